@@ -1,6 +1,7 @@
 #include <stdint.h>
 #include <string.h>
 #include <cpu.h>
+#include <ipxe/cpuid.h>
 
 /** @file
  *
@@ -33,41 +34,54 @@ static inline int flag_is_changeable ( unsigned int flag ) {
 	return ( ( ( f1 ^ f2 ) & flag ) != 0 );
 }
 
+/**
+ * Check whether or not CPUID instruction is supported
+ *
+ * @ret is_supported	CPUID instruction is supported
+ */
+int cpuid_is_supported ( void ) {
+	return flag_is_changeable ( X86_EFLAGS_ID );
+}
+
 /**
  * Get CPU information
  *
  * @v cpu		CPU information structure to fill in
  */
 void get_cpuinfo ( struct cpuinfo_x86 *cpu ) {
-	unsigned int cpuid_level;
-	unsigned int cpuid_extlevel;
-	unsigned int discard_1, discard_2, discard_3;
+	uint32_t cpuid_level;
+	uint32_t cpuid_extlevel;
+	uint32_t discard_1, discard_2, discard_3;
 
 	memset ( cpu, 0, sizeof ( *cpu ) );
 
 	/* Check for CPUID instruction */
-	if ( ! flag_is_changeable ( X86_EFLAGS_ID ) ) {
+	if ( ! cpuid_is_supported() ) {
 		DBG ( "CPUID not supported\n" );
 		return;
 	}
 
 	/* Get features, if present */
-	cpuid ( 0x00000000, &cpuid_level, &discard_1,
+	cpuid ( CPUID_VENDOR_ID, 0, &cpuid_level, &discard_1,
 		&discard_2, &discard_3 );
-	if ( cpuid_level >= 0x00000001 ) {
-		cpuid ( 0x00000001, &discard_1, &discard_2,
+	if ( cpuid_level >= CPUID_FEATURES ) {
+		cpuid ( CPUID_FEATURES, 0, &discard_1, &discard_2,
 			&discard_3, &cpu->features );
 	} else {
 		DBG ( "CPUID cannot return capabilities\n" );
 	}
 
 	/* Get 64-bit features, if present */
-	cpuid ( 0x80000000, &cpuid_extlevel, &discard_1,
+	cpuid ( 0x80000000, 0, &cpuid_extlevel, &discard_1,
 		&discard_2, &discard_3 );
 	if ( ( cpuid_extlevel & 0xffff0000 ) == 0x80000000 ) {
 		if ( cpuid_extlevel >= 0x80000001 ) {
-			cpuid ( 0x80000001, &discard_1, &discard_2,
+			cpuid ( 0x80000001, 0, &discard_1, &discard_2,
 				&discard_3, &cpu->amd_features );
 		}
+		if ( cpuid_extlevel >= 0x80000007 ) {
+			cpuid ( 0x80000007, 0, &discard_1, &discard_2,
+				&discard_3, &cpu->apm_features );
+		}
 	}
 }
@@ -84,7 +84,8 @@ void bigint_multiply_raw ( const uint32_t *multiplicand0,
 					       : "0" ( multiplicand_element ),
 						 "g" ( multiplier_element ),
 						 "r" ( result_elements ),
-						 "2" ( 0 ) );
+						 "2" ( 0 )
+					       : "memory" );
 		}
 	}
 }
@@ -75,6 +75,45 @@ static void undinet_close ( struct net_device *netdev );
 /** Address of UNDI entry point */
 static SEGOFF16_t undinet_entry;
 
+/*****************************************************************************
+ *
+ * UNDI receive staging buffer
+ *
+ *****************************************************************************
+ */
+
+/** An UNDI receive staging record
+ *
+ * Each call to PXENV_UNDI_ISR made while draining the receive queue
+ * in real mode produces one record, consisting of the PXENV_EXIT_xxx
+ * code, the returned parameter block and (for
+ * #PXENV_UNDI_ISR_OUT_RECEIVE) a copy of the fragment data.
+ */
+struct undinet_rx_record {
+	/** PXE exit code */
+	uint16_t exit;
+	/** PXENV_UNDI_ISR parameter block */
+	struct s_PXENV_UNDI_ISR isr;
+	/** Fragment data */
+	uint8_t data[0];
+} __attribute__ (( packed ));
+
+/** Maximum number of receive fragments drained per real-mode call */
+#define UNDINET_RX_BATCH 4
+
+/** Length of UNDI receive staging buffer */
+#define UNDINET_RX_STAGE_LEN \
+	( UNDINET_RX_BATCH * \
+	  ( sizeof ( struct undinet_rx_record ) + BASEMEM_PACKET_LEN ) )
+
+/** UNDI receive staging buffer */
+static uint8_t __bss16_array ( undinet_rx_stage, [UNDINET_RX_STAGE_LEN] );
+#define undinet_rx_stage __use_data16 ( undinet_rx_stage )
+
+/** UNDI entry point, as used by the real-mode receive drain loop */
+static SEGOFF16_t __bss16 ( undinet_rx_entry );
+#define undinet_rx_entry __use_data16 ( undinet_rx_entry )
+
 /*****************************************************************************
  *
  * UNDI interrupt service routine
@@ -264,6 +303,95 @@ static int undinet_transmit ( struct net_device *netdev,
 	return rc;
 }
 
+/**
+ * Drain UNDI receive queue into staging buffer
+ *
+ * @v funcflag		Initial function flag
+ * @ret len		Length of staging records
+ *
+ * Calls PXENV_UNDI_ISR repeatedly from within a single real-mode
+ * call, copying each received fragment into the base-memory staging
+ * buffer.  The loop stops after the first call that fails or returns
+ * anything other than #PXENV_UNDI_ISR_OUT_RECEIVE or
+ * #PXENV_UNDI_ISR_OUT_TRANSMIT, or once #UNDINET_RX_BATCH fragments
+ * have been received.  Transmit completions are discarded without
+ * generating a record.  Fragments longer than #BASEMEM_PACKET_LEN are
+ * truncated.
+ */
+static size_t undinet_isr_drain ( unsigned int funcflag ) {
+	unsigned int end;
+	unsigned int discard_a;
+	unsigned int discard_b;
+	unsigned int discard_c;
+
+	memcpy ( &undinet_rx_entry, &undinet_entry,
+		 sizeof ( undinet_rx_entry ) );
+	__asm__ __volatile__ (
+		REAL_CODE ( "cld\n\t"
+			    "\n3:\n\t"
+			    /* Issue PXENV_UNDI_ISR using the record's
+			     * parameter block.
+			     */
+			    "movw %%bx, 4(%%di)\n\t"
+			    "pushw %%cx\n\t"
+			    "pushw %%di\n\t"
+			    "addw $2, %%di\n\t"
+			    "pushw %%es\n\t"
+			    "pushw %%di\n\t"
+			    "pushw %[function]\n\t"
+			    "lcall *undinet_rx_entry\n\t"
+			    "cli\n\t"
+			    "addw $6, %%sp\n\t"
+			    "popw %%di\n\t"
+			    "popw %%cx\n\t"
+			    "movw %%cs:rm_ds, %%dx\n\t"
+			    "movw %%dx, %%ds\n\t"
+			    "movw %%dx, %%es\n\t"
+			    "movw %%ax, (%%di)\n\t"
+			    "movw %[get_next], %%bx\n\t"
+			    /* Stop on failure or on anything other
+			     * than a transmit or receive event.
+			     */
+			    "testw %%ax, %%ax\n\t"
+			    "jnz 5f\n\t"
+			    "movw 4(%%di), %%ax\n\t"
+			    "cmpw %[transmit], %%ax\n\t"
+			    "je 3b\n\t"
+			    "cmpw %[receive], %%ax\n\t"
+			    "jne 5f\n\t"
+			    /* Copy fragment into record */
+			    "pushw %%cx\n\t"
+			    "movw 6(%%di), %%cx\n\t"
+			    "cmpw %[max_len], %%cx\n\t"
+			    "jbe 4f\n\t"
+			    "movw %[max_len], %%cx\n\t"
+			    "\n4:\n\t"
+			    "ldsw 12(%%di), %%si\n\t"
+			    "addw %[hdr_len], %%di\n\t"
+			    "rep movsb\n\t"
+			    "movw %%dx, %%ds\n\t"
+			    "popw %%cx\n\t"
+			    "decw %%cx\n\t"
+			    "jnz 3b\n\t"
+			    "jmp 6f\n\t"
+			    "\n5:\n\t"
+			    "addw %[hdr_len], %%di\n\t"
+			    "\n6:\n\t" )
+		: "=D" ( end ), "=a" ( discard_a ), "=b" ( discard_b ),
+		  "=c" ( discard_c )
+		: "D" ( __from_data16 ( &undinet_rx_stage ) ),
+		  "b" ( funcflag ), "c" ( UNDINET_RX_BATCH ),
+		  [function] "i" ( PXENV_UNDI_ISR ),
+		  [get_next] "i" ( PXENV_UNDI_ISR_IN_GET_NEXT ),
+		  [transmit] "i" ( PXENV_UNDI_ISR_OUT_TRANSMIT ),
+		  [receive] "i" ( PXENV_UNDI_ISR_OUT_RECEIVE ),
+		  [max_len] "i" ( BASEMEM_PACKET_LEN ),
+		  [hdr_len] "i" ( sizeof ( struct undinet_rx_record ) )
+		: "edx", "esi", "ebp" );
+
+	return ( end - __from_data16 ( &undinet_rx_stage ) );
+}
+
 /** 
  * Poll for received packets
  *
@@ -296,12 +424,15 @@ static int undinet_transmit ( struct net_device *netdev,
  */
 static void undinet_poll ( struct net_device *netdev ) {
 	struct undi_nic *undinic = netdev->priv;
-	struct s_PXENV_UNDI_ISR undi_isr;
+	struct undinet_rx_record *record;
 	struct io_buffer *iobuf = NULL;
+	unsigned int funcflag;
+	size_t offset;
+	size_t stage_len;
 	size_t len;
 	size_t frag_len;
+	size_t copy_len;
 	size_t max_frag_len;
-	int rc;
 
 	if ( ! undinic->isr_processing ) {
 		/* Allow interrupt to occur.  Do this even if
@@ -326,26 +457,36 @@ static void undinet_poll ( struct net_device *netdev ) {
 
 		/* Start ISR processing */
 		undinic->isr_processing = 1;
-		undi_isr.FuncFlag = PXENV_UNDI_ISR_IN_PROCESS;
+		funcflag = PXENV_UNDI_ISR_IN_PROCESS;
 	} else {
 		/* Continue ISR processing */
-		undi_isr.FuncFlag = PXENV_UNDI_ISR_IN_GET_NEXT;
+		funcflag = PXENV_UNDI_ISR_IN_GET_NEXT;
 	}
 
-	/* Run through the ISR loop */
-	while ( 1 ) {
-		if ( ( rc = pxeparent_call ( undinet_entry, PXENV_UNDI_ISR,
-					     &undi_isr,
-					     sizeof ( undi_isr ) ) ) != 0 )
-			break;
-		switch ( undi_isr.FuncFlag ) {
-		case PXENV_UNDI_ISR_OUT_TRANSMIT:
-			/* We don't care about transmit completions */
-			break;
+	/* Run through the ISR loop, draining as many fragments as
+	 * possible into the staging buffer within a single real-mode
+	 * call.  If the staging buffer fills up, ISR processing will
+	 * be continued on the next poll.
+	 */
+	stage_len = undinet_isr_drain ( funcflag );
+	for ( offset = 0 ; offset < stage_len ;
+	      offset += ( sizeof ( *record ) + copy_len ) ) {
+		record = ( ( void * ) &undinet_rx_stage[offset] );
+		copy_len = 0;
+		if ( record->exit != PXENV_EXIT_SUCCESS ) {
+			DBGC ( undinic, "UNDINIC %p PXENV_UNDI_ISR failed: "
+			       "%s\n", undinic,
+			       strerror ( -record->isr.Status ) );
+			goto done;
+		}
+		switch ( record->isr.FuncFlag ) {
 		case PXENV_UNDI_ISR_OUT_RECEIVE:
 			/* Packet fragment received */
-			len = undi_isr.FrameLength;
-			frag_len = undi_isr.BufferLength;
+			len = record->isr.FrameLength;
+			frag_len = record->isr.BufferLength;
+			copy_len = frag_len;
+			if ( copy_len > BASEMEM_PACKET_LEN )
+				copy_len = BASEMEM_PACKET_LEN;
 			if ( ( len == 0 ) || ( len < frag_len ) ) {
 				/* Don't laugh.  VMWare does it. */
 				DBGC ( undinic, "UNDINIC %p reported insane "
@@ -362,19 +503,20 @@ static void undinet_poll ( struct net_device *netdev ) {
 				       undinic, len );
 				/* Fragment will be dropped */
 				netdev_rx_err ( netdev, NULL, -ENOMEM );
-				goto done;
+				break;
 			}
 			max_frag_len = iob_tailroom ( iobuf );
-			if ( frag_len > max_frag_len ) {
+			if ( copy_len > max_frag_len ) {
 				DBGC ( undinic, "UNDINIC %p fragment too big "
 				       "(%zd+%zd does not fit into %zd)\n",
 				       undinic, iob_len ( iobuf ), frag_len,
 				       ( iob_len ( iobuf ) + max_frag_len ) );
-				frag_len = max_frag_len;
+				memcpy ( iob_put ( iobuf, max_frag_len ),
+					 record->data, max_frag_len );
+			} else {
+				memcpy ( iob_put ( iobuf, copy_len ),
+					 record->data, copy_len );
 			}
-			copy_from_real ( iob_put ( iobuf, frag_len ),
-					 undi_isr.Frame.segment,
-					 undi_isr.Frame.offset, frag_len );
 			if ( iob_len ( iobuf ) == len ) {
 				/* Whole packet received; deliver it */
 				netdev_rx ( netdev, iob_disown ( iobuf ) );
@@ -392,11 +534,11 @@ static void undinet_poll ( struct net_device *netdev ) {
 		default:
 			/* Should never happen.  VMWare does it routinely. */
 			DBGC ( undinic, "UNDINIC %p ISR returned invalid "
-			       "FuncFlag %04x\n", undinic, undi_isr.FuncFlag );
+			       "FuncFlag %04x\n", undinic,
+			       record->isr.FuncFlag );
 			undinic->isr_processing = 0;
 			goto done;
 		}
-		undi_isr.FuncFlag = PXENV_UNDI_ISR_IN_GET_NEXT;
 	}
 
  done:
@@ -508,8 +650,11 @@ static void undinet_close ( struct net_device *netdev ) {
 static void undinet_irq ( struct net_device *netdev, int enable ) {
 	struct undi_nic *undinic = netdev->priv;
 
-	/* Cannot support interrupts yet */
-	DBGC ( undinic, "UNDINIC %p cannot %s interrupts\n",
+	/* Cannot support interrupts yet.  (Our ISR remains hooked
+	 * while the device is open, which is sufficient to wake from
+	 * a nap.)
+	 */
+	DBGC2 ( undinic, "UNDINIC %p cannot %s interrupts\n",
 	       undinic, ( enable ? "enable" : "disable" ) );
 }
 
@@ -629,6 +774,10 @@ int undinet_probe ( struct undi_device *undi ) {
 	if ( ( undi_iface.ServiceFlags & SUPPORTED_IRQ ) &&
 	     ( undinic->irq != 0 ) ) {
 		undinic->irq_supported = 1;
+		/* Our ISR acknowledges the interrupt via the UNDI
+		 * stack, so it is safe to nap awaiting packets.
+		 */
+		netdev->state |= NETDEV_IRQ_WAKE;
 	}
 	DBGC ( undinic, "UNDINIC %p using %s mode\n", undinic,
 	       ( undinic->irq_supported ? "interrupt" : "polling" ) );
@@ -18,8 +18,11 @@
 
 FILE_LICENCE ( GPL2_OR_LATER );
 
+#include <ipxe/device.h>
+#include <ipxe/init.h>
 #include <realmode.h>
 #include <undipreload.h>
+#include <usr/autoboot.h>
 
 /** @file
  *
@@ -35,3 +38,22 @@ FILE_LICENCE ( GPL2_OR_LATER );
  * claim this device must zero out this data structure.
  */
 struct undi_device __data16 ( preloaded_undi );
+
+/**
+ * Initialise autoboot device from preloaded UNDI device
+ *
+ * If we were loaded via PXE, the device from which we were loaded is
+ * the most likely boot device.
+ */
+static void undipreload_init ( void ) {
+	struct undi_device *undi = &preloaded_undi;
+
+	if ( undi->entry.segment &&
+	     ( undi->pci_busdevfn != UNDI_NO_PCI_BUSDEVFN ) )
+		set_autoboot_busloc ( BUS_TYPE_PCI, undi->pci_busdevfn );
+}
+
+/** Preloaded UNDI device initialisation function */
+struct init_fn undipreload_init_fn __init_fn ( INIT_NORMAL ) = {
+	.initialise = undipreload_init,
+};
@@ -49,6 +49,9 @@ FILE_LICENCE ( GPL2_OR_LATER );
 
 #define ATTR_DEFAULT		ATTR_FCOL_WHITE
 
+/** Maximum number of characters printed in a single real-mode call */
+#define BIOS_WRITE_MAX		128
+
 /* Set default console usage if applicable */
 #if ! ( defined ( CONSOLE_PCBIOS ) && CONSOLE_EXPLICIT ( CONSOLE_PCBIOS ) )
 #undef CONSOLE_PCBIOS
@@ -58,6 +61,10 @@ FILE_LICENCE ( GPL2_OR_LATER );
 /** Current character attribute */
 static unsigned int bios_attr = ATTR_DEFAULT;
 
+/** Base memory buffer used to pass strings to real-mode code */
+static char __bss16_array ( bios_write_buf, [BIOS_WRITE_MAX] );
+#define bios_write_buf __use_data16 ( bios_write_buf )
+
 /**
  * Handle ANSI CUP (cursor position)
  *
@@ -194,6 +201,97 @@ static void bios_putchar ( int character ) {
 			       : "ebp" );
 }
 
+/**
+ * Print a run of characters to BIOS console
+ *
+ * @v count		Number of characters in bios_write_buf
+ *
+ * All characters are printed within a single real-mode transition,
+ * using the same sequence of INT 10 calls as bios_putchar().
+ */
+static void bios_write_run ( unsigned int count ) {
+	int discard_a, discard_b, discard_c, discard_S;
+
+	__asm__ __volatile__ ( REAL_CODE ( "sti\n\t"
+					   "cld\n\t"
+					   "\n1:\n\t"
+					   "lodsb\n\t"
+					   "pushw %%cx\n\t"
+					   "pushw %%bx\n\t"
+					   "pushw %%si\n\t"
+					   /* Skip non-printable characters */
+					   "cmpb $0x20, %%al\n\t"
+					   "jb 2f\n\t"
+					   /* Read attribute */
+					   "movb %%al, %%cl\n\t"
+					   "movb $0x08, %%ah\n\t"
+					   "int $0x10\n\t"
+					   "xchgb %%al, %%cl\n\t"
+					   /* Skip if attribute matches */
+					   "cmpb %%ah, %%bl\n\t"
+					   "je 2f\n\t"
+					   /* Set attribute */
+					   "movw $0x0001, %%cx\n\t"
+					   "movb $0x09, %%ah\n\t"
+					   "int $0x10\n\t"
+					   "\n2:\n\t"
+					   /* Print character */
+					   "xorw %%bx, %%bx\n\t"
+					   "movb $0x0e, %%ah\n\t"
+					   "int $0x10\n\t"
+					   /* Move to next character */
+					   "popw %%si\n\t"
+					   "popw %%bx\n\t"
+					   "popw %%cx\n\t"
+					   "loop 1b\n\t"
+					   "cli\n\t" )
+			       : "=a" ( discard_a ), "=b" ( discard_b ),
+				 "=c" ( discard_c ), "=S" ( discard_S )
+			       : "b" ( bios_attr ), "c" ( count ),
+				 "S" ( __from_data16 ( bios_write_buf ) )
+			       : "ebp" );
+}
+
+/**
+ * Print a string to BIOS console
+ *
+ * @v data		Characters to be printed
+ * @v len		Number of characters
+ *
+ * Runs of characters lying outside ANSI escape sequences are printed
+ * using a single real-mode transition, rather than one transition
+ * per character.
+ */
+static void bios_write ( const char *data, size_t len ) {
+	unsigned int count = 0;
+	int character;
+
+	while ( len-- ) {
+		character = *( ( const unsigned char * ) data++ );
+
+		/* Add characters outside escape sequences to the run */
+		if ( ( bios_ansiesc_ctx.count == 0 ) && ( character != ESC ) ) {
+			bios_write_buf[count++] = character;
+			if ( count < BIOS_WRITE_MAX )
+				continue;
+		}
+
+		/* Write out run, if applicable */
+		if ( count ) {
+			bios_write_run ( count );
+			count = 0;
+		}
+
+		/* Process escape sequence characters */
+		if ( bios_ansiesc_ctx.count || ( character == ESC ) )
+			bios_putchar ( character );
+	}
+
+	/* Write out final run, if applicable */
+	if ( count )
+		bios_write_run ( count );
+}
+
 /**
  * Pointer to current ANSI output sequence
  *
@@ -326,6 +424,7 @@ static int bios_iskey ( void ) {
 
 struct console_driver bios_console __console_driver = {
 	.putchar = bios_putchar,
+	.write = bios_write,
 	.getchar = bios_getchar,
 	.iskey = bios_iskey,
 	.usage = CONSOLE_PCBIOS,
@@ -73,6 +73,8 @@ struct bzimage_context {
 	physaddr_t ramdisk_image;
 	/** Initrd size */
 	physaddr_t ramdisk_size;
+	/** Initrd images are to be used in place */
+	int ramdisk_in_place;
 
 	/** Command line magic block */
 	struct bzimage_cmdline cmdline_magic;
@@ -321,30 +323,31 @@ static int bzimage_set_cmdline ( struct image *image,
 }
 
 /**
- * Load initrd
+ * Construct cpio header for initrd
  *
  * @v image		bzImage image
  * @v initrd		initrd image
- * @v address		Address at which to load, or UNULL
- * @ret len		Length of loaded image, rounded up to 4 bytes
+ * @v address		Address at which to construct header, or UNULL
+ * @ret len		Length of header, rounded up to 4 bytes
+ *
+ * No header is required for images without a filename (which are
+ * assumed to be prebuilt cpio archives).
  */
-static size_t bzimage_load_initrd ( struct image *image,
-				    struct image *initrd,
-				    userptr_t address ) {
+static size_t bzimage_initrd_header ( struct image *image,
+				      struct image *initrd,
+				      userptr_t address ) {
 	char *filename = initrd->cmdline;
 	struct cpio_header cpio;
-        size_t offset = 0;
-
-	/* Do not include kernel image itself as an initrd */
-	if ( initrd == image )
-		return 0;
+	size_t name_len;
+	size_t offset = 0;
 
 	/* Create cpio header before non-prebuilt images */
 	if ( filename && filename[0] ) {
-		size_t name_len = ( strlen ( filename ) + 1 );
-
-		DBGC ( image, "bzImage %p inserting initrd %p as %s\n",
-		       image, initrd, filename );
+		name_len = ( strlen ( filename ) + 1 );
+		if ( address ) {
+			DBGC ( image, "bzImage %p inserting initrd %p as %s\n",
+			       image, initrd, filename );
+		}
 		memset ( &cpio, '0', sizeof ( cpio ) );
 		memcpy ( cpio.c_magic, CPIO_MAGIC, sizeof ( cpio.c_magic ) );
 		cpio_set_field ( cpio.c_mode, 0100644 );
@@ -364,6 +367,29 @@ static size_t bzimage_load_initrd ( struct image *image,
 		offset = ( ( offset + 0x03 ) & ~0x03 );
 	}
 
+	return offset;
+}
+
+/**
+ * Load initrd
+ *
+ * @v image		bzImage image
+ * @v initrd		initrd image
+ * @v address		Address at which to load, or UNULL
+ * @ret len		Length of loaded image, rounded up to 4 bytes
+ */
+static size_t bzimage_load_initrd ( struct image *image,
+				    struct image *initrd,
+				    userptr_t address ) {
+	size_t offset;
+
+	/* Do not include kernel image itself as an initrd */
+	if ( initrd == image )
+		return 0;
+
+	/* Create cpio header, if applicable */
+	offset = bzimage_initrd_header ( image, initrd, address );
+
 	/* Copy in initrd image body */
 	if ( address )
 		memcpy_user ( address, offset, initrd->data, 0, initrd->len );
@@ -379,6 +405,90 @@ static size_t bzimage_load_initrd ( struct image *image,
 	return offset;
 }
 
+/**
+ * Check whether initrds can be used in place
+ *
+ * @v image		bzImage image
+ * @v bzimg		bzImage context
+ * @ret in_place	initrds can be used in place
+ *
+ * If the initrd images already lie in ascending order within memory
+ * accessible to the kernel, with sufficient space before each image
+ * to hold its cpio header, then the initrd can be constructed without
+ * copying any image bodies.
+ */
+static int bzimage_initrds_in_place ( struct image *image,
+				      struct bzimage_context *bzimg ) {
+	struct image *initrd;
+	physaddr_t start = 0;
+	physaddr_t end = 0;
+	physaddr_t data;
+	size_t hdr_len;
+
+	/* Check that each image starts at a suitable address, beyond
+	 * the end of the previous image.
+	 */
+	for_each_image ( initrd ) {
+		if ( initrd == image )
+			continue;
+		hdr_len = bzimage_initrd_header ( image, initrd, UNULL );
+		data = user_to_phys ( initrd->data, 0 );
+		if ( ( data & 0x03 ) || ( data < ( end + hdr_len ) ) )
+			return 0;
+		if ( ! end )
+			start = ( data - hdr_len );
+		end = ( data + initrd->len );
+	}
+
+	/* Check that we're not going to overwrite the kernel itself
+	 * (using the same check as for a copied initrd), and that we
+	 * are within the kernel's range.
+	 */
+	if ( ( ! end ) || ( start <= ( BZI_LOAD_HIGH_ADDR + image->len ) ) ||
+	     ( ( end - 1 ) > bzimg->mem_limit ) )
+		return 0;
+
+	/* Record initrd location */
+	bzimg->ramdisk_image = start;
+	bzimg->ramdisk_size = ( end - start );
+	bzimg->ramdisk_in_place = 1;
+	DBGC ( image, "bzImage %p using initrds in place at [%lx,%lx)\n",
+	       image, start, end );
+
+	return 1;
+}
+
+/**
+ * Construct in-place initrd
+ *
+ * @v image		bzImage image
+ * @v bzimg		bzImage context
+ *
+ * The gaps between in-place initrd images may contain arbitrary
+ * external memory allocations (including the external heap's own
+ * metadata), and so this must be called only once iPXE has shut
+ * down.  The gaps are zeroed, since the kernel's cpio parser will
+ * skip over any zero padding between archive members.
+ */
+static void bzimage_place_initrds ( struct image *image,
+				    struct bzimage_context *bzimg ) {
+	struct image *initrd;
+	physaddr_t address = bzimg->ramdisk_image;
+	physaddr_t header;
+
+	for_each_image ( initrd ) {
+		if ( initrd == image )
+			continue;
+		header = ( user_to_phys ( initrd->data, 0 ) -
+			   bzimage_initrd_header ( image, initrd, UNULL ) );
+		memset_user ( phys_to_user ( address ), 0, 0,
+			      ( header - address ) );
+		bzimage_initrd_header ( image, initrd,
+					phys_to_user ( header ) );
+		address = user_to_phys ( initrd->data, initrd->len );
+	}
+}
+
 /**
  * Load initrds, if any
  *
@@ -401,6 +511,10 @@ static int bzimage_load_initrds ( struct image *image,
 	if ( ! total_len )
 		return 0;
 
+	/* Use initrds in place, if possible */
+	if ( bzimage_initrds_in_place ( image, bzimg ) )
+		return 0;
+
 	/* Find a suitable start address.  Try 1MB boundaries,
 	 * starting from the downloaded kernel image itself and
 	 * working downwards until we hit an available region.
@@ -499,6 +613,10 @@ static int bzimage_exec ( struct image *image ) {
 	/* Prepare for exiting */
 	shutdown_boot();
 
+	/* Construct in-place initrd, if applicable */
+	if ( bzimg.ramdisk_in_place )
+		bzimage_place_initrds ( image, &bzimg );
+
 	DBGC ( image, "bzImage %p jumping to RM kernel at %04x:0000 "
 	       "(stack %04x:%04zx)\n", image, ( bzimg.rm_kernel_seg + 0x20 ),
 	       bzimg.rm_kernel_seg, bzimg.rm_heap );
@@ -14,6 +14,9 @@ FILE_LICENCE ( GPL2_OR_LATER );
 /** Element of a big integer */
 typedef uint32_t bigint_element_t;
 
+/** Double-length element of a big integer */
+typedef uint64_t bigint_double_element_t;
+
 /**
  * Initialise big integer
  *
@@ -40,7 +43,7 @@ bigint_init_raw ( uint32_t *value0, unsigned int size,
 			       : "=&D" ( discard_D ), "=&c" ( discard_c )
 			       : "r" ( data ), "g" ( pad_len ), "0" ( value0 ),
 				 "1" ( len )
-			       : "eax" );
+			       : "eax", "memory" );
 }
 
 /**
@@ -66,7 +69,7 @@ bigint_add_raw ( const uint32_t *addend0, uint32_t *value0,
 			       : "=&r" ( index ), "=&S" ( discard_S ),
 				 "=&c" ( discard_c )
 			       : "r" ( value0 ), "1" ( addend0 ), "2" ( size )
-			       : "eax" );
+			       : "eax", "memory" );
 }
 
 /**
@@ -93,7 +96,7 @@ bigint_subtract_raw ( const uint32_t *subtrahend0, uint32_t *value0,
 				 "=&c" ( discard_c )
 			       : "r" ( value0 ), "1" ( subtrahend0 ),
 				 "2" ( size )
-			       : "eax" );
+			       : "eax", "memory" );
 }
 
 /**
@@ -113,7 +116,8 @@ bigint_rol_raw ( uint32_t *value0, unsigned int size ) {
 			       "inc %0\n\t" /* Does not affect CF */
 			       "loop 1b\n\t"
 			       : "=&r" ( index ), "=&c" ( discard_c )
-			       : "r" ( value0 ), "1" ( size ) );
+			       : "r" ( value0 ), "1" ( size )
+			       : "memory" );
 }
 
 /**
@@ -131,7 +135,8 @@ bigint_ror_raw ( uint32_t *value0, unsigned int size ) {
 			       "rcrl $1, -4(%1,%0,4)\n\t"
 			       "loop 1b\n\t"
 			       : "=&c" ( discard_c )
-			       : "r" ( value0 ), "0" ( size ) );
+			       : "r" ( value0 ), "0" ( size )
+			       : "memory" );
 }
 
 /**
@@ -152,7 +157,8 @@ bigint_is_zero_raw ( const uint32_t *value0, unsigned int size ) {
 			       "sete %b0\n\t"
 			       : "=&a" ( result ), "=&D" ( discard_D ),
 				 "=&c" ( discard_c )
-			       : "1" ( value0 ), "2" ( size ) );
+			       : "1" ( value0 ), "2" ( size )
+			       : "memory" );
 	return result;
 }
 
@@ -188,7 +194,7 @@ bigint_is_geq_raw ( const uint32_t *value0, const uint32_t *reference0,
 			       : "0" ( 0 ), "1" ( &value->element[ size - 1 ] ),
 				 "2" ( &reference->element[ size - 1 ] ),
 				 "3" ( size )
-			       : "eax" );
+			       : "eax", "memory" );
 	return result;
 }
 
@@ -233,7 +239,8 @@ bigint_max_set_bit_raw ( const uint32_t *value0, unsigned int size ) {
 			       "xor %0, %0\n\t"
 			       "\n2:\n\t"
 			       : "=&r" ( result ), "=&c" ( discard_c )
-			       : "r" ( value0 ), "1" ( size ) );
+			       : "r" ( value0 ), "1" ( size )
+			       : "memory" );
 	return result;
 }
 
@@ -261,7 +268,7 @@ bigint_grow_raw ( const uint32_t *source0, unsigned int source_size,
 				 "=&c" ( discard_c )
 			       : "g" ( pad_size ), "0" ( dest0 ),
 				 "1" ( source0 ), "2" ( source_size )
-			       : "eax" );
+			       : "eax", "memory" );
 }
 
 /**
@@ -284,7 +291,7 @@ bigint_shrink_raw ( const uint32_t *source0, unsigned int source_size __unused,
 				 "=&c" ( discard_c )
 			       : "0" ( dest0 ), "1" ( source0 ),
 				 "2" ( dest_size )
-			       : "eax" );
+			       : "eax", "memory" );
 }
 
 /**
@@ -308,7 +315,7 @@ bigint_done_raw ( const uint32_t *value0, unsigned int size __unused,
 			       "loop 1b\n\t"
 			       : "=&D" ( discard_D ), "=&c" ( discard_c )
 			       : "r" ( value0 ), "0" ( out ), "1" ( len )
-			       : "eax" );
+			       : "eax", "memory" );
 }
 
 extern void bigint_multiply_raw ( const uint32_t *multiplicand0,
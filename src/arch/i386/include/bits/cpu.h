@@ -41,12 +41,17 @@
 #define X86_FEATURE_3DNOWEXT	30 /* AMD 3DNow! extensions */
 #define X86_FEATURE_3DNOW	31 /* 3DNow! */
 
+/* Advanced power management features, CPUID level 0x80000007 */
+#define X86_FEATURE_INVARIANT_TSC 8 /* TSC runs at a constant rate */
+
 /** x86 CPU information */
 struct cpuinfo_x86 {
 	/** CPU features */
 	unsigned int features;
 	/** 64-bit CPU features */
 	unsigned int amd_features;
+	/** Advanced power management features */
+	unsigned int apm_features;
 };
 
 /*
@@ -70,17 +75,6 @@ struct cpuinfo_x86 {
 #define X86_EFLAGS_VIP	0x00100000 /* Virtual Interrupt Pending */
 #define X86_EFLAGS_ID	0x00200000 /* CPUID detection flag */
 
-/*
- * Generic CPUID function
- */
-static inline __attribute__ (( always_inline )) void
-cpuid ( int op, unsigned int *eax, unsigned int *ebx,
-	unsigned int *ecx, unsigned int *edx ) {
-	__asm__ ( "cpuid" :
-		  "=a" ( *eax ), "=b" ( *ebx ), "=c" ( *ecx ), "=d" ( *edx )
-		: "0" ( op ) );
-}
-
 extern void get_cpuinfo ( struct cpuinfo_x86 *cpu );
 
 #endif /* I386_BITS_CPU_H */
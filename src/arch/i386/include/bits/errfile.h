@@ -19,6 +19,8 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #define ERRFILE_vmware		( ERRFILE_ARCH | ERRFILE_CORE | 0x00080000 )
 #define ERRFILE_guestrpc	( ERRFILE_ARCH | ERRFILE_CORE | 0x00090000 )
 #define ERRFILE_guestinfo	( ERRFILE_ARCH | ERRFILE_CORE | 0x000a0000 )
+#define ERRFILE_bios_acpi	( ERRFILE_ARCH | ERRFILE_CORE | 0x000b0000 )
+#define ERRFILE_pciecam		( ERRFILE_ARCH | ERRFILE_CORE | 0x000c0000 )
 
 #define ERRFILE_bootsector     ( ERRFILE_ARCH | ERRFILE_IMAGE | 0x00000000 )
 #define ERRFILE_bzimage	       ( ERRFILE_ARCH | ERRFILE_IMAGE | 0x00010000 )
@@ -0,0 +1,16 @@
+#ifndef _IPXE_BIOS_ACPI_H
+#define _IPXE_BIOS_ACPI_H
+
+/** @file
+ *
+ * Standard PC-BIOS ACPI interface
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <ipxe/uaccess.h>
+
+extern userptr_t bios_find_rsdt ( void );
+
+#endif /* _IPXE_BIOS_ACPI_H */
@@ -30,15 +30,4 @@ TIMER_INLINE ( pcbios, udelay ) ( unsigned long usecs ) {
 	timer2_udelay ( usecs );
 }
 
-/**
- * Get number of ticks per second
- *
- * @ret ticks_per_sec	Number of ticks per second
- */
-static inline __always_inline unsigned long
-TIMER_INLINE ( pcbios, ticks_per_sec ) ( void ) {
-	/* BIOS timer ticks over at 18.2 ticks per second */
-	return 18;
-}
-
 #endif /* _IPXE_BIOS_TIMER_H */
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <string.h>
+#include <byteswap.h>
+#include <ipxe/uaccess.h>
+#include <ipxe/acpi.h>
+#include <ipxe/bios_acpi.h>
+#include <realmode.h>
+#include <bios.h>
+
+/** @file
+ *
+ * Standard PC-BIOS ACPI interface
+ *
+ */
+
+/** Start of BIOS read-only memory area searched for the RSDP */
+#define RSDP_BIOS_START 0xe0000
+
+/** Length of BIOS read-only memory area searched for the RSDP */
+#define RSDP_BIOS_LEN 0x20000
+
+/** Length of extended BIOS data area searched for the RSDP */
+#define RSDP_EBDA_LEN 0x400
+
+/**
+ * Locate ACPI root system description table within a memory range
+ *
+ * @v start		Start of memory range
+ * @v len		Length of memory range
+ * @ret rsdt		ACPI root system description table, or UNULL
+ *
+ * The RSDP is always aligned on a 16-byte boundary.
+ */
+static userptr_t bios_find_rsdt_range ( userptr_t start, size_t len ) {
+	static const char signature[8] = RSDP_SIGNATURE;
+	struct acpi_rsdp rsdp;
+	userptr_t rsdt;
+	size_t offset;
+	unsigned int i;
+	uint8_t sum;
+
+	/* Search for RSDP */
+	for ( offset = 0 ; offset < len ; offset += 16 ) {
+
+		/* Check signature and checksum */
+		copy_from_user ( &rsdp, start, offset, sizeof ( rsdp ) );
+		if ( memcmp ( rsdp.signature, signature,
+			      sizeof ( signature ) ) != 0 )
+			continue;
+		for ( sum = 0, i = 0 ; i < sizeof ( rsdp ) ; i++ )
+			sum += *( ( ( uint8_t * ) &rsdp ) + i );
+		if ( sum != 0 )
+			continue;
+
+		/* Extract RSDT */
+		rsdt = phys_to_user ( le32_to_cpu ( rsdp.rsdt ) );
+		DBG ( "RSDT %#08lx found via RSDP %#08lx\n",
+		      user_to_phys ( rsdt, 0 ), user_to_phys ( start, offset ));
+		return rsdt;
+	}
+
+	return UNULL;
+}
+
+/**
+ * Locate ACPI root system description table
+ *
+ * @ret rsdt		ACPI root system description table, or UNULL
+ */
+userptr_t bios_find_rsdt ( void ) {
+	uint16_t ebda_seg;
+	userptr_t rsdt;
+
+	/* Search within first kB of EBDA */
+	get_real ( ebda_seg, BDA_SEG, BDA_EBDA );
+	if ( ebda_seg ) {
+		rsdt = bios_find_rsdt_range ( real_to_user ( ebda_seg, 0 ),
+					      RSDP_EBDA_LEN );
+		if ( rsdt )
+			return rsdt;
+	}
+
+	/* Search within BIOS read-only memory area */
+	rsdt = bios_find_rsdt_range ( phys_to_user ( RSDP_BIOS_START ),
+				      RSDP_BIOS_LEN );
+	if ( rsdt )
+		return rsdt;
+
+	DBG ( "No RSDP found\n" );
+	return UNULL;
+}
@@ -25,19 +25,63 @@ FILE_LICENCE ( GPL2_OR_LATER );
  */
 
 #include <ipxe/timer.h>
+#include <ipxe/timer2.h>
 #include <realmode.h>
 #include <bios.h>
+#include <cpu.h>
+
+/** BIOS timer ticks over at 18.2 ticks per second */
+#define BIOS_TICKS_PER_SEC 18
+
+/** TSC calibration time (in microseconds) */
+#define BIOS_TSC_CALIBRATE_US 10000
+
+/** Number of BIOS synchronisations per BIOS timer tick
+ *
+ * When a TSC is available, we return to real mode (to read the BIOS
+ * tick counter and to allow pending interrupts to be serviced) only
+ * this many times per BIOS timer tick, as measured by the TSC.
+ */
+#define BIOS_SYNC_PER_TICK 4
+
+/** Maximum number of calls to currticks() between BIOS synchronisations
+ *
+ * A TSC that is not invariant may slow down or stop (e.g. while the
+ * CPU is halted), so we also resynchronise after this many calls.
+ */
+#define BIOS_SYNC_MAX_CALLS 64
+
+/** Number of TSC ticks per second, or zero if TSC is not in use */
+static unsigned long bios_tsc_ticks_per_sec;
+
+/** TSC is invariant and is in use as the tick source */
+static int bios_tsc_invariant;
+
+/** TSC availability has been checked */
+static int bios_tsc_checked;
+
+/** Number of TSC ticks between BIOS synchronisations */
+static unsigned long bios_sync_interval;
+
+/** TSC value at last BIOS synchronisation */
+static unsigned long bios_sync_tsc;
+
+/** BIOS tick count at last BIOS synchronisation */
+static unsigned long bios_sync_ticks;
+
+/** Number of calls to currticks() since last BIOS synchronisation */
+static unsigned int bios_sync_calls;
 
 /**
- * Get current system time in ticks
+ * Synchronise with BIOS
  *
- * @ret ticks		Current time, in ticks
+ * @ret ticks		BIOS tick count
  *
  * Use direct memory access to BIOS variables, longword 0040:006C
  * (ticks today) and byte 0040:0070 (midnight crossover flag) instead
  * of calling timeofday BIOS interrupt.
  */
-static unsigned long bios_currticks ( void ) {
+static unsigned long bios_sync ( void ) {
 	static int days = 0;
 	uint32_t ticks;
 	uint8_t midnight;
@@ -57,9 +101,114 @@ static unsigned long bios_currticks ( void ) {
 		days += 0x1800b0;
 	}
 
-	return ( days + ticks );
+	/* Record synchronisation */
+	bios_sync_ticks = ( days + ticks );
+	bios_sync_calls = 0;
+	if ( bios_tsc_ticks_per_sec )
+		bios_sync_tsc = __rdtsc_currticks();
+
+	return bios_sync_ticks;
+}
+
+/**
+ * Check for usable TSC
+ *
+ * @ret tsc		TSC is usable as the tick source
+ *
+ * If the CPU has a TSC, then calibrate it against timer2 so that it
+ * can be used to limit the rate of BIOS synchronisations.  If the
+ * TSC is also invariant (i.e. runs at a constant rate regardless of
+ * power management state), then use it in place of the (18.2Hz)
+ * BIOS timer tick.  This gives retry timers and round-trip time
+ * estimates a resolution of well under a microsecond.
+ */
+static int bios_tsc ( void ) {
+	struct cpuinfo_x86 cpu;
+	unsigned long start;
+	unsigned long elapsed;
+
+	/* Check for TSC only once */
+	if ( bios_tsc_checked )
+		return bios_tsc_invariant;
+	bios_tsc_checked = 1;
+
+	/* Check for a TSC */
+	get_cpuinfo ( &cpu );
+	if ( ! ( cpu.features & ( 1 << X86_FEATURE_TSC ) ) ) {
+		DBG ( "BIOS timer using BIOS ticks (no TSC)\n" );
+		return 0;
+	}
+
+	/* Calibrate TSC */
+	start = __rdtsc_currticks();
+	timer2_udelay ( BIOS_TSC_CALIBRATE_US );
+	elapsed = ( __rdtsc_currticks() - start );
+	bios_tsc_ticks_per_sec =
+		( elapsed * ( 1000000 / BIOS_TSC_CALIBRATE_US ) );
+	bios_sync_interval = ( bios_tsc_ticks_per_sec /
+			       ( BIOS_TICKS_PER_SEC * BIOS_SYNC_PER_TICK ) );
+	bios_sync();
+
+	/* Use TSC as the tick source only if it is invariant */
+	bios_tsc_invariant =
+		( ( bios_tsc_ticks_per_sec != 0 ) &&
+		  ( cpu.apm_features & ( 1 << X86_FEATURE_INVARIANT_TSC ) ) );
+	if ( bios_tsc_invariant ) {
+		DBG ( "BIOS timer using TSC (%ld ticks/sec)\n",
+		      bios_tsc_ticks_per_sec );
+	} else {
+		DBG ( "BIOS timer using BIOS ticks (TSC not invariant, %ld "
+		      "ticks/sec)\n", bios_tsc_ticks_per_sec );
+	}
+
+	return bios_tsc_invariant;
+}
+
+/**
+ * Get current system time in ticks
+ *
+ * @ret ticks		Current time, in ticks
+ *
+ * Returning to real mode is expensive relative to the frequency with
+ * which currticks() is called.  If a TSC is available, then we
+ * synchronise with the BIOS only a few times per BIOS timer tick,
+ * and otherwise return either the TSC (if invariant) or the BIOS
+ * tick count as of the last synchronisation.
+ */
+static unsigned long bios_currticks ( void ) {
+	unsigned long tsc;
+	int invariant;
+
+	/* Synchronise on every call if there is no TSC */
+	invariant = bios_tsc();
+	if ( ! bios_tsc_ticks_per_sec )
+		return bios_sync();
+
+	/* Synchronise only if due */
+	tsc = __rdtsc_currticks();
+	if ( ( ( tsc - bios_sync_tsc ) >= bios_sync_interval ) ||
+	     ( ( ++bios_sync_calls >= BIOS_SYNC_MAX_CALLS ) &&
+	       ( ! invariant ) ) ) {
+		bios_sync();
+	}
+
+	return ( invariant ? tsc : bios_sync_ticks );
+}
+
+/**
+ * Get number of ticks per second
+ *
+ * @ret ticks_per_sec	Number of ticks per second
+ */
+static unsigned long bios_ticks_per_sec ( void ) {
+
+	/* Use TSC, if available */
+	if ( bios_tsc() )
+		return bios_tsc_ticks_per_sec;
+
+	return BIOS_TICKS_PER_SEC;
 }
 
 PROVIDE_TIMER_INLINE ( pcbios, udelay );
 PROVIDE_TIMER ( pcbios, currticks, bios_currticks );
-PROVIDE_TIMER_INLINE ( pcbios, ticks_per_sec );
+PROVIDE_TIMER ( pcbios, ticks_per_sec, bios_ticks_per_sec );
@@ -20,6 +20,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <stdio.h>
 #include <limits.h>
 #include <byteswap.h>
 #include <errno.h>
@@ -37,11 +38,16 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/sanboot.h>
 #include <ipxe/device.h>
 #include <ipxe/pci.h>
+#include <ipxe/init.h>
+#include <ipxe/blockcache.h>
+#include <ipxe/blockstat.h>
+#include <ipxe/umalloc.h>
 #include <realmode.h>
 #include <bios.h>
 #include <biosint.h>
 #include <bootsector.h>
 #include <int13.h>
+#include <config/general.h>
 
 /** @file
  *
@@ -63,6 +69,35 @@ FILE_LICENCE ( GPL2_OR_LATER );
  */
 #define INT13_COMMAND_TIMEOUT ( 15 * TICKS_PER_SEC )
 
+/**
+ * Maximum number of concurrent INT 13 commands
+ *
+ * A single INT 13 read or write may be split into several fragments.
+ * Issuing these fragments concurrently (subject to the underlying
+ * block device's flow control window) hides the network latency of
+ * each individual fragment.
+ */
+#define INT13_MAX_COMMANDS 8
+
+/**
+ * An INT 13 emulated drive path
+ *
+ * A drive may be reachable via several alternative paths (e.g. iSCSI
+ * sessions via different network devices).  Commands are spread
+ * across all usable paths, and a command that fails on one path is
+ * retried on another.
+ */
+struct int13_path {
+	/** Emulated drive */
+	struct int13_drive *int13;
+	/** Block device URI */
+	struct uri *uri;
+	/** Underlying block device interface */
+	struct interface block;
+	/** Underlying device status, if in error */
+	int block_rc;
+};
+
 /** An INT 13 emulated drive */
 struct int13_drive {
 	/** Reference count */
@@ -70,11 +105,6 @@ struct int13_drive {
 	/** List of all registered drives */
 	struct list_head list;
 
-	/** Block device URI */
-	struct uri *uri;
-	/** Underlying block device interface */
-	struct interface block;
-
 	/** BIOS in-use drive number (0x00-0xff) */
 	unsigned int drive;
 	/** BIOS natural drive number (0x00-0xff)
@@ -129,10 +159,26 @@ struct int13_drive {
 	/** Address of El Torito boot catalog (if any) */
 	unsigned int boot_catalog;
 
-	/** Underlying device status, if in error */
-	int block_rc;
+	/** Read-ahead cache */
+	struct block_cache cache;
+	/** In-memory copy of entire device, or UNULL
+	 *
+	 * If present, all reads and writes are satisfied from this
+	 * copy, and the underlying block device is no longer used.
+	 */
+	userptr_t ramdisk;
+	/** Statistics */
+	struct block_device_stats stats;
+
 	/** Status of last operation */
 	int last_status;
+
+	/** Index of next path to be used for issuing commands */
+	unsigned int next_path;
+	/** Number of paths */
+	unsigned int num_paths;
+	/** Paths */
+	struct int13_path paths[0];
 };
 
 /** Vector for chaining to other INT 13 handlers */
@@ -228,10 +274,23 @@ struct int13_command {
 	int rc;
 	/** INT 13 drive */
 	struct int13_drive *int13;
+	/** Drive path */
+	struct int13_path *path;
 	/** Underlying block device interface */
 	struct interface block;
 	/** Command timeout timer */
 	struct retry_timer timer;
+
+	/** Starting logical block address */
+	uint64_t lba;
+	/** Number of logical blocks */
+	unsigned int count;
+	/** Data buffer */
+	userptr_t buffer;
+	/** Number of attempts to fail over to an alternative path */
+	unsigned int failovers;
+	/** Time at which command was issued */
+	unsigned long started;
 };
 
 /**
@@ -268,6 +327,7 @@ static void int13_command_expired ( struct retry_timer *timer,
 	struct int13_command *command =
 		container_of ( timer, struct int13_command, timer );
 
+	command->int13->stats.timeouts++;
 	int13_command_close ( command, -ETIMEDOUT );
 }
 
@@ -282,32 +342,146 @@ static struct interface_operation int13_command_op[] = {
 static struct interface_descriptor int13_command_desc =
 	INTF_DESC ( struct int13_command, block, int13_command_op );
 
+/** INT 13 commands */
+static struct int13_command int13_commands[INT13_MAX_COMMANDS];
+
 /**
- * Open (or reopen) INT 13 emulated drive underlying block device
+ * Open (or reopen) INT 13 emulated drive path underlying block device
  *
- * @v int13		Emulated drive
+ * @v path		Drive path
  * @ret rc		Return status code
  */
-static int int13_reopen_block ( struct int13_drive *int13 ) {
+static int int13_path_reopen ( struct int13_path *path ) {
+	struct int13_drive *int13 = path->int13;
 	int rc;
 
 	/* Close any existing block device */
-	intf_restart ( &int13->block, -ECONNRESET );
+	intf_restart ( &path->block, -ECONNRESET );
 
 	/* Open block device */
-	if ( ( rc = xfer_open_uri ( &int13->block, int13->uri ) ) != 0 ) {
-		DBGC ( int13, "INT13 drive %02x could not reopen block "
-		       "device: %s\n", int13->drive, strerror ( rc ) );
-		int13->block_rc = rc;
+	if ( ( rc = xfer_open_uri ( &path->block, path->uri ) ) != 0 ) {
+		DBGC ( int13, "INT13 drive %02x path %d could not reopen "
+		       "block device: %s\n", int13->drive,
+		       ( ( int ) ( path - int13->paths ) ), strerror ( rc ) );
+		path->block_rc = rc;
 		return rc;
 	}
 
 	/* Clear block device error status */
-	int13->block_rc = 0;
+	path->block_rc = 0;
 
 	return 0;
 }
 
+/**
+ * Check if INT 13 emulated drive path has commands in progress
+ *
+ * @v path		Drive path
+ * @ret busy		Path has commands in progress
+ */
+static int int13_path_busy ( struct int13_path *path ) {
+	unsigned int i;
+
+	for ( i = 0 ; i < INT13_MAX_COMMANDS ; i++ ) {
+		if ( int13_commands[i].path == path )
+			return 1;
+	}
+	return 0;
+}
+
+/**
+ * Find usable INT 13 emulated drive path
+ *
+ * @v int13		Emulated drive
+ * @ret path		Drive path, or NULL if no path is usable
+ */
+static struct int13_path * int13_usable_path ( struct int13_drive *int13 ) {
+	struct int13_path *path;
+	unsigned int i;
+
+	for ( i = 0 ; i < int13->num_paths ; i++ ) {
+		path = &int13->paths[i];
+		if ( path->block_rc == 0 )
+			return path;
+	}
+	return NULL;
+}
+
+/**
+ * Get INT 13 emulated drive status
+ *
+ * @v int13		Emulated drive
+ * @ret rc		Return status code
+ *
+ * The drive is usable if at least one path is usable.
+ */
+static int int13_block_status ( struct int13_drive *int13 ) {
+
+	if ( int13_usable_path ( int13 ) )
+		return 0;
+	return int13->paths[ int13->num_paths - 1 ].block_rc;
+}
+
+/**
+ * Open (or reopen) all INT 13 emulated drive paths
+ *
+ * @v int13		Emulated drive
+ * @ret rc		Return status code
+ */
+static int int13_reopen_block ( struct int13_drive *int13 ) {
+	unsigned int i;
+
+	for ( i = 0 ; i < int13->num_paths ; i++ )
+		int13_path_reopen ( &int13->paths[i] );
+	return int13_block_status ( int13 );
+}
+
+/**
+ * Reopen any failed INT 13 emulated drive paths
+ *
+ * @v int13		Emulated drive
+ * @ret rc		Return status code
+ *
+ * Paths with commands still in progress are left untouched, rather
+ * than being reopened underneath those commands.
+ */
+static int int13_reopen_failed ( struct int13_drive *int13 ) {
+	struct int13_path *path;
+	unsigned int i;
+
+	for ( i = 0 ; i < int13->num_paths ; i++ ) {
+		path = &int13->paths[i];
+		if ( ( path->block_rc != 0 ) && ! int13_path_busy ( path ) )
+			int13_path_reopen ( path );
+	}
+	return int13_block_status ( int13 );
+}
+
+/**
+ * Select INT 13 emulated drive path for a new command
+ *
+ * @v int13		Emulated drive
+ * @ret path		Drive path, or NULL if no path is ready
+ *
+ * Paths are used in turn, to spread commands across all paths.
+ */
+static struct int13_path * int13_select_path ( struct int13_drive *int13 ) {
+	struct int13_path *path;
+	unsigned int i;
+
+	for ( i = 0 ; i < int13->num_paths ; i++ ) {
+		path = &int13->paths[ ( int13->next_path + i ) %
+				      int13->num_paths ];
+		if ( ( path->block_rc == 0 ) &&
+		     ( xfer_window ( &path->block ) != 0 ) ) {
+			int13->next_path = ( ( ( path - int13->paths ) + 1 ) %
+					     int13->num_paths );
+			return path;
+		}
+	}
+	return NULL;
+}
+
 /**
  * Prepare to issue INT 13 command
  *
@@ -317,15 +491,16 @@ static int int13_reopen_block ( struct int13_drive *int13 ) {
  */
 static int int13_command_start ( struct int13_command *command,
 				 struct int13_drive *int13 ) {
+	struct int13_path *path;
 	int rc;
 
 	/* Sanity check */
 	assert ( command->int13 == NULL );
+	assert ( command->path == NULL );
 	assert ( ! timer_running ( &command->timer ) );
 
-	/* Reopen block device if necessary */
-	if ( ( int13->block_rc != 0 ) &&
-	     ( ( rc = int13_reopen_block ( int13 ) ) != 0 ) )
+	/* Reopen block device paths if necessary */
+	if ( ( rc = int13_reopen_failed ( int13 ) ) != 0 )
 		return rc;
 
 	/* Initialise command */
@@ -333,14 +508,18 @@ static int int13_command_start ( struct int13_command *command,
 	command->int13 = int13;
 	start_timer_fixed ( &command->timer, INT13_COMMAND_TIMEOUT );
 
-	/* Wait for block control interface to become ready */
-	while ( ( command->rc == -EINPROGRESS ) &&
-		( xfer_window ( &int13->block ) == 0 ) ) {
+	/* Wait for a block control interface to become ready */
+	while ( command->rc == -EINPROGRESS ) {
+		if ( ( path = int13_select_path ( int13 ) ) != NULL ) {
+			command->path = path;
+			return 0;
+		}
+		if ( ( rc = int13_block_status ( int13 ) ) != 0 )
+			return rc;
 		step();
 	}
 
-	return ( ( command->rc == -EINPROGRESS ) ?
-		 int13->block_rc : command->rc );
+	return command->rc;
 }
 
 /**
@@ -370,32 +549,192 @@ static int int13_command_wait ( struct int13_command *command ) {
 static void int13_command_stop ( struct int13_command *command ) {
 	stop_timer ( &command->timer );
 	command->int13 = NULL;
+	command->path = NULL;
+}
+
+/**
+ * Initialise INT 13 commands
+ *
+ */
+static void int13_command_init ( void ) {
+	struct int13_command *command;
+	unsigned int i;
+
+	for ( i = 0 ; i < INT13_MAX_COMMANDS ; i++ ) {
+		command = &int13_commands[i];
+		intf_init ( &command->block, &int13_command_desc, NULL );
+		timer_init ( &command->timer, int13_command_expired, NULL );
+	}
 }
 
-/** The single active INT 13 command */
-static struct int13_command int13_command = {
-	.block = INTF_INIT ( int13_command_desc ),
-	.timer = TIMER_INIT ( int13_command_expired ),
+/** INT 13 command initialisation function */
+struct init_fn int13_command_init_fn __init_fn ( INIT_NORMAL ) = {
+	.initialise = int13_command_init,
 };
 
 /**
- * Read from or write to INT 13 drive
+ * Abort all INT 13 commands for an emulated drive
  *
  * @v int13		Emulated drive
+ * @v rc		Reason for abort
+ */
+static void int13_command_abort ( struct int13_drive *int13, int rc ) {
+	struct int13_command *command;
+	unsigned int i;
+
+	for ( i = 0 ; i < INT13_MAX_COMMANDS ; i++ ) {
+		command = &int13_commands[i];
+		if ( command->int13 != int13 )
+			continue;
+		int13_command_close ( command, rc );
+		int13_command_stop ( command );
+	}
+}
+
+/**
+ * Issue INT 13 read or write command
+ *
+ * @v command		INT 13 command
+ * @v int13		Emulated drive
  * @v lba		Starting logical block address
  * @v count		Number of logical blocks
  * @v buffer		Data buffer
  * @v block_rw		Block read/write method
  * @ret rc		Return status code
  */
-static int int13_rw ( struct int13_drive *int13, uint64_t lba,
-		      unsigned int count, userptr_t buffer,
-		      int ( * block_rw ) ( struct interface *control,
-					   struct interface *data,
-					   uint64_t lba, unsigned int count,
-					   userptr_t buffer, size_t len ) ) {
-	struct int13_command *command = &int13_command;
+static int int13_command_rw ( struct int13_command *command,
+			      struct int13_drive *int13, uint64_t lba,
+			      unsigned int count, userptr_t buffer,
+			      int ( * block_rw ) ( struct interface *control,
+						   struct interface *data,
+						   uint64_t lba,
+						   unsigned int count,
+						   userptr_t buffer,
+						   size_t len ) ) {
+	size_t len = ( int13->capacity.blksize * count );
+	int rc;
+
+	/* Issue command */
+	if ( ( ( rc = int13_command_start ( command, int13 ) ) != 0 ) ||
+	     ( ( rc = block_rw ( &command->path->block, &command->block,
+				 lba, count, buffer, len ) ) != 0 ) ) {
+		int13_command_stop ( command );
+		return rc;
+	}
+
+	/* Record parameters for a possible failover */
+	command->lba = lba;
+	command->count = count;
+	command->buffer = buffer;
+
+	/* Record statistics */
+	block_stats_issued ( &int13->stats );
+	command->started = currticks();
+
+	return 0;
+}
+
+/**
+ * Reap completed INT 13 commands for an emulated drive
+ *
+ * @v int13		Emulated drive
+ * @v active		Number of commands still in progress to fill in
+ * @v block_rw		Block read/write method
+ * @ret rc		Return status code
+ *
+ * A command that failed will be retried via an alternative path, if
+ * one exists.
+ */
+static int int13_command_reap ( struct int13_drive *int13,
+				unsigned int *active,
+				int ( * block_rw ) ( struct interface *control,
+						     struct interface *data,
+						     uint64_t lba,
+						     unsigned int count,
+						     userptr_t buffer,
+						     size_t len ) ) {
+	struct int13_command *command;
+	unsigned int i;
+	int rc;
+
+	*active = 0;
+	for ( i = 0 ; i < INT13_MAX_COMMANDS ; i++ ) {
+		command = &int13_commands[i];
+		if ( command->int13 != int13 )
+			continue;
+		if ( command->rc == -EINPROGRESS ) {
+			(*active)++;
+			continue;
+		}
+		rc = command->rc;
+		int13_command_stop ( command );
+		block_stats_done ( &int13->stats,
+				   ( currticks() - command->started ),
+				   ( int13->capacity.blksize * command->count ),
+				   ( block_rw == block_write ), rc );
+		if ( ( rc != 0 ) && ( int13->num_paths > 1 ) &&
+		     ( command->failovers++ < int13->num_paths ) ) {
+			DBGC ( int13, "INT13 drive %02x failing over after "
+			       "error: %s\n", int13->drive, strerror ( rc ) );
+			int13->stats.retries++;
+			rc = int13_command_rw ( command, int13, command->lba,
+						command->count,
+						command->buffer, block_rw );
+			if ( rc == 0 ) {
+				(*active)++;
+				continue;
+			}
+		}
+		if ( rc != 0 )
+			return rc;
+	}
+	return 0;
+}
+
+/**
+ * Find an unused INT 13 command
+ *
+ * @ret command		INT 13 command, or NULL
+ */
+static struct int13_command * int13_command_find_free ( void ) {
+	struct int13_command *command;
+	unsigned int i;
+
+	for ( i = 0 ; i < INT13_MAX_COMMANDS ; i++ ) {
+		command = &int13_commands[i];
+		if ( ! command->int13 )
+			return command;
+	}
+	return NULL;
+}
+
+/**
+ * Read from or write to INT 13 drive, bypassing read-ahead cache
+ *
+ * @v int13		Emulated drive
+ * @v lba		Starting logical block address
+ * @v count		Number of logical blocks
+ * @v buffer		Data buffer
+ * @v block_rw		Block read/write method
+ * @ret rc		Return status code
+ *
+ * The transfer is split into fragments no larger than the underlying
+ * block device's maximum transfer size.  Fragments are issued without
+ * waiting for preceding fragments to complete, up to the limit of
+ * INT13_MAX_COMMANDS concurrent commands, and are spread across all
+ * usable paths.
+ */
+static int int13_rw_direct ( struct int13_drive *int13, uint64_t lba,
+			     unsigned int count, userptr_t buffer,
+			     int ( * block_rw ) ( struct interface *control,
+						  struct interface *data,
+						  uint64_t lba,
+						  unsigned int count,
+						  userptr_t buffer,
+						  size_t len ) ) {
+	struct int13_command *command;
 	unsigned int frag_count;
+	unsigned int active = 0;
 	size_t frag_len;
 	int rc;
 
@@ -403,34 +742,203 @@ static int int13_rw ( struct int13_drive *int13, uint64_t lba,
 	lba <<= int13->blksize_shift;
 	count <<= int13->blksize_shift;
 
-	while ( count ) {
-
-		/* Determine fragment length */
-		frag_count = count;
-		if ( frag_count > int13->capacity.max_count )
-			frag_count = int13->capacity.max_count;
-		frag_len = ( int13->capacity.blksize * frag_count );
-
-		/* Issue command */
-		if ( ( ( rc = int13_command_start ( command, int13 ) ) != 0 ) ||
-		     ( ( rc = block_rw ( &int13->block, &command->block, lba,
-					 frag_count, buffer,
-					 frag_len ) ) != 0 ) ||
-		     ( ( rc = int13_command_wait ( command ) ) != 0 ) ) {
-			int13_command_stop ( command );
-			return rc;
+	do {
+
+		/* Fail if all paths have failed while commands are
+		 * still in progress, rather than reopening them
+		 * underneath those commands.
+		 */
+		if ( active && ( ( rc = int13_block_status ( int13 ) ) != 0 ) )
+			goto err;
+
+		/* Issue next fragment, if a command is available */
+		command = ( count ? int13_command_find_free() : NULL );
+		if ( command ) {
+
+			/* Determine fragment length */
+			frag_count = count;
+			if ( frag_count > int13->capacity.max_count )
+				frag_count = int13->capacity.max_count;
+
+			/* Issue command */
+			command->failovers = 0;
+			if ( ( rc = int13_command_rw ( command, int13, lba,
+						       frag_count, buffer,
+						       block_rw ) ) != 0 )
+				goto err;
+
+			/* Move to next fragment */
+			lba += frag_count;
+			count -= frag_count;
+			frag_len = ( int13->capacity.blksize * frag_count );
+			buffer = userptr_add ( buffer, frag_len );
+
+		} else {
+
+			/* Wait for a command to complete */
+			step();
 		}
-		int13_command_stop ( command );
 
-		/* Move to next fragment */
-		lba += frag_count;
-		count -= frag_count;
-		buffer = userptr_add ( buffer, frag_len );
+		/* Reap any completed commands */
+		if ( ( rc = int13_command_reap ( int13, &active,
+						 block_rw ) ) != 0 )
+			goto err;
+
+	} while ( count || active );
+
+	return 0;
+
+ err:
+	int13_command_abort ( int13, rc );
+	return rc;
+}
+
+/**
+ * Read from INT 13 drive to fill read-ahead cache
+ *
+ * @v cache		Block cache
+ * @v lba		Starting logical block address
+ * @v count		Number of logical blocks
+ * @v buffer		Data buffer
+ * @ret rc		Return status code
+ */
+static int int13_cache_read ( struct block_cache *cache, uint64_t lba,
+			      unsigned int count, userptr_t buffer ) {
+	struct int13_drive *int13 =
+		container_of ( cache, struct int13_drive, cache );
+
+	return int13_rw_direct ( int13, lba, count, buffer, block_read );
+}
+
+/**
+ * Read from or write to INT 13 drive RAM disk
+ *
+ * @v int13		Emulated drive
+ * @v lba		Starting logical block address
+ * @v count		Number of logical blocks
+ * @v buffer		Data buffer
+ * @v block_rw		Block read/write method
+ * @ret rc		Return status code
+ *
+ * Writes modify only the in-memory copy of the device.
+ */
+static int int13_ramdisk_rw ( struct int13_drive *int13, uint64_t lba,
+			      unsigned int count, userptr_t buffer,
+			      int ( * block_rw ) ( struct interface *control,
+						   struct interface *data,
+						   uint64_t lba,
+						   unsigned int count,
+						   userptr_t buffer,
+						   size_t len ) ) {
+	size_t blksize = int13_blksize ( int13 );
+	off_t offset = ( lba * blksize );
+	size_t len = ( count * blksize );
+
+	/* Check range */
+	if ( ( lba > int13_capacity ( int13 ) ) ||
+	     ( count > ( int13_capacity ( int13 ) - lba ) ) ) {
+		DBGC ( int13, "INT13 drive %02x RAM disk access %#llx+%#x "
+		       "out of range\n", int13->drive,
+		       ( ( unsigned long long ) lba ), count );
+		return -ERANGE;
+	}
+
+	/* Copy data */
+	if ( block_rw == block_read ) {
+		memcpy_user ( buffer, 0, int13->ramdisk, offset, len );
+	} else {
+		memcpy_user ( int13->ramdisk, offset, buffer, 0, len );
+	}
+
+	return 0;
+}
+
+/**
+ * Copy INT 13 drive into memory
+ *
+ * @v int13		Emulated drive
+ * @ret rc		Return status code
+ *
+ * The entire underlying device is read into a RAM disk, using as
+ * many concurrent commands as are available in order to download at
+ * full streaming speed.  The RAM disk is allocated from external
+ * memory, which remains hidden from the operating system's memory
+ * map for as long as the drive remains registered.
+ */
+static int int13_load_ramdisk ( struct int13_drive *int13 ) {
+	uint64_t blocks = int13->capacity.blocks;
+	size_t blksize = int13->capacity.blksize;
+	userptr_t ramdisk;
+	size_t len;
+	int rc;
+
+	/* Check that device fits within memory */
+	if ( ( ! blocks ) || ( blocks > ( ~( ( size_t ) 0 ) / blksize ) ) ||
+	     ( blocks > UINT_MAX ) ) {
+		DBGC ( int13, "INT13 drive %02x too large for RAM disk\n",
+		       int13->drive );
+		return -ENOSPC;
+	}
+	len = ( blocks * blksize );
+
+	/* Allocate RAM disk */
+	ramdisk = umalloc ( len );
+	if ( ! ramdisk ) {
+		DBGC ( int13, "INT13 drive %02x could not allocate %zd-byte "
+		       "RAM disk\n", int13->drive, len );
+		return -ENOMEM;
+	}
+
+	/* Read entire device */
+	DBGC ( int13, "INT13 drive %02x loading %zd-byte RAM disk\n",
+	       int13->drive, len );
+	if ( ( rc = int13_rw_direct ( int13, 0, blocks, ramdisk,
+				      block_read ) ) != 0 ) {
+		DBGC ( int13, "INT13 drive %02x could not load RAM disk: %s\n",
+		       int13->drive, strerror ( rc ) );
+		ufree ( ramdisk );
+		return rc;
 	}
 
+	/* Use RAM disk for all subsequent accesses */
+	int13->ramdisk = ramdisk;
+	DBGC ( int13, "INT13 drive %02x loaded RAM disk at [%#08lx,%#08lx)\n",
+	       int13->drive, user_to_phys ( ramdisk, 0 ),
+	       user_to_phys ( ramdisk, len ) );
+
 	return 0;
 }
 
+/**
+ * Read from or write to INT 13 drive
+ *
+ * @v int13		Emulated drive
+ * @v lba		Starting logical block address
+ * @v count		Number of logical blocks
+ * @v buffer		Data buffer
+ * @v block_rw		Block read/write method
+ * @ret rc		Return status code
+ */
+static int int13_rw ( struct int13_drive *int13, uint64_t lba,
+		      unsigned int count, userptr_t buffer,
+		      int ( * block_rw ) ( struct interface *control,
+					   struct interface *data,
+					   uint64_t lba, unsigned int count,
+					   userptr_t buffer, size_t len ) ) {
+
+	/* Satisfy reads and writes from RAM disk, if present */
+	if ( int13->ramdisk )
+		return int13_ramdisk_rw ( int13, lba, count, buffer, block_rw );
+
+	/* Satisfy reads via the read-ahead cache */
+	if ( block_rw == block_read )
+		return block_cache_read ( &int13->cache, lba, count, buffer );
+
+	/* Discard any cached copy of blocks being written */
+	block_cache_invalidate ( &int13->cache, lba, count );
+	return int13_rw_direct ( int13, lba, count, buffer, block_rw );
+}
+
 /**
  * Read INT 13 drive capacity
  *
@@ -438,12 +946,12 @@ static int int13_rw ( struct int13_drive *int13, uint64_t lba,
  * @ret rc		Return status code
  */
 static int int13_read_capacity ( struct int13_drive *int13 ) {
-	struct int13_command *command = &int13_command;
+	struct int13_command *command = &int13_commands[0];
 	int rc;
 
 	/* Issue command */
 	if ( ( ( rc = int13_command_start ( command, int13 ) ) != 0 ) ||
-	     ( ( rc = block_read_capacity ( &int13->block,
+	     ( ( rc = block_read_capacity ( &command->path->block,
 					    &command->block ) ) != 0 ) ||
 	     ( ( rc = int13_command_wait ( command ) ) != 0 ) ) {
 		int13_command_stop ( command );
@@ -1158,19 +1666,21 @@ static int int13_extended_seek ( struct int13_drive *int13,
  */
 static int int13_device_path_info ( struct int13_drive *int13,
 				    struct edd_device_path_information *dpi ) {
+	struct int13_path *path;
 	struct device *device;
 	struct device_description *desc;
 	unsigned int i;
 	uint8_t sum = 0;
 	int rc;
 
-	/* Reopen block device if necessary */
-	if ( ( int13->block_rc != 0 ) &&
-	     ( ( rc = int13_reopen_block ( int13 ) ) != 0 ) )
+	/* Reopen block device paths if necessary */
+	if ( ( rc = int13_reopen_failed ( int13 ) ) != 0 )
 		return rc;
+	path = int13_usable_path ( int13 );
+	assert ( path != NULL );
 
 	/* Get underlying hardware device */
-	device = identify_device ( &int13->block );
+	device = identify_device ( &path->block );
 	if ( ! device ) {
 		DBGC ( int13, "INT13 drive %02x cannot identify hardware "
 		       "device\n", int13->drive );
@@ -1194,7 +1704,7 @@ static int int13_device_path_info ( struct int13_drive *int13,
 	}
 
 	/* Get EDD block device description */
-	if ( ( rc = edd_describe ( &int13->block, &dpi->interface_type,
+	if ( ( rc = edd_describe ( &path->block, &dpi->interface_type,
 				   &dpi->device_path ) ) != 0 ) {
 		DBGC ( int13, "INT13 drive %02x cannot identify block device: "
 		       "%s\n", int13->drive, strerror ( rc ) );
@@ -1524,9 +2034,9 @@ static void int13_unhook_vector ( void ) {
 /**
  * Check INT13 emulated drive flow control window
  *
- * @v int13		Emulated drive
+ * @v path		Drive path
  */
-static size_t int13_block_window ( struct int13_drive *int13 __unused ) {
+static size_t int13_block_window ( struct int13_path *path __unused ) {
 
 	/* We are never ready to receive data via this interface.
 	 * This prevents objects that support both block and stream
@@ -1538,34 +2048,36 @@ static size_t int13_block_window ( struct int13_drive *int13 __unused ) {
 /**
  * Handle INT 13 emulated drive underlying block device closing
  *
- * @v int13		Emulated drive
+ * @v path		Drive path
  * @v rc		Reason for close
  */
-static void int13_block_close ( struct int13_drive *int13, int rc ) {
+static void int13_block_close ( struct int13_path *path, int rc ) {
+	struct int13_drive *int13 = path->int13;
 
 	/* Any closing is an error from our point of view */
 	if ( rc == 0 )
 		rc = -ENOTCONN;
 
-	DBGC ( int13, "INT13 drive %02x went away: %s\n",
-	       int13->drive, strerror ( rc ) );
+	DBGC ( int13, "INT13 drive %02x path %d went away: %s\n",
+	       int13->drive, ( ( int ) ( path - int13->paths ) ),
+	       strerror ( rc ) );
 
 	/* Record block device error code */
-	int13->block_rc = rc;
+	path->block_rc = rc;
 
 	/* Shut down interfaces */
-	intf_restart ( &int13->block, rc );
+	intf_restart ( &path->block, rc );
 }
 
 /** INT 13 drive interface operations */
 static struct interface_operation int13_block_op[] = {
-	INTF_OP ( xfer_window, struct int13_drive *, int13_block_window ),
-	INTF_OP ( intf_close, struct int13_drive *, int13_block_close ),
+	INTF_OP ( xfer_window, struct int13_path *, int13_block_window ),
+	INTF_OP ( intf_close, struct int13_path *, int13_block_close ),
 };
 
 /** INT 13 drive interface descriptor */
 static struct interface_descriptor int13_block_desc =
-	INTF_DESC ( struct int13_drive, block, int13_block_op );
+	INTF_DESC ( struct int13_path, block, int13_block_op );
 
 /**
  * Free INT 13 emulated drive
@@ -1575,27 +2087,55 @@ static struct interface_descriptor int13_block_desc =
 static void int13_free ( struct refcnt *refcnt ) {
 	struct int13_drive *int13 =
 		container_of ( refcnt, struct int13_drive, refcnt );
+	unsigned int i;
 
-	uri_put ( int13->uri );
+	block_cache_free ( &int13->cache );
+	ufree ( int13->ramdisk );
+	for ( i = 0 ; i < int13->num_paths ; i++ )
+		uri_put ( int13->paths[i].uri );
 	free ( int13 );
 }
 
+/**
+ * Shut down INT 13 emulated drive paths
+ *
+ * @v int13		Emulated drive
+ * @v rc		Reason for shutdown
+ */
+static void int13_shutdown ( struct int13_drive *int13, int rc ) {
+	unsigned int i;
+
+	for ( i = 0 ; i < int13->num_paths ; i++ )
+		intf_shutdown ( &int13->paths[i].block, rc );
+}
+
 /**
  * Hook INT 13 emulated drive
  *
- * @v uri		URI
+ * @v uris		List of URIs
+ * @v count		Number of URIs
  * @v drive		Drive number
+ * @v flags		Flags
  * @ret rc		Return status code
  *
  * Registers the drive with the INT 13 emulation subsystem, and hooks
- * the INT 13 interrupt vector (if not already hooked).
+ * the INT 13 interrupt vector (if not already hooked).  Each URI is
+ * treated as an alternative path to the same underlying device.
  */
-static int int13_hook ( struct uri *uri, unsigned int drive ) {
+static int int13_hook ( struct uri **uris, unsigned int count,
+			unsigned int drive, unsigned int flags ) {
 	struct int13_drive *int13;
+	struct int13_path *path;
 	unsigned int natural_drive;
+	unsigned int i;
+	char name[12];
 	void *scratch;
 	int rc;
 
+	/* Sanity check */
+	if ( ! count )
+		return -EINVAL;
+
 	/* Calculate natural drive number */
 	int13_sync_num_drives();
 	natural_drive = ( ( drive & 0x80 ) ? ( num_drives | 0x80 ) : num_fdds );
@@ -1609,18 +2149,26 @@ static int int13_hook ( struct uri *uri, unsigned int drive ) {
 	}
 
 	/* Allocate and initialise structure */
-	int13 = zalloc ( sizeof ( *int13 ) );
+	int13 = zalloc ( sizeof ( *int13 ) +
+			 ( count * sizeof ( int13->paths[0] ) ) );
 	if ( ! int13 ) {
 		rc = -ENOMEM;
 		goto err_zalloc;
 	}
 	ref_init ( &int13->refcnt, int13_free );
-	intf_init ( &int13->block, &int13_block_desc, &int13->refcnt );
-	int13->uri = uri_get ( uri );
+	block_cache_init ( &int13->cache, int13_cache_read );
+	block_stats_init ( &int13->stats, &int13->refcnt );
 	int13->drive = drive;
 	int13->natural_drive = natural_drive;
+	int13->num_paths = count;
+	for ( i = 0 ; i < count ; i++ ) {
+		path = &int13->paths[i];
+		path->int13 = int13;
+		path->uri = uri_get ( uris[i] );
+		intf_init ( &path->block, &int13_block_desc, &int13->refcnt );
+	}
 
-	/* Open block device interface */
+	/* Open block device interfaces */
 	if ( ( rc = int13_reopen_block ( int13 ) ) != 0 )
 		goto err_reopen_block;
 
@@ -1628,6 +2176,11 @@ static int int13_hook ( struct uri *uri, unsigned int drive ) {
 	if ( ( rc = int13_read_capacity ( int13 ) ) != 0 )
 		goto err_read_capacity;
 
+	/* Copy device into memory, if applicable */
+	if ( ( flags & SAN_RAMDISK ) &&
+	     ( ( rc = int13_load_ramdisk ( int13 ) ) != 0 ) )
+		goto err_load_ramdisk;
+
 	/* Allocate scratch area */
 	scratch = malloc ( int13_blksize ( int13 ) );
 	if ( ! scratch )
@@ -1637,13 +2190,33 @@ static int int13_hook ( struct uri *uri, unsigned int drive ) {
 	if ( ( rc = int13_parse_iso9660 ( int13, scratch ) ) != 0 )
 		goto err_parse_iso9660;
 
+	/* Allocate read-ahead cache (unless the whole drive is
+	 * already in memory).  Failure is not fatal, since the drive
+	 * remains usable without the cache.
+	 */
+	if ( ( ! int13->ramdisk ) &&
+	     ( ( rc = block_cache_alloc ( &int13->cache,
+					  int13_blksize ( int13 ),
+					  int13_capacity ( int13 ),
+					  SANBOOT_CACHE_EXTENT_LEN,
+					  SANBOOT_CACHE_EXTENTS ) ) != 0 ) ) {
+		DBGC ( int13, "INT13 drive %02x could not allocate read-ahead "
+		       "cache: %s\n", int13->drive, strerror ( rc ) );
+	}
+
 	/* Give drive a default geometry */
 	if ( ( rc = int13_guess_geometry ( int13, scratch ) ) != 0 )
 		goto err_guess_geometry;
 
 	DBGC ( int13, "INT13 drive %02x (naturally %02x) registered with C/H/S "
-	       "geometry %d/%d/%d\n", int13->drive, int13->natural_drive,
-	       int13->cylinders, int13->heads, int13->sectors_per_track );
+	       "geometry %d/%d/%d via %d path(s)\n", int13->drive,
+	       int13->natural_drive, int13->cylinders, int13->heads,
+	       int13->sectors_per_track, int13->num_paths );
+
+	/* Register statistics */
+	snprintf ( name, sizeof ( name ), "san%02x", int13->drive );
+	if ( ( rc = block_stats_register ( &int13->stats, name ) ) != 0 )
+		goto err_stats_register;
 
 	/* Hook INT 13 vector if not already hooked */
 	if ( list_empty ( &int13s ) ) {
@@ -1660,13 +2233,15 @@ static int int13_hook ( struct uri *uri, unsigned int drive ) {
 	free ( scratch );
 	return 0;
 
+ err_stats_register:
  err_guess_geometry:
  err_parse_iso9660:
 	free ( scratch );
  err_alloc_scratch:
+ err_load_ramdisk:
  err_read_capacity:
  err_reopen_block:
-	intf_shutdown ( &int13->block, rc );
+	int13_shutdown ( int13, rc );
 	ref_put ( &int13->refcnt );
  err_zalloc:
  err_in_use:
@@ -1709,7 +2284,10 @@ static void int13_unhook ( unsigned int drive ) {
 	}
 
 	/* Shut down interfaces */
-	intf_shutdown ( &int13->block, 0 );
+	int13_shutdown ( int13, 0 );
+
+	/* Unregister statistics */
+	block_stats_unregister ( &int13->stats );
 
 	/* Remove from list of emulated drives */
 	list_del ( &int13->list );
@@ -1935,6 +2513,7 @@ static union xbft_table __bss16 ( xbftab ) __attribute__ (( aligned ( 16 ) ));
  */
 static int int13_describe ( unsigned int drive ) {
 	struct int13_drive *int13;
+	struct int13_path *path;
 	struct segoff xbft_address;
 	int rc;
 
@@ -1945,10 +2524,11 @@ static int int13_describe ( unsigned int drive ) {
 		return -ENODEV;
 	}
 
-	/* Reopen block device if necessary */
-	if ( ( int13->block_rc != 0 ) &&
-	     ( ( rc = int13_reopen_block ( int13 ) ) != 0 ) )
+	/* Reopen block device paths if necessary */
+	if ( ( rc = int13_reopen_failed ( int13 ) ) != 0 )
 		return rc;
+	path = int13_usable_path ( int13 );
+	assert ( path != NULL );
 
 	/* Clear table */
 	memset ( &xbftab, 0, sizeof ( xbftab ) );
@@ -1960,7 +2540,7 @@ static int int13_describe ( unsigned int drive ) {
 		  sizeof ( xbftab.acpi.oem_table_id ) );
 
 	/* Fill in remaining parameters */
-	if ( ( rc = acpi_describe ( &int13->block, &xbftab.acpi,
+	if ( ( rc = acpi_describe ( &path->block, &xbftab.acpi,
 				    sizeof ( xbftab ) ) ) != 0 ) {
 		DBGC ( int13, "INT13 drive %02x could not create ACPI "
 		       "description: %s\n", int13->drive, strerror ( rc ) );
@@ -35,6 +35,19 @@ FILE_LICENCE ( GPL2_OR_LATER );
 /** Alignment of external allocated memory */
 #define EM_ALIGN ( 4 * 1024 )
 
+/** Preferred minimum address of external heap
+ *
+ * The area immediately above 1MB is typically used for loading
+ * kernels and their decompressed images.  If the available memory
+ * region is large enough (at least EM_MIN_ADDR_RATIO times this
+ * address), then the external heap will start no lower than this
+ * address.
+ */
+#define EM_MIN_ADDR ( 64 * 1024 * 1024 )
+
+/** Minimum ratio of heap size to EM_MIN_ADDR for skipping low memory */
+#define EM_MIN_ADDR_RATIO 8
+
 /** Equivalent of NOWHERE for user pointers */
 #define UNOWHERE ( ~UNULL )
 
@@ -44,13 +57,18 @@ struct external_memory {
 	size_t size;
 	/** Block is currently in use */
 	int used;
+	/** Previously allocated block, or UNULL */
+	userptr_t prev;
 };
 
-/** Top of heap */
-static userptr_t top = UNULL;
+/** Bottom of heap (or UNULL if heap is not yet initialised) */
+static userptr_t base = UNULL;
+
+/** End of allocated memory within heap */
+static userptr_t end = UNULL;
 
-/** Bottom of heap (current lowest allocated block) */
-static userptr_t bottom = UNULL;
+/** Most recently allocated block, or UNULL */
+static userptr_t last = UNULL;
 
 /** Remaining space on heap */
 static size_t heap_size;
@@ -59,9 +77,16 @@ static size_t heap_size;
  * Initialise external heap
  *
  * @ret rc		Return status code
+ *
+ * The heap grows upwards from its base address, so that the most
+ * recently allocated block can always be expanded in place into the
+ * remaining free space.  In particular, the data of an image being
+ * downloaded never needs to be moved as the image grows.
  */
 static int init_eheap ( void ) {
 	struct memory_map memmap;
+	unsigned long start;
+	unsigned long skip;
 	unsigned int i;
 
 	DBG ( "Allocating external heap\n" );
@@ -92,7 +117,7 @@ static int init_eheap ( void ) {
 		r_size = ( r_end - r_start );
 		if ( r_size > heap_size ) {
 			DBG ( "...new best block found\n" );
-			top = bottom = phys_to_user ( r_end );
+			base = end = phys_to_user ( r_start );
 			heap_size = r_size;
 		}
 	}
@@ -102,8 +127,19 @@ static int init_eheap ( void ) {
 		return -ENOMEM;
 	}
 
-	DBG ( "External heap grows downwards from %lx (size %zx)\n",
-	      user_to_phys ( top, 0 ), heap_size );
+	/* Avoid the area typically used for loading kernels, if
+	 * this wastes only a small fraction of the available memory.
+	 */
+	start = user_to_phys ( base, 0 );
+	if ( ( start < EM_MIN_ADDR ) &&
+	     ( heap_size >= ( EM_MIN_ADDR_RATIO * EM_MIN_ADDR ) ) ) {
+		skip = ( ( EM_MIN_ADDR - start ) & ~( EM_ALIGN - 1 ) );
+		base = end = userptr_add ( base, skip );
+		heap_size -= skip;
+	}
+
+	DBG ( "External heap grows upwards from %lx (size %zx)\n",
+	      user_to_phys ( base, 0 ), heap_size );
 	return 0;
 }
 
@@ -113,19 +149,30 @@ static int init_eheap ( void ) {
  */
 static void ecollect_free ( void ) {
 	struct external_memory extmem;
-	size_t len;
+	userptr_t new_end;
 
-	/* Walk the free list and collect empty blocks */
-	while ( bottom != top ) {
-		copy_from_user ( &extmem, bottom, -sizeof ( extmem ),
+	/* Walk backwards from the most recently allocated block and
+	 * collect empty blocks.
+	 */
+	while ( last ) {
+		copy_from_user ( &extmem, last, -sizeof ( extmem ),
 				 sizeof ( extmem ) );
 		if ( extmem.used )
 			break;
-		DBG ( "EXTMEM freeing [%lx,%lx)\n", user_to_phys ( bottom, 0 ),
-		      user_to_phys ( bottom, extmem.size ) );
-		len = ( extmem.size + sizeof ( extmem ) );
-		bottom = userptr_add ( bottom, len );
-		heap_size += len;
+		DBG ( "EXTMEM freeing [%lx,%lx)\n", user_to_phys ( last, 0 ),
+		      user_to_phys ( last, extmem.size ) );
+		if ( extmem.prev ) {
+			copy_from_user ( &extmem.size, extmem.prev,
+					 -sizeof ( extmem ),
+					 sizeof ( extmem.size ) );
+			new_end = userptr_add ( extmem.prev, extmem.size );
+		} else {
+			new_end = base;
+		}
+		heap_size += ( user_to_phys ( end, 0 ) -
+			       user_to_phys ( new_end, 0 ) );
+		end = new_end;
+		last = extmem.prev;
 	}
 }
 
@@ -138,15 +185,19 @@ static void ecollect_free ( void ) {
  *
  * Calling realloc() with a new size of zero is a valid way to free a
  * memory block.
+ *
+ * Blocks are never moved when shrinking.  The most recently allocated
+ * block is expanded in place; any other block is moved to the end of
+ * the heap.
  */
 static userptr_t memtop_urealloc ( userptr_t ptr, size_t new_size ) {
 	struct external_memory extmem;
-	userptr_t new = ptr;
-	size_t align;
+	userptr_t new;
+	size_t pad;
 	int rc;
 
 	/* Initialise external memory allocator if necessary */
-	if ( bottom == top ) {
+	if ( ! base ) {
 		if ( ( rc = init_eheap() ) != 0 )
 			return UNULL;
 	}
@@ -157,62 +208,68 @@ static userptr_t memtop_urealloc ( userptr_t ptr, size_t new_size ) {
 		copy_from_user ( &extmem, ptr, -sizeof ( extmem ),
 				 sizeof ( extmem ) );
 	} else {
-		/* Create a zero-length block */
-		if ( heap_size < sizeof ( extmem ) ) {
+		/* Create a zero-length block at the end of the heap */
+		pad = ( ( - user_to_phys ( end, sizeof ( extmem ) ) ) &
+			( EM_ALIGN - 1 ) );
+		if ( ( sizeof ( extmem ) + pad + new_size ) > heap_size ) {
 			DBG ( "EXTMEM out of space\n" );
 			return UNULL;
 		}
-		ptr = bottom = userptr_add ( bottom, -sizeof ( extmem ) );
-		heap_size -= sizeof ( extmem );
+		ptr = end = userptr_add ( end, ( sizeof ( extmem ) + pad ) );
+		heap_size -= ( sizeof ( extmem ) + pad );
 		DBG ( "EXTMEM allocating [%lx,%lx)\n",
 		      user_to_phys ( ptr, 0 ), user_to_phys ( ptr, 0 ) );
 		extmem.size = 0;
+		extmem.prev = last;
+		last = ptr;
 	}
 	extmem.used = ( new_size > 0 );
 
-	/* Expand/shrink block if possible */
-	if ( ptr == bottom ) {
-		/* Update block */
-		if ( new_size > ( heap_size - extmem.size ) ) {
+	/* Expand/shrink block */
+	if ( ptr == last ) {
+		/* Expand or shrink in place */
+		if ( new_size > ( heap_size + extmem.size ) ) {
 			DBG ( "EXTMEM out of space\n" );
 			return UNULL;
 		}
-		new = userptr_add ( ptr, - ( new_size - extmem.size ) );
-		align = ( user_to_phys ( new, 0 ) & ( EM_ALIGN - 1 ) );
-		new_size += align;
-		new = userptr_add ( new, -align );
-		DBG ( "EXTMEM expanding [%lx,%lx) to [%lx,%lx)\n",
+		DBG ( "EXTMEM resizing [%lx,%lx) to [%lx,%lx)\n",
 		      user_to_phys ( ptr, 0 ),
 		      user_to_phys ( ptr, extmem.size ),
-		      user_to_phys ( new, 0 ),
-		      user_to_phys ( new, new_size ));
-		memmove_user ( new, 0, ptr, 0, ( ( extmem.size < new_size ) ?
-						 extmem.size : new_size ) );
-		bottom = new;
+		      user_to_phys ( ptr, 0 ),
+		      user_to_phys ( ptr, new_size ) );
 		heap_size -= ( new_size - extmem.size );
+		end = userptr_add ( ptr, new_size );
 		extmem.size = new_size;
-	} else {
-		/* Cannot expand; can only pretend to shrink */
-		if ( new_size > extmem.size ) {
-			/* Refuse to expand */
-			DBG ( "EXTMEM cannot expand [%lx,%lx)\n",
-			      user_to_phys ( ptr, 0 ),
-			      user_to_phys ( ptr, extmem.size ) );
+	} else if ( new_size > extmem.size ) {
+		/* Cannot expand in place; move to end of heap */
+		new = memtop_urealloc ( UNULL, new_size );
+		if ( ! new )
 			return UNULL;
-		}
+		DBG ( "EXTMEM moving [%lx,%lx) to [%lx,%lx)\n",
+		      user_to_phys ( ptr, 0 ),
+		      user_to_phys ( ptr, extmem.size ),
+		      user_to_phys ( new, 0 ),
+		      user_to_phys ( new, new_size ) );
+		memcpy_user ( new, 0, ptr, 0, extmem.size );
+		memtop_urealloc ( ptr, 0 );
+		return new;
+	} else if ( ! new_size ) {
+		/* Free block; memory will be reclaimed once all
+		 * subsequently allocated blocks have been freed.
+		 */
+		extmem.size = 0;
 	}
+	/* Otherwise, block is shrinking; just pretend to shrink it */
 
 	/* Write back block properties */
-	copy_to_user ( new, -sizeof ( extmem ), &extmem,
+	copy_to_user ( ptr, -sizeof ( extmem ), &extmem,
 		       sizeof ( extmem ) );
 
 	/* Collect any free blocks and update hidden memory region */
 	ecollect_free();
-	hide_umalloc ( user_to_phys ( bottom, ( ( bottom == top ) ?
-						0 : -sizeof ( extmem ) ) ),
-		       user_to_phys ( top, 0 ) );
+	hide_umalloc ( user_to_phys ( base, 0 ), user_to_phys ( end, 0 ) );
 
-	return ( new_size ? new : UNOWHERE );
+	return ( new_size ? ptr : UNOWHERE );
 }
 
 PROVIDE_UMALLOC ( memtop, urealloc, memtop_urealloc );
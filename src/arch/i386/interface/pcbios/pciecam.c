@@ -0,0 +1,299 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <errno.h>
+#include <byteswap.h>
+#include <ipxe/io.h>
+#include <ipxe/uaccess.h>
+#include <ipxe/acpi.h>
+#include <ipxe/pci.h>
+#include <ipxe/bios_acpi.h>
+
+/** @file
+ *
+ * PCI configuration space access via PCIe enhanced configuration
+ *
+ * The enhanced configuration access mechanism (ECAM) maps the
+ * configuration space of each PCI function into memory, as described
+ * by the ACPI MCFG table.  A single memory access is much cheaper
+ * than the pair of I/O port accesses required for a Type 1 access
+ * (or the real-mode transition required for a PCI BIOS call), which
+ * matters when enumerating systems with many buses.
+ *
+ * Any bus not covered by an MCFG allocation (including all buses, if
+ * no MCFG table exists) is accessed via Type 1 accesses.
+ */
+
+/** Mapped configuration space for each bus, if any */
+static void *ecam_bus[256];
+
+/** Number of buses covered by enhanced configuration space */
+static unsigned int ecam_count;
+
+/** Enhanced configuration space has been probed */
+static int ecam_probed;
+
+/**
+ * Map enhanced configuration space
+ *
+ * @ret rc		Return status code
+ */
+static int ecam_probe ( void ) {
+	struct ecam_table mcfg;
+	struct ecam_allocation alloc;
+	userptr_t rsdt;
+	userptr_t table;
+	unsigned long base;
+	unsigned int count;
+	unsigned int num_bus;
+	unsigned int bus;
+	unsigned int i;
+	size_t offset;
+	void *mapped;
+
+	/* Locate MCFG table */
+	rsdt = bios_find_rsdt();
+	if ( ! rsdt )
+		return -ENODEV;
+	table = acpi_find ( rsdt, MCFG_SIGNATURE, 0 );
+	if ( ! table ) {
+		DBG ( "ECAM found no MCFG table\n" );
+		return -ENOENT;
+	}
+	copy_from_user ( &mcfg, table, 0, sizeof ( mcfg ) );
+	if ( le32_to_cpu ( mcfg.acpi.length ) < sizeof ( mcfg ) )
+		return -EINVAL;
+	count = ( ( le32_to_cpu ( mcfg.acpi.length ) - sizeof ( mcfg ) ) /
+		  sizeof ( alloc ) );
+
+	/* Map each allocation */
+	for ( i = 0 ; i < count ; i++ ) {
+
+		/* Read allocation */
+		offset = ( sizeof ( mcfg ) + ( i * sizeof ( alloc ) ) );
+		copy_from_user ( &alloc, table, offset, sizeof ( alloc ) );
+		DBG ( "ECAM segment %04x buses %02x-%02x at %#08llx\n",
+		      le16_to_cpu ( alloc.segment ), alloc.start, alloc.end,
+		      ( ( unsigned long long ) le64_to_cpu ( alloc.base ) ) );
+
+		/* Only segment 0 is addressable via a struct
+		 * pci_device, and we can map only the 32-bit
+		 * physical address space.
+		 */
+		if ( le16_to_cpu ( alloc.segment ) != 0 )
+			continue;
+		if ( alloc.end < alloc.start )
+			continue;
+		if ( ( le64_to_cpu ( alloc.base ) +
+		       ( ( alloc.end + 1 ) * ECAM_BUS_LEN ) ) >
+		     ( 1ULL << 32 ) ) {
+			DBG ( "ECAM cannot map allocation above 4GB\n" );
+			continue;
+		}
+
+		/* Map configuration space for these buses */
+		num_bus = ( alloc.end - alloc.start + 1 );
+		base = ( le64_to_cpu ( alloc.base ) +
+			 ( alloc.start * ECAM_BUS_LEN ) );
+		mapped = ioremap ( base, ( num_bus * ECAM_BUS_LEN ) );
+		if ( ! mapped )
+			continue;
+		for ( bus = alloc.start ; bus <= alloc.end ; bus++ ) {
+			ecam_bus[bus] = mapped;
+			mapped += ECAM_BUS_LEN;
+		}
+		if ( ecam_count <= alloc.end )
+			ecam_count = ( alloc.end + 1 );
+	}
+
+	return 0;
+}
+
+/**
+ * Get address of enhanced configuration space
+ *
+ * @v pci		PCI device
+ * @v where		Location within PCI configuration space
+ * @ret addr		Mapped address, or NULL if not available
+ */
+static void * ecam_address ( struct pci_device *pci, unsigned int where ) {
+	void *base;
+
+	/* Map configuration space on first use */
+	if ( ! ecam_probed ) {
+		ecam_probe();
+		ecam_probed = 1;
+	}
+
+	/* Locate configuration space for this function */
+	base = ecam_bus[ PCI_BUS ( pci->busdevfn ) ];
+	if ( ! base )
+		return NULL;
+	return ( base + ( ( pci->busdevfn & 0xff ) * ECAM_FUNC_LEN ) + where );
+}
+
+/**
+ * Determine number of PCI buses within system
+ *
+ * @ret num_bus		Number of buses
+ */
+static int ecam_num_bus ( void ) {
+
+	/* Map configuration space on first use */
+	if ( ! ecam_probed ) {
+		ecam_probe();
+		ecam_probed = 1;
+	}
+
+	/* Use MCFG bus range, if available */
+	if ( ecam_count )
+		return ecam_count;
+	return PCIAPI_INLINE ( direct, pci_num_bus ) ();
+}
+
+/**
+ * Read byte from PCI configuration space
+ *
+ * @v pci	PCI device
+ * @v where	Location within PCI configuration space
+ * @v value	Value read
+ * @ret rc	Return status code
+ */
+static int ecam_read_config_byte ( struct pci_device *pci, unsigned int where,
+				   uint8_t *value ) {
+	void *addr = ecam_address ( pci, where );
+
+	if ( ! addr ) {
+		return PCIAPI_INLINE ( direct, pci_read_config_byte )
+			( pci, where, value );
+	}
+	*value = readb ( addr );
+	return 0;
+}
+
+/**
+ * Read 16-bit word from PCI configuration space
+ *
+ * @v pci	PCI device
+ * @v where	Location within PCI configuration space
+ * @v value	Value read
+ * @ret rc	Return status code
+ */
+static int ecam_read_config_word ( struct pci_device *pci, unsigned int where,
+				   uint16_t *value ) {
+	void *addr = ecam_address ( pci, where );
+
+	if ( ! addr ) {
+		return PCIAPI_INLINE ( direct, pci_read_config_word )
+			( pci, where, value );
+	}
+	*value = readw ( addr );
+	return 0;
+}
+
+/**
+ * Read 32-bit dword from PCI configuration space
+ *
+ * @v pci	PCI device
+ * @v where	Location within PCI configuration space
+ * @v value	Value read
+ * @ret rc	Return status code
+ */
+static int ecam_read_config_dword ( struct pci_device *pci,
+				    unsigned int where, uint32_t *value ) {
+	void *addr = ecam_address ( pci, where );
+
+	if ( ! addr ) {
+		return PCIAPI_INLINE ( direct, pci_read_config_dword )
+			( pci, where, value );
+	}
+	*value = readl ( addr );
+	return 0;
+}
+
+/**
+ * Write byte to PCI configuration space
+ *
+ * @v pci	PCI device
+ * @v where	Location within PCI configuration space
+ * @v value	Value to be written
+ * @ret rc	Return status code
+ */
+static int ecam_write_config_byte ( struct pci_device *pci,
+				    unsigned int where, uint8_t value ) {
+	void *addr = ecam_address ( pci, where );
+
+	if ( ! addr ) {
+		return PCIAPI_INLINE ( direct, pci_write_config_byte )
+			( pci, where, value );
+	}
+	writeb ( value, addr );
+	return 0;
+}
+
+/**
+ * Write 16-bit word to PCI configuration space
+ *
+ * @v pci	PCI device
+ * @v where	Location within PCI configuration space
+ * @v value	Value to be written
+ * @ret rc	Return status code
+ */
+static int ecam_write_config_word ( struct pci_device *pci,
+				    unsigned int where, uint16_t value ) {
+	void *addr = ecam_address ( pci, where );
+
+	if ( ! addr ) {
+		return PCIAPI_INLINE ( direct, pci_write_config_word )
+			( pci, where, value );
+	}
+	writew ( value, addr );
+	return 0;
+}
+
+/**
+ * Write 32-bit dword to PCI configuration space
+ *
+ * @v pci	PCI device
+ * @v where	Location within PCI configuration space
+ * @v value	Value to be written
+ * @ret rc	Return status code
+ */
+static int ecam_write_config_dword ( struct pci_device *pci,
+				     unsigned int where, uint32_t value ) {
+	void *addr = ecam_address ( pci, where );
+
+	if ( ! addr ) {
+		return PCIAPI_INLINE ( direct, pci_write_config_dword )
+			( pci, where, value );
+	}
+	writel ( value, addr );
+	return 0;
+}
+
+PROVIDE_PCIAPI ( ecam, pci_num_bus, ecam_num_bus );
+PROVIDE_PCIAPI ( ecam, pci_read_config_byte, ecam_read_config_byte );
+PROVIDE_PCIAPI ( ecam, pci_read_config_word, ecam_read_config_word );
+PROVIDE_PCIAPI ( ecam, pci_read_config_dword, ecam_read_config_dword );
+PROVIDE_PCIAPI ( ecam, pci_write_config_byte, ecam_write_config_byte );
+PROVIDE_PCIAPI ( ecam, pci_write_config_word, ecam_write_config_word );
+PROVIDE_PCIAPI ( ecam, pci_write_config_dword, ecam_write_config_dword );
@@ -26,6 +26,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <errno.h>
 #include <byteswap.h>
 #include <ipxe/uaccess.h>
@@ -36,6 +37,20 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/open.h>
 #include <ipxe/process.h>
 #include <pxe.h>
+#include <config/general.h>
+
+/**
+ * Length of read-ahead ring (in blocks)
+ *
+ * Blocks delivered by the TFTP protocol layer are held in this ring
+ * until they are consumed by pxenv_tftp_read().  The TFTP server may
+ * send up to a full window of blocks (as negotiated via the
+ * "windowsize" option) for each acknowledgement, so the ring must be
+ * able to hold at least one window.  Allowing for two windows avoids
+ * an overrun if blocks from a retransmitted window arrive while
+ * blocks from the previous window remain unconsumed.
+ */
+#define PXE_TFTP_READAHEAD ( 2 * TFTP_WINDOWSIZE )
 
 /** A PXE TFTP connection */
 struct pxe_tftp_connection {
@@ -55,10 +70,80 @@ struct pxe_tftp_connection {
 	size_t blksize;
 	/** Block index */
 	unsigned int blkidx;
+	/** Read-ahead is enabled (i.e. using pxenv_tftp_read()) */
+	int readahead;
+	/** Read-ahead ring, indexed by block number */
+	struct io_buffer *ring[PXE_TFTP_READAHEAD];
 	/** Overall return status code */
 	int rc;
 };
 
+/**
+ * Discard PXE TFTP read-ahead ring
+ *
+ * @v pxe_tftp		PXE TFTP connection
+ */
+static void pxe_tftp_discard ( struct pxe_tftp_connection *pxe_tftp ) {
+	unsigned int i;
+
+	for ( i = 0 ; i < PXE_TFTP_READAHEAD ; i++ ) {
+		free_iob ( pxe_tftp->ring[i] );
+		pxe_tftp->ring[i] = NULL;
+	}
+}
+
+/**
+ * Store data block in PXE TFTP read-ahead ring
+ *
+ * @v pxe_tftp		PXE TFTP connection
+ * @v iobuf		I/O buffer
+ * @ret rc		Return status code
+ *
+ * Takes ownership of the I/O buffer.  Duplicate blocks (which may be
+ * seen when a TFTP server restarts a window) are silently discarded.
+ */
+static int pxe_tftp_readahead ( struct pxe_tftp_connection *pxe_tftp,
+				struct io_buffer *iobuf ) {
+	struct io_buffer **slot;
+	unsigned int block;
+
+	/* The TFTP layer does not report the negotiated block size
+	 * until after the OACK, so obtain it here if necessary.
+	 */
+	if ( ! pxe_tftp->blksize )
+		pxe_tftp->blksize = xfer_window ( &pxe_tftp->xfer );
+
+	/* Identify block */
+	if ( ( ! pxe_tftp->blksize ) ||
+	     ( pxe_tftp->offset % pxe_tftp->blksize ) ) {
+		DBG ( " misaligned block at %zx", pxe_tftp->offset );
+		free_iob ( iobuf );
+		return -EINVAL;
+	}
+	block = ( pxe_tftp->offset / pxe_tftp->blksize );
+	if ( block < pxe_tftp->blkidx ) {
+		/* Already consumed; discard */
+		free_iob ( iobuf );
+		return 0;
+	}
+	if ( block >= ( pxe_tftp->blkidx + PXE_TFTP_READAHEAD ) ) {
+		DBG ( " read-ahead overrun at block %d (min %d)",
+		      block, pxe_tftp->blkidx );
+		free_iob ( iobuf );
+		return -ENOBUFS;
+	}
+
+	/* Store block, unless it is a duplicate */
+	slot = &pxe_tftp->ring[ block % PXE_TFTP_READAHEAD ];
+	if ( *slot ) {
+		free_iob ( iobuf );
+	} else {
+		*slot = iobuf;
+	}
+
+	return 0;
+}
+
 /**
  * Close PXE TFTP connection
  *
@@ -92,6 +177,9 @@ static int pxe_tftp_xfer_deliver ( struct pxe_tftp_connection *pxe_tftp,
 	/* Copy data block to buffer */
 	if ( len == 0 ) {
 		/* No data (pure seek); treat as success */
+	} else if ( pxe_tftp->readahead ) {
+		/* Store in read-ahead ring */
+		rc = pxe_tftp_readahead ( pxe_tftp, iob_disown ( iobuf ) );
 	} else if ( pxe_tftp->offset < pxe_tftp->start ) {
 		DBG ( " buffer underrun at %zx (min %zx)",
 		      pxe_tftp->offset, pxe_tftp->start );
@@ -164,6 +252,7 @@ static int pxe_tftp_open ( uint32_t ipaddress, unsigned int port,
 	int rc;
 
 	/* Reset PXE TFTP connection structure */
+	pxe_tftp_discard ( &pxe_tftp );
 	memset ( &pxe_tftp, 0, sizeof ( pxe_tftp ) );
 	intf_init ( &pxe_tftp.xfer, &pxe_tftp_xfer_desc, NULL );
 	pxe_tftp.rc = -EINPROGRESS;
@@ -250,13 +339,15 @@ static PXENV_EXIT_t pxenv_tftp_open ( struct s_PXENV_TFTP_OPEN *tftp_open ) {
 		tftp_open->Status = PXENV_STATUS ( rc );
 		return PXENV_EXIT_FAILURE;
 	}
+	pxe_tftp.readahead = 1;
 
 	/* Wait for OACK to arrive so that we have the block size */
 	while ( ( ( rc = pxe_tftp.rc ) == -EINPROGRESS ) &&
 		( pxe_tftp.max_offset == 0 ) ) {
 		step();
 	}
-	pxe_tftp.blksize = xfer_window ( &pxe_tftp.xfer );
+	if ( ! pxe_tftp.blksize )
+		pxe_tftp.blksize = xfer_window ( &pxe_tftp.xfer );
 	tftp_open->PacketSize = pxe_tftp.blksize;
 	DBG ( " blksize=%d", tftp_open->PacketSize );
 
@@ -289,6 +380,7 @@ static PXENV_EXIT_t pxenv_tftp_close ( struct s_PXENV_TFTP_CLOSE *tftp_close ) {
 	DBG ( "PXENV_TFTP_CLOSE" );
 
 	pxe_tftp_close ( &pxe_tftp, 0 );
+	pxe_tftp_discard ( &pxe_tftp );
 	tftp_close->Status = PXENV_STATUS_SUCCESS;
 	return PXENV_EXIT_SUCCESS;
 }
@@ -349,27 +441,46 @@ static PXENV_EXIT_t pxenv_tftp_close ( struct s_PXENV_TFTP_CLOSE *tftp_close ) {
  * is as expected (i.e. one greater than that returned from the
  * previous call to pxenv_tftp_read()).
  *
+ * iPXE does not wait for each block in turn.  The TFTP server may
+ * send a window of several blocks for each acknowledgement, and any
+ * blocks received ahead of the one required are held in a read-ahead
+ * ring, from which subsequent calls to pxenv_tftp_read() will return
+ * immediately.
+ *
  * On x86, you must set the s_PXE::StatusCallout field to a nonzero
  * value before calling this function in protected mode.  You cannot
  * call this function with a 32-bit stack segment.  (See the relevant
  * @ref pxe_x86_pmode16 "implementation note" for more details.)
  */
 static PXENV_EXIT_t pxenv_tftp_read ( struct s_PXENV_TFTP_READ *tftp_read ) {
+	struct io_buffer **slot;
+	struct io_buffer *iobuf;
+	size_t len = 0;
 	int rc;
 
 	DBG ( "PXENV_TFTP_READ to %04x:%04x",
 	      tftp_read->Buffer.segment, tftp_read->Buffer.offset );
 
-	/* Read single block into buffer */
-	pxe_tftp.buffer = real_to_user ( tftp_read->Buffer.segment,
-					 tftp_read->Buffer.offset );
-	pxe_tftp.size = pxe_tftp.blksize;
-	pxe_tftp.start = pxe_tftp.offset;
-	while ( ( ( rc = pxe_tftp.rc ) == -EINPROGRESS ) &&
-		( pxe_tftp.offset == pxe_tftp.start ) )
+	/* Wait for next block to arrive in read-ahead ring */
+	slot = &pxe_tftp.ring[ pxe_tftp.blkidx % PXE_TFTP_READAHEAD ];
+	while ( ( ( rc = pxe_tftp.rc ) == -EINPROGRESS ) && ( ! *slot ) )
 		step();
-	pxe_tftp.buffer = UNULL;
-	tftp_read->BufferSize = ( pxe_tftp.offset - pxe_tftp.start );
+
+	/* Copy block to buffer.  Any data already received is
+	 * returned even if the transfer has since failed; the error
+	 * will be reported by a subsequent call.
+	 */
+	iobuf = *slot;
+	if ( iobuf ) {
+		*slot = NULL;
+		len = iob_len ( iobuf );
+		copy_to_user ( real_to_user ( tftp_read->Buffer.segment,
+					      tftp_read->Buffer.offset ),
+			       0, iobuf->data, len );
+		free_iob ( iobuf );
+		rc = 0;
+	}
+	tftp_read->BufferSize = len;
 	tftp_read->PacketNumber = ++pxe_tftp.blkidx;
 
 	/* EINPROGRESS is normal if we haven't reached EOF yet */
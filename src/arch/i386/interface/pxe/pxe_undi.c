@@ -37,8 +37,18 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/ip.h>
 #include <ipxe/arp.h>
 #include <ipxe/rarp.h>
+#include <realmode.h>
 #include "pxe.h"
 
+/**
+ * Minimum length of data block to be transmitted by reference
+ *
+ * Data blocks shorter than this are copied, since the overhead of
+ * describing an additional fragment would outweigh the cost of the
+ * copy.
+ */
+#define PXE_UNDI_TX_REF_MIN 256
+
 /**
  * Count of outstanding transmitted packets
  *
@@ -50,8 +60,58 @@ FILE_LICENCE ( GPL2_OR_LATER );
  */
 static int undi_tx_count = 0;
 
+/** Promiscuous reception has been requested by UNDI caller */
+static int undi_promisc = 0;
+
 struct net_device *pxe_netdev = NULL;
 
+/**
+ * Base memory
+ *
+ * This is used as the owner of I/O buffers that refer directly to
+ * data blocks within the caller's base memory.  We hold a permanent
+ * reference to it, so it is never freed.
+ */
+static struct io_buffer undi_basemem = {
+	.refs = 1,
+};
+
+/**
+ * Allocate I/O buffer referring to a data block in base memory
+ *
+ * @v datablk		Data block
+ * @ret iobuf		I/O buffer, or NULL
+ */
+static struct io_buffer * pxe_undi_tx_ref ( struct DataBlk *datablk ) {
+
+	/* Describe base memory, if not already done */
+	if ( ! undi_basemem.end ) {
+		undi_basemem.head = undi_basemem.data = undi_basemem.tail =
+			user_to_virt ( real_to_user ( 0, 0 ), 0 );
+		undi_basemem.end = ( undi_basemem.head + 0x110000 );
+	}
+
+	return alloc_iob_ref ( &undi_basemem,
+			       user_to_virt ( real_to_user (
+					datablk->TDDataPtr.segment,
+					datablk->TDDataPtr.offset ), 0 ),
+			       datablk->TDDataLen );
+}
+
+/**
+ * Set PXE network device promiscuous reception state
+ *
+ * @v promisc		Promiscuous reception is required
+ */
+static void pxe_netdev_promisc ( int promisc ) {
+
+	promisc = ( promisc != 0 );
+	if ( promisc != undi_promisc ) {
+		netdev_rx_promisc ( pxe_netdev, promisc );
+		undi_promisc = promisc;
+	}
+}
+
 /**
  * Set network device as current PXE network device
  *
@@ -60,6 +120,7 @@ struct net_device *pxe_netdev = NULL;
 void pxe_set_netdev ( struct net_device *netdev ) {
 
 	if ( pxe_netdev ) {
+		pxe_netdev_promisc ( 0 );
 		netdev_rx_unfreeze ( pxe_netdev );
 		netdev_put ( pxe_netdev );
 	}
@@ -99,6 +160,7 @@ static void pxe_netdev_close ( void ) {
 	netdev_rx_unfreeze ( pxe_netdev );
 	netdev_irq ( pxe_netdev, 0 );
 	netdev_close ( pxe_netdev );
+	pxe_netdev_promisc ( 0 );
 	undi_tx_count = 0;
 }
 
@@ -265,6 +327,9 @@ static PXENV_EXIT_t pxenv_undi_open ( struct s_PXENV_UNDI_OPEN *undi_open ) {
 		return PXENV_EXIT_FAILURE;
 	}
 
+	/* Apply receive filter */
+	pxe_netdev_promisc ( undi_open->PktFilter & FLTR_PRMSCS );
+
 	undi_open->Status = PXENV_STATUS_SUCCESS;
 	return PXENV_EXIT_SUCCESS;
 }
@@ -300,11 +365,14 @@ pxenv_undi_transmit ( struct s_PXENV_UNDI_TRANSMIT *undi_transmit ) {
 	struct s_PXENV_UNDI_TBD tbd;
 	struct DataBlk *datablk;
 	struct io_buffer *iobuf;
+	struct io_buffer *frag;
+	struct io_buffer *tail;
 	struct net_protocol *net_protocol;
 	struct ll_protocol *ll_protocol;
 	char destaddr[MAX_LL_ADDR_LEN];
 	const void *ll_dest;
 	size_t len;
+	unsigned int first_ref;
 	unsigned int i;
 	int rc;
 
@@ -323,7 +391,8 @@ pxenv_undi_transmit ( struct s_PXENV_UNDI_TRANSMIT *undi_transmit ) {
 	 * call PXENV_UNDI_OPEN before attempting to use the UNDI API.
 	 */
 	netdev_rx_freeze ( pxe_netdev );
-	netdev_irq ( pxe_netdev, 1 );
+	if ( ! netdev_irq_enabled ( pxe_netdev ) )
+		netdev_irq ( pxe_netdev, 1 );
 
 	/* Identify network-layer protocol */
 	switch ( undi_transmit->Protocol ) {
@@ -342,18 +411,37 @@ pxenv_undi_transmit ( struct s_PXENV_UNDI_TRANSMIT *undi_transmit ) {
 	DBGC2 ( &pxe_netdev, " %s",
 		( net_protocol ? net_protocol->name : "RAW" ) );
 
-	/* Calculate total packet length */
+	/* Identify trailing data blocks that may be transmitted by
+	 * reference rather than by copying, if the underlying driver
+	 * supports scatter-gather transmission.  The caller may not
+	 * modify a data block until transmission is complete.
+	 */
 	copy_from_real ( &tbd, undi_transmit->TBD.segment,
 			 undi_transmit->TBD.offset, sizeof ( tbd ) );
+	if ( tbd.DataBlkCount > MAX_DATA_BLKS )
+		tbd.DataBlkCount = MAX_DATA_BLKS;
+	first_ref = tbd.DataBlkCount;
+	if ( net_protocol || tbd.ImmedLength ) {
+		while ( ( first_ref > 0 ) &&
+			( tbd.DataBlock[ first_ref - 1 ].TDDataLen >=
+			  PXE_UNDI_TX_REF_MIN ) &&
+			( ( 1 + tbd.DataBlkCount - first_ref ) <
+			  pxe_netdev->max_tx_frags ) ) {
+			first_ref--;
+		}
+	}
+
+	/* Calculate length of data to be copied */
 	len = tbd.ImmedLength;
 	DBGC2 ( &pxe_netdev, " %04x:%04x+%x", tbd.Xmit.segment, tbd.Xmit.offset,
 		tbd.ImmedLength );
 	for ( i = 0 ; i < tbd.DataBlkCount ; i++ ) {
 		datablk = &tbd.DataBlock[i];
-		len += datablk->TDDataLen;
-		DBGC2 ( &pxe_netdev, " %04x:%04x+%x",
+		if ( i < first_ref )
+			len += datablk->TDDataLen;
+		DBGC2 ( &pxe_netdev, " %04x:%04x+%x%s",
 			datablk->TDDataPtr.segment, datablk->TDDataPtr.offset,
-			datablk->TDDataLen );
+			datablk->TDDataLen, ( ( i < first_ref ) ? "" : "*" ) );
 	}
 
 	/* Allocate and fill I/O buffer */
@@ -366,12 +454,25 @@ pxenv_undi_transmit ( struct s_PXENV_UNDI_TRANSMIT *undi_transmit ) {
 	iob_reserve ( iobuf, MAX_LL_HEADER_LEN );
 	copy_from_real ( iob_put ( iobuf, tbd.ImmedLength ), tbd.Xmit.segment,
 			 tbd.Xmit.offset, tbd.ImmedLength );
+	tail = iobuf;
 	for ( i = 0 ; i < tbd.DataBlkCount ; i++ ) {
 		datablk = &tbd.DataBlock[i];
-		copy_from_real ( iob_put ( iobuf, datablk->TDDataLen ),
-				 datablk->TDDataPtr.segment,
-				 datablk->TDDataPtr.offset,
-				 datablk->TDDataLen );
+		if ( i < first_ref ) {
+			copy_from_real ( iob_put ( iobuf, datablk->TDDataLen ),
+					 datablk->TDDataPtr.segment,
+					 datablk->TDDataPtr.offset,
+					 datablk->TDDataLen );
+			continue;
+		}
+		frag = pxe_undi_tx_ref ( datablk );
+		if ( ! frag ) {
+			DBGC2 ( &pxe_netdev, " could not allocate iobuf\n" );
+			free_iob ( iobuf );
+			undi_transmit->Status = PXENV_STATUS_OUT_OF_RESOURCES;
+			return PXENV_EXIT_FAILURE;
+		}
+		tail->frag = frag;
+		tail = frag;
 	}
 
 	/* Add link-layer header, if required to do so */
@@ -492,8 +593,8 @@ pxenv_undi_set_station_address ( struct s_PXENV_UNDI_SET_STATION_ADDRESS
 
 /* PXENV_UNDI_SET_PACKET_FILTER
  *
- * Status: won't implement (would require driver API changes for no
- * real benefit)
+ * Status: working (promiscuous flag only; directed, broadcast and
+ * multicast packets are always received)
  */
 static PXENV_EXIT_t
 pxenv_undi_set_packet_filter ( struct s_PXENV_UNDI_SET_PACKET_FILTER
@@ -511,10 +612,10 @@ pxenv_undi_set_packet_filter ( struct s_PXENV_UNDI_SET_PACKET_FILTER
 		return PXENV_EXIT_FAILURE;
 	}
 
-	/* Pretend that we succeeded, otherwise the 3Com DOS UNDI
-	 * driver refuses to load.  (We ignore the filter value in the
-	 * PXENV_UNDI_OPEN call anyway.)
+	/* Apply promiscuous flag.  Always report success, otherwise
+	 * the 3Com DOS UNDI driver refuses to load.
 	 */
+	pxe_netdev_promisc ( undi_set_packet_filter->filter & FLTR_PRMSCS );
 	undi_set_packet_filter->Status = PXENV_STATUS_SUCCESS;
 
 	return PXENV_EXIT_SUCCESS;
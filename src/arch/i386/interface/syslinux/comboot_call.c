@@ -259,6 +259,7 @@ static __asmcall void int21 ( struct i386_all_regs *ix86 ) {
 
 	case 0x04: /* Write Character to Serial Port */
 		serial_putc ( ix86->regs.dl );
+		serial_flush();
 		ix86->flags &= ~CF;
 		break;
 
@@ -402,24 +403,36 @@ static __asmcall void int22 ( struct i386_all_regs *ix86 ) {
 		{
 			int fd = ix86->regs.si;
 			int len = ix86->regs.cx * COMBOOT_FILE_BLOCKSZ;
-			int rc;
+			int total = 0;
+			int rc = 0;
 			fd_set fds;
 			userptr_t buf = real_to_user ( ix86->segs.es, ix86->regs.bx );
 
-			/* Wait for data ready to read */
-			FD_ZERO ( &fds );
-			FD_SET ( fd, &fds );
+			/* Fill as much of the buffer as possible before
+			 * returning, to minimise the number of calls
+			 * (and hence real-mode transitions) required.
+			 */
+			while ( total < len ) {
+
+				/* Wait for data ready to read */
+				FD_ZERO ( &fds );
+				FD_SET ( fd, &fds );
 
-			select ( &fds, 1 );
+				select ( &fds, 1 );
 
-			rc = read_user ( fd, buf, 0, len );
-			if ( rc < 0 ) {
+				rc = read_user ( fd, buf, total,
+						 ( len - total ) );
+				if ( rc <= 0 )
+					break;
+				total += rc;
+			}
+			if ( ( total == 0 ) && ( rc < 0 ) ) {
 				DBG ( "COMBOOT: read failed\n" );
 				ix86->regs.si = 0;
 				break;
 			}
 
-			ix86->regs.ecx = rc;
+			ix86->regs.ecx = total;
 			ix86->flags &= ~CF;
 		}
 		break;
@@ -28,6 +28,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <stdarg.h>
 #include <asm/unistd.h>
 #include <string.h>
+#include <linux/net.h>
 
 int linux_open ( const char *pathname, int flags ) {
 	return linux_syscall ( __NR_open, pathname, flags );
@@ -104,3 +105,46 @@ void * linux_mremap ( void *old_address, __kernel_size_t old_size,
 int linux_munmap ( void *addr, __kernel_size_t length ) {
 	return linux_syscall ( __NR_munmap, addr, length );
 }
+
+/*
+ * The i386 ABI provides the socket calls via the multiplexed
+ * socketcall() system call; direct system calls were added only in
+ * Linux 4.3.
+ */
+#ifdef __NR_socketcall
+#define LINUX_SOCKETCALL( nr, call, ... ) ( {				\
+	long args[] = { __VA_ARGS__ };					\
+	linux_syscall ( __NR_socketcall, (call), args ); } )
+#else
+#define LINUX_SOCKETCALL( nr, call, ... )				\
+	linux_syscall ( (nr), __VA_ARGS__ )
+#endif
+
+int linux_socket ( int domain, int type, int protocol ) {
+	return LINUX_SOCKETCALL ( __NR_socket, SYS_SOCKET,
+				  domain, type, protocol );
+}
+
+int linux_bind ( int fd, const void *addr, int addrlen ) {
+	return LINUX_SOCKETCALL ( __NR_bind, SYS_BIND,
+				  fd, ( ( long ) addr ), addrlen );
+}
+
+int linux_setsockopt ( int fd, int level, int optname,
+		       const void *optval, int optlen ) {
+	return LINUX_SOCKETCALL ( __NR_setsockopt, SYS_SETSOCKOPT,
+				  fd, level, optname, ( ( long ) optval ),
+				  optlen );
+}
+
+int linux_recvmmsg ( int fd, struct linux_mmsghdr *msgvec,
+		     unsigned int vlen, unsigned int flags ) {
+	return LINUX_SOCKETCALL ( __NR_recvmmsg, SYS_RECVMMSG,
+				  fd, ( ( long ) msgvec ), vlen, flags, 0 );
+}
+
+int linux_sendmmsg ( int fd, struct linux_mmsghdr *msgvec,
+		     unsigned int vlen, unsigned int flags ) {
+	return LINUX_SOCKETCALL ( __NR_sendmmsg, SYS_SENDMMSG,
+				  fd, ( ( long ) msgvec ), vlen, flags );
+}
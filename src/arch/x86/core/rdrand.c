@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/** @file
+ *
+ * RDRAND/RDSEED-based entropy source
+ *
+ * This entropy source uses the RDSEED instruction if available, and
+ * otherwise the RDRAND instruction.  Each sample is available almost
+ * immediately, rather than requiring a wait for an external event
+ * such as an RTC interrupt.
+ */
+
+#include <stdint.h>
+#include <errno.h>
+#include <ipxe/cpuid.h>
+#include <ipxe/entropy.h>
+
+/** CPUID function 1 %ecx flag for RDRAND */
+#define CPUID_FEATURES_RDRAND 0x40000000UL
+
+/** CPUID function 7 %ebx flag for RDSEED */
+#define CPUID_EXT_FEATURES_RDSEED 0x00040000UL
+
+/** Number of attempts at obtaining a sample
+ *
+ * Both RDRAND and RDSEED may transiently fail to return a value (by
+ * clearing the carry flag).  Intel recommends retrying RDRAND up to
+ * ten times before treating the failure as a hardware fault; RDSEED
+ * may fail more often under load, and so is retried for longer.
+ */
+#define RDRAND_RETRY_COUNT 10
+#define RDSEED_RETRY_COUNT 1024
+
+/** RDSEED is supported */
+static int rdrand_use_rdseed;
+
+/**
+ * Enable entropy gathering
+ *
+ * @ret rc		Return status code
+ */
+static int rdrand_entropy_enable ( void ) {
+	uint32_t max_level;
+	uint32_t features;
+	uint32_t ext_features;
+	uint32_t discard_a;
+	uint32_t discard_b;
+	uint32_t discard_c;
+	uint32_t discard_d;
+
+	/* Check for CPUID function 1 and the RDRAND feature flag */
+	if ( ! cpuid_is_supported() ) {
+		DBGC ( &rdrand_use_rdseed, "RDRAND CPUID unavailable\n" );
+		return -ENOTSUP;
+	}
+	cpuid ( CPUID_VENDOR_ID, 0, &max_level, &discard_b, &discard_c,
+		&discard_d );
+	if ( max_level < CPUID_FEATURES ) {
+		DBGC ( &rdrand_use_rdseed, "RDRAND CPUID features "
+		       "unavailable\n" );
+		return -ENOTSUP;
+	}
+	cpuid ( CPUID_FEATURES, 0, &discard_a, &discard_b, &features,
+		&discard_d );
+	if ( ! ( features & CPUID_FEATURES_RDRAND ) ) {
+		DBGC ( &rdrand_use_rdseed, "RDRAND not supported\n" );
+		return -ENOTSUP;
+	}
+
+	/* Check for CPUID function 7 and the RDSEED feature flag */
+	ext_features = 0;
+	if ( max_level >= CPUID_EXTENDED_FEATURES ) {
+		cpuid ( CPUID_EXTENDED_FEATURES, 0, &discard_a, &ext_features,
+			&discard_c, &discard_d );
+	}
+	rdrand_use_rdseed =
+		( ( ext_features & CPUID_EXT_FEATURES_RDSEED ) != 0 );
+	DBGC ( &rdrand_use_rdseed, "RDRAND using %s\n",
+	       ( rdrand_use_rdseed ? "RDSEED" : "RDRAND" ) );
+
+	return 0;
+}
+
+/**
+ * Disable entropy gathering
+ *
+ */
+static void rdrand_entropy_disable ( void ) {
+	/* Nothing to do */
+}
+
+/**
+ * Get noise sample
+ *
+ * @ret noise		Noise sample
+ * @ret rc		Return status code
+ */
+static int rdrand_get_noise ( noise_sample_t *noise ) {
+	unsigned int retries;
+	uint32_t value;
+	uint8_t ok;
+
+	/* Try RDSEED, if supported */
+	if ( rdrand_use_rdseed ) {
+		for ( retries = RDSEED_RETRY_COUNT ; retries ; retries-- ) {
+			__asm__ __volatile__ ( ".byte 0x0f, 0xc7, 0xf8\n\t"
+					       /* rdseed %eax */
+					       "setc %1\n\t"
+					       : "=a" ( value ), "=qm" ( ok ) );
+			if ( ok )
+				goto done;
+		}
+		DBGC ( &rdrand_use_rdseed, "RDRAND RDSEED exhausted; "
+		       "falling back to RDRAND\n" );
+	}
+
+	/* Use RDRAND */
+	for ( retries = RDRAND_RETRY_COUNT ; retries ; retries-- ) {
+		__asm__ __volatile__ ( ".byte 0x0f, 0xc7, 0xf0\n\t"
+				       /* rdrand %eax */
+				       "setc %1\n\t"
+				       : "=a" ( value ), "=qm" ( ok ) );
+		if ( ok )
+			goto done;
+	}
+	DBGC ( &rdrand_use_rdseed, "RDRAND failed to return a value\n" );
+	return -EBUSY;
+
+ done:
+	*noise = value;
+	return 0;
+}
+
+PROVIDE_ENTROPY_INLINE ( rdrand, min_entropy_per_sample );
+PROVIDE_ENTROPY ( rdrand, entropy_enable, rdrand_entropy_enable );
+PROVIDE_ENTROPY ( rdrand, entropy_disable, rdrand_entropy_disable );
+PROVIDE_ENTROPY ( rdrand, get_noise, rdrand_get_noise );
@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/** @file
+ *
+ * CRC32C checksum using the SSE4.2 crc32 instruction
+ *
+ */
+
+#include <stdint.h>
+#include <ipxe/cpuid.h>
+#include <ipxe/crc32c.h>
+
+/** CPUID function 1 %ecx flag for SSE4.2 */
+#define CPUID_FEATURES_SSE4_2 0x00100000UL
+
+/** SSE4.2 is supported (or negative if not yet determined) */
+static int x86_crc32c_sse4_2 = -1;
+
+/**
+ * Check whether or not SSE4.2 is supported
+ *
+ * @ret supported	SSE4.2 is supported
+ */
+static int x86_crc32c_supported ( void ) {
+	uint32_t max_level;
+	uint32_t features;
+	uint32_t discard_a;
+	uint32_t discard_b;
+	uint32_t discard_c;
+	uint32_t discard_d;
+
+	/* Use cached result, if available */
+	if ( x86_crc32c_sse4_2 >= 0 )
+		return x86_crc32c_sse4_2;
+
+	/* Check for CPUID function 1 and the SSE4.2 feature flag */
+	x86_crc32c_sse4_2 = 0;
+	if ( ! cpuid_is_supported() )
+		return 0;
+	cpuid ( CPUID_VENDOR_ID, 0, &max_level, &discard_b, &discard_c,
+		&discard_d );
+	if ( max_level < CPUID_FEATURES )
+		return 0;
+	cpuid ( CPUID_FEATURES, 0, &discard_a, &discard_b, &features,
+		&discard_d );
+	x86_crc32c_sse4_2 = ( ( features & CPUID_FEATURES_SSE4_2 ) != 0 );
+
+	return x86_crc32c_sse4_2;
+}
+
+/**
+ * Calculate CRC32C checksum
+ *
+ * @v seed	Initial value
+ * @v data	Data to checksum
+ * @v len	Length of data
+ * @ret crc	CRC value
+ *
+ * The SSE4.2 crc32 instruction is used if available, processing one
+ * machine word per instruction.  Otherwise, the generic table-driven
+ * implementation is used.
+ */
+u32 crc32c_le ( u32 seed, const void *data, size_t len ) {
+	unsigned long crc = seed;
+	const uint8_t *src = data;
+	const unsigned long *word;
+
+	/* Use generic implementation if SSE4.2 is not supported */
+	if ( ! x86_crc32c_supported() )
+		return crc32c_le_generic ( seed, data, len );
+
+	/* Process leading bytes until source is aligned */
+	while ( len && ( ( ( intptr_t ) src ) & ( sizeof ( *word ) - 1 ) ) ) {
+		__asm__ ( "crc32b %1, %k0"
+			  : "+r" ( crc ) : "qm" ( *(src++) ) );
+		len--;
+	}
+
+	/* Process a machine word at a time */
+	word = ( ( const unsigned long * ) src );
+	while ( len >= sizeof ( *word ) ) {
+		__asm__ ( "crc32 %1, %0"
+			  : "+r" ( crc ) : "r" ( *(word++) ) );
+		len -= sizeof ( *word );
+	}
+	src = ( ( const uint8_t * ) word );
+
+	/* Process trailing bytes */
+	while ( len-- ) {
+		__asm__ ( "crc32b %1, %k0"
+			  : "+r" ( crc ) : "qm" ( *(src++) ) );
+	}
+
+	return crc;
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/** @file
+ *
+ * TCP/IP checksum
+ *
+ */
+
+#include <stdint.h>
+#include <ipxe/tcpip.h>
+
+/** Number of machine words summed per loop iteration */
+#define X86_TCPIP_UNROLL 4
+
+/**
+ * Sum machine words using add-with-carry
+ *
+ * @v sum		Initial sum
+ * @v data		Data buffer
+ * @v count		Number of blocks of @c X86_TCPIP_UNROLL words
+ * @ret sum		Updated sum (with end-around carry applied)
+ *
+ * The carry flag is propagated through the whole loop, and is
+ * restored to the sum only once at the end.  This relies upon
+ * "lea" and "dec" leaving the carry flag untouched.
+ */
+static inline __attribute__ (( always_inline )) unsigned long
+x86_tcpip_sum ( unsigned long sum, const unsigned long *data,
+		size_t count ) {
+	const void *discard_S;
+	size_t discard_c;
+
+	__asm__ ( "clc\n\t"
+		  "\n1:\n\t"
+		  "adc 0(%1), %0\n\t"
+		  "adc %c5(%1), %0\n\t"
+		  "adc %c6(%1), %0\n\t"
+		  "adc %c7(%1), %0\n\t"
+		  "lea %c8(%1), %1\n\t"
+		  "dec %2\n\t"
+		  "jnz 1b\n\t"
+		  "adc $0, %0\n\t"
+		  : "=r" ( sum ), "=r" ( discard_S ), "=r" ( discard_c )
+		  : "0" ( sum ), "1" ( data ), "i" ( 1 * sizeof ( *data ) ),
+		    "i" ( 2 * sizeof ( *data ) ), "i" ( 3 * sizeof ( *data ) ),
+		    "i" ( X86_TCPIP_UNROLL * sizeof ( *data ) ), "2" ( count )
+		  : "memory" );
+	return sum;
+}
+
+/**
+ * Fold sum to 16 bits
+ *
+ * @v sum		Sum
+ * @ret sum		Folded sum
+ */
+static inline __attribute__ (( always_inline )) unsigned long
+x86_tcpip_fold ( unsigned long sum ) {
+
+	while ( sum >> 16 )
+		sum = ( ( sum & 0xffff ) + ( sum >> 16 ) );
+	return sum;
+}
+
+/**
+ * Calculate continued TCP/IP checkum
+ *
+ * @v partial		Checksum of already-summed data, in network byte order
+ * @v data		Data buffer
+ * @v len		Length of data buffer
+ * @ret cksum		Updated checksum, in network byte order
+ *
+ * The bulk of the data is summed one machine word at a time using
+ * add-with-carry, and the result is folded down to 16 bits only once
+ * per call.  Since the one's complement sum is independent of byte
+ * order, native-endian loads produce the same result as the generic
+ * implementation.
+ */
+uint16_t __hot tcpip_continue_chksum ( uint16_t partial, const void *data,
+				       size_t len ) {
+	const unsigned long *word = data;
+	const uint16_t *half;
+	const uint8_t *byte;
+	unsigned long sum = ( ( ~partial ) & 0xffff );
+	size_t count;
+
+	/* Sum unrolled blocks of machine words */
+	count = ( len / ( X86_TCPIP_UNROLL * sizeof ( *word ) ) );
+	if ( count ) {
+		sum = x86_tcpip_sum ( sum, word, count );
+		word += ( count * X86_TCPIP_UNROLL );
+		len -= ( count * X86_TCPIP_UNROLL * sizeof ( *word ) );
+		sum = x86_tcpip_fold ( sum );
+	}
+
+	/* Sum remaining 16-bit words and any trailing byte.  At most
+	 * ( X86_TCPIP_UNROLL * sizeof ( *word ) / 2 ) values are
+	 * added, so the sum cannot overflow.
+	 */
+	half = ( ( const uint16_t * ) word );
+	for ( ; len >= sizeof ( *half ) ; len -= sizeof ( *half ) )
+		sum += *(half++);
+	if ( len ) {
+		byte = ( ( const uint8_t * ) half );
+		sum += *byte;
+	}
+
+	return ( ~x86_tcpip_fold ( sum ) );
+}
@@ -0,0 +1,16 @@
+#ifndef _BITS_CRC32C_H
+#define _BITS_CRC32C_H
+
+/** @file
+ *
+ * x86-specific CRC32C checksum
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+
+extern u32 crc32c_le ( u32 seed, const void *data, size_t len );
+
+#endif /* _BITS_CRC32C_H */
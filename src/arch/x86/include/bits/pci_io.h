@@ -11,5 +11,6 @@ FILE_LICENCE ( GPL2_OR_LATER );
 
 #include <ipxe/pcibios.h>
 #include <ipxe/pcidirect.h>
+#include <ipxe/pciecam.h>
 
 #endif /* _BITS_PCI_IO_H */
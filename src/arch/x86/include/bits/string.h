@@ -159,14 +159,11 @@ __constant_memcpy ( void *dest, const void *src, size_t len ) {
 static inline void * memmove(void * dest,const void * src, size_t n)
 {
 int d0, d1, d2;
-if (dest<src)
-__asm__ __volatile__(
-	"cld\n\t"
-	"rep\n\t"
-	"movsb"
-	: "=&c" (d0), "=&S" (d1), "=&D" (d2)
-	:"0" (n),"1" (src),"2" (dest)
-	: "memory");
+/* __memcpy() always copies forwards, so is safe unless the
+ * destination overlaps the end of the source.
+ */
+if ((dest<src) || (((const char *)dest)>=(n+(const char *)src)))
+	return __memcpy(dest, src, n);
 else
 __asm__ __volatile__(
 	"std\n\t"
@@ -0,0 +1,62 @@
+#ifndef _IPXE_CPUID_H
+#define _IPXE_CPUID_H
+
+/** @file
+ *
+ * x86 CPUID instruction
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+
+/** CPUID function to get maximum function level and vendor ID */
+#define CPUID_VENDOR_ID 0x00000000UL
+
+/** CPUID function to get basic feature flags */
+#define CPUID_FEATURES 0x00000001UL
+
+/** CPUID function to get structured extended feature flags */
+#define CPUID_EXTENDED_FEATURES 0x00000007UL
+
+/**
+ * Issue CPUID instruction
+ *
+ * @v leaf		CPUID function
+ * @v subleaf		CPUID subfunction
+ * @v eax		Output via %eax
+ * @v ebx		Output via %ebx
+ * @v ecx		Output via %ecx
+ * @v edx		Output via %edx
+ */
+static inline __attribute__ (( always_inline )) void
+cpuid ( uint32_t leaf, uint32_t subleaf, uint32_t *eax, uint32_t *ebx,
+	uint32_t *ecx, uint32_t *edx ) {
+
+	__asm__ ( "cpuid"
+		  : "=a" ( *eax ), "=b" ( *ebx ), "=c" ( *ecx ), "=d" ( *edx )
+		  : "0" ( leaf ), "2" ( subleaf ) );
+}
+
+#ifdef __i386__
+
+extern int cpuid_is_supported ( void );
+
+#else
+
+/**
+ * Check whether or not CPUID instruction is supported
+ *
+ * @ret is_supported	CPUID instruction is supported
+ */
+static inline __attribute__ (( always_inline )) int
+cpuid_is_supported ( void ) {
+
+	/* All 64-bit CPUs support CPUID */
+	return 1;
+}
+
+#endif
+
+#endif /* _IPXE_CPUID_H */
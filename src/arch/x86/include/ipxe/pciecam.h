@@ -0,0 +1,54 @@
+#ifndef _IPXE_PCIECAM_H
+#define _IPXE_PCIECAM_H
+
+/** @file
+ *
+ * PCI configuration space access via PCIe enhanced configuration
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <ipxe/acpi.h>
+
+#ifdef PCIAPI_ECAM
+#define PCIAPI_PREFIX_ecam
+#else
+#define PCIAPI_PREFIX_ecam __ecam_
+#endif
+
+/** Memory-mapped configuration space description table signature */
+#define MCFG_SIGNATURE ACPI_SIGNATURE ( 'M', 'C', 'F', 'G' )
+
+/** An enhanced configuration space allocation */
+struct ecam_allocation {
+	/** Base address (for bus 0 of this segment) */
+	uint64_t base;
+	/** PCI segment group number */
+	uint16_t segment;
+	/** Start PCI bus number */
+	uint8_t start;
+	/** End PCI bus number */
+	uint8_t end;
+	/** Reserved */
+	uint8_t reserved[4];
+} __attribute__ (( packed ));
+
+/** Memory-mapped configuration space description table */
+struct ecam_table {
+	/** ACPI header */
+	struct acpi_description_header acpi;
+	/** Reserved */
+	uint8_t reserved[8];
+	/** Allocations */
+	struct ecam_allocation alloc[0];
+} __attribute__ (( packed ));
+
+/** Length of configuration space for each bus within an allocation */
+#define ECAM_BUS_LEN ( 1 << 20 )
+
+/** Length of configuration space for each function */
+#define ECAM_FUNC_LEN ( 1 << 12 )
+
+#endif /* _IPXE_PCIECAM_H */
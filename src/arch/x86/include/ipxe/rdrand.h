@@ -0,0 +1,40 @@
+#ifndef _IPXE_RDRAND_H
+#define _IPXE_RDRAND_H
+
+/** @file
+ *
+ * RDRAND/RDSEED-based entropy source
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+
+#ifdef ENTROPY_RDRAND
+#define ENTROPY_PREFIX_rdrand
+#else
+#define ENTROPY_PREFIX_rdrand __rdrand_
+#endif
+
+/**
+ * min-entropy per sample
+ *
+ * @ret min_entropy	min-entropy of each sample
+ */
+static inline __always_inline double
+ENTROPY_INLINE ( rdrand, min_entropy_per_sample ) ( void ) {
+
+	/* RDSEED returns the output of the CPU's conditioned entropy
+	 * source, and is intended to provide full entropy.  RDRAND
+	 * (used only when RDSEED is not supported) returns the output
+	 * of a DRBG which is continually reseeded from the same
+	 * source.  Neither is a raw noise source of the kind assumed
+	 * by the health tests, and neither can be independently
+	 * verified, so we credit each 8-bit sample with only 2 bits
+	 * of min-entropy.
+	 */
+	return 2.0;
+}
+
+#endif /* _IPXE_RDRAND_H */
@@ -19,30 +19,148 @@
 FILE_LICENCE ( GPL2_OR_LATER );
 
 #include <ipxe/nap.h>
+#include <ipxe/init.h>
+#include <ipxe/netdevice.h>
 #include <ipxe/efi/efi.h>
 
 /** @file
  *
  * iPXE CPU sleeping API for EFI
  *
+ * Rather than halting the CPU directly, we idle within the
+ * firmware's WaitForEvent(), so that the firmware is able to service
+ * its own devices and timers (and to sleep the CPU in whatever way
+ * it considers appropriate).  While waiting, open network devices
+ * continue to be polled, so that packets do not accumulate in (and
+ * overflow) the hardware receive rings.
  */
 
+/** Nap timer period (in 100ns units) */
+#define EFI_NAP_PERIOD 10000
+
+/** Maximum number of packets to hold in each receive queue while napping
+ *
+ * Polling stops once this many packets are waiting to be processed,
+ * so that a flood of received packets cannot exhaust the heap while
+ * the main loop is idle.
+ */
+#define EFI_NAP_MAX_RX 32
+
+/** Nap timer event */
+static EFI_EVENT efix86_nap_event;
+
+/**
+ * Poll network devices while napping
+ *
+ * @v event		Nap timer event
+ * @v context		Event context
+ *
+ * This is invoked by the firmware for as long as we are waiting on
+ * the timer event.  Since the timer event is waited upon only from
+ * efix86_cpu_nap(), which is called only from idle points in the main
+ * loop, it is safe to poll network devices here.
+ */
+static VOID EFIAPI efix86_nap_poll ( EFI_EVENT event,
+				     VOID *context __unused ) {
+	EFI_BOOT_SERVICES *bs = efi_systab->BootServices;
+	struct net_device *netdev;
+	unsigned int before;
+	int arrived = 0;
+
+	/* Poll each open network device into its receive queue */
+	for_each_netdev ( netdev ) {
+		if ( ! netdev_is_open ( netdev ) )
+			continue;
+		if ( netdev->rx_fill >= EFI_NAP_MAX_RX )
+			continue;
+		before = netdev->rx_fill;
+		netdev_poll ( netdev );
+		if ( netdev->rx_fill != before )
+			arrived = 1;
+	}
+
+	/* Wake up immediately if any packets have arrived */
+	if ( arrived )
+		bs->SignalEvent ( event );
+}
+
 /**
  * Sleep until next interrupt
  *
  */
 static void efix86_cpu_nap ( void ) {
-	/*
-	 * I can't find any EFI API that allows us to put the CPU to
-	 * sleep.  The CpuSleep() function is defined in CpuLib.h, but
-	 * isn't part of any exposed protocol so we have no way to
-	 * call it.
-	 *
-	 * The EFI shell doesn't seem to bother sleeping the CPU; it
-	 * just sits there idly burning power.
-	 *
+	EFI_BOOT_SERVICES *bs = efi_systab->BootServices;
+	UINTN index;
+	EFI_STATUS efirc;
+
+	/* Wait for the nap timer (or for a received packet) */
+	if ( efix86_nap_event ) {
+		if ( ( efirc = bs->WaitForEvent ( 1, &efix86_nap_event,
+						  &index ) ) == 0 )
+			return;
+		DBGC ( &efix86_nap_event, "EFINAP could not wait: %s\n",
+		       efi_strerror ( efirc ) );
+	}
+
+	/* Fall back to halting until the next interrupt.  The EFI
+	 * shell doesn't seem to bother sleeping the CPU; it just sits
+	 * there idly burning power.
 	 */
 	__asm__ __volatile__ ( "hlt" );
 }
 
+/**
+ * Create nap timer event
+ *
+ */
+static void efix86_nap_startup ( void ) {
+	EFI_BOOT_SERVICES *bs = efi_systab->BootServices;
+	EFI_EVENT event;
+	EFI_STATUS efirc;
+
+	/* Create periodic timer event */
+	if ( ( efirc = bs->CreateEvent ( ( EVT_TIMER | EVT_NOTIFY_WAIT ),
+					 TPL_CALLBACK, efix86_nap_poll, NULL,
+					 &event ) ) != 0 ) {
+		DBGC ( &efix86_nap_event, "EFINAP could not create event: "
+		       "%s\n", efi_strerror ( efirc ) );
+		goto err_create;
+	}
+	if ( ( efirc = bs->SetTimer ( event, TimerPeriodic,
+				      EFI_NAP_PERIOD ) ) != 0 ) {
+		DBGC ( &efix86_nap_event, "EFINAP could not set timer: %s\n",
+		       efi_strerror ( efirc ) );
+		goto err_set_timer;
+	}
+	efix86_nap_event = event;
+
+	return;
+
+ err_set_timer:
+	bs->CloseEvent ( event );
+ err_create:
+	return;
+}
+
+/**
+ * Destroy nap timer event
+ *
+ * @v booting		System is shutting down in order to boot
+ */
+static void efix86_nap_shutdown ( int booting __unused ) {
+	EFI_BOOT_SERVICES *bs = efi_systab->BootServices;
+
+	if ( efix86_nap_event ) {
+		bs->SetTimer ( efix86_nap_event, TimerCancel, 0 );
+		bs->CloseEvent ( efix86_nap_event );
+		efix86_nap_event = NULL;
+	}
+}
+
+/** EFI nap startup function */
+struct startup_fn efix86_nap_startup_fn __startup_fn ( STARTUP_NORMAL ) = {
+	.startup = efix86_nap_startup,
+	.shutdown = efix86_nap_shutdown,
+};
+
 PROVIDE_NAP ( efix86, cpu_nap, efix86_cpu_nap );
@@ -0,0 +1,521 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <ipxe/crypto.h>
+#include <ipxe/init.h>
+#include <ipxe/aes.h>
+#include <ipxe/cpuid.h>
+
+/** @file
+ *
+ * AES-NI accelerated AES in CBC mode
+ *
+ * The 64-bit environments that we run in (EFI and Linux) all enable
+ * SSE, so the AES instructions can be used whenever the CPU supports
+ * them.  If so, the AES-NI implementation replaces the generic
+ * implementation of AES in CBC mode.
+ */
+
+/** CPUID feature flag for AES instructions (in %ecx of leaf 1) */
+#define CPUID_FEATURES_AES 0x02000000UL
+
+/** Maximum number of AES rounds */
+#define AESNI_MAX_ROUNDS 14
+
+/** An AES-NI round key */
+struct aesni_round_key {
+	uint8_t key[AES_BLOCKSIZE];
+} __attribute__ (( packed ));
+
+/** AES-NI context */
+struct aesni_context {
+	/** Encryption round keys */
+	struct aesni_round_key encrypt[ AESNI_MAX_ROUNDS + 1 ];
+	/** Decryption round keys (in order of use) */
+	struct aesni_round_key decrypt[ AESNI_MAX_ROUNDS + 1 ];
+	/** Number of rounds */
+	unsigned long rounds;
+	/** CBC chaining value */
+	uint8_t cbc[AES_BLOCKSIZE];
+};
+
+/**
+ * Check for AES-NI support
+ *
+ * @ret supported	AES instructions are supported
+ */
+static int aesni_supported ( void ) {
+	uint32_t eax;
+	uint32_t ebx;
+	uint32_t ecx;
+	uint32_t edx;
+
+	cpuid ( CPUID_FEATURES, 0, &eax, &ebx, &ecx, &edx );
+	return ( ecx & CPUID_FEATURES_AES );
+}
+
+/**
+ * Expand AES-128 round key
+ *
+ * @v rcon		Round constant
+ * @v offset		Offset of round key within key schedule
+ *
+ * Expects the previous round key in %xmm1, and leaves the new round
+ * key in %xmm1.
+ */
+#define AESNI_EXPAND_128( rcon, offset )				\
+	"aeskeygenassist $" #rcon ", %%xmm1, %%xmm2\n\t"		\
+	"pshufd $0xff, %%xmm2, %%xmm2\n\t"				\
+	"movdqa %%xmm1, %%xmm3\n\t"					\
+	"pslldq $4, %%xmm3\n\t"						\
+	"pxor %%xmm3, %%xmm1\n\t"					\
+	"pslldq $4, %%xmm3\n\t"						\
+	"pxor %%xmm3, %%xmm1\n\t"					\
+	"pslldq $4, %%xmm3\n\t"						\
+	"pxor %%xmm3, %%xmm1\n\t"					\
+	"pxor %%xmm2, %%xmm1\n\t"					\
+	"movdqu %%xmm1, " #offset "(%0)\n\t"
+
+/**
+ * Expand AES-192 key schedule by six words
+ *
+ * @v rcon		Round constant
+ *
+ * Expects the previous six words of the key schedule in %xmm1 and
+ * the low half of %xmm3, and leaves the next six words in %xmm1 and
+ * the low half of %xmm3.  The high half of %xmm3 is undefined.
+ */
+#define AESNI_EXPAND_192( rcon )					\
+	"aeskeygenassist $" #rcon ", %%xmm3, %%xmm2\n\t"		\
+	"pshufd $0x55, %%xmm2, %%xmm2\n\t"				\
+	"movdqa %%xmm1, %%xmm4\n\t"					\
+	"pslldq $4, %%xmm4\n\t"						\
+	"pxor %%xmm4, %%xmm1\n\t"					\
+	"pslldq $4, %%xmm4\n\t"						\
+	"pxor %%xmm4, %%xmm1\n\t"					\
+	"pslldq $4, %%xmm4\n\t"						\
+	"pxor %%xmm4, %%xmm1\n\t"					\
+	"pxor %%xmm2, %%xmm1\n\t"					\
+	"pshufd $0xff, %%xmm1, %%xmm2\n\t"				\
+	"movdqa %%xmm3, %%xmm4\n\t"					\
+	"pslldq $4, %%xmm4\n\t"						\
+	"pxor %%xmm4, %%xmm3\n\t"					\
+	"pxor %%xmm2, %%xmm3\n\t"
+
+/**
+ * Expand AES-192 round keys, starting mid-way through a round key
+ *
+ * @v rcon		Round constant
+ * @v offset		Offset of first round key
+ * @v next		Offset of second round key
+ *
+ * The first round key is completed using the previous two words
+ * (from the low half of %xmm3).
+ */
+#define AESNI_EXPAND_192_SPLIT( rcon, offset, next )			\
+	"movdqa %%xmm3, %%xmm5\n\t"					\
+	AESNI_EXPAND_192 ( rcon )					\
+	"shufpd $0, %%xmm1, %%xmm5\n\t"				\
+	"movdqu %%xmm5, " #offset "(%0)\n\t"				\
+	"movdqa %%xmm1, %%xmm5\n\t"					\
+	"shufpd $1, %%xmm3, %%xmm5\n\t"				\
+	"movdqu %%xmm5, " #next "(%0)\n\t"
+
+/**
+ * Expand AES-192 round key, starting at the beginning of a round key
+ *
+ * @v rcon		Round constant
+ * @v offset		Offset of round key
+ *
+ * The remaining two words (in the low half of %xmm3) are written out
+ * as part of the following round key.
+ */
+#define AESNI_EXPAND_192_ALIGNED( rcon, offset )			\
+	AESNI_EXPAND_192 ( rcon )					\
+	"movdqu %%xmm1, " #offset "(%0)\n\t"
+
+/**
+ * Expand AES-256 even-numbered round key
+ *
+ * @v rcon		Round constant
+ * @v offset		Offset of round key within key schedule
+ *
+ * Expects the previous two round keys in %xmm1 and %xmm3, and leaves
+ * the new round key in %xmm1.
+ */
+#define AESNI_EXPAND_256_EVEN( rcon, offset )				\
+	"aeskeygenassist $" #rcon ", %%xmm3, %%xmm2\n\t"		\
+	"pshufd $0xff, %%xmm2, %%xmm2\n\t"				\
+	"movdqa %%xmm1, %%xmm4\n\t"					\
+	"pslldq $4, %%xmm4\n\t"						\
+	"pxor %%xmm4, %%xmm1\n\t"					\
+	"pslldq $4, %%xmm4\n\t"						\
+	"pxor %%xmm4, %%xmm1\n\t"					\
+	"pslldq $4, %%xmm4\n\t"						\
+	"pxor %%xmm4, %%xmm1\n\t"					\
+	"pxor %%xmm2, %%xmm1\n\t"					\
+	"movdqu %%xmm1, " #offset "(%0)\n\t"
+
+/**
+ * Expand AES-256 odd-numbered round key
+ *
+ * @v offset		Offset of round key within key schedule
+ *
+ * Expects the previous two round keys in %xmm3 and %xmm1, and leaves
+ * the new round key in %xmm3.
+ */
+#define AESNI_EXPAND_256_ODD( offset )					\
+	"aeskeygenassist $0x00, %%xmm1, %%xmm2\n\t"			\
+	"pshufd $0xaa, %%xmm2, %%xmm2\n\t"				\
+	"movdqa %%xmm3, %%xmm4\n\t"					\
+	"pslldq $4, %%xmm4\n\t"						\
+	"pxor %%xmm4, %%xmm3\n\t"					\
+	"pslldq $4, %%xmm4\n\t"						\
+	"pxor %%xmm4, %%xmm3\n\t"					\
+	"pslldq $4, %%xmm4\n\t"						\
+	"pxor %%xmm4, %%xmm3\n\t"					\
+	"pxor %%xmm2, %%xmm3\n\t"					\
+	"movdqu %%xmm3, " #offset "(%0)\n\t"
+
+/**
+ * Expand AES-256 round key pair
+ *
+ * @v rcon		Round constant
+ * @v offset		Offset of even-numbered round key
+ * @v next		Offset of odd-numbered round key
+ */
+#define AESNI_EXPAND_256( rcon, offset, next )				\
+	AESNI_EXPAND_256_EVEN ( rcon, offset )				\
+	AESNI_EXPAND_256_ODD ( next )
+
+/**
+ * Set key
+ *
+ * @v ctx		Context
+ * @v key		Key
+ * @v keylen		Key length
+ * @ret rc		Return status code
+ */
+static int aesni_setkey ( void *ctx, const void *key, size_t keylen ) {
+	struct aesni_context *aesni = ctx;
+	unsigned int i;
+
+	/* Construct encryption key schedule */
+	switch ( keylen ) {
+	case ( 128 / 8 ) :
+		aesni->rounds = 10;
+		__asm__ __volatile__ ( "movdqu (%1), %%xmm1\n\t"
+				       "movdqu %%xmm1, 0(%0)\n\t"
+				       AESNI_EXPAND_128 ( 0x01, 16 )
+				       AESNI_EXPAND_128 ( 0x02, 32 )
+				       AESNI_EXPAND_128 ( 0x04, 48 )
+				       AESNI_EXPAND_128 ( 0x08, 64 )
+				       AESNI_EXPAND_128 ( 0x10, 80 )
+				       AESNI_EXPAND_128 ( 0x20, 96 )
+				       AESNI_EXPAND_128 ( 0x40, 112 )
+				       AESNI_EXPAND_128 ( 0x80, 128 )
+				       AESNI_EXPAND_128 ( 0x1b, 144 )
+				       AESNI_EXPAND_128 ( 0x36, 160 )
+				       : : "r" ( aesni->encrypt ), "r" ( key )
+				       : "xmm1", "xmm2", "xmm3", "memory" );
+		break;
+	case ( 192 / 8 ) :
+		aesni->rounds = 12;
+		__asm__ __volatile__ ( "movdqu 0(%1), %%xmm1\n\t"
+				       "movq 16(%1), %%xmm3\n\t"
+				       "movdqu %%xmm1, 0(%0)\n\t"
+				       AESNI_EXPAND_192_SPLIT ( 0x01, 16, 32 )
+				       AESNI_EXPAND_192_ALIGNED ( 0x02, 48 )
+				       AESNI_EXPAND_192_SPLIT ( 0x04, 64, 80 )
+				       AESNI_EXPAND_192_ALIGNED ( 0x08, 96 )
+				       AESNI_EXPAND_192_SPLIT ( 0x10, 112, 128 )
+				       AESNI_EXPAND_192_ALIGNED ( 0x20, 144 )
+				       AESNI_EXPAND_192_SPLIT ( 0x40, 160, 176 )
+				       AESNI_EXPAND_192_ALIGNED ( 0x80, 192 )
+				       : : "r" ( aesni->encrypt ), "r" ( key )
+				       : "xmm1", "xmm2", "xmm3", "xmm4", "xmm5",
+					 "memory" );
+		break;
+	case ( 256 / 8 ) :
+		aesni->rounds = 14;
+		__asm__ __volatile__ ( "movdqu 0(%1), %%xmm1\n\t"
+				       "movdqu 16(%1), %%xmm3\n\t"
+				       "movdqu %%xmm1, 0(%0)\n\t"
+				       "movdqu %%xmm3, 16(%0)\n\t"
+				       AESNI_EXPAND_256 ( 0x01, 32, 48 )
+				       AESNI_EXPAND_256 ( 0x02, 64, 80 )
+				       AESNI_EXPAND_256 ( 0x04, 96, 112 )
+				       AESNI_EXPAND_256 ( 0x08, 128, 144 )
+				       AESNI_EXPAND_256 ( 0x10, 160, 176 )
+				       AESNI_EXPAND_256 ( 0x20, 192, 208 )
+				       AESNI_EXPAND_256_EVEN ( 0x40, 224 )
+				       : : "r" ( aesni->encrypt ), "r" ( key )
+				       : "xmm1", "xmm2", "xmm3", "xmm4",
+					 "memory" );
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	/* Construct decryption key schedule for the equivalent
+	 * inverse cipher.
+	 */
+	memcpy ( &aesni->decrypt[0], &aesni->encrypt[aesni->rounds],
+		 sizeof ( aesni->decrypt[0] ) );
+	for ( i = 1 ; i < aesni->rounds ; i++ ) {
+		__asm__ __volatile__ ( "movdqu (%1), %%xmm1\n\t"
+				       "aesimc %%xmm1, %%xmm1\n\t"
+				       "movdqu %%xmm1, (%0)\n\t"
+				       : : "r" ( &aesni->decrypt[i] ),
+					   "r" ( &aesni->encrypt[ aesni->rounds
+								  - i ] )
+				       : "xmm1", "memory" );
+	}
+	memcpy ( &aesni->decrypt[aesni->rounds], &aesni->encrypt[0],
+		 sizeof ( aesni->decrypt[0] ) );
+
+	return 0;
+}
+
+/**
+ * Set initialisation vector
+ *
+ * @v ctx		Context
+ * @v iv		Initialisation vector
+ */
+static void aesni_setiv ( void *ctx, const void *iv ) {
+	struct aesni_context *aesni = ctx;
+
+	memcpy ( aesni->cbc, iv, sizeof ( aesni->cbc ) );
+}
+
+/**
+ * Encrypt data
+ *
+ * @v ctx		Context
+ * @v src		Data to encrypt
+ * @v dst		Buffer for encrypted data
+ * @v len		Length of data
+ *
+ * CBC encryption is inherently serial, so blocks are encrypted one
+ * at a time, with the chaining value held in %xmm0 throughout.
+ */
+static void aesni_encrypt ( void *ctx, const void *src, void *dst,
+			    size_t len ) {
+	struct aesni_context *aesni = ctx;
+	void *discard_key;
+	unsigned long discard_count;
+
+	assert ( ( len % AES_BLOCKSIZE ) == 0 );
+	if ( ! len )
+		return;
+
+	__asm__ __volatile__ ( "movdqu (%[cbc]), %%xmm0\n\t"
+			       "\n1:\n\t"
+			       "movdqu (%[src]), %%xmm1\n\t"
+			       "pxor %%xmm1, %%xmm0\n\t"
+			       "movdqu (%[keys]), %%xmm2\n\t"
+			       "pxor %%xmm2, %%xmm0\n\t"
+			       "lea 16(%[keys]), %[key]\n\t"
+			       "mov %[rounds], %[count]\n\t"
+			       "dec %[count]\n\t"
+			       "\n2:\n\t"
+			       "movdqu (%[key]), %%xmm2\n\t"
+			       "aesenc %%xmm2, %%xmm0\n\t"
+			       "add $16, %[key]\n\t"
+			       "dec %[count]\n\t"
+			       "jnz 2b\n\t"
+			       "movdqu (%[key]), %%xmm2\n\t"
+			       "aesenclast %%xmm2, %%xmm0\n\t"
+			       "movdqu %%xmm0, (%[dst])\n\t"
+			       "add $16, %[src]\n\t"
+			       "add $16, %[dst]\n\t"
+			       "sub $16, %[len]\n\t"
+			       "jnz 1b\n\t"
+			       "movdqu %%xmm0, (%[cbc])\n\t"
+			       : [src] "+r" ( src ), [dst] "+r" ( dst ),
+				 [len] "+r" ( len ), [key] "=&r" ( discard_key ),
+				 [count] "=&r" ( discard_count )
+			       : [cbc] "r" ( aesni->cbc ),
+				 [keys] "r" ( aesni->encrypt ),
+				 [rounds] "r" ( aesni->rounds )
+			       : "xmm0", "xmm1", "xmm2", "memory" );
+}
+
+/**
+ * Decrypt four blocks
+ *
+ * Expects the ciphertext blocks in %xmm0-%xmm3, and leaves the raw
+ * decrypted blocks (before chaining) in %xmm0-%xmm3.
+ */
+#define AESNI_DECRYPT_4( insn )						\
+	insn " %%xmm4, %%xmm0\n\t"					\
+	insn " %%xmm4, %%xmm1\n\t"					\
+	insn " %%xmm4, %%xmm2\n\t"					\
+	insn " %%xmm4, %%xmm3\n\t"
+
+/**
+ * Decrypt data
+ *
+ * @v ctx		Context
+ * @v src		Data to decrypt
+ * @v dst		Buffer for decrypted data
+ * @v len		Length of data
+ *
+ * CBC decryption has no dependency between blocks, so four blocks at
+ * a time are interleaved through the AES pipeline.  The chaining
+ * value and the original ciphertext blocks are held in registers, so
+ * that @c src and @c dst may be identical.
+ */
+static void aesni_decrypt ( void *ctx, const void *src, void *dst,
+			    size_t len ) {
+	struct aesni_context *aesni = ctx;
+	void *discard_key;
+	unsigned long discard_count;
+
+	assert ( ( len % AES_BLOCKSIZE ) == 0 );
+
+	__asm__ __volatile__ ( "movdqu (%[cbc]), %%xmm9\n\t"
+			       /* Process four blocks at a time */
+			       "cmp $64, %[len]\n\t"
+			       "jb 3f\n\t"
+			       "\n1:\n\t"
+			       "movdqu 0(%[src]), %%xmm0\n\t"
+			       "movdqu 16(%[src]), %%xmm1\n\t"
+			       "movdqu 32(%[src]), %%xmm2\n\t"
+			       "movdqu 48(%[src]), %%xmm3\n\t"
+			       "movdqa %%xmm0, %%xmm5\n\t"
+			       "movdqa %%xmm1, %%xmm6\n\t"
+			       "movdqa %%xmm2, %%xmm7\n\t"
+			       "movdqa %%xmm3, %%xmm8\n\t"
+			       "movdqu (%[keys]), %%xmm4\n\t"
+			       AESNI_DECRYPT_4 ( "pxor" )
+			       "lea 16(%[keys]), %[key]\n\t"
+			       "mov %[rounds], %[count]\n\t"
+			       "dec %[count]\n\t"
+			       "\n2:\n\t"
+			       "movdqu (%[key]), %%xmm4\n\t"
+			       AESNI_DECRYPT_4 ( "aesdec" )
+			       "add $16, %[key]\n\t"
+			       "dec %[count]\n\t"
+			       "jnz 2b\n\t"
+			       "movdqu (%[key]), %%xmm4\n\t"
+			       AESNI_DECRYPT_4 ( "aesdeclast" )
+			       "pxor %%xmm9, %%xmm0\n\t"
+			       "pxor %%xmm5, %%xmm1\n\t"
+			       "pxor %%xmm6, %%xmm2\n\t"
+			       "pxor %%xmm7, %%xmm3\n\t"
+			       "movdqa %%xmm8, %%xmm9\n\t"
+			       "movdqu %%xmm0, 0(%[dst])\n\t"
+			       "movdqu %%xmm1, 16(%[dst])\n\t"
+			       "movdqu %%xmm2, 32(%[dst])\n\t"
+			       "movdqu %%xmm3, 48(%[dst])\n\t"
+			       "add $64, %[src]\n\t"
+			       "add $64, %[dst]\n\t"
+			       "sub $64, %[len]\n\t"
+			       "cmp $64, %[len]\n\t"
+			       "jae 1b\n\t"
+			       /* Process any remaining single blocks */
+			       "\n3:\n\t"
+			       "test %[len], %[len]\n\t"
+			       "jz 6f\n\t"
+			       "\n4:\n\t"
+			       "movdqu (%[src]), %%xmm0\n\t"
+			       "movdqa %%xmm0, %%xmm5\n\t"
+			       "movdqu (%[keys]), %%xmm4\n\t"
+			       "pxor %%xmm4, %%xmm0\n\t"
+			       "lea 16(%[keys]), %[key]\n\t"
+			       "mov %[rounds], %[count]\n\t"
+			       "dec %[count]\n\t"
+			       "\n5:\n\t"
+			       "movdqu (%[key]), %%xmm4\n\t"
+			       "aesdec %%xmm4, %%xmm0\n\t"
+			       "add $16, %[key]\n\t"
+			       "dec %[count]\n\t"
+			       "jnz 5b\n\t"
+			       "movdqu (%[key]), %%xmm4\n\t"
+			       "aesdeclast %%xmm4, %%xmm0\n\t"
+			       "pxor %%xmm9, %%xmm0\n\t"
+			       "movdqa %%xmm5, %%xmm9\n\t"
+			       "movdqu %%xmm0, (%[dst])\n\t"
+			       "add $16, %[src]\n\t"
+			       "add $16, %[dst]\n\t"
+			       "sub $16, %[len]\n\t"
+			       "jnz 4b\n\t"
+			       "\n6:\n\t"
+			       "movdqu %%xmm9, (%[cbc])\n\t"
+			       : [src] "+r" ( src ), [dst] "+r" ( dst ),
+				 [len] "+r" ( len ), [key] "=&r" ( discard_key ),
+				 [count] "=&r" ( discard_count )
+			       : [cbc] "r" ( aesni->cbc ),
+				 [keys] "r" ( aesni->decrypt ),
+				 [rounds] "r" ( aesni->rounds )
+			       : "xmm0", "xmm1", "xmm2", "xmm3", "xmm4",
+				 "xmm5", "xmm6", "xmm7", "xmm8", "xmm9",
+				 "memory" );
+}
+
+/** AES-NI accelerated AES in CBC mode */
+struct cipher_algorithm aesni_cbc_algorithm = {
+	.name = "aes_cbc",
+	.ctxsize = sizeof ( struct aesni_context ),
+	.blocksize = AES_BLOCKSIZE,
+	.setkey = aesni_setkey,
+	.setiv = aesni_setiv,
+	.encrypt = aesni_encrypt,
+	.decrypt = aesni_decrypt,
+};
+
+/**
+ * Initialise AES-NI
+ *
+ */
+static void aesni_init ( void ) {
+
+	/* Ensure that statically sized AES-CBC contexts are large
+	 * enough to hold an AES-NI context.
+	 */
+	linker_assert ( ( sizeof ( struct aesni_context ) <=
+			  AES_CBC_CTX_MAX_SIZE ), __aesni_context_too_large );
+
+	/* Do nothing unless the CPU supports the AES instructions */
+	if ( ! aesni_supported() ) {
+		DBG ( "AES-NI not supported\n" );
+		return;
+	}
+
+	/* Replace generic AES-CBC implementation.  This must happen
+	 * before any AES-CBC contexts are created, since the context
+	 * size changes.
+	 */
+	DBG ( "AES-NI enabled\n" );
+	memcpy ( &aes_cbc_algorithm, &aesni_cbc_algorithm,
+		 sizeof ( aes_cbc_algorithm ) );
+}
+
+/** AES-NI initialisation function */
+struct init_fn aesni_init_fn __init_fn ( INIT_NORMAL ) = {
+	.initialise = aesni_init,
+};
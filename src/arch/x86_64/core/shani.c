@@ -0,0 +1,406 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <byteswap.h>
+#include <ipxe/init.h>
+#include <ipxe/cpuid.h>
+#include <ipxe/sha1.h>
+#include <ipxe/sha256.h>
+
+/** @file
+ *
+ * SHA extensions accelerated SHA-1 and SHA-256
+ *
+ * If the CPU supports the SHA extensions, the SHA-1 and SHA-256 block
+ * compression functions are replaced with implementations using the
+ * SHA instructions.  These implementations also require SSSE3 and
+ * SSE4.1, which are present on every CPU supporting the SHA
+ * extensions.
+ */
+
+/** CPUID feature flag for SHA instructions (in %ebx of leaf 7) */
+#define CPUID_EXTENDED_FEATURES_SHA 0x20000000UL
+
+/** Byte-swapping shuffle mask for SHA-256 message dwords */
+static const uint8_t shani_sha256_mask[16] = {
+	3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12
+};
+
+/** Byte-reversing shuffle mask for SHA-1 message blocks */
+static const uint8_t shani_sha1_mask[16] = {
+	15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0
+};
+
+/** SHA-256 constants */
+static const uint32_t shani_sha256_k[64] __attribute__ (( aligned ( 16 ) )) = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+	0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+	0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+	0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+	0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+	0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+/**
+ * Check for SHA extensions support
+ *
+ * @ret supported	SHA instructions are supported
+ */
+static int shani_supported ( void ) {
+	uint32_t eax;
+	uint32_t ebx;
+	uint32_t ecx;
+	uint32_t edx;
+
+	cpuid ( CPUID_VENDOR_ID, 0, &eax, &ebx, &ecx, &edx );
+	if ( eax < CPUID_EXTENDED_FEATURES )
+		return 0;
+
+	cpuid ( CPUID_EXTENDED_FEATURES, 0, &eax, &ebx, &ecx, &edx );
+	return ( ebx & CPUID_EXTENDED_FEATURES_SHA );
+}
+
+/**
+ * Load SHA-256 message dwords
+ *
+ * @v i			Message dword group (0-3)
+ * @v msg		Register for message dwords
+ */
+#define SHANI_SHA256_LOAD( i, msg )					\
+	"movdqu " #i "*16(%[data]), %%xmm" #msg "\n\t"			\
+	"pshufb %%xmm8, %%xmm" #msg "\n\t"
+
+/**
+ * Calculate next SHA-256 message dwords
+ *
+ * @v msg0		Register holding W[t-16..t-13], and result W[t..t+3]
+ * @v msg1		Register holding W[t-12..t-9]
+ * @v msg2		Register holding W[t-8..t-5]
+ * @v msg3		Register holding W[t-4..t-1]
+ */
+#define SHANI_SHA256_SCHEDULE( msg0, msg1, msg2, msg3 )			\
+	"sha256msg1 %%xmm" #msg1 ", %%xmm" #msg0 "\n\t"			\
+	"movdqa %%xmm" #msg3 ", %%xmm7\n\t"				\
+	"palignr $4, %%xmm" #msg2 ", %%xmm7\n\t"			\
+	"paddd %%xmm7, %%xmm" #msg0 "\n\t"				\
+	"sha256msg2 %%xmm" #msg3 ", %%xmm" #msg0 "\n\t"
+
+/**
+ * Perform four SHA-256 rounds
+ *
+ * @v i			Round group (0-15)
+ * @v msg		Register holding message dwords
+ *
+ * The state is held in %xmm1 (ABEF) and %xmm2 (CDGH).
+ */
+#define SHANI_SHA256_ROUNDS( i, msg )					\
+	"movdqa %%xmm" #msg ", %%xmm0\n\t"				\
+	"paddd " #i "*16(%[k]), %%xmm0\n\t"				\
+	"sha256rnds2 %%xmm1, %%xmm2\n\t"				\
+	"pshufd $0x0e, %%xmm0, %%xmm0\n\t"				\
+	"sha256rnds2 %%xmm2, %%xmm1\n\t"
+
+/**
+ * Digest data blocks using SHA-256 instructions
+ *
+ * @v context		SHA-256 context
+ * @v data		Data blocks
+ * @v count		Number of data blocks
+ */
+static void shani_sha256_compress ( struct sha256_context *context,
+				    const void *data, size_t count ) {
+	struct sha256_digest digest;
+	unsigned int i;
+
+	/* Do nothing if there are no blocks */
+	if ( ! count )
+		return;
+
+	/* Convert digest to host-endian */
+	for ( i = 0 ; i < 8 ; i++ )
+		digest.h[i] = be32_to_cpu ( context->ddd.dd.digest.h[i] );
+
+	/* Digest blocks */
+	__asm__ __volatile__ ( "movdqu (%[mask]), %%xmm8\n\t"
+			       "movdqu 0(%[digest]), %%xmm1\n\t"
+			       "movdqu 16(%[digest]), %%xmm2\n\t"
+			       "movdqa %%xmm1, %%xmm7\n\t"
+			       "punpcklqdq %%xmm2, %%xmm1\n\t"
+			       "punpckhqdq %%xmm7, %%xmm2\n\t"
+			       "pshufd $0x1b, %%xmm1, %%xmm1\n\t"
+			       "pshufd $0xb1, %%xmm2, %%xmm2\n\t"
+			       "\n1:\n\t"
+			       "movdqa %%xmm1, %%xmm9\n\t"
+			       "movdqa %%xmm2, %%xmm10\n\t"
+			       SHANI_SHA256_LOAD ( 0, 3 )
+			       SHANI_SHA256_ROUNDS ( 0, 3 )
+			       SHANI_SHA256_LOAD ( 1, 4 )
+			       SHANI_SHA256_ROUNDS ( 1, 4 )
+			       SHANI_SHA256_LOAD ( 2, 5 )
+			       SHANI_SHA256_ROUNDS ( 2, 5 )
+			       SHANI_SHA256_LOAD ( 3, 6 )
+			       SHANI_SHA256_ROUNDS ( 3, 6 )
+			       SHANI_SHA256_SCHEDULE ( 3, 4, 5, 6 )
+			       SHANI_SHA256_ROUNDS ( 4, 3 )
+			       SHANI_SHA256_SCHEDULE ( 4, 5, 6, 3 )
+			       SHANI_SHA256_ROUNDS ( 5, 4 )
+			       SHANI_SHA256_SCHEDULE ( 5, 6, 3, 4 )
+			       SHANI_SHA256_ROUNDS ( 6, 5 )
+			       SHANI_SHA256_SCHEDULE ( 6, 3, 4, 5 )
+			       SHANI_SHA256_ROUNDS ( 7, 6 )
+			       SHANI_SHA256_SCHEDULE ( 3, 4, 5, 6 )
+			       SHANI_SHA256_ROUNDS ( 8, 3 )
+			       SHANI_SHA256_SCHEDULE ( 4, 5, 6, 3 )
+			       SHANI_SHA256_ROUNDS ( 9, 4 )
+			       SHANI_SHA256_SCHEDULE ( 5, 6, 3, 4 )
+			       SHANI_SHA256_ROUNDS ( 10, 5 )
+			       SHANI_SHA256_SCHEDULE ( 6, 3, 4, 5 )
+			       SHANI_SHA256_ROUNDS ( 11, 6 )
+			       SHANI_SHA256_SCHEDULE ( 3, 4, 5, 6 )
+			       SHANI_SHA256_ROUNDS ( 12, 3 )
+			       SHANI_SHA256_SCHEDULE ( 4, 5, 6, 3 )
+			       SHANI_SHA256_ROUNDS ( 13, 4 )
+			       SHANI_SHA256_SCHEDULE ( 5, 6, 3, 4 )
+			       SHANI_SHA256_ROUNDS ( 14, 5 )
+			       SHANI_SHA256_SCHEDULE ( 6, 3, 4, 5 )
+			       SHANI_SHA256_ROUNDS ( 15, 6 )
+			       "paddd %%xmm9, %%xmm1\n\t"
+			       "paddd %%xmm10, %%xmm2\n\t"
+			       "add $64, %[data]\n\t"
+			       "dec %[count]\n\t"
+			       "jnz 1b\n\t"
+			       "movdqa %%xmm1, %%xmm7\n\t"
+			       "punpcklqdq %%xmm2, %%xmm1\n\t"
+			       "punpckhqdq %%xmm7, %%xmm2\n\t"
+			       "pshufd $0xb1, %%xmm1, %%xmm1\n\t"
+			       "pshufd $0x1b, %%xmm2, %%xmm2\n\t"
+			       "movdqu %%xmm2, 0(%[digest])\n\t"
+			       "movdqu %%xmm1, 16(%[digest])\n\t"
+			       : [data] "+r" ( data ), [count] "+r" ( count )
+			       : [digest] "r" ( &digest ),
+				 [k] "r" ( shani_sha256_k ),
+				 [mask] "r" ( shani_sha256_mask )
+			       : "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5",
+				 "xmm6", "xmm7", "xmm8", "xmm9", "xmm10",
+				 "memory" );
+
+	/* Convert digest back to big-endian */
+	for ( i = 0 ; i < 8 ; i++ )
+		context->ddd.dd.digest.h[i] = cpu_to_be32 ( digest.h[i] );
+}
+
+/**
+ * Load SHA-1 message dwords
+ *
+ * @v i			Message dword group (0-3)
+ * @v msg		Register for message dwords
+ */
+#define SHANI_SHA1_LOAD( i, msg )					\
+	"movdqu " #i "*16(%[data]), %%xmm" #msg "\n\t"			\
+	"pshufb %%xmm7, %%xmm" #msg "\n\t"
+
+/**
+ * Perform first four SHA-1 rounds
+ *
+ * @v func		Round function (0-3)
+ * @v msg		Register holding message dwords
+ *
+ * The state is held in %xmm0 (ABCD) and %xmm1 (E).
+ */
+#define SHANI_SHA1_FIRST_ROUNDS( func, msg )				\
+	"paddd %%xmm" #msg ", %%xmm1\n\t"				\
+	"movdqa %%xmm0, %%xmm2\n\t"					\
+	"sha1rnds4 $" #func ", %%xmm1, %%xmm0\n\t"
+
+/**
+ * Perform subsequent four SHA-1 rounds
+ *
+ * @v func		Round function (0-3)
+ * @v e			Register holding ABCD from before previous rounds
+ * @v next_e		Register to hold ABCD from before these rounds
+ * @v msg		Register holding message dwords
+ */
+#define SHANI_SHA1_ROUNDS( func, e, next_e, msg )			\
+	"sha1nexte %%xmm" #msg ", %%xmm" #e "\n\t"			\
+	"movdqa %%xmm0, %%xmm" #next_e "\n\t"				\
+	"sha1rnds4 $" #func ", %%xmm" #e ", %%xmm0\n\t"
+
+/**
+ * Perform SHA-1 message schedule operations
+ *
+ * @v src		Source register
+ * @v dst		Destination register
+ */
+#define SHANI_SHA1_MSG1( src, dst )					\
+	"sha1msg1 %%xmm" #src ", %%xmm" #dst "\n\t"
+#define SHANI_SHA1_MSG2( src, dst )					\
+	"sha1msg2 %%xmm" #src ", %%xmm" #dst "\n\t"
+#define SHANI_SHA1_XOR( src, dst )					\
+	"pxor %%xmm" #src ", %%xmm" #dst "\n\t"
+
+/**
+ * Digest data blocks using SHA-1 instructions
+ *
+ * @v context		SHA-1 context
+ * @v data		Data blocks
+ * @v count		Number of data blocks
+ */
+static void shani_sha1_compress ( struct sha1_context *context,
+				  const void *data, size_t count ) {
+	struct sha1_digest digest;
+	unsigned int i;
+
+	/* Do nothing if there are no blocks */
+	if ( ! count )
+		return;
+
+	/* Convert digest to host-endian */
+	for ( i = 0 ; i < 5 ; i++ )
+		digest.h[i] = be32_to_cpu ( context->ddd.dd.digest.h[i] );
+
+	/* Digest blocks */
+	__asm__ __volatile__ ( "movdqu (%[mask]), %%xmm7\n\t"
+			       "movdqu 0(%[digest]), %%xmm0\n\t"
+			       "pshufd $0x1b, %%xmm0, %%xmm0\n\t"
+			       "pxor %%xmm1, %%xmm1\n\t"
+			       "pinsrd $3, 16(%[digest]), %%xmm1\n\t"
+			       "\n1:\n\t"
+			       "movdqa %%xmm0, %%xmm8\n\t"
+			       "movdqa %%xmm1, %%xmm9\n\t"
+			       SHANI_SHA1_LOAD ( 0, 3 )
+			       SHANI_SHA1_FIRST_ROUNDS ( 0, 3 )
+			       SHANI_SHA1_LOAD ( 1, 4 )
+			       SHANI_SHA1_ROUNDS ( 0, 2, 1, 4 )
+			       SHANI_SHA1_MSG1 ( 4, 3 )
+			       SHANI_SHA1_LOAD ( 2, 5 )
+			       SHANI_SHA1_ROUNDS ( 0, 1, 2, 5 )
+			       SHANI_SHA1_MSG1 ( 5, 4 )
+			       SHANI_SHA1_XOR ( 5, 3 )
+			       SHANI_SHA1_LOAD ( 3, 6 )
+			       SHANI_SHA1_ROUNDS ( 0, 2, 1, 6 )
+			       SHANI_SHA1_MSG2 ( 6, 3 )
+			       SHANI_SHA1_MSG1 ( 6, 5 )
+			       SHANI_SHA1_XOR ( 6, 4 )
+			       SHANI_SHA1_ROUNDS ( 0, 1, 2, 3 )
+			       SHANI_SHA1_MSG2 ( 3, 4 )
+			       SHANI_SHA1_MSG1 ( 3, 6 )
+			       SHANI_SHA1_XOR ( 3, 5 )
+			       SHANI_SHA1_ROUNDS ( 1, 2, 1, 4 )
+			       SHANI_SHA1_MSG2 ( 4, 5 )
+			       SHANI_SHA1_MSG1 ( 4, 3 )
+			       SHANI_SHA1_XOR ( 4, 6 )
+			       SHANI_SHA1_ROUNDS ( 1, 1, 2, 5 )
+			       SHANI_SHA1_MSG2 ( 5, 6 )
+			       SHANI_SHA1_MSG1 ( 5, 4 )
+			       SHANI_SHA1_XOR ( 5, 3 )
+			       SHANI_SHA1_ROUNDS ( 1, 2, 1, 6 )
+			       SHANI_SHA1_MSG2 ( 6, 3 )
+			       SHANI_SHA1_MSG1 ( 6, 5 )
+			       SHANI_SHA1_XOR ( 6, 4 )
+			       SHANI_SHA1_ROUNDS ( 1, 1, 2, 3 )
+			       SHANI_SHA1_MSG2 ( 3, 4 )
+			       SHANI_SHA1_MSG1 ( 3, 6 )
+			       SHANI_SHA1_XOR ( 3, 5 )
+			       SHANI_SHA1_ROUNDS ( 1, 2, 1, 4 )
+			       SHANI_SHA1_MSG2 ( 4, 5 )
+			       SHANI_SHA1_MSG1 ( 4, 3 )
+			       SHANI_SHA1_XOR ( 4, 6 )
+			       SHANI_SHA1_ROUNDS ( 2, 1, 2, 5 )
+			       SHANI_SHA1_MSG2 ( 5, 6 )
+			       SHANI_SHA1_MSG1 ( 5, 4 )
+			       SHANI_SHA1_XOR ( 5, 3 )
+			       SHANI_SHA1_ROUNDS ( 2, 2, 1, 6 )
+			       SHANI_SHA1_MSG2 ( 6, 3 )
+			       SHANI_SHA1_MSG1 ( 6, 5 )
+			       SHANI_SHA1_XOR ( 6, 4 )
+			       SHANI_SHA1_ROUNDS ( 2, 1, 2, 3 )
+			       SHANI_SHA1_MSG2 ( 3, 4 )
+			       SHANI_SHA1_MSG1 ( 3, 6 )
+			       SHANI_SHA1_XOR ( 3, 5 )
+			       SHANI_SHA1_ROUNDS ( 2, 2, 1, 4 )
+			       SHANI_SHA1_MSG2 ( 4, 5 )
+			       SHANI_SHA1_MSG1 ( 4, 3 )
+			       SHANI_SHA1_XOR ( 4, 6 )
+			       SHANI_SHA1_ROUNDS ( 2, 1, 2, 5 )
+			       SHANI_SHA1_MSG2 ( 5, 6 )
+			       SHANI_SHA1_MSG1 ( 5, 4 )
+			       SHANI_SHA1_XOR ( 5, 3 )
+			       SHANI_SHA1_ROUNDS ( 3, 2, 1, 6 )
+			       SHANI_SHA1_MSG2 ( 6, 3 )
+			       SHANI_SHA1_MSG1 ( 6, 5 )
+			       SHANI_SHA1_XOR ( 6, 4 )
+			       SHANI_SHA1_ROUNDS ( 3, 1, 2, 3 )
+			       SHANI_SHA1_MSG2 ( 3, 4 )
+			       SHANI_SHA1_MSG1 ( 3, 6 )
+			       SHANI_SHA1_XOR ( 3, 5 )
+			       SHANI_SHA1_ROUNDS ( 3, 2, 1, 4 )
+			       SHANI_SHA1_MSG2 ( 4, 5 )
+			       SHANI_SHA1_XOR ( 4, 6 )
+			       SHANI_SHA1_ROUNDS ( 3, 1, 2, 5 )
+			       SHANI_SHA1_MSG2 ( 5, 6 )
+			       SHANI_SHA1_ROUNDS ( 3, 2, 1, 6 )
+			       "sha1nexte %%xmm9, %%xmm1\n\t"
+			       "paddd %%xmm8, %%xmm0\n\t"
+			       "add $64, %[data]\n\t"
+			       "dec %[count]\n\t"
+			       "jnz 1b\n\t"
+			       "pshufd $0x1b, %%xmm0, %%xmm0\n\t"
+			       "movdqu %%xmm0, 0(%[digest])\n\t"
+			       "pextrd $3, %%xmm1, 16(%[digest])\n\t"
+			       : [data] "+r" ( data ), [count] "+r" ( count )
+			       : [digest] "r" ( &digest ),
+				 [mask] "r" ( shani_sha1_mask )
+			       : "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5",
+				 "xmm6", "xmm7", "xmm8", "xmm9", "memory" );
+
+	/* Convert digest back to big-endian */
+	for ( i = 0 ; i < 5 ; i++ )
+		context->ddd.dd.digest.h[i] = cpu_to_be32 ( digest.h[i] );
+}
+
+/**
+ * Initialise SHA extensions accelerated SHA-1 and SHA-256
+ *
+ */
+static void shani_init ( void ) {
+
+	/* Do nothing unless the CPU supports the SHA instructions */
+	if ( ! shani_supported() ) {
+		DBG ( "SHA extensions not supported\n" );
+		return;
+	}
+
+	/* Replace generic block compression functions */
+	DBG ( "SHA extensions enabled\n" );
+	sha1_compress = shani_sha1_compress;
+	sha256_compress = shani_sha256_compress;
+}
+
+/** SHA extensions initialisation function */
+struct init_fn shani_init_fn __init_fn ( INIT_NORMAL ) = {
+	.initialise = shani_init,
+};
@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+#include <stdint.h>
+#include <string.h>
+#include <ipxe/init.h>
+#include <ipxe/cpuid.h>
+#include <ipxe/bigint.h>
+
+/** @file
+ *
+ * Big integer support
+ *
+ * Big integers are held as 64-bit elements.  Multiplication is built
+ * from a single kernel which adds a multiple of one big integer to
+ * another.  If the CPU supports the BMI2 and ADX extensions, this
+ * kernel is replaced with one using MULX, ADCX and ADOX, which allow
+ * the low and high halves of each product to be accumulated using
+ * two independent carry chains.
+ */
+
+/** CPUID feature flag for BMI2 instructions (in %ebx of leaf 7) */
+#define CPUID_EXTENDED_FEATURES_BMI2 0x00000100UL
+
+/** CPUID feature flag for ADX instructions (in %ebx of leaf 7) */
+#define CPUID_EXTENDED_FEATURES_ADX 0x00080000UL
+
+/**
+ * Add multiple of big integer
+ *
+ * @v multiplicand0	Element 0 of big integer to be multiplied
+ * @v multiplier	Single-element multiplier
+ * @v value0		Element 0 of big integer to be added to
+ * @v size		Number of elements
+ * @ret carry		Carry out of most significant element
+ */
+static uint64_t bigint_multiply_add_generic ( const uint64_t *multiplicand0,
+					      uint64_t multiplier,
+					      uint64_t *value0,
+					      unsigned int size ) {
+	bigint_double_element_t accumulator = 0;
+	unsigned int i;
+
+	for ( i = 0 ; i < size ; i++ ) {
+		accumulator += ( ( ( bigint_double_element_t )
+				   multiplicand0[i] ) * multiplier );
+		accumulator += value0[i];
+		value0[i] = accumulator;
+		accumulator >>= ( 8 * sizeof ( value0[i] ) );
+	}
+
+	return accumulator;
+}
+
+/**
+ * Add multiple of big integer using MULX, ADCX and ADOX
+ *
+ * @v multiplicand0	Element 0 of big integer to be multiplied
+ * @v multiplier	Single-element multiplier
+ * @v value0		Element 0 of big integer to be added to
+ * @v size		Number of elements
+ * @ret carry		Carry out of most significant element
+ *
+ * The low half of each product is added to the existing element
+ * using the CF chain (ADCX), and the high half of the previous
+ * product is added using the OF chain (ADOX).  Neither MULX, LEA nor
+ * JRCXZ affects the flags, so both chains survive around the loop.
+ */
+static uint64_t bigint_multiply_add_adx ( const uint64_t *multiplicand0,
+					  uint64_t multiplier,
+					  uint64_t *value0,
+					  unsigned int size ) {
+	unsigned long count = size;
+	uint64_t carry;
+	uint64_t discard_lo;
+	uint64_t discard_hi;
+
+	__asm__ __volatile__ ( /* Zero carry, and clear CF and OF */
+			       "xor %[carry], %[carry]\n\t"
+			       "\n1:\n\t"
+			       "mulx (%[multiplicand]), %[lo], %[hi]\n\t"
+			       "adcx (%[value]), %[lo]\n\t"
+			       "adox %[carry], %[lo]\n\t"
+			       "mov %[lo], (%[value])\n\t"
+			       "mov %[hi], %[carry]\n\t"
+			       "lea 8(%[multiplicand]), %[multiplicand]\n\t"
+			       "lea 8(%[value]), %[value]\n\t"
+			       "lea -1(%[count]), %[count]\n\t"
+			       "jrcxz 2f\n\t"
+			       "jmp 1b\n\t"
+			       "\n2:\n\t"
+			       /* Add final carries from both chains */
+			       "mov $0, %k[lo]\n\t"
+			       "adcx %[lo], %[carry]\n\t"
+			       "adox %[lo], %[carry]\n\t"
+			       : [carry] "=&r" ( carry ),
+				 [lo] "=&r" ( discard_lo ),
+				 [hi] "=&r" ( discard_hi ),
+				 [multiplicand] "+r" ( multiplicand0 ),
+				 [value] "+r" ( value0 ),
+				 [count] "+c" ( count )
+			       : [multiplier] "d" ( multiplier )
+			       : "memory" );
+
+	return carry;
+}
+
+/** Add multiple of big integer */
+static uint64_t ( * bigint_multiply_add ) ( const uint64_t *multiplicand0,
+					    uint64_t multiplier,
+					    uint64_t *value0,
+					    unsigned int size ) =
+	bigint_multiply_add_generic;
+
+/**
+ * Multiply big integers
+ *
+ * @v multiplicand0	Element 0 of big integer to be multiplied
+ * @v multiplier0	Element 0 of big integer to be multiplied
+ * @v result0		Element 0 of big integer to hold result
+ * @v size		Number of elements
+ */
+void bigint_multiply_raw ( const uint64_t *multiplicand0,
+			   const uint64_t *multiplier0,
+			   uint64_t *result0, unsigned int size ) {
+	const bigint_t ( size ) __attribute__ (( may_alias )) *multiplier =
+		( ( const void * ) multiplier0 );
+	bigint_t ( size * 2 ) __attribute__ (( may_alias )) *result =
+		( ( void * ) result0 );
+	unsigned int i;
+
+	/* Zero result */
+	memset ( result, 0, sizeof ( *result ) );
+
+	/* Add multiplicand multiplied by each element of multiplier.
+	 * The most significant element touched by each row has not
+	 * yet been written, so the carry can be stored directly.
+	 */
+	for ( i = 0 ; i < size ; i++ ) {
+		result->element[ i + size ] =
+			bigint_multiply_add ( multiplicand0,
+					      multiplier->element[i],
+					      &result->element[i], size );
+	}
+}
+
+/**
+ * Check for BMI2 and ADX support
+ *
+ * @ret supported	MULX, ADCX and ADOX instructions are supported
+ */
+static int bigint_adx_supported ( void ) {
+	uint32_t eax;
+	uint32_t ebx;
+	uint32_t ecx;
+	uint32_t edx;
+	uint32_t required = ( CPUID_EXTENDED_FEATURES_BMI2 |
+			      CPUID_EXTENDED_FEATURES_ADX );
+
+	cpuid ( CPUID_VENDOR_ID, 0, &eax, &ebx, &ecx, &edx );
+	if ( eax < CPUID_EXTENDED_FEATURES )
+		return 0;
+
+	cpuid ( CPUID_EXTENDED_FEATURES, 0, &eax, &ebx, &ecx, &edx );
+	return ( ( ebx & required ) == required );
+}
+
+/**
+ * Initialise big integer support
+ *
+ */
+static void bigint_adx_init ( void ) {
+
+	/* Do nothing unless the CPU supports MULX, ADCX and ADOX */
+	if ( ! bigint_adx_supported() ) {
+		DBG ( "BIGINT MULX/ADX not supported\n" );
+		return;
+	}
+
+	/* Replace generic multiply-and-add kernel */
+	DBG ( "BIGINT MULX/ADX enabled\n" );
+	bigint_multiply_add = bigint_multiply_add_adx;
+}
+
+/** Big integer initialisation function */
+struct init_fn bigint_adx_init_fn __init_fn ( INIT_NORMAL ) = {
+	.initialise = bigint_adx_init,
+};
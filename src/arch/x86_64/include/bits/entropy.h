@@ -9,4 +9,6 @@
 
 FILE_LICENCE ( GPL2_OR_LATER );
 
+#include <ipxe/rdrand.h>
+
 #endif /* _BITS_ENTROPY_H */
@@ -6,6 +6,8 @@
  * @{
  */
 
+#define ERRFILE_aesni		( ERRFILE_ARCH | ERRFILE_OTHER | 0x00000000 )
+
 /** @} */
 
 #endif /* _BITS_ERRFILE_H */
@@ -108,6 +108,9 @@ REQUIRE_OBJECT ( pxemenu );
 #ifdef PXE_STACK
 REQUIRE_OBJECT ( pxe_call );
 #endif
+#ifdef CACHEDHCP_EFI
+REQUIRE_OBJECT ( efi_cachedhcp );
+#endif
 
 /*
  * Drag in all requested download protocols
@@ -122,12 +125,30 @@ REQUIRE_OBJECT ( http );
 #ifdef DOWNLOAD_PROTO_HTTPS
 REQUIRE_OBJECT ( https );
 #endif
+#ifdef HTTP_ENC_GZIP
+REQUIRE_OBJECT ( httpgzip );
+#endif
 #ifdef DOWNLOAD_PROTO_FTP
 REQUIRE_OBJECT ( ftp );
 #endif
 #ifdef DOWNLOAD_PROTO_SLAM
 REQUIRE_OBJECT ( slam );
 #endif
+#ifdef DOWNLOAD_PROTO_MCAST
+REQUIRE_OBJECT ( mcast );
+REQUIRE_OBJECT ( slam );
+#endif
+
+/*
+ * Drag in accelerated cryptographic algorithms
+ *
+ */
+#ifdef CRYPTO_AESNI
+REQUIRE_OBJECT ( aesni );
+#endif
+#ifdef CRYPTO_SHANI
+REQUIRE_OBJECT ( shani );
+#endif
 
 /*
  * Drag in all requested SAN boot protocols
@@ -205,9 +226,27 @@ REQUIRE_OBJECT ( route_cmd );
 #ifdef IMAGE_CMD
 REQUIRE_OBJECT ( image_cmd );
 #endif
+#ifdef JOB_CMD
+REQUIRE_OBJECT ( job_cmd );
+#endif
 #ifdef IMAGE_TRUST_CMD
 REQUIRE_OBJECT ( image_trust_cmd );
 #endif
+#ifdef PROFSTAT_CMD
+REQUIRE_OBJECT ( profstat_cmd );
+#endif
+#ifdef CACHESTAT_CMD
+REQUIRE_OBJECT ( cachestat_cmd );
+#endif
+#ifdef PCAP_CMD
+REQUIRE_OBJECT ( pcap_cmd );
+#endif
+#ifdef TIMELINE_CMD
+REQUIRE_OBJECT ( timeline_cmd );
+#endif
+#ifdef TRACE_CMD
+REQUIRE_OBJECT ( trace_cmd );
+#endif
 #ifdef DHCP_CMD
 REQUIRE_OBJECT ( dhcp_cmd );
 #endif
@@ -232,9 +271,15 @@ REQUIRE_OBJECT ( pxe_cmd );
 #ifdef LOTEST_CMD
 REQUIRE_OBJECT ( lotest_cmd );
 #endif
+#ifdef NETBENCH_CMD
+REQUIRE_OBJECT ( netbench_cmd );
+#endif
 #ifdef VLAN_CMD
 REQUIRE_OBJECT ( vlan_cmd );
 #endif
+#ifdef BOND_CMD
+REQUIRE_OBJECT ( bond_cmd );
+#endif
 #ifdef REBOOT_CMD
 REQUIRE_OBJECT ( reboot_cmd );
 #endif
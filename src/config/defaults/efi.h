@@ -15,7 +15,7 @@
 #define NAP_EFIX86
 #define UMALLOC_EFI
 #define SMBIOS_EFI
-#define SANBOOT_NULL
+#define SANBOOT_EFI
 #define BOFM_EFI
 #define ENTROPY_NULL
 #define TIME_NULL
@@ -23,4 +23,9 @@
 #define	IMAGE_EFI		/* EFI image support */
 #define	IMAGE_SCRIPT		/* iPXE script image support */
 
+#define	CACHEDHCP_EFI		/* Reuse cached EFI PXE DHCPACK */
+
+#define	SANBOOT_PROTO_ISCSI	/* iSCSI protocol */
+#define	SANBOOT_PROTO_AOE	/* AoE protocol */
+
 #endif /* CONFIG_DEFAULTS_EFI_H */
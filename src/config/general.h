@@ -59,6 +59,139 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #undef	DOWNLOAD_PROTO_HTTPS	/* Secure Hypertext Transfer Protocol */
 #undef	DOWNLOAD_PROTO_FTP	/* File Transfer Protocol */
 #undef	DOWNLOAD_PROTO_SLAM	/* Scalable Local Area Multicast */
+#undef	DOWNLOAD_PROTO_MCAST	/* Multicast-first with unicast repair */
+#undef	DOWNLOAD_DIGEST		/* SHA-256 digest images while downloading */
+#undef	DOWNLOAD_ELF_STREAM	/* Load ELF segments while downloading */
+#undef	DOWNLOAD_LZ4		/* Decompress LZ4-compressed images */
+#undef	DOWNLOAD_CACHE		/* Reuse images already downloaded */
+#undef	DOWNLOAD_PREFETCH	/* Prefetch consecutive script downloads */
+
+/*
+ * TFTP window size
+ *
+ * Number of consecutive data blocks that a TFTP server may send
+ * before waiting for an acknowledgement (RFC 7440).  Set to one to
+ * disable the windowsize option and use strict lock-step transfers.
+ *
+ */
+#define TFTP_WINDOWSIZE		8	/* Requested TFTP window size */
+
+/*
+ * HTTP segmented downloads
+ *
+ * Large files served by a server that accepts range requests may be
+ * downloaded as several segments in parallel, each via a separate
+ * connection.  Set to one to disable segmented downloads.
+ *
+ */
+#define HTTP_SEGMENTS		1	/* Maximum number of parallel segments */
+
+/*
+ * FTP segmented downloads
+ *
+ * Large files served by an FTP server that supports the SIZE and
+ * REST commands may be downloaded as several segments in parallel,
+ * each via a separate control and data connection.  Set to one to
+ * disable segmented downloads.
+ *
+ */
+#define FTP_SEGMENTS		1	/* Maximum number of parallel segments */
+
+/*
+ * HTTP connection reuse
+ *
+ * Connections which remain usable after a download completes are
+ * retained for a short time, and reused by subsequent requests to the
+ * same server.  Set to zero to disable connection reuse.
+ *
+ */
+#define HTTP_POOL		4	/* Maximum number of idle connections */
+
+/*
+ * HTTP request pipelining
+ *
+ * Requests to a server which already has a connection carrying a
+ * download may be queued on that connection, rather than opening a
+ * new connection.  Set to zero to disable request pipelining.
+ *
+ */
+#define HTTP_PIPELINE		4	/* Maximum number of queued requests */
+
+/*
+ * TCP Fast Open
+ *
+ * Cookies issued by servers supporting TCP Fast Open (RFC 7413) are
+ * cached, and used to send the first data of subsequent connections
+ * which permit it (e.g. HTTP requests) within the SYN, saving a
+ * round trip.  Set to zero to disable TCP Fast Open.
+ *
+ */
+#define TCP_FASTOPEN		8	/* Maximum number of cached cookies */
+
+/*
+ * HTTP content encodings
+ *
+ * Servers may be permitted to send compressed content, which is
+ * decompressed transparently as it is received.
+ *
+ */
+#undef	HTTP_ENC_GZIP		/* gzip and deflate content encodings */
+
+/*
+ * DNS response caching
+ *
+ * Resolved names (and names which the DNS server reports as not
+ * existing) are cached for the time-to-live given by the DNS server.
+ * Set to zero to disable caching.
+ *
+ */
+#define DNS_CACHE		8	/* Maximum number of cached names */
+
+/*
+ * Connection racing
+ *
+ * When a name resolves to several addresses, connection attempts to
+ * each address are started in turn (alternating between address
+ * families, as per RFC 8305) at intervals of 250ms, and the first
+ * attempt to connect is used.  Set to one to use only the first
+ * resolved address.
+ *
+ */
+#define RESOLV_ADDRESSES	4	/* Maximum addresses used per name */
+
+/*
+ * Infiniband address caching
+ *
+ * IPoIB peer addresses and Infiniband path records are cached, and
+ * the least recently used entry is evicted when a cache is full.
+ * The IPoIB peer cache may hold at most 128 entries.
+ *
+ */
+#define IPOIB_PEER_CACHE	16	/* Number of cached IPoIB peers */
+#define IB_PATH_CACHE		16	/* Number of cached paths */
+
+/*
+ * Automatic booting
+ *
+ * DHCP may be performed on all network devices concurrently, booting
+ * from whichever network device is configured first.  Set to zero to
+ * attempt each network device in turn.
+ *
+ */
+#define AUTOBOOT_PARALLEL_DHCP	0	/* Perform DHCP concurrently */
+
+/*
+ * Lazy device probing
+ *
+ * If the boot device is known (e.g. the device from which a ROM or
+ * PXE image was loaded), it may be probed before all other devices,
+ * allowing DHCP to start without waiting for other devices to
+ * initialise.  Other devices are then probed in the background, or
+ * before they are first needed.  Set to zero to probe all devices
+ * at startup.
+ *
+ */
+#define AUTOBOOT_LAZY_PROBE	0	/* Probe boot device first */
 
 /*
  * SAN boot protocols
@@ -70,6 +203,16 @@ FILE_LICENCE ( GPL2_OR_LATER );
 //#undef	SANBOOT_PROTO_IB_SRP	/* Infiniband SCSI RDMA protocol */
 //#undef	SANBOOT_PROTO_FCP	/* Fibre Channel protocol */
 
+/*
+ * SAN boot read-ahead cache
+ *
+ * Small reads from a SAN-booted drive are expanded to fill an entire
+ * extent.  Set SANBOOT_CACHE_EXTENTS to zero to disable the cache.
+ *
+ */
+#define SANBOOT_CACHE_EXTENTS	16	/* Number of cached extents */
+#define SANBOOT_CACHE_EXTENT_LEN ( 64 * 1024 ) /* Length of each extent */
+
 /*
  * 802.11 cryptosystems and handshaking protocols
  *
@@ -78,6 +221,13 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #define	CRYPTO_80211_WPA	/* WPA Personal, authenticating with passphrase */
 #define	CRYPTO_80211_WPA2	/* Add support for stronger WPA cryptography */
 
+/*
+ * Accelerated cryptographic algorithms
+ *
+ */
+#undef	CRYPTO_AESNI		/* AES-NI accelerated AES (x86_64 only) */
+#undef	CRYPTO_SHANI		/* SHA extensions accelerated SHA (x86_64 only) */
+
 /*
  * Name resolution modules
  *
@@ -101,6 +251,17 @@ FILE_LICENCE ( GPL2_OR_LATER );
 //#define	IMAGE_COMBOOT		/* SYSLINUX COMBOOT image support */
 //#define	IMAGE_EFI		/* EFI image support */
 
+/*
+ * Embedded image options
+ *
+ * Embedded images (specified via EMBED=...) with a ".gz" extension
+ * may be stored gzip-compressed within the binary, and decompressed
+ * into external memory when iPXE starts up.  This reduces the size of
+ * binaries which are not otherwise compressed (e.g. EFI binaries).
+ *
+ */
+#undef	EMBED_GZIP		/* gzip-compressed embedded images */
+
 /*
  * Command-line commands to include
  *
@@ -113,6 +274,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #define FCMGMT_CMD		/* Fibre Channel management commands */
 #define	ROUTE_CMD		/* Routing table management commands */
 #define IMAGE_CMD		/* Image management commands */
+#define JOB_CMD			/* Background job commands */
 #define DHCP_CMD		/* DHCP management commands */
 #define SANBOOT_CMD		/* SAN boot commands */
 #define MENU_CMD		/* Menu commands */
@@ -120,10 +282,17 @@ FILE_LICENCE ( GPL2_OR_LATER );
 //#define TIME_CMD		/* Time commands */
 //#define DIGEST_CMD		/* Image crypto digest commands */
 //#define LOTEST_CMD		/* Loopback testing commands */
+//#define NETBENCH_CMD		/* Download benchmarking commands */
 //#define VLAN_CMD		/* VLAN commands */
+//#define BOND_CMD		/* Link aggregation commands */
 //#define PXE_CMD		/* PXE commands */
 //#define REBOOT_CMD		/* Reboot command */
 //#define IMAGE_TRUST_CMD	/* Image trust management commands */
+//#define PROFSTAT_CMD		/* Profiling statistics commands */
+//#define CACHESTAT_CMD		/* Cache statistics commands */
+//#define PCAP_CMD		/* Packet capture commands */
+//#define TIMELINE_CMD		/* Boot timeline commands */
+//#define TRACE_CMD		/* Runtime trace commands */
 
 /*
  * ROM-specific options
@@ -145,6 +314,16 @@ FILE_LICENCE ( GPL2_OR_LATER );
  */
 
 #define	NETDEV_DISCARD_RATE 0	/* Drop every N packets (0=>no drop) */
+#define	NETDEV_RX_BUDGET 16	/* Max RX packets processed per netdev
+				 * per poll */
+#define	NETDEV_RX_RING_SIZE 64	/* Preferred RX descriptor ring size
+				 * (a power of two) */
+#define	NETDEV_RX_RING_MEM 8	/* Max RX ring buffer memory, as a
+				 * fraction (1/N) of free memory */
+#define	NETDEV_RX_COALESCE_LEN 16384 /* Max length of coalesced RX
+				 * packets (0=>no coalescing) */
+#undef	NETDEV_FASTPATH_ETHERNET /* Call Ethernet link-layer methods
+				 * directly (for Ethernet-only builds) */
 #undef	BUILD_SERIAL		/* Include an automatic build serial
 				 * number.  Add "bs" to the list of
 				 * make targets.  For example:
@@ -13,6 +13,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 
 //#undef	PCIAPI_PCBIOS		/* Access via PCI BIOS */
 //#define	PCIAPI_DIRECT		/* Direct access via Type 1 accesses */
+//#define	PCIAPI_ECAM		/* Access via PCIe enhanced configuration */
 
 #include <config/local/ioapi.h>
 
@@ -19,6 +19,8 @@
 FILE_LICENCE ( GPL2_OR_LATER );
 
 #include <errno.h>
+#include <byteswap.h>
+#include <ipxe/uaccess.h>
 #include <ipxe/acpi.h>
 #include <ipxe/interface.h>
 
@@ -50,6 +52,96 @@ void acpi_fix_checksum ( struct acpi_description_header *acpi ) {
 	acpi->checksum -= sum;
 }
 
+/**
+ * Calculate checksum of ACPI table in user memory
+ *
+ * @v table		ACPI table
+ * @ret sum		Sum of all bytes (zero for a valid table)
+ */
+static uint8_t acpi_checksum ( userptr_t table ) {
+	struct acpi_description_header acpi;
+	uint8_t buf[64];
+	size_t offset;
+	size_t len;
+	size_t frag_len;
+	unsigned int i;
+	uint8_t sum = 0;
+
+	copy_from_user ( &acpi, table, 0, sizeof ( acpi ) );
+	len = le32_to_cpu ( acpi.length );
+	for ( offset = 0 ; offset < len ; offset += frag_len ) {
+		frag_len = ( len - offset );
+		if ( frag_len > sizeof ( buf ) )
+			frag_len = sizeof ( buf );
+		copy_from_user ( buf, table, offset, frag_len );
+		for ( i = 0 ; i < frag_len ; i++ )
+			sum += buf[i];
+	}
+	return sum;
+}
+
+/**
+ * Locate ACPI table
+ *
+ * @v rsdt		ACPI root system description table
+ * @v signature		Requested table signature
+ * @v index		Requested index of table with this signature
+ * @ret table		Table, or UNULL if not found
+ */
+userptr_t acpi_find ( userptr_t rsdt, uint32_t signature,
+		      unsigned int index ) {
+	struct acpi_description_header acpi;
+	userptr_t table;
+	uint32_t entry;
+	size_t len;
+	unsigned int count;
+	unsigned int i;
+
+	/* Read and verify RSDT header */
+	copy_from_user ( &acpi, rsdt, 0, sizeof ( acpi ) );
+	if ( acpi.signature != cpu_to_le32 ( RSDT_SIGNATURE ) ) {
+		DBG ( "ACPI RSDT %#08lx has invalid signature\n",
+		      user_to_phys ( rsdt, 0 ) );
+		return UNULL;
+	}
+	len = le32_to_cpu ( acpi.length );
+	if ( len < sizeof ( acpi ) ) {
+		DBG ( "ACPI RSDT %#08lx has invalid length\n",
+		      user_to_phys ( rsdt, 0 ) );
+		return UNULL;
+	}
+	count = ( ( len - sizeof ( acpi ) ) / sizeof ( entry ) );
+
+	/* Search through entries */
+	for ( i = 0 ; i < count ; i++ ) {
+
+		/* Read table header */
+		copy_from_user ( &entry, rsdt,
+				 ( sizeof ( acpi ) + ( i * sizeof ( entry ) ) ),
+				 sizeof ( entry ) );
+		table = phys_to_user ( le32_to_cpu ( entry ) );
+		copy_from_user ( &acpi, table, 0, sizeof ( acpi ) );
+
+		/* Check table signature and index */
+		if ( acpi.signature != cpu_to_le32 ( signature ) )
+			continue;
+		if ( index-- )
+			continue;
+
+		/* Check table checksum */
+		if ( acpi_checksum ( table ) != 0 ) {
+			DBG ( "ACPI table %#08lx has bad checksum\n",
+			      user_to_phys ( table, 0 ) );
+			return UNULL;
+		}
+
+		DBG ( "ACPI found table %#08lx\n", user_to_phys ( table, 0 ) );
+		return table;
+	}
+
+	return UNULL;
+}
+
 /******************************************************************************
  *
  * Interface methods
@@ -79,6 +79,33 @@ int bitmap_test ( struct bitmap *bitmap, unsigned int bit ) {
 	return ( ( bitmap->blocks[index] & mask ) != 0 );
 }
 
+/**
+ * Find next gap in bitmap
+ *
+ * @v bitmap		Bitmap
+ * @v bit		Bit index at which to start searching
+ * @ret gap		Index of next unset bit, or bitmap length if none
+ *
+ * Completely full blocks are skipped without testing individual
+ * bits.
+ */
+unsigned int bitmap_next_gap ( struct bitmap *bitmap, unsigned int bit ) {
+	unsigned int index;
+
+	while ( bit < bitmap->length ) {
+		index = BITMAP_INDEX ( bit );
+		if ( ( ( bit % BITMAP_BLKSIZE ) == 0 ) &&
+		     ( bitmap->blocks[index] == ~( ( bitmap_block_t ) 0 ) ) ) {
+			bit += BITMAP_BLKSIZE;
+			continue;
+		}
+		if ( ! ( bitmap->blocks[index] & BITMAP_MASK ( bit ) ) )
+			return bit;
+		bit++;
+	}
+	return bitmap->length;
+}
+
 /**
  * Set bit in bitmap
  *
@@ -95,7 +122,5 @@ void bitmap_set ( struct bitmap *bitmap, unsigned int bit ) {
 	bitmap->blocks[index] |= mask;
 
 	/* Update first gap counter */
-	while ( bitmap_test ( bitmap, bitmap->first_gap ) ) {
-		bitmap->first_gap++;
-	}
+	bitmap->first_gap = bitmap_next_gap ( bitmap, bitmap->first_gap );
 }
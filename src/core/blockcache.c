@@ -0,0 +1,248 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <ipxe/list.h>
+#include <ipxe/uaccess.h>
+#include <ipxe/umalloc.h>
+#include <ipxe/blockcache.h>
+
+/** @file
+ *
+ * Block device read-ahead cache
+ *
+ * Boot loaders tend to issue many small sequential reads.  Each read
+ * that misses the cache is expanded to fill an entire (aligned)
+ * extent, so that subsequent reads may be satisfied without any
+ * further access to the underlying block device.  Extents are
+ * replaced in least-recently-used order.
+ */
+
+/**
+ * Allocate block cache
+ *
+ * @v cache		Block cache
+ * @v blksize		Block size
+ * @v blocks		Total number of blocks in underlying device
+ * @v extent_len	Length of each extent
+ * @v num_extents	Number of extents
+ * @ret rc		Return status code
+ *
+ * If the extent length is smaller than the block size, or the number
+ * of extents is zero, then the cache will be disabled and all reads
+ * will be passed directly to the underlying block device.
+ */
+int block_cache_alloc ( struct block_cache *cache, size_t blksize,
+			uint64_t blocks, size_t extent_len,
+			unsigned int num_extents ) {
+	struct block_cache_extent *extent;
+	unsigned int i;
+
+	/* Free any existing cache */
+	block_cache_free ( cache );
+
+	/* Record parameters */
+	cache->blksize = blksize;
+	cache->blocks = blocks;
+	cache->count = ( extent_len / blksize );
+	if ( ! ( cache->count && num_extents ) )
+		return 0;
+	extent_len = ( cache->count * blksize );
+
+	/* Allocate extents */
+	cache->extent = zalloc ( num_extents * sizeof ( cache->extent[0] ) );
+	if ( ! cache->extent )
+		goto err_zalloc;
+	cache->data = umalloc ( num_extents * extent_len );
+	if ( ! cache->data )
+		goto err_umalloc;
+
+	/* Initialise extents */
+	for ( i = 0 ; i < num_extents ; i++ ) {
+		extent = &cache->extent[i];
+		extent->data = userptr_add ( cache->data, ( i * extent_len ) );
+		list_add_tail ( &extent->list, &cache->extents );
+	}
+
+	return 0;
+
+ err_umalloc:
+	free ( cache->extent );
+	cache->extent = NULL;
+ err_zalloc:
+	return -ENOMEM;
+}
+
+/**
+ * Free block cache
+ *
+ * @v cache		Block cache
+ *
+ * The cache will be disabled, and all reads will be passed directly
+ * to the underlying block device.
+ */
+void block_cache_free ( struct block_cache *cache ) {
+
+	INIT_LIST_HEAD ( &cache->extents );
+	ufree ( cache->data );
+	cache->data = UNULL;
+	free ( cache->extent );
+	cache->extent = NULL;
+}
+
+/**
+ * Invalidate cached blocks
+ *
+ * @v cache		Block cache
+ * @v lba		Starting logical block address
+ * @v count		Number of logical blocks
+ *
+ * This must be called whenever blocks are written to the underlying
+ * block device.
+ */
+void block_cache_invalidate ( struct block_cache *cache, uint64_t lba,
+			      unsigned int count ) {
+	struct block_cache_extent *extent;
+
+	list_for_each_entry ( extent, &cache->extents, list ) {
+		if ( ( extent->count != 0 ) &&
+		     ( lba < ( extent->lba + extent->count ) ) &&
+		     ( extent->lba < ( lba + count ) ) ) {
+			extent->count = 0;
+		}
+	}
+}
+
+/**
+ * Find cached extent
+ *
+ * @v cache		Block cache
+ * @v lba		Starting logical block address of extent
+ * @ret extent		Extent, or NULL if not cached
+ */
+static struct block_cache_extent *
+block_cache_find ( struct block_cache *cache, uint64_t lba ) {
+	struct block_cache_extent *extent;
+
+	list_for_each_entry ( extent, &cache->extents, list ) {
+		if ( ( extent->count != 0 ) && ( extent->lba == lba ) )
+			return extent;
+	}
+	return NULL;
+}
+
+/**
+ * Fill extent from underlying block device
+ *
+ * @v cache		Block cache
+ * @v lba		Starting logical block address of extent
+ * @ret extent		Extent
+ * @ret rc		Return status code
+ *
+ * The least recently used extent will be replaced.
+ */
+static int block_cache_fill ( struct block_cache *cache, uint64_t lba,
+			      struct block_cache_extent **extent ) {
+	unsigned int count;
+	int rc;
+
+	/* Reuse least recently used extent */
+	*extent = list_entry ( cache->extents.prev, struct block_cache_extent,
+			       list );
+	(*extent)->count = 0;
+
+	/* Read as much of the extent as lies within the device */
+	count = cache->count;
+	if ( count > ( cache->blocks - lba ) )
+		count = ( cache->blocks - lba );
+	if ( ( rc = cache->read ( cache, lba, count,
+				  (*extent)->data ) ) != 0 )
+		return rc;
+	(*extent)->lba = lba;
+	(*extent)->count = count;
+
+	return 0;
+}
+
+/**
+ * Read from block device via cache
+ *
+ * @v cache		Block cache
+ * @v lba		Starting logical block address
+ * @v count		Number of logical blocks
+ * @v buffer		Data buffer
+ * @ret rc		Return status code
+ */
+int block_cache_read ( struct block_cache *cache, uint64_t lba,
+		       unsigned int count, userptr_t buffer ) {
+	struct block_cache_extent *extent;
+	uint64_t extent_lba;
+	unsigned int offset;
+	unsigned int frag_count;
+	size_t frag_len;
+	int rc;
+
+	/* Bypass cache if disabled, or for reads large enough not to
+	 * benefit from read-ahead.  Such reads are delivered straight
+	 * into the caller's buffer, avoiding a copy via the cache.
+	 */
+	if ( ( ! cache->extent ) || ( count >= cache->count ) )
+		return cache->read ( cache, lba, count, buffer );
+
+	while ( count ) {
+
+		/* Leave the underlying device to report any attempt
+		 * to read beyond the end of the device.
+		 */
+		if ( lba >= cache->blocks )
+			return cache->read ( cache, lba, count, buffer );
+
+		/* Find or fill extent containing this block */
+		extent_lba = ( lba - ( lba % cache->count ) );
+		extent = block_cache_find ( cache, extent_lba );
+		if ( ( ! extent ) &&
+		     ( ( rc = block_cache_fill ( cache, extent_lba,
+						 &extent ) ) != 0 ) )
+			return rc;
+
+		/* Mark extent as most recently used */
+		list_del ( &extent->list );
+		list_add ( &extent->list, &cache->extents );
+
+		/* Copy out cached data */
+		offset = ( lba - extent->lba );
+		frag_count = ( extent->count - offset );
+		if ( frag_count > count )
+			frag_count = count;
+		frag_len = ( frag_count * cache->blksize );
+		memcpy_user ( buffer, 0, extent->data,
+			      ( offset * cache->blksize ), frag_len );
+
+		/* Move to next fragment */
+		lba += frag_count;
+		count -= frag_count;
+		buffer = userptr_add ( buffer, frag_len );
+	}
+
+	return 0;
+}
@@ -0,0 +1,275 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <byteswap.h>
+#include <ipxe/timer.h>
+#include <ipxe/settings.h>
+#include <ipxe/blockstat.h>
+
+/** @file
+ *
+ * Block device statistics
+ *
+ * Statistics are gathered for each registered block device (such as
+ * an emulated SAN drive), and are exposed via a settings block named
+ * after the device.
+ */
+
+/** List of block device statistics */
+LIST_HEAD ( block_stats );
+
+/** Number of commands setting */
+struct setting blk_commands_setting __setting ( SETTING_SANBOOT_EXTRA ) = {
+	.name = "blk-commands",
+	.description = "Block device commands issued",
+	.type = &setting_type_uint32,
+};
+
+/** Number of failed commands setting */
+struct setting blk_errors_setting __setting ( SETTING_SANBOOT_EXTRA ) = {
+	.name = "blk-errors",
+	.description = "Block device commands failed",
+	.type = &setting_type_uint32,
+};
+
+/** Number of retried commands setting */
+struct setting blk_retries_setting __setting ( SETTING_SANBOOT_EXTRA ) = {
+	.name = "blk-retries",
+	.description = "Block device commands retried",
+	.type = &setting_type_uint32,
+};
+
+/** Number of timed out commands setting */
+struct setting blk_timeouts_setting __setting ( SETTING_SANBOOT_EXTRA ) = {
+	.name = "blk-timeouts",
+	.description = "Block device commands timed out",
+	.type = &setting_type_uint32,
+};
+
+/** Data read setting */
+struct setting blk_read_kb_setting __setting ( SETTING_SANBOOT_EXTRA ) = {
+	.name = "blk-read-kb",
+	.description = "Block device data read (kB)",
+	.type = &setting_type_uint32,
+};
+
+/** Data written setting */
+struct setting blk_write_kb_setting __setting ( SETTING_SANBOOT_EXTRA ) = {
+	.name = "blk-write-kb",
+	.description = "Block device data written (kB)",
+	.type = &setting_type_uint32,
+};
+
+/** Average latency setting */
+struct setting blk_latency_setting __setting ( SETTING_SANBOOT_EXTRA ) = {
+	.name = "blk-latency",
+	.description = "Block device average latency (us)",
+	.type = &setting_type_uint32,
+};
+
+/**
+ * Get upper bound of latency histogram bucket
+ *
+ * @v bucket		Bucket index
+ * @ret max		Upper bound (in microseconds), or 0 if unbounded
+ */
+unsigned long block_stats_latency_max ( unsigned int bucket ) {
+
+	if ( bucket >= ( BLOCK_STATS_LATENCY_BUCKETS - 1 ) )
+		return 0;
+	return ( BLOCK_STATS_LATENCY_MIN_US << bucket );
+}
+
+/**
+ * Record completed block device command
+ *
+ * @v stats		Block device statistics
+ * @v elapsed		Time taken (in ticks)
+ * @v len		Length of data transferred
+ * @v is_write		Command was a write
+ * @v rc		Command status
+ */
+void block_stats_done ( struct block_device_stats *stats,
+			unsigned long elapsed, size_t len, int is_write,
+			int rc ) {
+	unsigned long latency;
+	unsigned int bucket;
+
+	/* Record failures */
+	if ( rc != 0 ) {
+		stats->errors++;
+		return;
+	}
+
+	/* Record data transferred */
+	if ( is_write ) {
+		stats->write_len += len;
+	} else {
+		stats->read_len += len;
+	}
+
+	/* Record latency */
+	latency = ( ( ( uint64_t ) elapsed * 1000000 ) / TICKS_PER_SEC );
+	stats->latency_total += latency;
+	for ( bucket = 0 ; block_stats_latency_max ( bucket ) ; bucket++ ) {
+		if ( latency < block_stats_latency_max ( bucket ) )
+			break;
+	}
+	stats->latency[bucket]++;
+}
+
+/**
+ * Calculate average latency of completed commands
+ *
+ * @v stats		Block device statistics
+ * @ret latency		Average latency (in microseconds)
+ */
+static unsigned long
+block_stats_latency ( struct block_device_stats *stats ) {
+	unsigned int completed = 0;
+	unsigned int i;
+
+	for ( i = 0 ; i < BLOCK_STATS_LATENCY_BUCKETS ; i++ )
+		completed += stats->latency[i];
+	if ( ! completed )
+		return 0;
+	return ( stats->latency_total / completed );
+}
+
+/**
+ * Get value of block device statistics setting
+ *
+ * @v stats		Block device statistics
+ * @v setting		Setting
+ * @v value		Value to fill in
+ * @ret rc		Return status code
+ */
+static int block_stats_value ( struct block_device_stats *stats,
+			       struct setting *setting, uint32_t *value ) {
+
+	if ( setting_cmp ( setting, &blk_commands_setting ) == 0 ) {
+		*value = stats->commands;
+	} else if ( setting_cmp ( setting, &blk_errors_setting ) == 0 ) {
+		*value = stats->errors;
+	} else if ( setting_cmp ( setting, &blk_retries_setting ) == 0 ) {
+		*value = stats->retries;
+	} else if ( setting_cmp ( setting, &blk_timeouts_setting ) == 0 ) {
+		*value = stats->timeouts;
+	} else if ( setting_cmp ( setting, &blk_read_kb_setting ) == 0 ) {
+		*value = ( stats->read_len / 1024 );
+	} else if ( setting_cmp ( setting, &blk_write_kb_setting ) == 0 ) {
+		*value = ( stats->write_len / 1024 );
+	} else if ( setting_cmp ( setting, &blk_latency_setting ) == 0 ) {
+		*value = block_stats_latency ( stats );
+	} else {
+		return -ENOENT;
+	}
+	return 0;
+}
+
+/**
+ * Check applicability of block device statistics setting
+ *
+ * @v settings		Settings block
+ * @v setting		Setting
+ * @ret applies		Setting applies within this settings block
+ */
+static int block_stats_applies ( struct settings *settings,
+				 struct setting *setting ) {
+	struct block_device_stats *stats =
+		container_of ( settings, struct block_device_stats, settings );
+	uint32_t value;
+
+	return ( block_stats_value ( stats, setting, &value ) == 0 );
+}
+
+/**
+ * Fetch value of block device statistics setting
+ *
+ * @v settings		Settings block
+ * @v setting		Setting to fetch
+ * @v data		Buffer to fill with setting data
+ * @v len		Length of buffer
+ * @ret len		Length of setting data, or negative error
+ */
+static int block_stats_fetch ( struct settings *settings,
+			       struct setting *setting,
+			       void *data, size_t len ) {
+	struct block_device_stats *stats =
+		container_of ( settings, struct block_device_stats, settings );
+	uint32_t value;
+	int rc;
+
+	/* Get value */
+	if ( ( rc = block_stats_value ( stats, setting, &value ) ) != 0 )
+		return rc;
+
+	/* Copy out value */
+	value = htonl ( value );
+	if ( len > sizeof ( value ) )
+		len = sizeof ( value );
+	memcpy ( data, &value, len );
+	return sizeof ( value );
+}
+
+/** Block device statistics settings operations */
+struct settings_operations block_stats_settings_operations = {
+	.applies = block_stats_applies,
+	.fetch = block_stats_fetch,
+};
+
+/**
+ * Register block device statistics
+ *
+ * @v stats		Block device statistics
+ * @v name		Name
+ * @ret rc		Return status code
+ */
+int block_stats_register ( struct block_device_stats *stats,
+			   const char *name ) {
+	int rc;
+
+	/* Register settings block */
+	snprintf ( stats->name, sizeof ( stats->name ), "%s", name );
+	if ( ( rc = register_settings ( &stats->settings, NULL,
+					stats->name ) ) != 0 )
+		return rc;
+
+	/* Add to list of block device statistics */
+	list_add_tail ( &stats->list, &block_stats );
+
+	return 0;
+}
+
+/**
+ * Unregister block device statistics
+ *
+ * @v stats		Block device statistics
+ */
+void block_stats_unregister ( struct block_device_stats *stats ) {
+
+	list_del ( &stats->list );
+	unregister_settings ( &stats->settings );
+}
@@ -10,6 +10,77 @@ FILE_LICENCE ( GPL2_OR_LATER );
 /** Current console usage */
 int console_usage = CONSOLE_USAGE_STDOUT;
 
+/** Length of console output buffer */
+#define CONSOLE_BUFSIZE 128
+
+/** Console output buffer */
+static char console_buf[CONSOLE_BUFSIZE];
+
+/** Used length of console output buffer */
+static size_t console_buf_len;
+
+/**
+ * Flush console output buffer
+ *
+ * Any buffered characters are written out to all enabled console
+ * devices, using each device's console_driver::write() method if
+ * present, or its console_driver::putchar() method otherwise.
+ */
+void console_flush ( void ) {
+	struct console_driver *console;
+	size_t len = console_buf_len;
+	size_t i;
+
+	/* Do nothing unless output has been buffered */
+	if ( ! len )
+		return;
+	console_buf_len = 0;
+
+	for_each_table_entry ( console, CONSOLES ) {
+		if ( console->disabled || ! ( console_usage & console->usage ) )
+			continue;
+		if ( console->write ) {
+			console->write ( console_buf, len );
+		} else if ( console->putchar ) {
+			for ( i = 0 ; i < len ; i++ )
+				console->putchar ( console_buf[i] );
+		}
+	}
+}
+
+/**
+ * Write characters to each console device
+ *
+ * @v data		Characters to be written
+ * @v len		Number of characters
+ *
+ * Output is buffered while a text-based user interface is active (so
+ * that screen redraws can reach each console in large pieces), and
+ * flushed before any check for input.  Otherwise, output is flushed
+ * immediately.
+ */
+void console_write ( const char *data, size_t len ) {
+	char character;
+
+	while ( len-- ) {
+		character = *(data++);
+
+		/* Automatic LF -> CR,LF translation */
+		if ( character == '\n' ) {
+			console_buf[ console_buf_len++ ] = '\r';
+			if ( console_buf_len == sizeof ( console_buf ) )
+				console_flush();
+		}
+
+		console_buf[ console_buf_len++ ] = character;
+		if ( console_buf_len == sizeof ( console_buf ) )
+			console_flush();
+	}
+
+	if ( console_usage != CONSOLE_USAGE_TUI )
+		console_flush();
+}
+
 /**
  * Write a single character to each console device.
  *
@@ -17,23 +88,14 @@ int console_usage = CONSOLE_USAGE_STDOUT;
  * @ret None		-
  * @err None		-
  *
- * The character is written out to all enabled console devices, using
- * each device's console_driver::putchar() method.
+ * The character is written out to all enabled console devices, as
+ * for console_write().
  *
  */
 void putchar ( int character ) {
-	struct console_driver *console;
-
-	/* Automatic LF -> CR,LF translation */
-	if ( character == '\n' )
-		putchar ( '\r' );
+	char tmp = character;
 
-	for_each_table_entry ( console, CONSOLES ) {
-		if ( ( ! console->disabled ) &&
-		     ( console_usage & console->usage ) &&
-		     console->putchar )
-			console->putchar ( character );
-	}
+	console_write ( &tmp, sizeof ( tmp ) );
 }
 
 /**
@@ -52,6 +114,9 @@ void putchar ( int character ) {
 static struct console_driver * has_input ( void ) {
 	struct console_driver *console;
 
+	/* Ensure that any buffered output is visible */
+	console_flush();
+
 	for_each_table_entry ( console, CONSOLES ) {
 		if ( ( ! console->disabled ) && console->iskey ) {
 			if ( console->iskey () )
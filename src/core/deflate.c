@@ -0,0 +1,827 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <ipxe/crc32.h>
+#include <ipxe/deflate.h>
+
+/** @file
+ *
+ * DEFLATE decompression algorithm
+ *
+ * This is a streaming decompressor: compressed data may be supplied
+ * in arbitrarily-sized chunks, and decompressed data is produced into
+ * an arbitrarily-sized output buffer.  Each Huffman code (along with
+ * any extra bits) is consumed only once it is available in its
+ * entirety, so that decompression may be suspended at any point.
+ */
+
+/* Disambiguate the various error causes */
+#define EINVAL_HEADER __einfo_error ( EINFO_EINVAL_HEADER )
+#define EINFO_EINVAL_HEADER \
+	__einfo_uniqify ( EINFO_EINVAL, 0x01, "Invalid header" )
+#define EINVAL_BLOCK __einfo_error ( EINFO_EINVAL_BLOCK )
+#define EINFO_EINVAL_BLOCK \
+	__einfo_uniqify ( EINFO_EINVAL, 0x02, "Invalid block type" )
+#define EINVAL_STORED __einfo_error ( EINFO_EINVAL_STORED )
+#define EINFO_EINVAL_STORED \
+	__einfo_uniqify ( EINFO_EINVAL, 0x03, "Invalid stored block length" )
+#define EINVAL_HUFFMAN __einfo_error ( EINFO_EINVAL_HUFFMAN )
+#define EINFO_EINVAL_HUFFMAN \
+	__einfo_uniqify ( EINFO_EINVAL, 0x04, "Invalid Huffman code" )
+#define EINVAL_DISTANCE __einfo_error ( EINFO_EINVAL_DISTANCE )
+#define EINFO_EINVAL_DISTANCE \
+	__einfo_uniqify ( EINFO_EINVAL, 0x05, "Invalid back-reference" )
+#define EIO_CHECKSUM __einfo_error ( EINFO_EIO_CHECKSUM )
+#define EINFO_EIO_CHECKSUM \
+	__einfo_uniqify ( EINFO_EIO, 0x01, "Checksum mismatch" )
+
+/** Result of a single decompression step */
+enum deflate_step_result {
+	/** Progress was made */
+	DEFLATE_CONTINUE = 0,
+	/** No progress can be made without more input or output space */
+	DEFLATE_BLOCKED = 1,
+};
+
+/** GZIP header flags */
+enum deflate_gzip_flags {
+	/** Header CRC is present */
+	DEFLATE_GZIP_FHCRC = 0x02,
+	/** Extra fields are present */
+	DEFLATE_GZIP_FEXTRA = 0x04,
+	/** Original file name is present */
+	DEFLATE_GZIP_FNAME = 0x08,
+	/** File comment is present */
+	DEFLATE_GZIP_FCOMMENT = 0x10,
+	/** Reserved flags */
+	DEFLATE_GZIP_RESERVED = 0xe0,
+};
+
+/** Length of GZIP header */
+#define DEFLATE_GZIP_HEADER_LEN 10
+
+/** Length of GZIP footer */
+#define DEFLATE_GZIP_FOOTER_LEN 8
+
+/** Length of ZLIB header */
+#define DEFLATE_ZLIB_HEADER_LEN 2
+
+/** Length of ZLIB footer */
+#define DEFLATE_ZLIB_FOOTER_LEN 4
+
+/** ADLER32 modulus */
+#define DEFLATE_ADLER32_MOD 65521
+
+/** Maximum number of bytes which may be summed before reducing an
+ * ADLER32 checksum (avoiding overflow)
+ */
+#define DEFLATE_ADLER32_NMAX 5552
+
+/** Number of literal/length symbols in the fixed Huffman alphabet */
+#define DEFLATE_FIXED_LITLEN 288
+
+/** Number of distance symbols in the fixed Huffman alphabet */
+#define DEFLATE_FIXED_DISTANCE 30
+
+/** End-of-block symbol */
+#define DEFLATE_END_OF_BLOCK 256
+
+/** Order in which code length code lengths are transmitted */
+static const uint8_t deflate_codelen_order[19] = {
+	16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+/** Base lengths for length symbols 257-285 */
+static const uint16_t deflate_length_base[29] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+/** Extra bits for length symbols 257-285 */
+static const uint8_t deflate_length_extra[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+/** Base distances for distance symbols 0-29 */
+static const uint16_t deflate_distance_base[30] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+	8193, 12289, 16385, 24577
+};
+
+/** Extra bits for distance symbols 0-29 */
+static const uint8_t deflate_distance_extra[30] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+/**
+ * Construct Huffman alphabet
+ *
+ * @v huffman		Huffman alphabet to fill in
+ * @v lengths		Code lengths
+ * @v count		Number of symbols
+ * @ret rc		Return status code
+ *
+ * Incomplete codes are permitted (and will fail only if an unused
+ * code is encountered), but over-subscribed codes are rejected.
+ */
+static int deflate_huffman ( struct deflate_huffman *huffman,
+			     const uint8_t *lengths, unsigned int count ) {
+	uint16_t offsets[ DEFLATE_HUFFMAN_BITS + 1 ];
+	unsigned int symbol;
+	unsigned int len;
+	int left;
+
+	/* Count number of codes of each length */
+	memset ( huffman->count, 0, sizeof ( huffman->count ) );
+	for ( symbol = 0 ; symbol < count ; symbol++ )
+		huffman->count[ lengths[symbol] ]++;
+
+	/* Check that code is not over-subscribed */
+	left = 1;
+	for ( len = 1 ; len <= DEFLATE_HUFFMAN_BITS ; len++ ) {
+		left <<= 1;
+		left -= huffman->count[len];
+		if ( left < 0 )
+			return -EINVAL_HUFFMAN;
+	}
+
+	/* Sort symbols into canonical code order */
+	offsets[1] = 0;
+	for ( len = 1 ; len < DEFLATE_HUFFMAN_BITS ; len++ )
+		offsets[ len + 1 ] = ( offsets[len] + huffman->count[len] );
+	for ( symbol = 0 ; symbol < count ; symbol++ ) {
+		len = lengths[symbol];
+		if ( len )
+			huffman->symbol[ offsets[len]++ ] = symbol;
+	}
+
+	return 0;
+}
+
+/**
+ * Decode Huffman code from bit buffer without consuming it
+ *
+ * @v deflate		Decompressor
+ * @v huffman		Huffman alphabet
+ * @v symbol		Symbol to fill in
+ * @v len		Code length to fill in
+ * @ret rc		Return status code, or DEFLATE_BLOCKED
+ */
+static int deflate_decode ( struct deflate *deflate,
+			    struct deflate_huffman *huffman,
+			    unsigned int *symbol, unsigned int *len ) {
+	uint32_t bits = deflate->bits;
+	int code = 0;
+	int first = 0;
+	int index = 0;
+	int count;
+	unsigned int i;
+
+	for ( i = 1 ; i <= DEFLATE_HUFFMAN_BITS ; i++ ) {
+		if ( i > deflate->bits_len )
+			return DEFLATE_BLOCKED;
+		code |= ( bits & 1 );
+		bits >>= 1;
+		count = huffman->count[i];
+		if ( ( code - count ) < first ) {
+			*symbol = huffman->symbol[ index + ( code - first ) ];
+			*len = i;
+			return 0;
+		}
+		index += count;
+		first += count;
+		first <<= 1;
+		code <<= 1;
+	}
+
+	DBGC ( deflate, "DEFLATE %p invalid Huffman code\n", deflate );
+	return -EINVAL_HUFFMAN;
+}
+
+/**
+ * Peek at bits from bit buffer
+ *
+ * @v deflate		Decompressor
+ * @v offset		Offset within bit buffer
+ * @v len		Number of bits
+ * @ret value		Value
+ */
+static inline unsigned int deflate_peek ( struct deflate *deflate,
+					  unsigned int offset,
+					  unsigned int len ) {
+	return ( ( deflate->bits >> offset ) & ( ( 1UL << len ) - 1 ) );
+}
+
+/**
+ * Consume bits from bit buffer
+ *
+ * @v deflate		Decompressor
+ * @v len		Number of bits
+ */
+static inline void deflate_consume ( struct deflate *deflate,
+				     unsigned int len ) {
+	deflate->bits >>= len;
+	deflate->bits_len -= len;
+}
+
+/**
+ * Discard bits up to the next byte boundary
+ *
+ * @v deflate		Decompressor
+ */
+static inline void deflate_align ( struct deflate *deflate ) {
+	deflate_consume ( deflate, ( deflate->bits_len % 8 ) );
+}
+
+/**
+ * Get byte from (byte-aligned) bit buffer
+ *
+ * @v deflate		Decompressor
+ * @ret byte		Byte, or negative if no byte is available
+ */
+static int deflate_byte ( struct deflate *deflate ) {
+	int byte;
+
+	if ( deflate->bits_len < 8 )
+		return -1;
+	byte = deflate_peek ( deflate, 0, 8 );
+	deflate_consume ( deflate, 8 );
+	return byte;
+}
+
+/**
+ * Accumulate header or footer bytes
+ *
+ * @v deflate		Decompressor
+ * @v len		Required number of bytes
+ * @ret complete	All bytes have been accumulated
+ */
+static int deflate_header ( struct deflate *deflate, unsigned int len ) {
+	int byte;
+
+	while ( deflate->header_len < len ) {
+		if ( ( byte = deflate_byte ( deflate ) ) < 0 )
+			return 0;
+		deflate->header[ deflate->header_len++ ] = byte;
+	}
+	deflate->header_len = 0;
+	return 1;
+}
+
+/**
+ * Write decompressed byte
+ *
+ * @v deflate		Decompressor
+ * @v out		Output data buffer
+ * @v byte		Byte
+ */
+static inline void deflate_write ( struct deflate *deflate,
+				   struct deflate_chunk *out, uint8_t byte ) {
+	uint8_t *data = out->data;
+
+	data[ out->offset++ ] = byte;
+	deflate->window[ deflate->total++ % DEFLATE_WINDOW_SIZE ] = byte;
+}
+
+/**
+ * Update checksum over decompressed data
+ *
+ * @v deflate		Decompressor
+ * @v out		Output data buffer
+ * @v start		Offset of first byte not yet included in checksum
+ */
+static void deflate_checksum ( struct deflate *deflate,
+			       struct deflate_chunk *out, size_t *start ) {
+	const uint8_t *data = ( out->data + *start );
+	size_t len = ( out->offset - *start );
+	uint32_t a = ( deflate->checksum & 0xffff );
+	uint32_t b = ( deflate->checksum >> 16 );
+	size_t frag_len;
+
+	switch ( deflate->format ) {
+	case DEFLATE_ZLIB:
+		while ( len ) {
+			frag_len = len;
+			if ( frag_len > DEFLATE_ADLER32_NMAX )
+				frag_len = DEFLATE_ADLER32_NMAX;
+			len -= frag_len;
+			while ( frag_len-- ) {
+				a += *(data++);
+				b += a;
+			}
+			a %= DEFLATE_ADLER32_MOD;
+			b %= DEFLATE_ADLER32_MOD;
+		}
+		deflate->checksum = ( ( b << 16 ) | a );
+		break;
+	case DEFLATE_GZIP:
+		deflate->checksum = crc32_le ( deflate->checksum, data, len );
+		break;
+	default:
+		break;
+	}
+	*start = out->offset;
+}
+
+/**
+ * Select next GZIP header field
+ *
+ * @v deflate		Decompressor
+ */
+static void deflate_gzip_next ( struct deflate *deflate ) {
+
+	if ( deflate->flags & DEFLATE_GZIP_FEXTRA ) {
+		deflate->flags &= ~DEFLATE_GZIP_FEXTRA;
+		deflate->state = DEFLATE_GZIP_EXTRA_LEN;
+	} else if ( deflate->flags & DEFLATE_GZIP_FNAME ) {
+		deflate->flags &= ~DEFLATE_GZIP_FNAME;
+		deflate->state = DEFLATE_GZIP_STRING;
+	} else if ( deflate->flags & DEFLATE_GZIP_FCOMMENT ) {
+		deflate->flags &= ~DEFLATE_GZIP_FCOMMENT;
+		deflate->state = DEFLATE_GZIP_STRING;
+	} else if ( deflate->flags & DEFLATE_GZIP_FHCRC ) {
+		deflate->flags &= ~DEFLATE_GZIP_FHCRC;
+		deflate->remaining = 2;
+		deflate->state = DEFLATE_GZIP_SKIP;
+	} else {
+		deflate->state = DEFLATE_BLOCK_HEADER;
+	}
+}
+
+/**
+ * Handle end of compressed data
+ *
+ * @v deflate		Decompressor
+ */
+static void deflate_end ( struct deflate *deflate ) {
+
+	if ( deflate->format == DEFLATE_RAW ) {
+		deflate->state = DEFLATE_DONE;
+	} else {
+		deflate_align ( deflate );
+		deflate->state = DEFLATE_FOOTER;
+	}
+}
+
+/**
+ * Construct fixed Huffman alphabets
+ *
+ * @v deflate		Decompressor
+ * @ret rc		Return status code
+ */
+static int deflate_fixed ( struct deflate *deflate ) {
+	uint8_t *lengths = deflate->lengths;
+	int rc;
+
+	/* Construct literal/length alphabet */
+	memset ( &lengths[0], 8, 144 );
+	memset ( &lengths[144], 9, ( 256 - 144 ) );
+	memset ( &lengths[256], 7, ( 280 - 256 ) );
+	memset ( &lengths[280], 8, ( DEFLATE_FIXED_LITLEN - 280 ) );
+	if ( ( rc = deflate_huffman ( &deflate->litlen, lengths,
+				      DEFLATE_FIXED_LITLEN ) ) != 0 )
+		return rc;
+
+	/* Construct distance alphabet */
+	memset ( lengths, 5, DEFLATE_FIXED_DISTANCE );
+	if ( ( rc = deflate_huffman ( &deflate->distance, lengths,
+				      DEFLATE_FIXED_DISTANCE ) ) != 0 )
+		return rc;
+
+	return 0;
+}
+
+/**
+ * Perform a single decompression step
+ *
+ * @v deflate		Decompressor
+ * @v out		Output data buffer
+ * @v start		Offset of first byte not yet included in checksum
+ * @ret rc		Return status code (or DEFLATE_CONTINUE/BLOCKED)
+ */
+static int deflate_step ( struct deflate *deflate, struct deflate_chunk *out,
+			  size_t *start ) {
+	uint8_t *header = deflate->header;
+	unsigned int symbol;
+	unsigned int len;
+	unsigned int extra;
+	unsigned int repeat;
+	unsigned int value;
+	uint32_t checksum;
+	int byte;
+	int rc;
+
+	switch ( deflate->state ) {
+
+	case DEFLATE_ZLIB_HEADER:
+		if ( ! deflate_header ( deflate, DEFLATE_ZLIB_HEADER_LEN ) )
+			return DEFLATE_BLOCKED;
+		if ( ( ( header[0] & 0x0f ) != 8 ) ||
+		     ( ( header[0] >> 4 ) > 7 ) ||
+		     ( ( ( header[0] << 8 ) | header[1] ) % 31 ) ||
+		     ( header[1] & 0x20 /* FDICT */ ) ) {
+			DBGC ( deflate, "DEFLATE %p invalid ZLIB header "
+			       "%02x%02x\n", deflate, header[0], header[1] );
+			return -EINVAL_HEADER;
+		}
+		deflate->state = DEFLATE_BLOCK_HEADER;
+		return DEFLATE_CONTINUE;
+
+	case DEFLATE_GZIP_HEADER:
+		if ( ! deflate_header ( deflate, DEFLATE_GZIP_HEADER_LEN ) )
+			return DEFLATE_BLOCKED;
+		if ( ( header[0] != 0x1f ) || ( header[1] != 0x8b ) ||
+		     ( header[2] != 8 ) ||
+		     ( header[3] & DEFLATE_GZIP_RESERVED ) ) {
+			DBGC ( deflate, "DEFLATE %p invalid GZIP header:\n",
+			       deflate );
+			DBGC_HDA ( deflate, 0, header,
+				   DEFLATE_GZIP_HEADER_LEN );
+			return -EINVAL_HEADER;
+		}
+		deflate->flags = header[3];
+		deflate_gzip_next ( deflate );
+		return DEFLATE_CONTINUE;
+
+	case DEFLATE_GZIP_EXTRA_LEN:
+		if ( ! deflate_header ( deflate, 2 ) )
+			return DEFLATE_BLOCKED;
+		deflate->remaining = ( header[0] | ( header[1] << 8 ) );
+		deflate->state = DEFLATE_GZIP_SKIP;
+		return DEFLATE_CONTINUE;
+
+	case DEFLATE_GZIP_SKIP:
+		while ( deflate->remaining ) {
+			if ( deflate_byte ( deflate ) < 0 )
+				return DEFLATE_BLOCKED;
+			deflate->remaining--;
+		}
+		deflate_gzip_next ( deflate );
+		return DEFLATE_CONTINUE;
+
+	case DEFLATE_GZIP_STRING:
+		do {
+			if ( ( byte = deflate_byte ( deflate ) ) < 0 )
+				return DEFLATE_BLOCKED;
+		} while ( byte != 0 );
+		deflate_gzip_next ( deflate );
+		return DEFLATE_CONTINUE;
+
+	case DEFLATE_BLOCK_HEADER:
+		if ( deflate->bits_len < 3 )
+			return DEFLATE_BLOCKED;
+		deflate->final = deflate_peek ( deflate, 0, 1 );
+		value = deflate_peek ( deflate, 1, 2 );
+		deflate_consume ( deflate, 3 );
+		switch ( value ) {
+		case 0:
+			deflate_align ( deflate );
+			deflate->state = DEFLATE_STORED_LEN;
+			break;
+		case 1:
+			if ( ( rc = deflate_fixed ( deflate ) ) != 0 )
+				return rc;
+			deflate->state = DEFLATE_LITLEN;
+			break;
+		case 2:
+			deflate->state = DEFLATE_DYNAMIC_HEADER;
+			break;
+		default:
+			DBGC ( deflate, "DEFLATE %p invalid block type %d\n",
+			       deflate, value );
+			return -EINVAL_BLOCK;
+		}
+		return DEFLATE_CONTINUE;
+
+	case DEFLATE_STORED_LEN:
+		if ( ! deflate_header ( deflate, 4 ) )
+			return DEFLATE_BLOCKED;
+		deflate->remaining = ( header[0] | ( header[1] << 8 ) );
+		value = ( header[2] | ( header[3] << 8 ) );
+		if ( ( deflate->remaining ^ value ) != 0xffff ) {
+			DBGC ( deflate, "DEFLATE %p invalid stored length "
+			       "%04zx/%04x\n", deflate, deflate->remaining,
+			       value );
+			return -EINVAL_STORED;
+		}
+		deflate->state = DEFLATE_STORED_DATA;
+		return DEFLATE_CONTINUE;
+
+	case DEFLATE_STORED_DATA:
+		while ( deflate->remaining ) {
+			if ( out->offset == out->len )
+				return DEFLATE_BLOCKED;
+			if ( ( byte = deflate_byte ( deflate ) ) < 0 )
+				return DEFLATE_BLOCKED;
+			deflate_write ( deflate, out, byte );
+			deflate->remaining--;
+		}
+		if ( deflate->final ) {
+			deflate_end ( deflate );
+		} else {
+			deflate->state = DEFLATE_BLOCK_HEADER;
+		}
+		return DEFLATE_CONTINUE;
+
+	case DEFLATE_DYNAMIC_HEADER:
+		if ( deflate->bits_len < 14 )
+			return DEFLATE_BLOCKED;
+		deflate->hlit = ( deflate_peek ( deflate, 0, 5 ) + 257 );
+		deflate->hdist = ( deflate_peek ( deflate, 5, 5 ) + 1 );
+		deflate->hclen = ( deflate_peek ( deflate, 10, 4 ) + 4 );
+		deflate_consume ( deflate, 14 );
+		if ( ( deflate->hlit > 286 ) || ( deflate->hdist > 30 ) ) {
+			DBGC ( deflate, "DEFLATE %p invalid dynamic header "
+			       "(%d/%d)\n", deflate, deflate->hlit,
+			       deflate->hdist );
+			return -EINVAL_HUFFMAN;
+		}
+		memset ( deflate->lengths, 0, sizeof ( deflate->lengths ) );
+		deflate->index = 0;
+		deflate->state = DEFLATE_DYNAMIC_CODELEN;
+		return DEFLATE_CONTINUE;
+
+	case DEFLATE_DYNAMIC_CODELEN:
+		while ( deflate->index < deflate->hclen ) {
+			if ( deflate->bits_len < 3 )
+				return DEFLATE_BLOCKED;
+			symbol = deflate_codelen_order[ deflate->index++ ];
+			deflate->lengths[symbol] =
+				deflate_peek ( deflate, 0, 3 );
+			deflate_consume ( deflate, 3 );
+		}
+		if ( ( rc = deflate_huffman ( &deflate->codelen,
+					      deflate->lengths,
+					      sizeof ( deflate_codelen_order )
+					      ) ) != 0 )
+			return rc;
+		memset ( deflate->lengths, 0, sizeof ( deflate->lengths ) );
+		deflate->index = 0;
+		deflate->state = DEFLATE_DYNAMIC_LENGTHS;
+		return DEFLATE_CONTINUE;
+
+	case DEFLATE_DYNAMIC_LENGTHS:
+		while ( deflate->index < ( deflate->hlit + deflate->hdist ) ) {
+			if ( ( rc = deflate_decode ( deflate, &deflate->codelen,
+						     &symbol, &len ) ) != 0 )
+				return rc;
+			if ( symbol < 16 ) {
+				deflate_consume ( deflate, len );
+				deflate->lengths[ deflate->index++ ] = symbol;
+				continue;
+			}
+			extra = ( ( symbol == 16 ) ? 2 :
+				  ( ( symbol == 17 ) ? 3 : 7 ) );
+			if ( deflate->bits_len < ( len + extra ) )
+				return DEFLATE_BLOCKED;
+			repeat = ( deflate_peek ( deflate, len, extra ) +
+				   ( ( symbol == 18 ) ? 11 : 3 ) );
+			deflate_consume ( deflate, ( len + extra ) );
+			value = 0;
+			if ( symbol == 16 ) {
+				if ( ! deflate->index )
+					return -EINVAL_HUFFMAN;
+				value = deflate->lengths[ deflate->index - 1 ];
+			}
+			if ( ( deflate->index + repeat ) >
+			     ( deflate->hlit + deflate->hdist ) )
+				return -EINVAL_HUFFMAN;
+			while ( repeat-- )
+				deflate->lengths[ deflate->index++ ] = value;
+		}
+		if ( ! deflate->lengths[DEFLATE_END_OF_BLOCK] ) {
+			DBGC ( deflate, "DEFLATE %p missing end-of-block "
+			       "code\n", deflate );
+			return -EINVAL_HUFFMAN;
+		}
+		if ( ( rc = deflate_huffman ( &deflate->litlen,
+					      deflate->lengths,
+					      deflate->hlit ) ) != 0 )
+			return rc;
+		if ( ( rc = deflate_huffman ( &deflate->distance,
+					      &deflate->lengths[deflate->hlit],
+					      deflate->hdist ) ) != 0 )
+			return rc;
+		deflate->state = DEFLATE_LITLEN;
+		return DEFLATE_CONTINUE;
+
+	case DEFLATE_LITLEN:
+		/* Decode literals in a tight loop */
+		while ( 1 ) {
+			if ( ( rc = deflate_decode ( deflate, &deflate->litlen,
+						     &symbol, &len ) ) != 0 )
+				return rc;
+			if ( symbol >= DEFLATE_END_OF_BLOCK )
+				break;
+			if ( out->offset == out->len )
+				return DEFLATE_BLOCKED;
+			deflate_consume ( deflate, len );
+			deflate_write ( deflate, out, symbol );
+		}
+		if ( symbol == DEFLATE_END_OF_BLOCK ) {
+			deflate_consume ( deflate, len );
+			if ( deflate->final ) {
+				deflate_end ( deflate );
+			} else {
+				deflate->state = DEFLATE_BLOCK_HEADER;
+			}
+			return DEFLATE_CONTINUE;
+		}
+		symbol -= ( DEFLATE_END_OF_BLOCK + 1 );
+		if ( symbol >= ( sizeof ( deflate_length_base ) /
+				 sizeof ( deflate_length_base[0] ) ) ) {
+			DBGC ( deflate, "DEFLATE %p invalid length symbol\n",
+			       deflate );
+			return -EINVAL_HUFFMAN;
+		}
+		extra = deflate_length_extra[symbol];
+		if ( deflate->bits_len < ( len + extra ) )
+			return DEFLATE_BLOCKED;
+		deflate->copy_len = ( deflate_length_base[symbol] +
+				      deflate_peek ( deflate, len, extra ) );
+		deflate_consume ( deflate, ( len + extra ) );
+		deflate->state = DEFLATE_DISTANCE;
+		return DEFLATE_CONTINUE;
+
+	case DEFLATE_DISTANCE:
+		if ( ( rc = deflate_decode ( deflate, &deflate->distance,
+					     &symbol, &len ) ) != 0 )
+			return rc;
+		if ( symbol >= ( sizeof ( deflate_distance_base ) /
+				 sizeof ( deflate_distance_base[0] ) ) ) {
+			DBGC ( deflate, "DEFLATE %p invalid distance symbol\n",
+			       deflate );
+			return -EINVAL_HUFFMAN;
+		}
+		deflate_consume ( deflate, len );
+		deflate->copy_dist = symbol;
+		deflate->state = DEFLATE_DISTANCE_EXTRA;
+		return DEFLATE_CONTINUE;
+
+	case DEFLATE_DISTANCE_EXTRA:
+		symbol = deflate->copy_dist;
+		extra = deflate_distance_extra[symbol];
+		if ( deflate->bits_len < extra )
+			return DEFLATE_BLOCKED;
+		deflate->copy_dist = ( deflate_distance_base[symbol] +
+				       deflate_peek ( deflate, 0, extra ) );
+		deflate_consume ( deflate, extra );
+		if ( deflate->copy_dist > deflate->total ) {
+			DBGC ( deflate, "DEFLATE %p distance %d exceeds "
+			       "output length %zd\n", deflate,
+			       deflate->copy_dist, deflate->total );
+			return -EINVAL_DISTANCE;
+		}
+		deflate->state = DEFLATE_COPY;
+		return DEFLATE_CONTINUE;
+
+	case DEFLATE_COPY:
+		while ( deflate->copy_len ) {
+			if ( out->offset == out->len )
+				return DEFLATE_BLOCKED;
+			value = ( ( deflate->total - deflate->copy_dist ) %
+				  DEFLATE_WINDOW_SIZE );
+			deflate_write ( deflate, out,
+					deflate->window[value] );
+			deflate->copy_len--;
+		}
+		deflate->state = DEFLATE_LITLEN;
+		return DEFLATE_CONTINUE;
+
+	case DEFLATE_FOOTER:
+		deflate_checksum ( deflate, out, start );
+		if ( deflate->format == DEFLATE_ZLIB ) {
+			if ( ! deflate_header ( deflate,
+						DEFLATE_ZLIB_FOOTER_LEN ) )
+				return DEFLATE_BLOCKED;
+			checksum = ( ( header[0] << 24 ) | ( header[1] << 16 ) |
+				     ( header[2] << 8 ) | ( header[3] << 0 ) );
+			len = 0;
+		} else {
+			if ( ! deflate_header ( deflate,
+						DEFLATE_GZIP_FOOTER_LEN ) )
+				return DEFLATE_BLOCKED;
+			checksum = ~( ( header[0] << 0 ) |
+				      ( header[1] << 8 ) |
+				      ( header[2] << 16 ) |
+				      ( header[3] << 24 ) );
+			len = ( ( header[4] << 0 ) | ( header[5] << 8 ) |
+				( header[6] << 16 ) | ( header[7] << 24 ) );
+			if ( len != ( ( uint32_t ) deflate->total ) ) {
+				DBGC ( deflate, "DEFLATE %p length mismatch "
+				       "(%zd, expected %d)\n", deflate,
+				       deflate->total, len );
+				return -EIO_CHECKSUM;
+			}
+		}
+		if ( checksum != deflate->checksum ) {
+			DBGC ( deflate, "DEFLATE %p checksum mismatch (%08x, "
+			       "expected %08x)\n", deflate, deflate->checksum,
+			       checksum );
+			return -EIO_CHECKSUM;
+		}
+		deflate->state = DEFLATE_DONE;
+		return DEFLATE_CONTINUE;
+
+	case DEFLATE_DONE:
+		return DEFLATE_BLOCKED;
+
+	default:
+		assert ( 0 );
+		return -EINVAL;
+	}
+}
+
+/**
+ * Initialise decompressor
+ *
+ * @v deflate		Decompressor
+ * @v format		Compression format
+ */
+void deflate_init ( struct deflate *deflate, enum deflate_format format ) {
+	static const enum deflate_state initial[] = {
+		[DEFLATE_RAW] = DEFLATE_BLOCK_HEADER,
+		[DEFLATE_ZLIB] = DEFLATE_ZLIB_HEADER,
+		[DEFLATE_GZIP] = DEFLATE_GZIP_HEADER,
+	};
+
+	/* Clear all state except the sliding window, which is
+	 * necessarily written before it is read.
+	 */
+	memset ( deflate, 0, offsetof ( struct deflate, window ) );
+	deflate->format = format;
+	deflate->state = initial[format];
+	deflate->checksum = ( ( format == DEFLATE_ZLIB ) ? 1 : 0xffffffffUL );
+}
+
+/**
+ * Decompress data
+ *
+ * @v deflate		Decompressor
+ * @v in		Compressed input data
+ * @v out		Output data buffer
+ * @ret rc		Return status code
+ *
+ * Decompression continues until either all input data has been
+ * consumed, the output data buffer is full, or the end of the
+ * compressed data is reached (as indicated by deflate_finished()).
+ * The input and output offsets are updated to reflect the data
+ * consumed and produced.
+ */
+int deflate_inflate ( struct deflate *deflate, struct deflate_chunk *in,
+		      struct deflate_chunk *out ) {
+	const uint8_t *data = in->data;
+	size_t start = out->offset;
+	int rc;
+
+	do {
+		/* Refill bit buffer */
+		while ( ( deflate->bits_len <= 24 ) &&
+			( in->offset < in->len ) ) {
+			deflate->bits |= ( ( ( uint32_t ) data[ in->offset++ ] )
+					   << deflate->bits_len );
+			deflate->bits_len += 8;
+		}
+
+		/* Perform decompression step */
+		rc = deflate_step ( deflate, out, &start );
+
+		/* Continue unless blocked with no further input able
+		 * to be loaded into the bit buffer.
+		 */
+	} while ( ( rc == DEFLATE_CONTINUE ) ||
+		  ( ( rc == DEFLATE_BLOCKED ) &&
+		    ( deflate->bits_len <= 24 ) && ( in->offset < in->len ) &&
+		    ( deflate->state != DEFLATE_DONE ) ) );
+
+	/* Update checksum over newly decompressed data */
+	deflate_checksum ( deflate, out, &start );
+
+	return ( ( rc < 0 ) ? rc : 0 );
+}
@@ -23,7 +23,10 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/tables.h>
 #include <ipxe/init.h>
 #include <ipxe/interface.h>
+#include <ipxe/timer.h>
+#include <ipxe/retry.h>
 #include <ipxe/device.h>
+#include <ipxe/timeline.h>
 
 /**
  * @file
@@ -38,6 +41,33 @@ static LIST_HEAD ( devices );
 /** Device removal inhibition counter */
 int device_keep_count = 0;
 
+/** Delay before probing deferred devices in the background */
+#define DEFERRED_PROBE_DELAY TICKS_PER_SEC
+
+/** Device to be probed before all others, if any */
+static struct device_description *first_desc;
+
+/** Devices other than the first device are being deferred */
+static int probe_deferring;
+
+/** Number of devices deferred by the current root device */
+static unsigned int probe_deferred_count;
+
+/**
+ * Handle deferred device probing timer expiry
+ *
+ * @v timer		Retry timer
+ * @v fail		Failure indicator
+ */
+static void deferred_probe_expired ( struct retry_timer *timer __unused,
+				     int fail __unused ) {
+	probe_deferred_devices();
+}
+
+/** Deferred device probing timer */
+static struct retry_timer deferred_probe_timer =
+	TIMER_INIT ( deferred_probe_expired );
+
 /**
  * Probe a root device
  *
@@ -48,7 +78,10 @@ static int rootdev_probe ( struct root_device *rootdev ) {
 	int rc;
 
 	DBG ( "Adding %s root bus\n", rootdev->dev.name );
-	if ( ( rc = rootdev->driver->probe ( rootdev ) ) != 0 ) {
+	timeline_begin ( "device", "probe", rootdev, rootdev->dev.name );
+	rc = rootdev->driver->probe ( rootdev );
+	timeline_end ( "device", "probe", rootdev, NULL );
+	if ( rc != 0 ) {
 		DBG ( "Failed to add %s root bus: %s\n",
 		      rootdev->dev.name, strerror ( rc ) );
 		return rc;
@@ -67,25 +100,127 @@ static void rootdev_remove ( struct root_device *rootdev ) {
 	DBG ( "Removed %s root bus\n", rootdev->dev.name );
 }
 
+/**
+ * Request that a device be probed before all others
+ *
+ * @v desc		Device description
+ *
+ * When probing devices at startup, only the specified device will be
+ * probed.  All other devices will be probed either in the background
+ * shortly afterwards, or on demand via probe_deferred_devices(),
+ * whichever happens first.  This allows e.g. DHCP to start on the
+ * boot network device without waiting for other devices with slow
+ * initialisation (such as PHY autonegotiation or firmware loading).
+ *
+ * This must be called before startup, and the description must
+ * remain valid until all deferred devices have been probed.
+ */
+void probe_device_first ( struct device_description *desc ) {
+
+	DBG ( "Probing device %d:%04x first\n",
+	      desc->bus_type, desc->location );
+	first_desc = desc;
+}
+
+/**
+ * Check whether or not a device should be probed now
+ *
+ * @v desc		Device description
+ * @ret probe		Device should be probed now
+ *
+ * Bus drivers should call this before probing each device that they
+ * find.  If the device is not to be probed now, then the bus driver
+ * will be asked to probe again later (via its root device's probe()
+ * method), at which point this function will allow all devices
+ * except those that have already been probed.
+ */
+int probe_device_now ( struct device_description *desc ) {
+	int first;
+
+	/* Probe all devices if no first device is specified */
+	if ( ! first_desc )
+		return 1;
+
+	/* Identify first device */
+	first = ( ( desc->bus_type == first_desc->bus_type ) &&
+		  ( desc->location == first_desc->location ) );
+
+	/* While deferring, probe only the first device.  Otherwise,
+	 * probe everything except the (already probed) first device.
+	 */
+	if ( probe_deferring ) {
+		if ( ! first )
+			probe_deferred_count++;
+		return first;
+	} else {
+		return ( ! first );
+	}
+}
+
 /**
  * Probe all devices
  *
  * This initiates probing for all devices in the system.  After this
  * call, the device hierarchy will be populated, and all hardware
- * should be ready to use.
+ * should be ready to use (unless probing has been deferred via
+ * probe_device_first()).
  */
 static void probe_devices ( void ) {
 	struct root_device *rootdev;
+	unsigned int deferred = 0;
 	int rc;
 
+	probe_deferring = ( first_desc != NULL );
 	for_each_table_entry ( rootdev, ROOT_DEVICES ) {
 		list_add ( &rootdev->dev.siblings, &devices );
 		INIT_LIST_HEAD ( &rootdev->dev.children );
-		if ( ( rc = rootdev_probe ( rootdev ) ) != 0 )
+		probe_deferred_count = 0;
+		if ( ( rc = rootdev_probe ( rootdev ) ) != 0 ) {
 			list_del ( &rootdev->dev.siblings );
+			continue;
+		}
+		rootdev->deferred = ( probe_deferred_count != 0 );
+		deferred += probe_deferred_count;
+	}
+	probe_deferring = 0;
+
+	/* Schedule probing of any deferred devices */
+	if ( deferred ) {
+		DBG ( "Deferred probing of %d devices\n", deferred );
+		start_timer_fixed ( &deferred_probe_timer,
+				    DEFERRED_PROBE_DELAY );
+	} else {
+		first_desc = NULL;
 	}
 }
 
+/**
+ * Probe all deferred devices
+ *
+ * This may be called by anything that requires the complete device
+ * hierarchy to be present (e.g. before falling back to booting from
+ * devices other than the boot device).  It does nothing if no
+ * devices were deferred, or if they have already been probed.
+ */
+void probe_deferred_devices ( void ) {
+	struct root_device *rootdev;
+
+	/* Do nothing unless devices have been deferred */
+	stop_timer ( &deferred_probe_timer );
+	if ( ! first_desc )
+		return;
+
+	/* Probe all deferred devices */
+	DBG ( "Probing deferred devices\n" );
+	list_for_each_entry ( rootdev, &devices, dev.siblings ) {
+		if ( ! rootdev->deferred )
+			continue;
+		rootdev->deferred = 0;
+		rootdev_probe ( rootdev );
+	}
+	first_desc = NULL;
+}
+
 /**
  * Remove all devices
  *
@@ -99,6 +234,10 @@ static void remove_devices ( int booting __unused ) {
 		return;
 	}
 
+	/* Abandon any deferred probing */
+	stop_timer ( &deferred_probe_timer );
+	first_desc = NULL;
+
 	list_for_each_entry_safe ( rootdev, tmp, &devices, dev.siblings ) {
 		rootdev_remove ( rootdev );
 		list_del ( &rootdev->dev.siblings );
@@ -19,8 +19,10 @@
 FILE_LICENCE ( GPL2_OR_LATER );
 
 #include <stdlib.h>
+#include <string.h>
 #include <stdarg.h>
 #include <errno.h>
+#include <assert.h>
 #include <syslog.h>
 #include <ipxe/iobuf.h>
 #include <ipxe/xfer.h>
@@ -29,7 +31,13 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/uaccess.h>
 #include <ipxe/umalloc.h>
 #include <ipxe/image.h>
+#include <ipxe/crypto.h>
+#include <ipxe/sha256.h>
 #include <ipxe/downloader.h>
+#include <ipxe/elf.h>
+#include <ipxe/lz4.h>
+#include <ipxe/timeline.h>
+#include <config/general.h>
 
 /** @file
  *
@@ -37,6 +45,27 @@ FILE_LICENCE ( GPL2_OR_LATER );
  *
  */
 
+/** Digest algorithm used to digest images during download */
+#ifdef DOWNLOAD_DIGEST
+#define DOWNLOADER_DIGEST &sha256_algorithm
+#else
+#define DOWNLOADER_DIGEST NULL
+#endif
+
+/** Load ELF segments during download */
+#ifdef DOWNLOAD_ELF_STREAM
+#define DOWNLOADER_ELF_STREAM 1
+#else
+#define DOWNLOADER_ELF_STREAM 0
+#endif
+
+/** Decompress LZ4-compressed images after download */
+#ifdef DOWNLOAD_LZ4
+#define DOWNLOADER_LZ4 1
+#else
+#define DOWNLOADER_LZ4 0
+#endif
+
 /** A downloader */
 struct downloader {
 	/** Reference count for this object */
@@ -51,6 +80,34 @@ struct downloader {
 	struct image *image;
 	/** Current position within image buffer */
 	size_t pos;
+	/** Allocated length of image buffer
+	 *
+	 * This may exceed the length of the image, since the buffer
+	 * is extended geometrically when the final length of the
+	 * image is not known in advance.
+	 */
+	size_t alloc_len;
+	/** Number of direct placements in progress
+	 *
+	 * The image buffer must not be moved while any data is being
+	 * placed directly into it.
+	 */
+	unsigned int placements;
+
+	/** Digest algorithm, or NULL if not digesting
+	 *
+	 * Data is digested as it arrives, for as long as it arrives
+	 * in order.  Digesting is abandoned if any data arrives out
+	 * of order.
+	 */
+	struct digest_algorithm *digest;
+	/** Digest context */
+	void *digest_ctx;
+	/** Length of data digested so far */
+	size_t digest_len;
+
+	/** ELF segment stream */
+	struct elf_stream elf;
 };
 
 /**
@@ -66,6 +123,125 @@ static void downloader_free ( struct refcnt *refcnt ) {
 	free ( downloader );
 }
 
+/**
+ * Trim download buffer to image length
+ *
+ * @v downloader	Downloader
+ */
+static void downloader_trim ( struct downloader *downloader ) {
+	struct image *image = downloader->image;
+	userptr_t new_buffer;
+
+	/* Do nothing unless buffer is over-allocated */
+	if ( downloader->alloc_len <= image->len )
+		return;
+
+	DBGC ( downloader, "Downloader %p trimming from %zd to %zd bytes\n",
+	       downloader, downloader->alloc_len, image->len );
+
+	/* Shrink buffer.  Failure to shrink is not fatal, since the
+	 * existing buffer remains valid.
+	 */
+	new_buffer = urealloc ( image->data, image->len );
+	if ( new_buffer || ( image->len == 0 ) ) {
+		image->data = new_buffer;
+		downloader->alloc_len = image->len;
+	}
+}
+
+/**
+ * Decompress downloaded image
+ *
+ * @v downloader	Downloader
+ * @ret rc		Return status code
+ *
+ * LZ4-compressed images (identified by their signature) are replaced
+ * by their decompressed contents, so that subsequent image type
+ * probing and any use as an initrd sees only the decompressed data.
+ */
+static int downloader_decompress ( struct downloader *downloader ) {
+	struct image *image = downloader->image;
+	void *data = user_to_virt ( image->data, 0 );
+	userptr_t buffer;
+	size_t len;
+	int rc;
+
+	/* Do nothing unless image is LZ4-compressed */
+	if ( ! lz4_detect ( data, image->len ) )
+		return 0;
+
+	/* Calculate decompressed length */
+	if ( ( rc = lz4_decompress ( data, image->len, NULL, &len ) ) != 0 ) {
+		DBGC ( downloader, "Downloader %p could not decompress: %s\n",
+		       downloader, strerror ( rc ) );
+		return rc;
+	}
+
+	/* Allocate buffer and decompress */
+	buffer = umalloc ( len );
+	if ( ! buffer ) {
+		DBGC ( downloader, "Downloader %p could not allocate %zd "
+		       "bytes for decompression\n", downloader, len );
+		return -ENOMEM;
+	}
+	if ( ( rc = lz4_decompress ( data, image->len,
+				     user_to_virt ( buffer, 0 ),
+				     &len ) ) != 0 ) {
+		ufree ( buffer );
+		return rc;
+	}
+	DBGC ( downloader, "Downloader %p decompressed %zd bytes to %zd "
+	       "bytes\n", downloader, image->len, len );
+
+	/* Replace image contents.  Any digest calculated during
+	 * download describes only the compressed data.
+	 */
+	ufree ( image->data );
+	image->data = buffer;
+	image->len = len;
+	image->preloaded = 0;
+	downloader->alloc_len = len;
+	downloader->digest = NULL;
+
+	return 0;
+}
+
+/**
+ * Record digest of downloaded image
+ *
+ * @v downloader	Downloader
+ */
+static void downloader_digest ( struct downloader *downloader ) {
+	struct digest_algorithm *digest = downloader->digest;
+	struct image *image = downloader->image;
+	struct image_digest *image_digest;
+
+	/* Do nothing unless the whole image has been digested */
+	if ( ! digest )
+		return;
+	if ( downloader->digest_len != image->len ) {
+		DBGC ( downloader, "Downloader %p digested only %zd of %zd "
+		       "bytes\n", downloader, downloader->digest_len,
+		       image->len );
+		return;
+	}
+
+	/* Allocate and record digest.  Failure is not fatal, since
+	 * the image can still be digested later if required.
+	 */
+	image_digest = malloc ( sizeof ( *image_digest ) +
+				digest->digestsize );
+	if ( ! image_digest )
+		return;
+	image_digest->digest = digest;
+	digest_final ( digest, downloader->digest_ctx, image_digest->out );
+	free ( image->digest );
+	image->digest = image_digest;
+	DBGC ( downloader, "Downloader %p %s digest:\n",
+	       downloader, digest->name );
+	DBGC_HDA ( downloader, 0, image_digest->out, digest->digestsize );
+}
+
 /**
  * Terminate download
  *
@@ -74,7 +250,28 @@ static void downloader_free ( struct refcnt *refcnt ) {
  */
 static void downloader_finished ( struct downloader *downloader, int rc ) {
 
+	/* Release any unused buffer space, decompress image if
+	 * applicable, and record image digest.
+	 */
+	if ( rc == 0 ) {
+		downloader_trim ( downloader );
+		if ( DOWNLOADER_LZ4 )
+			rc = downloader_decompress ( downloader );
+	}
+	if ( rc == 0 )
+		downloader_digest ( downloader );
+	downloader->digest = NULL;
+
+	/* Complete any segment loading carried out during download.
+	 * This must happen after trimming the buffer, since the
+	 * buffer may move as a result.
+	 */
+	if ( DOWNLOADER_ELF_STREAM && ( rc == 0 ) )
+		elf_stream_finish ( &downloader->elf, downloader->image );
+	downloader->elf.state = ELF_STREAM_IDLE;
+
 	/* Log download status */
+	timeline_end ( "image", "download", downloader, NULL );
 	if ( rc == 0 ) {
 		syslog ( LOG_NOTICE, "Downloaded \"%s\"\n",
 			 downloader->image->name );
@@ -97,24 +294,51 @@ static void downloader_finished ( struct downloader *downloader, int rc ) {
  */
 static int downloader_ensure_size ( struct downloader *downloader,
 				    size_t len ) {
+	struct image *image = downloader->image;
 	userptr_t new_buffer;
+	size_t alloc_len;
 
-	/* If buffer is already large enough, do nothing */
-	if ( len <= downloader->image->len )
+	/* If image is already large enough, do nothing */
+	if ( len <= image->len )
 		return 0;
 
-	DBGC ( downloader, "Downloader %p extending to %zd bytes\n",
-	       downloader, len );
-
-	/* Extend buffer */
-	new_buffer = urealloc ( downloader->image->data, len );
-	if ( ! new_buffer ) {
-		DBGC ( downloader, "Downloader %p could not extend buffer to "
-		       "%zd bytes\n", downloader, len );
-		return -ENOSPC;
+	/* Extend buffer if necessary.  When the data extends beyond
+	 * the end of the buffer, we grow the buffer geometrically so
+	 * that downloads of unknown length (i.e. with no file size
+	 * hint provided via xfer_seek()) do not require a reallocation
+	 * for each received packet.  A file size hint will generally
+	 * cause the buffer to be allocated at exactly the hinted size,
+	 * since the hint will exceed the geometric growth.
+	 */
+	if ( len > downloader->alloc_len ) {
+		if ( downloader->placements ) {
+			DBGC ( downloader, "Downloader %p cannot extend "
+			       "buffer during direct placement\n",
+			       downloader );
+			return -ENOSPC;
+		}
+		alloc_len = ( downloader->alloc_len * 2 );
+		if ( alloc_len < len )
+			alloc_len = len;
+		DBGC ( downloader, "Downloader %p extending to %zd bytes\n",
+		       downloader, alloc_len );
+		new_buffer = urealloc ( image->data, alloc_len );
+		if ( ( ! new_buffer ) && ( alloc_len > len ) ) {
+			/* Retry with exactly the required length */
+			alloc_len = len;
+			new_buffer = urealloc ( image->data, alloc_len );
+		}
+		if ( ! new_buffer ) {
+			DBGC ( downloader, "Downloader %p could not extend "
+			       "buffer to %zd bytes\n", downloader, len );
+			return -ENOSPC;
+		}
+		image->data = new_buffer;
+		downloader->alloc_len = alloc_len;
 	}
-	downloader->image->data = new_buffer;
-	downloader->image->len = len;
+
+	/* Record new image length */
+	image->len = len;
 
 	return 0;
 }
@@ -148,6 +372,40 @@ static void downloader_progress ( struct downloader *downloader,
  *
  */
 
+/**
+ * Process data received into image buffer
+ *
+ * @v downloader	Downloader
+ * @v len		Length of data at current buffer position
+ */
+static void downloader_received ( struct downloader *downloader,
+				  size_t len ) {
+	struct image *image = downloader->image;
+
+	/* Digest data, if it follows on from the data already digested */
+	if ( downloader->digest ) {
+		if ( downloader->pos == downloader->digest_len ) {
+			digest_update ( downloader->digest,
+					downloader->digest_ctx,
+					user_to_virt ( image->data,
+						       downloader->pos ), len );
+			downloader->digest_len += len;
+		} else {
+			DBGC ( downloader, "Downloader %p abandoning digest "
+			       "at out-of-order offset %zd\n",
+			       downloader, downloader->pos );
+			downloader->digest = NULL;
+		}
+	}
+
+	/* Load data into ELF segments, if applicable */
+	if ( DOWNLOADER_ELF_STREAM )
+		elf_stream ( &downloader->elf, image, downloader->pos, len );
+
+	/* Update current buffer position */
+	downloader->pos += len;
+}
+
 /**
  * Handle received data
  *
@@ -177,9 +435,7 @@ static int downloader_xfer_deliver ( struct downloader *downloader,
 	/* Copy data to buffer */
 	copy_to_user ( downloader->image->data, downloader->pos,
 		       iobuf->data, len );
-
-	/* Update current buffer position */
-	downloader->pos += len;
+	downloader_received ( downloader, len );
 
  done:
 	free_iob ( iobuf );
@@ -188,9 +444,62 @@ static int downloader_xfer_deliver ( struct downloader *downloader,
 	return rc;
 }
 
+/**
+ * Get buffer for direct data placement
+ *
+ * @v downloader	Downloader
+ * @v offset		Absolute offset of data within image
+ * @v len		Length of data
+ * @ret buffer		Buffer for data, or UNULL
+ *
+ * Direct placement is permitted only within the image length already
+ * established (e.g. via a file size hint), since placement into a
+ * buffer that may subsequently need to be extended would be unsafe.
+ */
+static userptr_t downloader_xfer_buffer ( struct downloader *downloader,
+					  size_t offset, size_t len ) {
+	struct image *image = downloader->image;
+
+	/* Check that range lies within the existing image buffer */
+	if ( ( offset > image->len ) || ( len > ( image->len - offset ) ) )
+		return UNULL;
+
+	DBGC2 ( downloader, "Downloader %p placing %#zx+%#zx directly\n",
+		downloader, offset, len );
+	downloader->placements++;
+	return userptr_add ( image->data, offset );
+}
+
+/**
+ * Handle data placed directly into buffer
+ *
+ * @v downloader	Downloader
+ * @v offset		Absolute offset of data within image
+ * @v len		Length of data
+ * @ret rc		Return status code
+ */
+static int downloader_xfer_placed ( struct downloader *downloader,
+				    size_t offset, size_t len ) {
+	struct image *image = downloader->image;
+
+	/* Sanity checks */
+	assert ( downloader->placements > 0 );
+	assert ( offset <= image->len );
+	assert ( len <= ( image->len - offset ) );
+	downloader->placements--;
+
+	/* Process data */
+	downloader->pos = offset;
+	downloader_received ( downloader, len );
+
+	return 0;
+}
+
 /** Downloader data transfer interface operations */
 static struct interface_operation downloader_xfer_operations[] = {
 	INTF_OP ( xfer_deliver, struct downloader *, downloader_xfer_deliver ),
+	INTF_OP ( xfer_buffer, struct downloader *, downloader_xfer_buffer ),
+	INTF_OP ( xfer_placed, struct downloader *, downloader_xfer_placed ),
 	INTF_OP ( intf_close, struct downloader *, downloader_finished ),
 };
 
@@ -234,12 +543,14 @@ static struct interface_descriptor downloader_job_desc =
  */
 int create_downloader ( struct interface *job, struct image *image,
 			int type, ... ) {
+	struct digest_algorithm *digest = DOWNLOADER_DIGEST;
 	struct downloader *downloader;
+	size_t ctxsize = ( digest ? digest->ctxsize : 0 );
 	va_list args;
 	int rc;
 
 	/* Allocate and initialise structure */
-	downloader = zalloc ( sizeof ( *downloader ) );
+	downloader = zalloc ( sizeof ( *downloader ) + ctxsize );
 	if ( ! downloader )
 		return -ENOMEM;
 	ref_init ( &downloader->refcnt, downloader_free );
@@ -248,7 +559,20 @@ int create_downloader ( struct interface *job, struct image *image,
 	intf_init ( &downloader->xfer, &downloader_xfer_desc,
 		    &downloader->refcnt );
 	downloader->image = image_get ( image );
+	downloader->alloc_len = image->len;
+	if ( digest ) {
+		downloader->digest = digest;
+		downloader->digest_ctx = ( ( ( void * ) downloader ) +
+					   sizeof ( *downloader ) );
+		digest_init ( digest, downloader->digest_ctx );
+	}
+	free ( image->digest );
+	image->digest = NULL;
+	image->preloaded = 0;
+	if ( DOWNLOADER_ELF_STREAM )
+		elf_stream_init ( &downloader->elf );
 	va_start ( args, type );
+	timeline_begin ( "image", "download", downloader, image->name );
 
 	/* Instantiate child objects and attach to our interfaces */
 	if ( ( rc = xfer_vopen ( &downloader->xfer, type, args ) ) != 0 )
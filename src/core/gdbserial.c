@@ -35,6 +35,7 @@ static void gdbserial_send ( const char *buf, size_t len ) {
 	while ( len-- > 0 ) {
 		serial_putc ( *buf++ );
 	}
+	serial_flush();
 }
 
 struct gdb_transport serial_gdb_transport __gdb_transport = {
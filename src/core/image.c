@@ -30,6 +30,8 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/umalloc.h>
 #include <ipxe/uri.h>
 #include <ipxe/image.h>
+#include <ipxe/profstat.h>
+#include <ipxe/timeline.h>
 
 /** @file
  *
@@ -70,6 +72,7 @@ static void free_image ( struct refcnt *refcnt ) {
 	DBGC ( image, "IMAGE %s freed\n", image->name );
 	free ( image->name );
 	free ( image->cmdline );
+	free ( image->digest );
 	uri_put ( image->uri );
 	ufree ( image->data );
 	image_put ( image->replacement );
@@ -229,6 +232,14 @@ int image_probe ( struct image *image ) {
 	if ( image->type )
 		return 0;
 
+	/* Fail if we have already failed to identify a type.  The
+	 * set of image types cannot change, so there is no need to
+	 * repeat each probe (e.g. each time an image is reselected).
+	 */
+	if ( image->flags & IMAGE_PROBED )
+		return -ENOEXEC;
+	image->flags |= IMAGE_PROBED;
+
 	/* Try each type in turn */
 	for_each_table_entry ( type, IMAGE_TYPES ) {
 		if ( ( rc = type->probe ( image ) ) == 0 ) {
@@ -258,7 +269,9 @@ int image_probe ( struct image *image ) {
 int image_exec ( struct image *image ) {
 	struct image *saved_current_image;
 	struct image *replacement;
+	struct image_type *type;
 	struct uri *old_cwuri;
+	union profiler profiler;
 	int rc;
 
 	/* Sanity check */
@@ -291,7 +304,13 @@ int image_exec ( struct image *image ) {
 	syslog ( LOG_NOTICE, "Executing \"%s\"\n", image->name );
 
 	/* Try executing the image */
-	if ( ( rc = image->type->exec ( image ) ) != 0 ) {
+	type = image->type;
+	profstat_start ( &profiler );
+	timeline_begin ( "image", "exec", image, image->name );
+	rc = type->exec ( image );
+	timeline_end ( "image", "exec", image, NULL );
+	profstat_stop ( &profiler, "image", type, type->name, image->len );
+	if ( rc != 0 ) {
 		DBGC ( image, "IMAGE %s could not execute: %s\n",
 		       image->name, strerror ( rc ) );
 		/* Do not return yet; we still have clean-up to do */
@@ -20,11 +20,17 @@ FILE_LICENCE ( GPL2_OR_LATER );
 
 #include <ipxe/device.h>
 #include <ipxe/init.h>
+#include <ipxe/profstat.h>
+#include <ipxe/timeline.h>
 
 /** @file
  *
  * Initialisation, startup and shutdown routines
  *
+ * If profiling statistics are enabled, the time taken by each
+ * initialisation and startup function is recorded, and may be
+ * displayed using the "profstat" command.  Each function is
+ * identified by its address.
  */
 
 /** "startup() has been called" flag */
@@ -42,10 +48,17 @@ static int started = 0;
  */
 void initialise ( void ) {
 	struct init_fn *init_fn;
+	union profiler profiler;
 
 	/* Call registered initialisation functions */
-	for_each_table_entry ( init_fn, INIT_FNS )
+	timeline_begin ( "init", "initialise", NULL, NULL );
+	for_each_table_entry ( init_fn, INIT_FNS ) {
+		profstat_start ( &profiler );
 		init_fn->initialise ();
+		profstat_stop ( &profiler, "init", init_fn->initialise,
+				NULL, 0 );
+	}
+	timeline_end ( "init", "initialise", NULL, NULL );
 }
 
 /**
@@ -57,15 +70,22 @@ void initialise ( void ) {
  */
 void startup ( void ) {
 	struct startup_fn *startup_fn;
+	union profiler profiler;
 
 	if ( started )
 		return;
 
 	/* Call registered startup functions */
+	timeline_begin ( "init", "startup", NULL, NULL );
 	for_each_table_entry ( startup_fn, STARTUP_FNS ) {
-		if ( startup_fn->startup )
+		if ( startup_fn->startup ) {
+			profstat_start ( &profiler );
 			startup_fn->startup();
+			profstat_stop ( &profiler, "startup",
+					startup_fn->startup, NULL, 0 );
+		}
 	}
+	timeline_end ( "init", "startup", NULL, NULL );
 
 	started = 1;
 }
@@ -49,6 +49,34 @@ struct interface null_intf = INTF_INIT ( null_intf_desc );
  *
  */
 
+/** Number of entries in operation cache (must be a power of two) */
+#define INTF_CACHE_SIZE 32
+
+/** A cached operation lookup */
+struct interface_cache {
+	/** Object interface */
+	struct interface *intf;
+	/** Operation type */
+	void *type;
+	/** Destination interface */
+	struct interface *dest;
+	/** Implementing method, or NULL */
+	void *func;
+	/** Plumbing generation at which lookup was performed */
+	unsigned long generation;
+};
+
+/** Cache of recent operation lookups */
+static struct interface_cache intf_cache[INTF_CACHE_SIZE];
+
+/** Plumbing generation
+ *
+ * This is incremented whenever any interface is replugged or has its
+ * descriptor changed, thereby invalidating all cached lookups.  It
+ * starts from one so that empty cache entries are never valid.
+ */
+unsigned long intf_generation = 1;
+
 /**
  * Plug an object interface into a new destination object interface
  *
@@ -69,6 +97,7 @@ void intf_plug ( struct interface *intf, struct interface *dest ) {
 	intf_get ( dest );
 	intf_put ( intf->dest );
 	intf->dest = dest;
+	intf_generation++;
 }
 
 /**
@@ -95,6 +124,28 @@ void intf_unplug ( struct interface *intf ) {
 	intf_plug ( intf, &null_intf );
 }
 
+/**
+ * Splice together the destinations of two object interfaces
+ *
+ * @v a			Object interface A
+ * @v b			Object interface B
+ *
+ * Plugs the destination of interface A into the destination of
+ * interface B (and vice versa), and unplugs both interfaces A and B.
+ * This allows an intermediate object to remove itself from a chain of
+ * interfaces.
+ */
+void intf_splice ( struct interface *a, struct interface *b ) {
+	struct interface *a_dest = intf_get ( a->dest );
+	struct interface *b_dest = intf_get ( b->dest );
+
+	intf_unplug ( a );
+	intf_unplug ( b );
+	intf_plug_plug ( a_dest, b_dest );
+	intf_put ( a_dest );
+	intf_put ( b_dest );
+}
+
 /**
  * Ignore all further operations on an object interface
  *
@@ -102,6 +153,7 @@ void intf_unplug ( struct interface *intf ) {
  */
 void intf_nullify ( struct interface *intf ) {
 	intf->desc = &null_intf_desc;
+	intf_generation++;
 }
 
 /**
@@ -182,11 +234,28 @@ void * intf_get_dest_op_no_passthru_untyped ( struct interface *intf,
  * @v type		Operation type
  * @ret dest		Destination interface
  * @ret func		Implementing method, or NULL
+ *
+ * The result of the lookup (including the walk along any chain of
+ * pass-through interfaces) is cached until the next change to any
+ * interface's plumbing, so that repeated operations (e.g. delivering
+ * each received packet) do not need to repeat the lookup.
  */
 void * intf_get_dest_op_untyped ( struct interface *intf, void *type,
 				  struct interface **dest ) {
+	struct interface_cache *cache;
+	struct interface *origin = intf;
 	void *func;
 
+	/* Use cached lookup, if available */
+	cache = &intf_cache[ ( ( ( ( intptr_t ) intf ) >> 3 ) ^
+			       ( ( ( intptr_t ) type ) >> 2 ) ) &
+			     ( INTF_CACHE_SIZE - 1 ) ];
+	if ( ( cache->intf == intf ) && ( cache->type == type ) &&
+	     ( cache->generation == intf_generation ) ) {
+		*dest = intf_get ( cache->dest );
+		return cache->func;
+	}
+
 	while ( 1 ) {
 
 		/* Search for an implementing method provided by the
@@ -194,13 +263,22 @@ void * intf_get_dest_op_untyped ( struct interface *intf, void *type,
 		 */
 		func = intf_get_dest_op_no_passthru_untyped( intf, type, dest );
 		if ( func )
-			return func;
+			break;
 
 		/* Pass through to the underlying interface, if applicable */
 		if ( ! ( intf = intf_get_passthru ( *dest ) ) )
-			return NULL;
+			break;
 		intf_put ( *dest );
 	}
+
+	/* Record lookup in cache */
+	cache->intf = origin;
+	cache->type = type;
+	cache->dest = *dest;
+	cache->func = func;
+	cache->generation = intf_generation;
+
+	return func;
 }
 
 /*****************************************************************************
@@ -288,4 +366,5 @@ void intf_restart ( struct interface *intf, int rc ) {
 	 * of the link call each other recursively.
 	 */
 	intf->desc = desc;
+	intf_generation++;
 }
@@ -19,6 +19,7 @@
 FILE_LICENCE ( GPL2_OR_LATER );
 
 #include <stdint.h>
+#include <string.h>
 #include <errno.h>
 #include <ipxe/malloc.h>
 #include <ipxe/iobuf.h>
@@ -29,6 +30,50 @@ FILE_LICENCE ( GPL2_OR_LATER );
  *
  */
 
+/** An I/O buffer pool size class */
+struct io_buffer_pool {
+	/** List of free I/O buffers */
+	struct list_head free;
+	/** Number of free I/O buffers */
+	unsigned int count;
+};
+
+/** I/O buffer pools
+ *
+ * The list of free I/O buffers within each pool is initialised
+ * whenever the first buffer is added to an empty pool.
+ */
+static struct io_buffer_pool iob_pools[IOB_POOL_CLASSES];
+
+struct cache_discarder iob_cache_discarder __cache_discarder ( CACHE_CHEAP );
+
+/**
+ * Get I/O buffer pool size
+ *
+ * @v class	Size class
+ * @ret size	Total size of I/O buffer (including descriptor)
+ */
+static inline __attribute__ (( always_inline )) size_t
+iob_pool_size ( unsigned int class ) {
+	return ( IOB_ALIGN << class );
+}
+
+/**
+ * Identify I/O buffer pool size class
+ *
+ * @v size	Total size of I/O buffer (including descriptor)
+ * @ret pool	I/O buffer pool, or NULL
+ */
+static struct io_buffer_pool * iob_pool ( size_t size ) {
+	unsigned int class;
+
+	for ( class = 0 ; class < IOB_POOL_CLASSES ; class++ ) {
+		if ( size == iob_pool_size ( class ) )
+			return &iob_pools[class];
+	}
+	return NULL;
+}
+
 /**
  * Allocate I/O buffer
  *
@@ -39,7 +84,10 @@ FILE_LICENCE ( GPL2_OR_LATER );
  * @c IOBUF_SIZE.
  */
 struct io_buffer * alloc_iob ( size_t len ) {
+	struct io_buffer_pool *pool;
 	struct io_buffer *iobuf = NULL;
+	unsigned int class;
+	size_t size;
 	void *data;
 
 	/* Pad to minimum length */
@@ -49,7 +97,38 @@ struct io_buffer * alloc_iob ( size_t len ) {
 	/* Align buffer length */
 	len = ( len + __alignof__( *iobuf ) - 1 ) &
 		~( __alignof__( *iobuf ) - 1 );
-	
+
+	/* Round up to a pool size class, if applicable.  Buffers
+	 * smaller than half of the smallest size class are not
+	 * rounded up, since this would waste memory.
+	 */
+	for ( class = 0 ; class < IOB_POOL_CLASSES ; class++ ) {
+		size = iob_pool_size ( class );
+		if ( ( ( len + sizeof ( *iobuf ) ) <= size ) &&
+		     ( ( len + sizeof ( *iobuf ) ) > ( size / 2 ) ) ) {
+			len = ( size - sizeof ( *iobuf ) );
+			break;
+		}
+	}
+
+	/* Reuse a pooled I/O buffer, if available */
+	pool = iob_pool ( len + sizeof ( *iobuf ) );
+	if ( pool && pool->count ) {
+		cache_hit ( &iob_cache_discarder );
+		iobuf = list_first_entry ( &pool->free, struct io_buffer,
+					   list );
+		list_del ( &iobuf->list );
+		pool->count--;
+		iobuf->data = iobuf->tail = iobuf->head;
+		iobuf->flags = 0;
+		iobuf->frag = NULL;
+		iobuf->owner = NULL;
+		iobuf->refs = 0;
+		return iobuf;
+	}
+	if ( pool )
+		cache_miss ( &iob_cache_discarder );
+
 	/* Allocate memory for buffer plus descriptor */
 	data = malloc_dma ( len + sizeof ( *iobuf ), IOB_ALIGN );
 	if ( ! data )
@@ -58,6 +137,48 @@ struct io_buffer * alloc_iob ( size_t len ) {
 	iobuf = ( struct io_buffer * ) ( data + len );
 	iobuf->head = iobuf->data = iobuf->tail = data;
 	iobuf->end = iobuf;
+	iobuf->flags = 0;
+	iobuf->frag = NULL;
+	iobuf->owner = NULL;
+	iobuf->refs = 0;
+	return iobuf;
+}
+
+/**
+ * Allocate I/O buffer referring to data within another I/O buffer
+ *
+ * @v owner	I/O buffer containing the data
+ * @v data	Start of data
+ * @v len	Length of data
+ * @ret iobuf	I/O buffer, or NULL if none available
+ *
+ * The new I/O buffer holds a reference to @c owner, which will not
+ * be freed until the new I/O buffer has also been freed.  The
+ * referenced data must not be modified while the new I/O buffer
+ * exists.  This allows (for example) a transmitted packet to include
+ * payload data that remains queued for possible retransmission,
+ * without copying it.
+ */
+struct io_buffer * alloc_iob_ref ( struct io_buffer *owner,
+				   void *data, size_t len ) {
+	struct io_buffer *iobuf;
+
+	/* Sanity checks */
+	assert ( owner->frag == NULL );
+	assert ( data >= owner->head );
+	assert ( ( data + len ) <= owner->end );
+
+	/* Allocate descriptor */
+	iobuf = zalloc ( sizeof ( *iobuf ) );
+	if ( ! iobuf )
+		return NULL;
+	iobuf->head = iobuf->data = data;
+	iobuf->tail = iobuf->end = ( data + len );
+
+	/* Take reference to owner */
+	iobuf->owner = owner;
+	owner->refs++;
+
 	return iobuf;
 }
 
@@ -67,15 +188,114 @@ struct io_buffer * alloc_iob ( size_t len ) {
  * @v iobuf	I/O buffer
  */
 void free_iob ( struct io_buffer *iobuf ) {
-	if ( iobuf ) {
+	struct io_buffer_pool *pool;
+	struct io_buffer *frag;
+	size_t size;
+
+	for ( ; iobuf ; iobuf = frag ) {
 		assert ( iobuf->head <= iobuf->data );
 		assert ( iobuf->data <= iobuf->tail );
 		assert ( iobuf->tail <= iobuf->end );
-		free_dma ( iobuf->head,
-			   ( iobuf->end - iobuf->head ) + sizeof ( *iobuf ) );
+		frag = iobuf->frag;
+
+		/* Drop reference if buffer is still in use elsewhere */
+		if ( iobuf->refs ) {
+			assert ( frag == NULL );
+			iobuf->refs--;
+			break;
+		}
+
+		/* Release referenced buffer, if applicable */
+		if ( iobuf->owner ) {
+			free_iob ( iobuf->owner );
+			free ( iobuf );
+			continue;
+		}
+		size = ( ( iobuf->end - iobuf->head ) + sizeof ( *iobuf ) );
+
+		/* Recycle into pool, if applicable */
+		pool = iob_pool ( size );
+		if ( pool && ( pool->count < IOB_POOL_MAX ) ) {
+			if ( ! pool->count )
+				INIT_LIST_HEAD ( &pool->free );
+			list_add ( &iobuf->list, &pool->free );
+			pool->count++;
+			continue;
+		}
+
+		free_dma ( iobuf->head, size );
+	}
+}
+
+/**
+ * Linearise multi-fragment I/O buffer
+ *
+ * @v iobuf	I/O buffer
+ * @ret linear	Single-fragment I/O buffer, or NULL on failure
+ *
+ * If the I/O buffer consists of multiple fragments, then the data is
+ * copied into a newly allocated single-fragment I/O buffer and the
+ * original I/O buffer is freed.  On failure, the original I/O buffer
+ * is left unaltered.
+ */
+struct io_buffer * iob_linearise ( struct io_buffer *iobuf ) {
+	struct io_buffer *linear;
+	struct io_buffer *frag;
+
+	/* Do nothing unless there are multiple fragments */
+	if ( ! iobuf->frag )
+		return iobuf;
+
+	/* Allocate new I/O buffer */
+	linear = alloc_iob ( iob_total_len ( iobuf ) );
+	if ( ! linear )
+		return NULL;
+	linear->flags = iobuf->flags;
+
+	/* Copy in data and free original I/O buffer */
+	for ( frag = iobuf ; frag ; frag = frag->frag ) {
+		memcpy ( iob_put ( linear, iob_len ( frag ) ), frag->data,
+			 iob_len ( frag ) );
+	}
+	free_iob ( iobuf );
+
+	return linear;
+}
+
+/**
+ * Discard some pooled I/O buffers
+ *
+ * @ret discarded	Number of cached items discarded
+ */
+static unsigned int iob_discard ( void ) {
+	struct io_buffer_pool *pool;
+	struct io_buffer *iobuf;
+	unsigned int class;
+	unsigned int discarded = 0;
+
+	/* Release one pooled I/O buffer from each size class */
+	for ( class = 0 ; class < IOB_POOL_CLASSES ; class++ ) {
+		pool = &iob_pools[class];
+		if ( ! pool->count )
+			continue;
+		iobuf = list_first_entry ( &pool->free, struct io_buffer,
+					   list );
+		list_del ( &iobuf->list );
+		pool->count--;
+		free_dma ( iobuf->head, iob_pool_size ( class ) );
+		discarded++;
 	}
+
+	return discarded;
 }
 
+/** I/O buffer pool cache discarder */
+struct cache_discarder iob_cache_discarder
+	__cache_discarder ( CACHE_CHEAP ) = {
+	.name = "iobuf",
+	.discard = iob_discard,
+};
+
 /**
  * Ensure I/O buffer has sufficient headroom
  *
@@ -94,3 +314,45 @@ int iob_ensure_headroom ( struct io_buffer *iobuf, size_t len ) {
 	return -ENOBUFS;
 }
 
+/**
+ * Ensure I/O buffer has sufficient tailroom
+ *
+ * @v iobuf	I/O buffer to update
+ * @v len	Required tailroom
+ * @ret rc	Return status code
+ *
+ * If the I/O buffer has insufficient tailroom, then it will be
+ * reallocated and its contents (including any headroom) copied to
+ * the new I/O buffer.  Any pointers into the original I/O buffer
+ * will then be invalid.  On failure, the original I/O buffer is left
+ * unaltered.
+ */
+int iob_expand ( struct io_buffer **iobuf, size_t len ) {
+	struct io_buffer *old = *iobuf;
+	struct io_buffer *new;
+	size_t headroom = iob_headroom ( old );
+
+	/* Do nothing if there is already sufficient tailroom */
+	if ( iob_tailroom ( old ) >= len )
+		return 0;
+
+	/* Sanity checks */
+	assert ( old->frag == NULL );
+	assert ( old->owner == NULL );
+	assert ( old->refs == 0 );
+
+	/* Allocate new I/O buffer */
+	new = alloc_iob ( headroom + iob_len ( old ) + len );
+	if ( ! new )
+		return -ENOMEM;
+
+	/* Copy contents and free original I/O buffer */
+	memcpy ( new->head, old->head, ( headroom + iob_len ( old ) ) );
+	iob_reserve ( new, headroom );
+	iob_put ( new, iob_len ( old ) );
+	new->flags = old->flags;
+	free_iob ( old );
+
+	*iobuf = new;
+	return 0;
+}
@@ -109,3 +109,49 @@ ssize_t line_buffer ( struct line_buffer *linebuf,
 
 	return consume;
 }
+
+/**
+ * Extract received data by lines, avoiding copies where possible
+ *
+ * @v linebuf			Line buffer
+ * @v data			New data to add
+ * @v len			Length of new data to add
+ * @ret line			Complete line, or NULL if no line ready
+ * @ret len			Consumed length, or negative error number
+ *
+ * This behaves as line_buffer(), except that a line lying entirely
+ * within @c data is terminated in place (by overwriting its line
+ * terminator) and returned directly, without any allocation.  Only
+ * lines which span more than one call are copied into the line
+ * buffer.  The returned line is valid only until the next call to
+ * line_buffer_inplace() (or to empty_line_buffer()), and only while
+ * @c data remains valid.
+ */
+ssize_t line_buffer_inplace ( struct line_buffer *linebuf,
+			      char *data, size_t len, char **line ) {
+	char *eol;
+	size_t consume;
+	ssize_t frag_len;
+
+	/* Free any completed line from previous iteration */
+	if ( linebuf->ready )
+		empty_line_buffer ( linebuf );
+
+	/* If no partial line is pending and a complete line is
+	 * present, then terminate and return the line in place.
+	 */
+	if ( ( linebuf->len == 0 ) &&
+	     ( ( eol = memchr ( data, '\n', len ) ) != NULL ) ) {
+		consume = ( eol - data + 1 );
+		*eol = '\0'; /* trim NL */
+		if ( ( eol > data ) && ( eol[-1] == '\r' ) )
+			eol[-1] = '\0'; /* trim CR */
+		*line = data;
+		return consume;
+	}
+
+	/* Otherwise, fall back to buffering the line */
+	frag_len = line_buffer ( linebuf, data, len );
+	*line = buffered_line ( linebuf );
+	return frag_len;
+}
@@ -25,8 +25,12 @@ FILE_LICENCE ( GPL2_OR_LATER );
  */
 
 #include <stdarg.h>
+#include <string.h>
+#include <errno.h>
 #include <syslog.h>
 #include <ipxe/console.h>
+#include <ipxe/init.h>
+#include <ipxe/log.h>
 
 /**
  * Write message to system log
@@ -60,3 +64,160 @@ void log_printf ( const char *fmt, ... ) {
 	log_vprintf ( fmt, args );
 	va_end ( args );
 }
+
+/******************************************************************************
+ *
+ * Log ring buffers
+ *
+ ******************************************************************************
+ */
+
+/**
+ * Add record to log ring buffer
+ *
+ * @v ring		Log ring
+ * @v data		Record (including terminating newline)
+ * @v len		Length of record
+ * @ret rc		Return status code
+ *
+ * The record is discarded (and counted as dropped) if there is
+ * insufficient space in the ring.  This function never blocks, and
+ * so may be called from any context.
+ */
+int log_ring_put ( struct log_ring *ring, const void *data, size_t len ) {
+	size_t offset;
+	size_t frag_len;
+
+	/* Drop record if there is insufficient space */
+	if ( len > ( ring->size - log_ring_fill ( ring ) ) ) {
+		ring->dropped++;
+		return -ENOBUFS;
+	}
+
+	/* Copy record into ring, wrapping around if necessary */
+	offset = ( ring->prod & ( ring->size - 1 ) );
+	frag_len = ( ring->size - offset );
+	if ( frag_len > len )
+		frag_len = len;
+	memcpy ( ( ring->data + offset ), data, frag_len );
+	memcpy ( ring->data, ( data + frag_len ), ( len - frag_len ) );
+	ring->prod += len;
+
+	/* Start flush process */
+	process_add ( &ring->process );
+
+	return 0;
+}
+
+/**
+ * Get length of first record in log ring buffer
+ *
+ * @v ring		Log ring
+ * @ret len		Length of first record (including newline), or zero
+ */
+size_t log_ring_record_len ( struct log_ring *ring ) {
+	size_t fill = log_ring_fill ( ring );
+	size_t i;
+
+	for ( i = 0 ; i < fill ; i++ ) {
+		if ( ring->data[ ( ring->cons + i ) & ( ring->size - 1 ) ]
+		     == '\n' )
+			return ( i + 1 );
+	}
+	return 0;
+}
+
+/**
+ * Remove records from log ring buffer
+ *
+ * @v ring		Log ring
+ * @v data		Buffer to fill with records
+ * @v len		Length of buffer
+ * @ret len		Length of records removed
+ *
+ * As many complete records as will fit within the buffer are
+ * removed from the ring.
+ */
+size_t log_ring_get ( struct log_ring *ring, void *data, size_t len ) {
+	size_t fill = log_ring_fill ( ring );
+	size_t used = 0;
+	size_t offset;
+	size_t frag_len;
+	size_t i;
+
+	/* Find end of last complete record that fits within buffer */
+	if ( len > fill )
+		len = fill;
+	for ( i = 0 ; i < len ; i++ ) {
+		if ( ring->data[ ( ring->cons + i ) & ( ring->size - 1 ) ]
+		     == '\n' )
+			used = ( i + 1 );
+	}
+
+	/* Copy records out of ring, wrapping around if necessary */
+	offset = ( ring->cons & ( ring->size - 1 ) );
+	frag_len = ( ring->size - offset );
+	if ( frag_len > used )
+		frag_len = used;
+	memcpy ( data, ( ring->data + offset ), frag_len );
+	memcpy ( ( data + frag_len ), ring->data, ( used - frag_len ) );
+	ring->cons += used;
+
+	return used;
+}
+
+/**
+ * Restart log ring buffer flush process
+ *
+ * @v ring		Log ring
+ *
+ * This should be called when a transmit method that previously
+ * failed to make progress may now be able to do so (e.g. when a
+ * flow control window opens).
+ */
+void log_ring_kick ( struct log_ring *ring ) {
+
+	if ( log_ring_fill ( ring ) )
+		process_add ( &ring->process );
+}
+
+/**
+ * Flush log ring buffer
+ *
+ * @v ring		Log ring
+ */
+static void log_ring_step ( struct log_ring *ring ) {
+
+	/* Stop process when ring is empty or no progress can be made */
+	if ( ( log_ring_fill ( ring ) == 0 ) || ( ring->flush ( ring ) != 0 ) )
+		process_del ( &ring->process );
+}
+
+/** Log ring buffer flush process descriptor */
+struct process_descriptor log_ring_process_desc =
+	PROC_DESC ( struct log_ring, process, log_ring_step );
+
+/**
+ * Flush all log ring buffers on shutdown
+ *
+ * @v booting		System is shutting down for OS boot
+ */
+static void log_ring_shutdown ( int booting __unused ) {
+	struct log_ring *ring;
+
+	/* Transmit as much as possible, since the flush processes
+	 * will never run again if we are about to boot an OS.
+	 */
+	for_each_table_entry ( ring, LOG_RINGS ) {
+		while ( log_ring_fill ( ring ) &&
+			( ring->flush ( ring ) == 0 ) ) {
+			/* Do nothing */
+		}
+		process_del ( &ring->process );
+	}
+}
+
+/** Log ring buffer shutdown function */
+struct startup_fn log_ring_startup_fn __startup_fn ( STARTUP_LATE ) = {
+	.shutdown = log_ring_shutdown,
+};
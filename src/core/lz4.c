@@ -0,0 +1,369 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <ipxe/lz4.h>
+
+/** @file
+ *
+ * LZ4 decompression algorithm
+ *
+ * LZ4 back-references may reach at most 64kB into the preceding
+ * output.  Since the output is decompressed directly into a single
+ * contiguous buffer, no separate sliding window is required.
+ *
+ * Both the LZ4 frame format and the legacy frame format (as used for
+ * Linux kernel and initramfs compression) are supported.  Header,
+ * block and content checksums are skipped over without being
+ * verified.
+ */
+
+/* Disambiguate the various error causes */
+#define EINVAL_HEADER __einfo_error ( EINFO_EINVAL_HEADER )
+#define EINFO_EINVAL_HEADER \
+	__einfo_uniqify ( EINFO_EINVAL, 0x01, "Invalid header" )
+#define EINVAL_TRUNCATED __einfo_error ( EINFO_EINVAL_TRUNCATED )
+#define EINFO_EINVAL_TRUNCATED \
+	__einfo_uniqify ( EINFO_EINVAL, 0x02, "Truncated data" )
+#define EINVAL_DISTANCE __einfo_error ( EINFO_EINVAL_DISTANCE )
+#define EINFO_EINVAL_DISTANCE \
+	__einfo_uniqify ( EINFO_EINVAL, 0x03, "Invalid back-reference" )
+#define ENOTSUP_VERSION __einfo_error ( EINFO_ENOTSUP_VERSION )
+#define EINFO_ENOTSUP_VERSION \
+	__einfo_uniqify ( EINFO_ENOTSUP, 0x01, "Unsupported version" )
+#define ENOTSUP_DICT __einfo_error ( EINFO_ENOTSUP_DICT )
+#define EINFO_ENOTSUP_DICT \
+	__einfo_uniqify ( EINFO_ENOTSUP, 0x02, "Dictionaries not supported" )
+#define ENOSPC_OUTPUT __einfo_error ( EINFO_ENOSPC_OUTPUT )
+#define EINFO_ENOSPC_OUTPUT \
+	__einfo_uniqify ( EINFO_ENOSPC, 0x01, "Output buffer too small" )
+
+/** An LZ4 decompression output buffer */
+struct lz4_output {
+	/** Data, or NULL to calculate length only */
+	uint8_t *data;
+	/** Current offset */
+	size_t offset;
+	/** Maximum length */
+	size_t len;
+};
+
+/**
+ * Read little-endian 32-bit value
+ *
+ * @v data		Data
+ * @ret value		Value
+ */
+static inline uint32_t lz4_le32 ( const uint8_t *data ) {
+	return ( data[0] | ( data[1] << 8 ) | ( data[2] << 16 ) |
+		 ( ( ( uint32_t ) data[3] ) << 24 ) );
+}
+
+/**
+ * Read extended length
+ *
+ * @v in		Input data pointer
+ * @v end		End of input data
+ * @v len		Length to extend
+ * @ret rc		Return status code
+ */
+static int lz4_length ( const uint8_t **in, const uint8_t *end,
+			size_t *len ) {
+	uint8_t byte;
+
+	do {
+		if ( *in >= end )
+			return -EINVAL_TRUNCATED;
+		byte = *((*in)++);
+		*len += byte;
+	} while ( byte == 0xff );
+
+	return 0;
+}
+
+/**
+ * Decompress LZ4 block
+ *
+ * @v in		Compressed block
+ * @v len		Length of compressed block
+ * @v out		Output buffer
+ * @ret rc		Return status code
+ */
+static int lz4_block ( const uint8_t *in, size_t len,
+		       struct lz4_output *out ) {
+	const uint8_t *end = ( in + len );
+	const uint8_t *src;
+	uint8_t *dst;
+	unsigned int token;
+	size_t literal_len;
+	size_t match_len;
+	size_t distance;
+	size_t i;
+	int rc;
+
+	while ( 1 ) {
+
+		/* Read token and literal length */
+		if ( in >= end )
+			return -EINVAL_TRUNCATED;
+		token = *(in++);
+		literal_len = ( token >> 4 );
+		if ( ( literal_len == 0x0f ) &&
+		     ( ( rc = lz4_length ( &in, end, &literal_len ) ) != 0 ) )
+			return rc;
+
+		/* Copy literals */
+		if ( literal_len > ( ( size_t ) ( end - in ) ) )
+			return -EINVAL_TRUNCATED;
+		if ( literal_len > ( out->len - out->offset ) )
+			return -ENOSPC_OUTPUT;
+		if ( out->data )
+			memcpy ( ( out->data + out->offset ), in, literal_len );
+		in += literal_len;
+		out->offset += literal_len;
+
+		/* The final sequence comprises only literals */
+		if ( in == end )
+			return 0;
+
+		/* Read match distance and length */
+		if ( ( end - in ) < 2 )
+			return -EINVAL_TRUNCATED;
+		distance = ( in[0] | ( in[1] << 8 ) );
+		in += 2;
+		if ( ( distance == 0 ) || ( distance > out->offset ) )
+			return -EINVAL_DISTANCE;
+		match_len = ( token & 0x0f );
+		if ( ( match_len == 0x0f ) &&
+		     ( ( rc = lz4_length ( &in, end, &match_len ) ) != 0 ) )
+			return rc;
+		match_len += LZ4_MIN_MATCH;
+
+		/* Copy back-reference.  The source and destination
+		 * may overlap, in which case the copy must proceed
+		 * one byte at a time.
+		 */
+		if ( match_len > ( out->len - out->offset ) )
+			return -ENOSPC_OUTPUT;
+		if ( out->data ) {
+			dst = ( out->data + out->offset );
+			src = ( dst - distance );
+			if ( distance >= match_len ) {
+				memcpy ( dst, src, match_len );
+			} else {
+				for ( i = 0 ; i < match_len ; i++ )
+					dst[i] = src[i];
+			}
+		}
+		out->offset += match_len;
+	}
+}
+
+/**
+ * Copy uncompressed LZ4 block
+ *
+ * @v in		Block data
+ * @v len		Length of block data
+ * @v out		Output buffer
+ * @ret rc		Return status code
+ */
+static int lz4_stored ( const uint8_t *in, size_t len,
+			struct lz4_output *out ) {
+
+	if ( len > ( out->len - out->offset ) )
+		return -ENOSPC_OUTPUT;
+	if ( out->data )
+		memcpy ( ( out->data + out->offset ), in, len );
+	out->offset += len;
+	return 0;
+}
+
+/**
+ * Decompress LZ4 frame
+ *
+ * @v in		Compressed data
+ * @v len		Length of compressed data
+ * @v out		Output buffer
+ * @ret used		Length consumed, or negative error
+ */
+static int lz4_frame ( const uint8_t *in, size_t len,
+		       struct lz4_output *out ) {
+	const uint8_t *start = in;
+	const uint8_t *end = ( in + len );
+	unsigned int flags;
+	size_t header_len;
+	size_t block_len;
+	uint32_t block;
+	int rc;
+
+	/* Parse frame descriptor */
+	if ( len < 7 /* magic, FLG, BD, HC */ )
+		return -EINVAL_TRUNCATED;
+	flags = in[4];
+	if ( ( flags & LZ4_FLG_VERSION_MASK ) != LZ4_FLG_VERSION )
+		return -ENOTSUP_VERSION;
+	if ( flags & LZ4_FLG_DICT_ID )
+		return -ENOTSUP_DICT;
+	header_len = ( 7 + ( ( flags & LZ4_FLG_CONTENT_SIZE ) ? 8 : 0 ) );
+	if ( len < header_len )
+		return -EINVAL_TRUNCATED;
+	in += header_len;
+
+	/* Process blocks until the end mark */
+	while ( 1 ) {
+		if ( ( end - in ) < 4 )
+			return -EINVAL_TRUNCATED;
+		block = lz4_le32 ( in );
+		in += 4;
+		if ( ! block )
+			break;
+		block_len = ( block & ~LZ4_BLOCK_UNCOMPRESSED );
+		if ( block_len > ( ( size_t ) ( end - in ) ) )
+			return -EINVAL_TRUNCATED;
+		if ( block & LZ4_BLOCK_UNCOMPRESSED ) {
+			rc = lz4_stored ( in, block_len, out );
+		} else {
+			rc = lz4_block ( in, block_len, out );
+		}
+		if ( rc != 0 )
+			return rc;
+		in += block_len;
+		if ( flags & LZ4_FLG_BLOCK_CHECKSUM ) {
+			if ( ( end - in ) < 4 )
+				return -EINVAL_TRUNCATED;
+			in += 4;
+		}
+	}
+
+	/* Skip content checksum, if present */
+	if ( flags & LZ4_FLG_CONTENT_CHECKSUM ) {
+		if ( ( end - in ) < 4 )
+			return -EINVAL_TRUNCATED;
+		in += 4;
+	}
+
+	return ( in - start );
+}
+
+/**
+ * Decompress LZ4 legacy frame
+ *
+ * @v in		Compressed data
+ * @v len		Length of compressed data
+ * @v out		Output buffer
+ * @ret used		Length consumed, or negative error
+ *
+ * A legacy frame has no end mark, and is terminated either by the
+ * end of the data or by the start of a subsequent frame.
+ */
+static int lz4_legacy ( const uint8_t *in, size_t len,
+			struct lz4_output *out ) {
+	const uint8_t *start = in;
+	const uint8_t *end = ( in + len );
+	size_t block_start;
+	uint32_t block;
+	int rc;
+
+	/* Skip magic number */
+	in += 4;
+
+	/* Process blocks */
+	while ( ( end - in ) >= 4 ) {
+		block = lz4_le32 ( in );
+		if ( ( block == 0 ) || ( block == LZ4_MAGIC ) ||
+		     ( block == LZ4_LEGACY_MAGIC ) ||
+		     ( ( block & LZ4_SKIPPABLE_MASK ) ==
+		       LZ4_SKIPPABLE_MAGIC ) )
+			break;
+		in += 4;
+		if ( block > ( ( size_t ) ( end - in ) ) )
+			return -EINVAL_TRUNCATED;
+		block_start = out->offset;
+		if ( ( rc = lz4_block ( in, block, out ) ) != 0 )
+			return rc;
+		if ( ( out->offset - block_start ) > LZ4_LEGACY_BLOCK_MAX )
+			return -EINVAL_HEADER;
+		in += block;
+	}
+
+	return ( in - start );
+}
+
+/**
+ * Decompress LZ4 data
+ *
+ * @v data		Compressed data
+ * @v len		Length of compressed data
+ * @v buf		Output buffer, or NULL to calculate length only
+ * @v out_len		Output buffer length (updated on return)
+ * @ret rc		Return status code
+ *
+ * The compressed data may comprise any number of concatenated
+ * frames.  Any trailing data following a complete frame (such as
+ * zero padding) is ignored.  Calling this function with a NULL
+ * output buffer will calculate the length of the decompressed data,
+ * allowing a suitable output buffer to be allocated.
+ */
+int lz4_decompress ( const void *data, size_t len, void *buf,
+		     size_t *out_len ) {
+	const uint8_t *in = data;
+	const uint8_t *end = ( in + len );
+	struct lz4_output out;
+	unsigned int frames = 0;
+	uint32_t magic;
+	int used;
+
+	/* Initialise output buffer */
+	out.data = buf;
+	out.offset = 0;
+	out.len = ( buf ? *out_len : ~( ( size_t ) 0 ) );
+
+	/* Process frames */
+	while ( ( end - in ) >= 4 ) {
+		magic = lz4_le32 ( in );
+		if ( magic == LZ4_MAGIC ) {
+			used = lz4_frame ( in, ( end - in ), &out );
+		} else if ( magic == LZ4_LEGACY_MAGIC ) {
+			used = lz4_legacy ( in, ( end - in ), &out );
+		} else if ( ( magic & LZ4_SKIPPABLE_MASK ) ==
+			    LZ4_SKIPPABLE_MAGIC ) {
+			if ( ( end - in ) < 8 )
+				return -EINVAL_TRUNCATED;
+			if ( lz4_le32 ( in + 4 ) >
+			     ( ( size_t ) ( end - in - 8 ) ) )
+				return -EINVAL_TRUNCATED;
+			used = ( 8 + lz4_le32 ( in + 4 ) );
+		} else {
+			break;
+		}
+		if ( used < 0 )
+			return used;
+		in += used;
+		frames++;
+	}
+	if ( ! frames )
+		return -EINVAL_HEADER;
+
+	*out_len = out.offset;
+	return 0;
+}
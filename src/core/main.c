@@ -17,6 +17,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <stdio.h>
 #include <stdlib.h>
 #include <ipxe/init.h>
+#include <ipxe/device.h>
 #include <ipxe/features.h>
 #include <ipxe/shell.h>
 #include <ipxe/image.h>
@@ -91,15 +92,18 @@ __asmcall int main ( void ) {
 	/* Boot system */
 	if ( ( image = first_image() ) != NULL ) {
 		/* We have an embedded image; execute it */
+		probe_deferred_devices();
 		image_exec ( image );
 	} else if ( shell_banner() ) {
 		/* User wants shell; just give them a shell */
+		probe_deferred_devices();
 		shell();
 	} else {
 		fetch_string_setting_copy ( NULL, &scriptlet_setting,
 					    &scriptlet );
 		if ( scriptlet ) {
 			/* User has defined a scriptlet; execute it */
+			probe_deferred_devices();
 			system ( scriptlet );
 			free ( scriptlet );
 		} else {
@@ -107,8 +111,10 @@ __asmcall int main ( void ) {
 			 * user another chance to enter the shell.
 			 */
 			autoboot();
-			if ( shell_banner() )
+			if ( shell_banner() ) {
+				probe_deferred_devices();
 				shell();
+			}
 		}
 	}
 
@@ -27,6 +27,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/init.h>
 #include <ipxe/refcnt.h>
 #include <ipxe/malloc.h>
+#include <ipxe/umalloc.h>
 #include <valgrind/memcheck.h>
 
 /** @file
@@ -50,8 +51,10 @@ struct memory_block {
 	 */
 	char pad[ offsetof ( struct refcnt, count ) +
 		  sizeof ( ( ( struct refcnt * ) NULL )->count ) ];
-	/** List of free blocks */
+	/** List of free blocks, in address order */
 	struct list_head list;
+	/** List of free blocks within the same size class */
+	struct list_head bin;
 };
 
 #define MIN_MEMBLOCK_SIZE \
@@ -85,19 +88,46 @@ struct autosized_block {
 /** List of free memory blocks */
 static LIST_HEAD ( free_blocks );
 
+/**
+ * Number of free block size classes
+ *
+ * Size class @c n holds free blocks whose size lies within the range
+ * [ MIN_MEMBLOCK_SIZE << n, MIN_MEMBLOCK_SIZE << ( n + 1 ) ).  The
+ * final size class holds all larger blocks.
+ */
+#define MEMBLOCK_BINS 16
+
+/** Free memory blocks, segregated by size class */
+static struct list_head free_bins[MEMBLOCK_BINS];
+
 /** Total amount of free memory */
 size_t freemem;
 
 /**
- * Heap size
+ * Initial heap size
  *
- * Currently fixed at 128kB.
+ * The heap starts as a static 128kB region, and is grown on demand
+ * using external memory.
  */
 #define HEAP_SIZE ( 128 * 1024 )
 
-/** The heap itself */
+/** The initial heap */
 static char heap[HEAP_SIZE] __attribute__ (( aligned ( __alignof__(void *) )));
 
+/**
+ * Heap growth granularity
+ *
+ * External memory is added to the heap in multiples of this size,
+ * to limit the number of separate regions.
+ */
+#define HEAP_GROW_SIZE ( 1024 * 1024 )
+
+/** Total amount of external memory added to the heap */
+static size_t heap_grown;
+
+/** Heap growth has been disabled */
+static int heap_fixed;
+
 /**
  * Mark all blocks in free list as defined
  *
@@ -129,6 +159,39 @@ static inline void valgrind_make_blocks_noaccess ( void ) {
 	}
 }
 
+/**
+ * Get size class for a free memory block
+ *
+ * @v size		Size of block
+ * @ret bin		Size class
+ */
+static inline unsigned int memblock_bin ( size_t size ) {
+	unsigned int bin;
+
+	bin = ( fls ( size ) - fls ( MIN_MEMBLOCK_SIZE ) );
+	if ( bin >= MEMBLOCK_BINS )
+		bin = ( MEMBLOCK_BINS - 1 );
+	return bin;
+}
+
+/**
+ * Add free memory block to its size class
+ *
+ * @v block		Free memory block
+ */
+static inline void memblock_bin_add ( struct memory_block *block ) {
+	list_add ( &block->bin, &free_bins[ memblock_bin ( block->size ) ] );
+}
+
+/**
+ * Remove free memory block from its size class
+ *
+ * @v block		Free memory block
+ */
+static inline void memblock_bin_del ( struct memory_block *block ) {
+	list_del ( &block->bin );
+}
+
 /**
  * Discard some cached data
  *
@@ -136,12 +199,70 @@ static inline void valgrind_make_blocks_noaccess ( void ) {
  */
 static unsigned int discard_cache ( void ) {
 	struct cache_discarder *discarder;
-	unsigned int discarded = 0;
+	unsigned int discarded;
 
+	/* Discard from the cheapest cache that still holds any data */
 	for_each_table_entry ( discarder, CACHE_DISCARDERS ) {
-		discarded += discarder->discard();
+		discarded = discarder->discard();
+		if ( discarded ) {
+			discarder->discarded += discarded;
+			return discarded;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Grow heap using external memory
+ *
+ * @v size		Size of block that could not be allocated
+ * @v align_mask	Alignment mask for block
+ * @ret grown		Heap has been grown
+ *
+ * External memory is never returned, since a region cannot be
+ * removed from the heap once blocks have been allocated from it.
+ *
+ * Heap memory may be used for DMA by devices capable of only 32-bit
+ * addressing.  umalloc() provides no way to constrain the address of
+ * the allocated region, so any region extending above 4GB is freed
+ * and the heap is not grown.
+ */
+static int heap_grow ( size_t size, size_t align_mask ) {
+	userptr_t region;
+	physaddr_t end;
+	size_t len;
+	void *start;
+
+	/* Do nothing if heap growth has been disabled */
+	if ( heap_fixed )
+		return 0;
+
+	/* Allocate a region large enough for any alignment padding */
+	len = ( ( size + align_mask + HEAP_GROW_SIZE ) &
+		~( HEAP_GROW_SIZE - 1 ) );
+	region = umalloc ( len );
+	if ( ! region ) {
+		DBG ( "Could not grow heap by %#zx\n", len );
+		return 0;
 	}
-	return discarded;
+	start = user_to_virt ( region, 0 );
+
+	/* Refuse any region that is not 32-bit addressable */
+	end = virt_to_phys ( start + len - 1 );
+	if ( end & ~0xffffffffULL ) {
+		DBG ( "Cannot grow heap with [%p,%p) above 4GB\n",
+		      start, ( start + len ) );
+		ufree ( region );
+		return 0;
+	}
+
+	/* Add region to heap */
+	DBG ( "Growing heap with [%p,%p)\n", start, ( start + len ) );
+	VALGRIND_MAKE_MEM_NOACCESS ( start, len );
+	mpopulate ( start, len );
+	heap_grown += len;
+
+	return 1;
 }
 
 /**
@@ -164,6 +285,7 @@ void * alloc_memblock ( size_t size, size_t align ) {
 	struct memory_block *pre;
 	struct memory_block *post;
 	struct memory_block *ptr;
+	unsigned int bin;
 
 	valgrind_make_blocks_defined();
 
@@ -175,58 +297,29 @@ void * alloc_memblock ( size_t size, size_t align ) {
 
 	DBG ( "Allocating %#zx (aligned %#zx)\n", size, align );
 	while ( 1 ) {
-		/* Search through blocks for the first one with enough space */
-		list_for_each_entry ( block, &free_blocks, list ) {
-			pre_size = ( - virt_to_phys ( block ) ) & align_mask;
-			post_size = block->size - pre_size - size;
-			if ( post_size >= 0 ) {
-				/* Split block into pre-block, block, and
-				 * post-block.  After this split, the "pre"
-				 * block is the one currently linked into the
-				 * free list.
-				 */
-				pre   = block;
-				block = ( ( ( void * ) pre   ) + pre_size );
-				post  = ( ( ( void * ) block ) + size     );
-				DBG ( "[%p,%p) -> [%p,%p) + [%p,%p)\n", pre,
-				      ( ( ( void * ) pre ) + pre->size ),
-				      pre, block, post,
-				      ( ( ( void * ) pre ) + pre->size ) );
-				/* If there is a "post" block, add it in to
-				 * the free list.  Leak it if it is too small
-				 * (which can happen only at the very end of
-				 * the heap).
-				 */
-				if ( (size_t) post_size >= MIN_MEMBLOCK_SIZE ) {
-					VALGRIND_MAKE_MEM_DEFINED ( post,
-							     sizeof ( *post ) );
-					post->size = post_size;
-					list_add ( &post->list, &pre->list );
-				}
-				/* Shrink "pre" block, leaving the main block
-				 * isolated and no longer part of the free
-				 * list.
-				 */
-				pre->size = pre_size;
-				/* If there is no "pre" block, remove it from
-				 * the list.  Also remove it (i.e. leak it) if
-				 * it is too small, which can happen only at
-				 * the very start of the heap.
-				 */
-				if ( pre_size < MIN_MEMBLOCK_SIZE )
-					list_del ( &pre->list );
-				/* Update total free memory */
-				freemem -= size;
-				/* Return allocated block */
-				DBG ( "Allocated [%p,%p)\n", block,
-				      ( ( ( void * ) block ) + size ) );
-				ptr = block;
-				goto done;
+		/* Search through size classes, starting with the
+		 * smallest class that could contain a large enough
+		 * block, for the first block with enough space.  Any
+		 * block in a higher size class is large enough unless
+		 * alignment padding is required, so this search
+		 * will almost always terminate at the first block
+		 * examined in a non-empty higher size class.
+		 */
+		for ( bin = memblock_bin ( size ) ; bin < MEMBLOCK_BINS ;
+		      bin++ ) {
+			list_for_each_entry ( block, &free_bins[bin], bin ) {
+				pre_size = ( ( - virt_to_phys ( block ) ) &
+					     align_mask );
+				post_size = ( block->size - pre_size - size );
+				if ( post_size >= 0 )
+					goto found;
 			}
 		}
 
-		/* Try discarding some cached data to free up memory */
-		if ( ! discard_cache() ) {
+		/* Try growing the heap, or (failing that) discarding
+		 * some cached data, to free up memory.
+		 */
+		if ( ! ( heap_grow ( size, align_mask ) || discard_cache() ) ) {
 			/* Nothing available to discard */
 			DBG ( "Failed to allocate %#zx (aligned %#zx)\n",
 			      size, align );
@@ -235,6 +328,50 @@ void * alloc_memblock ( size_t size, size_t align ) {
 		}
 	}
 
+ found:
+	/* Split block into pre-block, block, and post-block.  After
+	 * this split, the "pre" block is the one currently linked
+	 * into the free list.
+	 */
+	pre   = block;
+	block = ( ( ( void * ) pre   ) + pre_size );
+	post  = ( ( ( void * ) block ) + size     );
+	DBG ( "[%p,%p) -> [%p,%p) + [%p,%p)\n", pre,
+	      ( ( ( void * ) pre ) + pre->size ), pre, block, post,
+	      ( ( ( void * ) pre ) + pre->size ) );
+	/* The "pre" block is about to change size, and so may no
+	 * longer belong in its current size class.
+	 */
+	memblock_bin_del ( pre );
+	/* If there is a "post" block, add it in to the free list.
+	 * Leak it if it is too small (which can happen only at the
+	 * very end of the heap).
+	 */
+	if ( (size_t) post_size >= MIN_MEMBLOCK_SIZE ) {
+		VALGRIND_MAKE_MEM_DEFINED ( post, sizeof ( *post ) );
+		post->size = post_size;
+		list_add ( &post->list, &pre->list );
+		memblock_bin_add ( post );
+	}
+	/* Shrink "pre" block, leaving the main block isolated and no
+	 * longer part of the free list.
+	 */
+	pre->size = pre_size;
+	/* If there is no "pre" block, remove it from the list.  Also
+	 * remove it (i.e. leak it) if it is too small, which can
+	 * happen only at the very start of the heap.
+	 */
+	if ( pre_size < MIN_MEMBLOCK_SIZE ) {
+		list_del ( &pre->list );
+	} else {
+		memblock_bin_add ( pre );
+	}
+	/* Update total free memory */
+	freemem -= size;
+	/* Return allocated block */
+	DBG ( "Allocated [%p,%p)\n", block, ( ( ( void * ) block ) + size ) );
+	ptr = block;
+
  done:
 	valgrind_make_blocks_noaccess();
 	return ptr;
@@ -285,6 +422,7 @@ void free_memblock ( void *ptr, size_t size ) {
 			      ( ( ( void * ) freeing ) + freeing->size ) );
 			block->size += size;
 			list_del ( &block->list );
+			memblock_bin_del ( block );
 			freeing = block;
 		}
 		/* Stop processing as soon as we reach a following block */
@@ -305,7 +443,9 @@ void free_memblock ( void *ptr, size_t size ) {
 		      ( ( ( void * ) block ) + block->size ) );
 		freeing->size += block->size;
 		list_del ( &block->list );
+		memblock_bin_del ( block );
 	}
+	memblock_bin_add ( freeing );
 
 	/* Update free memory counter */
 	freemem += size;
@@ -444,11 +584,48 @@ void mpopulate ( void *start, size_t len ) {
 	free_memblock ( start, ( len & ~( MIN_MEMBLOCK_SIZE - 1 ) ) );
 }
 
+/**
+ * Get DMA pool
+ *
+ * @v len		Length of DMA pool to fill in
+ * @ret start		Start of DMA pool, or NULL if not a single pool
+ *
+ * All memory returned by malloc_dma() (including all descriptor rings
+ * and I/O buffers) lies within the heap.  Until the heap has been
+ * grown, this is a single physically contiguous region.  Platforms
+ * that require DMA buffers to be explicitly mapped for a device may
+ * therefore map the whole pool once, rather than mapping each
+ * individual buffer, and then call heap_fix() to ensure that the
+ * pool remains the only source of DMA buffers.
+ */
+void * dma_pool ( size_t *len ) {
+
+	/* Fail if the heap is no longer a single region */
+	if ( heap_grown )
+		return NULL;
+
+	*len = sizeof ( heap );
+	return heap;
+}
+
+/**
+ * Disable heap growth
+ *
+ */
+void heap_fix ( void ) {
+
+	heap_fixed = 1;
+}
+
 /**
  * Initialise the heap
  *
  */
 static void init_heap ( void ) {
+	unsigned int i;
+
+	for ( i = 0 ; i < MEMBLOCK_BINS ; i++ )
+		INIT_LIST_HEAD ( &free_bins[i] );
 	VALGRIND_MAKE_MEM_NOACCESS ( heap, sizeof ( heap ) );
 	mpopulate ( heap, sizeof ( heap ) );
 }
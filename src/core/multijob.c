@@ -0,0 +1,235 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <ipxe/process.h>
+#include <ipxe/console.h>
+#include <ipxe/keys.h>
+#include <ipxe/job.h>
+#include <ipxe/multijob.h>
+
+/** @file
+ *
+ * Concurrent background jobs
+ *
+ * A background job is started in the same way as a foreground job
+ * (by plugging a job control interface into the job), but does not
+ * block the caller.  Background jobs continue to run whenever the
+ * process scheduler runs, and may be waited upon via multijob_wait().
+ *
+ */
+
+/** List of background jobs */
+static LIST_HEAD ( multijobs );
+
+/**
+ * Free background job
+ *
+ * @v refcnt		Reference count
+ */
+static void multijob_free ( struct refcnt *refcnt ) {
+	struct multijob *mj = container_of ( refcnt, struct multijob, refcnt );
+
+	free ( mj );
+}
+
+/**
+ * Handle completion of background job
+ *
+ * @v mj		Background job
+ * @v rc		Reason for completion
+ */
+static void multijob_close ( struct multijob *mj, int rc ) {
+
+	/* Ignore duplicate completions */
+	if ( mj->rc != -EINPROGRESS )
+		return;
+
+	/* Shut down job control interface */
+	intf_restart ( &mj->job, rc );
+
+	/* Record final status, allowing owner to override it */
+	if ( mj->complete )
+		rc = mj->complete ( mj, rc );
+	mj->rc = rc;
+	DBGC ( mj, "MULTIJOB %p \"%s\" complete: %s\n",
+	       mj, mj->name, strerror ( rc ) );
+}
+
+/** Background job control interface operations */
+static struct interface_operation multijob_op[] = {
+	INTF_OP ( intf_close, struct multijob *, multijob_close ),
+};
+
+/** Background job control interface descriptor */
+static struct interface_descriptor multijob_desc =
+	INTF_DESC ( struct multijob, job, multijob_op );
+
+/**
+ * Allocate background job
+ *
+ * @v name		Job description
+ * @v priv_len		Length of private data
+ * @ret mj		Background job, or NULL on error
+ *
+ * The caller should plug the job control interface into the job to
+ * be run, and then call multijob_start().
+ */
+struct multijob * multijob_alloc ( const char *name, size_t priv_len ) {
+	struct multijob *mj;
+	size_t name_len = ( strlen ( name ) + 1 /* NUL */ );
+
+	mj = zalloc ( sizeof ( *mj ) + priv_len + name_len );
+	if ( ! mj )
+		return NULL;
+	ref_init ( &mj->refcnt, multijob_free );
+	intf_init ( &mj->job, &multijob_desc, &mj->refcnt );
+	INIT_LIST_HEAD ( &mj->list );
+	mj->priv = ( ( ( void * ) mj ) + sizeof ( *mj ) );
+	mj->name = ( mj->priv + priv_len );
+	memcpy ( mj->name, name, name_len );
+	mj->rc = -EINPROGRESS;
+
+	return mj;
+}
+
+/**
+ * Start background job
+ *
+ * @v mj		Background job
+ *
+ * The caller's reference to the background job is transferred to the
+ * list of background jobs.
+ */
+void multijob_start ( struct multijob *mj ) {
+
+	list_add_tail ( &mj->list, &multijobs );
+	DBGC ( mj, "MULTIJOB %p \"%s\" started\n", mj, mj->name );
+}
+
+/**
+ * Remove completed background job
+ *
+ * @v mj		Background job
+ * @ret rc		Job final status code
+ */
+static int multijob_reap ( struct multijob *mj ) {
+	int rc = mj->rc;
+
+	printf ( "%s... %s\n", mj->name, ( rc ? strerror ( rc ) : "ok" ) );
+	list_del ( &mj->list );
+	multijob_put ( mj );
+	return rc;
+}
+
+/**
+ * Get background job progress
+ *
+ * @v mj		Background job
+ * @v progress		Progress report to fill in
+ */
+void multijob_progress ( struct multijob *mj,
+			 struct job_progress *progress ) {
+
+	memset ( progress, 0, sizeof ( *progress ) );
+	if ( mj->rc == -EINPROGRESS )
+		job_progress ( &mj->job, progress );
+}
+
+/**
+ * Display background job status
+ *
+ */
+void multijob_list ( void ) {
+	struct multijob *mj;
+	struct job_progress progress;
+	unsigned long completed;
+	unsigned long total;
+
+	list_for_each_entry ( mj, &multijobs, list ) {
+		printf ( "%s: ", mj->name );
+		if ( mj->rc == -EINPROGRESS ) {
+			multijob_progress ( mj, &progress );
+			/* Normalise progress figures to avoid overflow */
+			completed = ( progress.completed / 128 );
+			total = ( progress.total / 128 );
+			if ( total ) {
+				printf ( "%lu%%\n", ( ( 100 * completed ) /
+						     total ) );
+			} else {
+				printf ( "running\n" );
+			}
+		} else {
+			printf ( "%s\n", ( mj->rc ? strerror ( mj->rc ) :
+					   "complete" ) );
+		}
+	}
+}
+
+/**
+ * Wait for background jobs to complete
+ *
+ * @v any		Return as soon as any job has completed
+ * @ret rc		Return status code
+ *
+ * Each completed job is reported and removed from the list of
+ * background jobs.  If @c any is zero, this waits for all background
+ * jobs to complete and returns the first failure (if any).  If @c any
+ * is non-zero, this waits until at least one job has completed and
+ * returns the status of the first completed job.
+ *
+ * Pressing Ctrl-C cancels all outstanding background jobs.
+ */
+int multijob_wait ( int any ) {
+	struct multijob *mj;
+	struct multijob *tmp;
+	unsigned int reaped = 0;
+	int job_rc;
+	int rc = 0;
+
+	while ( ! list_empty ( &multijobs ) ) {
+
+		/* Remove any completed jobs */
+		list_for_each_entry_safe ( mj, tmp, &multijobs, list ) {
+			if ( mj->rc == -EINPROGRESS )
+				continue;
+			job_rc = multijob_reap ( mj );
+			if ( any ? ( reaped == 0 ) : ( rc == 0 ) )
+				rc = job_rc;
+			reaped++;
+		}
+		if ( any && reaped )
+			break;
+
+		/* Allow jobs to progress */
+		step();
+
+		/* Cancel all jobs on Ctrl-C */
+		if ( iskey() && ( getchar() == CTRL_C ) ) {
+			list_for_each_entry ( mj, &multijobs, list )
+				multijob_close ( mj, -ECANCELED );
+		}
+	}
+
+	return rc;
+}
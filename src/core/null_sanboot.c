@@ -21,8 +21,10 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <errno.h>
 #include <ipxe/sanboot.h>
 
-static int null_san_hook ( struct uri *uri __unused,
-			   unsigned int drive __unused ) {
+static int null_san_hook ( struct uri **uris __unused,
+			   unsigned int count __unused,
+			   unsigned int drive __unused,
+			   unsigned int flags __unused ) {
 	return -EOPNOTSUPP;
 }
 
@@ -77,6 +77,7 @@ static int nvo_realloc ( struct nvo_block *nvo, size_t len ) {
 		nvo->dhcpopts.data = NULL;
 		nvo->dhcpopts.used_len = 0;
 		nvo->dhcpopts.alloc_len = 0;
+		nvo->dhcpopts.indexed = 0;
 	}
 
 	return 0;
@@ -26,6 +26,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/xfer.h>
 #include <ipxe/open.h>
 #include <ipxe/process.h>
+#include <ipxe/malloc.h>
 #include <ipxe/posix_io.h>
 
 /** @file
@@ -37,6 +38,17 @@ FILE_LICENCE ( GPL2_OR_LATER );
  * they may not be used by most other portions of the iPXE codebase.
  */
 
+/**
+ * Maximum amount of received data to queue for an open file
+ *
+ * Data that has been received but not yet read by the caller is held
+ * in the heap.  The flow control window offered to the data source is
+ * limited so that a caller that reads slowly (or not at all) cannot
+ * cause the heap to be exhausted.  The window is further limited
+ * according to the amount of free heap memory.
+ */
+#define POSIX_MAX_QUEUED ( 32 * 1024 )
+
 /** An open file */
 struct posix_file {
 	/** Reference count for this object */
@@ -58,6 +70,14 @@ struct posix_file {
 	size_t filesize;
 	/** Received data queue */
 	struct list_head data;
+	/** Length of data in received data queue */
+	size_t queued;
+	/** Direct read buffer, if any */
+	userptr_t rx_buffer;
+	/** Length of direct read buffer */
+	size_t rx_len;
+	/** Length of data written to direct read buffer */
+	size_t rx_filled;
 };
 
 /** List of open files */
@@ -103,6 +123,7 @@ static void posix_file_finished ( struct posix_file *file, int rc ) {
 static int posix_file_xfer_deliver ( struct posix_file *file,
 				     struct io_buffer *iobuf,
 				     struct xfer_metadata *meta ) {
+	size_t len;
 
 	/* Keep track of file position solely for the filesize */
 	if ( meta->flags & XFER_FL_ABS_OFFSET )
@@ -111,7 +132,23 @@ static int posix_file_xfer_deliver ( struct posix_file *file,
 	if ( file->filesize < file->pos )
 		file->filesize = file->pos;
 
+	/* Copy directly to caller's buffer, if a read is in progress
+	 * and no earlier data remains queued.
+	 */
+	if ( ( file->rx_buffer != UNULL ) && list_empty ( &file->data ) ) {
+		len = iob_len ( iobuf );
+		if ( len > ( file->rx_len - file->rx_filled ) )
+			len = ( file->rx_len - file->rx_filled );
+		copy_to_user ( file->rx_buffer, file->rx_filled,
+			       iobuf->data, len );
+		iob_pull ( iobuf, len );
+		file->rx_filled += len;
+		file->pos += len;
+	}
+
+	/* Queue any remaining data */
 	if ( iob_len ( iobuf ) ) {
+		file->queued += iob_len ( iobuf );
 		list_add_tail ( &iobuf->list, &file->data );
 	} else {
 		free_iob ( iobuf );
@@ -120,9 +157,30 @@ static int posix_file_xfer_deliver ( struct posix_file *file,
 	return 0;
 }
 
+/**
+ * Check file data transfer flow control window
+ *
+ * @v file		POSIX file
+ * @ret len		Length of window
+ */
+static size_t posix_file_xfer_window ( struct posix_file *file ) {
+	size_t budget;
+
+	/* Limit queued data according to the memory budget */
+	budget = POSIX_MAX_QUEUED;
+	if ( budget > ( freemem / 4 ) )
+		budget = ( freemem / 4 );
+
+	/* Allow for any space remaining in a direct read buffer */
+	budget += ( file->rx_len - file->rx_filled );
+
+	return ( ( budget > file->queued ) ? ( budget - file->queued ) : 0 );
+}
+
 /** POSIX file data transfer interface operations */
 static struct interface_operation posix_file_xfer_operations[] = {
 	INTF_OP ( xfer_deliver, struct posix_file *, posix_file_xfer_deliver ),
+	INTF_OP ( xfer_window, struct posix_file *, posix_file_xfer_window ),
 	INTF_OP ( intf_close, struct posix_file *, posix_file_finished ),
 };
 
@@ -255,11 +313,21 @@ int select ( fd_set *readfds, int wait ) {
  * @ret len		Actual length read, or negative error number
  *
  * This call is non-blocking; if no data is available to read then
- * -EWOULDBLOCK will be returned.
+ * -EWOULDBLOCK will be returned.  All data already received (up to
+ * the maximum length) is returned, rather than only the contents of
+ * a single received packet, so that large reads do not require a
+ * separate call for each packet.
+ *
+ * If the queued data does not fill the buffer, then the network is
+ * polled for as long as new data continues to arrive, and this data
+ * is copied directly into the buffer without first being queued.
  */
 ssize_t read_user ( int fd, userptr_t buffer, off_t offset, size_t max_len ) {
 	struct posix_file *file;
 	struct io_buffer *iobuf;
+	struct io_buffer *tmp;
+	size_t total = 0;
+	size_t prev;
 	size_t len;
 
 	/* Identify file */
@@ -267,25 +335,51 @@ ssize_t read_user ( int fd, userptr_t buffer, off_t offset, size_t max_len ) {
 	if ( ! file )
 		return -EBADF;
 
-	/* Try to fetch more data if none available */
-	if ( list_empty ( &file->data ) )
-		step();
-
-	/* Dequeue at most one received I/O buffer into user buffer */
-	list_for_each_entry ( iobuf, &file->data, list ) {
+	/* Dequeue as many received I/O buffers as will fit into user
+	 * buffer
+	 */
+	list_for_each_entry_safe ( iobuf, tmp, &file->data, list ) {
+		if ( total == max_len )
+			break;
 		len = iob_len ( iobuf );
-		if ( len > max_len )
-			len = max_len;
-		copy_to_user ( buffer, offset, iobuf->data, len );
+		if ( len > ( max_len - total ) )
+			len = ( max_len - total );
+		copy_to_user ( buffer, ( offset + total ), iobuf->data, len );
 		iob_pull ( iobuf, len );
 		if ( ! iob_len ( iobuf ) ) {
 			list_del ( &iobuf->list );
 			free_iob ( iobuf );
 		}
+		file->queued -= len;
 		file->pos += len;
-		assert ( len != 0 );
-		return len;
+		total += len;
+	}
+
+	/* Receive directly into remainder of user buffer for as long
+	 * as new data continues to arrive.  The window will have
+	 * opened by at least the remaining buffer length.
+	 */
+	if ( ( total < max_len ) && ( file->rc == -EINPROGRESS ) ) {
+		file->rx_buffer = userptr_add ( buffer, ( offset + total ) );
+		file->rx_len = ( max_len - total );
+		file->rx_filled = 0;
+		xfer_window_changed ( &file->xfer );
+		do {
+			prev = file->rx_filled;
+			step();
+		} while ( ( file->rx_filled != prev ) &&
+			  ( file->rx_filled < file->rx_len ) &&
+			  ( file->rc == -EINPROGRESS ) );
+		total += file->rx_filled;
+		file->rx_buffer = UNULL;
+		file->rx_len = 0;
+		file->rx_filled = 0;
+	} else if ( total ) {
+		/* Window has opened by the length of data dequeued */
+		xfer_window_changed ( &file->xfer );
 	}
+	if ( total )
+		return total;
 
 	/* If file has completed, return (after returning all data) */
 	if ( file->rc != -EINPROGRESS ) {
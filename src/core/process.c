@@ -21,6 +21,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/list.h>
 #include <ipxe/init.h>
 #include <ipxe/process.h>
+#include <ipxe/profstat.h>
 
 /** @file
  *
@@ -87,14 +88,29 @@ void process_del ( struct process *process ) {
 /**
  * Single-step a single process
  *
- * This executes a single step of the first process in the run queue,
- * and moves the process to the end of the run queue.
+ * This executes a single step of each priority process, followed by a
+ * single step of the first process in the run queue, and moves the
+ * process to the end of the run queue.
+ *
+ * Priority processes (such as the network stack) therefore run once
+ * per step, rather than once per cycle through the run queue, however
+ * many other processes are running.
  */
 void step ( void ) {
 	struct process *process;
 	struct process_descriptor *desc;
+	union profiler profiler;
 	void *object;
 
+	for_each_table_entry ( process, PRIORITY_PROCESSES ) {
+		DBGC2 ( PROC_COL ( process ), "PROCESS " PROC_FMT
+			" executing (priority)\n", PROC_DBG ( process ) );
+		desc = process->desc;
+		profstat_start ( &profiler );
+		desc->step ( process_object ( process ) );
+		profstat_stop ( &profiler, "process", desc->step, NULL, 0 );
+	}
+
 	if ( ( process = list_first_entry ( &run_queue, struct process,
 					    list ) ) ) {
 		ref_get ( process->refcnt ); /* Inhibit destruction mid-step */
@@ -108,13 +124,34 @@ void step ( void ) {
 		}
 		DBGC2 ( PROC_COL ( process ), "PROCESS " PROC_FMT
 			" executing\n", PROC_DBG ( process ) );
+		profstat_start ( &profiler );
 		desc->step ( object );
+		profstat_stop ( &profiler, "process", desc->step, NULL, 0 );
 		DBGC2 ( PROC_COL ( process ), "PROCESS " PROC_FMT
 			" finished executing\n", PROC_DBG ( process ) );
 		ref_put ( process->refcnt ); /* Allow destruction */
 	}
 }
 
+/**
+ * Check whether or not any process has work pending
+ *
+ * @ret busy		A non-permanent process is runnable
+ *
+ * Permanent processes (such as the network stack) are always present
+ * in the run queue, and so are ignored.
+ */
+int process_busy ( void ) {
+	struct process *process;
+
+	list_for_each_entry ( process, &run_queue, list ) {
+		if ( ( process < table_start ( PERMANENT_PROCESSES ) ) ||
+		     ( process >= table_end ( PERMANENT_PROCESSES ) ) )
+			return 1;
+	}
+	return 0;
+}
+
 /**
  * Initialise processes
  *
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <string.h>
+#include <ipxe/profstat.h>
+
+/** @file
+ *
+ * Profiling statistics
+ *
+ * Statistics are accumulated per identifying key (e.g. per network
+ * protocol or per process descriptor) within a small fixed-size hash
+ * table, so that recording a statistic never allocates memory.
+ * Elapsed times are inclusive of any nested profiled calls.
+ */
+
+/** Profiling statistics */
+struct profile_stat profile_stats[PROFSTAT_MAX];
+
+/**
+ * Find profiling statistic
+ *
+ * @v key		Identifying key
+ * @ret stat		Profiling statistic (possibly unused), or NULL
+ */
+static struct profile_stat * profstat_find ( const void *key ) {
+	unsigned int index = ( ( ( intptr_t ) key ) >> 3 );
+	struct profile_stat *stat;
+	unsigned int i;
+
+	for ( i = 0 ; i < PROFSTAT_MAX ; i++ ) {
+		stat = &profile_stats[ ( index + i ) % PROFSTAT_MAX ];
+		if ( ( stat->key == key ) || ( ! stat->type ) )
+			return stat;
+	}
+	return NULL;
+}
+
+/**
+ * Record profiled call
+ *
+ * @v type		Category
+ * @v key		Identifying key
+ * @v name		Name, or NULL
+ * @v cycles		Elapsed timestamp counter ticks
+ * @v bytes		Number of bytes processed
+ */
+void profstat_add ( const char *type, const void *key, const char *name,
+		    unsigned long cycles, size_t bytes ) {
+	struct profile_stat *stat;
+
+	/* Find statistic, discarding the call if the table is full */
+	stat = profstat_find ( key );
+	if ( ! stat )
+		return;
+
+	/* Populate statistic, if newly used */
+	if ( ! stat->type ) {
+		stat->type = type;
+		stat->key = key;
+		stat->name = name;
+	}
+
+	/* Accumulate statistic */
+	stat->calls++;
+	stat->cycles += cycles;
+	stat->bytes += bytes;
+}
+
+/**
+ * Clear profiling statistics
+ *
+ */
+void profstat_clear ( void ) {
+	memset ( profile_stats, 0, sizeof ( profile_stats ) );
+}
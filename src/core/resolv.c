@@ -26,7 +26,10 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/xfer.h>
 #include <ipxe/open.h>
 #include <ipxe/process.h>
+#include <ipxe/retry.h>
+#include <ipxe/timer.h>
 #include <ipxe/resolv.h>
+#include <config/general.h>
 
 /** @file
  *
@@ -295,6 +298,25 @@ int resolv ( struct interface *resolv, const char *name,
  ***************************************************************************
  */
 
+/** Delay between starting successive connection attempts
+ *
+ * This is the "Connection Attempt Delay" recommended by RFC 8305
+ * section 8.
+ */
+#define NAMED_ATTEMPT_DELAY ( TICKS_PER_SEC / 4 )
+
+/** A named socket connection attempt */
+struct named_attempt {
+	/** Named socket */
+	struct named_socket *named;
+	/** Data transfer interface */
+	struct interface xfer;
+	/** Peer socket address */
+	struct sockaddr peer;
+	/** Attempt has been started */
+	int started;
+};
+
 /** A named socket */
 struct named_socket {
 	/** Reference counter */
@@ -303,12 +325,24 @@ struct named_socket {
 	struct interface xfer;
 	/** Name resolution interface */
 	struct interface resolv;
+	/** Connection attempt timer */
+	struct retry_timer timer;
 	/** Communication semantics (e.g. SOCK_STREAM) */
 	int semantics;
 	/** Stored local socket address, if applicable */
 	struct sockaddr local;
 	/** Stored local socket address exists */
 	int have_local;
+	/** Number of resolved addresses */
+	unsigned int count;
+	/** Number of connection attempts in progress */
+	unsigned int active;
+	/** Address family of most recently started attempt */
+	sa_family_t family;
+	/** Most recent failure status code */
+	int rc;
+	/** Connection attempts */
+	struct named_attempt attempts[RESOLV_ADDRESSES];
 };
 
 /**
@@ -318,8 +352,17 @@ struct named_socket {
  * @v rc		Reason for termination
  */
 static void named_close ( struct named_socket *named, int rc ) {
+	unsigned int i;
+
+	/* Stop timer */
+	stop_timer ( &named->timer );
+
 	/* Shut down interfaces */
 	intf_shutdown ( &named->resolv, rc );
+	for ( i = 0 ; i < named->count ; i++ ) {
+		intf_shutdown ( &named->attempts[i].xfer,
+				( rc ? rc : -ECANCELED ) );
+	}
 	intf_shutdown ( &named->xfer, rc );
 }
 
@@ -345,13 +388,187 @@ static struct interface_descriptor named_xfer_desc =
 	INTF_DESC ( struct named_socket, xfer, named_xfer_ops );
 
 /**
- * Name resolved
+ * Complete named socket opener using a connected attempt
+ *
+ * @v named		Named socket
+ * @v attempt		Connected attempt
+ */
+static void named_connected ( struct named_socket *named,
+			      struct named_attempt *attempt ) {
+	struct interface tmp = INTF_INIT ( null_intf_desc );
+
+	DBGC ( named, "NAMED %p connected via %s attempt %d\n",
+	       named, socket_family_name ( attempt->peer.sa_family ),
+	       ( ( int ) ( attempt - named->attempts ) ) );
+
+	/* Splice our parent interface directly to the connected
+	 * socket.  Use a temporary interface in order to be able to
+	 * send xfer_window_changed() to the parent.
+	 */
+	intf_plug ( &tmp, named->xfer.dest );
+	intf_splice ( &named->xfer, &attempt->xfer );
+	xfer_window_changed ( &tmp );
+	intf_unplug ( &tmp );
+
+	/* Abandon any remaining attempts */
+	named_close ( named, 0 );
+}
+
+/**
+ * Start next connection attempt
+ *
+ * @v named		Named socket
+ *
+ * The next address is chosen (in order of resolution) so as to
+ * alternate between address families where possible, as per RFC
+ * 8305 section 4.
+ */
+static void named_next ( struct named_socket *named ) {
+	struct named_attempt *attempt;
+	struct named_attempt *next;
+	int semantics;
+	unsigned int i;
+	int rc;
+
+	/* Stop timer */
+	stop_timer ( &named->timer );
+
+	/* A TCP Fast Open socket may report a window before the
+	 * connection has been established, so that initial data may
+	 * be sent within the SYN.  An attempt's window is the only
+	 * indication that it has connected, so race using ordinary
+	 * stream sockets.  (Use the numeric constants, to avoid
+	 * dragging in TCP.)
+	 */
+	semantics = named->semantics;
+	if ( semantics == TCP_SOCK_STREAM_FASTOPEN )
+		semantics = TCP_SOCK_STREAM;
+
+	while ( 1 ) {
+
+		/* Choose next address, if any */
+		next = NULL;
+		for ( i = 0 ; i < named->count ; i++ ) {
+			attempt = &named->attempts[i];
+			if ( attempt->started )
+				continue;
+			if ( ! next )
+				next = attempt;
+			if ( attempt->peer.sa_family != named->family ) {
+				next = attempt;
+				break;
+			}
+		}
+		if ( ! next )
+			break;
+
+		/* Start connection attempt */
+		DBGC ( named, "NAMED %p starting %s attempt %d\n",
+		       named, socket_family_name ( next->peer.sa_family ),
+		       ( ( int ) ( next - named->attempts ) ) );
+		next->started = 1;
+		named->family = next->peer.sa_family;
+		if ( ( rc = xfer_open_socket ( &next->xfer, semantics,
+					       &next->peer,
+					       ( named->have_local ?
+						 &named->local : NULL ) ) )!=0){
+			DBGC ( named, "NAMED %p could not open attempt %d: "
+			       "%s\n", named,
+			       ( ( int ) ( next - named->attempts ) ),
+			       strerror ( rc ) );
+			named->rc = rc;
+			continue;
+		}
+		named->active++;
+
+		/* Use this attempt immediately if it is already able
+		 * to accept data (e.g. a datagram socket), otherwise
+		 * allow it a head start before trying the next
+		 * address.
+		 */
+		if ( xfer_window ( &next->xfer ) ) {
+			named_connected ( named, next );
+		} else {
+			start_timer_fixed ( &named->timer,
+					    NAMED_ATTEMPT_DELAY );
+		}
+		return;
+	}
+
+	/* Fail if there is nothing left to try */
+	if ( ! named->active )
+		named_close ( named, named->rc );
+}
+
+/**
+ * Handle connection attempt timer expiry
+ *
+ * @v timer		Connection attempt timer
+ * @v fail		Failure indicator
+ */
+static void named_expired ( struct retry_timer *timer, int fail __unused ) {
+	struct named_socket *named =
+		container_of ( timer, struct named_socket, timer );
+
+	/* Start next attempt, if any, without waiting for the
+	 * current attempts to complete.
+	 */
+	named_next ( named );
+}
+
+/**
+ * Handle change of flow control window on connection attempt
+ *
+ * @v attempt		Connection attempt
+ */
+static void named_attempt_window_changed ( struct named_attempt *attempt ) {
+
+	/* Use the first attempt to become ready for data */
+	if ( xfer_window ( &attempt->xfer ) )
+		named_connected ( attempt->named, attempt );
+}
+
+/**
+ * Handle failure of connection attempt
+ *
+ * @v attempt		Connection attempt
+ * @v rc		Reason for failure
+ */
+static void named_attempt_close ( struct named_attempt *attempt, int rc ) {
+	struct named_socket *named = attempt->named;
+
+	DBGC ( named, "NAMED %p attempt %d failed: %s\n",
+	       named, ( ( int ) ( attempt - named->attempts ) ),
+	       strerror ( rc ) );
+
+	/* Record failure */
+	intf_restart ( &attempt->xfer, rc );
+	named->active--;
+	named->rc = ( rc ? rc : -ECONNRESET );
+
+	/* Start next attempt, if any, immediately */
+	named_next ( named );
+}
+
+/** Named socket connection attempt interface operations */
+static struct interface_operation named_attempt_ops[] = {
+	INTF_OP ( xfer_window_changed, struct named_attempt *,
+		  named_attempt_window_changed ),
+	INTF_OP ( intf_close, struct named_attempt *, named_attempt_close ),
+};
+
+/** Named socket connection attempt interface descriptor */
+static struct interface_descriptor named_attempt_desc =
+	INTF_DESC ( struct named_attempt, xfer, named_attempt_ops );
+
+/**
+ * Redirect to sole resolved address
  *
  * @v named		Named socket
  * @v sa		Completed socket address
  */
-static void named_resolv_done ( struct named_socket *named,
-				struct sockaddr *sa ) {
+static void named_redirect ( struct named_socket *named,
+			     struct sockaddr *sa ) {
 	int rc;
 
 	/* Nullify data transfer interface */
@@ -375,9 +592,57 @@ static void named_resolv_done ( struct named_socket *named,
 	named_close ( named, rc );
 }
 
+/**
+ * Name resolved
+ *
+ * @v named		Named socket
+ * @v sa		Completed socket address
+ */
+static void named_resolv_done ( struct named_socket *named,
+				struct sockaddr *sa ) {
+	struct named_attempt *attempt;
+
+	/* Record address */
+	if ( named->count >= RESOLV_ADDRESSES ) {
+		DBGC ( named, "NAMED %p ignoring excess %s address\n",
+		       named, socket_family_name ( sa->sa_family ) );
+		return;
+	}
+	attempt = &named->attempts[ named->count++ ];
+	memcpy ( &attempt->peer, sa, sizeof ( attempt->peer ) );
+}
+
+/**
+ * Name resolution completed
+ *
+ * @v named		Named socket
+ * @v rc		Reason for completion
+ */
+static void named_resolv_close ( struct named_socket *named, int rc ) {
+
+	/* Shut down resolver interface */
+	intf_shutdown ( &named->resolv, rc );
+
+	/* Fail if name could not be resolved */
+	if ( ! named->count ) {
+		named_close ( named, rc );
+		return;
+	}
+
+	/* Redirect the parent interface if there is only a single
+	 * address, otherwise race connection attempts to each
+	 * address.
+	 */
+	if ( named->count == 1 ) {
+		named_redirect ( named, &named->attempts[0].peer );
+	} else {
+		named_next ( named );
+	}
+}
+
 /** Named socket opener resolver interface operations */
 static struct interface_operation named_resolv_op[] = {
-	INTF_OP ( intf_close, struct named_socket *, named_close ),
+	INTF_OP ( intf_close, struct named_socket *, named_resolv_close ),
 	INTF_OP ( resolv_done, struct named_socket *, named_resolv_done ),
 };
 
@@ -393,11 +658,19 @@ static struct interface_descriptor named_resolv_desc =
  * @v name		Name to resolve
  * @v local		Local socket address, or NULL
  * @ret rc		Return status code
+ *
+ * If the name resolves to more than one address, then connection
+ * attempts will be made to each address in turn (without waiting for
+ * earlier attempts to fail), and the first attempt to become ready
+ * for data will be used.  TCP Fast Open is not used for these
+ * attempts, since a Fast Open socket may be ready for data before
+ * it has connected.
  */
 int xfer_open_named_socket ( struct interface *xfer, int semantics,
 			     struct sockaddr *peer, const char *name,
 			     struct sockaddr *local ) {
 	struct named_socket *named;
+	unsigned int i;
 	int rc;
 
 	/* Allocate and initialise structure */
@@ -407,6 +680,13 @@ int xfer_open_named_socket ( struct interface *xfer, int semantics,
 	ref_init ( &named->refcnt, NULL );
 	intf_init ( &named->xfer, &named_xfer_desc, &named->refcnt );
 	intf_init ( &named->resolv, &named_resolv_desc, &named->refcnt );
+	timer_init ( &named->timer, named_expired, &named->refcnt );
+	for ( i = 0 ; i < ( sizeof ( named->attempts ) /
+			    sizeof ( named->attempts[0] ) ) ; i++ ) {
+		named->attempts[i].named = named;
+		intf_init ( &named->attempts[i].xfer, &named_attempt_desc,
+			    &named->refcnt );
+	}
 	named->semantics = semantics;
 	if ( local ) {
 		memcpy ( &named->local, local, sizeof ( named->local ) );
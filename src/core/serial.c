@@ -17,6 +17,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/init.h>
 #include <ipxe/io.h>
 #include <unistd.h>
+#include <ipxe/process.h>
 #include <ipxe/serial.h>
 #include "config/serial.h"
 
@@ -54,6 +55,12 @@ FILE_LICENCE ( GPL2_OR_LATER );
 
 #define COMBRD (115200/UART_BAUD)
 
+/** Transmit ring buffer size (must be a power of two) */
+#define SERIAL_TX_RING_SIZE 256
+
+/** Maximum time to wait without transmit progress (in ms) */
+#define SERIAL_TX_TIMEOUT_MS 2000
+
 /* Line Control Settings */
 #define UART_LCS ( ( ( (COMDATA) - 5 )	<< 0 ) | \
 		   ( ( (COMPARITY) )	<< 3 ) | \
@@ -67,6 +74,10 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #define UART_IER 0x01
 #define UART_IIR 0x02
 #define UART_FCR 0x02
+#define  UART_FCR_FE	0x01	/* FIFO enable */
+#define  UART_FCR_RFR	0x02	/* Receiver FIFO reset */
+#define  UART_FCR_TFR	0x04	/* Transmitter FIFO reset */
+#define  UART_IIR_FIFO	0xc0	/* FIFOs enabled */
 #define UART_LCR 0x03
 #define UART_MCR 0x04
 #define UART_DLL 0x00
@@ -85,6 +96,9 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #define UART_MSR 0x06
 #define UART_SCR 0x07
 
+/** 16550 transmit FIFO length */
+#define UART_FIFO_LEN 16
+
 #if defined(UART_MEM)
 #define uart_readb(addr) readb((addr))
 #define uart_writeb(val,addr) writeb((val),(addr))
@@ -93,25 +107,119 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #define uart_writeb(val,addr) outb((val),(addr))
 #endif
 
-/*
- * void serial_putc(int ch);
- *	Write character `ch' to port UART_BASE.
+/** Transmit ring buffer */
+static char serial_tx_ring[SERIAL_TX_RING_SIZE];
+
+/** Transmit ring producer counter */
+static unsigned int serial_tx_prod;
+
+/** Transmit ring consumer counter */
+static unsigned int serial_tx_cons;
+
+/** Number of characters that may be written when transmitter is empty */
+static unsigned int serial_tx_burst = 1;
+
+/**
+ * Calculate number of characters awaiting transmission
+ *
+ * @ret fill		Number of characters in transmit ring
  */
-void serial_putc ( int ch ) {
-	int i;
+static inline unsigned int serial_tx_fill ( void ) {
+	return ( serial_tx_prod - serial_tx_cons );
+}
+
+/**
+ * Refill UART transmitter from transmit ring
+ *
+ * The UART is never waited upon: if the transmitter (or transmit
+ * FIFO) is not yet empty, this returns immediately.
+ */
+static void serial_tx_refill ( void ) {
+	unsigned int i;
 	int status;
-	i = 1000; /* timeout */
-	while(--i > 0) {
-		status = uart_readb(UART_BASE + UART_LSR);
-		if (status & UART_LSR_THRE) { 
-			/* TX buffer emtpy */
-			uart_writeb(ch, UART_BASE + UART_TBR);
+
+	/* Do nothing unless there is data and the transmitter is empty */
+	if ( ! serial_tx_fill() )
+		return;
+	status = uart_readb(UART_BASE + UART_LSR);
+	if ( ! ( status & UART_LSR_THRE ) )
+		return;
+
+	/* Fill transmitter (or transmit FIFO) in a single burst */
+	for ( i = 0 ; ( i < serial_tx_burst ) && serial_tx_fill() ; i++ ) {
+		uart_writeb ( serial_tx_ring[ serial_tx_cons++ %
+					      SERIAL_TX_RING_SIZE ],
+			      UART_BASE + UART_TBR );
+	}
+}
+
+/**
+ * Wait for transmit ring to drain
+ *
+ * @v limit		Maximum number of characters to leave in ring
+ */
+static void serial_tx_drain ( unsigned int limit ) {
+	unsigned int fill;
+	unsigned int timeout = 0;
+
+	while ( ( fill = serial_tx_fill() ) > limit ) {
+		serial_tx_refill();
+		if ( serial_tx_fill() < fill ) {
+			timeout = 0;
+			continue;
+		}
+		if ( timeout++ >= SERIAL_TX_TIMEOUT_MS ) {
+			/* Assume the UART is dead and discard output */
+			serial_tx_cons = ( serial_tx_prod - limit );
 			break;
 		}
-		mdelay(2);
+		mdelay ( 1 );
 	}
 }
 
+/**
+ * Flush transmit ring
+ *
+ * Wait until all buffered characters have been written to the UART.
+ * This is required only by callers that may run for a long time
+ * without allowing the serial process to be scheduled.
+ */
+void serial_flush ( void ) {
+	serial_tx_drain ( 0 );
+}
+
+/*
+ * void serial_putc(int ch);
+ *	Write character `ch' to port UART_BASE.
+ *
+ *	The character is added to the transmit ring; it will be
+ *	written to the UART from the serial process.  This function
+ *	waits only if the transmit ring is full.
+ */
+void serial_putc ( int ch ) {
+
+	/* Wait for space in transmit ring, if necessary */
+	serial_tx_drain ( SERIAL_TX_RING_SIZE - 1 );
+
+	/* Add character to transmit ring */
+	serial_tx_ring[ serial_tx_prod++ % SERIAL_TX_RING_SIZE ] = ch;
+
+	/* Start transmission immediately if the transmitter is idle */
+	serial_tx_refill();
+}
+
+/**
+ * Serial process
+ *
+ * @v process		Process
+ */
+static void serial_step ( struct process *process __unused ) {
+	serial_tx_refill();
+}
+
+/** Serial process */
+PERMANENT_PROCESS ( serial_process, serial_step );
+
 /*
  * int serial_getc(void);
  *	Read a character from port UART_BASE.
@@ -120,6 +228,7 @@ int serial_getc ( void ) {
 	int status;
 	int ch;
 	do {
+		serial_tx_refill();
 		status = uart_readb(UART_BASE + UART_LSR);
 	} while((status & 1) == 0);
 	ch = uart_readb(UART_BASE + UART_RBR);	/* fetch (first) character */
@@ -201,8 +310,18 @@ static void serial_init ( void ) {
 	/* disable interrupts */
 	uart_writeb(0x0, UART_BASE + UART_IER);
 
-	/* disable fifo's */
-	uart_writeb(0x00, UART_BASE + UART_FCR);
+	/* enable and reset fifo's, if present */
+	uart_writeb ( ( UART_FCR_FE | UART_FCR_RFR | UART_FCR_TFR ),
+		      UART_BASE + UART_FCR );
+	if ( ( uart_readb ( UART_BASE + UART_IIR ) & UART_IIR_FIFO ) ==
+	     UART_IIR_FIFO ) {
+		serial_tx_burst = UART_FIFO_LEN;
+	} else {
+		uart_writeb ( 0x00, UART_BASE + UART_FCR );
+		serial_tx_burst = 1;
+	}
+	DBG ( "Serial port %#x transmitting in bursts of %d\n",
+	      UART_BASE, serial_tx_burst );
 
 	/* Set clear to send, so flow control works... */
 	uart_writeb((1<<1), UART_BASE + UART_MCR);
@@ -231,6 +350,7 @@ static void serial_fini ( int flags __unused ) {
 	/* Flush the output buffer to avoid dropping characters,
 	 * if we are reinitializing the serial port.
 	 */
+	serial_flush();
 	i = 10000; /* timeout */
 	do {
 		status = uart_readb(UART_BASE + UART_LSR);
@@ -1069,6 +1069,46 @@ int storef_setting ( struct settings *settings, struct setting *setting,
  ******************************************************************************
  */
 
+/** Index of named settings, sorted by name */
+static struct setting **setting_index;
+
+/**
+ * Get sorted index of named settings
+ *
+ * @ret index		Sorted index, or NULL if unavailable
+ *
+ * The index is constructed on first use.  Settings with identical
+ * names retain their relative order within the settings table, so
+ * that a lookup via the index finds the same setting as a linear
+ * search of the table would.
+ */
+static struct setting ** named_setting_index ( void ) {
+	unsigned int count = table_num_entries ( SETTINGS );
+	struct setting *setting;
+	unsigned int i = 0;
+	unsigned int j;
+
+	/* Use existing index, if already constructed */
+	if ( setting_index )
+		return setting_index;
+
+	/* Allocate index */
+	setting_index = malloc ( count * sizeof ( setting_index[0] ) );
+	if ( ! setting_index )
+		return NULL;
+
+	/* Populate index using a (stable) insertion sort */
+	for_each_table_entry ( setting, SETTINGS ) {
+		for ( j = i ; j && ( strcmp ( setting_index[ j - 1 ]->name,
+					      setting->name ) > 0 ) ; j-- )
+			setting_index[j] = setting_index[ j - 1 ];
+		setting_index[j] = setting;
+		i++;
+	}
+
+	return setting_index;
+}
+
 /**
  * Find named setting
  *
@@ -1076,12 +1116,36 @@ int storef_setting ( struct settings *settings, struct setting *setting,
  * @ret setting		Named setting, or NULL
  */
 struct setting * find_setting ( const char *name ) {
+	struct setting **index;
 	struct setting *setting;
+	unsigned int min = 0;
+	unsigned int max = table_num_entries ( SETTINGS );
+	unsigned int mid;
+	int diff;
+
+	/* Fall back to a linear search if no index is available */
+	index = named_setting_index();
+	if ( ! index ) {
+		for_each_table_entry ( setting, SETTINGS ) {
+			if ( strcmp ( name, setting->name ) == 0 )
+				return setting;
+		}
+		return NULL;
+	}
 
-	for_each_table_entry ( setting, SETTINGS ) {
-		if ( strcmp ( name, setting->name ) == 0 )
-			return setting;
+	/* Binary search for the first setting with this name */
+	while ( min < max ) {
+		mid = ( ( min + max ) / 2 );
+		diff = strcmp ( index[mid]->name, name );
+		if ( diff < 0 ) {
+			min = ( mid + 1 );
+		} else {
+			max = mid;
+		}
 	}
+	if ( ( min < table_num_entries ( SETTINGS ) ) &&
+	     ( strcmp ( index[min]->name, name ) == 0 ) )
+		return index[min];
 	return NULL;
 }
 
@@ -1182,12 +1246,23 @@ parse_setting_name ( const char *name,
 	/* Identify setting */
 	setting->tag = parse_setting_tag ( *settings, setting_name );
 	setting->name = setting_name;
-	for_each_table_entry ( named_setting, SETTINGS ) {
-		/* Matches a defined named setting; use that setting */
-		if ( setting_cmp ( named_setting, setting ) == 0 ) {
-			memcpy ( setting, named_setting, sizeof ( *setting ) );
-			break;
+	if ( setting->tag ) {
+		/* Numeric name: match on either tag or name */
+		for_each_table_entry ( named_setting, SETTINGS ) {
+			if ( setting_cmp ( named_setting, setting ) == 0 )
+				break;
 		}
+		if ( named_setting == table_end ( SETTINGS ) )
+			named_setting = NULL;
+	} else if ( setting_name[0] ) {
+		/* Non-numeric name: match on name only */
+		named_setting = find_setting ( setting_name );
+	} else {
+		named_setting = NULL;
+	}
+	if ( named_setting ) {
+		/* Matches a defined named setting; use that setting */
+		memcpy ( setting, named_setting, sizeof ( *setting ) );
 	}
 
 	/* Identify setting type, if specified */
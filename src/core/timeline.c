@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <ipxe/vsprintf.h>
+#include <ipxe/uaccess.h>
+#include <ipxe/umalloc.h>
+#include <ipxe/profile.h>
+#include <ipxe/image.h>
+#include <ipxe/timeline.h>
+
+/** @file
+ *
+ * Boot timeline tracing
+ *
+ * Timeline events are recorded into a fixed-size ring buffer,
+ * timestamped using the CPU timestamp counter.  When the ring buffer
+ * is full, the oldest events are overwritten.  The events may be
+ * saved as an image in the Chrome trace event format (readable by
+ * e.g. chrome://tracing or ui.perfetto.dev).
+ *
+ * Spans are recorded as asynchronous events, since spans belonging
+ * to different objects (e.g. concurrent TCP connections) may overlap
+ * without being nested.
+ */
+
+/** Duration over which to calibrate the timestamp counter (in ms) */
+#define TIMELINE_CALIBRATE_MS 10
+
+/** Timeline events */
+static struct timeline_event timeline_events[TIMELINE_MAX];
+
+/** Timeline event producer counter */
+static unsigned int timeline_prod;
+
+/**
+ * Record timeline event
+ *
+ * @v phase		Phase
+ * @v category		Category
+ * @v name		Name
+ * @v key		Identifying key
+ * @v detail		Detail, or NULL
+ */
+void timeline_record ( char phase, const char *category, const char *name,
+		       const void *key, const char *detail ) {
+	struct timeline_event *event;
+	union profiler now;
+	unsigned int i;
+	char c;
+
+	/* Populate next event, overwriting the oldest if necessary */
+	event = &timeline_events[ timeline_prod++ % TIMELINE_MAX ];
+	profile ( &now );
+	event->tsc = now.timestamp;
+	event->category = category;
+	event->name = name;
+	event->key = key;
+	event->phase = phase;
+
+	/* Copy detail, replacing any characters that would require
+	 * escaping within a JSON string.
+	 */
+	for ( i = 0 ; detail && ( i < ( sizeof ( event->detail ) - 1 ) ) &&
+		      ( ( c = detail[i] ) != '\0' ) ; i++ ) {
+		if ( ( c < ' ' ) || ( c == '"' ) || ( c == '\\' ) )
+			c = '_';
+		event->detail[i] = c;
+	}
+	event->detail[i] = '\0';
+}
+
+/**
+ * Format timeline events in Chrome trace event format
+ *
+ * @v data		Buffer
+ * @v len		Length of buffer
+ * @v tsc_per_usec	Timestamp counter ticks per microsecond
+ * @ret used		Length of formatted data
+ */
+static size_t timeline_format ( char *data, size_t len,
+				unsigned long tsc_per_usec ) {
+	struct timeline_event *event;
+	unsigned int first;
+	unsigned int i;
+	uint64_t start;
+	uint64_t usec;
+	size_t used = 0;
+
+	/* Identify oldest retained event */
+	first = ( ( timeline_prod > TIMELINE_MAX ) ?
+		  ( timeline_prod - TIMELINE_MAX ) : 0 );
+	start = timeline_events[ first % TIMELINE_MAX ].tsc;
+
+	/* Construct events */
+	used += ssnprintf ( ( data + used ), ( len - used ),
+			    "{\"traceEvents\":[" );
+	for ( i = first ; i != timeline_prod ; i++ ) {
+		event = &timeline_events[ i % TIMELINE_MAX ];
+		usec = ( ( event->tsc - start ) / tsc_per_usec );
+		used += ssnprintf ( ( data + used ), ( len - used ),
+				    "%s\n{\"ph\":\"%c\",\"cat\":\"%s\","
+				    "\"name\":\"%s\",\"id\":\"%p\","
+				    "\"ts\":%lld,\"pid\":1,\"tid\":1,"
+				    "\"args\":{\"detail\":\"%s\"}}",
+				    ( ( i == first ) ? "" : "," ),
+				    event->phase, event->category,
+				    event->name, event->key,
+				    ( ( unsigned long long ) usec ),
+				    event->detail );
+	}
+	used += ssnprintf ( ( data + used ), ( len - used ), "\n]}\n" );
+
+	return used;
+}
+
+/**
+ * Save timeline events as an image
+ *
+ * @v name		Image name
+ * @ret rc		Return status code
+ */
+int timeline_save ( const char *name ) {
+	struct image *existing;
+	struct image *image;
+	union profiler profiler;
+	unsigned long tsc_per_usec;
+	char *data;
+	size_t len;
+	int rc;
+
+	/* Calibrate timestamp counter */
+	profiler.timestamp = 0;
+	profile ( &profiler );
+	mdelay ( TIMELINE_CALIBRATE_MS );
+	tsc_per_usec = ( profile ( &profiler ) /
+			 ( TIMELINE_CALIBRATE_MS * 1000 ) );
+	if ( ! tsc_per_usec )
+		tsc_per_usec = 1;
+
+	/* Format events */
+	len = timeline_format ( NULL, 0, tsc_per_usec );
+	data = malloc ( len + 1 /* NUL */ );
+	if ( ! data ) {
+		rc = -ENOMEM;
+		goto err_alloc_data;
+	}
+	timeline_format ( data, ( len + 1 /* NUL */ ), tsc_per_usec );
+
+	/* Allocate image */
+	image = alloc_image ( NULL );
+	if ( ! image ) {
+		rc = -ENOMEM;
+		goto err_alloc_image;
+	}
+	if ( ( rc = image_set_name ( image, name ) ) != 0 )
+		goto err_set_name;
+	image->data = umalloc ( len );
+	if ( ! image->data ) {
+		rc = -ENOMEM;
+		goto err_umalloc;
+	}
+	image->len = len;
+	copy_to_user ( image->data, 0, data, len );
+
+	/* Replace any existing image of the same name */
+	if ( ( existing = find_image ( name ) ) != NULL )
+		unregister_image ( existing );
+
+	/* Register image */
+	if ( ( rc = register_image ( image ) ) != 0 )
+		goto err_register_image;
+
+ err_register_image:
+ err_umalloc:
+ err_set_name:
+	image_put ( image );
+ err_alloc_image:
+	free ( data );
+ err_alloc_data:
+	return rc;
+}
@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <ipxe/profile.h>
+#include <ipxe/trace.h>
+
+/** @file
+ *
+ * Runtime trace channels
+ *
+ * Trace points are recorded into a fixed-size ring buffer in binary
+ * form, timestamped using the CPU timestamp counter.  When the ring
+ * buffer is full, the oldest entries are overwritten.  Formatting is
+ * deferred until the ring buffer is dumped, so that enabling a trace
+ * channel has minimal effect on the timing being investigated.
+ */
+
+/** Duration over which to calibrate the timestamp counter (in ms) */
+#define TRACE_CALIBRATE_MS 10
+
+/** Trace entries */
+static struct trace_entry trace_entries[TRACE_MAX];
+
+/** Trace entry producer counter */
+static unsigned int trace_prod;
+
+/** Trace entry consumer counter */
+static unsigned int trace_cons;
+
+/**
+ * Record trace entry
+ *
+ * @v channel		Trace channel
+ * @v object		Traced object
+ * @v fmt		Format string
+ * @v arg0		First argument
+ * @v arg1		Second argument
+ * @v arg2		Third argument
+ * @v arg3		Fourth argument
+ */
+void trace_record ( struct trace_channel *channel, const void *object,
+		    const char *fmt, unsigned long arg0, unsigned long arg1,
+		    unsigned long arg2, unsigned long arg3 ) {
+	struct trace_entry *entry;
+	union profiler now;
+
+	/* Ignore objects not being traced */
+	if ( channel->object && ( channel->object != object ) )
+		return;
+
+	/* Populate next entry, overwriting the oldest if necessary */
+	if ( ( trace_prod - trace_cons ) >= TRACE_MAX )
+		trace_cons++;
+	entry = &trace_entries[ trace_prod++ % TRACE_MAX ];
+	profile ( &now );
+	entry->tsc = now.timestamp;
+	entry->channel = channel;
+	entry->object = object;
+	entry->fmt = fmt;
+	entry->args[0] = arg0;
+	entry->args[1] = arg1;
+	entry->args[2] = arg2;
+	entry->args[3] = arg3;
+}
+
+/**
+ * Print formatted trace entry
+ *
+ * @v fmt		Format string
+ * @v ...		Arguments
+ */
+static void trace_printf ( const char *fmt, ... ) {
+	va_list args;
+
+	va_start ( args, fmt );
+	vprintf ( fmt, args );
+	va_end ( args );
+}
+
+/**
+ * Dump trace entries
+ *
+ * Entries are displayed with timestamps (in microseconds) relative
+ * to the oldest retained entry.
+ */
+void trace_dump ( void ) {
+	struct trace_entry *entry;
+	union profiler profiler;
+	unsigned long tsc_per_usec;
+	unsigned long usec;
+	uint64_t start = 0;
+	unsigned int i;
+
+	/* Calibrate timestamp counter */
+	profiler.timestamp = 0;
+	profile ( &profiler );
+	mdelay ( TRACE_CALIBRATE_MS );
+	tsc_per_usec = ( profile ( &profiler ) /
+			 ( TRACE_CALIBRATE_MS * 1000 ) );
+	if ( ! tsc_per_usec )
+		tsc_per_usec = 1;
+
+	/* Display entries */
+	for ( i = trace_cons ; i != trace_prod ; i++ ) {
+		entry = &trace_entries[ i % TRACE_MAX ];
+		if ( i == trace_cons )
+			start = entry->tsc;
+		usec = ( ( entry->tsc - start ) / tsc_per_usec );
+		printf ( "%10ld %s %p: ", usec, entry->channel->name,
+			 entry->object );
+		trace_printf ( entry->fmt, entry->args[0], entry->args[1],
+			       entry->args[2], entry->args[3] );
+		printf ( "\n" );
+	}
+}
+
+/**
+ * Discard all trace entries
+ *
+ */
+void trace_clear ( void ) {
+
+	trace_cons = trace_prod;
+}
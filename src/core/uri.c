@@ -285,14 +285,47 @@ int unparse_uri ( char *buf, size_t size, struct uri *uri,
  * @v uri		URI
  * @ret uri		Duplicate URI
  *
- * Creates a modifiable copy of a URI.
+ * Creates a modifiable copy of a URI.  The (already decoded) fields
+ * are copied directly into a single allocation, rather than being
+ * re-encoded and re-parsed.
  */
 struct uri * uri_dup ( struct uri *uri ) {
-	size_t len = ( unparse_uri ( NULL, 0, uri, URI_ALL ) + 1 );
-	char buf[len];
+	struct uri *dup;
+	const char *field;
+	size_t len = sizeof ( *dup );
+	size_t field_len;
+	char *out;
+	int i;
+
+	/* Calculate space required for fields */
+	for ( i = URI_FIRST_FIELD; i <= URI_LAST_FIELD; i++ ) {
+		field = uri_get_field ( uri, i );
+		if ( field )
+			len += ( strlen ( field ) + 1 /* NUL */ );
+	}
+
+	/* Allocate URI struct and space for fields */
+	dup = zalloc ( len );
+	if ( ! dup )
+		return NULL;
+	out = ( ( ( char * ) dup ) + sizeof ( *dup ) );
+
+	/* Copy fields */
+	for ( i = URI_FIRST_FIELD; i <= URI_LAST_FIELD; i++ ) {
+		field = uri_get_field ( uri, i );
+		if ( ! field )
+			continue;
+		field_len = ( strlen ( field ) + 1 /* NUL */ );
+		memcpy ( out, field, field_len );
+		uri_get_field ( dup, i ) = out;
+		out += field_len;
+	}
+
+	DBG ( "URI duplicated as" );
+	dump_uri ( dup );
+	DBG ( "\n" );
 
-	unparse_uri ( buf, len, uri, URI_ALL );
-	return parse_uri ( buf );
+	return dup;
 }
 
 /**
@@ -442,24 +475,38 @@ static int is_unreserved_uri_char ( int c, int field ) {
  */
 size_t uri_encode ( const char *raw_string, char *buf, ssize_t len,
 		    int field ) {
-	ssize_t remaining = len;
-	size_t used;
+	static const char hex[] = "0123456789ABCDEF";
+	char encoded[3];
+	ssize_t used = 0;
+	unsigned int count;
+	unsigned int i;
 	unsigned char c;
 
-	if ( len > 0 )
-		buf[0] = '\0';
-
 	while ( ( c = *(raw_string++) ) ) {
+
+		/* Encode character */
 		if ( is_unreserved_uri_char ( c, field ) ) {
-			used = ssnprintf ( buf, remaining, "%c", c );
+			encoded[0] = c;
+			count = 1;
 		} else {
-			used = ssnprintf ( buf, remaining, "%%%02X", c );
+			encoded[0] = '%';
+			encoded[1] = hex[ c >> 4 ];
+			encoded[2] = hex[ c & 0xf ];
+			count = 3;
+		}
+
+		/* Store as much as will fit, leaving space for the NUL */
+		for ( i = 0 ; i < count ; i++, used++ ) {
+			if ( ( used + 1 ) < len )
+				buf[used] = encoded[i];
 		}
-		buf += used;
-		remaining -= used;
 	}
 
-	return ( len - remaining );
+	/* Terminate string */
+	if ( len > 0 )
+		buf[ ( used < len ) ? used : ( len - 1 ) ] = '\0';
+
+	return used;
 }
 
 /**
@@ -475,17 +522,20 @@ size_t uri_encode ( const char *raw_string, char *buf, ssize_t len,
  */
 size_t uri_decode ( const char *encoded_string, char *buf, ssize_t len ) {
 	ssize_t remaining;
-	char hexbuf[3];
-	char *hexbuf_end;
+	unsigned int digit;
+	unsigned int i;
 	unsigned char c;
 
 	for ( remaining = len; *encoded_string; remaining-- ) {
 		if ( *encoded_string == '%' ) {
+			/* Decode up to two hex digits */
 			encoded_string++;
-			snprintf ( hexbuf, sizeof ( hexbuf ), "%s",
-				   encoded_string );
-			c = strtoul ( hexbuf, &hexbuf_end, 16 );
-			encoded_string += ( hexbuf_end - hexbuf );
+			for ( c = 0, i = 0 ; i < 2 ; i++, encoded_string++ ) {
+				digit = strtoul_charval ( *encoded_string );
+				if ( digit >= 16 )
+					break;
+				c = ( ( c << 4 ) | digit );
+			}
 		} else {
 			c = *(encoded_string++);
 		}
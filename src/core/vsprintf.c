@@ -22,6 +22,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <stdarg.h>
 #include <stdio.h>
 #include <errno.h>
+#include <ipxe/console.h>
 #include <ipxe/vsprintf.h>
 
 /** @file */
@@ -395,15 +396,33 @@ int ssnprintf ( char *buf, ssize_t ssize, const char *fmt, ... ) {
 	return len;
 }
 
+/** Context used by vprintf() */
+struct putchar_context {
+	struct printf_context ctx;
+	/** Buffered characters */
+	char buf[32];
+	/** Number of buffered characters */
+	size_t len;
+};
+
 /**
  * Write character to console
  *
  * @v ctx		Context
  * @v c			Character
+ *
+ * Characters are passed to the console in batches, so that consoles
+ * able to write several characters at once may do so.
  */
-static void printf_putchar ( struct printf_context *ctx __unused,
-			     unsigned int c ) {
-	putchar ( c );
+static void printf_putchar ( struct printf_context *ctx, unsigned int c ) {
+	struct putchar_context *pctx =
+		container_of ( ctx, struct putchar_context, ctx );
+
+	pctx->buf[ pctx->len++ ] = c;
+	if ( pctx->len == sizeof ( pctx->buf ) ) {
+		console_write ( pctx->buf, pctx->len );
+		pctx->len = 0;
+	}
 }
 
 /**
@@ -414,11 +433,18 @@ static void printf_putchar ( struct printf_context *ctx __unused,
  * @ret len		Length of formatted string
  */
 int vprintf ( const char *fmt, va_list args ) {
-	struct printf_context ctx;
+	struct putchar_context pctx;
+	int len;
 
 	/* Hand off to vcprintf */
-	ctx.handler = printf_putchar;	
-	return vcprintf ( &ctx, fmt, args );	
+	pctx.ctx.handler = printf_putchar;
+	pctx.len = 0;
+	len = vcprintf ( &pctx.ctx, fmt, args );
+
+	/* Write out any remaining characters */
+	console_write ( pctx.buf, pctx.len );
+
+	return len;
 }
 
 /**
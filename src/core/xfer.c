@@ -182,6 +182,84 @@ struct io_buffer * xfer_alloc_iob ( struct interface *intf, size_t len ) {
 	return iobuf;
 }
 
+/**
+ * Get buffer for direct data placement
+ *
+ * @v intf		Data transfer interface
+ * @v offset		Absolute offset of data within stream
+ * @v len		Length of data
+ * @ret buffer		Buffer for data, or UNULL
+ *
+ * A sender that is able to write data directly into memory (e.g. via
+ * a block device read) may use this to avoid allocating an I/O
+ * buffer and having the recipient copy the data out of it.  The
+ * recipient guarantees that the buffer will remain valid until the
+ * sender calls xfer_placed() or the interface is closed.
+ *
+ * If no buffer is available (e.g. because the recipient has no
+ * preallocated storage covering the specified range), the sender
+ * must fall back to delivering the data via xfer_deliver().
+ */
+userptr_t xfer_buffer ( struct interface *intf, size_t offset, size_t len ) {
+	struct interface *dest;
+	xfer_buffer_TYPE ( void * ) *op =
+		intf_get_dest_op ( intf, xfer_buffer, &dest );
+	void *object = intf_object ( dest );
+	userptr_t buffer;
+
+	DBGC ( INTF_COL ( intf ), "INTF " INTF_INTF_FMT " buffer %#zx+%#zx\n",
+	       INTF_INTF_DBG ( intf, dest ), offset, len );
+
+	if ( op ) {
+		buffer = op ( object, offset, len );
+	} else {
+		/* Default is to disallow direct placement */
+		buffer = UNULL;
+	}
+
+	intf_put ( dest );
+	return buffer;
+}
+
+/**
+ * Report data placed directly into buffer
+ *
+ * @v intf		Data transfer interface
+ * @v offset		Absolute offset of data within stream
+ * @v len		Length of data
+ * @ret rc		Return status code
+ *
+ * The buffer must have been obtained via xfer_buffer().
+ */
+int xfer_placed ( struct interface *intf, size_t offset, size_t len ) {
+	struct interface *dest;
+	xfer_placed_TYPE ( void * ) *op =
+		intf_get_dest_op ( intf, xfer_placed, &dest );
+	void *object = intf_object ( dest );
+	int rc;
+
+	DBGC ( INTF_COL ( intf ), "INTF " INTF_INTF_FMT " placed %#zx+%#zx\n",
+	       INTF_INTF_DBG ( intf, dest ), offset, len );
+
+	if ( op ) {
+		rc = op ( object, offset, len );
+	} else {
+		/* Default is to fail, since no buffer can have been
+		 * provided.
+		 */
+		rc = -EPIPE;
+	}
+
+	if ( rc != 0 ) {
+		DBGC ( INTF_COL ( intf ), "INTF " INTF_INTF_FMT
+		       " placed failed: %s\n",
+		       INTF_INTF_DBG ( intf, dest ), strerror ( rc ) );
+	}
+
+	intf_put ( dest );
+	return rc;
+}
+
 /**
  * Deliver datagram
  *
@@ -83,12 +83,19 @@ static void arc4_xor ( void *ctxv, const void *srcv, void *dstv,
 	u8 *S = ctx->state;
 	int i = ctx->i, j = ctx->j;
 
-	while ( len-- ) {
-		i = ( i + 1 ) & 0xff;
-		j = ( j + S[i] ) & 0xff;
-		SWAP ( S, i, j );
-		if ( srcv && dstv )
+	if ( srcv && dstv ) {
+		while ( len-- ) {
+			i = ( i + 1 ) & 0xff;
+			j = ( j + S[i] ) & 0xff;
+			SWAP ( S, i, j );
 			*dst++ = *src++ ^ S[(S[i] + S[j]) & 0xff];
+		}
+	} else {
+		while ( len-- ) {
+			i = ( i + 1 ) & 0xff;
+			j = ( j + S[i] ) & 0xff;
+			SWAP ( S, i, j );
+		}
 	}
 
 	ctx->i = i;
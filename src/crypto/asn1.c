@@ -239,6 +239,43 @@ int asn1_shrink ( struct asn1_cursor *cursor, unsigned int type ) {
 	return 0;
 }
 
+/**
+ * Extract next ASN.1 object
+ *
+ * @v cursor		ASN.1 object cursor
+ * @v type		Expected type, or ASN1_ANY
+ * @v object		ASN.1 object cursor to fill in
+ * @ret rc		Return status code
+ *
+ * The object cursor will be filled in to contain only the current
+ * ASN.1 object (including its tag and length), and the original
+ * cursor will be updated to point to the following ASN.1 object (if
+ * any).  This is equivalent to asn1_shrink() on a copy of the cursor
+ * followed by asn1_skip(), but decodes the object header only once.
+ * If any error occurs, both cursors will be invalidated.
+ */
+int asn1_next ( struct asn1_cursor *cursor, unsigned int type,
+		struct asn1_cursor *object ) {
+	const void *start = cursor->data;
+	int len;
+
+	/* Find end of object */
+	len = asn1_start ( cursor, type );
+	if ( len < 0 ) {
+		asn1_invalidate_cursor ( cursor );
+		asn1_invalidate_cursor ( object );
+		return len;
+	}
+	cursor->data += len;
+	cursor->len -= len;
+
+	/* Record object */
+	object->data = start;
+	object->len = ( cursor->data - start );
+
+	return 0;
+}
+
 /**
  * Enter ASN.1 object of any type
  *
@@ -190,6 +190,11 @@ void AES_set_key(AES_CTX *ctx, const uint8_t *key,
             words = 4;
             break;
 
+        case AES_MODE_192:
+            i = 12;
+            words = 6;
+            break;
+
         case AES_MODE_256:
             i = 14;
             words = 8;
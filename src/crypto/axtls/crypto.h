@@ -78,6 +78,7 @@ typedef struct aes_key_st
 typedef enum
 {
     AES_MODE_128,
+    AES_MODE_192,
     AES_MODE_256
 } AES_MODE;
 
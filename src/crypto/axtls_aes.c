@@ -24,6 +24,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <byteswap.h>
 #include <ipxe/crypto.h>
 #include <ipxe/cbc.h>
+#include <ipxe/gcm.h>
 #include <ipxe/aes.h>
 #include "crypto/axtls/crypto.h"
 
@@ -50,6 +51,9 @@ static int aes_setkey ( void *ctx, const void *key, size_t keylen ) {
 	case ( 128 / 8 ):
 		mode = AES_MODE_128;
 		break;
+	case ( 192 / 8 ):
+		mode = AES_MODE_192;
+		break;
 	case ( 256 / 8 ):
 		mode = AES_MODE_256;
 		break;
@@ -157,3 +161,6 @@ struct cipher_algorithm aes_algorithm = {
 /* AES with cipher-block chaining */
 CBC_CIPHER ( aes_cbc, aes_cbc_algorithm,
 	     aes_algorithm, struct aes_context, AES_BLOCKSIZE );
+
+/* AES in Galois/Counter mode */
+GCM_CIPHER ( aes_gcm, aes_gcm_algorithm, aes_algorithm, struct aes_context );
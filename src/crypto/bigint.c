@@ -86,7 +86,95 @@ void bigint_mod_multiply_raw ( const bigint_element_t *multiplicand0,
 }
 
 /**
- * Perform modular exponentiation of big integers
+ * Calculate Montgomery inverse of big integer modulus
+ *
+ * @v modulus0		Element 0 of big integer modulus (must be odd)
+ * @ret inverse		Negated inverse of element 0, modulo 2^n
+ *
+ * Calculates -N^{-1} mod 2^n, where n is the number of bits in a big
+ * integer element.
+ */
+static bigint_element_t
+bigint_montgomery_inverse ( const bigint_element_t *modulus0 ) {
+	bigint_element_t modulus = modulus0[0];
+	bigint_element_t inverse = modulus;
+	unsigned int i;
+
+	/* Any odd number is its own inverse modulo 2^3.  Each
+	 * Newton-Raphson iteration doubles the number of correct
+	 * bits.
+	 */
+	for ( i = 3 ; i < ( 8 * sizeof ( inverse ) ) ; i *= 2 )
+		inverse *= ( 2 - ( modulus * inverse ) );
+
+	return ( -inverse );
+}
+
+/**
+ * Perform Montgomery multiplication of big integers
+ *
+ * @v multiplicand0	Element 0 of big integer to be multiplied
+ * @v multiplier0	Element 0 of big integer to be multiplied
+ * @v modulus0		Element 0 of big integer modulus (must be odd)
+ * @v inverse		Montgomery inverse of modulus
+ * @v result0		Element 0 of big integer to hold result
+ * @v size		Number of elements in base, modulus, and result
+ * @v product0		Element 0 of double-sized temporary big integer
+ *
+ * Calculates a.b.R^{-1} mod N, where R=2^(n.size).  The full product
+ * is calculated using bigint_multiply_raw() (which may be provided by
+ * architecture-specific code), and is then reduced one element at a
+ * time.  Both inputs must be less than the modulus.
+ */
+static void bigint_montgomery_raw ( const bigint_element_t *multiplicand0,
+				    const bigint_element_t *multiplier0,
+				    const bigint_element_t *modulus0,
+				    bigint_element_t inverse,
+				    bigint_element_t *result0,
+				    unsigned int size,
+				    bigint_element_t *product0 ) {
+	const bigint_t ( size ) __attribute__ (( may_alias )) *modulus =
+		( ( const void * ) modulus0 );
+	bigint_t ( size ) __attribute__ (( may_alias )) *result =
+		( ( void * ) result0 );
+	bigint_t ( size * 2 ) __attribute__ (( may_alias )) *product =
+		( ( void * ) product0 );
+	bigint_element_t multiple;
+	bigint_double_element_t accumulator;
+	unsigned int overflow = 0;
+	unsigned int i;
+	unsigned int j;
+
+	/* Calculate full product */
+	bigint_multiply_raw ( multiplicand0, multiplier0, product0, size );
+
+	/* Add multiples of the modulus to clear each low element in turn */
+	for ( i = 0 ; i < size ; i++ ) {
+		multiple = ( product->element[i] * inverse );
+		accumulator = 0;
+		for ( j = 0 ; j < size ; j++ ) {
+			accumulator += ( ( ( bigint_double_element_t )
+					   multiple ) * modulus->element[j] );
+			accumulator += product->element[ i + j ];
+			product->element[ i + j ] = accumulator;
+			accumulator >>= ( 8 * sizeof ( multiple ) );
+		}
+		for ( j += i ; accumulator && ( j < ( size * 2 ) ) ; j++ ) {
+			accumulator += product->element[j];
+			product->element[j] = accumulator;
+			accumulator >>= ( 8 * sizeof ( multiple ) );
+		}
+		overflow += accumulator;
+	}
+
+	/* Extract upper half, which is now less than twice the modulus */
+	memcpy ( result, &product->element[size], sizeof ( *result ) );
+	if ( overflow || bigint_is_geq ( result, modulus ) )
+		bigint_subtract ( modulus, result );
+}
+
+/**
+ * Perform modular exponentiation of big integers using square-and-multiply
  *
  * @v base0		Element 0 of big integer base
  * @v modulus0		Element 0 of big integer modulus
@@ -95,13 +183,17 @@ void bigint_mod_multiply_raw ( const bigint_element_t *multiplicand0,
  * @v size		Number of elements in base, modulus, and result
  * @v exponent_size	Number of elements in exponent
  * @v tmp		Temporary working space
+ *
+ * This is used only for even moduli, for which Montgomery reduction
+ * is not possible.
  */
-void bigint_mod_exp_raw ( const bigint_element_t *base0,
-			  const bigint_element_t *modulus0,
-			  const bigint_element_t *exponent0,
-			  bigint_element_t *result0,
-			  unsigned int size, unsigned int exponent_size,
-			  void *tmp ) {
+static void bigint_mod_exp_simple_raw ( const bigint_element_t *base0,
+					const bigint_element_t *modulus0,
+					const bigint_element_t *exponent0,
+					bigint_element_t *result0,
+					unsigned int size,
+					unsigned int exponent_size,
+					void *tmp ) {
 	const bigint_t ( size ) __attribute__ (( may_alias )) *base =
 		( ( const void * ) base0 );
 	const bigint_t ( size ) __attribute__ (( may_alias )) *modulus =
@@ -132,3 +224,130 @@ void bigint_mod_exp_raw ( const bigint_element_t *base0,
 				      &temp->base, temp->mod_multiply );
 	}
 }
+
+/**
+ * Perform modular exponentiation of big integers
+ *
+ * @v base0		Element 0 of big integer base
+ * @v modulus0		Element 0 of big integer modulus
+ * @v exponent0		Element 0 of big integer exponent
+ * @v result0		Element 0 of big integer to hold result
+ * @v size		Number of elements in base, modulus, and result
+ * @v exponent_size	Number of elements in exponent
+ * @v tmp		Temporary working space
+ *
+ * For odd moduli (which includes all RSA moduli), the exponentiation
+ * is performed in Montgomery form using a sliding window over the
+ * exponent, with a table of precomputed odd powers of the base.
+ */
+void bigint_mod_exp_raw ( const bigint_element_t *base0,
+			  const bigint_element_t *modulus0,
+			  const bigint_element_t *exponent0,
+			  bigint_element_t *result0,
+			  unsigned int size, unsigned int exponent_size,
+			  void *tmp ) {
+	const bigint_t ( size ) __attribute__ (( may_alias )) *base =
+		( ( const void * ) base0 );
+	const bigint_t ( size ) __attribute__ (( may_alias )) *modulus =
+		( ( const void * ) modulus0 );
+	const bigint_t ( exponent_size ) __attribute__ (( may_alias ))
+		*exponent = ( ( const void * ) exponent0 );
+	bigint_t ( size ) __attribute__ (( may_alias )) *result =
+		( ( void * ) result0 );
+	size_t mod_multiply_len = bigint_mod_multiply_tmp_len ( modulus );
+	struct {
+		bigint_t ( size ) base;
+		bigint_t ( exponent_size ) exponent;
+		union {
+			uint8_t mod_multiply[mod_multiply_len];
+			bigint_t ( size * 2 ) product;
+		};
+		bigint_t ( size ) power[BIGINT_MOD_EXP_POWERS];
+	} *temp = tmp;
+	static const uint8_t one[1] = { 0x01 };
+	bigint_element_t inverse;
+	unsigned int window;
+	unsigned int i;
+	int bit;
+	int low;
+
+	/* Sanity check */
+	assert ( sizeof ( *temp ) ==
+		 bigint_mod_exp_tmp_len ( modulus, exponent ) );
+
+	/* Use simple square-and-multiply for even moduli */
+	if ( ! bigint_bit_is_set ( modulus, 0 ) ) {
+		bigint_mod_exp_simple_raw ( base0, modulus0, exponent0,
+					    result0, size, exponent_size,
+					    tmp );
+		return;
+	}
+
+	/* Calculate R mod N (i.e. the Montgomery form of one) in the
+	 * result, and convert the base to Montgomery form.
+	 */
+	memcpy ( &temp->base, base, sizeof ( temp->base ) );
+	memset ( result, 0, sizeof ( *result ) );
+	bigint_subtract ( modulus, result );
+	bigint_init ( &temp->power[0], one, sizeof ( one ) );
+	bigint_mod_multiply ( result, &temp->power[0], modulus, result,
+			      temp->mod_multiply );
+	bigint_mod_multiply ( &temp->base, result, modulus, &temp->power[0],
+			      temp->mod_multiply );
+
+	/* Precompute odd powers of the base, using temp->base to hold
+	 * the square of the base.
+	 */
+	inverse = bigint_montgomery_inverse ( modulus0 );
+	bigint_montgomery_raw ( temp->power[0].element, temp->power[0].element,
+				modulus0, inverse, temp->base.element, size,
+				temp->product.element );
+	for ( i = 1 ; i < BIGINT_MOD_EXP_POWERS ; i++ ) {
+		bigint_montgomery_raw ( temp->power[ i - 1 ].element,
+					temp->base.element, modulus0, inverse,
+					temp->power[i].element, size,
+					temp->product.element );
+	}
+
+	/* Scan exponent from most significant bit */
+	for ( bit = ( bigint_max_set_bit ( exponent ) - 1 ) ; bit >= 0 ; ) {
+
+		/* Square for each zero bit outside a window */
+		if ( ! bigint_bit_is_set ( exponent, bit ) ) {
+			bigint_montgomery_raw ( result0, result0, modulus0,
+						inverse, result0, size,
+						temp->product.element );
+			bit--;
+			continue;
+		}
+
+		/* Find longest window ending in a set bit */
+		low = ( bit - BIGINT_MOD_EXP_WINDOW + 1 );
+		if ( low < 0 )
+			low = 0;
+		while ( ! bigint_bit_is_set ( exponent, low ) )
+			low++;
+
+		/* Square once per bit in window, then multiply by
+		 * the corresponding odd power of the base.
+		 */
+		window = 0;
+		for ( ; bit >= low ; bit-- ) {
+			window <<= 1;
+			if ( bigint_bit_is_set ( exponent, bit ) )
+				window |= 1;
+			bigint_montgomery_raw ( result0, result0, modulus0,
+						inverse, result0, size,
+						temp->product.element );
+		}
+		bigint_montgomery_raw ( result0,
+					temp->power[ window / 2 ].element,
+					modulus0, inverse, result0, size,
+					temp->product.element );
+	}
+
+	/* Convert result out of Montgomery form */
+	bigint_init ( &temp->base, one, sizeof ( one ) );
+	bigint_montgomery_raw ( result0, temp->base.element, modulus0, inverse,
+				result0, size, temp->product.element );
+}
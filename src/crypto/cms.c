@@ -389,18 +389,21 @@ static int cms_parse_next ( struct x509_certificate *cert,
 	struct cms_signature *sig = context->sig;
 	struct cms_signer_info *info = context->info;
 	struct asn1_cursor cursor;
+	struct asn1_cursor raw;
 	int rc;
 
-	/* Search for relevant certificate */
+	/* Search for relevant certificate.  Each candidate is only
+	 * indexed (which is cheap); only the matching certificate is
+	 * fully parsed.
+	 */
 	memcpy ( &cursor, &sig->certificates, sizeof ( cursor ) );
-	while ( cursor.len ) {
+	while ( asn1_next ( &cursor, ASN1_ANY, &raw ) == 0 ) {
 
-		/* Parse certificate */
-		if ( ( rc = x509_parse ( cert, cursor.data,
-					 cursor.len ) ) != 0 ) {
+		/* Index certificate */
+		if ( ( rc = x509_index ( cert, raw.data, raw.len ) ) != 0 ) {
 			DBGC ( sig, "CMS %p/%p could not parse certificate:\n",
 			       sig, info );
-			DBGC_HDA ( sig, 0, cursor.data, cursor.len );
+			DBGC_HDA ( sig, 0, raw.data, raw.len );
 			return rc;
 		}
 
@@ -409,23 +412,30 @@ static int cms_parse_next ( struct x509_certificate *cert,
 			 * number against signer info
 			 */
 			if ( ( asn1_compare ( &info->issuer,
-					      &cert->issuer.raw ) == 0 ) &&
+					      &cert->issuer.raw ) != 0 ) ||
 			     ( asn1_compare ( &info->serial,
-					      &cert->serial.raw ) == 0 ) ) {
-				return 0;
+					      &cert->serial.raw ) != 0 ) ) {
+				continue;
 			}
 		} else {
 			/* Subsequent certificates: check subject
 			 * against previous certificate's issuer.
 			 */
 			if ( asn1_compare ( &previous->issuer.raw,
-					    &cert->subject.raw ) == 0 ) {
-				return 0;
+					    &cert->subject.raw ) != 0 ) {
+				continue;
 			}
 		}
 
-		/* Move to next certificate */
-		asn1_skip_any ( &cursor );
+		/* Parse certificate */
+		if ( ( rc = x509_parse ( cert, raw.data, raw.len ) ) != 0 ) {
+			DBGC ( sig, "CMS %p/%p could not parse certificate:\n",
+			       sig, info );
+			DBGC_HDA ( sig, 0, raw.data, raw.len );
+			return rc;
+		}
+
+		return 0;
 	}
 
 	DBGC ( sig, "CMS %p/%p reached end of certificate chain\n", sig, info );
@@ -439,17 +449,34 @@ static int cms_parse_next ( struct x509_certificate *cert,
  * @v info		Signer information
  * @v data		Signed data
  * @v len		Length of signed data
+ * @v digested		Algorithm of precalculated digest, or NULL
+ * @v digested_out	Precalculated digest of signed data, or NULL
  * @v out		Digest output
+ *
+ * A precalculated digest (e.g. one calculated while the signed data
+ * was being downloaded) is used if it was generated using the
+ * signer's digest algorithm.
  */
 static void cms_digest ( struct cms_signature *sig,
 			 struct cms_signer_info *info,
-			 userptr_t data, size_t len, void *out ) {
+			 userptr_t data, size_t len,
+			 struct digest_algorithm *digested,
+			 const void *digested_out, void *out ) {
 	struct digest_algorithm *digest = info->digest;
 	uint8_t ctx[ digest->ctxsize ];
 	uint8_t block[ digest->blocksize ];
 	size_t offset = 0;
 	size_t frag_len;
 
+	/* Use precalculated digest, if applicable */
+	if ( digested_out && ( digested == digest ) ) {
+		memcpy ( out, digested_out, digest->digestsize );
+		DBGC ( sig, "CMS %p/%p using precalculated digest value:\n",
+		       sig, info );
+		DBGC_HDA ( sig, 0, out, digest->digestsize );
+		return;
+	}
+
 	/* Initialise digest */
 	digest_init ( digest, ctx );
 
@@ -479,12 +506,16 @@ static void cms_digest ( struct cms_signature *sig,
  * @v cert		Corresponding certificate
  * @v data		Signed data
  * @v len		Length of signed data
+ * @v digested		Algorithm of precalculated digest, or NULL
+ * @v digested_out	Precalculated digest of signed data, or NULL
  * @ret rc		Return status code
  */
 static int cms_verify_digest ( struct cms_signature *sig,
 			       struct cms_signer_info *info,
 			       struct x509_certificate *cert,
-			       userptr_t data, size_t len ) {
+			       userptr_t data, size_t len,
+			       struct digest_algorithm *digested,
+			       const void *digested_out ) {
 	struct digest_algorithm *digest = info->digest;
 	struct pubkey_algorithm *pubkey = info->pubkey;
 	struct x509_public_key *public_key = &cert->subject.public_key;
@@ -493,7 +524,8 @@ static int cms_verify_digest ( struct cms_signature *sig,
 	int rc;
 
 	/* Generate digest */
-	cms_digest ( sig, info, data, len, digest_out );
+	cms_digest ( sig, info, data, len, digested, digested_out,
+		     digest_out );
 
 	/* Initialise public-key algorithm */
 	if ( ( rc = pubkey_init ( pubkey, ctx, public_key->raw.data,
@@ -524,6 +556,8 @@ static int cms_verify_digest ( struct cms_signature *sig,
  * @v info		Signer information
  * @v data		Signed data
  * @v len		Length of signed data
+ * @v digested		Algorithm of precalculated digest, or NULL
+ * @v digested_out	Precalculated digest of signed data, or NULL
  * @v name		Required common name, or NULL to allow any name
  * @v time		Time at which to validate certificates
  * @v root		Root certificate store, or NULL to use default
@@ -532,6 +566,8 @@ static int cms_verify_digest ( struct cms_signature *sig,
 static int cms_verify_signer_info ( struct cms_signature *sig,
 				    struct cms_signer_info *info,
 				    userptr_t data, size_t len,
+				    struct digest_algorithm *digested,
+				    const void *digested_out,
 				    const char *name, time_t time,
 				    struct x509_root *root ) {
 	struct cms_chain_context context;
@@ -573,31 +609,58 @@ static int cms_verify_signer_info ( struct cms_signature *sig,
 	}
 
 	/* Verify digest */
-	if ( ( rc = cms_verify_digest ( sig, info, &cert, data, len ) ) != 0 )
+	if ( ( rc = cms_verify_digest ( sig, info, &cert, data, len,
+					digested, digested_out ) ) != 0 )
 		return rc;
 
 	return 0;
 }
 
 /**
- * Verify CMS signature
+ * Verify CMS signature using precalculated digest
  *
  * @v sig		CMS signature
  * @v data		Signed data
  * @v len		Length of signed data
+ * @v digested		Algorithm of precalculated digest, or NULL
+ * @v digested_out	Precalculated digest of signed data, or NULL
  * @v name		Required common name, or NULL to allow any name
  * @v time		Time at which to validate certificates
  * @v root		Root certificate store, or NULL to use default
  * @ret rc		Return status code
+ *
+ * The signed data is digested only if the precalculated digest does
+ * not use the signer's digest algorithm.
  */
-int cms_verify ( struct cms_signature *sig, userptr_t data, size_t len,
-		 const char *name, time_t time, struct x509_root *root ) {
+int cms_verify_digested ( struct cms_signature *sig, userptr_t data,
+			  size_t len, struct digest_algorithm *digested,
+			  const void *digested_out, const char *name,
+			  time_t time, struct x509_root *root ) {
 	int rc;
 
 	/* Verify using first signerInfo */
 	if ( ( rc = cms_verify_signer_info ( sig, &sig->info, data, len,
+					     digested, digested_out,
 					     name, time, root ) ) != 0 )
 		return rc;
 
 	return 0;
 }
+
+/**
+ * Verify CMS signature
+ *
+ * @v sig		CMS signature
+ * @v data		Signed data
+ * @v len		Length of signed data
+ * @v name		Required common name, or NULL to allow any name
+ * @v time		Time at which to validate certificates
+ * @v root		Root certificate store, or NULL to use default
+ * @ret rc		Return status code
+ */
+int cms_verify ( struct cms_signature *sig, userptr_t data, size_t len,
+		 const char *name, time_t time, struct x509_root *root ) {
+
+	return cms_verify_digested ( sig, data, len, NULL, NULL,
+				     name, time, root );
+}
@@ -20,10 +20,70 @@
 
 FILE_LICENCE ( GPL2_OR_LATER );
 
+#include <stdint.h>
+#include <byteswap.h>
 #include <ipxe/crc32.h>
 
+/** @file
+ *
+ * Little-endian CRC32
+ *
+ * The checksum is calculated using the "slice-by-8" algorithm, which
+ * consumes eight bytes per iteration using eight 256-entry lookup
+ * tables.  The tables are constructed on first use, to avoid adding
+ * 8kB to the size of the binary.
+ */
+
 #define CRCPOLY		0xedb88320
 
+/** Number of lookup tables */
+#define CRC32_SLICES	8
+
+/** CRC32 lookup tables */
+static u32 crc32_table[CRC32_SLICES][256];
+
+/** CRC32 lookup tables have been constructed */
+static int crc32_table_valid;
+
+/**
+ * Construct CRC32 lookup tables
+ *
+ * Table 0 holds the CRC of each single byte value.  Table @c n holds
+ * the CRC of each byte value followed by @c n zero bytes.
+ */
+static void crc32_init_table ( void ) {
+	u32 crc;
+	unsigned int i;
+	unsigned int j;
+
+	for ( i = 0 ; i < 256 ; i++ ) {
+		crc = i;
+		for ( j = 0 ; j < 8 ; j++ )
+			crc = ( ( crc >> 1 ) ^ ( ( crc & 1 ) ? CRCPOLY : 0 ) );
+		crc32_table[0][i] = crc;
+	}
+	for ( i = 0 ; i < 256 ; i++ ) {
+		crc = crc32_table[0][i];
+		for ( j = 1 ; j < CRC32_SLICES ; j++ ) {
+			crc = ( ( crc >> 8 ) ^
+				crc32_table[0][ crc & 0xff ] );
+			crc32_table[j][i] = crc;
+		}
+	}
+	crc32_table_valid = 1;
+}
+
+/**
+ * Update CRC32 checksum with a single byte
+ *
+ * @v crc	Current CRC value
+ * @v byte	Data byte
+ * @ret crc	Updated CRC value
+ */
+static inline u32 crc32_byte ( u32 crc, u8 byte ) {
+	return ( ( crc >> 8 ) ^ crc32_table[0][ ( crc ^ byte ) & 0xff ] );
+}
+
 /**
  * Calculate 32-bit little-endian CRC checksum
  *
@@ -39,16 +99,40 @@ u32 crc32_le ( u32 seed, const void *data, size_t len )
 {
 	u32 crc = seed;
 	const u8 *src = data;
-	u32 mult;
-	int i;
-
-	while ( len-- ) {
-		crc ^= *src++;
-		for ( i = 0; i < 8; i++ ) {
-			mult = ( crc & 1 ) ? CRCPOLY : 0;
-			crc = ( crc >> 1 ) ^ mult;
-		}
+	const u32 *src32;
+	u32 low;
+	u32 high;
+
+	/* Construct lookup tables, if not already done */
+	if ( ! crc32_table_valid )
+		crc32_init_table();
+
+	/* Process leading bytes until source is aligned */
+	while ( len && ( ( ( intptr_t ) src ) & ( sizeof ( *src32 ) - 1 ) ) ) {
+		crc = crc32_byte ( crc, *(src++) );
+		len--;
 	}
 
+	/* Process eight bytes at a time */
+	src32 = ( ( const u32 * ) src );
+	while ( len >= CRC32_SLICES ) {
+		low = ( crc ^ le32_to_cpu ( *(src32++) ) );
+		high = le32_to_cpu ( *(src32++) );
+		crc = ( crc32_table[7][ ( low >> 0 ) & 0xff ] ^
+			crc32_table[6][ ( low >> 8 ) & 0xff ] ^
+			crc32_table[5][ ( low >> 16 ) & 0xff ] ^
+			crc32_table[4][ ( low >> 24 ) & 0xff ] ^
+			crc32_table[3][ ( high >> 0 ) & 0xff ] ^
+			crc32_table[2][ ( high >> 8 ) & 0xff ] ^
+			crc32_table[1][ ( high >> 16 ) & 0xff ] ^
+			crc32_table[0][ ( high >> 24 ) & 0xff ] );
+		len -= CRC32_SLICES;
+	}
+	src = ( ( const u8 * ) src32 );
+
+	/* Process trailing bytes */
+	while ( len-- )
+		crc = crc32_byte ( crc, *(src++) );
+
 	return crc;
 }
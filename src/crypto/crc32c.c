@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <byteswap.h>
+#include <ipxe/crc32c.h>
+
+/** @file
+ *
+ * CRC32C (Castagnoli) checksum
+ *
+ * This is the checksum used for iSCSI header and data digests.  The
+ * generic implementation uses the same "slice-by-8" algorithm as the
+ * CRC32 implementation, with lookup tables constructed on first use.
+ * Architectures may provide a faster crc32c_le() using dedicated
+ * instructions, falling back to crc32c_le_generic() when those are
+ * unavailable.
+ */
+
+/** CRC32C polynomial (bit-reversed) */
+#define CRC32C_POLY	0x82f63b78
+
+/** Number of lookup tables */
+#define CRC32C_SLICES	8
+
+/** CRC32C lookup tables */
+static u32 crc32c_table[CRC32C_SLICES][256];
+
+/** CRC32C lookup tables have been constructed */
+static int crc32c_table_valid;
+
+/**
+ * Construct CRC32C lookup tables
+ *
+ * Table 0 holds the CRC of each single byte value.  Table @c n holds
+ * the CRC of each byte value followed by @c n zero bytes.
+ */
+static void crc32c_init_table ( void ) {
+	u32 crc;
+	unsigned int i;
+	unsigned int j;
+
+	for ( i = 0 ; i < 256 ; i++ ) {
+		crc = i;
+		for ( j = 0 ; j < 8 ; j++ ) {
+			crc = ( ( crc >> 1 ) ^
+				( ( crc & 1 ) ? CRC32C_POLY : 0 ) );
+		}
+		crc32c_table[0][i] = crc;
+	}
+	for ( i = 0 ; i < 256 ; i++ ) {
+		crc = crc32c_table[0][i];
+		for ( j = 1 ; j < CRC32C_SLICES ; j++ ) {
+			crc = ( ( crc >> 8 ) ^
+				crc32c_table[0][ crc & 0xff ] );
+			crc32c_table[j][i] = crc;
+		}
+	}
+	crc32c_table_valid = 1;
+}
+
+/**
+ * Update CRC32C checksum with a single byte
+ *
+ * @v crc	Current CRC value
+ * @v byte	Data byte
+ * @ret crc	Updated CRC value
+ */
+static inline u32 crc32c_byte ( u32 crc, u8 byte ) {
+	return ( ( crc >> 8 ) ^ crc32c_table[0][ ( crc ^ byte ) & 0xff ] );
+}
+
+/**
+ * Calculate CRC32C checksum without using any special instructions
+ *
+ * @v seed	Initial value
+ * @v data	Data to checksum
+ * @v len	Length of data
+ * @ret crc	CRC value
+ *
+ * Usually @a seed is initially all one bits.  To continue a CRC
+ * checksum over multiple calls, pass the return value from one call
+ * as the @a seed parameter to the next.
+ */
+u32 crc32c_le_generic ( u32 seed, const void *data, size_t len ) {
+	u32 crc = seed;
+	const u8 *src = data;
+	const u32 *src32;
+	u32 low;
+	u32 high;
+
+	/* Construct lookup tables, if not already done */
+	if ( ! crc32c_table_valid )
+		crc32c_init_table();
+
+	/* Process leading bytes until source is aligned */
+	while ( len && ( ( ( intptr_t ) src ) & ( sizeof ( *src32 ) - 1 ) ) ) {
+		crc = crc32c_byte ( crc, *(src++) );
+		len--;
+	}
+
+	/* Process eight bytes at a time */
+	src32 = ( ( const u32 * ) src );
+	while ( len >= CRC32C_SLICES ) {
+		low = ( crc ^ le32_to_cpu ( *(src32++) ) );
+		high = le32_to_cpu ( *(src32++) );
+		crc = ( crc32c_table[7][ ( low >> 0 ) & 0xff ] ^
+			crc32c_table[6][ ( low >> 8 ) & 0xff ] ^
+			crc32c_table[5][ ( low >> 16 ) & 0xff ] ^
+			crc32c_table[4][ ( low >> 24 ) & 0xff ] ^
+			crc32c_table[3][ ( high >> 0 ) & 0xff ] ^
+			crc32c_table[2][ ( high >> 8 ) & 0xff ] ^
+			crc32c_table[1][ ( high >> 16 ) & 0xff ] ^
+			crc32c_table[0][ ( high >> 24 ) & 0xff ] );
+		len -= CRC32C_SLICES;
+	}
+	src = ( ( const u8 * ) src32 );
+
+	/* Process trailing bytes */
+	while ( len-- )
+		crc = crc32c_byte ( crc, *(src++) );
+
+	return crc;
+}
@@ -68,7 +68,8 @@ static void cipher_null_encrypt ( void *ctx __unused, const void *src,
 
 static void cipher_null_decrypt ( void *ctx __unused, const void *src,
 				  void *dst, size_t len ) {
-	memcpy ( dst, src, len );
+	if ( dst != src )
+		memcpy ( dst, src, len );
 }
 
 struct cipher_algorithm cipher_null = {
@@ -0,0 +1,328 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <byteswap.h>
+#include <ipxe/crypto.h>
+#include <ipxe/gcm.h>
+
+/** @file
+ *
+ * Galois/Counter Mode (GCM)
+ *
+ * The GHASH multiplication uses Shoup's method with a table of
+ * sixteen precomputed multiples of the hash key, processing the
+ * input four bits at a time.
+ *
+ */
+
+/** Reduction constants for each possible four-bit remainder */
+static const uint16_t gcm_reduce[16] = {
+	0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+	0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0,
+};
+
+/**
+ * XOR data blocks
+ *
+ * @v src		Input data
+ * @v dst		Second input data and output data buffer
+ * @v len		Length of data
+ */
+static void gcm_xor ( const void *src, void *dst, size_t len ) {
+	const uint8_t *srcb = src;
+	uint8_t *dstb = dst;
+
+	while ( len-- )
+		*(dstb++) ^= *(srcb++);
+}
+
+/**
+ * Multiply accumulated hash by hash key
+ *
+ * @v gcm_ctx		GCM context
+ */
+static void gcm_multiply ( struct gcm_context *gcm_ctx ) {
+	const uint8_t *x = gcm_ctx->hash.byte;
+	uint64_t zh;
+	uint64_t zl;
+	unsigned int rem;
+	unsigned int lo;
+	unsigned int hi;
+	int i;
+
+	lo = ( x[ GCM_BLOCKSIZE - 1 ] & 0x0f );
+	zh = gcm_ctx->hh[lo];
+	zl = gcm_ctx->hl[lo];
+
+	for ( i = ( GCM_BLOCKSIZE - 1 ) ; i >= 0 ; i-- ) {
+		lo = ( x[i] & 0x0f );
+		hi = ( x[i] >> 4 );
+		if ( i != ( GCM_BLOCKSIZE - 1 ) ) {
+			rem = ( zl & 0x0f );
+			zl = ( ( zh << 60 ) | ( zl >> 4 ) );
+			zh = ( ( zh >> 4 ) ^
+			       ( ( ( uint64_t ) gcm_reduce[rem] ) << 48 ) );
+			zh ^= gcm_ctx->hh[lo];
+			zl ^= gcm_ctx->hl[lo];
+		}
+		rem = ( zl & 0x0f );
+		zl = ( ( zh << 60 ) | ( zl >> 4 ) );
+		zh = ( ( zh >> 4 ) ^
+		       ( ( ( uint64_t ) gcm_reduce[rem] ) << 48 ) );
+		zh ^= gcm_ctx->hh[hi];
+		zl ^= gcm_ctx->hl[hi];
+	}
+
+	gcm_ctx->hash.qword[0] = cpu_to_be64 ( zh );
+	gcm_ctx->hash.qword[1] = cpu_to_be64 ( zl );
+}
+
+/**
+ * Update accumulated hash
+ *
+ * @v gcm_ctx		GCM context
+ * @v data		Data
+ * @v len		Length of data
+ *
+ * Any trailing partial block is padded with zeroes.
+ */
+static void gcm_hash ( struct gcm_context *gcm_ctx, const void *data,
+		       size_t len ) {
+	size_t frag_len;
+
+	while ( len ) {
+		frag_len = len;
+		if ( frag_len > GCM_BLOCKSIZE )
+			frag_len = GCM_BLOCKSIZE;
+		gcm_xor ( data, gcm_ctx->hash.byte, frag_len );
+		gcm_multiply ( gcm_ctx );
+		data += frag_len;
+		len -= frag_len;
+	}
+}
+
+/**
+ * Set key
+ *
+ * @v ctx		Context
+ * @v key		Key
+ * @v keylen		Key length
+ * @v raw_cipher	Underlying cipher algorithm
+ * @v gcm_ctx		GCM context
+ * @ret rc		Return status code
+ */
+int gcm_setkey ( void *ctx, const void *key, size_t keylen,
+		 struct cipher_algorithm *raw_cipher,
+		 struct gcm_context *gcm_ctx ) {
+	union gcm_block hkey;
+	uint64_t vh;
+	uint64_t vl;
+	uint64_t carry;
+	unsigned int i;
+	unsigned int j;
+	int rc;
+
+	/* Set underlying cipher key */
+	if ( ( rc = cipher_setkey ( raw_cipher, ctx, key, keylen ) ) != 0 )
+		return rc;
+
+	/* Construct hash key H = E(K,0) */
+	memset ( &hkey, 0, sizeof ( hkey ) );
+	cipher_encrypt ( raw_cipher, ctx, &hkey, &hkey, sizeof ( hkey ) );
+	vh = be64_to_cpu ( hkey.qword[0] );
+	vl = be64_to_cpu ( hkey.qword[1] );
+
+	/* Construct single-bit multiples of H.  The field uses a
+	 * reflected bit order, so that H itself is at index 8.
+	 */
+	gcm_ctx->hh[0] = 0;
+	gcm_ctx->hl[0] = 0;
+	gcm_ctx->hh[8] = vh;
+	gcm_ctx->hl[8] = vl;
+	for ( i = 4 ; i > 0 ; i >>= 1 ) {
+		carry = ( ( vl & 1 ) ? 0xe100000000000000ULL : 0 );
+		vl = ( ( vh << 63 ) | ( vl >> 1 ) );
+		vh = ( ( vh >> 1 ) ^ carry );
+		gcm_ctx->hh[i] = vh;
+		gcm_ctx->hl[i] = vl;
+	}
+
+	/* Construct remaining multiples by linearity */
+	for ( i = 2 ; i <= 8 ; i <<= 1 ) {
+		for ( j = 1 ; j < i ; j++ ) {
+			gcm_ctx->hh[ i + j ] = ( gcm_ctx->hh[i] ^
+						 gcm_ctx->hh[j] );
+			gcm_ctx->hl[ i + j ] = ( gcm_ctx->hl[i] ^
+						 gcm_ctx->hl[j] );
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Set initialisation vector
+ *
+ * @v ctx		Context
+ * @v iv		Initialisation vector (of length @c GCM_IV_LEN)
+ * @v raw_cipher	Underlying cipher algorithm
+ * @v gcm_ctx		GCM context
+ *
+ * Setting the initialisation vector also resets the accumulated
+ * hash, ready to process a new message.
+ */
+void gcm_setiv ( void *ctx __unused, const void *iv,
+		 struct cipher_algorithm *raw_cipher __unused,
+		 struct gcm_context *gcm_ctx ) {
+
+	/* Construct initial counter Y0 = IV || 0^31 || 1 */
+	memset ( &gcm_ctx->iv, 0, sizeof ( gcm_ctx->iv ) );
+	memcpy ( &gcm_ctx->iv, iv, GCM_IV_LEN );
+	gcm_ctx->iv.byte[ GCM_BLOCKSIZE - 1 ] = 1;
+	memcpy ( &gcm_ctx->ctr, &gcm_ctx->iv, sizeof ( gcm_ctx->ctr ) );
+
+	/* Reset accumulated hash */
+	memset ( &gcm_ctx->hash, 0, sizeof ( gcm_ctx->hash ) );
+	gcm_ctx->add_len = 0;
+	gcm_ctx->data_len = 0;
+}
+
+/**
+ * Encrypt or decrypt data in counter mode
+ *
+ * @v ctx		Context
+ * @v src		Input data
+ * @v dst		Output data
+ * @v len		Length of data
+ * @v raw_cipher	Underlying cipher algorithm
+ * @v gcm_ctx		GCM context
+ * @v encrypting	Data is being encrypted
+ */
+static void gcm_crypt ( void *ctx, const void *src, void *dst, size_t len,
+			struct cipher_algorithm *raw_cipher,
+			struct gcm_context *gcm_ctx, int encrypting ) {
+	union gcm_block keystream;
+	uint32_t *counter =
+		( ( uint32_t * ) &gcm_ctx->ctr.byte[ GCM_BLOCKSIZE -
+						     sizeof ( *counter ) ] );
+	size_t frag_len;
+
+	/* Treat any data without an output buffer as additional data */
+	if ( ! dst ) {
+		gcm_hash ( gcm_ctx, src, len );
+		gcm_ctx->add_len += len;
+		return;
+	}
+
+	/* Process data */
+	gcm_ctx->data_len += len;
+	while ( len ) {
+
+		/* Generate keystream block */
+		*counter = cpu_to_be32 ( be32_to_cpu ( *counter ) + 1 );
+		cipher_encrypt ( raw_cipher, ctx, &gcm_ctx->ctr, &keystream,
+				 sizeof ( keystream ) );
+
+		/* Hash ciphertext before decrypting, since the input
+		 * buffer may be overwritten if decrypting in place.
+		 */
+		frag_len = len;
+		if ( frag_len > GCM_BLOCKSIZE )
+			frag_len = GCM_BLOCKSIZE;
+		if ( ! encrypting )
+			gcm_hash ( gcm_ctx, src, frag_len );
+		memmove ( dst, src, frag_len );
+		gcm_xor ( &keystream, dst, frag_len );
+		if ( encrypting )
+			gcm_hash ( gcm_ctx, dst, frag_len );
+
+		src += frag_len;
+		dst += frag_len;
+		len -= frag_len;
+	}
+}
+
+/**
+ * Encrypt data
+ *
+ * @v ctx		Context
+ * @v src		Data to encrypt
+ * @v dst		Buffer for encrypted data, or NULL for additional data
+ * @v len		Length of data
+ * @v raw_cipher	Underlying cipher algorithm
+ * @v gcm_ctx		GCM context
+ *
+ * Additional data must be provided before any encrypted data.  Each
+ * call is padded to a whole number of blocks, so all calls other
+ * than the last of each type must use a multiple of @c GCM_BLOCKSIZE.
+ */
+void gcm_encrypt ( void *ctx, const void *src, void *dst, size_t len,
+		   struct cipher_algorithm *raw_cipher,
+		   struct gcm_context *gcm_ctx ) {
+
+	gcm_crypt ( ctx, src, dst, len, raw_cipher, gcm_ctx, 1 );
+}
+
+/**
+ * Decrypt data
+ *
+ * @v ctx		Context
+ * @v src		Data to decrypt
+ * @v dst		Buffer for decrypted data, or NULL for additional data
+ * @v len		Length of data
+ * @v raw_cipher	Underlying cipher algorithm
+ * @v gcm_ctx		GCM context
+ *
+ * The same restrictions apply as for gcm_encrypt().
+ */
+void gcm_decrypt ( void *ctx, const void *src, void *dst, size_t len,
+		   struct cipher_algorithm *raw_cipher,
+		   struct gcm_context *gcm_ctx ) {
+
+	gcm_crypt ( ctx, src, dst, len, raw_cipher, gcm_ctx, 0 );
+}
+
+/**
+ * Generate authentication tag
+ *
+ * @v ctx		Context
+ * @v auth		Buffer for authentication tag
+ * @v raw_cipher	Underlying cipher algorithm
+ * @v gcm_ctx		GCM context
+ */
+void gcm_auth ( void *ctx, void *auth, struct cipher_algorithm *raw_cipher,
+		struct gcm_context *gcm_ctx ) {
+	union gcm_block lengths;
+	union gcm_block tag;
+
+	/* Hash lengths (in bits) */
+	lengths.qword[0] = cpu_to_be64 ( gcm_ctx->add_len * 8 );
+	lengths.qword[1] = cpu_to_be64 ( gcm_ctx->data_len * 8 );
+	gcm_hash ( gcm_ctx, &lengths, sizeof ( lengths ) );
+
+	/* Construct tag T = GHASH ^ E(K,Y0) */
+	cipher_encrypt ( raw_cipher, ctx, &gcm_ctx->iv, &tag, sizeof ( tag ) );
+	gcm_xor ( &gcm_ctx->hash, &tag, sizeof ( tag ) );
+	memcpy ( auth, &tag, GCM_AUTHSIZE );
+}
@@ -40,9 +40,81 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <errno.h>
 #include <assert.h>
 #include <ipxe/crypto.h>
-#include <ipxe/hmac.h>
 #include <ipxe/hmac_drbg.h>
 
+/**
+ * Set the HMAC_DRBG key
+ *
+ * @v hash		Underlying hash algorithm
+ * @v state		HMAC_DRBG internal state
+ *
+ * This precalculates the inner and outer hash contexts for the
+ * current key, so that subsequent HMAC calculations using the same
+ * key do not need to process the padded key again.  It must be
+ * called whenever the key is changed.
+ */
+static void hmac_drbg_set_key ( struct digest_algorithm *hash,
+				struct hmac_drbg_state *state ) {
+	uint8_t pad[ hash->blocksize ];
+	size_t out_len = hash->digestsize;
+	unsigned int i;
+
+	/* Sanity checks */
+	assert ( hash->ctxsize <= sizeof ( state->inner ) );
+	assert ( out_len <= sizeof ( pad ) );
+
+	/* Construct inner hash context from ( Key XOR ipad ) */
+	memset ( pad, 0, sizeof ( pad ) );
+	memcpy ( pad, state->key, out_len );
+	for ( i = 0 ; i < sizeof ( pad ) ; i++ )
+		pad[i] ^= 0x36;
+	digest_init ( hash, state->inner );
+	digest_update ( hash, state->inner, pad, sizeof ( pad ) );
+
+	/* Construct outer hash context from ( Key XOR opad ) */
+	for ( i = 0 ; i < sizeof ( pad ) ; i++ )
+		pad[i] ^= ( 0x36 ^ 0x5c );
+	digest_init ( hash, state->outer );
+	digest_update ( hash, state->outer, pad, sizeof ( pad ) );
+}
+
+/**
+ * Calculate HMAC using the current HMAC_DRBG key
+ *
+ * @v hash		Underlying hash algorithm
+ * @v state		HMAC_DRBG internal state
+ * @v data		Provided data, or NULL
+ * @v len		Length of provided data
+ * @v single		Pointer to single byte used in concatenation, or NULL
+ * @v out		Output buffer
+ *
+ * This function carries out the operation
+ *
+ *     out = HMAC ( K, V || [ single || provided_data ] )
+ *
+ * The output buffer may overlap the current key or value.
+ */
+static void hmac_drbg_hmac ( struct digest_algorithm *hash,
+			     struct hmac_drbg_state *state,
+			     const void *data, size_t len,
+			     const uint8_t *single, void *out ) {
+	uint8_t context[ hash->ctxsize ];
+	uint8_t inner[ hash->digestsize ];
+
+	/* Inner hash */
+	memcpy ( context, state->inner, sizeof ( context ) );
+	digest_update ( hash, context, state->value, sizeof ( inner ) );
+	if ( single )
+		digest_update ( hash, context, single, sizeof ( *single ) );
+	digest_update ( hash, context, data, len );
+	digest_final ( hash, context, inner );
+
+	/* Outer hash */
+	memcpy ( context, state->outer, sizeof ( context ) );
+	digest_update ( hash, context, inner, sizeof ( inner ) );
+	digest_final ( hash, context, out );
+}
+
 /**
  * Update the HMAC_DRBG key
  *
@@ -62,8 +134,6 @@ static void hmac_drbg_update_key ( struct digest_algorithm *hash,
 				   struct hmac_drbg_state *state,
 				   const void *data, size_t len,
 				   const uint8_t single ) {
-	uint8_t context[ hash->ctxsize ];
-	size_t out_len = hash->digestsize;
 
 	DBGC ( state, "HMAC_DRBG_%s %p provided data :\n", hash->name, state );
 	DBGC_HDA ( state, 0, data, len );
@@ -75,17 +145,12 @@ static void hmac_drbg_update_key ( struct digest_algorithm *hash,
 	assert ( ( single == 0x00 ) || ( single == 0x01 ) );
 
 	/* K = HMAC ( K, V || single || provided_data ) */
-	hmac_init ( hash, context, state->key, &out_len );
-	assert ( out_len == hash->digestsize );
-	hmac_update ( hash, context, state->value, out_len );
-	hmac_update ( hash, context, &single, sizeof ( single ) );
-	hmac_update ( hash, context, data, len );
-	hmac_final ( hash, context, state->key, &out_len, state->key );
-	assert ( out_len == hash->digestsize );
+	hmac_drbg_hmac ( hash, state, data, len, &single, state->key );
+	hmac_drbg_set_key ( hash, state );
 
 	DBGC ( state, "HMAC_DRBG_%s %p K = HMAC ( K, V || %#02x || "
 	       "provided_data ) :\n", hash->name, state, single );
-	DBGC_HDA ( state, 0, state->key, out_len );
+	DBGC_HDA ( state, 0, state->key, hash->digestsize );
 }
 
 /**
@@ -105,23 +170,17 @@ static void hmac_drbg_update_key ( struct digest_algorithm *hash,
  */
 static void hmac_drbg_update_value ( struct digest_algorithm *hash,
 				     struct hmac_drbg_state *state ) {
-	uint8_t context[ hash->ctxsize ];
-	size_t out_len = hash->digestsize;
 
 	/* Sanity checks */
 	assert ( hash != NULL );
 	assert ( state != NULL );
 
 	/* V = HMAC ( K, V ) */
-	hmac_init ( hash, context, state->key, &out_len );
-	assert ( out_len == hash->digestsize );
-	hmac_update ( hash, context, state->value, out_len );
-	hmac_final ( hash, context, state->key, &out_len, state->value );
-	assert ( out_len == hash->digestsize );
+	hmac_drbg_hmac ( hash, state, NULL, 0, NULL, state->value );
 
 	DBGC ( state, "HMAC_DRBG_%s %p V = HMAC ( K, V ) :\n",
 	       hash->name, state );
-	DBGC_HDA ( state, 0, state->value, out_len );
+	DBGC_HDA ( state, 0, state->value, hash->digestsize );
 }
 
 /**
@@ -210,6 +269,7 @@ void hmac_drbg_instantiate ( struct digest_algorithm *hash,
 
 	/* 2.  Key = 0x00 00..00 */
 	memset ( state->key, 0x00, out_len );
+	hmac_drbg_set_key ( hash, state );
 
 	/* 3.  V = 0x01 01...01 */
 	memset ( state->value, 0x01, out_len );
@@ -40,6 +40,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 
 #include <stddef.h>
 #include <stdint.h>
+#include <ipxe/drbg.h>
 #include <ipxe/rbg.h>
 #include <ipxe/random_nz.h>
 
@@ -53,22 +54,41 @@ FILE_LICENCE ( GPL2_OR_LATER );
  * This algorithm is designed to be isomorphic to the Simple Discard
  * Method described in ANS X9.82 Part 1-2006 Section 9.2.1 (NIST SP
  * 800-90 Section B.5.1.1).
+ *
+ * Random bytes are generated in bulk to fill the whole of the
+ * remaining output buffer, rather than one byte at a time.  Zero
+ * bytes are then discarded, and the remainder of the buffer is
+ * refilled as necessary.
  */
 int get_random_nz ( void *data, size_t len ) {
 	uint8_t *bytes = data;
+	uint8_t *src;
+	uint8_t *dst;
+	size_t frag_len;
+	size_t remaining;
 	int rc;
 
 	while ( len ) {
 
-		/* Generate random byte */
-		if ( ( rc = rbg_generate ( NULL, 0, 0, bytes, 1 ) ) != 0 )
+		/* Generate random bytes */
+		frag_len = len;
+		if ( frag_len > DRBG_MAX_GENERATED_LEN_BYTES )
+			frag_len = DRBG_MAX_GENERATED_LEN_BYTES;
+		if ( ( rc = rbg_generate ( NULL, 0, 0, bytes,
+					   frag_len ) ) != 0 )
 			return rc;
 
-		/* Move to next byte if this byte is acceptable */
-		if ( *bytes != 0 ) {
-			bytes++;
-			len--;
+		/* Discard any zero bytes */
+		src = dst = bytes;
+		for ( remaining = frag_len ; remaining ; remaining-- ) {
+			if ( *src != 0 )
+				*(dst++) = *src;
+			src++;
 		}
+
+		/* Move to first byte not yet filled */
+		len -= ( dst - bytes );
+		bytes = dst;
 	}
 
 	return 0;
@@ -80,12 +80,32 @@ static int rbg_startup ( void ) {
 	return 0;
 }
 
+/**
+ * Complete deferred RBG startup
+ *
+ * Instantiating the DRBG requires the collection of a substantial
+ * amount of entropy, which can be slow.  This is therefore deferred
+ * until the first request for random bits, so that boots which never
+ * use TLS (or any other consumer of random bits) do not pay the cost.
+ */
+void rbg_startup_deferred ( void ) {
+
+	/* Start up RBG.  As with an immediate startup, a failure will
+	 * result in an invalid DRBG that refuses to generate bits.
+	 */
+	rbg.deferred = 0;
+	rbg_startup();
+}
+
 /**
  * Shut down RBG
  *
  */
 static void rbg_shutdown ( void ) {
 
+	/* Cancel any deferred startup */
+	rbg.deferred = 0;
+
 	/* Uninstantiate DRBG */
 	drbg_uninstantiate ( &rbg.state );
 }
@@ -93,11 +113,8 @@ static void rbg_shutdown ( void ) {
 /** RBG startup function */
 static void rbg_startup_fn ( void ) {
 
-	/* Start up RBG.  There is no way to report an error at this
-	 * stage, but a failed startup will result in an invalid DRBG
-	 * that refuses to generate bits.
-	 */
-	rbg_startup();
+	/* Defer startup until first use */
+	rbg.deferred = 1;
 }
 
 /** RBG shutdown function */
@@ -142,6 +142,46 @@ rsa_find_prefix ( struct digest_algorithm *digest ) {
 	return NULL;
 }
 
+/**
+ * Define temporary working space for RSA CRT private-key operation
+ *
+ * @v size		Number of elements in modulus
+ * @v prime_size	Number of elements in each prime factor
+ * @v mod_multiply_len	Length of working space for modular multiplication
+ * @v mod_exp_len	Length of working space for modular exponentiation
+ */
+#define rsa_crt_tmp_t( size, prime_size, mod_multiply_len, mod_exp_len ) \
+	struct {							\
+		bigint_t ( size ) modulus;				\
+		bigint_t ( size ) reduced;				\
+		bigint_t ( prime_size ) base;				\
+		bigint_t ( prime_size ) result[2];			\
+		bigint_t ( prime_size ) difference;			\
+		bigint_t ( prime_size * 2 ) product;			\
+		bigint_t ( prime_size * 2 ) sum;			\
+		union {							\
+			uint8_t mod_multiply[mod_multiply_len];		\
+			uint8_t mod_exp[mod_exp_len];			\
+		} tmp;							\
+	}
+
+/**
+ * Calculate temporary working space required for RSA CRT operation
+ *
+ * @v size		Number of elements in modulus
+ * @v prime_size	Number of elements in each prime factor
+ * @ret len		Length of temporary working space
+ */
+static size_t rsa_crt_tmp_len ( unsigned int size, unsigned int prime_size ) {
+	bigint_t ( size ) *modulus;
+	bigint_t ( prime_size ) *prime;
+	size_t mod_multiply_len = bigint_mod_multiply_tmp_len ( modulus );
+	size_t mod_exp_len = bigint_mod_exp_tmp_len ( prime, prime );
+
+	return sizeof ( rsa_crt_tmp_t ( size, prime_size, mod_multiply_len,
+					mod_exp_len ) );
+}
+
 /**
  * Free RSA dynamic storage
  *
@@ -159,22 +199,31 @@ static void rsa_free ( struct rsa_context *context ) {
  * @v context		RSA context
  * @v modulus_len	Modulus length
  * @v exponent_len	Exponent length
+ * @v prime_len		Prime factor length, or zero if not using the CRT
  * @ret rc		Return status code
  */
 static int rsa_alloc ( struct rsa_context *context, size_t modulus_len,
-		       size_t exponent_len ) {
+		       size_t exponent_len, size_t prime_len ) {
 	unsigned int size = bigint_required_size ( modulus_len );
 	unsigned int exponent_size = bigint_required_size ( exponent_len );
+	unsigned int prime_size = bigint_required_size ( prime_len );
 	bigint_t ( size ) *modulus;
 	bigint_t ( exponent_size ) *exponent;
 	size_t tmp_len = bigint_mod_exp_tmp_len ( modulus, exponent );
+	size_t crt_tmp_len =
+		( prime_len ? rsa_crt_tmp_len ( size, prime_size ) : 0 );
+	unsigned int i;
 	struct {
 		bigint_t ( size ) modulus;
 		bigint_t ( exponent_size ) exponent;
 		bigint_t ( size ) input;
 		bigint_t ( size ) output;
-		uint8_t tmp[tmp_len];
-	} __attribute__ (( packed )) *dynamic;
+		bigint_t ( prime_size ) prime[2];
+		bigint_t ( prime_size ) crt_exponent[2];
+		bigint_t ( prime_size ) coefficient;
+		uint8_t tmp[ ( tmp_len > crt_tmp_len ) ?
+			     tmp_len : crt_tmp_len ];
+	} *dynamic;
 
 	/* Free any existing dynamic storage */
 	rsa_free ( context );
@@ -193,6 +242,15 @@ static int rsa_alloc ( struct rsa_context *context, size_t modulus_len,
 	context->exponent_size = exponent_size;
 	context->input0 = &dynamic->input.element[0];
 	context->output0 = &dynamic->output.element[0];
+	if ( prime_len ) {
+		context->prime_size = prime_size;
+		for ( i = 0 ; i < 2 ; i++ ) {
+			context->prime0[i] = &dynamic->prime[i].element[0];
+			context->crt_exponent0[i] =
+				&dynamic->crt_exponent[i].element[0];
+		}
+		context->coefficient0 = &dynamic->coefficient.element[0];
+	}
 	context->tmp = &dynamic->tmp;
 
 	return 0;
@@ -231,6 +289,64 @@ static int rsa_parse_integer ( struct rsa_context *context,
 	return 0;
 }
 
+/**
+ * Parse RSA CRT parameters
+ *
+ * @v context		RSA context
+ * @v raw		ASN.1 cursor positioned at privateExponent
+ * @v modulus_len	Modulus length
+ * @v prime		Prime factors to fill in
+ * @v crt_exponent	CRT exponents to fill in
+ * @v coefficient	CRT coefficient to fill in
+ * @ret prime_len	Prime factor length, or zero if CRT is not usable
+ */
+static size_t rsa_parse_crt ( struct rsa_context *context,
+			      const struct asn1_cursor *raw,
+			      size_t modulus_len, struct asn1_cursor *prime,
+			      struct asn1_cursor *crt_exponent,
+			      struct asn1_cursor *coefficient ) {
+	struct asn1_cursor cursor;
+	size_t prime_len;
+	unsigned int i;
+
+	/* Skip privateExponent */
+	memcpy ( &cursor, raw, sizeof ( cursor ) );
+	asn1_skip_any ( &cursor );
+
+	/* Extract prime1 and prime2 */
+	for ( i = 0 ; i < 2 ; i++ ) {
+		if ( rsa_parse_integer ( context, &prime[i], &cursor ) != 0 )
+			return 0;
+		asn1_skip_any ( &cursor );
+	}
+	prime_len = prime[0].len;
+	if ( prime_len < prime[1].len )
+		prime_len = prime[1].len;
+
+	/* Extract exponent1 and exponent2 */
+	for ( i = 0 ; i < 2 ; i++ ) {
+		if ( rsa_parse_integer ( context, &crt_exponent[i],
+					 &cursor ) != 0 )
+			return 0;
+		asn1_skip_any ( &cursor );
+	}
+
+	/* Extract coefficient */
+	if ( rsa_parse_integer ( context, coefficient, &cursor ) != 0 )
+		return 0;
+
+	/* Check that all values will fit */
+	if ( ( prime_len > modulus_len ) ||
+	     ( crt_exponent[0].len > prime_len ) ||
+	     ( crt_exponent[1].len > prime_len ) ||
+	     ( coefficient->len > prime_len ) ) {
+		DBGC ( context, "RSA %p unusable CRT parameters\n", context );
+		return 0;
+	}
+
+	return prime_len;
+}
+
 /**
  * Initialise RSA cipher
  *
@@ -244,7 +360,12 @@ static int rsa_init ( void *ctx, const void *key, size_t key_len ) {
 	const struct asn1_bit_string *bit_string;
 	struct asn1_cursor modulus;
 	struct asn1_cursor exponent;
+	struct asn1_cursor prime[2];
+	struct asn1_cursor crt_exponent[2];
+	struct asn1_cursor coefficient;
 	struct asn1_cursor cursor;
+	size_t prime_len = 0;
+	unsigned int i;
 	int is_private;
 	int rc;
 
@@ -308,8 +429,16 @@ static int rsa_init ( void *ctx, const void *key, size_t key_len ) {
 	DBGC ( context, "RSA %p exponent:\n", context );
 	DBGC_HDA ( context, 0, exponent.data, exponent.len );
 
+	/* Extract CRT parameters, if applicable */
+	if ( is_private ) {
+		prime_len = rsa_parse_crt ( context, &cursor, modulus.len,
+					    prime, crt_exponent,
+					    &coefficient );
+	}
+
 	/* Allocate dynamic storage */
-	if ( ( rc = rsa_alloc ( context, modulus.len, exponent.len ) ) != 0 )
+	if ( ( rc = rsa_alloc ( context, modulus.len, exponent.len,
+				prime_len ) ) != 0 )
 		goto err_alloc;
 
 	/* Construct big integers */
@@ -317,6 +446,21 @@ static int rsa_init ( void *ctx, const void *key, size_t key_len ) {
 		      modulus.data, modulus.len );
 	bigint_init ( ( ( bigint_t ( context->exponent_size ) * )
 			context->exponent0 ), exponent.data, exponent.len );
+	if ( prime_len ) {
+		for ( i = 0 ; i < 2 ; i++ ) {
+			bigint_init ( ( ( bigint_t ( context->prime_size ) * )
+					context->prime0[i] ),
+				      prime[i].data, prime[i].len );
+			bigint_init ( ( ( bigint_t ( context->prime_size ) * )
+					context->crt_exponent0[i] ),
+				      crt_exponent[i].data,
+				      crt_exponent[i].len );
+		}
+		bigint_init ( ( ( bigint_t ( context->prime_size ) * )
+				context->coefficient0 ),
+			      coefficient.data, coefficient.len );
+		DBGC ( context, "RSA %p using CRT\n", context );
+	}
 
 	return 0;
 
@@ -338,6 +482,68 @@ static size_t rsa_max_len ( void *ctx ) {
 	return context->max_len;
 }
 
+/**
+ * Perform RSA private-key operation using the CRT
+ *
+ * @v context		RSA context
+ *
+ * The input big integer is exponentiated separately modulo each
+ * prime factor, using exponents half the size of the private
+ * exponent, and the two results are recombined using Garner's
+ * formula:
+ *
+ *     m = m2 + q.( qInv.( m1 - m2 ) mod p )
+ */
+static void rsa_cipher_crt ( struct rsa_context *context ) {
+	unsigned int size = context->size;
+	unsigned int prime_size = context->prime_size;
+	bigint_t ( size ) *input = ( ( void * ) context->input0 );
+	bigint_t ( size ) *output = ( ( void * ) context->output0 );
+	bigint_t ( prime_size ) *prime[2] = {
+		( ( void * ) context->prime0[0] ),
+		( ( void * ) context->prime0[1] ),
+	};
+	bigint_t ( prime_size ) *crt_exponent[2] = {
+		( ( void * ) context->crt_exponent0[0] ),
+		( ( void * ) context->crt_exponent0[1] ),
+	};
+	bigint_t ( prime_size ) *coefficient =
+		( ( void * ) context->coefficient0 );
+	size_t mod_multiply_len = bigint_mod_multiply_tmp_len ( input );
+	size_t mod_exp_len = bigint_mod_exp_tmp_len ( prime[0], prime[0] );
+	rsa_crt_tmp_t ( size, prime_size, mod_multiply_len,
+			mod_exp_len ) *temp = context->tmp;
+	static const uint8_t one[1] = { 0x01 };
+	unsigned int i;
+
+	/* Calculate m1 = c^dP mod p and m2 = c^dQ mod q */
+	for ( i = 0 ; i < 2 ; i++ ) {
+		bigint_grow ( prime[i], &temp->modulus );
+		bigint_init ( &temp->reduced, one, sizeof ( one ) );
+		bigint_mod_multiply ( input, &temp->reduced, &temp->modulus,
+				      &temp->reduced, temp->tmp.mod_multiply );
+		bigint_shrink ( &temp->reduced, &temp->base );
+		bigint_mod_exp ( &temp->base, prime[i], crt_exponent[i],
+				 &temp->result[i], temp->tmp.mod_exp );
+	}
+
+	/* Calculate h = qInv.( m1 - m2 ) mod p */
+	bigint_init ( &temp->difference, one, sizeof ( one ) );
+	bigint_mod_multiply ( &temp->result[1], &temp->difference, prime[0],
+			      &temp->difference, temp->tmp.mod_multiply );
+	if ( ! bigint_is_geq ( &temp->result[0], &temp->difference ) )
+		bigint_add ( prime[0], &temp->result[0] );
+	bigint_subtract ( &temp->difference, &temp->result[0] );
+	bigint_mod_multiply ( coefficient, &temp->result[0], prime[0],
+			      &temp->difference, temp->tmp.mod_multiply );
+
+	/* Calculate m = m2 + q.h */
+	bigint_multiply ( &temp->difference, prime[1], &temp->product );
+	bigint_grow ( &temp->result[1], &temp->sum );
+	bigint_add ( &temp->product, &temp->sum );
+	bigint_shrink ( &temp->sum, output );
+}
+
 /**
  * Perform RSA cipher operation
  *
@@ -357,7 +563,12 @@ static void rsa_cipher ( struct rsa_context *context,
 	bigint_init ( input, in, context->max_len );
 
 	/* Perform modular exponentiation */
-	bigint_mod_exp ( input, modulus, exponent, output, context->tmp );
+	if ( context->prime_size ) {
+		rsa_cipher_crt ( context );
+	} else {
+		bigint_mod_exp ( input, modulus, exponent, output,
+				 context->tmp );
+	}
 
 	/* Copy out result */
 	bigint_done ( output, out, context->max_len );
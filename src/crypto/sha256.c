@@ -178,6 +178,34 @@ static void sha256_digest ( struct sha256_context *context ) {
 		   sizeof ( context->ddd.dd.digest ) );
 }
 
+/**
+ * Digest data blocks using generic SHA-256 implementation
+ *
+ * @v context		SHA-256 context
+ * @v data		Data blocks
+ * @v count		Number of data blocks
+ */
+static void sha256_generic_compress ( struct sha256_context *context,
+				      const void *data, size_t count ) {
+
+	for ( ; count ; count-- ) {
+		if ( data != &context->ddd.dd.data ) {
+			memcpy ( &context->ddd.dd.data, data,
+				 sizeof ( context->ddd.dd.data ) );
+		}
+		sha256_digest ( context );
+		data += sizeof ( context->ddd.dd.data );
+	}
+}
+
+/** SHA-256 block compression function
+ *
+ * This may be replaced by an accelerated implementation.
+ */
+void ( * sha256_compress ) ( struct sha256_context *context,
+			     const void *data, size_t count ) =
+	sha256_generic_compress;
+
 /**
  * Accumulate data with SHA-256 algorithm
  *
@@ -188,17 +216,35 @@ static void sha256_digest ( struct sha256_context *context ) {
 static void sha256_update ( void *ctx, const void *data, size_t len ) {
 	struct sha256_context *context = ctx;
 	const uint8_t *byte = data;
+	size_t blocksize = sizeof ( context->ddd.dd.data );
 	size_t offset;
+	size_t frag_len;
 
-	/* Accumulate data a byte at a time, performing the digest
-	 * whenever we fill the data buffer
-	 */
-	while ( len-- ) {
-		offset = ( context->len % sizeof ( context->ddd.dd.data ) );
-		context->ddd.dd.data.byte[offset] = *(byte++);
-		context->len++;
-		if ( ( context->len % sizeof ( context->ddd.dd.data ) ) == 0 )
-			sha256_digest ( context );
+	while ( len ) {
+		offset = ( context->len % blocksize );
+		if ( ( offset == 0 ) && ( len >= blocksize ) ) {
+			/* Digest whole blocks directly from the input */
+			frag_len = ( len - ( len % blocksize ) );
+			sha256_compress ( context, byte,
+					  ( frag_len / blocksize ) );
+			context->len += frag_len;
+		} else {
+			/* Accumulate data, performing the digest whenever
+			 * we fill the data buffer
+			 */
+			frag_len = ( blocksize - offset );
+			if ( frag_len > len )
+				frag_len = len;
+			memcpy ( &context->ddd.dd.data.byte[offset], byte,
+				 frag_len );
+			context->len += frag_len;
+			if ( ( context->len % blocksize ) == 0 ) {
+				sha256_compress ( context, &context->ddd.dd.data,
+						  1 );
+			}
+		}
+		byte += frag_len;
+		len -= frag_len;
 	}
 }
 
@@ -18,6 +18,7 @@
 
 FILE_LICENCE ( GPL2_OR_LATER );
 
+#include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #include <time.h>
@@ -30,6 +31,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/sha256.h>
 #include <ipxe/rsa.h>
 #include <ipxe/rootcert.h>
+#include <ipxe/malloc.h>
 #include <ipxe/x509.h>
 
 /** @file
@@ -395,56 +397,6 @@ static int x509_parse_version ( struct x509_certificate *cert,
 	return 0;
 }
 
-/**
- * Parse X.509 certificate serial number
- *
- * @v cert		X.509 certificate
- * @v raw		ASN.1 cursor
- * @ret rc		Return status code
- */
-static int x509_parse_serial ( struct x509_certificate *cert,
-			       const struct asn1_cursor *raw ) {
-	struct x509_serial *serial = &cert->serial;
-	int rc;
-
-	/* Record raw serial number */
-	memcpy ( &serial->raw, raw, sizeof ( serial->raw ) );
-	if ( ( rc = asn1_shrink ( &serial->raw, ASN1_INTEGER ) ) != 0 ) {
-		DBGC ( cert, "X509 %p cannot shrink serialNumber: %s\n",
-		       cert, strerror ( rc ) );
-		return rc;
-	}
-	DBGC ( cert, "X509 %p issuer is:\n", cert );
-	DBGC_HDA ( cert, 0, serial->raw.data, serial->raw.len );
-
-	return 0;
-}
-
-/**
- * Parse X.509 certificate issuer
- *
- * @v cert		X.509 certificate
- * @v raw		ASN.1 cursor
- * @ret rc		Return status code
- */
-static int x509_parse_issuer ( struct x509_certificate *cert,
-			       const struct asn1_cursor *raw ) {
-	struct x509_issuer *issuer = &cert->issuer;
-	int rc;
-
-	/* Record raw issuer */
-	memcpy ( &issuer->raw, raw, sizeof ( issuer->raw ) );
-	if ( ( rc = asn1_shrink ( &issuer->raw, ASN1_SEQUENCE ) ) != 0 ) {
-		DBGC ( cert, "X509 %p cannot shrink issuer: %s\n",
-		       cert, strerror ( rc ) );
-		return rc;
-	}
-	DBGC ( cert, "X509 %p issuer is:\n", cert );
-	DBGC_HDA ( cert, 0, issuer->raw.data, issuer->raw.len );
-
-	return 0;
-}
-
 /**
  * Parse X.509 certificate validity
  *
@@ -536,12 +488,6 @@ static int x509_parse_subject ( struct x509_certificate *cert,
 	struct x509_name *name = &subject->name;
 	int rc;
 
-	/* Record raw subject */
-	memcpy ( &subject->raw, raw, sizeof ( subject->raw ) );
-	asn1_shrink_any ( &subject->raw );
-	DBGC ( cert, "X509 %p subject is:\n", cert );
-	DBGC_HDA ( cert, 0, subject->raw.data, subject->raw.len );
-
 	/* Parse common name */
 	if ( ( rc = x509_parse_common_name ( cert, name, raw ) ) != 0 )
 		return rc;
@@ -744,17 +690,17 @@ static int x509_parse_key_purpose ( struct x509_certificate *cert,
 static int x509_parse_extended_key_usage ( struct x509_certificate *cert,
 					   const struct asn1_cursor *raw ) {
 	struct asn1_cursor cursor;
+	struct asn1_cursor purpose;
 	int rc;
 
 	/* Enter extKeyUsage */
 	memcpy ( &cursor, raw, sizeof ( cursor ) );
 	asn1_enter ( &cursor, ASN1_SEQUENCE );
 
-	/* Parse each extension in turn */
-	while ( cursor.len ) {
-		if ( ( rc = x509_parse_key_purpose ( cert, &cursor ) ) != 0 )
+	/* Parse each key purpose in turn */
+	while ( asn1_next ( &cursor, ASN1_ANY, &purpose ) == 0 ) {
+		if ( ( rc = x509_parse_key_purpose ( cert, &purpose ) ) != 0 )
 			return rc;
-		asn1_skip_any ( &cursor );
 	}
 
 	return 0;
@@ -878,7 +824,7 @@ static int x509_parse_extension ( struct x509_certificate *cert,
 }
 
 /**
- * Parse X.509 certificate extensions, if present
+ * Parse X.509 certificate extensions
  *
  * @v cert		X.509 certificate
  * @v raw		ASN.1 cursor
@@ -887,86 +833,146 @@ static int x509_parse_extension ( struct x509_certificate *cert,
 static int x509_parse_extensions ( struct x509_certificate *cert,
 				   const struct asn1_cursor *raw ) {
 	struct asn1_cursor cursor;
+	struct asn1_cursor extension;
 	int rc;
 
-	/* Enter extensions, if present */
+	/* Enter extensions */
 	memcpy ( &cursor, raw, sizeof ( cursor ) );
 	asn1_enter ( &cursor, ASN1_EXPLICIT_TAG ( 3 ) );
 	asn1_enter ( &cursor, ASN1_SEQUENCE );
 
 	/* Parse each extension in turn */
-	while ( cursor.len ) {
-		if ( ( rc = x509_parse_extension ( cert, &cursor ) ) != 0 )
+	while ( asn1_next ( &cursor, ASN1_ANY, &extension ) == 0 ) {
+		if ( ( rc = x509_parse_extension ( cert, &extension ) ) != 0 )
 			return rc;
-		asn1_skip_any ( &cursor );
 	}
 
 	return 0;
 }
 
 /**
- * Parse X.509 certificate tbsCertificate
+ * Locate X.509 certificate element
  *
  * @v cert		X.509 certificate
- * @v raw		ASN.1 cursor
+ * @v cursor		ASN.1 cursor
+ * @v type		Expected type
+ * @v element		Element cursor to fill in
+ * @v name		Element name (for debugging)
  * @ret rc		Return status code
  */
-static int x509_parse_tbscertificate ( struct x509_certificate *cert,
-				       const struct asn1_cursor *raw ) {
-	struct asn1_algorithm **algorithm = &cert->signature_algorithm;
+static int x509_locate ( struct x509_certificate *cert,
+			 struct asn1_cursor *cursor, unsigned int type,
+			 struct asn1_cursor *element, const char *name ) {
+	int rc;
+
+	if ( ( rc = asn1_next ( cursor, type, element ) ) != 0 ) {
+		DBGC ( cert, "X509 %p cannot locate %s: %s\n",
+		       cert, name, strerror ( rc ) );
+		DBGC_HDA ( cert, 0, cert->raw.data, cert->raw.len );
+		return rc;
+	}
+
+	return 0;
+}
+
+/**
+ * Index X.509 certificate elements
+ *
+ * @v cert		X.509 certificate
+ * @v data		Raw certificate data
+ * @v len		Length of raw data
+ * @ret rc		Return status code
+ *
+ * This locates the top-level elements of the certificate (including
+ * the raw serial number, issuer and subject) in a single pass,
+ * without parsing their contents.  It is much cheaper than a full
+ * x509_parse(), and is sufficient to identify a certificate within a
+ * certificate chain.
+ */
+int x509_index ( struct x509_certificate *cert, const void *data,
+		 size_t len ) {
+	struct x509_index *index = &cert->index;
 	struct asn1_cursor cursor;
+	struct asn1_cursor tbs;
 	int rc;
 
-	/* Record raw tbsCertificate */
-	memcpy ( &cursor, raw, sizeof ( cursor ) );
-	asn1_shrink_any ( &cursor );
-	memcpy ( &cert->tbs, &cursor, sizeof ( cert->tbs ) );
+	/* Initialise certificate */
+	memset ( cert, 0, sizeof ( *cert ) );
+	cert->raw.data = data;
+	cert->raw.len = len;
+	asn1_shrink_any ( &cert->raw );
 
-	/* Enter tbsCertificate */
+	/* Enter certificate */
+	memcpy ( &cursor, &cert->raw, sizeof ( cursor ) );
 	asn1_enter ( &cursor, ASN1_SEQUENCE );
 
-	/* Parse version, if present */
-	if ( asn1_type ( &cursor ) == ASN1_EXPLICIT_TAG ( 0 ) ) {
-		if ( ( rc = x509_parse_version ( cert, &cursor ) ) != 0 )
-			return rc;
-		asn1_skip_any ( &cursor );
-	}
+	/* Locate and enter tbsCertificate */
+	if ( ( rc = x509_locate ( cert, &cursor, ASN1_SEQUENCE, &cert->tbs,
+				  "tbsCertificate" ) ) != 0 )
+		return rc;
+	memcpy ( &tbs, &cert->tbs, sizeof ( tbs ) );
+	asn1_enter ( &tbs, ASN1_SEQUENCE );
 
-	/* Parse serialNumber */
-	if ( ( rc = x509_parse_serial ( cert, &cursor ) ) != 0 )
+	/* Locate version, if present */
+	if ( ( asn1_type ( &tbs ) == ASN1_EXPLICIT_TAG ( 0 ) ) &&
+	     ( ( rc = x509_locate ( cert, &tbs, ASN1_EXPLICIT_TAG ( 0 ),
+				    &index->version, "version" ) ) != 0 ) )
 		return rc;
-	asn1_skip_any ( &cursor );
 
-	/* Parse signature */
-	if ( ( rc = x509_parse_signature_algorithm ( cert, algorithm,
-						     &cursor ) ) != 0 )
+	/* Locate serialNumber */
+	if ( ( rc = x509_locate ( cert, &tbs, ASN1_INTEGER, &cert->serial.raw,
+				  "serialNumber" ) ) != 0 )
 		return rc;
-	DBGC ( cert, "X509 %p tbsCertificate signature algorithm is %s\n",
-	       cert, (*algorithm)->name );
-	asn1_skip_any ( &cursor );
+	DBGC ( cert, "X509 %p serial number is:\n", cert );
+	DBGC_HDA ( cert, 0, cert->serial.raw.data, cert->serial.raw.len );
 
-	/* Parse issuer */
-	if ( ( rc = x509_parse_issuer ( cert, &cursor ) ) != 0 )
+	/* Locate signature */
+	if ( ( rc = x509_locate ( cert, &tbs, ASN1_SEQUENCE,
+				  &index->signature, "signature" ) ) != 0 )
 		return rc;
-	asn1_skip_any ( &cursor );
 
-	/* Parse validity */
-	if ( ( rc = x509_parse_validity ( cert, &cursor ) ) != 0 )
+	/* Locate issuer */
+	if ( ( rc = x509_locate ( cert, &tbs, ASN1_SEQUENCE, &cert->issuer.raw,
+				  "issuer" ) ) != 0 )
 		return rc;
-	asn1_skip_any ( &cursor );
+	DBGC ( cert, "X509 %p issuer is:\n", cert );
+	DBGC_HDA ( cert, 0, cert->issuer.raw.data, cert->issuer.raw.len );
 
-	/* Parse subject */
-	if ( ( rc = x509_parse_subject ( cert, &cursor ) ) != 0 )
+	/* Locate validity */
+	if ( ( rc = x509_locate ( cert, &tbs, ASN1_SEQUENCE,
+				  &index->validity, "validity" ) ) != 0 )
 		return rc;
-	asn1_skip_any ( &cursor );
 
-	/* Parse subjectPublicKeyInfo */
-	if ( ( rc = x509_parse_public_key ( cert, &cursor ) ) != 0 )
+	/* Locate subject */
+	if ( ( rc = x509_locate ( cert, &tbs, ASN1_SEQUENCE,
+				  &cert->subject.raw, "subject" ) ) != 0 )
 		return rc;
-	asn1_skip_any ( &cursor );
+	DBGC ( cert, "X509 %p subject is:\n", cert );
+	DBGC_HDA ( cert, 0, cert->subject.raw.data, cert->subject.raw.len );
 
-	/* Parse extensions, if present */
-	if ( ( rc = x509_parse_extensions ( cert, &cursor ) ) != 0 )
+	/* Locate subjectPublicKeyInfo */
+	if ( ( rc = x509_locate ( cert, &tbs, ASN1_SEQUENCE,
+				  &index->public_key,
+				  "subjectPublicKeyInfo" ) ) != 0 )
+		return rc;
+
+	/* Locate extensions, if present */
+	if ( tbs.len && ( asn1_type ( &tbs ) == ASN1_EXPLICIT_TAG ( 3 ) ) &&
+	     ( ( rc = x509_locate ( cert, &tbs, ASN1_EXPLICIT_TAG ( 3 ),
+				    &index->extensions,
+				    "extensions" ) ) != 0 ) )
+		return rc;
+
+	/* Locate signatureAlgorithm */
+	if ( ( rc = x509_locate ( cert, &cursor, ASN1_SEQUENCE,
+				  &index->signature_algorithm,
+				  "signatureAlgorithm" ) ) != 0 )
+		return rc;
+
+	/* Locate signatureValue */
+	if ( ( rc = x509_locate ( cert, &cursor, ASN1_BIT_STRING,
+				  &index->signature_value,
+				  "signatureValue" ) ) != 0 )
 		return rc;
 
 	return 0;
@@ -981,38 +987,59 @@ static int x509_parse_tbscertificate ( struct x509_certificate *cert,
  * @ret rc		Return status code
  */
 int x509_parse ( struct x509_certificate *cert, const void *data, size_t len ) {
+	struct x509_index *index = &cert->index;
 	struct x509_signature *signature = &cert->signature;
+	struct asn1_algorithm **algorithm = &cert->signature_algorithm;
 	struct asn1_algorithm **signature_algorithm = &signature->algorithm;
 	struct x509_bit_string *signature_value = &signature->value;
-	struct asn1_cursor cursor;
 	int rc;
 
-	/* Initialise certificate */
-	memset ( cert, 0, sizeof ( *cert ) );
-	cert->raw.data = data;
-	cert->raw.len = len;
-	asn1_shrink_any ( &cert->raw );
+	/* Locate certificate elements */
+	if ( ( rc = x509_index ( cert, data, len ) ) != 0 )
+		return rc;
 
-	/* Enter certificate */
-	memcpy ( &cursor, &cert->raw, sizeof ( cursor ) );
-	asn1_enter ( &cursor, ASN1_SEQUENCE );
+	/* Parse version, if present */
+	if ( index->version.len &&
+	     ( ( rc = x509_parse_version ( cert, &index->version ) ) != 0 ) )
+		return rc;
 
-	/* Parse tbsCertificate */
-	if ( ( rc = x509_parse_tbscertificate ( cert, &cursor ) ) != 0 )
+	/* Parse signature */
+	if ( ( rc = x509_parse_signature_algorithm ( cert, algorithm,
+						     &index->signature ) ) != 0)
+		return rc;
+	DBGC ( cert, "X509 %p tbsCertificate signature algorithm is %s\n",
+	       cert, (*algorithm)->name );
+
+	/* Parse validity */
+	if ( ( rc = x509_parse_validity ( cert, &index->validity ) ) != 0 )
+		return rc;
+
+	/* Parse subject */
+	if ( ( rc = x509_parse_subject ( cert, &cert->subject.raw ) ) != 0 )
+		return rc;
+
+	/* Parse subjectPublicKeyInfo */
+	if ( ( rc = x509_parse_public_key ( cert, &index->public_key ) ) != 0 )
+		return rc;
+
+	/* Parse extensions, if present */
+	if ( index->extensions.len &&
+	     ( ( rc = x509_parse_extensions ( cert,
+					      &index->extensions ) ) != 0 ) )
 		return rc;
-	asn1_skip_any ( &cursor );
 
 	/* Parse signatureAlgorithm */
 	if ( ( rc = x509_parse_signature_algorithm ( cert, signature_algorithm,
-						     &cursor ) ) != 0 )
+						     &index->signature_algorithm
+						     ) ) != 0 )
 		return rc;
 	DBGC ( cert, "X509 %p signatureAlgorithm is %s\n",
 	       cert, (*signature_algorithm)->name );
-	asn1_skip_any ( &cursor );
 
 	/* Parse signatureValue */
 	if ( ( rc = x509_parse_integral_bit_string ( cert, signature_value,
-						     &cursor ) ) != 0 )
+						     &index->signature_value
+						     ) ) != 0 )
 		return rc;
 	DBGC ( cert, "X509 %p signatureValue is:\n", cert );
 	DBGC_HDA ( cert, 0, signature_value->data, signature_value->len );
@@ -1020,11 +1047,11 @@ int x509_parse ( struct x509_certificate *cert, const void *data, size_t len ) {
 	/* Check that algorithm in tbsCertificate matches algorithm in
 	 * signature
 	 */
-	if ( signature->algorithm != (*signature_algorithm) ) {
+	if ( signature->algorithm != (*algorithm) ) {
 		DBGC ( cert, "X509 %p signature algorithm %s does not match "
 		       "signatureAlgorithm %s\n",
 		       cert, signature->algorithm->name,
-		       (*signature_algorithm)->name );
+		       (*algorithm)->name );
 		return -EINVAL_ALGORITHM_MISMATCH;
 	}
 
@@ -1093,6 +1120,92 @@ static int x509_check_signature ( struct x509_certificate *cert,
 	return rc;
 }
 
+/** List of cached signature verifications, most recently used first */
+static LIST_HEAD ( x509_cached_list );
+
+/** Number of cached signature verifications */
+static unsigned int x509_num_cached;
+
+/**
+ * Find cached signature verification
+ *
+ * @v fingerprint	Certificate fingerprint
+ * @v issuer		Issuer certificate fingerprint
+ * @ret cached		Cached signature verification, or NULL
+ */
+static struct x509_cached * x509_find_cached ( const void *fingerprint,
+					       const void *issuer ) {
+	struct x509_cached *cached;
+
+	list_for_each_entry ( cached, &x509_cached_list, list ) {
+		if ( ( memcmp ( cached->fingerprint, fingerprint,
+				sizeof ( cached->fingerprint ) ) == 0 ) &&
+		     ( memcmp ( cached->issuer, issuer,
+				sizeof ( cached->issuer ) ) == 0 ) ) {
+			/* Move to head of list */
+			list_del ( &cached->list );
+			list_add ( &cached->list, &x509_cached_list );
+			return cached;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Discard some cached signature verifications
+ *
+ * @ret discarded	Number of cached items discarded
+ */
+static unsigned int x509_discard ( void ) {
+	struct x509_cached *cached;
+
+	/* Drop least recently used verification, if any */
+	list_for_each_entry_reverse ( cached, &x509_cached_list, list ) {
+		list_del ( &cached->list );
+		x509_num_cached--;
+		free ( cached );
+		return 1;
+	}
+
+	return 0;
+}
+
+/** X.509 signature verification cache discarder */
+struct cache_discarder x509_cache_discarder
+	__cache_discarder ( CACHE_NORMAL ) = {
+	.name = "x509",
+	.discard = x509_discard,
+};
+
+/**
+ * Record successful signature verification
+ *
+ * @v fingerprint	Certificate fingerprint
+ * @v issuer		Issuer certificate fingerprint
+ */
+static void x509_cache ( const void *fingerprint, const void *issuer ) {
+	struct x509_cached *cached;
+
+	/* Discard least recently used verification if cache is full */
+	if ( x509_num_cached >= X509_MAX_CACHED )
+		x509_discard();
+
+	/* Allocate and populate cached verification.  Failure is
+	 * not fatal; the signature will merely be verified again
+	 * next time.
+	 */
+	cached = malloc ( sizeof ( *cached ) );
+	if ( ! cached )
+		return;
+	memcpy ( cached->fingerprint, fingerprint,
+		 sizeof ( cached->fingerprint ) );
+	memcpy ( cached->issuer, issuer, sizeof ( cached->issuer ) );
+
+	/* Add to cache */
+	list_add ( &cached->list, &x509_cached_list );
+	x509_num_cached++;
+}
+
 /**
  * Validate X.509 certificate against issuer certificate
  *
@@ -1103,6 +1216,8 @@ static int x509_check_signature ( struct x509_certificate *cert,
 int x509_validate_issuer ( struct x509_certificate *cert,
 			   struct x509_certificate *issuer ) {
 	struct x509_public_key *public_key = &issuer->subject.public_key;
+	uint8_t fingerprint[SHA256_DIGEST_SIZE];
+	uint8_t issuer_fingerprint[SHA256_DIGEST_SIZE];
 	int rc;
 
 	/* Check issuer.  In theory, this should be a full X.500 DN
@@ -1140,9 +1255,28 @@ int x509_validate_issuer ( struct x509_certificate *cert,
 		return -EACCES_KEY_USAGE;
 	}
 
+	/* Skip signature check if we have previously verified this
+	 * certificate using this issuer.  Certificate chains are
+	 * typically presented repeatedly (e.g. for each TLS
+	 * connection to the same server, or for each image signed by
+	 * the same signer), and the public-key operation dominates
+	 * the cost of validation.
+	 */
+	x509_fingerprint ( cert, &sha256_algorithm, fingerprint );
+	x509_fingerprint ( issuer, &sha256_algorithm, issuer_fingerprint );
+	if ( x509_find_cached ( fingerprint, issuer_fingerprint ) ) {
+		cache_hit ( &x509_cache_discarder );
+		DBGC ( cert, "X509 %p signature previously verified using "
+		       "X509 %p\n", cert, issuer );
+		return 0;
+	}
+
+	cache_miss ( &x509_cache_discarder );
+
 	/* Check signature */
 	if ( ( rc = x509_check_signature ( cert, public_key ) ) != 0 )
 		return rc;
+	x509_cache ( fingerprint, issuer_fingerprint );
 
 	DBGC ( cert, "X509 %p successfully validated using X509 %p\n",
 	       cert, issuer );
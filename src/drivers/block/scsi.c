@@ -38,6 +38,15 @@ FILE_LICENCE ( GPL2_OR_LATER );
 /** Maximum number of command retries */
 #define SCSICMD_MAX_RETRIES 10
 
+/** Maximum number of commands outstanding at the SCSI transport */
+#define SCSIDEV_MAX_OUTSTANDING 8
+
+/** Maximum number of commands queued awaiting issue */
+#define SCSIDEV_MAX_QUEUED 8
+
+/** Maximum length of a merged READ command */
+#define SCSIDEV_MAX_MERGE_LEN ( 1024 * 1024 )
+
 /* Error numbers generated by SCSI sense data */
 #define EIO_NO_SENSE __einfo_error ( EINFO_EIO_NO_SENSE )
 #define EINFO_EIO_NO_SENSE \
@@ -209,11 +218,13 @@ struct scsi_device {
 
 	/** TEST UNIT READY interface */
 	struct interface ready;
-	/** TEST UNIT READY process */
+	/** TEST UNIT READY and command queue process */
 	struct process process;
 
 	/** List of commands */
 	struct list_head cmds;
+	/** Queue of commands awaiting issue */
+	struct list_head queue;
 };
 
 /** SCSI device flags */
@@ -232,6 +243,14 @@ struct scsi_command {
 	struct scsi_device *scsidev;
 	/** List of SCSI commands */
 	struct list_head list;
+	/** Flags */
+	unsigned int flags;
+	/** Queue of commands awaiting issue, or list of merged commands */
+	struct list_head queue;
+	/** List of commands merged into this command */
+	struct list_head merged;
+	/** Command into which this command has been merged (if any) */
+	struct scsi_command *leader;
 
 	/** Block data interface */
 	struct interface block;
@@ -258,6 +277,16 @@ struct scsi_command {
 	uint8_t priv[0];
 };
 
+/** SCSI command flags */
+enum scsi_command_flags {
+	/** Command is queued awaiting issue */
+	SCSICMD_QUEUED = 0x0001,
+	/** Command is outstanding at the SCSI transport */
+	SCSICMD_ISSUED = 0x0002,
+	/** Command has been closed */
+	SCSICMD_CLOSED = 0x0004,
+};
+
 /** A SCSI command type */
 struct scsi_command_type {
 	/** Name */
@@ -361,15 +390,55 @@ static void scsicmd_free ( struct refcnt *refcnt ) {
  */
 static void scsicmd_close ( struct scsi_command *scsicmd, int rc ) {
 	struct scsi_device *scsidev = scsicmd->scsidev;
+	struct scsi_command *leader = scsicmd->leader;
+	struct scsi_command *merged;
+
+	/* Do nothing if already closed */
+	if ( scsicmd->flags & SCSICMD_CLOSED )
+		return;
 
 	if ( rc != 0 ) {
 		DBGC ( scsidev, "SCSI %p tag %08x closed: %s\n",
 		       scsidev, scsicmd->tag, strerror ( rc ) );
 	}
 
+	/* Remove from queue or from list of merged commands */
+	if ( scsicmd->flags & SCSICMD_QUEUED )
+		list_del ( &scsicmd->queue );
+	if ( leader ) {
+		list_del ( &scsicmd->queue );
+		scsicmd->leader = NULL;
+	}
+	scsicmd->flags = SCSICMD_CLOSED;
+
 	/* Shut down interfaces */
 	intf_shutdown ( &scsicmd->scsi, rc );
 	intf_shutdown ( &scsicmd->block, rc );
+
+	/* Close any commands merged into this command */
+	while ( ( merged = list_first_entry ( &scsicmd->merged,
+					      struct scsi_command,
+					      queue ) ) != NULL ) {
+		list_del ( &merged->queue );
+		merged->leader = NULL;
+		scsicmd_get ( merged );
+		scsicmd_close ( merged, rc );
+		scsicmd_put ( merged );
+	}
+
+	/* If this command was merged into another command, then the
+	 * data transfer cannot be completed without it; abort the
+	 * whole merged command.
+	 */
+	if ( leader ) {
+		scsicmd_get ( leader );
+		scsicmd_close ( leader, ( rc ? rc : -ECANCELED ) );
+		scsicmd_put ( leader );
+	}
+
+	/* Allow any queued commands to be issued */
+	if ( ! list_empty ( &scsidev->queue ) )
+		process_add ( &scsidev->process );
 }
 
 /**
@@ -397,6 +466,9 @@ static int scsicmd_command ( struct scsi_command *scsicmd ) {
 		return rc;
 	}
 
+	/* Mark as outstanding */
+	scsicmd->flags |= SCSICMD_ISSUED;
+
 	/* Record tag */
 	if ( scsicmd->tag ) {
 		DBGC ( scsidev, "SCSI %p tag %08x is now tag %08x\n",
@@ -421,6 +493,7 @@ static void scsicmd_done ( struct scsi_command *scsicmd, int rc ) {
 
 	/* Restart SCSI interface */
 	intf_restart ( &scsicmd->scsi, rc );
+	scsicmd->flags &= ~SCSICMD_ISSUED;
 
 	/* SCSI targets have an annoying habit of returning occasional
 	 * pointless "error" messages such as "power-on occurred", so
@@ -486,7 +559,8 @@ static void scsicmd_response ( struct scsi_command *scsicmd,
 static void scsicmd_read_cmd ( struct scsi_command *scsicmd,
 			       struct scsi_cmd *command ) {
 
-	if ( ( scsicmd->lba + scsicmd->count ) > SCSI_MAX_BLOCK_10 ) {
+	if ( ( ( scsicmd->lba + scsicmd->count ) > SCSI_MAX_BLOCK_10 ) ||
+	     ( scsicmd->count > SCSI_MAX_COUNT_10 ) ) {
 		/* Use READ (16) */
 		command->cdb.read16.opcode = SCSI_OPCODE_READ_16;
 		command->cdb.read16.lba = cpu_to_be64 ( scsicmd->lba );
@@ -517,7 +591,8 @@ static struct scsi_command_type scsicmd_read = {
 static void scsicmd_write_cmd ( struct scsi_command *scsicmd,
 				struct scsi_cmd *command ) {
 
-	if ( ( scsicmd->lba + scsicmd->count ) > SCSI_MAX_BLOCK_10 ) {
+	if ( ( ( scsicmd->lba + scsicmd->count ) > SCSI_MAX_BLOCK_10 ) ||
+	     ( scsicmd->count > SCSI_MAX_COUNT_10 ) ) {
 		/* Use WRITE (16) */
 		command->cdb.write16.opcode = SCSI_OPCODE_WRITE_16;
 		command->cdb.write16.lba = cpu_to_be64 ( scsicmd->lba );
@@ -682,6 +757,119 @@ static struct interface_descriptor scsicmd_scsi_desc =
 	INTF_DESC_PASSTHRU ( struct scsi_command, scsi,
 			     scsicmd_scsi_op, block );
 
+/**
+ * Count SCSI commands outstanding at the SCSI transport
+ *
+ * @v scsidev		SCSI device
+ * @ret count		Number of outstanding commands
+ */
+static unsigned int scsidev_outstanding ( struct scsi_device *scsidev ) {
+	struct scsi_command *scsicmd;
+	unsigned int count = 0;
+
+	list_for_each_entry ( scsicmd, &scsidev->cmds, list ) {
+		if ( scsicmd->flags & SCSICMD_ISSUED )
+			count++;
+	}
+	return count;
+}
+
+/**
+ * Count SCSI commands queued awaiting issue
+ *
+ * @v scsidev		SCSI device
+ * @ret count		Number of queued commands
+ */
+static unsigned int scsidev_queued ( struct scsi_device *scsidev ) {
+	struct scsi_command *scsicmd;
+	unsigned int count = 0;
+
+	list_for_each_entry ( scsicmd, &scsidev->queue, queue )
+		count++;
+	return count;
+}
+
+/**
+ * Check if SCSI device can issue a command immediately
+ *
+ * @v scsidev		SCSI device
+ * @ret ready		Command can be issued
+ */
+static int scsidev_can_issue ( struct scsi_device *scsidev ) {
+	unsigned int outstanding = scsidev_outstanding ( scsidev );
+
+	return ( ( outstanding < SCSIDEV_MAX_OUTSTANDING ) &&
+		 ( xfer_window ( &scsidev->scsi ) != 0 ) );
+}
+
+/**
+ * Issue queued SCSI commands
+ *
+ * @v scsidev		SCSI device
+ */
+static void scsidev_issue ( struct scsi_device *scsidev ) {
+	struct scsi_command *scsicmd;
+	int rc;
+
+	while ( ( ! list_empty ( &scsidev->queue ) ) &&
+		scsidev_can_issue ( scsidev ) ) {
+
+		/* Remove first command from queue */
+		scsicmd = list_first_entry ( &scsidev->queue,
+					     struct scsi_command, queue );
+		list_del ( &scsicmd->queue );
+		scsicmd->flags &= ~SCSICMD_QUEUED;
+
+		/* Issue command */
+		if ( ( rc = scsicmd_command ( scsicmd ) ) != 0 ) {
+			scsicmd_get ( scsicmd );
+			scsicmd_close ( scsicmd, rc );
+			scsicmd_put ( scsicmd );
+		}
+	}
+}
+
+/**
+ * Merge SCSI command into a queued command
+ *
+ * @v scsidev		SCSI device
+ * @v scsicmd		SCSI command
+ * @ret merged		Command was merged
+ *
+ * A READ command may be merged into the last queued command if that
+ * command is a READ of the immediately preceding blocks into the
+ * immediately preceding portion of memory.
+ */
+static int scsidev_merge ( struct scsi_device *scsidev,
+			   struct scsi_command *scsicmd ) {
+	struct scsi_command *tail;
+
+	/* Identify last queued command */
+	if ( list_empty ( &scsidev->queue ) )
+		return 0;
+	tail = list_entry ( scsidev->queue.prev, struct scsi_command, queue );
+
+	/* Check that commands are contiguous reads */
+	if ( ( scsicmd->type != &scsicmd_read ) ||
+	     ( tail->type != &scsicmd_read ) ||
+	     ( ( tail->lba + tail->count ) != scsicmd->lba ) ||
+	     ( userptr_add ( tail->buffer, tail->len ) != scsicmd->buffer ) ||
+	     ( ( tail->len + scsicmd->len ) > SCSIDEV_MAX_MERGE_LEN ) )
+		return 0;
+
+	/* Merge command */
+	DBGC2 ( scsidev, "SCSI %p merging READ %#llx+%#x into %#llx+%#x\n",
+		scsidev, ( ( unsigned long long ) scsicmd->lba ),
+		scsicmd->count, ( ( unsigned long long ) tail->lba ),
+		tail->count );
+	tail->count += scsicmd->count;
+	tail->len += scsicmd->len;
+	list_add_tail ( &scsicmd->queue, &tail->merged );
+	scsicmd->leader = tail;
+
+	return 1;
+}
+
 /**
  * Create SCSI command
  *
@@ -714,15 +902,23 @@ static int scsidev_command ( struct scsi_device *scsidev,
 		    &scsicmd->refcnt );
 	scsicmd->scsidev = scsidev_get ( scsidev );
 	list_add ( &scsicmd->list, &scsidev->cmds );
+	INIT_LIST_HEAD ( &scsicmd->merged );
 	scsicmd->type = type;
 	scsicmd->lba = lba;
 	scsicmd->count = count;
 	scsicmd->buffer = buffer;
 	scsicmd->len = len;
 
-	/* Issue SCSI command */
-	if ( ( rc = scsicmd_command ( scsicmd ) ) != 0 )
-		goto err_command;
+	/* Issue SCSI command immediately if possible, otherwise merge
+	 * into an existing queued command or add to the queue.
+	 */
+	if ( list_empty ( &scsidev->queue ) && scsidev_can_issue ( scsidev ) ) {
+		if ( ( rc = scsicmd_command ( scsicmd ) ) != 0 )
+			goto err_command;
+	} else if ( ! scsidev_merge ( scsidev, scsicmd ) ) {
+		list_add_tail ( &scsicmd->queue, &scsidev->queue );
+		scsicmd->flags |= SCSICMD_QUEUED;
+	}
 
 	/* Attach to parent interface, mortalise self, and return */
 	intf_plug_plug ( &scsicmd->block, block );
@@ -809,11 +1005,34 @@ static int scsidev_test_unit_ready ( struct scsi_device *scsidev,
  */
 static size_t scsidev_window ( struct scsi_device *scsidev ) {
 
+	unsigned int queued;
+
 	/* Refuse commands until unit is confirmed ready */
 	if ( ! ( scsidev->flags & SCSIDEV_UNIT_READY ) )
 		return 0;
 
-	return xfer_window ( &scsidev->scsi );
+	/* Accept commands until the queue is full; queued commands
+	 * will be issued as the SCSI transport becomes ready.
+	 */
+	queued = scsidev_queued ( scsidev );
+	return ( ( queued < SCSIDEV_MAX_QUEUED ) ?
+		 ( SCSIDEV_MAX_QUEUED - queued ) : 0 );
+}
+
+/**
+ * Find open SCSI command
+ *
+ * @v scsidev		SCSI device
+ * @ret scsicmd		SCSI command, or NULL
+ */
+static struct scsi_command * scsidev_find_open ( struct scsi_device *scsidev ) {
+	struct scsi_command *scsicmd;
+
+	list_for_each_entry ( scsicmd, &scsidev->cmds, list ) {
+		if ( ! ( scsicmd->flags & SCSICMD_CLOSED ) )
+			return scsicmd;
+	}
+	return NULL;
 }
 
 /**
@@ -824,7 +1043,6 @@ static size_t scsidev_window ( struct scsi_device *scsidev ) {
  */
 static void scsidev_close ( struct scsi_device *scsidev, int rc ) {
 	struct scsi_command *scsicmd;
-	struct scsi_command *tmp;
 
 	/* Stop process */
 	process_del ( &scsidev->process );
@@ -834,8 +1052,11 @@ static void scsidev_close ( struct scsi_device *scsidev, int rc ) {
 	intf_shutdown ( &scsidev->scsi, rc );
 	intf_shutdown ( &scsidev->ready, rc );
 
-	/* Shut down any remaining commands */
-	list_for_each_entry_safe ( scsicmd, tmp, &scsidev->cmds, list ) {
+	/* Shut down any remaining commands.  Closing a command may
+	 * also close (and free) the commands merged with it, so
+	 * restart the search after each closure.
+	 */
+	while ( ( scsicmd = scsidev_find_open ( scsidev ) ) != NULL ) {
 		scsicmd_get ( scsicmd );
 		scsicmd_close ( scsicmd, rc );
 		scsicmd_put ( scsicmd );
@@ -892,13 +1113,16 @@ static struct interface_descriptor scsidev_ready_desc =
 	INTF_DESC ( struct scsi_device, ready, scsidev_ready_op );
 
 /**
- * SCSI TEST UNIT READY process
+ * SCSI device process
  *
  * @v scsidev		SCSI device
  */
 static void scsidev_step ( struct scsi_device *scsidev ) {
 	int rc;
 
+	/* Issue any queued commands */
+	scsidev_issue ( scsidev );
+
 	/* Do nothing if we have already issued TEST UNIT READY */
 	if ( scsidev->flags & SCSIDEV_UNIT_TESTED )
 		return;
@@ -958,6 +1182,7 @@ int scsi_open ( struct interface *block, struct interface *scsi,
 	process_init ( &scsidev->process, &scsidev_process_desc,
 		       &scsidev->refcnt );
 	INIT_LIST_HEAD ( &scsidev->cmds );
+	INIT_LIST_HEAD ( &scsidev->queue );
 	memcpy ( &scsidev->lun, lun, sizeof ( scsidev->lun ) );
 	DBGC ( scsidev, "SCSI %p created for LUN " SCSI_LUN_FORMAT "\n",
 	       scsidev, SCSI_LUN_DATA ( scsidev->lun ) );
@@ -112,6 +112,12 @@ struct srp_device {
 	uint32_t memory_handle;
 	/** Login completed successfully */
 	int logged_in;
+	/** Request limit
+	 *
+	 * This is the number of further request IUs which the target
+	 * is currently prepared to accept.
+	 */
+	unsigned int req_lim;
 
 	/** Initiator port ID (for boot firmware table) */
 	union srp_port_id initiator;
@@ -286,6 +292,29 @@ static int srp_new_tag ( struct srp_device *srpdev ) {
 	return -EADDRINUSE;
 }
 
+/**
+ * Apply SRP request limit delta
+ *
+ * @v srpdev		SRP device
+ * @v delta		Request limit delta (in network byte order)
+ */
+static void srp_req_lim ( struct srp_device *srpdev, uint32_t delta ) {
+	unsigned int old_req_lim = srpdev->req_lim;
+
+	/* Update request limit */
+	srpdev->req_lim += ( ( int32_t ) ntohl ( delta ) );
+	if ( ( ( int ) srpdev->req_lim ) < 0 )
+		srpdev->req_lim = 0;
+	if ( srpdev->req_lim != old_req_lim ) {
+		DBGC2 ( srpdev, "SRP %p request limit now %d\n",
+			srpdev, srpdev->req_lim );
+	}
+
+	/* Notify of window change if further commands may now be sent */
+	if ( srpdev->logged_in && srpdev->req_lim && ! old_req_lim )
+		xfer_window_changed ( &srpdev->scsi );
+}
+
 /**
  * Transmit SRP login request
  *
@@ -355,10 +384,12 @@ static int srp_login_rsp ( struct srp_device *srpdev,
 
 	/* Mark as logged in */
 	srpdev->logged_in = 1;
-	DBGC ( srpdev, "SRP %p logged in\n", srpdev );
+	srpdev->req_lim = 0;
+	DBGC ( srpdev, "SRP %p logged in with request limit %d\n",
+	       srpdev, ntohl ( login_rsp->request_limit_delta ) );
 
-	/* Notify of window change */
-	xfer_window_changed ( &srpdev->scsi );
+	/* Record initial request limit and notify of window change */
+	srp_req_lim ( srpdev, login_rsp->request_limit_delta );
 
 	return 0;
 }
@@ -415,6 +446,11 @@ static int srp_cmd ( struct srp_device *srpdev,
 		       "login completes\n", srpdev, tag );
 		return -EBUSY;
 	}
+	if ( ! srpdev->req_lim ) {
+		DBGC ( srpdev, "SRP %p tag %08x cannot send CMD beyond "
+		       "request limit\n", srpdev, tag );
+		return -EBUSY;
+	}
 
 	/* Allocate I/O buffer */
 	iobuf = xfer_alloc_iob ( &srpdev->socket, SRP_MAX_I_T_IU_LEN );
@@ -460,6 +496,9 @@ static int srp_cmd ( struct srp_device *srpdev,
 		return rc;
 	}
 
+	/* Consume request limit */
+	srpdev->req_lim--;
+
 	return 0;
 }
 
@@ -498,6 +537,9 @@ static int srp_rsp ( struct srp_device *srpdev,
 		( ( rsp->valid & SRP_RSP_VALID_SNSVALID ) ? " sns" : "" ),
 		( ( rsp->valid & SRP_RSP_VALID_RSPVALID ) ? " rsp" : "" ) );
 
+	/* Update request limit */
+	srp_req_lim ( srpdev, rsp->request_limit_delta );
+
 	/* Identify command by tag */
 	srpcmd = srp_find_tag ( srpdev, ntohl ( rsp->tag.dwords[1] ) );
 	if ( ! srpcmd ) {
@@ -539,6 +581,56 @@ static int srp_rsp ( struct srp_device *srpdev,
 	return 0;
 }
 
+/**
+ * Receive SRP credit request
+ *
+ * @v srpdev		SRP device
+ * @v data		SRP IU
+ * @v len		Length of SRP IU
+ * @ret rc		Returns status code
+ */
+static int srp_cred_req ( struct srp_device *srpdev,
+			  const void *data, size_t len ) {
+	const struct srp_cred_req *cred_req = data;
+	struct io_buffer *iobuf;
+	struct srp_cred_rsp *cred_rsp;
+	int rc;
+
+	/* Sanity check */
+	if ( len < sizeof ( *cred_req ) ) {
+		DBGC ( srpdev, "SRP %p CRED_REQ too short (%zd bytes)\n",
+		       srpdev, len );
+		return -EINVAL;
+	}
+	DBGC2 ( srpdev, "SRP %p tag %08x CRED_REQ delta %d\n",
+		srpdev, ntohl ( cred_req->tag.dwords[1] ),
+		ntohl ( cred_req->request_limit_delta ) );
+
+	/* Update request limit */
+	srp_req_lim ( srpdev, cred_req->request_limit_delta );
+
+	/* Allocate I/O buffer */
+	iobuf = xfer_alloc_iob ( &srpdev->socket, sizeof ( *cred_rsp ) );
+	if ( ! iobuf )
+		return -ENOMEM;
+
+	/* Construct credit response */
+	cred_rsp = iob_put ( iobuf, sizeof ( *cred_rsp ) );
+	memset ( cred_rsp, 0, sizeof ( *cred_rsp ) );
+	cred_rsp->type = SRP_CRED_RSP;
+	memcpy ( &cred_rsp->tag, &cred_req->tag, sizeof ( cred_rsp->tag ) );
+
+	/* Send IU */
+	if ( ( rc = xfer_deliver_iob ( &srpdev->socket, iobuf ) ) != 0 ) {
+		DBGC ( srpdev, "SRP %p tag %08x could not send CRED_RSP: "
+		       "%s\n", srpdev, ntohl ( cred_req->tag.dwords[1] ),
+		       strerror ( rc ) );
+		return rc;
+	}
+
+	return 0;
+}
+
 /**
  * Receive SRP unrecognised response IU
  *
@@ -652,6 +744,9 @@ static int srpdev_deliver ( struct srp_device *srpdev,
 	case SRP_RSP:
 		type = srp_rsp;
 		break;
+	case SRP_CRED_REQ:
+		type = srp_cred_req;
+		break;
 	default:
 		type = srp_unrecognised;
 		break;
@@ -678,9 +773,12 @@ static int srpdev_deliver ( struct srp_device *srpdev,
  *
  * @v srpdev		SRP device
  * @ret len		Length of window
+ *
+ * The window is the number of further commands which may be issued
+ * before exhausting the target's request limit.
  */
 static size_t srpdev_window ( struct srp_device *srpdev ) {
-	return ( srpdev->logged_in ? ~( ( size_t ) 0 ) : 0 );
+	return ( srpdev->logged_in ? srpdev->req_lim : 0 );
 }
 
 /**
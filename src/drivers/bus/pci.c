@@ -203,12 +203,148 @@ int pci_read_config ( struct pci_device *pci ) {
 }
 
 /**
- * Find driver for PCI device
+ * Construct PCI driver ID index entry
+ *
+ * @v vendor		PCI vendor ID
+ * @v device		PCI device ID
+ * @v driver		Index of driver within PCI driver table
+ * @v id		Index of ID within driver's ID table
+ * @ret entry		Index entry
+ *
+ * Index entries sort by vendor and device ID, and then by position
+ * within the driver tables, so that the first matching entry is the
+ * one that a linear search of the tables would have found.
+ */
+static inline __attribute__ (( always_inline )) uint64_t
+pci_index_entry ( unsigned int vendor, unsigned int device,
+		  unsigned int driver, unsigned int id ) {
+	return ( ( ( ( uint64_t ) vendor ) << 48 ) |
+		 ( ( ( uint64_t ) device ) << 32 ) |
+		 ( driver << 16 ) | id );
+}
+
+/** PCI driver ID index
+ *
+ * Wildcard entries are placed first (in no particular order),
+ * followed by all exact entries in sorted order.
+ */
+static uint64_t *pci_index;
+
+/** Number of entries in PCI driver ID index */
+static unsigned int pci_index_count;
+
+/** Number of wildcard entries in PCI driver ID index */
+static unsigned int pci_index_wild;
+
+/** PCI driver ID index has been constructed */
+static int pci_indexed;
+
+/**
+ * Sift down PCI driver ID index heap
+ *
+ * @v heap		Heap
+ * @v root		Index of root element
+ * @v count		Number of elements in heap
+ */
+static void pci_index_sift ( uint64_t *heap, unsigned int root,
+			     unsigned int count ) {
+	unsigned int child;
+	uint64_t tmp;
+
+	while ( ( child = ( ( 2 * root ) + 1 ) ) < count ) {
+		if ( ( ( child + 1 ) < count ) &&
+		     ( heap[ child + 1 ] > heap[child] ) )
+			child++;
+		if ( heap[root] >= heap[child] )
+			break;
+		tmp = heap[root];
+		heap[root] = heap[child];
+		heap[child] = tmp;
+		root = child;
+	}
+}
+
+/**
+ * Construct PCI driver ID index
+ *
+ * The index is constructed once, on first use, and allows a driver
+ * to be located via a binary search rather than by walking every ID
+ * of every driver.  If no memory is available, the index is left
+ * empty and drivers will be located via a linear search.
+ */
+static void pci_index_ids ( void ) {
+	struct pci_driver *driver;
+	struct pci_device_id *id;
+	unsigned int count = 0;
+	unsigned int wild = 0;
+	unsigned int exact;
+	unsigned int drv;
+	unsigned int i;
+	uint64_t *heap;
+	uint64_t tmp;
+
+	/* Mark as indexed (even on failure) */
+	pci_indexed = 1;
+
+	/* Count IDs */
+	for_each_table_entry ( driver, PCI_DRIVERS ) {
+		for ( i = 0 ; i < driver->id_count ; i++ ) {
+			id = &driver->ids[i];
+			if ( ( id->vendor == PCI_ANY_ID ) ||
+			     ( id->device == PCI_ANY_ID ) )
+				wild++;
+			count++;
+		}
+	}
+
+	/* Allocate index */
+	pci_index = malloc ( count * sizeof ( pci_index[0] ) );
+	if ( ! pci_index ) {
+		DBG ( "PCI could not allocate index for %d IDs\n", count );
+		return;
+	}
+	pci_index_count = count;
+	pci_index_wild = wild;
+
+	/* Populate index */
+	heap = &pci_index[wild];
+	exact = 0;
+	wild = 0;
+	for_each_table_entry ( driver, PCI_DRIVERS ) {
+		drv = table_index ( PCI_DRIVERS, driver );
+		for ( i = 0 ; i < driver->id_count ; i++ ) {
+			id = &driver->ids[i];
+			tmp = pci_index_entry ( id->vendor, id->device,
+						drv, i );
+			if ( ( id->vendor == PCI_ANY_ID ) ||
+			     ( id->device == PCI_ANY_ID ) ) {
+				pci_index[wild++] = tmp;
+			} else {
+				heap[exact++] = tmp;
+			}
+		}
+	}
+
+	/* Sort exact entries using heapsort */
+	for ( i = ( exact / 2 ) ; i-- ; )
+		pci_index_sift ( heap, i, exact );
+	for ( i = exact ; i-- > 1 ; ) {
+		tmp = heap[0];
+		heap[0] = heap[i];
+		heap[i] = tmp;
+		pci_index_sift ( heap, 0, i );
+	}
+
+	DBG ( "PCI indexed %d IDs (%d wildcard)\n", count, wild );
+}
+
+/**
+ * Find driver for PCI device via linear search
  *
  * @v pci		PCI device
  * @ret rc		Return status code
  */
-int pci_find_driver ( struct pci_device *pci ) {
+static int pci_find_driver_linear ( struct pci_device *pci ) {
 	struct pci_driver *driver;
 	struct pci_device_id *id;
 	unsigned int i;
@@ -229,6 +365,77 @@ int pci_find_driver ( struct pci_device *pci ) {
 	return -ENOENT;
 }
 
+/**
+ * Find driver for PCI device
+ *
+ * @v pci		PCI device
+ * @ret rc		Return status code
+ */
+int pci_find_driver ( struct pci_device *pci ) {
+	struct pci_driver *driver;
+	uint64_t key = pci_index_entry ( pci->vendor, pci->device, 0, 0 );
+	uint64_t best = ~( ( uint64_t ) 0 );
+	uint64_t entry;
+	unsigned int vendor;
+	unsigned int device;
+	unsigned int min;
+	unsigned int max;
+	unsigned int mid;
+	unsigned int drv;
+	unsigned int i;
+
+	/* Construct index on first use */
+	if ( ! pci_indexed )
+		pci_index_ids();
+	if ( ! pci_index )
+		return pci_find_driver_linear ( pci );
+
+	/* Find first exact match, if any */
+	min = pci_index_wild;
+	max = pci_index_count;
+	while ( min < max ) {
+		mid = ( ( min + max ) / 2 );
+		if ( pci_index[mid] < key ) {
+			min = ( mid + 1 );
+		} else {
+			max = mid;
+		}
+	}
+	if ( ( min < pci_index_count ) &&
+	     ( ( pci_index[min] >> 32 ) == ( key >> 32 ) ) ) {
+		best = pci_index[min];
+	}
+
+	/* Check for any earlier wildcard match */
+	for ( i = 0 ; i < pci_index_wild ; i++ ) {
+		entry = pci_index[i];
+		vendor = ( ( entry >> 48 ) & 0xffff );
+		device = ( ( entry >> 32 ) & 0xffff );
+		if ( ( vendor != PCI_ANY_ID ) && ( vendor != pci->vendor ) )
+			continue;
+		if ( ( device != PCI_ANY_ID ) && ( device != pci->device ) )
+			continue;
+		if ( ( entry & 0xffffffffUL ) < ( best & 0xffffffffUL ) )
+			best = entry;
+	}
+
+	/* Fail if no match was found */
+	if ( best == ~( ( uint64_t ) 0 ) )
+		return -ENOENT;
+
+	/* Locate and record driver */
+	drv = ( ( best >> 16 ) & 0xffff );
+	for_each_table_entry ( driver, PCI_DRIVERS ) {
+		if ( table_index ( PCI_DRIVERS, driver ) == drv ) {
+			pci_set_driver ( pci, driver,
+					 &driver->ids[ best & 0xffff ] );
+			return 0;
+		}
+	}
+
+	return -ENOENT;
+}
+
 /**
  * Probe a PCI device
  *
@@ -284,6 +491,12 @@ static int pcibus_probe ( struct root_device *rootdev ) {
 	for ( busdevfn = 0 ; busdevfn < PCI_BUSDEVFN ( num_bus, 0, 0 ) ;
 	      busdevfn++ ) {
 
+		/* Skip all but the first function on absent or
+		 * non-multifunction cards
+		 */
+		if ( ( PCI_FUNC ( busdevfn ) != 0 ) && ! ( hdrtype & 0x80 ) )
+			continue;
+
 		/* Allocate struct pci_device */
 		if ( ! pci )
 			pci = malloc ( sizeof ( *pci ) );
@@ -293,19 +506,24 @@ static int pcibus_probe ( struct root_device *rootdev ) {
 		}
 		memset ( pci, 0, sizeof ( *pci ) );
 		pci_init ( pci, busdevfn );
-			
-		/* Skip all but the first function on
-		 * non-multifunction cards
+
+		/* Read device configuration.  An absent first
+		 * function reads as all ones, which would otherwise
+		 * appear to be a multifunction header type.
 		 */
+		rc = pci_read_config ( pci );
 		if ( PCI_FUNC ( busdevfn ) == 0 ) {
-			pci_read_config_byte ( pci, PCI_HEADER_TYPE,
-					       &hdrtype );
-		} else if ( ! ( hdrtype & 0x80 ) ) {
-			continue;
+			hdrtype = 0;
+			if ( rc == 0 ) {
+				pci_read_config_byte ( pci, PCI_HEADER_TYPE,
+						       &hdrtype );
+			}
 		}
+		if ( rc != 0 )
+			continue;
 
-		/* Read device configuration */
-		if ( ( rc = pci_read_config ( pci ) ) != 0 )
+		/* Skip devices whose probing is deferred */
+		if ( ! probe_device_now ( &pci->dev.desc ) )
 			continue;
 
 		/* Look for a driver */
@@ -20,6 +20,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <errno.h>
 #include <byteswap.h>
@@ -43,6 +44,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 int pci_vpd_init ( struct pci_vpd *vpd, struct pci_device *pci ) {
 
 	/* Initialise structure */
+	memset ( vpd, 0, sizeof ( *vpd ) );
 	vpd->pci = pci;
 	pci_vpd_invalidate_cache ( vpd );
 
@@ -166,6 +168,203 @@ static int pci_vpd_write_dword ( struct pci_vpd *vpd, int address,
 	return -ETIMEDOUT;
 }
 
+/**
+ * Free PCI Vital Product Data shadow copy
+ *
+ * @v vpd		PCI VPD
+ *
+ * Any unflushed writes will be discarded.
+ */
+static void pci_vpd_unshadow ( struct pci_vpd *vpd ) {
+
+	free ( vpd->shadow );
+	vpd->shadow = NULL;
+	vpd->shadow_len = 0;
+	free ( vpd->dirty );
+	vpd->dirty = NULL;
+	vpd->num_tags = 0;
+}
+
+/**
+ * Shut down PCI Vital Product Data
+ *
+ * @v vpd		PCI VPD
+ *
+ * Any unflushed writes will be discarded.
+ */
+void pci_vpd_fini ( struct pci_vpd *vpd ) {
+
+	pci_vpd_unshadow ( vpd );
+	vpd->shadowed = 0;
+}
+
+/**
+ * Extend PCI Vital Product Data shadow copy
+ *
+ * @v vpd		PCI VPD
+ * @v end		Required end address
+ * @ret rc		Return status code
+ */
+static int pci_vpd_extend_shadow ( struct pci_vpd *vpd, unsigned int end ) {
+	uint8_t *new_shadow;
+	uint32_t data;
+	size_t len;
+
+	/* Round up to a whole number of dwords */
+	end = ( ( end + 3 ) & ~3 );
+	if ( end <= vpd->shadow_len )
+		return 0;
+	if ( end > PCI_VPD_MAX_ADDRESS )
+		return -ERANGE;
+
+	/* Reallocate shadow copy, in reasonably-sized blocks */
+	len = ( ( end + 0xff ) & ~0xff );
+	new_shadow = realloc ( vpd->shadow, len );
+	if ( ! new_shadow )
+		return -ENOMEM;
+	vpd->shadow = new_shadow;
+
+	/* Read each additional dword exactly once */
+	while ( vpd->shadow_len < end ) {
+		if ( pci_vpd_read_dword ( vpd, vpd->shadow_len, &data ) != 0 )
+			return -EIO;
+		data = cpu_to_le32 ( data );
+		memcpy ( ( vpd->shadow + vpd->shadow_len ), &data,
+			 sizeof ( data ) );
+		vpd->shadow_len += sizeof ( data );
+	}
+
+	return 0;
+}
+
+/**
+ * Load PCI Vital Product Data shadow copy
+ *
+ * @v vpd		PCI VPD
+ * @ret rc		Return status code
+ *
+ * The VPD is read once, up to and including the end tag, and each
+ * tag is recorded in the tag index.  All subsequent reads within the
+ * shadow copy (including all tag and field lookups) are satisfied
+ * from memory.
+ */
+static int pci_vpd_load_shadow ( struct pci_vpd *vpd ) {
+	struct pci_vpd_tag *index;
+	unsigned int address = 0;
+	unsigned int tag;
+	size_t len;
+	int rc;
+
+	/* Scan through tags */
+	do {
+		/* Read tag header */
+		if ( ( rc = pci_vpd_extend_shadow ( vpd, address + 3 ) ) != 0 )
+			goto err;
+		tag = vpd->shadow[address++];
+		if ( ISAPNP_IS_LARGE_TAG ( tag ) ) {
+			len = ( vpd->shadow[address] |
+				( vpd->shadow[ address + 1 ] << 8 ) );
+			address += 2;
+			tag = ISAPNP_LARGE_TAG_NAME ( tag );
+		} else {
+			len = ISAPNP_SMALL_TAG_LEN ( tag );
+			tag = ISAPNP_SMALL_TAG_NAME ( tag );
+		}
+
+		/* Read tag body */
+		if ( ( rc = pci_vpd_extend_shadow ( vpd,
+						    address + len ) ) != 0 )
+			goto err;
+
+		/* Add to tag index */
+		if ( vpd->num_tags >= PCI_VPD_MAX_TAGS ) {
+			rc = -ENOBUFS;
+			goto err;
+		}
+		index = &vpd->tags[ vpd->num_tags++ ];
+		index->tag = tag;
+		index->address = address;
+		index->len = len;
+
+		/* Move to next tag */
+		address += len;
+
+	} while ( tag != ISAPNP_TAG_END );
+
+	/* Allocate dirty dword bitmap */
+	vpd->dirty = zalloc ( ( vpd->shadow_len / 4 + 7 ) / 8 );
+	if ( ! vpd->dirty ) {
+		rc = -ENOMEM;
+		goto err;
+	}
+
+	DBGC ( vpd, PCI_FMT " VPD shadowed [0000,%04zx) with %d tags\n",
+	       PCI_ARGS ( vpd->pci ), vpd->shadow_len, vpd->num_tags );
+	return 0;
+
+ err:
+	DBGC ( vpd, PCI_FMT " VPD could not be shadowed: %s\n",
+	       PCI_ARGS ( vpd->pci ), strerror ( rc ) );
+	pci_vpd_unshadow ( vpd );
+	return rc;
+}
+
+/**
+ * Check for PCI Vital Product Data shadow copy of a region
+ *
+ * @v vpd		PCI VPD
+ * @v address		Starting address
+ * @v len		Length of region
+ * @ret is_shadowed	Region is held within shadow copy
+ *
+ * The shadow copy will be loaded on first use.  If it cannot be
+ * loaded, all accesses will fall back to using the hardware directly.
+ */
+static int pci_vpd_is_shadowed ( struct pci_vpd *vpd, unsigned int address,
+				 size_t len ) {
+
+	/* Load shadow copy on first use */
+	if ( ! vpd->shadowed ) {
+		vpd->shadowed = 1;
+		if ( vpd->cap )
+			pci_vpd_load_shadow ( vpd );
+	}
+
+	return ( vpd->shadow && ( address <= vpd->shadow_len ) &&
+		 ( len <= ( vpd->shadow_len - address ) ) );
+}
+
+/**
+ * Write dirty PCI Vital Product Data back to hardware
+ *
+ * @v vpd		PCI VPD
+ * @ret rc		Return status code
+ */
+int pci_vpd_flush ( struct pci_vpd *vpd ) {
+	unsigned int address;
+	unsigned int dword;
+	uint32_t data;
+	int rc;
+
+	/* Do nothing unless a shadow copy exists */
+	if ( ! vpd->shadow )
+		return 0;
+
+	/* Write each dirty dword */
+	for ( address = 0 ; address < vpd->shadow_len ; address += 4 ) {
+		dword = ( address / 4 );
+		if ( ! ( vpd->dirty[ dword / 8 ] & ( 1 << ( dword % 8 ) ) ) )
+			continue;
+		memcpy ( &data, ( vpd->shadow + address ), sizeof ( data ) );
+		data = le32_to_cpu ( data );
+		if ( ( rc = pci_vpd_write_dword ( vpd, address, data ) ) != 0 )
+			return rc;
+		vpd->dirty[ dword / 8 ] &= ~( 1 << ( dword % 8 ) );
+	}
+
+	return 0;
+}
+
 /**
  * Read PCI VPD
  *
@@ -183,6 +382,12 @@ int pci_vpd_read ( struct pci_vpd *vpd, unsigned int address, void *buf,
 	unsigned int i;
 	int rc;
 
+	/* Read from shadow copy, if possible */
+	if ( pci_vpd_is_shadowed ( vpd, address, len ) ) {
+		memcpy ( buf, ( vpd->shadow + address ), len );
+		return 0;
+	}
+
 	/* Calculate length to skip at start of data */
 	skip_len = ( address & 0x03 );
 
@@ -222,9 +427,24 @@ int pci_vpd_write ( struct pci_vpd *vpd, unsigned int address, const void *buf,
 	const uint8_t *bytes = buf;
 	uint32_t data;
 	size_t skip_len;
+	unsigned int dword;
 	unsigned int i;
 	int rc;
 
+	/* Update shadow copy, if possible, marking only those dwords
+	 * that actually change as dirty.
+	 */
+	if ( pci_vpd_is_shadowed ( vpd, address, len ) ) {
+		for ( i = 0 ; i < len ; i++ ) {
+			if ( vpd->shadow[ address + i ] == bytes[i] )
+				continue;
+			vpd->shadow[ address + i ] = bytes[i];
+			dword = ( ( address + i ) / 4 );
+			vpd->dirty[ dword / 8 ] |= ( 1 << ( dword % 8 ) );
+		}
+		return ( vpd->writeback ? 0 : pci_vpd_flush ( vpd ) );
+	}
+
 	/* Calculate length to skip at start of data */
 	skip_len = ( address & 0x03 );
 
@@ -292,10 +512,27 @@ static void pci_vpd_dump ( struct pci_vpd *vpd, unsigned int address,
  */
 static int pci_vpd_find_tag ( struct pci_vpd *vpd, unsigned int tag,
 			      unsigned int *address, size_t *len ) {
+	struct pci_vpd_tag *index;
 	uint8_t read_tag;
 	uint16_t read_len;
+	unsigned int i;
 	int rc;
 
+	/* Use tag index, if available */
+	if ( pci_vpd_is_shadowed ( vpd, 0, 0 ) ) {
+		for ( i = 0 ; i < vpd->num_tags ; i++ ) {
+			index = &vpd->tags[i];
+			if ( index->tag == tag ) {
+				*address = index->address;
+				*len = index->len;
+				return 0;
+			}
+		}
+		DBGC ( vpd, PCI_FMT " VPD tag %02x not found\n",
+		       PCI_ARGS ( vpd->pci ), tag );
+		return -ENOENT;
+	}
+
 	/* Scan through tags looking for a match */
 	*address = 0;
 	do {
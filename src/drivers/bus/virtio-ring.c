@@ -125,12 +125,19 @@ void vring_add_buf(struct vring_virtqueue *vq,
 void vring_kick(unsigned int ioaddr, struct vring_virtqueue *vq, int num_added)
 {
    struct vring *vr = &vq->vring;
+   u16 old_idx = vr->avail->idx;
+   u16 new_idx = old_idx + num_added;
+   int notify;
 
    wmb();
-   vr->avail->idx += num_added;
+   vr->avail->idx = new_idx;
 
    mb();
-   if (!(vr->used->flags & VRING_USED_F_NO_NOTIFY))
+   if (vq->event)
+           notify = vring_need_event(vring_avail_event(vr), new_idx, old_idx);
+   else
+           notify = !(vr->used->flags & VRING_USED_F_NO_NOTIFY);
+   if (notify)
            vp_notify(ioaddr, vq->queue_index);
 }
 
@@ -1675,11 +1675,11 @@ static void arbel_poll_cq ( struct ib_device *ibdev,
 		barrier();
 		/* Update completion queue's index */
 		cq->next_idx++;
-		/* Update doorbell record */
-		ci_db_rec = &arbel->db_rec[arbel_cq->ci_doorbell_idx].cq_ci;
-		MLX_FILL_1 ( ci_db_rec, 0,
-			     counter, ( cq->next_idx & 0xffffffffUL ) );
 	}
+
+	/* Update doorbell record */
+	ci_db_rec = &arbel->db_rec[arbel_cq->ci_doorbell_idx].cq_ci;
+	MLX_FILL_1 ( ci_db_rec, 0, counter, ( cq->next_idx & 0xffffffffUL ) );
 }
 
 /***************************************************************************
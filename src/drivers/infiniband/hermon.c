@@ -1552,6 +1552,29 @@ static unsigned int
 	[IB_QPT_ETH] = hermon_fill_eth_send_wqe,
 };
 
+/**
+ * Ring send doorbell register
+ *
+ * @v ibdev		Infiniband device
+ * @v qp		Queue pair
+ */
+static void hermon_ring_send_doorbell ( struct ib_device *ibdev __unused,
+					struct ib_queue_pair *qp ) {
+	struct hermon_queue_pair *hermon_qp = ib_qp_get_drvdata ( qp );
+	struct hermon_send_work_queue *hermon_send_wq = &hermon_qp->send;
+	union hermonprm_doorbell_register db_reg;
+
+	/* Do nothing unless new work queue entries have been posted */
+	if ( hermon_send_wq->notified_idx == qp->send.next_idx )
+		return;
+	hermon_send_wq->notified_idx = qp->send.next_idx;
+
+	/* Ring doorbell register */
+	MLX_FILL_1 ( &db_reg.send, 0, qn, qp->qpn );
+	barrier();
+	writel ( db_reg.dword[0], hermon_send_wq->doorbell );
+}
+
 /**
  * Post send work queue entry
  *
@@ -1560,6 +1583,10 @@ static unsigned int
  * @v av		Address vector
  * @v iobuf		I/O buffer
  * @ret rc		Return status code
+ *
+ * The doorbell is not rung immediately.  All work queue entries
+ * posted between consecutive polls of the event queue are notified
+ * to the hardware using a single doorbell write.
  */
 static int hermon_post_send ( struct ib_device *ibdev,
 			      struct ib_queue_pair *qp,
@@ -1570,7 +1597,6 @@ static int hermon_post_send ( struct ib_device *ibdev,
 	struct ib_work_queue *wq = &qp->send;
 	struct hermon_send_work_queue *hermon_send_wq = &hermon_qp->send;
 	union hermon_send_wqe *wqe;
-	union hermonprm_doorbell_register db_reg;
 	unsigned long wqe_idx_mask;
 	unsigned long wqe_idx;
 	unsigned int owner;
@@ -1603,11 +1629,6 @@ static int hermon_post_send ( struct ib_device *ibdev,
 		hermon, qp->qpn, wqe_idx );
 	DBGCP_HDA ( hermon, virt_to_phys ( wqe ), wqe, sizeof ( *wqe ) );
 
-	/* Ring doorbell register */
-	MLX_FILL_1 ( &db_reg.send, 0, qn, qp->qpn );
-	barrier();
-	writel ( db_reg.dword[0], hermon_send_wq->doorbell );
-
 	/* Update work queue's index */
 	wq->next_idx++;
 
@@ -1684,6 +1705,7 @@ static int hermon_complete ( struct ib_device *ibdev,
 	int is_send;
 	unsigned long wqe_idx;
 	unsigned long wqe_idx_mask;
+	uint32_t status;
 	size_t len;
 	int rc = 0;
 
@@ -1760,6 +1782,16 @@ static int hermon_complete ( struct ib_device *ibdev,
 			av = &recv_av;
 			av->vlan_present = MLX_GET ( &cqe->normal, vlan );
 			av->vlan = MLX_GET ( &cqe->normal, vid );
+			/* Record checksum verification, if applicable */
+			status = MLX_GET ( &cqe->normal,
+					   smac31_0_rawether_ipoib_status );
+			if ( ( status & ( HERMON_CQE_ETH_STATUS_TCP |
+					  HERMON_CQE_ETH_STATUS_UDP ) ) &&
+			     ( status & HERMON_CQE_ETH_STATUS_IPOK ) &&
+			     ( MLX_GET ( &cqe->normal, checksum ) ==
+			       0xffff ) ) {
+				iobuf->flags |= IOB_CSUM_VERIFIED;
+			}
 			break;
 		default:
 			assert ( 0 );
@@ -1806,11 +1838,11 @@ static void hermon_poll_cq ( struct ib_device *ibdev,
 
 		/* Update completion queue's index */
 		cq->next_idx++;
-
-		/* Update doorbell record */
-		MLX_FILL_1 ( hermon_cq->doorbell, 0, update_ci,
-			     ( cq->next_idx & 0x00ffffffUL ) );
 	}
+
+	/* Update doorbell record */
+	MLX_FILL_1 ( hermon_cq->doorbell, 0, update_ci,
+		     ( cq->next_idx & 0x00ffffffUL ) );
 }
 
 /***************************************************************************
@@ -1987,9 +2019,14 @@ static void hermon_poll_eq ( struct ib_device *ibdev ) {
 	struct hermon_event_queue *hermon_eq = &hermon->eq;
 	union hermonprm_event_entry *eqe;
 	union hermonprm_doorbell_register db_reg;
+	struct ib_queue_pair *qp;
 	unsigned int eqe_idx_mask;
 	unsigned int event_type;
 
+	/* Notify hardware of any newly posted send work queue entries */
+	list_for_each_entry ( qp, &ibdev->qps, list )
+		hermon_ring_send_doorbell ( ibdev, qp );
+
 	/* No event is generated upon reaching INIT, so we must poll
 	 * separately for link state changes while we remain DOWN.
 	 */
@@ -3094,13 +3131,13 @@ static struct hermon_port_type hermon_port_type_ib = {
  */
 
 /** Number of Hermon Ethernet send work queue entries */
-#define HERMON_ETH_NUM_SEND_WQES 2
+#define HERMON_ETH_NUM_SEND_WQES 16
 
-/** Number of Hermon Ethernet receive work queue entries */
-#define HERMON_ETH_NUM_RECV_WQES 4
+/** Minimum number of Hermon Ethernet receive work queue entries */
+#define HERMON_ETH_MIN_RECV_WQES 4
 
-/** Number of Hermon Ethernet completion entries */
-#define HERMON_ETH_NUM_CQES 8
+/** Maximum number of Hermon Ethernet receive work queue entries */
+#define HERMON_ETH_MAX_RECV_WQES 64
 
 /**
  * Transmit packet via Hermon Ethernet device
@@ -3205,15 +3242,25 @@ static int hermon_eth_open ( struct net_device *netdev ) {
 	struct ib_device *ibdev = port->ibdev;
 	struct hermon *hermon = ib_get_drvdata ( ibdev );
 	union hermonprm_set_port set_port;
+	unsigned int num_recv_wqes;
+	unsigned int num_cqes;
 	int rc;
 
 	/* Open hardware */
 	if ( ( rc = hermon_open ( hermon ) ) != 0 )
 		goto err_open;
 
+	/* Choose receive queue size, and a completion queue size
+	 * large enough to hold completions for both queues
+	 */
+	num_recv_wqes = netdev_rx_ring_size ( netdev, IB_MAX_PAYLOAD_SIZE,
+					      HERMON_ETH_MIN_RECV_WQES,
+					      HERMON_ETH_MAX_RECV_WQES );
+	num_cqes = ( 1 << fls ( HERMON_ETH_NUM_SEND_WQES +
+				num_recv_wqes - 1 ) );
+
 	/* Allocate completion queue */
-	port->eth_cq = ib_create_cq ( ibdev, HERMON_ETH_NUM_CQES,
-				      &hermon_eth_cq_op );
+	port->eth_cq = ib_create_cq ( ibdev, num_cqes, &hermon_eth_cq_op );
 	if ( ! port->eth_cq ) {
 		DBGC ( hermon, "Hermon %p port %d could not create completion "
 		       "queue\n", hermon, ibdev->port );
@@ -3224,7 +3271,7 @@ static int hermon_eth_open ( struct net_device *netdev ) {
 	/* Allocate queue pair */
 	port->eth_qp = ib_create_qp ( ibdev, IB_QPT_ETH,
 				      HERMON_ETH_NUM_SEND_WQES, port->eth_cq,
-				      HERMON_ETH_NUM_RECV_WQES, port->eth_cq );
+				      num_recv_wqes, port->eth_cq );
 	if ( ! port->eth_qp ) {
 		DBGC ( hermon, "Hermon %p port %d could not create queue "
 		       "pair\n", hermon, ibdev->port );
@@ -3793,6 +3840,7 @@ static int hermon_probe ( struct pci_device *pci ) {
 		netdev_init ( netdev, &hermon_eth_operations );
 		netdev->dev = &pci->dev;
 		netdev->priv = &hermon->port[i];
+		netdev->state |= NETDEV_RX_CSUM;
 	}
 
 	/* Start device */
@@ -41,6 +41,11 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #define HERMON_OPCODE_RECV_ERROR	0xfe
 #define HERMON_OPCODE_SEND_ERROR	0xff
 
+/* Ethernet completion queue entry status bits */
+#define HERMON_CQE_ETH_STATUS_TCP	0x04000000UL
+#define HERMON_CQE_ETH_STATUS_UDP	0x08000000UL
+#define HERMON_CQE_ETH_STATUS_IPOK	0x10000000UL
+
 /* HCA command register opcodes */
 #define HERMON_HCR_QUERY_DEV_CAP	0x0003
 #define HERMON_HCR_QUERY_FW		0x0004
@@ -664,6 +669,8 @@ struct hermon_send_work_queue {
 	size_t wqe_size;
 	/** Doorbell register */
 	void *doorbell;
+	/** Work queue index as last notified to hardware */
+	unsigned long notified_idx;
 };
 
 /** Alignment of Hermon receive work queue entries */
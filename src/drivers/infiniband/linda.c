@@ -930,6 +930,34 @@ static void linda_destroy_qp ( struct ib_device *ibdev,
  ***************************************************************************
  */
 
+/**
+ * Write data to send buffer
+ *
+ * @v linda		Linda device
+ * @v data		Data
+ * @v len		Length of data
+ * @v offset		Offset within send buffer (must be qword-aligned)
+ * @ret offset		Offset following written data
+ *
+ * Data is written using qword accesses wherever possible, halving
+ * the number of MMIO writes required.  The length is rounded up to a
+ * whole number of dwords; only a final odd dword is written as a
+ * dword.
+ */
+static unsigned long linda_write_send_data ( struct linda *linda,
+					     const void *data, ssize_t len,
+					     unsigned long offset ) {
+	const struct QIB_7220_scalar *qword = data;
+
+	for ( ; len > 4 ; qword++, offset += 8, len -= 8 )
+		linda_writeq ( linda, qword, offset );
+	if ( len > 0 ) {
+		linda_writel ( linda, qword->u.dwords[0], offset );
+		offset += 4;
+	}
+	return offset;
+}
+
 /**
  * Post send work queue entry
  *
@@ -947,14 +975,16 @@ static int linda_post_send ( struct ib_device *ibdev,
 	struct ib_work_queue *wq = &qp->send;
 	struct linda_send_work_queue *linda_wq = ib_wq_get_drvdata ( wq );
 	struct QIB_7220_SendPbc sendpbc;
-	uint8_t header_buf[IB_MAX_HEADER_SIZE];
+	uint8_t header_buf[ IB_MAX_HEADER_SIZE + sizeof ( uint32_t ) ];
 	struct io_buffer headers;
 	unsigned int send_buf;
 	unsigned long start_offset;
 	unsigned long offset;
 	size_t len;
-	ssize_t frag_len;
-	uint32_t *data;
+	size_t frag_len;
+	size_t dword_len;
+	uint32_t *dword;
+	void *data;
 
 	/* Allocate send buffer and calculate offset */
 	send_buf = linda_alloc_send_buf ( linda );
@@ -965,9 +995,9 @@ static int linda_post_send ( struct ib_device *ibdev,
 	wq->iobufs[linda_wq->prod] = iobuf;
 	linda_wq->send_buf[linda_wq->prod] = send_buf;
 
-	/* Construct headers */
+	/* Construct headers, leaving room for one dword of payload */
 	iob_populate ( &headers, header_buf, 0, sizeof ( header_buf ) );
-	iob_reserve ( &headers, sizeof ( header_buf ) );
+	iob_reserve ( &headers, IB_MAX_HEADER_SIZE );
 	ib_push ( ibdev, &headers, qp, iob_len ( iobuf ), av );
 
 	/* Calculate packet length */
@@ -985,17 +1015,25 @@ static int linda_post_send ( struct ib_device *ibdev,
 	linda_writeq ( linda, &sendpbc, offset );
 	offset += sizeof ( sendpbc );
 
-	/* Write headers */
-	for ( data = headers.data, frag_len = iob_len ( &headers ) ;
-	      frag_len > 0 ; data++, offset += 4, frag_len -= 4 ) {
-		linda_writel ( linda, *data, offset );
+	/* Move up to one dword of payload into the headers, if
+	 * needed to keep the payload qword-aligned.
+	 */
+	data = iobuf->data;
+	frag_len = iob_len ( iobuf );
+	if ( frag_len && ( iob_len ( &headers ) & sizeof ( *dword ) ) ) {
+		dword = iob_put ( &headers, sizeof ( *dword ) );
+		dword_len = ( ( frag_len < sizeof ( *dword ) ) ?
+			      frag_len : sizeof ( *dword ) );
+		memset ( dword, 0, sizeof ( *dword ) );
+		memcpy ( dword, data, dword_len );
+		data += dword_len;
+		frag_len -= dword_len;
 	}
 
-	/* Write data */
-	for ( data = iobuf->data, frag_len = iob_len ( iobuf ) ;
-	      frag_len > 0 ; data++, offset += 4, frag_len -= 4 ) {
-		linda_writel ( linda, *data, offset );
-	}
+	/* Write headers and data */
+	offset = linda_write_send_data ( linda, headers.data,
+					 iob_len ( &headers ), offset );
+	offset = linda_write_send_data ( linda, data, frag_len, offset );
 	DBG_ENABLE ( DBGLVL_IO );
 
 	assert ( ( start_offset + len ) == offset );
@@ -0,0 +1,473 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <byteswap.h>
+#include <linux_api.h>
+#include <ipxe/linux.h>
+#include <ipxe/device.h>
+#include <ipxe/netdevice.h>
+#include <ipxe/iobuf.h>
+#include <ipxe/ethernet.h>
+#include <ipxe/settings.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <linux/sockios.h>
+
+/** @file
+ *
+ * Linux raw packet socket driver
+ *
+ * This driver attaches to an existing host network interface via an
+ * AF_PACKET socket.  Unlike the TAP driver (which must use one
+ * read() or write() system call per frame), packets are received and
+ * transmitted in batches using recvmmsg() and sendmmsg(), which
+ * allows the Linux build to sustain realistic traffic rates.
+ */
+
+/** Packet socket address family */
+#define AF_PACKET 17
+
+/** Raw socket type */
+#define SOCK_RAW 3
+
+/** Packet socket option level */
+#define SOL_PACKET 263
+
+/** Message was truncated */
+#define LINUX_MSG_TRUNC 0x20
+
+/** Maximum interface name length */
+#define AF_PACKET_IFNAMSIZ 16
+
+/**
+ * Number of packets per batch
+ *
+ * This is the maximum number of packets received by a single
+ * recvmmsg() call, and the maximum number of transmissions deferred
+ * until a single sendmmsg() call.
+ */
+#define AF_PACKET_BATCH 32
+
+/** Receive buffer length */
+#define AF_PACKET_RX_LEN 1536
+
+/**
+ * An interface request
+ *
+ * This is the subset of struct ifreq required for SIOCGIFINDEX,
+ * padded to the size of the full structure.  We avoid <linux/if.h>
+ * since it drags in C library headers on some systems.
+ */
+struct af_packet_ifreq {
+	/** Interface name */
+	char name[AF_PACKET_IFNAMSIZ];
+	/** Interface index */
+	int ifindex;
+	/** Padding */
+	char pad[20];
+};
+
+/** A raw packet socket network device */
+struct af_packet_nic {
+	/** Host interface name */
+	char *interface;
+	/** Socket file descriptor */
+	int fd;
+
+	/** Receive I/O buffers */
+	struct io_buffer *rx_iobuf[AF_PACKET_BATCH];
+	/** Receive source addresses */
+	struct sockaddr_ll rx_addr[AF_PACKET_BATCH];
+	/** Receive I/O vectors */
+	struct linux_iovec rx_iov[AF_PACKET_BATCH];
+	/** Receive message headers */
+	struct linux_mmsghdr rx_msg[AF_PACKET_BATCH];
+
+	/** Deferred transmit I/O buffers */
+	struct io_buffer *tx_iobuf[AF_PACKET_BATCH];
+	/** Transmit I/O vectors */
+	struct linux_iovec tx_iov[AF_PACKET_BATCH];
+	/** Transmit message headers */
+	struct linux_mmsghdr tx_msg[AF_PACKET_BATCH];
+	/** Number of deferred transmissions */
+	unsigned int tx_fill;
+};
+
+/**
+ * Prepare receive message slot
+ *
+ * @v nic		Raw packet socket device
+ * @v index		Slot index
+ * @v iobuf		I/O buffer
+ */
+static void af_packet_rx_prepare ( struct af_packet_nic *nic,
+				   unsigned int index,
+				   struct io_buffer *iobuf ) {
+	struct linux_mmsghdr *msg = &nic->rx_msg[index];
+	struct linux_iovec *iov = &nic->rx_iov[index];
+
+	iob_unput ( iobuf, iob_len ( iobuf ) );
+	nic->rx_iobuf[index] = iobuf;
+	iov->iov_base = iobuf->data;
+	iov->iov_len = iob_tailroom ( iobuf );
+	memset ( msg, 0, sizeof ( *msg ) );
+	msg->msg_hdr.msg_name = &nic->rx_addr[index];
+	msg->msg_hdr.msg_namelen = sizeof ( nic->rx_addr[index] );
+	msg->msg_hdr.msg_iov = iov;
+	msg->msg_hdr.msg_iovlen = 1;
+}
+
+/**
+ * Refill receive message slots
+ *
+ * @v nic		Raw packet socket device
+ * @ret count		Number of usable slots
+ */
+static unsigned int af_packet_rx_refill ( struct af_packet_nic *nic ) {
+	struct io_buffer *iobuf;
+	unsigned int i;
+
+	for ( i = 0 ; i < AF_PACKET_BATCH ; i++ ) {
+		if ( nic->rx_iobuf[i] )
+			continue;
+		iobuf = alloc_iob ( AF_PACKET_RX_LEN );
+		if ( ! iobuf ) {
+			/* Wait for next refill attempt */
+			break;
+		}
+		af_packet_rx_prepare ( nic, i, iobuf );
+	}
+	return i;
+}
+
+/**
+ * Open network device
+ *
+ * @v netdev		Network device
+ * @ret rc		Return status code
+ */
+static int af_packet_open ( struct net_device *netdev ) {
+	struct af_packet_nic *nic = netdev->priv;
+	struct af_packet_ifreq ifr;
+	struct sockaddr_ll sll;
+	struct packet_mreq mreq;
+	int rc;
+
+	/* Open socket */
+	nic->fd = linux_socket ( AF_PACKET, SOCK_RAW, htons ( ETH_P_ALL ) );
+	if ( nic->fd < 0 ) {
+		DBGC ( nic, "AFPACKET %p could not open socket: %s\n",
+		       nic, linux_strerror ( linux_errno ) );
+		rc = -EIO;
+		goto err_socket;
+	}
+
+	/* Identify host interface */
+	memset ( &ifr, 0, sizeof ( ifr ) );
+	strncpy ( ifr.name, nic->interface, ( sizeof ( ifr.name ) - 1 ) );
+	if ( linux_ioctl ( nic->fd, SIOCGIFINDEX, &ifr ) != 0 ) {
+		DBGC ( nic, "AFPACKET %p could not find interface \"%s\": "
+		       "%s\n", nic, nic->interface,
+		       linux_strerror ( linux_errno ) );
+		rc = -ENODEV;
+		goto err_ifindex;
+	}
+
+	/* Bind to host interface */
+	memset ( &sll, 0, sizeof ( sll ) );
+	sll.sll_family = AF_PACKET;
+	sll.sll_protocol = htons ( ETH_P_ALL );
+	sll.sll_ifindex = ifr.ifindex;
+	if ( linux_bind ( nic->fd, &sll, sizeof ( sll ) ) != 0 ) {
+		DBGC ( nic, "AFPACKET %p could not bind to \"%s\": %s\n",
+		       nic, nic->interface, linux_strerror ( linux_errno ) );
+		rc = -EIO;
+		goto err_bind;
+	}
+
+	/* Enable promiscuous mode, since our MAC address need not
+	 * match that of the host interface.
+	 */
+	memset ( &mreq, 0, sizeof ( mreq ) );
+	mreq.mr_ifindex = ifr.ifindex;
+	mreq.mr_type = PACKET_MR_PROMISC;
+	if ( linux_setsockopt ( nic->fd, SOL_PACKET, PACKET_ADD_MEMBERSHIP,
+				&mreq, sizeof ( mreq ) ) != 0 ) {
+		DBGC ( nic, "AFPACKET %p could not enable promiscuous mode: "
+		       "%s\n", nic, linux_strerror ( linux_errno ) );
+		/* Continue anyway */
+	}
+
+	/* Fill receive slots */
+	af_packet_rx_refill ( nic );
+	nic->tx_fill = 0;
+
+	DBGC ( nic, "AFPACKET %p attached to \"%s\" (index %d)\n",
+	       nic, nic->interface, ifr.ifindex );
+	return 0;
+
+ err_bind:
+ err_ifindex:
+	linux_close ( nic->fd );
+ err_socket:
+	return rc;
+}
+
+/**
+ * Close network device
+ *
+ * @v netdev		Network device
+ */
+static void af_packet_close ( struct net_device *netdev ) {
+	struct af_packet_nic *nic = netdev->priv;
+	unsigned int i;
+
+	/* Close socket */
+	linux_close ( nic->fd );
+
+	/* Discard receive buffers */
+	for ( i = 0 ; i < AF_PACKET_BATCH ; i++ ) {
+		free_iob ( nic->rx_iobuf[i] );
+		nic->rx_iobuf[i] = NULL;
+	}
+
+	/* Deferred transmissions will be cancelled by netdev_close() */
+	nic->tx_fill = 0;
+}
+
+/**
+ * Transmit deferred packets
+ *
+ * @v netdev		Network device
+ */
+static void af_packet_flush ( struct net_device *netdev ) {
+	struct af_packet_nic *nic = netdev->priv;
+	unsigned int done = 0;
+	int count;
+
+	/* Transmit all deferred packets */
+	while ( done < nic->tx_fill ) {
+		count = linux_sendmmsg ( nic->fd, &nic->tx_msg[done],
+					 ( nic->tx_fill - done ), 0 );
+		if ( count <= 0 ) {
+			DBGC ( nic, "AFPACKET %p could not transmit: %s\n",
+			       nic, linux_strerror ( linux_errno ) );
+			break;
+		}
+		DBGC2 ( nic, "AFPACKET %p transmitted %d packets\n",
+			nic, count );
+		while ( count-- )
+			netdev_tx_complete ( netdev, nic->tx_iobuf[done++] );
+	}
+
+	/* Fail any remaining packets */
+	while ( done < nic->tx_fill )
+		netdev_tx_complete_err ( netdev, nic->tx_iobuf[done++], -EIO );
+	nic->tx_fill = 0;
+}
+
+/**
+ * Transmit packet
+ *
+ * @v netdev		Network device
+ * @v iobuf		I/O buffer
+ * @ret rc		Return status code
+ *
+ * Transmissions are deferred until the next poll (or until a full
+ * batch has accumulated), so that packets generated in quick
+ * succession are handed to the kernel via a single system call.
+ */
+static int af_packet_transmit ( struct net_device *netdev,
+				struct io_buffer *iobuf ) {
+	struct af_packet_nic *nic = netdev->priv;
+	unsigned int index = nic->tx_fill;
+	struct linux_mmsghdr *msg = &nic->tx_msg[index];
+	struct linux_iovec *iov = &nic->tx_iov[index];
+
+	/* Pad packet */
+	iob_pad ( iobuf, ETH_ZLEN );
+
+	/* Defer transmission */
+	nic->tx_iobuf[index] = iobuf;
+	iov->iov_base = iobuf->data;
+	iov->iov_len = iob_len ( iobuf );
+	memset ( msg, 0, sizeof ( *msg ) );
+	msg->msg_hdr.msg_iov = iov;
+	msg->msg_hdr.msg_iovlen = 1;
+	nic->tx_fill++;
+
+	/* Transmit immediately if batch is full */
+	if ( nic->tx_fill == AF_PACKET_BATCH )
+		af_packet_flush ( netdev );
+
+	return 0;
+}
+
+/**
+ * Poll for received packets
+ *
+ * @v netdev		Network device
+ */
+static void af_packet_poll_rx ( struct net_device *netdev ) {
+	struct af_packet_nic *nic = netdev->priv;
+	struct linux_mmsghdr *msg;
+	struct io_buffer *iobuf;
+	unsigned int slots;
+	unsigned int i;
+	int count;
+
+	do {
+		/* Receive a batch of packets */
+		slots = af_packet_rx_refill ( nic );
+		if ( ! slots )
+			return;
+		count = linux_recvmmsg ( nic->fd, nic->rx_msg, slots,
+					 LINUX_MSG_DONTWAIT );
+		if ( count <= 0 )
+			return;
+		DBGC2 ( nic, "AFPACKET %p received %d packets\n",
+			nic, count );
+
+		/* Hand off received packets */
+		for ( i = 0 ; i < ( ( unsigned int ) count ) ; i++ ) {
+			msg = &nic->rx_msg[i];
+			iobuf = nic->rx_iobuf[i];
+
+			/* Recycle our own transmitted packets */
+			if ( nic->rx_addr[i].sll_pkttype == PACKET_OUTGOING ) {
+				af_packet_rx_prepare ( nic, i, iobuf );
+				continue;
+			}
+
+			/* Hand off packet */
+			nic->rx_iobuf[i] = NULL;
+			iob_put ( iobuf, msg->msg_len );
+			if ( msg->msg_hdr.msg_flags & LINUX_MSG_TRUNC ) {
+				netdev_rx_err ( netdev, iobuf, -EINVAL );
+			} else {
+				netdev_rx ( netdev, iobuf );
+			}
+		}
+
+	} while ( ( ( unsigned int ) count ) == slots );
+}
+
+/**
+ * Poll for completed and received packets
+ *
+ * @v netdev		Network device
+ */
+static void af_packet_poll ( struct net_device *netdev ) {
+
+	/* Transmit any deferred packets */
+	af_packet_flush ( netdev );
+
+	/* Poll for received packets */
+	af_packet_poll_rx ( netdev );
+}
+
+/** Raw packet socket network device operations */
+static struct net_device_operations af_packet_operations = {
+	.open		= af_packet_open,
+	.close		= af_packet_close,
+	.transmit	= af_packet_transmit,
+	.poll		= af_packet_poll,
+};
+
+/**
+ * Probe device
+ *
+ * @v device		Linux device
+ * @v request		Device request
+ * @ret rc		Return status code
+ */
+static int af_packet_probe ( struct linux_device *device,
+			     struct linux_device_request *request ) {
+	struct linux_setting *if_setting;
+	struct net_device *netdev;
+	struct af_packet_nic *nic;
+	int rc;
+
+	/* Allocate and initialise network device */
+	netdev = alloc_etherdev ( sizeof ( *nic ) );
+	if ( ! netdev ) {
+		rc = -ENOMEM;
+		goto err_alloc;
+	}
+	netdev_init ( netdev, &af_packet_operations );
+	nic = netdev->priv;
+	linux_set_drvdata ( device, netdev );
+	netdev->dev = &device->dev;
+	memset ( nic, 0, sizeof ( *nic ) );
+
+	/* Look for the mandatory interface setting */
+	if_setting = linux_find_setting ( "if", &request->settings );
+	if ( ! if_setting ) {
+		printf ( "af_packet missing a mandatory if setting\n" );
+		rc = -EINVAL;
+		goto err_settings;
+	}
+	nic->interface = if_setting->value;
+	if_setting->applied = 1;
+
+	/* Register network device */
+	if ( ( rc = register_netdev ( netdev ) ) != 0 )
+		goto err_register;
+	netdev_link_up ( netdev );
+
+	/* Apply remaining settings */
+	linux_apply_settings ( &request->settings,
+			       &netdev->settings.settings );
+
+	return 0;
+
+	unregister_netdev ( netdev );
+ err_register:
+ err_settings:
+	netdev_nullify ( netdev );
+	netdev_put ( netdev );
+ err_alloc:
+	return rc;
+}
+
+/**
+ * Remove device
+ *
+ * @v device		Linux device
+ */
+static void af_packet_remove ( struct linux_device *device ) {
+	struct net_device *netdev = linux_get_drvdata ( device );
+
+	unregister_netdev ( netdev );
+	netdev_nullify ( netdev );
+	netdev_put ( netdev );
+}
+
+/** Raw packet socket driver */
+struct linux_driver af_packet_driver __linux_driver = {
+	.name = "af_packet",
+	.probe = af_packet_probe,
+	.remove = af_packet_remove,
+	.can_probe = 1,
+};
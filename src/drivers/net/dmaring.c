@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <string.h>
+#include <errno.h>
+#include <ipxe/malloc.h>
+#include <ipxe/dmaring.h>
+
+/** @file
+ *
+ * DMA descriptor rings
+ *
+ */
+
+/**
+ * Allocate descriptor ring
+ *
+ * @v ring		Descriptor ring
+ * @v align		Required physical alignment, or zero
+ * @ret rc		Return status code
+ *
+ * The ring must already have been initialised using dma_ring_init().
+ * The descriptors are zeroed, and the producer and consumer counters
+ * are reset.  The ring will be aligned to at least @c DMA_RING_ALIGN,
+ * and its length is padded to a whole number of cachelines.
+ */
+int dma_ring_alloc ( struct dma_ring *ring, size_t align ) {
+	size_t len;
+
+	/* Allocate and zero descriptors */
+	if ( align < DMA_RING_ALIGN )
+		align = DMA_RING_ALIGN;
+	len = ( ( ring->len + DMA_RING_ALIGN - 1 ) & ~( DMA_RING_ALIGN - 1 ) );
+	ring->desc = malloc_dma ( len, align );
+	if ( ! ring->desc )
+		return -ENOMEM;
+	memset ( ring->desc, 0, len );
+
+	/* Reset counters */
+	ring->prod = 0;
+	ring->cons = 0;
+	ring->notified = 0;
+
+	return 0;
+}
+
+/**
+ * Free descriptor ring
+ *
+ * @v ring		Descriptor ring
+ */
+void dma_ring_free ( struct dma_ring *ring ) {
+	size_t len;
+
+	len = ( ( ring->len + DMA_RING_ALIGN - 1 ) & ~( DMA_RING_ALIGN - 1 ) );
+	free_dma ( ring->desc, len );
+	ring->desc = NULL;
+	ring->prod = 0;
+	ring->cons = 0;
+	ring->notified = 0;
+}
@@ -43,6 +43,14 @@ struct snpnet_device {
 
 	/** State that the SNP should be in after close */
 	UINT32 close_state;
+
+	/** Spare receive buffer, if any
+	 *
+	 * Most polls find no packet waiting.  The receive buffer
+	 * allocated for such a poll is kept for use by the next poll,
+	 * rather than being freed and immediately reallocated.
+	 */
+	struct io_buffer *rxbuf;
 };
 
 /**
@@ -99,7 +107,10 @@ static void snpnet_poll ( struct net_device *netdev ) {
 		 * some breathing room.
 		 */
 		len = snp->Mode->MaxPacketSize + ETH_HLEN + 8;
-		iobuf = alloc_iob ( len );
+		iobuf = snpnetdev->rxbuf;
+		snpnetdev->rxbuf = NULL;
+		if ( iobuf == NULL )
+			iobuf = alloc_iob ( len );
 		if ( iobuf == NULL ) {
 			netdev_rx_err ( netdev, NULL, -ENOMEM );
 			break;
@@ -108,9 +119,9 @@ static void snpnet_poll ( struct net_device *netdev ) {
 		efirc = snp->Receive ( snp, NULL, &len, iobuf->data,
 				       NULL, NULL, NULL );
 
-		/* No packets left? */
+		/* No packets left?  Keep buffer for the next poll */
 		if ( efirc == EFI_NOT_READY ) {
-			free_iob ( iobuf );
+			snpnetdev->rxbuf = iobuf;
 			break;
 		}
 
@@ -207,6 +218,10 @@ static void snpnet_close ( struct net_device *netdev ) {
 			       snp, efi_strerror ( efirc ) );
 		}
 	}
+
+	/* Discard spare receive buffer */
+	free_iob ( snpnetdev->rxbuf );
+	snpnetdev->rxbuf = NULL;
 }
 
 /**
@@ -2842,7 +2842,7 @@ sfe4001_init ( struct efab_nic *efab )
 	struct i2c_interface *i2c = &efab->i2c_bb.i2c;
 	efab_dword_t reg;
 	uint8_t in, cfg, out;
-	int count, rc;
+	int count, wait, rc;
 
 	EFAB_LOG ( "Initialise SFE4001 board\n" );
 
@@ -2920,16 +2920,20 @@ sfe4001_init ( struct efab_nic *efab )
 		if ( rc )
 			goto fail9;
 
+		/* Wait up to 1 second for DSP to power up */
 		EFAB_LOG ( "Waiting for power...(attempt %d)\n", count);
-		mdelay ( 1000 );
+		for ( wait = 0 ; wait < 100 ; wait++ ) {
+			mdelay ( 10 );
 
-		/* Check DSP is powered */
-		rc = i2c->read ( i2c, &i2c_pca9539, P1_IN, &in, EFAB_BYTE );
-		if ( rc )
-			goto fail10;
+			/* Check DSP is powered */
+			rc = i2c->read ( i2c, &i2c_pca9539, P1_IN, &in,
+					 EFAB_BYTE );
+			if ( rc )
+				goto fail10;
 
-		if ( in & ( 1 << P1_AFE_PWD_LBN ) )
-			return 0;
+			if ( in & ( 1 << P1_AFE_PWD_LBN ) )
+				return 0;
+		}
 	}
 
 	rc = -ETIMEDOUT;
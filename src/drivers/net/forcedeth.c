@@ -1113,12 +1113,15 @@ nv_mgmt_acquire_sema ( struct forcedeth_private *priv )
 	int i;
 	u32 tx_ctrl, mgmt_sema;
 
-	for ( i = 0; i < 10; i++ ) {
+	/* Wait up to 5 seconds for the management unit to release
+	 * the semaphore
+	 */
+	for ( i = 0; i < 5000; i++ ) {
 		mgmt_sema = readl ( ioaddr + NvRegTransmitterControl ) &
 			NVREG_XMITCTL_MGMT_SEMA_MASK;
 		if ( mgmt_sema == NVREG_XMITCTL_MGMT_SEMA_FREE )
 			break;
-		mdelay ( 500 );
+		mdelay ( 1 );
 	}
 
 	if ( mgmt_sema != NVREG_XMITCTL_MGMT_SEMA_FREE )
@@ -1175,14 +1178,14 @@ nv_mgmt_get_version ( struct forcedeth_private *priv )
 		ioaddr + NvRegTransmitterControl );
 	start = currticks();
 
-	while ( currticks() > start + 5 * ticks_per_sec() ) {
+	while ( ( currticks() - start ) < ( 5 * ticks_per_sec() ) ) {
 		data_ready2 = readl ( ioaddr + NvRegTransmitterControl );
 		if ( ( data_ready & NVREG_XMITCTL_DATA_READY ) !=
 		     ( data_ready2 & NVREG_XMITCTL_DATA_READY ) ) {
 			ready = 1;
 			break;
 		}
-		mdelay ( 1000 );
+		mdelay ( 1 );
 	}
 
 	if ( ! ready || ( data_ready2 & NVREG_XMITCTL_DATA_ERROR ) )
@@ -277,17 +277,23 @@ struct igbvf_adapter {
 
         u32 max_hw_frame_size;
 
-#define NUM_TX_DESC     8
-#define NUM_RX_DESC     8
+#define NUM_TX_DESC     32
+
+/* Minimum and maximum number of RX descriptors; the actual ring size
+ * is chosen on open according to available memory.
+ */
+#define IGBVF_MIN_RX_DESC 8
+#define IGBVF_MAX_RX_DESC 256
 
         struct io_buffer *tx_iobuf[NUM_TX_DESC];
-        struct io_buffer *rx_iobuf[NUM_RX_DESC];
+        struct io_buffer *rx_iobuf[IGBVF_MAX_RX_DESC];
 
         union e1000_adv_tx_desc *tx_base;
         union e1000_adv_rx_desc *rx_base;
 
         uint32_t tx_ring_size;
         uint32_t rx_ring_size;
+        uint32_t rx_count;
 
         uint32_t tx_head;
         uint32_t tx_tail;
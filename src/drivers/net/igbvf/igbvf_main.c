@@ -89,13 +89,13 @@ void igbvf_free_tx_resources ( struct igbvf_adapter *adapter )
  **/
 void igbvf_free_rx_resources ( struct igbvf_adapter *adapter )
 {
-	int i;
+	unsigned int i;
 
 	DBG ( "igbvf_free_rx_resources\n" );
 
 	free_dma ( adapter->rx_base, adapter->rx_ring_size );
 
-	for ( i = 0; i < NUM_RX_DESC; i++ ) {
+	for ( i = 0; i < adapter->rx_count; i++ ) {
 		free_iob ( adapter->rx_iobuf[i] );
 	}
 }
@@ -109,7 +109,7 @@ void igbvf_free_rx_resources ( struct igbvf_adapter *adapter )
  **/
 static int igbvf_refill_rx_ring ( struct igbvf_adapter *adapter )
 {
-	int i, rx_curr;
+	unsigned int i, rx_curr;
 	int rc = 0;
 	union e1000_adv_rx_desc *rx_curr_desc;
 	struct e1000_hw *hw = &adapter->hw;
@@ -117,8 +117,8 @@ static int igbvf_refill_rx_ring ( struct igbvf_adapter *adapter )
 
 	DBGP ("igbvf_refill_rx_ring\n");
 
-	for ( i = 0; i < NUM_RX_DESC; i++ ) {
-		rx_curr = ( ( adapter->rx_curr + i ) % NUM_RX_DESC );
+	for ( i = 0; i < adapter->rx_count; i++ ) {
+		rx_curr = ( ( adapter->rx_curr + i ) % adapter->rx_count );
 		rx_curr_desc = adapter->rx_base + rx_curr;
 
 		if ( rx_curr_desc->wb.upper.status_error & E1000_RXD_STAT_DD )
@@ -282,6 +282,15 @@ static void igbvf_process_rx_packets ( struct net_device *netdev )
 
 		iob_put ( adapter->rx_iobuf[i], rx_len );
 
+		/* Record checksum verification, if applicable */
+		if ( ( rx_status & ( E1000_RXD_STAT_TCPCS |
+				     E1000_RXD_STAT_UDPCS ) ) &&
+		     ! ( rx_status & ( E1000_RXD_STAT_IXSM |
+				       E1000_RXDEXT_STATERR_TCPE |
+				       E1000_RXDEXT_STATERR_IPE ) ) ) {
+			adapter->rx_iobuf[i]->flags |= IOB_CSUM_VERIFIED;
+		}
+
 		if ( rx_err & E1000_RXDEXT_ERR_FRAME_ERR_MASK ) {
 
 			netdev_rx_err ( netdev, adapter->rx_iobuf[i], -EINVAL );
@@ -295,7 +304,7 @@ static void igbvf_process_rx_packets ( struct net_device *netdev )
 
 		memset ( rx_curr_desc, 0, sizeof ( *rx_curr_desc ) );
 
-		adapter->rx_curr = ( adapter->rx_curr + 1 ) % NUM_RX_DESC;
+		adapter->rx_curr = ( adapter->rx_curr + 1 ) % adapter->rx_count;
 	}
 }
 
@@ -553,7 +562,7 @@ static void igbvf_configure_rx ( struct igbvf_adapter *adapter )
 
         /* enable receives */
         ew32 ( RXDCTL(0), rxdctl );
-        ew32 ( RDT(0), NUM_RX_DESC );
+        ew32 ( RDT(0), adapter->rx_count );
 }
 
 /**
@@ -563,7 +572,7 @@ static void igbvf_configure_rx ( struct igbvf_adapter *adapter )
  **/
 int igbvf_setup_rx_resources ( struct igbvf_adapter *adapter )
 {
-	int i;
+	unsigned int i;
 	union e1000_adv_rx_desc *rx_curr_desc;
         struct io_buffer *iob;
 
@@ -581,7 +590,7 @@ int igbvf_setup_rx_resources ( struct igbvf_adapter *adapter )
 	}
 	memset ( adapter->rx_base, 0, adapter->rx_ring_size );
 
-	for ( i = 0; i < NUM_RX_DESC; i++ ) {
+	for ( i = 0; i < adapter->rx_count; i++ ) {
                 rx_curr_desc = adapter->rx_base + i;
                 iob = alloc_iob ( MAXIMUM_ETHERNET_VLAN_SIZE );
                 adapter->rx_iobuf[i] = iob;
@@ -617,6 +626,14 @@ static int igbvf_open ( struct net_device *netdev )
 
 	DBG ("igbvf_open\n");
 
+	/* Choose receive descriptor ring size */
+	adapter->rx_count = netdev_rx_ring_size ( netdev,
+						  MAXIMUM_ETHERNET_VLAN_SIZE,
+						  IGBVF_MIN_RX_DESC,
+						  IGBVF_MAX_RX_DESC );
+	adapter->rx_ring_size =
+		sizeof ( *adapter->rx_base ) * adapter->rx_count;
+
 	/* allocate transmit descriptors */
 	err = igbvf_setup_tx_resources ( adapter );
 	if (err) {
@@ -805,6 +822,11 @@ int igbvf_probe ( struct pci_device *pdev )
 	pci_set_drvdata ( pdev, netdev );
 	netdev->dev = &pdev->dev;
 
+	/* Received TCP and UDP checksums are verified by hardware,
+	 * if enabled by the PF driver
+	 */
+	netdev->state |= NETDEV_RX_CSUM;
+
 	/* Initialize driver private storage */
 	adapter = netdev_priv ( netdev );
 	memset ( adapter, 0, ( sizeof ( *adapter ) ) );
@@ -826,7 +848,6 @@ int igbvf_probe ( struct pci_device *pdev )
 	adapter->max_hw_frame_size = ETH_FRAME_LEN + ETH_FCS_LEN;
 
 	adapter->tx_ring_size = sizeof ( *adapter->tx_base ) * NUM_TX_DESC;
-	adapter->rx_ring_size = sizeof ( *adapter->rx_base ) * NUM_RX_DESC;
 
 	/* Fix up PCI device */
 	adjust_pci_device ( pdev );
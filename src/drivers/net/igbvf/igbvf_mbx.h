@@ -78,8 +78,8 @@ FILE_LICENCE ( GPL2_ONLY );
 
 #define E1000_PF_CONTROL_MSG      0x0100 /* PF control message */
 
-#define E1000_VF_MBX_INIT_TIMEOUT 2000 /* number of retries on mailbox */
-#define E1000_VF_MBX_INIT_DELAY   500  /* microseconds between retries */
+#define E1000_VF_MBX_INIT_TIMEOUT 100000 /* number of retries on mailbox */
+#define E1000_VF_MBX_INIT_DELAY   10     /* microseconds between retries */
 
 void igbvf_init_mbx_ops_generic(struct e1000_hw *hw);
 s32 igbvf_init_mbx_params_vf(struct e1000_hw *);
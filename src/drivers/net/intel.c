@@ -363,20 +363,17 @@ static void intel_check_link ( struct net_device *netdev ) {
 static int intel_create_ring ( struct intel_nic *intel,
 			       struct intel_ring *ring ) {
 	physaddr_t address;
+	int rc;
 
 	/* Allocate descriptor ring.  Align ring on its own size to
 	 * prevent any possible page-crossing errors due to hardware
 	 * errata.
 	 */
-	ring->desc = malloc_dma ( ring->len, ring->len );
-	if ( ! ring->desc )
-		return -ENOMEM;
-
-	/* Initialise descriptor ring */
-	memset ( ring->desc, 0, ring->len );
+	if ( ( rc = dma_ring_alloc ( &ring->ring, ring->ring.len ) ) != 0 )
+		return rc;
 
 	/* Program ring address */
-	address = virt_to_bus ( ring->desc );
+	address = virt_to_bus ( ring->ring.desc );
 	writel ( ( address & 0xffffffffUL ),
 		 ( intel->regs + ring->reg + INTEL_xDBAL ) );
 	if ( sizeof ( physaddr_t ) > sizeof ( uint32_t ) ) {
@@ -387,7 +384,7 @@ static int intel_create_ring ( struct intel_nic *intel,
 	}
 
 	/* Program ring length */
-	writel ( ring->len, ( intel->regs + ring->reg + INTEL_xDLEN ) );
+	writel ( ring->ring.len, ( intel->regs + ring->reg + INTEL_xDLEN ) );
 
 	/* Reset head and tail pointers */
 	writel ( 0, ( intel->regs + ring->reg + INTEL_xDH ) );
@@ -395,7 +392,7 @@ static int intel_create_ring ( struct intel_nic *intel,
 
 	DBGC ( intel, "INTEL %p ring %05x is at [%08llx,%08llx)\n",
 	       intel, ring->reg, ( ( unsigned long long ) address ),
-	       ( ( unsigned long long ) address + ring->len ) );
+	       ( ( unsigned long long ) address + ring->ring.len ) );
 
 	return 0;
 }
@@ -417,10 +414,7 @@ static void intel_destroy_ring ( struct intel_nic *intel,
 	writel ( 0, ( intel->regs + ring->reg + INTEL_xDBAH ) );
 
 	/* Free descriptor ring */
-	free_dma ( ring->desc, ring->len );
-	ring->desc = NULL;
-	ring->prod = 0;
-	ring->cons = 0;
+	dma_ring_free ( &ring->ring );
 }
 
 /**
@@ -429,25 +423,28 @@ static void intel_destroy_ring ( struct intel_nic *intel,
  * @v intel		Intel device
  */
 static void intel_refill_rx ( struct intel_nic *intel ) {
+	struct dma_ring *ring = &intel->rx.ring;
 	struct intel_descriptor *rx;
 	struct io_buffer *iobuf;
 	unsigned int rx_idx;
-	unsigned int rx_tail;
 	physaddr_t address;
 
-	while ( ( intel->rx.prod - intel->rx.cons ) < INTEL_RX_FILL ) {
+	/* Defer refilling until a whole batch of descriptors is free */
+	if ( ( intel->rx_fill - dma_ring_fill ( ring ) ) < intel->rx_batch )
+		return;
+
+	while ( dma_ring_fill ( ring ) < intel->rx_fill ) {
 
 		/* Allocate I/O buffer */
-		iobuf = alloc_iob ( INTEL_RX_MAX_LEN );
+		iobuf = alloc_iob ( intel->rx_len );
 		if ( ! iobuf ) {
 			/* Wait for next refill */
-			return;
+			break;
 		}
 
 		/* Get next receive descriptor */
-		rx_idx = ( intel->rx.prod++ % INTEL_NUM_RX_DESC );
-		rx_tail = ( intel->rx.prod % INTEL_NUM_RX_DESC );
-		rx = &intel->rx.desc[rx_idx];
+		rx_idx = dma_ring_index ( ring, ring->prod++ );
+		rx = dma_ring_desc ( ring, rx_idx );
 
 		/* Populate receive descriptor */
 		address = virt_to_bus ( iobuf->data );
@@ -455,21 +452,85 @@ static void intel_refill_rx ( struct intel_nic *intel ) {
 		rx->length = 0;
 		rx->status = 0;
 		rx->errors = 0;
-		wmb();
 
 		/* Record I/O buffer */
 		assert ( intel->rx_iobuf[rx_idx] == NULL );
 		intel->rx_iobuf[rx_idx] = iobuf;
 
-		/* Push descriptor to card */
-		writel ( rx_tail, intel->regs + INTEL_RDT );
-
 		DBGC2 ( intel, "INTEL %p RX %d is [%llx,%llx)\n", intel, rx_idx,
 			( ( unsigned long long ) address ),
-			( ( unsigned long long ) address + INTEL_RX_MAX_LEN ) );
+			( ( unsigned long long ) address + intel->rx_len ) );
+	}
+
+	/* Push all new descriptors to card with a single tail update */
+	if ( dma_ring_notify ( ring ) ) {
+		wmb();
+		writel ( dma_ring_index ( ring, ring->prod ),
+			 intel->regs + INTEL_RDT );
+	}
+}
+
+/**
+ * Choose receive buffer size
+ *
+ * @v netdev		Network device
+ * @ret rctl		Receive control register buffer size bits
+ */
+static uint32_t intel_rx_bsize ( struct net_device *netdev ) {
+	struct intel_nic *intel = netdev->priv;
+	size_t len;
+
+	/* Allow space for a VLAN tag and CRC */
+	len = ( netdev_rx_frame_len ( netdev ) + 4 /* VLAN */ + 4 /* CRC */ );
+
+	/* Use the smallest supported buffer size that will fit */
+	if ( len <= INTEL_RX_MIN_LEN ) {
+		intel->rx_len = INTEL_RX_MIN_LEN;
+		return INTEL_RCTL_BSIZE_2048;
+	} else if ( len <= 4096 ) {
+		intel->rx_len = 4096;
+		return INTEL_RCTL_BSIZE_4096;
+	} else if ( len <= 8192 ) {
+		intel->rx_len = 8192;
+		return INTEL_RCTL_BSIZE_8192;
+	} else {
+		intel->rx_len = 16384;
+		return INTEL_RCTL_BSIZE_16384;
 	}
 }
 
+/**
+ * Update receive address filter
+ *
+ * @v netdev		Network device
+ */
+static void intel_filter ( struct net_device *netdev ) {
+	struct intel_nic *intel = netdev->priv;
+	union intel_receive_address mac;
+	uint32_t rctl;
+
+	/* Program MAC address */
+	memset ( &mac, 0, sizeof ( mac ) );
+	memcpy ( mac.raw, netdev->ll_addr, sizeof ( mac.raw ) );
+	writel ( le32_to_cpu ( mac.reg.low ), intel->regs + INTEL_RAL0 );
+	writel ( ( le32_to_cpu ( mac.reg.high ) | INTEL_RAH0_AV ),
+		 intel->regs + INTEL_RAH0 );
+
+	/* Accept foreign unicast packets only if required.  Multicast
+	 * group membership is not tracked, so all multicast packets
+	 * are always accepted.
+	 */
+	rctl = readl ( intel->regs + INTEL_RCTL );
+	rctl &= ~INTEL_RCTL_UPE;
+	rctl |= INTEL_RCTL_MPE;
+	if ( netdev_rx_is_promisc ( netdev ) )
+		rctl |= INTEL_RCTL_UPE;
+	writel ( rctl, intel->regs + INTEL_RCTL );
+	DBGC ( intel, "INTEL %p receiving %s unicast for %s\n", intel,
+	       ( netdev_rx_is_promisc ( netdev ) ? "all" : "own" ),
+	       eth_ntoa ( netdev->ll_addr ) );
+}
+
 /**
  * Open network device
  *
@@ -478,11 +539,20 @@ static void intel_refill_rx ( struct intel_nic *intel ) {
  */
 static int intel_open ( struct net_device *netdev ) {
 	struct intel_nic *intel = netdev->priv;
-	union intel_receive_address mac;
 	uint32_t tctl;
 	uint32_t rctl;
+	uint32_t bsize;
+	unsigned int rx_count;
 	int rc;
 
+	/* Choose receive buffer size and descriptor ring size */
+	bsize = intel_rx_bsize ( netdev );
+	rx_count = netdev_rx_ring_size ( netdev, intel->rx_len,
+					 INTEL_MIN_RX_DESC, INTEL_MAX_RX_DESC );
+	intel_init_ring ( &intel->rx, rx_count, INTEL_RD );
+	intel->rx_fill = ( rx_count / 2 );
+	intel->rx_batch = ( ( intel->rx_fill + 3 ) / 4 );
+
 	/* Create transmit descriptor ring */
 	if ( ( rc = intel_create_ring ( intel, &intel->tx ) ) != 0 )
 		goto err_create_tx;
@@ -494,12 +564,8 @@ static int intel_open ( struct net_device *netdev ) {
 	/* Fill receive ring */
 	intel_refill_rx ( intel );
 
-	/* Program MAC address */
-	memset ( &mac, 0, sizeof ( mac ) );
-	memcpy ( mac.raw, netdev->ll_addr, sizeof ( mac.raw ) );
-	writel ( le32_to_cpu ( mac.reg.low ), intel->regs + INTEL_RAL0 );
-	writel ( ( le32_to_cpu ( mac.reg.high ) | INTEL_RAH0_AV ),
-		 intel->regs + INTEL_RAH0 );
+	/* Program MAC address and receive filter */
+	intel_filter ( netdev );
 
 	/* Enable transmitter  */
 	tctl = readl ( intel->regs + INTEL_TCTL );
@@ -508,11 +574,16 @@ static int intel_open ( struct net_device *netdev ) {
 		  INTEL_TCTL_COLD_DEFAULT );
 	writel ( tctl, intel->regs + INTEL_TCTL );
 
+	/* Enable receive checksum offload */
+	writel ( ( INTEL_RXCSUM_IPOFL | INTEL_RXCSUM_TUOFL ),
+		 intel->regs + INTEL_RXCSUM );
+
 	/* Enable receiver */
 	rctl = readl ( intel->regs + INTEL_RCTL );
-	rctl &= ~( INTEL_RCTL_BSIZE_BSEX_MASK );
-	rctl |= ( INTEL_RCTL_EN | INTEL_RCTL_UPE | INTEL_RCTL_MPE |
-		  INTEL_RCTL_BAM | INTEL_RCTL_BSIZE_2048 | INTEL_RCTL_SECRC );
+	rctl &= ~( INTEL_RCTL_BSIZE_BSEX_MASK | INTEL_RCTL_LPE );
+	rctl |= ( INTEL_RCTL_EN | INTEL_RCTL_BAM | bsize | INTEL_RCTL_SECRC );
+	if ( netdev->mtu > ETH_MAX_MTU )
+		rctl |= INTEL_RCTL_LPE;
 	writel ( rctl, intel->regs + INTEL_RCTL );
 
 	/* Update link state */
@@ -546,7 +617,7 @@ static void intel_close ( struct net_device *netdev ) {
 	intel_destroy_ring ( intel, &intel->rx );
 
 	/* Discard any unused receive buffers */
-	for ( i = 0 ; i < INTEL_NUM_RX_DESC ; i++ ) {
+	for ( i = 0 ; i < intel->rx.ring.count ; i++ ) {
 		if ( intel->rx_iobuf[i] )
 			free_iob ( intel->rx_iobuf[i] );
 		intel->rx_iobuf[i] = NULL;
@@ -566,22 +637,21 @@ static void intel_close ( struct net_device *netdev ) {
  * @v iobuf		I/O buffer
  * @ret rc		Return status code
  */
-static int intel_transmit ( struct net_device *netdev,
-			       struct io_buffer *iobuf ) {
+static int __hot intel_transmit ( struct net_device *netdev,
+				  struct io_buffer *iobuf ) {
 	struct intel_nic *intel = netdev->priv;
+	struct dma_ring *ring = &intel->tx.ring;
 	struct intel_descriptor *tx;
 	unsigned int tx_idx;
-	unsigned int tx_tail;
 	physaddr_t address;
 
 	/* Get next transmit descriptor */
-	if ( ( intel->tx.prod - intel->tx.cons ) >= INTEL_NUM_TX_DESC ) {
+	if ( ! dma_ring_space ( ring ) ) {
 		DBGC ( intel, "INTEL %p out of transmit descriptors\n", intel );
 		return -ENOBUFS;
 	}
-	tx_idx = ( intel->tx.prod++ % INTEL_NUM_TX_DESC );
-	tx_tail = ( intel->tx.prod % INTEL_NUM_TX_DESC );
-	tx = &intel->tx.desc[tx_idx];
+	tx_idx = dma_ring_index ( ring, ring->prod++ );
+	tx = dma_ring_desc ( ring, tx_idx );
 
 	/* Populate transmit descriptor */
 	address = virt_to_bus ( iobuf->data );
@@ -593,7 +663,9 @@ static int intel_transmit ( struct net_device *netdev,
 	wmb();
 
 	/* Notify card that there are packets ready to transmit */
-	writel ( tx_tail, intel->regs + INTEL_TDT );
+	if ( dma_ring_notify ( ring ) )
+		writel ( dma_ring_index ( ring, ring->prod ),
+			 intel->regs + INTEL_TDT );
 
 	DBGC2 ( intel, "INTEL %p TX %d is [%llx,%llx)\n", intel, tx_idx,
 		( ( unsigned long long ) address ),
@@ -607,17 +679,18 @@ static int intel_transmit ( struct net_device *netdev,
  *
  * @v netdev		Network device
  */
-static void intel_poll_tx ( struct net_device *netdev ) {
+static void __hot intel_poll_tx ( struct net_device *netdev ) {
 	struct intel_nic *intel = netdev->priv;
+	struct dma_ring *ring = &intel->tx.ring;
 	struct intel_descriptor *tx;
 	unsigned int tx_idx;
 
 	/* Check for completed packets */
-	while ( intel->tx.cons != intel->tx.prod ) {
+	while ( dma_ring_fill ( ring ) ) {
 
 		/* Get next transmit descriptor */
-		tx_idx = ( intel->tx.cons % INTEL_NUM_TX_DESC );
-		tx = &intel->tx.desc[tx_idx];
+		tx_idx = dma_ring_index ( ring, ring->cons );
+		tx = dma_ring_desc ( ring, tx_idx );
 
 		/* Stop if descriptor is still in use */
 		if ( ! ( tx->status & INTEL_DESC_STATUS_DD ) )
@@ -627,7 +700,7 @@ static void intel_poll_tx ( struct net_device *netdev ) {
 
 		/* Complete TX descriptor */
 		netdev_tx_complete_next ( netdev );
-		intel->tx.cons++;
+		ring->cons++;
 	}
 }
 
@@ -636,32 +709,44 @@ static void intel_poll_tx ( struct net_device *netdev ) {
  *
  * @v netdev		Network device
  */
-static void intel_poll_rx ( struct net_device *netdev ) {
+static void __hot intel_poll_rx ( struct net_device *netdev ) {
 	struct intel_nic *intel = netdev->priv;
+	struct dma_ring *ring = &intel->rx.ring;
 	struct intel_descriptor *rx;
 	struct io_buffer *iobuf;
 	unsigned int rx_idx;
 	size_t len;
 
 	/* Check for received packets */
-	while ( intel->rx.cons != intel->rx.prod ) {
+	while ( dma_ring_fill ( ring ) ) {
 
 		/* Get next receive descriptor */
-		rx_idx = ( intel->rx.cons % INTEL_NUM_RX_DESC );
-		rx = &intel->rx.desc[rx_idx];
+		rx_idx = dma_ring_index ( ring, ring->cons );
+		rx = dma_ring_desc ( ring, rx_idx );
 
 		/* Stop if descriptor is still in use */
 		if ( ! ( rx->status & INTEL_DESC_STATUS_DD ) )
 			return;
 
+		/* Start fetching the following descriptor */
+		dma_ring_prefetch ( ring, ( ring->cons + 1 ) );
+
 		/* Populate I/O buffer */
 		iobuf = intel->rx_iobuf[rx_idx];
 		intel->rx_iobuf[rx_idx] = NULL;
 		len = le16_to_cpu ( rx->length );
 		iob_put ( iobuf, len );
 
+		/* Record checksum verification, if applicable */
+		if ( ( ( rx->status & ( INTEL_DESC_STATUS_IXSM |
+					INTEL_DESC_STATUS_TCPCS ) ) ==
+		       INTEL_DESC_STATUS_TCPCS ) &&
+		     ( ! ( rx->errors & INTEL_DESC_ERR_CSUM ) ) ) {
+			iobuf->flags |= IOB_CSUM_VERIFIED;
+		}
+
 		/* Hand off to network stack */
-		if ( rx->errors ) {
+		if ( rx->errors & ~INTEL_DESC_ERR_CSUM ) {
 			DBGC ( intel, "INTEL %p RX %d error (length %zd, "
 			       "errors %02x)\n",
 			       intel, rx_idx, len, rx->errors );
@@ -671,7 +756,7 @@ static void intel_poll_rx ( struct net_device *netdev ) {
 				intel, rx_idx, len );
 			netdev_rx ( netdev, iobuf );
 		}
-		intel->rx.cons++;
+		ring->cons++;
 	}
 }
 
@@ -680,15 +765,23 @@ static void intel_poll_rx ( struct net_device *netdev ) {
  *
  * @v netdev		Network device
  */
-static void intel_poll ( struct net_device *netdev ) {
+static void __hot intel_poll ( struct net_device *netdev ) {
 	struct intel_nic *intel = netdev->priv;
 	uint32_t icr;
+	uint32_t missed;
 
 	/* Check for and acknowledge interrupts */
 	icr = readl ( intel->regs + INTEL_ICR );
 	if ( ! icr )
 		return;
 
+	/* Report packets dropped due to lack of receive descriptors */
+	if ( icr & INTEL_IRQ_RXO ) {
+		missed = readl ( intel->regs + INTEL_MPC );
+		while ( missed-- )
+			netdev_rx_err ( netdev, NULL, -ENOBUFS );
+	}
+
 	/* Poll for TX completions, if applicable */
 	if ( icr & INTEL_IRQ_TXDW )
 		intel_poll_tx ( netdev );
@@ -730,6 +823,7 @@ static struct net_device_operations intel_operations = {
 	.transmit	= intel_transmit,
 	.poll		= intel_poll,
 	.irq		= intel_irq,
+	.filter		= intel_filter,
 };
 
 /******************************************************************************
@@ -760,10 +854,11 @@ static int intel_probe ( struct pci_device *pci ) {
 	intel = netdev->priv;
 	pci_set_drvdata ( pci, netdev );
 	netdev->dev = &pci->dev;
+	netdev->state |= NETDEV_RX_CSUM;
+	netdev->max_pkt_len = INTEL_MAX_PKT_LEN;
 	memset ( intel, 0, sizeof ( *intel ) );
 	intel->port = PCI_FUNC ( pci->busdevfn );
 	intel_init_ring ( &intel->tx, INTEL_NUM_TX_DESC, INTEL_TD );
-	intel_init_ring ( &intel->rx, INTEL_NUM_RX_DESC, INTEL_RD );
 
 	/* Fix up PCI device */
 	adjust_pci_device ( pci );
@@ -12,6 +12,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <stdint.h>
 #include <ipxe/if_ether.h>
 #include <ipxe/nvs.h>
+#include <ipxe/dmaring.h>
 
 /** Intel BAR size */
 #define INTEL_BAR_SIZE ( 128 * 1024 )
@@ -48,8 +49,26 @@ enum intel_descriptor_command {
 enum intel_descriptor_status {
 	/** Descriptor done */
 	INTEL_DESC_STATUS_DD = 0x01,
+	/** Ignore checksum indication */
+	INTEL_DESC_STATUS_IXSM = 0x04,
+	/** TCP/UDP checksum calculated */
+	INTEL_DESC_STATUS_TCPCS = 0x20,
 };
 
+/** Packet descriptor error bits */
+enum intel_descriptor_errors {
+	/** TCP/UDP checksum error */
+	INTEL_DESC_ERR_TCPE = 0x20,
+	/** IP checksum error */
+	INTEL_DESC_ERR_IPE = 0x40,
+};
+
+/** Packet descriptor errors which do not invalidate the packet
+ *
+ * Checksum errors are left for the network stack to detect.
+ */
+#define INTEL_DESC_ERR_CSUM ( INTEL_DESC_ERR_TCPE | INTEL_DESC_ERR_IPE )
+
 /** Device Control Register */
 #define INTEL_CTRL 0x00000UL
 #define INTEL_CTRL_LRST		0x00000008UL	/**< Link reset */
@@ -92,6 +111,7 @@ enum intel_descriptor_status {
 #define INTEL_ICR 0x000c0UL
 #define INTEL_IRQ_TXDW		0x00000001UL	/**< Transmit descriptor done */
 #define INTEL_IRQ_LSC		0x00000004UL	/**< Link status change */
+#define INTEL_IRQ_RXO		0x00000040UL	/**< Receive overrun */
 #define INTEL_IRQ_RXT0		0x00000080UL	/**< Receive timer */
 
 /** Interrupt Mask Set/Read Register */
@@ -105,13 +125,25 @@ enum intel_descriptor_status {
 #define INTEL_RCTL_EN		0x00000002UL	/**< Receive enable */
 #define INTEL_RCTL_UPE		0x00000008UL	/**< Unicast promiscuous mode */
 #define INTEL_RCTL_MPE		0x00000010UL	/**< Multicast promiscuous */
+#define INTEL_RCTL_LPE		0x00000020UL	/**< Long packet enable */
 #define INTEL_RCTL_BAM		0x00008000UL	/**< Broadcast accept mode */
 #define INTEL_RCTL_BSIZE_BSEX(bsex,bsize) \
 	( ( (bsize) << 16 ) | ( (bsex) << 25 ) ) /**< Buffer size */
 #define INTEL_RCTL_BSIZE_2048	INTEL_RCTL_BSIZE_BSEX ( 0, 0 )
+#define INTEL_RCTL_BSIZE_4096	INTEL_RCTL_BSIZE_BSEX ( 1, 3 )
+#define INTEL_RCTL_BSIZE_8192	INTEL_RCTL_BSIZE_BSEX ( 1, 2 )
+#define INTEL_RCTL_BSIZE_16384	INTEL_RCTL_BSIZE_BSEX ( 1, 1 )
 #define INTEL_RCTL_BSIZE_BSEX_MASK INTEL_RCTL_BSIZE_BSEX ( 1, 3 )
 #define INTEL_RCTL_SECRC	0x04000000UL	/**< Strip CRC */
 
+/** Missed Packets Count Register */
+#define INTEL_MPC 0x04010UL
+
+/** Receive Checksum Control Register */
+#define INTEL_RXCSUM 0x05000UL
+#define INTEL_RXCSUM_IPOFL	0x00000100UL	/**< IP checksum offload */
+#define INTEL_RXCSUM_TUOFL	0x00000200UL	/**< TCP/UDP checksum offload */
+
 /** Transmit Control Register */
 #define INTEL_TCTL 0x00400UL
 #define INTEL_TCTL_EN		0x00000002UL	/**< Transmit enable */
@@ -132,18 +164,21 @@ enum intel_descriptor_status {
 /** Receive Descriptor register block */
 #define INTEL_RD 0x02800UL
 
-/** Number of receive descriptors
+/** Minimum number of receive descriptors
  *
  * Minimum value is 8, since the descriptor ring length must be a
  * multiple of 128.
  */
-#define INTEL_NUM_RX_DESC 8
+#define INTEL_MIN_RX_DESC 8
 
-/** Receive descriptor ring fill level */
-#define INTEL_RX_FILL 4
+/** Maximum number of receive descriptors */
+#define INTEL_MAX_RX_DESC 256
 
-/** Receive buffer length */
-#define INTEL_RX_MAX_LEN 2048
+/** Minimum receive buffer length */
+#define INTEL_RX_MIN_LEN 2048
+
+/** Maximum packet length (including jumbo frames) */
+#define INTEL_MAX_PKT_LEN ETH_JUMBO_FRAME_LEN
 
 /** Transmit Descriptor register block */
 #define INTEL_TD 0x03800UL
@@ -200,17 +235,10 @@ union intel_receive_address {
 
 /** An Intel descriptor ring */
 struct intel_ring {
-	/** Descriptors */
-	struct intel_descriptor *desc;
-	/** Producer index */
-	unsigned int prod;
-	/** Consumer index */
-	unsigned int cons;
-
+	/** Descriptor ring */
+	struct dma_ring ring;
 	/** Register block */
 	unsigned int reg;
-	/** Length (in bytes) */
-	size_t len;
 };
 
 /**
@@ -223,7 +251,8 @@ struct intel_ring {
 static inline __attribute__ (( always_inline)) void
 intel_init_ring ( struct intel_ring *ring, unsigned int count,
 		  unsigned int reg ) {
-	ring->len = ( count * sizeof ( ring->desc[0] ) );
+	dma_ring_init ( &ring->ring, count,
+			sizeof ( struct intel_descriptor ) );
 	ring->reg = reg;
 }
 
@@ -245,8 +274,14 @@ struct intel_nic {
 	struct intel_ring tx;
 	/** Receive descriptor ring */
 	struct intel_ring rx;
+	/** Receive buffer length */
+	size_t rx_len;
+	/** Receive descriptor ring fill level */
+	unsigned int rx_fill;
+	/** Minimum number of receive descriptors to refill at once */
+	unsigned int rx_batch;
 	/** Receive I/O buffers */
-	struct io_buffer *rx_iobuf[INTEL_NUM_RX_DESC];
+	struct io_buffer *rx_iobuf[INTEL_MAX_RX_DESC];
 };
 
 #endif /* _INTEL_H */
@@ -32,20 +32,25 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/ib_pathrec.h>
 #include <ipxe/ib_mcast.h>
 #include <ipxe/ipoib.h>
+#include <config/general.h>
 
 /** @file
  *
  * IP over Infiniband
  */
 
-/** Number of IPoIB send work queue entries */
-#define IPOIB_NUM_SEND_WQES 2
+/** Number of IPoIB send work queue entries
+ *
+ * Some Infiniband devices (e.g. Linda) have only a small number of
+ * send buffers, which must be shared between all queue pairs.
+ */
+#define IPOIB_NUM_SEND_WQES 8
 
-/** Number of IPoIB receive work queue entries */
-#define IPOIB_NUM_RECV_WQES 4
+/** Minimum number of IPoIB receive work queue entries */
+#define IPOIB_MIN_RECV_WQES 4
 
-/** Number of IPoIB completion entries */
-#define IPOIB_NUM_CQES 8
+/** Maximum number of IPoIB receive work queue entries */
+#define IPOIB_MAX_RECV_WQES 64
 
 /** An IPoIB device */
 struct ipoib_device {
@@ -104,26 +109,48 @@ struct errortab ipoib_errors[] __errortab = {
  * netdevice driver.
  */
 struct ipoib_peer {
+	/** Next peer in hash chain */
+	struct ipoib_peer *next;
+	/** Time of last use */
+	unsigned long used;
 	/** Key */
 	uint8_t key;
 	/** MAC address */
 	struct ipoib_mac mac;
 };
 
-/** Number of IPoIB peer cache entries
- *
- * Must be a power of two.
- */
-#define IPOIB_NUM_CACHED_PEERS 4
+/** IPoIB peer cache entry validity flag */
+#define IPOIB_PEER_KEY_VALID 0x80
+
+/* Each cache entry must be representable by a single-byte key */
+#if ( IPOIB_PEER_CACHE < 1 ) || ( IPOIB_PEER_CACHE > IPOIB_PEER_KEY_VALID )
+#error "IPOIB_PEER_CACHE out of range"
+#endif
 
 /** IPoIB peer address cache */
-static struct ipoib_peer ipoib_peer_cache[IPOIB_NUM_CACHED_PEERS];
+static struct ipoib_peer ipoib_peer_cache[IPOIB_PEER_CACHE];
 
-/** Oldest IPoIB peer cache entry index */
-static unsigned int ipoib_peer_cache_idx = 0;
+/** IPoIB peer address cache hash chains */
+static struct ipoib_peer *ipoib_peer_hash[IPOIB_PEER_CACHE];
 
-/** IPoIB peer cache entry validity flag */
-#define IPOIB_PEER_KEY_VALID 0x80
+/** IPoIB peer cache usage counter */
+static unsigned long ipoib_peer_used;
+
+/**
+ * Calculate hash chain for peer MAC address
+ *
+ * @v mac		Peer MAC address
+ * @ret chain		Hash chain
+ */
+static struct ipoib_peer ** ipoib_peer_chain ( const struct ipoib_mac *mac ) {
+	uint32_t hash;
+
+	hash = ( mac->flags__qpn ^ mac->gid.dwords[0] ^ mac->gid.dwords[1] ^
+		 mac->gid.dwords[2] ^ mac->gid.dwords[3] );
+	hash ^= ( hash >> 16 );
+	hash ^= ( hash >> 8 );
+	return &ipoib_peer_hash[ hash % IPOIB_PEER_CACHE ];
+}
 
 /**
  * Look up cached peer by key
@@ -133,13 +160,14 @@ static unsigned int ipoib_peer_cache_idx = 0;
  */
 static struct ipoib_peer * ipoib_lookup_peer_by_key ( unsigned int key ) {
 	struct ipoib_peer *peer;
-	unsigned int i;
+	unsigned int index;
 
 	if ( ! key )
 		return NULL;
 
-	for ( i = 0 ; i < IPOIB_NUM_CACHED_PEERS ; i++ ) {
-		peer = &ipoib_peer_cache[i];
+	index = ( key & ~IPOIB_PEER_KEY_VALID );
+	if ( index < IPOIB_PEER_CACHE ) {
+		peer = &ipoib_peer_cache[index];
 		if ( peer->key == key )
 			return peer;
 	}
@@ -149,6 +177,36 @@ static struct ipoib_peer * ipoib_lookup_peer_by_key ( unsigned int key ) {
 	return NULL;
 }
 
+/**
+ * Evict least recently used peer cache entry
+ *
+ * @ret peer		Unused peer cache entry
+ */
+static struct ipoib_peer * ipoib_evict_peer ( void ) {
+	struct ipoib_peer *oldest = NULL;
+	struct ipoib_peer *peer;
+	struct ipoib_peer **chain;
+	unsigned int i;
+
+	/* Find an unused entry, or the least recently used entry */
+	for ( i = 0 ; i < IPOIB_PEER_CACHE ; i++ ) {
+		peer = &ipoib_peer_cache[i];
+		if ( ! peer->key )
+			return peer;
+		if ( ( ! oldest ) || ( ( ipoib_peer_used - peer->used ) >
+				       ( ipoib_peer_used - oldest->used ) ) )
+			oldest = peer;
+	}
+
+	/* Remove entry from its hash chain */
+	for ( chain = ipoib_peer_chain ( &oldest->mac ) ; *chain != oldest ;
+	      chain = &(*chain)->next ) {}
+	*chain = oldest->next;
+	DBG ( "IPoIB peer %x evicted from cache\n", oldest->key );
+
+	return oldest;
+}
+
 /**
  * Store GID and QPN in peer cache
  *
@@ -156,26 +214,25 @@ static struct ipoib_peer * ipoib_lookup_peer_by_key ( unsigned int key ) {
  * @ret peer		Peer cache entry
  */
 static struct ipoib_peer * ipoib_cache_peer ( const struct ipoib_mac *mac ) {
+	struct ipoib_peer **chain = ipoib_peer_chain ( mac );
 	struct ipoib_peer *peer;
-	uint8_t key;
-	unsigned int i;
 
 	/* Look for existing cache entry */
-	for ( i = 0 ; i < IPOIB_NUM_CACHED_PEERS ; i++ ) {
-		peer = &ipoib_peer_cache[i];
-		if ( memcmp ( &peer->mac, mac, sizeof ( peer->mac ) ) == 0 )
+	for ( peer = *chain ; peer ; peer = peer->next ) {
+		if ( memcmp ( &peer->mac, mac, sizeof ( peer->mac ) ) == 0 ) {
+			peer->used = ++ipoib_peer_used;
 			return peer;
+		}
 	}
 
 	/* No entry found: create a new one */
-	key = ( ipoib_peer_cache_idx++ | IPOIB_PEER_KEY_VALID );
-	peer = &ipoib_peer_cache[ key % IPOIB_NUM_CACHED_PEERS ];
-	if ( peer->key )
-		DBG ( "IPoIB peer %x evicted from cache\n", peer->key );
-
+	peer = ipoib_evict_peer();
 	memset ( peer, 0, sizeof ( *peer ) );
-	peer->key = key;
+	peer->key = ( ( peer - ipoib_peer_cache ) | IPOIB_PEER_KEY_VALID );
 	memcpy ( &peer->mac, mac, sizeof ( peer->mac ) );
+	peer->used = ++ipoib_peer_used;
+	peer->next = *chain;
+	*chain = peer;
 	DBG ( "IPoIB peer %x has MAC %s\n",
 	      peer->key, ipoib_ntoa ( &peer->mac ) );
 	return peer;
@@ -552,7 +609,7 @@ static void ipoib_poll ( struct net_device *netdev ) {
  * @v qp		Queue pair
  * @v membership	Multicast group membership
  * @v rc		Status code
- * @v mad		Response MAD (or NULL on error)
+ * @v mad		Response MAD (or NULL on error, or if already known)
  */
 void ipoib_join_complete ( struct ib_device *ibdev __unused,
 			   struct ib_queue_pair *qp __unused,
@@ -647,6 +704,7 @@ static int ipoib_open ( struct net_device *netdev ) {
 	struct ipoib_device *ipoib = netdev->priv;
 	struct ib_device *ibdev = ipoib->ibdev;
 	struct ipoib_mac *mac = ( ( struct ipoib_mac * ) netdev->ll_addr );
+	unsigned int num_recv_wqes;
 	int rc;
 
 	/* Open IB device */
@@ -656,8 +714,15 @@ static int ipoib_open ( struct net_device *netdev ) {
 		goto err_ib_open;
 	}
 
+	/* Choose receive work queue size */
+	num_recv_wqes = netdev_rx_ring_size ( netdev, IB_MAX_PAYLOAD_SIZE,
+					      IPOIB_MIN_RECV_WQES,
+					      IPOIB_MAX_RECV_WQES );
+
 	/* Allocate completion queue */
-	ipoib->cq = ib_create_cq ( ibdev, IPOIB_NUM_CQES, &ipoib_cq_op );
+	ipoib->cq = ib_create_cq ( ibdev, ( IPOIB_NUM_SEND_WQES +
+					    num_recv_wqes ),
+				   &ipoib_cq_op );
 	if ( ! ipoib->cq ) {
 		DBGC ( ipoib, "IPoIB %p could not allocate completion queue\n",
 		       ipoib );
@@ -668,7 +733,7 @@ static int ipoib_open ( struct net_device *netdev ) {
 	/* Allocate queue pair */
 	ipoib->qp = ib_create_qp ( ibdev, IB_QPT_UD,
 				   IPOIB_NUM_SEND_WQES, ipoib->cq,
-				   IPOIB_NUM_RECV_WQES, ipoib->cq );
+				   num_recv_wqes, ipoib->cq );
 	if ( ! ipoib->qp ) {
 		DBGC ( ipoib, "IPoIB %p could not allocate queue pair\n",
 		       ipoib );
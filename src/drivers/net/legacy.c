@@ -38,10 +38,28 @@ static int legacy_transmit ( struct net_device *netdev, struct io_buffer *iobuf
 	return 0;
 }
 
+static void legacy_check_link ( struct net_device *netdev ) {
+	struct nic *nic = netdev->priv;
+	int link_up;
+
+	/* Assume link is up if driver cannot report link state */
+	link_up = ( nic->nic_op->link ? nic->nic_op->link ( nic ) : 1 );
+
+	/* Report only changes in link state */
+	if ( link_up && ! netdev_link_ok ( netdev ) ) {
+		netdev_link_up ( netdev );
+	} else if ( ( ! link_up ) && netdev_link_ok ( netdev ) ) {
+		netdev_link_down ( netdev );
+	}
+}
+
 static void legacy_poll ( struct net_device *netdev ) {
 	struct nic *nic = netdev->priv;
 	struct io_buffer *iobuf;
 
+	if ( nic->nic_op->link )
+		legacy_check_link ( netdev );
+
 	iobuf = alloc_iob ( ETH_FRAME_LEN );
 	if ( ! iobuf )
 		return;
@@ -117,8 +135,10 @@ int legacy_probe ( void *hwdev,
 	if ( ( rc = register_netdev ( netdev ) ) != 0 )
 		goto err_register;
 
-	/* Mark as link up; legacy devices don't handle link state */
-	netdev_link_up ( netdev );
+	/* Set initial link state; most legacy devices don't handle
+	 * link state and so are marked as link up.
+	 */
+	legacy_check_link ( netdev );
 
 	/* Do not remove this message */
 	printf ( "WARNING: Using legacy NIC wrapper on %s\n",
@@ -30,17 +30,55 @@ FILE_LICENCE ( GPL2_OR_LATER );
  *
  */
 
+/**
+ * Check if MII interface already has a valid autonegotiated link
+ *
+ * @v mii		MII interface
+ * @ret has_link	MII interface has a valid autonegotiated link
+ */
+static int mii_has_link ( struct mii_interface *mii ) {
+	int bmcr;
+	int bmsr;
+
+	/* Read BMCR and BMSR.  The link status bit is latched low,
+	 * so read BMSR twice to obtain the current link status.
+	 */
+	bmcr = mii_read ( mii, MII_BMCR );
+	if ( bmcr < 0 )
+		return 0;
+	bmsr = mii_read ( mii, MII_BMSR );
+	bmsr = mii_read ( mii, MII_BMSR );
+	if ( bmsr < 0 )
+		return 0;
+
+	/* Check for a powered-up, autonegotiated link */
+	return ( ( bmcr & BMCR_ANENABLE ) &&
+		 ( ! ( bmcr & ( BMCR_PDOWN | BMCR_ISOLATE ) ) ) &&
+		 ( bmsr & BMSR_ANEGCOMPLETE ) && ( bmsr & BMSR_LSTATUS ) );
+}
+
 /**
  * Reset MII interface
  *
  * @v mii		MII interface
  * @ret rc		Return status code
+ *
+ * If the PHY already has a valid autonegotiated link (e.g. one
+ * established by the platform firmware or by a previous boot stage),
+ * then the reset is skipped, since resetting would restart
+ * autonegotiation and take the link down for several seconds.
  */
 int mii_reset ( struct mii_interface *mii ) {
 	unsigned int i;
 	int bmcr;
 	int rc;
 
+	/* Leave an existing valid link untouched */
+	if ( mii_has_link ( mii ) ) {
+		DBGC ( mii, "MII %p already has link; not resetting\n", mii );
+		return 0;
+	}
+
 	/* Power-up, enable autonegotiation and initiate reset */
 	if ( ( rc = mii_write ( mii, MII_BMCR,
 				( BMCR_RESET | BMCR_ANENABLE ) ) ) != 0 ) {
@@ -1933,12 +1933,13 @@ static int phantom_init_cmdpeg ( struct phantom_nic *phantom ) {
 	/* Wait for command PEG to finish initialising */
 	DBGC ( phantom, "Phantom %p initialising command PEG (will take up to "
 	       "%d seconds)...\n", phantom, PHN_CMDPEG_INIT_TIMEOUT_SEC );
-	for ( retries = 0; retries < PHN_CMDPEG_INIT_TIMEOUT_SEC; retries++ ) {
+	for ( retries = 0 ; retries < ( PHN_CMDPEG_INIT_TIMEOUT_SEC * 1000 ) ;
+	      retries++ ) {
 		cmdpeg_state = phantom_readl ( phantom,
 					       UNM_NIC_REG_CMDPEG_STATE );
 		if ( cmdpeg_state != last_cmdpeg_state ) {
 			DBGC ( phantom, "Phantom %p command PEG state is "
-			       "%08x after %d seconds...\n",
+			       "%08x after %dms...\n",
 			       phantom, cmdpeg_state, retries );
 			last_cmdpeg_state = cmdpeg_state;
 		}
@@ -1949,7 +1950,7 @@ static int phantom_init_cmdpeg ( struct phantom_nic *phantom ) {
 				       UNM_NIC_REG_CMDPEG_STATE );
 			return 0;
 		}
-		mdelay ( 1000 );
+		mdelay ( 1 );
 	}
 
 	DBGC ( phantom, "Phantom %p timed out waiting for command PEG to "
@@ -2027,18 +2028,19 @@ static int phantom_init_rcvpeg ( struct phantom_nic *phantom ) {
 
 	DBGC ( phantom, "Phantom %p initialising receive PEG (will take up to "
 	       "%d seconds)...\n", phantom, PHN_RCVPEG_INIT_TIMEOUT_SEC );
-	for ( retries = 0; retries < PHN_RCVPEG_INIT_TIMEOUT_SEC; retries++ ) {
+	for ( retries = 0 ; retries < ( PHN_RCVPEG_INIT_TIMEOUT_SEC * 1000 ) ;
+	      retries++ ) {
 		rcvpeg_state = phantom_readl ( phantom,
 					       UNM_NIC_REG_RCVPEG_STATE );
 		if ( rcvpeg_state != last_rcvpeg_state ) {
 			DBGC ( phantom, "Phantom %p receive PEG state is "
-			       "%08x after %d seconds...\n",
+			       "%08x after %dms...\n",
 			       phantom, rcvpeg_state, retries );
 			last_rcvpeg_state = rcvpeg_state;
 		}
 		if ( rcvpeg_state == UNM_NIC_REG_RCVPEG_STATE_INITIALIZED )
 			return 0;
-		mdelay ( 1000 );
+		mdelay ( 1 );
 	}
 
 	DBGC ( phantom, "Phantom %p timed out waiting for receive PEG to "
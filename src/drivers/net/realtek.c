@@ -461,7 +461,7 @@ static void realtek_refill_rx ( struct realtek_nic *rtl ) {
 	if ( rtl->legacy )
 		return;
 
-	while ( ( rtl->rx.prod - rtl->rx.cons ) < RTL_NUM_RX_DESC ) {
+	while ( ( rtl->rx.prod - rtl->rx.cons ) < rtl->rx.count ) {
 
 		/* Allocate I/O buffer */
 		iobuf = alloc_iob ( RTL_RX_MAX_LEN );
@@ -471,8 +471,8 @@ static void realtek_refill_rx ( struct realtek_nic *rtl ) {
 		}
 
 		/* Get next receive descriptor */
-		rx_idx = ( rtl->rx.prod++ % RTL_NUM_RX_DESC );
-		is_last = ( rx_idx == ( RTL_NUM_RX_DESC - 1 ) );
+		rx_idx = ( rtl->rx.prod++ % rtl->rx.count );
+		is_last = ( rx_idx == ( rtl->rx.count - 1 ) );
 		rx = &rtl->rx.desc[rx_idx];
 
 		/* Populate receive descriptor */
@@ -502,9 +502,15 @@ static void realtek_refill_rx ( struct realtek_nic *rtl ) {
  */
 static int realtek_open ( struct net_device *netdev ) {
 	struct realtek_nic *rtl = netdev->priv;
+	unsigned int rx_count;
 	uint32_t rcr;
 	int rc;
 
+	/* Choose receive descriptor ring size */
+	rx_count = netdev_rx_ring_size ( netdev, RTL_RX_MAX_LEN,
+					 RTL_MIN_RX_DESC, RTL_MAX_RX_DESC );
+	realtek_init_ring ( &rtl->rx, rx_count, RTL_RDSAR );
+
 	/* Create transmit descriptor ring */
 	if ( ( rc = realtek_create_ring ( rtl, &rtl->tx ) ) != 0 )
 		goto err_create_tx;
@@ -569,7 +575,7 @@ static void realtek_close ( struct net_device *netdev ) {
 	realtek_destroy_ring ( rtl, &rtl->rx );
 
 	/* Discard any unused receive buffers */
-	for ( i = 0 ; i < RTL_NUM_RX_DESC ; i++ ) {
+	for ( i = 0 ; i < rtl->rx.count ; i++ ) {
 		if ( rtl->rx_iobuf[i] )
 			free_iob ( rtl->rx_iobuf[i] );
 		rtl->rx_iobuf[i] = NULL;
@@ -586,8 +592,8 @@ static void realtek_close ( struct net_device *netdev ) {
  * @v iobuf		I/O buffer
  * @ret rc		Return status code
  */
-static int realtek_transmit ( struct net_device *netdev,
-			      struct io_buffer *iobuf ) {
+static int __hot realtek_transmit ( struct net_device *netdev,
+				    struct io_buffer *iobuf ) {
 	struct realtek_nic *rtl = netdev->priv;
 	struct realtek_descriptor *tx;
 	unsigned int tx_idx;
@@ -651,7 +657,7 @@ static int realtek_transmit ( struct net_device *netdev,
  *
  * @v netdev		Network device
  */
-static void realtek_poll_tx ( struct net_device *netdev ) {
+static void __hot realtek_poll_tx ( struct net_device *netdev ) {
 	struct realtek_nic *rtl = netdev->priv;
 	struct realtek_descriptor *tx;
 	unsigned int tx_idx;
@@ -744,7 +750,7 @@ static void realtek_legacy_poll_rx ( struct net_device *netdev ) {
  *
  * @v netdev		Network device
  */
-static void realtek_poll_rx ( struct net_device *netdev ) {
+static void __hot realtek_poll_rx ( struct net_device *netdev ) {
 	struct realtek_nic *rtl = netdev->priv;
 	struct realtek_descriptor *rx;
 	struct io_buffer *iobuf;
@@ -761,7 +767,7 @@ static void realtek_poll_rx ( struct net_device *netdev ) {
 	while ( rtl->rx.cons != rtl->rx.prod ) {
 
 		/* Get next receive descriptor */
-		rx_idx = ( rtl->rx.cons % RTL_NUM_RX_DESC );
+		rx_idx = ( rtl->rx.cons % rtl->rx.count );
 		rx = &rtl->rx.desc[rx_idx];
 
 		/* Stop if descriptor is still in use */
@@ -792,7 +798,7 @@ static void realtek_poll_rx ( struct net_device *netdev ) {
  *
  * @v netdev		Network device
  */
-static void realtek_poll ( struct net_device *netdev ) {
+static void __hot realtek_poll ( struct net_device *netdev ) {
 	struct realtek_nic *rtl = netdev->priv;
 	uint16_t isr;
 
@@ -802,6 +808,10 @@ static void realtek_poll ( struct net_device *netdev ) {
 		return;
 	writew ( isr, rtl->regs + RTL_ISR );
 
+	/* Report receive overruns, if applicable */
+	if ( isr & ( RTL_IRQ_RDU | RTL_IRQ_FOVW ) )
+		netdev_rx_err ( netdev, NULL, -ENOBUFS );
+
 	/* Poll for TX completions, if applicable */
 	if ( isr & ( RTL_IRQ_TER | RTL_IRQ_TOK ) )
 		realtek_poll_tx ( netdev );
@@ -919,7 +929,6 @@ static int realtek_probe ( struct pci_device *pci ) {
 	netdev->dev = &pci->dev;
 	memset ( rtl, 0, sizeof ( *rtl ) );
 	realtek_init_ring ( &rtl->tx, RTL_NUM_TX_DESC, RTL_TNPDS );
-	realtek_init_ring ( &rtl->rx, RTL_NUM_RX_DESC, RTL_RDSAR );
 
 	/* Fix up PCI device */
 	adjust_pci_device ( pci );
@@ -123,7 +123,9 @@ enum realtek_legacy_status {
 
 /** Interrupt Mask Register (word) */
 #define RTL_IMR 0x3c
+#define RTL_IRQ_FOVW		0x0040	/**< Receive FIFO overflow */
 #define RTL_IRQ_PUN_LINKCHG	0x0020	/**< Packet underrun / link change */
+#define RTL_IRQ_RDU		0x0010	/**< Receive buffer unavailable */
 #define RTL_IRQ_TER		0x0008	/**< Transmit error */
 #define RTL_IRQ_TOK		0x0004	/**< Transmit OK */
 #define RTL_IRQ_RER		0x0002	/**< Receive error */
@@ -203,8 +205,11 @@ enum realtek_legacy_status {
 /** Receive Descriptor Start Address Register (qword) */
 #define RTL_RDSAR 0xe4
 
-/** Number of receive descriptors */
-#define RTL_NUM_RX_DESC 4
+/** Minimum number of receive descriptors */
+#define RTL_MIN_RX_DESC 4
+
+/** Maximum number of receive descriptors */
+#define RTL_MAX_RX_DESC 256
 
 /** Receive buffer length */
 #define RTL_RX_MAX_LEN ( ETH_FRAME_LEN + 4 /* VLAN */ + 4 /* CRC */ )
@@ -218,6 +223,9 @@ struct realtek_ring {
 	/** Consumer index */
 	unsigned int cons;
 
+	/** Number of descriptors */
+	unsigned int count;
+
 	/** Descriptor start address register */
 	unsigned int reg;
 	/** Length (in bytes) */
@@ -234,6 +242,7 @@ struct realtek_ring {
 static inline __attribute__ (( always_inline)) void
 realtek_init_ring ( struct realtek_ring *ring, unsigned int count,
 		    unsigned int reg ) {
+	ring->count = count;
 	ring->len = ( count * sizeof ( ring->desc[0] ) );
 	ring->reg = reg;
 }
@@ -263,7 +272,7 @@ struct realtek_nic {
 	/** Receive descriptor ring */
 	struct realtek_ring rx;
 	/** Receive I/O buffers */
-	struct io_buffer *rx_iobuf[RTL_NUM_RX_DESC];
+	struct io_buffer *rx_iobuf[RTL_MAX_RX_DESC];
 	/** Receive buffer (legacy mode) */
 	void *rx_buffer;
 	/** Offset within receive buffer (legacy mode) */
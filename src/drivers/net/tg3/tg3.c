@@ -457,6 +457,10 @@ static void tg3_rx_complete(struct net_device *dev)
 			len = ((desc->idx_len & RXD_LEN_MASK) >> RXD_LEN_SHIFT) -
 			        ETH_FCS_LEN;
 			iob_put(iob, len);
+			if ((desc->type_flags & RXD_FLAG_TCPUDP_CSUM) &&
+			    (((desc->ip_tcp_csum & RXD_TCPCSUM_MASK)
+			      >> RXD_TCPCSUM_SHIFT) == 0xffff))
+				iob->flags |= IOB_CSUM_VERIFIED;
 			netdev_rx(dev, iob);
 
 			DBGC2(dev, "Received packet: %d bytes %d %d\n", len, sw_idx, hw_idx);
@@ -781,6 +785,10 @@ static int tg3_init_one(struct pci_device *pdev)
 
 	tg3_init_bufmgr_config(tp);
 
+	/* 5700 B0 chips have broken receive checksums */
+	if (tp->pci_chip_rev_id != CHIPREV_ID_5700_B0)
+		dev->state |= NETDEV_RX_CSUM;
+
 	err = tg3_get_device_address(tp);
 	if (err) {
 		DBGC(&pdev->dev, "Could not obtain valid ethernet address, aborting\n");
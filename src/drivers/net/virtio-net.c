@@ -24,6 +24,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 
 #include <errno.h>
 #include <stdlib.h>
+#include <string.h>
 #include <ipxe/list.h>
 #include <ipxe/iobuf.h>
 #include <ipxe/netdevice.h>
@@ -77,11 +78,17 @@ enum {
 };
 
 enum {
-	/** Max number of pending rx packets */
+	/** Min number of pending rx packets */
 	NUM_RX_BUF = 8,
 
-	/** Max Ethernet frame length, including FCS and VLAN tag */
+	/** Min rx buffer length: max Ethernet frame, FCS and VLAN tag */
 	RX_BUF_SIZE = 1522,
+
+	/** Max number of fragments per tx packet */
+	MAX_TX_FRAGS = 4,
+
+	/** Max rx packet length with large receive offload */
+	LRO_PKT_LEN = ( ETH_HLEN + 4 /* VLAN */ + 0xffff ),
 };
 
 struct virtnet_nic {
@@ -97,8 +104,17 @@ struct virtnet_nic {
 	/** Pending rx packet count */
 	unsigned int rx_num_iobufs;
 
-	/** Virtio net packet header, we only need one */
-	struct virtio_net_hdr empty_header;
+	/** Max number of pending rx packets */
+	unsigned int rx_max_iobufs;
+
+	/** Length of virtio net packet header */
+	size_t hdr_len;
+
+	/** Length of each rx buffer, excluding virtio net header */
+	size_t rx_buf_len;
+
+	/** Virtio net packet header, shared between all tx packets */
+	struct virtio_net_hdr_mrg_rxbuf empty_header;
 };
 
 /** Add an iobuf to a virtqueue
@@ -106,36 +122,55 @@ struct virtnet_nic {
  * @v netdev		Network device
  * @v vq_idx		Virtqueue index (RX_INDEX or TX_INDEX)
  * @v iobuf		I/O buffer
+ * @v num_added		Number of iobufs added since the last kick
  *
- * The virtqueue is kicked after the iobuf has been added.
+ * The virtqueue is not kicked; the caller must call vring_kick() once
+ * all iobufs have been added.
  */
 static void virtnet_enqueue_iob ( struct net_device *netdev,
-				  int vq_idx, struct io_buffer *iobuf ) {
+				  int vq_idx, struct io_buffer *iobuf,
+				  int num_added ) {
 	struct virtnet_nic *virtnet = netdev->priv;
 	struct vring_virtqueue *vq = &virtnet->virtqueue[vq_idx];
-	unsigned int out = ( vq_idx == TX_INDEX ) ? 2 : 0;
-	unsigned int in = ( vq_idx == TX_INDEX ) ? 0 : 2;
-	struct vring_list list[] = {
-		{
-			/* Share a single zeroed virtio net header between all
-			 * rx and tx packets.  This works because this driver
-			 * does not use any advanced features so none of the
-			 * header fields get used.
-			 */
-			.addr = ( char* ) &virtnet->empty_header,
-			.length = sizeof ( virtnet->empty_header ),
-		},
-		{
-			.addr = ( char* ) iobuf->data,
-			.length = iob_len ( iobuf ),
-		},
-	};
+	struct vring_list list[ 1 + MAX_TX_FRAGS ];
+	struct io_buffer *frag;
+	unsigned int count;
+
+	if ( vq_idx == TX_INDEX ) {
+		/* Share a single zeroed virtio net header between all
+		 * tx packets.  This works because this driver does not
+		 * use any transmit offload features so none of the
+		 * header fields get used.  Each fragment of the packet
+		 * occupies a further descriptor.
+		 */
+		list[0].addr = ( char * ) &virtnet->empty_header;
+		list[0].length = virtnet->hdr_len;
+		count = 1;
+		for ( frag = iobuf ; frag ; frag = frag->frag ) {
+			assert ( count < ( sizeof ( list ) /
+					   sizeof ( list[0] ) ) );
+			list[count].addr = frag->data;
+			list[count].length = iob_len ( frag );
+			count++;
+		}
+	} else {
+		/* Each rx packet receives its own header at the start
+		 * of the I/O buffer, since the checksum flags are
+		 * per-packet.
+		 */
+		list[0].addr = iobuf->data;
+		list[0].length = virtnet->hdr_len;
+		list[1].addr = ( ( char * ) iobuf->data + virtnet->hdr_len );
+		list[1].length = ( iob_len ( iobuf ) - virtnet->hdr_len );
+		count = 2;
+	}
 
 	DBGC ( virtnet, "VIRTIO-NET %p enqueuing iobuf %p on vq %d\n",
 	       virtnet, iobuf, vq_idx );
 
-	vring_add_buf ( vq, list, out, in, iobuf, 0 );
-	vring_kick ( virtnet->ioaddr, vq, 1 );
+	vring_add_buf ( vq, list, ( ( vq_idx == TX_INDEX ) ? count : 0 ),
+			( ( vq_idx == TX_INDEX ) ? 0 : count ), iobuf,
+			num_added );
 }
 
 /** Try to keep rx virtqueue filled with iobufs
@@ -144,12 +179,14 @@ static void virtnet_enqueue_iob ( struct net_device *netdev,
  */
 static void virtnet_refill_rx_virtqueue ( struct net_device *netdev ) {
 	struct virtnet_nic *virtnet = netdev->priv;
+	struct vring_virtqueue *rx_vq = &virtnet->virtqueue[RX_INDEX];
+	int num_added = 0;
 
-	while ( virtnet->rx_num_iobufs < NUM_RX_BUF ) {
+	while ( virtnet->rx_num_iobufs < virtnet->rx_max_iobufs ) {
 		struct io_buffer *iobuf;
 
 		/* Try to allocate a buffer, stop for now if out of memory */
-		iobuf = alloc_iob ( RX_BUF_SIZE );
+		iobuf = alloc_iob ( virtnet->hdr_len + virtnet->rx_buf_len );
 		if ( ! iobuf )
 			break;
 
@@ -157,11 +194,15 @@ static void virtnet_refill_rx_virtqueue ( struct net_device *netdev ) {
 		list_add ( &iobuf->list, &virtnet->rx_iobufs );
 
 		/* Mark packet length until we know the actual size */
-		iob_put ( iobuf, RX_BUF_SIZE );
+		iob_put ( iobuf, ( virtnet->hdr_len + virtnet->rx_buf_len ) );
 
-		virtnet_enqueue_iob ( netdev, RX_INDEX, iobuf );
+		virtnet_enqueue_iob ( netdev, RX_INDEX, iobuf, num_added++ );
 		virtnet->rx_num_iobufs++;
 	}
+
+	/* Notify the device once for the whole batch */
+	if ( num_added )
+		vring_kick ( virtnet->ioaddr, rx_vq, num_added );
 }
 
 /** Open network device
@@ -172,12 +213,44 @@ static void virtnet_refill_rx_virtqueue ( struct net_device *netdev ) {
 static int virtnet_open ( struct net_device *netdev ) {
 	struct virtnet_nic *virtnet = netdev->priv;
 	unsigned long ioaddr = virtnet->ioaddr;
+	unsigned int rx_min;
+	unsigned int rx_max;
+	unsigned int rx_lro;
+	size_t rx_len;
 	u32 features;
+	u32 lro_features;
 	int i;
 
 	/* Reset for sanity */
 	vp_reset ( ioaddr );
 
+	/* Choose features.  The header length must be known before
+	 * any rx buffers are posted.  Large receive offload is used
+	 * only if the host can spread large packets across several
+	 * rx buffers, and requires receive checksum offload.
+	 */
+	features = vp_get_features ( ioaddr );
+	features &= ( ( 1 << VIRTIO_NET_F_MAC ) |
+		      ( 1 << VIRTIO_NET_F_GUEST_CSUM ) |
+		      ( 1 << VIRTIO_NET_F_GUEST_TSO4 ) |
+		      ( 1 << VIRTIO_NET_F_MRG_RXBUF ) |
+		      ( 1 << VIRTIO_RING_F_EVENT_IDX ) );
+	lro_features = ( ( 1 << VIRTIO_NET_F_GUEST_CSUM ) |
+			 ( 1 << VIRTIO_NET_F_MRG_RXBUF ) );
+	if ( ( features & lro_features ) != lro_features )
+		features &= ~( 1 << VIRTIO_NET_F_GUEST_TSO4 );
+	virtnet->hdr_len = ( ( features & ( 1 << VIRTIO_NET_F_MRG_RXBUF ) ) ?
+			     sizeof ( struct virtio_net_hdr_mrg_rxbuf ) :
+			     sizeof ( struct virtio_net_hdr ) );
+
+	/* Size rx buffers to hold a complete frame, unless the host
+	 * is able to spread large frames across several buffers.
+	 */
+	virtnet->rx_buf_len = ( netdev_rx_frame_len ( netdev ) + 4 /* VLAN */ );
+	if ( ( features & ( 1 << VIRTIO_NET_F_MRG_RXBUF ) ) ||
+	     ( virtnet->rx_buf_len < RX_BUF_SIZE ) )
+		virtnet->rx_buf_len = RX_BUF_SIZE;
+
 	/* Allocate virtqueues */
 	virtnet->virtqueue = zalloc ( QUEUE_NB *
 				      sizeof ( *virtnet->virtqueue ) );
@@ -193,19 +266,41 @@ static int virtnet_open ( struct net_device *netdev ) {
 			virtnet->virtqueue = NULL;
 			return -ENOENT;
 		}
+		virtnet->virtqueue[i].event =
+			( features & ( 1 << VIRTIO_RING_F_EVENT_IDX ) );
 	}
 
-	/* Initialize rx packets */
+	/* Initialize rx packets.  Each rx packet uses two descriptors.
+	 * Large receive offload requires enough rx buffers to be kept
+	 * posted to hold a maximum-sized packet.
+	 */
 	INIT_LIST_HEAD ( &virtnet->rx_iobufs );
 	virtnet->rx_num_iobufs = 0;
+	rx_len = ( virtnet->hdr_len + virtnet->rx_buf_len );
+	rx_min = NUM_RX_BUF;
+	rx_max = ( virtnet->virtqueue[RX_INDEX].vring.num / 2 );
+	if ( features & ( 1 << VIRTIO_NET_F_GUEST_TSO4 ) ) {
+		rx_lro = ( ( virtnet->hdr_len + LRO_PKT_LEN + rx_len - 1 ) /
+			   rx_len );
+		if ( rx_lro > rx_max ) {
+			features &= ~( 1 << VIRTIO_NET_F_GUEST_TSO4 );
+		} else if ( rx_lro > rx_min ) {
+			rx_min = rx_lro;
+		}
+	}
+	virtnet->rx_max_iobufs = netdev_rx_ring_size ( netdev, rx_len,
+						       rx_min, rx_max );
+
+	/* Negotiate features */
+	vp_set_features ( ioaddr, features );
+	DBGC ( virtnet, "VIRTIO-NET %p features %#08x\n", virtnet, features );
+
 	virtnet_refill_rx_virtqueue ( netdev );
 
 	/* Disable interrupts before starting */
 	netdev_irq ( netdev, 0 );
 
 	/* Driver is ready */
-	features = vp_get_features ( ioaddr );
-	vp_set_features ( ioaddr, features & ( 1 << VIRTIO_NET_F_MAC ) );
 	vp_set_status ( ioaddr, VIRTIO_CONFIG_S_DRIVER | VIRTIO_CONFIG_S_DRIVER_OK );
 	return 0;
 }
@@ -239,9 +334,12 @@ static void virtnet_close ( struct net_device *netdev ) {
  * @v iobuf	I/O buffer
  * @ret rc	Return status code
  */
-static int virtnet_transmit ( struct net_device *netdev,
-			      struct io_buffer *iobuf ) {
-	virtnet_enqueue_iob ( netdev, TX_INDEX, iobuf );
+static int __hot virtnet_transmit ( struct net_device *netdev,
+				    struct io_buffer *iobuf ) {
+	struct virtnet_nic *virtnet = netdev->priv;
+
+	virtnet_enqueue_iob ( netdev, TX_INDEX, iobuf, 0 );
+	vring_kick ( virtnet->ioaddr, &virtnet->virtqueue[TX_INDEX], 1 );
 	return 0;
 }
 
@@ -263,6 +361,63 @@ static void virtnet_process_tx_packets ( struct net_device *netdev ) {
 	}
 }
 
+/** Reassemble a packet spread across mergeable rx buffers
+ *
+ * @v netdev		Network device
+ * @v iobuf		First I/O buffer, with virtio net header stripped
+ * @v num_buffers	Number of rx buffers used by the packet
+ * @ret iobuf		Reassembled I/O buffer, or NULL on error
+ *
+ * The host publishes all buffers belonging to a packet with a single
+ * update of the used ring index, so the remaining buffers are always
+ * available by the time the first one has been seen.
+ */
+static struct io_buffer * virtnet_merge_rx ( struct net_device *netdev,
+					     struct io_buffer *iobuf,
+					     unsigned int num_buffers ) {
+	struct virtnet_nic *virtnet = netdev->priv;
+	struct vring_virtqueue *rx_vq = &virtnet->virtqueue[RX_INDEX];
+	struct io_buffer *merged;
+	struct io_buffer *frag;
+	unsigned int len;
+
+	/* Allocate buffer large enough for all fragments */
+	merged = alloc_iob ( num_buffers * virtnet->rx_buf_len +
+			     ( num_buffers - 1 ) * virtnet->hdr_len );
+	if ( merged ) {
+		memcpy ( iob_put ( merged, iob_len ( iobuf ) ), iobuf->data,
+			 iob_len ( iobuf ) );
+		merged->flags = iobuf->flags;
+	}
+	free_iob ( iobuf );
+
+	/* Gather remaining fragments, consuming them even if the
+	 * packet is to be discarded.  The continuation buffers carry
+	 * no virtio net header of their own.
+	 */
+	while ( --num_buffers ) {
+		if ( ! vring_more_used ( rx_vq ) ) {
+			DBGC ( virtnet, "VIRTIO-NET %p missing merged rx "
+			       "buffer\n", virtnet );
+			free_iob ( merged );
+			netdev_rx_err ( netdev, NULL, -EPROTO );
+			return NULL;
+		}
+		frag = vring_get_buf ( rx_vq, &len );
+		list_del ( &frag->list );
+		virtnet->rx_num_iobufs--;
+		if ( merged )
+			memcpy ( iob_put ( merged, len ), frag->data, len );
+		free_iob ( frag );
+	}
+
+	if ( ! merged ) {
+		netdev_rx_err ( netdev, NULL, -ENOMEM );
+		return NULL;
+	}
+	return merged;
+}
+
 /** Complete packet reception
  *
  * @v netdev	Network device
@@ -274,14 +429,37 @@ static void virtnet_process_rx_packets ( struct net_device *netdev ) {
 	while ( vring_more_used ( rx_vq ) ) {
 		unsigned int len;
 		struct io_buffer *iobuf = vring_get_buf ( rx_vq, &len );
+		struct virtio_net_hdr_mrg_rxbuf *header;
+		unsigned int num_buffers;
 
 		/* Release ownership of iobuf */
 		list_del ( &iobuf->list );
 		virtnet->rx_num_iobufs--;
 
 		/* Update iobuf length */
-		iob_unput ( iobuf, RX_BUF_SIZE );
-		iob_put ( iobuf, len - sizeof ( struct virtio_net_hdr ) );
+		iob_unput ( iobuf, iob_len ( iobuf ) );
+		iob_put ( iobuf, len );
+
+		/* Strip virtio net header.  A packet with a partial
+		 * checksum originated within the host and its contents
+		 * have therefore not been exposed to any transmission
+		 * errors.
+		 */
+		header = iobuf->data;
+		if ( header->hdr.flags & ( VIRTIO_NET_HDR_F_NEEDS_CSUM |
+					   VIRTIO_NET_HDR_F_DATA_VALID ) ) {
+			iobuf->flags |= IOB_CSUM_VERIFIED;
+		}
+		num_buffers = ( ( virtnet->hdr_len == sizeof ( *header ) ) ?
+				header->num_buffers : 1 );
+		iob_pull ( iobuf, virtnet->hdr_len );
+
+		/* Reassemble packets spanning several rx buffers */
+		if ( num_buffers > 1 ) {
+			iobuf = virtnet_merge_rx ( netdev, iobuf, num_buffers );
+			if ( ! iobuf )
+				continue;
+		}
 
 		DBGC ( virtnet, "VIRTIO-NET %p rx complete iobuf %p len %zd\n",
 		       virtnet, iobuf, iob_len ( iobuf ) );
@@ -297,7 +475,7 @@ static void virtnet_process_rx_packets ( struct net_device *netdev ) {
  *
  * @v netdev	Network device
  */
-static void virtnet_poll ( struct net_device *netdev ) {
+static void __hot virtnet_poll ( struct net_device *netdev ) {
 	struct virtnet_nic *virtnet = netdev->priv;
 
 	/* Acknowledge interrupt.  This is necessary for UNDI operation and
@@ -360,6 +538,8 @@ static int virtnet_probe ( struct pci_device *pci ) {
 	virtnet->ioaddr = ioaddr;
 	pci_set_drvdata ( pci, netdev );
 	netdev->dev = &pci->dev;
+	netdev->max_pkt_len = ETH_JUMBO_FRAME_LEN;
+	netdev->max_tx_frags = MAX_TX_FRAGS;
 
 	DBGC ( virtnet, "VIRTIO-NET %p busaddr=%s ioaddr=%#lx irq=%d\n",
 	       virtnet, pci->dev.name, ioaddr, pci->irq );
@@ -377,6 +557,10 @@ static int virtnet_probe ( struct pci_device *pci ) {
 		       eth_ntoa ( netdev->hw_addr ) );
 	}
 
+	/* Record checksum offload capability */
+	if ( features & ( 1 << VIRTIO_NET_F_GUEST_CSUM ) )
+		netdev->state |= NETDEV_RX_CSUM;
+
 	/* Register network device */
 	if ( ( rc = register_netdev ( netdev ) ) != 0 )
 		goto err_register_netdev;
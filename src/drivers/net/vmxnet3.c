@@ -53,6 +53,24 @@ static inline uint32_t vmxnet3_command ( struct vmxnet3_nic *vmxnet,
 	return readl ( vmxnet->vd + VMXNET3_VD_CMD );
 }
 
+/**
+ * Notify device of new transmit descriptors
+ *
+ * @v vmxnet		vmxnet3 NIC
+ */
+static void vmxnet3_notify_tx ( struct vmxnet3_nic *vmxnet ) {
+
+	/* Do nothing unless there are new descriptors */
+	if ( vmxnet->count.tx_notified == vmxnet->count.tx_prod )
+		return;
+
+	/* Hand over descriptors to NIC */
+	wmb();
+	writel ( ( vmxnet->count.tx_prod % VMXNET3_NUM_TX_DESC ),
+		 ( vmxnet->pt + VMXNET3_PT_TXPROD ) );
+	vmxnet->count.tx_notified = vmxnet->count.tx_prod;
+}
+
 /**
  * Transmit packet
  *
@@ -89,10 +107,11 @@ static int vmxnet3_transmit ( struct net_device *netdev,
 	tx_desc->flags[0] = ( generation | cpu_to_le32 ( iob_len ( iobuf ) ) );
 	tx_desc->flags[1] = cpu_to_le32 ( VMXNET3_TXF_CQ | VMXNET3_TXF_EOP );
 
-	/* Hand over descriptor to NIC */
-	wmb();
-	writel ( ( vmxnet->count.tx_prod % VMXNET3_NUM_TX_DESC ),
-		 ( vmxnet->pt + VMXNET3_PT_TXPROD ) );
+	/* Hand over descriptors to NIC, if enough are outstanding */
+	if ( ( vmxnet->count.tx_prod - vmxnet->count.tx_notified ) >=
+	     VMXNET3_TX_BATCH ) {
+		vmxnet3_notify_tx ( vmxnet );
+	}
 
 	return 0;
 }
@@ -164,10 +183,26 @@ static void vmxnet3_flush_tx ( struct net_device *netdev ) {
 	}
 }
 
+/**
+ * Notify device of new receive descriptors
+ *
+ * @v vmxnet		vmxnet3 NIC
+ */
+static void vmxnet3_notify_rx ( struct vmxnet3_nic *vmxnet ) {
+
+	wmb();
+	writel ( ( vmxnet->count.rx_prod % VMXNET3_NUM_RX_DESC ),
+		 ( vmxnet->pt + VMXNET3_PT_RXPROD ) );
+}
+
 /**
  * Refill receive ring
  *
  * @v netdev		Network device
+ *
+ * The device picks up new receive descriptors via their generation
+ * flags, and requests an explicit (and expensive) RXPROD update only
+ * when it has run out of descriptors.
  */
 static void vmxnet3_refill_rx ( struct net_device *netdev ) {
 	struct vmxnet3_nic *vmxnet = netdev_priv ( netdev );
@@ -208,11 +243,10 @@ static void vmxnet3_refill_rx ( struct net_device *netdev ) {
 
 	}
 
-	/* Hand over any new descriptors to NIC */
-	if ( vmxnet->count.rx_prod != orig_rx_prod ) {
-		wmb();
-		writel ( ( vmxnet->count.rx_prod % VMXNET3_NUM_RX_DESC ),
-			 ( vmxnet->pt + VMXNET3_PT_RXPROD ) );
+	/* Hand over any new descriptors to NIC, if requested */
+	if ( ( vmxnet->count.rx_prod != orig_rx_prod ) &&
+	     vmxnet->dma->queues.rx.ctrl.update_prod ) {
+		vmxnet3_notify_rx ( vmxnet );
 	}
 }
 
@@ -228,6 +262,7 @@ static void vmxnet3_poll_rx ( struct net_device *netdev ) {
 	unsigned int comp_idx;
 	unsigned int desc_idx;
 	unsigned int generation;
+	uint32_t flags;
 	size_t len;
 
 	while ( 1 ) {
@@ -266,6 +301,12 @@ static void vmxnet3_poll_rx ( struct net_device *netdev ) {
 		DBGC2 ( vmxnet, "VMXNET3 %p completed RX %#x/%#x (len %#zx)\n",
 			vmxnet, comp_idx, desc_idx, len );
 		iob_put ( iobuf, len );
+		flags = le32_to_cpu ( rx_comp->flags );
+		if ( ( flags & VMXNET3_RXCF_TUC ) &&
+		     ( flags & ( VMXNET3_RXCF_TCP | VMXNET3_RXCF_UDP ) ) &&
+		     ! ( flags & VMXNET3_RXCF_FRG ) ) {
+			iobuf->flags |= IOB_CSUM_VERIFIED;
+		}
 		netdev_rx ( netdev, iobuf );
 	}
 }
@@ -368,7 +409,9 @@ static void vmxnet3_poll_events ( struct net_device *netdev ) {
  * @v netdev		Network device
  */
 static void vmxnet3_poll ( struct net_device *netdev ) {
+	struct vmxnet3_nic *vmxnet = netdev_priv ( netdev );
 
+	vmxnet3_notify_tx ( vmxnet );
 	vmxnet3_poll_events ( netdev );
 	vmxnet3_poll_tx ( netdev );
 	vmxnet3_poll_rx ( netdev );
@@ -457,6 +500,7 @@ static int vmxnet3_open ( struct net_device *netdev ) {
 	shared->misc.version_support = cpu_to_le32 ( VMXNET3_VERSION_SELECT );
 	shared->misc.upt_version_support =
 		cpu_to_le32 ( VMXNET3_UPT_VERSION_SELECT );
+	shared->misc.upt_features = cpu_to_le64 ( VMXNET3_UPT_F_RXCSUM );
 	shared->misc.queue_desc_address = cpu_to_le64 ( queues_bus );
 	shared->misc.queue_desc_len = cpu_to_le32 ( sizeof ( *queues ) );
 	shared->misc.mtu = cpu_to_le32 ( VMXNET3_MTU );
@@ -490,8 +534,9 @@ static int vmxnet3_open ( struct net_device *netdev ) {
 		goto err_activate;
 	}
 
-	/* Fill receive ring */
+	/* Fill receive ring and notify device of initial descriptors */
 	vmxnet3_refill_rx ( netdev );
+	vmxnet3_notify_rx ( vmxnet );
 
 	return 0;
 
@@ -593,6 +638,7 @@ static int vmxnet3_probe ( struct pci_device *pci ) {
 	vmxnet = netdev_priv ( netdev );
 	pci_set_drvdata ( pci, netdev );
 	netdev->dev = &pci->dev;
+	netdev->state |= NETDEV_RX_CSUM;
 	memset ( vmxnet, 0, sizeof ( *vmxnet ) );
 
 	/* Fix up PCI device */
@@ -331,6 +331,18 @@ struct vmxnet3_rx_comp {
 	uint32_t flags;
 } __attribute__ (( packed ));
 
+/** Receive completion TCP/UDP checksum correct flag */
+#define VMXNET3_RXCF_TUC 0x00010000UL
+
+/** Receive completion UDP packet flag */
+#define VMXNET3_RXCF_UDP 0x00020000UL
+
+/** Receive completion TCP packet flag */
+#define VMXNET3_RXCF_TCP 0x00040000UL
+
+/** Receive completion IP fragment flag */
+#define VMXNET3_RXCF_FRG 0x00400000UL
+
 /** Receive completion generation flag */
 #define VMXNET3_RXCF_GEN 0x80000000UL
 
@@ -419,10 +431,10 @@ struct vmxnet3_queues {
 #define VMXNET3_NUM_TX_COMP 32
 
 /** Number of RX descriptors */
-#define VMXNET3_NUM_RX_DESC 32
+#define VMXNET3_NUM_RX_DESC 64
 
 /** Number of RX completion descriptors */
-#define VMXNET3_NUM_RX_COMP 32
+#define VMXNET3_NUM_RX_COMP 64
 
 /**
  * DMA areas
@@ -452,6 +464,8 @@ struct vmxnet3_dma {
 struct vmxnet3_counters {
 	/** Transmit producer counter */
 	unsigned int tx_prod;
+	/** Transmit producer counter as last notified to device */
+	unsigned int tx_notified;
 	/** Transmit completion consumer counter */
 	unsigned int tx_cons;
 	/** Receive producer counter */
@@ -485,11 +499,22 @@ struct vmxnet3_nic {
 /** UPT version that we support */
 #define VMXNET3_UPT_VERSION_SELECT 1
 
+/** UPT receive checksum offload feature */
+#define VMXNET3_UPT_F_RXCSUM 0x0001ULL
+
 /** MTU size */
 #define VMXNET3_MTU ( ETH_FRAME_LEN + 4 /* VLAN */ + 4 /* FCS */ )
 
 /** Receive ring maximum fill level */
-#define VMXNET3_RX_FILL 8
+#define VMXNET3_RX_FILL 32
+
+/** Maximum number of transmit descriptors to defer notifying
+ *
+ * Each write to the TXPROD register causes a VM exit.  Notification
+ * of new transmit descriptors is deferred until this many are
+ * outstanding or until the device is next polled.
+ */
+#define VMXNET3_TX_BATCH 8
 
 /** Received packet alignment padding */
 #define NET_IP_ALIGN 2
@@ -102,6 +102,12 @@ static int nvs_vpd_write ( struct nvs_device *nvs, unsigned int field,
 	size_t max_len;
 	int rc;
 
+	/* Allow writing non-existent field (which may have just been
+	 * removed via nvs_vpd_resize())
+	 */
+	if ( len == 0 )
+		goto flush;
+
 	/* Locate VPD field */
 	if ( ( rc = pci_vpd_find ( &nvsvpd->vpd, field, &address,
 				   &max_len ) ) != 0 ) {
@@ -130,6 +136,17 @@ static int nvs_vpd_write ( struct nvs_device *nvs, unsigned int field,
 		return rc;
 	}
 
+ flush:
+	/* Write back any changes (including those made by a preceding
+	 * nvs_vpd_resize()) to the hardware.
+	 */
+	if ( ( rc = pci_vpd_flush ( &nvsvpd->vpd ) ) != 0 ) {
+		DBGC ( pci, PCI_FMT " NVS VPD could not write back field "
+		       PCI_VPD_FIELD_FMT ": %s\n", PCI_ARGS ( pci ),
+		       PCI_VPD_FIELD_ARGS ( field ), strerror ( rc ) );
+		return rc;
+	}
+
 	return 0;
 }
 
@@ -180,6 +197,12 @@ int nvs_vpd_init ( struct nvs_vpd_device *nvsvpd, struct pci_device *pci ) {
 		return rc;
 	}
 
+	/* Defer VPD writes until the whole options block is saved,
+	 * so that the field resizing and options data writes
+	 * performed by nvo_store() are combined.
+	 */
+	nvsvpd->vpd.writeback = 1;
+
 	/* Initialise NVS device */
 	nvsvpd->nvs.read = nvs_vpd_read;
 	nvsvpd->nvs.write = nvs_vpd_write;
@@ -187,6 +210,16 @@ int nvs_vpd_init ( struct nvs_vpd_device *nvsvpd, struct pci_device *pci ) {
 	return 0;
 }
 
+/**
+ * Shut down NVS VPD device
+ *
+ * @v nvsvpd		NVS VPD device
+ */
+void nvs_vpd_fini ( struct nvs_vpd_device *nvsvpd ) {
+
+	pci_vpd_fini ( &nvsvpd->vpd );
+}
+
 /**
  * Resize non-volatile option storage within NVS VPD device
  *
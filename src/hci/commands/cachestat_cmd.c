@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdio.h>
+#include <getopt.h>
+#include <ipxe/command.h>
+#include <ipxe/parseopt.h>
+#include <ipxe/malloc.h>
+
+/** @file
+ *
+ * Cache statistics commands
+ *
+ */
+
+/** "cachestat" options */
+struct cachestat_options {
+	/** Clear statistics after displaying them */
+	int clear;
+};
+
+/** "cachestat" option list */
+static struct option_descriptor cachestat_opts[] = {
+	OPTION_DESC ( "clear", 'c', no_argument,
+		      struct cachestat_options, clear, parse_flag ),
+};
+
+/** "cachestat" command descriptor */
+static struct command_descriptor cachestat_cmd =
+	COMMAND_DESC ( struct cachestat_options, cachestat_opts, 0, 0,
+		       "[--clear]" );
+
+/**
+ * The "cachestat" command
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @ret rc		Return status code
+ *
+ * Caches are listed in the order in which they will be discarded
+ * under memory pressure.
+ */
+static int cachestat_exec ( int argc, char **argv ) {
+	struct cachestat_options opts;
+	struct cache_discarder *discarder;
+	int rc;
+
+	/* Parse options */
+	if ( ( rc = parse_options ( argc, argv, &cachestat_cmd, &opts ) ) != 0 )
+		return rc;
+
+	/* Display statistics */
+	for_each_table_entry ( discarder, CACHE_DISCARDERS ) {
+		printf ( "%s: %ld hits, %ld misses, %ld discarded\n",
+			 discarder->name, discarder->hits, discarder->misses,
+			 discarder->discarded );
+		if ( opts.clear ) {
+			discarder->hits = 0;
+			discarder->misses = 0;
+			discarder->discarded = 0;
+		}
+	}
+
+	return 0;
+}
+
+/** Cache statistics commands */
+struct command cachestat_command __command = {
+	.name = "cachestat",
+	.exec = cachestat_exec,
+};
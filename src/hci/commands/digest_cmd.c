@@ -78,21 +78,29 @@ static int digest_exec ( int argc, char **argv,
 		/* Acquire image */
 		if ( ( rc = imgacquire ( argv[i], &image ) ) != 0 )
 			continue;
-		offset = 0;
-		len = image->len;
-
-		/* calculate digest */
-		digest_init ( digest, digest_ctx );
-		while ( len ) {
-			frag_len = len;
-			if ( frag_len > sizeof ( buf ) )
-				frag_len = sizeof ( buf );
-			copy_from_user ( buf, image->data, offset, frag_len );
-			digest_update ( digest, digest_ctx, buf, frag_len );
-			len -= frag_len;
-			offset += frag_len;
+
+		/* Use digest calculated during download, if available */
+		if ( image->digest && ( image->digest->digest == digest ) ) {
+			memcpy ( digest_out, image->digest->out,
+				 sizeof ( digest_out ) );
+		} else {
+			/* calculate digest */
+			offset = 0;
+			len = image->len;
+			digest_init ( digest, digest_ctx );
+			while ( len ) {
+				frag_len = len;
+				if ( frag_len > sizeof ( buf ) )
+					frag_len = sizeof ( buf );
+				copy_from_user ( buf, image->data, offset,
+						 frag_len );
+				digest_update ( digest, digest_ctx, buf,
+						frag_len );
+				len -= frag_len;
+				offset += frag_len;
+			}
+			digest_final ( digest, digest_ctx, digest_out );
 		}
-		digest_final ( digest, digest_ctx, digest_out );
 
 		for ( j = 0 ; j < sizeof ( digest_out ) ; j++ )
 			printf ( "%02x", digest_out[j] );
@@ -164,6 +164,36 @@ static int ifstat_exec ( int argc, char **argv ) {
 	return ifcommon_exec ( argc, argv, &ifstat_cmd, ifstat_payload, 0 );
 }
 
+/** "netstat" options */
+struct netstat_options {};
+
+/** "netstat" option list */
+static struct option_descriptor netstat_opts[] = {};
+
+/** "netstat" command descriptor */
+static struct command_descriptor netstat_cmd =
+	COMMAND_DESC ( struct netstat_options, netstat_opts, 0, 0, "" );
+
+/**
+ * The "netstat" command
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @ret rc		Return status code
+ */
+static int netstat_exec ( int argc, char **argv ) {
+	struct netstat_options opts;
+	int rc;
+
+	/* Parse options */
+	if ( ( rc = parse_options ( argc, argv, &netstat_cmd, &opts ) ) != 0 )
+		return rc;
+
+	netstat();
+
+	return 0;
+}
+
 /** Interface management commands */
 struct command ifmgmt_commands[] __command = {
 	{
@@ -178,4 +208,8 @@ struct command ifmgmt_commands[] __command = {
 		.name = "ifstat",
 		.exec = ifstat_exec,
 	},
+	{
+		.name = "netstat",
+		.exec = netstat_exec,
+	},
 };
@@ -38,6 +38,8 @@ FILE_LICENCE ( GPL2_OR_LATER );
 struct imgsingle_options {
 	/** Image name */
 	const char *name;
+	/** Download in background */
+	int async;
 };
 
 /** "img{single}" option list */
@@ -100,6 +102,12 @@ static int imgsingle_exec ( int argc, char **argv,
 		}
 	}
 
+	/* Start background download, if applicable */
+	if ( opts.async ) {
+		rc = imgdownload_async ( name_uri, opts.name, cmdline );
+		goto err_async;
+	}
+
 	/* Acquire the image */
 	if ( name_uri ) {
 		if ( ( rc = desc->acquire ( name_uri, &image ) ) != 0 )
@@ -150,17 +158,26 @@ static int imgsingle_exec ( int argc, char **argv,
  err_set_cmdline:
  err_set_name:
  err_acquire:
+ err_async:
 	free ( cmdline );
  err_parse_cmdline:
  err_parse_options:
 	return rc;
 }
 
+/** "imgfetch" option list */
+static struct option_descriptor imgfetch_opts[] = {
+	OPTION_DESC ( "name", 'n', required_argument,
+		      struct imgsingle_options, name, parse_string ),
+	OPTION_DESC ( "async", 'a', no_argument,
+		      struct imgsingle_options, async, parse_flag ),
+};
+
 /** "imgfetch" command descriptor */
 static struct command_descriptor imgfetch_cmd =
-	COMMAND_DESC ( struct imgsingle_options, imgsingle_opts,
+	COMMAND_DESC ( struct imgsingle_options, imgfetch_opts,
 		       1, MAX_ARGUMENTS,
-		       "[--name <name>] <uri> [<arguments>...]" );
+		       "[--name <name>] [--async] <uri> [<arguments>...]" );
 
 /** "imgfetch" family command descriptor */
 struct imgsingle_descriptor imgfetch_desc = {
@@ -241,6 +258,37 @@ static int imgargs_exec ( int argc, char **argv ) {
 	return imgsingle_exec ( argc, argv, &imgargs_desc );
 }
 
+/** "imgfetchall" options */
+struct imgfetchall_options {};
+
+/** "imgfetchall" option list */
+static struct option_descriptor imgfetchall_opts[] = {};
+
+/** "imgfetchall" command descriptor */
+static struct command_descriptor imgfetchall_cmd =
+	COMMAND_DESC ( struct imgfetchall_options, imgfetchall_opts,
+		       1, MAX_ARGUMENTS, "<uri> [<uri>...]" );
+
+/**
+ * The "imgfetchall" command
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @ret rc		Return status code
+ */
+static int imgfetchall_exec ( int argc, char **argv ) {
+	struct imgfetchall_options opts;
+	int rc;
+
+	/* Parse options */
+	if ( ( rc = parse_options ( argc, argv, &imgfetchall_cmd,
+				    &opts ) ) != 0 )
+		return rc;
+
+	/* Fetch images */
+	return imgdownload_multi ( &argv[optind], ( argc - optind ), 0 );
+}
+
 /** "img{multi}" options */
 struct imgmulti_options {};
 
@@ -320,6 +368,10 @@ struct command image_commands[] __command = {
 		.name = "imgfetch",
 		.exec = imgfetch_exec,
 	},
+	{
+		.name = "imgfetchall",
+		.exec = imgfetchall_exec,
+	},
 	{
 		.name = "module",
 		.exec = imgfetch_exec, /* synonym for "imgfetch" */
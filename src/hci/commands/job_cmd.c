@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+#include <stdio.h>
+#include <getopt.h>
+#include <ipxe/command.h>
+#include <ipxe/parseopt.h>
+#include <ipxe/multijob.h>
+
+/** @file
+ *
+ * Background job commands
+ *
+ */
+
+/** "jobs" options */
+struct jobs_options {};
+
+/** "jobs" option list */
+static struct option_descriptor jobs_opts[] = {};
+
+/** "jobs" command descriptor */
+static struct command_descriptor jobs_cmd =
+	COMMAND_DESC ( struct jobs_options, jobs_opts, 0, 0, "" );
+
+/**
+ * The "jobs" command
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @ret rc		Return status code
+ */
+static int jobs_exec ( int argc, char **argv ) {
+	struct jobs_options opts;
+	int rc;
+
+	/* Parse options */
+	if ( ( rc = parse_options ( argc, argv, &jobs_cmd, &opts ) ) != 0 )
+		return rc;
+
+	/* List background jobs */
+	multijob_list();
+
+	return 0;
+}
+
+/** "wait" options */
+struct wait_options {
+	/** Wait for any job */
+	int any;
+};
+
+/** "wait" option list */
+static struct option_descriptor wait_opts[] = {
+	OPTION_DESC ( "any", 'a', no_argument,
+		      struct wait_options, any, parse_flag ),
+};
+
+/** "wait" command descriptor */
+static struct command_descriptor wait_cmd =
+	COMMAND_DESC ( struct wait_options, wait_opts, 0, 0, "[--any]" );
+
+/**
+ * The "wait" command
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @ret rc		Return status code
+ */
+static int wait_exec ( int argc, char **argv ) {
+	struct wait_options opts;
+	int rc;
+
+	/* Parse options */
+	if ( ( rc = parse_options ( argc, argv, &wait_cmd, &opts ) ) != 0 )
+		return rc;
+
+	/* Wait for background jobs */
+	return multijob_wait ( opts.any );
+}
+
+/** Background job commands */
+struct command job_commands[] __command = {
+	{
+		.name = "jobs",
+		.exec = jobs_exec,
+	},
+	{
+		.name = "wait",
+		.exec = wait_exec,
+	},
+};
@@ -38,18 +38,27 @@ FILE_LICENCE ( GPL2_OR_LATER );
 struct lotest_options {
 	/** MTU */
 	unsigned int mtu;
+	/** Number of packets in flight */
+	unsigned int window;
+	/** Number of packets to send */
+	unsigned int count;
 };
 
 /** "lotest" option list */
 static struct option_descriptor lotest_opts[] = {
 	OPTION_DESC ( "mtu", 'm', required_argument,
 		      struct lotest_options, mtu, parse_integer ),
+	OPTION_DESC ( "window", 'w', required_argument,
+		      struct lotest_options, window, parse_integer ),
+	OPTION_DESC ( "count", 'c', required_argument,
+		      struct lotest_options, count, parse_integer ),
 };
 
 /** "lotest" command descriptor */
 static struct command_descriptor lotest_cmd =
 	COMMAND_DESC ( struct lotest_options, lotest_opts, 2, 2,
-		       "[--mtu <mtu>] <sending interface> "
+		       "[--mtu <mtu>] [--window <packets>] "
+		       "[--count <packets>] <sending interface> "
 		       "<receiving interface>" );
 
 /**
@@ -82,7 +91,8 @@ static int lotest_exec ( int argc, char **argv ) {
 		opts.mtu = ETH_MAX_MTU;
 
 	/* Perform loopback test */
-	if ( ( rc = loopback_test ( sender, receiver, opts.mtu ) ) != 0 ) {
+	if ( ( rc = loopback_test ( sender, receiver, opts.mtu,
+				    opts.window, opts.count ) ) != 0 ) {
 		printf ( "Test failed: %s\n", strerror ( rc ) );
 		return rc;
 	}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <ipxe/command.h>
+#include <ipxe/parseopt.h>
+#include <ipxe/uri.h>
+#include <usr/netbench.h>
+
+/** @file
+ *
+ * Network download benchmarking commands
+ *
+ */
+
+/** "netbench" options */
+struct netbench_options {
+	/** Number of downloads */
+	unsigned int count;
+};
+
+/** "netbench" option list */
+static struct option_descriptor netbench_opts[] = {
+	OPTION_DESC ( "count", 'c', required_argument,
+		      struct netbench_options, count, parse_integer ),
+};
+
+/** "netbench" command descriptor */
+static struct command_descriptor netbench_cmd =
+	COMMAND_DESC ( struct netbench_options, netbench_opts, 1, 1,
+		       "[--count <count>] <uri>" );
+
+/**
+ * "netbench" command
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @ret rc		Return status code
+ */
+static int netbench_exec ( int argc, char **argv ) {
+	struct netbench_options opts;
+	struct uri *uri;
+	int rc;
+
+	/* Parse options */
+	if ( ( rc = parse_options ( argc, argv, &netbench_cmd, &opts ) ) != 0 )
+		return rc;
+
+	/* Use a single download if no count specified */
+	if ( ! opts.count )
+		opts.count = 1;
+
+	/* Parse URI */
+	uri = parse_uri ( argv[optind] );
+	if ( ! uri )
+		return -ENOMEM;
+
+	/* Perform benchmark */
+	if ( ( rc = netbench ( uri, opts.count ) ) != 0 ) {
+		printf ( "Benchmark failed: %s\n", strerror ( rc ) );
+		goto err_netbench;
+	}
+
+ err_netbench:
+	uri_put ( uri );
+	return rc;
+}
+
+/** Network download benchmarking commands */
+struct command netbench_command __command = {
+	.name = "netbench",
+	.exec = netbench_exec,
+};
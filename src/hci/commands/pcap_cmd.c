@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdio.h>
+#include <string.h>
+#include <getopt.h>
+#include <ipxe/netdevice.h>
+#include <ipxe/command.h>
+#include <ipxe/parseopt.h>
+#include <ipxe/pcap.h>
+
+/** @file
+ *
+ * Packet capture commands
+ *
+ */
+
+/** "pcapstart" options */
+struct pcapstart_options {
+	/** Capture buffer size */
+	unsigned int size;
+	/** Maximum captured length of each packet */
+	unsigned int snaplen;
+};
+
+/** "pcapstart" option list */
+static struct option_descriptor pcapstart_opts[] = {
+	OPTION_DESC ( "size", 's', required_argument,
+		      struct pcapstart_options, size, parse_integer ),
+	OPTION_DESC ( "snaplen", 'l', required_argument,
+		      struct pcapstart_options, snaplen, parse_integer ),
+};
+
+/** "pcapstart" command descriptor */
+static struct command_descriptor pcapstart_cmd =
+	COMMAND_DESC ( struct pcapstart_options, pcapstart_opts, 0, 1,
+		       "[--size <size>] [--snaplen <len>] [<interface>]" );
+
+/**
+ * The "pcapstart" command
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @ret rc		Return status code
+ */
+static int pcapstart_exec ( int argc, char **argv ) {
+	struct pcapstart_options opts;
+	struct net_device *netdev = NULL;
+	int rc;
+
+	/* Parse options */
+	if ( ( rc = parse_options ( argc, argv, &pcapstart_cmd, &opts ) ) != 0 )
+		return rc;
+	if ( ! opts.size )
+		opts.size = PCAP_DEFAULT_SIZE;
+	if ( ! opts.snaplen )
+		opts.snaplen = PCAP_DEFAULT_SNAPLEN;
+
+	/* Parse network device, if present */
+	if ( ( optind < argc ) &&
+	     ( ( rc = parse_netdev ( argv[optind], &netdev ) ) != 0 ) )
+		return rc;
+
+	/* Start capture */
+	if ( ( rc = pcap_start ( netdev, opts.size, opts.snaplen ) ) != 0 ) {
+		printf ( "Could not start capture: %s\n", strerror ( rc ) );
+		return rc;
+	}
+
+	return 0;
+}
+
+/** "pcapstop" options */
+struct pcapstop_options {};
+
+/** "pcapstop" option list */
+static struct option_descriptor pcapstop_opts[] = {};
+
+/** "pcapstop" command descriptor */
+static struct command_descriptor pcapstop_cmd =
+	COMMAND_DESC ( struct pcapstop_options, pcapstop_opts, 0, 0, "" );
+
+/**
+ * The "pcapstop" command
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @ret rc		Return status code
+ */
+static int pcapstop_exec ( int argc, char **argv ) {
+	struct pcapstop_options opts;
+	int rc;
+
+	/* Parse options */
+	if ( ( rc = parse_options ( argc, argv, &pcapstop_cmd, &opts ) ) != 0 )
+		return rc;
+
+	/* Stop capture */
+	pcap_stop();
+
+	return 0;
+}
+
+/** "pcapsave" options */
+struct pcapsave_options {};
+
+/** "pcapsave" option list */
+static struct option_descriptor pcapsave_opts[] = {};
+
+/** "pcapsave" command descriptor */
+static struct command_descriptor pcapsave_cmd =
+	COMMAND_DESC ( struct pcapsave_options, pcapsave_opts, 0, 1,
+		       "[<name>]" );
+
+/**
+ * The "pcapsave" command
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @ret rc		Return status code
+ */
+static int pcapsave_exec ( int argc, char **argv ) {
+	struct pcapsave_options opts;
+	const char *name = "capture.pcap";
+	int rc;
+
+	/* Parse options */
+	if ( ( rc = parse_options ( argc, argv, &pcapsave_cmd, &opts ) ) != 0 )
+		return rc;
+
+	/* Parse image name, if present */
+	if ( optind < argc )
+		name = argv[optind];
+
+	/* Save captured packets */
+	if ( ( rc = pcap_save ( name ) ) != 0 ) {
+		printf ( "Could not save capture: %s\n", strerror ( rc ) );
+		return rc;
+	}
+
+	return 0;
+}
+
+/** Packet capture commands */
+struct command pcap_commands[] __command = {
+	{
+		.name = "pcapstart",
+		.exec = pcapstart_exec,
+	},
+	{
+		.name = "pcapstop",
+		.exec = pcapstop_exec,
+	},
+	{
+		.name = "pcapsave",
+		.exec = pcapsave_exec,
+	},
+};
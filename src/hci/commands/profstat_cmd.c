@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdio.h>
+#include <getopt.h>
+#include <ipxe/command.h>
+#include <ipxe/parseopt.h>
+#include <ipxe/profstat.h>
+
+/** @file
+ *
+ * Profiling statistics commands
+ *
+ */
+
+/** "profstat" options */
+struct profstat_options {
+	/** Clear statistics after displaying them */
+	int clear;
+};
+
+/** "profstat" option list */
+static struct option_descriptor profstat_opts[] = {
+	OPTION_DESC ( "clear", 'c', no_argument,
+		      struct profstat_options, clear, parse_flag ),
+};
+
+/** "profstat" command descriptor */
+static struct command_descriptor profstat_cmd =
+	COMMAND_DESC ( struct profstat_options, profstat_opts, 0, 0,
+		       "[--clear]" );
+
+/**
+ * The "profstat" command
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @ret rc		Return status code
+ *
+ * Statistics are printed to the console, and so will also be sent to
+ * any configured syslog server.
+ */
+static int profstat_exec ( int argc, char **argv ) {
+	struct profstat_options opts;
+	struct profile_stat *stat;
+	char name[20];
+	unsigned int i;
+	int rc;
+
+	/* Parse options */
+	if ( ( rc = parse_options ( argc, argv, &profstat_cmd, &opts ) ) != 0 )
+		return rc;
+
+	/* Display statistics */
+	for ( i = 0 ; i < PROFSTAT_MAX ; i++ ) {
+		stat = &profile_stats[i];
+		if ( ! stat->type )
+			continue;
+		if ( stat->name ) {
+			snprintf ( name, sizeof ( name ), "%s", stat->name );
+		} else {
+			snprintf ( name, sizeof ( name ), "%p", stat->key );
+		}
+		printf ( "%-7s %-12s %8ld calls %12lld cycles %10lld bytes\n",
+			 stat->type, name, stat->calls,
+			 ( ( unsigned long long ) stat->cycles ),
+			 ( ( unsigned long long ) stat->bytes ) );
+	}
+
+	/* Clear statistics, if applicable */
+	if ( opts.clear )
+		profstat_clear();
+
+	return 0;
+}
+
+/** Profiling statistics commands */
+struct command profstat_command __command = {
+	.name = "profstat",
+	.exec = profstat_exec,
+};
@@ -24,6 +24,7 @@
 #include <ipxe/parseopt.h>
 #include <ipxe/uri.h>
 #include <ipxe/sanboot.h>
+#include <ipxe/blockstat.h>
 #include <usr/autoboot.h>
 
 FILE_LICENCE ( GPL2_OR_LATER );
@@ -42,6 +43,8 @@ struct sanboot_options {
 	int no_describe;
 	/** Keep SAN device */
 	int keep;
+	/** Copy SAN device into memory */
+	int ramdisk;
 };
 
 /** "sanboot" option list */
@@ -52,18 +55,21 @@ static struct option_descriptor sanboot_opts[] = {
 		      struct sanboot_options, no_describe, parse_flag ),
 	OPTION_DESC ( "keep", 'k', no_argument,
 		      struct sanboot_options, keep, parse_flag ),
+	OPTION_DESC ( "ramdisk", 'r', no_argument,
+		      struct sanboot_options, ramdisk, parse_flag ),
 };
 
 /** "sanhook" command descriptor */
 static struct command_descriptor sanhook_cmd =
-	COMMAND_DESC ( struct sanboot_options, sanboot_opts, 1, 1,
-		       "[--drive <drive>] [--no-describe] <root-path>" );
+	COMMAND_DESC ( struct sanboot_options, sanboot_opts, 1, MAX_ARGUMENTS,
+		       "[--drive <drive>] [--no-describe] [--ramdisk] "
+		       "<root-path> [<root-path>...]" );
 
 /** "sanboot" command descriptor */
 static struct command_descriptor sanboot_cmd =
-	COMMAND_DESC ( struct sanboot_options, sanboot_opts, 0, 1,
+	COMMAND_DESC ( struct sanboot_options, sanboot_opts, 0, MAX_ARGUMENTS,
 		       "[--drive <drive>] [--no-describe] [--keep] "
-		       "[<root-path>]" );
+		       "[--ramdisk] [<root-path>...]" );
 
 /** "sanunhook" command descriptor */
 static struct command_descriptor sanunhook_cmd =
@@ -83,8 +89,8 @@ static int sanboot_core_exec ( int argc, char **argv,
 			       struct command_descriptor *cmd,
 			       int default_flags, int no_root_path_flags ) {
 	struct sanboot_options opts;
-	const char *root_path;
-	struct uri *uri;
+	unsigned int count;
+	unsigned int i;
 	int flags;
 	int rc;
 
@@ -94,19 +100,17 @@ static int sanboot_core_exec ( int argc, char **argv,
 
 	/* Parse options */
 	if ( ( rc = reparse_options ( argc, argv, cmd, &opts ) ) != 0 )
-		goto err_parse_options;
-
-	/* Parse root path, if present */
-	if ( argc > optind ) {
-		root_path = argv[optind];
-		uri = parse_uri ( root_path );
-		if ( ! uri ) {
+		return rc;
+
+	/* Parse root paths, if present */
+	count = ( argc - optind );
+	struct uri *uris[count];
+	for ( i = 0 ; i < count ; i++ ) {
+		uris[i] = parse_uri ( argv[ optind + i ] );
+		if ( ! uris[i] ) {
 			rc = -ENOMEM;
 			goto err_parse_uri;
 		}
-	} else {
-		root_path = NULL;
-		uri = NULL;
 	}
 
 	/* Construct flags */
@@ -115,17 +119,19 @@ static int sanboot_core_exec ( int argc, char **argv,
 		flags |= URIBOOT_NO_SAN_DESCRIBE;
 	if ( opts.keep )
 		flags |= URIBOOT_NO_SAN_UNHOOK;
-	if ( ! root_path )
+	if ( opts.ramdisk )
+		flags |= URIBOOT_SAN_RAMDISK;
+	if ( ! count )
 		flags |= no_root_path_flags;
 
-	/* Boot from root path */
-	if ( ( rc = uriboot ( NULL, uri, opts.drive, flags ) ) != 0 )
+	/* Boot from root path(s) */
+	if ( ( rc = uriboot ( NULL, uris, count, opts.drive, flags ) ) != 0 )
 		goto err_uriboot;
 
  err_uriboot:
-	uri_put ( uri );
  err_parse_uri:
- err_parse_options:
+	while ( i-- )
+		uri_put ( uris[i] );
 	return rc;
 }
 
@@ -167,6 +173,67 @@ static int sanunhook_exec ( int argc, char **argv ) {
 				     URIBOOT_NO_SAN_BOOT ), 0 );
 }
 
+/** "sanstat" options */
+struct sanstat_options {};
+
+/** "sanstat" option list */
+static struct option_descriptor sanstat_opts[] = {};
+
+/** "sanstat" command descriptor */
+static struct command_descriptor sanstat_cmd =
+	COMMAND_DESC ( struct sanstat_options, sanstat_opts, 0, 0, "" );
+
+/**
+ * Print block device statistics
+ *
+ * @v stats		Block device statistics
+ */
+static void sanstat ( struct block_device_stats *stats ) {
+	unsigned long max;
+	unsigned int i;
+
+	printf ( "%s: %d commands, %d errors, %d retries, %d timeouts\n",
+		 stats->name, stats->commands, stats->errors, stats->retries,
+		 stats->timeouts );
+	printf ( "  Read %lld bytes, wrote %lld bytes\n",
+		 ( ( unsigned long long ) stats->read_len ),
+		 ( ( unsigned long long ) stats->write_len ) );
+	for ( i = 0 ; i < BLOCK_STATS_LATENCY_BUCKETS ; i++ ) {
+		if ( ! stats->latency[i] )
+			continue;
+		max = block_stats_latency_max ( i );
+		if ( max ) {
+			printf ( "  <%ldus: %d\n", max, stats->latency[i] );
+		} else {
+			printf ( "  >=%ldus: %d\n",
+				 block_stats_latency_max ( i - 1 ),
+				 stats->latency[i] );
+		}
+	}
+}
+
+/**
+ * The "sanstat" command
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @ret rc		Return status code
+ */
+static int sanstat_exec ( int argc, char **argv ) {
+	struct sanstat_options opts;
+	struct block_device_stats *stats;
+	int rc;
+
+	/* Parse options */
+	if ( ( rc = parse_options ( argc, argv, &sanstat_cmd, &opts ) ) != 0 )
+		return rc;
+
+	for_each_block_stats ( stats )
+		sanstat ( stats );
+
+	return 0;
+}
+
 /** SAN commands */
 struct command sanboot_commands[] __command = {
 	{
@@ -181,4 +248,8 @@ struct command sanboot_commands[] __command = {
 		.name = "sanunhook",
 		.exec = sanunhook_exec,
 	},
+	{
+		.name = "sanstat",
+		.exec = sanstat_exec,
+	},
 };
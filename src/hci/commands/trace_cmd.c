@@ -0,0 +1,231 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <ipxe/command.h>
+#include <ipxe/parseopt.h>
+#include <ipxe/trace.h>
+
+/** @file
+ *
+ * Runtime trace commands
+ *
+ */
+
+/**
+ * Find trace channel by name
+ *
+ * @v name		Channel name
+ * @ret channel		Trace channel, or NULL if not found
+ */
+static struct trace_channel * find_trace_channel ( const char *name ) {
+	struct trace_channel *channel;
+
+	for_each_table_entry ( channel, TRACE_CHANNELS ) {
+		if ( strcmp ( channel->name, name ) == 0 )
+			return channel;
+	}
+	return NULL;
+}
+
+/**
+ * Enable or disable trace channels
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @v enabled		Channels should be enabled
+ * @v object		Object to be traced, or NULL to trace all objects
+ * @ret rc		Return status code
+ *
+ * If no channels are named, then all channels are affected.
+ */
+static int trace_set ( int argc, char **argv, int enabled,
+		       const void *object ) {
+	struct trace_channel *channel;
+	int i;
+
+	/* Affect all channels if none are named */
+	if ( optind == argc ) {
+		for_each_table_entry ( channel, TRACE_CHANNELS ) {
+			channel->enabled = enabled;
+			channel->object = object;
+		}
+		return 0;
+	}
+
+	/* Affect named channels */
+	for ( i = optind ; i < argc ; i++ ) {
+		channel = find_trace_channel ( argv[i] );
+		if ( ! channel ) {
+			printf ( "%s: no such trace channel\n", argv[i] );
+			return -ENOENT;
+		}
+		channel->enabled = enabled;
+		channel->object = object;
+	}
+
+	return 0;
+}
+
+/** "traceon" options */
+struct traceon_options {
+	/** Object to be traced */
+	const char *object;
+};
+
+/** "traceon" option list */
+static struct option_descriptor traceon_opts[] = {
+	OPTION_DESC ( "object", 'o', required_argument,
+		      struct traceon_options, object, parse_string ),
+};
+
+/** "traceon" command descriptor */
+static struct command_descriptor traceon_cmd =
+	COMMAND_DESC ( struct traceon_options, traceon_opts, 0, MAX_ARGUMENTS,
+		       "[--object <id>] [<channel>...]" );
+
+/**
+ * The "traceon" command
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @ret rc		Return status code
+ */
+static int traceon_exec ( int argc, char **argv ) {
+	struct traceon_options opts;
+	unsigned long object = 0;
+	char *endp;
+	int rc;
+
+	/* Parse options */
+	if ( ( rc = parse_options ( argc, argv, &traceon_cmd, &opts ) ) != 0 )
+		return rc;
+
+	/* Parse object identifier, if present */
+	if ( opts.object ) {
+		object = strtoul ( opts.object, &endp, 0 );
+		if ( *endp ) {
+			printf ( "\"%s\": invalid object\n", opts.object );
+			return -EINVAL;
+		}
+	}
+
+	/* Enable channels */
+	return trace_set ( argc, argv, 1, ( ( void * ) object ) );
+}
+
+/** "traceoff" options */
+struct traceoff_options {};
+
+/** "traceoff" option list */
+static struct option_descriptor traceoff_opts[] = {};
+
+/** "traceoff" command descriptor */
+static struct command_descriptor traceoff_cmd =
+	COMMAND_DESC ( struct traceoff_options, traceoff_opts, 0,
+		       MAX_ARGUMENTS, "[<channel>...]" );
+
+/**
+ * The "traceoff" command
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @ret rc		Return status code
+ */
+static int traceoff_exec ( int argc, char **argv ) {
+	struct traceoff_options opts;
+	int rc;
+
+	/* Parse options */
+	if ( ( rc = parse_options ( argc, argv, &traceoff_cmd, &opts ) ) != 0 )
+		return rc;
+
+	/* Disable channels */
+	return trace_set ( argc, argv, 0, NULL );
+}
+
+/** "trace" options */
+struct trace_options {
+	/** Discard entries after displaying them */
+	int clear;
+};
+
+/** "trace" option list */
+static struct option_descriptor trace_opts[] = {
+	OPTION_DESC ( "clear", 'c', no_argument,
+		      struct trace_options, clear, parse_flag ),
+};
+
+/** "trace" command descriptor */
+static struct command_descriptor trace_cmd =
+	COMMAND_DESC ( struct trace_options, trace_opts, 0, 0, "[--clear]" );
+
+/**
+ * The "trace" command
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @ret rc		Return status code
+ */
+static int trace_exec ( int argc, char **argv ) {
+	struct trace_options opts;
+	struct trace_channel *channel;
+	int rc;
+
+	/* Parse options */
+	if ( ( rc = parse_options ( argc, argv, &trace_cmd, &opts ) ) != 0 )
+		return rc;
+
+	/* List channels */
+	printf ( "Channels:" );
+	for_each_table_entry ( channel, TRACE_CHANNELS ) {
+		printf ( " %s%s", channel->name,
+			 ( channel->enabled ? "+" : "" ) );
+	}
+	printf ( "\n" );
+
+	/* Dump entries */
+	trace_dump();
+	if ( opts.clear )
+		trace_clear();
+
+	return 0;
+}
+
+/** Runtime trace commands */
+struct command trace_commands[] __command = {
+	{
+		.name = "traceon",
+		.exec = traceon_exec,
+	},
+	{
+		.name = "traceoff",
+		.exec = traceoff_exec,
+	},
+	{
+		.name = "trace",
+		.exec = trace_exec,
+	},
+};
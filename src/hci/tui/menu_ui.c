@@ -24,7 +24,9 @@ FILE_LICENCE ( GPL2_OR_LATER );
  *
  */
 
+#include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <errno.h>
 #include <curses.h>
 #include <ipxe/keys.h>
@@ -44,11 +46,17 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #define MENU_ROWS	18
 #define MENU_COLS	78
 #define MENU_PAD	2
+#define SEARCH_ROW	( MENU_ROW + MENU_ROWS + 1 )
+
+/** Maximum length of incremental search string */
+#define MENU_SEARCH_LEN	32
 
 /** A menu user interface */
 struct menu_ui {
 	/** Menu */
 	struct menu *menu;
+	/** Menu items, in order */
+	struct menu_item **items;
 	/** Number of menu items */
 	int count;
 	/** Currently selected item */
@@ -57,24 +65,84 @@ struct menu_ui {
 	int first_visible;
 	/** Timeout (0=indefinite) */
 	unsigned long timeout;
+	/** Incremental search string */
+	char search[ MENU_SEARCH_LEN + 1 /* NUL */ ];
+	/** Length of incremental search string */
+	size_t search_len;
 };
 
 /**
  * Return a numbered menu item
  *
- * @v menu		Menu
+ * @v ui		Menu user interface
  * @v index		Index
  * @ret item		Menu item, or NULL
  */
-static struct menu_item * menu_item ( struct menu *menu, unsigned int index ) {
+static struct menu_item * menu_item ( struct menu_ui *ui, int index ) {
+
+	if ( ( index < 0 ) || ( index >= ui->count ) )
+		return NULL;
+	return ui->items[index];
+}
+
+/**
+ * Check if menu item text contains the incremental search string
+ *
+ * @v ui		Menu user interface
+ * @v item		Menu item
+ * @ret matches		Menu item matches search string
+ *
+ * The comparison is case-insensitive.
+ */
+static int menu_item_matches ( struct menu_ui *ui, struct menu_item *item ) {
+	const char *text;
+	size_t i;
+
+	for ( text = item->text ; *text ; text++ ) {
+		for ( i = 0 ; i < ui->search_len ; i++ ) {
+			if ( tolower ( text[i] ) != tolower ( ui->search[i] ) )
+				break;
+		}
+		if ( i == ui->search_len )
+			return 1;
+	}
+	return 0;
+}
+
+/**
+ * Find menu item matching the incremental search string
+ *
+ * @v ui		Menu user interface
+ * @ret index		Index of matching item, or negative if not found
+ *
+ * Items are searched starting from the current selection, so that
+ * the selection moves only if it no longer matches.
+ */
+static int menu_search ( struct menu_ui *ui ) {
 	struct menu_item *item;
+	int index;
+	int i;
 
-	list_for_each_entry ( item, &menu->items, list ) {
-		if ( index-- == 0 )
-			return item;
+	for ( i = 0 ; i < ui->count ; i++ ) {
+		index = ( ( ui->selected + i ) % ui->count );
+		item = menu_item ( ui, index );
+		if ( item->label && menu_item_matches ( ui, item ) )
+			return index;
 	}
+	return -1;
+}
 
-	return NULL;
+/**
+ * Draw incremental search string
+ *
+ * @v ui		Menu user interface
+ */
+static void draw_menu_search ( struct menu_ui *ui ) {
+
+	move ( SEARCH_ROW, ( MENU_COL + MENU_PAD ) );
+	if ( ui->search_len )
+		printw ( "Search: %s", ui->search );
+	clrtoeol();
 }
 
 /**
@@ -97,7 +165,7 @@ static void draw_menu_item ( struct menu_ui *ui, int index ) {
 	move ( ( MENU_ROW + row_offset ), MENU_COL );
 
 	/* Get menu item */
-	item = menu_item ( ui->menu, index );
+	item = menu_item ( ui, index );
 	if ( item ) {
 
 		/* Draw separators in a different colour */
@@ -188,6 +256,7 @@ static int menu_loop ( struct menu_ui *ui, struct menu_item **selected ) {
 	int key;
 	int i;
 	int move;
+	int searching;
 	int chosen = 0;
 	int rc = 0;
 
@@ -203,6 +272,7 @@ static int menu_loop ( struct menu_ui *ui, struct menu_item **selected ) {
 
 		/* Get key */
 		move = 0;
+		searching = 0;
 		key = getkey ( timeout );
 		if ( key < 0 ) {
 			/* Choose default if we finally time out */
@@ -234,6 +304,10 @@ static int menu_loop ( struct menu_ui *ui, struct menu_item **selected ) {
 				move = +ui->count;
 				break;
 			case ESC:
+				/* Cancel search, if any, otherwise menu */
+				if ( ! ui->search_len )
+					rc = -ECANCELED;
+				break;
 			case CTRL_C:
 				rc = -ECANCELED;
 				break;
@@ -241,19 +315,56 @@ static int menu_loop ( struct menu_ui *ui, struct menu_item **selected ) {
 			case LF:
 				chosen = 1;
 				break;
+			case BACKSPACE:
+				/* Shorten search string.  The current
+				 * selection must still match.
+				 */
+				if ( ui->search_len )
+					ui->search[ --ui->search_len ] = '\0';
+				searching = 1;
+				break;
 			default:
-				i = 0;
-				list_for_each_entry ( item, &ui->menu->items,
-						      list ) {
+				/* Check for shortcut keys, unless a
+				 * search is in progress.
+				 */
+				for ( i = 0 ; ( ( ! ui->search_len ) &&
+						( i < ui->count ) ) ; i++ ) {
+					item = menu_item ( ui, i );
 					if ( item->shortcut == key ) {
 						ui->selected = i;
 						chosen = 1;
 						break;
 					}
-					i++;
+				}
+				if ( chosen )
+					break;
+
+				/* Extend search string, ignoring any
+				 * character which would match nothing.
+				 */
+				if ( ( key < ' ' ) || ( key > '~' ) )
+					break;
+				searching = 1;
+				if ( ui->search_len >= MENU_SEARCH_LEN )
+					break;
+				ui->search[ ui->search_len++ ] = key;
+				ui->search[ ui->search_len ] = '\0';
+				i = menu_search ( ui );
+				if ( i >= 0 ) {
+					ui->selected = i;
+				} else {
+					ui->search[ --ui->search_len ] = '\0';
 				}
 				break;
 			}
+
+			/* Any other key terminates the search */
+			if ( searching || ui->search_len ) {
+				if ( ! searching )
+					ui->search_len = 0;
+				ui->search[ ui->search_len ] = '\0';
+				draw_menu_search ( ui );
+			}
 		}
 
 		/* Move selection, if applicable */
@@ -266,23 +377,25 @@ static int menu_loop ( struct menu_ui *ui, struct menu_item **selected ) {
 				ui->selected = ( ui->count - 1 );
 				move = -1;
 			}
-			item = menu_item ( ui->menu, ui->selected );
+			item = menu_item ( ui, ui->selected );
 			if ( item->label )
 				break;
 			move = ( ( move > 0 ) ? +1 : -1 );
 		}
 
-		/* Redraw selection if necessary */
-		if ( ( ui->selected != current ) || ( timeout != 0 ) ) {
+		/* Redraw only the rows that have changed */
+		if ( ui->selected != current ) {
 			draw_menu_item ( ui, current );
 			delta = ( ui->selected - ui->first_visible );
 			if ( delta >= MENU_ROWS )
 				draw_menu_items ( ui );
 			draw_menu_item ( ui, ui->selected );
+		} else if ( timeout != 0 ) {
+			draw_menu_item ( ui, ui->selected );
 		}
 
 		/* Refuse to choose unlabelled items (i.e. separators) */
-		item = menu_item ( ui->menu, ui->selected );
+		item = menu_item ( ui, ui->selected );
 		if ( ! item->label )
 			chosen = 0;
 
@@ -313,7 +426,16 @@ int show_menu ( struct menu *menu, unsigned int timeout_ms,
 	memset ( &ui, 0, sizeof ( ui ) );
 	ui.menu = menu;
 	ui.timeout = ( ( timeout_ms * TICKS_PER_SEC ) / 1000 );
+
+	/* Index menu items, to allow for very large menus */
+	list_for_each_entry ( item, &menu->items, list )
+		ui.count++;
+	ui.items = malloc ( ui.count * sizeof ( ui.items[0] ) );
+	if ( ! ui.items )
+		return -ENOMEM;
+	ui.count = 0;
 	list_for_each_entry ( item, &menu->items, list ) {
+		ui.items[ui.count] = item;
 		if ( item->label ) {
 			if ( ! labelled_count )
 				ui.selected = ui.count;
@@ -333,7 +455,8 @@ int show_menu ( struct menu *menu, unsigned int timeout_ms,
 		 * from, and will seriously confuse the navigation
 		 * logic.  Refuse to display any such menus.
 		 */
-		return -ENOENT;
+		rc = -ENOENT;
+		goto err_no_labels;
 	}
 
 	/* Initialise screen */
@@ -360,5 +483,7 @@ int show_menu ( struct menu *menu, unsigned int timeout_ms,
 	/* Clear screen */
 	endwin();
 
+ err_no_labels:
+	free ( ui.items );
 	return rc;
 }
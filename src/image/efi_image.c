@@ -21,6 +21,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <errno.h>
 #include <stdlib.h>
 #include <ipxe/efi/efi.h>
+#include <ipxe/efi/IndustryStandard/PeImage.h>
 #include <ipxe/image.h>
 #include <ipxe/init.h>
 #include <ipxe/features.h>
@@ -125,6 +126,7 @@ static int efi_image_exec ( struct image *image ) {
 	UINTN exit_data_size;
 	CHAR16 *exit_data;
 	EFI_STATUS efirc;
+	int file_rc;
 	int rc;
 
 	/* Attempt loading image */
@@ -154,6 +156,15 @@ static int efi_image_exec ( struct image *image ) {
 		       "protocol: %s\n", image, strerror ( rc ) );
 		goto err_download_install;
 	}
+
+	/* Allow the image to read files via iPXE.  This is not fatal
+	 * if it fails, since the device handle may already support a
+	 * file system (e.g. if iPXE itself was loaded from a disk).
+	 */
+	if ( ( file_rc = efi_file_install ( &device_handle ) ) != 0 ) {
+		DBGC ( image, "EFIIMAGE %p could not install file "
+		       "protocols: %s\n", image, strerror ( file_rc ) );
+	}
 	loaded.image->DeviceHandle = device_handle;
 	loaded.image->ParentHandle = efi_loaded_image;
 	if ( ( rc = efi_image_make_cmdline ( image, &loaded.image->FilePath,
@@ -176,6 +187,8 @@ static int efi_image_exec ( struct image *image ) {
  err_start_image:
 	free ( loaded.image->LoadOptions );
  err_make_cmdline:
+	if ( file_rc == 0 )
+		efi_file_uninstall ( device_handle );
 	efi_download_uninstall ( device_handle );
  err_download_install:
  err_open_protocol:
@@ -193,26 +206,52 @@ static int efi_image_exec ( struct image *image ) {
  *
  * @v image		EFI file
  * @ret rc		Return status code
+ *
+ * The image headers are checked directly, rather than by loading the
+ * image via LoadImage().  Loading the image would cause the firmware
+ * to copy, relocate (and possibly verify the signature of) the whole
+ * image, only for it to be unloaded and then loaded again by
+ * efi_image_exec().  Any image which passes this check but which the
+ * firmware subsequently refuses to load will still fail cleanly at
+ * execution time.
  */
 static int efi_image_probe ( struct image *image ) {
-	EFI_BOOT_SERVICES *bs = efi_systab->BootServices;
-	EFI_HANDLE handle;
-	EFI_STATUS efirc;
+	EFI_IMAGE_DOS_HEADER dos;
+	EFI_IMAGE_NT_HEADERS32 nt;
+	unsigned int subsystem;
 
-	/* Attempt loading image */
-	if ( ( efirc = bs->LoadImage ( FALSE, efi_image_handle, NULL,
-				       user_to_virt ( image->data, 0 ),
-				       image->len, &handle ) ) != 0 ) {
-		/* Not an EFI image */
-		DBGC ( image, "EFIIMAGE %p could not load: %s\n",
-		       image, efi_strerror ( efirc ) );
+	/* Check DOS header */
+	if ( image->len < sizeof ( dos ) ) {
+		DBGC ( image, "EFIIMAGE %p too short for DOS header\n", image );
+		return -ENOEXEC;
+	}
+	copy_from_user ( &dos, image->data, 0, sizeof ( dos ) );
+	if ( dos.e_magic != EFI_IMAGE_DOS_SIGNATURE ) {
+		DBGC ( image, "EFIIMAGE %p has no DOS signature\n", image );
 		return -ENOEXEC;
 	}
 
-	/* Unload the image.  We can't leave it loaded, because we
-	 * have no "unload" operation.
+	/* Check PE header.  The subsystem field appears at the same
+	 * offset within both the 32-bit and 64-bit optional headers.
 	 */
-	bs->UnloadImage ( handle );
+	if ( ( dos.e_lfanew > image->len ) ||
+	     ( ( image->len - dos.e_lfanew ) < sizeof ( nt ) ) ) {
+		DBGC ( image, "EFIIMAGE %p too short for PE header\n", image );
+		return -ENOEXEC;
+	}
+	copy_from_user ( &nt, image->data, dos.e_lfanew, sizeof ( nt ) );
+	if ( nt.Signature != EFI_IMAGE_NT_SIGNATURE ) {
+		DBGC ( image, "EFIIMAGE %p has no PE signature\n", image );
+		return -ENOEXEC;
+	}
+	subsystem = nt.OptionalHeader.Subsystem;
+	if ( ( subsystem != EFI_IMAGE_SUBSYSTEM_EFI_APPLICATION ) &&
+	     ( subsystem != EFI_IMAGE_SUBSYSTEM_EFI_BOOT_SERVICE_DRIVER ) &&
+	     ( subsystem != EFI_IMAGE_SUBSYSTEM_EFI_RUNTIME_DRIVER ) ) {
+		DBGC ( image, "EFIIMAGE %p has non-EFI subsystem %d\n",
+		       image, subsystem );
+		return -ENOEXEC;
+	}
 
 	return 0;
 }
@@ -40,19 +40,42 @@ typedef Elf32_Phdr	Elf_Phdr;
 typedef Elf32_Off	Elf_Off;
 #define ELFCLASS	ELFCLASS32
 
+/** ELF signature */
+static const uint8_t elf_ident[] = {
+	[EI_MAG0]	= ELFMAG0,
+	[EI_MAG1]	= ELFMAG1,
+	[EI_MAG2]	= ELFMAG2,
+	[EI_MAG3]	= ELFMAG3,
+	[EI_CLASS]	= ELFCLASS,
+};
+
+/**
+ * Find ELF segment load address
+ *
+ * @v phdr		ELF program header
+ * @ret dest		Load address, or zero
+ *
+ * Use the physical address for preference, falling back to the
+ * virtual address if no physical address is supplied.
+ */
+static physaddr_t elf_dest ( Elf_Phdr *phdr ) {
+	return ( phdr->p_paddr ? phdr->p_paddr : phdr->p_vaddr );
+}
+
 /**
  * Load ELF segment into memory
  *
  * @v image		ELF file
  * @v phdr		ELF program header
  * @v ehdr		ELF executable header
+ * @v preloaded		Segment has already been loaded into memory
  * @ret entry		Entry point, if found
  * @ret max		Maximum used address
  * @ret rc		Return status code
  */
 static int elf_load_segment ( struct image *image, Elf_Phdr *phdr,
-			      Elf_Ehdr *ehdr, physaddr_t *entry,
-			      physaddr_t *max ) {
+			      Elf_Ehdr *ehdr, int preloaded,
+			      physaddr_t *entry, physaddr_t *max ) {
 	physaddr_t dest;
 	physaddr_t end;
 	userptr_t buffer;
@@ -69,13 +92,8 @@ static int elf_load_segment ( struct image *image, Elf_Phdr *phdr,
 		return -ENOEXEC;
 	}
 
-	/* Find start address: use physical address for preference,
-	 * fall back to virtual address if no physical address
-	 * supplied.
-	 */
-	dest = phdr->p_paddr;
-	if ( ! dest )
-		dest = phdr->p_vaddr;
+	/* Find start address */
+	dest = elf_dest ( phdr );
 	if ( ! dest ) {
 		DBGC ( image, "ELF %p segment loads to physical address 0\n",
 		       image );
@@ -89,21 +107,22 @@ static int elf_load_segment ( struct image *image, Elf_Phdr *phdr,
 	       phdr->p_paddr, ( phdr->p_paddr + phdr->p_filesz ),
 	       ( phdr->p_paddr + phdr->p_memsz ) );
 
-	/* Verify and prepare segment */
-	if ( ( rc = prep_segment ( buffer, phdr->p_filesz,
-				   phdr->p_memsz ) ) != 0 ) {
-		DBGC ( image, "ELF %p could not prepare segment: %s\n",
-		       image, strerror ( rc ) );
-		return rc;
+	/* Verify, prepare and copy segment, unless already loaded */
+	if ( ! preloaded ) {
+		if ( ( rc = prep_segment ( buffer, phdr->p_filesz,
+					   phdr->p_memsz ) ) != 0 ) {
+			DBGC ( image, "ELF %p could not prepare segment: "
+			       "%s\n", image, strerror ( rc ) );
+			return rc;
+		}
+		memcpy_user ( buffer, 0, image->data, phdr->p_offset,
+			      phdr->p_filesz );
 	}
 
 	/* Update maximum used address, if applicable */
 	if ( end > *max )
 		*max = end;
 
-	/* Copy image to segment */
-	memcpy_user ( buffer, 0, image->data, phdr->p_offset, phdr->p_filesz );
-
 	/* Set execution address, if it lies within this segment */
 	if ( ( e_offset = ( ehdr->e_entry - dest ) ) < phdr->p_filesz ) {
 		*entry = ehdr->e_entry;
@@ -131,23 +150,17 @@ static int elf_load_segment ( struct image *image, Elf_Phdr *phdr,
  * @ret rc		Return status code
  */
 int elf_load ( struct image *image, physaddr_t *entry, physaddr_t *max ) {
-	static const uint8_t e_ident[] = {
-		[EI_MAG0]	= ELFMAG0,
-		[EI_MAG1]	= ELFMAG1,
-		[EI_MAG2]	= ELFMAG2,
-		[EI_MAG3]	= ELFMAG3,
-		[EI_CLASS]	= ELFCLASS,
-	};
 	Elf_Ehdr ehdr;
 	Elf_Phdr phdr;
 	Elf_Off phoff;
 	unsigned int phnum;
+	int preloaded;
 	int rc;
 
 	/* Read ELF header */
 	copy_from_user ( &ehdr, image->data, 0, sizeof ( ehdr ) );
-	if ( memcmp ( &ehdr.e_ident[EI_MAG0], e_ident,
-		      sizeof ( e_ident ) ) != 0 ) {
+	if ( memcmp ( &ehdr.e_ident[EI_MAG0], elf_ident,
+		      sizeof ( elf_ident ) ) != 0 ) {
 		DBGC ( image, "ELF %p has invalid signature\n", image );
 		return -ENOEXEC;
 	}
@@ -158,6 +171,16 @@ int elf_load ( struct image *image, physaddr_t *entry, physaddr_t *max ) {
 	/* Invalidate entry point */
 	*entry = 0;
 
+	/* Check whether segments were loaded during download, and
+	 * have not since been overwritten by any other segment.
+	 */
+	preloaded = ( image->preloaded &&
+		      ( image->preloaded == segment_generation ) );
+	if ( preloaded ) {
+		DBGC ( image, "ELF %p segments already loaded during "
+		       "download\n", image );
+	}
+
 	/* Read ELF program headers */
 	for ( phoff = ehdr.e_phoff , phnum = ehdr.e_phnum ; phnum ;
 	      phoff += ehdr.e_phentsize, phnum-- ) {
@@ -167,7 +190,7 @@ int elf_load ( struct image *image, physaddr_t *entry, physaddr_t *max ) {
 			return -ENOEXEC;
 		}
 		copy_from_user ( &phdr, image->data, phoff, sizeof ( phdr ) );
-		if ( ( rc = elf_load_segment ( image, &phdr, &ehdr,
+		if ( ( rc = elf_load_segment ( image, &phdr, &ehdr, preloaded,
 					       entry, max ) ) != 0 ) {
 			return rc;
 		}
@@ -182,3 +205,175 @@ int elf_load ( struct image *image, physaddr_t *entry, physaddr_t *max ) {
 
 	return 0;
 }
+
+/**
+ * Abandon ELF segment stream
+ *
+ * @v stream		ELF segment stream
+ * @v image		ELF file
+ * @v reason		Reason for abandoning stream
+ */
+static void elf_stream_abandon ( struct elf_stream *stream,
+				 struct image *image, const char *reason ) {
+
+	DBGC ( image, "ELF %p not loading during download: %s\n",
+	       image, reason );
+	stream->state = ELF_STREAM_IDLE;
+}
+
+/**
+ * Prepare segments for ELF segment stream
+ *
+ * @v stream		ELF segment stream
+ * @v image		ELF file
+ * @v ehdr		ELF executable header
+ * @ret rc		Return status code
+ *
+ * Segments are loaded during download only if they lie entirely
+ * below the download buffer.  The external heap never grows
+ * downwards into such memory, so the segments cannot be overwritten
+ * by the download buffer itself.
+ */
+static int elf_stream_prepare ( struct elf_stream *stream,
+				struct image *image, Elf_Ehdr *ehdr ) {
+	physaddr_t limit = user_to_phys ( image->data, 0 );
+	physaddr_t dest;
+	Elf_Phdr phdr;
+	Elf_Off phoff;
+	unsigned int phnum;
+	int rc;
+
+	for ( phoff = ehdr->e_phoff , phnum = ehdr->e_phnum ; phnum ;
+	      phoff += sizeof ( phdr ), phnum-- ) {
+		copy_from_user ( &phdr, image->data, phoff, sizeof ( phdr ) );
+		if ( phdr.p_type != PT_LOAD )
+			continue;
+		dest = elf_dest ( &phdr );
+		if ( ( ! dest ) || ( phdr.p_memsz > ( limit - dest ) ) ||
+		     ( dest >= limit ) )
+			return -ERANGE;
+		if ( ( rc = prep_segment ( phys_to_user ( dest ),
+					   phdr.p_filesz,
+					   phdr.p_memsz ) ) != 0 )
+			return rc;
+	}
+
+	stream->data = image->data;
+	stream->generation = segment_generation;
+	return 0;
+}
+
+/**
+ * Load newly downloaded data into ELF segments
+ *
+ * @v stream		ELF segment stream
+ * @v image		ELF file
+ * @v pos		Offset of newly downloaded data
+ * @v len		Length of newly downloaded data
+ *
+ * The data must already have been written to the image buffer.
+ * Loading is abandoned (and will instead take place as normal when
+ * the image is executed) if data arrives out of order, or if the
+ * segments cannot be prepared as soon as the program headers have
+ * been received.
+ */
+void elf_stream ( struct elf_stream *stream, struct image *image,
+		  size_t pos, size_t len ) {
+	Elf_Ehdr ehdr;
+	Elf_Phdr phdr;
+	Elf_Off phoff;
+	unsigned int phnum;
+	size_t start;
+	size_t end;
+	size_t seg_start;
+	size_t seg_end;
+
+	/* Do nothing unless streaming, and ignore empty deliveries
+	 * (such as seek hints).
+	 */
+	if ( ( stream->state == ELF_STREAM_IDLE ) || ( ! len ) )
+		return;
+
+	/* Abandon if data arrives out of order, or if the image
+	 * buffer has moved.
+	 */
+	if ( pos != stream->pos ) {
+		elf_stream_abandon ( stream, image, "out-of-order data" );
+		return;
+	}
+	if ( stream->data && ( stream->data != image->data ) ) {
+		elf_stream_abandon ( stream, image, "buffer moved" );
+		return;
+	}
+	start = pos;
+	end = stream->pos = ( pos + len );
+
+	/* Wait for ELF header */
+	if ( end < sizeof ( ehdr ) )
+		return;
+	copy_from_user ( &ehdr, image->data, 0, sizeof ( ehdr ) );
+
+	/* Parse headers, once available */
+	if ( stream->state == ELF_STREAM_HEADERS ) {
+		if ( ( memcmp ( &ehdr.e_ident[EI_MAG0], elf_ident,
+				sizeof ( elf_ident ) ) != 0 ) ||
+		     ( ehdr.e_phentsize != sizeof ( phdr ) ) ) {
+			stream->state = ELF_STREAM_IDLE;
+			return;
+		}
+		if ( end < ( ehdr.e_phoff + ( ehdr.e_phnum * sizeof ( phdr ) )))
+			return;
+		if ( elf_stream_prepare ( stream, image, &ehdr ) != 0 ) {
+			elf_stream_abandon ( stream, image,
+					     "cannot prepare segments" );
+			return;
+		}
+		DBGC ( image, "ELF %p loading segments during download\n",
+		       image );
+		stream->state = ELF_STREAM_LOADING;
+		start = 0;
+	}
+
+	/* Copy data into any overlapping segments */
+	for ( phoff = ehdr.e_phoff , phnum = ehdr.e_phnum ; phnum ;
+	      phoff += sizeof ( phdr ), phnum-- ) {
+		copy_from_user ( &phdr, image->data, phoff, sizeof ( phdr ) );
+		if ( phdr.p_type != PT_LOAD )
+			continue;
+		seg_start = phdr.p_offset;
+		seg_end = ( phdr.p_offset + phdr.p_filesz );
+		if ( seg_start < start )
+			seg_start = start;
+		if ( seg_end > end )
+			seg_end = end;
+		if ( seg_start >= seg_end )
+			continue;
+		memcpy_user ( phys_to_user ( elf_dest ( &phdr ) ),
+			      ( seg_start - phdr.p_offset ), image->data,
+			      seg_start, ( seg_end - seg_start ) );
+	}
+}
+
+/**
+ * Finish ELF segment stream
+ *
+ * @v stream		ELF segment stream
+ * @v image		ELF file
+ *
+ * This must be called only when the download has completed
+ * successfully.
+ */
+void elf_stream_finish ( struct elf_stream *stream, struct image *image ) {
+
+	/* Record image as preloaded if all data was loaded in order
+	 * and no other segments have since been prepared.
+	 */
+	if ( ( stream->state == ELF_STREAM_LOADING ) &&
+	     ( stream->pos == image->len ) &&
+	     ( stream->data == image->data ) &&
+	     ( stream->generation == segment_generation ) ) {
+		DBGC ( image, "ELF %p loaded during download\n", image );
+		image->preloaded = segment_generation;
+	}
+	stream->state = ELF_STREAM_IDLE;
+}
@@ -9,9 +9,25 @@
 FILE_LICENCE ( GPL2_OR_LATER );
 
 #include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <byteswap.h>
 #include <ipxe/image.h>
 #include <ipxe/uaccess.h>
+#include <ipxe/umalloc.h>
+#include <ipxe/deflate.h>
 #include <ipxe/init.h>
+#include <config/general.h>
+
+/** Decompress gzip-compressed embedded images */
+#ifdef EMBED_GZIP
+#define EMBEDDED_GZIP 1
+#else
+#define EMBEDDED_GZIP 0
+#endif
+
+/** Filename extension for gzip-compressed embedded images */
+#define EMBEDDED_GZIP_EXT ".gz"
 
 /* Raw image data for all embedded images */
 #undef EMBED
@@ -40,6 +56,101 @@ static struct image embedded_images[] = {
 	EMBED_ALL
 };
 
+/**
+ * Decompress gzip-compressed embedded image
+ *
+ * @v image		Embedded image
+ * @ret rc		Return status code
+ *
+ * The decompressed image is placed in external memory, and the
+ * compressed image data is left untouched.
+ */
+static int embedded_gunzip ( struct image *image ) {
+	static const uint8_t magic[] = { 0x1f, 0x8b };
+	char *name = image->name;
+	size_t name_len = strlen ( name );
+	size_t ext_len = ( sizeof ( EMBEDDED_GZIP_EXT ) - 1 );
+	char base_name[ name_len + 1 /* NUL */ ];
+	struct deflate *deflate;
+	struct deflate_chunk in;
+	struct deflate_chunk out;
+	uint8_t sig[ sizeof ( magic ) ];
+	uint32_t isize;
+	userptr_t data;
+	int rc;
+
+	/* Do nothing unless image is named as a gzip-compressed file
+	 * and has a gzip signature.
+	 */
+	if ( ( name_len <= ext_len ) ||
+	     ( strcmp ( ( name + name_len - ext_len ),
+			EMBEDDED_GZIP_EXT ) != 0 ) ||
+	     ( image->len < ( sizeof ( sig ) + sizeof ( isize ) ) ) )
+		return 0;
+	copy_from_user ( sig, image->data, 0, sizeof ( sig ) );
+	if ( memcmp ( sig, magic, sizeof ( sig ) ) != 0 )
+		return 0;
+
+	/* Allocate decompressor */
+	deflate = malloc ( sizeof ( *deflate ) );
+	if ( ! deflate ) {
+		rc = -ENOMEM;
+		goto err_alloc_deflate;
+	}
+	deflate_init ( deflate, DEFLATE_GZIP );
+
+	/* Allocate decompressed data buffer.  The uncompressed length
+	 * is recorded in the final four bytes of the gzip footer.
+	 */
+	copy_from_user ( &isize, image->data,
+			 ( image->len - sizeof ( isize ) ), sizeof ( isize ) );
+	isize = le32_to_cpu ( isize );
+	data = umalloc ( isize );
+	if ( ! data ) {
+		rc = -ENOMEM;
+		goto err_alloc_data;
+	}
+
+	/* Decompress image */
+	deflate_chunk_init ( &in, user_to_virt ( image->data, 0 ), 0,
+			     image->len );
+	deflate_chunk_init ( &out, user_to_virt ( data, 0 ), 0, isize );
+	if ( ( rc = deflate_inflate ( deflate, &in, &out ) ) != 0 )
+		goto err_inflate;
+	if ( ! ( deflate_finished ( deflate ) && ( out.offset == isize ) ) ) {
+		rc = -EINVAL;
+		goto err_inflate;
+	}
+
+	/* Replace image data and strip filename extension */
+	memcpy ( base_name, name, ( name_len - ext_len ) );
+	base_name[ name_len - ext_len ] = '\0';
+	image->name = NULL;
+	if ( ( rc = image_set_name ( image, base_name ) ) != 0 ) {
+		image->name = name;
+		goto err_set_name;
+	}
+	DBG ( "Embedded image \"%s\" decompressed from %zd to %d bytes at "
+	      "%#08lx\n", image->name, image->len, isize,
+	      user_to_phys ( data, 0 ) );
+	image->data = data;
+	image->len = isize;
+	image->preloaded = 0;
+
+	free ( deflate );
+	return 0;
+
+ err_set_name:
+ err_inflate:
+	ufree ( data );
+ err_alloc_data:
+	free ( deflate );
+ err_alloc_deflate:
+	DBG ( "Could not decompress embedded image \"%s\": %s\n",
+	      name, strerror ( rc ) );
+	return rc;
+}
+
 /**
  * Register all embedded images
  */
@@ -69,6 +180,11 @@ static void embedded_init ( void ) {
 		DBG ( "Embedded image \"%s\": %zd bytes at %p\n",
 		      image->name, image->len, data );
 
+		/* Decompress image, if applicable */
+		if ( EMBEDDED_GZIP &&
+		     ( ( rc = embedded_gunzip ( image ) ) != 0 ) )
+			return;
+
 		if ( ( rc = register_image ( image ) ) != 0 ) {
 			DBG ( "Could not register embedded image \"%s\": "
 			      "%s\n", image->name, strerror ( rc ) );
@@ -31,12 +31,25 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ctype.h>
 #include <errno.h>
 #include <getopt.h>
+#include <ipxe/list.h>
 #include <ipxe/command.h>
 #include <ipxe/parseopt.h>
 #include <ipxe/image.h>
 #include <ipxe/shell.h>
 #include <usr/prompt.h>
+#include <usr/imgmgmt.h>
 #include <ipxe/script.h>
+#include <config/general.h>
+
+/** Prefetch images for consecutive image download commands */
+#ifdef DOWNLOAD_PREFETCH
+#define SCRIPT_PREFETCH 1
+#else
+#define SCRIPT_PREFETCH 0
+#endif
+
+/** Maximum number of images to prefetch at once */
+#define SCRIPT_PREFETCH_MAX 8
 
 /** Offset within current script
  *
@@ -45,6 +58,131 @@ FILE_LICENCE ( GPL2_OR_LATER );
  */
 static size_t script_offset;
 
+/** Start of most recently prefetched range of script lines */
+static size_t script_prefetch_start;
+
+/** End of most recently prefetched range of script lines */
+static size_t script_prefetch_end;
+
+/** A script label */
+struct script_label {
+	/** List of labels */
+	struct list_head list;
+	/** Offset of line following label */
+	size_t offset;
+	/** Label name */
+	char name[0];
+};
+
+/** Labels within current script, or NULL if not in a script
+ *
+ * This is a global in order to allow goto_exec() to find labels
+ * without rescanning the script.
+ */
+static struct list_head *script_labels;
+
+/**
+ * Read script line
+ *
+ * @v image		Script
+ * @v offset		Offset within script (will be updated)
+ * @ret line		Line of script, or NULL
+ *
+ * The line excludes any terminating '\n'.  The caller is responsible
+ * for freeing the line.
+ */
+static char * script_read_line ( struct image *image, size_t *offset ) {
+	off_t eol;
+	size_t len;
+	char *line;
+
+	/* Find length of next line, excluding any terminating '\n' */
+	eol = memchr_user ( image->data, *offset, '\n',
+			    ( image->len - *offset ) );
+	if ( eol < 0 )
+		eol = image->len;
+	len = ( eol - *offset );
+
+	/* Allocate buffer for line */
+	line = zalloc ( len + 1 /* NUL */ );
+	if ( ! line )
+		return NULL;
+
+	/* Copy line */
+	copy_from_user ( line, image->data, *offset, len );
+
+	/* Move to next line */
+	*offset += ( len + 1 );
+
+	return line;
+}
+
+/**
+ * Index labels within script
+ *
+ * @v image		Script
+ * @v labels		List of labels to fill in
+ * @ret rc		Return status code
+ */
+static int script_index_labels ( struct image *image,
+				 struct list_head *labels ) {
+	struct script_label *label;
+	size_t offset = 0;
+	size_t len;
+	char *line;
+	char first;
+
+	while ( offset < image->len ) {
+
+		/* Skip lines which are not labels */
+		copy_from_user ( &first, image->data, offset, sizeof ( first ));
+		if ( first != ':' ) {
+			offset = memchr_user ( image->data, offset, '\n',
+					       ( image->len - offset ) );
+			if ( ( ( off_t ) offset ) < 0 )
+				break;
+			offset++;
+			continue;
+		}
+
+		/* Read label line */
+		line = script_read_line ( image, &offset );
+		if ( ! line )
+			return -ENOMEM;
+
+		/* Record label, ignoring any trailing text */
+		len = strcspn ( &line[1], " \t\r\n\f\v" );
+		label = zalloc ( sizeof ( *label ) + len + 1 /* NUL */ );
+		if ( ! label ) {
+			free ( line );
+			return -ENOMEM;
+		}
+		memcpy ( label->name, &line[1], len );
+		label->offset = offset;
+		list_add_tail ( &label->list, labels );
+		DBG ( "Script label \"%s\" at offset %#zx\n",
+		      label->name, label->offset );
+		free ( line );
+	}
+
+	return 0;
+}
+
+/**
+ * Free script label index
+ *
+ * @v labels		List of labels
+ */
+static void script_free_labels ( struct list_head *labels ) {
+	struct script_label *label;
+	struct script_label *tmp;
+
+	list_for_each_entry_safe ( label, tmp, labels, list ) {
+		list_del ( &label->list );
+		free ( label );
+	}
+}
+
 /**
  * Process script lines
  *
@@ -56,8 +194,6 @@ static size_t script_offset;
 static int process_script ( struct image *image,
 			    int ( * process_line ) ( const char *line ),
 			    int ( * terminate ) ( int rc ) ) {
-	off_t eol;
-	size_t len;
 	char *line;
 	int rc;
 
@@ -65,25 +201,12 @@ static int process_script ( struct image *image,
 
 	do {
 	
-		/* Find length of next line, excluding any terminating '\n' */
-		eol = memchr_user ( image->data, script_offset, '\n',
-				    ( image->len - script_offset ) );
-		if ( eol < 0 )
-			eol = image->len;
-		len = ( eol - script_offset );
-
-		/* Allocate buffer for line */
-		line = zalloc ( len + 1 /* NUL */ );
+		/* Read next line */
+		line = script_read_line ( image, &script_offset );
 		if ( ! line )
 			return -ENOMEM;
-
-		/* Copy line */
-		copy_from_user ( line, image->data, script_offset, len );
 		DBG ( "$ %s\n", line );
 
-		/* Move to next line */
-		script_offset += ( len + 1 );
-
 		/* Process and free line */
 		rc = process_line ( line );
 		free ( line );
@@ -107,6 +230,135 @@ static int terminate_on_exit_or_failure ( int rc ) {
 		 ( rc != 0 ) );
 }
 
+/** Commands which download an image specified as their first argument */
+static const char *script_prefetch_commands[] = {
+	"imgfetch", "module", "initrd", "kernel", "imgselect", "imgload",
+	"chain", "imgexec", "boot",
+};
+
+/**
+ * Check for image download command
+ *
+ * @v command		Command name
+ * @ret is_download	Command downloads an image
+ */
+static int script_prefetch_command ( const char *command ) {
+	unsigned int num_commands = ( sizeof ( script_prefetch_commands ) /
+				      sizeof ( script_prefetch_commands[0] ) );
+	unsigned int i;
+
+	for ( i = 0 ; i < num_commands ; i++ ) {
+		if ( strcmp ( command, script_prefetch_commands[i] ) == 0 )
+			return 1;
+	}
+	return 0;
+}
+
+/**
+ * Identify image to be downloaded by a script line
+ *
+ * @v line		Line of script (will be modified)
+ * @ret uri_string	URI string, or NULL if line does not download an image
+ */
+static char * script_prefetch_uri ( char *line ) {
+	int have_command = 0;
+	char *word;
+
+	/* Ignore any line which would be subject to settings
+	 * expansion, since the settings may be changed by the
+	 * preceding commands.
+	 */
+	if ( strchr ( line, '$' ) )
+		return NULL;
+
+	/* Identify command and first non-option argument */
+	while ( ( word = strsep ( &line, " \t" ) ) != NULL ) {
+		if ( ! *word )
+			continue;
+		if ( ! have_command ) {
+			if ( ! script_prefetch_command ( word ) )
+				return NULL;
+			have_command = 1;
+			continue;
+		}
+		if ( ( strcmp ( word, "-n" ) == 0 ) ||
+		     ( strcmp ( word, "--name" ) == 0 ) ) {
+			strsep ( &line, " \t" );
+			continue;
+		}
+		if ( word[0] == '-' )
+			continue;
+
+		/* Ignore references to existing images */
+		if ( find_image ( word ) )
+			return NULL;
+		return word;
+	}
+
+	return NULL;
+}
+
+/**
+ * Prefetch images for consecutive image download commands
+ *
+ * @v line		Line of script
+ *
+ * When a script line downloads an image, the images downloaded by
+ * any immediately following lines (e.g. a "kernel" line followed by
+ * several "initrd" lines) are downloaded concurrently.  The following
+ * lines will then find their images already present.  Failures are
+ * ignored, since any failed download will be retried (and reported)
+ * when its script line is executed.
+ */
+static void script_prefetch ( const char *line ) {
+	struct image *image = current_image;
+	char *lines[SCRIPT_PREFETCH_MAX];
+	char *uris[SCRIPT_PREFETCH_MAX];
+	unsigned int count = 0;
+	size_t offset = script_offset;
+	unsigned int i;
+
+	/* Do nothing unless prefetching is enabled */
+	if ( ! SCRIPT_PREFETCH )
+		return;
+
+	/* Do nothing if this line has already been prefetched */
+	if ( ( offset > script_prefetch_start ) &&
+	     ( offset <= script_prefetch_end ) )
+		return;
+
+	/* Identify images to be downloaded by this and following lines */
+	while ( count < SCRIPT_PREFETCH_MAX ) {
+		if ( count == 0 ) {
+			lines[count] = strdup ( line );
+		} else if ( offset < image->len ) {
+			lines[count] = script_read_line ( image, &offset );
+		} else {
+			break;
+		}
+		if ( ! lines[count] )
+			break;
+		uris[count] = script_prefetch_uri ( lines[count] );
+		if ( ! uris[count] ) {
+			free ( lines[count] );
+			break;
+		}
+		count++;
+	}
+
+	/* Download images concurrently, if worthwhile */
+	if ( count > 1 ) {
+		DBG ( "Prefetching %d images\n", count );
+		script_prefetch_start = script_offset;
+		script_prefetch_end = offset;
+		imgdownload_multi ( uris, count, IMAGE_PREFETCHED );
+	}
+
+	/* Free lines */
+	for ( i = 0 ; i < count ; i++ )
+		free ( lines[i] );
+}
+
 /**
  * Execute script line
  *
@@ -120,6 +372,9 @@ static int script_exec_line ( const char *line ) {
 	if ( line[0] == ':' )
 		return 0;
 
+	/* Prefetch any images downloaded by this and following lines */
+	script_prefetch ( line );
+
 	/* Execute command */
 	if ( ( rc = system ( line ) ) != 0 )
 		return rc;
@@ -134,9 +389,17 @@ static int script_exec_line ( const char *line ) {
  * @ret rc		Return status code
  */
 static int script_exec ( struct image *image ) {
+	LIST_HEAD ( labels );
+	struct list_head *saved_labels;
 	size_t saved_offset;
+	size_t saved_prefetch_start;
+	size_t saved_prefetch_end;
 	int rc;
 
+	/* Index labels */
+	if ( ( rc = script_index_labels ( image, &labels ) ) != 0 )
+		goto err_index;
+
 	/* Temporarily de-register image, so that a "boot" command
 	 * doesn't throw us into an execution loop.
 	 */
@@ -144,6 +407,11 @@ static int script_exec ( struct image *image ) {
 
 	/* Preserve state of any currently-running script */
 	saved_offset = script_offset;
+	saved_prefetch_start = script_prefetch_start;
+	saved_prefetch_end = script_prefetch_end;
+	saved_labels = script_labels;
+	script_prefetch_start = script_prefetch_end = 0;
+	script_labels = &labels;
 
 	/* Process script */
 	rc = process_script ( image, script_exec_line,
@@ -151,11 +419,16 @@ static int script_exec ( struct image *image ) {
 
 	/* Restore saved state */
 	script_offset = saved_offset;
+	script_prefetch_start = saved_prefetch_start;
+	script_prefetch_end = saved_prefetch_end;
+	script_labels = saved_labels;
 
 	/* Re-register image (unless we have been replaced) */
 	if ( ! image->replacement )
 		register_image ( image );
 
+ err_index:
+	script_free_labels ( &labels );
 	return rc;
 }
 
@@ -208,44 +481,6 @@ static struct option_descriptor goto_opts[] = {};
 static struct command_descriptor goto_cmd =
 	COMMAND_DESC ( struct goto_options, goto_opts, 1, 1, "<label>" );
 
-/**
- * Current "goto" label
- *
- * Valid only during goto_exec().  Consider this part of a closure.
- */
-static const char *goto_label;
-
-/**
- * Check for presence of label
- *
- * @v line		Script line
- * @ret rc		Return status code
- */
-static int goto_find_label ( const char *line ) {
-	size_t len = strlen ( goto_label );
-
-	if ( line[0] != ':' )
-		return -ENOENT;
-
-	if ( strncmp ( goto_label, &line[1], len ) != 0 )
-		return -ENOENT;
-
-	if ( line[ 1 + len ] && ! isspace ( line[ 1 + len ] ) )
-		return -ENOENT;
-
-	return 0;
-}
-
-/**
- * Terminate script processing when label is found
- *
- * @v rc		Line processing status
- * @ret terminate	Terminate script processing
- */
-static int terminate_on_label_found ( int rc ) {
-	return ( rc == 0 );
-}
-
 /**
  * "goto" command
  *
@@ -255,7 +490,7 @@ static int terminate_on_label_found ( int rc ) {
  */
 static int goto_exec ( int argc, char **argv ) {
 	struct goto_options opts;
-	size_t saved_offset;
+	struct script_label *label;
 	int rc;
 
 	/* Parse options */
@@ -263,27 +498,27 @@ static int goto_exec ( int argc, char **argv ) {
 		return rc;
 
 	/* Sanity check */
-	if ( ! current_image ) {
+	if ( ! ( current_image && script_labels ) ) {
 		rc = -ENOTTY;
 		printf ( "Not in a script: %s\n", strerror ( rc ) );
 		return rc;
 	}
 
-	/* Parse label */
-	goto_label = argv[optind];
-
 	/* Find label */
-	saved_offset = script_offset;
-	if ( ( rc = process_script ( current_image, goto_find_label,
-				     terminate_on_label_found ) ) != 0 ) {
-		script_offset = saved_offset;
-		return rc;
-	}
+	list_for_each_entry ( label, script_labels, list ) {
+		if ( strcmp ( label->name, argv[optind] ) == 0 ) {
 
-	/* Terminate processing of current command */
-	shell_stop ( SHELL_STOP_COMMAND );
+			/* Continue script from line following label */
+			script_offset = label->offset;
 
-	return 0;
+			/* Terminate processing of current command */
+			shell_stop ( SHELL_STOP_COMMAND );
+
+			return 0;
+		}
+	}
+
+	return -ENOENT;
 }
 
 /** "goto" command */
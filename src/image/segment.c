@@ -44,6 +44,16 @@ struct errortab segment_errors[] __errortab = {
 	__einfo_errortab ( EINFO_ERANGE_SEGMENT ),
 };
 
+/**
+ * Segment generation counter
+ *
+ * This is incremented whenever a segment is prepared for loading.
+ * Anything loaded into memory at a point when the counter held a
+ * particular value cannot subsequently have been overwritten by a
+ * segment loader if the counter still holds that same value.
+ */
+unsigned long segment_generation;
+
 /**
  * Prepare segment for loading
  *
@@ -61,6 +71,9 @@ int prep_segment ( userptr_t segment, size_t filesz, size_t memsz ) {
 
 	DBG ( "Preparing segment [%lx,%lx,%lx)\n", start, mid, end );
 
+	/* Update generation counter */
+	segment_generation++;
+
 	/* Sanity check */
 	if ( filesz > memsz ) {
 		DBG ( "Insane segment [%lx,%lx,%lx)\n", start, mid, end );
@@ -591,6 +591,21 @@ int __debug_disable;
 /** Declare a function to be always inline */
 #define __always_inline __attribute__ (( always_inline ))
 
+/**
+ * Declare a function as being on a hot path
+ *
+ * Hot functions are placed into .text.hot, which the linker scripts
+ * group together ahead of all other code so that the packet
+ * processing fast path occupies as few cachelines as possible.  In
+ * the speed-optimised build profile (PROFILE=speed), hot functions
+ * are also optimised for speed rather than for size.
+ */
+#ifdef PROFILE_SPEED
+#define __hot __attribute__ (( hot, optimize ( "O2" ) ))
+#else
+#define __hot __attribute__ (( hot ))
+#endif
+
 /* Force all inline functions to not be instrumented
  *
  * This is required to cope with what seems to be a long-standing gcc
@@ -11,6 +11,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 
 #include <stdint.h>
 #include <ipxe/interface.h>
+#include <ipxe/uaccess.h>
 
 /**
  * An ACPI description header
@@ -51,6 +52,34 @@ struct acpi_description_header {
 #define ACPI_SIGNATURE( a, b, c, d ) \
 	( ( (a) << 0 ) | ( (b) << 8 ) | ( (c) << 16 ) | ( (d) << 24 ) )
 
+/** Root System Description Pointer signature */
+#define RSDP_SIGNATURE { 'R', 'S', 'D', ' ', 'P', 'T', 'R', ' ' }
+
+/** Root System Description Pointer */
+struct acpi_rsdp {
+	/** Signature */
+	char signature[8];
+	/** To make sum of structure == 0 */
+	uint8_t checksum;
+	/** OEM identification */
+	char oem_id[6];
+	/** Revision */
+	uint8_t revision;
+	/** Physical address of RSDT */
+	uint32_t rsdt;
+} __attribute__ (( packed ));
+
+/** Root System Description Table (RSDT) signature */
+#define RSDT_SIGNATURE ACPI_SIGNATURE ( 'R', 'S', 'D', 'T' )
+
+/** ACPI Root System Description Table (RSDT) */
+struct acpi_rsdt {
+	/** ACPI header */
+	struct acpi_description_header acpi;
+	/** Physical addresses of other ACPI tables */
+	uint32_t entry[0];
+} __attribute__ (( packed ));
+
 extern int acpi_describe ( struct interface *interface,
 			   struct acpi_description_header *acpi, size_t len );
 #define acpi_describe_TYPE( object_type )				\
@@ -59,5 +88,7 @@ extern int acpi_describe ( struct interface *interface,
 		       size_t len ) )
 
 extern void acpi_fix_checksum ( struct acpi_description_header *acpi );
+extern userptr_t acpi_find ( userptr_t rsdt, uint32_t signature,
+			     unsigned int index );
 
 #endif /* _IPXE_ACPI_H */
@@ -21,12 +21,21 @@ struct aes_context {
 /** AES context size */
 #define AES_CTX_SIZE sizeof ( struct aes_context )
 
+/** Maximum AES-CBC context size
+ *
+ * An accelerated implementation may replace the generic AES-CBC
+ * implementation at startup, changing the value of @c ctxsize.  Any
+ * such implementation must fit within the generic context size.
+ */
+#define AES_CBC_CTX_MAX_SIZE ( AES_CTX_SIZE + AES_BLOCKSIZE )
+
 /* AXTLS functions */
 extern void axtls_aes_encrypt ( const AES_CTX *ctx, uint32_t *data );
 extern void axtls_aes_decrypt ( const AES_CTX *ctx, uint32_t *data );
 
 extern struct cipher_algorithm aes_algorithm;
 extern struct cipher_algorithm aes_cbc_algorithm;
+extern struct cipher_algorithm aes_gcm_algorithm;
 
 int aes_wrap ( const void *kek, const void *src, void *dest, int nblk );
 int aes_unwrap ( const void *kek, const void *src, void *dest, int nblk );
@@ -106,8 +106,13 @@ struct aoehdr {
 /** AoE tag magic marker */
 #define AOE_TAG_MAGIC 0x18ae0000
 
-/** Maximum number of sectors per packet */
-#define AOE_MAX_COUNT 2
+/** Maximum number of sectors per packet
+ *
+ * This is the limit imposed by the width of the ATA sector count
+ * field.  The number of sectors actually used is constrained by the
+ * network device's maximum packet length.
+ */
+#define AOE_MAX_COUNT 255
 
 /** AoE boot firmware table signature */
 #define ABFT_SIG ACPI_SIGNATURE ( 'a', 'B', 'F', 'T' )
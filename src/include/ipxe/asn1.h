@@ -213,6 +213,8 @@ extern int asn1_skip_if_exists ( struct asn1_cursor *cursor,
 				 unsigned int type );
 extern int asn1_skip ( struct asn1_cursor *cursor, unsigned int type );
 extern int asn1_shrink ( struct asn1_cursor *cursor, unsigned int type );
+extern int asn1_next ( struct asn1_cursor *cursor, unsigned int type,
+		       struct asn1_cursor *object );
 extern int asn1_enter_any ( struct asn1_cursor *cursor );
 extern int asn1_skip_any ( struct asn1_cursor *cursor );
 extern int asn1_shrink_any ( struct asn1_cursor *cursor );
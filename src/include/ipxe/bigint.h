@@ -238,6 +238,12 @@ FILE_LICENCE ( GPL2_OR_LATER );
 			     size, exponent_size, tmp );		\
 	} while ( 0 )
 
+/** Window size (in bits) used for modular exponentiation */
+#define BIGINT_MOD_EXP_WINDOW 4
+
+/** Number of precomputed powers used for modular exponentiation */
+#define BIGINT_MOD_EXP_POWERS ( 1 << ( BIGINT_MOD_EXP_WINDOW - 1 ) )
+
 /**
  * Calculate temporary working space required for moduluar exponentiation
  *
@@ -253,7 +259,11 @@ FILE_LICENCE ( GPL2_OR_LATER );
 	sizeof ( struct {						\
 		bigint_t ( size ) temp_base;				\
 		bigint_t ( exponent_size ) temp_exponent;		\
-		uint8_t mod_multiply[mod_multiply_len];			\
+		union {							\
+			uint8_t mod_multiply[mod_multiply_len];		\
+			bigint_t ( size * 2 ) product;			\
+		} temp_multiply;					\
+		bigint_t ( size ) temp_power[BIGINT_MOD_EXP_POWERS];	\
 	} ); } )
 
 #include <bits/bigint.h>
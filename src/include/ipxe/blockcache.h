@@ -0,0 +1,78 @@
+#ifndef _IPXE_BLOCKCACHE_H
+#define _IPXE_BLOCKCACHE_H
+
+/** @file
+ *
+ * Block device read-ahead cache
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <ipxe/list.h>
+#include <ipxe/uaccess.h>
+
+/** A block cache extent */
+struct block_cache_extent {
+	/** List of extents, most recently used first */
+	struct list_head list;
+	/** Starting logical block address */
+	uint64_t lba;
+	/** Number of valid blocks (zero if extent is unused) */
+	unsigned int count;
+	/** Cached data */
+	userptr_t data;
+};
+
+/** A block cache */
+struct block_cache {
+	/** List of extents, most recently used first */
+	struct list_head extents;
+	/** Extents */
+	struct block_cache_extent *extent;
+	/** Cached data for all extents */
+	userptr_t data;
+	/** Block size */
+	size_t blksize;
+	/** Total number of blocks in underlying device */
+	uint64_t blocks;
+	/** Number of blocks per extent */
+	unsigned int count;
+	/**
+	 * Read from underlying block device
+	 *
+	 * @v cache		Block cache
+	 * @v lba		Starting logical block address
+	 * @v count		Number of logical blocks
+	 * @v buffer		Data buffer
+	 * @ret rc		Return status code
+	 */
+	int ( * read ) ( struct block_cache *cache, uint64_t lba,
+			 unsigned int count, userptr_t buffer );
+};
+
+/**
+ * Initialise block cache
+ *
+ * @v cache		Block cache
+ * @v read		Method for reading from underlying block device
+ */
+static inline void
+block_cache_init ( struct block_cache *cache,
+		   int ( * read ) ( struct block_cache *cache, uint64_t lba,
+				    unsigned int count, userptr_t buffer ) ) {
+	INIT_LIST_HEAD ( &cache->extents );
+	cache->read = read;
+}
+
+extern int block_cache_alloc ( struct block_cache *cache, size_t blksize,
+			       uint64_t blocks, size_t extent_len,
+			       unsigned int num_extents );
+extern void block_cache_free ( struct block_cache *cache );
+extern void block_cache_invalidate ( struct block_cache *cache, uint64_t lba,
+				     unsigned int count );
+extern int block_cache_read ( struct block_cache *cache, uint64_t lba,
+			      unsigned int count, userptr_t buffer );
+
+#endif /* _IPXE_BLOCKCACHE_H */
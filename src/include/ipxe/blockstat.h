@@ -0,0 +1,91 @@
+#ifndef _IPXE_BLOCKSTAT_H
+#define _IPXE_BLOCKSTAT_H
+
+/** @file
+ *
+ * Block device statistics
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <ipxe/list.h>
+#include <ipxe/settings.h>
+
+/** Number of latency histogram buckets */
+#define BLOCK_STATS_LATENCY_BUCKETS 16
+
+/** Upper bound of first latency histogram bucket (in microseconds)
+ *
+ * Each subsequent bucket covers twice the range of the preceding
+ * bucket.  The final bucket is unbounded.
+ */
+#define BLOCK_STATS_LATENCY_MIN_US 64
+
+/** Block device statistics */
+struct block_device_stats {
+	/** List of block device statistics */
+	struct list_head list;
+	/** Name */
+	char name[12];
+	/** Settings block */
+	struct settings settings;
+
+	/** Number of commands issued */
+	unsigned int commands;
+	/** Number of commands that failed */
+	unsigned int errors;
+	/** Number of commands retried */
+	unsigned int retries;
+	/** Number of commands that timed out */
+	unsigned int timeouts;
+	/** Total length of data read */
+	uint64_t read_len;
+	/** Total length of data written */
+	uint64_t write_len;
+	/** Total latency of completed commands (in microseconds) */
+	uint64_t latency_total;
+	/** Latency histogram */
+	unsigned int latency[BLOCK_STATS_LATENCY_BUCKETS];
+};
+
+extern struct list_head block_stats;
+
+/** Iterate over all block device statistics */
+#define for_each_block_stats( stats ) \
+	list_for_each_entry ( (stats), &block_stats, list )
+
+extern struct settings_operations block_stats_settings_operations;
+
+/**
+ * Initialise block device statistics
+ *
+ * @v stats		Block device statistics
+ * @v refcnt		Containing object reference counter, or NULL
+ */
+static inline void block_stats_init ( struct block_device_stats *stats,
+				      struct refcnt *refcnt ) {
+	INIT_LIST_HEAD ( &stats->list );
+	settings_init ( &stats->settings, &block_stats_settings_operations,
+			refcnt, 0 );
+}
+
+/**
+ * Record issued block device command
+ *
+ * @v stats		Block device statistics
+ */
+static inline void block_stats_issued ( struct block_device_stats *stats ) {
+	stats->commands++;
+}
+
+extern int block_stats_register ( struct block_device_stats *stats,
+				  const char *name );
+extern void block_stats_unregister ( struct block_device_stats *stats );
+extern void block_stats_done ( struct block_device_stats *stats,
+			       unsigned long elapsed, size_t len,
+			       int is_write, int rc );
+extern unsigned long block_stats_latency_max ( unsigned int bucket );
+
+#endif /* _IPXE_BLOCKSTAT_H */
@@ -0,0 +1,21 @@
+#ifndef _IPXE_BOND_H
+#define _IPXE_BOND_H
+
+/**
+ * @file
+ *
+ * Link aggregation
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+struct net_device;
+
+/** Maximum number of member ports in an aggregated link */
+#define BOND_MAX_PORTS 8
+
+extern int bond_create ( struct net_device **members, unsigned int count );
+extern int bond_destroy ( struct net_device *netdev );
+
+#endif /* _IPXE_BOND_H */
@@ -46,5 +46,9 @@ extern int cms_parse ( struct cms_signature *sig, const void *data,
 		       size_t len );
 extern int cms_verify ( struct cms_signature *sig, userptr_t data, size_t len,
 			const char *name, time_t time, struct x509_root *root );
+extern int cms_verify_digested ( struct cms_signature *sig, userptr_t data,
+				 size_t len, struct digest_algorithm *digested,
+				 const void *digested_out, const char *name,
+				 time_t time, struct x509_root *root );
 
 #endif /* _IPXE_CMS_H */
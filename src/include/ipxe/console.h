@@ -50,6 +50,18 @@ struct console_driver {
 	 */
 	void ( *putchar ) ( int character );
 
+	/** Write a string to the console.
+	 *
+	 * @v data		Characters to be written
+	 * @v len		Number of characters
+	 *
+	 * This method is optional.  Consoles which can write several
+	 * characters more cheaply than one at a time (e.g. via a
+	 * single firmware call) may provide it; otherwise putchar()
+	 * will be called for each character.
+	 */
+	void ( *write ) ( const char *data, size_t len );
+
 	/** Read a character from the console.
 	 *
 	 * @v None		-
@@ -143,6 +155,9 @@ struct console_driver {
 
 extern int console_usage;
 
+extern void console_write ( const char *data, size_t len );
+extern void console_flush ( void );
+
 /**
  * Set console usage
  *
@@ -153,6 +168,7 @@ static inline __attribute__ (( always_inline )) int
 console_set_usage ( int usage ) {
 	int old_usage = console_usage;
 
+	console_flush();
 	console_usage = usage;
 	return old_usage;
 }
@@ -0,0 +1,18 @@
+#ifndef _IPXE_CRC32C_H
+#define _IPXE_CRC32C_H
+
+/** @file
+ *
+ * CRC32C (Castagnoli) checksum
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+
+extern u32 crc32c_le_generic ( u32 seed, const void *data, size_t len );
+
+#include <bits/crc32c.h>
+
+#endif /* _IPXE_CRC32C_H */
@@ -52,6 +52,12 @@ struct cipher_algorithm {
 	size_t ctxsize;
 	/** Block size */
 	size_t blocksize;
+	/** Authentication tag size
+	 *
+	 * This is zero for ciphers which do not provide
+	 * authentication.
+	 */
+	size_t authsize;
 	/** Set key
 	 *
 	 * @v ctx		Context
@@ -73,7 +79,9 @@ struct cipher_algorithm {
 	 * @v dst		Buffer for encrypted data
 	 * @v len		Length of data
 	 *
-	 * @v len is guaranteed to be a multiple of @c blocksize.
+	 * @v len is guaranteed to be a multiple of @c blocksize.  For
+	 * authenticated ciphers, @c dst may be NULL to indicate that
+	 * @c src is additional authenticated data.
 	 */
 	void ( * encrypt ) ( void *ctx, const void *src, void *dst,
 			     size_t len );
@@ -84,10 +92,21 @@ struct cipher_algorithm {
 	 * @v dst		Buffer for decrypted data
 	 * @v len		Length of data
 	 *
-	 * @v len is guaranteed to be a multiple of @c blocksize.
+	 * @v len is guaranteed to be a multiple of @c blocksize.  @c
+	 * src and @c dst may be identical, to allow for in-place
+	 * decryption.  For authenticated ciphers, @c dst may be NULL
+	 * to indicate that @c src is additional authenticated data.
 	 */
 	void ( * decrypt ) ( void *ctx, const void *src, void *dst,
 			     size_t len );
+	/** Generate authentication tag
+	 *
+	 * @v ctx		Context
+	 * @v auth		Buffer for authentication tag
+	 *
+	 * This is used only for ciphers with a non-zero @c authsize.
+	 */
+	void ( * auth ) ( void *ctx, void *auth );
 };
 
 /** A public key algorithm */
@@ -204,10 +223,19 @@ static inline void cipher_decrypt ( struct cipher_algorithm *cipher,
 	cipher_decrypt ( (cipher), (ctx), (src), (dst), (len) );	\
 	} while ( 0 )
 
+static inline void cipher_auth ( struct cipher_algorithm *cipher, void *ctx,
+				 void *auth ) {
+	cipher->auth ( ctx, auth );
+}
+
 static inline int is_stream_cipher ( struct cipher_algorithm *cipher ) {
 	return ( cipher->blocksize == 1 );
 }
 
+static inline int is_auth_cipher ( struct cipher_algorithm *cipher ) {
+	return cipher->authsize;
+}
+
 static inline int pubkey_init ( struct pubkey_algorithm *pubkey, void *ctx,
 				const void *key, size_t key_len ) {
 	return pubkey->init ( ctx, key, key_len );
@@ -0,0 +1,175 @@
+#ifndef _IPXE_DEFLATE_H
+#define _IPXE_DEFLATE_H
+
+/** @file
+ *
+ * DEFLATE decompression algorithm
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+
+/** Compression formats */
+enum deflate_format {
+	/** Raw DEFLATE data (RFC 1951) */
+	DEFLATE_RAW,
+	/** ZLIB header and footer (RFC 1950) */
+	DEFLATE_ZLIB,
+	/** GZIP header and footer (RFC 1952) */
+	DEFLATE_GZIP,
+};
+
+/** Decompressor states */
+enum deflate_state {
+	/** Awaiting ZLIB header */
+	DEFLATE_ZLIB_HEADER,
+	/** Awaiting GZIP header */
+	DEFLATE_GZIP_HEADER,
+	/** Awaiting GZIP extra field length */
+	DEFLATE_GZIP_EXTRA_LEN,
+	/** Skipping GZIP header bytes */
+	DEFLATE_GZIP_SKIP,
+	/** Skipping GZIP NUL-terminated header string */
+	DEFLATE_GZIP_STRING,
+	/** Awaiting block header */
+	DEFLATE_BLOCK_HEADER,
+	/** Awaiting stored block length */
+	DEFLATE_STORED_LEN,
+	/** Copying stored block data */
+	DEFLATE_STORED_DATA,
+	/** Awaiting dynamic block header */
+	DEFLATE_DYNAMIC_HEADER,
+	/** Awaiting dynamic block code length code lengths */
+	DEFLATE_DYNAMIC_CODELEN,
+	/** Awaiting dynamic block literal/length and distance lengths */
+	DEFLATE_DYNAMIC_LENGTHS,
+	/** Awaiting literal/length symbol */
+	DEFLATE_LITLEN,
+	/** Awaiting distance symbol */
+	DEFLATE_DISTANCE,
+	/** Awaiting distance extra bits */
+	DEFLATE_DISTANCE_EXTRA,
+	/** Copying back-reference */
+	DEFLATE_COPY,
+	/** Awaiting footer */
+	DEFLATE_FOOTER,
+	/** Decompression complete */
+	DEFLATE_DONE,
+};
+
+/** Maximum number of symbols in any Huffman alphabet */
+#define DEFLATE_HUFFMAN_SYMBOLS 288
+
+/** Maximum length of any Huffman code */
+#define DEFLATE_HUFFMAN_BITS 15
+
+/** Size of sliding window */
+#define DEFLATE_WINDOW_SIZE 32768
+
+/** A Huffman alphabet */
+struct deflate_huffman {
+	/** Number of codes of each length */
+	uint16_t count[ DEFLATE_HUFFMAN_BITS + 1 ];
+	/** Symbols, in canonical code order */
+	uint16_t symbol[DEFLATE_HUFFMAN_SYMBOLS];
+};
+
+/** A DEFLATE decompressor */
+struct deflate {
+	/** Compression format */
+	enum deflate_format format;
+	/** Current state */
+	enum deflate_state state;
+
+	/** Bit buffer */
+	uint32_t bits;
+	/** Number of bits within bit buffer */
+	unsigned int bits_len;
+
+	/** Current block is the final block */
+	int final;
+	/** Remaining length of current region (if applicable) */
+	size_t remaining;
+	/** Header or footer bytes */
+	uint8_t header[10];
+	/** Number of header or footer bytes received */
+	unsigned int header_len;
+	/** Header flags (GZIP format only) */
+	unsigned int flags;
+
+	/** Number of literal/length codes */
+	unsigned int hlit;
+	/** Number of distance codes */
+	unsigned int hdist;
+	/** Number of code length codes */
+	unsigned int hclen;
+	/** Index of next code length to be received */
+	unsigned int index;
+	/** Code lengths */
+	uint8_t lengths[ 286 + 32 ];
+	/** Code length alphabet */
+	struct deflate_huffman codelen;
+	/** Literal/length alphabet */
+	struct deflate_huffman litlen;
+	/** Distance alphabet */
+	struct deflate_huffman distance;
+
+	/** Length of pending back-reference */
+	unsigned int copy_len;
+	/** Distance of pending back-reference */
+	unsigned int copy_dist;
+
+	/** Running checksum */
+	uint32_t checksum;
+	/** Total length of decompressed data */
+	size_t total;
+	/** Sliding window */
+	uint8_t window[DEFLATE_WINDOW_SIZE];
+};
+
+/** A chunk of data */
+struct deflate_chunk {
+	/** Data */
+	void *data;
+	/** Current offset */
+	size_t offset;
+	/** Length of data */
+	size_t len;
+};
+
+/**
+ * Initialise chunk of data
+ *
+ * @v chunk		Chunk of data to initialise
+ * @v data		Data
+ * @v offset		Starting offset
+ * @v len		Length
+ */
+static inline __attribute__ (( always_inline )) void
+deflate_chunk_init ( struct deflate_chunk *chunk, void *data,
+		     size_t offset, size_t len ) {
+
+	chunk->data = data;
+	chunk->offset = offset;
+	chunk->len = len;
+}
+
+/**
+ * Check if decompression has finished
+ *
+ * @v deflate		Decompressor
+ * @ret finished	Decompression has finished
+ */
+static inline int deflate_finished ( struct deflate *deflate ) {
+	return ( deflate->state == DEFLATE_DONE );
+}
+
+extern void deflate_init ( struct deflate *deflate,
+			   enum deflate_format format );
+extern int deflate_inflate ( struct deflate *deflate,
+			     struct deflate_chunk *in,
+			     struct deflate_chunk *out );
+
+#endif /* _IPXE_DEFLATE_H */
@@ -84,6 +84,8 @@ struct root_device {
 	struct device dev;
 	/** Root device driver */
 	struct root_driver *driver;
+	/** Probing of some devices has been deferred */
+	int deferred;
 };
 
 /** A root device driver */
@@ -136,4 +138,8 @@ extern struct device * identify_device ( struct interface *intf );
 #define identify_device_TYPE( object_type ) \
 	typeof ( struct device * ( object_type ) )
 
+extern void probe_device_first ( struct device_description *desc );
+extern int probe_device_now ( struct device_description *desc );
+extern void probe_deferred_devices ( void );
+
 #endif /* _IPXE_DEVICE_H */
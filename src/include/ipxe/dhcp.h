@@ -83,6 +83,9 @@ struct dhcp_packet;
 /** Root path */
 #define DHCP_ROOT_PATH 17
 
+/** Interface MTU */
+#define DHCP_MTU 26
+
 /** Vendor encapsulated options */
 #define DHCP_VENDOR_ENCAP 43
 
@@ -238,6 +241,14 @@ struct dhcp_client_id {
 /** User class identifier */
 #define DHCP_USER_CLASS_ID 77
 
+/** Rapid commit
+ *
+ * This zero-length option indicates that the client is prepared to
+ * accept an immediate DHCPACK in response to its DHCPDISCOVER, as
+ * defined in RFC 4039.
+ */
+#define DHCP_RAPID_COMMIT 80
+
 /** Client system architecture */
 #define DHCP_CLIENT_ARCHITECTURE 93
 
@@ -404,6 +415,14 @@ struct dhcp_netdev_desc {
  */
 #define DHCP_EB_USE_CACHED DHCP_ENCAP_OPT ( DHCP_EB_ENCAP, 0xb2 )
 
+/** Maximum time to wait for ProxyDHCP responses
+ *
+ * This is the time (in milliseconds) for which DHCP will wait for
+ * ProxyDHCP responses once a DHCPOFFER has been received.  It may be
+ * used to reduce (but not to extend) the default waiting time.
+ */
+#define DHCP_EB_PROXYDHCP_WAIT DHCP_ENCAP_OPT ( DHCP_EB_ENCAP, 0xb3 )
+
 /** BIOS drive number
  *
  * This is the drive number for a drive emulated via INT 13.  0x80 is
@@ -635,6 +654,9 @@ struct dhcphdr {
 /** Maximum time that we will wait for ProxyDHCP responses */
 #define PROXYDHCP_MAX_TIMEOUT ( 2 * TICKS_PER_SEC )
 
+/** Maximum time that we will wait for a DHCPACK to an INIT-REBOOT request */
+#define DHCP_REBOOT_MAX_TIMEOUT ( 3 * TICKS_PER_SEC )
+
 /** Maximum time that we will wait for Boot Server responses */
 #define PXEBS_MAX_TIMEOUT ( 3 * TICKS_PER_SEC )
 
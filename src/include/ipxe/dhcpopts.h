@@ -26,6 +26,15 @@ struct dhcp_options {
 	 * @ret rc		Return status code
 	 */
 	int ( * realloc ) ( struct dhcp_options *options, size_t len );
+	/** Index is valid */
+	int indexed;
+	/** Option index
+	 *
+	 * Each entry holds one plus the offset of the first top-level
+	 * option with the corresponding tag, or zero if there is no
+	 * such option.
+	 */
+	uint16_t index[256];
 };
 
 extern int dhcpopt_applies ( unsigned int tag );
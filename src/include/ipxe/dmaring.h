@@ -0,0 +1,142 @@
+#ifndef _IPXE_DMARING_H
+#define _IPXE_DMARING_H
+
+/** @file
+ *
+ * DMA descriptor rings
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Minimum descriptor ring alignment
+ *
+ * Descriptor rings are always aligned to at least this boundary (a
+ * typical cacheline size), so that no cacheline is ever shared
+ * between a descriptor ring and unrelated data.
+ */
+#define DMA_RING_ALIGN 64
+
+/** A DMA descriptor ring */
+struct dma_ring {
+	/** Descriptors */
+	void *desc;
+	/** Producer counter */
+	unsigned int prod;
+	/** Consumer counter */
+	unsigned int cons;
+	/** Producer counter as last notified to hardware */
+	unsigned int notified;
+
+	/** Number of descriptors */
+	unsigned int count;
+	/** Length of each descriptor (in bytes) */
+	size_t size;
+	/** Length of ring (in bytes) */
+	size_t len;
+};
+
+/**
+ * Initialise descriptor ring
+ *
+ * @v ring		Descriptor ring
+ * @v count		Number of descriptors
+ * @v size		Length of each descriptor
+ */
+static inline __attribute__ (( always_inline )) void
+dma_ring_init ( struct dma_ring *ring, unsigned int count, size_t size ) {
+	ring->count = count;
+	ring->size = size;
+	ring->len = ( count * size );
+}
+
+/**
+ * Calculate number of descriptors currently in use
+ *
+ * @v ring		Descriptor ring
+ * @ret fill		Number of descriptors owned by hardware
+ */
+static inline __attribute__ (( always_inline )) unsigned int
+dma_ring_fill ( struct dma_ring *ring ) {
+	return ( ring->prod - ring->cons );
+}
+
+/**
+ * Calculate number of descriptors currently available
+ *
+ * @v ring		Descriptor ring
+ * @ret space		Number of free descriptors
+ */
+static inline __attribute__ (( always_inline )) unsigned int
+dma_ring_space ( struct dma_ring *ring ) {
+	return ( ring->count - dma_ring_fill ( ring ) );
+}
+
+/**
+ * Convert producer or consumer counter to descriptor index
+ *
+ * @v ring		Descriptor ring
+ * @v counter		Producer or consumer counter
+ * @ret index		Descriptor index
+ */
+static inline __attribute__ (( always_inline )) unsigned int
+dma_ring_index ( struct dma_ring *ring, unsigned int counter ) {
+	return ( counter % ring->count );
+}
+
+/**
+ * Get descriptor
+ *
+ * @v ring		Descriptor ring
+ * @v index		Descriptor index
+ * @ret desc		Descriptor
+ */
+static inline __attribute__ (( always_inline )) void *
+dma_ring_desc ( struct dma_ring *ring, unsigned int index ) {
+	return ( ring->desc + ( index * ring->size ) );
+}
+
+/**
+ * Prefetch descriptor
+ *
+ * @v ring		Descriptor ring
+ * @v counter		Producer or consumer counter
+ *
+ * Drivers that poll a descriptor ring may use this to start fetching
+ * the following descriptor while the current one is being processed.
+ */
+static inline __attribute__ (( always_inline )) void
+dma_ring_prefetch ( struct dma_ring *ring, unsigned int counter ) {
+	__builtin_prefetch ( dma_ring_desc ( ring,
+					     dma_ring_index ( ring, counter ) ) );
+}
+
+/**
+ * Check for descriptors not yet notified to hardware
+ *
+ * @v ring		Descriptor ring
+ * @ret notify		Hardware should be notified
+ *
+ * Drivers may produce several descriptors before notifying the
+ * hardware (e.g. by writing the ring tail register, using the value
+ * of dma_ring_index() for the producer counter) only once.  This
+ * function returns true if any descriptors have been produced since
+ * the previous notification, and records that the hardware is now
+ * being notified.
+ */
+static inline __attribute__ (( always_inline )) int
+dma_ring_notify ( struct dma_ring *ring ) {
+	if ( ring->notified == ring->prod )
+		return 0;
+	ring->notified = ring->prod;
+	return 1;
+}
+
+extern int dma_ring_alloc ( struct dma_ring *ring, size_t align );
+extern void dma_ring_free ( struct dma_ring *ring );
+
+#endif /* _IPXE_DMARING_H */
@@ -19,6 +19,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 
 #define DNS_TYPE_A		1
 #define DNS_TYPE_CNAME		5
+#define DNS_TYPE_SOA		6
 #define DNS_TYPE_ANY		255
 
 #define DNS_CLASS_IN		1
@@ -83,10 +84,25 @@ struct dns_rr_info_cname {
 	char cname[0];
 } __attribute__ (( packed ));
 
+struct dns_rr_info_soa {
+	struct dns_rr_info_common common;
+	char mname[0];
+} __attribute__ (( packed ));
+
+/** Fixed-length portion of SOA record, following the two names */
+struct dns_soa_info {
+	uint32_t	serial;
+	uint32_t	refresh;
+	uint32_t	retry;
+	uint32_t	expire;
+	uint32_t	minimum;
+} __attribute__ (( packed ));
+
 union dns_rr_info {
 	struct dns_rr_info_common common;
 	struct dns_rr_info_a a;
 	struct dns_rr_info_cname cname;
+	struct dns_rr_info_soa soa;
 };
 
 #endif /* _IPXE_DNS_H */
@@ -144,5 +144,7 @@ extern EFI_STATUS efi_init ( EFI_HANDLE image_handle,
 			     EFI_SYSTEM_TABLE *systab );
 extern int efi_download_install ( EFI_HANDLE *device_handle );
 extern void efi_download_uninstall ( EFI_HANDLE device_handle );
+extern int efi_file_install ( EFI_HANDLE *handle );
+extern void efi_file_uninstall ( EFI_HANDLE handle );
 
 #endif /* _IPXE_EFI_H */
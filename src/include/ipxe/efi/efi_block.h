@@ -0,0 +1,26 @@
+#ifndef _IPXE_EFI_BLOCK_H
+#define _IPXE_EFI_BLOCK_H
+
+/** @file
+ *
+ * EFI block device protocols
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#ifdef SANBOOT_EFI
+#define SANBOOT_PREFIX_efi
+#else
+#define SANBOOT_PREFIX_efi __efi_
+#endif
+
+static inline __always_inline unsigned int
+SANBOOT_INLINE ( efi, san_default_drive ) ( void ) {
+	/* Drive numbers mean nothing to EFI; use the first hard disk
+	 * number simply for consistency with the BIOS.
+	 */
+	return 0x80;
+}
+
+#endif /* _IPXE_EFI_BLOCK_H */
@@ -29,6 +29,8 @@ struct efi_pci_device {
 	EFI_DEVICE_PATH_PROTOCOL *path;
 	/** EFI driver */
 	struct efi_driver *efidrv;
+	/** DMA pool mapping, if any */
+	void *mapping;
 };
 
 extern struct efi_pci_device * efipci_create ( struct efi_driver *efidrv,
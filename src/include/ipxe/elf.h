@@ -10,8 +10,55 @@
 
 FILE_LICENCE ( GPL2_OR_LATER );
 
+#include <stddef.h>
 #include <elf.h>
+#include <ipxe/uaccess.h>
+
+struct image;
+
+/** ELF segment stream states */
+enum elf_stream_state {
+	/** Not streaming */
+	ELF_STREAM_IDLE = 0,
+	/** Awaiting ELF and program headers */
+	ELF_STREAM_HEADERS,
+	/** Loading segments */
+	ELF_STREAM_LOADING,
+};
+
+/** An ELF segment stream
+ *
+ * An ELF segment stream loads the segments of an ELF image into
+ * memory as the image is being downloaded, so that they do not need
+ * to be copied into place once the download is complete.
+ */
+struct elf_stream {
+	/** Current state */
+	enum elf_stream_state state;
+	/** Length of data received so far */
+	size_t pos;
+	/** Image data buffer at the time segments were prepared */
+	userptr_t data;
+	/** Segment generation after preparing segments */
+	unsigned long generation;
+};
+
+/**
+ * Initialise ELF segment stream
+ *
+ * @v stream		ELF segment stream
+ */
+static inline void elf_stream_init ( struct elf_stream *stream ) {
+	stream->state = ELF_STREAM_HEADERS;
+	stream->pos = 0;
+	stream->data = UNULL;
+	stream->generation = 0;
+}
 
 extern int elf_load ( struct image *image, physaddr_t *entry, physaddr_t *max );
+extern void elf_stream ( struct elf_stream *stream, struct image *image,
+			 size_t pos, size_t len );
+extern void elf_stream_finish ( struct elf_stream *stream,
+				struct image *image );
 
 #endif /* _IPXE_ELF_H */
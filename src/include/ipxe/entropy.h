@@ -55,6 +55,7 @@ typedef uint8_t entropy_sample_t;
 /* Include all architecture-independent entropy API headers */
 #include <ipxe/null_entropy.h>
 #include <ipxe/linux/linux_entropy.h>
+#include <ipxe/efi/efi_entropy.h>
 
 /* Include all architecture-dependent entropy API headers */
 #include <bits/entropy.h>
@@ -61,6 +61,13 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #define ERRFILE_edd		       ( ERRFILE_CORE | 0x00150000 )
 #define ERRFILE_parseopt	       ( ERRFILE_CORE | 0x00160000 )
 #define ERRFILE_test		       ( ERRFILE_CORE | 0x00170000 )
+#define ERRFILE_blockcache	       ( ERRFILE_CORE | 0x00180000 )
+#define ERRFILE_blockstat	       ( ERRFILE_CORE | 0x00190000 )
+#define ERRFILE_deflate		       ( ERRFILE_CORE | 0x001a0000 )
+#define ERRFILE_lz4		       ( ERRFILE_CORE | 0x001b0000 )
+#define ERRFILE_log		       ( ERRFILE_CORE | 0x001c0000 )
+#define ERRFILE_multijob	       ( ERRFILE_CORE | 0x001d0000 )
+#define ERRFILE_timeline	       ( ERRFILE_CORE | 0x001e0000 )
 
 #define ERRFILE_eisa		     ( ERRFILE_DRIVER | 0x00000000 )
 #define ERRFILE_isa		     ( ERRFILE_DRIVER | 0x00010000 )
@@ -146,6 +153,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #define ERRFILE_skeleton	     ( ERRFILE_DRIVER | 0x00640000 )
 #define ERRFILE_intel		     ( ERRFILE_DRIVER | 0x00650000 )
 #define ERRFILE_myson		     ( ERRFILE_DRIVER | 0x00660000 )
+#define ERRFILE_dmaring		     ( ERRFILE_DRIVER | 0x00670000 )
 
 #define ERRFILE_scsi		     ( ERRFILE_DRIVER | 0x00700000 )
 #define ERRFILE_arbel		     ( ERRFILE_DRIVER | 0x00710000 )
@@ -154,6 +162,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #define ERRFILE_ata		     ( ERRFILE_DRIVER | 0x00740000 )
 #define ERRFILE_srp		     ( ERRFILE_DRIVER | 0x00750000 )
 #define ERRFILE_qib7322		     ( ERRFILE_DRIVER | 0x00760000 )
+#define ERRFILE_af_packet	     ( ERRFILE_DRIVER | 0x00770000 )
 
 #define ERRFILE_aoe			( ERRFILE_NET | 0x00000000 )
 #define ERRFILE_arp			( ERRFILE_NET | 0x00010000 )
@@ -204,6 +213,12 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #define ERRFILE_fcoe			( ERRFILE_NET | 0x002e0000 )
 #define ERRFILE_fcns			( ERRFILE_NET | 0x002f0000 )
 #define ERRFILE_vlan			( ERRFILE_NET | 0x00300000 )
+#define ERRFILE_mcast			( ERRFILE_NET | 0x00310000 )
+#define ERRFILE_httpgzip		( ERRFILE_NET | 0x00320000 )
+#define ERRFILE_syslog			( ERRFILE_NET | 0x00330000 )
+#define ERRFILE_syslogs			( ERRFILE_NET | 0x00340000 )
+#define ERRFILE_bond			( ERRFILE_NET | 0x00350000 )
+#define ERRFILE_pcap			( ERRFILE_NET | 0x00360000 )
 
 #define ERRFILE_image		      ( ERRFILE_IMAGE | 0x00000000 )
 #define ERRFILE_elf		      ( ERRFILE_IMAGE | 0x00010000 )
@@ -258,6 +273,19 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #define ERRFILE_imgtrust	      ( ERRFILE_OTHER | 0x002b0000 )
 #define ERRFILE_menu_ui		      ( ERRFILE_OTHER | 0x002c0000 )
 #define ERRFILE_menu_cmd	      ( ERRFILE_OTHER | 0x002d0000 )
+#define ERRFILE_blockcache_test	      ( ERRFILE_OTHER | 0x002e0000 )
+#define ERRFILE_netbench	      ( ERRFILE_OTHER | 0x002f0000 )
+#define ERRFILE_netbench_cmd	      ( ERRFILE_OTHER | 0x00300000 )
+#define ERRFILE_log_test	      ( ERRFILE_OTHER | 0x00310000 )
+#define ERRFILE_rdrand		      ( ERRFILE_OTHER | 0x00320000 )
+#define ERRFILE_efi_entropy	      ( ERRFILE_OTHER | 0x00330000 )
+#define ERRFILE_efi_file	      ( ERRFILE_OTHER | 0x00340000 )
+#define ERRFILE_trace_cmd	      ( ERRFILE_OTHER | 0x00350000 )
+#define ERRFILE_efi_block	      ( ERRFILE_OTHER | 0x00360000 )
+#define ERRFILE_net_bench	      ( ERRFILE_OTHER | 0x00370000 )
+#define ERRFILE_deflate_test	      ( ERRFILE_OTHER | 0x00380000 )
+#define ERRFILE_lz4_test	      ( ERRFILE_OTHER | 0x00390000 )
+#define ERRFILE_tcp_test	      ( ERRFILE_OTHER | 0x003a0000 )
 
 /** @} */
 
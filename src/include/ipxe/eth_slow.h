@@ -9,6 +9,9 @@
 
 FILE_LICENCE ( GPL2_OR_LATER );
 
+#include <stdint.h>
+#include <ipxe/if_ether.h>
+
 /** Slow protocols header */
 struct eth_slow_header {
 	/** Slow protocols subtype */
@@ -252,4 +255,6 @@ union eth_slow_packet {
 	struct eth_slow_marker marker;
 } __attribute__ (( packed ));
 
+extern const uint8_t eth_slow_address[ETH_ALEN];
+
 #endif /* _IPXE_ETH_SLOW_H */
@@ -79,6 +79,8 @@ static inline int is_valid_ether_addr ( const void *addr ) {
 		 ( ! is_zero_ether_addr ( addr ) ) );
 }
 
+extern struct ll_protocol ethernet_protocol __ll_protocol;
+
 extern int eth_push ( struct net_device *netdev, struct io_buffer *iobuf,
 		      const void *ll_dest, const void *ll_source,
 		      uint16_t net_proto );
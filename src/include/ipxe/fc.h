@@ -323,6 +323,7 @@ extern int fc_port_login ( struct fc_port *port, struct fc_port_id *port_id,
 			   const struct fc_name *link_port_wwn,
 			   int has_fabric );
 extern void fc_port_logout ( struct fc_port *port, int rc );
+extern size_t fc_port_mtu ( struct fc_port *port );
 extern int fc_port_open ( struct interface *transport,
 			  const struct fc_name *node_wwn,
 			  const struct fc_name *port_wwn,
@@ -354,6 +355,8 @@ struct fc_peer {
 	struct fc_port *port;
 	/** Peer port ID, if known */
 	struct fc_port_id port_id;
+	/** Receive data field size, if known */
+	size_t mtu;
 
 	/** List of upper-layer protocols */
 	struct list_head ulps;
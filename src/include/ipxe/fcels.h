@@ -167,6 +167,15 @@ struct fc_login_common {
 /** Fibre Channel default MTU */
 #define FC_LOGIN_DEFAULT_MTU 1452
 
+/** Fibre Channel maximum MTU */
+#define FC_LOGIN_MAX_MTU 2112
+
+/** Fibre Channel minimum MTU */
+#define FC_LOGIN_MIN_MTU 256
+
+/** Receive data field size mask */
+#define FC_LOGIN_MTU_MASK 0x0fff
+
 /** Default maximum number of concurrent sequences */
 #define FC_LOGIN_DEFAULT_MAX_SEQ 255
 
@@ -0,0 +1,125 @@
+#ifndef _IPXE_GCM_H
+#define _IPXE_GCM_H
+
+/** @file
+ *
+ * Galois/Counter Mode (GCM)
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <ipxe/crypto.h>
+
+/** GCM block size */
+#define GCM_BLOCKSIZE 16
+
+/** GCM initialisation vector length
+ *
+ * Only the recommended 96-bit initialisation vector length is
+ * supported.
+ */
+#define GCM_IV_LEN 12
+
+/** GCM authentication tag size */
+#define GCM_AUTHSIZE 16
+
+/** A GCM block */
+union gcm_block {
+	/** Raw bytes */
+	uint8_t byte[GCM_BLOCKSIZE];
+	/** Raw quadwords */
+	uint64_t qword[ GCM_BLOCKSIZE / sizeof ( uint64_t ) ];
+};
+
+/** GCM context */
+struct gcm_context {
+	/** Accumulated hash (X) */
+	union gcm_block hash;
+	/** Counter (Y) */
+	union gcm_block ctr;
+	/** Initial counter (Y0) */
+	union gcm_block iv;
+	/** Length of additional data (in bytes) */
+	uint64_t add_len;
+	/** Length of encrypted data (in bytes) */
+	uint64_t data_len;
+	/** Multiples of hash key (H), high quadwords */
+	uint64_t hh[16];
+	/** Multiples of hash key (H), low quadwords */
+	uint64_t hl[16];
+};
+
+extern int gcm_setkey ( void *ctx, const void *key, size_t keylen,
+			struct cipher_algorithm *raw_cipher,
+			struct gcm_context *gcm_ctx );
+extern void gcm_setiv ( void *ctx, const void *iv,
+			struct cipher_algorithm *raw_cipher,
+			struct gcm_context *gcm_ctx );
+extern void gcm_encrypt ( void *ctx, const void *src, void *dst,
+			  size_t len, struct cipher_algorithm *raw_cipher,
+			  struct gcm_context *gcm_ctx );
+extern void gcm_decrypt ( void *ctx, const void *src, void *dst,
+			  size_t len, struct cipher_algorithm *raw_cipher,
+			  struct gcm_context *gcm_ctx );
+extern void gcm_auth ( void *ctx, void *auth,
+		       struct cipher_algorithm *raw_cipher,
+		       struct gcm_context *gcm_ctx );
+
+/**
+ * Create a GCM mode of behaviour of an existing cipher
+ *
+ * @v _gcm_name		Name for the new GCM cipher
+ * @v _gcm_cipher	New cipher algorithm
+ * @v _raw_cipher	Underlying cipher algorithm
+ * @v _raw_context	Context structure for the underlying cipher
+ *
+ * The underlying cipher must have a block size of @c GCM_BLOCKSIZE.
+ */
+#define GCM_CIPHER( _gcm_name, _gcm_cipher, _raw_cipher, _raw_context )	\
+struct _gcm_name ## _context {						\
+	_raw_context raw_ctx;						\
+	struct gcm_context gcm_ctx;					\
+};									\
+static int _gcm_name ## _setkey ( void *ctx, const void *key,		\
+				  size_t keylen ) {			\
+	struct _gcm_name ## _context * _gcm_name ## _ctx = ctx;		\
+	return gcm_setkey ( &_gcm_name ## _ctx->raw_ctx, key, keylen,	\
+			    &_raw_cipher, &_gcm_name ## _ctx->gcm_ctx );\
+}									\
+static void _gcm_name ## _setiv ( void *ctx, const void *iv ) {		\
+	struct _gcm_name ## _context * _gcm_name ## _ctx = ctx;		\
+	gcm_setiv ( &_gcm_name ## _ctx->raw_ctx, iv,			\
+		    &_raw_cipher, &_gcm_name ## _ctx->gcm_ctx );	\
+}									\
+static void _gcm_name ## _encrypt ( void *ctx, const void *src,		\
+				    void *dst, size_t len ) {		\
+	struct _gcm_name ## _context * _gcm_name ## _ctx = ctx;		\
+	gcm_encrypt ( &_gcm_name ## _ctx->raw_ctx, src, dst, len,	\
+		      &_raw_cipher, &_gcm_name ## _ctx->gcm_ctx );	\
+}									\
+static void _gcm_name ## _decrypt ( void *ctx, const void *src,		\
+				    void *dst, size_t len ) {		\
+	struct _gcm_name ## _context * _gcm_name ## _ctx = ctx;		\
+	gcm_decrypt ( &_gcm_name ## _ctx->raw_ctx, src, dst, len,	\
+		      &_raw_cipher, &_gcm_name ## _ctx->gcm_ctx );	\
+}									\
+static void _gcm_name ## _auth ( void *ctx, void *auth ) {		\
+	struct _gcm_name ## _context * _gcm_name ## _ctx = ctx;		\
+	gcm_auth ( &_gcm_name ## _ctx->raw_ctx, auth,			\
+		   &_raw_cipher, &_gcm_name ## _ctx->gcm_ctx );		\
+}									\
+struct cipher_algorithm _gcm_cipher = {					\
+	.name		= #_gcm_name,					\
+	.ctxsize	= sizeof ( struct _gcm_name ## _context ),	\
+	.blocksize	= 1,						\
+	.authsize	= GCM_AUTHSIZE,					\
+	.setkey		= _gcm_name ## _setkey,				\
+	.setiv		= _gcm_name ## _setiv,				\
+	.encrypt	= _gcm_name ## _encrypt,			\
+	.decrypt	= _gcm_name ## _decrypt,			\
+	.auth		= _gcm_name ## _auth,				\
+};
+
+#endif /* _IPXE_GCM_H */
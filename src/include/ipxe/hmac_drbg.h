@@ -11,6 +11,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 
 #include <stdint.h>
 #include <ipxe/crypto.h>
+#include <ipxe/sha256.h>
 
 /** Declare an HMAC_DRBG algorithm
  *
@@ -205,6 +206,13 @@ FILE_LICENCE ( GPL2_OR_LATER );
  */
 #define HMAC_DRBG_RESEED_INTERVAL 1024
 
+/** Maximum underlying hash algorithm context size
+ *
+ * This is the context size of the largest hash algorithm currently
+ * available for use with HMAC_DRBG.
+ */
+#define HMAC_DRBG_MAX_CTX_SIZE SHA256_CTX_SIZE
+
 /**
  * HMAC_DRBG internal state
  *
@@ -228,6 +236,18 @@ struct hmac_drbg_state {
 	 * time that the DRBG mechanism generates pseudorandom bits."
 	 */
 	uint8_t key[HMAC_DRBG_MAX_OUTLEN_BYTES];
+	/** Inner hash context for current key
+	 *
+	 * This is the hash context after processing ( Key XOR ipad ),
+	 * which is the same for every HMAC calculated using the
+	 * current key.
+	 */
+	uint8_t inner[HMAC_DRBG_MAX_CTX_SIZE];
+	/** Outer hash context for current key
+	 *
+	 * This is the hash context after processing ( Key XOR opad ).
+	 */
+	uint8_t outer[HMAC_DRBG_MAX_CTX_SIZE];
 	/** Reseed counter
 	 *
 	 * "A counter (reseed_counter) that indicates the number of
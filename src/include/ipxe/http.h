@@ -9,16 +9,45 @@
 
 FILE_LICENCE ( GPL2_OR_LATER );
 
+#include <ipxe/tables.h>
+
+struct interface;
+struct uri;
+
 /** HTTP default port */
 #define HTTP_PORT 80
 
 /** HTTPS default port */
 #define HTTPS_PORT 443
 
+/** An HTTP content encoding */
+struct http_content_encoding {
+	/** Name (e.g. "gzip") */
+	const char *name;
+	/**
+	 * Start decoding received content
+	 *
+	 * @v xfer		Data transfer interface
+	 * @ret rc		Return status code
+	 *
+	 * The decoder must insert itself between the data transfer
+	 * interface and its current destination.
+	 */
+	int ( * decode ) ( struct interface *xfer );
+};
+
+/** HTTP content encoding table */
+#define HTTP_CONTENT_ENCODINGS \
+	__table ( struct http_content_encoding, "http_content_encodings" )
+
+/** Declare an HTTP content encoding */
+#define __http_content_encoding __table_entry ( HTTP_CONTENT_ENCODINGS, 01 )
+
 extern int http_open_filter ( struct interface *xfer, struct uri *uri,
 			      unsigned int default_port,
 			      int ( * filter ) ( struct interface *,
 						 const char *,
+						 unsigned int,
 						 struct interface ** ) );
 
 #endif /* _IPXE_HTTP_H */
@@ -27,7 +27,8 @@ struct ib_mc_membership {
 	 * @v qp		Queue pair
 	 * @v membership	Multicast group membership
 	 * @v rc		Status code
-	 * @v mad		Response MAD (or NULL on error)
+	 * @v mad		Response MAD (or NULL on error, or if
+	 *			the group was already known)
 	 */
 	void ( * complete ) ( struct ib_device *ibdev, struct ib_queue_pair *qp,
 			      struct ib_mc_membership *membership, int rc,
@@ -19,7 +19,21 @@ struct icmp_header {
 	uint16_t chksum;
 } __attribute__ (( packed ));
 
+/** An ICMP "fragmentation needed" message header */
+struct icmp_frag_needed {
+	/** ICMP header */
+	struct icmp_header icmp;
+	/** Unused */
+	uint16_t unused;
+	/** Next-hop MTU, or zero if not provided by the router */
+	uint16_t mtu;
+} __attribute__ (( packed ));
+
 #define ICMP_ECHO_RESPONSE 0
+#define ICMP_DESTINATION_UNREACHABLE 3
 #define ICMP_ECHO_REQUEST 8
 
+/** "Fragmentation needed" destination unreachable code */
+#define ICMP_FRAGMENTATION_NEEDED 4
+
 #endif /* _IPXE_ICMP_H */
@@ -9,6 +9,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #define ETH_HLEN		14	/* Size of ethernet header */
 #define	ETH_ZLEN		60	/* Minimum packet */
 #define	ETH_FRAME_LEN		1514	/* Maximum packet */
+#define ETH_JUMBO_FRAME_LEN	9014	/* Maximum jumbo packet */
 #define ETH_DATA_ALIGN		2	/* Amount needed to align the data after an ethernet header */
 #ifndef	ETH_MAX_MTU
 #define	ETH_MAX_MTU		(ETH_FRAME_LEN-ETH_HLEN)
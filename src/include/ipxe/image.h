@@ -17,6 +17,15 @@ FILE_LICENCE ( GPL2_OR_LATER );
 
 struct uri;
 struct image_type;
+struct digest_algorithm;
+
+/** A digest of image contents */
+struct image_digest {
+	/** Digest algorithm */
+	struct digest_algorithm *digest;
+	/** Digest value */
+	uint8_t out[0];
+};
 
 /** An executable image */
 struct image {
@@ -43,6 +52,16 @@ struct image {
 	/** Image type, if known */
 	struct image_type *type;
 
+	/** Digest of image contents, if calculated during download */
+	struct image_digest *digest;
+	/** Segment generation at which the image was loaded into memory
+	 * during download, or zero
+	 *
+	 * Code replacing the contents of an image must reset this to
+	 * zero.
+	 */
+	unsigned long preloaded;
+
 	/** Replacement image
 	 *
 	 * An image wishing to replace itself with another image (in a
@@ -67,6 +86,16 @@ struct image {
 /** Image is trusted */
 #define IMAGE_TRUSTED 0x0004
 
+/** Image was prefetched and has not yet been used */
+#define IMAGE_PREFETCHED 0x0008
+
+/** Image type has been probed
+ *
+ * Code replacing the contents of an image after it has been probed
+ * must clear this flag and reset the image type.
+ */
+#define IMAGE_PROBED 0x0010
+
 /** An executable image type */
 struct image_type {
 	/** Name of this image type */
@@ -128,6 +128,7 @@ struct interface {
 extern void intf_plug ( struct interface *intf, struct interface *dest );
 extern void intf_plug_plug ( struct interface *a, struct interface *b );
 extern void intf_unplug ( struct interface *intf );
+extern void intf_splice ( struct interface *a, struct interface *b );
 extern void intf_nullify ( struct interface *intf );
 extern struct interface * intf_get ( struct interface *intf );
 extern void intf_put ( struct interface *intf );
@@ -147,6 +148,7 @@ extern void intf_restart ( struct interface *intf, int rc );
 
 extern struct interface_descriptor null_intf_desc;
 extern struct interface null_intf;
+extern unsigned long intf_generation;
 
 /**
  * Initialise an object interface
@@ -161,6 +163,7 @@ static inline void intf_init ( struct interface *intf,
 	intf->dest = &null_intf;
 	intf->refcnt = refcnt;
 	intf->desc = desc;
+	intf_generation++;
 }
 
 /**
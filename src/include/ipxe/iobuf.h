@@ -33,6 +33,24 @@ FILE_LICENCE ( GPL2_OR_LATER );
  */
 #define IOB_ZLEN 64
 
+/**
+ * Number of I/O buffer pool size classes
+ *
+ * Freed I/O buffers whose total size (including the descriptor) is
+ * exactly ( @c IOB_ALIGN << n ), for n in the range [ 0, @c
+ * IOB_POOL_CLASSES ), are retained in a per-size-class pool for
+ * reuse by subsequent calls to alloc_iob().
+ */
+#define IOB_POOL_CLASSES 2
+
+/**
+ * Maximum number of I/O buffers retained in each pool size class
+ *
+ * Pooled I/O buffers are released back to the heap when memory is
+ * required for other purposes.
+ */
+#define IOB_POOL_MAX 8
+
 /**
  * A persistent I/O buffer
  *
@@ -57,8 +75,34 @@ struct io_buffer {
 	void *tail;
 	/** End of the buffer */
         void *end;
+	/** Flags
+	 *
+	 * This is the bitwise-OR of zero or more IOB_XXX constants.
+	 */
+	unsigned int flags;
+	/** Next fragment of a multi-fragment packet, or NULL
+	 *
+	 * A packet may be constructed as a chain of I/O buffers
+	 * (e.g. a buffer containing the protocol headers followed by
+	 * buffers containing the payload).  The chain is owned by
+	 * the first I/O buffer, and freeing the first I/O buffer
+	 * will free the whole chain.
+	 */
+	struct io_buffer *frag;
+	/** I/O buffer containing the data, or NULL
+	 *
+	 * An I/O buffer created via alloc_iob_ref() refers to data
+	 * held within another I/O buffer, and holds a reference to
+	 * that I/O buffer.
+	 */
+	struct io_buffer *owner;
+	/** Number of references held by other I/O buffers */
+	unsigned int refs;
 };
 
+/** Transport-layer checksum has already been verified by hardware */
+#define IOB_CSUM_VERIFIED 0x0001
+
 /**
  * Reserve space at start of I/O buffer
  *
@@ -199,6 +243,38 @@ static inline void iob_populate ( struct io_buffer *iobuf,
 	iobuf->head = iobuf->data = data;
 	iobuf->tail = ( data + len );
 	iobuf->end = ( data + max_len );
+	iobuf->flags = 0;
+	iobuf->frag = NULL;
+	iobuf->owner = NULL;
+	iobuf->refs = 0;
+}
+
+/**
+ * Calculate total length of data in a multi-fragment I/O buffer
+ *
+ * @v iobuf	I/O buffer
+ * @ret len	Length of data in all fragments
+ */
+static inline size_t iob_total_len ( struct io_buffer *iobuf ) {
+	size_t len = 0;
+
+	for ( ; iobuf ; iobuf = iobuf->frag )
+		len += iob_len ( iobuf );
+	return len;
+}
+
+/**
+ * Count fragments in a multi-fragment I/O buffer
+ *
+ * @v iobuf	I/O buffer
+ * @ret count	Number of fragments
+ */
+static inline unsigned int iob_frags ( struct io_buffer *iobuf ) {
+	unsigned int count = 0;
+
+	for ( ; iobuf ; iobuf = iobuf->frag )
+		count++;
+	return count;
 }
 
 /**
@@ -222,8 +298,12 @@ static inline void iob_populate ( struct io_buffer *iobuf,
 	__iobuf; } )
 
 extern struct io_buffer * __malloc alloc_iob ( size_t len );
+extern struct io_buffer * __malloc alloc_iob_ref ( struct io_buffer *owner,
+						   void *data, size_t len );
 extern void free_iob ( struct io_buffer *iobuf );
+extern struct io_buffer * iob_linearise ( struct io_buffer *iobuf );
 extern void iob_pad ( struct io_buffer *iobuf, size_t min_len );
 extern int iob_ensure_headroom ( struct io_buffer *iobuf, size_t len );
+extern int iob_expand ( struct io_buffer **iobuf, size_t len );
 
 #endif /* _IPXE_IOBUF_H */
@@ -26,6 +26,8 @@ struct io_buffer;
 #define IP_MASK_DONOTFRAG	0x4000U
 #define IP_MASK_MOREFRAGS	0x2000U
 #define IP_PSHLEN 	12
+#define IP_MAX_HLEN	60
+#define IP_MAX_LEN	0xffffU
 
 /* IP header defaults */
 #define IP_TOS		0
@@ -70,20 +72,81 @@ struct ipv4_miniroute {
 	struct in_addr gateway;
 };
 
+/** A hole in an IPv4 fragment reassembly buffer
+ *
+ * Holes are tracked as described in RFC 815.
+ */
+struct ipv4_fragment_hole {
+	/** List of holes */
+	struct list_head list;
+	/** Start offset of hole within payload */
+	size_t start;
+	/** End offset of hole within payload */
+	size_t end;
+};
+
 /* IPv4 fragment reassembly buffer */
 struct ipv4_fragment {
 	/* List of fragment reassembly buffers */
 	struct list_head list;
-	/** Reassembled packet */
+	/** Source address */
+	struct in_addr src;
+	/** Destination address */
+	struct in_addr dest;
+	/** Identification */
+	uint16_t ident;
+	/** Protocol */
+	uint8_t protocol;
+	/** Reassembled payload, or NULL
+	 *
+	 * The IPv4 header of the first fragment (if received) is held
+	 * in the headroom immediately preceding the payload.
+	 */
 	struct io_buffer *iobuf;
-	/** Current offset */
-	size_t offset;
+	/** Length of IPv4 header, or zero if first fragment not received */
+	size_t hdrlen;
+	/** Total payload length, or zero if final fragment not received */
+	size_t len;
+	/** List of holes not yet filled */
+	struct list_head holes;
 	/** Reassembly timer */
 	struct retry_timer timer;
 };
 
+/** A cached IPv4 path MTU */
+struct ipv4_pmtu {
+	/** Destination address, or zero if entry is unused */
+	struct in_addr dest;
+	/** Path MTU */
+	size_t mtu;
+	/** Time at which path MTU was recorded */
+	unsigned long recorded;
+};
+
+/** Number of cached IPv4 path MTUs */
+#define IPV4_PMTU_CACHE_SIZE 8
+
+/** Lifetime of a cached IPv4 path MTU
+ *
+ * RFC 1191 section 6.3 suggests that an increase in path MTU should
+ * be detected by discarding a reduced path MTU estimate after ten
+ * minutes.
+ */
+#define IPV4_PMTU_TIMEOUT ( 10 * 60 * TICKS_PER_SEC )
+
+/** Minimum accepted IPv4 path MTU
+ *
+ * This guards against reports of implausibly small path MTUs, which
+ * would otherwise reduce TCP segments to a few bytes each.  Packets
+ * to a destination whose path MTU has reached this minimum are sent
+ * without the "don't fragment" flag.
+ */
+#define IPV4_PMTU_MIN 576
+
 extern struct list_head ipv4_miniroutes;
 
 extern struct net_protocol ipv4_protocol __net_protocol;
 
+extern void ipv4_pmtu_update ( struct in_addr dest, size_t mtu );
+
 #endif /* _IPXE_IP_H */
@@ -11,6 +11,8 @@ FILE_LICENCE ( GPL2_OR_LATER );
 
 #include <stdint.h>
 #include <ipxe/in.h>
+#include <ipxe/list.h>
+#include <ipxe/retry.h>
 #include <ipxe/netdevice.h>
 #include <ipxe/tcpip.h>
 
@@ -19,6 +21,9 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #define IP6_VERSION	0x6
 #define IP6_HOP_LIMIT	255
 
+/** Maximum length of an IPv6 payload */
+#define IP6_MAX_LEN	0xffff
+
 /**
  * I/O buffer contents
  * This is duplicated in tcp.h and here. Ideally it should go into iobuf.h
@@ -56,14 +61,85 @@ struct ipv6_pseudo_header {
 };
 
 /* Next header numbers */
-#define IP6_HOPBYHOP 		0x00
-#define IP6_ROUTING 		0x43
-#define IP6_FRAGMENT		0x44
-#define IP6_AUTHENTICATION	0x51
-#define IP6_DEST_OPTS		0x60
-#define IP6_ESP			0x50
-#define IP6_ICMP6		0x58
-#define IP6_NO_HEADER		0x59
+#define IP6_HOPBYHOP 		0
+#define IP6_ROUTING 		43
+#define IP6_FRAGMENT		44
+#define IP6_AUTHENTICATION	51
+#define IP6_DEST_OPTS		60
+#define IP6_ESP			50
+#define IP6_ICMP6		58
+#define IP6_NO_HEADER		59
+
+/** IPv6 extension header (common portion) */
+struct ip6_ext_header {
+	/** Next header */
+	uint8_t nxt_hdr;
+	/** Length in 8-octet units, excluding the first 8 octets */
+	uint8_t len;
+} __attribute__ (( packed ));
+
+/** IPv6 routing header (common portion) */
+struct ip6_routing_header {
+	/** Next header */
+	uint8_t nxt_hdr;
+	/** Length in 8-octet units, excluding the first 8 octets */
+	uint8_t len;
+	/** Routing type */
+	uint8_t type;
+	/** Number of route segments remaining */
+	uint8_t segments_left;
+} __attribute__ (( packed ));
+
+/** IPv6 fragment header */
+struct ip6_fragment_header {
+	/** Next header */
+	uint8_t nxt_hdr;
+	/** Reserved */
+	uint8_t reserved;
+	/** Fragment offset (in 8-octet units) and flags */
+	uint16_t offset_flags;
+	/** Identification */
+	uint32_t ident;
+} __attribute__ (( packed ));
+
+/** IPv6 fragment offset mask */
+#define IP6_MASK_OFFSET		0xfff8
+
+/** IPv6 "more fragments" flag */
+#define IP6_MASK_MOREFRAGS	0x0001
+
+/** An IPv6 fragment reassembly buffer */
+struct ipv6_fragment {
+	/** List of fragment reassembly buffers */
+	struct list_head list;
+	/** Source address */
+	struct in6_addr src;
+	/** Destination address */
+	struct in6_addr dest;
+	/** Identification */
+	uint32_t ident;
+	/** Next header following the fragment header
+	 *
+	 * This is valid only once the first fragment has been
+	 * received.
+	 */
+	uint8_t nxt_hdr;
+	/** Reassembled payload, or NULL */
+	struct io_buffer *iobuf;
+	/** Total payload length, or zero if final fragment not received */
+	size_t len;
+	/** Length of payload received so far */
+	size_t received;
+	/** Bitmap of 8-octet blocks received so far
+	 *
+	 * Overlapping fragments are forbidden in IPv6 (RFC 5722), so
+	 * this is sufficient to determine when reassembly is
+	 * complete.
+	 */
+	uint8_t blocks[ ( ( IP6_MAX_LEN + 63 ) / 64 ) ];
+	/** Reassembly timer */
+	struct retry_timer timer;
+};
 
 struct io_buffer;
 
@@ -119,8 +119,10 @@ struct iscsi_bhs_common_response {
 	uint32_t statsn;
 	/** Expected command sequence number */
 	uint32_t expcmdsn;
+	/** Maximum command sequence number */
+	uint32_t maxcmdsn;
 	/** Fields specific to the PDU type */
-	uint8_t other_d[16];
+	uint8_t other_d[12];
 };
 
 /**
@@ -523,12 +525,72 @@ enum iscsi_rx_state {
 	ISCSI_RX_BHS = 0,
 	/** Receiving the additional header segment */
 	ISCSI_RX_AHS,
+	/** Receiving the header digest */
+	ISCSI_RX_HEADER_DIGEST,
 	/** Receiving the data segment */
 	ISCSI_RX_DATA,
 	/** Receiving the data segment padding */
 	ISCSI_RX_DATA_PADDING,
+	/** Receiving the data digest */
+	ISCSI_RX_DATA_DIGEST,
+};
+
+/** Maximum number of concurrent iSCSI tasks */
+#define ISCSI_MAX_TASKS 8
+
+/** Maximum number of consecutive iSCSI connection reinstatements
+ *
+ * This limits the number of times that a failed connection will be
+ * reinstated without any command completing successfully, before the
+ * session is abandoned.
+ */
+#define ISCSI_MAX_REINSTATEMENTS 3
+
+/** An iSCSI task */
+struct iscsi_task {
+	/** iSCSI session */
+	struct iscsi_session *iscsi;
+	/** SCSI command interface */
+	struct interface data;
+	/** SCSI command */
+	struct scsi_cmd command;
+	/** Task status
+	 *
+	 * This is the bitwise-OR of zero or more ISCSI_TASK_XXX
+	 * constants.
+	 */
+	unsigned int status;
+	/** Initiator task tag */
+	uint32_t itt;
+	/** Target transfer tag
+	 *
+	 * This is the tag attached to a sequence of data-out PDUs in
+	 * response to an R2T.
+	 */
+	uint32_t ttt;
+	/** Transfer offset
+	 *
+	 * This is the offset for an in-progress sequence of data-out
+	 * PDUs in response to an R2T.
+	 */
+	uint32_t transfer_offset;
+	/** Transfer length
+	 *
+	 * This is the length for an in-progress sequence of data-out
+	 * PDUs in response to an R2T.
+	 */
+	uint32_t transfer_len;
 };
 
+/** iSCSI task is in use */
+#define ISCSI_TASK_ACTIVE 0x0001
+
+/** iSCSI task needs to send its SCSI command PDU */
+#define ISCSI_TASK_TX_COMMAND 0x0002
+
+/** iSCSI task needs to send a sequence of data-out PDUs */
+#define ISCSI_TASK_TX_DATA_OUT 0x0004
+
 /** An iSCSI session */
 struct iscsi_session {
 	/** Reference counter */
@@ -536,8 +598,6 @@ struct iscsi_session {
 
 	/** SCSI command-issuing interface */
 	struct interface control;
-	/** SCSI command interface */
-	struct interface data;
 	/** Transport-layer socket */
 	struct interface socket;
 
@@ -577,42 +637,48 @@ struct iscsi_session {
 
 	/** Initiator session ID (IANA format) qualifier
 	 *
-	 * This is part of the ISID.  It is generated randomly
-	 * whenever a new connection is opened.
+	 * This is part of the ISID.  It is generated randomly when
+	 * the session is created, and is retained when a connection
+	 * is reinstated.
 	 */
 	uint16_t isid_iana_qual;
-	/** Initiator task tag
-	 *
-	 * This is the tag of the current command.  It is incremented
-	 * whenever a new command is started.
-	 */
-	uint32_t itt;
-	/** Target transfer tag
+	/** Target session identifying handle
 	 *
-	 * This is the tag attached to a sequence of data-out PDUs in
-	 * response to an R2T.
+	 * This is assigned by the target when login completes, and
+	 * is zero until then.  A non-zero value indicates that a
+	 * failed connection may be reinstated within the existing
+	 * session.
 	 */
-	uint32_t ttt;
-	/** Transfer offset
-	 *
-	 * This is the offset for an in-progress sequence of data-out
-	 * PDUs in response to an R2T.
+	uint16_t tsih;
+	/** Security negotiation is required on each new connection */
+	int auth_required;
+	/** Number of connection reinstatements since the last
+	 * successfully completed command
 	 */
-	uint32_t transfer_offset;
-	/** Transfer length
+	unsigned int reinstatements;
+	/** Initiator task tag
 	 *
-	 * This is the length for an in-progress sequence of data-out
-	 * PDUs in response to an R2T.
+	 * This is the tag used for login requests.  It is assigned
+	 * whenever a new connection is opened.
 	 */
-	uint32_t transfer_len;
+	uint32_t itt;
 	/** Command sequence number
 	 *
-	 * This is the sequence number of the current command, used to
+	 * This is the sequence number of the next command, used to
 	 * fill out the CmdSN field in iSCSI request PDUs.  It is
-	 * updated with the value of the ExpCmdSN field whenever we
-	 * receive an iSCSI response PDU containing such a field.
+	 * incremented whenever a SCSI command PDU is constructed.
+	 * During login, it is updated with the value of the ExpCmdSN
+	 * field whenever we receive an iSCSI response PDU containing
+	 * such a field.
 	 */
 	uint32_t cmdsn;
+	/** Maximum command sequence number
+	 *
+	 * This is the most recent value present in the MaxCmdSN field
+	 * of an iSCSI response PDU.  We may send commands with a
+	 * CmdSN up to and including this value.
+	 */
+	uint32_t maxcmdsn;
 	/** Status sequence number
 	 *
 	 * This is the most recent status sequence number present in
@@ -621,11 +687,24 @@ struct iscsi_session {
 	 * the ExpStatSN field with this value plus one.
 	 */
 	uint32_t statsn;
-	
+
+	/** Maximum length of transmitted data segments
+	 *
+	 * This is the target's MaxRecvDataSegmentLength, limited to
+	 * ISCSI_MAX_DATA_SEG_LEN.
+	 */
+	size_t max_send_len;
+	/** Negotiated FirstBurstLength */
+	size_t first_burst_len;
+	/** Negotiated ImmediateData */
+	int immediate_data;
+
 	/** Basic header segment for current TX PDU */
 	union iscsi_bhs tx_bhs;
 	/** State of the TX engine */
 	enum iscsi_tx_state tx_state;
+	/** Task owning the current TX PDU, if any */
+	struct iscsi_task *tx_task;
 	/** TX process */
 	struct process process;
 
@@ -639,9 +718,19 @@ struct iscsi_session {
 	size_t rx_len;
 	/** Buffer for received data (not always used) */
 	void *rx_buffer;
+	/** Digests in use for the current RX PDU
+	 *
+	 * This is the bitwise-OR of zero or more of
+	 * ISCSI_STATUS_HEADER_DIGEST and ISCSI_STATUS_DATA_DIGEST.
+	 */
+	int rx_digests;
+	/** Running CRC32C for the current RX digest */
+	uint32_t rx_crc;
+	/** Received digest */
+	uint32_t rx_digest;
 
-	/** Current SCSI command, if any */
-	struct scsi_cmd *command;
+	/** Tasks */
+	struct iscsi_task task[ISCSI_MAX_TASKS];
 
 	/** Target socket address (for boot firmware table) */
 	struct sockaddr target_sockaddr;
@@ -682,6 +771,9 @@ struct iscsi_session {
 /** iSCSI session needs to send the operational negotiation strings */
 #define ISCSI_STATUS_STRINGS_OPERATIONAL 0x1000
 
+/** iSCSI session needs to send the initiator and target names */
+#define ISCSI_STATUS_STRINGS_NAMES 0x2000
+
 /** Mask for all iSCSI "needs to send" flags */
 #define ISCSI_STATUS_STRINGS_MASK 0xff00
 
@@ -694,6 +786,25 @@ struct iscsi_session {
 /** Target authenticated itself correctly */
 #define ISCSI_STATUS_AUTH_REVERSE_OK 0x00040000
 
+/** Target has agreed to use CRC32C header digests */
+#define ISCSI_STATUS_HEADER_DIGEST 0x00080000
+
+/** Target has agreed to use CRC32C data digests */
+#define ISCSI_STATUS_DATA_DIGEST 0x00100000
+
+/** Maximum data segment length
+ *
+ * This is advertised as our MaxRecvDataSegmentLength, and also limits
+ * the length of the data segments that we transmit.
+ */
+#define ISCSI_MAX_DATA_SEG_LEN 65536
+
+/** Default MaxRecvDataSegmentLength (as per RFC3720) */
+#define ISCSI_DEFAULT_MAX_RECV_DATA_SEG_LEN 8192
+
+/** Default FirstBurstLength (as per RFC3720) */
+#define ISCSI_DEFAULT_FIRST_BURST_LEN 65536
+
 /** Default initiator IQN prefix */
 #define ISCSI_DEFAULT_IQN_PREFIX "iqn.2010-04.org.ipxe"
 
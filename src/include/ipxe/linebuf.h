@@ -25,6 +25,8 @@ struct line_buffer {
 extern char * buffered_line ( struct line_buffer *linebuf );
 extern ssize_t line_buffer ( struct line_buffer *linebuf,
 			     const char *data, size_t len );
+extern ssize_t line_buffer_inplace ( struct line_buffer *linebuf,
+				     char *data, size_t len, char **line );
 extern void empty_line_buffer ( struct line_buffer *linebuf );
 
 #endif /* _IPXE_LINEBUF_H */
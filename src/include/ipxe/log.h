@@ -0,0 +1,95 @@
+#ifndef _IPXE_LOG_H
+#define _IPXE_LOG_H
+
+/** @file
+ *
+ * Log ring buffers
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stddef.h>
+#include <ipxe/process.h>
+#include <ipxe/tables.h>
+
+/**
+ * A log ring buffer
+ *
+ * A log ring holds complete newline-terminated log records awaiting
+ * transmission to a remote log server.  Records are added from the
+ * context that printed them, and are removed and transmitted by a
+ * background process.
+ */
+struct log_ring {
+	/** Data buffer */
+	char *data;
+	/** Length of data buffer (must be a power of two) */
+	size_t size;
+	/** Producer counter */
+	size_t prod;
+	/** Consumer counter */
+	size_t cons;
+	/** Number of records dropped due to lack of space */
+	unsigned int dropped;
+	/** Flush process */
+	struct process process;
+	/**
+	 * Transmit records
+	 *
+	 * @v ring		Log ring
+	 * @ret rc		Return status code
+	 *
+	 * This method should remove and transmit some or all of the
+	 * queued records.  If no progress can be made (e.g. because
+	 * a flow control window is closed), it should return an
+	 * error; the flush process will then be stopped until
+	 * restarted via log_ring_kick().
+	 */
+	int ( * flush ) ( struct log_ring *ring );
+};
+
+/** Log ring buffer table */
+#define LOG_RINGS __table ( struct log_ring, "log_rings" )
+
+/** Declare a log ring buffer */
+#define __log_ring __table_entry ( LOG_RINGS, 01 )
+
+extern struct process_descriptor log_ring_process_desc;
+
+/**
+ * Initialise a static log ring buffer
+ *
+ * @v _ring		Log ring
+ * @v _buffer		Data buffer (whose size must be a power of two)
+ * @v _flush		Transmit method
+ */
+#define LOG_RING_INIT( _ring, _buffer, _flush ) {			\
+	.data = (_buffer),						\
+	.size = sizeof ( _buffer ),					\
+	.process = {							\
+		.list = LIST_HEAD_INIT ( (_ring).process.list ),	\
+		.desc = &log_ring_process_desc,				\
+		.refcnt = NULL,						\
+	},								\
+	.flush = (_flush),						\
+	}
+
+/**
+ * Calculate amount of data held in log ring buffer
+ *
+ * @v ring		Log ring
+ * @ret fill		Length of queued records
+ */
+static inline __attribute__ (( always_inline )) size_t
+log_ring_fill ( struct log_ring *ring ) {
+	return ( ring->prod - ring->cons );
+}
+
+extern int log_ring_put ( struct log_ring *ring, const void *data,
+			  size_t len );
+extern size_t log_ring_record_len ( struct log_ring *ring );
+extern size_t log_ring_get ( struct log_ring *ring, void *data, size_t len );
+extern void log_ring_kick ( struct log_ring *ring );
+
+#endif /* _IPXE_LOG_H */
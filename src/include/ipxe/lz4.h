@@ -0,0 +1,75 @@
+#ifndef _IPXE_LZ4_H
+#define _IPXE_LZ4_H
+
+/** @file
+ *
+ * LZ4 decompression algorithm
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** LZ4 frame magic number */
+#define LZ4_MAGIC 0x184d2204UL
+
+/** LZ4 legacy frame magic number */
+#define LZ4_LEGACY_MAGIC 0x184c2102UL
+
+/** LZ4 skippable frame magic number (low nibble ignored) */
+#define LZ4_SKIPPABLE_MAGIC 0x184d2a50UL
+
+/** LZ4 skippable frame magic number mask */
+#define LZ4_SKIPPABLE_MASK 0xfffffff0UL
+
+/** LZ4 frame descriptor version */
+#define LZ4_FLG_VERSION 0x40
+
+/** LZ4 frame descriptor version mask */
+#define LZ4_FLG_VERSION_MASK 0xc0
+
+/** LZ4 frame has block checksums */
+#define LZ4_FLG_BLOCK_CHECKSUM 0x10
+
+/** LZ4 frame has content size */
+#define LZ4_FLG_CONTENT_SIZE 0x08
+
+/** LZ4 frame has content checksum */
+#define LZ4_FLG_CONTENT_CHECKSUM 0x04
+
+/** LZ4 frame has dictionary ID */
+#define LZ4_FLG_DICT_ID 0x01
+
+/** LZ4 block is stored uncompressed */
+#define LZ4_BLOCK_UNCOMPRESSED 0x80000000UL
+
+/** Maximum decompressed length of an LZ4 legacy frame block */
+#define LZ4_LEGACY_BLOCK_MAX ( 8 * 1024 * 1024 )
+
+/** Minimum LZ4 match length */
+#define LZ4_MIN_MATCH 4
+
+/**
+ * Check for LZ4-compressed data
+ *
+ * @v data		Data
+ * @v len		Length of data
+ * @ret is_lz4		Data appears to be LZ4-compressed
+ */
+static inline int lz4_detect ( const void *data, size_t len ) {
+	const uint8_t *bytes = data;
+	uint32_t magic;
+
+	if ( len < sizeof ( magic ) )
+		return 0;
+	magic = ( bytes[0] | ( bytes[1] << 8 ) | ( bytes[2] << 16 ) |
+		  ( ( ( uint32_t ) bytes[3] ) << 24 ) );
+	return ( ( magic == LZ4_MAGIC ) || ( magic == LZ4_LEGACY_MAGIC ) );
+}
+
+extern int lz4_decompress ( const void *data, size_t len, void *buf,
+			    size_t *out_len );
+
+#endif /* _IPXE_LZ4_H */
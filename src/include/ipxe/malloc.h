@@ -26,6 +26,8 @@ extern size_t freemem;
 extern void * __malloc alloc_memblock ( size_t size, size_t align );
 extern void free_memblock ( void *ptr, size_t size );
 extern void mpopulate ( void *start, size_t len );
+extern void * dma_pool ( size_t *len );
+extern void heap_fix ( void );
 extern void mdumpfree ( void );
 
 /**
@@ -64,18 +66,61 @@ static inline void free_dma ( void *ptr, size_t size ) {
 
 /** A cache discarder */
 struct cache_discarder {
+	/** Name */
+	const char *name;
 	/**
 	 * Discard some cached data
 	 *
 	 * @ret discarded	Number of cached items discarded
 	 */
 	unsigned int ( * discard ) ( void );
+	/** Number of lookups satisfied from the cache */
+	unsigned long hits;
+	/** Number of lookups not satisfied from the cache */
+	unsigned long misses;
+	/** Number of items discarded due to memory pressure */
+	unsigned long discarded;
 };
 
 /** Cache discarder table */
 #define CACHE_DISCARDERS __table ( struct cache_discarder, "cache_discarders" )
 
-/** Declare a cache discarder */
-#define __cache_discarder __table_entry ( CACHE_DISCARDERS, 01 )
+/** Cached data is cheap to recreate (e.g. pooled buffers) */
+#define CACHE_CHEAP 01
+
+/** Cached data costs a network round trip or computation to recreate */
+#define CACHE_NORMAL 02
+
+/** Cached data is expensive to recreate (e.g. received data) */
+#define CACHE_EXPENSIVE 03
+
+/**
+ * Declare a cache discarder
+ *
+ * @v cost		Cost of recreating discarded data
+ *
+ * Under memory pressure, caches are discarded in order of increasing
+ * cost: a more expensive cache will be asked to discard data only
+ * when all cheaper caches are empty.
+ */
+#define __cache_discarder( cost ) __table_entry ( CACHE_DISCARDERS, cost )
+
+/**
+ * Record cache hit
+ *
+ * @v discarder		Cache discarder
+ */
+static inline void cache_hit ( struct cache_discarder *discarder ) {
+	discarder->hits++;
+}
+
+/**
+ * Record cache miss
+ *
+ * @v discarder		Cache discarder
+ */
+static inline void cache_miss ( struct cache_discarder *discarder ) {
+	discarder->misses++;
+}
 
 #endif /* _IPXE_MALLOC_H */
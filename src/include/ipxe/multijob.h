@@ -0,0 +1,75 @@
+#ifndef _IPXE_MULTIJOB_H
+#define _IPXE_MULTIJOB_H
+
+/** @file
+ *
+ * Concurrent background jobs
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <ipxe/refcnt.h>
+#include <ipxe/list.h>
+#include <ipxe/interface.h>
+
+struct job_progress;
+
+/** A background job */
+struct multijob {
+	/** Reference count */
+	struct refcnt refcnt;
+	/** List of background jobs */
+	struct list_head list;
+	/** Job control interface */
+	struct interface job;
+	/** Job description */
+	char *name;
+	/** Final status code, or -EINPROGRESS while running */
+	int rc;
+	/**
+	 * Handle job completion (optional)
+	 *
+	 * @v mj		Background job
+	 * @v rc		Reason for completion
+	 * @ret rc		Final status code
+	 *
+	 * This is called exactly once, when the job completes or is
+	 * cancelled, and should release any resources held in the
+	 * private data.
+	 */
+	int ( * complete ) ( struct multijob *mj, int rc );
+	/** Driver-private data */
+	void *priv;
+};
+
+/**
+ * Get reference to background job
+ *
+ * @v mj		Background job
+ * @ret mj		Background job
+ */
+static inline __attribute__ (( always_inline )) struct multijob *
+multijob_get ( struct multijob *mj ) {
+	ref_get ( &mj->refcnt );
+	return mj;
+}
+
+/**
+ * Drop reference to background job
+ *
+ * @v mj		Background job
+ */
+static inline __attribute__ (( always_inline )) void
+multijob_put ( struct multijob *mj ) {
+	ref_put ( &mj->refcnt );
+}
+
+extern struct multijob * multijob_alloc ( const char *name, size_t priv_len );
+extern void multijob_start ( struct multijob *mj );
+extern void multijob_progress ( struct multijob *mj,
+				struct job_progress *progress );
+extern void multijob_list ( void );
+extern int multijob_wait ( int any );
+
+#endif /* _IPXE_MULTIJOB_H */
@@ -953,6 +953,20 @@ struct net80211_device
 	/** MAC address of the access point most recently associated */
 	u8 bssid[ETH_ALEN];
 
+	/** MAC address of the last access point successfully joined
+	 *
+	 * When reassociating, the probe first checks for this access
+	 * point on @c last_channel_nr before scanning all channels.
+	 */
+	u8 last_bssid[ETH_ALEN];
+
+	/** Channel number of the last access point successfully joined
+	 *
+	 * This is a raw channel number (net80211_channel::channel_nr),
+	 * or zero if no association has yet succeeded.
+	 */
+	u8 last_channel_nr;
+
 	/** SSID of the access point we are or will be associated with
 	 *
 	 * Although the SSID field in 802.11 packets is generally not
@@ -78,6 +78,27 @@ struct net_protocol {
 	int ( * rx ) ( struct io_buffer *iobuf, struct net_device *netdev,
 		       const void *ll_dest, const void *ll_source,
 		       unsigned int flags );
+	/**
+	 * Merge received packets
+	 *
+	 * @v iobuf		I/O buffer containing first packet
+	 * @v next		I/O buffer containing following packet
+	 * @v max_len		Maximum length of merged packet
+	 * @ret rc		Return status code
+	 *
+	 * If the following packet is a continuation of the same flow
+	 * as the first packet (e.g. the next in-order segment of a
+	 * TCP connection), then this method should append its payload
+	 * to the first packet and update the first packet's headers
+	 * accordingly.  If the first I/O buffer has insufficient
+	 * tailroom, it should be reallocated with enough tailroom to
+	 * reach @c max_len, to allow for further merges.  On failure,
+	 * neither packet may be altered in any way that would affect
+	 * its subsequent processing via rx().  The following I/O
+	 * buffer is never consumed.  This method is optional.
+	 */
+	int ( * merge ) ( struct io_buffer **iobuf, struct io_buffer *next,
+			  size_t max_len );
 	/**
 	 * Transcribe network-layer address
 	 *
@@ -251,6 +272,22 @@ struct net_device_operations {
 	 * supported.
 	 */
 	void ( * irq ) ( struct net_device *netdev, int enable );
+	/** Update receive address filter
+	 *
+	 * @v netdev	Network device
+	 *
+	 * This method should reprogram the hardware receive filter
+	 * to accept packets addressed to the current link-layer
+	 * address, broadcast packets and multicast packets.  Packets
+	 * addressed to any other unicast address should be accepted
+	 * only if netdev_rx_is_promisc() is true.
+	 *
+	 * This method may be NULL to indicate that the device is
+	 * always in promiscuous mode.  It is guaranteed to be called
+	 * only when the device is open; the open() method must
+	 * program the initial filter state itself.
+	 */
+	void ( * filter ) ( struct net_device *netdev );
 };
 
 /** Network device error */
@@ -332,17 +369,51 @@ struct net_device {
 	int link_rc;
 	/** Maximum packet length
 	 *
-	 * This length includes any link-layer headers.
+	 * This length includes any link-layer headers, and is the
+	 * largest packet that the hardware is capable of handling.
 	 */
 	size_t max_pkt_len;
+	/** Maximum transmission unit
+	 *
+	 * This length excludes any link-layer headers.  It may be
+	 * changed (up to the limit implied by max_pkt_len) via the
+	 * "mtu" setting.  Drivers should size their receive buffers
+	 * using netdev_rx_frame_len() when the device is opened.
+	 */
+	size_t mtu;
+	/** Maximum number of fragments per transmitted packet
+	 *
+	 * Drivers that are able to transmit a multi-fragment I/O
+	 * buffer directly (without copying) should set this to the
+	 * maximum number of fragments that they can handle.  A value
+	 * of zero indicates no scatter-gather support; any
+	 * multi-fragment packets will be linearised before being
+	 * passed to the driver.
+	 */
+	unsigned int max_tx_frags;
+	/** Additional transmit headroom
+	 *
+	 * This is the headroom required beyond the link-layer header
+	 * itself, for headers added by any underlying device (e.g. a
+	 * VLAN tag added before transmission via the trunk device).
+	 */
+	size_t tx_headroom;
 	/** TX packet queue */
 	struct list_head tx_queue;
 	/** RX packet queue */
 	struct list_head rx_queue;
+	/** Number of packets in RX packet queue */
+	unsigned int rx_fill;
+	/** Number of outstanding requests for promiscuous reception */
+	unsigned int rx_promisc;
 	/** TX statistics */
 	struct net_device_stats tx_stats;
 	/** RX statistics */
 	struct net_device_stats rx_stats;
+	/** Count of polls for which the RX processing budget was
+	 * exhausted
+	 */
+	unsigned int rx_budget_exhausted;
 
 	/** Configuration settings applicable to this device */
 	struct generic_settings settings;
@@ -360,6 +431,26 @@ struct net_device {
 /** Network device receive queue processing is frozen */
 #define NETDEV_RX_FROZEN 0x0004
 
+/** Network device can verify received TCP and UDP checksums
+ *
+ * A driver setting this flag may mark received packets with @c
+ * IOB_CSUM_VERIFIED, allowing the software checksum to be skipped.
+ */
+#define NETDEV_RX_CSUM 0x0008
+
+/** Network device interrupts can wake the CPU from a nap
+ *
+ * A driver setting this flag guarantees that, while interrupts are
+ * enabled via netdev_irq(), any received packet will generate an
+ * interrupt that is safely handled without further intervention.
+ * The network stack will then nap between packets rather than
+ * polling continuously.
+ */
+#define NETDEV_IRQ_WAKE 0x0010
+
+/** Network device interrupts were enabled only for the duration of a nap */
+#define NETDEV_IRQ_NAP 0x0020
+
 /** Link-layer protocol table */
 #define LL_PROTOCOLS __table ( struct ll_protocol, "ll_protocols" )
 
@@ -433,6 +524,8 @@ struct net_driver {
 #define NETDEV_SETTING_TAG_BUS_ID NETDEV_SETTING_TAG ( 0x02 )
 
 extern struct list_head net_devices;
+extern void ( * netdev_capture ) ( struct net_device *netdev,
+				   struct io_buffer *iobuf );
 extern struct net_device_operations null_netdev_operations;
 extern struct settings_operations netdev_settings_operations;
 
@@ -538,6 +631,17 @@ netdev_settings_init ( struct net_device *netdev ) {
 	netdev->settings.settings.op = &netdev_settings_operations;
 }
 
+/**
+ * Get transmit headroom required by network device
+ *
+ * @v netdev		Network device
+ * @ret headroom	Required headroom for link-layer headers
+ */
+static inline __attribute__ (( always_inline )) size_t
+netdev_headroom ( struct net_device *netdev ) {
+	return ( netdev->ll_protocol->ll_header_len + netdev->tx_headroom );
+}
+
 /**
  * Check link state of network device
  *
@@ -582,6 +686,31 @@ netdev_irq_enabled ( struct net_device *netdev ) {
 	return ( netdev->state & NETDEV_IRQ_ENABLED );
 }
 
+/**
+ * Check whether or not network device should receive promiscuously
+ *
+ * @v netdev		Network device
+ * @ret promisc		Network device should accept all unicast packets
+ */
+static inline __attribute__ (( always_inline )) int
+netdev_rx_is_promisc ( struct net_device *netdev ) {
+	return ( netdev->rx_promisc != 0 );
+}
+
+/**
+ * Get maximum received frame length
+ *
+ * @v netdev		Network device
+ * @ret len		Maximum frame length, including link-layer headers
+ *
+ * Drivers should add any hardware-specific overhead (such as a VLAN
+ * tag or a trailing CRC) when sizing receive buffers.
+ */
+static inline __attribute__ (( always_inline )) size_t
+netdev_rx_frame_len ( struct net_device *netdev ) {
+	return ( netdev->mtu + netdev->ll_protocol->ll_header_len );
+}
+
 /**
  * Check whether or not network device receive queue processing is frozen
  *
@@ -604,6 +733,9 @@ extern void netdev_tx_complete_next_err ( struct net_device *netdev, int rc );
 extern void netdev_rx ( struct net_device *netdev, struct io_buffer *iobuf );
 extern void netdev_rx_err ( struct net_device *netdev,
 			    struct io_buffer *iobuf, int rc );
+extern unsigned int netdev_rx_ring_size ( struct net_device *netdev,
+					  size_t buf_len, unsigned int min,
+					  unsigned int max );
 extern void netdev_poll ( struct net_device *netdev );
 extern struct io_buffer * netdev_rx_dequeue ( struct net_device *netdev );
 extern struct net_device * alloc_netdev ( size_t priv_size );
@@ -612,6 +744,8 @@ extern int netdev_open ( struct net_device *netdev );
 extern void netdev_close ( struct net_device *netdev );
 extern void unregister_netdev ( struct net_device *netdev );
 extern void netdev_irq ( struct net_device *netdev, int enable );
+extern void netdev_rx_filter ( struct net_device *netdev );
+extern void netdev_rx_promisc ( struct net_device *netdev, int enable );
 extern struct net_device * find_netdev ( const char *name );
 extern struct net_device * find_netdev_by_location ( unsigned int bus_type,
 						     unsigned int location );
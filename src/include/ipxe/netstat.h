@@ -0,0 +1,43 @@
+#ifndef _IPXE_NETSTAT_H
+#define _IPXE_NETSTAT_H
+
+/** @file
+ *
+ * Network protocol statistics
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <ipxe/tables.h>
+
+/** A network protocol statistic */
+struct net_statistic {
+	/** Protocol name */
+	const char *protocol;
+	/** Statistic name */
+	const char *name;
+	/** Counter */
+	unsigned int *counter;
+};
+
+/** Network protocol statistics table */
+#define NET_STATISTICS __table ( struct net_statistic, "net_statistics" )
+
+/** Network-layer protocol statistics */
+#define NET_STAT_NETWORK 01
+
+/** Transport-layer protocol statistics */
+#define NET_STAT_TRANSPORT 02
+
+/** Application-layer protocol statistics */
+#define NET_STAT_APPLICATION 03
+
+/**
+ * Declare network protocol statistics
+ *
+ * @v layer		Protocol layer
+ */
+#define __net_statistic( layer ) __table_entry ( NET_STATISTICS, layer )
+
+#endif /* _IPXE_NETSTAT_H */
@@ -26,6 +26,7 @@ struct nvs_vpd_device {
 
 extern int nvs_vpd_init ( struct nvs_vpd_device *nvsvpd,
 			  struct pci_device *pci );
+extern void nvs_vpd_fini ( struct nvs_vpd_device *nvsvpd );
 extern void nvs_vpd_nvo_init ( struct nvs_vpd_device *nvsvpd,
 			       unsigned int field, struct nvo_block *nvo,
 			       struct refcnt *refcnt );
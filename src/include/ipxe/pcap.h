@@ -0,0 +1,73 @@
+#ifndef _IPXE_PCAP_H
+#define _IPXE_PCAP_H
+
+/** @file
+ *
+ * Packet capture
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+
+struct net_device;
+
+/** A pcap file header */
+struct pcap_header {
+	/** Magic number */
+	uint32_t magic;
+	/** Major version */
+	uint16_t major;
+	/** Minor version */
+	uint16_t minor;
+	/** Offset from UTC, in seconds */
+	int32_t thiszone;
+	/** Timestamp accuracy */
+	uint32_t sigfigs;
+	/** Maximum captured length of any packet */
+	uint32_t snaplen;
+	/** Link-layer header type */
+	uint32_t linktype;
+} __attribute__ (( packed ));
+
+/** pcap magic number (for microsecond-resolution timestamps) */
+#define PCAP_MAGIC 0xa1b2c3d4UL
+
+/** pcap major version */
+#define PCAP_VERSION_MAJOR 2
+
+/** pcap minor version */
+#define PCAP_VERSION_MINOR 4
+
+/** pcap Ethernet link-layer header type */
+#define PCAP_LINKTYPE_ETHERNET 1
+
+/** A pcap packet record header */
+struct pcap_record {
+	/** Timestamp (seconds) */
+	uint32_t sec;
+	/** Timestamp (microseconds) */
+	uint32_t usec;
+	/** Captured length */
+	uint32_t len;
+	/** Original length */
+	uint32_t orig_len;
+} __attribute__ (( packed ));
+
+/** Default packet capture buffer size */
+#define PCAP_DEFAULT_SIZE ( 1024 * 1024 )
+
+/** Default maximum captured length of each packet
+ *
+ * This is sufficient to capture the Ethernet, IPv4 and TCP headers
+ * (including options) of each packet.
+ */
+#define PCAP_DEFAULT_SNAPLEN 128
+
+extern int pcap_start ( struct net_device *netdev, size_t size,
+			size_t snaplen );
+extern void pcap_stop ( void );
+extern int pcap_save ( const char *name );
+
+#endif /* _IPXE_PCAP_H */
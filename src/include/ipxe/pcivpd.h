@@ -126,6 +126,22 @@ struct pci_vpd_cache {
 	uint32_t data;
 };
 
+/** Maximum PCI VPD address (exclusive) */
+#define PCI_VPD_MAX_ADDRESS 0x8000
+
+/** Maximum number of entries in PCI VPD tag index */
+#define PCI_VPD_MAX_TAGS 8
+
+/** A PCI VPD tag index entry */
+struct pci_vpd_tag {
+	/** ISAPnP tag */
+	unsigned int tag;
+	/** Address of tag body */
+	unsigned int address;
+	/** Length of tag body */
+	size_t len;
+};
+
 /** PCI VPD */
 struct pci_vpd {
 	/** PCI device */
@@ -134,6 +150,24 @@ struct pci_vpd {
 	int cap;
 	/** Read cache */
 	struct pci_vpd_cache cache;
+	/** Shadow copy of VPD contents (up to and including end tag)
+	 *
+	 * This is NULL if the shadow copy has not yet been loaded, or
+	 * could not be loaded.
+	 */
+	uint8_t *shadow;
+	/** Length of shadow copy (always a multiple of four bytes) */
+	size_t shadow_len;
+	/** Dirty dword bitmap for shadow copy */
+	uint8_t *dirty;
+	/** Tag index */
+	struct pci_vpd_tag tags[PCI_VPD_MAX_TAGS];
+	/** Number of entries in tag index */
+	unsigned int num_tags;
+	/** Loading shadow copy has been attempted */
+	int shadowed;
+	/** Defer writes within shadow copy until pci_vpd_flush() */
+	int writeback;
 };
 
 /**
@@ -169,6 +203,8 @@ pci_vpd_invalidate_cache ( struct pci_vpd *vpd ) {
 }
 
 extern int pci_vpd_init ( struct pci_vpd *vpd, struct pci_device *pci );
+extern void pci_vpd_fini ( struct pci_vpd *vpd );
+extern int pci_vpd_flush ( struct pci_vpd *vpd );
 extern int pci_vpd_read ( struct pci_vpd *vpd, unsigned int address,
 			  void *buf, size_t len );
 extern int pci_vpd_write ( struct pci_vpd *vpd, unsigned int address,
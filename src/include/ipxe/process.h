@@ -116,6 +116,7 @@ process_object ( struct process *process );
 extern void process_add ( struct process *process );
 extern void process_del ( struct process *process );
 extern void step ( void );
+extern int process_busy ( void );
 
 /**
  * Initialise process without adding to process list
@@ -181,6 +182,29 @@ struct process name __permanent_process = {				      \
 	.refcnt = NULL,							      \
 };
 
+/** Priority process table */
+#define PRIORITY_PROCESSES __table ( struct process, "priority_processes" )
+
+/**
+ * Declare a priority process
+ *
+ * Priority processes are not placed on the process list.  Instead,
+ * they are executed on every call to step(), in addition to the
+ * process at the head of the process list.
+ */
+#define __priority_process __table_entry ( PRIORITY_PROCESSES, 01 )
+
+/** Define a priority process
+ *
+ */
+#define PRIORITY_PROCESS( name, step )					      \
+struct process_descriptor name ## _desc = PROC_DESC_PURE ( step );	      \
+struct process name __priority_process = {				      \
+	.list = LIST_HEAD_INIT ( name.list ),				      \
+	.desc = & name ## _desc,					      \
+	.refcnt = NULL,							      \
+};
+
 /**
  * Find debugging colourisation for a process
  *
@@ -0,0 +1,84 @@
+#ifndef _IPXE_PROFSTAT_H
+#define _IPXE_PROFSTAT_H
+
+/** @file
+ *
+ * Profiling statistics
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <stddef.h>
+#include <ipxe/profile.h>
+#include <config/general.h>
+
+/** Profiling statistics are collected only if the command is present */
+#ifdef PROFSTAT_CMD
+#define PROFSTAT 1
+#else
+#define PROFSTAT 0
+#endif
+
+/** A profiling statistic */
+struct profile_stat {
+	/** Category (e.g. "process" or "net"), or NULL if unused */
+	const char *type;
+	/** Identifying key (e.g. a protocol or process descriptor) */
+	const void *key;
+	/** Name, or NULL */
+	const char *name;
+	/** Number of calls */
+	unsigned long calls;
+	/** Total elapsed timestamp counter ticks */
+	uint64_t cycles;
+	/** Total number of bytes processed */
+	uint64_t bytes;
+};
+
+/** Maximum number of profiling statistics */
+#define PROFSTAT_MAX 64
+
+extern struct profile_stat profile_stats[PROFSTAT_MAX];
+
+extern void profstat_add ( const char *type, const void *key,
+			   const char *name, unsigned long cycles,
+			   size_t bytes );
+extern void profstat_clear ( void );
+
+/**
+ * Start profiling a call
+ *
+ * @v profiler		Profiler
+ */
+static inline __attribute__ (( always_inline )) void
+profstat_start ( union profiler *profiler ) {
+	if ( PROFSTAT ) {
+		profiler->timestamp = 0;
+		profile ( profiler );
+	}
+}
+
+/**
+ * Stop profiling a call
+ *
+ * @v profiler		Profiler
+ * @v type		Category
+ * @v key		Identifying key
+ * @v name		Name, or NULL
+ * @v bytes		Number of bytes processed
+ *
+ * When profiling statistics are not enabled, this compiles away to
+ * nothing.
+ */
+static inline __attribute__ (( always_inline )) void
+profstat_stop ( union profiler *profiler, const char *type, const void *key,
+		const char *name, size_t bytes ) {
+	if ( PROFSTAT ) {
+		profstat_add ( type, key, name, profile ( profiler ),
+			       bytes );
+	}
+}
+
+#endif /* _IPXE_PROFSTAT_H */
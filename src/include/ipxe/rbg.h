@@ -16,10 +16,14 @@ FILE_LICENCE ( GPL2_OR_LATER );
 struct random_bit_generator {
 	/** DRBG state */
 	struct drbg_state state;
+	/** DRBG instantiation has been deferred until first use */
+	int deferred;
 };
 
 extern struct random_bit_generator rbg;
 
+extern void rbg_startup_deferred ( void );
+
 /**
  * Generate bits using RBG
  *
@@ -36,6 +40,11 @@ extern struct random_bit_generator rbg;
 static inline int rbg_generate ( const void *additional, size_t additional_len,
 				 int prediction_resist, void *data,
 				 size_t len ) {
+
+	/* Complete startup on first use */
+	if ( rbg.deferred )
+		rbg_startup_deferred();
+
 	return drbg_generate ( &rbg.state, additional, additional_len,
 			       prediction_resist, data, len );
 }
@@ -72,6 +72,14 @@ struct rsa_context {
 	bigint_element_t *input0;
 	/** Output buffer */
 	bigint_element_t *output0;
+	/** Prime factor size, or zero if not using the CRT */
+	unsigned int prime_size;
+	/** Prime factors (p and q) */
+	bigint_element_t *prime0[2];
+	/** CRT exponents (d mod (p-1) and d mod (q-1)) */
+	bigint_element_t *crt_exponent0[2];
+	/** CRT coefficient (q^-1 mod p) */
+	bigint_element_t *coefficient0;
 	/** Temporary working space for modular exponentiation */
 	void *tmp;
 };
@@ -54,10 +54,17 @@ struct uri;
 
 /* Include all architecture-independent sanboot API headers */
 #include <ipxe/null_sanboot.h>
+#include <ipxe/efi/efi_block.h>
 
 /* Include all architecture-dependent sanboot API headers */
 #include <bits/sanboot.h>
 
+/** SAN device flags */
+enum san_device_flags {
+	/** Copy entire device into memory when hooking */
+	SAN_RAMDISK = 0x0001,
+};
+
 /**
  * Get default SAN drive number
  *
@@ -68,11 +75,16 @@ unsigned int san_default_drive ( void );
 /**
  * Hook SAN device
  *
- * @v uri		URI
+ * @v uris		List of URIs
+ * @v count		Number of URIs
  * @v drive		Drive number
+ * @v flags		Flags
  * @ret rc		Return status code
+ *
+ * Each URI is treated as an alternative path to the same device.
  */
-int san_hook ( struct uri *uri, unsigned int drive );
+int san_hook ( struct uri **uris, unsigned int count, unsigned int drive,
+	       unsigned int flags );
 
 /**
  * Unhook SAN device
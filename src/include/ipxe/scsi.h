@@ -16,6 +16,9 @@ FILE_LICENCE ( GPL2_OR_LATER );
 /** Maximum block for READ/WRITE (10) commands */
 #define SCSI_MAX_BLOCK_10 0xffffffffULL
 
+/** Maximum block count for READ/WRITE (10) commands */
+#define SCSI_MAX_COUNT_10 0xffffU
+
 /**
  * @defgroup scsiops SCSI operation codes
  * @{
@@ -12,6 +12,8 @@ FILE_LICENCE ( GPL2_OR_LATER );
 
 #include <ipxe/uaccess.h>
 
+extern unsigned long segment_generation;
+
 extern int prep_segment ( userptr_t segment, size_t filesz, size_t memsz );
 
 #endif /* _IPXE_SEGMENT_H */
@@ -70,6 +70,9 @@ struct sha1_context {
 
 extern struct digest_algorithm sha1_algorithm;
 
+extern void ( * sha1_compress ) ( struct sha1_context *context,
+				  const void *data, size_t count );
+
 extern void prf_sha1 ( const void *key, size_t key_len, const char *label,
 		       const void *data, size_t data_len, void *prf,
 		       size_t prf_len );
@@ -70,4 +70,7 @@ struct sha256_context {
 
 extern struct digest_algorithm sha256_algorithm;
 
+extern void ( * sha256_compress ) ( struct sha256_context *context,
+				    const void *data, size_t count );
+
 #endif /* _IPXE_SHA256_H */
@@ -93,6 +93,10 @@ struct smbios_structure {
 	size_t offset;
 	/** Length of strings section */
 	size_t strings_len;
+	/** Index of first string within SMBIOS string table */
+	unsigned int first_string;
+	/** Number of strings */
+	unsigned int num_strings;
 };
 
 /** SMBIOS system information structure */
@@ -151,7 +155,7 @@ struct smbios {
 };
 
 extern int find_smbios ( struct smbios *smbios );
-extern int find_smbios_structure ( unsigned int type,
+extern int find_smbios_structure ( unsigned int type, unsigned int instance,
 				   struct smbios_structure *structure );
 extern int read_smbios_structure ( struct smbios_structure *structure,
 				   void *data, size_t len );
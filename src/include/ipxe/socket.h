@@ -27,6 +27,15 @@ extern int udp_sock_dgram;
 #define UDP_SOCK_DGRAM 0x2
 #define SOCK_DGRAM udp_sock_dgram
 
+/** Connection-based, reliable streams with idempotent initial data
+ *
+ * The initial data may be sent within the connection request (using
+ * TCP Fast Open), and so may be received by the peer more than once.
+ */
+extern int tcp_sock_stream_fastopen;
+#define TCP_SOCK_STREAM_FASTOPEN 0x3
+#define SOCK_STREAM_FASTOPEN tcp_sock_stream_fastopen
+
 /** @} */
 
 /**
@@ -42,6 +51,8 @@ socket_semantics_name ( int semantics ) {
 		return "SOCK_STREAM";
 	} else if ( semantics == SOCK_DGRAM ) {
 		return "SOCK_DGRAM";
+	} else if ( semantics == SOCK_STREAM_FASTOPEN ) {
+		return "SOCK_STREAM_FASTOPEN";
 	} else {
 		return "SOCK_UNKNOWN";
 	}
@@ -20,6 +20,24 @@ FILE_LICENCE ( GPL2_OR_LATER );
  */
 #define SYSLOG_BUFSIZE 128
 
+/** Maximum length of syslog message header
+ *
+ * This allows for the "<priority>ipxe: " prefix and the terminating
+ * newline.
+ */
+#define SYSLOG_HEADER_LEN 16
+
+/** Maximum length of syslog dropped message notice */
+#define SYSLOG_DROPPED_LEN 32
+
+/** Syslog ring buffer size
+ *
+ * Messages are queued in a ring buffer of this size (which must be
+ * a power of two) and transmitted by a background process.  Messages
+ * are dropped if the ring buffer is full.  This is a policy decision.
+ */
+#define SYSLOG_RING_SIZE 4096
+
 /** Syslog default facility
  *
  * This is a policy decision
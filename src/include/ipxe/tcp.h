@@ -32,6 +32,9 @@ struct tcp_header {
  * @{
  */
 
+/** Maximum length of TCP options */
+#define TCP_MAX_OPTIONS_LEN 40
+
 /** End of TCP options list */
 #define TCP_OPTION_END 0
 
@@ -54,6 +57,78 @@ struct tcp_mss_option {
 /** Code for the TCP MSS option */
 #define TCP_OPTION_MSS 2
 
+/** TCP window scale option */
+struct tcp_window_scale_option {
+	uint8_t kind;
+	uint8_t length;
+	uint8_t scale;
+} __attribute__ (( packed ));
+
+/** Padded TCP window scale option (used for sending) */
+struct tcp_window_scale_padded_option {
+	uint8_t nop[1];
+	struct tcp_window_scale_option wsopt;
+} __attribute__ (( packed ));
+
+/** Code for the TCP window scale option */
+#define TCP_OPTION_WS 3
+
+/** Maximum window scale permitted by RFC 1323 */
+#define TCP_MAX_WINDOW_SCALE 14
+
+/** TCP selective acknowledgement permitted option */
+struct tcp_sack_permitted_option {
+	uint8_t kind;
+	uint8_t length;
+} __attribute__ (( packed ));
+
+/** Padded TCP selective acknowledgement permitted option (used for
+ * sending)
+ */
+struct tcp_sack_permitted_padded_option {
+	uint8_t nop[2];
+	struct tcp_sack_permitted_option spopt;
+} __attribute__ (( packed ));
+
+/** Code for the TCP selective acknowledgement permitted option */
+#define TCP_OPTION_SACK_PERMITTED 4
+
+/** TCP selective acknowledgement option */
+struct tcp_sack_option {
+	uint8_t kind;
+	uint8_t length;
+} __attribute__ (( packed ));
+
+/** TCP selective acknowledgement block */
+struct tcp_sack_block {
+	uint32_t left;
+	uint32_t right;
+} __attribute__ (( packed ));
+
+/** Maximum number of selective acknowledgement blocks
+ *
+ * This allows for the presence of the TCP timestamp option.
+ */
+#define TCP_SACK_MAX 3
+
+/** Padded TCP selective acknowledgement option (used for sending) */
+struct tcp_sack_padded_option {
+	uint8_t nop[2];
+	struct tcp_sack_option sackopt;
+} __attribute__ (( packed ));
+
+/** Code for the TCP selective acknowledgement option */
+#define TCP_OPTION_SACK 5
+
+/** Advertised TCP window scale
+ *
+ * Using a scale factor of 2**9 provides for a maximum window of 32MB,
+ * which is sufficient to allow Gigabit-speed transfers with a 200ms
+ * RTT.  The minimum advertised window is 512 bytes, which is still
+ * less than a single packet.
+ */
+#define TCP_RX_WINDOW_SCALE 9
+
 /** TCP timestamp option */
 struct tcp_timestamp_option {
 	uint8_t kind;
@@ -71,12 +146,48 @@ struct tcp_timestamp_padded_option {
 /** Code for the TCP timestamp option */
 #define TCP_OPTION_TS 8
 
+/** TCP Fast Open option
+ *
+ * This is followed by the cookie, if any.  An option without a
+ * cookie is a request for the server to issue a cookie.
+ */
+struct tcp_fastopen_option {
+	uint8_t kind;
+	uint8_t length;
+} __attribute__ (( packed ));
+
+/** Code for the TCP Fast Open option */
+#define TCP_OPTION_FASTOPEN 34
+
+/** Minimum TCP Fast Open cookie length */
+#define TCP_FASTOPEN_COOKIE_MIN 4
+
+/** Maximum TCP Fast Open cookie length
+ *
+ * RFC 7413 permits cookies of up to 16 bytes, but a SYN carrying a
+ * padded 16-byte cookie alongside the MSS, window scale, SACK
+ * permitted and timestamp options would exceed the 40 bytes of
+ * option space available.  Longer cookies are therefore ignored.
+ */
+#define TCP_FASTOPEN_COOKIE_MAX 14
+
+/** Maximum length of padded TCP Fast Open option (used for sending) */
+#define TCP_FASTOPEN_OPTION_MAX_LEN				\
+	( ( sizeof ( struct tcp_fastopen_option ) +		\
+	    TCP_FASTOPEN_COOKIE_MAX + 3 ) & ~3 )
+
 /** Parsed TCP options */
 struct tcp_options {
 	/** MSS option, if present */
 	const struct tcp_mss_option *mssopt;
+	/** Window scale option, if present */
+	const struct tcp_window_scale_option *wsopt;
+	/** SACK permitted option, if present */
+	const struct tcp_sack_permitted_option *spopt;
 	/** Timestampe option, if present */
 	const struct tcp_timestamp_option *tsopt;
+	/** Fast Open option, if present */
+	const struct tcp_fastopen_option *foopt;
 };
 
 /** @} */
@@ -260,47 +371,82 @@ struct tcp_options {
 /**
  * Maxmimum advertised TCP window size
  *
- * We estimate the TCP window size as the amount of free memory we
- * have.  This is not strictly accurate (since it ignores any space
- * already allocated as RX buffers), but it will do for now.
- *
- * Since we don't store out-of-order received packets, the
- * retransmission penalty is that the whole window contents must be
- * resent.  This suggests keeping the window size small, but bear in
- * mind that the maximum bandwidth on any link is limited to
+ * The maximum bandwidth on any link is limited by
  *
  *    max_bandwidth = ( tcp_window / round_trip_time )
  *
- * With a 48kB window, which probably accurately reflects our amount
- * of free memory, and a WAN RTT of say 200ms, this gives a maximum
- * bandwidth of 240kB/s.  This is sufficiently close to realistic that
- * we will need to be careful that our advertised window doesn't end
- * up limiting WAN download speeds.
+ * With a 256kB window and a LAN RTT of 2ms, this gives a maximum
+ * bandwidth of 128MB/s, which is sufficient for Gigabit-speed
+ * transfers.  A 10G link will still be window-limited at this RTT,
+ * but increasing the window further would allow a single connection
+ * to consume an unreasonable amount of memory in out-of-order
+ * segments.
+ *
+ * The advertised window is further limited by the amount of free
+ * heap memory (since each received packet occupies heap memory until
+ * it has been delivered to the application), by the application's
+ * own flow control window, and by the largest window representable
+ * with the negotiated window scale.  Out-of-order segments held in the
+ * receive queue may be discarded under memory pressure via the TCP
+ * cache discarder.
+ */
+#define TCP_MAX_WINDOW_SIZE	( 256 * 1024 )
+
+/**
+ * Default TCP MSS
+ *
+ * The advertised MSS is normally derived from the MTU of the network
+ * device used to reach the peer.  This value is used if that MTU
+ * cannot be determined, and also limits the size of transmitted
+ * segments if the peer does not specify an MSS.
  *
- * Finally, since the window goes into a 16-bit field and we cannot
- * actually use 65536, we use a window size of (65536-4) to ensure
- * that payloads remain dword-aligned.
+ * The size of transmitted segments is reduced further if path MTU
+ * discovery (RFC 1191) reveals a smaller path MTU.
  */
-//#define TCP_MAX_WINDOW_SIZE	( 65536 - 4 )
-#define TCP_MAX_WINDOW_SIZE	8192
+#define TCP_MSS 1460
 
 /**
- * Path MTU
+ * TCP Fast Open SYN deferral
  *
- * We really ought to implement Path MTU discovery.  Until we do,
- * anything with a path MTU greater than this may fail.
+ * When data may be sent within the SYN, transmission of the SYN is
+ * deferred for up to this time to allow the application to deliver
+ * its initial data.
  */
-#define TCP_PATH_MTU 1460
+#define TCP_FASTOPEN_DELAY ( TICKS_PER_SEC / 10 )
 
 /**
- * Advertised TCP MSS
+ * Minimum payload length for zero-copy transmission
  *
- * We currently hardcode this to a reasonable value and hope that the
- * sender uses path MTU discovery.  The alternative is breaking the
- * abstraction layer so that we can find out the MTU from the IP layer
- * (which would have to find out from the net device layer).
+ * Segment payloads of at least this length are transmitted as a
+ * chain of I/O buffer fragments referring directly to the data held
+ * within the transmit queue.  Smaller payloads are copied, since the
+ * overhead of the additional fragments would outweigh the saving.
  */
-#define TCP_MSS 1460
+#define TCP_TX_REF_MIN_LEN 256
+
+/**
+ * Maximum TCP congestion window
+ *
+ * This limits the amount of data that may be held in the transmit
+ * queue awaiting acknowledgement.
+ */
+#define TCP_MAX_CWND ( 64 * 1024 )
+
+/**
+ * Number of duplicate ACKs triggering fast retransmission
+ *
+ * As specified in RFC 5681.
+ */
+#define TCP_DUPACK_THRESHOLD 3
+
+/**
+ * TCP delayed acknowledgement timeout
+ *
+ * In-order data is acknowledged after every second full-sized
+ * segment, or after this timeout if no further data arrives.  RFC
+ * 1122 requires the delay to be less than 0.5 seconds.
+ */
+#define TCP_DELACK_TIMEOUT ( TICKS_PER_SEC / 20 )
 
 /** TCP maximum segment lifetime
  *
@@ -311,12 +457,19 @@ struct tcp_options {
 /**
  * TCP maximum header length
  *
+ * This is an overestimate, since the SYN-only options (MSS, window
+ * scale, SACK permitted and Fast Open) are never sent alongside SACK
+ * blocks, and the Fast Open option is no longer than the SACK option.
  */
 #define TCP_MAX_HEADER_LEN					\
 	( MAX_LL_NET_HEADER_LEN +				\
 	  sizeof ( struct tcp_header ) +			\
 	  sizeof ( struct tcp_mss_option ) +			\
-	  sizeof ( struct tcp_timestamp_padded_option ) )
+	  sizeof ( struct tcp_window_scale_padded_option ) +	\
+	  sizeof ( struct tcp_sack_permitted_padded_option ) +	\
+	  sizeof ( struct tcp_timestamp_padded_option ) +	\
+	  sizeof ( struct tcp_sack_padded_option ) +		\
+	  ( TCP_SACK_MAX * sizeof ( struct tcp_sack_block ) ) )
 
 /**
  * Compare TCP sequence numbers
@@ -347,6 +500,30 @@ static inline int tcp_in_window ( uint32_t seq, uint32_t start,
 	return ( ( seq - start ) < len );
 }
 
+/** TCP statistics */
+struct tcp_statistics {
+	/** Number of retransmissions following a timeout */
+	unsigned int retransmits;
+	/** Number of fast retransmissions following duplicate ACKs */
+	unsigned int fast_retransmits;
+	/** Number of received segments containing only old data */
+	unsigned int rx_duplicates;
+	/** Number of received segments arriving out of order */
+	unsigned int rx_out_of_order;
+	/** Number of zero-length receive windows advertised */
+	unsigned int zero_windows;
+	/** Number of received segments with incorrect checksums */
+	unsigned int checksum_errors;
+	/** Number of segment size reductions due to path MTU discovery */
+	unsigned int pmtu_updates;
+	/** Number of SYNs transmitted with Fast Open data */
+	unsigned int fastopen_sent;
+	/** Number of SYNs whose Fast Open data was not accepted */
+	unsigned int fastopen_rejected;
+};
+
+extern struct tcp_statistics tcp_stats;
+
 extern struct tcpip_protocol tcp_protocol __tcpip_protocol;
 
 #endif /* _IPXE_TCP_H */
@@ -63,6 +63,41 @@ struct tcpip_protocol {
          */
         int ( * rx ) ( struct io_buffer *iobuf, struct sockaddr_tcpip *st_src,
 		       struct sockaddr_tcpip *st_dest, uint16_t pshdr_csum );
+	/**
+	 * Check whether received packets may be merged
+	 *
+	 * @v iobuf		I/O buffer containing first packet
+	 * @v next		I/O buffer containing following packet
+	 * @v pshdr_csum	Pseudo-header checksum for first packet
+	 * @v next_pshdr_csum	Pseudo-header checksum for following packet
+	 * @ret len		Length of headers in following packet, or rc
+	 *
+	 * If the payload of the following packet may be appended to
+	 * the first packet, this method should return the length of
+	 * the transport-layer headers that precede the payload within
+	 * the following packet.  Neither I/O buffer is consumed.
+	 * This method is optional.
+	 */
+	int ( * merge ) ( struct io_buffer *iobuf, struct io_buffer *next,
+			  uint16_t pshdr_csum, uint16_t next_pshdr_csum );
+	/**
+	 * Process path MTU reduction
+	 *
+	 * @v st_peer		Peer address
+	 * @v data		Leading part of the oversized packet's header
+	 * @v len		Length of leading part of header
+	 * @v mtu		New maximum transport-layer payload length
+	 * @ret rc		Return status code
+	 *
+	 * This method is called when a router reports that a packet
+	 * was too large to be forwarded.  It should return an error
+	 * if the packet cannot be matched to an existing connection,
+	 * in which case the report will be ignored.  Packets for
+	 * protocols providing this method will be transmitted with
+	 * fragmentation disallowed.  This method is optional.
+	 */
+	int ( * pmtu ) ( struct sockaddr_tcpip *st_peer, const void *data,
+			 size_t len, size_t mtu );
         /** 
 	 * Transport-layer protocol number
 	 *
@@ -79,6 +114,8 @@ struct tcpip_net_protocol {
 	const char *name;
 	/** Network address family */
 	sa_family_t sa_family;
+	/** Length of network-layer header */
+	size_t header_len;
 	/**
 	 * Transmit packet
 	 *
@@ -98,6 +135,22 @@ struct tcpip_net_protocol {
 		       struct sockaddr_tcpip *st_dest,
 		       struct net_device *netdev,
 		       uint16_t *trans_csum );
+	/**
+	 * Determine transmitting network device
+	 *
+	 * @v st_dest		Destination address
+	 * @ret netdev		Network device, or NULL
+	 */
+	struct net_device * ( * netdev ) ( struct sockaddr_tcpip *dest );
+	/**
+	 * Determine path MTU
+	 *
+	 * @v st_dest		Destination address
+	 * @ret mtu		Path MTU, or zero if not known
+	 *
+	 * This method is optional.
+	 */
+	size_t ( * pmtu ) ( struct sockaddr_tcpip *st_dest );
 };
 
 /** TCP/IP transport-layer protocol table */
@@ -116,13 +169,23 @@ struct tcpip_net_protocol {
 extern int tcpip_rx ( struct io_buffer *iobuf, uint8_t tcpip_proto,
 		      struct sockaddr_tcpip *st_src,
 		      struct sockaddr_tcpip *st_dest, uint16_t pshdr_csum );
+extern int tcpip_merge ( struct io_buffer *iobuf, struct io_buffer *next,
+			 uint8_t tcpip_proto, uint16_t pshdr_csum,
+			 uint16_t next_pshdr_csum );
 extern int tcpip_tx ( struct io_buffer *iobuf, struct tcpip_protocol *tcpip,
 		      struct sockaddr_tcpip *st_src,
 		      struct sockaddr_tcpip *st_dest,
 		      struct net_device *netdev,
 		      uint16_t *trans_csum );
-extern uint16_t tcpip_continue_chksum ( uint16_t partial,
-					const void *data, size_t len );
+extern size_t tcpip_headroom ( struct sockaddr_tcpip *st_dest );
+extern size_t tcpip_mtu ( struct sockaddr_tcpip *st_dest );
+extern int tcpip_pmtu ( uint8_t tcpip_proto, struct sockaddr_tcpip *st_peer,
+			const void *data, size_t len, size_t mtu );
+extern uint16_t generic_tcpip_continue_chksum ( uint16_t partial,
+						const void *data, size_t len );
 extern uint16_t tcpip_chksum ( const void *data, size_t len );
+extern uint16_t tcpip_chksum_iob ( struct io_buffer *iobuf );
+
+#include <bits/tcpip.h>
 
 #endif /* _IPXE_TCPIP_H */
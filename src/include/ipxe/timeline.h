@@ -0,0 +1,102 @@
+#ifndef _IPXE_TIMELINE_H
+#define _IPXE_TIMELINE_H
+
+/** @file
+ *
+ * Boot timeline tracing
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <config/general.h>
+
+/** Timeline events are recorded only if the command is present */
+#ifdef TIMELINE_CMD
+#define TIMELINE 1
+#else
+#define TIMELINE 0
+#endif
+
+/** A timeline event */
+struct timeline_event {
+	/** CPU timestamp counter */
+	uint64_t tsc;
+	/** Category (e.g. "net" or "image") */
+	const char *category;
+	/** Name */
+	const char *name;
+	/** Identifying key (used to match begin and end events) */
+	const void *key;
+	/** Phase (a Chrome trace event "ph" value) */
+	char phase;
+	/** Detail (e.g. a URI or a device name), or empty */
+	char detail[39];
+};
+
+/** Beginning of a timeline span */
+#define TIMELINE_BEGIN 'b'
+
+/** End of a timeline span */
+#define TIMELINE_END 'e'
+
+/** Timeline instant event */
+#define TIMELINE_INSTANT 'n'
+
+/** Number of timeline events retained (must be a power of two) */
+#define TIMELINE_MAX 256
+
+extern void timeline_record ( char phase, const char *category,
+			      const char *name, const void *key,
+			      const char *detail );
+extern int timeline_save ( const char *name );
+
+/**
+ * Record beginning of a timeline span
+ *
+ * @v category		Category
+ * @v name		Name
+ * @v key		Identifying key
+ * @v detail		Detail, or NULL
+ */
+static inline __attribute__ (( always_inline )) void
+timeline_begin ( const char *category, const char *name, const void *key,
+		 const char *detail ) {
+	if ( TIMELINE )
+		timeline_record ( TIMELINE_BEGIN, category, name, key, detail );
+}
+
+/**
+ * Record end of a timeline span
+ *
+ * @v category		Category
+ * @v name		Name
+ * @v key		Identifying key
+ * @v detail		Detail (e.g. a status message), or NULL
+ */
+static inline __attribute__ (( always_inline )) void
+timeline_end ( const char *category, const char *name, const void *key,
+	       const char *detail ) {
+	if ( TIMELINE )
+		timeline_record ( TIMELINE_END, category, name, key, detail );
+}
+
+/**
+ * Record timeline instant event
+ *
+ * @v category		Category
+ * @v name		Name
+ * @v key		Identifying key
+ * @v detail		Detail, or NULL
+ */
+static inline __attribute__ (( always_inline )) void
+timeline_mark ( const char *category, const char *name, const void *key,
+		const char *detail ) {
+	if ( TIMELINE ) {
+		timeline_record ( TIMELINE_INSTANT, category, name, key,
+				  detail );
+	}
+}
+
+#endif /* _IPXE_TIMELINE_H */
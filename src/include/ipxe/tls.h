@@ -11,6 +11,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 
 #include <stdint.h>
 #include <ipxe/refcnt.h>
+#include <ipxe/list.h>
 #include <ipxe/interface.h>
 #include <ipxe/process.h>
 #include <ipxe/crypto.h>
@@ -60,6 +61,7 @@ struct tls_header {
 #define TLS_HELLO_REQUEST 0
 #define TLS_CLIENT_HELLO 1
 #define TLS_SERVER_HELLO 2
+#define TLS_NEW_SESSION_TICKET 4
 #define TLS_CERTIFICATE 11
 #define TLS_SERVER_KEY_EXCHANGE 12
 #define TLS_CERTIFICATE_REQUEST 13
@@ -79,6 +81,7 @@ struct tls_header {
 #define TLS_RSA_WITH_AES_256_CBC_SHA 0x0035
 #define TLS_RSA_WITH_AES_128_CBC_SHA256 0x003c
 #define TLS_RSA_WITH_AES_256_CBC_SHA256 0x003d
+#define TLS_RSA_WITH_AES_128_GCM_SHA256 0x009c
 
 /* TLS hash algorithm identifiers */
 #define TLS_MD5_ALGORITHM 1
@@ -91,6 +94,13 @@ struct tls_header {
 /* TLS extension types */
 #define TLS_SERVER_NAME 0
 #define TLS_SERVER_NAME_HOST_NAME 0
+#define TLS_SESSION_TICKET 35
+
+/** Maximum length of a TLS session ID */
+#define TLS_MAX_SESSION_ID_LEN 32
+
+/** Maximum number of cached TLS sessions */
+#define TLS_MAX_CACHED_SESSIONS 8
 
 /** TLS RX state machine state */
 enum tls_rx_state {
@@ -118,6 +128,20 @@ struct tls_cipher_suite {
 	struct digest_algorithm *digest;
 	/** Key length */
 	uint16_t key_len;
+	/** MAC secret length */
+	uint8_t mac_len;
+	/** Fixed initialisation vector length
+	 *
+	 * This is the length of the initialisation vector portion of
+	 * the key block.
+	 */
+	uint8_t fixed_iv_len;
+	/** Record initialisation vector length
+	 *
+	 * This is the length of the explicit nonce transmitted within
+	 * each record.  It is used only for authenticated ciphers.
+	 */
+	uint8_t record_iv_len;
 	/** Numeric code (in network-endian order) */
 	uint16_t code;
 };
@@ -132,10 +156,14 @@ struct tls_cipherspec {
 	void *pubkey_ctx;
 	/** Bulk encryption cipher context */
 	void *cipher_ctx;
-	/** Next bulk encryption cipher context (TX only) */
-	void *cipher_next_ctx;
 	/** MAC secret */
 	void *mac_secret;
+	/** Fixed initialisation vector
+	 *
+	 * For block ciphers in the TX direction, this is updated
+	 * after each record to hold the current chaining value.
+	 */
+	void *fixed_iv;
 };
 
 /** A TLS signature and hash algorithm identifier */
@@ -194,6 +222,37 @@ struct md5_sha1_digest {
 /** MD5+SHA1 digest size */
 #define MD5_SHA1_DIGEST_SIZE sizeof ( struct md5_sha1_digest )
 
+/** A cached TLS session
+ *
+ * A cached session records the parameters required to resume a
+ * previously established session with the same server by means of
+ * an abbreviated handshake.
+ */
+struct tls_cached_session {
+	/** Reference counter */
+	struct refcnt refcnt;
+	/** List of cached sessions */
+	struct list_head list;
+	/** Server name */
+	const char *name;
+	/** Server port */
+	unsigned int port;
+	/** Protocol version */
+	uint16_t version;
+	/** Cipher suite (in network-endian order) */
+	uint16_t cipher_suite;
+	/** Master secret */
+	uint8_t master_secret[48];
+	/** Session ID */
+	uint8_t id[TLS_MAX_SESSION_ID_LEN];
+	/** Length of session ID */
+	size_t id_len;
+	/** Session ticket (if any) */
+	void *ticket;
+	/** Length of session ticket */
+	size_t ticket_len;
+};
+
 /** A TLS session */
 struct tls_session {
 	/** Reference counter */
@@ -201,6 +260,8 @@ struct tls_session {
 
 	/** Server name */
 	const char *name;
+	/** Server port */
+	unsigned int port;
 	/** Plaintext stream */
 	struct interface plainstream;
 	/** Ciphertext stream */
@@ -235,6 +296,19 @@ struct tls_session {
 	/** Public-key algorithm used for Certificate Verify (if sent) */
 	struct pubkey_algorithm *verify_pubkey;
 
+	/** Session ID */
+	uint8_t session_id[TLS_MAX_SESSION_ID_LEN];
+	/** Length of session ID */
+	size_t session_id_len;
+	/** Cached session offered for resumption (if any) */
+	struct tls_cached_session *resume;
+	/** Session has been resumed via an abbreviated handshake */
+	int resumed;
+	/** Newly issued session ticket (if any) */
+	void *ticket;
+	/** Length of newly issued session ticket */
+	size_t ticket_len;
+
 	/** TX sequence number */
 	uint64_t tx_seq;
 	/** TX pending transmissions */
@@ -252,11 +326,15 @@ struct tls_session {
 	size_t rx_rcvd;
 	/** Current received record header */
 	struct tls_header rx_header;
-	/** Current received raw data buffer */
-	void *rx_data;
+	/** Current received record data buffer
+	 *
+	 * This buffer is reused for subsequent records, unless it is
+	 * handed over to the plaintext stream as application data.
+	 */
+	struct io_buffer *rx_data;
 };
 
 extern int add_tls ( struct interface *xfer, const char *name,
-		     struct interface **next );
+		     unsigned int port, struct interface **next );
 
 #endif /* _IPXE_TLS_H */
@@ -0,0 +1,97 @@
+#ifndef _IPXE_TRACE_H
+#define _IPXE_TRACE_H
+
+/** @file
+ *
+ * Runtime trace channels
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <ipxe/tables.h>
+#include <config/general.h>
+
+/** Trace points are compiled in only if the commands are present */
+#ifdef TRACE_CMD
+#define TRACING 1
+#else
+#define TRACING 0
+#endif
+
+/** A trace channel */
+struct trace_channel {
+	/** Name */
+	const char *name;
+	/** Channel is enabled */
+	int enabled;
+	/** Object to be traced, or NULL to trace all objects */
+	const void *object;
+};
+
+/** Trace channel table */
+#define TRACE_CHANNELS __table ( struct trace_channel, "trace_channels" )
+
+/** Declare a trace channel */
+#define __trace_channel __table_entry ( TRACE_CHANNELS, 01 )
+
+/** Maximum number of arguments to a trace point */
+#define TRACE_MAX_ARGS 4
+
+/** A trace entry */
+struct trace_entry {
+	/** CPU timestamp counter */
+	uint64_t tsc;
+	/** Trace channel */
+	struct trace_channel *channel;
+	/** Traced object */
+	const void *object;
+	/** Format string */
+	const char *fmt;
+	/** Arguments */
+	unsigned long args[TRACE_MAX_ARGS];
+};
+
+/** Number of trace entries retained (must be a power of two) */
+#define TRACE_MAX 512
+
+extern void trace_record ( struct trace_channel *channel, const void *object,
+			   const char *fmt, unsigned long arg0,
+			   unsigned long arg1, unsigned long arg2,
+			   unsigned long arg3 );
+extern void trace_dump ( void );
+extern void trace_clear ( void );
+
+/**
+ * Record trace entry
+ *
+ * @v channel		Trace channel
+ * @v object		Traced object
+ * @v fmt		Format string
+ * @v ...		Arguments (up to @c TRACE_MAX_ARGS)
+ *
+ * Formatting is deferred until the trace is dumped, and so the cost
+ * of a disabled trace point is a single well-predicted branch.  Each
+ * argument is stored as an unsigned long: the format string must
+ * therefore use only long integer conversions (e.g. "%ld" or "%lx"),
+ * "%p", or "%s" of a string with static lifetime.  The format string
+ * should not include a trailing newline.
+ */
+#define TRACE( channel, object, fmt, ... )				\
+	TRACE_ARGS ( channel, object, fmt, ##__VA_ARGS__, 0, 0, 0, 0 )
+
+/** Record trace entry (with padded argument list) */
+#define TRACE_ARGS( channel, object, fmt, arg0, arg1, arg2, arg3, ... )	\
+	do {								\
+		if ( TRACING &&						\
+		     __builtin_expect ( (channel).enabled, 0 ) ) {	\
+			trace_record ( &(channel), (object), (fmt),	\
+				       ( ( unsigned long ) (arg0) ),	\
+				       ( ( unsigned long ) (arg1) ),	\
+				       ( ( unsigned long ) (arg2) ),	\
+				       ( ( unsigned long ) (arg3) ) );	\
+		}							\
+	} while ( 0 )
+
+#endif /* _IPXE_TRACE_H */
@@ -23,6 +23,11 @@
 
 #define VRING_USED_F_NO_NOTIFY     1
 
+/* The Guest publishes the used index for which it expects an interrupt
+ * at the end of the avail ring, and the Host publishes the avail index
+ * for which it expects a kick at the end of the used ring. */
+#define VIRTIO_RING_F_EVENT_IDX    29
+
 struct vring_desc
 {
    u64 addr;
@@ -60,9 +65,26 @@ struct vring {
 
 #define vring_size(num) \
    (((((sizeof(struct vring_desc) * num) + \
-      (sizeof(struct vring_avail) + sizeof(u16) * num)) \
+      (sizeof(struct vring_avail) + sizeof(u16) * (num + 1))) \
          + PAGE_MASK) & ~PAGE_MASK) + \
-         (sizeof(struct vring_used) + sizeof(struct vring_used_elem) * num))
+         (sizeof(struct vring_used) + sizeof(struct vring_used_elem) * num) + \
+         sizeof(u16))
+
+/* Event index fields, valid only if VIRTIO_RING_F_EVENT_IDX negotiated */
+#define vring_used_event(vr) ((vr)->avail->ring[(vr)->num])
+#define vring_avail_event(vr) (*(u16 *)((vr)->used->ring + (vr)->num))
+
+/*
+ * vring_need_event
+ *
+ * has the event index been passed by moving from old_idx to new_idx ?
+ *
+ */
+
+static inline int vring_need_event(u16 event_idx, u16 new_idx, u16 old_idx)
+{
+   return (u16)(new_idx - event_idx - 1) < (u16)(new_idx - old_idx);
+}
 
 typedef unsigned char virtio_queue_t[PAGE_MASK + vring_size(MAX_QUEUE_NUM)];
 
@@ -72,6 +94,8 @@ struct vring_virtqueue {
    u16 free_head;
    u16 last_used_idx;
    void *vdata[MAX_QUEUE_NUM];
+   /* VIRTIO_RING_F_EVENT_IDX negotiated */
+   int event;
    /* PCI */
    int queue_index;
 };
@@ -99,7 +123,7 @@ static inline void vring_init(struct vring *vr,
 
    /* physical address of used must be page aligned */
 
-   pa = virt_to_phys(&vr->avail->ring[num]);
+   pa = virt_to_phys(&vr->avail->ring[num + 1]);
    pa = (pa + PAGE_MASK) & ~PAGE_MASK;
         vr->used = phys_to_virt(pa);
 
@@ -111,11 +135,19 @@ static inline void vring_init(struct vring *vr,
 static inline void vring_enable_cb(struct vring_virtqueue *vq)
 {
    vq->vring.avail->flags &= ~VRING_AVAIL_F_NO_INTERRUPT;
+   if (vq->event)
+           vring_used_event(&vq->vring) = vq->last_used_idx;
+   mb();
 }
 
 static inline void vring_disable_cb(struct vring_virtqueue *vq)
 {
    vq->vring.avail->flags |= VRING_AVAIL_F_NO_INTERRUPT;
+   /* The Host ignores the flag if event index is in use: move the
+    * event index behind the used index instead. */
+   if (vq->event)
+           vring_used_event(&vq->vring) = vq->last_used_idx - 1;
+   mb();
 }
 
 
@@ -13,6 +13,8 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <stddef.h>
 #include <time.h>
 #include <ipxe/asn1.h>
+#include <ipxe/list.h>
+#include <ipxe/sha256.h>
 
 /** An X.509 bit string */
 struct x509_bit_string {
@@ -138,6 +140,29 @@ struct x509_extensions {
 	struct x509_extended_key_usage ext_usage;
 };
 
+/** An X.509 certificate element index
+ *
+ * This records the location of each element of the certificate that
+ * is not otherwise recorded in raw form.  Optional elements that are
+ * absent have a zero length.
+ */
+struct x509_index {
+	/** Version */
+	struct asn1_cursor version;
+	/** tbsCertificate signature algorithm */
+	struct asn1_cursor signature;
+	/** Validity */
+	struct asn1_cursor validity;
+	/** Subject public key information */
+	struct asn1_cursor public_key;
+	/** Extensions */
+	struct asn1_cursor extensions;
+	/** Signature algorithm */
+	struct asn1_cursor signature_algorithm;
+	/** Signature value */
+	struct asn1_cursor signature_value;
+};
+
 /** An X.509 certificate */
 struct x509_certificate {
 	/** Raw certificate */
@@ -160,6 +185,8 @@ struct x509_certificate {
 	struct x509_signature signature;
 	/** Extensions */
 	struct x509_extensions extensions;
+	/** Element index */
+	struct x509_index index;
 };
 
 /** An X.509 extension */
@@ -198,6 +225,25 @@ struct x509_root {
 	const void *fingerprints;
 };
 
+/** A cached X.509 signature verification
+ *
+ * A cached verification records that a certificate's signature has
+ * previously been verified using an issuer's public key.
+ */
+struct x509_cached {
+	/** List of cached verifications */
+	struct list_head list;
+	/** Certificate fingerprint */
+	uint8_t fingerprint[SHA256_DIGEST_SIZE];
+	/** Issuer certificate fingerprint */
+	uint8_t issuer[SHA256_DIGEST_SIZE];
+};
+
+/** Maximum number of cached signature verifications */
+#define X509_MAX_CACHED 16
+
+extern int x509_index ( struct x509_certificate *cert,
+			const void *data, size_t len );
 extern int x509_parse ( struct x509_certificate *cert,
 			const void *data, size_t len );
 extern int x509_validate_issuer ( struct x509_certificate *cert,
@@ -12,6 +12,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <stddef.h>
 #include <stdarg.h>
 #include <ipxe/interface.h>
+#include <ipxe/uaccess.h>
 
 struct xfer_metadata;
 struct io_buffer;
@@ -81,6 +82,13 @@ extern struct io_buffer * xfer_alloc_iob ( struct interface *intf,
 					   size_t len );
 #define xfer_alloc_iob_TYPE( object_type ) \
 	typeof ( struct io_buffer * ( object_type, size_t len ) )
+extern userptr_t xfer_buffer ( struct interface *intf, size_t offset,
+			       size_t len );
+#define xfer_buffer_TYPE( object_type ) \
+	typeof ( userptr_t ( object_type, size_t offset, size_t len ) )
+extern int xfer_placed ( struct interface *intf, size_t offset, size_t len );
+#define xfer_placed_TYPE( object_type ) \
+	typeof ( int ( object_type, size_t offset, size_t len ) )
 
 extern int xfer_deliver ( struct interface *intf,
 			  struct io_buffer *iobuf,
@@ -49,6 +49,43 @@ typedef unsigned long nfds_t;
 typedef uint32_t useconds_t;
 #define MAP_FAILED ( ( void * ) -1 )
 
+/** Do not block (for linux_recvmmsg() and linux_sendmmsg()) */
+#define LINUX_MSG_DONTWAIT 0x40
+
+/** A scatter/gather I/O vector */
+struct linux_iovec {
+	/** Start of buffer */
+	void *iov_base;
+	/** Length of buffer */
+	__kernel_size_t iov_len;
+};
+
+/** A socket message header */
+struct linux_msghdr {
+	/** Socket address */
+	void *msg_name;
+	/** Length of socket address */
+	int msg_namelen;
+	/** I/O vectors */
+	struct linux_iovec *msg_iov;
+	/** Number of I/O vectors */
+	__kernel_size_t msg_iovlen;
+	/** Ancillary data */
+	void *msg_control;
+	/** Length of ancillary data */
+	__kernel_size_t msg_controllen;
+	/** Flags on received message */
+	unsigned int msg_flags;
+};
+
+/** A socket message header for linux_recvmmsg() and linux_sendmmsg() */
+struct linux_mmsghdr {
+	/** Message header */
+	struct linux_msghdr msg_hdr;
+	/** Number of bytes transferred */
+	unsigned int msg_len;
+};
+
 extern long linux_syscall ( int number, ... );
 
 extern int linux_open ( const char *pathname, int flags );
@@ -67,6 +104,14 @@ extern void * linux_mmap ( void *addr, __kernel_size_t length, int prot,
 extern void * linux_mremap ( void *old_address, __kernel_size_t old_size,
 			     __kernel_size_t new_size, int flags );
 extern int linux_munmap ( void *addr, __kernel_size_t length );
+extern int linux_socket ( int domain, int type, int protocol );
+extern int linux_bind ( int fd, const void *addr, int addrlen );
+extern int linux_setsockopt ( int fd, int level, int optname,
+			      const void *optval, int optlen );
+extern int linux_recvmmsg ( int fd, struct linux_mmsghdr *msgvec,
+			    unsigned int vlen, unsigned int flags );
+extern int linux_sendmmsg ( int fd, struct linux_mmsghdr *msgvec,
+			    unsigned int vlen, unsigned int flags );
 
 extern const char * linux_strerror ( int errnum );
 
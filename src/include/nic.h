@@ -55,6 +55,8 @@ struct nic_operations {
 	void ( *transmit ) ( struct nic *, const char *,
 			     unsigned int, unsigned int, const char * );
 	void ( *irq ) ( struct nic *, irq_action_t );
+	/* Check link state (optional; link is assumed up if absent) */
+	int ( *link ) ( struct nic * );
 };
 
 extern struct nic nic;
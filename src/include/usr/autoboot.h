@@ -19,13 +19,17 @@ enum uriboot_flags {
 	URIBOOT_NO_SAN_DESCRIBE = 0x0001,
 	URIBOOT_NO_SAN_BOOT = 0x0002,
 	URIBOOT_NO_SAN_UNHOOK = 0x0004,
+	URIBOOT_SAN_RAMDISK = 0x0008,
 };
 
 #define URIBOOT_NO_SAN ( URIBOOT_NO_SAN_DESCRIBE | \
 			 URIBOOT_NO_SAN_BOOT |	   \
 			 URIBOOT_NO_SAN_UNHOOK )
 
-extern int uriboot ( struct uri *filename, struct uri *root_path, int drive,
+extern void set_autoboot_busloc ( unsigned int bus_type,
+				  unsigned int location );
+extern int uriboot ( struct uri *filename, struct uri **root_paths,
+		     unsigned int root_path_count, int drive,
 		     unsigned int flags );
 extern struct uri *
 fetch_next_server_and_filename ( struct settings *settings );
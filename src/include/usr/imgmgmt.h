@@ -13,6 +13,10 @@ FILE_LICENCE ( GPL2_OR_LATER );
 
 extern int imgdownload ( struct uri *uri, struct image **image );
 extern int imgdownload_string ( const char *uri_string, struct image **image );
+extern int imgdownload_multi ( char **uri_strings, unsigned int count,
+			       unsigned int flags );
+extern int imgdownload_async ( const char *uri_string, const char *name,
+			       const char *cmdline );
 extern int imgacquire ( const char *name, struct image **image );
 extern void imgstat ( struct image *image );
 
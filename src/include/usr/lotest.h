@@ -10,6 +10,7 @@
 FILE_LICENCE ( GPL2_OR_LATER );
 
 extern int loopback_test ( struct net_device *sender,
-			   struct net_device *receiver, size_t mtu );
+			   struct net_device *receiver, size_t mtu,
+			   unsigned int window, unsigned int count );
 
 #endif /* _USR_LOTEST_H */
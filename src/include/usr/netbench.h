@@ -0,0 +1,16 @@
+#ifndef _USR_NETBENCH_H
+#define _USR_NETBENCH_H
+
+/** @file
+ *
+ * Network download benchmarking
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+struct uri;
+
+extern int netbench ( struct uri *uri, unsigned int count );
+
+#endif /* _USR_NETBENCH_H */
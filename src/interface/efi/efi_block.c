@@ -0,0 +1,1222 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/**
+ * @file
+ *
+ * EFI block device protocols
+ *
+ * A SAN device is exposed to EFI via the BlockIo and BlockIo2
+ * protocols, so that the firmware's partition and file system drivers
+ * (and hence any EFI OS loader) can read from it.
+ *
+ * Each BlockIo or BlockIo2 request is split into fragments no larger
+ * than the underlying block device's maximum transfer size, and the
+ * fragments are issued on up to EFI_BLOCK_MAX_COMMANDS concurrent
+ * block commands.  Asynchronous BlockIo2 requests are queued and
+ * driven to completion by a periodic timer event, so that a loader
+ * issuing several requests without waiting obtains pipelined I/O.
+ *
+ * The timer event runs at TPL_CALLBACK, and the protocol entry points
+ * raise the task priority level to TPL_CALLBACK while running, so
+ * that iPXE code is never reentered by the timer event.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <ipxe/list.h>
+#include <ipxe/uri.h>
+#include <ipxe/open.h>
+#include <ipxe/xfer.h>
+#include <ipxe/process.h>
+#include <ipxe/retry.h>
+#include <ipxe/timer.h>
+#include <ipxe/blockdev.h>
+#include <ipxe/blockstat.h>
+#include <ipxe/sanboot.h>
+#include <ipxe/efi/efi.h>
+#include <ipxe/efi/Protocol/BlockIo.h>
+#include <ipxe/efi/Protocol/BlockIo2.h>
+#include <ipxe/efi/Protocol/DevicePath.h>
+#include <ipxe/efi/Protocol/SimpleFileSystem.h>
+#include <ipxe/efi/efi_driver.h>
+
+/** Maximum number of concurrent commands per drive */
+#define EFI_BLOCK_MAX_COMMANDS 8
+
+/** Command timeout */
+#define EFI_BLOCK_COMMAND_TIMEOUT ( 15 * TICKS_PER_SEC )
+
+/** Polling interval for asynchronous requests (in 100ns units) */
+#define EFI_BLOCK_POLL_INTERVAL ( 10 * 10000 )
+
+/** EFI block I/O protocol GUID */
+static EFI_GUID efi_block_io_protocol_guid = EFI_BLOCK_IO_PROTOCOL_GUID;
+
+/** EFI block I/O 2 protocol GUID */
+static EFI_GUID efi_block_io2_protocol_guid = EFI_BLOCK_IO2_PROTOCOL_GUID;
+
+/** EFI device path protocol GUID */
+static EFI_GUID efi_device_path_protocol_guid =
+	EFI_DEVICE_PATH_PROTOCOL_GUID;
+
+/** EFI simple file system protocol GUID */
+static EFI_GUID efi_simple_file_system_protocol_guid =
+	EFI_SIMPLE_FILE_SYSTEM_PROTOCOL_GUID;
+
+/** Vendor GUID used within SAN device paths */
+static EFI_GUID efi_block_vendor_guid = {
+	0x4e1f5b9a, 0x2ae3, 0x4d4b,
+	{ 0x9b, 0x6e, 0x21, 0x7c, 0x5c, 0x0f, 0x3d, 0x81 }
+};
+
+/** Block read/write method */
+typedef int ( * efi_block_rw_t ) ( struct interface *control,
+				   struct interface *data, uint64_t lba,
+				   unsigned int count, userptr_t buffer,
+				   size_t len );
+
+/** A SAN device path */
+struct efi_block_path {
+	/** Vendor-defined hardware device path */
+	VENDOR_DEVICE_PATH vendor;
+	/** Drive number */
+	UINT8 drive;
+	/** End of device path */
+	EFI_DEVICE_PATH_PROTOCOL end;
+} __attribute__ (( packed ));
+
+/** An EFI block request */
+struct efi_block_request {
+	/** List of queued requests */
+	struct list_head list;
+	/** BlockIo2 token, or NULL for a synchronous request */
+	EFI_BLOCK_IO2_TOKEN *token;
+	/** Block read/write method */
+	efi_block_rw_t block_rw;
+	/** Starting logical block address of next fragment */
+	uint64_t lba;
+	/** Number of logical blocks not yet issued */
+	uint64_t count;
+	/** Data buffer for next fragment */
+	userptr_t buffer;
+	/** Number of fragments in progress */
+	unsigned int active;
+	/** Status */
+	int rc;
+	/** Request is complete */
+	int complete;
+};
+
+/** An EFI block command */
+struct efi_block_command {
+	/** Owning drive */
+	struct efi_block *block;
+	/** Block data interface */
+	struct interface data;
+	/** Command timeout timer */
+	struct retry_timer timer;
+	/** Request to which this fragment belongs, or NULL */
+	struct efi_block_request *request;
+	/** Length of fragment */
+	size_t len;
+	/** Time at which command was issued */
+	unsigned long started;
+	/** Status (or -EINPROGRESS while in progress) */
+	int rc;
+};
+
+/** An EFI block device */
+struct efi_block {
+	/** Reference count */
+	struct refcnt refcnt;
+	/** List of all registered drives */
+	struct list_head list;
+	/** Drive number */
+	unsigned int drive;
+
+	/** Block control interface */
+	struct interface block;
+	/** Block control interface status */
+	int block_rc;
+	/** Block device capacity */
+	struct block_device_capacity capacity;
+	/** Statistics */
+	struct block_device_stats stats;
+
+	/** Queued requests */
+	struct list_head requests;
+	/** Request processing process */
+	struct process process;
+	/** Commands */
+	struct efi_block_command commands[EFI_BLOCK_MAX_COMMANDS];
+	/** Polling timer event for asynchronous requests */
+	EFI_EVENT poll;
+	/** Polling timer is running */
+	int polling;
+
+	/** EFI handle */
+	EFI_HANDLE handle;
+	/** Media descriptor */
+	EFI_BLOCK_IO_MEDIA media;
+	/** Block I/O protocol */
+	EFI_BLOCK_IO_PROTOCOL block_io;
+	/** Block I/O 2 protocol */
+	EFI_BLOCK_IO2_PROTOCOL block_io2;
+	/** Device path */
+	struct efi_block_path path;
+
+	/** Number of URIs */
+	unsigned int num_uris;
+	/** URIs (treated as alternative paths to the same device) */
+	struct uri *uris[0];
+};
+
+/** List of registered drives */
+static LIST_HEAD ( efi_blocks );
+
+static void efi_block_request_progress ( struct efi_block *block );
+
+/******************************************************************************
+ *
+ * Block commands
+ *
+ ******************************************************************************
+ */
+
+/**
+ * Close EFI block command
+ *
+ * @v command		Command
+ * @v rc		Reason for close
+ */
+static void efi_block_command_close ( struct efi_block_command *command,
+				      int rc ) {
+	struct efi_block *block = command->block;
+	struct efi_block_request *request = command->request;
+
+	/* Ignore closes of idle commands */
+	if ( command->rc != -EINPROGRESS )
+		return;
+
+	/* Stop command */
+	intf_restart ( &command->data, rc );
+	stop_timer ( &command->timer );
+	command->rc = rc;
+
+	/* Record completion of fragment, if applicable */
+	if ( request ) {
+		block_stats_done ( &block->stats,
+				   ( currticks() - command->started ),
+				   command->len,
+				   ( request->block_rw == block_write ), rc );
+		command->request = NULL;
+		assert ( request->active > 0 );
+		request->active--;
+		if ( ( rc != 0 ) && ( request->rc == 0 ) ) {
+			/* Abandon any fragments not yet issued */
+			request->rc = rc;
+			request->count = 0;
+		}
+		process_add ( &block->process );
+	}
+}
+
+/**
+ * Record EFI block device capacity
+ *
+ * @v command		Command
+ * @v capacity		Block device capacity
+ */
+static void efi_block_command_capacity ( struct efi_block_command *command,
+				struct block_device_capacity *capacity ) {
+	struct efi_block *block = command->block;
+
+	memcpy ( &block->capacity, capacity, sizeof ( block->capacity ) );
+}
+
+/**
+ * Handle EFI block command timer expiry
+ *
+ * @v timer		Timer
+ * @v over		Failure indicator
+ */
+static void efi_block_command_expired ( struct retry_timer *timer,
+					int over __unused ) {
+	struct efi_block_command *command =
+		container_of ( timer, struct efi_block_command, timer );
+
+	command->block->stats.timeouts++;
+	efi_block_command_close ( command, -ETIMEDOUT );
+}
+
+/** EFI block command interface operations */
+static struct interface_operation efi_block_command_op[] = {
+	INTF_OP ( intf_close, struct efi_block_command *,
+		  efi_block_command_close ),
+	INTF_OP ( block_capacity, struct efi_block_command *,
+		  efi_block_command_capacity ),
+};
+
+/** EFI block command interface descriptor */
+static struct interface_descriptor efi_block_command_desc =
+	INTF_DESC ( struct efi_block_command, data, efi_block_command_op );
+
+/**
+ * Find idle EFI block command
+ *
+ * @v block		Block device
+ * @ret command		Command, or NULL if all commands are in progress
+ */
+static struct efi_block_command *
+efi_block_command_find_free ( struct efi_block *block ) {
+	struct efi_block_command *command;
+	unsigned int i;
+
+	for ( i = 0 ; i < EFI_BLOCK_MAX_COMMANDS ; i++ ) {
+		command = &block->commands[i];
+		if ( command->rc != -EINPROGRESS )
+			return command;
+	}
+	return NULL;
+}
+
+/**
+ * Open (or reopen) EFI block device
+ *
+ * @v block		Block device
+ * @ret rc		Return status code
+ *
+ * Each URI is tried in turn, and the first which can be opened is
+ * used.
+ */
+static int efi_block_reopen ( struct efi_block *block ) {
+	unsigned int i;
+	int rc = -ENODEV;
+
+	/* Close any existing block device */
+	intf_restart ( &block->block, -ECONNRESET );
+
+	/* Open block device */
+	for ( i = 0 ; i < block->num_uris ; i++ ) {
+		if ( ( rc = xfer_open_uri ( &block->block,
+					    block->uris[i] ) ) == 0 )
+			break;
+		DBGC ( block, "EFIBLK %#02x could not open path %d: %s\n",
+		       block->drive, i, strerror ( rc ) );
+	}
+	block->block_rc = rc;
+
+	return rc;
+}
+
+/**
+ * Check for EFI block commands in progress
+ *
+ * @v block		Block device
+ * @ret busy		Commands are in progress
+ */
+static int efi_block_busy ( struct efi_block *block ) {
+	unsigned int i;
+
+	for ( i = 0 ; i < EFI_BLOCK_MAX_COMMANDS ; i++ ) {
+		if ( block->commands[i].rc == -EINPROGRESS )
+			return 1;
+	}
+	return 0;
+}
+
+/**
+ * Start EFI block command
+ *
+ * @v command		Command
+ */
+static void efi_block_command_start ( struct efi_block_command *command ) {
+
+	command->rc = -EINPROGRESS;
+	start_timer_fixed ( &command->timer, EFI_BLOCK_COMMAND_TIMEOUT );
+}
+
+/**
+ * Read EFI block device capacity
+ *
+ * @v block		Block device
+ * @ret rc		Return status code
+ */
+static int efi_block_read_capacity ( struct efi_block *block ) {
+	struct efi_block_command *command = &block->commands[0];
+	int rc;
+
+	/* Wait for block control interface to become ready */
+	while ( ( block->block_rc == 0 ) &&
+		( xfer_window ( &block->block ) == 0 ) )
+		step();
+	if ( ( rc = block->block_rc ) != 0 )
+		return rc;
+
+	/* Issue command */
+	efi_block_command_start ( command );
+	if ( ( rc = block_read_capacity ( &block->block,
+					  &command->data ) ) != 0 ) {
+		efi_block_command_close ( command, rc );
+		return rc;
+	}
+
+	/* Wait for command to complete */
+	while ( command->rc == -EINPROGRESS )
+		step();
+
+	return command->rc;
+}
+
+/******************************************************************************
+ *
+ * Requests
+ *
+ ******************************************************************************
+ */
+
+/**
+ * Complete EFI block request
+ *
+ * @v block		Block device
+ * @v request		Request
+ */
+static void efi_block_request_complete ( struct efi_block *block,
+					 struct efi_block_request *request ) {
+	EFI_BOOT_SERVICES *bs = efi_systab->BootServices;
+
+	/* Remove from queue */
+	list_del ( &request->list );
+	if ( request->rc != 0 ) {
+		block->stats.errors++;
+		DBGC ( block, "EFIBLK %#02x request failed: %s\n",
+		       block->drive, strerror ( request->rc ) );
+	}
+
+	/* Report completion */
+	if ( request->token ) {
+		request->token->TransactionStatus = RC_TO_EFIRC ( request->rc );
+		bs->SignalEvent ( request->token->Event );
+		free ( request );
+	} else {
+		request->complete = 1;
+	}
+}
+
+/**
+ * Issue fragments of queued EFI block requests
+ *
+ * @v block		Block device
+ */
+static void efi_block_request_progress ( struct efi_block *block ) {
+	struct efi_block_request *request;
+	struct efi_block_request *tmp;
+	struct efi_block_command *command;
+	unsigned int count;
+	int rc;
+
+	/* Reopen block device if necessary */
+	if ( ( block->block_rc != 0 ) && ( ! efi_block_busy ( block ) ) &&
+	     ( ! list_empty ( &block->requests ) ) )
+		efi_block_reopen ( block );
+
+	list_for_each_entry_safe ( request, tmp, &block->requests, list ) {
+
+		/* Fail request if block device is unusable */
+		if ( ( block->block_rc != 0 ) && ( request->rc == 0 ) ) {
+			request->rc = block->block_rc;
+			request->count = 0;
+		}
+
+		/* Issue fragments while commands are available */
+		while ( request->count && xfer_window ( &block->block ) &&
+			( command = efi_block_command_find_free ( block ) ) ) {
+
+			/* Determine fragment length */
+			count = block->capacity.max_count;
+			if ( count > request->count )
+				count = request->count;
+			command->len = ( count * block->capacity.blksize );
+
+			/* Issue command */
+			efi_block_command_start ( command );
+			command->request = request;
+			command->started = currticks();
+			request->active++;
+			block_stats_issued ( &block->stats );
+			rc = request->block_rw ( &block->block,
+						 &command->data, request->lba,
+						 count, request->buffer,
+						 command->len );
+			if ( rc != 0 ) {
+				efi_block_command_close ( command, rc );
+				break;
+			}
+
+			/* Move to next fragment */
+			request->lba += count;
+			request->count -= count;
+			request->buffer = userptr_add ( request->buffer,
+							command->len );
+		}
+
+		/* Complete request if all fragments have completed */
+		if ( ( request->count == 0 ) && ( request->active == 0 ) )
+			efi_block_request_complete ( block, request );
+	}
+}
+
+/**
+ * Process EFI block requests
+ *
+ * @v block		Block device
+ */
+static void efi_block_step ( struct efi_block *block ) {
+	EFI_BOOT_SERVICES *bs = efi_systab->BootServices;
+
+	/* Issue and complete requests */
+	efi_block_request_progress ( block );
+
+	/* Stop processing (and polling) once idle.  The process will
+	 * be restarted when a command completes or a new request is
+	 * queued.
+	 */
+	if ( list_empty ( &block->requests ) ) {
+		process_del ( &block->process );
+		if ( block->polling ) {
+			bs->SetTimer ( block->poll, TimerCancel, 0 );
+			block->polling = 0;
+		}
+	}
+}
+
+/** EFI block request process descriptor */
+static struct process_descriptor efi_block_process_desc =
+	PROC_DESC ( struct efi_block, process, efi_block_step );
+
+/**
+ * Poll for completion of asynchronous requests
+ *
+ * @v event		Event
+ * @v context		Event context
+ */
+static VOID EFIAPI efi_block_poll ( EFI_EVENT event __unused,
+				    VOID *context __unused ) {
+	step();
+}
+
+/**
+ * Submit EFI block request
+ *
+ * @v block		Block device
+ * @v media_id		Media ID
+ * @v lba		Starting logical block address
+ * @v token		BlockIo2 token, or NULL
+ * @v len		Length of data buffer
+ * @v data		Data buffer
+ * @v block_rw		Block read/write method
+ * @ret efirc		EFI status code
+ *
+ * If the token is absent or has no event, then the request is
+ * completed synchronously.
+ */
+static EFI_STATUS efi_block_submit ( struct efi_block *block, UINT32 media_id,
+				     EFI_LBA lba, EFI_BLOCK_IO2_TOKEN *token,
+				     UINTN len, VOID *data,
+				     efi_block_rw_t block_rw ) {
+	EFI_BOOT_SERVICES *bs = efi_systab->BootServices;
+	struct efi_block_request sync;
+	struct efi_block_request *request;
+	size_t blksize = block->capacity.blksize;
+	uint64_t count = ( len / blksize );
+	EFI_TPL saved_tpl;
+	EFI_STATUS efirc;
+
+	/* Sanity checks */
+	if ( media_id != block->media.MediaId )
+		return EFI_MEDIA_CHANGED;
+	if ( ( len % blksize ) != 0 )
+		return EFI_BAD_BUFFER_SIZE;
+	if ( ( ! data ) || ( lba > block->media.LastBlock ) ||
+	     ( count > ( block->media.LastBlock + 1 - lba ) ) )
+		return EFI_INVALID_PARAMETER;
+
+	/* Use a request on the stack for synchronous requests */
+	if ( token && ( ! token->Event ) )
+		token = NULL;
+	if ( token ) {
+		request = malloc ( sizeof ( *request ) );
+		if ( ! request )
+			return EFI_OUT_OF_RESOURCES;
+	} else {
+		request = &sync;
+	}
+	memset ( request, 0, sizeof ( *request ) );
+	request->token = token;
+	request->block_rw = block_rw;
+	request->lba = lba;
+	request->count = count;
+	request->buffer = virt_to_user ( data );
+
+	/* Prevent the polling event from reentering iPXE */
+	saved_tpl = bs->RaiseTPL ( TPL_CALLBACK );
+
+	/* Queue request */
+	list_add_tail ( &request->list, &block->requests );
+	process_add ( &block->process );
+
+	/* Start polling for completion of asynchronous requests */
+	if ( token && ( ! block->polling ) ) {
+		bs->SetTimer ( block->poll, TimerPeriodic,
+			       EFI_BLOCK_POLL_INTERVAL );
+		block->polling = 1;
+	}
+
+	/* Issue as many fragments as possible immediately */
+	efi_block_request_progress ( block );
+
+	/* Wait for synchronous requests to complete */
+	efirc = 0;
+	if ( ! token ) {
+		while ( ! request->complete )
+			step();
+		efirc = ( request->rc ? EFI_DEVICE_ERROR : 0 );
+	}
+
+	bs->RestoreTPL ( saved_tpl );
+	return efirc;
+}
+
+/******************************************************************************
+ *
+ * Block I/O protocols
+ *
+ ******************************************************************************
+ */
+
+/**
+ * Reset block device
+ *
+ * @v block_io		Block I/O protocol
+ * @v verify		Perform extended verification
+ * @ret efirc		EFI status code
+ */
+static EFI_STATUS EFIAPI efi_block_io_reset ( EFI_BLOCK_IO_PROTOCOL *block_io,
+					      BOOLEAN verify __unused ) {
+	struct efi_block *block =
+		container_of ( block_io, struct efi_block, block_io );
+
+	DBGC2 ( block, "EFIBLK %#02x reset\n", block->drive );
+	return 0;
+}
+
+/**
+ * Read from block device
+ *
+ * @v block_io		Block I/O protocol
+ * @v media_id		Media ID
+ * @v lba		Starting logical block address
+ * @v len		Length of data buffer
+ * @v data		Data buffer
+ * @ret efirc		EFI status code
+ */
+static EFI_STATUS EFIAPI efi_block_io_read ( EFI_BLOCK_IO_PROTOCOL *block_io,
+					     UINT32 media_id, EFI_LBA lba,
+					     UINTN len, VOID *data ) {
+	struct efi_block *block =
+		container_of ( block_io, struct efi_block, block_io );
+
+	DBGC2 ( block, "EFIBLK %#02x read %#llx+%#zx\n",
+		block->drive, ( ( unsigned long long ) lba ), ( size_t ) len );
+	return efi_block_submit ( block, media_id, lba, NULL, len, data,
+				  block_read );
+}
+
+/**
+ * Write to block device
+ *
+ * @v block_io		Block I/O protocol
+ * @v media_id		Media ID
+ * @v lba		Starting logical block address
+ * @v len		Length of data buffer
+ * @v data		Data buffer
+ * @ret efirc		EFI status code
+ */
+static EFI_STATUS EFIAPI efi_block_io_write ( EFI_BLOCK_IO_PROTOCOL *block_io,
+					      UINT32 media_id, EFI_LBA lba,
+					      UINTN len, VOID *data ) {
+	struct efi_block *block =
+		container_of ( block_io, struct efi_block, block_io );
+
+	DBGC2 ( block, "EFIBLK %#02x write %#llx+%#zx\n",
+		block->drive, ( ( unsigned long long ) lba ), ( size_t ) len );
+	return efi_block_submit ( block, media_id, lba, NULL, len, data,
+				  block_write );
+}
+
+/**
+ * Flush block device
+ *
+ * @v block_io		Block I/O protocol
+ * @ret efirc		EFI status code
+ */
+static EFI_STATUS EFIAPI efi_block_io_flush ( EFI_BLOCK_IO_PROTOCOL *block_io ){
+	struct efi_block *block =
+		container_of ( block_io, struct efi_block, block_io );
+
+	/* Writes are not cached, so there is nothing to flush */
+	DBGC2 ( block, "EFIBLK %#02x flush\n", block->drive );
+	return 0;
+}
+
+/**
+ * Reset block device (extended)
+ *
+ * @v block_io2		Block I/O 2 protocol
+ * @v verify		Perform extended verification
+ * @ret efirc		EFI status code
+ */
+static EFI_STATUS EFIAPI
+efi_block_io2_reset ( EFI_BLOCK_IO2_PROTOCOL *block_io2,
+		      BOOLEAN verify __unused ) {
+	struct efi_block *block =
+		container_of ( block_io2, struct efi_block, block_io2 );
+
+	DBGC2 ( block, "EFIBLK %#02x reset (extended)\n", block->drive );
+	return 0;
+}
+
+/**
+ * Read from block device (extended)
+ *
+ * @v block_io2		Block I/O 2 protocol
+ * @v media_id		Media ID
+ * @v lba		Starting logical block address
+ * @v token		Token, or NULL
+ * @v len		Length of data buffer
+ * @v data		Data buffer
+ * @ret efirc		EFI status code
+ */
+static EFI_STATUS EFIAPI
+efi_block_io2_read ( EFI_BLOCK_IO2_PROTOCOL *block_io2, UINT32 media_id,
+		     EFI_LBA lba, EFI_BLOCK_IO2_TOKEN *token, UINTN len,
+		     VOID *data ) {
+	struct efi_block *block =
+		container_of ( block_io2, struct efi_block, block_io2 );
+
+	DBGC2 ( block, "EFIBLK %#02x read %#llx+%#zx%s\n",
+		block->drive, ( ( unsigned long long ) lba ), ( size_t ) len,
+		( ( token && token->Event ) ? " (async)" : "" ) );
+	return efi_block_submit ( block, media_id, lba, token, len, data,
+				  block_read );
+}
+
+/**
+ * Write to block device (extended)
+ *
+ * @v block_io2		Block I/O 2 protocol
+ * @v media_id		Media ID
+ * @v lba		Starting logical block address
+ * @v token		Token, or NULL
+ * @v len		Length of data buffer
+ * @v data		Data buffer
+ * @ret efirc		EFI status code
+ */
+static EFI_STATUS EFIAPI
+efi_block_io2_write ( EFI_BLOCK_IO2_PROTOCOL *block_io2, UINT32 media_id,
+		      EFI_LBA lba, EFI_BLOCK_IO2_TOKEN *token, UINTN len,
+		      VOID *data ) {
+	struct efi_block *block =
+		container_of ( block_io2, struct efi_block, block_io2 );
+
+	DBGC2 ( block, "EFIBLK %#02x write %#llx+%#zx%s\n",
+		block->drive, ( ( unsigned long long ) lba ), ( size_t ) len,
+		( ( token && token->Event ) ? " (async)" : "" ) );
+	return efi_block_submit ( block, media_id, lba, token, len, data,
+				  block_write );
+}
+
+/**
+ * Flush block device (extended)
+ *
+ * @v block_io2		Block I/O 2 protocol
+ * @v token		Token, or NULL
+ * @ret efirc		EFI status code
+ */
+static EFI_STATUS EFIAPI
+efi_block_io2_flush ( EFI_BLOCK_IO2_PROTOCOL *block_io2,
+		      EFI_BLOCK_IO2_TOKEN *token ) {
+	EFI_BOOT_SERVICES *bs = efi_systab->BootServices;
+	struct efi_block *block =
+		container_of ( block_io2, struct efi_block, block_io2 );
+
+	/* Writes are not cached, so there is nothing to flush */
+	DBGC2 ( block, "EFIBLK %#02x flush (extended)\n", block->drive );
+	if ( token && token->Event ) {
+		token->TransactionStatus = 0;
+		bs->SignalEvent ( token->Event );
+	}
+	return 0;
+}
+
+/** Block I/O protocol */
+static EFI_BLOCK_IO_PROTOCOL efi_block_io_protocol = {
+	.Revision = EFI_BLOCK_IO_PROTOCOL_REVISION,
+	.Reset = efi_block_io_reset,
+	.ReadBlocks = efi_block_io_read,
+	.WriteBlocks = efi_block_io_write,
+	.FlushBlocks = efi_block_io_flush,
+};
+
+/** Block I/O 2 protocol */
+static EFI_BLOCK_IO2_PROTOCOL efi_block_io2_protocol = {
+	.Reset = efi_block_io2_reset,
+	.ReadBlocksEx = efi_block_io2_read,
+	.WriteBlocksEx = efi_block_io2_write,
+	.FlushBlocksEx = efi_block_io2_flush,
+};
+
+/******************************************************************************
+ *
+ * SAN boot API
+ *
+ ******************************************************************************
+ */
+
+/**
+ * Close EFI block control interface
+ *
+ * @v block		Block device
+ * @v rc		Reason for close
+ */
+static void efi_block_close ( struct efi_block *block, int rc ) {
+
+	/* Any closure is an error from our point of view */
+	if ( rc == 0 )
+		rc = -ENOTCONN;
+	DBGC ( block, "EFIBLK %#02x went away: %s\n",
+	       block->drive, strerror ( rc ) );
+
+	/* Record block device error and reopen on next request */
+	intf_restart ( &block->block, rc );
+	block->block_rc = rc;
+	process_add ( &block->process );
+}
+
+/** EFI block control interface operations */
+static struct interface_operation efi_block_op[] = {
+	INTF_OP ( intf_close, struct efi_block *, efi_block_close ),
+};
+
+/** EFI block control interface descriptor */
+static struct interface_descriptor efi_block_desc =
+	INTF_DESC ( struct efi_block, block, efi_block_op );
+
+/**
+ * Free EFI block device
+ *
+ * @v refcnt		Reference count
+ */
+static void efi_block_free ( struct refcnt *refcnt ) {
+	struct efi_block *block =
+		container_of ( refcnt, struct efi_block, refcnt );
+	unsigned int i;
+
+	for ( i = 0 ; i < block->num_uris ; i++ )
+		uri_put ( block->uris[i] );
+	free ( block );
+}
+
+/**
+ * Shut down EFI block device interfaces
+ *
+ * @v block		Block device
+ * @v rc		Reason for shutdown
+ */
+static void efi_block_shutdown ( struct efi_block *block, int rc ) {
+	unsigned int i;
+
+	for ( i = 0 ; i < EFI_BLOCK_MAX_COMMANDS ; i++ )
+		efi_block_command_close ( &block->commands[i], rc );
+	intf_shutdown ( &block->block, rc );
+	process_del ( &block->process );
+}
+
+/**
+ * Find EFI block device by drive number
+ *
+ * @v drive		Drive number
+ * @ret block		Block device, or NULL
+ */
+static struct efi_block * efi_block_find ( unsigned int drive ) {
+	struct efi_block *block;
+
+	list_for_each_entry ( block, &efi_blocks, list ) {
+		if ( block->drive == drive )
+			return block;
+	}
+	return NULL;
+}
+
+/**
+ * Hook EFI block device
+ *
+ * @v uris		List of URIs
+ * @v count		Number of URIs
+ * @v drive		Drive number
+ * @v flags		Flags
+ * @ret rc		Return status code
+ */
+static int efi_block_hook ( struct uri **uris, unsigned int count,
+			    unsigned int drive, unsigned int flags ) {
+	EFI_BOOT_SERVICES *bs = efi_systab->BootServices;
+	struct efi_block_command *command;
+	struct efi_block *block;
+	EFI_STATUS efirc;
+	char name[12];
+	unsigned int i;
+	int rc;
+
+	/* Sanity checks */
+	if ( ! count )
+		return -EINVAL;
+	if ( flags & SAN_RAMDISK ) {
+		DBG ( "EFIBLK %#02x cannot use a RAM disk\n", drive );
+		return -ENOTSUP;
+	}
+	if ( efi_block_find ( drive ) )
+		return -EADDRINUSE;
+
+	/* Allocate and initialise structure */
+	block = zalloc ( sizeof ( *block ) +
+			 ( count * sizeof ( block->uris[0] ) ) );
+	if ( ! block ) {
+		rc = -ENOMEM;
+		goto err_zalloc;
+	}
+	ref_init ( &block->refcnt, efi_block_free );
+	block->drive = drive;
+	intf_init ( &block->block, &efi_block_desc, &block->refcnt );
+	block_stats_init ( &block->stats, &block->refcnt );
+	INIT_LIST_HEAD ( &block->requests );
+	process_init_stopped ( &block->process, &efi_block_process_desc,
+			       &block->refcnt );
+	for ( i = 0 ; i < EFI_BLOCK_MAX_COMMANDS ; i++ ) {
+		command = &block->commands[i];
+		command->block = block;
+		intf_init ( &command->data, &efi_block_command_desc,
+			    &block->refcnt );
+		timer_init ( &command->timer, efi_block_command_expired,
+			     &block->refcnt );
+	}
+	block->num_uris = count;
+	for ( i = 0 ; i < count ; i++ )
+		block->uris[i] = uri_get ( uris[i] );
+
+	/* Open block device and read capacity */
+	if ( ( rc = efi_block_reopen ( block ) ) != 0 )
+		goto err_reopen;
+	if ( ( rc = efi_block_read_capacity ( block ) ) != 0 ) {
+		DBGC ( block, "EFIBLK %#02x could not read capacity: %s\n",
+		       block->drive, strerror ( rc ) );
+		goto err_read_capacity;
+	}
+	if ( ! block->capacity.max_count )
+		block->capacity.max_count = 1;
+
+	/* Populate protocols */
+	block->media.MediaId = 0;
+	block->media.MediaPresent = 1;
+	block->media.LogicalPartition = 0;
+	block->media.BlockSize = block->capacity.blksize;
+	block->media.LastBlock = ( block->capacity.blocks - 1 );
+	memcpy ( &block->block_io, &efi_block_io_protocol,
+		 sizeof ( block->block_io ) );
+	block->block_io.Media = &block->media;
+	memcpy ( &block->block_io2, &efi_block_io2_protocol,
+		 sizeof ( block->block_io2 ) );
+	block->block_io2.Media = &block->media;
+
+	/* Construct device path */
+	block->path.vendor.Header.Type = HARDWARE_DEVICE_PATH;
+	block->path.vendor.Header.SubType = HW_VENDOR_DP;
+	block->path.vendor.Header.Length[0] =
+		( sizeof ( block->path.vendor ) + sizeof ( block->path.drive ));
+	memcpy ( &block->path.vendor.Guid, &efi_block_vendor_guid,
+		 sizeof ( block->path.vendor.Guid ) );
+	block->path.drive = drive;
+	block->path.end.Type = END_DEVICE_PATH_TYPE;
+	block->path.end.SubType = END_ENTIRE_DEVICE_PATH_SUBTYPE;
+	block->path.end.Length[0] = sizeof ( block->path.end );
+
+	/* Create polling timer event */
+	if ( ( efirc = bs->CreateEvent ( ( EVT_TIMER | EVT_NOTIFY_SIGNAL ),
+					 TPL_CALLBACK, efi_block_poll, block,
+					 &block->poll ) ) != 0 ) {
+		DBGC ( block, "EFIBLK %#02x could not create event: %s\n",
+		       block->drive, efi_strerror ( efirc ) );
+		rc = EFIRC_TO_RC ( efirc );
+		goto err_create_event;
+	}
+
+	/* Register statistics */
+	snprintf ( name, sizeof ( name ), "san%02x", block->drive );
+	if ( ( rc = block_stats_register ( &block->stats, name ) ) != 0 )
+		goto err_stats_register;
+
+	/* Install protocols */
+	if ( ( efirc = bs->InstallMultipleProtocolInterfaces (
+			&block->handle,
+			&efi_block_io_protocol_guid, &block->block_io,
+			&efi_block_io2_protocol_guid, &block->block_io2,
+			&efi_device_path_protocol_guid, &block->path,
+			NULL ) ) != 0 ) {
+		DBGC ( block, "EFIBLK %#02x could not install protocols: "
+		       "%s\n", block->drive, efi_strerror ( efirc ) );
+		rc = EFIRC_TO_RC ( efirc );
+		goto err_install;
+	}
+
+	/* Add to list of drives */
+	list_add ( &block->list, &efi_blocks );
+	DBGC ( block, "EFIBLK %#02x registered with %lld %zd-byte blocks via "
+	       "%d path(s)\n", block->drive,
+	       ( ( unsigned long long ) block->capacity.blocks ),
+	       block->capacity.blksize, block->num_uris );
+
+	return 0;
+
+ err_install:
+	block_stats_unregister ( &block->stats );
+ err_stats_register:
+	bs->CloseEvent ( block->poll );
+ err_create_event:
+ err_read_capacity:
+ err_reopen:
+	efi_block_shutdown ( block, rc );
+	ref_put ( &block->refcnt );
+ err_zalloc:
+	return rc;
+}
+
+/**
+ * Unhook EFI block device
+ *
+ * @v drive		Drive number
+ */
+static void efi_block_unhook ( unsigned int drive ) {
+	EFI_BOOT_SERVICES *bs = efi_systab->BootServices;
+	struct efi_block *block;
+	EFI_STATUS efirc;
+
+	/* Find drive */
+	block = efi_block_find ( drive );
+	if ( ! block ) {
+		DBG ( "EFIBLK cannot find drive %#02x\n", drive );
+		return;
+	}
+
+	/* Disconnect any drivers and uninstall protocols */
+	bs->DisconnectController ( block->handle, NULL, NULL );
+	if ( ( efirc = bs->UninstallMultipleProtocolInterfaces (
+			block->handle,
+			&efi_block_io_protocol_guid, &block->block_io,
+			&efi_block_io2_protocol_guid, &block->block_io2,
+			&efi_device_path_protocol_guid, &block->path,
+			NULL ) ) != 0 ) {
+		/* Leave the drive registered, since the firmware
+		 * still holds pointers into it.
+		 */
+		DBGC ( block, "EFIBLK %#02x could not uninstall protocols: "
+		       "%s\n", block->drive, efi_strerror ( efirc ) );
+		return;
+	}
+
+	/* Shut down drive */
+	bs->CloseEvent ( block->poll );
+	block_stats_unregister ( &block->stats );
+	efi_block_shutdown ( block, 0 );
+	list_del ( &block->list );
+	DBGC ( block, "EFIBLK %#02x unregistered\n", block->drive );
+	ref_put ( &block->refcnt );
+}
+
+/**
+ * Attempt to boot from an EFI file system on a block device
+ *
+ * @v block		Block device
+ * @v handle		File system handle
+ * @ret rc		Return status code
+ */
+static int efi_block_boot_image ( struct efi_block *block,
+				  EFI_HANDLE handle ) {
+	EFI_BOOT_SERVICES *bs = efi_systab->BootServices;
+	static CHAR16 filename[] = EFI_REMOVABLE_MEDIA_FILE_NAME;
+	size_t prefix_len = ( sizeof ( block->path ) -
+			      sizeof ( block->path.end ) );
+	union {
+		EFI_DEVICE_PATH_PROTOCOL *path;
+		void *interface;
+	} path;
+	EFI_DEVICE_PATH_PROTOCOL *boot_path;
+	FILEPATH_DEVICE_PATH *filepath;
+	EFI_DEVICE_PATH_PROTOCOL *end;
+	EFI_HANDLE image;
+	size_t path_len;
+	size_t filepath_len;
+	EFI_STATUS efirc;
+	int rc;
+
+	/* Identify file system device path */
+	if ( ( efirc = bs->OpenProtocol ( handle,
+					  &efi_device_path_protocol_guid,
+					  &path.interface, efi_image_handle,
+					  handle,
+					  EFI_OPEN_PROTOCOL_GET_PROTOCOL ))!=0){
+		rc = EFIRC_TO_RC ( efirc );
+		goto err_open_protocol;
+	}
+
+	/* Ignore file systems not on this block device */
+	if ( memcmp ( path.path, &block->path, prefix_len ) != 0 ) {
+		rc = -ENOTTY;
+		goto err_not_child;
+	}
+
+	/* Construct device path for boot file */
+	path_len = ( ( ( void * ) efi_devpath_end ( path.path ) ) -
+		     ( ( void * ) path.path ) );
+	filepath_len = ( SIZE_OF_FILEPATH_DEVICE_PATH + sizeof ( filename ) );
+	boot_path = zalloc ( path_len + filepath_len + sizeof ( *end ) );
+	if ( ! boot_path ) {
+		rc = -ENOMEM;
+		goto err_alloc_path;
+	}
+	memcpy ( boot_path, path.path, path_len );
+	filepath = ( ( ( void * ) boot_path ) + path_len );
+	filepath->Header.Type = MEDIA_DEVICE_PATH;
+	filepath->Header.SubType = MEDIA_FILEPATH_DP;
+	filepath->Header.Length[0] = ( filepath_len & 0xff );
+	filepath->Header.Length[1] = ( filepath_len >> 8 );
+	memcpy ( filepath->PathName, filename, sizeof ( filename ) );
+	end = ( ( ( void * ) filepath ) + filepath_len );
+	end->Type = END_DEVICE_PATH_TYPE;
+	end->SubType = END_ENTIRE_DEVICE_PATH_SUBTYPE;
+	end->Length[0] = sizeof ( *end );
+
+	/* Load and start image */
+	if ( ( efirc = bs->LoadImage ( FALSE, efi_image_handle, boot_path,
+				       NULL, 0, &image ) ) != 0 ) {
+		DBGC ( block, "EFIBLK %#02x could not load image: %s\n",
+		       block->drive, efi_strerror ( efirc ) );
+		rc = EFIRC_TO_RC ( efirc );
+		goto err_load_image;
+	}
+	DBGC ( block, "EFIBLK %#02x booting image\n", block->drive );
+	efirc = bs->StartImage ( image, NULL, NULL );
+	DBGC ( block, "EFIBLK %#02x image returned: %s\n",
+	       block->drive, efi_strerror ( efirc ) );
+	rc = EFIRC_TO_RC ( efirc );
+
+	/* Unload image, in case it did not unload itself */
+	bs->UnloadImage ( image );
+ err_load_image:
+	free ( boot_path );
+ err_alloc_path:
+ err_not_child:
+ err_open_protocol:
+	return rc;
+}
+
+/**
+ * Boot from EFI block device
+ *
+ * @v drive		Drive number
+ * @ret rc		Return status code
+ *
+ * The firmware's partition and file system drivers are connected to
+ * the block device, and the standard removable media boot file is
+ * loaded from the first file system found upon it.
+ */
+static int efi_block_boot ( unsigned int drive ) {
+	EFI_BOOT_SERVICES *bs = efi_systab->BootServices;
+	struct efi_block *block;
+	EFI_HANDLE *handles;
+	UINTN count;
+	unsigned int i;
+	EFI_STATUS efirc;
+	int rc;
+
+	/* Find drive */
+	block = efi_block_find ( drive );
+	if ( ! block ) {
+		DBG ( "EFIBLK cannot find drive %#02x\n", drive );
+		return -ENODEV;
+	}
+
+	/* Connect all possible drivers */
+	bs->ConnectController ( block->handle, NULL, NULL, TRUE );
+
+	/* Locate all file systems */
+	if ( ( efirc = bs->LocateHandleBuffer ( ByProtocol,
+				&efi_simple_file_system_protocol_guid,
+				NULL, &count, &handles ) ) != 0 ) {
+		DBGC ( block, "EFIBLK %#02x found no file systems: %s\n",
+		       block->drive, efi_strerror ( efirc ) );
+		return -ENOENT;
+	}
+
+	/* Try booting from each file system on this drive */
+	rc = -ENOENT;
+	for ( i = 0 ; i < count ; i++ ) {
+		if ( ( rc = efi_block_boot_image ( block, handles[i] ) ) == 0 )
+			break;
+	}
+
+	bs->FreePool ( handles );
+	return rc;
+}
+
+/**
+ * Describe EFI block device
+ *
+ * @v drive		Drive number
+ * @ret rc		Return status code
+ *
+ * Installing boot firmware tables (e.g. an iBFT) requires the EFI
+ * ACPI table protocol, which is not yet supported.  Use the
+ * "--no-describe" option to boot without describing the device.
+ */
+static int efi_block_describe ( unsigned int drive ) {
+
+	DBG ( "EFIBLK cannot describe drive %#02x\n", drive );
+	return -ENOTSUP;
+}
+
+PROVIDE_SANBOOT_INLINE ( efi, san_default_drive );
+PROVIDE_SANBOOT ( efi, san_hook, efi_block_hook );
+PROVIDE_SANBOOT ( efi, san_unhook, efi_block_unhook );
+PROVIDE_SANBOOT ( efi, san_boot, efi_block_boot );
+PROVIDE_SANBOOT ( efi, san_describe, efi_block_describe );
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <string.h>
+#include <ipxe/dhcp.h>
+#include <ipxe/uaccess.h>
+#include <ipxe/efi/efi.h>
+#include <ipxe/efi/Protocol/LoadedImage.h>
+#include <ipxe/efi/Protocol/PxeBaseCode.h>
+
+/** @file
+ *
+ * EFI cached DHCP packet
+ *
+ * When iPXE is itself loaded via PXE (e.g. by the platform firmware,
+ * or by any other bootloader providing the PXE base code protocol),
+ * the DHCPACK already obtained by the PXE base code is retained in
+ * the protocol's mode data.  Reusing this packet allows iPXE to
+ * start transfers immediately, rather than repeating the entire DHCP
+ * transaction.
+ */
+
+/** PXE base code protocol GUID */
+static EFI_GUID efi_pxe_base_code_protocol_guid =
+	EFI_PXE_BASE_CODE_PROTOCOL_GUID;
+
+/**
+ * Present cached DHCP packet if it exists
+ */
+void get_cached_dhcpack ( void ) {
+	EFI_BOOT_SERVICES *bs = efi_systab->BootServices;
+	EFI_HANDLE device = efi_loaded_image->DeviceHandle;
+	union {
+		EFI_PXE_BASE_CODE_PROTOCOL *pxe;
+		void *interface;
+	} u;
+	EFI_PXE_BASE_CODE_MODE *mode;
+	EFI_STATUS efirc;
+
+	/* Look for PXE base code protocol on our loaded image's device */
+	if ( ( efirc = bs->OpenProtocol ( device,
+					  &efi_pxe_base_code_protocol_guid,
+					  &u.interface, efi_image_handle, NULL,
+					  EFI_OPEN_PROTOCOL_GET_PROTOCOL ))!=0){
+		DBGC ( device, "EFI %p has no PXE base code: %s\n",
+		       device, efi_strerror ( efirc ) );
+		return;
+	}
+
+	/* Check for a cached DHCPACK */
+	mode = u.pxe->Mode;
+	if ( ! ( mode->Started && mode->DhcpAckReceived ) ) {
+		DBGC ( device, "EFI %p has no cached DHCPACK\n", device );
+		return;
+	}
+	if ( mode->UsingIpv6 ) {
+		DBGC ( device, "EFI %p has an IPv6 DHCP reply\n", device );
+		return;
+	}
+	DBGC ( device, "EFI %p found cached DHCPACK\n", device );
+
+	/* Present cached DHCP packet */
+	store_cached_dhcpack ( virt_to_user ( &mode->DhcpAck ),
+			       sizeof ( mode->DhcpAck ) );
+}
@@ -49,6 +49,9 @@ FILE_LICENCE ( GPL2_OR_LATER );
 
 #define ATTR_DEFAULT		ATTR_FCOL_WHITE
 
+/** Maximum number of characters passed in a single OutputString() call */
+#define EFI_WRITE_MAX		64
+
 /* Set default console usage if applicable */
 #if ! ( defined ( CONSOLE_EFI ) && CONSOLE_EXPLICIT ( CONSOLE_EFI ) )
 #undef CONSOLE_EFI
@@ -167,6 +170,50 @@ static void efi_putchar ( int character ) {
 	conout->OutputString ( conout, wstr );
 }
 
+/**
+ * Print a string to EFI console
+ *
+ * @v data		Characters to be printed
+ * @v len		Number of characters
+ *
+ * Runs of characters lying outside ANSI escape sequences are passed
+ * to the firmware using a single OutputString() call.
+ */
+static void efi_write ( const char *data, size_t len ) {
+	EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL *conout = efi_systab->ConOut;
+	wchar_t wstr[ EFI_WRITE_MAX + 1 /* NUL */ ];
+	unsigned int count = 0;
+	int character;
+
+	while ( len-- ) {
+		character = *( ( const unsigned char * ) data++ );
+
+		/* Add characters outside escape sequences to the run */
+		if ( ( efi_ansiesc_ctx.count == 0 ) && ( character != ESC ) ) {
+			wstr[count++] = character;
+			if ( count < EFI_WRITE_MAX )
+				continue;
+		}
+
+		/* Write out run, if applicable */
+		if ( count ) {
+			wstr[count] = 0;
+			conout->OutputString ( conout, wstr );
+			count = 0;
+		}
+
+		/* Process escape sequence characters */
+		if ( efi_ansiesc_ctx.count || ( character == ESC ) )
+			efi_putchar ( character );
+	}
+
+	/* Write out final run, if applicable */
+	if ( count ) {
+		wstr[count] = 0;
+		conout->OutputString ( conout, wstr );
+	}
+}
+
 /**
  * Pointer to current ANSI output sequence
  *
@@ -278,6 +325,7 @@ static int efi_iskey ( void ) {
 
 struct console_driver efi_console __console_driver = {
 	.putchar = efi_putchar,
+	.write = efi_write,
 	.getchar = efi_getchar,
 	.iskey = efi_iskey,
 	.usage = CONSOLE_EFI,
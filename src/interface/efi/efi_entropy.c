@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <string.h>
+#include <errno.h>
+#include <ipxe/entropy.h>
+#include <ipxe/efi/efi.h>
+#include <ipxe/efi/Protocol/Rng.h>
+
+/** @file
+ *
+ * EFI entropy source
+ *
+ * This entropy source uses the EFI_RNG_PROTOCOL, where provided by
+ * the platform firmware.
+ */
+
+/** Number of bytes to request from the RNG protocol at a time
+ *
+ * Each call to GetRNG() is relatively expensive, so we obtain
+ * samples in blocks and return them one at a time.
+ */
+#define EFI_ENTROPY_BLOCK_LEN 64
+
+/** EFI random number generator protocol GUID */
+static EFI_GUID efi_rng_protocol_guid = EFI_RNG_PROTOCOL_GUID;
+
+/** Random number generator protocol */
+static EFI_RNG_PROTOCOL *efirng;
+
+/** Buffered samples */
+static uint8_t efi_entropy_buf[EFI_ENTROPY_BLOCK_LEN];
+
+/** Number of buffered samples remaining */
+static unsigned int efi_entropy_remaining;
+
+/**
+ * Enable entropy gathering
+ *
+ * @ret rc		Return status code
+ */
+static int efi_entropy_enable ( void ) {
+	EFI_BOOT_SERVICES *bs = efi_systab->BootServices;
+	union {
+		EFI_RNG_PROTOCOL *rng;
+		void *interface;
+	} u;
+	EFI_STATUS efirc;
+	int rc;
+
+	/* Locate random number generator protocol.  This protocol
+	 * is optional, and so cannot be listed via
+	 * EFI_REQUIRE_PROTOCOL().
+	 */
+	if ( ( efirc = bs->LocateProtocol ( &efi_rng_protocol_guid, NULL,
+					    &u.interface ) ) != 0 ) {
+		rc = EFIRC_TO_RC ( efirc );
+		DBGC ( &efirng, "ENTROPY could not locate RNG protocol: "
+		       "%s\n", strerror ( rc ) );
+		return rc;
+	}
+	efirng = u.rng;
+	efi_entropy_remaining = 0;
+	DBGC ( &efirng, "ENTROPY using EFI RNG protocol %p\n", efirng );
+
+	return 0;
+}
+
+/**
+ * Disable entropy gathering
+ *
+ */
+static void efi_entropy_disable ( void ) {
+
+	/* Discard any unused samples */
+	memset ( efi_entropy_buf, 0, sizeof ( efi_entropy_buf ) );
+	efi_entropy_remaining = 0;
+	efirng = NULL;
+}
+
+/**
+ * Get noise sample
+ *
+ * @ret noise		Noise sample
+ * @ret rc		Return status code
+ */
+static int efi_get_noise ( noise_sample_t *noise ) {
+	EFI_STATUS efirc;
+	int rc;
+
+	/* Refill buffer if necessary */
+	if ( ! efi_entropy_remaining ) {
+		if ( ( efirc = efirng->GetRNG ( efirng, NULL,
+						sizeof ( efi_entropy_buf ),
+						efi_entropy_buf ) ) != 0 ) {
+			rc = EFIRC_TO_RC ( efirc );
+			DBGC ( &efirng, "ENTROPY could not read from RNG: "
+			       "%s\n", strerror ( rc ) );
+			return rc;
+		}
+		efi_entropy_remaining = sizeof ( efi_entropy_buf );
+	}
+
+	/* Consume one sample, erasing it from the buffer */
+	efi_entropy_remaining--;
+	*noise = efi_entropy_buf[efi_entropy_remaining];
+	efi_entropy_buf[efi_entropy_remaining] = 0;
+
+	return 0;
+}
+
+PROVIDE_ENTROPY_INLINE ( efi, min_entropy_per_sample );
+PROVIDE_ENTROPY ( efi, entropy_enable, efi_entropy_enable );
+PROVIDE_ENTROPY ( efi, entropy_disable, efi_entropy_disable );
+PROVIDE_ENTROPY ( efi, get_noise, efi_get_noise );
@@ -0,0 +1,663 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/**
+ * @file
+ *
+ * EFI file protocols
+ *
+ * Images registered with iPXE are exposed to the loaded EFI image via
+ * the SimpleFileSystem and LoadFile2 protocols, so that standard EFI
+ * loaders can read further files (kernels, initrds, configuration
+ * files, modules) through iPXE rather than through the firmware's
+ * own network stack.  A file which is not already registered is
+ * downloaded on demand, relative to the current working URI.
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <libgen.h>
+#include <ipxe/image.h>
+#include <ipxe/uaccess.h>
+#include <ipxe/uuid.h>
+#include <ipxe/efi/efi.h>
+#include <ipxe/efi/efi_strings.h>
+#include <ipxe/efi/Protocol/SimpleFileSystem.h>
+#include <ipxe/efi/Protocol/LoadFile2.h>
+#include <ipxe/efi/Protocol/DevicePath.h>
+#include <ipxe/efi/Guid/FileInfo.h>
+#include <ipxe/efi/Guid/FileSystemInfo.h>
+#include <usr/imgmgmt.h>
+
+/** EFI simple file system protocol GUID */
+static EFI_GUID efi_simple_file_system_protocol_guid
+	= EFI_SIMPLE_FILE_SYSTEM_PROTOCOL_GUID;
+
+/** EFI load file 2 protocol GUID */
+static EFI_GUID efi_load_file2_protocol_guid
+	= EFI_LOAD_FILE2_PROTOCOL_GUID;
+
+/** EFI file information GUID */
+static EFI_GUID efi_file_info_id = EFI_FILE_INFO_ID;
+
+/** EFI file system information GUID */
+static EFI_GUID efi_file_system_info_id = EFI_FILE_SYSTEM_INFO_ID;
+
+/** Maximum length of a file name */
+#define EFI_FILE_NAME_MAX 256
+
+/** Volume label */
+#define EFI_FILE_VOLUME_LABEL "iPXE"
+
+/** An EFI file */
+struct efi_file {
+	/** EFI file protocol */
+	EFI_FILE_PROTOCOL file;
+	/** Image (or NULL for the root directory) */
+	struct image *image;
+	/** Current file position (or directory entry index) */
+	size_t pos;
+};
+
+static struct efi_file efi_file_root;
+
+/**
+ * Get EFI file name (for debugging)
+ *
+ * @v file		EFI file
+ * @ret name		Name
+ */
+static const char * efi_file_name ( struct efi_file *file ) {
+
+	return ( file->image ? file->image->name : "<root>" );
+}
+
+/**
+ * Convert file path to ASCII
+ *
+ * @v wname		File path
+ * @v name		Name buffer
+ * @v len		Length of name buffer
+ * @ret rc		Return status code
+ *
+ * Leading backslashes are removed, and remaining backslashes are
+ * converted to forward slashes so that the path may be used as a
+ * relative URI.
+ */
+static int efi_file_path ( const CHAR16 *wname, char *name, size_t len ) {
+	size_t i;
+
+	/* Skip leading path separators */
+	while ( *wname == L'\\' )
+		wname++;
+
+	/* Convert to ASCII */
+	for ( i = 0 ; wname[i] ; i++ ) {
+		if ( ( i + 1 ) >= len )
+			return -ENAMETOOLONG;
+		if ( wname[i] >= 0x80 )
+			return -EINVAL;
+		name[i] = ( ( wname[i] == L'\\' ) ? '/' : wname[i] );
+	}
+	name[i] = '\0';
+
+	return 0;
+}
+
+/**
+ * Find (or download) image
+ *
+ * @v name		Path relative to the root directory
+ * @v image		Image to fill in
+ * @ret rc		Return status code
+ */
+static int efi_file_find ( char *name, struct image **image ) {
+
+	/* Look for an image registered under the full path, or under
+	 * the final path component (which is the name given to an
+	 * image by default when it is downloaded).
+	 */
+	if ( ( ( *image = find_image ( name ) ) != NULL ) ||
+	     ( ( *image = find_image ( basename ( name ) ) ) != NULL ) )
+		return 0;
+
+	/* Otherwise, download the file via iPXE's own stack */
+	return imgacquire ( name, image );
+}
+
+/**
+ * Open file
+ *
+ * @v this		EFI file
+ * @ret new		New EFI file
+ * @v wname		Filename
+ * @v mode		File mode
+ * @v attributes	File attributes (for newly-created files)
+ * @ret efirc		EFI status code
+ */
+static EFI_STATUS EFIAPI
+efi_file_open ( EFI_FILE_PROTOCOL *this, EFI_FILE_PROTOCOL **new,
+		CHAR16 *wname, UINT64 mode,
+		UINT64 attributes __unused ) {
+	struct efi_file *file = container_of ( this, struct efi_file, file );
+	char name[EFI_FILE_NAME_MAX];
+	struct efi_file *new_file;
+	struct image *image;
+	int rc;
+
+	/* Convert name to ASCII */
+	if ( ( rc = efi_file_path ( wname, name, sizeof ( name ) ) ) != 0 ) {
+		DBGC ( file, "EFIFILE %s could not convert name: %s\n",
+		       efi_file_name ( file ), strerror ( rc ) );
+		return RC_TO_EFIRC ( rc );
+	}
+
+	/* Only the root directory exists; all paths are relative to it */
+	if ( file != &efi_file_root ) {
+		DBGC ( file, "EFIFILE %s is not a directory\n",
+		       efi_file_name ( file ) );
+		return EFI_NOT_FOUND;
+	}
+
+	/* Return root directory for an empty path or "." */
+	if ( ( name[0] == '\0' ) || ( strcmp ( name, "." ) == 0 ) ) {
+		*new = &efi_file_root.file;
+		return 0;
+	}
+
+	/* All files are read-only */
+	if ( mode != EFI_FILE_MODE_READ ) {
+		DBGC ( file, "EFIFILE %s cannot be opened in mode %#08llx\n",
+		       name, mode );
+		return EFI_WRITE_PROTECTED;
+	}
+
+	/* Identify image */
+	if ( ( rc = efi_file_find ( name, &image ) ) != 0 ) {
+		DBGC ( file, "EFIFILE %s does not exist: %s\n",
+		       name, strerror ( rc ) );
+		return EFI_NOT_FOUND;
+	}
+
+	/* Allocate and initialise file */
+	new_file = zalloc ( sizeof ( *new_file ) );
+	if ( ! new_file )
+		return EFI_OUT_OF_RESOURCES;
+	memcpy ( &new_file->file, &efi_file_root.file,
+		 sizeof ( new_file->file ) );
+	new_file->image = image_get ( image );
+	*new = &new_file->file;
+	DBGC ( new_file, "EFIFILE %s opened\n", efi_file_name ( new_file ) );
+
+	return 0;
+}
+
+/**
+ * Close file
+ *
+ * @v this		EFI file
+ * @ret efirc		EFI status code
+ */
+static EFI_STATUS EFIAPI efi_file_close ( EFI_FILE_PROTOCOL *this ) {
+	struct efi_file *file = container_of ( this, struct efi_file, file );
+
+	/* Do nothing if this is the root */
+	if ( file == &efi_file_root )
+		return 0;
+
+	/* Close file */
+	DBGC ( file, "EFIFILE %s closed\n", efi_file_name ( file ) );
+	image_put ( file->image );
+	free ( file );
+
+	return 0;
+}
+
+/**
+ * Close and delete file
+ *
+ * @v this		EFI file
+ * @ret efirc		EFI status code
+ */
+static EFI_STATUS EFIAPI efi_file_delete ( EFI_FILE_PROTOCOL *this ) {
+	struct efi_file *file = container_of ( this, struct efi_file, file );
+
+	DBGC ( file, "EFIFILE %s cannot be deleted\n", efi_file_name ( file ) );
+
+	/* Close file */
+	efi_file_close ( this );
+
+	/* Warn of failure to delete */
+	return EFI_WARN_DELETE_FAILURE;
+}
+
+/**
+ * Construct file information
+ *
+ * @v image		Image (or NULL for the root directory)
+ * @v len		Length of data buffer
+ * @v data		Data buffer
+ * @ret efirc		EFI status code
+ */
+static EFI_STATUS efi_file_info ( struct image *image, UINTN *len,
+				  VOID *data ) {
+	EFI_FILE_INFO *info = data;
+	const char *name = ( image ? image->name : "" );
+	size_t name_len = ( strlen ( name ) + 1 /* NUL */ );
+	size_t info_len = ( SIZE_OF_EFI_FILE_INFO +
+			    ( name_len * sizeof ( info->FileName[0] ) ) );
+
+	/* Check buffer length */
+	if ( *len < info_len ) {
+		*len = info_len;
+		return EFI_BUFFER_TOO_SMALL;
+	}
+
+	/* Populate file information */
+	memset ( info, 0, info_len );
+	info->Size = info_len;
+	if ( image ) {
+		info->FileSize = image->len;
+		info->PhysicalSize = image->len;
+		info->Attribute = EFI_FILE_READ_ONLY;
+	} else {
+		info->Attribute = ( EFI_FILE_READ_ONLY | EFI_FILE_DIRECTORY );
+	}
+	efi_snprintf ( info->FileName, name_len, "%s", name );
+	*len = info_len;
+
+	return 0;
+}
+
+/**
+ * Read directory entry
+ *
+ * @v file		EFI file (the root directory)
+ * @v len		Length to read
+ * @v data		Data buffer
+ * @ret efirc		EFI status code
+ */
+static EFI_STATUS efi_file_read_dir ( struct efi_file *file, UINTN *len,
+				      VOID *data ) {
+	struct image *image;
+	unsigned int index = 0;
+	EFI_STATUS efirc;
+
+	/* Find image corresponding to the current directory entry */
+	for_each_image ( image ) {
+		if ( index++ != file->pos )
+			continue;
+		if ( ( efirc = efi_file_info ( image, len, data ) ) != 0 )
+			return efirc;
+		file->pos++;
+		return 0;
+	}
+
+	/* No more entries */
+	*len = 0;
+	return 0;
+}
+
+/**
+ * Read from file
+ *
+ * @v this		EFI file
+ * @v len		Length to read
+ * @v data		Data buffer
+ * @ret efirc		EFI status code
+ */
+static EFI_STATUS EFIAPI efi_file_read ( EFI_FILE_PROTOCOL *this,
+					 UINTN *len, VOID *data ) {
+	struct efi_file *file = container_of ( this, struct efi_file, file );
+	size_t remaining;
+
+	/* If this is the root directory, then construct a directory entry */
+	if ( ! file->image )
+		return efi_file_read_dir ( file, len, data );
+
+	/* Read from the image */
+	remaining = ( ( file->pos < file->image->len ) ?
+		      ( file->image->len - file->pos ) : 0 );
+	if ( *len > remaining )
+		*len = remaining;
+	DBGC2 ( file, "EFIFILE %s read [%#08zx,%#08zx)\n",
+		efi_file_name ( file ), file->pos,
+		( ( size_t ) ( file->pos + *len ) ) );
+	copy_from_user ( data, file->image->data, file->pos, *len );
+	file->pos += *len;
+
+	return 0;
+}
+
+/**
+ * Write to file
+ *
+ * @v this		EFI file
+ * @v len		Length to write
+ * @v data		Data buffer
+ * @ret efirc		EFI status code
+ */
+static EFI_STATUS EFIAPI efi_file_write ( EFI_FILE_PROTOCOL *this,
+					  UINTN *len, VOID *data __unused ) {
+	struct efi_file *file = container_of ( this, struct efi_file, file );
+
+	DBGC ( file, "EFIFILE %s cannot write %#08zx bytes\n",
+	       efi_file_name ( file ), ( ( size_t ) *len ) );
+	return EFI_WRITE_PROTECTED;
+}
+
+/**
+ * Set file position
+ *
+ * @v this		EFI file
+ * @v position		New file position
+ * @ret efirc		EFI status code
+ */
+static EFI_STATUS EFIAPI efi_file_set_position ( EFI_FILE_PROTOCOL *this,
+						 UINT64 position ) {
+	struct efi_file *file = container_of ( this, struct efi_file, file );
+
+	/* Only a rewind is permitted on the root directory */
+	if ( ! file->image ) {
+		if ( position != 0 )
+			return EFI_UNSUPPORTED;
+		file->pos = 0;
+		return 0;
+	}
+
+	/* Treat the special value 0xffffffffffffffff as "end of file" */
+	if ( position == ~( ( UINT64 ) 0 ) )
+		position = file->image->len;
+
+	/* Positions beyond the end of the file are permitted; reads
+	 * from such positions will return no data.
+	 */
+	if ( position > file->image->len )
+		position = file->image->len;
+	file->pos = position;
+
+	return 0;
+}
+
+/**
+ * Get file position
+ *
+ * @v this		EFI file
+ * @ret position	New file position
+ * @ret efirc		EFI status code
+ */
+static EFI_STATUS EFIAPI efi_file_get_position ( EFI_FILE_PROTOCOL *this,
+						 UINT64 *position ) {
+	struct efi_file *file = container_of ( this, struct efi_file, file );
+
+	/* Positions are not defined for directories */
+	if ( ! file->image )
+		return EFI_UNSUPPORTED;
+
+	*position = file->pos;
+	return 0;
+}
+
+/**
+ * Get file information
+ *
+ * @v this		EFI file
+ * @v type		Type of information
+ * @v len		Buffer size
+ * @v data		Buffer
+ * @ret efirc		EFI status code
+ */
+static EFI_STATUS EFIAPI efi_file_get_info ( EFI_FILE_PROTOCOL *this,
+					     EFI_GUID *type,
+					     UINTN *len, VOID *data ) {
+	struct efi_file *file = container_of ( this, struct efi_file, file );
+	EFI_FILE_SYSTEM_INFO *fsinfo = data;
+	static const char label[] = EFI_FILE_VOLUME_LABEL;
+	struct image *image;
+	size_t fsinfo_len;
+
+	/* Determine information to return */
+	if ( memcmp ( type, &efi_file_info_id, sizeof ( *type ) ) == 0 ) {
+
+		/* Get file information */
+		return efi_file_info ( file->image, len, data );
+
+	} else if ( memcmp ( type, &efi_file_system_info_id,
+			     sizeof ( *type ) ) == 0 ) {
+
+		/* Get file system information */
+		fsinfo_len = ( SIZE_OF_EFI_FILE_SYSTEM_INFO +
+			       ( sizeof ( label ) *
+				 sizeof ( fsinfo->VolumeLabel[0] ) ) );
+		if ( *len < fsinfo_len ) {
+			*len = fsinfo_len;
+			return EFI_BUFFER_TOO_SMALL;
+		}
+		memset ( fsinfo, 0, fsinfo_len );
+		fsinfo->Size = fsinfo_len;
+		fsinfo->ReadOnly = TRUE;
+		for_each_image ( image )
+			fsinfo->VolumeSize += image->len;
+		efi_snprintf ( fsinfo->VolumeLabel, sizeof ( label ),
+			       "%s", label );
+		*len = fsinfo_len;
+		return 0;
+
+	} else {
+
+		DBGC ( file, "EFIFILE %s cannot get information of type "
+		       "%s\n", efi_file_name ( file ),
+		       uuid_ntoa ( ( union uuid * ) type ) );
+		return EFI_UNSUPPORTED;
+	}
+}
+
+/**
+ * Set file information
+ *
+ * @v this		EFI file
+ * @v type		Type of information
+ * @v len		Buffer size
+ * @v data		Buffer
+ * @ret efirc		EFI status code
+ */
+static EFI_STATUS EFIAPI
+efi_file_set_info ( EFI_FILE_PROTOCOL *this, EFI_GUID *type __unused,
+		    UINTN len __unused, VOID *data __unused ) {
+	struct efi_file *file = container_of ( this, struct efi_file, file );
+
+	DBGC ( file, "EFIFILE %s cannot set information\n",
+	       efi_file_name ( file ) );
+	return EFI_WRITE_PROTECTED;
+}
+
+/**
+ * Flush file modified data
+ *
+ * @v this		EFI file
+ * @ret efirc		EFI status code
+ */
+static EFI_STATUS EFIAPI efi_file_flush ( EFI_FILE_PROTOCOL *this __unused ) {
+
+	/* Nothing to do */
+	return 0;
+}
+
+/** Root directory */
+static struct efi_file efi_file_root = {
+	.file = {
+		.Revision = EFI_FILE_PROTOCOL_REVISION,
+		.Open = efi_file_open,
+		.Close = efi_file_close,
+		.Delete = efi_file_delete,
+		.Read = efi_file_read,
+		.Write = efi_file_write,
+		.GetPosition = efi_file_get_position,
+		.SetPosition = efi_file_set_position,
+		.GetInfo = efi_file_get_info,
+		.SetInfo = efi_file_set_info,
+		.Flush = efi_file_flush,
+	},
+	.image = NULL,
+};
+
+/**
+ * Open root directory
+ *
+ * @v filesystem	EFI simple file system
+ * @ret file		EFI file handle
+ * @ret efirc		EFI status code
+ */
+static EFI_STATUS EFIAPI
+efi_file_open_volume ( EFI_SIMPLE_FILE_SYSTEM_PROTOCOL *filesystem __unused,
+		       EFI_FILE_PROTOCOL **file ) {
+
+	DBGC ( &efi_file_root, "EFIFILE open volume\n" );
+	*file = &efi_file_root.file;
+	return 0;
+}
+
+/** EFI simple file system protocol */
+static EFI_SIMPLE_FILE_SYSTEM_PROTOCOL efi_simple_file_system_protocol = {
+	.Revision = EFI_SIMPLE_FILE_SYSTEM_PROTOCOL_REVISION,
+	.OpenVolume = efi_file_open_volume,
+};
+
+/**
+ * Load file
+ *
+ * @v this		EFI load file 2 protocol
+ * @v path		Device path of file to load
+ * @v boot		Boot policy (must be FALSE)
+ * @v len		Length of data buffer
+ * @v data		Data buffer, or NULL to query length
+ * @ret efirc		EFI status code
+ *
+ * The file is identified by the first file path node within the
+ * device path.
+ */
+static EFI_STATUS EFIAPI
+efi_file_load ( EFI_LOAD_FILE2_PROTOCOL *this __unused,
+		EFI_DEVICE_PATH_PROTOCOL *path, BOOLEAN boot,
+		UINTN *len, VOID *data ) {
+	FILEPATH_DEVICE_PATH *filepath;
+	char name[EFI_FILE_NAME_MAX];
+	struct image *image;
+	int rc;
+
+	/* Boot policy must be FALSE for LoadFile2 */
+	if ( boot )
+		return EFI_UNSUPPORTED;
+	if ( ! ( path && len ) )
+		return EFI_INVALID_PARAMETER;
+
+	/* Find file path node */
+	while ( ! ( ( path->Type == MEDIA_DEVICE_PATH ) &&
+		    ( path->SubType == MEDIA_FILEPATH_DP ) ) ) {
+		if ( path->Type == END_DEVICE_PATH_TYPE ) {
+			DBGC ( &efi_file_root, "EFIFILE load with no file "
+			       "path\n" );
+			return EFI_NOT_FOUND;
+		}
+		path = ( ( ( void * ) path ) +
+			 ( path->Length[0] | ( path->Length[1] << 8 ) ) );
+	}
+	filepath = container_of ( path, FILEPATH_DEVICE_PATH, Header );
+
+	/* Identify image */
+	if ( ( rc = efi_file_path ( filepath->PathName, name,
+				    sizeof ( name ) ) ) != 0 )
+		return RC_TO_EFIRC ( rc );
+	if ( ( rc = efi_file_find ( name, &image ) ) != 0 ) {
+		DBGC ( &efi_file_root, "EFIFILE %s does not exist: %s\n",
+		       name, strerror ( rc ) );
+		return EFI_NOT_FOUND;
+	}
+
+	/* Check buffer length */
+	if ( ( ! data ) || ( *len < image->len ) ) {
+		*len = image->len;
+		return EFI_BUFFER_TOO_SMALL;
+	}
+
+	/* Copy image */
+	DBGC ( &efi_file_root, "EFIFILE %s loaded %#08zx bytes\n",
+	       image->name, image->len );
+	copy_from_user ( data, image->data, 0, image->len );
+	*len = image->len;
+
+	return 0;
+}
+
+/** EFI load file 2 protocol */
+static EFI_LOAD_FILE2_PROTOCOL efi_load_file2_protocol = {
+	.LoadFile = efi_file_load,
+};
+
+/**
+ * Install EFI file protocols
+ *
+ * @v handle		Device handle
+ * @ret rc		Return status code
+ */
+int efi_file_install ( EFI_HANDLE *handle ) {
+	EFI_BOOT_SERVICES *bs = efi_systab->BootServices;
+	EFI_STATUS efirc;
+	int rc;
+
+	/* Install protocols */
+	if ( ( efirc = bs->InstallMultipleProtocolInterfaces (
+			handle,
+			&efi_simple_file_system_protocol_guid,
+			&efi_simple_file_system_protocol,
+			&efi_load_file2_protocol_guid,
+			&efi_load_file2_protocol,
+			NULL ) ) != 0 ) {
+		rc = EFIRC_TO_RC ( efirc );
+		DBGC ( &efi_file_root, "EFIFILE could not install "
+		       "protocols: %s\n", strerror ( rc ) );
+		return rc;
+	}
+
+	return 0;
+}
+
+/**
+ * Uninstall EFI file protocols
+ *
+ * @v handle		Device handle
+ */
+void efi_file_uninstall ( EFI_HANDLE handle ) {
+	EFI_BOOT_SERVICES *bs = efi_systab->BootServices;
+
+	/* Uninstall protocols */
+	bs->UninstallMultipleProtocolInterfaces (
+			handle,
+			&efi_simple_file_system_protocol_guid,
+			&efi_simple_file_system_protocol,
+			&efi_load_file2_protocol_guid,
+			&efi_load_file2_protocol,
+			NULL );
+}
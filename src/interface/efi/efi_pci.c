@@ -22,6 +22,8 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <errno.h>
 #include <ipxe/pci.h>
 #include <ipxe/init.h>
+#include <ipxe/malloc.h>
+#include <ipxe/io.h>
 #include <ipxe/efi/efi.h>
 #include <ipxe/efi/efi_pci.h>
 #include <ipxe/efi/efi_driver.h>
@@ -208,6 +210,92 @@ struct efi_pci_device * efipci_create ( struct efi_driver *efidrv,
 	return NULL;
 }
 
+/**
+ * Map DMA pool for EFI PCI device
+ *
+ * @v efipci		EFI PCI device
+ * @ret efirc		EFI status code
+ *
+ * Platforms with an IOMMU may block all device accesses to memory
+ * that has not been explicitly mapped via the PCI I/O protocol.  All
+ * iPXE DMA buffers are allocated from a single contiguous pool, so we
+ * map the entire pool once as a common buffer when the device is
+ * enabled, and prevent the heap from subsequently growing beyond the
+ * mapped pool.  iPXE drivers use virt_to_bus() to obtain DMA addresses,
+ * so we cannot use a mapping that changes the device address.
+ */
+static EFI_STATUS efipci_map ( struct efi_pci_device *efipci ) {
+	EFI_PCI_IO_PROTOCOL *pci_io = efipci->pci_io;
+	EFI_PHYSICAL_ADDRESS bus;
+	void *mapping;
+	void *start;
+	size_t len;
+	UINTN count;
+	EFI_STATUS efirc;
+
+	/* Do nothing if already mapped */
+	if ( efipci->mapping )
+		return 0;
+
+	/* Map pool.  If the heap has already grown beyond a single
+	 * pool, then DMA buffers may lie outside any mapping we could
+	 * create, and so the device cannot safely be used.
+	 */
+	start = dma_pool ( &len );
+	if ( ! start ) {
+		DBGC ( efipci, "EFIPCI " PCI_FMT " has no single DMA pool\n",
+		       PCI_ARGS ( &efipci->pci ) );
+		return EFI_UNSUPPORTED;
+	}
+	count = len;
+	if ( ( efirc = pci_io->Map ( pci_io,
+				     EfiPciIoOperationBusMasterCommonBuffer,
+				     start, &count, &bus, &mapping ) ) != 0 ) {
+		/* Not all platforms support mapping arbitrary memory
+		 * as a common buffer; such platforms will generally
+		 * not restrict DMA via an IOMMU.
+		 */
+		DBGC ( efipci, "EFIPCI " PCI_FMT " could not map DMA pool: "
+		       "%s\n", PCI_ARGS ( &efipci->pci ),
+		       efi_strerror ( efirc ) );
+		return 0;
+	}
+
+	/* Check that mapping is usable */
+	if ( ( count != len ) || ( bus != virt_to_bus ( start ) ) ) {
+		DBGC ( efipci, "EFIPCI " PCI_FMT " mapped DMA pool [%08lx,"
+		       "%08lx) to [%08llx,%08llx)\n", PCI_ARGS ( &efipci->pci ),
+		       virt_to_phys ( start ), virt_to_phys ( start + len ),
+		       ( ( unsigned long long ) bus ),
+		       ( ( unsigned long long ) ( bus + count ) ) );
+		pci_io->Unmap ( pci_io, mapping );
+		return EFI_UNSUPPORTED;
+	}
+	DBGC2 ( efipci, "EFIPCI " PCI_FMT " mapped DMA pool [%08lx,%08lx)\n",
+		PCI_ARGS ( &efipci->pci ), virt_to_phys ( start ),
+		virt_to_phys ( start + len ) );
+	efipci->mapping = mapping;
+
+	/* Ensure that all DMA buffers remain within the mapped pool */
+	heap_fix();
+
+	return 0;
+}
+
+/**
+ * Unmap DMA pool for EFI PCI device
+ *
+ * @v efipci		EFI PCI device
+ */
+static void efipci_unmap ( struct efi_pci_device *efipci ) {
+	EFI_PCI_IO_PROTOCOL *pci_io = efipci->pci_io;
+
+	if ( efipci->mapping ) {
+		pci_io->Unmap ( pci_io, efipci->mapping );
+		efipci->mapping = NULL;
+	}
+}
+
 /**
  * Enable EFI PCI device
  *
@@ -228,6 +316,10 @@ EFI_STATUS efipci_enable ( struct efi_pci_device *efipci ) {
 		return efirc;
 	}
 
+	/* Map DMA pool */
+	if ( ( efirc = efipci_map ( efipci ) ) != 0 )
+		return efirc;
+
 	return 0;
 }
 
@@ -321,6 +413,7 @@ void efipci_destroy ( struct efi_driver *efidrv,
 		      struct efi_pci_device *efipci ) {
 	EFI_BOOT_SERVICES *bs = efi_systab->BootServices;
 
+	efipci_unmap ( efipci );
 	list_del ( &efipci->list );
 	bs->CloseProtocol ( efipci->device, &efi_device_path_protocol_guid,
 			    efidrv->driver.DriverBindingHandle,
@@ -73,6 +73,8 @@ struct efi_snp_device {
 	unsigned int rx_count_interrupts;
 	/** Outstanding RX packet count (via WaitForPacket event) */
 	unsigned int rx_count_events;
+	/** Promiscuous reception has been requested */
+	int promisc;
 	/** The network interface identifier */
 	EFI_NETWORK_INTERFACE_IDENTIFIER_PROTOCOL nii;
 	/** HII configuration access protocol */
@@ -132,7 +134,8 @@ static void efi_snp_set_mode ( struct efi_snp_device *snpdev ) {
 	mode->MaxPacketSize = netdev->max_pkt_len;
 	mode->ReceiveFilterMask = ( EFI_SIMPLE_NETWORK_RECEIVE_UNICAST |
 				    EFI_SIMPLE_NETWORK_RECEIVE_MULTICAST |
-				    EFI_SIMPLE_NETWORK_RECEIVE_BROADCAST );
+				    EFI_SIMPLE_NETWORK_RECEIVE_BROADCAST |
+				    EFI_SIMPLE_NETWORK_RECEIVE_PROMISCUOUS );
 	assert ( ll_addr_len <= sizeof ( mode->CurrentAddress ) );
 	memcpy ( &mode->CurrentAddress, netdev->ll_addr, ll_addr_len );
 	memcpy ( &mode->BroadcastAddress, netdev->ll_broadcast, ll_addr_len );
@@ -149,20 +152,17 @@ static void efi_snp_set_mode ( struct efi_snp_device *snpdev ) {
  * @v snpdev		SNP device
  */
 static void efi_snp_poll ( struct efi_snp_device *snpdev ) {
-	struct io_buffer *iobuf;
-	unsigned int before = 0;
-	unsigned int after = 0;
+	struct net_device *netdev = snpdev->netdev;
+	unsigned int before;
 	unsigned int arrived;
 
 	/* We have to report packet arrivals, and this is the easiest
-	 * way to fake it.
+	 * way to fake it.  Nothing is removed from the RX queue while
+	 * polling, so any growth in the queue represents new arrivals.
 	 */
-	list_for_each_entry ( iobuf, &snpdev->netdev->rx_queue, list )
-		before++;
-	netdev_poll ( snpdev->netdev );
-	list_for_each_entry ( iobuf, &snpdev->netdev->rx_queue, list )
-		after++;
-	arrived = ( after - before );
+	before = netdev->rx_fill;
+	netdev_poll ( netdev );
+	arrived = ( netdev->rx_fill - before );
 
 	snpdev->rx_count_interrupts += arrived;
 	snpdev->rx_count_events += arrived;
@@ -295,6 +295,8 @@ efi_snp_receive_filters ( EFI_SIMPLE_NETWORK_PROTOCOL *snp, UINT32 enable,
 			  UINTN mcast_count, EFI_MAC_ADDRESS *mcast ) {
 	struct efi_snp_device *snpdev =
 		container_of ( snp, struct efi_snp_device, snp );
+	UINT32 setting;
+	int promisc;
 	unsigned int i;
 
 	DBGC2 ( snpdev, "SNPDEV %p RECEIVE_FILTERS %08x&~%08x%s %ld mcast\n",
@@ -305,7 +307,20 @@ efi_snp_receive_filters ( EFI_SIMPLE_NETWORK_PROTOCOL *snp, UINT32 enable,
 			    snpdev->netdev->ll_protocol->ll_addr_len );
 	}
 
-	/* Lie through our teeth, otherwise MNP refuses to accept us */
+	/* Update promiscuous reception state.  Unicast, broadcast
+	 * and multicast packets are always received.
+	 */
+	setting = ( ( snpdev->mode.ReceiveFilterSetting | enable ) & ~disable );
+	snpdev->mode.ReceiveFilterSetting = setting;
+	promisc = ( ( setting & EFI_SIMPLE_NETWORK_RECEIVE_PROMISCUOUS ) != 0 );
+	if ( promisc != snpdev->promisc ) {
+		netdev_rx_promisc ( snpdev->netdev, promisc );
+		snpdev->promisc = promisc;
+	}
+
+	/* Lie through our teeth about anything else, otherwise MNP
+	 * refuses to accept us
+	 */
 	return 0;
 }
 
@@ -332,11 +347,8 @@ efi_snp_station_address ( EFI_SIMPLE_NETWORK_PROTOCOL *snp, BOOLEAN reset,
 		new = &snpdev->mode.PermanentAddress;
 	memcpy ( snpdev->netdev->ll_addr, new, ll_protocol->ll_addr_len );
 
-	/* MAC address changes take effect only on netdev_open() */
-	if ( netdev_is_open ( snpdev->netdev ) ) {
-		DBGC ( snpdev, "SNPDEV %p MAC address changed while net "
-		       "devive open\n", snpdev );
-	}
+	/* Update receive filter, if device is open */
+	netdev_rx_filter ( snpdev->netdev );
 
 	return 0;
 }
@@ -665,11 +677,17 @@ efi_snp_receive ( EFI_SIMPLE_NETWORK_PROTOCOL *snp,
 	DBGC2 ( snpdev, "SNPDEV %p RECEIVE %p(+%lx)", snpdev, data,
 		( ( unsigned long ) *len ) );
 
-	/* Poll the network device */
-	efi_snp_poll ( snpdev );
+	/* Poll the network device, unless packets are already
+	 * waiting.  Callers typically invoke Receive() repeatedly
+	 * until no packet is returned; avoid the cost of polling the
+	 * hardware on each call while the RX queue is draining.
+	 */
+	if ( ! snpdev->netdev->rx_fill )
+		efi_snp_poll ( snpdev );
 
-	/* Dequeue a packet, if one is available */
-	iobuf = netdev_rx_dequeue ( snpdev->netdev );
+	/* Check for an available packet */
+	iobuf = list_first_entry ( &snpdev->netdev->rx_queue,
+				   struct io_buffer, list );
 	if ( ! iobuf ) {
 		DBGC2 ( snpdev, "\n" );
 		efirc = EFI_NOT_READY;
@@ -677,6 +695,19 @@ efi_snp_receive ( EFI_SIMPLE_NETWORK_PROTOCOL *snp,
 	}
 	DBGC2 ( snpdev, "+%zx\n", iob_len ( iobuf ) );
 
+	/* Leave packet in queue if caller's buffer is too small */
+	if ( *len < iob_len ( iobuf ) ) {
+		DBGC ( snpdev, "SNPDEV %p RECEIVE buffer too small "
+		       "(%lx < %zx)\n", snpdev, ( ( unsigned long ) *len ),
+		       iob_len ( iobuf ) );
+		*len = iob_len ( iobuf );
+		efirc = EFI_BUFFER_TOO_SMALL;
+		goto out_too_small;
+	}
+
+	/* Dequeue packet */
+	iobuf = netdev_rx_dequeue ( snpdev->netdev );
+
 	/* Return packet to caller */
 	memcpy ( data, iobuf->data, iob_len ( iobuf ) );
 	*len = iob_len ( iobuf );
@@ -705,6 +736,7 @@ efi_snp_receive ( EFI_SIMPLE_NETWORK_PROTOCOL *snp,
 
  out_bad_ll_header:
 	free_iob ( iobuf );
+ out_too_small:
 out_no_packet:
 	return efirc;
 }
@@ -1329,6 +1361,8 @@ static void efi_snp_remove ( struct net_device *netdev ) {
 			&efi_hii_config_access_protocol_guid, &snpdev->hii,
 			NULL );
 	bs->CloseEvent ( snpdev->snp.WaitForPacket );
+	if ( snpdev->promisc )
+		netdev_rx_promisc ( snpdev->netdev, 0 );
 	netdev_put ( snpdev->netdev );
 	free ( snpdev );
 }
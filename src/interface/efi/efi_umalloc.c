@@ -40,15 +40,48 @@ FILE_LICENCE ( GPL2_OR_LATER );
  *
  * Calling realloc() with a new size of zero is a valid way to free a
  * memory block.
+ *
+ * An existing block will be resized in place if possible, by
+ * allocating or freeing pages at the end of the block.
  */
 static userptr_t efi_urealloc ( userptr_t old_ptr, size_t new_size ) {
 	EFI_BOOT_SERVICES *bs = efi_systab->BootServices;
 	EFI_PHYSICAL_ADDRESS phys_addr;
 	unsigned int new_pages, old_pages;
 	userptr_t new_ptr = UNOWHERE;
+	EFI_PHYSICAL_ADDRESS tail;
 	size_t old_size;
 	EFI_STATUS efirc;
 
+	/* Resize existing block in place, if possible */
+	if ( old_ptr && ( old_ptr != UNOWHERE ) && new_size ) {
+		copy_from_user ( &old_size, old_ptr, -EFI_PAGE_SIZE,
+				 sizeof ( old_size ) );
+		old_pages = ( EFI_SIZE_TO_PAGES ( old_size ) + 1 );
+		new_pages = ( EFI_SIZE_TO_PAGES ( new_size ) + 1 );
+		phys_addr = user_to_phys ( old_ptr, -EFI_PAGE_SIZE );
+		tail = ( phys_addr + EFI_PAGES_TO_SIZE ( old_pages ) );
+		if ( new_pages > old_pages ) {
+			efirc = bs->AllocatePages ( AllocateAddress,
+						    EfiBootServicesData,
+						    ( new_pages - old_pages ),
+						    &tail );
+		} else if ( new_pages < old_pages ) {
+			tail = ( phys_addr + EFI_PAGES_TO_SIZE ( new_pages ) );
+			efirc = bs->FreePages ( tail,
+						( old_pages - new_pages ) );
+		} else {
+			efirc = 0;
+		}
+		if ( efirc == 0 ) {
+			copy_to_user ( old_ptr, -EFI_PAGE_SIZE,
+				       &new_size, sizeof ( new_size ) );
+			DBG ( "EFI resized %d pages at %llx to %d pages\n",
+			      old_pages, phys_addr, new_pages );
+			return old_ptr;
+		}
+	}
+
 	/* Allocate new memory if necessary.  If allocation fails,
 	 * return without touching the old block.
 	 */
@@ -19,6 +19,7 @@
 FILE_LICENCE ( GPL2_OR_LATER );
 
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 #include <assert.h>
@@ -36,77 +37,101 @@ static struct smbios smbios = {
 	.address = UNULL,
 };
 
-/**
- * Find SMBIOS strings terminator
+/** Copy of SMBIOS structures */
+static uint8_t *smbios_data;
+
+/** SMBIOS structure index
  *
- * @v offset		Offset to start of strings
- * @ret offset		Offset to strings terminator, or 0 if not found
+ * Structures are sorted by type, and then by order of appearance
+ * within the SMBIOS, so that any (type, instance) pair may be located
+ * directly via @c smbios_type_start.
  */
-static size_t find_strings_terminator ( size_t offset ) {
-	size_t max_offset = ( smbios.len - 2 );
-	uint16_t nulnul;
-
-	for ( ; offset <= max_offset ; offset++ ) {
-		copy_from_user ( &nulnul, smbios.address, offset, 2 );
-		if ( nulnul == 0 )
-			return ( offset + 1 );
-	}
-	return 0;
-}
+static struct smbios_structure *smbios_index;
+
+/** Start of each structure type within SMBIOS structure index */
+static uint16_t smbios_type_start[ 256 + 1 ];
+
+/** SMBIOS string table (offsets of each string within SMBIOS) */
+static uint16_t *smbios_strings;
 
 /**
- * Find specific structure type within SMBIOS
+ * Parse SMBIOS structures
  *
- * @v type		Structure type to search for
- * @v structure		SMBIOS structure descriptor to fill in
- * @ret rc		Return status code
+ * @v index		Structure index to fill in, or NULL
+ * @v strings		String table to fill in, or NULL
+ * @v next		Next free index position for each type, or NULL
+ * @ret num_strings	Number of strings, or negative error
+ *
+ * If no index is provided, this function will count the number of
+ * structures of each type (within @c smbios_type_start) and the
+ * total number of strings, without filling in anything else.
  */
-int find_smbios_structure ( unsigned int type,
-			    struct smbios_structure *structure ) {
+static int smbios_parse ( struct smbios_structure *index, uint16_t *strings,
+			  uint16_t *next ) {
+	struct smbios_structure structure;
 	unsigned int count = 0;
+	unsigned int num_strings = 0;
 	size_t offset = 0;
 	size_t strings_offset;
 	size_t terminator_offset;
-	int rc;
-
-	/* Find SMBIOS */
-	if ( ( smbios.address == UNULL ) &&
-	     ( ( rc = find_smbios ( &smbios ) ) != 0 ) )
-		return rc;
-	assert ( smbios.address != UNULL );
+	size_t string_offset;
 
 	/* Scan through list of structures */
-	while ( ( ( offset + sizeof ( structure->header ) ) < smbios.len )
+	while ( ( ( offset + sizeof ( structure.header ) ) < smbios.len )
 		&& ( count < smbios.count ) ) {
 
 		/* Read next SMBIOS structure header */
-		copy_from_user ( &structure->header, smbios.address, offset,
-				 sizeof ( structure->header ) );
+		memcpy ( &structure.header, ( smbios_data + offset ),
+			 sizeof ( structure.header ) );
 
 		/* Determine start and extent of strings block */
-		strings_offset = ( offset + structure->header.len );
+		strings_offset = ( offset + structure.header.len );
 		if ( strings_offset > smbios.len ) {
 			DBG ( "SMBIOS structure at offset %zx with length "
 			      "%x extends beyond SMBIOS\n", offset,
-			      structure->header.len );
+			      structure.header.len );
 			return -ENOENT;
 		}
-		terminator_offset = find_strings_terminator ( strings_offset );
-		if ( ! terminator_offset ) {
-			DBG ( "SMBIOS structure at offset %zx has "
-			      "unterminated strings section\n", offset );
-			return -ENOENT;
+		for ( terminator_offset = strings_offset ; ;
+		      terminator_offset++ ) {
+			if ( ( terminator_offset + 2 ) > smbios.len ) {
+				DBG ( "SMBIOS structure at offset %zx has "
+				      "unterminated strings section\n",
+				      offset );
+				return -ENOENT;
+			}
+			if ( ( smbios_data[terminator_offset] == 0 ) &&
+			     ( smbios_data[ terminator_offset + 1 ] == 0 ) )
+				break;
 		}
-		structure->strings_len = ( terminator_offset - strings_offset);
+		terminator_offset++;
+		structure.offset = offset;
+		structure.strings_len = ( terminator_offset - strings_offset );
 
-		DBG ( "SMBIOS structure at offset %zx has type %d, length %x, "
-		      "strings length %zx\n", offset, structure->header.type,
-		      structure->header.len, structure->strings_len );
+		/* Record strings.  The strings section is constructed
+		 * so as always to end on a string boundary.
+		 */
+		structure.first_string = num_strings;
+		for ( string_offset = strings_offset ;
+		      string_offset < terminator_offset ;
+		      string_offset += ( strlen ( ( char * ) smbios_data +
+						  string_offset ) + 1 ) ) {
+			if ( strings )
+				strings[num_strings] = string_offset;
+			num_strings++;
+		}
+		structure.num_strings = ( num_strings -
+					  structure.first_string );
 
-		/* If this is the structure we want, return */
-		if ( structure->header.type == type ) {
-			structure->offset = offset;
-			return 0;
+		/* Count or record structure */
+		if ( index ) {
+			index[ next[structure.header.type]++ ] = structure;
+		} else {
+			DBG ( "SMBIOS structure at offset %zx has type %d, "
+			      "length %x, strings length %zx\n", offset,
+			      structure.header.type, structure.header.len,
+			      structure.strings_len );
+			smbios_type_start[ structure.header.type + 1 ]++;
 		}
 
 		/* Move to next SMBIOS structure */
@@ -114,8 +139,108 @@ int find_smbios_structure ( unsigned int type,
 		count++;
 	}
 
-	DBG ( "SMBIOS structure type %d not found\n", type );
-	return -ENOENT;
+	return num_strings;
+}
+
+/**
+ * Construct SMBIOS structure index
+ *
+ * @ret rc		Return status code
+ *
+ * The SMBIOS structures are copied and parsed once, so that all
+ * subsequent structure and string lookups require no scanning.
+ */
+static int smbios_index_structures ( void ) {
+	uint16_t next[256];
+	unsigned int num_structures;
+	unsigned int type;
+	int num_strings;
+	int rc;
+
+	/* Find SMBIOS */
+	if ( ( smbios.address == UNULL ) &&
+	     ( ( rc = find_smbios ( &smbios ) ) != 0 ) )
+		return rc;
+	assert ( smbios.address != UNULL );
+
+	/* Copy SMBIOS structures */
+	smbios_data = malloc ( smbios.len );
+	if ( ! smbios_data ) {
+		rc = -ENOMEM;
+		goto err_data;
+	}
+	copy_from_user ( smbios_data, smbios.address, 0, smbios.len );
+
+	/* Count structures of each type and total number of strings */
+	memset ( smbios_type_start, 0, sizeof ( smbios_type_start ) );
+	num_strings = smbios_parse ( NULL, NULL, NULL );
+	if ( num_strings < 0 ) {
+		rc = num_strings;
+		goto err_count;
+	}
+	for ( type = 0 ; type < 256 ; type++ ) {
+		smbios_type_start[ type + 1 ] += smbios_type_start[type];
+		next[type] = smbios_type_start[type];
+	}
+	num_structures = smbios_type_start[256];
+
+	/* Allocate index and string table */
+	smbios_index = malloc ( num_structures * sizeof ( smbios_index[0] ) );
+	smbios_strings = malloc ( num_strings * sizeof ( smbios_strings[0] ));
+	if ( ! ( smbios_index && smbios_strings ) ) {
+		rc = -ENOMEM;
+		goto err_index;
+	}
+
+	/* Populate index and string table */
+	smbios_parse ( smbios_index, smbios_strings, next );
+
+	DBG ( "SMBIOS indexed %d structures and %d strings\n",
+	      num_structures, num_strings );
+	return 0;
+
+ err_index:
+	free ( smbios_strings );
+	smbios_strings = NULL;
+	free ( smbios_index );
+	smbios_index = NULL;
+ err_count:
+	free ( smbios_data );
+	smbios_data = NULL;
+ err_data:
+	return rc;
+}
+
+/**
+ * Find specific structure type within SMBIOS
+ *
+ * @v type		Structure type to search for
+ * @v instance		Instance of this type of structure
+ * @v structure		SMBIOS structure descriptor to fill in
+ * @ret rc		Return status code
+ */
+int find_smbios_structure ( unsigned int type, unsigned int instance,
+			    struct smbios_structure *structure ) {
+	unsigned int position;
+	int rc;
+
+	/* Construct index on first use */
+	if ( ( ! smbios_index ) &&
+	     ( ( rc = smbios_index_structures() ) != 0 ) )
+		return rc;
+
+	/* Locate structure */
+	if ( type > 0xff )
+		return -ENOENT;
+	position = ( smbios_type_start[type] + instance );
+	if ( position >= smbios_type_start[ type + 1 ] ) {
+		DBG ( "SMBIOS structure type %d instance %d not found\n",
+		      type, instance );
+		return -ENOENT;
+	}
+	memcpy ( structure, &smbios_index[position], sizeof ( *structure ) );
+
+	return 0;
 }
 
 /**
@@ -129,11 +254,11 @@ int find_smbios_structure ( unsigned int type,
 int read_smbios_structure ( struct smbios_structure *structure,
 			    void *data, size_t len ) {
 
-	assert ( smbios.address != UNULL );
+	assert ( smbios_data != NULL );
 
 	if ( len > structure->header.len )
 		len = structure->header.len;
-	copy_from_user ( data, smbios.address, structure->offset, len );
+	memcpy ( data, ( smbios_data + structure->offset ), len );
 	return 0;
 }
 
@@ -148,33 +273,23 @@ int read_smbios_structure ( struct smbios_structure *structure,
  */
 int read_smbios_string ( struct smbios_structure *structure,
 			 unsigned int index, void *data, size_t len ) {
-	size_t strings_start = ( structure->offset + structure->header.len );
-	size_t strings_end = ( strings_start + structure->strings_len );
-	size_t offset;
+	const char *string;
 	size_t string_len;
 
-	assert ( smbios.address != UNULL );
+	assert ( smbios_strings != NULL );
 
 	/* String numbers start at 1 (0 is used to indicate "no string") */
-	if ( ! index )
+	if ( ( ! index ) || ( index > structure->num_strings ) ) {
+		DBG ( "SMBIOS string index %d not found\n", index );
 		return -ENOENT;
-
-	for ( offset = strings_start ; offset < strings_end ;
-	      offset += ( string_len + 1 ) ) {
-		/* Get string length.  This is known safe, since the
-		 * smbios_strings struct is constructed so as to
-		 * always end on a string boundary.
-		 */
-		string_len = strlen_user ( smbios.address, offset );
-		if ( --index == 0 ) {
-			/* Copy string, truncating as necessary. */
-			if ( len > string_len )
-				len = string_len;
-			copy_from_user ( data, smbios.address, offset, len );
-			return string_len;
-		}
 	}
 
-	DBG ( "SMBIOS string index %d not found\n", index );
-	return -ENOENT;
+	/* Copy string, truncating as necessary */
+	string = ( ( char * ) smbios_data +
+		   smbios_strings[ structure->first_string + index - 1 ] );
+	string_len = strlen ( string );
+	if ( len > string_len )
+		len = string_len;
+	memcpy ( data, string, len );
+	return string_len;
 }
@@ -106,7 +106,7 @@ static int smbios_fetch ( struct settings *settings __unused,
 	assert ( tag_magic == SMBIOS_TAG_MAGIC );
 
 	/* Find SMBIOS structure */
-	if ( ( rc = find_smbios_structure ( tag_type, &structure ) ) != 0 )
+	if ( ( rc = find_smbios_structure ( tag_type, 0, &structure ) ) != 0 )
 		return rc;
 
 	{
@@ -87,6 +87,9 @@ struct net80211_probe_ctx {
 	/** Channels to hop by when changing channel */
 	int hop_step;
 
+	/** Currently checking the last successfully joined channel */
+	int fast;
+
 	/** List of best beacons for each network found so far */
 	struct list_head *beacons;
 };
@@ -764,6 +767,7 @@ struct net80211_device * net80211_alloc ( size_t priv_size )
 	netdev->ll_protocol = &net80211_ll_protocol;
 	netdev->ll_broadcast = net80211_ll_broadcast;
 	netdev->max_pkt_len = IEEE80211_MAX_DATA_LEN;
+	netdev->mtu = ETH_MAX_MTU; /* usually bridged to Ethernet */
 	netdev_init ( netdev, &net80211_netdev_ops );
 
 	dev = netdev->priv;
@@ -1265,6 +1269,58 @@ net80211_marshal_request_info ( struct net80211_device *dev,
 /** Seconds to allow a probe to take if no network has been found */
 #define NET80211_PROBE_TIMEOUT   6
 
+/** Milliseconds to spend on the last successfully joined channel
+ *
+ * This is long enough to see at least one beacon at the usual beacon
+ * interval of 100 TU (102.4ms), or a probe response when scanning
+ * actively.
+ */
+#define NET80211_PROBE_FAST_DWELL 150
+
+/**
+ * Switch probe to a new channel
+ *
+ * @v ctx	Probe context
+ * @v channel	Channel index
+ * @ret rc	Return status code
+ *
+ * If scanning actively, a probe request is sent on the new channel.
+ */
+static int net80211_probe_hop ( struct net80211_probe_ctx *ctx,
+				int channel )
+{
+	struct net80211_device *dev = ctx->dev;
+	struct io_buffer *siob = ctx->probe; /* to send */
+	struct io_buffer *iob;
+	int rc;
+
+	dev->channel = channel;
+	dev->op->config ( dev, NET80211_CFG_CHANNEL );
+	udelay ( dev->hw->channel_change_time );
+
+	ctx->ticks_channel = currticks();
+
+	if ( ! siob )
+		return 0;
+
+	/* make a copy for future use */
+	iob = alloc_iob ( siob->tail - siob->head );
+	iob_reserve ( iob, iob_headroom ( siob ) );
+	memcpy ( iob_put ( iob, iob_len ( siob ) ), siob->data,
+		 iob_len ( siob ) );
+
+	ctx->probe = iob;
+	rc = net80211_tx_mgmt ( dev, IEEE80211_STYPE_PROBE_REQ,
+				net80211_ll_broadcast, iob_disown ( siob ) );
+	if ( rc ) {
+		DBGC ( dev, "802.11 %p send probe failed: %s\n",
+		       dev, strerror ( rc ) );
+		return rc;
+	}
+
+	return 0;
+}
+
 /**
  * Begin probe of 802.11 networks
  *
@@ -1340,6 +1396,40 @@ struct net80211_probe_ctx * net80211_probe_start ( struct net80211_device *dev,
 	return ctx;
 }
 
+/**
+ * Check last successfully joined channel first
+ *
+ * @v ctx	Probe context returned by net80211_probe_start()
+ *
+ * If a network has previously been joined successfully, the channel
+ * on which it was found is checked first (for a short time only),
+ * and the probe completes as soon as that access point is seen
+ * again.  Otherwise, all channels are scanned as usual.  This is used
+ * when reassociating, to avoid a full scan in the common case.
+ */
+static void net80211_probe_last ( struct net80211_probe_ctx *ctx )
+{
+	struct net80211_device *dev = ctx->dev;
+	int i;
+
+	if ( ! dev->last_channel_nr )
+		return;
+
+	for ( i = 0; i < dev->nr_channels; i++ ) {
+		if ( dev->channels[i].channel_nr == dev->last_channel_nr )
+			break;
+	}
+	if ( i == dev->nr_channels )
+		return;
+
+	DBGC ( dev, "802.11 %p probe: trying %s on channel %d first\n",
+	       dev, eth_ntoa ( dev->last_bssid ), dev->last_channel_nr );
+	ctx->fast = 1;
+	ctx->hop_time = ( ( NET80211_PROBE_FAST_DWELL * ticks_per_sec() )
+			  / 1000 );
+	net80211_probe_hop ( ctx, i );
+}
+
 /**
  * Continue probe of 802.11 networks
  *
@@ -1365,6 +1455,8 @@ int net80211_probe_step ( struct net80211_probe_ctx *ctx )
 	u32 now = currticks();
 	struct io_buffer *iob;
 	int signal;
+	int channel;
+	int found_last = 0;
 	int rc;
 	char ssid[IEEE80211_MAX_SSID_LEN + 1];
 
@@ -1380,32 +1472,19 @@ int net80211_probe_step ( struct net80211_probe_ctx *ctx )
 
 	/* Change channels if necessary */
 	if ( now >= ctx->ticks_channel + ctx->hop_time ) {
-		dev->channel = ( dev->channel + ctx->hop_step )
-			% dev->nr_channels;
-		dev->op->config ( dev, NET80211_CFG_CHANNEL );
-		udelay ( dev->hw->channel_change_time );
-
-		ctx->ticks_channel = now;
-
-		if ( ctx->probe ) {
-			struct io_buffer *siob = ctx->probe; /* to send */
-
-			/* make a copy for future use */
-			iob = alloc_iob ( siob->tail - siob->head );
-			iob_reserve ( iob, iob_headroom ( siob ) );
-			memcpy ( iob_put ( iob, iob_len ( siob ) ),
-				 siob->data, iob_len ( siob ) );
-
-			ctx->probe = iob;
-			rc = net80211_tx_mgmt ( dev, IEEE80211_STYPE_PROBE_REQ,
-						net80211_ll_broadcast,
-						iob_disown ( siob ) );
-			if ( rc ) {
-				DBGC ( dev, "802.11 %p send probe failed: "
-				       "%s\n", dev, strerror ( rc ) );
-				return rc;
-			}
+		if ( ctx->fast ) {
+			/* Last joined network not seen; scan normally */
+			DBGC ( dev, "802.11 %p probe: %s not found on channel "
+			       "%d\n", dev, eth_ntoa ( dev->last_bssid ),
+			       dev->last_channel_nr );
+			ctx->fast = 0;
+			ctx->hop_time = ticks_per_sec() /
+				( ctx->probe ? 2 : 6 );
 		}
+		channel = ( ( dev->channel + ctx->hop_step ) %
+			    dev->nr_channels );
+		if ( ( rc = net80211_probe_hop ( ctx, channel ) ) != 0 )
+			return rc;
 	}
 
 	/* Check for new management packets */
@@ -1519,11 +1598,17 @@ int net80211_probe_step ( struct net80211_probe_ctx *ctx )
 		DBGC2 ( dev, "802.11 %p probe: good beacon for %s (%s)\n",
 			dev, wlan->essid, eth_ntoa ( wlan->bssid ) );
 
+		/* Stop as soon as the last joined network is seen */
+		if ( ctx->fast &&
+		     ( memcmp ( wlan->bssid, dev->last_bssid,
+				ETH_ALEN ) == 0 ) )
+			found_last = 1;
+
 	drop:
 		free_iob ( iob );
 	}
 
-	return 0;
+	return found_last;
 }
 
 
@@ -1706,6 +1791,7 @@ static void net80211_step_associate ( struct net80211_device *dev )
 				dev->assoc_rc = -ENOMEM;
 				goto fail;
 			}
+			net80211_probe_last ( dev->ctx.probe );
 		}
 
 		rc = net80211_probe_step ( dev->ctx.probe );
@@ -1833,6 +1919,8 @@ static void net80211_step_associate ( struct net80211_device *dev )
 	}
 
 	/* state: done! */
+	memcpy ( dev->last_bssid, dev->bssid, ETH_ALEN );
+	dev->last_channel_nr = dev->channels[dev->channel].channel_nr;
 	netdev_link_up ( dev->netdev );
 	dev->assoc_rc = 0;
 	dev->state &= ~NET80211_WORKING;
@@ -80,7 +80,10 @@ FILE_LICENCE ( GPL2_OR_LATER );
  *
  * To avoid staying at 1Mbps for a long time, we don't track any
  * transmitted packets until we've set our rate based on received
- * packets.
+ * packets.  If the device reports signal strength, we instead start
+ * immediately at a rate chosen according to the strength of the
+ * signal from the access point, and let the TX statistics correct
+ * any overestimate.
  */
 
 /** Two-bit packet status indicator for a packet with no retries */
@@ -122,6 +125,12 @@ FILE_LICENCE ( GPL2_OR_LATER );
 /** Minimum (num RX + @c RC_TX_FACTOR * num TX) to use a certain rate */
 #define RC_UNCERTAINTY_THRESH	4
 
+/** Signal strength (in dBm) at or below which we start at the lowest rate */
+#define RC_SIGNAL_DBM_MIN	-90
+
+/** Signal strength (in dBm) at or above which we start at the highest rate */
+#define RC_SIGNAL_DBM_MAX	-50
+
 /** TX direction */
 #define TX	0
 
@@ -144,15 +153,69 @@ struct rc80211_ctx
 	int packets;
 };
 
+/**
+ * Choose initial rate based on signal strength
+ *
+ * @v dev	802.11 device
+ * @ret rate_idx Index of initial rate, or -1 if signal strength is unknown
+ *
+ * The signal strength of the most recently received frame (normally
+ * the association response) is scaled linearly onto the range of
+ * available rates.
+ */
+static int rc80211_initial_rate ( struct net80211_device *dev )
+{
+	int signal = dev->last_signal;
+	int quality;
+
+	if ( ! signal || dev->nr_rates < 2 )
+		return -1;
+
+	switch ( dev->hw->signal_type ) {
+	case NET80211_SIGNAL_DBM:
+		quality = ( 100 * ( signal - RC_SIGNAL_DBM_MIN ) /
+			    ( RC_SIGNAL_DBM_MAX - RC_SIGNAL_DBM_MIN ) );
+		break;
+	case NET80211_SIGNAL_ARBITRARY:
+	case NET80211_SIGNAL_DB:
+		if ( ! dev->hw->signal_max )
+			return -1;
+		quality = ( 100 * signal / ( int ) dev->hw->signal_max );
+		break;
+	default:
+		return -1;
+	}
+
+	if ( quality < 0 )
+		quality = 0;
+	if ( quality > 100 )
+		quality = 100;
+
+	return ( quality * ( dev->nr_rates - 1 ) / 100 );
+}
+
 /**
  * Initialize rate-control algorithm
  *
  * @v dev	802.11 device
  * @ret ctx	Rate-control context, to be stored in @c dev->rctl
  */
-struct rc80211_ctx * rc80211_init ( struct net80211_device *dev __unused )
+struct rc80211_ctx * rc80211_init ( struct net80211_device *dev )
 {
 	struct rc80211_ctx *ret = zalloc ( sizeof ( *ret ) );
+	int rate_idx;
+
+	if ( ! ret )
+		return NULL;
+
+	rate_idx = rc80211_initial_rate ( dev );
+	if ( rate_idx >= 0 ) {
+		DBGC ( ret, "802.11 RC %p starting at %d Mbps for signal %d\n",
+		       ret, dev->rates[rate_idx] / 10, dev->last_signal );
+		net80211_set_rate_idx ( dev, rate_idx );
+		ret->started = 1;
+	}
+
 	return ret;
 }
 
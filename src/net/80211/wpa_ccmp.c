@@ -19,6 +19,7 @@
 FILE_LICENCE ( GPL2_OR_LATER );
 
 #include <string.h>
+#include <assert.h>
 #include <ipxe/net80211.h>
 #include <ipxe/crypto.h>
 #include <ipxe/hmac.h>
@@ -36,8 +37,13 @@ FILE_LICENCE ( GPL2_OR_LATER );
 /** Context for CCMP encryption and decryption */
 struct ccmp_ctx
 {
-	/** AES context - only ever used for encryption */
-	u8 aes_ctx[AES_CTX_SIZE];
+	/** AES-CBC context - only ever used for encryption
+	 *
+	 * AES-CBC is used (rather than raw AES) so that an
+	 * accelerated implementation will be picked up if one has
+	 * replaced the generic implementation.
+	 */
+	u8 aes_ctx[AES_CBC_CTX_MAX_SIZE];
 
 	/** Most recently sent packet number */
 	u64 tx_seq;
@@ -163,105 +169,69 @@ static int ccmp_init ( struct net80211_crypto *crypto, const void *key,
 	if ( rsc )
 		ctx->rx_seq = pn_to_u64 ( rsc );
 
-	cipher_setkey ( &aes_algorithm, ctx->aes_ctx, key, keylen );
+	assert ( aes_cbc_algorithm.ctxsize <= sizeof ( ctx->aes_ctx ) );
+	cipher_setkey ( &aes_cbc_algorithm, ctx->aes_ctx, key, keylen );
 
 	return 0;
 }
 
 
 /**
- * Encrypt or decrypt data stream using AES in Counter mode
+ * Encrypt a single block using AES
  *
  * @v ctx	CCMP cryptosystem context
- * @v nonce	Nonce value, 13 bytes
- * @v srcv	Data to encrypt or decrypt
- * @v len	Number of bytes pointed to by @a src
- * @v msrcv	MIC value to encrypt or decrypt (may be NULL)
- * @ret destv	Encrypted or decrypted data
- * @ret mdestv	Encrypted or decrypted MIC value
- *
- * This assumes CCMP parameters of L=2 and M=8. The algorithm is
- * defined in RFC 3610.
- */
-static void ccmp_ctr_xor ( struct ccmp_ctx *ctx, const void *nonce,
-			   const void *srcv, void *destv, int len,
-			   const void *msrcv, void *mdestv )
-{
-	u8 A[16], S[16];
-	u16 ctr;
-	int i;
-	const u8 *src = srcv, *msrc = msrcv;
-	u8 *dest = destv, *mdest = mdestv;
-
-	A[0] = 0x01;		/* flags, L' = L - 1 = 1, other bits rsvd */
-	memcpy ( A + 1, nonce, CCMP_NONCE_LEN );
-
-	if ( msrcv ) {
-		A[14] = A[15] = 0;
-
-		cipher_encrypt ( &aes_algorithm, ctx->aes_ctx, A, S, 16 );
-
-		for ( i = 0; i < 8; i++ ) {
-			*mdest++ = *msrc++ ^ S[i];
-		}
-	}
-
-	for ( ctr = 1 ;; ctr++ ) {
-		A[14] = ctr >> 8;
-		A[15] = ctr & 0xFF;
-
-		cipher_encrypt ( &aes_algorithm, ctx->aes_ctx, A, S, 16 );
-
-		for ( i = 0; i < len && i < 16; i++ )
-			*dest++ = *src++ ^ S[i];
-
-		if ( len <= 16 )
-			break;	/* we're done */
-
-		len -= 16;
-	}
-}
-
-
-/**
- * Advance one block in CBC-MAC calculation
- *
- * @v aes_ctx	AES encryption context with key set
- * @v B		Cleartext block to incorporate (16 bytes)
- * @v X		Previous ciphertext block (16 bytes)
- * @ret B	Clobbered
- * @ret X	New ciphertext block (16 bytes)
+ * @v iv	Block to XOR into input before encryption (16 bytes)
+ * @v src	Block to encrypt (16 bytes)
+ * @ret dst	Encrypted block (16 bytes)
  *
- * This function does X := E[key] ( X ^ B ).
+ * This function does dst := E[key] ( iv ^ src ), which is a single
+ * CBC-MAC step, or (with an all-zero @a iv) a single CTR keystream
+ * block.  @a dst may be the same as @a iv.
  */
-static void ccmp_feed_cbc_mac ( void *aes_ctx, u8 *B, u8 *X )
+static void ccmp_aes ( struct ccmp_ctx *ctx, const void *iv,
+		       const void *src, void *dst )
 {
-	int i;
-	for ( i = 0; i < 16; i++ )
-		B[i] ^= X[i];
-	cipher_encrypt ( &aes_algorithm, aes_ctx, B, X, 16 );
+	cipher_setiv ( &aes_cbc_algorithm, ctx->aes_ctx, iv );
+	cipher_encrypt ( &aes_cbc_algorithm, ctx->aes_ctx, src, dst, 16 );
 }
 
 
 /**
- * Calculate MIC on plaintext data using CBC-MAC
+ * Encrypt or decrypt data and calculate MIC using CCM
  *
  * @v ctx	CCMP cryptosystem context
  * @v nonce	Nonce value, 13 bytes
- * @v data	Data to calculate MIC over
- * @v datalen	Length of @a data
  * @v aad	Additional authentication data, for MIC but not encryption
- * @ret mic	MIC value (unencrypted), 8 bytes
+ * @v srcv	Data to encrypt or decrypt
+ * @v destv	Buffer for encrypted or decrypted data
+ * @v len	Length of data
+ * @v decrypt	Data is being decrypted
+ * @ret mic	Encrypted MIC value, 8 bytes
+ *
+ * This assumes CCMP parameters of L=2 and M=8. The algorithm is
+ * defined in RFC 3610.  The CBC-MAC over the plaintext and the
+ * Counter mode encryption are calculated in a single pass over the
+ * data, rather than walking the frame once for each.
  *
  * @a aadlen is assumed to be 22 bytes long, as it always is for
  * 802.11 use when transmitting non-QoS, not-between-APs frames (the
  * only type we deal with).
+ *
+ * When decrypting, the returned MIC may be compared directly against
+ * the encrypted MIC transmitted with the frame.
  */
-static void ccmp_cbc_mac ( struct ccmp_ctx *ctx, const void *nonce,
-			   const void *data, u16 datalen,
-			   const void *aad, void *mic )
+static void ccmp_ccm ( struct ccmp_ctx *ctx, const void *nonce,
+		       const void *aad, const void *srcv, void *destv,
+		       u16 len, int decrypt, void *mic )
 {
-	u8 X[16], B[16];
+	static const u8 zero[16];
+	u8 A[16], S[16], B[16], X[16];
+	const u8 *src = srcv;
+	u8 *dest = destv;
+	u8 *emic = mic;
+	u16 ctr;
+	int frag;
+	int i;
 
 	/* Zeroth block: flags, nonce, length */
 
@@ -270,42 +240,50 @@ static void ccmp_cbc_mac ( struct ccmp_ctx *ctx, const void *nonce,
 	 */
 	B[0] = 0x59;
 	memcpy ( B + 1, nonce, CCMP_NONCE_LEN );
-	B[14] = datalen >> 8;
-	B[15] = datalen & 0xFF;
-
-	cipher_encrypt ( &aes_algorithm, ctx->aes_ctx, B, X, 16 );
+	B[14] = len >> 8;
+	B[15] = len & 0xFF;
+	ccmp_aes ( ctx, zero, B, X );
 
 	/* First block: AAD length field and 14 bytes of AAD */
 	B[0] = 0;
 	B[1] = CCMP_AAD_LEN;
 	memcpy ( B + 2, aad, 14 );
-
-	ccmp_feed_cbc_mac ( ctx->aes_ctx, B, X );
+	ccmp_aes ( ctx, X, B, X );
 
 	/* Second block: Remaining 8 bytes of AAD, 8 bytes zero pad */
 	memcpy ( B, aad + 14, 8 );
 	memset ( B + 8, 0, 8 );
+	ccmp_aes ( ctx, X, B, X );
 
-	ccmp_feed_cbc_mac ( ctx->aes_ctx, B, X );
+	/* Message blocks: encrypt or decrypt, and feed the plaintext
+	 * into the CBC-MAC.
+	 */
+	A[0] = 0x01;		/* flags, L' = L - 1 = 1, other bits rsvd */
+	memcpy ( A + 1, nonce, CCMP_NONCE_LEN );
+	for ( ctr = 1 ; len ; ctr++ ) {
+		frag = ( ( len < 16 ) ? len : 16 );
 
-	/* Message blocks */
-	while ( datalen ) {
-		if ( datalen >= 16 ) {
-			memcpy ( B, data, 16 );
-			datalen -= 16;
-		} else {
-			memcpy ( B, data, datalen );
-			memset ( B + datalen, 0, 16 - datalen );
-			datalen = 0;
-		}
+		A[14] = ctr >> 8;
+		A[15] = ctr & 0xFF;
+		ccmp_aes ( ctx, zero, A, S );
+
+		for ( i = 0; i < frag; i++ )
+			dest[i] = src[i] ^ S[i];
 
-		ccmp_feed_cbc_mac ( ctx->aes_ctx, B, X );
+		memcpy ( B, ( decrypt ? dest : src ), frag );
+		memset ( B + frag, 0, 16 - frag );
+		ccmp_aes ( ctx, X, B, X );
 
-		data += 16;
+		src += frag;
+		dest += frag;
+		len -= frag;
 	}
 
-	/* Get MIC from final value of X */
-	memcpy ( mic, X, 8 );
+	/* Encrypt MIC from final value of X */
+	A[14] = A[15] = 0;
+	ccmp_aes ( ctx, zero, A, S );
+	for ( i = 0; i < 8; i++ )
+		emic[i] = X[i] ^ S[i];
 }
 
 
@@ -327,8 +305,7 @@ struct io_buffer * ccmp_encrypt ( struct net80211_crypto *crypto,
 	struct ccmp_head head;
 	struct ccmp_nonce nonce;
 	struct ccmp_aad aad;
-	u8 mic[8], tx_pn[6];
-	void *edata, *emic;
+	u8 tx_pn[6];
 
 	ctx->tx_seq++;
 	u64_to_pn ( ctx->tx_seq, tx_pn, PN_LSB );
@@ -360,15 +337,10 @@ struct io_buffer * ccmp_encrypt ( struct net80211_crypto *crypto,
 	memcpy ( aad.a1, hdr->addr1, 3 * ETH_ALEN ); /* all 3 at once */
 	aad.seq = hdr->seq & CCMP_AAD_SEQ_MASK;
 
-	/* Calculate MIC over the data */
-	ccmp_cbc_mac ( ctx, &nonce, iob->data + hdrlen, datalen, &aad, mic );
-
-	/* Copy and encrypt data and MIC */
-	edata = iob_put ( eiob, datalen );
-	emic = iob_put ( eiob, CCMP_MIC_LEN );
-	ccmp_ctr_xor ( ctx, &nonce,
-		       iob->data + hdrlen, edata, datalen,
-		       mic, emic );
+	/* Copy and encrypt data, and calculate encrypted MIC */
+	ccmp_ccm ( ctx, &nonce, &aad, iob->data + hdrlen,
+		   iob_put ( eiob, datalen ), datalen, 0,
+		   iob_put ( eiob, CCMP_MIC_LEN ) );
 
 	/* Done! */
 	DBGC2 ( ctx, "WPA-CCMP %p: encrypted packet %p -> %p\n", ctx,
@@ -395,7 +367,7 @@ static struct io_buffer * ccmp_decrypt ( struct net80211_crypto *crypto,
 	struct ccmp_head *head;
 	struct ccmp_nonce nonce;
 	struct ccmp_aad aad;
-	u8 rx_pn[6], their_mic[8], our_mic[8];
+	u8 rx_pn[6], our_mic[8];
 
 	iob = alloc_iob ( hdrlen + datalen );
 	if ( ! iob )
@@ -432,16 +404,13 @@ static struct io_buffer * ccmp_decrypt ( struct net80211_crypto *crypto,
 	memcpy ( aad.a1, hdr->addr1, 3 * ETH_ALEN ); /* all 3 at once */
 	aad.seq = hdr->seq & CCMP_AAD_SEQ_MASK;
 
-	/* Copy-decrypt data and MIC */
-	ccmp_ctr_xor ( ctx, &nonce, eiob->data + hdrlen + sizeof ( *head ),
-		       iob_put ( iob, datalen ), datalen,
-		       eiob->tail - CCMP_MIC_LEN, their_mic );
+	/* Copy-decrypt data, and calculate encrypted MIC */
+	ccmp_ccm ( ctx, &nonce, &aad, eiob->data + hdrlen + sizeof ( *head ),
+		   iob_put ( iob, datalen ), datalen, 1, our_mic );
 
 	/* Check MIC */
-	ccmp_cbc_mac ( ctx, &nonce, iob->data + hdrlen, datalen, &aad,
-		       our_mic );
-
-	if ( memcmp ( their_mic, our_mic, CCMP_MIC_LEN ) != 0 ) {
+	if ( memcmp ( eiob->tail - CCMP_MIC_LEN, our_mic,
+		      CCMP_MIC_LEN ) != 0 ) {
 		DBGC2 ( ctx, "WPA-CCMP %p: MIC failure\n", ctx );
 		free_iob ( iob );
 		return NULL;
@@ -19,6 +19,7 @@
 FILE_LICENCE ( GPL2_OR_LATER );
 
 #include <string.h>
+#include <stdio.h>
 #include <ipxe/net80211.h>
 #include <ipxe/sha1.h>
 #include <ipxe/wpa.h>
@@ -29,6 +30,65 @@ FILE_LICENCE ( GPL2_OR_LATER );
  * Frontend for WPA using a pre-shared key.
  */
 
+/** Maximum WPA passphrase length */
+#define WPA_PSK_MAX_PASSPHRASE_LEN 64
+
+/** A cached WPA-PSK pairwise master key
+ *
+ * Deriving the PMK from the passphrase requires 4096 iterations of
+ * PBKDF2-SHA1, which can take several seconds on a slow CPU.  The
+ * most recently derived PMK is retained, so that reassociating to
+ * the same network (e.g. after the link drops) does not repeat the
+ * derivation.
+ */
+struct wpa_psk_cache {
+	/** Network name */
+	char essid[IEEE80211_MAX_SSID_LEN + 1];
+	/** Passphrase */
+	char passphrase[WPA_PSK_MAX_PASSPHRASE_LEN + 1];
+	/** Pairwise master key */
+	u8 pmk[WPA_PMK_LEN];
+	/** Cache entry is valid */
+	int valid;
+};
+
+/** Most recently derived PMK */
+static struct wpa_psk_cache wpa_psk_cache;
+
+/**
+ * Derive PMK from passphrase
+ *
+ * @v essid	Network name
+ * @v passphrase Passphrase
+ * @v len	Length of passphrase
+ * @ret pmk	Pairwise master key (WPA_PMK_LEN bytes)
+ */
+static void wpa_psk_derive_pmk ( const char *essid, const char *passphrase,
+				 int len, u8 *pmk )
+{
+	struct wpa_psk_cache *cache = &wpa_psk_cache;
+
+	/* Use cached PMK if network name and passphrase both match */
+	if ( cache->valid && ( strcmp ( cache->essid, essid ) == 0 ) &&
+	     ( strcmp ( cache->passphrase, passphrase ) == 0 ) ) {
+		DBGC ( cache, "WPA-PSK using cached PMK for \"%s\"\n",
+		       essid );
+		memcpy ( pmk, cache->pmk, WPA_PMK_LEN );
+		return;
+	}
+
+	/* Derive PMK */
+	pbkdf2_sha1 ( passphrase, len, essid, strlen ( essid ),
+		      4096, pmk, WPA_PMK_LEN );
+
+	/* Record in cache */
+	snprintf ( cache->essid, sizeof ( cache->essid ), "%s", essid );
+	snprintf ( cache->passphrase, sizeof ( cache->passphrase ), "%s",
+		   passphrase );
+	memcpy ( cache->pmk, pmk, WPA_PMK_LEN );
+	cache->valid = 1;
+}
+
 /**
  * Initialise WPA-PSK state
  *
@@ -48,14 +108,14 @@ static int wpa_psk_init ( struct net80211_device *dev )
  */
 static int wpa_psk_start ( struct net80211_device *dev )
 {
-	char passphrase[64+1];
+	char passphrase[WPA_PSK_MAX_PASSPHRASE_LEN + 1];
 	u8 pmk[WPA_PMK_LEN];
 	int len;
 	struct wpa_common_ctx *ctx = dev->handshaker->priv;
 
 	len = fetch_string_setting ( netdev_settings ( dev->netdev ),
 				     &net80211_key_setting, passphrase,
-				     64 + 1 );
+				     sizeof ( passphrase ) );
 
 	if ( len <= 0 ) {
 		DBGC ( ctx, "WPA-PSK %p: no passphrase provided!\n", ctx );
@@ -63,8 +123,7 @@ static int wpa_psk_start ( struct net80211_device *dev )
 		return -EACCES;
 	}
 
-	pbkdf2_sha1 ( passphrase, len, dev->essid, strlen ( dev->essid ),
-		      4096, pmk, WPA_PMK_LEN );
+	wpa_psk_derive_pmk ( dev->essid, passphrase, len, pmk );
 
 	DBGC ( ctx, "WPA-PSK %p: derived PMK from passphrase `%s':\n", ctx,
 	       passphrase );
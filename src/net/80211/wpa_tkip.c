@@ -295,7 +295,8 @@ static void tkip_mix_2 ( struct tkip_dir_ctx *dctx, struct tkip_tk *tk,
  * @v V		Michael code state (two 32-bit words)
  * @v word	Next 32-bit word of data
  */
-static void tkip_feed_michael ( u32 *V, u32 word )
+static inline __attribute__ (( always_inline )) void
+tkip_feed_michael ( u32 *V, u32 word )
 {
 	V[0] ^= word;
 	V[1] ^= rol32 ( V[0], 17 );
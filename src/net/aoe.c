@@ -86,6 +86,22 @@ struct aoe_device {
 	struct interface config;
 	/** Device is configued */
 	int configured;
+
+	/** Maximum number of sectors per ATA command */
+	unsigned int max_count;
+	/** Maximum number of sectors per AoE ATA request
+	 *
+	 * This is the target's advertised sector count, or zero if
+	 * the target does not impose a limit.
+	 */
+	unsigned int scnt;
+	/** Maximum number of outstanding commands
+	 *
+	 * This is the target's advertised buffer count.
+	 */
+	unsigned int bufcnt;
+	/** Number of outstanding commands */
+	unsigned int outstanding;
 };
 
 /** An AoE command */
@@ -102,6 +118,8 @@ struct aoe_command {
 
 	/** ATA command */
 	struct ata_cmd command;
+	/** Number of sectors already transferred */
+	unsigned int offset;
 	/** Command type */
 	struct aoe_command_type *type;
 	/** Command tag */
@@ -141,6 +159,8 @@ struct aoe_command_type {
 			size_t len, const void *ll_source );
 };
 
+static int aoecmd_new_tag ( void );
+
 /**
  * Get reference to AoE device
  *
@@ -235,6 +255,10 @@ static void aoecmd_close ( struct aoe_command *aoecmd, int rc ) {
 		list_del ( &aoecmd->list );
 		INIT_LIST_HEAD ( &aoecmd->list );
 		aoecmd_put ( aoecmd );
+
+		/* Reopen flow-control window if it was previously full */
+		if ( aoedev->outstanding-- == aoedev->bufcnt )
+			xfer_window_changed ( &aoedev->ata );
 	}
 
 	/* Shut down interfaces */
@@ -338,6 +362,21 @@ static int aoecmd_rx ( struct aoe_command *aoecmd, struct io_buffer *iobuf,
 					ll_source ) ) != 0 )
 		goto done;
 
+	/* Issue next request if the command has been split to fit
+	 * within the target's advertised sector count.  Use a fresh
+	 * tag, so that a late duplicate response to the previous
+	 * request cannot be mistaken for a response to this one.
+	 */
+	if ( aoecmd->offset < aoecmd->command.cb.count.native ) {
+		if ( ( rc = aoecmd_new_tag() ) < 0 )
+			goto done;
+		aoecmd->tag = rc;
+		free_iob ( iobuf );
+		stop_timer ( &aoecmd->timer );
+		aoecmd_tx ( aoecmd );
+		return 0;
+	}
+
  done:
 	/* Free I/O buffer */
 	free_iob ( iobuf );
@@ -365,6 +404,41 @@ static void aoecmd_expired ( struct retry_timer *timer, int fail ) {
 	}
 }
 
+/**
+ * Calculate number of sectors in next AoE ATA request
+ *
+ * @v aoecmd		AoE command
+ * @ret count		Number of sectors
+ */
+static unsigned int aoecmd_ata_count ( struct aoe_command *aoecmd ) {
+	struct aoe_device *aoedev = aoecmd->aoedev;
+	unsigned int count;
+
+	count = ( aoecmd->command.cb.count.native - aoecmd->offset );
+	if ( aoedev->scnt && ( count > aoedev->scnt ) )
+		count = aoedev->scnt;
+	return count;
+}
+
+/**
+ * Calculate data length of next AoE ATA request
+ *
+ * @v aoecmd		AoE command
+ * @v len		Total data length of ATA command
+ * @ret len		Data length of request
+ */
+static size_t aoecmd_ata_data_len ( struct aoe_command *aoecmd,
+				    size_t len ) {
+
+	/* Commands that are not split transfer their full length */
+	if ( ( ! len ) ||
+	     ( aoecmd_ata_count ( aoecmd ) ==
+	       aoecmd->command.cb.count.native ) )
+		return len;
+
+	return ( aoecmd_ata_count ( aoecmd ) * ATA_SECTOR_SIZE );
+}
+
 /**
  * Calculate length of AoE ATA command IU
  *
@@ -375,7 +449,7 @@ static size_t aoecmd_ata_cmd_len ( struct aoe_command *aoecmd ) {
 	struct ata_cmd *command = &aoecmd->command;
 
 	return ( sizeof ( struct aoehdr ) + sizeof ( struct aoeata ) +
-		 command->data_out_len );
+		 aoecmd_ata_data_len ( aoecmd, command->data_out_len ) );
 }
 
 /**
@@ -391,11 +465,15 @@ static void aoecmd_ata_cmd ( struct aoe_command *aoecmd,
 	struct ata_cmd *command = &aoecmd->command;
 	struct aoehdr *aoehdr = data;
 	struct aoeata *aoeata = &aoehdr->payload[0].ata;
+	size_t data_out_len =
+		aoecmd_ata_data_len ( aoecmd, command->data_out_len );
+	size_t data_in_len =
+		aoecmd_ata_data_len ( aoecmd, command->data_in_len );
 
 	/* Sanity check */
 	linker_assert ( AOE_FL_DEV_HEAD	== ATA_DEV_SLAVE, __fix_ata_h__ );
 	assert ( len == ( sizeof ( *aoehdr ) + sizeof ( *aoeata ) +
-			  command->data_out_len ) );
+			  data_out_len ) );
 
 	/* Build IU */
 	aoehdr->command = AOE_CMD_ATA;
@@ -404,23 +482,24 @@ static void aoecmd_ata_cmd ( struct aoe_command *aoecmd,
 			   ( command->cb.device & ATA_DEV_SLAVE ) |
 			   ( command->data_out_len ? AOE_FL_WRITE : 0 ) );
 	aoeata->err_feat = command->cb.err_feat.bytes.cur;
-	aoeata->count = command->cb.count.native;
+	aoeata->count = aoecmd_ata_count ( aoecmd );
 	aoeata->cmd_stat = command->cb.cmd_stat;
-	aoeata->lba.u64 = cpu_to_le64 ( command->cb.lba.native );
+	aoeata->lba.u64 = cpu_to_le64 ( command->cb.lba.native +
+					aoecmd->offset );
 	if ( ! command->cb.lba48 )
 		aoeata->lba.bytes[3] |=
 			( command->cb.device & ATA_DEV_MASK );
-	copy_from_user ( aoeata->data, command->data_out, 0,
-			 command->data_out_len );
+	copy_from_user ( aoeata->data, command->data_out,
+			 ( aoecmd->offset * ATA_SECTOR_SIZE ), data_out_len );
 
 	DBGC2 ( aoedev, "AoE %s/%08x ATA cmd %02x:%02x:%02x:%02x:%08llx",
 		aoedev_name ( aoedev ), aoecmd->tag, aoeata->aflags,
 		aoeata->err_feat, aoeata->count, aoeata->cmd_stat,
 		aoeata->lba.u64 );
-	if ( command->data_out_len )
-		DBGC2 ( aoedev, " out %04zx", command->data_out_len );
-	if ( command->data_in_len )
-		DBGC2 ( aoedev, " in %04zx", command->data_in_len );
+	if ( data_out_len )
+		DBGC2 ( aoedev, " out %04zx", data_out_len );
+	if ( data_in_len )
+		DBGC2 ( aoedev, " in %04zx", data_in_len );
 	DBGC2 ( aoedev, "\n" );
 }
 
@@ -439,6 +518,8 @@ static int aoecmd_ata_rsp ( struct aoe_command *aoecmd, const void *data,
 	struct ata_cmd *command = &aoecmd->command;
 	const struct aoehdr *aoehdr = data;
 	const struct aoeata *aoeata = &aoehdr->payload[0].ata;
+	size_t data_in_len =
+		aoecmd_ata_data_len ( aoecmd, command->data_in_len );
 	size_t data_len;
 
 	/* Sanity check */
@@ -463,16 +544,19 @@ static int aoecmd_ata_rsp ( struct aoe_command *aoecmd, const void *data,
 	/* Check data-in length is sufficient.  (There may be trailing
 	 * garbage due to Ethernet minimum-frame-size padding.)
 	 */
-	if ( data_len < command->data_in_len ) {
+	if ( data_len < data_in_len ) {
 		DBGC ( aoedev, "AoE %s/%08x data-in underrun (received %zd, "
 		       "expected %zd)\n", aoedev_name ( aoedev ), aoecmd->tag,
-		       data_len, command->data_in_len );
+		       data_len, data_in_len );
 		return -ERANGE;
 	}
 
 	/* Copy out data payload */
-	copy_to_user ( command->data_in, 0, aoeata->data,
-		       command->data_in_len );
+	copy_to_user ( command->data_in, ( aoecmd->offset * ATA_SECTOR_SIZE ),
+		       aoeata->data, data_in_len );
+
+	/* Record progress */
+	aoecmd->offset += aoecmd_ata_count ( aoecmd );
 
 	return 0;
 }
@@ -545,6 +629,22 @@ static int aoecmd_cfg_rsp ( struct aoe_command *aoecmd, const void *data,
 	       aoedev_name ( aoedev ), aoecmd->tag, ntohs ( aoecfg->bufcnt ),
 	       aoecfg->fwver, aoecfg->scnt );
 
+	/* Record number of commands that may be outstanding */
+	aoedev->bufcnt = ntohs ( aoecfg->bufcnt );
+	if ( ! aoedev->bufcnt )
+		aoedev->bufcnt = 1;
+
+	/* Record number of sectors per request.  ATA commands larger
+	 * than this will be split into multiple requests.
+	 */
+	aoedev->scnt = aoecfg->scnt;
+	if ( aoedev->scnt && ( aoedev->scnt < aoedev->max_count ) ) {
+		DBGC ( aoedev, "AoE %s target supports only %d sectors per "
+		       "request (splitting commands of up to %d)\n",
+		       aoedev_name ( aoedev ), aoedev->scnt,
+		       aoedev->max_count );
+	}
+
 	/* Record target MAC address */
 	memcpy ( aoedev->target, ll_source, ll_protocol->ll_addr_len );
 	DBGC ( aoedev, "AoE %s has MAC address %s\n",
@@ -625,6 +725,7 @@ static struct aoe_command * aoecmd_create ( struct aoe_device *aoedev,
 		return NULL;
 	ref_init ( &aoecmd->refcnt, aoecmd_free );
 	list_add ( &aoecmd->list, &aoe_commands );
+	aoedev->outstanding++;
 	intf_init ( &aoecmd->ata, &aoecmd_ata_desc, &aoecmd->refcnt );
 	timer_init ( &aoecmd->timer, aoecmd_expired, &aoecmd->refcnt );
 	aoecmd->aoedev = aoedev_get ( aoedev );
@@ -747,9 +848,23 @@ static void aoedev_close ( struct aoe_device *aoedev, int rc ) {
  *
  * @v aoedev		AoE device
  * @ret len		Length of window
+ *
+ * The window is the amount of data that may be transferred by the
+ * commands which can be issued without exceeding the target's
+ * advertised buffer count.
  */
 static size_t aoedev_window ( struct aoe_device *aoedev ) {
-	return ( aoedev->configured ? ~( ( size_t ) 0 ) : 0 );
+
+	/* Block commands until configuration is complete */
+	if ( ! aoedev->configured )
+		return 0;
+
+	/* Block commands while the target's buffers are all in use */
+	if ( aoedev->outstanding >= aoedev->bufcnt )
+		return 0;
+
+	return ( ( aoedev->bufcnt - aoedev->outstanding ) *
+		 aoedev->max_count * ATA_SECTOR_SIZE );
 }
 
 /**
@@ -836,6 +951,33 @@ static struct interface_operation aoedev_config_op[] = {
 static struct interface_descriptor aoedev_config_desc =
 	INTF_DESC ( struct aoe_device, config, aoedev_config_op );
 
+/**
+ * Calculate maximum number of sectors per AoE ATA command
+ *
+ * @v netdev		Network device
+ * @ret max_count	Maximum number of sectors per command
+ *
+ * Each AoE ATA command must fit within a single packet, so the
+ * number of sectors is determined by the network device's MTU
+ * (which will be larger when using jumbo frames).
+ */
+static unsigned int aoedev_max_count ( struct net_device *netdev ) {
+	size_t overhead = ( sizeof ( struct aoehdr ) +
+			    sizeof ( struct aoeata ) );
+	unsigned int max_count;
+
+	/* Calculate number of sectors that fit within a packet */
+	if ( netdev->mtu < ( overhead + ATA_SECTOR_SIZE ) )
+		return 1;
+	max_count = ( ( netdev->mtu - overhead ) / ATA_SECTOR_SIZE );
+
+	/* Limit to width of ATA sector count field */
+	if ( max_count > AOE_MAX_COUNT )
+		max_count = AOE_MAX_COUNT;
+
+	return max_count;
+}
+
 /**
  * Open AoE device
  *
@@ -862,8 +1004,12 @@ static int aoedev_open ( struct interface *parent, struct net_device *netdev,
 	aoedev->netdev = netdev_get ( netdev );
 	aoedev->major = major;
 	aoedev->minor = minor;
+	aoedev->max_count = aoedev_max_count ( netdev );
+	aoedev->bufcnt = 1;
 	memcpy ( aoedev->target, netdev->ll_broadcast,
 		 netdev->ll_protocol->ll_addr_len );
+	DBGC ( aoedev, "AoE %s using %d sectors per command\n",
+	       aoedev_name ( aoedev ), aoedev->max_count );
 
 	/* Initiate configuration */
 	if ( ( rc = aoedev_cfg_command ( aoedev, &aoedev->config ) ) < 0 ) {
@@ -874,7 +1020,7 @@ static int aoedev_open ( struct interface *parent, struct net_device *netdev,
 
 	/* Attach ATA device to parent interface */
 	if ( ( rc = ata_open ( parent, &aoedev->ata, ATA_DEV_MASTER,
-			       AOE_MAX_COUNT ) ) != 0 ) {
+			       aoedev->max_count ) ) != 0 ) {
 		DBGC ( aoedev, "AoE %s could not create ATA device: %s\n",
 		       aoedev_name ( aoedev ), strerror ( rc ) );
 		goto err_ata_open;
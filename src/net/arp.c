@@ -49,10 +49,15 @@ FILE_LICENCE ( GPL2_OR_LATER );
 /** ARP maximum timeout */
 #define ARP_MAX_TIMEOUT ( TICKS_PER_SEC * 3 )
 
+/** Number of ARP cache hash chains (must be a power of two) */
+#define ARP_HASH_SIZE 16
+
 /** An ARP cache entry */
 struct arp_entry {
-	/** List of ARP cache entries */
+	/** List of ARP cache entries (most recently used first) */
 	struct list_head list;
+	/** ARP cache hash chain */
+	struct list_head hash;
 	/** Network device */
 	struct net_device *netdev;
 	/** Network-layer protocol */
@@ -72,7 +77,42 @@ struct arp_entry {
 /** The ARP cache */
 static LIST_HEAD ( arp_entries );
 
+/** ARP cache hash chains */
+static struct list_head arp_hash[ARP_HASH_SIZE];
+
+/**
+ * Get ARP cache hash chain
+ *
+ * @v net_protocol	Network-layer protocol
+ * @v net_dest		Destination network-layer address
+ * @ret chain		ARP cache hash chain
+ */
+static struct list_head * arp_chain ( struct net_protocol *net_protocol,
+				      const void *net_dest ) {
+	const uint8_t *addr = net_dest;
+	struct list_head *chain;
+	unsigned int hash = 0;
+	unsigned int i;
+
+	/* Fold all bytes of the address, since the low-order bytes
+	 * (which vary most within a subnet) may be at either end.
+	 */
+	for ( i = 0 ; i < net_protocol->net_addr_len ; i++ )
+		hash ^= addr[i];
+	hash ^= ( hash >> 4 );
+	chain = &arp_hash[ hash & ( ARP_HASH_SIZE - 1 ) ];
+
+	/* Initialise hash chains on first use */
+	if ( ! chain->next ) {
+		for ( i = 0 ; i < ARP_HASH_SIZE ; i++ )
+			INIT_LIST_HEAD ( &arp_hash[i] );
+	}
+
+	return chain;
+}
+
 struct net_protocol arp_protocol __net_protocol;
+struct cache_discarder arp_cache_discarder __cache_discarder ( CACHE_NORMAL );
 
 static void arp_expired ( struct retry_timer *timer, int over );
 
@@ -108,6 +148,7 @@ static struct arp_entry * arp_create ( struct net_device *netdev,
 	arp->timer.max_timeout = ARP_MAX_TIMEOUT;
 	INIT_LIST_HEAD ( &arp->tx_queue );
 	list_add ( &arp->list, &arp_entries );
+	list_add ( &arp->hash, arp_chain ( net_protocol, net_dest ) );
 
 	/* Start timer running to trigger initial transmission */
 	start_timer_nodelay ( &arp->timer );
@@ -130,7 +171,8 @@ static struct arp_entry * arp_find ( struct net_device *netdev,
 				     const void *net_dest ) {
 	struct arp_entry *arp;
 
-	list_for_each_entry ( arp, &arp_entries, list ) {
+	list_for_each_entry ( arp, arp_chain ( net_protocol, net_dest ),
+			      hash ) {
 		if ( ( arp->netdev == netdev ) &&
 		     ( arp->net_protocol == net_protocol ) &&
 		     ( memcmp ( arp->net_dest, net_dest,
@@ -177,6 +219,7 @@ static void arp_destroy ( struct arp_entry *arp, int rc ) {
 	/* Drop reference to network device, remove from cache and free */
 	netdev_put ( arp->netdev );
 	list_del ( &arp->list );
+	list_del ( &arp->hash );
 	free ( arp );
 }
 
@@ -208,7 +251,10 @@ int arp_tx ( struct io_buffer *iobuf, struct net_device *netdev,
 
 	/* Find or create ARP cache entry */
 	arp = arp_find ( netdev, net_protocol, net_dest );
-	if ( ! arp ) {
+	if ( arp ) {
+		cache_hit ( &arp_cache_discarder );
+	} else {
+		cache_miss ( &arp_cache_discarder );
 		arp = arp_create ( netdev, net_protocol, net_dest,
 				   net_source );
 		if ( ! arp )
@@ -230,6 +276,36 @@ int arp_tx ( struct io_buffer *iobuf, struct net_device *netdev,
 	}
 }
 
+/**
+ * Start resolving link-layer address via ARP
+ *
+ * @v netdev		Network device
+ * @v net_protocol	Network-layer protocol
+ * @v net_dest		Destination network-layer address
+ * @v net_source	Source network-layer address
+ * @ret rc		Return status code
+ *
+ * This may be used to resolve the address of a peer that is likely
+ * to be needed soon (such as a router), so that the first packet
+ * sent to it does not have to wait for an ARP reply.
+ */
+int arp_resolve ( struct net_device *netdev,
+		  struct net_protocol *net_protocol, const void *net_dest,
+		  const void *net_source ) {
+	struct arp_entry *arp;
+
+	/* Do nothing if entry already exists */
+	if ( arp_find ( netdev, net_protocol, net_dest ) )
+		return 0;
+
+	/* Create ARP cache entry */
+	arp = arp_create ( netdev, net_protocol, net_dest, net_source );
+	if ( ! arp )
+		return -ENOMEM;
+
+	return 0;
+}
+
 /**
  * Update ARP cache entry
  *
@@ -388,14 +464,26 @@ static int arp_rx ( struct io_buffer *iobuf, struct net_device *netdev,
 		arp_update ( arp, arp_sender_ha ( arphdr ) );
 	}
 
-	/* If it's not a request, there's nothing more to do */
-	if ( arphdr->ar_op != htons ( ARPOP_REQUEST ) ) {
+	/* See if we own the target protocol address */
+	if ( arp_net_protocol->check ( netdev, arp_target_pa ( arphdr ) ) != 0){
 		rc = 0;
 		goto done;
 	}
 
-	/* See if we own the target protocol address */
-	if ( arp_net_protocol->check ( netdev, arp_target_pa ( arphdr ) ) != 0){
+	/* If we have no entry for this sender, create one.  A peer
+	 * resolving our address is about to talk to us, and will
+	 * almost certainly need a reply.
+	 */
+	if ( ! arp ) {
+		arp = arp_create ( netdev, net_protocol,
+				   arp_sender_pa ( arphdr ),
+				   arp_target_pa ( arphdr ) );
+		if ( arp )
+			arp_update ( arp, arp_sender_ha ( arphdr ) );
+	}
+
+	/* If it's not a request, there's nothing more to do */
+	if ( arphdr->ar_op != htons ( ARPOP_REQUEST ) ) {
 		rc = 0;
 		goto done;
 	}
@@ -499,6 +587,8 @@ static unsigned int arp_discard ( void ) {
 }
 
 /** ARP cache discarder */
-struct cache_discarder arp_cache_discarder __cache_discarder = {
+struct cache_discarder arp_cache_discarder
+	__cache_discarder ( CACHE_NORMAL ) = {
+	.name = "arp",
 	.discard = arp_discard,
 };
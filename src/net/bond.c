@@ -0,0 +1,943 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <byteswap.h>
+#include <ipxe/if_ether.h>
+#include <ipxe/ethernet.h>
+#include <ipxe/netdevice.h>
+#include <ipxe/iobuf.h>
+#include <ipxe/timer.h>
+#include <ipxe/retry.h>
+#include <ipxe/in.h>
+#include <ipxe/ip.h>
+#include <ipxe/errortab.h>
+#include <ipxe/eth_slow.h>
+#include <ipxe/bond.h>
+
+/** @file
+ *
+ * Link aggregation
+ *
+ * A bond device aggregates several Ethernet member ports into a
+ * single network device, using the Link Aggregation Control Protocol
+ * to agree with the link partner which ports may be used.
+ *
+ * We are an active LACP participant and request the short timeout,
+ * so that the partner transmits LACPDUs every second.  We use
+ * coupled control (i.e. collecting and distributing are enabled
+ * together as soon as a port is selected), and we transmit an LACPDU
+ * immediately whenever the state of a port changes.  A port can
+ * therefore be aggregated within one round trip of the first LACPDU
+ * received from the partner.
+ *
+ * Packets received on any member port are handed to the bond device.
+ * Transmitted packets are distributed across the distributing ports
+ * by hashing the IPv4 addresses and TCP or UDP ports, so that each
+ * flow remains on a single port and is never reordered.
+ *
+ * If nothing is heard from an LACP partner within a few seconds of a
+ * port's link coming up, then we assume that the partner does not
+ * implement LACP and fall back to using that port alone, so that
+ * booting still works when attached to a non-aggregated switch port.
+ */
+
+/* Disambiguate the various possible link statuses */
+#define EINPROGRESS_LACP __einfo_error ( EINFO_EINPROGRESS_LACP )
+#define EINFO_EINPROGRESS_LACP __einfo_uniqify \
+	( EINFO_EINPROGRESS, 0x01, "Waiting for LACP partner" )
+#define ENOTCONN_NO_PORTS __einfo_error ( EINFO_ENOTCONN_NO_PORTS )
+#define EINFO_ENOTCONN_NO_PORTS __einfo_uniqify \
+	( EINFO_ENOTCONN, 0x01, "No member ports up" )
+
+/** Human-readable message for the link statuses */
+struct errortab bond_errors[] __errortab = {
+	__einfo_errortab ( EINFO_EINPROGRESS_LACP ),
+	__einfo_errortab ( EINFO_ENOTCONN_NO_PORTS ),
+};
+
+/** LACP state machine tick interval */
+#define BOND_TICK ( TICKS_PER_SEC / 4 )
+
+/** LACPDU transmission interval for a partner using the short timeout */
+#define BOND_FAST_PERIOD ( 1 * TICKS_PER_SEC )
+
+/** LACPDU transmission interval for a partner using the long timeout */
+#define BOND_SLOW_PERIOD ( 30 * TICKS_PER_SEC )
+
+/** Partner information timeout
+ *
+ * We always request the short timeout, so the partner should
+ * transmit an LACPDU every @c BOND_FAST_PERIOD.
+ */
+#define BOND_TIMEOUT ( 3 * BOND_FAST_PERIOD )
+
+/** Delay before falling back to using a port without an LACP partner */
+#define BOND_FALLBACK_DELAY ( 3 * TICKS_PER_SEC )
+
+/** LACP actor key */
+#define BOND_KEY 1
+
+/** LACP actor state for a port that is not selected */
+#define BOND_STATE_UNSELECTED \
+	( LACP_STATE_ACTIVE | LACP_STATE_FAST | LACP_STATE_AGGREGATABLE )
+
+/** LACP actor state for a selected port */
+#define BOND_STATE_SELECTED						\
+	( BOND_STATE_UNSELECTED | LACP_STATE_IN_SYNC |			\
+	  LACP_STATE_COLLECTING | LACP_STATE_DISTRIBUTING )
+
+/** A bond member port */
+struct bond_port {
+	/** Member network device */
+	struct net_device *netdev;
+	/** LACP port number */
+	unsigned int number;
+	/** LACP actor state */
+	uint8_t state;
+	/** LACP partner information (as last received) */
+	struct eth_slow_lacp_entity_tlv partner;
+	/** LACP partner information is valid */
+	int partner_valid;
+	/** Time at which partner information was last received */
+	unsigned long rx_time;
+	/** Time at which an LACPDU was last transmitted */
+	unsigned long tx_time;
+	/** An LACPDU needs to be transmitted */
+	int ntt;
+	/** Link was up when last checked */
+	int link_up;
+	/** Time at which link came up */
+	unsigned long link_time;
+	/** Port is distributing */
+	int distributing;
+	/** Promiscuous reception has been requested on member device */
+	int promisc;
+};
+
+/** Bond device private data */
+struct bond_device {
+	/** Bond network device */
+	struct net_device *netdev;
+	/** LACP state machine timer */
+	struct retry_timer timer;
+	/** Number of member ports */
+	unsigned int count;
+	/** Number of distributing ports */
+	unsigned int distributing;
+	/** Fallback port for use when no ports are distributing, if any */
+	struct bond_port *fallback;
+	/** Member ports */
+	struct bond_port port[BOND_MAX_PORTS];
+};
+
+static struct net_device_operations bond_operations;
+
+/**
+ * Identify bond member port
+ *
+ * @v member		Member network device
+ * @ret bond		Bond device, or NULL
+ * @ret port		Member port, or NULL
+ */
+static struct bond_port * bond_find_port ( struct net_device *member,
+					   struct bond_device **bond ) {
+	struct net_device *netdev;
+	struct bond_port *port;
+	unsigned int i;
+
+	for_each_netdev ( netdev ) {
+		if ( netdev->op != &bond_operations )
+			continue;
+		*bond = netdev->priv;
+		for ( i = 0 ; i < (*bond)->count ; i++ ) {
+			port = &(*bond)->port[i];
+			if ( port->netdev == member )
+				return port;
+		}
+	}
+	*bond = NULL;
+	return NULL;
+}
+
+/**
+ * Set member device promiscuous reception state
+ *
+ * @v port		Member port
+ * @v promisc		Promiscuous reception is required
+ */
+static void bond_promisc ( struct bond_port *port, int promisc ) {
+
+	if ( promisc != port->promisc ) {
+		netdev_rx_promisc ( port->netdev, promisc );
+		port->promisc = promisc;
+	}
+}
+
+/**
+ * Update bond device receive address filter
+ *
+ * @v netdev		Network device
+ */
+static void bond_filter ( struct net_device *netdev ) {
+	struct bond_device *bond = netdev->priv;
+	struct bond_port *port;
+	unsigned int i;
+
+	/* Each member device must receive promiscuously if the bond
+	 * device has been asked to do so, or if the member device's
+	 * link-layer address differs from the bond device's
+	 * link-layer address (which the partner will use for packets
+	 * distributed to any port).
+	 */
+	for ( i = 0 ; i < bond->count ; i++ ) {
+		port = &bond->port[i];
+		bond_promisc ( port, ( netdev_rx_is_promisc ( netdev ) ||
+				       ( memcmp ( netdev->ll_addr,
+						  port->netdev->ll_addr,
+						  ETH_ALEN ) != 0 ) ) );
+	}
+}
+
+/**
+ * Transmit LACPDU
+ *
+ * @v bond		Bond device
+ * @v port		Member port
+ * @ret rc		Return status code
+ */
+static int bond_lacp_tx ( struct bond_device *bond, struct bond_port *port ) {
+	struct net_device *netdev = bond->netdev;
+	struct net_device *member = port->netdev;
+	struct ll_protocol *ll_protocol = member->ll_protocol;
+	struct io_buffer *iobuf;
+	struct eth_slow_lacp *lacp;
+	int rc;
+
+	/* Record transmission */
+	port->ntt = 0;
+	port->tx_time = currticks();
+
+	/* Allocate I/O buffer */
+	iobuf = alloc_iob ( MAX_LL_HEADER_LEN + sizeof ( *lacp ) );
+	if ( ! iobuf )
+		return -ENOMEM;
+	iob_reserve ( iobuf, MAX_LL_HEADER_LEN );
+
+	/* Construct LACPDU */
+	lacp = iob_put ( iobuf, sizeof ( *lacp ) );
+	memset ( lacp, 0, sizeof ( *lacp ) );
+	lacp->header.subtype = ETH_SLOW_SUBTYPE_LACP;
+	lacp->header.version = ETH_SLOW_LACP_VERSION;
+	lacp->actor.tlv.type = ETH_SLOW_TLV_LACP_ACTOR;
+	lacp->actor.tlv.length = ETH_SLOW_TLV_LACP_ACTOR_LEN;
+	lacp->actor.system_priority = htons ( LACP_SYSTEM_PRIORITY_MAX );
+	memcpy ( lacp->actor.system, netdev->ll_addr,
+		 sizeof ( lacp->actor.system ) );
+	lacp->actor.key = htons ( BOND_KEY );
+	lacp->actor.port_priority = htons ( LACP_PORT_PRIORITY_MAX );
+	lacp->actor.port = htons ( port->number );
+	lacp->actor.state = port->state;
+	if ( port->partner_valid ) {
+		memcpy ( &lacp->partner, &port->partner,
+			 sizeof ( lacp->partner ) );
+		memset ( &lacp->partner.reserved, 0,
+			 sizeof ( lacp->partner.reserved ) );
+	}
+	lacp->partner.tlv.type = ETH_SLOW_TLV_LACP_PARTNER;
+	lacp->partner.tlv.length = ETH_SLOW_TLV_LACP_PARTNER_LEN;
+	lacp->collector.tlv.type = ETH_SLOW_TLV_LACP_COLLECTOR;
+	lacp->collector.tlv.length = ETH_SLOW_TLV_LACP_COLLECTOR_LEN;
+	DBGC2 ( netdev, "BOND %s port %d TX LACP state %02x partner %02x\n",
+		netdev->name, port->number, lacp->actor.state,
+		lacp->partner.state );
+
+	/* Add link-layer header.  We use netdev_tx() rather than
+	 * net_tx(), since this may be called from within a poll of
+	 * the member device.
+	 */
+	if ( ( rc = ll_protocol->push ( member, iobuf, eth_slow_address,
+					member->ll_addr,
+					htons ( ETH_P_SLOW ) ) ) != 0 ) {
+		free_iob ( iobuf );
+		return rc;
+	}
+
+	/* Transmit LACPDU */
+	return netdev_tx ( member, iobuf );
+}
+
+/**
+ * Update LACP state
+ *
+ * @v bond		Bond device
+ */
+static void bond_update ( struct bond_device *bond ) {
+	struct net_device *netdev = bond->netdev;
+	struct eth_slow_lacp_entity_tlv *aggregator = NULL;
+	struct bond_port *fallback = NULL;
+	struct bond_port *port;
+	unsigned long now = currticks();
+	unsigned long period;
+	unsigned int distributing = 0;
+	unsigned int i;
+	uint8_t state;
+	int selected;
+	int individual;
+	int waited;
+	int link_rc;
+	int any_up = 0;
+	int up;
+
+	for ( i = 0 ; i < bond->count ; i++ ) {
+		port = &bond->port[i];
+
+		/* Record time at which link came up */
+		up = ( netdev_is_open ( port->netdev ) &&
+		       netdev_link_ok ( port->netdev ) );
+		if ( up && ( ! port->link_up ) )
+			port->link_time = now;
+		port->link_up = up;
+		any_up |= up;
+
+		/* Expire partner information */
+		if ( port->partner_valid &&
+		     ( ( ! up ) ||
+		       ( ( now - port->rx_time ) >= BOND_TIMEOUT ) ) ) {
+			DBGC ( netdev, "BOND %s port %d partner %s\n",
+			       netdev->name, port->number,
+			       ( up ? "expired" : "lost" ) );
+			port->partner_valid = 0;
+		}
+
+		/* Select port if the partner is aggregatable, and is
+		 * the same partner system and key as the first
+		 * selected port.
+		 */
+		selected = ( port->partner_valid &&
+			     ( port->partner.state &
+			       LACP_STATE_AGGREGATABLE ) &&
+			     ( ( ! aggregator ) ||
+			       ( ( memcmp ( port->partner.system,
+					    aggregator->system,
+					    sizeof ( aggregator->system ) )
+				   == 0 ) &&
+				 ( port->partner.key == aggregator->key ) ) ) );
+		if ( selected && ( ! aggregator ) )
+			aggregator = &port->partner;
+
+		/* Update actor state */
+		state = ( selected ? BOND_STATE_SELECTED :
+			  BOND_STATE_UNSELECTED );
+		if ( state != port->state ) {
+			DBGC ( netdev, "BOND %s port %d %s\n",
+			       netdev->name, port->number,
+			       ( selected ? "selected" : "unselected" ) );
+			port->state = state;
+			port->ntt = 1;
+		}
+
+		/* Distribute to the port once the partner is collecting */
+		port->distributing =
+			( selected &&
+			  ( ( port->partner.state &
+			      ( LACP_STATE_IN_SYNC | LACP_STATE_COLLECTING ) )
+			    == ( LACP_STATE_IN_SYNC |
+				 LACP_STATE_COLLECTING ) ) );
+		if ( port->distributing )
+			distributing++;
+
+		/* Use the first port with an individual (or absent)
+		 * partner as a fallback.
+		 */
+		waited = ( ( now - port->link_time ) >= BOND_FALLBACK_DELAY );
+		individual = ( port->partner_valid ?
+			       ( ! ( port->partner.state &
+				     LACP_STATE_AGGREGATABLE ) ) : waited );
+		if ( up && individual && ( ! selected ) && ( ! fallback ) )
+			fallback = port;
+
+		/* Transmit LACPDU if needed, or if periodic
+		 * transmission is due.
+		 */
+		period = ( ( port->partner_valid &&
+			     ( ! ( port->partner.state & LACP_STATE_FAST ) ) ) ?
+			   BOND_SLOW_PERIOD : BOND_FAST_PERIOD );
+		if ( up && ( port->ntt ||
+			     ( ( now - port->tx_time ) >= period ) ) ) {
+			bond_lacp_tx ( bond, port );
+		}
+	}
+
+	/* Record distribution state */
+	if ( ( distributing != bond->distributing ) ||
+	     ( ( ! distributing ) && ( fallback != bond->fallback ) ) ) {
+		DBGC ( netdev, "BOND %s distributing to %d of %d ports",
+		       netdev->name, distributing, bond->count );
+		if ( ( ! distributing ) && fallback ) {
+			DBGC ( netdev, " (fallback to port %d)",
+			       fallback->number );
+		}
+		DBGC ( netdev, "\n" );
+	}
+	bond->distributing = distributing;
+	bond->fallback = ( distributing ? NULL : fallback );
+
+	/* Update link state */
+	if ( distributing || fallback ) {
+		link_rc = 0;
+	} else if ( any_up ) {
+		link_rc = -EINPROGRESS_LACP;
+	} else {
+		link_rc = -ENOTCONN_NO_PORTS;
+	}
+	if ( link_rc != netdev->link_rc )
+		netdev_link_err ( netdev, link_rc );
+}
+
+/**
+ * LACP state machine timer expired
+ *
+ * @v timer		LACP state machine timer
+ * @v over		Failure indicator
+ */
+static void bond_expired ( struct retry_timer *timer, int over __unused ) {
+	struct bond_device *bond =
+		container_of ( timer, struct bond_device, timer );
+
+	/* Update state and restart timer */
+	bond_update ( bond );
+	start_timer_fixed ( &bond->timer, BOND_TICK );
+}
+
+/**
+ * Process received LACPDU
+ *
+ * @v bond		Bond device
+ * @v port		Member port
+ * @v iobuf		I/O buffer
+ */
+static void bond_lacp_rx ( struct bond_device *bond, struct bond_port *port,
+			   struct io_buffer *iobuf ) {
+	struct net_device *netdev = bond->netdev;
+	struct eth_slow_lacp *lacp = iobuf->data;
+
+	/* Sanity check */
+	if ( iob_len ( iobuf ) < sizeof ( *lacp ) ) {
+		DBGC ( netdev, "BOND %s port %d received underlength LACPDU "
+		       "(%zd bytes)\n", netdev->name, port->number,
+		       iob_len ( iobuf ) );
+		goto done;
+	}
+	DBGC2 ( netdev, "BOND %s port %d RX LACP state %02x partner %02x\n",
+		netdev->name, port->number, lacp->actor.state,
+		lacp->partner.state );
+
+	/* Record partner information */
+	if ( ! port->partner_valid ) {
+		DBGC ( netdev, "BOND %s port %d partner %s port %04x key "
+		       "%04x\n", netdev->name, port->number,
+		       eth_ntoa ( lacp->actor.system ),
+		       ntohs ( lacp->actor.port ), ntohs ( lacp->actor.key ) );
+	}
+	memcpy ( &port->partner, &lacp->actor, sizeof ( port->partner ) );
+	port->partner_valid = 1;
+	port->rx_time = currticks();
+
+	/* Respond immediately if the partner's view of us is out of
+	 * date, rather than waiting for the next periodic LACPDU.
+	 */
+	if ( ( memcmp ( lacp->partner.system, netdev->ll_addr,
+			sizeof ( lacp->partner.system ) ) != 0 ) ||
+	     ( lacp->partner.key != htons ( BOND_KEY ) ) ||
+	     ( lacp->partner.port != htons ( port->number ) ) ||
+	     ( lacp->partner.state != port->state ) ) {
+		port->ntt = 1;
+	}
+
+	/* Update state */
+	bond_update ( bond );
+
+ done:
+	free_iob ( iobuf );
+}
+
+/**
+ * Process packet received on member port
+ *
+ * @v bond		Bond device
+ * @v port		Member port
+ * @v iobuf		I/O buffer
+ */
+static void bond_rx ( struct bond_device *bond, struct bond_port *port,
+		      struct io_buffer *iobuf ) {
+	struct net_device *netdev = bond->netdev;
+	struct ethhdr *ethhdr = iobuf->data;
+	union eth_slow_packet *eth_slow;
+
+	/* Sanity check */
+	if ( iob_len ( iobuf ) < sizeof ( *ethhdr ) ) {
+		free_iob ( iobuf );
+		return;
+	}
+
+	/* Handle slow protocol packets on the member port */
+	if ( ethhdr->h_protocol == htons ( ETH_P_SLOW ) ) {
+		eth_slow = iob_pull ( iobuf, sizeof ( *ethhdr ) );
+		if ( ( iob_len ( iobuf ) >= sizeof ( eth_slow->header ) ) &&
+		     ( eth_slow->header.subtype == ETH_SLOW_SUBTYPE_LACP ) ) {
+			bond_lacp_rx ( bond, port, iobuf );
+		} else {
+			net_rx ( iobuf, port->netdev, ethhdr->h_protocol,
+				 ethhdr->h_dest, ethhdr->h_source, 0 );
+		}
+		return;
+	}
+
+	/* Discard unicast packets for other link-layer addresses,
+	 * unless the bond device is receiving promiscuously.
+	 */
+	if ( ( ! is_multicast_ether_addr ( ethhdr->h_dest ) ) &&
+	     ( memcmp ( ethhdr->h_dest, netdev->ll_addr, ETH_ALEN ) != 0 ) &&
+	     ( ! netdev_rx_is_promisc ( netdev ) ) ) {
+		free_iob ( iobuf );
+		return;
+	}
+
+	/* Hand packet to bond device */
+	netdev_rx ( netdev, iobuf );
+}
+
+/**
+ * Calculate flow hash for transmitted packet
+ *
+ * @v iobuf		I/O buffer
+ * @ret hash		Flow hash
+ *
+ * The hash uses the IPv4 addresses and, for unfragmented TCP and UDP
+ * packets, the ports.  All other packets are hashed using the
+ * Ethernet addresses.
+ */
+static unsigned int bond_hash ( struct io_buffer *iobuf ) {
+	struct ethhdr *ethhdr = iobuf->data;
+	struct iphdr *iphdr = ( iobuf->data + sizeof ( *ethhdr ) );
+	size_t len = iob_len ( iobuf );
+	size_t hdrlen;
+	uint32_t ports;
+	uint32_t hash;
+
+	/* Hash Ethernet addresses by default */
+	hash = ( ethhdr->h_dest[ ETH_ALEN - 1 ] ^
+		 ethhdr->h_source[ ETH_ALEN - 1 ] );
+
+	/* Hash IPv4 addresses and ports, if applicable */
+	if ( ( ethhdr->h_protocol == htons ( ETH_P_IP ) ) &&
+	     ( len >= ( sizeof ( *ethhdr ) + sizeof ( *iphdr ) ) ) ) {
+		hash = ( iphdr->src.s_addr ^ iphdr->dest.s_addr );
+		hdrlen = ( ( iphdr->verhdrlen & IP_MASK_HLEN ) * 4 );
+		if ( ( ( iphdr->protocol == IP_TCP ) ||
+		       ( iphdr->protocol == IP_UDP ) ) &&
+		     ( ! ( iphdr->frags & htons ( IP_MASK_OFFSET |
+						  IP_MASK_MOREFRAGS ) ) ) &&
+		     ( len >= ( sizeof ( *ethhdr ) + hdrlen +
+				sizeof ( ports ) ) ) ) {
+			memcpy ( &ports, ( ( ( void * ) iphdr ) + hdrlen ),
+				 sizeof ( ports ) );
+			hash ^= ports;
+		}
+	}
+
+	/* Fold hash */
+	hash ^= ( hash >> 16 );
+	hash ^= ( hash >> 8 );
+	return ( hash & 0xff );
+}
+
+/**
+ * Select member port for transmitted packet
+ *
+ * @v bond		Bond device
+ * @v iobuf		I/O buffer
+ * @ret port		Member port, or NULL
+ */
+static struct bond_port * bond_select ( struct bond_device *bond,
+					struct io_buffer *iobuf ) {
+	struct bond_port *port;
+	unsigned int index;
+	unsigned int i;
+
+	/* Use fallback port, if no ports are distributing */
+	if ( ! bond->distributing )
+		return bond->fallback;
+
+	/* Select distributing port based on flow hash */
+	index = ( bond_hash ( iobuf ) % bond->distributing );
+	for ( i = 0 ; i < bond->count ; i++ ) {
+		port = &bond->port[i];
+		if ( port->distributing && ( index-- == 0 ) )
+			return port;
+	}
+
+	return NULL;
+}
+
+/**
+ * Open bond device
+ *
+ * @v netdev		Network device
+ * @ret rc		Return status code
+ */
+static int bond_open ( struct net_device *netdev ) {
+	struct bond_device *bond = netdev->priv;
+	struct bond_port *port;
+	unsigned int i;
+	int rc;
+
+	/* Open member devices and take over their receive queues */
+	for ( i = 0 ; i < bond->count ; i++ ) {
+		port = &bond->port[i];
+		if ( ( rc = netdev_open ( port->netdev ) ) != 0 ) {
+			DBGC ( netdev, "BOND %s could not open %s: %s\n",
+			       netdev->name, port->netdev->name,
+			       strerror ( rc ) );
+			goto err_open;
+		}
+		netdev_rx_freeze ( port->netdev );
+		port->state = 0;
+		port->partner_valid = 0;
+		port->link_up = 0;
+		port->distributing = 0;
+	}
+	bond->distributing = 0;
+	bond->fallback = NULL;
+	bond_filter ( netdev );
+
+	/* Start LACP */
+	bond_update ( bond );
+	start_timer_fixed ( &bond->timer, BOND_TICK );
+
+	return 0;
+
+ err_open:
+	while ( i-- ) {
+		port = &bond->port[i];
+		netdev_rx_unfreeze ( port->netdev );
+		netdev_close ( port->netdev );
+	}
+	return rc;
+}
+
+/**
+ * Close bond device
+ *
+ * @v netdev		Network device
+ */
+static void bond_close ( struct net_device *netdev ) {
+	struct bond_device *bond = netdev->priv;
+	struct bond_port *port;
+	unsigned int i;
+
+	/* Stop LACP */
+	stop_timer ( &bond->timer );
+	bond->distributing = 0;
+	bond->fallback = NULL;
+
+	/* Release and close member devices */
+	for ( i = 0 ; i < bond->count ; i++ ) {
+		port = &bond->port[i];
+		bond_promisc ( port, 0 );
+		netdev_rx_unfreeze ( port->netdev );
+		netdev_close ( port->netdev );
+	}
+}
+
+/**
+ * Transmit packet on bond device
+ *
+ * @v netdev		Network device
+ * @v iobuf		I/O buffer
+ * @ret rc		Return status code
+ */
+static int bond_transmit ( struct net_device *netdev,
+			   struct io_buffer *iobuf ) {
+	struct bond_device *bond = netdev->priv;
+	struct bond_port *port;
+	int rc;
+
+	/* Select member port */
+	port = bond_select ( bond, iobuf );
+	if ( ! port )
+		return -ENETUNREACH;
+
+	/* Reclaim I/O buffer from bond device's TX queue */
+	list_del ( &iobuf->list );
+
+	/* Transmit packet on member device */
+	if ( ( rc = netdev_tx ( port->netdev, iob_disown ( iobuf ) ) ) != 0 ) {
+		DBGC ( netdev, "BOND %s could not transmit on %s: %s\n",
+		       netdev->name, port->netdev->name, strerror ( rc ) );
+		/* Cannot return an error status, since that would
+		 * cause the I/O buffer to be double-freed.
+		 */
+		return 0;
+	}
+
+	return 0;
+}
+
+/**
+ * Poll bond device
+ *
+ * @v netdev		Network device
+ */
+static void bond_poll ( struct net_device *netdev ) {
+	struct bond_device *bond = netdev->priv;
+	struct bond_port *port;
+	struct io_buffer *iobuf;
+	unsigned int i;
+
+	/* Poll member devices and process their received packets */
+	for ( i = 0 ; i < bond->count ; i++ ) {
+		port = &bond->port[i];
+		netdev_poll ( port->netdev );
+		while ( ( iobuf = netdev_rx_dequeue ( port->netdev ) ) )
+			bond_rx ( bond, port, iobuf );
+	}
+}
+
+/**
+ * Enable/disable interrupts on bond device
+ *
+ * @v netdev		Network device
+ * @v enable		Interrupts should be enabled
+ */
+static void bond_irq ( struct net_device *netdev, int enable ) {
+	struct bond_device *bond = netdev->priv;
+	unsigned int i;
+
+	for ( i = 0 ; i < bond->count ; i++ )
+		netdev_irq ( bond->port[i].netdev, enable );
+}
+
+/** Bond device operations */
+static struct net_device_operations bond_operations = {
+	.open		= bond_open,
+	.close		= bond_close,
+	.transmit	= bond_transmit,
+	.poll		= bond_poll,
+	.irq		= bond_irq,
+	.filter		= bond_filter,
+};
+
+/**
+ * Create bond device
+ *
+ * @v members		Member network devices
+ * @v count		Number of member network devices
+ * @ret rc		Return status code
+ */
+int bond_create ( struct net_device **members, unsigned int count ) {
+	struct net_device *netdev;
+	struct net_device *member;
+	struct bond_device *bond;
+	struct bond_device *other;
+	struct bond_port *port;
+	unsigned int index = 0;
+	unsigned int i;
+	unsigned int j;
+	int rc;
+
+	/* Sanity check */
+	if ( ( count == 0 ) || ( count > BOND_MAX_PORTS ) ) {
+		DBG ( "BOND cannot aggregate %d ports\n", count );
+		rc = -EINVAL;
+		goto err_count;
+	}
+
+	/* Allocate and initialise structure */
+	netdev = alloc_etherdev ( sizeof ( *bond ) );
+	if ( ! netdev ) {
+		rc = -ENOMEM;
+		goto err_alloc_etherdev;
+	}
+	netdev_init ( netdev, &bond_operations );
+	netdev->dev = members[0]->dev;
+	netdev->max_pkt_len = members[0]->max_pkt_len;
+	netdev->max_tx_frags = members[0]->max_tx_frags;
+	netdev->state |= NETDEV_RX_CSUM;
+	memcpy ( netdev->hw_addr, members[0]->ll_addr, ETH_ALEN );
+	bond = netdev->priv;
+	bond->netdev = netdev;
+	timer_init ( &bond->timer, bond_expired, NULL );
+
+	/* Add member ports */
+	for ( i = 0 ; i < count ; i++ ) {
+		member = members[i];
+
+		/* Check that member is usable */
+		if ( ( member->ll_protocol != netdev->ll_protocol ) ||
+		     ( member->op == &bond_operations ) ) {
+			DBGC ( netdev, "BOND cannot aggregate non-Ethernet "
+			       "device %s\n", member->name );
+			rc = -ENOTTY;
+			goto err_member;
+		}
+		for ( j = 0 ; j < i ; j++ ) {
+			if ( members[j] == member )
+				break;
+		}
+		if ( ( j < i ) || bond_find_port ( member, &other ) ) {
+			DBGC ( netdev, "BOND cannot aggregate %s twice\n",
+			       member->name );
+			rc = -EBUSY;
+			goto err_member;
+		}
+
+		/* Add member port */
+		port = &bond->port[i];
+		port->netdev = netdev_get ( member );
+		port->number = ( i + 1 );
+		bond->count++;
+
+		/* Use the most restrictive member limits */
+		if ( netdev->max_pkt_len > member->max_pkt_len )
+			netdev->max_pkt_len = member->max_pkt_len;
+		if ( netdev->max_tx_frags > member->max_tx_frags )
+			netdev->max_tx_frags = member->max_tx_frags;
+		if ( ! ( member->state & NETDEV_RX_CSUM ) )
+			netdev->state &= ~NETDEV_RX_CSUM;
+	}
+
+	/* Construct bond device name */
+	do {
+		snprintf ( netdev->name, sizeof ( netdev->name ), "bond%d",
+			   index++ );
+	} while ( find_netdev ( netdev->name ) );
+
+	/* Register bond device */
+	if ( ( rc = register_netdev ( netdev ) ) != 0 ) {
+		DBGC ( netdev, "BOND %s could not register: %s\n",
+		       netdev->name, strerror ( rc ) );
+		goto err_register;
+	}
+
+	DBGC ( netdev, "BOND %s created with %d ports:", netdev->name,
+	       bond->count );
+	for ( i = 0 ; i < bond->count ; i++ )
+		DBGC ( netdev, " %s", bond->port[i].netdev->name );
+	DBGC ( netdev, "\n" );
+
+	return 0;
+
+	unregister_netdev ( netdev );
+ err_register:
+ err_member:
+	for ( i = 0 ; i < bond->count ; i++ )
+		netdev_put ( bond->port[i].netdev );
+	netdev_nullify ( netdev );
+	netdev_put ( netdev );
+ err_alloc_etherdev:
+ err_count:
+	return rc;
+}
+
+/**
+ * Destroy bond device
+ *
+ * @v netdev		Network device
+ * @ret rc		Return status code
+ */
+int bond_destroy ( struct net_device *netdev ) {
+	struct bond_device *bond = netdev->priv;
+	struct net_device *members[BOND_MAX_PORTS];
+	unsigned int count;
+	unsigned int i;
+
+	/* Sanity check */
+	if ( netdev->op != &bond_operations ) {
+		DBGC ( netdev, "BOND %s cannot destroy non-bond device\n",
+		       netdev->name );
+		return -ENOTTY;
+	}
+
+	DBGC ( netdev, "BOND %s destroyed\n", netdev->name );
+
+	/* Remove bond device */
+	count = bond->count;
+	for ( i = 0 ; i < count ; i++ )
+		members[i] = bond->port[i].netdev;
+	unregister_netdev ( netdev );
+	netdev_nullify ( netdev );
+	netdev_put ( netdev );
+	for ( i = 0 ; i < count ; i++ )
+		netdev_put ( members[i] );
+
+	return 0;
+}
+
+/**
+ * Do nothing
+ *
+ * @v netdev		Network device
+ * @ret rc		Return status code
+ */
+static int bond_probe ( struct net_device *netdev __unused ) {
+	return 0;
+}
+
+/**
+ * Handle member network device link state change
+ *
+ * @v member		Member network device
+ */
+static void bond_notify ( struct net_device *member ) {
+	struct bond_device *bond;
+
+	/* Update LACP state immediately, to avoid waiting for the
+	 * next timer tick.
+	 */
+	if ( bond_find_port ( member, &bond ) &&
+	     netdev_is_open ( bond->netdev ) ) {
+		bond_update ( bond );
+	}
+}
+
+/**
+ * Destroy bond device for a removed member network device
+ *
+ * @v member		Member network device
+ */
+static void bond_remove ( struct net_device *member ) {
+	struct bond_device *bond;
+
+	if ( bond_find_port ( member, &bond ) )
+		bond_destroy ( bond->netdev );
+}
+
+/** Bond driver */
+struct net_driver bond_driver __net_driver = {
+	.name = "Bond",
+	.probe = bond_probe,
+	.notify = bond_notify,
+	.remove = bond_remove,
+};
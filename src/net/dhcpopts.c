@@ -91,6 +91,51 @@ static unsigned int dhcp_option_len ( struct dhcp_option *option ) {
 	}
 }
 
+/**
+ * Construct DHCP option index
+ *
+ * @v options		DHCP options block
+ * @ret indexed		DHCP options block has a valid index
+ *
+ * The index records the offset of the first instance of each
+ * top-level option (including the @c DHCP_END marker), scanning in
+ * the same way as find_dhcp_option_with_encap().  It is invalidated
+ * whenever the options block is modified, and reconstructed on the
+ * next search.
+ */
+static int dhcpopt_index ( struct dhcp_options *options ) {
+	struct dhcp_option *option;
+	int offset = 0;
+	ssize_t remaining = options->used_len;
+	unsigned int option_len;
+
+	/* Use existing index, if valid */
+	if ( options->indexed )
+		return 1;
+
+	/* Do not index blocks whose offsets would not fit in the index */
+	if ( options->used_len > 0xffff )
+		return 0;
+
+	/* Index options */
+	memset ( options->index, 0, sizeof ( options->index ) );
+	while ( remaining ) {
+		option = dhcp_option ( options, offset );
+		option_len = dhcp_option_len ( option );
+		remaining -= option_len;
+		if ( remaining < 0 )
+			break;
+		if ( ! options->index[option->tag] )
+			options->index[option->tag] = ( offset + 1 );
+		if ( option->tag == DHCP_END )
+			break;
+		offset += option_len;
+	}
+	options->indexed = 1;
+
+	return 1;
+}
+
 /**
  * Find DHCP option within DHCP options block, and its encapsulator (if any)
  *
@@ -120,10 +165,24 @@ static int find_dhcp_option_with_encap ( struct dhcp_options *options,
 	ssize_t remaining = options->used_len;
 	unsigned int option_len;
 
+	unsigned int index_tag;
+
 	/* Sanity check */
 	if ( tag == DHCP_PAD )
 		return -ENOENT;
 
+	/* Skip directly to the top-level option (or its encapsulator),
+	 * if possible.
+	 */
+	if ( dhcpopt_index ( options ) ) {
+		index_tag = ( DHCP_IS_ENCAP_OPT ( tag ) ?
+			      DHCP_ENCAPSULATOR ( tag ) : tag );
+		if ( ! options->index[index_tag] )
+			return -ENOENT;
+		offset = ( options->index[index_tag] - 1 );
+		remaining -= offset;
+	}
+
 	/* Search for option */
 	while ( remaining ) {
 		/* Calculate length of this option.  Abort processing
@@ -211,6 +270,9 @@ static int resize_dhcp_option ( struct dhcp_options *options,
 	}
 	new_used_len = ( options->used_len + delta );
 
+	/* Invalidate index */
+	options->indexed = 0;
+
 	/* Expand options block, if necessary */
 	if ( new_used_len > options->alloc_len ) {
 		/* Reallocate options block */
@@ -420,6 +482,9 @@ void dhcpopt_update_used_len ( struct dhcp_options *options ) {
 	ssize_t remaining = options->alloc_len;
 	unsigned int option_len;
 
+	/* Invalidate index */
+	options->indexed = 0;
+
 	/* Find last non-pad option */
 	options->used_len = 0;
 	while ( remaining ) {
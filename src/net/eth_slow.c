@@ -43,7 +43,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 struct net_protocol eth_slow_protocol __net_protocol;
 
 /** Slow protocols multicast address */
-static const uint8_t eth_slow_address[ETH_ALEN] =
+const uint8_t eth_slow_address[ETH_ALEN] =
 	{ 0x01, 0x80, 0xc2, 0x00, 0x00, 0x02 };
 
 /**
@@ -301,6 +301,8 @@ struct fc_exchange {
 	uint8_t seq_id;
 	/** Active sequence count */
 	uint16_t seq_cnt;
+	/** Maximum frame payload length */
+	size_t mtu;
 
 	/** Timeout timer */
 	struct retry_timer timer;
@@ -415,10 +417,8 @@ static void fc_xchg_expired ( struct retry_timer *timer, int over __unused ) {
  * @v xchg		Fibre Channel exchange
  * @ret len		Length opf window
  */
-static size_t fc_xchg_window ( struct fc_exchange *xchg __unused ) {
-
-	/* We don't currently store the path MTU */
-	return FC_LOGIN_DEFAULT_MTU;
+static size_t fc_xchg_window ( struct fc_exchange *xchg ) {
+	return xchg->mtu;
 }
 
 /**
@@ -691,6 +691,7 @@ static struct fc_exchange * fc_xchg_create ( struct fc_port *port,
 					     struct fc_port_id *peer_port_id,
 					     unsigned int type ) {
 	struct fc_exchange *xchg;
+	struct fc_peer *peer;
 
 	/* Allocate and initialise structure */
 	xchg = zalloc ( sizeof ( *xchg ) );
@@ -707,6 +708,15 @@ static struct fc_exchange * fc_xchg_create ( struct fc_port *port,
 	xchg->peer_xchg_id = FC_RX_ID_UNKNOWN;
 	xchg->seq_id = fc_new_seq_id();
 
+	/* Use peer's receive data field size, if known */
+	xchg->mtu = FC_LOGIN_DEFAULT_MTU;
+	peer = fc_peer_get_port_id ( port, peer_port_id );
+	if ( peer ) {
+		if ( peer->mtu )
+			xchg->mtu = peer->mtu;
+		fc_peer_put ( peer );
+	}
+
 	/* Transfer reference to list of exchanges and return */
 	list_add ( &xchg->list, &port->xchgs );
 	return xchg;
@@ -923,6 +933,20 @@ static int fc_port_deliver ( struct fc_port *port, struct io_buffer *iobuf,
 	return rc;
 }
 
+/**
+ * Notify all peers of Fibre Channel port state change
+ */
+static void fc_notify_peers ( void ) {
+	struct fc_peer *peer;
+	struct fc_peer *tmp;
+
+	list_for_each_entry_safe ( peer, tmp, &fc_peers, list ) {
+		fc_peer_get ( peer );
+		fc_link_examine ( &peer->link );
+		fc_peer_put ( peer );
+	}
+}
+
 /**
  * Log in Fibre Channel port
  *
@@ -936,8 +960,6 @@ static int fc_port_deliver ( struct fc_port *port, struct io_buffer *iobuf,
 int fc_port_login ( struct fc_port *port, struct fc_port_id *port_id,
 		    const struct fc_name *link_node_wwn,
 		    const struct fc_name *link_port_wwn, int has_fabric ) {
-	struct fc_peer *peer;
-	struct fc_peer *tmp;
 	int rc;
 
 	/* Perform implicit logout if logged in and details differ */
@@ -1016,15 +1038,37 @@ int fc_port_login ( struct fc_port *port, struct fc_port_id *port_id,
 	fc_link_up ( &port->link );
 
 	/* Notify peers of link state change */
-	list_for_each_entry_safe ( peer, tmp, &fc_peers, list ) {
-		fc_peer_get ( peer );
-		fc_link_examine ( &peer->link );
-		fc_peer_put ( peer );
-	}
+	fc_notify_peers();
 
 	return 0;
 }
 
+/**
+ * Calculate Fibre Channel port receive data field size
+ *
+ * @v port		Fibre Channel port
+ * @ret mtu		Receive data field size
+ *
+ * This is the largest frame payload which the underlying transport
+ * can carry, and is the receive data field size that we advertise
+ * when logging in.
+ */
+size_t fc_port_mtu ( struct fc_port *port ) {
+	size_t window = xfer_window ( &port->transport );
+	size_t mtu;
+
+	/* Calculate payload length, allowing for frame header */
+	if ( window < ( sizeof ( struct fc_frame_header ) +
+			FC_LOGIN_DEFAULT_MTU ) )
+		return FC_LOGIN_DEFAULT_MTU;
+	mtu = ( window - sizeof ( struct fc_frame_header ) );
+	if ( mtu > FC_LOGIN_MAX_MTU )
+		mtu = FC_LOGIN_MAX_MTU;
+
+	/* Round down to a multiple of four bytes */
+	return ( mtu & ~( ( size_t ) 3 ) );
+}
+
 /**
  * Log out Fibre Channel port
  *
@@ -1032,8 +1076,6 @@ int fc_port_login ( struct fc_port *port, struct fc_port_id *port_id,
  * @v rc		Reason for logout
  */
 void fc_port_logout ( struct fc_port *port, int rc ) {
-	struct fc_peer *peer;
-	struct fc_peer *tmp;
 
 	DBGC ( port, "FCPORT %s logged out: %s\n",
 	       port->name, strerror ( rc ) );
@@ -1046,11 +1088,7 @@ void fc_port_logout ( struct fc_port *port, int rc ) {
 	fc_link_err ( &port->link, rc );
 
 	/* Notify peers of link state change */
-	list_for_each_entry_safe ( peer, tmp, &fc_peers, list ) {
-		fc_peer_get ( peer );
-		fc_link_examine ( &peer->link );
-		fc_peer_put ( peer );
-	}
+	fc_notify_peers();
 }
 
 /**
@@ -1081,6 +1119,10 @@ static void fc_port_ns_plogi_done ( struct fc_port *port, int rc ) {
 		port->flags |= FC_PORT_HAS_NS;
 		DBGC ( port, "FCPORT %s logged in to name server\n",
 		       port->name );
+		/* Allow peers to start name server lookups immediately,
+		 * rather than waiting for their link retry timers.
+		 */
+		fc_notify_peers();
 	} else {
 		DBGC ( port, "FCPORT %s could not log in to name server: %s\n",
 		       port->name, strerror ( rc ) );
@@ -1353,6 +1395,7 @@ void fc_peer_logout ( struct fc_peer *peer, int rc ) {
 	/* Erase peer details */
 	fc_port_put ( peer->port );
 	peer->port = NULL;
+	peer->mtu = 0;
 
 	/* Record logout */
 	fc_link_err ( &peer->link, rc );
@@ -1395,6 +1438,13 @@ static int fc_peer_plogi ( struct fc_peer *peer, struct fc_port *port,
 			   struct fc_port_id *peer_port_id ) {
 	int rc;
 
+	/* Do nothing if already logged in via another port.  Name
+	 * server lookups may be in progress on several ports at once,
+	 * and the first port to find the peer wins.
+	 */
+	if ( fc_link_ok ( &peer->link ) )
+		return 0;
+
 	/* Try to create PLOGI ELS */
 	intf_restart ( &peer->plogi, -ECANCELED );
 	if ( ( rc = fc_els_plogi ( &peer->plogi, port, peer_port_id ) ) != 0 ) {
@@ -467,7 +467,7 @@ static int fc_els_flogi_tx ( struct fc_els *els ) {
 	flogi.common.version = htons ( FC_LOGIN_VERSION );
 	flogi.common.credit = htons ( FC_LOGIN_DEFAULT_B2B );
 	flogi.common.flags = htons ( FC_LOGIN_CONTINUOUS_OFFSET );
-	flogi.common.mtu = htons ( FC_LOGIN_DEFAULT_MTU );
+	flogi.common.mtu = htons ( fc_port_mtu ( els->port ) );
 	memcpy ( &flogi.port_wwn, &els->port->port_wwn,
 		 sizeof ( flogi.port_wwn ) );
 	memcpy ( &flogi.node_wwn, &els->port->node_wwn,
@@ -601,7 +601,7 @@ static int fc_els_plogi_tx ( struct fc_els *els ) {
 	plogi.common.version = htons ( FC_LOGIN_VERSION );
 	plogi.common.credit = htons ( FC_LOGIN_DEFAULT_B2B );
 	plogi.common.flags = htons ( FC_LOGIN_CONTINUOUS_OFFSET );
-	plogi.common.mtu = htons ( FC_LOGIN_DEFAULT_MTU );
+	plogi.common.mtu = htons ( fc_port_mtu ( els->port ) );
 	plogi.common.u.plogi.max_seq = htons ( FC_LOGIN_DEFAULT_MAX_SEQ );
 	plogi.common.u.plogi.rel_offs = htons ( FC_LOGIN_DEFAULT_REL_OFFS );
 	plogi.common.e_d_tov = htonl ( FC_LOGIN_DEFAULT_E_D_TOV );
@@ -611,7 +611,7 @@ static int fc_els_plogi_tx ( struct fc_els *els ) {
 		 sizeof ( plogi.node_wwn ) );
 	plogi.class3.flags = htons ( FC_LOGIN_CLASS_VALID |
 				     FC_LOGIN_CLASS_SEQUENTIAL );
-	plogi.class3.mtu = htons ( FC_LOGIN_DEFAULT_MTU );
+	plogi.class3.mtu = htons ( fc_port_mtu ( els->port ) );
 	plogi.class3.max_seq = htons ( FC_LOGIN_DEFAULT_MAX_SEQ );
 	plogi.class3.max_seq_per_xchg = 1;
 
@@ -630,6 +630,7 @@ static int fc_els_plogi_tx ( struct fc_els *els ) {
 static int fc_els_plogi_rx ( struct fc_els *els, void *data, size_t len ) {
 	struct fc_login_frame *plogi = data;
 	struct fc_peer *peer;
+	size_t mtu;
 	int rc;
 
 	/* Sanity checks */
@@ -671,6 +672,15 @@ static int fc_els_plogi_rx ( struct fc_els *els, void *data, size_t len ) {
 		goto err_login;
 	}
 
+	/* Record peer's receive data field size */
+	mtu = ( ntohs ( plogi->class3.mtu ) & FC_LOGIN_MTU_MASK );
+	if ( mtu > fc_port_mtu ( els->port ) )
+		mtu = fc_port_mtu ( els->port );
+	if ( mtu >= FC_LOGIN_MIN_MTU )
+		peer->mtu = mtu;
+	DBGC ( els, FCELS_FMT " has receive data field size %zd\n",
+	       FCELS_ARGS ( els ), peer->mtu );
+
 	/* Transmit response, if applicable */
 	if ( ! fc_els_is_request ( els ) ) {
 		if ( ( rc = fc_els_plogi_tx ( els ) ) != 0 )
@@ -108,6 +108,8 @@ enum fcoe_flags {
 	FCOE_VLAN_FOUND = 0x0010,
 	/** VLAN discovery has timed out */
 	FCOE_VLAN_TIMED_OUT = 0x0020,
+	/** Promiscuous reception has been requested */
+	FCOE_PROMISC = 0x0040,
 };
 
 struct net_protocol fcoe_protocol __net_protocol;
@@ -144,6 +146,13 @@ static uint8_t default_fcf_mac[ETH_ALEN] =
 /** Delay between retrying FIP solicitations */
 #define FCOE_FIP_RETRY_DELAY ( TICKS_PER_SEC )
 
+/** Delay for further advertisements after the first solicited advertisement
+ *
+ * This allows time for any other FCoE forwarders to respond, without
+ * waiting for the full FIP solicitation retry delay.
+ */
+#define FCOE_FIP_SELECT_DELAY ( TICKS_PER_SEC / 10 )
+
 /** Maximum number of missing discovery advertisements */
 #define FCOE_MAX_FIP_MISSING_KEEPALIVES 4
 
@@ -173,6 +182,19 @@ static struct fcoe_port * fcoe_demux ( struct net_device *netdev ) {
 	return NULL;
 }
 
+/**
+ * Release promiscuous reception, if requested
+ *
+ * @v fcoe		FCoE port
+ */
+static void fcoe_release_promisc ( struct fcoe_port *fcoe ) {
+
+	if ( fcoe->flags & FCOE_PROMISC ) {
+		netdev_rx_promisc ( fcoe->netdev, 0 );
+		fcoe->flags &= ~FCOE_PROMISC;
+	}
+}
+
 /**
  * Reset FCoE port
  *
@@ -184,6 +206,7 @@ static void fcoe_reset ( struct fcoe_port *fcoe ) {
 	intf_restart ( &fcoe->transport, -ECANCELED );
 
 	/* Reset any FIP state */
+	fcoe_release_promisc ( fcoe );
 	stop_timer ( &fcoe->timer );
 	fcoe->timeouts = 0;
 	fcoe->flags = 0;
@@ -430,7 +453,15 @@ static int fcoe_rx ( struct io_buffer *iobuf, struct net_device *netdev,
  * @ret len		Length of window
  */
 static size_t fcoe_window ( struct fcoe_port *fcoe ) {
-	return ( ( fcoe->flags & FCOE_HAVE_FCF ) ? ~( ( size_t ) 0 ) : 0 );
+	struct net_device *netdev = fcoe->netdev;
+
+	/* Do not allow transmission until an FCF has been found */
+	if ( ! ( fcoe->flags & FCOE_HAVE_FCF ) )
+		return 0;
+
+	/* Allow for FCoE header and footer */
+	return ( netdev->mtu - sizeof ( struct fcoe_header ) -
+		 sizeof ( struct fcoe_footer ) );
 }
 
 /**
@@ -443,6 +474,7 @@ static void fcoe_close ( struct fcoe_port *fcoe, int rc ) {
 
 	stop_timer ( &fcoe->timer );
 	intf_shutdown ( &fcoe->transport, rc );
+	fcoe_release_promisc ( fcoe );
 	netdev_put ( fcoe->netdev );
 	list_del ( &fcoe->list );
 	ref_put ( &fcoe->refcnt );
@@ -693,7 +725,7 @@ static int fcoe_fip_tx_solicitation ( struct fcoe_port *fcoe ) {
 	solicitation->max_fcoe_size.len =
 		( sizeof ( solicitation->max_fcoe_size ) / 4 );
 	solicitation->max_fcoe_size.mtu =
-		htons ( ETH_MAX_MTU - sizeof ( struct fcoe_header ) -
+		htons ( fcoe->netdev->mtu - sizeof ( struct fcoe_header ) -
 			sizeof ( struct fcoe_footer ) );
 
 	/* Send discovery solicitation */
@@ -750,6 +782,13 @@ static int fcoe_fip_rx_advertisement ( struct fcoe_port *fcoe,
 		       ( FIP_A | FIP_S | FIP_F ) ) &&
 		     ( priority->priority < fcoe->priority ) ) {
 
+			/* Select promptly once the first forwarder
+			 * has responded.
+			 */
+			if ( ! ( fcoe->flags & FCOE_HAVE_FIP_FCF ) ) {
+				start_timer_fixed ( &fcoe->timer,
+						    FCOE_FIP_SELECT_DELAY );
+			}
 			fcoe->flags |= FCOE_HAVE_FIP_FCF;
 			fcoe->priority = priority->priority;
 			if ( fka_adv_p->flags & FIP_NO_KEEPALIVE ) {
@@ -832,6 +871,14 @@ static int fcoe_fip_rx_els_response ( struct fcoe_port *fcoe,
 	DBGC ( fcoe, "FCoE %s using local MAC %s\n",
 	       fcoe->netdev->name, eth_ntoa ( fcoe->local_mac ) );
 
+	/* Receive promiscuously if using a fabric-provided MAC address */
+	if ( ( memcmp ( fcoe->local_mac, fcoe->netdev->ll_addr,
+			sizeof ( fcoe->local_mac ) ) != 0 ) &&
+	     ( ! ( fcoe->flags & FCOE_PROMISC ) ) ) {
+		netdev_rx_promisc ( fcoe->netdev, 1 );
+		fcoe->flags |= FCOE_PROMISC;
+	}
+
 	/* Hand off via transport interface */
 	frame = &flogi->fc;
 	frame_len = ( ( flogi->len * 4 ) - offsetof ( typeof ( *flogi ), fc ) );
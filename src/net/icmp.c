@@ -20,9 +20,11 @@ FILE_LICENCE ( GPL2_OR_LATER );
 
 #include <string.h>
 #include <errno.h>
+#include <byteswap.h>
 #include <ipxe/iobuf.h>
 #include <ipxe/in.h>
 #include <ipxe/tcpip.h>
+#include <ipxe/ip.h>
 #include <ipxe/icmp.h>
 
 /** @file
@@ -33,6 +35,94 @@ FILE_LICENCE ( GPL2_OR_LATER );
 
 struct tcpip_protocol icmp_protocol __tcpip_protocol;
 
+/** Path MTU plateaus (RFC 1191 section 7) */
+static const uint16_t icmp_mtu_plateaus[] = {
+	32000, 17914, 8166, 4352, 2002, 1492, 1006, 508, 296, 68
+};
+
+/**
+ * Estimate path MTU
+ *
+ * @v len		Length of oversized datagram
+ * @ret mtu		Estimated path MTU
+ *
+ * Routers predating RFC 1191 do not report the next-hop MTU.  The
+ * path MTU is then estimated as the largest plateau value smaller
+ * than the length of the datagram which could not be forwarded.
+ */
+static size_t icmp_mtu_plateau ( size_t len ) {
+	unsigned int i;
+
+	for ( i = 0 ; i < ( sizeof ( icmp_mtu_plateaus ) /
+			    sizeof ( icmp_mtu_plateaus[0] ) ) ; i++ ) {
+		if ( icmp_mtu_plateaus[i] < len )
+			return icmp_mtu_plateaus[i];
+	}
+	return 0;
+}
+
+/**
+ * Process a received "fragmentation needed" message
+ *
+ * @v iobuf		I/O buffer
+ * @ret rc		Return status code
+ *
+ * The message contains the IPv4 header and the first eight bytes of
+ * the payload of the datagram which could not be forwarded.
+ */
+static int icmp_rx_frag_needed ( struct io_buffer *iobuf ) {
+	struct icmp_frag_needed *frag = iobuf->data;
+	size_t len = iob_len ( iobuf );
+	struct iphdr *iphdr;
+	struct sockaddr_in sin_peer;
+	size_t hdrlen;
+	size_t mtu;
+	int rc;
+
+	/* Sanity check */
+	if ( len < ( sizeof ( *frag ) + sizeof ( *iphdr ) ) ) {
+		DBG ( "ICMP fragmentation needed too short at %zd bytes\n",
+		      len );
+		return -EINVAL;
+	}
+	iphdr = ( ( ( void * ) frag ) + sizeof ( *frag ) );
+	len -= sizeof ( *frag );
+	hdrlen = ( ( iphdr->verhdrlen & IP_MASK_HLEN ) * 4 );
+	if ( ( ( iphdr->verhdrlen & IP_MASK_VER ) != IP_VER ) ||
+	     ( hdrlen < sizeof ( *iphdr ) ) || ( hdrlen > len ) ) {
+		DBG ( "ICMP fragmentation needed has invalid IPv4 header\n" );
+		return -EINVAL;
+	}
+
+	/* Determine path MTU */
+	mtu = ntohs ( frag->mtu );
+	if ( ( mtu == 0 ) || ( mtu >= ntohs ( iphdr->len ) ) )
+		mtu = icmp_mtu_plateau ( ntohs ( iphdr->len ) );
+	if ( mtu < IPV4_PMTU_MIN )
+		mtu = IPV4_PMTU_MIN;
+	DBG ( "ICMP fragmentation needed for %s protocol %d (MTU %zd)\n",
+	      inet_ntoa ( iphdr->dest ), iphdr->protocol, mtu );
+
+	/* Notify transport-layer protocol */
+	memset ( &sin_peer, 0, sizeof ( sin_peer ) );
+	sin_peer.sin_family = AF_INET;
+	sin_peer.sin_addr = iphdr->dest;
+	if ( ( rc = tcpip_pmtu ( iphdr->protocol,
+				 ( ( struct sockaddr_tcpip * ) &sin_peer ),
+				 ( ( ( void * ) iphdr ) + hdrlen ),
+				 ( len - hdrlen ),
+				 ( mtu - sizeof ( *iphdr ) ) ) ) != 0 ) {
+		DBG ( "ICMP ignoring fragmentation needed: %s\n",
+		      strerror ( rc ) );
+		return rc;
+	}
+
+	/* Record path MTU */
+	ipv4_pmtu_update ( iphdr->dest, mtu );
+
+	return 0;
+}
+
 /**
  * Process a received packet
  *
@@ -68,7 +158,14 @@ static int icmp_rx ( struct io_buffer *iobuf, struct sockaddr_tcpip *st_src,
 		goto done;
 	}
 
-	/* We respond only to pings */
+	/* Handle path MTU discovery reports */
+	if ( ( icmp->type == ICMP_DESTINATION_UNREACHABLE ) &&
+	     ( icmp->code == ICMP_FRAGMENTATION_NEEDED ) ) {
+		rc = icmp_rx_frag_needed ( iobuf );
+		goto done;
+	}
+
+	/* We otherwise respond only to pings */
 	if ( icmp->type != ICMP_ECHO_REQUEST ) {
 		DBG ( "ICMP ignoring type %d\n", icmp->type );
 		rc = 0;
@@ -33,6 +33,81 @@ FILE_LICENCE ( GPL2_OR_LATER );
  *
  */
 
+/** Number of multicast group cache entries */
+#define IB_NUM_CACHED_MCAST 4
+
+/** A cached multicast group
+ *
+ * The queue key of a multicast group is a property of the group
+ * itself, and so remains valid after we leave the group.  Caching it
+ * allows a subsequent join (e.g. when an IPoIB device is reopened) to
+ * start using the group immediately, without waiting for the subnet
+ * administrator to respond.
+ */
+struct ib_cached_mcast {
+	/** Port GID */
+	union ib_gid port_gid;
+	/** Multicast GID */
+	union ib_gid gid;
+	/** Queue key (or zero if entry is unused) */
+	unsigned long qkey;
+};
+
+/** Multicast group cache */
+static struct ib_cached_mcast ib_mcast_cache[IB_NUM_CACHED_MCAST];
+
+/** Oldest multicast group cache entry index */
+static unsigned int ib_mcast_cache_idx;
+
+/**
+ * Find multicast group cache entry
+ *
+ * @v ibdev		Infiniband device
+ * @v gid		Multicast GID
+ * @ret cached		Multicast group cache entry, or NULL
+ */
+static struct ib_cached_mcast *
+ib_mcast_find_cached ( struct ib_device *ibdev, union ib_gid *gid ) {
+	struct ib_cached_mcast *cached;
+	unsigned int i;
+
+	for ( i = 0 ; i < IB_NUM_CACHED_MCAST ; i++ ) {
+		cached = &ib_mcast_cache[i];
+		if ( ! cached->qkey )
+			continue;
+		if ( memcmp ( &cached->port_gid, &ibdev->gid,
+			      sizeof ( cached->port_gid ) ) != 0 )
+			continue;
+		if ( memcmp ( &cached->gid, gid, sizeof ( cached->gid ) ) != 0 )
+			continue;
+		return cached;
+	}
+	return NULL;
+}
+
+/**
+ * Record multicast group in cache
+ *
+ * @v ibdev		Infiniband device
+ * @v gid		Multicast GID
+ * @v qkey		Queue key
+ */
+static void ib_mcast_cache_qkey ( struct ib_device *ibdev, union ib_gid *gid,
+				  unsigned long qkey ) {
+	struct ib_cached_mcast *cached;
+
+	/* Reuse existing entry, or replace oldest entry */
+	cached = ib_mcast_find_cached ( ibdev, gid );
+	if ( ! cached ) {
+		cached = &ib_mcast_cache[ ( ib_mcast_cache_idx++ ) %
+					  IB_NUM_CACHED_MCAST ];
+		memcpy ( &cached->port_gid, &ibdev->gid,
+			 sizeof ( cached->port_gid ) );
+		memcpy ( &cached->gid, gid, sizeof ( cached->gid ) );
+	}
+	cached->qkey = qkey;
+}
+
 /**
  * Generate multicast membership MAD
  *
@@ -101,6 +176,10 @@ static void ib_mcast_complete ( struct ib_device *ibdev,
 	       ibdev, qp->qpn, ( joined ? "joined" : "left" ),
 	       IB_GID_ARGS ( gid ), qkey );
 
+	/* Record queue key for use by subsequent joins */
+	if ( joined && qkey )
+		ib_mcast_cache_qkey ( ibdev, gid, qkey );
+
 	/* Set queue key */
 	qp->qkey = qkey;
 	if ( ( rc = ib_modify_qp ( ibdev, qp ) ) != 0 ) {
@@ -132,6 +211,13 @@ static struct ib_mad_transaction_operations ib_mcast_op = {
  * @v gid		Multicast GID to join
  * @v joined		Join completion handler
  * @ret rc		Return status code
+ *
+ * If the group's queue key is already known from a previous join,
+ * then the queue pair will start using it immediately, and the
+ * completion handler will be called (with no response MAD) before
+ * this function returns.  The join request is still sent to the
+ * subnet administrator, and the completion handler will be called
+ * again when the response arrives.
  */
 int ib_mcast_join ( struct ib_device *ibdev, struct ib_queue_pair *qp,
 		    struct ib_mc_membership *membership, union ib_gid *gid,
@@ -139,6 +225,7 @@ int ib_mcast_join ( struct ib_device *ibdev, struct ib_queue_pair *qp,
 					  struct ib_queue_pair *qp,
 					  struct ib_mc_membership *membership,
 					  int rc, union ib_mad *mad ) ) {
+	struct ib_cached_mcast *cached;
 	union ib_mad mad;
 	int rc;
 
@@ -169,9 +256,25 @@ int ib_mcast_join ( struct ib_device *ibdev, struct ib_queue_pair *qp,
 	}
 	ib_madx_set_ownerdata ( membership->madx, membership );
 
+	/* Use cached queue key, if available */
+	cached = ib_mcast_find_cached ( ibdev, gid );
+	if ( cached ) {
+		DBGC ( ibdev, "IBDEV %p QPN %lx using cached qkey %lx\n",
+		       ibdev, qp->qpn, cached->qkey );
+		qp->qkey = cached->qkey;
+		if ( ( rc = ib_modify_qp ( ibdev, qp ) ) != 0 ) {
+			DBGC ( ibdev, "IBDEV %p QPN %lx could not modify "
+			       "qkey: %s\n", ibdev, qp->qpn, strerror ( rc ) );
+			goto err_modify_qp;
+		}
+		membership->complete ( ibdev, qp, membership, 0, NULL );
+	}
+
 	return 0;
 
+ err_modify_qp:
 	ib_destroy_madx ( ibdev, ibdev->gsi, membership->madx );
+	membership->madx = NULL;
  err_create_madx:
 	ib_mcast_detach ( ibdev, qp, gid );
  err_mcast_attach:
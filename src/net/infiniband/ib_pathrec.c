@@ -26,6 +26,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/infiniband.h>
 #include <ipxe/ib_mi.h>
 #include <ipxe/ib_pathrec.h>
+#include <config/general.h>
 
 /** @file
  *
@@ -149,23 +150,40 @@ void ib_destroy_path ( struct ib_device *ibdev, struct ib_path *path ) {
 	free ( path );
 }
 
-/** Number of path cache entries
- *
- * Must be a power of two.
- */
-#define IB_NUM_CACHED_PATHS 4
-
 /** A cached path */
 struct ib_cached_path {
+	/** Next cached path in hash chain */
+	struct ib_cached_path *next;
+	/** Time of last use */
+	unsigned long used;
 	/** Path */
 	struct ib_path *path;
 };
 
 /** Path cache */
-static struct ib_cached_path ib_path_cache[IB_NUM_CACHED_PATHS];
+static struct ib_cached_path ib_path_cache[IB_PATH_CACHE];
+
+/** Path cache hash chains */
+static struct ib_cached_path *ib_path_hash[IB_PATH_CACHE];
+
+/** Path cache usage counter */
+static unsigned long ib_path_cache_used;
 
-/** Oldest path cache entry index */
-static unsigned int ib_path_cache_idx;
+/**
+ * Calculate hash chain for destination GID
+ *
+ * @v dgid		Destination GID
+ * @ret chain		Hash chain
+ */
+static struct ib_cached_path ** ib_path_chain ( union ib_gid *dgid ) {
+	uint32_t hash;
+
+	hash = ( dgid->dwords[0] ^ dgid->dwords[1] ^
+		 dgid->dwords[2] ^ dgid->dwords[3] );
+	hash ^= ( hash >> 16 );
+	hash ^= ( hash >> 8 );
+	return &ib_path_hash[ hash % IB_PATH_CACHE ];
+}
 
 /**
  * Find path cache entry
@@ -177,23 +195,68 @@ static unsigned int ib_path_cache_idx;
 static struct ib_cached_path *
 ib_find_path_cache_entry ( struct ib_device *ibdev, union ib_gid *dgid ) {
 	struct ib_cached_path *cached;
-	unsigned int i;
 
-	for ( i = 0 ; i < IB_NUM_CACHED_PATHS ; i++ ) {
-		cached = &ib_path_cache[i];
-		if ( ! cached->path )
-			continue;
+	for ( cached = *ib_path_chain ( dgid ) ; cached ;
+	      cached = cached->next ) {
 		if ( cached->path->ibdev != ibdev )
 			continue;
 		if ( memcmp ( &cached->path->av.gid, dgid,
 			      sizeof ( cached->path->av.gid ) ) != 0 )
 			continue;
+		cached->used = ++ib_path_cache_used;
 		return cached;
 	}
 
 	return NULL;
 }
 
+/**
+ * Erase path cache entry
+ *
+ * @v ibdev		Infiniband device
+ * @v cached		Path cache entry
+ */
+static void ib_erase_path_cache_entry ( struct ib_device *ibdev,
+					struct ib_cached_path *cached ) {
+	struct ib_cached_path **chain;
+
+	/* Remove from hash chain */
+	for ( chain = ib_path_chain ( &cached->path->av.gid ) ;
+	      *chain != cached ; chain = &(*chain)->next ) {}
+	*chain = cached->next;
+
+	/* Destroy path */
+	ib_destroy_path ( ibdev, cached->path );
+	memset ( cached, 0, sizeof ( *cached ) );
+}
+
+/**
+ * Evict least recently used path cache entry
+ *
+ * @ret cached		Unused path cache entry
+ */
+static struct ib_cached_path * ib_evict_path_cache_entry ( void ) {
+	struct ib_cached_path *oldest = NULL;
+	struct ib_cached_path *cached;
+	unsigned int i;
+
+	/* Find an unused entry, or the least recently used entry */
+	for ( i = 0 ; i < IB_PATH_CACHE ; i++ ) {
+		cached = &ib_path_cache[i];
+		if ( ! cached->path )
+			return cached;
+		if ( ( ! oldest ) ||
+		     ( ( ib_path_cache_used - cached->used ) >
+		       ( ib_path_cache_used - oldest->used ) ) )
+			oldest = cached;
+	}
+
+	/* Destroy the old cache entry */
+	ib_erase_path_cache_entry ( oldest->path->ibdev, oldest );
+
+	return oldest;
+}
+
 /**
  * Handle cached path transaction completion
  *
@@ -209,9 +272,7 @@ static void ib_cached_path_complete ( struct ib_device *ibdev,
 
 	/* If the transaction failed, erase the cache entry */
 	if ( rc != 0 ) {
-		/* Destroy the old cache entry */
-		ib_destroy_path ( ibdev, path );
-		memset ( cached, 0, sizeof ( *cached ) );
+		ib_erase_path_cache_entry ( ibdev, cached );
 		return;
 	}
 
@@ -237,8 +298,8 @@ static struct ib_path_operations ib_cached_path_op = {
  */
 int ib_resolve_path ( struct ib_device *ibdev, struct ib_address_vector *av ) {
 	union ib_gid *gid = &av->gid;
+	struct ib_cached_path **chain;
 	struct ib_cached_path *cached;
-	unsigned int cache_idx;
 
 	/* Sanity check */
 	if ( ! av->gid_present ) {
@@ -266,13 +327,7 @@ int ib_resolve_path ( struct ib_device *ibdev, struct ib_address_vector *av ) {
 		return -ENOENT;
 
 	/* Locate a new cache entry to use */
-	cache_idx = ( (ib_path_cache_idx++) % IB_NUM_CACHED_PATHS );
-	cached = &ib_path_cache[cache_idx];
-
-	/* Destroy the old cache entry */
-	if ( cached->path )
-		ib_destroy_path ( ibdev, cached->path );
-	memset ( cached, 0, sizeof ( *cached ) );
+	cached = ib_evict_path_cache_entry();
 
 	/* Create new path */
 	cached->path = ib_create_path ( ibdev, av, &ib_cached_path_op );
@@ -282,6 +337,10 @@ int ib_resolve_path ( struct ib_device *ibdev, struct ib_address_vector *av ) {
 		return -ENOMEM;
 	}
 	ib_path_set_ownerdata ( cached->path, cached );
+	cached->used = ++ib_path_cache_used;
+	chain = ib_path_chain ( gid );
+	cached->next = *chain;
+	*chain = cached;
 
 	/* Not found yet */
 	return -ENOENT;
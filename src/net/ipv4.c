@@ -15,6 +15,7 @@
 #include <ipxe/dhcp.h>
 #include <ipxe/settings.h>
 #include <ipxe/timer.h>
+#include <ipxe/netstat.h>
 
 /** @file
  *
@@ -33,6 +34,49 @@ struct list_head ipv4_miniroutes = LIST_HEAD_INIT ( ipv4_miniroutes );
 /** List of fragment reassembly buffers */
 static LIST_HEAD ( ipv4_fragments );
 
+/** IPv4 statistics */
+struct ipv4_statistics {
+	/** Number of received packets with invalid headers */
+	unsigned int header_errors;
+	/** Number of received packets with incorrect header checksums */
+	unsigned int checksum_errors;
+	/** Number of fragments received */
+	unsigned int fragments;
+	/** Number of datagrams successfully reassembled */
+	unsigned int reassembled;
+	/** Number of fragments dropped or expired before reassembly */
+	unsigned int fragment_errors;
+	/** Number of packets not transmitted due to lack of a route */
+	unsigned int no_route;
+	/** Number of path MTU reductions recorded */
+	unsigned int pmtu_updates;
+};
+
+/** IPv4 statistics */
+static struct ipv4_statistics ipv4_stats;
+
+/** A cached IPv4 route */
+struct ipv4_route_cache {
+	/** Final destination address */
+	struct in_addr dest;
+	/** Next hop destination address */
+	struct in_addr next_hop;
+	/** Routing table entry, or NULL if cache is empty */
+	struct ipv4_miniroute *miniroute;
+};
+
+/** Most recently used IPv4 route
+ *
+ * Consecutive packets almost always go to the same destination, so
+ * the result of the most recent lookup is retained.  The cache is
+ * emptied whenever the routing table or the state of any network
+ * device changes.
+ */
+static struct ipv4_route_cache ipv4_route_cache;
+
+/** Cached path MTUs */
+static struct ipv4_pmtu ipv4_pmtus[IPV4_PMTU_CACHE_SIZE];
+
 /** Fragment reassembly timeout */
 #define IP_FRAG_TIMEOUT ( TICKS_PER_SEC / 2 )
 
@@ -49,6 +93,7 @@ static struct ipv4_miniroute * __malloc
 add_ipv4_miniroute ( struct net_device *netdev, struct in_addr address,
 		     struct in_addr netmask, struct in_addr gateway ) {
 	struct ipv4_miniroute *miniroute;
+	struct ipv4_miniroute *pos;
 
 	DBGC ( netdev, "IPv4 add %s", inet_ntoa ( address ) );
 	DBGC ( netdev, "/%s ", inet_ntoa ( netmask ) );
@@ -69,14 +114,23 @@ add_ipv4_miniroute ( struct net_device *netdev, struct in_addr address,
 	miniroute->netmask = netmask;
 	miniroute->gateway = gateway;
 		
-	/* Add to end of list if we have a gateway, otherwise
-	 * to start of list.
+	/* Keep list sorted by decreasing netmask length, so that the
+	 * first matching entry is the longest prefix match.  Among
+	 * entries with equal netmasks, place those with a gateway
+	 * last.
 	 */
-	if ( gateway.s_addr ) {
-		list_add_tail ( &miniroute->list, &ipv4_miniroutes );
-	} else {
-		list_add ( &miniroute->list, &ipv4_miniroutes );
+	list_for_each_entry ( pos, &ipv4_miniroutes, list ) {
+		if ( ntohl ( netmask.s_addr ) >
+		     ntohl ( pos->netmask.s_addr ) )
+			break;
+		if ( ( netmask.s_addr == pos->netmask.s_addr ) &&
+		     ( pos->gateway.s_addr && ! gateway.s_addr ) )
+			break;
 	}
+	list_add_tail ( &miniroute->list, &pos->list );
+
+	/* Invalidate route cache */
+	ipv4_route_cache.miniroute = NULL;
 
 	return miniroute;
 }
@@ -98,6 +152,9 @@ static void del_ipv4_miniroute ( struct ipv4_miniroute *miniroute ) {
 	netdev_put ( miniroute->netdev );
 	list_del ( &miniroute->list );
 	free ( miniroute );
+
+	/* Invalidate route cache */
+	ipv4_route_cache.miniroute = NULL;
 }
 
 /**
@@ -109,29 +166,178 @@ static void del_ipv4_miniroute ( struct ipv4_miniroute *miniroute ) {
  *
  * If the route requires use of a gateway, the next hop destination
  * address will be overwritten with the gateway address.
+ *
+ * A directly attached subnet is always preferred; if several match,
+ * the one with the longest netmask is used.  Otherwise, the first
+ * usable route with a gateway is used.
  */
 static struct ipv4_miniroute * ipv4_route ( struct in_addr *dest ) {
+	struct ipv4_route_cache *cache = &ipv4_route_cache;
 	struct ipv4_miniroute *miniroute;
+	struct ipv4_miniroute *gw_miniroute = NULL;
+	struct in_addr final = *dest;
 	int local;
-	int has_gw;
 
-	/* Find first usable route in routing table */
+	/* Use cached route if applicable */
+	if ( cache->miniroute && ( cache->dest.s_addr == dest->s_addr ) ) {
+		*dest = cache->next_hop;
+		return cache->miniroute;
+	}
+
+	/* Find longest matching directly attached subnet, or first
+	 * usable gateway.  The list is sorted by decreasing netmask
+	 * length.
+	 */
 	list_for_each_entry ( miniroute, &ipv4_miniroutes, list ) {
 		if ( ! netdev_is_open ( miniroute->netdev ) )
 			continue;
 		local = ( ( ( dest->s_addr ^ miniroute->address.s_addr )
 			    & miniroute->netmask.s_addr ) == 0 );
-		has_gw = ( miniroute->gateway.s_addr );
-		if ( local || has_gw ) {
-			if ( ! local )
-				*dest = miniroute->gateway;
-			return miniroute;
-		}
+		if ( local )
+			goto found;
+		if ( miniroute->gateway.s_addr && ( ! gw_miniroute ) )
+			gw_miniroute = miniroute;
 	}
+	if ( ! gw_miniroute )
+		return NULL;
+	miniroute = gw_miniroute;
+	*dest = miniroute->gateway;
+
+ found:
+	/* Record in cache */
+	cache->dest = final;
+	cache->next_hop = *dest;
+	cache->miniroute = miniroute;
+	return miniroute;
+}
 
+/**
+ * Determine transmitting network device
+ *
+ * @v st_dest		Destination network-layer address
+ * @ret netdev		Transmitting network device, or NULL
+ */
+static struct net_device * ipv4_netdev ( struct sockaddr_tcpip *st_dest ) {
+	struct sockaddr_in *sin_dest = ( ( struct sockaddr_in * ) st_dest );
+	struct in_addr dest = sin_dest->sin_addr;
+	struct ipv4_miniroute *miniroute;
+
+	/* Broadcasts and multicasts are not routed */
+	if ( ( dest.s_addr == INADDR_BROADCAST ) ||
+	     IN_MULTICAST ( ntohl ( dest.s_addr ) ) )
+		return NULL;
+
+	/* Find routing table entry */
+	miniroute = ipv4_route ( &dest );
+	if ( ! miniroute )
+		return NULL;
+
+	return miniroute->netdev;
+}
+
+/**
+ * Find cached IPv4 path MTU
+ *
+ * @v dest		Destination address
+ * @ret pmtu		Cached path MTU, or NULL
+ *
+ * Expired entries are discarded.
+ */
+static struct ipv4_pmtu * ipv4_pmtu_find ( struct in_addr dest ) {
+	struct ipv4_pmtu *pmtu;
+	unsigned int i;
+
+	for ( i = 0 ; i < IPV4_PMTU_CACHE_SIZE ; i++ ) {
+		pmtu = &ipv4_pmtus[i];
+		if ( ( ! pmtu->dest.s_addr ) ||
+		     ( pmtu->dest.s_addr != dest.s_addr ) )
+			continue;
+		if ( ( currticks() - pmtu->recorded ) >= IPV4_PMTU_TIMEOUT ) {
+			DBGC ( pmtu, "IPv4 path MTU to %s expired\n",
+			       inet_ntoa ( dest ) );
+			pmtu->dest.s_addr = 0;
+			return NULL;
+		}
+		return pmtu;
+	}
 	return NULL;
 }
 
+/**
+ * Record IPv4 path MTU
+ *
+ * @v dest		Destination address
+ * @v mtu		Path MTU
+ *
+ * The path MTU will be recorded only if it is smaller than any path
+ * MTU already recorded for this destination.  The least recently
+ * recorded entry will be replaced if the cache is full.
+ */
+void ipv4_pmtu_update ( struct in_addr dest, size_t mtu ) {
+	struct ipv4_pmtu *pmtu;
+	unsigned long now = currticks();
+	unsigned int i;
+
+	/* Use existing entry, if any */
+	pmtu = ipv4_pmtu_find ( dest );
+	if ( pmtu && ( pmtu->mtu <= mtu ) )
+		return;
+
+	/* Otherwise, use an empty or the oldest entry */
+	if ( ! pmtu ) {
+		pmtu = &ipv4_pmtus[0];
+		for ( i = 0 ; i < IPV4_PMTU_CACHE_SIZE ; i++ ) {
+			if ( ! ipv4_pmtus[i].dest.s_addr ) {
+				pmtu = &ipv4_pmtus[i];
+				break;
+			}
+			if ( ( now - ipv4_pmtus[i].recorded ) >
+			     ( now - pmtu->recorded ) )
+				pmtu = &ipv4_pmtus[i];
+		}
+	}
+
+	/* Record path MTU */
+	DBGC ( pmtu, "IPv4 path MTU to %s is %zd\n", inet_ntoa ( dest ), mtu );
+	pmtu->dest = dest;
+	pmtu->mtu = mtu;
+	pmtu->recorded = now;
+	ipv4_stats.pmtu_updates++;
+}
+
+/**
+ * Determine path MTU
+ *
+ * @v st_dest		Destination address
+ * @ret mtu		Path MTU, or zero if not known
+ */
+static size_t ipv4_pmtu ( struct sockaddr_tcpip *st_dest ) {
+	struct sockaddr_in *sin_dest = ( ( struct sockaddr_in * ) st_dest );
+	struct ipv4_pmtu *pmtu;
+
+	pmtu = ipv4_pmtu_find ( sin_dest->sin_addr );
+	return ( pmtu ? pmtu->mtu : 0 );
+}
+
+/**
+ * Free fragment reassembly buffer
+ *
+ * @v frag		Fragment reassembly buffer
+ */
+static void ipv4_fragment_free ( struct ipv4_fragment *frag ) {
+	struct ipv4_fragment_hole *hole;
+	struct ipv4_fragment_hole *tmp;
+
+	stop_timer ( &frag->timer );
+	list_for_each_entry_safe ( hole, tmp, &frag->holes, list ) {
+		list_del ( &hole->list );
+		free ( hole );
+	}
+	free_iob ( frag->iobuf );
+	list_del ( &frag->list );
+	free ( frag );
+}
+
 /**
  * Expire fragment reassembly buffer
  *
@@ -142,13 +348,11 @@ static void ipv4_fragment_expired ( struct retry_timer *timer,
 				    int fail __unused ) {
 	struct ipv4_fragment *frag =
 		container_of ( timer, struct ipv4_fragment, timer );
-	struct iphdr *iphdr = frag->iobuf->data;
 
-	DBGC ( iphdr->src, "IPv4 fragment %04x expired\n",
-	       ntohs ( iphdr->ident ) );
-	free_iob ( frag->iobuf );
-	list_del ( &frag->list );
-	free ( frag );
+	DBGC ( frag->src, "IPv4 fragment %04x expired\n",
+	       ntohs ( frag->ident ) );
+	ipv4_stats.fragment_errors++;
+	ipv4_fragment_free ( frag );
 }
 
 /**
@@ -159,13 +363,12 @@ static void ipv4_fragment_expired ( struct retry_timer *timer,
  */
 static struct ipv4_fragment * ipv4_fragment ( struct iphdr *iphdr ) {
 	struct ipv4_fragment *frag;
-	struct iphdr *frag_iphdr;
 
 	list_for_each_entry ( frag, &ipv4_fragments, list ) {
-		frag_iphdr = frag->iobuf->data;
-
-		if ( ( iphdr->src.s_addr == frag_iphdr->src.s_addr ) &&
-		     ( iphdr->ident == frag_iphdr->ident ) ) {
+		if ( ( iphdr->src.s_addr == frag->src.s_addr ) &&
+		     ( iphdr->dest.s_addr == frag->dest.s_addr ) &&
+		     ( iphdr->ident == frag->ident ) &&
+		     ( iphdr->protocol == frag->protocol ) ) {
 			return frag;
 		}
 	}
@@ -173,79 +376,222 @@ static struct ipv4_fragment * ipv4_fragment ( struct iphdr *iphdr ) {
 	return NULL;
 }
 
+/**
+ * Create fragment reassembly buffer
+ *
+ * @v iphdr		IPv4 header
+ * @ret frag		Fragment reassembly buffer, or NULL
+ *
+ * The new reassembly buffer initially has a single hole covering the
+ * whole of the (as yet unknown length) payload.
+ */
+static struct ipv4_fragment * ipv4_fragment_create ( struct iphdr *iphdr ) {
+	struct ipv4_fragment *frag;
+	struct ipv4_fragment_hole *hole;
+
+	/* Allocate and initialise structure */
+	frag = zalloc ( sizeof ( *frag ) );
+	if ( ! frag )
+		return NULL;
+	hole = malloc ( sizeof ( *hole ) );
+	if ( ! hole ) {
+		free ( frag );
+		return NULL;
+	}
+	frag->src = iphdr->src;
+	frag->dest = iphdr->dest;
+	frag->ident = iphdr->ident;
+	frag->protocol = iphdr->protocol;
+	INIT_LIST_HEAD ( &frag->holes );
+	hole->start = 0;
+	hole->end = IP_MAX_LEN;
+	list_add ( &hole->list, &frag->holes );
+	timer_init ( &frag->timer, ipv4_fragment_expired, NULL );
+	start_timer_fixed ( &frag->timer, IP_FRAG_TIMEOUT );
+	list_add ( &frag->list, &ipv4_fragments );
+
+	return frag;
+}
+
+/**
+ * Ensure fragment reassembly buffer covers a given payload length
+ *
+ * @v frag		Fragment reassembly buffer
+ * @v end		Required payload length
+ * @ret rc		Return status code
+ *
+ * If the final length of the payload is not yet known, the buffer is
+ * grown geometrically, so that the total amount of copying remains
+ * linear in the length of the datagram.
+ */
+static int ipv4_fragment_extend ( struct ipv4_fragment *frag, size_t end ) {
+	struct io_buffer *iobuf = frag->iobuf;
+	struct io_buffer *new_iobuf;
+	size_t len = ( iobuf ? iob_len ( iobuf ) : 0 );
+	size_t capacity;
+
+	/* Do nothing if buffer is already long enough */
+	if ( end <= len )
+		return 0;
+
+	/* Use existing tailroom, if possible */
+	if ( iobuf && ( ( end - len ) <= iob_tailroom ( iobuf ) ) ) {
+		iob_put ( iobuf, ( end - len ) );
+		return 0;
+	}
+
+	/* Allocate new buffer */
+	capacity = ( frag->len ? frag->len : ( 2 * len ) );
+	if ( capacity < end )
+		capacity = end;
+	if ( capacity > IP_MAX_LEN )
+		capacity = IP_MAX_LEN;
+	new_iobuf = alloc_iob ( IP_MAX_HLEN + capacity );
+	if ( ! new_iobuf ) {
+		DBGC ( frag->src, "IPv4 could not extend reassembly buffer "
+		       "to %zd bytes\n", capacity );
+		return -ENOMEM;
+	}
+	iob_reserve ( new_iobuf, IP_MAX_HLEN );
+
+	/* Copy header (if any) and existing payload */
+	if ( iobuf ) {
+		memcpy ( ( new_iobuf->data - frag->hdrlen ),
+			 ( iobuf->data - frag->hdrlen ),
+			 ( frag->hdrlen + len ) );
+		free_iob ( iobuf );
+	}
+	iob_put ( new_iobuf, end );
+	frag->iobuf = new_iobuf;
+
+	return 0;
+}
+
+/**
+ * Fill holes in fragment reassembly buffer
+ *
+ * @v frag		Fragment reassembly buffer
+ * @v start		Start offset of fragment within payload
+ * @v end		End offset of fragment within payload
+ * @v more_frags	More fragments follow this fragment
+ * @ret rc		Return status code
+ *
+ * This is the hole descriptor update algorithm from RFC 815.  If a
+ * hole cannot be split for lack of memory, it is left unfilled.
+ */
+static int ipv4_fragment_fill ( struct ipv4_fragment *frag, size_t start,
+				size_t end, int more_frags ) {
+	struct ipv4_fragment_hole *hole;
+	struct ipv4_fragment_hole *tmp;
+	struct ipv4_fragment_hole *right;
+
+	list_for_each_entry_safe ( hole, tmp, &frag->holes, list ) {
+
+		/* Skip holes not overlapped by this fragment, unless
+		 * this is the final fragment and the hole lies beyond
+		 * the end of the datagram.
+		 */
+		if ( ( start >= hole->end ) ||
+		     ( ( end <= hole->start ) && more_frags ) )
+			continue;
+
+		/* Split off any part of the hole following the
+		 * fragment (unless this is the final fragment).
+		 */
+		if ( ( end < hole->end ) && more_frags ) {
+			if ( start > hole->start ) {
+				right = malloc ( sizeof ( *right ) );
+				if ( ! right )
+					return -ENOMEM;
+				right->start = end;
+				right->end = hole->end;
+				list_add ( &right->list, &hole->list );
+				hole->end = start;
+			} else {
+				hole->start = end;
+			}
+			continue;
+		}
+
+		/* Retain any part of the hole preceding the fragment */
+		if ( start > hole->start ) {
+			hole->end = start;
+			continue;
+		}
+
+		/* Hole is completely filled */
+		list_del ( &hole->list );
+		free ( hole );
+	}
+
+	return 0;
+}
+
 /**
  * Fragment reassembler
  *
  * @v iobuf		I/O buffer
  * @ret iobuf		Reassembled packet, or NULL
+ *
+ * Fragments may arrive in any order, and may overlap.  Each fragment
+ * is copied directly into place within a single reassembly buffer per
+ * datagram, and the remaining holes are tracked as described in RFC
+ * 815.
  */
 static struct io_buffer * ipv4_reassemble ( struct io_buffer *iobuf ) {
 	struct iphdr *iphdr = iobuf->data;
 	size_t offset = ( ( ntohs ( iphdr->frags ) & IP_MASK_OFFSET ) << 3 );
 	unsigned int more_frags = ( iphdr->frags & htons ( IP_MASK_MOREFRAGS ));
 	size_t hdrlen = ( ( iphdr->verhdrlen & IP_MASK_HLEN ) * 4 );
+	size_t len = ( iob_len ( iobuf ) - hdrlen );
+	size_t end = ( offset + len );
 	struct ipv4_fragment *frag;
-	size_t expected_offset;
-	struct io_buffer *new_iobuf;
+	struct io_buffer *reassembled;
 
-	/* Find matching fragment reassembly buffer, if any */
+	/* Find or create matching fragment reassembly buffer */
 	frag = ipv4_fragment ( iphdr );
+	if ( ! frag ) {
+		frag = ipv4_fragment_create ( iphdr );
+		if ( ! frag )
+			goto drop;
+	}
 
-	/* Drop out-of-order fragments */
-	expected_offset = ( frag ? frag->offset : 0 );
-	if ( offset != expected_offset ) {
-		DBGC ( iphdr->src, "IPv4 dropping out-of-sequence fragment "
-		       "%04x (%zd+%zd, expected %zd)\n",
-		       ntohs ( iphdr->ident ), offset,
-		      ( iob_len ( iobuf ) - hdrlen ), expected_offset );
+	/* Drop fragments extending beyond the end of the datagram */
+	if ( ( end > ( IP_MAX_LEN - hdrlen ) ) ||
+	     ( frag->len && ( end > frag->len ) ) ||
+	     ( ( ! more_frags ) && frag->iobuf &&
+	       ( end < iob_len ( frag->iobuf ) ) ) ) {
+		DBGC ( iphdr->src, "IPv4 dropping inconsistent fragment "
+		       "%04x (%zd+%zd)\n", ntohs ( iphdr->ident ), offset,
+		       len );
 		goto drop;
 	}
+	if ( ! more_frags )
+		frag->len = end;
 
-	/* Create or extend fragment reassembly buffer as applicable */
-	if ( frag == NULL ) {
-
-		/* Create new fragment reassembly buffer */
-		frag = zalloc ( sizeof ( *frag ) );
-		if ( ! frag )
-			goto drop;
-		list_add ( &frag->list, &ipv4_fragments );
-		frag->iobuf = iobuf;
-		frag->offset = ( iob_len ( iobuf ) - hdrlen );
-		timer_init ( &frag->timer, ipv4_fragment_expired, NULL );
-
-	} else {
+	/* Copy fragment into place */
+	if ( ipv4_fragment_extend ( frag, end ) != 0 )
+		goto drop;
+	memcpy ( ( frag->iobuf->data + offset ), ( iobuf->data + hdrlen ),
+		 len );
+	if ( offset == 0 ) {
+		frag->hdrlen = hdrlen;
+		memcpy ( ( frag->iobuf->data - hdrlen ), iphdr, hdrlen );
+	}
+	ipv4_fragment_fill ( frag, offset, end, more_frags );
+	free_iob ( iobuf );
 
-		/* Extend reassembly buffer */
-		iob_pull ( iobuf, hdrlen );
-		new_iobuf = alloc_iob ( iob_len ( frag->iobuf ) +
-					iob_len ( iobuf ) );
-		if ( ! new_iobuf ) {
-			DBGC ( iphdr->src, "IPv4 could not extend reassembly "
-			       "buffer to %zd bytes\n",
-			       iob_len ( frag->iobuf ) + iob_len ( iobuf ) );
-			goto drop;
-		}
-		memcpy ( iob_put ( new_iobuf, iob_len ( frag->iobuf ) ),
-			 frag->iobuf->data, iob_len ( frag->iobuf ) );
-		memcpy ( iob_put ( new_iobuf, iob_len ( iobuf ) ),
-			 iobuf->data, iob_len ( iobuf ) );
-		free_iob ( frag->iobuf );
-		frag->iobuf = new_iobuf;
-		frag->offset += iob_len ( iobuf );
-		free_iob ( iobuf );
-		iphdr = frag->iobuf->data;
-		iphdr->len = ntohs ( iob_len ( frag->iobuf ) );
-
-		/* Stop fragment reassembly timer */
-		stop_timer ( &frag->timer );
-
-		/* If this is the final fragment, return it */
-		if ( ! more_frags ) {
-			iobuf = frag->iobuf;
-			list_del ( &frag->list );
-			free ( frag );
-			return iobuf;
-		}
+	/* If all holes are filled, return the reassembled packet */
+	if ( list_empty ( &frag->holes ) ) {
+		reassembled = frag->iobuf;
+		frag->iobuf = NULL;
+		iob_push ( reassembled, frag->hdrlen );
+		iphdr = reassembled->data;
+		iphdr->len = htons ( iob_len ( reassembled ) );
+		iphdr->frags &= ~htons ( IP_MASK_OFFSET | IP_MASK_MOREFRAGS );
+		ipv4_fragment_free ( frag );
+		ipv4_stats.reassembled++;
+		return reassembled;
 	}
 
 	/* (Re)start fragment reassembly timer */
@@ -254,6 +600,7 @@ static struct io_buffer * ipv4_reassemble ( struct io_buffer *iobuf ) {
 	return NULL;
 
  drop:
+	ipv4_stats.fragment_errors++;
 	free_iob ( iobuf );
 	return NULL;
 }
@@ -275,7 +622,7 @@ static uint16_t ipv4_pshdr_chksum ( struct io_buffer *iobuf, uint16_t csum ) {
 	pshdr.dest = iphdr->dest;
 	pshdr.zero_padding = 0x00;
 	pshdr.protocol = iphdr->protocol;
-	pshdr.len = htons ( iob_len ( iobuf ) - hdrlen );
+	pshdr.len = htons ( iob_total_len ( iobuf ) - hdrlen );
 
 	/* Update the checksum value */
 	return tcpip_continue_chksum ( csum, &pshdr, sizeof ( pshdr ) );
@@ -304,6 +651,7 @@ static int ipv4_tx ( struct io_buffer *iobuf,
 	struct sockaddr_in *sin_src = ( ( struct sockaddr_in * ) st_src );
 	struct sockaddr_in *sin_dest = ( ( struct sockaddr_in * ) st_dest );
 	struct ipv4_miniroute *miniroute;
+	struct ipv4_pmtu *pmtu;
 	struct in_addr next_hop;
 	struct in_addr netmask = { .s_addr = 0 };
 	uint8_t ll_dest_buf[MAX_LL_ADDR_LEN];
@@ -314,11 +662,23 @@ static int ipv4_tx ( struct io_buffer *iobuf,
 	memset ( iphdr, 0, sizeof ( *iphdr ) );
 	iphdr->verhdrlen = ( IP_VER | ( sizeof ( *iphdr ) / 4 ) );
 	iphdr->service = IP_TOS;
-	iphdr->len = htons ( iob_len ( iobuf ) );	
+	iphdr->len = htons ( iob_total_len ( iobuf ) );
 	iphdr->ttl = IP_TTL;
 	iphdr->protocol = tcpip_protocol->tcpip_proto;
 	iphdr->dest = sin_dest->sin_addr;
 
+	/* Disallow fragmentation for protocols performing path MTU
+	 * discovery (RFC 1191), unless the path MTU has already been
+	 * reduced to the minimum that we will accept.  Any reported
+	 * path MTU below this minimum is clamped, and so a router on
+	 * such a path must be allowed to fragment our packets.
+	 */
+	pmtu = ipv4_pmtu_find ( iphdr->dest );
+	if ( tcpip_protocol->pmtu &&
+	     ! ( pmtu && ( pmtu->mtu <= IPV4_PMTU_MIN ) ) ) {
+		iphdr->frags = htons ( IP_MASK_DONOTFRAG );
+	}
+
 	/* Use routing table to identify next hop and transmitting netdev */
 	next_hop = iphdr->dest;
 	if ( sin_src )
@@ -333,6 +693,7 @@ static int ipv4_tx ( struct io_buffer *iobuf,
 	if ( ! netdev ) {
 		DBGC ( sin_dest->sin_addr, "IPv4 has no route to %s\n",
 		       inet_ntoa ( iphdr->dest ) );
+		ipv4_stats.no_route++;
 		rc = -ENETUNREACH;
 		goto err;
 	}
@@ -451,11 +812,11 @@ static int ipv4_has_addr ( struct net_device *netdev, struct in_addr addr ) {
  * This function expects an IP4 network datagram. It processes the headers 
  * and sends it to the transport layer.
  */
-static int ipv4_rx ( struct io_buffer *iobuf,
-		     struct net_device *netdev,
-		     const void *ll_dest __unused,
-		     const void *ll_source __unused,
-		     unsigned int flags ) {
+static int __hot ipv4_rx ( struct io_buffer *iobuf,
+			   struct net_device *netdev,
+			   const void *ll_dest __unused,
+			   const void *ll_source __unused,
+			   unsigned int flags ) {
 	struct iphdr *iphdr = iobuf->data;
 	size_t hdrlen;
 	size_t len;
@@ -492,7 +853,8 @@ static int ipv4_rx ( struct io_buffer *iobuf,
 	if ( ( csum = tcpip_chksum ( iphdr, hdrlen ) ) != 0 ) {
 		DBGC ( iphdr->src, "IPv4 checksum incorrect (is %04x "
 		       "including checksum field, should be 0000)\n", csum );
-		goto err;
+		ipv4_stats.checksum_errors++;
+		goto drop;
 	}
 	len = ntohs ( iphdr->len );
 	if ( len < hdrlen ) {
@@ -521,7 +883,7 @@ static int ipv4_rx ( struct io_buffer *iobuf,
 	     ( ! ipv4_has_addr ( netdev, iphdr->dest ) ) ) {
 		DBGC ( iphdr->src, "IPv4 discarding non-local unicast packet "
 		       "for %s\n", inet_ntoa ( iphdr->dest ) );
-		goto err;
+		goto drop;
 	}
 
 	/* Perform fragment reassembly if applicable */
@@ -529,6 +891,7 @@ static int ipv4_rx ( struct io_buffer *iobuf,
 		/* Pass the fragment to ipv4_reassemble() which returns
 		 * either a fully reassembled I/O buffer or NULL.
 		 */
+		ipv4_stats.fragments++;
 		iobuf = ipv4_reassemble ( iobuf );
 		if ( ! iobuf )
 			return 0;
@@ -557,10 +920,110 @@ static int ipv4_rx ( struct io_buffer *iobuf,
 	return 0;
 
  err:
+	ipv4_stats.header_errors++;
+ drop:
 	free_iob ( iobuf );
 	return -EINVAL;
 }
 
+/**
+ * Check whether received IPv4 packet is eligible for merging
+ *
+ * @v iobuf		I/O buffer
+ * @ret len		Length of IPv4 packet, or zero if not eligible
+ */
+static size_t ipv4_mergeable ( struct io_buffer *iobuf ) {
+	struct iphdr *iphdr = iobuf->data;
+	size_t len;
+
+	/* Accept only valid, unfragmented packets without options */
+	if ( iob_len ( iobuf ) < sizeof ( *iphdr ) )
+		return 0;
+	if ( iphdr->verhdrlen != ( IP_VER | ( sizeof ( *iphdr ) / 4 ) ) )
+		return 0;
+	if ( iphdr->frags & htons ( IP_MASK_OFFSET | IP_MASK_MOREFRAGS ) )
+		return 0;
+	if ( tcpip_chksum ( iphdr, sizeof ( *iphdr ) ) != 0 )
+		return 0;
+	len = ntohs ( iphdr->len );
+	if ( ( len <= sizeof ( *iphdr ) ) || ( len > iob_len ( iobuf ) ) )
+		return 0;
+
+	return len;
+}
+
+/**
+ * Merge received IPv4 packets
+ *
+ * @v iobuf		I/O buffer containing first packet
+ * @v next		I/O buffer containing following packet
+ * @v max_len		Maximum length of merged packet
+ * @ret rc		Return status code
+ */
+static int ipv4_merge ( struct io_buffer **iobuf, struct io_buffer *next,
+			size_t max_len ) {
+	struct iphdr *iphdr = (*iobuf)->data;
+	struct iphdr *next_iphdr = next->data;
+	uint16_t pshdr_csum;
+	uint16_t next_pshdr_csum;
+	size_t len;
+	size_t next_len;
+	size_t payload_len;
+	int hlen;
+	int rc;
+
+	/* Check that both packets are eligible and belong to the
+	 * same flow.
+	 */
+	len = ipv4_mergeable ( *iobuf );
+	next_len = ipv4_mergeable ( next );
+	if ( ! ( len && next_len ) )
+		return -ENOTSUP;
+	if ( ( iphdr->src.s_addr != next_iphdr->src.s_addr ) ||
+	     ( iphdr->dest.s_addr != next_iphdr->dest.s_addr ) ||
+	     ( iphdr->protocol != next_iphdr->protocol ) )
+		return -ENOTSUP;
+
+	/* Strip any link-layer padding, as ipv4_rx() would do */
+	iob_unput ( *iobuf, ( iob_len ( *iobuf ) - len ) );
+	iob_unput ( next, ( iob_len ( next ) - next_len ) );
+
+	/* Check that the transport layer is able to merge the
+	 * packets, and identify the start of the payload.
+	 */
+	pshdr_csum = ipv4_pshdr_chksum ( *iobuf, TCPIP_EMPTY_CSUM );
+	next_pshdr_csum = ipv4_pshdr_chksum ( next, TCPIP_EMPTY_CSUM );
+	iob_pull ( *iobuf, sizeof ( *iphdr ) );
+	iob_pull ( next, sizeof ( *next_iphdr ) );
+	hlen = tcpip_merge ( *iobuf, next, iphdr->protocol, pshdr_csum,
+			     next_pshdr_csum );
+	iob_push ( *iobuf, sizeof ( *iphdr ) );
+	iob_push ( next, sizeof ( *next_iphdr ) );
+	if ( hlen < 0 )
+		return hlen;
+	payload_len = ( next_len - sizeof ( *next_iphdr ) - hlen );
+
+	/* Limit merged packet to the maximum representable length */
+	if ( max_len > 0xffff )
+		max_len = 0xffff;
+	if ( ( len + payload_len ) > max_len )
+		return -ERANGE;
+
+	/* Append payload and update header */
+	if ( iob_tailroom ( *iobuf ) < payload_len ) {
+		if ( ( rc = iob_expand ( iobuf, ( max_len - len ) ) ) != 0 )
+			return rc;
+	}
+	memcpy ( iob_put ( *iobuf, payload_len ),
+		 ( next->data + sizeof ( *next_iphdr ) + hlen ), payload_len );
+	iphdr = (*iobuf)->data;
+	iphdr->len = htons ( iob_len ( *iobuf ) );
+	iphdr->chksum = 0;
+	iphdr->chksum = tcpip_chksum ( iphdr, sizeof ( *iphdr ) );
+
+	return 0;
+}
+
 /** 
  * Check existence of IPv4 address for ARP
  *
@@ -608,6 +1071,7 @@ struct net_protocol ipv4_protocol __net_protocol = {
 	.net_proto = htons ( ETH_P_IP ),
 	.net_addr_len = sizeof ( struct in_addr ),
 	.rx = ipv4_rx,
+	.merge = ipv4_merge,
 	.ntoa = ipv4_ntoa,
 };
 
@@ -615,7 +1079,22 @@ struct net_protocol ipv4_protocol __net_protocol = {
 struct tcpip_net_protocol ipv4_tcpip_protocol __tcpip_net_protocol = {
 	.name = "IPv4",
 	.sa_family = AF_INET,
+	.header_len = sizeof ( struct iphdr ),
 	.tx = ipv4_tx,
+	.netdev = ipv4_netdev,
+	.pmtu = ipv4_pmtu,
+};
+
+/** IPv4 statistics */
+struct net_statistic ipv4_net_statistics[]
+	__net_statistic ( NET_STAT_NETWORK ) = {
+	{ "IPv4", "HDRE", &ipv4_stats.header_errors },
+	{ "IPv4", "CSUME", &ipv4_stats.checksum_errors },
+	{ "IPv4", "FRAG", &ipv4_stats.fragments },
+	{ "IPv4", "REASM", &ipv4_stats.reassembled },
+	{ "IPv4", "FRAGE", &ipv4_stats.fragment_errors },
+	{ "IPv4", "NOROUTE", &ipv4_stats.no_route },
+	{ "IPv4", "PMTU", &ipv4_stats.pmtu_updates },
 };
 
 /** IPv4 ARP protocol */
@@ -655,6 +1134,29 @@ struct setting gateway_setting __setting ( SETTING_IPv4 ) = {
 	.type = &setting_type_ipv4,
 };
 
+/**
+ * Start resolving link-layer address of a likely peer
+ *
+ * @v miniroute		Routing table entry
+ * @v peer		Peer address, or zero
+ */
+static void ipv4_resolve_peer ( struct ipv4_miniroute *miniroute,
+				struct in_addr peer ) {
+
+	/* Ignore peers that are absent or not directly attached */
+	if ( ( ! peer.s_addr ) ||
+	     ( ( peer.s_addr ^ miniroute->address.s_addr ) &
+	       miniroute->netmask.s_addr ) )
+		return;
+
+	/* Ignore network devices that are closed */
+	if ( ! netdev_is_open ( miniroute->netdev ) )
+		return;
+
+	arp_resolve ( miniroute->netdev, &ipv4_protocol, &peer,
+		      &miniroute->address );
+}
+
 /**
  * Create IPv4 routing table based on configured settings
  *
@@ -668,6 +1170,7 @@ static int ipv4_create_routes ( void ) {
 	struct in_addr address = { 0 };
 	struct in_addr netmask = { 0 };
 	struct in_addr gateway = { 0 };
+	struct in_addr next_server;
 
 	/* Delete all existing routes */
 	list_for_each_entry_safe ( miniroute, tmp, &ipv4_miniroutes, list )
@@ -700,6 +1203,14 @@ static int ipv4_create_routes ( void ) {
 						 netmask, gateway );
 		if ( ! miniroute )
 			return -ENOMEM;
+		/* Start resolving the gateway and boot server, since
+		 * both are likely to be used almost immediately.
+		 */
+		next_server.s_addr = 0;
+		fetch_ipv4_setting ( settings, &next_server_setting,
+				     &next_server );
+		ipv4_resolve_peer ( miniroute, gateway );
+		ipv4_resolve_peer ( miniroute, next_server );
 	}
 
 	return 0;
@@ -710,5 +1221,37 @@ struct settings_applicator ipv4_settings_applicator __settings_applicator = {
 	.apply = ipv4_create_routes,
 };
 
+/**
+ * Probe IPv4 network device
+ *
+ * @v netdev		Network device
+ * @ret rc		Return status code
+ */
+static int ipv4_probe ( struct net_device *netdev __unused ) {
+	/* Nothing to do */
+	return 0;
+}
+
+/**
+ * Invalidate IPv4 route cache on network device state change or removal
+ *
+ * @v netdev		Network device
+ */
+static void ipv4_flush ( struct net_device *netdev __unused ) {
+
+	/* Opening or closing a network device may change the result
+	 * of any route lookup.
+	 */
+	ipv4_route_cache.miniroute = NULL;
+}
+
+/** IPv4 driver (for net device notifications) */
+struct net_driver ipv4_net_driver __net_driver = {
+	.name = "IPv4",
+	.probe = ipv4_probe,
+	.notify = ipv4_flush,
+	.remove = ipv4_flush,
+};
+
 /* Drag in ICMP */
 REQUIRE_OBJECT ( icmp );
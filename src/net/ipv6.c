@@ -14,6 +14,7 @@
 #include <ipxe/iobuf.h>
 #include <ipxe/netdevice.h>
 #include <ipxe/if_ether.h>
+#include <ipxe/timer.h>
 
 /* Unspecified IP6 address */
 static struct in6_addr ip6_none = {
@@ -41,6 +42,33 @@ struct ipv6_miniroute {
 /** List of IPv6 miniroutes */
 static LIST_HEAD ( miniroutes );
 
+/** A cached IPv6 route */
+struct ipv6_route_cache {
+	/** Final destination address */
+	struct in6_addr dest;
+	/** Next hop destination address */
+	struct in6_addr next_hop;
+	/** Routing table entry, or NULL if cache is empty */
+	struct ipv6_miniroute *miniroute;
+	/** Partial checksum over source and destination addresses */
+	uint16_t csum;
+};
+
+/** Most recently used IPv6 route
+ *
+ * Consecutive packets almost always go to the same destination, so
+ * the result of the most recent lookup is retained, along with the
+ * address portion of the pseudo-header checksum.  The cache is
+ * emptied whenever the routing table changes.
+ */
+static struct ipv6_route_cache ipv6_route_cache;
+
+/** List of fragment reassembly buffers */
+static LIST_HEAD ( ipv6_fragments );
+
+/** Fragment reassembly timeout */
+#define IP6_FRAG_TIMEOUT ( TICKS_PER_SEC / 2 )
+
 /**
  * Add IPv6 minirouting table entry
  *
@@ -55,6 +83,7 @@ add_ipv6_miniroute ( struct net_device *netdev, struct in6_addr prefix,
 		     int prefix_len, struct in6_addr address,
 		     struct in6_addr gateway ) {
 	struct ipv6_miniroute *miniroute;
+	struct ipv6_miniroute *pos;
 	
 	miniroute = malloc ( sizeof ( *miniroute ) );
 	if ( miniroute ) {
@@ -65,12 +94,22 @@ add_ipv6_miniroute ( struct net_device *netdev, struct in6_addr prefix,
 		miniroute->address = address;
 		miniroute->gateway = gateway;
 		
-		/* Add miniroute to list of miniroutes */
-		if ( !IP6_EQUAL ( gateway, ip6_none ) ) {
-			list_add_tail ( &miniroute->list, &miniroutes );
-		} else {
-			list_add ( &miniroute->list, &miniroutes );
+		/* Add miniroute to list of miniroutes, keeping the
+		 * list sorted by decreasing prefix length so that the
+		 * first matching entry is the longest prefix match.
+		 */
+		list_for_each_entry ( pos, &miniroutes, list ) {
+			if ( prefix_len > pos->prefix_len )
+				break;
+			if ( ( prefix_len == pos->prefix_len ) &&
+			     IP6_EQUAL ( gateway, ip6_none ) &&
+			     ! IP6_EQUAL ( pos->gateway, ip6_none ) )
+				break;
 		}
+		list_add_tail ( &miniroute->list, &pos->list );
+
+		/* Invalidate route cache */
+		ipv6_route_cache.miniroute = NULL;
 	}
 
 	return miniroute;
@@ -85,6 +124,128 @@ static void del_ipv6_miniroute ( struct ipv6_miniroute *miniroute ) {
 	netdev_put ( miniroute->netdev );
 	list_del ( &miniroute->list );
 	free ( miniroute );
+
+	/* Invalidate route cache */
+	ipv6_route_cache.miniroute = NULL;
+}
+
+/**
+ * Check if address lies within prefix
+ *
+ * @v addr		Address
+ * @v prefix		Prefix
+ * @v prefix_len	Prefix length (in bits)
+ * @ret match		Address lies within prefix
+ */
+static int ipv6_prefix_match ( const struct in6_addr *addr,
+			       const struct in6_addr *prefix,
+			       unsigned int prefix_len ) {
+	unsigned int bytes = ( prefix_len / 8 );
+	unsigned int bits = ( prefix_len % 8 );
+	uint8_t mask;
+
+	if ( prefix_len > ( 8 * sizeof ( *addr ) ) )
+		return 0;
+	if ( memcmp ( addr, prefix, bytes ) != 0 )
+		return 0;
+	if ( ! bits )
+		return 1;
+	mask = ( 0xff << ( 8 - bits ) );
+	return ( ( ( addr->s6_addr[bytes] ^ prefix->s6_addr[bytes] )
+		   & mask ) == 0 );
+}
+
+/**
+ * Calculate partial checksum over pair of addresses
+ *
+ * @v src		Source address
+ * @v dest		Destination address
+ * @ret csum		Partial checksum
+ */
+static uint16_t ipv6_addr_chksum ( const struct in6_addr *src,
+				   const struct in6_addr *dest ) {
+	uint16_t csum;
+
+	csum = tcpip_chksum ( src, sizeof ( *src ) );
+	return tcpip_continue_chksum ( csum, dest, sizeof ( *dest ) );
+}
+
+/**
+ * Perform IPv6 routing
+ *
+ * @v dest		Final destination address
+ * @ret dest		Next hop destination address
+ * @ret miniroute	Routing table entry to use, or NULL if no route
+ *
+ * If the route requires use of a gateway, the next hop destination
+ * address will be overwritten with the gateway address.
+ *
+ * A directly attached prefix is always preferred; if several match,
+ * the longest prefix is used.  Otherwise, the first usable route
+ * with a gateway is used.
+ */
+static struct ipv6_miniroute * ipv6_route ( struct in6_addr *dest ) {
+	struct ipv6_route_cache *cache = &ipv6_route_cache;
+	struct ipv6_miniroute *miniroute;
+	struct ipv6_miniroute *gw_miniroute = NULL;
+	struct in6_addr final = *dest;
+
+	/* Use cached route if applicable */
+	if ( cache->miniroute && IP6_EQUAL ( cache->dest, *dest ) &&
+	     netdev_is_open ( cache->miniroute->netdev ) ) {
+		*dest = cache->next_hop;
+		return cache->miniroute;
+	}
+
+	/* Find longest matching directly attached prefix, or first
+	 * usable gateway.  The list is sorted by decreasing prefix
+	 * length.
+	 */
+	list_for_each_entry ( miniroute, &miniroutes, list ) {
+		if ( ! netdev_is_open ( miniroute->netdev ) )
+			continue;
+		if ( ipv6_prefix_match ( dest, &miniroute->prefix,
+					 miniroute->prefix_len ) )
+			goto found;
+		if ( ( ! IS_UNSPECIFIED ( miniroute->gateway ) ) &&
+		     ( ! gw_miniroute ) )
+			gw_miniroute = miniroute;
+	}
+	if ( ! gw_miniroute )
+		return NULL;
+	miniroute = gw_miniroute;
+	*dest = miniroute->gateway;
+
+ found:
+	/* Record in cache */
+	cache->dest = final;
+	cache->next_hop = *dest;
+	cache->miniroute = miniroute;
+	cache->csum = ipv6_addr_chksum ( &miniroute->address, &final );
+	return miniroute;
+}
+
+/**
+ * Determine transmitting network device
+ *
+ * @v st_dest		Destination network-layer address
+ * @ret netdev		Transmitting network device, or NULL
+ */
+static struct net_device * ipv6_netdev ( struct sockaddr_tcpip *st_dest ) {
+	struct sockaddr_in6 *sin6_dest = ( ( struct sockaddr_in6 * ) st_dest );
+	struct in6_addr dest = sin6_dest->sin6_addr;
+	struct ipv6_miniroute *miniroute;
+
+	/* Multicasts are not routed */
+	if ( dest.s6_addr[0] == 0xff )
+		return NULL;
+
+	/* Find routing table entry */
+	miniroute = ipv6_route ( &dest );
+	if ( ! miniroute )
+		return NULL;
+
+	return miniroute->netdev;
 }
 
 /**
@@ -129,27 +290,64 @@ void del_ipv6_address ( struct net_device *netdev ) {
 }
 
 /**
- * Calculate TCPIP checksum
+ * Add IPv6 pseudo-header checksum to existing checksum
  *
- * @v iobuf	I/O buffer
- * @v tcpip	TCP/IP protocol
+ * @v addr_csum		Partial checksum over addresses
+ * @v len		Upper-layer packet length
+ * @v nxt_hdr		Upper-layer protocol
+ * @v csum		Existing checksum
+ * @ret csum		Updated checksum
  *
- * This function constructs the pseudo header and completes the checksum in the
- * upper layer header.
+ * The address portion of the pseudo-header checksum is supplied
+ * separately, so that it may be calculated once and reused for all
+ * packets to or from the same peer.
  */
-static uint16_t ipv6_tx_csum ( struct io_buffer *iobuf, uint16_t csum ) {
-	struct ip6_header *ip6hdr = iobuf->data;
-	struct ipv6_pseudo_header pshdr;
+static uint16_t ipv6_pshdr_chksum ( uint16_t addr_csum, size_t len,
+				    uint8_t nxt_hdr, uint16_t csum ) {
+	struct {
+		uint8_t zero_padding;
+		uint8_t nxt_hdr;
+		uint16_t len;
+	} __attribute__ (( packed )) tail;
+	unsigned int sum;
+
+	/* Add length and next header */
+	tail.zero_padding = 0;
+	tail.nxt_hdr = nxt_hdr;
+	tail.len = htons ( len );
+	csum = tcpip_continue_chksum ( csum, &tail, sizeof ( tail ) );
+
+	/* Add address checksum using ones' complement addition */
+	sum = ( ( ( ~csum ) & 0xffff ) + ( ( ~addr_csum ) & 0xffff ) );
+	sum = ( ( sum & 0xffff ) + ( sum >> 16 ) );
+	return ( ~sum );
+}
 
-	/* Calculate pseudo header */
-	memset ( &pshdr, 0, sizeof ( pshdr ) );
-	pshdr.src = ip6hdr->src;
-	pshdr.dest = ip6hdr->dest;
-	pshdr.len = htons ( iob_len ( iobuf ) - sizeof ( *ip6hdr ) );
-	pshdr.nxt_hdr = ip6hdr->nxt_hdr;
+/**
+ * Calculate partial checksum over pair of addresses, using cache
+ *
+ * @v src		Source address
+ * @v dest		Destination address
+ * @ret csum		Partial checksum
+ *
+ * Since the checksum is independent of the order of the addresses,
+ * the cached value for the most recently used route also applies to
+ * packets received from that route's destination.
+ */
+static uint16_t ipv6_addr_chksum_cached ( const struct in6_addr *src,
+					  const struct in6_addr *dest ) {
+	struct ipv6_route_cache *cache = &ipv6_route_cache;
+	struct ipv6_miniroute *miniroute = cache->miniroute;
 
-	/* Update checksum value */
-	return tcpip_continue_chksum ( csum, &pshdr, sizeof ( pshdr ) );
+	if ( miniroute ) {
+		if ( IP6_EQUAL ( *src, miniroute->address ) &&
+		     IP6_EQUAL ( *dest, cache->dest ) )
+			return cache->csum;
+		if ( IP6_EQUAL ( *src, cache->dest ) &&
+		     IP6_EQUAL ( *dest, miniroute->address ) )
+			return cache->csum;
+	}
+	return ipv6_addr_chksum ( src, dest );
 }
 
 /**
@@ -166,50 +364,66 @@ void ipv6_dump ( struct ip6_header *ip6hdr ) {
 /**
  * Transmit IP6 packet
  *
- * iobuf		I/O buffer
- * tcpip	TCP/IP protocol
- * st_dest	Destination socket address
+ * @v iobuf		I/O buffer
+ * @v tcpip		Transport-layer protocol
+ * @v st_src		Source network-layer address
+ * @v st_dest		Destination network-layer address
+ * @v netdev		Network device to use if no route found, or NULL
+ * @v trans_csum	Transport-layer checksum to complete, or NULL
+ * @ret rc		Status
  *
  * This function prepends the IPv6 headers to the payload an transmits it.
  */
 static int ipv6_tx ( struct io_buffer *iobuf,
 		     struct tcpip_protocol *tcpip,
-		     struct sockaddr_tcpip *st_src __unused,
+		     struct sockaddr_tcpip *st_src,
 		     struct sockaddr_tcpip *st_dest,
 		     struct net_device *netdev,
 		     uint16_t *trans_csum ) {
-	struct sockaddr_in6 *dest = ( struct sockaddr_in6* ) st_dest;
+	struct sockaddr_in6 *src = ( struct sockaddr_in6 * ) st_src;
+	struct sockaddr_in6 *dest = ( struct sockaddr_in6 * ) st_dest;
 	struct in6_addr next_hop;
-	struct ipv6_miniroute *miniroute;
+	struct ipv6_miniroute *miniroute = NULL;
 	uint8_t ll_dest_buf[MAX_LL_ADDR_LEN];
 	const uint8_t *ll_dest = ll_dest_buf;
+	uint16_t addr_csum;
+	size_t len;
+	int multicast;
 	int rc;
 
 	/* Construct the IPv6 packet */
+	len = iob_total_len ( iobuf );
 	struct ip6_header *ip6hdr = iob_push ( iobuf, sizeof ( *ip6hdr ) );
 	memset ( ip6hdr, 0, sizeof ( *ip6hdr) );
 	ip6hdr->ver_traffic_class_flow_label = htonl ( 0x60000000 );//IP6_VERSION;
-	ip6hdr->payload_len = htons ( iob_len ( iobuf ) - sizeof ( *ip6hdr ) );
+	ip6hdr->payload_len = htons ( len );
 	ip6hdr->nxt_hdr = tcpip->tcpip_proto;
 	ip6hdr->hop_limit = IP6_HOP_LIMIT; // 255
+	ip6hdr->dest = dest->sin6_addr;
+	if ( src )
+		ip6hdr->src = src->sin6_addr;
 
-	/* Determine the next hop address and interface
-	 *
-	 * TODO: Implement the routing table.
+	/* Determine the next hop address and interface.  Multicasts
+	 * are not routed, and use the first address of the specified
+	 * (or any) network device.
 	 */
 	next_hop = dest->sin6_addr;
-	list_for_each_entry ( miniroute, &miniroutes, list ) {
-		if ( ( memcmp ( &ip6hdr->dest, &miniroute->prefix,
-					miniroute->prefix_len ) == 0 ) ||
-		     ( IP6_EQUAL ( miniroute->gateway, ip6_none ) ) ) {
-			netdev = miniroute->netdev;
-			ip6hdr->src = miniroute->address;
-			if ( ! ( IS_UNSPECIFIED ( miniroute->gateway ) ) ) {
-				next_hop = miniroute->gateway;
-			}
-			break;
+	multicast = ( next_hop.s6_addr[0] == 0xff );
+	if ( multicast ) {
+		list_for_each_entry ( miniroute, &miniroutes, list ) {
+			if ( ( ! netdev ) || ( miniroute->netdev == netdev ) )
+				break;
 		}
+		if ( &miniroute->list == &miniroutes )
+			miniroute = NULL;
+	} else {
+		miniroute = ipv6_route ( &next_hop );
 	}
+	if ( miniroute ) {
+		netdev = miniroute->netdev;
+		ip6hdr->src = miniroute->address;
+	}
+
 	/* No network interface identified */
 	if ( !netdev ) {
 		DBG ( "No route to host %s\n", inet6_ntoa ( ip6hdr->dest ) );
@@ -217,15 +431,27 @@ static int ipv6_tx ( struct io_buffer *iobuf,
 		goto err;
 	}
 
-	/* Complete the transport layer checksum */
-	if ( trans_csum )
-		*trans_csum = ipv6_tx_csum ( iobuf, *trans_csum );
+	/* Complete the transport layer checksum, reusing the cached
+	 * address checksum if this packet follows the cached route.
+	 */
+	if ( trans_csum ) {
+		if ( ( ! multicast ) && miniroute &&
+		     ( miniroute == ipv6_route_cache.miniroute ) ) {
+			addr_csum = ipv6_route_cache.csum;
+		} else {
+			addr_csum = ipv6_addr_chksum ( &ip6hdr->src,
+						       &ip6hdr->dest );
+		}
+		*trans_csum = ipv6_pshdr_chksum ( addr_csum, len,
+						  ip6hdr->nxt_hdr,
+						  *trans_csum );
+	}
 
 	/* Print IPv6 header */
 	ipv6_dump ( ip6hdr );
 	
 	/* Resolve link layer address */
-	if ( next_hop.in6_u.u6_addr8[0] == 0xff ) {
+	if ( multicast ) {
 		ll_dest_buf[0] = 0x33;
 		ll_dest_buf[1] = 0x33;
 		ll_dest_buf[2] = next_hop.in6_u.u6_addr8[12];
@@ -251,34 +477,321 @@ static int ipv6_tx ( struct io_buffer *iobuf,
 }
 
 /**
- * Process next IP6 header
+ * Free fragment reassembly buffer
  *
- * @v iobuf	I/O buffer
- * @v nxt_hdr	Next header number
- * @v src	Source socket address
- * @v dest	Destination socket address
+ * @v frag		Fragment reassembly buffer
+ */
+static void ipv6_fragment_free ( struct ipv6_fragment *frag ) {
+
+	stop_timer ( &frag->timer );
+	free_iob ( frag->iobuf );
+	list_del ( &frag->list );
+	free ( frag );
+}
+
+/**
+ * Expire fragment reassembly buffer
  *
- * Refer http://www.iana.org/assignments/ipv6-parameters for the numbers
+ * @v timer		Retry timer
+ * @v fail		Failure indicator
  */
-static int ipv6_process_nxt_hdr ( struct io_buffer *iobuf, uint8_t nxt_hdr,
-		struct sockaddr_tcpip *src, struct sockaddr_tcpip *dest ) {
+static void ipv6_fragment_expired ( struct retry_timer *timer,
+				    int fail __unused ) {
+	struct ipv6_fragment *frag =
+		container_of ( timer, struct ipv6_fragment, timer );
+
+	DBG ( "IP6 fragment %08x expired\n", ntohl ( frag->ident ) );
+	ipv6_fragment_free ( frag );
+}
+
+/**
+ * Find or create fragment reassembly buffer
+ *
+ * @v src		Source address
+ * @v dest		Destination address
+ * @v ident		Identification
+ * @ret frag		Fragment reassembly buffer, or NULL
+ */
+static struct ipv6_fragment * ipv6_fragment ( struct in6_addr *src,
+					      struct in6_addr *dest,
+					      uint32_t ident ) {
+	struct ipv6_fragment *frag;
+
+	/* Find existing reassembly buffer, if any */
+	list_for_each_entry ( frag, &ipv6_fragments, list ) {
+		if ( ( frag->ident == ident ) &&
+		     IP6_EQUAL ( frag->src, *src ) &&
+		     IP6_EQUAL ( frag->dest, *dest ) )
+			return frag;
+	}
+
+	/* Create new reassembly buffer */
+	frag = zalloc ( sizeof ( *frag ) );
+	if ( ! frag )
+		return NULL;
+	frag->src = *src;
+	frag->dest = *dest;
+	frag->ident = ident;
+	timer_init ( &frag->timer, ipv6_fragment_expired, NULL );
+	start_timer_fixed ( &frag->timer, IP6_FRAG_TIMEOUT );
+	list_add ( &frag->list, &ipv6_fragments );
+
+	return frag;
+}
+
+/**
+ * Ensure fragment reassembly buffer covers a given payload length
+ *
+ * @v frag		Fragment reassembly buffer
+ * @v end		Required payload length
+ * @ret rc		Return status code
+ *
+ * If the final length of the payload is not yet known, the buffer is
+ * grown geometrically, so that the total amount of copying remains
+ * linear in the length of the datagram.
+ */
+static int ipv6_fragment_extend ( struct ipv6_fragment *frag, size_t end ) {
+	struct io_buffer *iobuf = frag->iobuf;
+	struct io_buffer *new_iobuf;
+	size_t len = ( iobuf ? iob_len ( iobuf ) : 0 );
+	size_t capacity;
+
+	/* Do nothing if buffer is already long enough */
+	if ( end <= len )
+		return 0;
+
+	/* Use existing tailroom, if possible */
+	if ( iobuf && ( ( end - len ) <= iob_tailroom ( iobuf ) ) ) {
+		iob_put ( iobuf, ( end - len ) );
+		return 0;
+	}
+
+	/* Allocate new buffer */
+	capacity = ( frag->len ? frag->len : ( 2 * len ) );
+	if ( capacity < end )
+		capacity = end;
+	if ( capacity > IP6_MAX_LEN )
+		capacity = IP6_MAX_LEN;
+	new_iobuf = alloc_iob ( capacity );
+	if ( ! new_iobuf ) {
+		DBG ( "IP6 could not extend reassembly buffer to %zd bytes\n",
+		      capacity );
+		return -ENOMEM;
+	}
+
+	/* Copy existing payload */
+	if ( iobuf ) {
+		memcpy ( iob_put ( new_iobuf, len ), iobuf->data, len );
+		free_iob ( iobuf );
+	}
+	iob_put ( new_iobuf, ( end - len ) );
+	frag->iobuf = new_iobuf;
+
+	return 0;
+}
+
+/**
+ * Fragment reassembler
+ *
+ * @v iobuf		I/O buffer, starting with fragment header
+ * @v src		Source address
+ * @v dest		Destination address
+ * @v nxt_hdr		Next header to fill in
+ * @ret iobuf		Reassembled packet, or NULL
+ *
+ * Fragments may arrive in any order.  Each fragment is copied
+ * directly into place within a single reassembly buffer per
+ * datagram.  A datagram containing overlapping fragments is
+ * discarded, as required by RFC 5722.
+ */
+static struct io_buffer * ipv6_reassemble ( struct io_buffer *iobuf,
+					    struct in6_addr *src,
+					    struct in6_addr *dest,
+					    uint8_t *nxt_hdr ) {
+	struct ip6_fragment_header *fraghdr = iobuf->data;
+	struct ipv6_fragment *frag;
+	struct io_buffer *reassembled;
+	unsigned int more_frags;
+	unsigned int block;
+	size_t offset;
+	size_t len;
+	size_t end;
+
+	/* Sanity check */
+	if ( iob_len ( iobuf ) < sizeof ( *fraghdr ) ) {
+		DBG ( "IP6 fragment header too short\n" );
+		goto drop;
+	}
+	offset = ( ntohs ( fraghdr->offset_flags ) & IP6_MASK_OFFSET );
+	more_frags = ( ntohs ( fraghdr->offset_flags ) & IP6_MASK_MOREFRAGS );
+	len = ( iob_len ( iobuf ) - sizeof ( *fraghdr ) );
+	end = ( offset + len );
+
+	/* A packet with a fragment header but no fragmentation is
+	 * simply the original packet (RFC 8200 section 4.5).
+	 */
+	if ( ( offset == 0 ) && ( ! more_frags ) ) {
+		*nxt_hdr = fraghdr->nxt_hdr;
+		iob_pull ( iobuf, sizeof ( *fraghdr ) );
+		return iobuf;
+	}
+
+	/* Find or create matching fragment reassembly buffer */
+	frag = ipv6_fragment ( src, dest, fraghdr->ident );
+	if ( ! frag )
+		goto drop;
+
+	/* Drop fragments inconsistent with the datagram length.  All
+	 * fragments except the last must be a multiple of 8 octets.
+	 */
+	if ( ( end > IP6_MAX_LEN ) || ( more_frags && ( len & 7 ) ) ||
+	     ( frag->len && ( end > frag->len ) ) ||
+	     ( ( ! more_frags ) && frag->iobuf &&
+	       ( end < iob_len ( frag->iobuf ) ) ) ) {
+		DBG ( "IP6 dropping inconsistent fragment %08x (%zd+%zd)\n",
+		      ntohl ( fraghdr->ident ), offset, len );
+		goto drop;
+	}
+
+	/* Discard whole datagram if this fragment overlaps another */
+	for ( block = ( offset / 8 ) ; block < ( ( end + 7 ) / 8 ) ;
+	      block++ ) {
+		if ( frag->blocks[ block / 8 ] & ( 1 << ( block % 8 ) ) ) {
+			DBG ( "IP6 discarding overlapping fragment %08x "
+			      "(%zd+%zd)\n", ntohl ( fraghdr->ident ), offset,
+			      len );
+			ipv6_fragment_free ( frag );
+			goto drop;
+		}
+	}
+
+	/* Copy fragment into place */
+	if ( ipv6_fragment_extend ( frag, end ) != 0 )
+		goto drop;
+	memcpy ( ( frag->iobuf->data + offset ), ( fraghdr + 1 ), len );
+	for ( block = ( offset / 8 ) ; block < ( ( end + 7 ) / 8 ) ;
+	      block++ ) {
+		frag->blocks[ block / 8 ] |= ( 1 << ( block % 8 ) );
+	}
+	frag->received += len;
+	if ( offset == 0 )
+		frag->nxt_hdr = fraghdr->nxt_hdr;
+	if ( ! more_frags )
+		frag->len = end;
+	free_iob ( iobuf );
+
+	/* If all fragments have arrived, return the reassembled packet */
+	if ( frag->len && ( frag->received == frag->len ) ) {
+		reassembled = frag->iobuf;
+		frag->iobuf = NULL;
+		*nxt_hdr = frag->nxt_hdr;
+		ipv6_fragment_free ( frag );
+		return reassembled;
+	}
+
+	/* (Re)start fragment reassembly timer */
+	start_timer_fixed ( &frag->timer, IP6_FRAG_TIMEOUT );
+
+	return NULL;
+
+ drop:
+	free_iob ( iobuf );
+	return NULL;
+}
+
+/**
+ * Check if next header is an extension header
+ *
+ * @v nxt_hdr		Next header number
+ * @ret is_ext		Next header is an extension header
+ */
+static inline __attribute__ (( always_inline )) int
+ipv6_is_ext_hdr ( uint8_t nxt_hdr ) {
 	switch ( nxt_hdr ) {
-	case IP6_HOPBYHOP: 
-	case IP6_ROUTING: 
-	case IP6_FRAGMENT: 
-	case IP6_AUTHENTICATION: 
-	case IP6_DEST_OPTS: 
-	case IP6_ESP: 
-		DBG ( "Function not implemented for header %d\n", nxt_hdr );
-		return -ENOSYS;
-	case IP6_ICMP6: 
-		break;
-	case IP6_NO_HEADER: 
-		DBG ( "No next header\n" );
+	case IP6_HOPBYHOP:
+	case IP6_ROUTING:
+	case IP6_FRAGMENT:
+	case IP6_AUTHENTICATION:
+	case IP6_DEST_OPTS:
+	case IP6_ESP:
+	case IP6_NO_HEADER:
+		return 1;
+	default:
 		return 0;
 	}
-	/* Next header is not a IPv6 extension header */
-	return tcpip_rx ( iobuf, nxt_hdr, src, dest, 0 /* fixme */ );
+}
+
+/**
+ * Process IPv6 extension headers
+ *
+ * @v iobuf		I/O buffer
+ * @v nxt_hdr		Next header number
+ * @v src		Source socket address
+ * @v dest		Destination socket address
+ * @ret iobuf		I/O buffer containing upper-layer packet, or NULL
+ * @ret nxt_hdr		Upper-layer protocol
+ *
+ * Extension headers are stripped, and fragments are reassembled.
+ * The I/O buffer is consumed if no upper-layer packet is (yet)
+ * available.
+ *
+ * Refer http://www.iana.org/assignments/ipv6-parameters for the numbers
+ */
+static struct io_buffer * ipv6_process_ext_hdrs ( struct io_buffer *iobuf,
+						  uint8_t *nxt_hdr,
+						  struct sockaddr_in6 *src,
+						  struct sockaddr_in6 *dest ) {
+	struct ip6_ext_header *ext;
+	struct ip6_routing_header *routing;
+	size_t len;
+
+	while ( ipv6_is_ext_hdr ( *nxt_hdr ) ) {
+		switch ( *nxt_hdr ) {
+		case IP6_HOPBYHOP:
+		case IP6_DEST_OPTS:
+		case IP6_ROUTING:
+			/* Skip header.  Options are ignored, and we
+			 * are never an intermediate routing node.
+			 */
+			ext = iobuf->data;
+			if ( ( iob_len ( iobuf ) < sizeof ( *ext ) ) ||
+			     ( iob_len ( iobuf ) <
+			       ( len = ( ( ext->len + 1 ) * 8 ) ) ) ) {
+				DBG ( "IP6 extension header %d too short\n",
+				      *nxt_hdr );
+				goto drop;
+			}
+			routing = iobuf->data;
+			if ( ( *nxt_hdr == IP6_ROUTING ) &&
+			     routing->segments_left ) {
+				DBG ( "IP6 cannot forward source-routed "
+				      "packet\n" );
+				goto drop;
+			}
+			*nxt_hdr = ext->nxt_hdr;
+			iob_pull ( iobuf, len );
+			break;
+		case IP6_FRAGMENT:
+			iobuf = ipv6_reassemble ( iobuf, &src->sin6_addr,
+						  &dest->sin6_addr, nxt_hdr );
+			if ( ! iobuf )
+				return NULL;
+			break;
+		case IP6_NO_HEADER:
+			DBG ( "No next header\n" );
+			goto drop;
+		default:
+			DBG ( "Function not implemented for header %d\n",
+			      *nxt_hdr );
+			goto drop;
+		}
+	}
+
+	return iobuf;
+
+ drop:
+	free_iob ( iobuf );
+	return NULL;
 }
 
 /**
@@ -303,6 +816,8 @@ static int ipv6_rx ( struct io_buffer *iobuf,
 		struct sockaddr_in6 sin6;
 		struct sockaddr_tcpip st;
 	} src, dest;
+	uint16_t pshdr_csum;
+	uint8_t nxt_hdr;
 
 	/* Sanity check */
 	if ( iob_len ( iobuf ) < sizeof ( *ip6hdr ) ) {
@@ -310,21 +825,21 @@ static int ipv6_rx ( struct io_buffer *iobuf,
 		goto drop;
 	}
 
-	/* TODO: Verify checksum */
-
 	/* Print IP6 header for debugging */
 	ipv6_dump ( ip6hdr );
 
 	/* Check header version */
-	if ( ( ip6hdr->ver_traffic_class_flow_label & 0xf0000000 ) != 0x60000000 ) {
+	if ( ( ip6hdr->ver_traffic_class_flow_label & htonl ( 0xf0000000 ) )
+	     != htonl ( 0x60000000 ) ) {
 		DBG ( "Invalid protocol version\n" );
 		goto drop;
 	}
 
 	/* Check the payload length */
-	if ( ntohs ( ip6hdr->payload_len ) > iob_len ( iobuf ) ) {
+	if ( ntohs ( ip6hdr->payload_len ) >
+	     ( iob_len ( iobuf ) - sizeof ( *ip6hdr ) ) ) {
 		DBG ( "Inconsistent packet length (%d bytes)\n",
-			ip6hdr->payload_len );
+			ntohs ( ip6hdr->payload_len ) );
 		goto drop;
 	}
 
@@ -337,14 +852,32 @@ static int ipv6_rx ( struct io_buffer *iobuf,
 	memset ( &dest, 0, sizeof ( dest ) );
 	dest.sin6.sin_family = AF_INET6;
 	dest.sin6.sin6_addr = ip6hdr->dest;
+	nxt_hdr = ip6hdr->nxt_hdr;
 
 	/* Strip header */
 	iob_unput ( iobuf, iob_len ( iobuf ) - ntohs ( ip6hdr->payload_len ) -
 							sizeof ( *ip6hdr ) );
 	iob_pull ( iobuf, sizeof ( *ip6hdr ) );
 
+	/* Process any extension headers.  In the common case, the
+	 * upper-layer header directly follows the IPv6 header.
+	 */
+	if ( ipv6_is_ext_hdr ( nxt_hdr ) ) {
+		iobuf = ipv6_process_ext_hdrs ( iobuf, &nxt_hdr, &src.sin6,
+						&dest.sin6 );
+		if ( ! iobuf )
+			return 0;
+	}
+
+	/* Calculate pseudo-header checksum */
+	pshdr_csum = ipv6_pshdr_chksum ( ipv6_addr_chksum_cached (
+						 &src.sin6.sin6_addr,
+						 &dest.sin6.sin6_addr ),
+					 iob_len ( iobuf ), nxt_hdr,
+					 TCPIP_EMPTY_CSUM );
+
 	/* Send it to the transport layer */
-	return ipv6_process_nxt_hdr ( iobuf, ip6hdr->nxt_hdr, &src.st, &dest.st );
+	return tcpip_rx ( iobuf, nxt_hdr, &src.st, &dest.st, pshdr_csum );
 
   drop:
 	DBG ( "Packet dropped\n" );
@@ -380,5 +913,7 @@ struct net_protocol ipv6_protocol __net_protocol = {
 struct tcpip_net_protocol ipv6_tcpip_protocol __tcpip_net_protocol = {
 	.name = "IPv6",
 	.sa_family = AF_INET6,
+	.header_len = sizeof ( struct ip6_header ),
 	.tx = ipv6_tx,
+	.netdev = ipv6_netdev,
 };
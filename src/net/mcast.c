@@ -0,0 +1,672 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <ipxe/iobuf.h>
+#include <ipxe/bitmap.h>
+#include <ipxe/xfer.h>
+#include <ipxe/open.h>
+#include <ipxe/uri.h>
+#include <ipxe/uaccess.h>
+#include <ipxe/blockdev.h>
+#include <ipxe/process.h>
+#include <ipxe/retry.h>
+#include <ipxe/timer.h>
+#include <ipxe/settings.h>
+
+/** @file
+ *
+ * Multicast-first downloads
+ *
+ * A URI of the form "mcast:<uri>" fetches the file via multicast
+ * (e.g. SLAM or MTFTP), and then uses the unicast URI <uri> to repair
+ * any gaps left when the multicast transfer fails or stalls.  This
+ * allows many identical clients to be booted simultaneously without
+ * each client requiring its own copy of the file from the server.
+ *
+ * The multicast URI is taken from the "mcast-uri" setting.  If this
+ * setting is absent, an MTFTP URI is constructed from the host and
+ * path of the unicast URI, and the MTFTP multicast group announced
+ * via DHCP is used.
+ *
+ * Received data is tracked in a block bitmap.  Gaps are repaired
+ * using HTTP range requests where possible (i.e. when the unicast
+ * URI is an HTTP or HTTPS URI and the file size is known), otherwise
+ * by downloading the file via the unicast URI until all gaps have
+ * been filled.
+ */
+
+/** Granularity of the received block bitmap */
+#define MCAST_BLKSIZE 512
+
+/** Maximum length of a single range repair request */
+#define MCAST_REPAIR_MAX_LEN ( 64 * 1024 )
+
+/** Time to wait for progress on the multicast transfer */
+#define MCAST_IDLE_TIMEOUT ( 5 * TICKS_PER_SEC )
+
+/** Multicast URI setting */
+struct setting mcast_uri_setting __setting ( SETTING_BOOT_EXTRA ) = {
+	.name = "mcast-uri",
+	.description = "Multicast download URI",
+	.type = &setting_type_string,
+};
+
+/** A multicast-first download */
+struct mcast_request {
+	/** Reference count */
+	struct refcnt refcnt;
+	/** Data transfer interface */
+	struct interface xfer;
+	/** Multicast transfer interface */
+	struct interface multicast;
+	/** Unicast repair interface */
+	struct interface repair;
+	/** Unicast repair block data interface */
+	struct interface block;
+	/** Range repair process */
+	struct process process;
+	/** Multicast progress timer */
+	struct retry_timer timer;
+
+	/** Unicast URI */
+	struct uri *uri;
+	/** Flags */
+	unsigned int flags;
+	/** Received block bitmap */
+	struct bitmap bitmap;
+	/** Largest known file size */
+	size_t filesize;
+	/** Current position within the file */
+	size_t pos;
+
+	/** Range repair data buffer */
+	struct io_buffer *iobuf;
+	/** Offset of range repair data buffer */
+	size_t offset;
+};
+
+/** Multicast-first download flags */
+enum mcast_flags {
+	/** File size is known */
+	MCAST_FL_SIZE_KNOWN = 0x0001,
+	/** Repairing via unicast */
+	MCAST_FL_REPAIRING = 0x0002,
+	/** Repairing via range requests */
+	MCAST_FL_RANGED = 0x0004,
+};
+
+/**
+ * Free multicast-first download
+ *
+ * @v refcnt		Reference count
+ */
+static void mcast_free ( struct refcnt *refcnt ) {
+	struct mcast_request *mcast =
+		container_of ( refcnt, struct mcast_request, refcnt );
+
+	uri_put ( mcast->uri );
+	bitmap_free ( &mcast->bitmap );
+	free_iob ( mcast->iobuf );
+	free ( mcast );
+}
+
+/**
+ * Close multicast-first download
+ *
+ * @v mcast		Multicast-first download
+ * @v rc		Reason for close
+ */
+static void mcast_close ( struct mcast_request *mcast, int rc ) {
+
+	DBGC ( mcast, "MCAST %p finished with status %d (%s)\n",
+	       mcast, rc, strerror ( rc ) );
+
+	/* Stop timer and process */
+	stop_timer ( &mcast->timer );
+	process_del ( &mcast->process );
+
+	/* Shut down all interfaces */
+	intf_shutdown ( &mcast->block, rc );
+	intf_shutdown ( &mcast->repair, rc );
+	intf_shutdown ( &mcast->multicast, rc );
+	intf_shutdown ( &mcast->xfer, rc );
+}
+
+/**
+ * Calculate number of bitmap blocks covering a length
+ *
+ * @v len		Length
+ * @ret blocks		Number of blocks
+ */
+static inline unsigned int mcast_blocks ( size_t len ) {
+	return ( ( len + MCAST_BLKSIZE - 1 ) / MCAST_BLKSIZE );
+}
+
+/**
+ * Check if all of a known-size file has been received
+ *
+ * @v mcast		Multicast-first download
+ * @ret complete	File is complete
+ */
+static int mcast_is_complete ( struct mcast_request *mcast ) {
+	return ( ( mcast->flags & MCAST_FL_SIZE_KNOWN ) &&
+		 bitmap_full ( &mcast->bitmap ) );
+}
+
+/**
+ * Extend known file size
+ *
+ * @v mcast		Multicast-first download
+ * @v len		Minimum file size
+ * @ret rc		Return status code
+ */
+static int mcast_presize ( struct mcast_request *mcast, size_t len ) {
+	int rc;
+
+	/* Do nothing if we are already large enough */
+	if ( len <= mcast->filesize )
+		return 0;
+
+	/* Resize bitmap */
+	if ( ( rc = bitmap_resize ( &mcast->bitmap,
+				    mcast_blocks ( len ) ) ) != 0 ) {
+		DBGC ( mcast, "MCAST %p could not resize bitmap: %s\n",
+		       mcast, strerror ( rc ) );
+		return rc;
+	}
+	mcast->filesize = len;
+
+	return 0;
+}
+
+/**
+ * Receive data
+ *
+ * @v mcast		Multicast-first download
+ * @v iobuf		I/O buffer
+ * @v meta		Data transfer metadata
+ * @ret rc		Return status code
+ *
+ * Data is passed through to the data transfer interface, and all
+ * completely received blocks are marked in the bitmap.
+ */
+static int mcast_rx ( struct mcast_request *mcast, struct io_buffer *iobuf,
+		      struct xfer_metadata *meta ) {
+	struct xfer_metadata out;
+	size_t len = iob_len ( iobuf );
+	size_t offset;
+	size_t end;
+	unsigned int block;
+	unsigned int last;
+	int rc;
+
+	/* Calculate absolute position */
+	if ( meta->flags & XFER_FL_ABS_OFFSET )
+		mcast->pos = 0;
+	mcast->pos += meta->offset;
+	offset = mcast->pos;
+	end = ( offset + len );
+
+	/* A seek beyond all data seen so far is an announcement of
+	 * the file size.  (Seeks that merely track received data,
+	 * such as those generated by a TFTP server that does not
+	 * support the "tsize" option, never go beyond this point.)
+	 */
+	if ( ( len == 0 ) && ( end > mcast->filesize ) ) {
+		DBGC ( mcast, "MCAST %p file size is %zd bytes\n",
+		       mcast, end );
+		mcast->flags |= MCAST_FL_SIZE_KNOWN;
+	}
+	if ( ( rc = mcast_presize ( mcast, end ) ) != 0 )
+		goto err;
+
+	/* Mark completely received blocks.  The final block is
+	 * complete if the data reaches the end of the file.
+	 */
+	block = mcast_blocks ( offset );
+	last = ( end / MCAST_BLKSIZE );
+	if ( ( mcast->flags & MCAST_FL_SIZE_KNOWN ) &&
+	     ( end == mcast->filesize ) )
+		last = mcast_blocks ( end );
+	for ( ; block < last ; block++ )
+		bitmap_set ( &mcast->bitmap, block );
+
+	/* Deliver data */
+	memset ( &out, 0, sizeof ( out ) );
+	out.flags = XFER_FL_ABS_OFFSET;
+	out.offset = offset;
+	mcast->pos = end;
+	if ( ( rc = xfer_deliver ( &mcast->xfer, iob_disown ( iobuf ),
+				   &out ) ) != 0 )
+		goto err;
+
+	return 0;
+
+ err:
+	free_iob ( iobuf );
+	mcast_close ( mcast, rc );
+	return rc;
+}
+
+/**
+ * Check whether or not unicast repair can use range requests
+ *
+ * @v mcast		Multicast-first download
+ * @ret ranged		Range requests can be used
+ */
+static int mcast_can_range ( struct mcast_request *mcast ) {
+	const char *scheme = mcast->uri->scheme;
+
+	/* Range requests require a known file size, and a protocol
+	 * that supports them via the block device interface.
+	 */
+	return ( ( mcast->flags & MCAST_FL_SIZE_KNOWN ) && scheme &&
+		 ( ( strcmp ( scheme, "http" ) == 0 ) ||
+		   ( strcmp ( scheme, "https" ) == 0 ) ) );
+}
+
+/**
+ * Start unicast repair
+ *
+ * @v mcast		Multicast-first download
+ */
+static void mcast_repair ( struct mcast_request *mcast ) {
+	int rc;
+
+	/* Stop multicast transfer */
+	stop_timer ( &mcast->timer );
+	intf_restart ( &mcast->multicast, 0 );
+
+	/* Do nothing if already repairing */
+	if ( mcast->flags & MCAST_FL_REPAIRING )
+		return;
+	mcast->flags |= MCAST_FL_REPAIRING;
+
+	/* Finish if there is nothing to repair */
+	if ( mcast_is_complete ( mcast ) ) {
+		mcast_close ( mcast, 0 );
+		return;
+	}
+
+	/* Open unicast repair transfer */
+	if ( mcast_can_range ( mcast ) )
+		mcast->flags |= MCAST_FL_RANGED;
+	DBGC ( mcast, "MCAST %p repairing from block %d via %s\n",
+	       mcast, bitmap_first_gap ( &mcast->bitmap ),
+	       ( ( mcast->flags & MCAST_FL_RANGED ) ?
+		 "range requests" : "full download" ) );
+	if ( ( rc = xfer_open_uri ( &mcast->repair, mcast->uri ) ) != 0 ) {
+		DBGC ( mcast, "MCAST %p could not open repair transfer: %s\n",
+		       mcast, strerror ( rc ) );
+		mcast_close ( mcast, rc );
+		return;
+	}
+
+	/* Start issuing range requests, if applicable */
+	if ( mcast->flags & MCAST_FL_RANGED )
+		process_add ( &mcast->process );
+}
+
+/**
+ * Handle multicast progress timer expiry
+ *
+ * @v timer		Retry timer
+ * @v fail		Failure indicator
+ */
+static void mcast_expired ( struct retry_timer *timer, int fail __unused ) {
+	struct mcast_request *mcast =
+		container_of ( timer, struct mcast_request, timer );
+
+	DBGC ( mcast, "MCAST %p multicast transfer stalled\n", mcast );
+	mcast_repair ( mcast );
+}
+
+/**
+ * Receive multicast data
+ *
+ * @v mcast		Multicast-first download
+ * @v iobuf		I/O buffer
+ * @v meta		Data transfer metadata
+ * @ret rc		Return status code
+ */
+static int mcast_multicast_deliver ( struct mcast_request *mcast,
+				     struct io_buffer *iobuf,
+				     struct xfer_metadata *meta ) {
+
+	/* Any data counts as progress */
+	if ( iob_len ( iobuf ) )
+		start_timer_fixed ( &mcast->timer, MCAST_IDLE_TIMEOUT );
+
+	return mcast_rx ( mcast, iobuf, meta );
+}
+
+/**
+ * Handle multicast transfer closing
+ *
+ * @v mcast		Multicast-first download
+ * @v rc		Reason for close
+ */
+static void mcast_multicast_close ( struct mcast_request *mcast, int rc ) {
+
+	/* A successful transfer has delivered the whole file */
+	if ( rc == 0 )
+		mcast->flags |= MCAST_FL_SIZE_KNOWN;
+
+	DBGC ( mcast, "MCAST %p multicast transfer closed: %s\n",
+	       mcast, strerror ( rc ) );
+	mcast_repair ( mcast );
+}
+
+/** Multicast transfer interface operations */
+static struct interface_operation mcast_multicast_operations[] = {
+	INTF_OP ( xfer_deliver, struct mcast_request *,
+		  mcast_multicast_deliver ),
+	INTF_OP ( intf_close, struct mcast_request *, mcast_multicast_close ),
+};
+
+/** Multicast transfer interface descriptor */
+static struct interface_descriptor mcast_multicast_desc =
+	INTF_DESC ( struct mcast_request, multicast,
+		    mcast_multicast_operations );
+
+/**
+ * Receive unicast repair data
+ *
+ * @v mcast		Multicast-first download
+ * @v iobuf		I/O buffer
+ * @v meta		Data transfer metadata
+ * @ret rc		Return status code
+ */
+static int mcast_repair_deliver ( struct mcast_request *mcast,
+				  struct io_buffer *iobuf,
+				  struct xfer_metadata *meta ) {
+	int rc;
+
+	/* Receive data */
+	if ( ( rc = mcast_rx ( mcast, iobuf, meta ) ) != 0 )
+		return rc;
+
+	/* Finish as soon as all gaps have been filled */
+	if ( mcast_is_complete ( mcast ) )
+		mcast_close ( mcast, 0 );
+
+	return 0;
+}
+
+/**
+ * Check unicast repair flow control window
+ *
+ * @v mcast		Multicast-first download
+ * @ret len		Length of window
+ */
+static size_t mcast_repair_window ( struct mcast_request *mcast ) {
+
+	/* Refuse stream data when using range requests.  This causes
+	 * the HTTP layer to wait for block commands.
+	 */
+	if ( mcast->flags & MCAST_FL_RANGED )
+		return 0;
+	return xfer_window ( &mcast->xfer );
+}
+
+/** Unicast repair interface operations */
+static struct interface_operation mcast_repair_operations[] = {
+	INTF_OP ( xfer_deliver, struct mcast_request *, mcast_repair_deliver ),
+	INTF_OP ( xfer_window, struct mcast_request *, mcast_repair_window ),
+	INTF_OP ( intf_close, struct mcast_request *, mcast_close ),
+};
+
+/** Unicast repair interface descriptor */
+static struct interface_descriptor mcast_repair_desc =
+	INTF_DESC ( struct mcast_request, repair, mcast_repair_operations );
+
+/**
+ * Handle completed range repair request
+ *
+ * @v mcast		Multicast-first download
+ * @v rc		Reason for close
+ */
+static void mcast_block_close ( struct mcast_request *mcast, int rc ) {
+	struct xfer_metadata meta;
+
+	/* Close data interface */
+	intf_restart ( &mcast->block, rc );
+
+	/* Abort on error */
+	if ( rc != 0 ) {
+		DBGC ( mcast, "MCAST %p range repair failed: %s\n",
+		       mcast, strerror ( rc ) );
+		mcast_close ( mcast, rc );
+		return;
+	}
+
+	/* Receive data and issue next request */
+	memset ( &meta, 0, sizeof ( meta ) );
+	meta.flags = XFER_FL_ABS_OFFSET;
+	meta.offset = mcast->offset;
+	if ( mcast_rx ( mcast, iob_disown ( mcast->iobuf ), &meta ) != 0 )
+		return;
+	process_add ( &mcast->process );
+}
+
+/** Unicast repair block data interface operations */
+static struct interface_operation mcast_block_operations[] = {
+	INTF_OP ( intf_close, struct mcast_request *, mcast_block_close ),
+};
+
+/** Unicast repair block data interface descriptor */
+static struct interface_descriptor mcast_block_desc =
+	INTF_DESC ( struct mcast_request, block, mcast_block_operations );
+
+/**
+ * Issue next range repair request
+ *
+ * @v mcast		Multicast-first download
+ */
+static void mcast_step ( struct mcast_request *mcast ) {
+	unsigned int first;
+	unsigned int count;
+	size_t len;
+	int rc;
+
+	/* Do nothing while a request is in progress */
+	if ( mcast->iobuf )
+		return;
+
+	/* Finish if all gaps have been filled */
+	if ( mcast_is_complete ( mcast ) ) {
+		mcast_close ( mcast, 0 );
+		return;
+	}
+
+	/* Wait until the block device is ready */
+	if ( ! xfer_window ( &mcast->repair ) )
+		return;
+	process_del ( &mcast->process );
+
+	/* Identify next contiguous gap */
+	first = bitmap_first_gap ( &mcast->bitmap );
+	count = 1;
+	while ( ( ( first + count ) < mcast->bitmap.length ) &&
+		( ! bitmap_test ( &mcast->bitmap, ( first + count ) ) ) &&
+		( ( ( count + 1 ) * MCAST_BLKSIZE ) <= MCAST_REPAIR_MAX_LEN ) )
+		count++;
+	mcast->offset = ( first * MCAST_BLKSIZE );
+	len = ( count * MCAST_BLKSIZE );
+	if ( len > ( mcast->filesize - mcast->offset ) )
+		len = ( mcast->filesize - mcast->offset );
+	DBGC2 ( mcast, "MCAST %p repairing [%zd,%zd)\n",
+		mcast, mcast->offset, ( mcast->offset + len ) );
+
+	/* Allocate buffer */
+	mcast->iobuf = alloc_iob ( len );
+	if ( ! mcast->iobuf ) {
+		rc = -ENOMEM;
+		goto err;
+	}
+	iob_put ( mcast->iobuf, len );
+
+	/* Issue request */
+	if ( ( rc = block_read ( &mcast->repair, &mcast->block, first, count,
+				 virt_to_user ( mcast->iobuf->data ),
+				 len ) ) != 0 ) {
+		DBGC ( mcast, "MCAST %p could not issue range repair: %s\n",
+		       mcast, strerror ( rc ) );
+		goto err;
+	}
+
+	return;
+
+ err:
+	mcast_close ( mcast, rc );
+}
+
+/** Range repair process descriptor */
+static struct process_descriptor mcast_process_desc =
+	PROC_DESC ( struct mcast_request, process, mcast_step );
+
+/** Data transfer interface operations */
+static struct interface_operation mcast_xfer_operations[] = {
+	INTF_OP ( intf_close, struct mcast_request *, mcast_close ),
+};
+
+/** Data transfer interface descriptor */
+static struct interface_descriptor mcast_xfer_desc =
+	INTF_DESC ( struct mcast_request, xfer, mcast_xfer_operations );
+
+/**
+ * Open multicast transfer
+ *
+ * @v mcast		Multicast-first download
+ * @ret rc		Return status code
+ */
+static int mcast_open_multicast ( struct mcast_request *mcast ) {
+	struct uri *uri = mcast->uri;
+	char *uri_string;
+	int len;
+	int rc;
+
+	/* Use configured multicast URI, if any, otherwise construct
+	 * an MTFTP URI from the unicast URI.
+	 */
+	len = fetch_string_setting_copy ( NULL, &mcast_uri_setting,
+					  &uri_string );
+	if ( len < 0 ) {
+		rc = len;
+		goto err_fetch;
+	}
+	if ( ! uri_string ) {
+		if ( ! ( uri->host && uri->path ) ) {
+			rc = -EINVAL;
+			goto err_construct;
+		}
+		if ( asprintf ( &uri_string, "mtftp://%s%s",
+				uri->host, uri->path ) < 0 ) {
+			rc = -ENOMEM;
+			goto err_construct;
+		}
+	}
+	DBGC ( mcast, "MCAST %p joining %s\n", mcast, uri_string );
+
+	/* Open multicast transfer */
+	if ( ( rc = xfer_open_uri_string ( &mcast->multicast,
+					   uri_string ) ) != 0 ) {
+		DBGC ( mcast, "MCAST %p could not open %s: %s\n",
+		       mcast, uri_string, strerror ( rc ) );
+		goto err_open;
+	}
+
+ err_open:
+	free ( uri_string );
+ err_construct:
+ err_fetch:
+	return rc;
+}
+
+/**
+ * Initiate multicast-first download
+ *
+ * @v xfer		Data transfer interface
+ * @v uri		Uniform Resource Identifier
+ * @ret rc		Return status code
+ */
+static int mcast_open ( struct interface *xfer, struct uri *uri ) {
+	struct mcast_request *mcast;
+	int rc;
+
+	/* Sanity check */
+	if ( ! uri->opaque )
+		return -EINVAL;
+
+	/* Allocate and populate structure */
+	mcast = zalloc ( sizeof ( *mcast ) );
+	if ( ! mcast ) {
+		rc = -ENOMEM;
+		goto err_alloc;
+	}
+	ref_init ( &mcast->refcnt, mcast_free );
+	intf_init ( &mcast->xfer, &mcast_xfer_desc, &mcast->refcnt );
+	intf_init ( &mcast->multicast, &mcast_multicast_desc,
+		    &mcast->refcnt );
+	intf_init ( &mcast->repair, &mcast_repair_desc, &mcast->refcnt );
+	intf_init ( &mcast->block, &mcast_block_desc, &mcast->refcnt );
+	process_init_stopped ( &mcast->process, &mcast_process_desc,
+			       &mcast->refcnt );
+	timer_init ( &mcast->timer, mcast_expired, &mcast->refcnt );
+
+	/* Parse unicast URI */
+	mcast->uri = parse_uri ( uri->opaque );
+	if ( ! mcast->uri ) {
+		rc = -ENOMEM;
+		goto err_parse;
+	}
+
+	/* Open multicast transfer.  Failure is not fatal, since the
+	 * file can still be downloaded via unicast.
+	 */
+	if ( ( rc = mcast_open_multicast ( mcast ) ) == 0 ) {
+		start_timer_fixed ( &mcast->timer, MCAST_IDLE_TIMEOUT );
+	} else {
+		start_timer_nodelay ( &mcast->timer );
+	}
+
+	/* Attach to parent interface, mortalise self, and return */
+	intf_plug_plug ( &mcast->xfer, xfer );
+	ref_put ( &mcast->refcnt );
+	return 0;
+
+ err_parse:
+	mcast_close ( mcast, rc );
+	ref_put ( &mcast->refcnt );
+ err_alloc:
+	return rc;
+}
+
+/** Multicast-first URI opener */
+struct uri_opener mcast_uri_opener __uri_opener = {
+	.scheme	= "mcast",
+	.open	= mcast_open,
+};
@@ -46,6 +46,12 @@ struct setting busid_setting __setting ( SETTING_NETDEV ) = {
 	.type = &setting_type_hex,
 	.tag = NETDEV_SETTING_TAG_BUS_ID,
 };
+struct setting mtu_setting __setting ( SETTING_NETDEV_EXTRA ) = {
+	.name = "mtu",
+	.description = "MTU",
+	.type = &setting_type_uint16,
+	.tag = DHCP_MTU,
+};
 
 /**
  * Check applicability of network device setting
@@ -79,6 +85,7 @@ static int netdev_store ( struct settings *settings, struct setting *setting,
 		if ( len != netdev->ll_protocol->ll_addr_len )
 			return -EINVAL;
 		memcpy ( netdev->ll_addr, data, len );
+		netdev_rx_filter ( netdev );
 		return 0;
 	}
 	if ( setting_cmp ( setting, &busid_setting ) == 0 )
@@ -138,3 +145,62 @@ struct settings_operations netdev_settings_operations = {
 	.fetch = netdev_fetch,
 	.clear = netdev_clear,
 };
+
+/**
+ * Apply network device settings
+ *
+ * @ret rc		Return status code
+ */
+static int apply_netdev_settings ( void ) {
+	struct net_device *netdev;
+	unsigned long mtu;
+	size_t max_mtu;
+	size_t old_mtu;
+	int rc;
+
+	/* Process settings for each network device */
+	for_each_netdev ( netdev ) {
+
+		/* Do nothing unless an MTU is specified */
+		if ( ( fetch_uint_setting ( netdev_settings ( netdev ),
+					    &mtu_setting, &mtu ) < 0 ) ||
+		     ( mtu == 0 ) )
+			continue;
+
+		/* Limit MTU to maximum supported by hardware */
+		max_mtu = ( netdev->max_pkt_len -
+			    netdev->ll_protocol->ll_header_len );
+		if ( mtu > max_mtu ) {
+			DBGC ( netdev, "NETDEV %s cannot support MTU %ld "
+			       "(maximum %zd)\n", netdev->name, mtu, max_mtu );
+			mtu = max_mtu;
+		}
+
+		/* Update MTU */
+		old_mtu = netdev->mtu;
+		if ( mtu == old_mtu )
+			continue;
+		netdev->mtu = mtu;
+		DBGC ( netdev, "NETDEV %s MTU is %zd\n",
+		       netdev->name, netdev->mtu );
+
+		/* Receive buffers are sized when the device is opened,
+		 * so reopen the device if the MTU has increased.
+		 */
+		if ( netdev_is_open ( netdev ) && ( mtu > old_mtu ) ) {
+			netdev_close ( netdev );
+			if ( ( rc = netdev_open ( netdev ) ) != 0 ) {
+				DBGC ( netdev, "NETDEV %s could not reopen: "
+				       "%s\n", netdev->name, strerror ( rc ) );
+				return rc;
+			}
+		}
+	}
+
+	return 0;
+}
+
+/** Network device settings applicator */
+struct settings_applicator netdev_applicator __settings_applicator = {
+	.apply = apply_netdev_settings,
+};
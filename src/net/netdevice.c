@@ -24,15 +24,24 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <byteswap.h>
 #include <string.h>
 #include <errno.h>
+#include <assert.h>
 #include <config/general.h>
 #include <ipxe/if_ether.h>
 #include <ipxe/iobuf.h>
 #include <ipxe/tables.h>
 #include <ipxe/process.h>
+#include <ipxe/retry.h>
+#include <ipxe/nap.h>
+#include <ipxe/console.h>
 #include <ipxe/init.h>
 #include <ipxe/device.h>
 #include <ipxe/errortab.h>
+#include <ipxe/malloc.h>
 #include <ipxe/netdevice.h>
+#include <ipxe/ethernet.h>
+#include <ipxe/profstat.h>
+#include <ipxe/timeline.h>
+#include <ipxe/trace.h>
 
 /** @file
  *
@@ -46,6 +55,27 @@ struct list_head net_devices = LIST_HEAD_INIT ( net_devices );
 /** List of open network devices, in reverse order of opening */
 static struct list_head open_net_devices = LIST_HEAD_INIT ( open_net_devices );
 
+/** Packet capture hook, or NULL if packets are not being captured */
+void ( * netdev_capture ) ( struct net_device *netdev,
+			    struct io_buffer *iobuf );
+
+/** Network device trace channel */
+static struct trace_channel netdev_trace __trace_channel = {
+	.name = "netdev",
+};
+
+/** Order of network-layer protocol lookup table size */
+#define NET_PROTO_HASH_ORDER 6
+
+/** Network-layer protocol lookup table size */
+#define NET_PROTO_HASH_SIZE ( 1 << NET_PROTO_HASH_ORDER )
+
+/** Network-layer protocol lookup table, indexed by protocol hash */
+static struct net_protocol *net_proto_hash[NET_PROTO_HASH_SIZE];
+
+/** Network-layer protocol lookup table has been constructed */
+static int net_proto_hashed;
+
 /** Default unknown link status code */
 #define EUNKNOWN_LINK_STATUS __einfo_error ( EINFO_EUNKNOWN_LINK_STATUS )
 #define EINFO_EUNKNOWN_LINK_STATUS \
@@ -99,6 +129,12 @@ static void netdev_notify ( struct net_device *netdev ) {
  */
 void netdev_link_err ( struct net_device *netdev, int rc ) {
 
+	/* Record link state transitions on the boot timeline */
+	if ( ( rc == 0 ) != ( netdev->link_rc == 0 ) ) {
+		timeline_mark ( "net", ( rc ? "link down" : "link up" ),
+				netdev, netdev->name );
+	}
+
 	/* Record link state */
 	netdev->link_rc = rc;
 	if ( netdev->link_rc == 0 ) {
@@ -177,11 +213,31 @@ static void netdev_record_stat ( struct net_device_stats *stats, int rc ) {
  * Transmits the packet via the specified network device.  This
  * function takes ownership of the I/O buffer.
  */
-int netdev_tx ( struct net_device *netdev, struct io_buffer *iobuf ) {
+int __hot netdev_tx ( struct net_device *netdev, struct io_buffer *iobuf ) {
+	struct io_buffer *linear;
 	int rc;
 
 	DBGC2 ( netdev, "NETDEV %s transmitting %p (%p+%zx)\n",
-		netdev->name, iobuf, iobuf->data, iob_len ( iobuf ) );
+		netdev->name, iobuf, iobuf->data, iob_total_len ( iobuf ) );
+
+	/* Linearise packet if it has more fragments than the driver
+	 * can handle.
+	 */
+	if ( iobuf->frag && ( iob_frags ( iobuf ) > netdev->max_tx_frags ) ) {
+		linear = iob_linearise ( iobuf );
+		if ( ! linear ) {
+			rc = -ENOMEM;
+			netdev_tx_err ( netdev, iobuf, rc );
+			return rc;
+		}
+		iobuf = linear;
+	}
+
+	/* Capture packet, if applicable */
+	if ( netdev_capture )
+		netdev_capture ( netdev, iobuf );
+	TRACE ( netdev_trace, netdev, "TX %p len %ld",
+		iobuf, iob_len ( iobuf ) );
 
 	/* Enqueue packet */
 	list_add_tail ( &iobuf->list, &netdev->tx_queue );
@@ -225,6 +281,7 @@ void netdev_tx_err ( struct net_device *netdev,
 
 	/* Update statistics counter */
 	netdev_record_stat ( &netdev->tx_stats, rc );
+	TRACE ( netdev_trace, netdev, "TX %p complete %ld", iobuf, rc );
 	if ( rc == 0 ) {
 		DBGC2 ( netdev, "NETDEV %s transmission %p complete\n",
 			netdev->name, iobuf );
@@ -296,7 +353,7 @@ static void netdev_tx_flush ( struct net_device *netdev ) {
  * The packet is added to the network device's RX queue.  This
  * function takes ownership of the I/O buffer.
  */
-void netdev_rx ( struct net_device *netdev, struct io_buffer *iobuf ) {
+void __hot netdev_rx ( struct net_device *netdev, struct io_buffer *iobuf ) {
 
 	DBGC2 ( netdev, "NETDEV %s received %p (%p+%zx)\n",
 		netdev->name, iobuf, iobuf->data, iob_len ( iobuf ) );
@@ -308,8 +365,19 @@ void netdev_rx ( struct net_device *netdev, struct io_buffer *iobuf ) {
 		return;
 	}
 
+	/* Capture packet, if applicable */
+	if ( netdev_capture )
+		netdev_capture ( netdev, iobuf );
+	TRACE ( netdev_trace, netdev, "RX %p len %ld",
+		iobuf, iob_len ( iobuf ) );
+
+	/* Ignore checksum verification claimed by an incapable device */
+	if ( ! ( netdev->state & NETDEV_RX_CSUM ) )
+		iobuf->flags &= ~IOB_CSUM_VERIFIED;
+
 	/* Enqueue packet */
 	list_add_tail ( &iobuf->list, &netdev->rx_queue );
+	netdev->rx_fill++;
 
 	/* Update statistics counter */
 	netdev_record_stat ( &netdev->rx_stats, 0 );
@@ -332,6 +400,7 @@ void netdev_rx_err ( struct net_device *netdev,
 
 	DBGC ( netdev, "NETDEV %s failed to receive %p: %s\n",
 	       netdev->name, iobuf, strerror ( rc ) );
+	TRACE ( netdev_trace, netdev, "RX %p failed %ld", iobuf, rc );
 
 	/* Discard packet */
 	free_iob ( iobuf );
@@ -340,6 +409,43 @@ void netdev_rx_err ( struct net_device *netdev,
 	netdev_record_stat ( &netdev->rx_stats, rc );
 }
 
+/**
+ * Choose receive descriptor ring size
+ *
+ * @v netdev		Network device
+ * @v buf_len		Length of each receive buffer
+ * @v min		Minimum number of descriptors
+ * @v max		Maximum number of descriptors
+ * @ret count		Number of descriptors
+ *
+ * Drivers should call this when opening the device, to choose how
+ * many receive buffers to keep posted.  The preferred ring size is
+ * reduced (by halving) until the receive buffers would occupy no
+ * more than a fixed fraction of the currently free memory.  If @c
+ * min, @c max and the preferred size are all powers of two, then
+ * the returned value will also be a power of two.
+ */
+unsigned int netdev_rx_ring_size ( struct net_device *netdev,
+				   size_t buf_len, unsigned int min,
+				   unsigned int max ) {
+	size_t limit = ( freemem / NETDEV_RX_RING_MEM );
+	unsigned int count = NETDEV_RX_RING_SIZE;
+
+	/* Scale down to fit within available memory */
+	while ( ( count > min ) && ( ( count * buf_len ) > limit ) )
+		count >>= 1;
+
+	/* Apply device limits */
+	if ( count < min )
+		count = min;
+	if ( count > max )
+		count = max;
+
+	DBGC ( netdev, "NETDEV %s using %d RX descriptors\n",
+	       netdev->name, count );
+	return count;
+}
+
 /**
  * Poll for completed and received packets on network device
  *
@@ -349,7 +455,7 @@ void netdev_rx_err ( struct net_device *netdev,
  * packets.  Any received packets will be added to the RX packet queue
  * via netdev_rx().
  */
-void netdev_poll ( struct net_device *netdev ) {
+void __hot netdev_poll ( struct net_device *netdev ) {
 
 	if ( netdev_is_open ( netdev ) )
 		netdev->op->poll ( netdev );
@@ -372,6 +478,7 @@ struct io_buffer * netdev_rx_dequeue ( struct net_device *netdev ) {
 		return NULL;
 
 	list_del ( &iobuf->list );
+	netdev->rx_fill--;
 	return iobuf;
 }
 
@@ -455,6 +562,12 @@ int register_netdev ( struct net_device *netdev ) {
 						 netdev->ll_addr );
 	}
 
+	/* Set default MTU, if not already set */
+	if ( ! netdev->mtu ) {
+		netdev->mtu = ( netdev->max_pkt_len -
+				netdev->ll_protocol->ll_header_len );
+	}
+
 	/* Add to device list */
 	netdev_get ( netdev );
 	list_add_tail ( &netdev->list, &net_devices );
@@ -597,6 +710,50 @@ void netdev_irq ( struct net_device *netdev, int enable ) {
 		netdev->state |= NETDEV_IRQ_ENABLED;
 }
 
+/**
+ * Update network device receive address filter
+ *
+ * @v netdev		Network device
+ *
+ * This should be called whenever the link-layer address or the
+ * promiscuous reception state changes.
+ */
+void netdev_rx_filter ( struct net_device *netdev ) {
+
+	/* Do nothing unless device is open and supports filtering */
+	if ( ! ( netdev_is_open ( netdev ) && netdev->op->filter ) )
+		return;
+
+	/* Reprogram receive filter */
+	netdev->op->filter ( netdev );
+}
+
+/**
+ * Request or release promiscuous reception
+ *
+ * @v netdev		Network device
+ * @v enable		Promiscuous reception is required
+ *
+ * Requests are counted; each request must eventually be balanced by
+ * a matching release.
+ */
+void netdev_rx_promisc ( struct net_device *netdev, int enable ) {
+
+	/* Update request count */
+	if ( enable ) {
+		netdev->rx_promisc++;
+	} else {
+		assert ( netdev->rx_promisc > 0 );
+		netdev->rx_promisc--;
+	}
+	DBGC ( netdev, "NETDEV %s promiscuous reception %s (%d)\n",
+	       netdev->name, ( enable ? "requested" : "released" ),
+	       netdev->rx_promisc );
+
+	/* Reprogram receive filter */
+	netdev_rx_filter ( netdev );
+}
+
 /**
  * Get network device by name
  *
@@ -651,6 +808,64 @@ struct net_device * last_opened_netdev ( void ) {
 	return netdev;
 }
 
+/**
+ * Add link-layer header
+ *
+ * @v netdev		Network device
+ * @v ll_protocol	Link-layer protocol
+ * @v iobuf		I/O buffer
+ * @v ll_dest		Destination link-layer address
+ * @v ll_source		Source link-layer address
+ * @v net_proto		Network-layer protocol, in network-byte order
+ * @ret rc		Return status code
+ *
+ * In builds with the Ethernet fast path enabled, the Ethernet method
+ * is called directly, and only other link-layer protocols are called
+ * via the method pointer.
+ */
+static inline __attribute__ (( always_inline )) int
+net_ll_push ( struct net_device *netdev, struct ll_protocol *ll_protocol,
+	      struct io_buffer *iobuf, const void *ll_dest,
+	      const void *ll_source, uint16_t net_proto ) {
+
+#ifdef NETDEV_FASTPATH_ETHERNET
+	if ( ll_protocol == &ethernet_protocol ) {
+		return eth_push ( netdev, iobuf, ll_dest, ll_source,
+				  net_proto );
+	}
+#endif
+	return ll_protocol->push ( netdev, iobuf, ll_dest, ll_source,
+				   net_proto );
+}
+
+/**
+ * Remove link-layer header
+ *
+ * @v netdev		Network device
+ * @v ll_protocol	Link-layer protocol
+ * @v iobuf		I/O buffer
+ * @ret ll_dest		Destination link-layer address
+ * @ret ll_source	Source link-layer address
+ * @ret net_proto	Network-layer protocol, in network-byte order
+ * @ret flags		Packet flags
+ * @ret rc		Return status code
+ */
+static inline __attribute__ (( always_inline )) int
+net_ll_pull ( struct net_device *netdev, struct ll_protocol *ll_protocol,
+	      struct io_buffer *iobuf, const void **ll_dest,
+	      const void **ll_source, uint16_t *net_proto,
+	      unsigned int *flags ) {
+
+#ifdef NETDEV_FASTPATH_ETHERNET
+	if ( ll_protocol == &ethernet_protocol ) {
+		return eth_pull ( netdev, iobuf, ll_dest, ll_source,
+				  net_proto, flags );
+	}
+#endif
+	return ll_protocol->pull ( netdev, iobuf, ll_dest, ll_source,
+				   net_proto, flags );
+}
+
 /**
  * Transmit network-layer packet
  *
@@ -669,6 +884,7 @@ int net_tx ( struct io_buffer *iobuf, struct net_device *netdev,
 	     struct net_protocol *net_protocol, const void *ll_dest,
 	     const void *ll_source ) {
 	struct ll_protocol *ll_protocol = netdev->ll_protocol;
+	size_t headroom;
 	int rc;
 
 	/* Force a poll on the netdevice to (potentially) clear any
@@ -678,9 +894,17 @@ int net_tx ( struct io_buffer *iobuf, struct net_device *netdev,
 	 */
 	netdev_poll ( netdev );
 
+	/* Check we can accommodate the link-layer headers */
+	headroom = netdev_headroom ( netdev );
+	if ( ( rc = iob_ensure_headroom ( iobuf, headroom ) ) != 0 ) {
+		netdev_tx_err ( netdev, iobuf, rc );
+		return rc;
+	}
+
 	/* Add link-layer header */
-	if ( ( rc = ll_protocol->push ( netdev, iobuf, ll_dest, ll_source,
-					net_protocol->net_proto ) ) != 0 ) {
+	if ( ( rc = net_ll_push ( netdev, ll_protocol, iobuf, ll_dest,
+				  ll_source,
+				  net_protocol->net_proto ) ) != 0 ) {
 		/* Record error for diagnosis */
 		netdev_tx_err ( netdev, iobuf, rc );
 		return rc;
@@ -690,6 +914,78 @@ int net_tx ( struct io_buffer *iobuf, struct net_device *netdev,
 	return netdev_tx ( netdev, iobuf );
 }
 
+/**
+ * Calculate network-layer protocol lookup table index
+ *
+ * @v net_proto		Network-layer protocol, in network-byte order
+ * @ret key		Lookup table index
+ */
+static inline __attribute__ (( always_inline )) unsigned int
+net_proto_key ( uint16_t net_proto ) {
+	return ( ( ( uint16_t ) ( net_proto * 0x9e37U ) ) >>
+		 ( 16 - NET_PROTO_HASH_ORDER ) );
+}
+
+/**
+ * Construct network-layer protocol lookup table
+ *
+ * The table is open-addressed with linear probing.  Since there are
+ * far fewer network-layer protocols than table entries, almost every
+ * protocol will be found at its home index.  Where two table entries
+ * claim the same protocol, the first entry takes precedence (as with
+ * a linear search of the linker table).
+ */
+static void net_proto_hash_build ( void ) {
+	struct net_protocol *net_protocol;
+	struct net_protocol *slot;
+	unsigned int key;
+	unsigned int i;
+
+	for_each_table_entry ( net_protocol, NET_PROTOCOLS ) {
+		key = net_proto_key ( net_protocol->net_proto );
+		for ( i = 0 ; i < NET_PROTO_HASH_SIZE ; i++ ) {
+			slot = net_proto_hash[key];
+			if ( ! slot ) {
+				net_proto_hash[key] = net_protocol;
+				break;
+			}
+			if ( slot->net_proto == net_protocol->net_proto )
+				break;
+			key = ( ( key + 1 ) & ( NET_PROTO_HASH_SIZE - 1 ) );
+		}
+		assert ( i < NET_PROTO_HASH_SIZE );
+	}
+	net_proto_hashed = 1;
+}
+
+/**
+ * Identify network-layer protocol
+ *
+ * @v net_proto		Network-layer protocol, in network-byte order
+ * @ret net_protocol	Network-layer protocol, or NULL
+ */
+static struct net_protocol * net_protocol_find ( uint16_t net_proto ) {
+	struct net_protocol *net_protocol;
+	unsigned int key;
+	unsigned int i;
+
+	/* Construct lookup table on first use */
+	if ( ! net_proto_hashed )
+		net_proto_hash_build();
+
+	/* Probe lookup table */
+	key = net_proto_key ( net_proto );
+	for ( i = 0 ; i < NET_PROTO_HASH_SIZE ; i++ ) {
+		net_protocol = net_proto_hash[key];
+		if ( ! net_protocol )
+			break;
+		if ( net_protocol->net_proto == net_proto )
+			return net_protocol;
+		key = ( ( key + 1 ) & ( NET_PROTO_HASH_SIZE - 1 ) );
+	}
+	return NULL;
+}
+
 /**
  * Process received network-layer packet
  *
@@ -701,16 +997,24 @@ int net_tx ( struct io_buffer *iobuf, struct net_device *netdev,
  * @v flags		Packet flags
  * @ret rc		Return status code
  */
-int net_rx ( struct io_buffer *iobuf, struct net_device *netdev,
-	     uint16_t net_proto, const void *ll_dest, const void *ll_source,
-	     unsigned int flags ) {
+int __hot net_rx ( struct io_buffer *iobuf, struct net_device *netdev,
+		   uint16_t net_proto, const void *ll_dest,
+		   const void *ll_source, unsigned int flags ) {
 	struct net_protocol *net_protocol;
+	union profiler profiler;
+	size_t len;
+	int rc;
 
 	/* Hand off to network-layer protocol, if any */
-	for_each_table_entry ( net_protocol, NET_PROTOCOLS ) {
-		if ( net_protocol->net_proto == net_proto )
-			return net_protocol->rx ( iobuf, netdev, ll_dest,
-						  ll_source, flags );
+	net_protocol = net_protocol_find ( net_proto );
+	if ( net_protocol ) {
+		len = iob_len ( iobuf );
+		profstat_start ( &profiler );
+		rc = net_protocol->rx ( iobuf, netdev, ll_dest, ll_source,
+					flags );
+		profstat_stop ( &profiler, "net", net_protocol,
+				net_protocol->name, len );
+		return rc;
 	}
 
 	DBGC ( netdev, "NETDEV %s unknown network protocol %04x\n",
@@ -719,20 +1023,105 @@ int net_rx ( struct io_buffer *iobuf, struct net_device *netdev,
 	return -ENOTSUP;
 }
 
+/**
+ * Coalesce following received packets into a received packet
+ *
+ * @v netdev		Network device
+ * @v iobuf		I/O buffer (may be reallocated)
+ * @v net_proto		Network-layer protocol, in network-byte order
+ * @v ll_dest		Link-layer destination address
+ * @v ll_source		Link-layer source address
+ * @v flags		Packet flags
+ * @v max		Maximum number of packets to coalesce
+ * @ret count		Number of packets coalesced
+ *
+ * Packets from the head of the receive queue that belong to the same
+ * flow as the specified packet (which has already had its link-layer
+ * header removed) are merged into it by the network-layer protocol,
+ * so that the upper layers process fewer, larger packets.  The
+ * link-layer addresses must not point into the I/O buffer, since it
+ * may be reallocated.
+ */
+static unsigned int net_coalesce ( struct net_device *netdev,
+				   struct io_buffer **iobuf,
+				   uint16_t net_proto, const void *ll_dest,
+				   const void *ll_source, unsigned int flags,
+				   unsigned int max ) {
+	struct ll_protocol *ll_protocol = netdev->ll_protocol;
+	struct net_protocol *net_protocol;
+	struct io_buffer *next;
+	const void *next_ll_dest;
+	const void *next_ll_source;
+	uint16_t next_net_proto;
+	unsigned int next_flags;
+	unsigned int count = 0;
+	void *data;
+
+	/* Identify network-layer protocol */
+	net_protocol = net_protocol_find ( net_proto );
+	if ( ( ! net_protocol ) || ( ! net_protocol->merge ) )
+		return 0;
+
+	/* Merge packets for as long as possible */
+	while ( count < max ) {
+
+		/* Examine next packet, without dequeueing it */
+		next = list_first_entry ( &netdev->rx_queue, struct io_buffer,
+					  list );
+		if ( ! next )
+			break;
+
+		/* Stop unless the link-layer headers match and the
+		 * network-layer protocol is able to merge the packet.
+		 * Any link-layer header removed from a packet that is
+		 * not merged must be restored, since the packet will
+		 * be processed normally.
+		 */
+		data = next->data;
+		if ( ( net_ll_pull ( netdev, ll_protocol, next, &next_ll_dest,
+				     &next_ll_source, &next_net_proto,
+				     &next_flags ) != 0 ) ||
+		     ( next_net_proto != net_proto ) ||
+		     ( next_flags != flags ) ||
+		     ( memcmp ( next_ll_dest, ll_dest,
+				ll_protocol->ll_addr_len ) != 0 ) ||
+		     ( memcmp ( next_ll_source, ll_source,
+				ll_protocol->ll_addr_len ) != 0 ) ||
+		     ( net_protocol->merge ( iobuf, next,
+					     NETDEV_RX_COALESCE_LEN ) != 0 ) ) {
+			next->data = data;
+			break;
+		}
+
+		/* Discard merged packet */
+		DBGC2 ( netdev, "NETDEV %s merged %p into %p\n",
+			netdev->name, next, *iobuf );
+		list_del ( &next->list );
+		netdev->rx_fill--;
+		free_iob ( next );
+		count++;
+	}
+
+	return count;
+}
+
 /**
  * Poll the network stack
  *
  * This polls all interfaces for received packets, and processes
  * packets from the RX queue.
  */
-void net_poll ( void ) {
+void __hot net_poll ( void ) {
 	struct net_device *netdev;
 	struct io_buffer *iobuf;
 	struct ll_protocol *ll_protocol;
+	uint8_t ll_dest_buf[MAX_LL_ADDR_LEN];
+	uint8_t ll_source_buf[MAX_LL_ADDR_LEN];
 	const void *ll_dest;
 	const void *ll_source;
 	uint16_t net_proto;
 	unsigned int flags;
+	unsigned int budget;
 	int rc;
 
 	/* Poll and process each network device */
@@ -750,13 +1139,22 @@ void net_poll ( void ) {
 		if ( netdev_rx_frozen ( netdev ) )
 			continue;
 
-		/* Process at most one received packet.  Give priority
-		 * to getting packets out of the NIC over processing
-		 * the received packets, because we advertise a window
-		 * that assumes that we can receive packets from the
-		 * NIC faster than they arrive.
+		/* Process at most NETDEV_RX_BUDGET received packets.
+		 * Give priority to getting packets out of the NIC
+		 * over processing the received packets, because we
+		 * advertise a window that assumes that we can receive
+		 * packets from the NIC faster than they arrive.
+		 * Processing a batch of packets per poll allows the
+		 * receive queue to drain before small descriptor
+		 * rings overflow, while the budget prevents a single
+		 * device from starving the rest of the system.
 		 */
-		if ( ( iobuf = netdev_rx_dequeue ( netdev ) ) ) {
+		for ( budget = NETDEV_RX_BUDGET ; budget ; budget-- ) {
+
+			/* Stop when there are no more received packets */
+			iobuf = netdev_rx_dequeue ( netdev );
+			if ( ! iobuf )
+				break;
 
 			DBGC2 ( netdev, "NETDEV %s processing %p (%p+%zx)\n",
 				netdev->name, iobuf, iobuf->data,
@@ -764,14 +1162,34 @@ void net_poll ( void ) {
 
 			/* Remove link-layer header */
 			ll_protocol = netdev->ll_protocol;
-			if ( ( rc = ll_protocol->pull ( netdev, iobuf,
-							&ll_dest, &ll_source,
-							&net_proto,
-							&flags ) ) != 0 ) {
+			if ( ( rc = net_ll_pull ( netdev, ll_protocol, iobuf,
+						  &ll_dest, &ll_source,
+						  &net_proto,
+						  &flags ) ) != 0 ) {
 				free_iob ( iobuf );
 				continue;
 			}
 
+			/* Coalesce any following packets from the same
+			 * flow, counting them against the budget.  The
+			 * link-layer addresses are copied out first,
+			 * since the I/O buffer may be reallocated.
+			 */
+			if ( NETDEV_RX_COALESCE_LEN &&
+			     ( budget > 1 ) &&
+			     ( ! list_empty ( &netdev->rx_queue ) ) ) {
+				memcpy ( ll_dest_buf, ll_dest,
+					 ll_protocol->ll_addr_len );
+				memcpy ( ll_source_buf, ll_source,
+					 ll_protocol->ll_addr_len );
+				ll_dest = ll_dest_buf;
+				ll_source = ll_source_buf;
+				budget -= net_coalesce ( netdev, &iobuf,
+							 net_proto, ll_dest,
+							 ll_source, flags,
+							 ( budget - 1 ) );
+			}
+
 			/* Hand packet to network layer */
 			if ( ( rc = net_rx ( iob_disown ( iobuf ), netdev,
 					     net_proto, ll_dest,
@@ -780,6 +1198,59 @@ void net_poll ( void ) {
 				netdev_rx_err ( netdev, NULL, rc );
 			}
 		}
+
+		/* Record budget exhaustion for diagnosis */
+		if ( ( budget == 0 ) && ( ! list_empty ( &netdev->rx_queue ) ) )
+			netdev->rx_budget_exhausted++;
+	}
+}
+
+/**
+ * Nap until the next interrupt, if idle
+ *
+ * Nothing is done if any process has work pending, if any open
+ * network device has queued packets, or if console input is waiting.  Devices able to wake the CPU
+ * have their interrupts enabled for the duration of the nap, so that
+ * received packets are still processed promptly.  Packets received
+ * on any other device will not be noticed until the next timer
+ * interrupt, so we nap only if no timers are running (e.g. while
+ * waiting at a menu, rather than mid-transfer).
+ */
+static void net_nap ( void ) {
+	struct net_device *netdev;
+	int wake = 1;
+
+	/* Do nothing unless idle */
+	if ( process_busy() || iskey() )
+		return;
+	list_for_each_entry ( netdev, &open_net_devices, open_list ) {
+		if ( ! ( list_empty ( &netdev->tx_queue ) &&
+			 list_empty ( &netdev->rx_queue ) ) )
+			return;
+		if ( ! ( netdev->state & NETDEV_IRQ_WAKE ) )
+			wake = 0;
+	}
+	if ( ( ! wake ) && timers_running() )
+		return;
+
+	/* Enable interrupts on devices able to wake the CPU */
+	list_for_each_entry ( netdev, &open_net_devices, open_list ) {
+		if ( ( netdev->state & NETDEV_IRQ_WAKE ) &&
+		     ! netdev_irq_enabled ( netdev ) ) {
+			netdev_irq ( netdev, 1 );
+			netdev->state |= NETDEV_IRQ_NAP;
+		}
+	}
+
+	/* Nap until next interrupt */
+	cpu_nap();
+
+	/* Restore interrupt state */
+	list_for_each_entry ( netdev, &open_net_devices, open_list ) {
+		if ( netdev->state & NETDEV_IRQ_NAP ) {
+			netdev->state &= ~NETDEV_IRQ_NAP;
+			netdev_irq ( netdev, 0 );
+		}
 	}
 }
 
@@ -790,7 +1261,8 @@ void net_poll ( void ) {
  */
 static void net_step ( struct process *process __unused ) {
 	net_poll();
+	net_nap();
 }
 
 /** Networking stack process */
-PERMANENT_PROCESS ( net_process, net_step );
+PRIORITY_PROCESS ( net_process, net_step );
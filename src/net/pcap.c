@@ -0,0 +1,353 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <time.h>
+#include <byteswap.h>
+#include <ipxe/uaccess.h>
+#include <ipxe/umalloc.h>
+#include <ipxe/iobuf.h>
+#include <ipxe/if_arp.h>
+#include <ipxe/netdevice.h>
+#include <ipxe/timer.h>
+#include <ipxe/profile.h>
+#include <ipxe/image.h>
+#include <ipxe/pcap.h>
+
+/** @file
+ *
+ * Packet capture
+ *
+ * Packets are captured into a fixed-size ring buffer as they are
+ * transmitted and received.  When the ring buffer is full, the
+ * oldest packets are discarded to make room.  The ring buffer
+ * contents may be saved as a pcap image at any time.
+ *
+ * Captured packets are timestamped using the CPU timestamp counter,
+ * which is converted to a wall-clock time only when the image is
+ * saved.  This keeps the cost of capturing each packet to little
+ * more than a copy of its headers.
+ */
+
+/** A captured packet */
+struct pcap_entry {
+	/** CPU timestamp counter */
+	uint64_t tsc;
+	/** Captured length */
+	uint32_t len;
+	/** Original length */
+	uint32_t orig_len;
+} __attribute__ (( packed ));
+
+/** A packet capture ring buffer */
+struct pcap_ring {
+	/** Data buffer */
+	userptr_t data;
+	/** Length of data buffer (a power of two) */
+	size_t size;
+	/** Producer counter */
+	size_t prod;
+	/** Consumer counter */
+	size_t cons;
+	/** Maximum captured length of each packet */
+	size_t snaplen;
+	/** Network device to capture, or NULL to capture all devices */
+	struct net_device *netdev;
+	/** Number of captured packets */
+	unsigned int count;
+	/** Number of packets discarded to make room */
+	unsigned int discarded;
+	/** CPU timestamp counter at start of capture */
+	uint64_t start_tsc;
+	/** Timer tick at start of capture */
+	unsigned long start_ticks;
+	/** Wall-clock time at start of capture */
+	time_t start_time;
+};
+
+/** Packet capture ring buffer */
+static struct pcap_ring pcap_ring;
+
+/**
+ * Copy data into packet capture ring buffer
+ *
+ * @v offset		Producer offset
+ * @v data		Data
+ * @v len		Length of data
+ */
+static void pcap_copy_in ( size_t offset, const void *data, size_t len ) {
+	size_t index = ( offset & ( pcap_ring.size - 1 ) );
+	size_t frag_len = ( pcap_ring.size - index );
+
+	if ( frag_len > len )
+		frag_len = len;
+	copy_to_user ( pcap_ring.data, index, data, frag_len );
+	copy_to_user ( pcap_ring.data, 0, ( data + frag_len ),
+		       ( len - frag_len ) );
+}
+
+/**
+ * Copy data out of packet capture ring buffer
+ *
+ * @v offset		Consumer offset
+ * @v data		Data buffer
+ * @v len		Length of data
+ */
+static void pcap_copy_out ( size_t offset, void *data, size_t len ) {
+	size_t index = ( offset & ( pcap_ring.size - 1 ) );
+	size_t frag_len = ( pcap_ring.size - index );
+
+	if ( frag_len > len )
+		frag_len = len;
+	copy_from_user ( data, pcap_ring.data, index, frag_len );
+	copy_from_user ( ( data + frag_len ), pcap_ring.data, 0,
+			 ( len - frag_len ) );
+}
+
+/**
+ * Capture packet
+ *
+ * @v netdev		Network device
+ * @v iobuf		I/O buffer
+ */
+static void pcap_capture ( struct net_device *netdev,
+			   struct io_buffer *iobuf ) {
+	struct pcap_entry entry;
+	struct pcap_entry oldest;
+	union profiler now;
+	size_t remaining;
+	size_t offset;
+	size_t len;
+
+	/* Ignore packets on other or non-Ethernet network devices */
+	if ( pcap_ring.netdev && ( netdev != pcap_ring.netdev ) )
+		return;
+	if ( netdev->ll_protocol->ll_proto != htons ( ARPHRD_ETHER ) )
+		return;
+
+	/* Construct entry header */
+	profile ( &now );
+	entry.tsc = now.timestamp;
+	entry.orig_len = iob_total_len ( iobuf );
+	entry.len = entry.orig_len;
+	if ( entry.len > pcap_ring.snaplen )
+		entry.len = pcap_ring.snaplen;
+
+	/* Discard oldest entries to make room */
+	len = ( sizeof ( entry ) + entry.len );
+	while ( ( pcap_ring.prod + len - pcap_ring.cons ) > pcap_ring.size ) {
+		pcap_copy_out ( pcap_ring.cons, &oldest, sizeof ( oldest ) );
+		pcap_ring.cons += ( sizeof ( oldest ) + oldest.len );
+		pcap_ring.discarded++;
+	}
+
+	/* Copy in entry header and (truncated) packet data */
+	offset = pcap_ring.prod;
+	pcap_copy_in ( offset, &entry, sizeof ( entry ) );
+	offset += sizeof ( entry );
+	for ( remaining = entry.len ; remaining ; iobuf = iobuf->frag ) {
+		len = iob_len ( iobuf );
+		if ( len > remaining )
+			len = remaining;
+		pcap_copy_in ( offset, iobuf->data, len );
+		offset += len;
+		remaining -= len;
+	}
+	pcap_ring.prod = offset;
+	pcap_ring.count++;
+}
+
+/**
+ * Start capturing packets
+ *
+ * @v netdev		Network device to capture, or NULL for all devices
+ * @v size		Capture buffer size
+ * @v snaplen		Maximum captured length of each packet
+ * @ret rc		Return status code
+ *
+ * Any previously captured packets are discarded.
+ */
+int pcap_start ( struct net_device *netdev, size_t size, size_t snaplen ) {
+	union profiler now;
+
+	/* Stop any existing capture and free buffer */
+	pcap_stop();
+	ufree ( pcap_ring.data );
+	memset ( &pcap_ring, 0, sizeof ( pcap_ring ) );
+
+	/* Round buffer size up to a power of two, large enough to
+	 * hold at least one maximum-length packet.
+	 */
+	if ( ! snaplen )
+		return -EINVAL;
+	if ( size < ( sizeof ( struct pcap_entry ) + snaplen ) )
+		size = ( sizeof ( struct pcap_entry ) + snaplen );
+	size = ( 1UL << fls ( size - 1 ) );
+
+	/* Allocate buffer */
+	pcap_ring.data = umalloc ( size );
+	if ( ! pcap_ring.data )
+		return -ENOMEM;
+	pcap_ring.size = size;
+	pcap_ring.snaplen = snaplen;
+	pcap_ring.netdev = netdev_get ( netdev );
+
+	/* Record starting time */
+	profile ( &now );
+	pcap_ring.start_tsc = now.timestamp;
+	pcap_ring.start_ticks = currticks();
+	pcap_ring.start_time = time ( NULL );
+
+	/* Start capturing */
+	netdev_capture = pcap_capture;
+	DBGC ( &pcap_ring, "PCAP capturing %s using %zd bytes (snaplen %zd)\n",
+	       ( netdev ? netdev->name : "all devices" ), size, snaplen );
+
+	return 0;
+}
+
+/**
+ * Stop capturing packets
+ *
+ * Captured packets are retained until capture is restarted.
+ */
+void pcap_stop ( void ) {
+
+	/* Stop capturing */
+	if ( ! netdev_capture )
+		return;
+	netdev_capture = NULL;
+	DBGC ( &pcap_ring, "PCAP stopped after %d packets (%d discarded)\n",
+	       pcap_ring.count, pcap_ring.discarded );
+
+	/* Drop network device reference */
+	netdev_put ( pcap_ring.netdev );
+	pcap_ring.netdev = NULL;
+}
+
+/**
+ * Save captured packets as a pcap image
+ *
+ * @v name		Image name
+ * @ret rc		Return status code
+ */
+int pcap_save ( const char *name ) {
+	struct pcap_header header;
+	struct pcap_record record;
+	struct pcap_entry entry;
+	struct image *existing;
+	struct image *image;
+	union profiler now;
+	unsigned long ticks;
+	uint64_t tsc_per_usec;
+	uint64_t usec;
+	size_t remaining;
+	size_t offset;
+	size_t len;
+	size_t cons;
+	uint8_t buf[64];
+	int rc;
+
+	/* Calculate timestamp counter frequency from elapsed time */
+	profile ( &now );
+	ticks = ( currticks() - pcap_ring.start_ticks );
+	tsc_per_usec = 0;
+	if ( ticks ) {
+		tsc_per_usec = ( ( ( now.timestamp - pcap_ring.start_tsc ) *
+				   TICKS_PER_SEC ) / ( ticks * 1000000ULL ) );
+	}
+	if ( ! tsc_per_usec )
+		tsc_per_usec = 1;
+
+	/* Allocate image */
+	image = alloc_image ( NULL );
+	if ( ! image ) {
+		rc = -ENOMEM;
+		goto err_alloc_image;
+	}
+	if ( ( rc = image_set_name ( image, name ) ) != 0 )
+		goto err_set_name;
+	len = ( sizeof ( header ) + ( pcap_ring.prod - pcap_ring.cons ) );
+	image->data = umalloc ( len );
+	if ( ! image->data ) {
+		rc = -ENOMEM;
+		goto err_umalloc;
+	}
+	image->len = len;
+
+	/* Construct file header */
+	memset ( &header, 0, sizeof ( header ) );
+	header.magic = PCAP_MAGIC;
+	header.major = PCAP_VERSION_MAJOR;
+	header.minor = PCAP_VERSION_MINOR;
+	header.snaplen = pcap_ring.snaplen;
+	header.linktype = PCAP_LINKTYPE_ETHERNET;
+	copy_to_user ( image->data, 0, &header, sizeof ( header ) );
+	offset = sizeof ( header );
+
+	/* Construct packet records */
+	for ( cons = pcap_ring.cons ; cons != pcap_ring.prod ; ) {
+		pcap_copy_out ( cons, &entry, sizeof ( entry ) );
+		cons += sizeof ( entry );
+		usec = ( ( entry.tsc - pcap_ring.start_tsc ) / tsc_per_usec );
+		record.sec = ( pcap_ring.start_time + ( usec / 1000000 ) );
+		record.usec = ( usec % 1000000 );
+		record.len = entry.len;
+		record.orig_len = entry.orig_len;
+		copy_to_user ( image->data, offset, &record,
+			       sizeof ( record ) );
+		offset += sizeof ( record );
+		for ( remaining = entry.len ; remaining ; remaining -= len ) {
+			len = remaining;
+			if ( len > sizeof ( buf ) )
+				len = sizeof ( buf );
+			pcap_copy_out ( cons, buf, len );
+			copy_to_user ( image->data, offset, buf, len );
+			cons += len;
+			offset += len;
+		}
+	}
+
+	/* Replace any existing image of the same name */
+	if ( ( existing = find_image ( name ) ) != NULL )
+		unregister_image ( existing );
+
+	/* Register image */
+	if ( ( rc = register_image ( image ) ) != 0 )
+		goto err_register_image;
+	DBGC ( &pcap_ring, "PCAP saved %d packets as %s\n",
+	       ( pcap_ring.count - pcap_ring.discarded ), image->name );
+
+	/* Drop our reference to the image */
+	image_put ( image );
+
+	return 0;
+
+ err_register_image:
+ err_umalloc:
+ err_set_name:
+	image_put ( image );
+ err_alloc_image:
+	return rc;
+}
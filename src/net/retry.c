@@ -44,9 +44,45 @@ FILE_LICENCE ( GPL2_OR_LATER );
  */
 #define MIN_TIMEOUT 7
 
-/** List of running timers */
+/** List of running timers
+ *
+ * This list is kept sorted in order of expiry time, so that the
+ * retry timer process needs to examine only the head of the list.
+ */
 static LIST_HEAD ( timers );
 
+/**
+ * Check if timer has expired
+ *
+ * @v timer		Retry timer
+ * @v now		Current time
+ * @ret expired		Timer has expired
+ */
+static inline __attribute__ (( always_inline )) int
+timer_has_expired ( struct retry_timer *timer, unsigned long now ) {
+	return ( ( now - timer->start ) >= timer->timeout );
+}
+
+/**
+ * Add timer to list of running timers
+ *
+ * @v timer		Retry timer
+ *
+ * The timer is inserted after all timers expiring at or before the
+ * same time, so that timers with identical expiry times will fire in
+ * the order in which they were started.
+ */
+static void timer_enqueue ( struct retry_timer *timer ) {
+	unsigned long expiry = ( timer->start + timer->timeout );
+	struct retry_timer *tmp;
+
+	list_for_each_entry ( tmp, &timers, list ) {
+		if ( ( ( long ) ( ( tmp->start + tmp->timeout ) - expiry ) ) > 0 )
+			break;
+	}
+	list_add_tail ( &timer->list, &tmp->list );
+}
+
 /**
  * Start timer
  *
@@ -57,8 +93,9 @@ static LIST_HEAD ( timers );
  * be stopped and the timer's callback function will be called.
  */
 void start_timer ( struct retry_timer *timer ) {
-	if ( ! timer->running ) {
-		list_add ( &timer->list, &timers );
+	if ( timer->running ) {
+		list_del ( &timer->list );
+	} else {
 		ref_get ( timer->refcnt );
 	}
 	timer->start = currticks();
@@ -74,6 +111,9 @@ void start_timer ( struct retry_timer *timer ) {
 	if ( timer->timeout < timer->min_timeout )
 		timer->timeout = timer->min_timeout;
 
+	/* Add to list of running timers */
+	timer_enqueue ( timer );
+
 	DBG2 ( "Timer %p started at time %ld (expires at %ld)\n",
 	       timer, timer->start, ( timer->start + timer->timeout ) );
 }
@@ -87,10 +127,21 @@ void start_timer ( struct retry_timer *timer ) {
 void start_timer_fixed ( struct retry_timer *timer, unsigned long timeout ) {
 	start_timer ( timer );
 	timer->timeout = timeout;
+	list_del ( &timer->list );
+	timer_enqueue ( timer );
 	DBG2 ( "Timer %p expiry time changed to %ld\n",
 	       timer, ( timer->start + timer->timeout ) );
 }
 
+/**
+ * Check if any timers are running
+ *
+ * @ret running		At least one timer is running
+ */
+int timers_running ( void ) {
+	return ( ! list_empty ( &timers ) );
+}
+
 /**
  * Stop timer
  *
@@ -181,21 +232,32 @@ static void timer_expired ( struct retry_timer *timer ) {
  * @v process		Retry timer process
  */
 static void retry_step ( struct process *process __unused ) {
+	LIST_HEAD ( expired );
 	struct retry_timer *timer;
+	struct retry_timer *tmp;
 	unsigned long now = currticks();
-	unsigned long used;
 
-	/* Process at most one timer expiry.  We cannot process
-	 * multiple expiries in one pass, because one timer expiring
-	 * may end up triggering another timer's deletion from the
-	 * list.
+	/* Move all currently expired timers to a private list.  Since
+	 * the list of running timers is sorted by expiry time, the
+	 * expired timers form a prefix of the list.
 	 */
-	list_for_each_entry ( timer, &timers, list ) {
-		used = ( now - timer->start );
-		if ( used >= timer->timeout ) {
-			timer_expired ( timer );
+	list_for_each_entry_safe ( timer, tmp, &timers, list ) {
+		if ( ! timer_has_expired ( timer, now ) )
 			break;
-		}
+		list_del ( &timer->list );
+		list_add_tail ( &timer->list, &expired );
+	}
+
+	/* Process each expired timer.  An expiry callback may stop
+	 * or restart any other timer (including those remaining on
+	 * the private list), so we must re-examine the head of the
+	 * private list after each callback.  Any timer restarted by
+	 * a callback will be returned to the list of running timers,
+	 * and so will not be processed again until the next pass.
+	 */
+	while ( ( timer = list_first_entry ( &expired, struct retry_timer,
+					     list ) ) ) {
+		timer_expired ( timer );
 	}
 }
 
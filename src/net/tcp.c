@@ -10,11 +10,17 @@
 #include <ipxe/retry.h>
 #include <ipxe/refcnt.h>
 #include <ipxe/xfer.h>
+#include <ipxe/process.h>
 #include <ipxe/open.h>
 #include <ipxe/uri.h>
 #include <ipxe/netdevice.h>
+#include <ipxe/init.h>
 #include <ipxe/tcpip.h>
 #include <ipxe/tcp.h>
+#include <ipxe/netstat.h>
+#include <ipxe/timeline.h>
+#include <ipxe/trace.h>
+#include <config/general.h>
 
 /** @file
  *
@@ -30,6 +36,8 @@ struct tcp_connection {
 	struct refcnt refcnt;
 	/** List of TCP connections */
 	struct list_head list;
+	/** List of TCP connections within hash bucket */
+	struct list_head hash;
 
 	/** Flags */
 	unsigned int flags;
@@ -59,11 +67,22 @@ struct tcp_connection {
 	 * Equivalent to (SND.NXT-SND.UNA) in RFC 793 terminology.
 	 */
 	uint32_t snd_sent;
+	/** Highest sequence number sent (in host-endian order)
+	 *
+	 * Equivalent to SND.MAX in BSD terminology.  This may exceed
+	 * SND.NXT following a retransmission timeout.
+	 */
+	uint32_t snd_max;
 	/** Send window
 	 *
 	 * Equivalent to SND.WND in RFC 793 terminology
 	 */
 	uint32_t snd_win;
+	/** Send window scale
+	 *
+	 * Equivalent to Snd.Wind.Scale in RFC 1323 terminology
+	 */
+	uint8_t snd_win_scale;
 	/** Current acknowledgement number
 	 *
 	 * Equivalent to RCV.NXT in RFC 793 terminology.
@@ -74,6 +93,31 @@ struct tcp_connection {
 	 * Equivalent to RCV.WND in RFC 793 terminology.
 	 */
 	uint32_t rcv_win;
+	/** Receive window scale
+	 *
+	 * Equivalent to Rcv.Wind.Scale in RFC 1323 terminology
+	 */
+	uint8_t rcv_win_scale;
+	/** Received data not yet acknowledged (in bytes)
+	 *
+	 * Used to decide when a delayed acknowledgement must be sent.
+	 */
+	uint32_t rcv_unacked;
+	/** Maximum segment size
+	 *
+	 * Derived from the MTU of the route to the peer, and
+	 * advertised to the peer.
+	 */
+	size_t mss;
+	/** Sender maximum segment size
+	 *
+	 * Equivalent to SMSS in RFC 5681 terminology.
+	 */
+	size_t snd_mss;
+	/** Fast Open cookie length, or zero if no cookie is cached */
+	size_t fastopen_len;
+	/** Fast Open cookie */
+	uint8_t fastopen[TCP_FASTOPEN_COOKIE_MAX];
 	/** Received timestamp value
 	 *
 	 * Updated when a packet is received; copied to ts_recent when
@@ -85,6 +129,33 @@ struct tcp_connection {
 	 * Equivalent to TS.Recent in RFC 1323 terminology.
 	 */
 	uint32_t ts_recent;
+	/** Received timestamp echo reply, or zero if not present */
+	uint32_t ts_ecr;
+
+	/** Congestion window
+	 *
+	 * Equivalent to cwnd in RFC 5681 terminology.
+	 */
+	uint32_t cwnd;
+	/** Slow start threshold
+	 *
+	 * Equivalent to ssthresh in RFC 5681 terminology.
+	 */
+	uint32_t ssthresh;
+	/** Recovery point
+	 *
+	 * Equivalent to recover in RFC 6582 terminology.
+	 */
+	uint32_t recover;
+	/** Number of consecutive duplicate ACKs received */
+	unsigned int dupacks;
+	/** Smoothed round-trip time (in ticks, scaled by 8) */
+	unsigned long srtt;
+	/** Round-trip time variation (in ticks, scaled by 4) */
+	unsigned long rttvar;
+
+	/** Selective acknowledgement list (in network-endian order) */
+	struct tcp_sack_block sack[TCP_SACK_MAX];
 
 	/** Transmit queue */
 	struct list_head tx_queue;
@@ -94,6 +165,10 @@ struct tcp_connection {
 	struct retry_timer timer;
 	/** Shutdown (TIME_WAIT) timer */
 	struct retry_timer wait;
+	/** Delayed acknowledgement timer */
+	struct retry_timer delack;
+	/** Deferred transmission process */
+	struct process process;
 };
 
 /** TCP flags */
@@ -104,6 +179,16 @@ enum tcp_flags {
 	TCP_TS_ENABLED = 0x0002,
 	/** TCP acknowledgement is pending */
 	TCP_ACK_PENDING = 0x0004,
+	/** TCP selective acknowledgement is enabled */
+	TCP_SACK_ENABLED = 0x0008,
+	/** TCP is in fast recovery */
+	TCP_FAST_RECOVERY = 0x0010,
+	/** TCP round-trip time has been measured */
+	TCP_RTT_MEASURED = 0x0020,
+	/** TCP Fast Open is enabled */
+	TCP_FASTOPEN_ENABLED = 0x0040,
+	/** TCP SYN was sent with Fast Open data */
+	TCP_FASTOPEN_DATA = 0x0080,
 };
 
 /** TCP internal header
@@ -118,6 +203,8 @@ struct tcp_rx_queued_header {
 	 * enqueued, and so excludes the SYN, if present.
 	 */
 	uint32_t seq;
+	/** Next SEQ value, in host-endian order */
+	uint32_t nxt;
 	/** Flags
 	 *
 	 * Only FIN is valid within this flags byte; all other flags
@@ -134,12 +221,58 @@ struct tcp_rx_queued_header {
  */
 static LIST_HEAD ( tcp_conns );
 
+/** TCP statistics (aggregated over all connections) */
+struct tcp_statistics tcp_stats;
+
+/** TCP trace channel */
+static struct trace_channel tcp_trace __trace_channel = {
+	.name = "tcp",
+};
+
+/** A cached TCP Fast Open cookie */
+struct tcp_fastopen_cache {
+	/** Server address, or zero address family if entry is unused */
+	struct sockaddr_tcpip peer;
+	/** Server's maximum segment size */
+	size_t mss;
+	/** Time at which cookie was received */
+	unsigned long received;
+	/** Cookie length */
+	size_t len;
+	/** Cookie */
+	uint8_t cookie[TCP_FASTOPEN_COOKIE_MAX];
+};
+
+/** Cached TCP Fast Open cookies */
+static struct tcp_fastopen_cache tcp_fastopen_cookies[TCP_FASTOPEN];
+
+/** Number of TCP connection hash buckets (must be a power of two) */
+#define TCP_HASH_SIZE 16
+
+/** TCP connection hash buckets, indexed by local port */
+static struct list_head tcp_hash[TCP_HASH_SIZE];
+
+/**
+ * Get TCP connection hash bucket
+ *
+ * @v local_port	Local port
+ * @ret bucket		Hash bucket
+ */
+static inline __attribute__ (( always_inline )) struct list_head *
+tcp_bucket ( unsigned int local_port ) {
+	return &tcp_hash[ ( local_port ^ ( local_port >> 8 ) ) &
+			  ( TCP_HASH_SIZE - 1 ) ];
+}
+
 /* Forward declarations */
 static struct interface_descriptor tcp_xfer_desc;
+static struct process_descriptor tcp_process_desc;
 static void tcp_expired ( struct retry_timer *timer, int over );
 static void tcp_wait_expired ( struct retry_timer *timer, int over );
+static void tcp_delack_expired ( struct retry_timer *timer, int over );
 static int tcp_rx_ack ( struct tcp_connection *tcp, uint32_t ack,
-			uint32_t win );
+			uint32_t win, uint32_t seq_len );
+static struct tcp_connection * tcp_demux ( unsigned int local_port );
 
 /**
  * Name TCP state
@@ -168,6 +301,8 @@ tcp_state ( int state ) {
  * Dump TCP state transition
  *
  * @v tcp		TCP connection
+ *
+ * The connection setup is also recorded on the boot timeline.
  */
 static inline __attribute__ (( always_inline )) void
 tcp_dump_state ( struct tcp_connection *tcp ) {
@@ -176,6 +311,12 @@ tcp_dump_state ( struct tcp_connection *tcp ) {
 		DBGC ( tcp, "TCP %p transitioned from %s to %s\n", tcp,
 		       tcp_state ( tcp->prev_tcp_state ),
 		       tcp_state ( tcp->tcp_state ) );
+		if ( tcp->tcp_state == TCP_SYN_SENT ) {
+			timeline_begin ( "net", "tcp connect", tcp, NULL );
+		} else if ( tcp->prev_tcp_state == TCP_SYN_SENT ) {
+			timeline_end ( "net", "tcp connect", tcp,
+				       tcp_state ( tcp->tcp_state ) );
+		}
 	}
 	tcp->prev_tcp_state = tcp->tcp_state;
 }
@@ -199,6 +340,90 @@ tcp_dump_flags ( struct tcp_connection *tcp, unsigned int flags ) {
 		DBGC2 ( tcp, " ACK" );
 }
 
+/***************************************************************************
+ *
+ * Fast Open cookie cache
+ *
+ ***************************************************************************
+ */
+
+/**
+ * Find cached Fast Open cookie
+ *
+ * @v peer		Server address
+ * @ret cache		Cached cookie, or NULL
+ */
+static struct tcp_fastopen_cache *
+tcp_fastopen_find ( struct sockaddr_tcpip *peer ) {
+	struct tcp_fastopen_cache *cache;
+	unsigned int i;
+
+	for ( i = 0 ; i < TCP_FASTOPEN ; i++ ) {
+		cache = &tcp_fastopen_cookies[i];
+		if ( memcmp ( &cache->peer, peer,
+			      sizeof ( cache->peer ) ) == 0 )
+			return cache;
+	}
+	return NULL;
+}
+
+/**
+ * Record Fast Open cookie
+ *
+ * @v tcp		TCP connection
+ * @v foopt		Fast Open option
+ *
+ * The least recently received cookie will be replaced if the cache
+ * is full.
+ */
+static void tcp_fastopen_put ( struct tcp_connection *tcp,
+			       const struct tcp_fastopen_option *foopt ) {
+	struct tcp_fastopen_cache *cache;
+	unsigned long now = currticks();
+	size_t len;
+	unsigned int i;
+
+	/* Ignore options not containing a valid cookie */
+	if ( foopt->length < sizeof ( *foopt ) )
+		return;
+	len = ( foopt->length - sizeof ( *foopt ) );
+	if ( ( len < TCP_FASTOPEN_COOKIE_MIN ) ||
+	     ( len > TCP_FASTOPEN_COOKIE_MAX ) ) {
+		DBGC ( tcp, "TCP %p ignoring %zd-byte Fast Open cookie\n",
+		       tcp, len );
+		return;
+	}
+
+	/* Use existing entry for this server, or an empty or the
+	 * oldest entry.
+	 */
+	cache = tcp_fastopen_find ( &tcp->peer );
+	if ( ( ! cache ) && TCP_FASTOPEN ) {
+		cache = &tcp_fastopen_cookies[0];
+		for ( i = 0 ; i < TCP_FASTOPEN ; i++ ) {
+			if ( ! tcp_fastopen_cookies[i].peer.st_family ) {
+				cache = &tcp_fastopen_cookies[i];
+				break;
+			}
+			if ( ( now - tcp_fastopen_cookies[i].received ) >
+			     ( now - cache->received ) )
+				cache = &tcp_fastopen_cookies[i];
+		}
+	}
+	if ( ! cache )
+		return;
+
+	/* Record cookie */
+	memcpy ( &cache->peer, &tcp->peer, sizeof ( cache->peer ) );
+	cache->mss = tcp->snd_mss;
+	cache->received = now;
+	cache->len = len;
+	memcpy ( cache->cookie, ( ( ( void * ) foopt ) + sizeof ( *foopt ) ),
+		 len );
+	DBGC ( tcp, "TCP %p received Fast Open cookie:\n", tcp );
+	DBGC_HDA ( tcp, 0, cache->cookie, cache->len );
+}
+
 /***************************************************************************
  *
  * Open and close
@@ -217,7 +442,6 @@ tcp_dump_flags ( struct tcp_connection *tcp, unsigned int flags ) {
  * between 1024 and 65535.
  */
 static int tcp_bind ( struct tcp_connection *tcp, unsigned int port ) {
-	struct tcp_connection *existing;
 	uint16_t try_port;
 	unsigned int i;
 
@@ -236,12 +460,10 @@ static int tcp_bind ( struct tcp_connection *tcp, unsigned int port ) {
 	}
 
 	/* Attempt bind to local port */
-	list_for_each_entry ( existing, &tcp_conns, list ) {
-		if ( existing->local_port == port ) {
-			DBGC ( tcp, "TCP %p could not bind: port %d in use\n",
-			       tcp, port );
-			return -EADDRINUSE;
-		}
+	if ( tcp_demux ( port ) ) {
+		DBGC ( tcp, "TCP %p could not bind: port %d in use\n",
+		       tcp, port );
+		return -EADDRINUSE;
 	}
 	tcp->local_port = port;
 
@@ -255,14 +477,17 @@ static int tcp_bind ( struct tcp_connection *tcp, unsigned int port ) {
  * @v xfer		Data transfer interface
  * @v peer		Peer socket address
  * @v local		Local socket address, or NULL
+ * @v flags		Initial connection flags
  * @ret rc		Return status code
  */
 static int tcp_open ( struct interface *xfer, struct sockaddr *peer,
-		      struct sockaddr *local ) {
+		      struct sockaddr *local, unsigned int flags ) {
 	struct sockaddr_tcpip *st_peer = ( struct sockaddr_tcpip * ) peer;
 	struct sockaddr_tcpip *st_local = ( struct sockaddr_tcpip * ) local;
+	struct tcp_fastopen_cache *cache;
 	struct tcp_connection *tcp;
 	unsigned int bind_port;
+	size_t mtu;
 	int rc;
 
 	/* Allocate and initialise structure */
@@ -274,27 +499,58 @@ static int tcp_open ( struct interface *xfer, struct sockaddr *peer,
 	intf_init ( &tcp->xfer, &tcp_xfer_desc, &tcp->refcnt );
 	timer_init ( &tcp->timer, tcp_expired, &tcp->refcnt );
 	timer_init ( &tcp->wait, tcp_wait_expired, &tcp->refcnt );
+	timer_init ( &tcp->delack, tcp_delack_expired, &tcp->refcnt );
+	process_init_stopped ( &tcp->process, &tcp_process_desc,
+			       &tcp->refcnt );
+	tcp->flags = flags;
 	tcp->prev_tcp_state = TCP_CLOSED;
 	tcp->tcp_state = TCP_STATE_SENT ( TCP_SYN );
 	tcp_dump_state ( tcp );
 	tcp->snd_seq = random();
+	tcp->snd_max = tcp->snd_seq;
+	tcp->recover = tcp->snd_seq;
 	INIT_LIST_HEAD ( &tcp->tx_queue );
 	INIT_LIST_HEAD ( &tcp->rx_queue );
 	memcpy ( &tcp->peer, st_peer, sizeof ( tcp->peer ) );
 
+	/* Derive maximum segment size from route to peer */
+	mtu = tcpip_mtu ( &tcp->peer );
+	tcp->mss = ( ( mtu > sizeof ( struct tcp_header ) ) ?
+		     ( mtu - sizeof ( struct tcp_header ) ) : TCP_MSS );
+	tcp->snd_mss = ( ( tcp->mss < TCP_MSS ) ? tcp->mss : TCP_MSS );
+	DBGC ( tcp, "TCP %p using MSS %zd\n", tcp, tcp->mss );
+
+	/* Use any cached Fast Open cookie */
+	if ( ( flags & TCP_FASTOPEN_ENABLED ) &&
+	     ( ( cache = tcp_fastopen_find ( &tcp->peer ) ) != NULL ) ) {
+		memcpy ( tcp->fastopen, cache->cookie, cache->len );
+		tcp->fastopen_len = cache->len;
+		if ( tcp->snd_mss > cache->mss )
+			tcp->snd_mss = cache->mss;
+		DBGC ( tcp, "TCP %p using Fast Open cookie:\n", tcp );
+		DBGC_HDA ( tcp, 0, tcp->fastopen, tcp->fastopen_len );
+	}
+
 	/* Bind to local port */
 	bind_port = ( st_local ? ntohs ( st_local->st_port ) : 0 );
 	if ( ( rc = tcp_bind ( tcp, bind_port ) ) != 0 )
 		goto err;
 
-	/* Start timer to initiate SYN */
-	start_timer_nodelay ( &tcp->timer );
+	/* Start timer to initiate SYN.  If data may be sent within
+	 * the SYN, allow the application time to deliver it.
+	 */
+	if ( tcp->fastopen_len ) {
+		start_timer_fixed ( &tcp->timer, TCP_FASTOPEN_DELAY );
+	} else {
+		start_timer_nodelay ( &tcp->timer );
+	}
 
 	/* Attach parent interface, transfer reference to connection
 	 * list and return
 	 */
 	intf_plug_plug ( &tcp->xfer, xfer );
 	list_add ( &tcp->list, &tcp_conns );
+	list_add ( &tcp->hash, tcp_bucket ( tcp->local_port ) );
 	return 0;
 
  err:
@@ -343,7 +599,10 @@ static void tcp_close ( struct tcp_connection *tcp, int rc ) {
 
 		/* Remove from list and drop reference */
 		stop_timer ( &tcp->timer );
+		stop_timer ( &tcp->delack );
+		process_del ( &tcp->process );
 		list_del ( &tcp->list );
+		list_del ( &tcp->hash );
 		ref_put ( &tcp->refcnt );
 		DBGC ( tcp, "TCP %p connection deleted\n", tcp );
 		return;
@@ -354,7 +613,7 @@ static void tcp_close ( struct tcp_connection *tcp, int rc ) {
 	 * can send a FIN without breaking things.
 	 */
 	if ( ! ( tcp->tcp_state & TCP_STATE_ACKED ( TCP_SYN ) ) )
-		tcp_rx_ack ( tcp, ( tcp->snd_seq + 1 ), 0 );
+		tcp_rx_ack ( tcp, ( tcp->snd_seq + 1 ), 0, 0 );
 
 	/* If we have no data remaining to send, start sending FIN */
 	if ( list_empty ( &tcp->tx_queue ) ) {
@@ -370,6 +629,76 @@ static void tcp_close ( struct tcp_connection *tcp, int rc ) {
  ***************************************************************************
  */
 
+/**
+ * Calculate maximum segment payload length
+ *
+ * @v tcp		TCP connection
+ * @ret max_len		Maximum payload length of a single packet
+ */
+static size_t tcp_xmit_max_len ( struct tcp_connection *tcp ) {
+	size_t max_len;
+
+	/* The MSS does not include space for TCP options */
+	max_len = tcp->snd_mss;
+	if ( ( tcp->flags & TCP_TS_ENABLED ) &&
+	     ( max_len > sizeof ( struct tcp_timestamp_padded_option ) ) )
+		max_len -= sizeof ( struct tcp_timestamp_padded_option );
+
+	return max_len;
+}
+
+/**
+ * Calculate length of Fast Open option
+ *
+ * @v tcp		TCP connection
+ * @ret len		Length of padded Fast Open option
+ */
+static size_t tcp_fastopen_option_len ( struct tcp_connection *tcp ) {
+
+	return ( ( sizeof ( struct tcp_fastopen_option ) +
+		   tcp->fastopen_len + 3 ) & ~3 );
+}
+
+/**
+ * Calculate length of data that may be sent within SYN
+ *
+ * @v tcp		TCP connection
+ * @ret len		Maximum payload length of SYN
+ *
+ * Data may be sent only within the initial SYN, and only if a Fast
+ * Open cookie is available.
+ */
+static size_t tcp_fastopen_len ( struct tcp_connection *tcp ) {
+	size_t overhead;
+
+	/* Check that this is the initial SYN of a Fast Open connection */
+	if ( ( tcp->tcp_state != TCP_SYN_SENT ) || ( ! tcp->fastopen_len ) ||
+	     ( tcp->snd_max != tcp->snd_seq ) )
+		return 0;
+
+	/* Allow for SYN options */
+	overhead = ( sizeof ( struct tcp_mss_option ) +
+		     sizeof ( struct tcp_window_scale_padded_option ) +
+		     sizeof ( struct tcp_sack_permitted_padded_option ) +
+		     sizeof ( struct tcp_timestamp_padded_option ) +
+		     tcp_fastopen_option_len ( tcp ) );
+	return ( ( tcp->snd_mss > overhead ) ? ( tcp->snd_mss - overhead ) : 0);
+}
+
+/**
+ * Calculate total transmission window
+ *
+ * @v tcp		TCP connection
+ * @ret win		Amount of data that may be outstanding
+ */
+static size_t tcp_snd_window ( struct tcp_connection *tcp ) {
+
+	/* Window is the minimum of the receiver's window and the
+	 * congestion window.
+	 */
+	return ( ( tcp->snd_win < tcp->cwnd ) ? tcp->snd_win : tcp->cwnd );
+}
+
 /**
  * Calculate transmission window
  *
@@ -377,20 +706,41 @@ static void tcp_close ( struct tcp_connection *tcp, int rc ) {
  * @ret len		Maximum length that can be sent in a single packet
  */
 static size_t tcp_xmit_win ( struct tcp_connection *tcp ) {
+	size_t max_len;
+	size_t win;
 	size_t len;
 
 	/* Not ready if we're not in a suitable connection state */
 	if ( ! TCP_CAN_SEND_DATA ( tcp->tcp_state ) )
 		return 0;
 
-	/* Length is the minimum of the receiver's window and the path MTU */
-	len = tcp->snd_win;
-	if ( len > TCP_PATH_MTU )
-		len = TCP_PATH_MTU;
+	/* Length is the minimum of the remaining window and the MSS */
+	win = tcp_snd_window ( tcp );
+	if ( win <= tcp->snd_sent )
+		return 0;
+	len = ( win - tcp->snd_sent );
+	max_len = tcp_xmit_max_len ( tcp );
+	if ( len > max_len )
+		len = max_len;
 
 	return len;
 }
 
+/**
+ * Calculate length of data held in transmit queue
+ *
+ * @v tcp		TCP connection
+ * @ret len		Length of queued data
+ */
+static size_t tcp_tx_queue_len ( struct tcp_connection *tcp ) {
+	struct io_buffer *iobuf;
+	size_t len = 0;
+
+	list_for_each_entry ( iobuf, &tcp->tx_queue, list )
+		len += iob_len ( iobuf );
+	return len;
+}
+
 /**
  * Check data-transfer flow control window
  *
@@ -398,47 +748,75 @@ static size_t tcp_xmit_win ( struct tcp_connection *tcp ) {
  * @ret len		Length of window
  */
 static size_t tcp_xfer_window ( struct tcp_connection *tcp ) {
+	size_t win;
+	size_t len;
 
-	/* Not ready if data queue is non-empty.  This imposes a limit
-	 * of only one unACKed packet in the TX queue at any time; we
-	 * do this to conserve memory usage.
+	/* Allow initial data to be queued for transmission within the
+	 * SYN, if applicable.
 	 */
-	if ( ! list_empty ( &tcp->tx_queue ) )
+	if ( ( win = tcp_fastopen_len ( tcp ) ) != 0 ) {
+		len = tcp_tx_queue_len ( tcp );
+		return ( ( win > len ) ? ( win - len ) : 0 );
+	}
+
+	/* Not ready if we're not in a suitable connection state */
+	if ( ! TCP_CAN_SEND_DATA ( tcp->tcp_state ) )
 		return 0;
 
-	/* Return TCP window length */
-	return tcp_xmit_win ( tcp );
+	/* Allow the transmit queue to hold no more than can be
+	 * outstanding at any time; we do this to conserve memory
+	 * usage.  Each byte in flight may occupy heap memory twice
+	 * (once in the transmit queue and once in a transmitted
+	 * packet awaiting completion), so limit the queue further
+	 * according to the amount of free heap memory.
+	 */
+	win = tcp_snd_window ( tcp );
+	if ( win > ( freemem / 4 ) )
+		win = ( freemem / 4 );
+	len = tcp_tx_queue_len ( tcp );
+	return ( ( win > len ) ? ( win - len ) : 0 );
 }
 
 /**
  * Process TCP transmit queue
  *
  * @v tcp		TCP connection
+ * @v offset		Offset within transmit queue
  * @v max_len		Maximum length to process
  * @v dest		I/O buffer to fill with data, or NULL
  * @v remove		Remove data from queue
  * @ret len		Length of data processed
  *
  * This processes at most @c max_len bytes from the TCP connection's
- * transmit queue.  Data will be copied into the @c dest I/O buffer
- * (if provided) and, if @c remove is true, removed from the transmit
- * queue.
+ * transmit queue, starting at @c offset bytes from the first
+ * unacknowledged byte.  Data will be copied into the @c dest I/O
+ * buffer (if provided) and, if @c remove is true, removed from the
+ * transmit queue.  Data may be removed only from the start of the
+ * transmit queue.
  */
-static size_t tcp_process_tx_queue ( struct tcp_connection *tcp, size_t max_len,
+static size_t tcp_process_tx_queue ( struct tcp_connection *tcp,
+				     size_t offset, size_t max_len,
 				     struct io_buffer *dest, int remove ) {
 	struct io_buffer *iobuf;
 	struct io_buffer *tmp;
 	size_t frag_len;
 	size_t len = 0;
 
+	assert ( ! ( remove && offset ) );
 	list_for_each_entry_safe ( iobuf, tmp, &tcp->tx_queue, list ) {
 		frag_len = iob_len ( iobuf );
+		if ( offset && ( offset >= frag_len ) ) {
+			offset -= frag_len;
+			continue;
+		}
+		frag_len -= offset;
 		if ( frag_len > max_len )
 			frag_len = max_len;
 		if ( dest ) {
-			memcpy ( iob_put ( dest, frag_len ), iobuf->data,
-				 frag_len );
+			memcpy ( iob_put ( dest, frag_len ),
+				 ( iobuf->data + offset ), frag_len );
 		}
+		offset = 0;
 		if ( remove ) {
 			iob_pull ( iobuf, frag_len );
 			if ( ! iob_len ( iobuf ) ) {
@@ -453,73 +831,223 @@ static size_t tcp_process_tx_queue ( struct tcp_connection *tcp, size_t max_len,
 }
 
 /**
- * Transmit any outstanding data
+ * Add payload data from transmit queue to outgoing segment
  *
  * @v tcp		TCP connection
- * 
- * Transmits any outstanding data on the connection.
+ * @v iobuf		I/O buffer
+ * @v offset		Offset within transmit queue
+ * @v len		Length of payload data
  *
- * Note that even if an error is returned, the retransmission timer
- * will have been started if necessary, and so the stack will
- * eventually attempt to retransmit the failed packet.
+ * Larger payloads are attached to the I/O buffer as a chain of
+ * fragments referring directly to the data held within the transmit
+ * queue, avoiding the need to copy the data.  Smaller payloads (or
+ * any payload for which the fragments cannot be allocated) are
+ * copied into the I/O buffer, which must have sufficient tailroom.
  */
-static int tcp_xmit ( struct tcp_connection *tcp ) {
+static void tcp_xmit_payload ( struct tcp_connection *tcp,
+			       struct io_buffer *iobuf, size_t offset,
+			       size_t len ) {
+	struct io_buffer *queued;
+	struct io_buffer *frag;
+	struct io_buffer **next = &iobuf->frag;
+	size_t remaining = len;
+	size_t skip = offset;
+	size_t frag_len;
+
+	/* Attach larger payloads by reference */
+	if ( len >= TCP_TX_REF_MIN_LEN ) {
+		list_for_each_entry ( queued, &tcp->tx_queue, list ) {
+			if ( ! remaining )
+				break;
+			frag_len = iob_len ( queued );
+			if ( skip >= frag_len ) {
+				skip -= frag_len;
+				continue;
+			}
+			frag_len -= skip;
+			if ( frag_len > remaining )
+				frag_len = remaining;
+			frag = alloc_iob_ref ( queued, ( queued->data + skip ),
+					       frag_len );
+			skip = 0;
+			if ( ! frag )
+				break;
+			*next = frag;
+			next = &frag->frag;
+			remaining -= frag_len;
+		}
+		if ( ! remaining )
+			return;
+
+		/* Fall back to copying the whole payload */
+		free_iob ( iobuf->frag );
+		iobuf->frag = NULL;
+	}
+
+	/* Copy payload */
+	tcp_process_tx_queue ( tcp, offset, len, iobuf, 0 );
+}
+
+/**
+ * Find selective acknowledgement block
+ *
+ * @v tcp		TCP connection
+ * @v seq		SEQ value in SACK block (in host-endian order)
+ * @v sack		SACK block to fill in (in host-endian order)
+ * @ret len		Length of SACK block
+ */
+static uint32_t tcp_sack_block ( struct tcp_connection *tcp, uint32_t seq,
+				 struct tcp_sack_block *sack ) {
+	struct io_buffer *iobuf;
+	struct tcp_rx_queued_header *tcpqhdr;
+	uint32_t left = tcp->rcv_ack;
+	uint32_t right = left;
+
+	/* Find highest block which does not start after SEQ */
+	list_for_each_entry ( iobuf, &tcp->rx_queue, list ) {
+		tcpqhdr = iobuf->data;
+		if ( tcp_cmp ( tcpqhdr->seq, right ) > 0 ) {
+			if ( tcp_cmp ( tcpqhdr->seq, seq ) > 0 )
+				break;
+			left = tcpqhdr->seq;
+		}
+		if ( tcp_cmp ( tcpqhdr->nxt, right ) > 0 )
+			right = tcpqhdr->nxt;
+	}
+
+	/* Fail if this block does not contain SEQ */
+	if ( tcp_cmp ( right, seq ) < 0 )
+		return 0;
+
+	/* Populate SACK block */
+	sack->left = left;
+	sack->right = right;
+	return ( right - left );
+}
+
+/**
+ * Update TCP selective acknowledgement list
+ *
+ * @v tcp		TCP connection
+ * @v seq		SEQ value in first SACK block (in host-endian order)
+ * @ret count		Number of selective acknowledgement blocks
+ *
+ * As required by RFC 2018, the first SACK block reported is the one
+ * containing the most recently received segment, followed by the
+ * most recently reported blocks that have not yet been acknowledged.
+ */
+static unsigned int tcp_sack ( struct tcp_connection *tcp, uint32_t seq ) {
+	struct tcp_sack_block sack[TCP_SACK_MAX];
+	unsigned int old = 0;
+	unsigned int new = 0;
+	unsigned int i;
+	uint32_t len;
+
+	/* Populate first new SACK block */
+	len = tcp_sack_block ( tcp, seq, &sack[0] );
+	if ( len )
+		new++;
+
+	/* Populate remaining new SACK blocks based on old SACK blocks */
+	for ( old = 0 ; old < TCP_SACK_MAX ; old++ ) {
+
+		/* Stop if we run out of space in the new list */
+		if ( new == TCP_SACK_MAX )
+			break;
+
+		/* Skip empty old SACK blocks */
+		if ( tcp->sack[old].left == tcp->sack[old].right )
+			continue;
+
+		/* Populate new SACK block */
+		len = tcp_sack_block ( tcp, ntohl ( tcp->sack[old].left ),
+				       &sack[new] );
+		if ( len == 0 )
+			continue;
+
+		/* Eliminate duplicates */
+		for ( i = 0 ; i < new ; i++ ) {
+			if ( sack[i].left == sack[new].left )
+				break;
+		}
+		if ( i == new )
+			new++;
+	}
+
+	/* Update SACK list */
+	memset ( tcp->sack, 0, sizeof ( tcp->sack ) );
+	for ( i = 0 ; i < new ; i++ ) {
+		tcp->sack[i].left = htonl ( sack[i].left );
+		tcp->sack[i].right = htonl ( sack[i].right );
+	}
+	return new;
+}
+
+/**
+ * Determine required transmit headroom
+ *
+ * @v st_dest		Destination address
+ * @ret headroom	Headroom required for all headers
+ */
+static size_t tcp_headroom ( struct sockaddr_tcpip *st_dest ) {
+	size_t headroom;
+
+	headroom = ( TCP_MAX_HEADER_LEN - MAX_LL_NET_HEADER_LEN +
+		     tcpip_headroom ( st_dest ) );
+	if ( headroom < TCP_MAX_HEADER_LEN )
+		headroom = TCP_MAX_HEADER_LEN;
+	return headroom;
+}
+
+/**
+ * Transmit segment
+ *
+ * @v tcp		TCP connection
+ * @v offset		Offset of segment from first unacknowledged byte
+ * @v len		Length of payload data
+ * @v flags		TCP flags
+ * @v sack_seq		SEQ for first selective acknowledgement (if any)
+ * @ret rc		Return status code
+ */
+static int tcp_xmit_segment ( struct tcp_connection *tcp, uint32_t offset,
+			      size_t len, unsigned int flags,
+			      uint32_t sack_seq ) {
 	struct io_buffer *iobuf;
 	struct tcp_header *tcphdr;
 	struct tcp_mss_option *mssopt;
+	struct tcp_window_scale_padded_option *wsopt;
+	struct tcp_sack_permitted_padded_option *spopt;
 	struct tcp_timestamp_padded_option *tsopt;
+	struct tcp_sack_padded_option *sackopt;
+	struct tcp_fastopen_option *foopt;
 	void *payload;
-	unsigned int flags;
-	size_t len = 0;
+	void *pad;
+	size_t pad_len;
+	unsigned int sack_count;
+	size_t sack_len;
+	size_t headroom;
+	uint32_t seq = ( tcp->snd_seq + offset );
 	uint32_t seq_len;
 	uint32_t app_win;
 	uint32_t max_rcv_win;
+	uint32_t max_representable_win;
 	int rc;
 
-	/* If retransmission timer is already running, do nothing */
-	if ( timer_running ( &tcp->timer ) )
-		return 0;
-
-	/* Calculate both the actual (payload) and sequence space
-	 * lengths that we wish to transmit.
-	 */
-	if ( TCP_CAN_SEND_DATA ( tcp->tcp_state ) ) {
-		len = tcp_process_tx_queue ( tcp, tcp_xmit_win ( tcp ),
-					     NULL, 0 );
-	}
-	seq_len = len;
-	flags = TCP_FLAGS_SENDING ( tcp->tcp_state );
-	if ( flags & ( TCP_SYN | TCP_FIN ) ) {
-		/* SYN or FIN consume one byte, and we can never send both */
-		assert ( ! ( ( flags & TCP_SYN ) && ( flags & TCP_FIN ) ) );
-		seq_len++;
-	}
-	tcp->snd_sent = seq_len;
-
-	/* If we have nothing to transmit, stop now */
-	if ( ( seq_len == 0 ) && ! ( tcp->flags & TCP_ACK_PENDING ) )
-		return 0;
-
-	/* If we are transmitting anything that requires
-	 * acknowledgement (i.e. consumes sequence space), start the
-	 * retransmission timer.  Do this before attempting to
-	 * allocate the I/O buffer, in case allocation itself fails.
-	 */
-	if ( seq_len )
-		start_timer ( &tcp->timer );
+	/* Calculate sequence space length */
+	seq_len = ( len + ( ( flags & ( TCP_SYN | TCP_FIN ) ) ? 1 : 0 ) );
 
 	/* Allocate I/O buffer */
-	iobuf = alloc_iob ( len + TCP_MAX_HEADER_LEN );
+	headroom = tcp_headroom ( &tcp->peer );
+	iobuf = alloc_iob ( len + headroom );
 	if ( ! iobuf ) {
 		DBGC ( tcp, "TCP %p could not allocate iobuf for %08x..%08x "
-		       "%08x\n", tcp, tcp->snd_seq, ( tcp->snd_seq + seq_len ),
-		       tcp->rcv_ack );
+		       "%08x\n", tcp, seq, ( seq + seq_len ), tcp->rcv_ack );
 		return -ENOMEM;
 	}
-	iob_reserve ( iobuf, TCP_MAX_HEADER_LEN );
+	iob_reserve ( iobuf, headroom );
 
 	/* Fill data payload from transmit queue */
-	tcp_process_tx_queue ( tcp, len, iobuf, 0 );
+	tcp_xmit_payload ( tcp, iobuf, offset, len );
 
 	/* Expand receive window if possible */
 	max_rcv_win = ( ( freemem * 3 ) / 4 );
@@ -528,6 +1056,9 @@ static int tcp_xmit ( struct tcp_connection *tcp ) {
 	app_win = xfer_window ( &tcp->xfer );
 	if ( max_rcv_win > app_win )
 		max_rcv_win = app_win;
+	max_representable_win = ( 0xffff << tcp->rcv_win_scale );
+	if ( max_rcv_win > max_representable_win )
+		max_rcv_win = max_representable_win;
 	max_rcv_win &= ~0x03; /* Keep everything dword-aligned */
 	if ( tcp->rcv_win < max_rcv_win )
 		tcp->rcv_win = max_rcv_win;
@@ -538,7 +1069,28 @@ static int tcp_xmit ( struct tcp_connection *tcp ) {
 		mssopt = iob_push ( iobuf, sizeof ( *mssopt ) );
 		mssopt->kind = TCP_OPTION_MSS;
 		mssopt->length = sizeof ( *mssopt );
-		mssopt->mss = htons ( TCP_MSS );
+		mssopt->mss = htons ( tcp->mss );
+		wsopt = iob_push ( iobuf, sizeof ( *wsopt ) );
+		wsopt->nop[0] = TCP_OPTION_NOP;
+		wsopt->wsopt.kind = TCP_OPTION_WS;
+		wsopt->wsopt.length = sizeof ( wsopt->wsopt );
+		wsopt->wsopt.scale = TCP_RX_WINDOW_SCALE;
+		spopt = iob_push ( iobuf, sizeof ( *spopt ) );
+		memset ( spopt->nop, TCP_OPTION_NOP, sizeof ( spopt->nop ) );
+		spopt->spopt.kind = TCP_OPTION_SACK_PERMITTED;
+		spopt->spopt.length = sizeof ( spopt->spopt );
+		if ( tcp->flags & TCP_FASTOPEN_ENABLED ) {
+			pad_len = tcp_fastopen_option_len ( tcp );
+			pad = iob_push ( iobuf, pad_len );
+			memset ( pad, TCP_OPTION_NOP, pad_len );
+			foopt = ( pad + pad_len -
+				  ( sizeof ( *foopt ) + tcp->fastopen_len ) );
+			foopt->kind = TCP_OPTION_FASTOPEN;
+			foopt->length = ( sizeof ( *foopt ) +
+					  tcp->fastopen_len );
+			memcpy ( ( ( ( void * ) foopt ) + sizeof ( *foopt ) ),
+				 tcp->fastopen, tcp->fastopen_len );
+		}
 	}
 	if ( ( flags & TCP_SYN ) || ( tcp->flags & TCP_TS_ENABLED ) ) {
 		tsopt = iob_push ( iobuf, sizeof ( *tsopt ) );
@@ -548,18 +1100,34 @@ static int tcp_xmit ( struct tcp_connection *tcp ) {
 		tsopt->tsopt.tsval = htonl ( currticks() );
 		tsopt->tsopt.tsecr = htonl ( tcp->ts_recent );
 	}
+	if ( ( tcp->flags & TCP_SACK_ENABLED ) &&
+	     ( ! list_empty ( &tcp->rx_queue ) ) &&
+	     ( ( sack_count = tcp_sack ( tcp, sack_seq ) ) != 0 ) ) {
+		sack_len = ( sack_count * sizeof ( tcp->sack[0] ) );
+		sackopt = iob_push ( iobuf, ( sizeof ( *sackopt ) + sack_len ) );
+		memset ( sackopt->nop, TCP_OPTION_NOP, sizeof ( sackopt->nop ) );
+		sackopt->sackopt.kind = TCP_OPTION_SACK;
+		sackopt->sackopt.length =
+			( sizeof ( sackopt->sackopt ) + sack_len );
+		memcpy ( ( ( ( void * ) sackopt ) + sizeof ( *sackopt ) ),
+			 tcp->sack, sack_len );
+	}
 	if ( len != 0 )
 		flags |= TCP_PSH;
+	assert ( ( payload - iobuf->data ) <= TCP_MAX_OPTIONS_LEN );
 	tcphdr = iob_push ( iobuf, sizeof ( *tcphdr ) );
 	memset ( tcphdr, 0, sizeof ( *tcphdr ) );
 	tcphdr->src = htons ( tcp->local_port );
 	tcphdr->dest = tcp->peer.st_port;
-	tcphdr->seq = htonl ( tcp->snd_seq );
+	tcphdr->seq = htonl ( seq );
 	tcphdr->ack = htonl ( tcp->rcv_ack );
 	tcphdr->hlen = ( ( payload - iobuf->data ) << 2 );
 	tcphdr->flags = flags;
-	tcphdr->win = htons ( tcp->rcv_win );
-	tcphdr->csum = tcpip_chksum ( iobuf->data, iob_len ( iobuf ) );
+	tcphdr->win = htons ( tcp->rcv_win >> tcp->rcv_win_scale );
+	if ( ( ! tcphdr->win ) &&
+	     ( tcp->tcp_state & TCP_STATE_RCVD ( TCP_SYN ) ) )
+		tcp_stats.zero_windows++;
+	tcphdr->csum = tcpip_chksum_iob ( iobuf );
 
 	/* Dump header */
 	DBGC2 ( tcp, "TCP %p TX %d->%d %08x..%08x           %08x %4zd",
@@ -568,22 +1136,182 @@ static int tcp_xmit ( struct tcp_connection *tcp ) {
 		ntohl ( tcphdr->ack ), len );
 	tcp_dump_flags ( tcp, tcphdr->flags );
 	DBGC2 ( tcp, "\n" );
+	TRACE ( tcp_trace, tcp, "TX %08lx ack %08lx len %ld flags %02lx",
+		seq, tcp->rcv_ack, len, flags );
 
 	/* Transmit packet */
 	if ( ( rc = tcpip_tx ( iobuf, &tcp_protocol, NULL, &tcp->peer, NULL,
 			       &tcphdr->csum ) ) != 0 ) {
 		DBGC ( tcp, "TCP %p could not transmit %08x..%08x %08x: %s\n",
-		       tcp, tcp->snd_seq, ( tcp->snd_seq + tcp->snd_sent ),
-		       tcp->rcv_ack, strerror ( rc ) );
+		       tcp, seq, ( seq + seq_len ), tcp->rcv_ack,
+		       strerror ( rc ) );
 		return rc;
 	}
 
-	/* Clear ACK-pending flag */
+	/* Clear ACK-pending flag and any delayed acknowledgement */
 	tcp->flags &= ~TCP_ACK_PENDING;
+	tcp->rcv_unacked = 0;
+	stop_timer ( &tcp->delack );
+
+	return 0;
+}
+
+/**
+ * Transmit any outstanding data (with selective acknowledgement)
+ *
+ * @v tcp		TCP connection
+ * @v sack_seq		SEQ for first selective acknowledgement (if any)
+ * @ret rc		Return status code
+ *
+ * Transmits as much new data as the send and congestion windows
+ * allow, or a pure ACK if an acknowledgement is pending and there is
+ * no new data to send.
+ *
+ * Note that even if an error is returned, the retransmission timer
+ * will have been started if necessary, and so the stack will
+ * eventually attempt to retransmit the failed packet.
+ */
+static int tcp_xmit_sack ( struct tcp_connection *tcp, uint32_t sack_seq ) {
+	unsigned int flags;
+	uint32_t offset;
+	size_t fastopen;
+	size_t len;
+	uint32_t seq_len;
+	int rc;
+
+	do {
+		/* Calculate both the actual (payload) and sequence
+		 * space lengths that we wish to transmit next.
+		 */
+		len = 0;
+		fastopen = 0;
+		if ( TCP_CAN_SEND_DATA ( tcp->tcp_state ) ) {
+			len = tcp_process_tx_queue ( tcp, tcp->snd_sent,
+						     tcp_xmit_win ( tcp ),
+						     NULL, 0 );
+		} else if ( ( fastopen = tcp_fastopen_len ( tcp ) ) != 0 ) {
+			len = tcp_process_tx_queue ( tcp, 0, fastopen,
+						     NULL, 0 );
+			if ( len ) {
+				tcp->flags |= TCP_FASTOPEN_DATA;
+				tcp_stats.fastopen_sent++;
+			}
+		}
+		seq_len = len;
+		flags = TCP_FLAGS_SENDING ( tcp->tcp_state );
+		if ( tcp->snd_sent ) {
+			/* SYN or FIN is never sent alongside data, and
+			 * so must already be outstanding.
+			 */
+			flags &= ~( TCP_SYN | TCP_FIN );
+		} else if ( flags & ( TCP_SYN | TCP_FIN ) ) {
+			/* SYN or FIN consume one byte, and we can
+			 * never send both.
+			 */
+			assert ( ! ( ( flags & TCP_SYN ) &&
+				     ( flags & TCP_FIN ) ) );
+			seq_len++;
+		}
+
+		/* If we have nothing to transmit, stop now */
+		if ( ( seq_len == 0 ) && ! ( tcp->flags & TCP_ACK_PENDING ) )
+			return 0;
+
+		/* If we are transmitting anything that requires
+		 * acknowledgement (i.e. consumes sequence space),
+		 * start the retransmission timer if it is not
+		 * already running (or is running only to defer the
+		 * initial SYN of a Fast Open connection).  Do this
+		 * before attempting to transmit, in case transmission
+		 * itself fails.
+		 */
+		if ( seq_len &&
+		     ( fastopen || ( ! timer_running ( &tcp->timer ) ) ) )
+			start_timer ( &tcp->timer );
+
+		/* Transmit segment.  The segment is treated as sent
+		 * even if transmission fails, since it may still
+		 * have been queued (e.g. pending ARP resolution).
+		 */
+		offset = tcp->snd_sent;
+		tcp->snd_sent += seq_len;
+		if ( tcp_cmp ( ( tcp->snd_seq + tcp->snd_sent ),
+			       tcp->snd_max ) > 0 ) {
+			tcp->snd_max = ( tcp->snd_seq + tcp->snd_sent );
+		}
+		if ( ( rc = tcp_xmit_segment ( tcp, offset, len, flags,
+					       sack_seq ) ) != 0 )
+			return rc;
+
+	} while ( seq_len );
 
 	return 0;
 }
 
+/**
+ * Retransmit first unacknowledged segment
+ *
+ * @v tcp		TCP connection
+ *
+ * This is used for fast retransmission, and does not affect the
+ * record of which data remains to be sent.
+ */
+static void tcp_xmit_retransmit ( struct tcp_connection *tcp ) {
+	unsigned int flags;
+	size_t len;
+
+	/* Do nothing unless there is outstanding data */
+	len = tcp_process_tx_queue ( tcp, 0, tcp_xmit_max_len ( tcp ),
+				     NULL, 0 );
+	if ( len > tcp->snd_sent )
+		len = tcp->snd_sent;
+	if ( ! len )
+		return;
+
+	/* Retransmit segment */
+	DBGC ( tcp, "TCP %p fast retransmitting %08x..%08zx\n",
+	       tcp, tcp->snd_seq, ( tcp->snd_seq + len ) );
+	flags = ( TCP_FLAGS_SENDING ( tcp->tcp_state ) &
+		  ~( TCP_SYN | TCP_FIN ) );
+	tcp_xmit_segment ( tcp, 0, len, flags, tcp->rcv_ack );
+	tcp_stats.fast_retransmits++;
+}
+
+/**
+ * Transmit any outstanding data
+ *
+ * @v tcp		TCP connection
+ */
+static void tcp_xmit ( struct tcp_connection *tcp ) {
+
+	/* Transmit without an explicit first SEQ value */
+	tcp_xmit_sack ( tcp, tcp->rcv_ack );
+}
+
+/** TCP deferred transmission process descriptor */
+static struct process_descriptor tcp_process_desc =
+	PROC_DESC_ONCE ( struct tcp_connection, process, tcp_xmit );
+
+/**
+ * Reduce slow start threshold following loss
+ *
+ * @v tcp		TCP connection
+ *
+ * As specified in RFC 5681 section 3.1, the slow start threshold is
+ * set to half of the amount of outstanding data, but no less than
+ * two segments.
+ */
+static void tcp_loss ( struct tcp_connection *tcp ) {
+	uint32_t flight = ( tcp->snd_max - tcp->snd_seq );
+	uint32_t min_ssthresh = ( 2 * tcp->snd_mss );
+
+	tcp->ssthresh = ( flight / 2 );
+	if ( tcp->ssthresh < min_ssthresh )
+		tcp->ssthresh = min_ssthresh;
+	tcp->recover = tcp->snd_max;
+	tcp->dupacks = 0;
+}
+
 /**
  * Retransmission timer expired
  *
@@ -613,7 +1341,17 @@ static void tcp_expired ( struct retry_timer *timer, int over ) {
 		tcp_dump_state ( tcp );
 		tcp_close ( tcp, -ETIMEDOUT );
 	} else {
-		/* Otherwise, retransmit the packet */
+		/* Otherwise, collapse the congestion window to a
+		 * single segment and retransmit everything from the
+		 * first unacknowledged byte.
+		 */
+		if ( tcp->tcp_state & TCP_STATE_ACKED ( TCP_SYN ) ) {
+			tcp_loss ( tcp );
+			tcp->cwnd = tcp->snd_mss;
+			tcp->flags &= ~TCP_FAST_RECOVERY;
+		}
+		tcp->snd_sent = 0;
+		tcp_stats.retransmits++;
 		tcp_xmit ( tcp );
 	}
 }
@@ -639,6 +1377,25 @@ static void tcp_wait_expired ( struct retry_timer *timer, int over __unused ) {
 	tcp_close ( tcp, 0 );
 }
 
+/**
+ * Delayed acknowledgement timer expired
+ *
+ * @v timer		Delayed acknowledgement timer
+ * @v over		Failure indicator
+ */
+static void tcp_delack_expired ( struct retry_timer *timer,
+				 int over __unused ) {
+	struct tcp_connection *tcp =
+		container_of ( timer, struct tcp_connection, delack );
+
+	DBGC2 ( tcp, "TCP %p sending delayed ACK in %s for %08x\n", tcp,
+		tcp_state ( tcp->tcp_state ), tcp->rcv_ack );
+
+	/* Send acknowledgement */
+	tcp->flags |= TCP_ACK_PENDING;
+	tcp_xmit ( tcp );
+}
+
 /**
  * Send RST response to incoming packet
  *
@@ -650,17 +1407,19 @@ static int tcp_xmit_reset ( struct tcp_connection *tcp,
 			    struct tcp_header *in_tcphdr ) {
 	struct io_buffer *iobuf;
 	struct tcp_header *tcphdr;
+	size_t headroom;
 	int rc;
 
 	/* Allocate space for dataless TX buffer */
-	iobuf = alloc_iob ( TCP_MAX_HEADER_LEN );
+	headroom = tcp_headroom ( st_dest );
+	iobuf = alloc_iob ( headroom );
 	if ( ! iobuf ) {
 		DBGC ( tcp, "TCP %p could not allocate iobuf for RST "
 		       "%08x..%08x %08x\n", tcp, ntohl ( in_tcphdr->ack ),
 		       ntohl ( in_tcphdr->ack ), ntohl ( in_tcphdr->seq ) );
 		return -ENOMEM;
 	}
-	iob_reserve ( iobuf, TCP_MAX_HEADER_LEN );
+	iob_reserve ( iobuf, headroom );
 
 	/* Construct RST response */
 	tcphdr = iob_push ( iobuf, sizeof ( *tcphdr ) );
@@ -671,7 +1430,7 @@ static int tcp_xmit_reset ( struct tcp_connection *tcp,
 	tcphdr->ack = in_tcphdr->seq;
 	tcphdr->hlen = ( ( sizeof ( *tcphdr ) / 4 ) << 4 );
 	tcphdr->flags = ( TCP_RST | TCP_ACK );
-	tcphdr->win = htons ( TCP_MAX_WINDOW_SIZE );
+	tcphdr->win = htons ( 0 );
 	tcphdr->csum = tcpip_chksum ( iobuf->data, iob_len ( iobuf ) );
 
 	/* Dump header */
@@ -711,7 +1470,7 @@ static int tcp_xmit_reset ( struct tcp_connection *tcp,
 static struct tcp_connection * tcp_demux ( unsigned int local_port ) {
 	struct tcp_connection *tcp;
 
-	list_for_each_entry ( tcp, &tcp_conns, list ) {
+	list_for_each_entry ( tcp, tcp_bucket ( local_port ), hash ) {
 		if ( tcp->local_port == local_port )
 			return tcp;
 	}
@@ -746,9 +1505,22 @@ static void tcp_rx_opts ( struct tcp_connection *tcp, const void *data,
 		case TCP_OPTION_MSS:
 			options->mssopt = data;
 			break;
+		case TCP_OPTION_WS:
+			options->wsopt = data;
+			break;
+		case TCP_OPTION_SACK_PERMITTED:
+			options->spopt = data;
+			break;
+		case TCP_OPTION_SACK:
+			/* Ignore received SACKs */
+			break;
 		case TCP_OPTION_TS:
 			options->tsopt = data;
 			break;
+		case TCP_OPTION_FASTOPEN:
+			if ( ( data + option->length ) <= end )
+				options->foopt = data;
+			break;
 		default:
 			DBGC ( tcp, "TCP %p received unknown option %d\n",
 			       tcp, kind );
@@ -782,8 +1554,19 @@ static void tcp_rx_seq ( struct tcp_connection *tcp, uint32_t seq_len ) {
 	/* Update timestamp */
 	tcp->ts_recent = tcp->ts_val;
 
-	/* Mark ACK as pending */
-	tcp->flags |= TCP_ACK_PENDING;
+	/* Acknowledge immediately if we have received more than one
+	 * full-sized segment since the last acknowledgement, or if
+	 * the remaining window is small enough that the peer may soon
+	 * be unable to send.  Otherwise, delay the acknowledgement in
+	 * the hope of combining it with the next.
+	 */
+	tcp->rcv_unacked += seq_len;
+	if ( ( tcp->rcv_unacked > tcp->mss ) ||
+	     ( tcp->rcv_win < ( 2 * tcp->mss ) ) ) {
+		tcp->flags |= TCP_ACK_PENDING;
+	} else if ( ! timer_running ( &tcp->delack ) ) {
+		start_timer_fixed ( &tcp->delack, TCP_DELACK_TIMEOUT );
+	}
 }
 
 /**
@@ -802,14 +1585,38 @@ static int tcp_rx_syn ( struct tcp_connection *tcp, uint32_t seq,
 		tcp->rcv_ack = seq;
 		if ( options->tsopt )
 			tcp->flags |= TCP_TS_ENABLED;
+		if ( options->spopt )
+			tcp->flags |= TCP_SACK_ENABLED;
+		if ( options->mssopt ) {
+			tcp->snd_mss = ntohs ( options->mssopt->mss );
+			if ( tcp->snd_mss > tcp->mss )
+				tcp->snd_mss = tcp->mss;
+		}
+		if ( options->foopt && ( tcp->flags & TCP_FASTOPEN_ENABLED ) )
+			tcp_fastopen_put ( tcp, options->foopt );
+		if ( options->wsopt ) {
+			tcp->snd_win_scale = options->wsopt->scale;
+			if ( tcp->snd_win_scale > TCP_MAX_WINDOW_SCALE )
+				tcp->snd_win_scale = TCP_MAX_WINDOW_SCALE;
+			tcp->rcv_win_scale = TCP_RX_WINDOW_SCALE;
+		}
+
+		/* Set initial congestion window as per RFC 5681 */
+		tcp->cwnd = ( 2 * tcp->snd_mss );
+		if ( tcp->cwnd < 4380 )
+			tcp->cwnd = 4380;
+		if ( tcp->cwnd > ( 4 * tcp->snd_mss ) )
+			tcp->cwnd = ( 4 * tcp->snd_mss );
+		tcp->ssthresh = TCP_MAX_CWND;
 	}
 
 	/* Ignore duplicate SYN */
 	if ( seq != tcp->rcv_ack )
 		return 0;
 
-	/* Acknowledge SYN */
+	/* Acknowledge SYN immediately */
 	tcp_rx_seq ( tcp, 1 );
+	tcp->flags |= TCP_ACK_PENDING;
 
 	/* Mark SYN as received and start sending ACKs with each packet */
 	tcp->tcp_state |= ( TCP_STATE_SENT ( TCP_ACK ) |
@@ -818,26 +1625,160 @@ static int tcp_rx_syn ( struct tcp_connection *tcp, uint32_t seq,
 	return 0;
 }
 
+/**
+ * Update round-trip time estimate
+ *
+ * @v tcp		TCP connection
+ * @v rtt		Measured round-trip time (in ticks)
+ *
+ * The smoothed round-trip time and its variation are maintained as
+ * described in RFC 6298, and used to set the retransmission timeout.
+ * The retransmission timer must not be running.
+ */
+static void tcp_rtt ( struct tcp_connection *tcp, unsigned long rtt ) {
+	long delta;
+
+	/* Update estimates */
+	if ( tcp->flags & TCP_RTT_MEASURED ) {
+		delta = ( rtt - ( tcp->srtt >> 3 ) );
+		tcp->srtt += delta;
+		if ( delta < 0 )
+			delta = -delta;
+		delta -= ( tcp->rttvar >> 2 );
+		tcp->rttvar += delta;
+	} else {
+		tcp->srtt = ( rtt << 3 );
+		tcp->rttvar = ( rtt << 1 );
+		tcp->flags |= TCP_RTT_MEASURED;
+	}
+
+	/* Update retransmission timeout.  The retry timer will
+	 * enforce a minimum value.
+	 */
+	tcp->timer.timeout = ( ( tcp->srtt >> 3 ) +
+			       ( tcp->rttvar ? tcp->rttvar : 1 ) );
+	DBGC2 ( tcp, "TCP %p RTT %ld SRTT %ld RTTVAR %ld RTO %ld\n", tcp,
+		rtt, ( tcp->srtt >> 3 ), ( tcp->rttvar >> 2 ),
+		tcp->timer.timeout );
+}
+
+/**
+ * Update congestion window on receipt of a new acknowledgement
+ *
+ * @v tcp		TCP connection
+ * @v ack		ACK value (in host-endian order)
+ * @v len		Length of newly acknowledged data
+ */
+static void tcp_cwnd_ack ( struct tcp_connection *tcp, uint32_t ack,
+			   size_t len ) {
+	uint32_t incr;
+
+	/* Reset duplicate ACK counter */
+	tcp->dupacks = 0;
+
+	/* Do nothing further unless data has been acknowledged
+	 * (rather than just a SYN or FIN).  Data sent within a Fast
+	 * Open SYN may be acknowledged before the initial congestion
+	 * window has been set.
+	 */
+	if ( ( ! len ) ||
+	     ( ! ( tcp->tcp_state & TCP_STATE_ACKED ( TCP_SYN ) ) ) )
+		return;
+
+	/* Handle fast recovery as per RFC 6582 */
+	if ( tcp->flags & TCP_FAST_RECOVERY ) {
+		if ( tcp_cmp ( ack, tcp->recover ) >= 0 ) {
+			/* Full acknowledgement: deflate window */
+			DBGC ( tcp, "TCP %p exiting fast recovery\n", tcp );
+			tcp->flags &= ~TCP_FAST_RECOVERY;
+			tcp->cwnd = tcp->ssthresh;
+		} else {
+			/* Partial acknowledgement: retransmit the
+			 * next unacknowledged segment and deflate the
+			 * window by the amount of new data
+			 * acknowledged.
+			 */
+			tcp_xmit_retransmit ( tcp );
+			tcp->cwnd = ( ( tcp->cwnd > len ) ?
+				      ( tcp->cwnd - len ) : 0 );
+			tcp->cwnd += tcp->snd_mss;
+		}
+		return;
+	}
+
+	/* Open window via slow start or congestion avoidance */
+	if ( tcp->cwnd < tcp->ssthresh ) {
+		incr = ( ( len < tcp->snd_mss ) ? len : tcp->snd_mss );
+	} else {
+		incr = ( ( tcp->snd_mss * tcp->snd_mss ) / tcp->cwnd );
+		if ( ! incr )
+			incr = 1;
+	}
+	tcp->cwnd += incr;
+	if ( tcp->cwnd > TCP_MAX_CWND )
+		tcp->cwnd = TCP_MAX_CWND;
+}
+
+/**
+ * Handle TCP received duplicate ACK
+ *
+ * @v tcp		TCP connection
+ * @v ack		ACK value (in host-endian order)
+ */
+static void tcp_rx_dupack ( struct tcp_connection *tcp, uint32_t ack ) {
+
+	/* Count duplicate ACKs */
+	tcp->dupacks++;
+
+	/* Inflate window during fast recovery, since each duplicate
+	 * ACK indicates that a segment has left the network.
+	 */
+	if ( tcp->flags & TCP_FAST_RECOVERY ) {
+		if ( tcp->cwnd < TCP_MAX_CWND )
+			tcp->cwnd += tcp->snd_mss;
+		return;
+	}
+
+	/* Enter fast retransmit and fast recovery on reaching the
+	 * duplicate ACK threshold, unless this ACK does not cover
+	 * more than the previous recovery point (RFC 6582 section
+	 * 3.2).
+	 */
+	if ( ( tcp->dupacks == TCP_DUPACK_THRESHOLD ) &&
+	     ( tcp_cmp ( ack, tcp->recover ) > 0 ) ) {
+		DBGC ( tcp, "TCP %p entering fast recovery at %08x\n",
+		       tcp, ack );
+		tcp_loss ( tcp );
+		tcp->cwnd = ( tcp->ssthresh +
+			      ( TCP_DUPACK_THRESHOLD * tcp->snd_mss ) );
+		tcp->flags |= TCP_FAST_RECOVERY;
+		tcp_xmit_retransmit ( tcp );
+	}
+}
+
 /**
  * Handle TCP received ACK
  *
  * @v tcp		TCP connection
  * @v ack		ACK value (in host-endian order)
- * @v win		WIN value (in host-endian order)
+ * @v win		WIN value (in host-endian order, not yet scaled)
+ * @v seq_len		Sequence space length of received segment
  * @ret rc		Return status code
  */
 static int tcp_rx_ack ( struct tcp_connection *tcp, uint32_t ack,
-			uint32_t win ) {
+			uint32_t win, uint32_t seq_len ) {
 	uint32_t ack_len = ( ack - tcp->snd_seq );
+	uint32_t max_len = ( tcp->snd_max - tcp->snd_seq );
+	unsigned long rtt;
 	size_t len;
 	unsigned int acked_flags;
 
 	/* Check for out-of-range or old duplicate ACKs */
-	if ( ack_len > tcp->snd_sent ) {
+	if ( ack_len > max_len ) {
 		DBGC ( tcp, "TCP %p received ACK for %08x..%08x, "
 		       "sent only %08x..%08x\n", tcp, tcp->snd_seq,
 		       ( tcp->snd_seq + ack_len ), tcp->snd_seq,
-		       ( tcp->snd_seq + tcp->snd_sent ) );
+		       tcp->snd_max );
 
 		if ( TCP_HAS_BEEN_ESTABLISHED ( tcp->tcp_state ) ) {
 			/* Just ignore what might be old duplicate ACKs */
@@ -851,17 +1792,32 @@ static int tcp_rx_ack ( struct tcp_connection *tcp, uint32_t ack,
 		}
 	}
 
-	/* Ignore ACKs that don't actually acknowledge any new data.
+	/* Handle ACKs that don't actually acknowledge any new data.
 	 * (In particular, do not stop the retransmission timer; this
 	 * avoids creating a sorceror's apprentice syndrome when a
 	 * duplicate ACK is received and we still have data in our
-	 * transmit queue.)
+	 * transmit queue.)  An ACK carrying no data, with an
+	 * unchanged window, while data is outstanding is a duplicate
+	 * ACK as defined in RFC 5681.
 	 */
-	if ( ack_len == 0 )
+	if ( ack_len == 0 ) {
+		win <<= tcp->snd_win_scale;
+		if ( win != tcp->snd_win ) {
+			tcp->snd_win = win;
+		} else if ( max_len && ( seq_len == 0 ) &&
+			    TCP_CAN_SEND_DATA ( tcp->tcp_state ) ) {
+			tcp_rx_dupack ( tcp, ack );
+		}
 		return 0;
+	}
 
-	/* Stop the retransmission timer */
+	/* Stop the retransmission timer, and update the round-trip
+	 * time estimate if the ACK echoes a plausible timestamp.
+	 */
 	stop_timer ( &tcp->timer );
+	rtt = ( currticks() - tcp->ts_ecr );
+	if ( tcp->ts_ecr && ( rtt < DEFAULT_MAX_TIMEOUT ) )
+		tcp_rtt ( tcp, rtt );
 
 	/* Determine acknowledged flags and data length */
 	len = ack_len;
@@ -870,14 +1826,38 @@ static int tcp_rx_ack ( struct tcp_connection *tcp, uint32_t ack,
 	if ( acked_flags )
 		len--;
 
-	/* Update SEQ and sent counters, and window size */
+	/* Update SEQ and sent counters, and window size.  Following
+	 * a retransmission timeout, the ACK may cover data that we
+	 * have not yet retransmitted.
+	 */
 	tcp->snd_seq = ack;
-	tcp->snd_sent = 0;
-	tcp->snd_win = win;
+	tcp->snd_sent = ( ( ack_len < tcp->snd_sent ) ?
+			  ( tcp->snd_sent - ack_len ) : 0 );
+	tcp->snd_win = ( win << tcp->snd_win_scale );
+
+	/* Resend immediately any data sent within the SYN which the
+	 * peer did not accept (RFC 7413 section 4.2.2).
+	 */
+	if ( ( acked_flags & TCP_SYN ) && ( tcp->flags & TCP_FASTOPEN_DATA ) ) {
+		tcp->flags &= ~TCP_FASTOPEN_DATA;
+		if ( tcp->snd_sent ) {
+			DBGC ( tcp, "TCP %p Fast Open data not accepted\n",
+			       tcp );
+			tcp->snd_sent = 0;
+			tcp_stats.fastopen_rejected++;
+		}
+	}
 
 	/* Remove any acknowledged data from transmit queue */
-	tcp_process_tx_queue ( tcp, len, NULL, 1 );
-		
+	tcp_process_tx_queue ( tcp, 0, len, NULL, 1 );
+
+	/* Update congestion window */
+	tcp_cwnd_ack ( tcp, ack, len );
+
+	/* Restart the retransmission timer if data remains outstanding */
+	if ( tcp->snd_max != tcp->snd_seq )
+		start_timer ( &tcp->timer );
+
 	/* Mark SYN/FIN as acknowledged if applicable. */
 	if ( acked_flags )
 		tcp->tcp_state |= TCP_STATE_ACKED ( acked_flags );
@@ -941,8 +1921,9 @@ static int tcp_rx_fin ( struct tcp_connection *tcp, uint32_t seq ) {
 	if ( seq != tcp->rcv_ack )
 		return 0;
 
-	/* Acknowledge FIN */
+	/* Acknowledge FIN immediately */
 	tcp_rx_seq ( tcp, 1 );
+	tcp->flags |= TCP_ACK_PENDING;
 
 	/* Mark FIN as received */
 	tcp->tcp_state |= TCP_STATE_RCVD ( TCP_FIN );
@@ -1024,6 +2005,7 @@ static void tcp_rx_enqueue ( struct tcp_connection *tcp, uint32_t seq,
 	/* Add internal header */
 	tcpqhdr = iob_push ( iobuf, sizeof ( *tcpqhdr ) );
 	tcpqhdr->seq = seq;
+	tcpqhdr->nxt = ( seq + seq_len );
 	tcpqhdr->flags = flags;
 
 	/* Add to RX queue */
@@ -1088,10 +2070,10 @@ static void tcp_process_rx_queue ( struct tcp_connection *tcp ) {
  * @v pshdr_csum	Pseudo-header checksum
  * @ret rc		Return status code
   */
-static int tcp_rx ( struct io_buffer *iobuf,
-		    struct sockaddr_tcpip *st_src,
-		    struct sockaddr_tcpip *st_dest __unused,
-		    uint16_t pshdr_csum ) {
+static int __hot tcp_rx ( struct io_buffer *iobuf,
+			  struct sockaddr_tcpip *st_src,
+			  struct sockaddr_tcpip *st_dest __unused,
+			  uint16_t pshdr_csum ) {
 	struct tcp_header *tcphdr = iobuf->data;
 	struct tcp_connection *tcp;
 	struct tcp_options options;
@@ -1126,13 +2108,16 @@ static int tcp_rx ( struct io_buffer *iobuf,
 		rc = -EINVAL;
 		goto discard;
 	}
-	csum = tcpip_continue_chksum ( pshdr_csum, iobuf->data,
-				       iob_len ( iobuf ) );
-	if ( csum != 0 ) {
-		DBG ( "TCP checksum incorrect (is %04x including checksum "
-		      "field, should be 0000)\n", csum );
-		rc = -EINVAL;
-		goto discard;
+	if ( ! ( iobuf->flags & IOB_CSUM_VERIFIED ) ) {
+		csum = tcpip_continue_chksum ( pshdr_csum, iobuf->data,
+					       iob_len ( iobuf ) );
+		if ( csum != 0 ) {
+			DBG ( "TCP checksum incorrect (is %04x including "
+			      "checksum field, should be 0000)\n", csum );
+			tcp_stats.checksum_errors++;
+			rc = -EINVAL;
+			goto discard;
+		}
 	}
 	
 	/* Parse parameters from header and strip header */
@@ -1157,6 +2142,8 @@ static int tcp_rx ( struct io_buffer *iobuf,
 		( ntohl ( tcphdr->seq ) + seq_len ), len );
 	tcp_dump_flags ( tcp, tcphdr->flags );
 	DBGC2 ( tcp, "\n" );
+	TRACE ( tcp_trace, tcp, "RX %08lx ack %08lx len %ld flags %02lx",
+		seq, ack, len, flags );
 
 	/* If no connection was found, send RST */
 	if ( ! tcp ) {
@@ -1165,12 +2152,15 @@ static int tcp_rx ( struct io_buffer *iobuf,
 		goto discard;
 	}
 
+	/* Record timestamp echo reply, if any */
+	tcp->ts_ecr = ( options.tsopt ? ntohl ( options.tsopt->tsecr ) : 0 );
+
 	/* Record old data-transfer window */
 	old_xfer_window = tcp_xfer_window ( tcp );
 
 	/* Handle ACK, if present */
 	if ( flags & TCP_ACK ) {
-		if ( ( rc = tcp_rx_ack ( tcp, ack, win ) ) != 0 ) {
+		if ( ( rc = tcp_rx_ack ( tcp, ack, win, seq_len ) ) != 0 ) {
 			tcp_xmit_reset ( tcp, st_src, tcphdr );
 			goto discard;
 		}
@@ -1180,6 +2170,11 @@ static int tcp_rx ( struct io_buffer *iobuf,
 	if ( ( tcp->tcp_state & TCP_STATE_RCVD ( TCP_SYN ) ) &&
 	     ( seq != tcp->rcv_ack ) ) {
 		tcp->flags |= TCP_ACK_PENDING;
+		if ( seq_len &&
+		     ( tcp_cmp ( seq + seq_len, tcp->rcv_ack ) <= 0 ) )
+			tcp_stats.rx_duplicates++;
+		if ( seq_len && ( tcp_cmp ( seq, tcp->rcv_ack ) > 0 ) )
+			tcp_stats.rx_out_of_order++;
 	}
 
 	/* Handle SYN, if present */
@@ -1204,7 +2199,7 @@ static int tcp_rx ( struct io_buffer *iobuf,
 	tcp_dump_state ( tcp );
 
 	/* Send out any pending data */
-	tcp_xmit ( tcp );
+	tcp_xmit_sack ( tcp, seq );
 
 	/* If this packet was the last we expect to receive, set up
 	 * timer to expire and cause the connection to be freed.
@@ -1226,13 +2221,182 @@ static int tcp_rx ( struct io_buffer *iobuf,
 	return rc;
 }
 
+/**
+ * Check whether received TCP segments may be merged
+ *
+ * @v iobuf		I/O buffer containing first segment
+ * @v next		I/O buffer containing following segment
+ * @v pshdr_csum	Pseudo-header checksum for first segment
+ * @v next_pshdr_csum	Pseudo-header checksum for following segment
+ * @ret len		Length of headers in following segment, or rc
+ *
+ * Segments may be merged only if the following segment carries the
+ * next in-order data for the same connection, and neither segment
+ * carries anything other than data and an unchanged acknowledgement.
+ * Checksums are verified here, since the checksum of the merged
+ * segment would no longer be valid.
+ */
+static int tcp_merge ( struct io_buffer *iobuf, struct io_buffer *next,
+		       uint16_t pshdr_csum, uint16_t next_pshdr_csum ) {
+	struct tcp_header *tcphdr = iobuf->data;
+	struct tcp_header *next_tcphdr = next->data;
+	size_t hlen;
+	size_t len;
+
+	/* Sanity check segments */
+	if ( ( iob_len ( iobuf ) < sizeof ( *tcphdr ) ) ||
+	     ( iob_len ( next ) < sizeof ( *next_tcphdr ) ) )
+		return -EINVAL;
+	hlen = ( ( tcphdr->hlen & TCP_MASK_HLEN ) / 16 ) * 4;
+	if ( ( hlen < sizeof ( *tcphdr ) ) || ( hlen > iob_len ( iobuf ) ) )
+		return -EINVAL;
+
+	/* Require identical headers (including options) apart from
+	 * the sequence number and checksum, and require that the
+	 * following segment contain data.  The PSH flag is ignored,
+	 * since it has no effect on reception.
+	 */
+	if ( ( next_tcphdr->hlen != tcphdr->hlen ) ||
+	     ( hlen >= iob_len ( next ) ) ||
+	     ( next_tcphdr->src != tcphdr->src ) ||
+	     ( next_tcphdr->dest != tcphdr->dest ) ||
+	     ( next_tcphdr->ack != tcphdr->ack ) ||
+	     ( next_tcphdr->win != tcphdr->win ) ||
+	     ( ( tcphdr->flags & ~TCP_PSH ) != TCP_ACK ) ||
+	     ( ( next_tcphdr->flags & ~TCP_PSH ) != TCP_ACK ) ||
+	     ( memcmp ( ( tcphdr + 1 ), ( next_tcphdr + 1 ),
+			( hlen - sizeof ( *tcphdr ) ) ) != 0 ) )
+		return -ENOTSUP;
+
+	/* Require the following segment to be in order */
+	len = ( iob_len ( iobuf ) - hlen );
+	if ( ntohl ( next_tcphdr->seq ) != ( ntohl ( tcphdr->seq ) + len ) )
+		return -ENOTSUP;
+
+	/* Verify checksums */
+	if ( ! ( iobuf->flags & IOB_CSUM_VERIFIED ) ) {
+		if ( tcpip_continue_chksum ( pshdr_csum, iobuf->data,
+					     iob_len ( iobuf ) ) != 0 )
+			return -EINVAL;
+		iobuf->flags |= IOB_CSUM_VERIFIED;
+	}
+	if ( ( ! ( next->flags & IOB_CSUM_VERIFIED ) ) &&
+	     ( tcpip_continue_chksum ( next_pshdr_csum, next->data,
+				       iob_len ( next ) ) != 0 ) )
+		return -EINVAL;
+
+	return hlen;
+}
+
+/**
+ * Check whether or not address is a connection's peer
+ *
+ * @v tcp		TCP connection
+ * @v st_peer		Peer address (port is ignored)
+ * @ret is_peer		Address is the connection's peer
+ */
+static int tcp_is_peer ( struct tcp_connection *tcp,
+			 struct sockaddr_tcpip *st_peer ) {
+	struct sockaddr_in *sin_tcp = ( ( struct sockaddr_in * ) &tcp->peer );
+	struct sockaddr_in *sin_peer = ( ( struct sockaddr_in * ) st_peer );
+	struct sockaddr_in6 *sin6_tcp =
+		( ( struct sockaddr_in6 * ) &tcp->peer );
+	struct sockaddr_in6 *sin6_peer = ( ( struct sockaddr_in6 * ) st_peer );
+
+	if ( st_peer->st_family != tcp->peer.st_family )
+		return 0;
+	switch ( st_peer->st_family ) {
+	case AF_INET:
+		return ( sin_peer->sin_addr.s_addr ==
+			 sin_tcp->sin_addr.s_addr );
+	case AF_INET6:
+		return ( memcmp ( &sin6_peer->sin6_addr, &sin6_tcp->sin6_addr,
+				  sizeof ( sin6_tcp->sin6_addr ) ) == 0 );
+	default:
+		return 0;
+	}
+}
+
+/**
+ * Process path MTU reduction
+ *
+ * @v st_peer		Peer address
+ * @v data		Leading part of the oversized segment's header
+ * @v len		Length of leading part of header
+ * @v mtu		New maximum transport-layer payload length
+ * @ret rc		Return status code
+ *
+ * As recommended by RFC 5927 section 4.1, the report is accepted
+ * only if it refers to an unacknowledged segment of an existing
+ * connection to the reported peer.  Unacknowledged data is
+ * retransmitted immediately using the reduced segment size; this is
+ * not treated as a loss event (RFC 1191 section 6.5) and so the
+ * congestion window is not reduced.
+ */
+static int tcp_pmtu ( struct sockaddr_tcpip *st_peer,
+		      const void *data, size_t len, size_t mtu ) {
+	const struct tcp_header *tcphdr = data;
+	struct tcp_connection *tcp;
+	uint32_t seq;
+	size_t snd_mss;
+
+	/* Sanity check */
+	if ( len < offsetof ( struct tcp_header, ack ) )
+		return -EINVAL;
+	if ( mtu <= sizeof ( *tcphdr ) )
+		return -EINVAL;
+
+	/* Identify connection and segment */
+	tcp = tcp_demux ( ntohs ( tcphdr->src ) );
+	if ( ( ! tcp ) || ( tcp->peer.st_port != tcphdr->dest ) ||
+	     ( ! tcp_is_peer ( tcp, st_peer ) ) )
+		return -ENOTCONN;
+	seq = ntohl ( tcphdr->seq );
+	if ( ( seq - tcp->snd_seq ) >= ( tcp->snd_max - tcp->snd_seq ) ) {
+		DBGC ( tcp, "TCP %p ignoring path MTU for %08x outside "
+		       "%08x..%08x\n", tcp, seq, tcp->snd_seq, tcp->snd_max );
+		return -ERANGE;
+	}
+
+	/* Reduce segment size, if applicable */
+	snd_mss = ( mtu - sizeof ( *tcphdr ) );
+	if ( snd_mss >= tcp->snd_mss )
+		return 0;
+	DBGC ( tcp, "TCP %p reducing MSS from %zd to %zd\n",
+	       tcp, tcp->snd_mss, snd_mss );
+	tcp->snd_mss = snd_mss;
+	tcp_stats.pmtu_updates++;
+
+	/* Resend all unacknowledged data in smaller segments */
+	tcp->snd_sent = 0;
+	tcp_xmit ( tcp );
+
+	return 0;
+}
+
 /** TCP protocol */
 struct tcpip_protocol tcp_protocol __tcpip_protocol = {
 	.name = "TCP",
 	.rx = tcp_rx,
+	.merge = tcp_merge,
+	.pmtu = tcp_pmtu,
 	.tcpip_proto = IP_TCP,
 };
 
+/** TCP statistics */
+struct net_statistic tcp_net_statistics[]
+	__net_statistic ( NET_STAT_TRANSPORT ) = {
+	{ "TCP", "RTO", &tcp_stats.retransmits },
+	{ "TCP", "FRTX", &tcp_stats.fast_retransmits },
+	{ "TCP", "DUP", &tcp_stats.rx_duplicates },
+	{ "TCP", "OOO", &tcp_stats.rx_out_of_order },
+	{ "TCP", "ZWIN", &tcp_stats.zero_windows },
+	{ "TCP", "CSUME", &tcp_stats.checksum_errors },
+	{ "TCP", "PMTU", &tcp_stats.pmtu_updates },
+	{ "TCP", "TFO", &tcp_stats.fastopen_sent },
+	{ "TCP", "TFOREJ", &tcp_stats.fastopen_rejected },
+};
+
 /**
  * Discard some cached TCP data
  *
@@ -1257,10 +2421,28 @@ static unsigned int tcp_discard ( void ) {
 }
 
 /** TCP cache discarder */
-struct cache_discarder tcp_cache_discarder __cache_discarder = {
+struct cache_discarder tcp_cache_discarder
+	__cache_discarder ( CACHE_EXPENSIVE ) = {
+	.name = "tcp",
 	.discard = tcp_discard,
 };
 
+/**
+ * Initialise TCP connection hash buckets
+ *
+ */
+static void tcp_init ( void ) {
+	unsigned int i;
+
+	for ( i = 0 ; i < TCP_HASH_SIZE ; i++ )
+		INIT_LIST_HEAD ( &tcp_hash[i] );
+}
+
+/** TCP initialisation function */
+struct init_fn tcp_init_fn __init_fn ( INIT_NORMAL ) = {
+	.initialise = tcp_init,
+};
+
 /***************************************************************************
  *
  * Data transfer interface
@@ -1298,16 +2480,47 @@ static int tcp_xfer_deliver ( struct tcp_connection *tcp,
 	/* Enqueue packet */
 	list_add_tail ( &iobuf->list, &tcp->tx_queue );
 
-	/* Transmit data, if possible */
-	tcp_xmit ( tcp );
+	/* Defer transmission until the next scheduler step.  Protocols
+	 * commonly deliver a message as several small I/O buffers
+	 * (e.g. an iSCSI header followed by its data segment); these
+	 * can then be coalesced into full-sized segments.
+	 */
+	process_add ( &tcp->process );
 
 	return 0;
 }
 
+/**
+ * Handle change of application flow control window
+ *
+ * @v tcp		TCP connection
+ *
+ * The advertised receive window is limited by the application's flow
+ * control window.  If the application window has since opened by at
+ * least one full-sized segment beyond the currently advertised
+ * window, send a window update so that the peer need not wait for a
+ * zero window probe.
+ */
+static void tcp_xfer_window_changed ( struct tcp_connection *tcp ) {
+
+	/* Do nothing unless we are able to receive data */
+	if ( ( ! ( tcp->tcp_state & TCP_STATE_RCVD ( TCP_SYN ) ) ) ||
+	     ( tcp->tcp_state & TCP_STATE_RCVD ( TCP_FIN ) ) )
+		return;
+
+	/* Send window update if window has opened sufficiently */
+	if ( xfer_window ( &tcp->xfer ) >= ( tcp->rcv_win + tcp->mss ) ) {
+		tcp->flags |= TCP_ACK_PENDING;
+		tcp_xmit ( tcp );
+	}
+}
+
 /** TCP data transfer interface operations */
 static struct interface_operation tcp_xfer_operations[] = {
 	INTF_OP ( xfer_deliver, struct tcp_connection *, tcp_xfer_deliver ),
 	INTF_OP ( xfer_window, struct tcp_connection *, tcp_xfer_window ),
+	INTF_OP ( xfer_window_changed, struct tcp_connection *,
+		  tcp_xfer_window_changed ),
 	INTF_OP ( intf_close, struct tcp_connection *, tcp_xfer_close ),
 };
 
@@ -1322,16 +2535,55 @@ static struct interface_descriptor tcp_xfer_desc =
  ***************************************************************************
  */
 
+/**
+ * Open a TCP connection
+ *
+ * @v xfer		Data transfer interface
+ * @v peer		Peer socket address
+ * @v local		Local socket address, or NULL
+ * @ret rc		Return status code
+ */
+static int tcp_open_stream ( struct interface *xfer, struct sockaddr *peer,
+			     struct sockaddr *local ) {
+
+	return tcp_open ( xfer, peer, local, 0 );
+}
+
+/**
+ * Open a TCP connection using Fast Open
+ *
+ * @v xfer		Data transfer interface
+ * @v peer		Peer socket address
+ * @v local		Local socket address, or NULL
+ * @ret rc		Return status code
+ */
+static int tcp_open_fastopen ( struct interface *xfer, struct sockaddr *peer,
+			       struct sockaddr *local ) {
+
+	return tcp_open ( xfer, peer, local,
+			  ( TCP_FASTOPEN ? TCP_FASTOPEN_ENABLED : 0 ) );
+}
+
 /** TCP socket opener */
 struct socket_opener tcp_socket_opener __socket_opener = {
 	.semantics	= TCP_SOCK_STREAM,
 	.family		= AF_INET,
-	.open		= tcp_open,
+	.open		= tcp_open_stream,
+};
+
+/** TCP Fast Open socket opener */
+struct socket_opener tcp_fastopen_socket_opener __socket_opener = {
+	.semantics	= TCP_SOCK_STREAM_FASTOPEN,
+	.family		= AF_INET,
+	.open		= tcp_open_fastopen,
 };
 
 /** Linkage hack */
 int tcp_sock_stream = TCP_SOCK_STREAM;
 
+/** Linkage hack */
+int tcp_sock_stream_fastopen = TCP_SOCK_STREAM_FASTOPEN;
+
 /**
  * Open TCP URI
  *
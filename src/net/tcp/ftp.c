@@ -14,6 +14,7 @@
 #include <ipxe/uri.h>
 #include <ipxe/features.h>
 #include <ipxe/ftp.h>
+#include <config/general.h>
 
 /** @file
  *
@@ -23,53 +24,107 @@
 
 FEATURE ( FEATURE_PROTOCOL, "FTP", DHCP_EB_FEATURE_FTP, 1 );
 
+/** Minimum length of each segment of a segmented download */
+#define FTP_SEGMENT_MIN_LEN ( 1024 * 1024 )
+
 /**
  * FTP states
  *
  * These @b must be sequential, i.e. a successful FTP session must
- * pass through each of these states in order.
+ * pass through each of these states in order.  States which do not
+ * apply to a particular connection (e.g. "REST" for a connection
+ * fetching from the start of the file) are skipped.
  */
 enum ftp_state {
 	FTP_CONNECT = 0,
 	FTP_USER,
 	FTP_PASS,
 	FTP_TYPE,
+	FTP_SIZE,
 	FTP_PASV,
+	FTP_REST,
 	FTP_RETR,
 	FTP_WAIT,
 	FTP_QUIT,
 	FTP_DONE,
 };
 
+struct ftp_request;
+
 /**
- * An FTP request
+ * An FTP connection
  *
+ * Each connection comprises a control channel and a data channel.
+ * A segmented download uses one connection per segment.
  */
-struct ftp_request {
-	/** Reference counter */
-	struct refcnt refcnt;
-	/** Data transfer interface */
-	struct interface xfer;
-
-	/** URI being fetched */
-	struct uri *uri;
+struct ftp_connection {
+	/** FTP request */
+	struct ftp_request *ftp;
 	/** FTP control channel interface */
 	struct interface control;
 	/** FTP data channel interface */
 	struct interface data;
 
-	/** Current state */
+	/** Current state (i.e. command awaiting a response) */
 	enum ftp_state state;
+	/** Last state for which a command has been sent */
+	enum ftp_state sent;
+	/** Flags */
+	unsigned int flags;
 	/** Buffer to be filled with data received via the control channel */
 	char *recvbuf;
 	/** Remaining size of recvbuf */
 	size_t recvsize;
+	/** Length of current control channel line */
+	size_t line_len;
 	/** FTP status code, as text */
 	char status_text[5];
 	/** Passive-mode parameters, as text */
 	char passive_text[24]; /* "aaa,bbb,ccc,ddd,eee,fff" */
+	/** Reply parameter (following the status code), as text */
+	char param_text[24];
+	/** Restart offset, as text */
+	char rest_text[24];
+
+	/** Offset of next data to be received */
+	size_t offset;
+	/** End of segment, or zero to receive until end of file */
+	size_t end;
+};
+
+/** FTP connection flags */
+enum ftp_connection_flags {
+	/** Logged in without requiring a password */
+	FTP_NO_PASSWORD = 0x0001,
+};
+
+/**
+ * An FTP request
+ *
+ */
+struct ftp_request {
+	/** Reference counter */
+	struct refcnt refcnt;
+	/** Data transfer interface */
+	struct interface xfer;
+
+	/** URI being fetched */
+	struct uri *uri;
+	/** Download is split into parallel segments */
+	int segmented;
+	/** Connections (the first of which is the primary connection) */
+	struct ftp_connection conns[FTP_SEGMENTS];
 };
 
+/** Iterate over FTP connections
+ *
+ * @v conn		FTP connection
+ * @v ftp		FTP request
+ */
+#define for_each_ftp_connection( conn, ftp )				\
+	for ( (conn) = (ftp)->conns ;					\
+	      (conn) < &(ftp)->conns[FTP_SEGMENTS] ; (conn)++ )
+
 /**
  * Free FTP request
  *
@@ -92,15 +147,46 @@ static void ftp_free ( struct refcnt *refcnt ) {
  * @v rc		Return status code
  */
 static void ftp_done ( struct ftp_request *ftp, int rc ) {
+	struct ftp_connection *conn;
 
 	DBGC ( ftp, "FTP %p completed (%s)\n", ftp, strerror ( rc ) );
 
 	/* Close all data transfer interfaces */
-	intf_shutdown ( &ftp->data, rc );
-	intf_shutdown ( &ftp->control, rc );
+	for_each_ftp_connection ( conn, ftp ) {
+		intf_shutdown ( &conn->data, rc );
+		intf_shutdown ( &conn->control, rc );
+	}
 	intf_shutdown ( &ftp->xfer, rc );
 }
 
+/**
+ * Mark FTP connection as complete
+ *
+ * @v conn		FTP connection
+ *
+ * This is used only for segmented downloads, once the connection has
+ * received all data within its segment.
+ */
+static void ftp_connection_done ( struct ftp_connection *conn ) {
+	struct ftp_request *ftp = conn->ftp;
+	struct ftp_connection *other;
+
+	DBGC ( ftp, "FTP %p segment ending at %#zx received\n",
+	       ftp, conn->end );
+
+	/* Abandon the remainder of the transfer on this connection */
+	conn->state = FTP_DONE;
+	intf_restart ( &conn->data, 0 );
+	intf_restart ( &conn->control, 0 );
+
+	/* Complete request once all segments have been received */
+	for_each_ftp_connection ( other, ftp ) {
+		if ( other->end && ( other->state != FTP_DONE ) )
+			return;
+	}
+	ftp_done ( ftp, 0 );
+}
+
 /*****************************************************************************
  *
  * FTP control channel
@@ -113,57 +199,107 @@ struct ftp_control_string {
 	const char *literal;
 	/** Variable portion
 	 *
-	 * @v ftp	FTP request
+	 * @v conn	FTP connection
 	 * @ret string	Variable portion of string
 	 */
-	const char * ( *variable ) ( struct ftp_request *ftp );
+	const char * ( *variable ) ( struct ftp_connection *conn );
+	/** Next command may be sent without waiting for a response */
+	int pipeline;
 };
 
 /**
  * Retrieve FTP pathname
  *
- * @v ftp		FTP request
+ * @v conn		FTP connection
  * @ret path		FTP pathname
  */
-static const char * ftp_uri_path ( struct ftp_request *ftp ) {
-	return ftp->uri->path;
+static const char * ftp_uri_path ( struct ftp_connection *conn ) {
+	return conn->ftp->uri->path;
 }
 
 /**
  * Retrieve FTP user
  *
- * @v ftp		FTP request
+ * @v conn		FTP connection
  * @ret user		FTP user
  */
-static const char * ftp_user ( struct ftp_request *ftp ) {
+static const char * ftp_user ( struct ftp_connection *conn ) {
 	static char *ftp_default_user = "anonymous";
-	return ftp->uri->user ? ftp->uri->user : ftp_default_user;
+	struct uri *uri = conn->ftp->uri;
+
+	return uri->user ? uri->user : ftp_default_user;
 }
 
 /**
  * Retrieve FTP password
  *
- * @v ftp		FTP request
+ * @v conn		FTP connection
  * @ret password	FTP password
  */
-static const char * ftp_password ( struct ftp_request *ftp ) {
+static const char * ftp_password ( struct ftp_connection *conn ) {
 	static char *ftp_default_password = "ipxe@ipxe.org";
-	return ftp->uri->password ? ftp->uri->password : ftp_default_password;
+	struct uri *uri = conn->ftp->uri;
+
+	return uri->password ? uri->password : ftp_default_password;
 }
 
-/** FTP control channel strings */
+/**
+ * Retrieve FTP restart offset
+ *
+ * @v conn		FTP connection
+ * @ret offset		Restart offset
+ */
+static const char * ftp_rest_offset ( struct ftp_connection *conn ) {
+	snprintf ( conn->rest_text, sizeof ( conn->rest_text ), "%zd",
+		   conn->offset );
+	return conn->rest_text;
+}
+
+/** FTP control channel strings
+ *
+ * The login sequence and the SIZE command do not depend upon each
+ * other's results, and so are pipelined: they are sent together as
+ * soon as the server's greeting is received, saving several round
+ * trips.  PASV must complete before the data connection can be
+ * opened, and so ends the pipelined sequence.
+ */
 static struct ftp_control_string ftp_strings[] = {
-	[FTP_CONNECT]	= { NULL, NULL },
-	[FTP_USER]	= { "USER ", ftp_user },
-	[FTP_PASS]	= { "PASS ", ftp_password },
-	[FTP_TYPE]	= { "TYPE I", NULL },
-	[FTP_PASV]	= { "PASV", NULL },
-	[FTP_RETR]	= { "RETR ", ftp_uri_path },
-	[FTP_WAIT]	= { NULL, NULL },
-	[FTP_QUIT]	= { "QUIT", NULL },
-	[FTP_DONE]	= { NULL, NULL },
+	[FTP_CONNECT]	= { NULL, NULL, 0 },
+	[FTP_USER]	= { "USER ", ftp_user, 1 },
+	[FTP_PASS]	= { "PASS ", ftp_password, 1 },
+	[FTP_TYPE]	= { "TYPE I", NULL, 1 },
+	[FTP_SIZE]	= { "SIZE ", ftp_uri_path, 1 },
+	[FTP_PASV]	= { "PASV", NULL, 0 },
+	[FTP_REST]	= { "REST ", ftp_rest_offset, 1 },
+	[FTP_RETR]	= { "RETR ", ftp_uri_path, 0 },
+	[FTP_WAIT]	= { NULL, NULL, 0 },
+	[FTP_QUIT]	= { "QUIT", NULL, 0 },
+	[FTP_DONE]	= { NULL, NULL, 0 },
 };
 
+/**
+ * Check if FTP state applies to a connection
+ *
+ * @v conn		FTP connection
+ * @v state		FTP state
+ * @ret applies		State applies to this connection
+ */
+static int ftp_state_applies ( struct ftp_connection *conn,
+			       enum ftp_state state ) {
+
+	switch ( state ) {
+	case FTP_SIZE:
+		/* File size is required only for segmented downloads */
+		return ( ( FTP_SEGMENTS > 1 ) &&
+			 ( conn == &conn->ftp->conns[0] ) );
+	case FTP_REST:
+		/* Restart is required only for later segments */
+		return ( conn->offset != 0 );
+	default:
+		return 1;
+	}
+}
+
 /**
  * Parse FTP byte sequence value
  *
@@ -188,43 +324,128 @@ static void ftp_parse_value ( char **text, uint8_t *value, size_t len ) {
 }
 
 /**
- * Move to next state and send the appropriate FTP control string
+ * Move to next state and send the appropriate FTP control strings
  *
- * @v ftp		FTP request
+ * @v conn		FTP connection
  *
+ * If the control string for the new state has not already been sent,
+ * then it is sent along with any control strings that may be
+ * pipelined after it.
  */
-static void ftp_next_state ( struct ftp_request *ftp ) {
+static void ftp_next_state ( struct ftp_connection *conn ) {
+	struct ftp_request *ftp = conn->ftp;
 	struct ftp_control_string *ftp_string;
+	enum ftp_state state;
 	const char *literal;
 	const char *variable;
 
-	/* Move to next state */
-	if ( ftp->state < FTP_DONE )
-		ftp->state++;
-
-	/* Send control string if needed */
-	ftp_string = &ftp_strings[ftp->state];
-	literal = ftp_string->literal;
-	variable = ( ftp_string->variable ?
-		     ftp_string->variable ( ftp ) : "" );
-	if ( literal ) {
-		DBGC ( ftp, "FTP %p sending %s%s\n", ftp, literal, variable );
-		xfer_printf ( &ftp->control, "%s%s\r\n", literal, variable );
+	/* Move to next applicable state */
+	do {
+		if ( conn->state < FTP_DONE )
+			conn->state++;
+	} while ( ( conn->state < FTP_DONE ) &&
+		  ( ! ftp_state_applies ( conn, conn->state ) ) );
+
+	/* Do nothing further if control string has already been sent */
+	if ( conn->state <= conn->sent )
+		return;
+
+	/* Send control strings as needed */
+	for ( state = conn->state ; state <= FTP_DONE ; state++ ) {
+		if ( ! ftp_state_applies ( conn, state ) )
+			continue;
+		conn->sent = state;
+		ftp_string = &ftp_strings[state];
+		literal = ftp_string->literal;
+		variable = ( ftp_string->variable ?
+			     ftp_string->variable ( conn ) : "" );
+		if ( literal ) {
+			DBGC ( ftp, "FTP %p sending %s%s\n",
+			       ftp, literal, variable );
+			xfer_printf ( &conn->control, "%s%s\r\n",
+				      literal, variable );
+		}
+		if ( ! ftp_string->pipeline )
+			break;
 	}
 }
 
 /**
- * Handle an FTP control channel response
+ * Start segmented download, if applicable
  *
  * @v ftp		FTP request
+ * @v total		Total file size
+ * @ret rc		Return status code
+ *
+ * This is called once the response to "SIZE" has been received on
+ * the primary connection.  If the file is sufficiently large, then
+ * additional connections are opened to fetch all but the first
+ * segment of the file in parallel, using "REST" to start each
+ * transfer at the appropriate offset.
+ */
+static int ftp_segment_start ( struct ftp_request *ftp, size_t total ) {
+	struct ftp_connection *conn;
+	struct sockaddr_tcpip server;
+	size_t segment_len;
+	unsigned int count;
+	unsigned int i;
+	int rc;
+
+	/* Allow recipient to preallocate space for the whole file */
+	xfer_seek ( &ftp->xfer, total );
+	xfer_seek ( &ftp->xfer, 0 );
+
+	/* Check that a segmented download is worthwhile */
+	if ( total < ( 2 * FTP_SEGMENT_MIN_LEN ) )
+		return 0;
+	count = ( total / FTP_SEGMENT_MIN_LEN );
+	if ( count > FTP_SEGMENTS )
+		count = FTP_SEGMENTS;
+	segment_len = ( ( total + count - 1 ) / count );
+	DBGC ( ftp, "FTP %p downloading %zd bytes as %d segments of %zd "
+	       "bytes\n", ftp, total, count, segment_len );
+
+	/* Limit primary connection to first segment */
+	ftp->segmented = 1;
+	ftp->conns[0].end = segment_len;
+
+	/* Open additional connections */
+	memset ( &server, 0, sizeof ( server ) );
+	server.st_port = htons ( uri_port ( ftp->uri, FTP_PORT ) );
+	for ( i = 1 ; i < count ; i++ ) {
+		conn = &ftp->conns[i];
+		conn->offset = ( i * segment_len );
+		conn->end = ( conn->offset + segment_len );
+		if ( conn->end > total )
+			conn->end = total;
+		if ( ( rc = xfer_open_named_socket ( &conn->control,
+						     SOCK_STREAM,
+						     ( struct sockaddr * )
+						     &server, ftp->uri->host,
+						     NULL ) ) != 0 ) {
+			DBGC ( ftp, "FTP %p could not open segment: %s\n",
+			       ftp, strerror ( rc ) );
+			return rc;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Handle an FTP control channel response
+ *
+ * @v conn		FTP connection
  *
  * This is called once we have received a complete response line.
  */
-static void ftp_reply ( struct ftp_request *ftp ) {
-	char status_major = ftp->status_text[0];
-	char separator = ftp->status_text[3];
+static void ftp_reply ( struct ftp_connection *conn ) {
+	struct ftp_request *ftp = conn->ftp;
+	char status_major = conn->status_text[0];
+	char separator = conn->status_text[3];
+	int rc;
 
-	DBGC ( ftp, "FTP %p received status %s\n", ftp, ftp->status_text );
+	DBGC ( ftp, "FTP %p received status %s\n", ftp, conn->status_text );
 
 	/* Ignore malformed lines */
 	if ( separator != ' ' )
@@ -235,31 +456,52 @@ static void ftp_reply ( struct ftp_request *ftp ) {
 		return;
 
 	/* Anything other than success (2xx) or, in the case of a
-	 * repsonse to a "USER" command, a password prompt (3xx), is a
-	 * fatal error.
+	 * response to a "USER" or "REST" command, a request for
+	 * further information (3xx), is a fatal error.  Since "PASS"
+	 * is pipelined, any response to it is ignored if the server
+	 * did not require a password.  A failed "SIZE" merely
+	 * prevents a segmented download.
 	 */
 	if ( ! ( ( status_major == '2' ) ||
-		 ( ( status_major == '3' ) && ( ftp->state == FTP_USER ) ) ) ){
+		 ( ( status_major == '3' ) &&
+		   ( ( conn->state == FTP_USER ) ||
+		     ( conn->state == FTP_REST ) ) ) ||
+		 ( ( conn->state == FTP_PASS ) &&
+		   ( conn->flags & FTP_NO_PASSWORD ) ) ||
+		 ( conn->state == FTP_SIZE ) ) ) {
 		/* Flag protocol error and close connections */
 		ftp_done ( ftp, -EPROTO );
 		return;
 	}
 
+	/* Record whether or not a password was required */
+	if ( ( conn->state == FTP_USER ) && ( status_major == '2' ) )
+		conn->flags |= FTP_NO_PASSWORD;
+
+	/* Start segmented download when we get "SIZE" response */
+	if ( ( conn->state == FTP_SIZE ) && ( status_major == '2' ) ) {
+		size_t total = strtoul ( conn->param_text, NULL, 10 );
+
+		if ( ( rc = ftp_segment_start ( ftp, total ) ) != 0 ) {
+			ftp_done ( ftp, rc );
+			return;
+		}
+	}
+
 	/* Open passive connection when we get "PASV" response */
-	if ( ftp->state == FTP_PASV ) {
-		char *ptr = ftp->passive_text;
+	if ( conn->state == FTP_PASV ) {
+		char *ptr = conn->passive_text;
 		union {
 			struct sockaddr_in sin;
 			struct sockaddr sa;
 		} sa;
-		int rc;
 
 		sa.sin.sin_family = AF_INET;
 		ftp_parse_value ( &ptr, ( uint8_t * ) &sa.sin.sin_addr,
 				  sizeof ( sa.sin.sin_addr ) );
 		ftp_parse_value ( &ptr, ( uint8_t * ) &sa.sin.sin_port,
 				  sizeof ( sa.sin.sin_port ) );
-		if ( ( rc = xfer_open_socket ( &ftp->data, SOCK_STREAM,
+		if ( ( rc = xfer_open_socket ( &conn->data, SOCK_STREAM,
 					       &sa.sa, NULL ) ) != 0 ) {
 			DBGC ( ftp, "FTP %p could not open data connection\n",
 			       ftp );
@@ -269,14 +511,13 @@ static void ftp_reply ( struct ftp_request *ftp ) {
 	}
 
 	/* Move to next state and send control string */
-	ftp_next_state ( ftp );
-	
+	ftp_next_state ( conn );
 }
 
 /**
  * Handle new data arriving on FTP control channel
  *
- * @v ftp		FTP request
+ * @v conn		FTP connection
  * @v iob		I/O buffer
  * @v meta		Data transfer metadata
  * @ret rc		Return status code
@@ -284,15 +525,15 @@ static void ftp_reply ( struct ftp_request *ftp ) {
  * Data is collected until a complete line is received, at which point
  * its information is passed to ftp_reply().
  */
-static int ftp_control_deliver ( struct ftp_request *ftp,
+static int ftp_control_deliver ( struct ftp_connection *conn,
 				 struct io_buffer *iobuf,
 				 struct xfer_metadata *meta __unused ) {
 	char *data = iobuf->data;
 	size_t len = iob_len ( iobuf );
-	char *recvbuf = ftp->recvbuf;
-	size_t recvsize = ftp->recvsize;
+	char *recvbuf = conn->recvbuf;
+	size_t recvsize = conn->recvsize;
 	char c;
-	
+
 	while ( len-- ) {
 		c = *(data++);
 		switch ( c ) {
@@ -302,16 +543,24 @@ static int ftp_control_deliver ( struct ftp_request *ftp,
 			 * completed reply.  Avoid calling ftp_reply()
 			 * twice if we receive both \r and \n.
 			 */
-			if ( recvsize == 0 )
-				ftp_reply ( ftp );
+			if ( conn->line_len >= ( sizeof ( conn->status_text )
+						 - 1 ) ) {
+				ftp_reply ( conn );
+			}
+			/* Abandon processing if connection has closed */
+			if ( conn->state == FTP_DONE )
+				goto done;
 			/* Start filling up the status code buffer */
-			recvbuf = ftp->status_text;
-			recvsize = sizeof ( ftp->status_text ) - 1;
+			recvbuf = conn->status_text;
+			recvsize = sizeof ( conn->status_text ) - 1;
+			conn->line_len = 0;
+			memset ( conn->param_text, 0,
+				 sizeof ( conn->param_text ) );
 			break;
 		case '(' :
 			/* Start filling up the passive parameter buffer */
-			recvbuf = ftp->passive_text;
-			recvsize = sizeof ( ftp->passive_text ) - 1;
+			recvbuf = conn->passive_text;
+			recvsize = sizeof ( conn->passive_text ) - 1;
 			break;
 		case ')' :
 			/* Stop filling the passive parameter buffer */
@@ -319,33 +568,60 @@ static int ftp_control_deliver ( struct ftp_request *ftp,
 			break;
 		default :
 			/* Fill up buffer if applicable */
+			conn->line_len++;
 			if ( recvsize > 0 ) {
 				*(recvbuf++) = c;
 				recvsize--;
+				/* Follow status code with reply parameter */
+				if ( recvbuf == &conn->status_text[4] ) {
+					recvbuf = conn->param_text;
+					recvsize = ( sizeof ( conn->param_text )
+						     - 1 );
+				}
 			}
 			break;
 		}
 	}
 
 	/* Store for next invocation */
-	ftp->recvbuf = recvbuf;
-	ftp->recvsize = recvsize;
+	conn->recvbuf = recvbuf;
+	conn->recvsize = recvsize;
 
+ done:
 	/* Free I/O buffer */
 	free_iob ( iobuf );
 
 	return 0;
 }
 
+/**
+ * Handle FTP control channel being closed
+ *
+ * @v conn		FTP connection
+ * @v rc		Reason for closure
+ */
+static void ftp_control_closed ( struct ftp_connection *conn, int rc ) {
+	struct ftp_request *ftp = conn->ftp;
+
+	DBGC ( ftp, "FTP %p control connection closed: %s\n",
+	       ftp, strerror ( rc ) );
+
+	/* A segment's control connection must not close prematurely */
+	if ( ( rc == 0 ) && conn->end )
+		rc = -ECONNRESET;
+
+	ftp_done ( ftp, rc );
+}
+
 /** FTP control channel interface operations */
 static struct interface_operation ftp_control_operations[] = {
-	INTF_OP ( xfer_deliver, struct ftp_request *, ftp_control_deliver ),
-	INTF_OP ( intf_close, struct ftp_request *, ftp_done ),
+	INTF_OP ( xfer_deliver, struct ftp_connection *, ftp_control_deliver ),
+	INTF_OP ( intf_close, struct ftp_connection *, ftp_control_closed ),
 };
 
 /** FTP control channel interface descriptor */
 static struct interface_descriptor ftp_control_desc =
-	INTF_DESC ( struct ftp_request, control, ftp_control_operations );
+	INTF_DESC ( struct ftp_connection, control, ftp_control_operations );
 
 /*****************************************************************************
  *
@@ -353,10 +629,55 @@ static struct interface_descriptor ftp_control_desc =
  *
  */
 
+/**
+ * Handle new data arriving on FTP data channel
+ *
+ * @v conn		FTP connection
+ * @v iobuf		I/O buffer
+ * @v meta		Data transfer metadata
+ * @ret rc		Return status code
+ */
+static int ftp_data_deliver ( struct ftp_connection *conn,
+			      struct io_buffer *iobuf,
+			      struct xfer_metadata *meta ) {
+	struct ftp_request *ftp = conn->ftp;
+	struct xfer_metadata data_meta;
+	size_t len = iob_len ( iobuf );
+	int rc;
+
+	/* Discard anything beyond the end of this segment */
+	if ( conn->end && ( len > ( conn->end - conn->offset ) ) ) {
+		len = ( conn->end - conn->offset );
+		iob_unput ( iobuf, ( iob_len ( iobuf ) - len ) );
+	}
+
+	/* Segments are delivered out of order, so use absolute offsets */
+	if ( ftp->segmented ) {
+		memset ( &data_meta, 0, sizeof ( data_meta ) );
+		data_meta.flags = XFER_FL_ABS_OFFSET;
+		data_meta.offset = conn->offset;
+		meta = &data_meta;
+	}
+	conn->offset += len;
+
+	/* Pass data to recipient */
+	if ( ( rc = xfer_deliver ( &ftp->xfer, iob_disown ( iobuf ),
+				   meta ) ) != 0 ) {
+		ftp_done ( ftp, rc );
+		return rc;
+	}
+
+	/* Check for end of segment */
+	if ( conn->end && ( conn->offset == conn->end ) )
+		ftp_connection_done ( conn );
+
+	return 0;
+}
+
 /**
  * Handle FTP data channel being closed
  *
- * @v ftp		FTP request
+ * @v conn		FTP connection
  * @v rc		Reason for closure
  *
  * When the data channel is closed, the control channel should be left
@@ -365,28 +686,33 @@ static struct interface_descriptor ftp_control_desc =
  *
  * If the data channel is closed due to an error, we abort the request.
  */
-static void ftp_data_closed ( struct ftp_request *ftp, int rc ) {
+static void ftp_data_closed ( struct ftp_connection *conn, int rc ) {
+	struct ftp_request *ftp = conn->ftp;
 
 	DBGC ( ftp, "FTP %p data connection closed: %s\n",
 	       ftp, strerror ( rc ) );
-	
+
+	/* A segment's data connection must not close prematurely */
+	if ( ( rc == 0 ) && conn->end )
+		rc = -ECONNRESET;
+
 	/* If there was an error, close control channel and record status */
 	if ( rc ) {
 		ftp_done ( ftp, rc );
 	} else {
-		ftp_next_state ( ftp );
+		ftp_next_state ( conn );
 	}
 }
 
 /** FTP data channel interface operations */
 static struct interface_operation ftp_data_operations[] = {
-	INTF_OP ( intf_close, struct ftp_request *, ftp_data_closed ),
+	INTF_OP ( xfer_deliver, struct ftp_connection *, ftp_data_deliver ),
+	INTF_OP ( intf_close, struct ftp_connection *, ftp_data_closed ),
 };
 
 /** FTP data channel interface descriptor */
 static struct interface_descriptor ftp_data_desc =
-	INTF_DESC_PASSTHRU ( struct ftp_request, data, ftp_data_operations,
-			     xfer );
+	INTF_DESC ( struct ftp_connection, data, ftp_data_operations );
 
 /*****************************************************************************
  *
@@ -401,8 +727,7 @@ static struct interface_operation ftp_xfer_operations[] = {
 
 /** FTP data transfer interface descriptor */
 static struct interface_descriptor ftp_xfer_desc =
-	INTF_DESC_PASSTHRU ( struct ftp_request, xfer, ftp_xfer_operations,
-			     data );
+	INTF_DESC ( struct ftp_request, xfer, ftp_xfer_operations );
 
 /*****************************************************************************
  *
@@ -419,6 +744,7 @@ static struct interface_descriptor ftp_xfer_desc =
  */
 static int ftp_open ( struct interface *xfer, struct uri *uri ) {
 	struct ftp_request *ftp;
+	struct ftp_connection *conn;
 	struct sockaddr_tcpip server;
 	int rc;
 
@@ -434,18 +760,22 @@ static int ftp_open ( struct interface *xfer, struct uri *uri ) {
 		return -ENOMEM;
 	ref_init ( &ftp->refcnt, ftp_free );
 	intf_init ( &ftp->xfer, &ftp_xfer_desc, &ftp->refcnt );
-	intf_init ( &ftp->control, &ftp_control_desc, &ftp->refcnt );
-	intf_init ( &ftp->data, &ftp_data_desc, &ftp->refcnt );
+	for_each_ftp_connection ( conn, ftp ) {
+		conn->ftp = ftp;
+		intf_init ( &conn->control, &ftp_control_desc, &ftp->refcnt );
+		intf_init ( &conn->data, &ftp_data_desc, &ftp->refcnt );
+		conn->recvbuf = conn->status_text;
+		conn->recvsize = sizeof ( conn->status_text ) - 1;
+	}
 	ftp->uri = uri_get ( uri );
-	ftp->recvbuf = ftp->status_text;
-	ftp->recvsize = sizeof ( ftp->status_text ) - 1;
 
 	DBGC ( ftp, "FTP %p fetching %s\n", ftp, ftp->uri->path );
 
 	/* Open control connection */
 	memset ( &server, 0, sizeof ( server ) );
 	server.st_port = htons ( uri_port ( uri, FTP_PORT ) );
-	if ( ( rc = xfer_open_named_socket ( &ftp->control, SOCK_STREAM,
+	if ( ( rc = xfer_open_named_socket ( &ftp->conns[0].control,
+					     SOCK_STREAM,
 					     ( struct sockaddr * ) &server,
 					     uri->host, NULL ) ) != 0 )
 		goto err;
@@ -456,7 +786,7 @@ static int ftp_open ( struct interface *xfer, struct uri *uri ) {
 	return 0;
 
  err:
-	DBGC ( ftp, "FTP %p could not create request: %s\n", 
+	DBGC ( ftp, "FTP %p could not create request: %s\n",
 	       ftp, strerror ( rc ) );
 	ftp_done ( ftp, rc );
 	ref_put ( &ftp->refcnt );
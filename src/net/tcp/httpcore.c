@@ -30,6 +30,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <stdio.h>
 #include <string.h>
 #include <strings.h>
+#include <ctype.h>
 #include <byteswap.h>
 #include <errno.h>
 #include <assert.h>
@@ -41,11 +42,16 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/socket.h>
 #include <ipxe/tcpip.h>
 #include <ipxe/process.h>
+#include <ipxe/retry.h>
+#include <ipxe/timer.h>
+#include <ipxe/init.h>
 #include <ipxe/linebuf.h>
 #include <ipxe/base64.h>
 #include <ipxe/blockdev.h>
 #include <ipxe/acpi.h>
 #include <ipxe/http.h>
+#include <ipxe/netstat.h>
+#include <config/general.h>
 
 /* Disambiguate the various error causes */
 #define EACCES_401 __einfo_error ( EINFO_EACCES_401 )
@@ -82,6 +88,30 @@ FILE_LICENCE ( GPL2_OR_LATER );
 /** Block size used for HTTP block device request */
 #define HTTP_BLKSIZE 512
 
+/** Maximum number of blocks per HTTP block device request
+ *
+ * Limiting the size of each request allows large block device reads
+ * to be split into several pipelined requests.
+ */
+#define HTTP_MAX_COUNT 64
+
+/** Maximum number of outstanding partial transfers
+ *
+ * Partial transfers are pipelined on the (kept-alive) connection,
+ * hiding the per-request latency of the server.  Responses are
+ * received in the order in which the requests were transmitted.
+ */
+#define HTTP_MAX_PARTIALS 4
+
+/** Minimum length of each segment of a segmented download */
+#define HTTP_SEGMENT_MIN_LEN ( 1024 * 1024 )
+
+/** Maximum length of each range request within a segment */
+#define HTTP_SEGMENT_CHUNK_LEN ( 64 * 1024 )
+
+/** Time for which an idle connection is retained */
+#define HTTP_POOL_TIMEOUT ( 10 * TICKS_PER_SEC )
+
 /** HTTP flags */
 enum http_flags {
 	/** Request is waiting to be transmitted */
@@ -90,6 +120,20 @@ enum http_flags {
 	HTTP_HEAD_ONLY = 0x0002,
 	/** Keep connection alive */
 	HTTP_KEEPALIVE = 0x0004,
+	/** Server accepts byte range requests */
+	HTTP_ACCEPT_RANGES = 0x0008,
+	/** Download is split into parallel segments */
+	HTTP_SEGMENTED = 0x0010,
+	/** First segment of segmented download has been received */
+	HTTP_FIRST_SEGMENT_DONE = 0x0020,
+	/** Server will close connection after this response */
+	HTTP_SERVER_CLOSE = 0x0040,
+	/** Connection was reused from the idle connection pool */
+	HTTP_REUSED = 0x0080,
+	/** Request is queued behind another request on its connection */
+	HTTP_PIPELINED = 0x0100,
+	/** Connection must not be reused after this response */
+	HTTP_NO_REUSE = 0x0200,
 };
 
 /** HTTP receive state */
@@ -103,6 +147,55 @@ enum http_rx_state {
 	HTTP_RX_DEAD,
 };
 
+/** An HTTP partial transfer */
+struct http_partial {
+	/** HTTP request */
+	struct http_request *http;
+	/** Partial transfer interface */
+	struct interface partial;
+	/** Starting offset */
+	size_t start;
+	/** Length (or 0 to fetch header only) */
+	size_t len;
+	/** Data buffer */
+	userptr_t buffer;
+};
+
+/** An HTTP download segment
+ *
+ * A segmented download receives the first segment via the original
+ * connection, and each subsequent segment via an additional
+ * connection using range requests.
+ */
+struct http_segment {
+	/** HTTP request */
+	struct http_request *http;
+	/** Block device control interface */
+	struct interface control;
+	/** Block device data interface */
+	struct interface data;
+	/** Offset of next data to be requested */
+	size_t offset;
+	/** End of segment */
+	size_t end;
+	/** Length of range request in progress, or zero */
+	size_t len;
+	/** Data buffer for range request in progress, if not placed
+	 * directly into the recipient's buffer
+	 */
+	struct io_buffer *iobuf;
+};
+
+/** Iterate over additional download segments
+ *
+ * @v segment		Download segment
+ * @v http		HTTP request
+ */
+#define for_each_http_segment( segment, http )				\
+	for ( (segment) = (http)->segments ;				\
+	      (segment) < &(http)->segments[ HTTP_SEGMENTS - 1 ] ;	\
+	      (segment)++ )
+
 /**
  * An HTTP request
  *
@@ -110,22 +203,41 @@ enum http_rx_state {
 struct http_request {
 	/** Reference count */
 	struct refcnt refcnt;
+	/** List of HTTP requests */
+	struct list_head list;
 	/** Data transfer interface */
 	struct interface xfer;
-	/** Partial transfer interface */
-	struct interface partial;
+	/** Partial transfers */
+	struct http_partial partials[HTTP_MAX_PARTIALS];
+	/** Partial transfer producer counter */
+	unsigned int partial_prod;
+	/** Partial transfer transmit counter */
+	unsigned int partial_tx;
+	/** Partial transfer consumer (i.e. receive) counter */
+	unsigned int partial_cons;
+	/** Additional download segments */
+	struct http_segment segments[ HTTP_SEGMENTS - 1 ];
+	/** Download segment process */
+	struct process segment_process;
 
 	/** URI being fetched */
 	struct uri *uri;
+	/** Server port */
+	unsigned int port;
+	/** Filter to apply to socket, or NULL */
+	int ( * filter ) ( struct interface *xfer, const char *name,
+			   unsigned int port, struct interface **next );
 	/** Transport layer interface */
 	struct interface socket;
+	/** Request preceding this request on a pipelined connection */
+	struct http_request *prev;
+	/** Request following this request on a pipelined connection */
+	struct http_request *next;
+	/** Request which has just taken over our connection, if any */
+	struct http_request *handoff;
 
 	/** Flags */
 	unsigned int flags;
-	/** Starting offset of partial transfer (if applicable) */
-	size_t partial_start;
-	/** Length of partial transfer (if applicable) */
-	size_t partial_len;
 
 	/** TX process */
 	struct process process;
@@ -140,12 +252,422 @@ struct http_request {
 	int chunked;
 	/** Current chunk length remaining (if applicable) */
 	size_t chunk_remaining;
+	/** Content encoding, or NULL if content is not encoded */
+	struct http_content_encoding *encoding;
 	/** Line buffer for received header lines */
 	struct line_buffer linebuf;
 	/** Receive data buffer (if applicable) */
 	userptr_t rx_buffer;
 };
 
+/**
+ * An idle HTTP connection
+ *
+ * Connections which remain usable once a response has been received
+ * are retained for a short while, so that subsequent requests to the
+ * same server may avoid the cost of establishing a new connection
+ * (and, for HTTPS, a new TLS session).
+ */
+struct http_connection {
+	/** Reference count */
+	struct refcnt refcnt;
+	/** List of idle connections */
+	struct list_head list;
+	/** Transport layer interface */
+	struct interface socket;
+	/** Idle timer */
+	struct retry_timer timer;
+	/** Server port */
+	unsigned int port;
+	/** Filter applied to socket, or NULL */
+	int ( * filter ) ( struct interface *xfer, const char *name,
+			   unsigned int port, struct interface **next );
+	/** Server host name */
+	char host[0];
+};
+
+/** Idle HTTP connections (most recently used first) */
+static LIST_HEAD ( http_pool );
+
+/** HTTP statistics */
+struct http_statistics {
+	/** Number of new connections opened */
+	unsigned int connections;
+	/** Number of idle connections reused */
+	unsigned int reused;
+	/** Number of redirections followed */
+	unsigned int redirects;
+	/** Number of error responses received */
+	unsigned int errors;
+};
+
+/** HTTP statistics */
+static struct http_statistics http_stats;
+
+/** HTTP statistics */
+struct net_statistic http_net_statistics[]
+	__net_statistic ( NET_STAT_APPLICATION ) = {
+	{ "HTTP", "CONN", &http_stats.connections },
+	{ "HTTP", "REUSE", &http_stats.reused },
+	{ "HTTP", "REDIR", &http_stats.redirects },
+	{ "HTTP", "ERROR", &http_stats.errors },
+};
+
+/**
+ * Close idle HTTP connection
+ *
+ * @v conn		Idle connection
+ * @v rc		Reason for close
+ */
+static void http_pool_close ( struct http_connection *conn, int rc ) {
+
+	DBGC ( conn, "HTTP %p idle connection to %s closed: %s\n",
+	       conn, conn->host, strerror ( rc ) );
+
+	/* Stop timer and close socket */
+	stop_timer ( &conn->timer );
+	intf_shutdown ( &conn->socket, rc );
+
+	/* Remove from pool and drop pool's reference */
+	if ( ! list_empty ( &conn->list ) ) {
+		list_del ( &conn->list );
+		INIT_LIST_HEAD ( &conn->list );
+		ref_put ( &conn->refcnt );
+	}
+}
+
+/**
+ * Receive data on idle HTTP connection
+ *
+ * @v conn		Idle connection
+ * @v iobuf		I/O buffer
+ * @v meta		Data transfer metadata
+ * @ret rc		Return status code
+ */
+static int http_pool_deliver ( struct http_connection *conn,
+			       struct io_buffer *iobuf,
+			       struct xfer_metadata *meta __unused ) {
+
+	DBGC ( conn, "HTTP %p received %zd bytes while idle\n",
+	       conn, iob_len ( iobuf ) );
+	free_iob ( iobuf );
+	http_pool_close ( conn, -EPROTO_UNSOLICITED );
+	return -EPROTO_UNSOLICITED;
+}
+
+/**
+ * Handle idle HTTP connection timer expiry
+ *
+ * @v timer		Idle timer
+ * @v fail		Failure indicator
+ */
+static void http_pool_expired ( struct retry_timer *timer,
+				int fail __unused ) {
+	struct http_connection *conn =
+		container_of ( timer, struct http_connection, timer );
+
+	http_pool_close ( conn, 0 );
+}
+
+/** Idle HTTP connection socket interface operations */
+static struct interface_operation http_pool_socket_operations[] = {
+	INTF_OP ( xfer_deliver, struct http_connection *, http_pool_deliver ),
+	INTF_OP ( intf_close, struct http_connection *, http_pool_close ),
+};
+
+/** Idle HTTP connection socket interface descriptor */
+static struct interface_descriptor http_pool_socket_desc =
+	INTF_DESC ( struct http_connection, socket,
+		    http_pool_socket_operations );
+
+/**
+ * Return HTTP connection to idle connection pool
+ *
+ * @v http		HTTP request
+ */
+static void http_pool_put ( struct http_request *http ) {
+	struct http_connection *conn;
+	struct http_connection *oldest;
+	size_t host_len = ( strlen ( http->uri->host ) + 1 /* NUL */ );
+	unsigned int count = 0;
+
+	/* Do nothing if connection pooling is disabled */
+	if ( ! HTTP_POOL )
+		return;
+
+	/* Allocate and initialise structure */
+	conn = zalloc ( sizeof ( *conn ) + host_len );
+	if ( ! conn )
+		return;
+	ref_init ( &conn->refcnt, NULL );
+	intf_init ( &conn->socket, &http_pool_socket_desc, &conn->refcnt );
+	timer_init ( &conn->timer, http_pool_expired, &conn->refcnt );
+	conn->port = http->port;
+	conn->filter = http->filter;
+	memcpy ( conn->host, http->uri->host, host_len );
+
+	/* Evict least recently used connection if pool is full */
+	list_for_each_entry ( oldest, &http_pool, list )
+		count++;
+	if ( ( count + 1 ) > HTTP_POOL ) {
+		oldest = list_entry ( http_pool.prev, struct http_connection,
+				      list );
+		http_pool_close ( oldest, 0 );
+	}
+
+	/* Take ownership of socket and add to pool */
+	intf_plug_plug ( &conn->socket, http->socket.dest );
+	intf_unplug ( &http->socket );
+	list_add ( &conn->list, &http_pool );
+	start_timer_fixed ( &conn->timer, HTTP_POOL_TIMEOUT );
+	DBGC ( conn, "HTTP %p retaining idle connection to %s:%d\n",
+	       conn, conn->host, conn->port );
+}
+
+/**
+ * Take HTTP connection from idle connection pool
+ *
+ * @v http		HTTP request
+ * @ret found		An idle connection was found
+ */
+static int http_pool_get ( struct http_request *http ) {
+	struct http_connection *conn;
+
+	list_for_each_entry ( conn, &http_pool, list ) {
+		if ( ( conn->port == http->port ) &&
+		     ( conn->filter == http->filter ) &&
+		     ( strcmp ( conn->host, http->uri->host ) == 0 ) ) {
+			intf_plug_plug ( &http->socket, conn->socket.dest );
+			intf_unplug ( &conn->socket );
+			http_pool_close ( conn, 0 );
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Close all idle HTTP connections
+ *
+ * @v booting		System is shutting down for OS boot
+ */
+static void http_pool_shutdown ( int booting __unused ) {
+	struct http_connection *conn;
+	struct http_connection *tmp;
+
+	list_for_each_entry_safe ( conn, tmp, &http_pool, list )
+		http_pool_close ( conn, 0 );
+}
+
+/** Idle HTTP connection pool shutdown function */
+struct startup_fn http_pool_startup_fn __startup_fn ( STARTUP_LATE ) = {
+	.shutdown = http_pool_shutdown,
+};
+
+/**
+ * Open HTTP socket
+ *
+ * @v http		HTTP request
+ * @ret rc		Return status code
+ */
+static int http_socket_open ( struct http_request *http ) {
+	struct sockaddr_tcpip server;
+	struct interface *socket;
+	int rc;
+
+	/* Reuse an idle connection, if one is available */
+	if ( http_pool_get ( http ) ) {
+		DBGC ( http, "HTTP %p reusing idle connection\n", http );
+		http_stats.reused++;
+		http->flags |= HTTP_REUSED;
+		process_add ( &http->process );
+		return 0;
+	}
+
+	/* Open new socket */
+	memset ( &server, 0, sizeof ( server ) );
+	server.st_port = htons ( http->port );
+	socket = &http->socket;
+	if ( http->filter ) {
+		if ( ( rc = http->filter ( socket, http->uri->host,
+					   http->port, &socket ) ) != 0 )
+			return rc;
+	}
+	/* Requests are idempotent (GET or HEAD), and so may safely be
+	 * sent within the SYN using TCP Fast Open.
+	 */
+	if ( ( rc = xfer_open_named_socket ( socket, SOCK_STREAM_FASTOPEN,
+					     ( struct sockaddr * ) &server,
+					     http->uri->host, NULL ) ) != 0 )
+		return rc;
+	http_stats.connections++;
+
+	return 0;
+}
+
+/** List of HTTP requests */
+static LIST_HEAD ( http_requests );
+
+static void http_close ( struct http_request *http, int rc );
+
+/**
+ * Mark pipelined requests for retransmission
+ *
+ * @v http		HTTP request
+ *
+ * This must be called whenever the connection to which requests have
+ * already been transmitted is replaced.
+ */
+static void http_pipeline_reset ( struct http_request *http ) {
+
+	for ( http = http->next ; http ; http = http->next )
+		http->flags |= HTTP_TX_PENDING;
+}
+
+/**
+ * Queue HTTP request behind an existing request to the same server
+ *
+ * @v http		HTTP request
+ * @ret queued		Request was queued
+ *
+ * The request will be transmitted on the existing connection (as soon
+ * as any preceding requests have been transmitted), and will take
+ * over the connection once all preceding responses have been
+ * received.
+ */
+static int http_pipeline ( struct http_request *http ) {
+	struct http_request *owner;
+	struct http_request *tail;
+	unsigned int depth;
+
+	/* Do nothing if pipelining is disabled */
+	if ( ! HTTP_PIPELINE )
+		return 0;
+
+	list_for_each_entry ( owner, &http_requests, list ) {
+
+		/* Check for a connection to the same server */
+		if ( ( owner->port != http->port ) ||
+		     ( owner->filter != http->filter ) ||
+		     ( strcmp ( owner->uri->host, http->uri->host ) != 0 ) )
+			continue;
+
+		/* Check that the connection is carrying a plain download */
+		if ( ( owner->flags & ( HTTP_PIPELINED | HTTP_HEAD_ONLY |
+					HTTP_KEEPALIVE | HTTP_SEGMENTED ) ) ||
+		     ( owner->rx_state == HTTP_RX_DEAD ) ||
+		     ( ! xfer_window ( &owner->xfer ) ) )
+			continue;
+
+		/* Find end of pipeline, and check that the connection
+		 * may be reused after the final response.
+		 */
+		depth = 0;
+		for ( tail = owner ; tail->next ; tail = tail->next )
+			depth++;
+		if ( ( ( depth + 1 ) > HTTP_PIPELINE ) ||
+		     ( ( owner->flags | tail->flags ) &
+		       ( HTTP_SERVER_CLOSE | HTTP_NO_REUSE ) ) )
+			continue;
+
+		/* Append to pipeline */
+		DBGC ( http, "HTTP %p pipelined behind %p\n", http, tail );
+		tail->next = http;
+		ref_get ( &http->refcnt );
+		http->prev = tail;
+		http->flags |= HTTP_PIPELINED;
+		process_add ( &owner->process );
+		return 1;
+	}
+
+	return 0;
+}
+
+/**
+ * Detach pipelined requests from HTTP connection
+ *
+ * @v http		HTTP request
+ *
+ * Any requests queued behind this request are moved (as a pipeline)
+ * to a separate connection.
+ */
+static void http_pipeline_detach ( struct http_request *http ) {
+	struct http_request *next = http->next;
+	int rc;
+
+	/* Do nothing unless requests are queued behind us */
+	if ( ! next )
+		return;
+
+	/* Unlink from pipeline */
+	DBGC ( http, "HTTP %p detaching pipelined request %p\n", http, next );
+	http->next = NULL;
+	next->prev = NULL;
+	next->flags &= ~HTTP_PIPELINED;
+
+	/* Reissue requests on a separate connection */
+	next->flags |= HTTP_TX_PENDING;
+	http_pipeline_reset ( next );
+	if ( ( rc = http_socket_open ( next ) ) != 0 )
+		http_close ( next, rc );
+
+	/* Drop pipeline's reference */
+	ref_put ( &next->refcnt );
+}
+
+/**
+ * Remove HTTP request from pipeline
+ *
+ * @v http		HTTP request
+ */
+static void http_pipeline_remove ( struct http_request *http ) {
+	struct http_request *prev = http->prev;
+
+	/* Do nothing unless we are queued behind another request */
+	if ( ! prev )
+		return;
+
+	/* Requests following this request can no longer share the
+	 * connection, since the response to this request may still
+	 * arrive.  For the same reason, the connection cannot be
+	 * reused once the preceding response has been received.
+	 */
+	DBGC ( http, "HTTP %p abandoning pipelined request\n", http );
+	http_pipeline_detach ( http );
+	prev->next = NULL;
+	prev->flags |= HTTP_NO_REUSE;
+	http->prev = NULL;
+	http->flags &= ~HTTP_PIPELINED;
+
+	/* Drop pipeline's reference */
+	ref_put ( &http->refcnt );
+}
+
+/**
+ * Hand HTTP connection over to next pipelined request
+ *
+ * @v http		HTTP request
+ */
+static void http_pipeline_handoff ( struct http_request *http ) {
+	struct http_request *next = http->next;
+
+	/* Unlink from pipeline, transferring the pipeline's reference */
+	DBGC ( http, "HTTP %p handing connection to %p\n", http, next );
+	http->next = NULL;
+	http->handoff = next;
+	next->prev = NULL;
+	next->flags &= ~HTTP_PIPELINED;
+
+	/* Transfer socket.  The server may still close the
+	 * connection before responding, in which case the request
+	 * must be retried using a new connection.
+	 */
+	intf_plug_plug ( &next->socket, http->socket.dest );
+	intf_unplug ( &http->socket );
+	next->flags |= HTTP_REUSED;
+	process_add ( &next->process );
+}
+
 /**
  * Free HTTP request
  *
@@ -154,7 +676,10 @@ struct http_request {
 static void http_free ( struct refcnt *refcnt ) {
 	struct http_request *http =
 		container_of ( refcnt, struct http_request, refcnt );
+	struct http_segment *segment;
 
+	for_each_http_segment ( segment, http )
+		free_iob ( segment->iobuf );
 	uri_put ( http->uri );
 	empty_line_buffer ( &http->linebuf );
 	free ( http );
@@ -167,6 +692,8 @@ static void http_free ( struct refcnt *refcnt ) {
  * @v rc		Return status code
  */
 static void http_close ( struct http_request *http, int rc ) {
+	struct http_segment *segment;
+	unsigned int i;
 
 	/* Prevent further processing of any current packet */
 	http->rx_state = HTTP_RX_DEAD;
@@ -181,21 +708,146 @@ static void http_close ( struct http_request *http, int rc ) {
 			rc = -EIO_CONTENT_LENGTH;
 	}
 
-	/* Remove process */
+	/* Remove from list of requests, and from any pipeline */
+	list_del ( &http->list );
+	INIT_LIST_HEAD ( &http->list );
+	http_pipeline_remove ( http );
+	http_pipeline_detach ( http );
+
+	/* Remove processes */
 	process_del ( &http->process );
+	process_del ( &http->segment_process );
 
 	/* Close all data transfer interfaces */
 	intf_shutdown ( &http->socket, rc );
-	intf_shutdown ( &http->partial, rc );
+	for ( i = 0 ; i < HTTP_MAX_PARTIALS ; i++ )
+		intf_shutdown ( &http->partials[i].partial, rc );
+	for_each_http_segment ( segment, http ) {
+		intf_shutdown ( &segment->data, rc );
+		intf_shutdown ( &segment->control, rc );
+	}
 	intf_shutdown ( &http->xfer, rc );
 }
 
+/**
+ * Identify partial transfer currently being received
+ *
+ * @v http		HTTP request
+ * @ret partial		Partial transfer, or NULL
+ */
+static struct http_partial * http_rx_partial ( struct http_request *http ) {
+
+	if ( http->partial_cons == http->partial_prod )
+		return NULL;
+	return &http->partials[ http->partial_cons % HTTP_MAX_PARTIALS ];
+}
+
+/**
+ * Start receiving response to partial transfer request
+ *
+ * @v http		HTTP request
+ * @v partial		Partial transfer
+ */
+static void http_rx_partial_start ( struct http_request *http,
+				    struct http_partial *partial ) {
+
+	http->rx_buffer = partial->buffer;
+	http->remaining = partial->len;
+	http->flags &= ~HTTP_HEAD_ONLY;
+	if ( ! partial->len )
+		http->flags |= HTTP_HEAD_ONLY;
+	http->rx_state = HTTP_RX_RESPONSE;
+}
+
+/**
+ * Check for completion of segmented download
+ *
+ * @v http		HTTP request
+ */
+static void http_segment_check ( struct http_request *http ) {
+	struct http_segment *segment;
+
+	/* Check that all segments have been received */
+	if ( ! ( http->flags & HTTP_FIRST_SEGMENT_DONE ) )
+		return;
+	for_each_http_segment ( segment, http ) {
+		if ( segment->len || ( segment->offset < segment->end ) )
+			return;
+	}
+
+	DBGC ( http, "HTTP %p all segments received\n", http );
+	http_close ( http, 0 );
+}
+
+/**
+ * Start segmented download, if applicable
+ *
+ * @v http		HTTP request
+ * @ret rc		Return status code
+ *
+ * This is called once the response headers for a plain download
+ * have been received.  If the server accepts range requests, and the
+ * file is sufficiently large, then additional connections are opened
+ * to fetch all but the first segment of the file in parallel.
+ */
+static int http_segment_start ( struct http_request *http ) {
+	struct http_segment *segment;
+	size_t total = http->remaining;
+	size_t segment_len;
+	unsigned int count;
+	unsigned int i;
+	int rc;
+
+	/* Check that a segmented download is possible */
+	if ( ( HTTP_SEGMENTS < 2 ) ||
+	     ( http->flags & HTTP_HEAD_ONLY ) ||
+	     ( ! ( http->flags & HTTP_ACCEPT_RANGES ) ) ||
+	     http_rx_partial ( http ) || http->chunked || http->encoding ||
+	     ( total < ( 2 * HTTP_SEGMENT_MIN_LEN ) ) )
+		return 0;
+
+	/* Calculate segment length, rounded up to a whole number of
+	 * blocks so that each range request is block-aligned.
+	 */
+	count = ( total / HTTP_SEGMENT_MIN_LEN );
+	if ( count > HTTP_SEGMENTS )
+		count = HTTP_SEGMENTS;
+	segment_len = ( ( total + count - 1 ) / count );
+	segment_len = ( ( segment_len + HTTP_BLKSIZE - 1 ) &
+			~( HTTP_BLKSIZE - 1 ) );
+	DBGC ( http, "HTTP %p downloading %zd bytes as %d segments of %zd "
+	       "bytes\n", http, total, count, segment_len );
+
+	/* Open additional connections */
+	for ( i = 0 ; i < ( count - 1 ) ; i++ ) {
+		segment = &http->segments[i];
+		segment->offset = ( ( i + 1 ) * segment_len );
+		segment->end = ( segment->offset + segment_len );
+		if ( segment->end > total )
+			segment->end = total;
+		if ( ( rc = xfer_open_uri ( &segment->control,
+					    http->uri ) ) != 0 ) {
+			DBGC ( http, "HTTP %p could not open segment: %s\n",
+			       http, strerror ( rc ) );
+			return rc;
+		}
+	}
+
+	/* Receive only the first segment via this connection */
+	http->remaining = segment_len;
+	http->flags |= HTTP_SEGMENTED;
+	process_add ( &http->segment_process );
+
+	return 0;
+}
+
 /**
  * Mark HTTP request as completed successfully
  *
  * @v http		HTTP request
  */
 static void http_done ( struct http_request *http ) {
+	struct http_partial *partial;
 
 	/* If we had a Content-Length, and the received content length
 	 * isn't correct, force an error
@@ -212,12 +864,40 @@ static void http_done ( struct http_request *http ) {
 	assert ( http->chunked == 0 );
 	assert ( http->chunk_remaining == 0 );
 
-	/* Close partial transfer interface */
-	intf_restart ( &http->partial, 0 );
+	/* Complete current partial transfer, if applicable */
+	if ( ( partial = http_rx_partial ( http ) ) != NULL ) {
+		http->partial_cons++;
+		intf_restart ( &partial->partial, 0 );
+	}
 
-	/* Close everything unless we are keeping the connection alive */
-	if ( ! ( http->flags & HTTP_KEEPALIVE ) )
+	/* Start receiving next pipelined response, if applicable */
+	if ( ( partial = http_rx_partial ( http ) ) != NULL )
+		http_rx_partial_start ( http, partial );
+
+	/* The first segment of a segmented download is only part of
+	 * the response; abandon the remainder of the response.
+	 */
+	if ( http->flags & HTTP_SEGMENTED ) {
+		http->rx_state = HTTP_RX_DEAD;
+		http->flags |= HTTP_FIRST_SEGMENT_DONE;
+		http_pipeline_detach ( http );
+		intf_restart ( &http->socket, 0 );
+		http_segment_check ( http );
+		return;
+	}
+
+	/* Close everything unless we are keeping the connection alive,
+	 * retaining the connection for reuse if possible.
+	 */
+	if ( ! ( http->flags & HTTP_KEEPALIVE ) ) {
+		if ( http->next ) {
+			http_pipeline_handoff ( http );
+		} else if ( ! ( http->flags & ( HTTP_SERVER_CLOSE |
+					       HTTP_NO_REUSE ) ) ) {
+			http_pool_put ( http );
+		}
 		http_close ( http, 0 );
+	}
 }
 
 /**
@@ -263,13 +943,19 @@ static int http_rx_response ( struct http_request *http, char *response ) {
 	if ( strncmp ( response, "HTTP/", 5 ) != 0 )
 		return -EINVAL_RESPONSE;
 
+	/* HTTP/1.0 servers close the connection by default */
+	if ( strncmp ( response, "HTTP/1.0", 8 ) == 0 )
+		http->flags |= HTTP_SERVER_CLOSE;
+
 	/* Locate and check response code */
 	spc = strchr ( response, ' ' );
 	if ( ! spc )
 		return -EINVAL_RESPONSE;
 	code = strtoul ( spc, NULL, 10 );
-	if ( ( rc = http_response_to_rc ( code ) ) != 0 )
+	if ( ( rc = http_response_to_rc ( code ) ) != 0 ) {
+		http_stats.errors++;
 		return rc;
+	}
 
 	/* Move to received headers */
 	http->rx_state = HTTP_RX_HEADER;
@@ -294,6 +980,7 @@ static int http_rx_location ( struct http_request *http, const char *value ) {
 		       http, strerror ( rc ) );
 		return rc;
 	}
+	http_stats.redirects++;
 
 	return 0;
 }
@@ -308,6 +995,7 @@ static int http_rx_location ( struct http_request *http, const char *value ) {
 static int http_rx_content_length ( struct http_request *http,
 				    const char *value ) {
 	struct block_device_capacity capacity;
+	struct http_partial *partial;
 	size_t content_len;
 	char *endp;
 
@@ -330,16 +1018,13 @@ static int http_rx_content_length ( struct http_request *http,
 	if ( ! ( http->flags & HTTP_HEAD_ONLY ) )
 		http->remaining = content_len;
 
-	/* Use seek() to notify recipient of filesize */
-	xfer_seek ( &http->xfer, http->remaining );
-	xfer_seek ( &http->xfer, 0 );
-
 	/* Report block device capacity if applicable */
-	if ( http->flags & HTTP_HEAD_ONLY ) {
+	if ( ( http->flags & HTTP_HEAD_ONLY ) &&
+	     ( ( partial = http_rx_partial ( http ) ) != NULL ) ) {
 		capacity.blocks = ( content_len / HTTP_BLKSIZE );
 		capacity.blksize = HTTP_BLKSIZE;
-		capacity.max_count = -1U;
-		block_capacity ( &http->partial, &capacity );
+		capacity.max_count = HTTP_MAX_COUNT;
+		block_capacity ( &partial->partial, &capacity );
 	}
 	return 0;
 }
@@ -362,6 +1047,76 @@ static int http_rx_transfer_encoding ( struct http_request *http,
 	return 0;
 }
 
+/**
+ * Handle HTTP Accept-Ranges header
+ *
+ * @v http		HTTP request
+ * @v value		HTTP header value
+ * @ret rc		Return status code
+ */
+static int http_rx_accept_ranges ( struct http_request *http,
+				   const char *value ) {
+
+	if ( strcasecmp ( value, "bytes" ) == 0 ) {
+		/* Mark server as accepting byte range requests */
+		http->flags |= HTTP_ACCEPT_RANGES;
+	}
+
+	return 0;
+}
+
+/**
+ * Handle HTTP Connection header
+ *
+ * @v http		HTTP request
+ * @v value		HTTP header value
+ * @ret rc		Return status code
+ */
+static int http_rx_connection ( struct http_request *http,
+				const char *value ) {
+
+	if ( strcasecmp ( value, "close" ) == 0 ) {
+		/* Mark connection as not reusable */
+		http->flags |= HTTP_SERVER_CLOSE;
+	} else if ( strcasecmp ( value, "keep-alive" ) == 0 ) {
+		/* Mark connection as reusable */
+		http->flags &= ~HTTP_SERVER_CLOSE;
+	}
+
+	return 0;
+}
+
+/**
+ * Handle HTTP Content-Encoding header
+ *
+ * @v http		HTTP request
+ * @v value		HTTP header value
+ * @ret rc		Return status code
+ */
+static int http_rx_content_encoding ( struct http_request *http,
+				      const char *value ) {
+	struct http_content_encoding *encoding;
+
+	/* Treat "x-gzip" as equivalent to "gzip" (RFC 2616 section 3.5) */
+	if ( ( tolower ( value[0] ) == 'x' ) && ( value[1] == '-' ) )
+		value += 2;
+
+	/* Identify content encoding */
+	if ( strcasecmp ( value, "identity" ) == 0 )
+		return 0;
+	for_each_table_entry ( encoding, HTTP_CONTENT_ENCODINGS ) {
+		if ( strcasecmp ( value, encoding->name ) == 0 ) {
+			http->encoding = encoding;
+			return 0;
+		}
+	}
+
+	/* Pass through unsupported encodings unmodified */
+	DBGC ( http, "HTTP %p unsupported Content-Encoding \"%s\"\n",
+	       http, value );
+	return 0;
+}
+
 /** An HTTP header handler */
 struct http_header_handler {
 	/** Name (e.g. "Content-Length") */
@@ -391,6 +1146,18 @@ static struct http_header_handler http_header_handlers[] = {
 		.header = "Transfer-Encoding",
 		.rx = http_rx_transfer_encoding,
 	},
+	{
+		.header = "Accept-Ranges",
+		.rx = http_rx_accept_ranges,
+	},
+	{
+		.header = "Connection",
+		.rx = http_rx_connection,
+	},
+	{
+		.header = "Content-Encoding",
+		.rx = http_rx_content_encoding,
+	},
 	{ NULL, NULL }
 };
 
@@ -413,6 +1180,24 @@ static int http_rx_header ( struct http_request *http, char *header ) {
 		if ( ( http->rx_state == HTTP_RX_HEADER ) &&
 		     ( ! ( http->flags & HTTP_HEAD_ONLY ) ) ) {
 			DBGC ( http, "HTTP %p start of data\n", http );
+			if ( http->encoding && ! http_rx_partial ( http ) ) {
+				/* Insert content decoder */
+				DBGC ( http, "HTTP %p decoding %s content\n",
+				       http, http->encoding->name );
+				rc = http->encoding->decode ( &http->xfer );
+				if ( rc != 0 )
+					return rc;
+			} else {
+				/* Use seek() to notify recipient of
+				 * filesize.  This is omitted for
+				 * encoded content, since the length
+				 * is that of the encoded data.
+				 */
+				xfer_seek ( &http->xfer, http->remaining );
+				xfer_seek ( &http->xfer, 0 );
+			}
+			if ( ( rc = http_segment_start ( http ) ) != 0 )
+				return rc;
 			http->rx_state = ( http->chunked ?
 					   HTTP_RX_CHUNK_LEN : HTTP_RX_DATA );
 			return 0;
@@ -516,13 +1301,18 @@ static struct http_line_handler http_line_handlers[] = {
  */
 static int http_socket_deliver ( struct http_request *http,
 				 struct io_buffer *iobuf,
-				 struct xfer_metadata *meta __unused ) {
+				 struct xfer_metadata *meta ) {
+	struct xfer_metadata data_meta;
+	struct http_request *next;
 	struct http_line_handler *lh;
 	char *line;
 	size_t data_len;
 	ssize_t line_len;
 	int rc = 0;
 
+	/* Any received data proves that the connection is still alive */
+	http->flags &= ~HTTP_REUSED;
+
 	while ( iobuf && iob_len ( iobuf ) ) {
 
 		switch ( http->rx_state ) {
@@ -548,6 +1338,14 @@ static int http_socket_deliver ( struct http_request *http,
 			     ( http->remaining < data_len ) ) {
 				data_len = http->remaining;
 			}
+			memset ( &data_meta, 0, sizeof ( data_meta ) );
+			if ( http->flags & HTTP_SEGMENTED ) {
+				/* Other segments are delivered out of
+				 * order, so use absolute offsets.
+				 */
+				data_meta.flags = XFER_FL_ABS_OFFSET;
+				data_meta.offset = http->rx_len;
+			}
 			if ( http->rx_buffer != UNULL ) {
 				/* Copy to partial transfer buffer */
 				copy_to_user ( http->rx_buffer, http->rx_len,
@@ -555,15 +1353,18 @@ static int http_socket_deliver ( struct http_request *http,
 				iob_pull ( iobuf, data_len );
 			} else if ( data_len < iob_len ( iobuf ) ) {
 				/* Deliver partial buffer as raw data */
-				rc = xfer_deliver_raw ( &http->xfer,
-							iobuf->data, data_len );
+				rc = xfer_deliver_raw_meta ( &http->xfer,
+							     iobuf->data,
+							     data_len,
+							     &data_meta );
 				iob_pull ( iobuf, data_len );
 				if ( rc != 0 )
 					goto done;
 			} else {
 				/* Deliver whole I/O buffer */
-				if ( ( rc = xfer_deliver_iob ( &http->xfer,
-						 iob_disown ( iobuf ) ) ) != 0 )
+				if ( ( rc = xfer_deliver ( &http->xfer,
+						iob_disown ( iobuf ),
+						&data_meta ) ) != 0 )
 					goto done;
 			}
 			http->rx_len += data_len;
@@ -584,11 +1385,15 @@ static int http_socket_deliver ( struct http_request *http,
 		case HTTP_RX_HEADER:
 		case HTTP_RX_CHUNK_LEN:
 		case HTTP_RX_TRAILER:
-			/* In the other phases, buffer and process a
-			 * line at a time
+			/* In the other phases, process a line at a
+			 * time.  Lines lying entirely within this I/O
+			 * buffer are processed in place; only lines
+			 * split across I/O buffers need to be copied.
 			 */
-			line_len = line_buffer ( &http->linebuf, iobuf->data,
-						 iob_len ( iobuf ) );
+			line_len = line_buffer_inplace ( &http->linebuf,
+							 iobuf->data,
+							 iob_len ( iobuf ),
+							 &line );
 			if ( line_len < 0 ) {
 				rc = line_len;
 				DBGC ( http, "HTTP %p could not buffer line: "
@@ -596,7 +1401,6 @@ static int http_socket_deliver ( struct http_request *http,
 				goto done;
 			}
 			iob_pull ( iobuf, line_len );
-			line = buffered_line ( &http->linebuf );
 			if ( line ) {
 				lh = &http_line_handlers[http->rx_state];
 				if ( ( rc = lh->rx ( http, line ) ) != 0 )
@@ -612,6 +1416,19 @@ static int http_socket_deliver ( struct http_request *http,
  done:
 	if ( rc )
 		http_close ( http, rc );
+
+	/* Pass any remaining data to the request which has taken over
+	 * the connection, if applicable.
+	 */
+	if ( ( next = http->handoff ) != NULL ) {
+		http->handoff = NULL;
+		if ( iobuf && iob_len ( iobuf ) ) {
+			rc = http_socket_deliver ( next, iob_disown ( iobuf ),
+						   meta );
+		}
+		ref_put ( &next->refcnt );
+	}
+
 	free_iob ( iobuf );
 	return rc;
 }
@@ -622,20 +1439,52 @@ static int http_socket_deliver ( struct http_request *http,
  * @v http		HTTP request
  * @ret len		Length of window
  */
-static size_t http_socket_window ( struct http_request *http __unused ) {
+static size_t http_socket_window ( struct http_request *http ) {
 
-	/* Window is always open.  This is to prevent TCP from
-	 * stalling if our parent window is not currently open.
+	/* While streaming a plain (non-segmented, non-pipelined)
+	 * response body to our parent, pass through our parent's
+	 * window so that a slow consumer is able to limit the TCP
+	 * receive window.
+	 */
+	if ( ( http->rx_state == HTTP_RX_DATA ) &&
+	     ( http->rx_buffer == UNULL ) && ( ! http->next ) &&
+	     ( ! ( http->flags & HTTP_SEGMENTED ) ) ) {
+		return xfer_window ( &http->xfer );
+	}
+
+	/* Otherwise, window is always open.  This is to prevent TCP
+	 * from stalling if our parent window is not currently open.
 	 */
 	return ( ~( ( size_t ) 0 ) );
 }
 
 /**
- * HTTP process
+ * Calculate length of list of acceptable content encodings
+ *
+ * @ret len		Length of list (excluding NUL)
+ */
+static size_t http_encodings_len ( void ) {
+	struct http_content_encoding *encoding;
+	size_t len = 0;
+
+	for_each_table_entry ( encoding, HTTP_CONTENT_ENCODINGS ) {
+		len += ( strlen ( encoding->name ) +
+			 ( len ? 2 /* ", " */ : 0 ) );
+	}
+	return len;
+}
+
+/**
+ * Transmit HTTP request
  *
  * @v http		HTTP request
+ * @v socket		Transport layer interface
+ * @v partial		Partial transfer, or NULL
+ * @ret rc		Return status code
  */
-static void http_step ( struct http_request *http ) {
+static int http_tx_request ( struct http_request *http,
+			     struct interface *socket,
+			     struct http_partial *partial ) {
 	const char *host = http->uri->host;
 	const char *user = http->uri->user;
 	const char *password =
@@ -645,29 +1494,25 @@ static void http_step ( struct http_request *http ) {
 	size_t user_pw_base64_len = base64_encoded_len ( user_pw_len );
 	int request_len = unparse_uri ( NULL, 0, http->uri,
 					URI_PATH_BIT | URI_QUERY_BIT );
+	struct http_content_encoding *encoding;
+	size_t encodings_len = http_encodings_len();
 	struct {
 		uint8_t user_pw[ user_pw_len + 1 /* NUL */ ];
 		char user_pw_base64[ user_pw_base64_len + 1 /* NUL */ ];
 		char request[ request_len + 1 /* NUL */ ];
 		char range[48]; /* Enough for two 64-bit integers in decimal */
+		char encodings[ encodings_len + 1 /* NUL */ ];
 	} *dynamic;
-	int partial;
+	size_t encodings_used = 0;
+	int head_only;
+	int range;
+	int accept;
 	int rc;
 
-	/* Do nothing if we have already transmitted the request */
-	if ( ! ( http->flags & HTTP_TX_PENDING ) )
-		return;
-
-	/* Do nothing until socket is ready */
-	if ( ! xfer_window ( &http->socket ) )
-		return;
-
 	/* Allocate dynamic storage */
 	dynamic = malloc ( sizeof ( *dynamic ) );
-	if ( ! dynamic ) {
-		rc = -ENOMEM;
-		goto err_alloc;
-	}
+	if ( ! dynamic )
+		return -ENOMEM;
 
 	/* Construct path?query request */
 	unparse_uri ( dynamic->request, sizeof ( dynamic->request ), http->uri,
@@ -685,41 +1530,56 @@ static void http_step ( struct http_request *http ) {
 				dynamic->user_pw_base64 );
 	}
 
-	/* Force a HEAD request if we have nowhere to send any received data */
-	if ( ( xfer_window ( &http->xfer ) == 0 ) &&
-	     ( http->rx_buffer == UNULL ) ) {
-		http->flags |= ( HTTP_HEAD_ONLY | HTTP_KEEPALIVE );
-	}
-
 	/* Determine type of request */
-	partial = ( http->partial_len != 0 );
-	snprintf ( dynamic->range, sizeof ( dynamic->range ),
-		   "%zd-%zd", http->partial_start,
-		   ( http->partial_start + http->partial_len - 1 ) );
+	if ( partial ) {
+		head_only = ( partial->len == 0 );
+		range = ( partial->len != 0 );
+		snprintf ( dynamic->range, sizeof ( dynamic->range ),
+			   "%zd-%zd", partial->start,
+			   ( partial->start + partial->len - 1 ) );
+	} else {
+		head_only = ( http->flags & HTTP_HEAD_ONLY );
+		range = 0;
+	}
 
-	/* Mark request as transmitted */
-	http->flags &= ~HTTP_TX_PENDING;
+	/* Construct list of acceptable content encodings.  Encoded
+	 * content cannot be used for partial transfers, since byte
+	 * ranges would then refer to the encoded data.
+	 */
+	dynamic->encodings[0] = '\0';
+	for_each_table_entry ( encoding, HTTP_CONTENT_ENCODINGS ) {
+		encodings_used += snprintf ( ( dynamic->encodings +
+					       encodings_used ),
+					     ( sizeof ( dynamic->encodings ) -
+					       encodings_used ), "%s%s",
+					     ( encodings_used ? ", " : "" ),
+					     encoding->name );
+	}
+	accept = ( encodings_used && ( ! partial ) && ( ! head_only ) );
 
 	/* Send GET request */
-	if ( ( rc = xfer_printf ( &http->socket,
+	if ( ( rc = xfer_printf ( socket,
 				  "%s %s%s HTTP/1.1\r\n"
 				  "User-Agent: iPXE/" VERSION "\r\n"
 				  "Host: %s%s%s\r\n"
-				  "%s%s%s%s%s%s%s"
+				  "%s%s%s%s%s%s%s%s%s%s"
 				  "\r\n",
-				  ( ( http->flags & HTTP_HEAD_ONLY ) ?
-				    "HEAD" : "GET" ),
+				  ( head_only ? "HEAD" : "GET" ),
 				  ( http->uri->path ? "" : "/" ),
 				  dynamic->request, host,
 				  ( http->uri->port ?
 				    ":" : "" ),
 				  ( http->uri->port ?
 				    http->uri->port : "" ),
-				  ( ( http->flags & HTTP_KEEPALIVE ) ?
+				  ( ( HTTP_POOL ||
+				      ( http->flags & HTTP_KEEPALIVE ) ) ?
 				    "Connection: Keep-Alive\r\n" : "" ),
-				  ( partial ? "Range: bytes=" : "" ),
-				  ( partial ? dynamic->range : "" ),
-				  ( partial ? "\r\n" : "" ),
+				  ( range ? "Range: bytes=" : "" ),
+				  ( range ? dynamic->range : "" ),
+				  ( range ? "\r\n" : "" ),
+				  ( accept ? "Accept-Encoding: " : "" ),
+				  ( accept ? dynamic->encodings : "" ),
+				  ( accept ? "\r\n" : "" ),
 				  ( user ?
 				    "Authorization: Basic " : "" ),
 				  ( user ? dynamic->user_pw_base64 : "" ),
@@ -729,9 +1589,69 @@ static void http_step ( struct http_request *http ) {
 
  err_xfer:
 	free ( dynamic );
- err_alloc:
-	if ( rc != 0 )
-		http_close ( http, rc );
+	return rc;
+}
+
+/**
+ * HTTP process
+ *
+ * @v http		HTTP request
+ */
+static void http_step ( struct http_request *http ) {
+	struct http_partial *partial;
+	struct http_request *next;
+	int rc;
+
+	/* Transmit requests until none remain or socket is not ready */
+	while ( ( http->flags & HTTP_TX_PENDING ) &&
+		xfer_window ( &http->socket ) ) {
+
+		/* Identify next request */
+		if ( http->partial_tx != http->partial_prod ) {
+			partial = &http->partials[ http->partial_tx++ %
+						   HTTP_MAX_PARTIALS ];
+		} else {
+			partial = NULL;
+			/* Force a HEAD request if we have nowhere to
+			 * send any received data.
+			 */
+			if ( ( xfer_window ( &http->xfer ) == 0 ) &&
+			     ( http->rx_buffer == UNULL ) ) {
+				http->flags |= ( HTTP_HEAD_ONLY |
+						 HTTP_KEEPALIVE );
+				http_pipeline_detach ( http );
+			}
+		}
+
+		/* Mark request as transmitted, if no more are pending */
+		if ( http->partial_tx == http->partial_prod )
+			http->flags &= ~HTTP_TX_PENDING;
+
+		/* Send request */
+		if ( ( rc = http_tx_request ( http, &http->socket,
+					      partial ) ) != 0 ) {
+			http_close ( http, rc );
+			return;
+		}
+	}
+
+	/* Transmit pipelined requests, in order, once our own
+	 * requests have been transmitted.
+	 */
+	if ( http->flags & HTTP_TX_PENDING )
+		return;
+	for ( next = http->next ; next ; next = next->next ) {
+		if ( ! ( next->flags & HTTP_TX_PENDING ) )
+			continue;
+		if ( ! xfer_window ( &http->socket ) )
+			break;
+		next->flags &= ~HTTP_TX_PENDING;
+		if ( ( rc = http_tx_request ( next, &http->socket,
+					      NULL ) ) != 0 ) {
+			http_close ( http, rc );
+			return;
+		}
+	}
 }
 
 /**
@@ -741,9 +1661,16 @@ static void http_step ( struct http_request *http ) {
  * @ret len		Length of window
  */
 static size_t http_xfer_window ( struct http_request *http ) {
+	unsigned int outstanding =
+		( http->partial_prod - http->partial_cons );
 
-	/* New block commands may be issued only when we are idle */
-	return ( ( http->rx_state == HTTP_RX_IDLE ) ? 1 : 0 );
+	/* New block commands may be issued only when we are idle, or
+	 * when we are already pipelining partial transfers.
+	 */
+	if ( ( http->rx_state != HTTP_RX_IDLE ) &&
+	     ( ( http->rx_state == HTTP_RX_DEAD ) || ( ! outstanding ) ) )
+		return 0;
+	return ( HTTP_MAX_PARTIALS - outstanding );
 }
 
 /**
@@ -757,28 +1684,30 @@ static size_t http_xfer_window ( struct http_request *http ) {
  * @ret rc		Return status code
  */
 static int http_partial_read ( struct http_request *http,
-			       struct interface *partial,
+			       struct interface *intf,
 			       size_t offset, userptr_t buffer, size_t len ) {
+	struct http_partial *partial;
 
 	/* Sanity check */
 	if ( http_xfer_window ( http ) == 0 )
 		return -EBUSY;
 
 	/* Initialise partial transfer parameters */
-	http->rx_buffer = buffer;
-	http->partial_start = offset;
-	http->partial_len = len;
-	http->remaining = len;
+	partial = &http->partials[ http->partial_prod++ % HTTP_MAX_PARTIALS ];
+	partial->start = offset;
+	partial->len = len;
+	partial->buffer = buffer;
+
+	/* Start receiving response, if not already pipelining */
+	if ( http->rx_state == HTTP_RX_IDLE )
+		http_rx_partial_start ( http, partial );
 
 	/* Schedule request */
-	http->rx_state = HTTP_RX_RESPONSE;
-	http->flags = ( HTTP_TX_PENDING | HTTP_KEEPALIVE );
-	if ( ! len )
-		http->flags |= HTTP_HEAD_ONLY;
+	http->flags |= ( HTTP_TX_PENDING | HTTP_KEEPALIVE );
 	process_add ( &http->process );
 
 	/* Attach to parent interface and return */
-	intf_plug_plug ( &http->partial, partial );
+	intf_plug_plug ( &partial->partial, intf );
 
 	return 0;
 }
@@ -797,10 +1726,16 @@ static int http_partial_read ( struct http_request *http,
 static int http_block_read ( struct http_request *http,
 			     struct interface *block,
 			     uint64_t lba, unsigned int count,
-			     userptr_t buffer, size_t len __unused ) {
+			     userptr_t buffer, size_t len ) {
+
+	/* The data buffer may be shorter than the requested number
+	 * of blocks, to allow for reading a trailing partial block.
+	 */
+	if ( len > ( count * HTTP_BLKSIZE ) )
+		len = ( count * HTTP_BLKSIZE );
 
 	return http_partial_read ( http, block, ( lba * HTTP_BLKSIZE ),
-				   buffer, ( count * HTTP_BLKSIZE ) );
+				   buffer, len );
 }
 
 /**
@@ -835,12 +1770,38 @@ static int http_acpi_describe ( struct http_request *http,
 	return 0;
 }
 
+/**
+ * Close HTTP socket
+ *
+ * @v http		HTTP request
+ * @v rc		Reason for close
+ */
+static void http_socket_close ( struct http_request *http, int rc ) {
+
+	/* A reused connection may have been closed by the server
+	 * before our request arrived.  Retry using a new connection.
+	 */
+	if ( http->flags & HTTP_REUSED ) {
+		DBGC ( http, "HTTP %p reused connection closed (%s); "
+		       "reconnecting\n", http, strerror ( rc ) );
+		http->flags &= ~HTTP_REUSED;
+		intf_restart ( &http->socket, rc );
+		http->partial_tx = http->partial_cons;
+		http->flags |= HTTP_TX_PENDING;
+		http_pipeline_reset ( http );
+		if ( ( rc = http_socket_open ( http ) ) == 0 )
+			return;
+	}
+
+	http_close ( http, rc );
+}
+
 /** HTTP socket interface operations */
 static struct interface_operation http_socket_operations[] = {
 	INTF_OP ( xfer_window, struct http_request *, http_socket_window ),
 	INTF_OP ( xfer_deliver, struct http_request *, http_socket_deliver ),
 	INTF_OP ( xfer_window_changed, struct http_request *, http_step ),
-	INTF_OP ( intf_close, struct http_request *, http_close ),
+	INTF_OP ( intf_close, struct http_request *, http_socket_close ),
 };
 
 /** HTTP socket interface descriptor */
@@ -848,14 +1809,195 @@ static struct interface_descriptor http_socket_desc =
 	INTF_DESC_PASSTHRU ( struct http_request, socket,
 			     http_socket_operations, xfer );
 
+/**
+ * Close HTTP partial transfer
+ *
+ * @v partial		Partial transfer
+ * @v rc		Reason for close
+ *
+ * Responses to pipelined requests cannot be individually abandoned,
+ * so closing any partial transfer will close the whole connection.
+ */
+static void http_partial_close ( struct http_partial *partial, int rc ) {
+	http_close ( partial->http, rc );
+}
+
 /** HTTP partial transfer interface operations */
 static struct interface_operation http_partial_operations[] = {
-	INTF_OP ( intf_close, struct http_request *, http_close ),
+	INTF_OP ( intf_close, struct http_partial *, http_partial_close ),
 };
 
 /** HTTP partial transfer interface descriptor */
 static struct interface_descriptor http_partial_desc =
-	INTF_DESC ( struct http_request, partial, http_partial_operations );
+	INTF_DESC ( struct http_partial, partial, http_partial_operations );
+
+/**
+ * Issue range requests for download segments
+ *
+ * @v http		HTTP request
+ */
+static void http_segment_step ( struct http_request *http ) {
+	struct http_segment *segment;
+	unsigned int waiting = 0;
+	userptr_t buffer;
+	size_t len;
+	int rc;
+
+	for_each_http_segment ( segment, http ) {
+
+		/* Skip segments that are busy or complete */
+		if ( segment->len || ( segment->offset >= segment->end ) )
+			continue;
+
+		/* Wait until connection is ready */
+		if ( ! xfer_window ( &segment->control ) ) {
+			waiting++;
+			continue;
+		}
+
+		/* Calculate length of range request */
+		len = ( segment->end - segment->offset );
+		if ( len > HTTP_SEGMENT_CHUNK_LEN )
+			len = HTTP_SEGMENT_CHUNK_LEN;
+		segment->len = len;
+
+		/* Place data directly into the recipient's buffer if
+		 * possible, otherwise allocate a data buffer.
+		 */
+		buffer = xfer_buffer ( &http->xfer, segment->offset, len );
+		if ( ! buffer ) {
+			segment->iobuf = alloc_iob ( len );
+			if ( ! segment->iobuf ) {
+				rc = -ENOMEM;
+				goto err;
+			}
+			buffer = virt_to_user ( iob_put ( segment->iobuf,
+							  len ) );
+		}
+
+		/* Issue range request */
+		if ( ( rc = block_read ( &segment->control, &segment->data,
+					 ( segment->offset / HTTP_BLKSIZE ),
+					 ( ( len + HTTP_BLKSIZE - 1 ) /
+					   HTTP_BLKSIZE ),
+					 buffer, len ) ) != 0 ) {
+			DBGC ( http, "HTTP %p could not request segment: "
+			       "%s\n", http, strerror ( rc ) );
+			goto err;
+		}
+	}
+
+	/* Stop process unless some segments are still waiting */
+	if ( ! waiting )
+		process_del ( &http->segment_process );
+	return;
+
+ err:
+	http_close ( http, rc );
+}
+
+/**
+ * Handle completed range request for download segment
+ *
+ * @v segment		Download segment
+ * @v rc		Reason for close
+ */
+static void http_segment_data_close ( struct http_segment *segment, int rc ) {
+	struct http_request *http = segment->http;
+	struct xfer_metadata meta;
+	size_t len;
+
+	/* Close data interface */
+	intf_restart ( &segment->data, rc );
+
+	/* Abort download on error */
+	if ( rc != 0 )
+		goto err;
+
+	/* Deliver data, or report data placed directly */
+	len = segment->len;
+	segment->len = 0;
+	if ( segment->iobuf ) {
+		memset ( &meta, 0, sizeof ( meta ) );
+		meta.flags = XFER_FL_ABS_OFFSET;
+		meta.offset = segment->offset;
+		rc = xfer_deliver ( &http->xfer, iob_disown ( segment->iobuf ),
+				    &meta );
+	} else {
+		rc = xfer_placed ( &http->xfer, segment->offset, len );
+	}
+	segment->offset += len;
+	if ( rc != 0 )
+		goto err;
+
+	/* Issue next request, or finish download */
+	process_add ( &http->segment_process );
+	http_segment_check ( http );
+	return;
+
+ err:
+	http_close ( http, rc );
+}
+
+/**
+ * Check download segment control flow control window
+ *
+ * @v segment		Download segment
+ * @ret len		Length of window
+ */
+static size_t http_segment_window ( struct http_segment *segment __unused ) {
+
+	/* We are never ready to receive stream data via this
+	 * interface.  This causes the additional connection to wait
+	 * for range requests.
+	 */
+	return 0;
+}
+
+/**
+ * Handle download segment connection closing
+ *
+ * @v segment		Download segment
+ * @v rc		Reason for close
+ */
+static void http_segment_close ( struct http_segment *segment, int rc ) {
+	struct http_request *http = segment->http;
+
+	/* Close control interface */
+	intf_restart ( &segment->control, rc );
+
+	/* Abort download if segment is incomplete */
+	if ( segment->len || ( segment->offset < segment->end ) ) {
+		DBGC ( http, "HTTP %p segment connection closed: %s\n",
+		       http, strerror ( rc ) );
+		http_close ( http, ( rc ? rc : -ECONNRESET ) );
+	}
+}
+
+/** HTTP download segment control interface operations */
+static struct interface_operation http_segment_control_operations[] = {
+	INTF_OP ( xfer_window, struct http_segment *, http_segment_window ),
+	INTF_OP ( intf_close, struct http_segment *, http_segment_close ),
+};
+
+/** HTTP download segment control interface descriptor */
+static struct interface_descriptor http_segment_control_desc =
+	INTF_DESC ( struct http_segment, control,
+		    http_segment_control_operations );
+
+/** HTTP download segment data interface operations */
+static struct interface_operation http_segment_data_operations[] = {
+	INTF_OP ( intf_close, struct http_segment *,
+		  http_segment_data_close ),
+};
+
+/** HTTP download segment data interface descriptor */
+static struct interface_descriptor http_segment_data_desc =
+	INTF_DESC ( struct http_segment, data, http_segment_data_operations );
+
+/** HTTP download segment process descriptor */
+static struct process_descriptor http_segment_process_desc =
+	PROC_DESC ( struct http_request, segment_process, http_segment_step );
 
 /** HTTP data transfer interface operations */
 static struct interface_operation http_xfer_operations[] = {
@@ -889,10 +2031,14 @@ int http_open_filter ( struct interface *xfer, struct uri *uri,
 		       unsigned int default_port,
 		       int ( * filter ) ( struct interface *xfer,
 					  const char *name,
+					  unsigned int port,
 					  struct interface **next ) ) {
+	struct interface parent = INTF_INIT ( null_intf_desc );
 	struct http_request *http;
-	struct sockaddr_tcpip server;
-	struct interface *socket;
+	struct http_partial *partial;
+	struct http_segment *segment;
+	size_t window;
+	unsigned int i;
 	int rc;
 
 	/* Sanity checks */
@@ -904,25 +2050,45 @@ int http_open_filter ( struct interface *xfer, struct uri *uri,
 	if ( ! http )
 		return -ENOMEM;
 	ref_init ( &http->refcnt, http_free );
+	INIT_LIST_HEAD ( &http->list );
 	intf_init ( &http->xfer, &http_xfer_desc, &http->refcnt );
-	intf_init ( &http->partial, &http_partial_desc, &http->refcnt );
+	for ( i = 0 ; i < HTTP_MAX_PARTIALS ; i++ ) {
+		partial = &http->partials[i];
+		partial->http = http;
+		intf_init ( &partial->partial, &http_partial_desc,
+			    &http->refcnt );
+	}
+	for_each_http_segment ( segment, http ) {
+		segment->http = http;
+		intf_init ( &segment->control, &http_segment_control_desc,
+			    &http->refcnt );
+		intf_init ( &segment->data, &http_segment_data_desc,
+			    &http->refcnt );
+	}
+	process_init_stopped ( &http->segment_process,
+			       &http_segment_process_desc, &http->refcnt );
 	http->uri = uri_get ( uri );
+	http->port = uri_port ( http->uri, default_port );
+	http->filter = filter;
 	intf_init ( &http->socket, &http_socket_desc, &http->refcnt );
 	process_init ( &http->process, &http_process_desc, &http->refcnt );
 	http->flags = HTTP_TX_PENDING;
 
-	/* Open socket */
-	memset ( &server, 0, sizeof ( server ) );
-	server.st_port = htons ( uri_port ( http->uri, default_port ) );
-	socket = &http->socket;
-	if ( filter ) {
-		if ( ( rc = filter ( socket, uri->host, &socket ) ) != 0 )
+	/* Queue behind an existing request to the same server if
+	 * possible, otherwise open socket.  Requests with nowhere to
+	 * send any received data (i.e. block devices and additional
+	 * download segments) are never queued.  We are not yet
+	 * attached to the parent interface, so its window must be
+	 * checked via a temporary interface.
+	 */
+	intf_plug ( &parent, xfer );
+	window = xfer_window ( &parent );
+	intf_unplug ( &parent );
+	if ( ! ( window && http_pipeline ( http ) ) ) {
+		if ( ( rc = http_socket_open ( http ) ) != 0 )
 			goto err;
 	}
-	if ( ( rc = xfer_open_named_socket ( socket, SOCK_STREAM,
-					     ( struct sockaddr * ) &server,
-					     uri->host, NULL ) ) != 0 )
-		goto err;
+	list_add_tail ( &http->list, &http_requests );
 
 	/* Attach to parent interface, mortalise self, and return */
 	intf_plug_plug ( &http->xfer, xfer );
@@ -0,0 +1,232 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/**
+ * @file
+ *
+ * HTTP gzip and deflate content encodings
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <ipxe/refcnt.h>
+#include <ipxe/iobuf.h>
+#include <ipxe/xfer.h>
+#include <ipxe/deflate.h>
+#include <ipxe/http.h>
+
+/** Length of each decompressed data buffer */
+#define HTTP_DECODE_BLKSIZE 8192
+
+/* Disambiguate the various error causes */
+#define EPIPE_TRUNCATED __einfo_error ( EINFO_EPIPE_TRUNCATED )
+#define EINFO_EPIPE_TRUNCATED \
+	__einfo_uniqify ( EINFO_EPIPE, 0x01, "Compressed data truncated" )
+
+/** An HTTP content decoder */
+struct http_decoder {
+	/** Reference count */
+	struct refcnt refcnt;
+	/** Decompressed data transfer interface */
+	struct interface xfer;
+	/** Compressed data transfer interface */
+	struct interface raw;
+	/** Decompressor */
+	struct deflate deflate;
+};
+
+/**
+ * Close HTTP content decoder
+ *
+ * @v decoder		HTTP content decoder
+ * @v rc		Reason for close
+ */
+static void http_decoder_close ( struct http_decoder *decoder, int rc ) {
+
+	/* Treat premature end of compressed data as an error */
+	if ( ( rc == 0 ) && ! deflate_finished ( &decoder->deflate ) ) {
+		DBGC ( decoder, "HTTPDEC %p truncated compressed data\n",
+		       decoder );
+		rc = -EPIPE_TRUNCATED;
+	}
+
+	/* Shut down interfaces */
+	intf_shutdown ( &decoder->raw, rc );
+	intf_shutdown ( &decoder->xfer, rc );
+}
+
+/**
+ * Receive compressed data
+ *
+ * @v decoder		HTTP content decoder
+ * @v iobuf		I/O buffer
+ * @v meta		Data transfer metadata
+ * @ret rc		Return status code
+ */
+static int http_decoder_deliver ( struct http_decoder *decoder,
+				  struct io_buffer *iobuf,
+				  struct xfer_metadata *meta __unused ) {
+	struct deflate_chunk in;
+	struct deflate_chunk out;
+	struct io_buffer *decoded;
+	int rc;
+
+	/* Decompress data, one output buffer at a time.  Any data
+	 * following the end of the compressed stream is ignored, as
+	 * are any zero-length deliveries (e.g. seek hints, which
+	 * would refer to offsets within the compressed data).
+	 */
+	deflate_chunk_init ( &in, iobuf->data, 0, iob_len ( iobuf ) );
+	while ( in.len && ! deflate_finished ( &decoder->deflate ) ) {
+
+		/* Allocate output buffer */
+		decoded = xfer_alloc_iob ( &decoder->xfer,
+					   HTTP_DECODE_BLKSIZE );
+		if ( ! decoded ) {
+			rc = -ENOMEM;
+			goto err;
+		}
+
+		/* Decompress as much as will fit */
+		deflate_chunk_init ( &out, iob_put ( decoded,
+						     HTTP_DECODE_BLKSIZE ),
+				     0, HTTP_DECODE_BLKSIZE );
+		if ( ( rc = deflate_inflate ( &decoder->deflate, &in,
+					      &out ) ) != 0 ) {
+			DBGC ( decoder, "HTTPDEC %p could not decompress: "
+			       "%s\n", decoder, strerror ( rc ) );
+			free_iob ( decoded );
+			goto err;
+		}
+		iob_unput ( decoded, ( out.len - out.offset ) );
+
+		/* Pass decompressed data to recipient */
+		if ( out.offset ) {
+			if ( ( rc = xfer_deliver_iob ( &decoder->xfer,
+						       decoded ) ) != 0 )
+				goto err;
+		} else {
+			free_iob ( decoded );
+		}
+
+		/* A partially filled output buffer indicates that all
+		 * input (including any bits held within the
+		 * decompressor) has been consumed.
+		 */
+		if ( out.offset < out.len )
+			break;
+	}
+
+	free_iob ( iobuf );
+	return 0;
+
+ err:
+	free_iob ( iobuf );
+	http_decoder_close ( decoder, rc );
+	return rc;
+}
+
+/** HTTP content decoder compressed data interface operations */
+static struct interface_operation http_decoder_raw_op[] = {
+	INTF_OP ( xfer_deliver, struct http_decoder *, http_decoder_deliver ),
+	INTF_OP ( intf_close, struct http_decoder *, http_decoder_close ),
+};
+
+/** HTTP content decoder compressed data interface descriptor */
+static struct interface_descriptor http_decoder_raw_desc =
+	INTF_DESC_PASSTHRU ( struct http_decoder, raw, http_decoder_raw_op,
+			     xfer );
+
+/** HTTP content decoder decompressed data interface operations */
+static struct interface_operation http_decoder_xfer_op[] = {
+	INTF_OP ( intf_close, struct http_decoder *, http_decoder_close ),
+};
+
+/** HTTP content decoder decompressed data interface descriptor */
+static struct interface_descriptor http_decoder_xfer_desc =
+	INTF_DESC_PASSTHRU ( struct http_decoder, xfer, http_decoder_xfer_op,
+			     raw );
+
+/**
+ * Insert HTTP content decoder
+ *
+ * @v xfer		Data transfer interface
+ * @v format		Compression format
+ * @ret rc		Return status code
+ */
+static int http_decoder_insert ( struct interface *xfer,
+				 enum deflate_format format ) {
+	struct http_decoder *decoder;
+
+	/* Allocate and initialise structure */
+	decoder = malloc ( sizeof ( *decoder ) );
+	if ( ! decoder )
+		return -ENOMEM;
+	ref_init ( &decoder->refcnt, NULL );
+	intf_init ( &decoder->xfer, &http_decoder_xfer_desc,
+		    &decoder->refcnt );
+	intf_init ( &decoder->raw, &http_decoder_raw_desc, &decoder->refcnt );
+	deflate_init ( &decoder->deflate, format );
+
+	/* Insert between data transfer interface and its destination,
+	 * and mortalise self.
+	 */
+	intf_plug_plug ( &decoder->xfer, xfer->dest );
+	intf_plug_plug ( &decoder->raw, xfer );
+	ref_put ( &decoder->refcnt );
+
+	DBGC ( decoder, "HTTPDEC %p decoding for %p\n", decoder, xfer );
+	return 0;
+}
+
+/**
+ * Start decoding gzip content
+ *
+ * @v xfer		Data transfer interface
+ * @ret rc		Return status code
+ */
+static int http_gzip_decode ( struct interface *xfer ) {
+	return http_decoder_insert ( xfer, DEFLATE_GZIP );
+}
+
+/**
+ * Start decoding deflate content
+ *
+ * @v xfer		Data transfer interface
+ * @ret rc		Return status code
+ */
+static int http_deflate_decode ( struct interface *xfer ) {
+	return http_decoder_insert ( xfer, DEFLATE_ZLIB );
+}
+
+/** gzip content encoding */
+struct http_content_encoding http_gzip_encoding __http_content_encoding = {
+	.name = "gzip",
+	.decode = http_gzip_decode,
+};
+
+/** deflate content encoding */
+struct http_content_encoding http_deflate_encoding __http_content_encoding = {
+	.name = "deflate",
+	.decode = http_deflate_decode,
+};
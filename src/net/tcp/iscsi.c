@@ -39,6 +39,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/features.h>
 #include <ipxe/base16.h>
 #include <ipxe/base64.h>
+#include <ipxe/crc32c.h>
 #include <ipxe/ibft.h>
 #include <ipxe/iscsi.h>
 
@@ -87,6 +88,14 @@ FEATURE ( FEATURE_PROTOCOL, "iSCSI", DHCP_EB_FEATURE_ISCSI, 1 );
 	__einfo_error ( EINFO_EIO_TARGET_NO_RESOURCES )
 #define EINFO_EIO_TARGET_NO_RESOURCES \
 	__einfo_uniqify ( EINFO_EIO, 0x02, "Target out of resources" )
+#define EIO_HEADER_DIGEST \
+	__einfo_error ( EINFO_EIO_HEADER_DIGEST )
+#define EINFO_EIO_HEADER_DIGEST \
+	__einfo_uniqify ( EINFO_EIO, 0x03, "Header digest mismatch" )
+#define EIO_DATA_DIGEST \
+	__einfo_error ( EINFO_EIO_DATA_DIGEST )
+#define EINFO_EIO_DATA_DIGEST \
+	__einfo_uniqify ( EINFO_EIO, 0x04, "Data digest mismatch" )
 #define ENOTSUP_INITIATOR_STATUS \
 	__einfo_error ( EINFO_ENOTSUP_INITIATOR_STATUS )
 #define EINFO_ENOTSUP_INITIATOR_STATUS \
@@ -139,11 +148,15 @@ FEATURE ( FEATURE_PROTOCOL, "iSCSI", DHCP_EB_FEATURE_ISCSI, 1 );
 	__einfo_error ( EINFO_EPROTO_VALUE_REJECTED )
 #define EINFO_EPROTO_VALUE_REJECTED					\
 	__einfo_uniqify ( EINFO_EPROTO, 0x06, "Parameter rejected" )
-
-static void iscsi_start_tx ( struct iscsi_session *iscsi );
+#define EPROTO_UNKNOWN_TASK \
+	__einfo_error ( EINFO_EPROTO_UNKNOWN_TASK )
+#define EINFO_EPROTO_UNKNOWN_TASK \
+	__einfo_uniqify ( EINFO_EPROTO, 0x07, "Unknown task" )
+
+static void iscsi_start_tx ( struct iscsi_session *iscsi,
+			     struct iscsi_task *task );
+static void iscsi_tx_resume ( struct iscsi_session *iscsi );
 static void iscsi_start_login ( struct iscsi_session *iscsi );
-static void iscsi_start_data_out ( struct iscsi_session *iscsi,
-				   unsigned int datasn );
 
 /**
  * Finish receiving PDU data into buffer
@@ -185,6 +198,35 @@ static int iscsi_rx_buffered_data ( struct iscsi_session *iscsi,
 	return 0;
 }
 
+/**
+ * Get iSCSI digests in use
+ *
+ * @v iscsi		iSCSI session
+ * @ret digests		Digests in use
+ *
+ * Digests are negotiated during login, but are used only for PDUs in
+ * the full feature phase.  The return value is the bitwise-OR of zero
+ * or more of ISCSI_STATUS_HEADER_DIGEST and ISCSI_STATUS_DATA_DIGEST.
+ */
+static int iscsi_digests ( struct iscsi_session *iscsi ) {
+
+	if ( ( iscsi->status & ISCSI_STATUS_PHASE_MASK ) !=
+	     ISCSI_STATUS_FULL_FEATURE_PHASE )
+		return 0;
+	return ( iscsi->status & ( ISCSI_STATUS_HEADER_DIGEST |
+				   ISCSI_STATUS_DATA_DIGEST ) );
+}
+
+/**
+ * Calculate iSCSI digest
+ *
+ * @v crc		Running CRC32C value
+ * @ret digest		Digest, in transmission byte order
+ */
+static inline uint32_t iscsi_digest ( uint32_t crc ) {
+	return cpu_to_le32 ( ~crc );
+}
+
 /**
  * Free iSCSI session
  *
@@ -203,7 +245,6 @@ static void iscsi_free ( struct refcnt *refcnt ) {
 	free ( iscsi->target_password );
 	chap_finish ( &iscsi->chap );
 	iscsi_rx_buffered_data_done ( iscsi );
-	free ( iscsi->command );
 	free ( iscsi );
 }
 
@@ -214,6 +255,8 @@ static void iscsi_free ( struct refcnt *refcnt ) {
  * @v rc		Reason for close
  */
 static void iscsi_close ( struct iscsi_session *iscsi, int rc ) {
+	struct iscsi_task *task;
+	unsigned int i;
 
 	/* A TCP graceful close is still an error from our point of view */
 	if ( rc == 0 )
@@ -227,18 +270,50 @@ static void iscsi_close ( struct iscsi_session *iscsi, int rc ) {
 	/* Shut down interfaces */
 	intf_shutdown ( &iscsi->socket, rc );
 	intf_shutdown ( &iscsi->control, rc );
-	intf_shutdown ( &iscsi->data, rc );
+	for ( i = 0 ; i < ISCSI_MAX_TASKS ; i++ ) {
+		task = &iscsi->task[i];
+		task->status = 0;
+		intf_shutdown ( &task->data, rc );
+	}
+	iscsi->tx_task = NULL;
 }
 
 /**
  * Assign new iSCSI initiator task tag
  *
- * @v iscsi		iSCSI session
+ * @ret itt		Initiator task tag
  */
-static void iscsi_new_itt ( struct iscsi_session *iscsi ) {
+static uint32_t iscsi_new_itt ( void ) {
 	static uint16_t itt_idx;
 
-	iscsi->itt = ( ISCSI_TAG_MAGIC | (++itt_idx) );
+	return ( ISCSI_TAG_MAGIC | (++itt_idx) );
+}
+
+/**
+ * Find iSCSI task
+ *
+ * @v iscsi		iSCSI session
+ * @v itt		Initiator task tag
+ * @ret task		iSCSI task, or NULL if not found
+ *
+ * A task cannot legitimately receive any response while one of its
+ * own PDUs is still being transmitted, so such a task is treated as
+ * not found.
+ */
+static struct iscsi_task * iscsi_find_task ( struct iscsi_session *iscsi,
+					     uint32_t itt ) {
+	struct iscsi_task *task;
+	unsigned int i;
+
+	for ( i = 0 ; i < ISCSI_MAX_TASKS ; i++ ) {
+		task = &iscsi->task[i];
+		if ( ( task->status & ISCSI_TASK_ACTIVE ) &&
+		     ( task->itt == itt ) && ( task != iscsi->tx_task ) )
+			return task;
+	}
+
+	DBGC ( iscsi, "iSCSI %p has no task for ITT %08x\n", iscsi, itt );
+	return NULL;
 }
 
 /**
@@ -267,17 +342,34 @@ static int iscsi_open_connection ( struct iscsi_session *iscsi ) {
 		return rc;
 	}
 
-	/* Enter security negotiation phase */
-	iscsi->status = ( ISCSI_STATUS_SECURITY_NEGOTIATION_PHASE |
-			  ISCSI_STATUS_STRINGS_SECURITY );
-	if ( iscsi->target_username )
-		iscsi->status |= ISCSI_STATUS_AUTH_REVERSE_REQUIRED;
+	/* When reinstating a connection within a session that did not
+	 * require authentication, proceed directly to operational
+	 * negotiation.  Otherwise, enter security negotiation phase.
+	 */
+	if ( iscsi->tsih && ! iscsi->auth_required ) {
+		iscsi->status = ( ISCSI_STATUS_OPERATIONAL_NEGOTIATION_PHASE |
+				  ISCSI_STATUS_STRINGS_NAMES |
+				  ISCSI_STATUS_STRINGS_OPERATIONAL );
+	} else {
+		iscsi->status = ( ISCSI_STATUS_SECURITY_NEGOTIATION_PHASE |
+				  ISCSI_STATUS_STRINGS_NAMES |
+				  ISCSI_STATUS_STRINGS_SECURITY );
+		if ( iscsi->target_username )
+			iscsi->status |= ISCSI_STATUS_AUTH_REVERSE_REQUIRED;
+	}
 
-	/* Assign new ISID */
-	iscsi->isid_iana_qual = ( random() & 0xffff );
+	/* Reset negotiated parameters.  Immediate data will be used
+	 * only if the target explicitly agrees to it.  Session-wide
+	 * parameters are retained when reinstating a connection.
+	 */
+	iscsi->max_send_len = ISCSI_DEFAULT_MAX_RECV_DATA_SEG_LEN;
+	if ( ! iscsi->tsih ) {
+		iscsi->first_burst_len = ISCSI_DEFAULT_FIRST_BURST_LEN;
+		iscsi->immediate_data = 0;
+	}
 
 	/* Assign fresh initiator task tag */
-	iscsi_new_itt ( iscsi );
+	iscsi->itt = iscsi_new_itt();
 
 	/* Initiate login */
 	iscsi_start_login ( iscsi );
@@ -316,6 +408,7 @@ static void iscsi_close_connection ( struct iscsi_session *iscsi, int rc ) {
  * Mark iSCSI SCSI operation as complete
  *
  * @v iscsi		iSCSI session
+ * @v task		iSCSI task
  * @v rc		Return status code
  * @v rsp		SCSI response, if any
  *
@@ -324,27 +417,36 @@ static void iscsi_close_connection ( struct iscsi_session *iscsi, int rc ) {
  * appropriate state, otherwise bad things may happen on the next call
  * to iscsi_scsi_command().  The general rule is to call
  * iscsi_scsi_done() only at the end of receiving a PDU; at this point
- * the TX and RX engines should both be idle.
+ * the RX engine will be idle and the TX engine will not be
+ * transmitting any PDU belonging to this task.
  */
-static void iscsi_scsi_done ( struct iscsi_session *iscsi, int rc,
+static void iscsi_scsi_done ( struct iscsi_session *iscsi,
+			      struct iscsi_task *task, int rc,
 			      struct scsi_rsp *rsp ) {
-	uint32_t itt = iscsi->itt;
+	uint32_t itt = task->itt;
 
-	assert ( iscsi->tx_state == ISCSI_TX_IDLE );
+	assert ( task != iscsi->tx_task );
 
-	/* Clear command */
-	free ( iscsi->command );
-	iscsi->command = NULL;
+	/* Free task */
+	task->status = 0;
+
+	/* A successful completion shows that the connection is usable */
+	if ( rc == 0 )
+		iscsi->reinstatements = 0;
 
 	/* Send SCSI response, if any */
-	scsi_response ( &iscsi->data, rsp );
+	scsi_response ( &task->data, rsp );
 
 	/* Close SCSI command, if this is still the same command.  (It
 	 * is possible that the command interface has already been
-	 * closed as a result of the SCSI response we sent.)
+	 * closed as a result of the SCSI response we sent, and that
+	 * the task has since been reused for a new command.)
 	 */
-	if ( iscsi->itt == itt )
-		intf_restart ( &iscsi->data, rc );
+	if ( task->itt == itt )
+		intf_restart ( &task->data, rc );
+
+	/* Notify SCSI layer of window change */
+	xfer_window_changed ( &iscsi->control );
 }
 
 /****************************************************************************
@@ -357,41 +459,58 @@ static void iscsi_scsi_done ( struct iscsi_session *iscsi, int rc,
  * Build iSCSI SCSI command BHS
  *
  * @v iscsi		iSCSI session
+ * @v task		iSCSI task
  *
  * We don't currently support bidirectional commands (i.e. with both
  * Data-In and Data-Out segments); these would require providing code
  * to generate an AHS, and there doesn't seem to be any need for it at
  * the moment.
+ *
+ * If the target has agreed to accept immediate data, then as much of
+ * the Data-Out buffer as possible is sent within the command PDU
+ * itself.
  */
-static void iscsi_start_command ( struct iscsi_session *iscsi ) {
+static void iscsi_start_command ( struct iscsi_session *iscsi,
+				  struct iscsi_task *task ) {
 	struct iscsi_bhs_scsi_command *command = &iscsi->tx_bhs.scsi_command;
+	struct scsi_cmd *scsicmd = &task->command;
+	size_t len = 0;
 
-	assert ( ! ( iscsi->command->data_in && iscsi->command->data_out ) );
+	assert ( ! ( scsicmd->data_in && scsicmd->data_out ) );
+
+	/* Calculate length of immediate data */
+	if ( scsicmd->data_out && iscsi->immediate_data ) {
+		len = scsicmd->data_out_len;
+		if ( len > iscsi->first_burst_len )
+			len = iscsi->first_burst_len;
+		if ( len > iscsi->max_send_len )
+			len = iscsi->max_send_len;
+	}
 
 	/* Construct BHS and initiate transmission */
-	iscsi_start_tx ( iscsi );
+	iscsi_start_tx ( iscsi, task );
 	command->opcode = ISCSI_OPCODE_SCSI_COMMAND;
 	command->flags = ( ISCSI_FLAG_FINAL |
 			   ISCSI_COMMAND_ATTR_SIMPLE );
-	if ( iscsi->command->data_in )
+	if ( scsicmd->data_in )
 		command->flags |= ISCSI_COMMAND_FLAG_READ;
-	if ( iscsi->command->data_out )
+	if ( scsicmd->data_out )
 		command->flags |= ISCSI_COMMAND_FLAG_WRITE;
-	/* lengths left as zero */
-	memcpy ( &command->lun, &iscsi->command->lun,
-		 sizeof ( command->lun ) );
-	command->itt = htonl ( iscsi->itt );
-	command->exp_len = htonl ( iscsi->command->data_in_len |
-				   iscsi->command->data_out_len );
-	command->cmdsn = htonl ( iscsi->cmdsn );
+	ISCSI_SET_LENGTHS ( command->lengths, 0, len );
+	memcpy ( &command->lun, &scsicmd->lun, sizeof ( command->lun ) );
+	command->itt = htonl ( task->itt );
+	command->exp_len = htonl ( scsicmd->data_in_len |
+				   scsicmd->data_out_len );
+	command->cmdsn = htonl ( iscsi->cmdsn++ );
 	command->expstatsn = htonl ( iscsi->statsn + 1 );
-	memcpy ( &command->cdb, &iscsi->command->cdb, sizeof ( command->cdb ));
-	DBGC2 ( iscsi, "iSCSI %p start " SCSI_CDB_FORMAT " %s %#zx\n",
-		iscsi, SCSI_CDB_DATA ( command->cdb ),
-		( iscsi->command->data_in ? "in" : "out" ),
-		( iscsi->command->data_in ?
-		  iscsi->command->data_in_len :
-		  iscsi->command->data_out_len ) );
+	memcpy ( &command->cdb, &scsicmd->cdb, sizeof ( command->cdb ));
+	task->status &= ~ISCSI_TASK_TX_COMMAND;
+	DBGC2 ( iscsi, "iSCSI %p start " SCSI_CDB_FORMAT " %s %#zx imm %#zx "
+		"ITT %08x\n", iscsi, SCSI_CDB_DATA ( command->cdb ),
+		( scsicmd->data_in ? "in" : "out" ),
+		( scsicmd->data_in ?
+		  scsicmd->data_in_len : scsicmd->data_out_len ),
+		len, task->itt );
 }
 
 /**
@@ -408,6 +527,7 @@ static int iscsi_rx_scsi_response ( struct iscsi_session *iscsi,
 				    size_t remaining ) {
 	struct iscsi_bhs_scsi_response *response
 		= &iscsi->rx_bhs.scsi_response;
+	struct iscsi_task *task;
 	struct scsi_rsp rsp;
 	uint32_t residual_count;
 	int rc;
@@ -439,8 +559,13 @@ static int iscsi_rx_scsi_response ( struct iscsi_session *iscsi,
 	if ( response->response != ISCSI_RESPONSE_COMMAND_COMPLETE )
 		return -EIO;
 
+	/* Identify task */
+	task = iscsi_find_task ( iscsi, ntohl ( response->itt ) );
+	if ( ! task )
+		return -EPROTO_UNKNOWN_TASK;
+
 	/* Mark as completed */
-	iscsi_scsi_done ( iscsi, 0, &rsp );
+	iscsi_scsi_done ( iscsi, task, 0, &rsp );
 	return 0;
 }
 
@@ -457,14 +582,21 @@ static int iscsi_rx_data_in ( struct iscsi_session *iscsi,
 			      const void *data, size_t len,
 			      size_t remaining ) {
 	struct iscsi_bhs_data_in *data_in = &iscsi->rx_bhs.data_in;
+	struct iscsi_task *task;
 	unsigned long offset;
 
+	/* Identify task */
+	task = iscsi_find_task ( iscsi, ntohl ( data_in->itt ) );
+	if ( ! task )
+		return -EPROTO_UNKNOWN_TASK;
+
 	/* Copy data to data-in buffer */
-	offset = ntohl ( data_in->offset ) + iscsi->rx_offset;
-	assert ( iscsi->command != NULL );
-	assert ( iscsi->command->data_in );
-	assert ( ( offset + len ) <= iscsi->command->data_in_len );
-	copy_to_user ( iscsi->command->data_in, offset, data, len );
+	if ( len ) {
+		offset = ntohl ( data_in->offset ) + iscsi->rx_offset;
+		assert ( task->command.data_in );
+		assert ( ( offset + len ) <= task->command.data_in_len );
+		copy_to_user ( task->command.data_in, offset, data, len );
+	}
 
 	/* Wait for whole SCSI response to arrive */
 	if ( remaining )
@@ -472,10 +604,12 @@ static int iscsi_rx_data_in ( struct iscsi_session *iscsi,
 
 	/* Mark as completed if status is present */
 	if ( data_in->flags & ISCSI_DATA_FLAG_STATUS ) {
-		assert ( ( offset + len ) == iscsi->command->data_in_len );
+		assert ( ( ntohl ( data_in->offset ) +
+			   ISCSI_DATA_LEN ( data_in->lengths ) ) ==
+			 task->command.data_in_len );
 		assert ( data_in->flags & ISCSI_FLAG_FINAL );
 		/* iSCSI cannot return an error status via a data-in */
-		iscsi_scsi_done ( iscsi, 0, NULL );
+		iscsi_scsi_done ( iscsi, task, 0, NULL );
 	}
 
 	return 0;
@@ -494,12 +628,19 @@ static int iscsi_rx_r2t ( struct iscsi_session *iscsi,
 			  const void *data __unused, size_t len __unused,
 			  size_t remaining __unused ) {
 	struct iscsi_bhs_r2t *r2t = &iscsi->rx_bhs.r2t;
-
-	/* Record transfer parameters and trigger first data-out */
-	iscsi->ttt = ntohl ( r2t->ttt );
-	iscsi->transfer_offset = ntohl ( r2t->offset );
-	iscsi->transfer_len = ntohl ( r2t->len );
-	iscsi_start_data_out ( iscsi, 0 );
+	struct iscsi_task *task;
+
+	/* Identify task */
+	task = iscsi_find_task ( iscsi, ntohl ( r2t->itt ) );
+	if ( ! task )
+		return -EPROTO_UNKNOWN_TASK;
+
+	/* Record transfer parameters and schedule data-out sequence */
+	task->ttt = ntohl ( r2t->ttt );
+	task->transfer_offset = ntohl ( r2t->offset );
+	task->transfer_len = ntohl ( r2t->len );
+	task->status |= ISCSI_TASK_TX_DATA_OUT;
+	iscsi_tx_resume ( iscsi );
 
 	return 0;
 }
@@ -508,86 +649,113 @@ static int iscsi_rx_r2t ( struct iscsi_session *iscsi,
  * Build iSCSI data-out BHS
  *
  * @v iscsi		iSCSI session
+ * @v task		iSCSI task
  * @v datasn		Data sequence number within the transfer
  *
  */
 static void iscsi_start_data_out ( struct iscsi_session *iscsi,
+				   struct iscsi_task *task,
 				   unsigned int datasn ) {
 	struct iscsi_bhs_data_out *data_out = &iscsi->tx_bhs.data_out;
 	unsigned long offset;
 	unsigned long remaining;
 	unsigned long len;
 
-	/* We always send 512-byte Data-Out PDUs; this removes the
-	 * need to worry about the target's MaxRecvDataSegmentLength.
+	/* All Data-Out PDUs within the sequence (other than the
+	 * last) are of the maximum length accepted by the target.
 	 */
-	offset = datasn * 512;
-	remaining = iscsi->transfer_len - offset;
+	offset = datasn * iscsi->max_send_len;
+	remaining = task->transfer_len - offset;
 	len = remaining;
-	if ( len > 512 )
-		len = 512;
+	if ( len > iscsi->max_send_len )
+		len = iscsi->max_send_len;
 
 	/* Construct BHS and initiate transmission */
-	iscsi_start_tx ( iscsi );
+	iscsi_start_tx ( iscsi, task );
 	data_out->opcode = ISCSI_OPCODE_DATA_OUT;
 	if ( len == remaining )
 		data_out->flags = ( ISCSI_FLAG_FINAL );
 	ISCSI_SET_LENGTHS ( data_out->lengths, 0, len );
-	data_out->lun = iscsi->command->lun;
-	data_out->itt = htonl ( iscsi->itt );
-	data_out->ttt = htonl ( iscsi->ttt );
+	data_out->lun = task->command.lun;
+	data_out->itt = htonl ( task->itt );
+	data_out->ttt = htonl ( task->ttt );
 	data_out->expstatsn = htonl ( iscsi->statsn + 1 );
 	data_out->datasn = htonl ( datasn );
-	data_out->offset = htonl ( iscsi->transfer_offset + offset );
-	DBGC ( iscsi, "iSCSI %p start data out DataSN %#x len %#lx\n",
-	       iscsi, datasn, len );
+	data_out->offset = htonl ( task->transfer_offset + offset );
+	task->status &= ~ISCSI_TASK_TX_DATA_OUT;
+	DBGC ( iscsi, "iSCSI %p start data out ITT %08x DataSN %#x len %#lx\n",
+	       iscsi, task->itt, datasn, len );
 }
 
 /**
  * Complete iSCSI data-out PDU transmission
  *
  * @v iscsi		iSCSI session
+ * @v task		iSCSI task
  *
  */
-static void iscsi_data_out_done ( struct iscsi_session *iscsi ) {
+static void iscsi_data_out_done ( struct iscsi_session *iscsi,
+				  struct iscsi_task *task ) {
 	struct iscsi_bhs_data_out *data_out = &iscsi->tx_bhs.data_out;
 
 	/* If we haven't reached the end of the sequence, start
 	 * sending the next data-out PDU.
 	 */
-	if ( ! ( data_out->flags & ISCSI_FLAG_FINAL ) )
-		iscsi_start_data_out ( iscsi, ntohl ( data_out->datasn ) + 1 );
+	if ( ! ( data_out->flags & ISCSI_FLAG_FINAL ) ) {
+		iscsi_start_data_out ( iscsi, task,
+				       ( ntohl ( data_out->datasn ) + 1 ) );
+	}
 }
 
 /**
- * Send iSCSI data-out data segment
+ * Send iSCSI write data
  *
  * @v iscsi		iSCSI session
+ * @v offset		Offset within Data-Out buffer
  * @ret rc		Return status code
+ *
+ * This is used to send the data segment of both data-out PDUs and
+ * SCSI command PDUs carrying immediate data.
  */
-static int iscsi_tx_data_out ( struct iscsi_session *iscsi ) {
-	struct iscsi_bhs_data_out *data_out = &iscsi->tx_bhs.data_out;
+static int iscsi_tx_write_data ( struct iscsi_session *iscsi,
+				 unsigned long offset ) {
+	struct iscsi_bhs_common *common = &iscsi->tx_bhs.common;
+	struct iscsi_task *task = iscsi->tx_task;
 	struct io_buffer *iobuf;
-	unsigned long offset;
+	uint32_t *digest;
+	uint32_t crc;
 	size_t len;
 	size_t pad_len;
 
-	offset = ntohl ( data_out->offset );
-	len = ISCSI_DATA_LEN ( data_out->lengths );
-	pad_len = ISCSI_DATA_PAD_LEN ( data_out->lengths );
+	len = ISCSI_DATA_LEN ( common->lengths );
+	pad_len = ISCSI_DATA_PAD_LEN ( common->lengths );
 
-	assert ( iscsi->command != NULL );
-	assert ( iscsi->command->data_out );
-	assert ( ( offset + len ) <= iscsi->command->data_out_len );
+	/* Do nothing if there is no data segment (e.g. for a SCSI
+	 * command PDU without immediate data).
+	 */
+	if ( ! len )
+		return 0;
 
-	iobuf = xfer_alloc_iob ( &iscsi->socket, ( len + pad_len ) );
+	assert ( task != NULL );
+	assert ( task->command.data_out );
+	assert ( ( offset + len ) <= task->command.data_out_len );
+
+	iobuf = xfer_alloc_iob ( &iscsi->socket,
+				 ( len + pad_len + sizeof ( *digest ) ) );
 	if ( ! iobuf )
 		return -ENOMEM;
 	
 	copy_from_user ( iob_put ( iobuf, len ),
-			 iscsi->command->data_out, offset, len );
+			 task->command.data_out, offset, len );
 	memset ( iob_put ( iobuf, pad_len ), 0, pad_len );
 
+	/* Append data digest, if applicable */
+	if ( iscsi_digests ( iscsi ) & ISCSI_STATUS_DATA_DIGEST ) {
+		crc = crc32c_le ( ~0, iobuf->data, iob_len ( iobuf ) );
+		digest = iob_put ( iobuf, sizeof ( *digest ) );
+		*digest = iscsi_digest ( crc );
+	}
+
 	return xfer_deliver_iob ( &iscsi->socket, iobuf );
 }
 
@@ -634,16 +802,16 @@ static int iscsi_rx_nop_in ( struct iscsi_session *iscsi,
  * These are the initial set of strings sent in the first login
  * request PDU.  We want the following settings:
  *
- *     HeaderDigest=None
- *     DataDigest=None
+ *     HeaderDigest=None,CRC32C [7]
+ *     DataDigest=None,CRC32C [7]
  *     MaxConnections is irrelevant; we make only one connection anyway [4]
  *     InitialR2T=Yes [1]
- *     ImmediateData is irrelevant; we never send immediate data [4]
- *     MaxRecvDataSegmentLength=8192 (default; we don't care) [3]
+ *     ImmediateData=Yes [5]
+ *     MaxRecvDataSegmentLength=65536 [6]
  *     MaxBurstLength=262144 (default; we don't care) [3]
- *     FirstBurstLength=262144 (default; we don't care)
+ *     FirstBurstLength=65536 (default; we don't care) [3]
  *     DefaultTime2Wait=0 [2]
- *     DefaultTime2Retain=0 [2]
+ *     DefaultTime2Retain=20 [2]
  *     MaxOutstandingR2T=1
  *     DataPDUInOrder=Yes
  *     DataSequenceInOrder=Yes
@@ -653,9 +821,13 @@ static int iscsi_rx_nop_in ( struct iscsi_session *iscsi,
  * force us to use it.  We therefore simplify our logic by always
  * using it.
  *
- * [2] These ensure that we can safely start a new task once we have
- * reconnected after a failure, without having to manually tidy up
- * after the old one.
+ * [2] DefaultTime2Wait ensures that we can reconnect immediately
+ * after a failure.  DefaultTime2Retain (the RFC-defined default)
+ * allows the target to retain the session for long enough that a
+ * failed connection can be reinstated within it.  At
+ * ErrorRecoveryLevel=0 the target terminates all outstanding tasks
+ * when the connection fails, so we can safely reissue them as new
+ * tasks without having to manually tidy up after the old ones.
  *
  * [3] We are quite happy to use the RFC-defined default values for
  * these parameters, but some targets (notably OpenSolaris)
@@ -666,12 +838,38 @@ static int iscsi_rx_nop_in ( struct iscsi_session *iscsi,
  * these parameters, but some targets (notably a QNAP TS-639Pro) fail
  * unless they are supplied, so we explicitly specify the default
  * values.
+ *
+ * [5] ImmediateData has an AND resolution function.  If the target
+ * agrees, we send write data within the SCSI command PDU itself,
+ * saving a round trip for each write command.
+ *
+ * [6] Larger PDUs reduce the per-PDU overhead of reading from the
+ * target.  The target's own MaxRecvDataSegmentLength is a declaration
+ * of what it can receive, and is used to size our Data-Out PDUs.
+ *
+ * [7] We prefer not to use digests, but will use them if the target
+ * insists.  Digests are calculated incrementally as each PDU is
+ * transmitted or received.
+ *
+ * When reinstating a connection within an existing session, we omit
+ * SessionType and all other leading-only keys, and the session-wide
+ * values negotiated during the original login remain in force.  Only
+ * the connection-specific keys (HeaderDigest, DataDigest and
+ * MaxRecvDataSegmentLength) are renegotiated.
  */
 static int iscsi_build_login_request_strings ( struct iscsi_session *iscsi,
 					       void *data, size_t len ) {
 	unsigned int used = 0;
 	const char *auth_method;
 
+	if ( iscsi->status & ISCSI_STATUS_STRINGS_NAMES ) {
+		used += ssnprintf ( data + used, len - used,
+				    "InitiatorName=%s%c"
+				    "TargetName=%s%c",
+				    iscsi->initiator_iqn, 0,
+				    iscsi->target_iqn, 0 );
+	}
+
 	if ( iscsi->status & ISCSI_STATUS_STRINGS_SECURITY ) {
 		/* Default to allowing no authentication */
 		auth_method = "None";
@@ -681,14 +879,12 @@ static int iscsi_build_login_request_strings ( struct iscsi_session *iscsi,
 		/* If we have a credential to check, force CHAP */
 		if ( iscsi->target_username )
 			auth_method = "CHAP";
+		if ( ! iscsi->tsih ) {
+			used += ssnprintf ( data + used, len - used,
+					    "SessionType=Normal%c", 0 );
+		}
 		used += ssnprintf ( data + used, len - used,
-				    "InitiatorName=%s%c"
-				    "TargetName=%s%c"
-				    "SessionType=Normal%c"
-				    "AuthMethod=%s%c",
-				    iscsi->initiator_iqn, 0,
-				    iscsi->target_iqn, 0, 0,
-				    auth_method, 0 );
+				    "AuthMethod=%s%c", auth_method, 0 );
 	}
 
 	if ( iscsi->status & ISCSI_STATUS_STRINGS_CHAP_ALGORITHM ) {
@@ -717,20 +913,28 @@ static int iscsi_build_login_request_strings ( struct iscsi_session *iscsi,
 
 	if ( iscsi->status & ISCSI_STATUS_STRINGS_OPERATIONAL ) {
 		used += ssnprintf ( data + used, len - used,
-				    "HeaderDigest=None%c"
-				    "DataDigest=None%c"
+				    "HeaderDigest=None,CRC32C%c"
+				    "DataDigest=None,CRC32C%c"
+				    "MaxRecvDataSegmentLength=%d%c",
+				    0, 0, ISCSI_MAX_DATA_SEG_LEN, 0 );
+	}
+
+	if ( ( iscsi->status & ISCSI_STATUS_STRINGS_OPERATIONAL ) &&
+	     ! iscsi->tsih ) {
+		used += ssnprintf ( data + used, len - used,
 				    "MaxConnections=1%c"
 				    "InitialR2T=Yes%c"
-				    "ImmediateData=No%c"
-				    "MaxRecvDataSegmentLength=8192%c"
+				    "ImmediateData=Yes%c"
 				    "MaxBurstLength=262144%c"
+				    "FirstBurstLength=%d%c"
 				    "DefaultTime2Wait=0%c"
-				    "DefaultTime2Retain=0%c"
+				    "DefaultTime2Retain=20%c"
 				    "MaxOutstandingR2T=1%c"
 				    "DataPDUInOrder=Yes%c"
 				    "DataSequenceInOrder=Yes%c"
 				    "ErrorRecoveryLevel=0%c",
-				    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 );
+				    0, 0, 0, 0, ISCSI_DEFAULT_FIRST_BURST_LEN,
+				    0, 0, 0, 0, 0, 0, 0 );
 	}
 
 	return used;
@@ -759,7 +963,7 @@ static void iscsi_start_login ( struct iscsi_session *iscsi ) {
 	}
 
 	/* Construct BHS and initiate transmission */
-	iscsi_start_tx ( iscsi );
+	iscsi_start_tx ( iscsi, NULL );
 	request->opcode = ( ISCSI_OPCODE_LOGIN_REQUEST |
 			    ISCSI_FLAG_IMMEDIATE );
 	request->flags = ( ( iscsi->status & ISCSI_STATUS_PHASE_MASK ) |
@@ -770,7 +974,7 @@ static void iscsi_start_login ( struct iscsi_session *iscsi ) {
 	request->isid_iana_en = htonl ( ISCSI_ISID_IANA |
 					IANA_EN_FEN_SYSTEMS );
 	request->isid_iana_qual = htons ( iscsi->isid_iana_qual );
-	/* tsih left as zero */
+	request->tsih = htons ( iscsi->tsih );
 	request->itt = htonl ( iscsi->itt );
 	/* cid left as zero */
 	request->cmdsn = htonl ( iscsi->cmdsn );
@@ -1094,6 +1298,104 @@ static int iscsi_handle_chap_r_value ( struct iscsi_session *iscsi,
 	return 0;
 }
 
+/**
+ * Handle iSCSI MaxRecvDataSegmentLength text value
+ *
+ * @v iscsi		iSCSI session
+ * @v value		MaxRecvDataSegmentLength value
+ * @ret rc		Return status code
+ */
+static int
+iscsi_handle_maxrecvdatasegmentlength_value ( struct iscsi_session *iscsi,
+					      const char *value ) {
+	unsigned long len;
+	char *endp;
+
+	/* The target declares the length that it is able to receive */
+	len = strtoul ( value, &endp, 10 );
+	if ( ( *endp != '\0' ) || ( len == 0 ) ) {
+		DBGC ( iscsi, "iSCSI %p saw invalid MaxRecvDataSegmentLength "
+		       "\"%s\"\n", iscsi, value );
+		return -EPROTO_INVALID_KEY_VALUE_PAIR;
+	}
+	if ( len > ISCSI_MAX_DATA_SEG_LEN )
+		len = ISCSI_MAX_DATA_SEG_LEN;
+	iscsi->max_send_len = len;
+
+	return 0;
+}
+
+/**
+ * Handle iSCSI FirstBurstLength text value
+ *
+ * @v iscsi		iSCSI session
+ * @v value		FirstBurstLength value
+ * @ret rc		Return status code
+ */
+static int iscsi_handle_firstburstlength_value ( struct iscsi_session *iscsi,
+						 const char *value ) {
+	unsigned long len;
+	char *endp;
+
+	len = strtoul ( value, &endp, 10 );
+	if ( *endp != '\0' ) {
+		DBGC ( iscsi, "iSCSI %p saw invalid FirstBurstLength "
+		       "\"%s\"\n", iscsi, value );
+		return -EPROTO_INVALID_KEY_VALUE_PAIR;
+	}
+	iscsi->first_burst_len = len;
+
+	return 0;
+}
+
+/**
+ * Handle iSCSI ImmediateData text value
+ *
+ * @v iscsi		iSCSI session
+ * @v value		ImmediateData value
+ * @ret rc		Return status code
+ */
+static int iscsi_handle_immediatedata_value ( struct iscsi_session *iscsi,
+					      const char *value ) {
+
+	iscsi->immediate_data = ( strcmp ( value, "Yes" ) == 0 );
+	return 0;
+}
+
+/**
+ * Handle iSCSI HeaderDigest text value
+ *
+ * @v iscsi		iSCSI session
+ * @v value		HeaderDigest value
+ * @ret rc		Return status code
+ */
+static int iscsi_handle_headerdigest_value ( struct iscsi_session *iscsi,
+					     const char *value ) {
+
+	if ( strcmp ( value, "CRC32C" ) == 0 ) {
+		DBGC ( iscsi, "iSCSI %p using header digests\n", iscsi );
+		iscsi->status |= ISCSI_STATUS_HEADER_DIGEST;
+	}
+	return 0;
+}
+
+/**
+ * Handle iSCSI DataDigest text value
+ *
+ * @v iscsi		iSCSI session
+ * @v value		DataDigest value
+ * @ret rc		Return status code
+ */
+static int iscsi_handle_datadigest_value ( struct iscsi_session *iscsi,
+					   const char *value ) {
+
+	if ( strcmp ( value, "CRC32C" ) == 0 ) {
+		DBGC ( iscsi, "iSCSI %p using data digests\n", iscsi );
+		iscsi->status |= ISCSI_STATUS_DATA_DIGEST;
+	}
+	return 0;
+}
+
 /** An iSCSI text string that we want to handle */
 struct iscsi_string_type {
 	/** String key
@@ -1120,6 +1422,12 @@ static struct iscsi_string_type iscsi_string_types[] = {
 	{ "CHAP_C", iscsi_handle_chap_c_value },
 	{ "CHAP_N", iscsi_handle_chap_n_value },
 	{ "CHAP_R", iscsi_handle_chap_r_value },
+	{ "MaxRecvDataSegmentLength",
+	  iscsi_handle_maxrecvdatasegmentlength_value },
+	{ "FirstBurstLength", iscsi_handle_firstburstlength_value },
+	{ "ImmediateData", iscsi_handle_immediatedata_value },
+	{ "HeaderDigest", iscsi_handle_headerdigest_value },
+	{ "DataDigest", iscsi_handle_datadigest_value },
 	{ NULL, NULL }
 };
 
@@ -1285,6 +1593,19 @@ static int iscsi_rx_login_response ( struct iscsi_session *iscsi,
 		       response->status_class, response->status_detail );
 		rc = iscsi_status_to_rc ( response->status_class,
 					  response->status_detail );
+
+		/* If the target refused to reinstate the connection
+		 * within the existing session, fall back to a full
+		 * login.  Since the ISID is unchanged, this will
+		 * reinstate the session instead.
+		 */
+		if ( iscsi->tsih ) {
+			DBGC ( iscsi, "iSCSI %p could not reinstate "
+			       "connection; attempting full login\n", iscsi );
+			iscsi->tsih = 0;
+			iscsi_close_connection ( iscsi, rc );
+			return iscsi_open_connection ( iscsi );
+		}
 		return rc;
 	}
 
@@ -1325,9 +1646,22 @@ static int iscsi_rx_login_response ( struct iscsi_session *iscsi,
 		return -EPROTO;
 	}
 
-	/* Notify SCSI layer of window change */
-	DBGC ( iscsi, "iSCSI %p entering full feature phase\n", iscsi );
+	/* Record session identifying handle, and whether or not
+	 * authentication is required to reinstate a connection
+	 * within this session.
+	 */
+	iscsi->tsih = ntohs ( response->tsih );
+	iscsi->auth_required =
+		( !! ( iscsi->status & ( ISCSI_STATUS_AUTH_FORWARD_REQUIRED |
+					 ISCSI_STATUS_AUTH_REVERSE_REQUIRED )));
+
+	/* Notify SCSI layer of window change, and resume transmission
+	 * of any commands reissued after a connection reinstatement.
+	 */
+	DBGC ( iscsi, "iSCSI %p entering full feature phase (TSIH %04x)\n",
+	       iscsi, iscsi->tsih );
 	xfer_window_changed ( &iscsi->control );
+	iscsi_tx_resume ( iscsi );
 
 	return 0;
 }
@@ -1360,16 +1694,19 @@ static void iscsi_tx_resume ( struct iscsi_session *iscsi ) {
  * Start up a new TX PDU
  *
  * @v iscsi		iSCSI session
+ * @v task		iSCSI task owning the PDU, or NULL
  *
  * This initiates the process of sending a new PDU.  Only one PDU may
  * be in transit at any one time.
  */
-static void iscsi_start_tx ( struct iscsi_session *iscsi ) {
+static void iscsi_start_tx ( struct iscsi_session *iscsi,
+			     struct iscsi_task *task ) {
 
 	assert ( iscsi->tx_state == ISCSI_TX_IDLE );
 
 	/* Initialise TX BHS */
 	memset ( &iscsi->tx_bhs, 0, sizeof ( iscsi->tx_bhs ) );
+	iscsi->tx_task = task;
 
 	/* Flag TX engine to start transmitting */
 	iscsi->tx_state = ISCSI_TX_BHS;
@@ -1378,6 +1715,41 @@ static void iscsi_start_tx ( struct iscsi_session *iscsi ) {
 	iscsi_tx_resume ( iscsi );
 }
 
+/**
+ * Start up next pending task PDU
+ *
+ * @v iscsi		iSCSI session
+ * @ret started		A new PDU has been started
+ *
+ * SCSI command PDUs are given priority over data-out sequences, so
+ * that the target may start work on new commands as soon as possible.
+ */
+static int iscsi_tx_next ( struct iscsi_session *iscsi ) {
+	struct iscsi_task *task;
+	unsigned int i;
+
+	/* Do not start any task PDUs until login is complete */
+	if ( ( iscsi->status & ISCSI_STATUS_PHASE_MASK ) !=
+	     ISCSI_STATUS_FULL_FEATURE_PHASE )
+		return 0;
+
+	for ( i = 0 ; i < ISCSI_MAX_TASKS ; i++ ) {
+		task = &iscsi->task[i];
+		if ( task->status & ISCSI_TASK_TX_COMMAND ) {
+			iscsi_start_command ( iscsi, task );
+			return 1;
+		}
+	}
+	for ( i = 0 ; i < ISCSI_MAX_TASKS ; i++ ) {
+		task = &iscsi->task[i];
+		if ( task->status & ISCSI_TASK_TX_DATA_OUT ) {
+			iscsi_start_data_out ( iscsi, task, 0 );
+			return 1;
+		}
+	}
+	return 0;
+}
+
 /**
  * Transmit nothing
  *
@@ -1395,8 +1767,27 @@ static int iscsi_tx_nothing ( struct iscsi_session *iscsi __unused ) {
  * @ret rc		Return status code
  */
 static int iscsi_tx_bhs ( struct iscsi_session *iscsi ) {
-	return xfer_deliver_raw ( &iscsi->socket,  &iscsi->tx_bhs,
-				  sizeof ( iscsi->tx_bhs ) );
+	struct io_buffer *iobuf;
+	uint32_t *digest;
+
+	/* Send BHS alone if header digests are not in use */
+	if ( ! ( iscsi_digests ( iscsi ) & ISCSI_STATUS_HEADER_DIGEST ) ) {
+		return xfer_deliver_raw ( &iscsi->socket,  &iscsi->tx_bhs,
+					  sizeof ( iscsi->tx_bhs ) );
+	}
+
+	/* Send BHS followed by header digest */
+	iobuf = xfer_alloc_iob ( &iscsi->socket, ( sizeof ( iscsi->tx_bhs ) +
+						   sizeof ( *digest ) ) );
+	if ( ! iobuf )
+		return -ENOMEM;
+	memcpy ( iob_put ( iobuf, sizeof ( iscsi->tx_bhs ) ), &iscsi->tx_bhs,
+		 sizeof ( iscsi->tx_bhs ) );
+	digest = iob_put ( iobuf, sizeof ( *digest ) );
+	*digest = iscsi_digest ( crc32c_le ( ~0, &iscsi->tx_bhs,
+					     sizeof ( iscsi->tx_bhs ) ) );
+
+	return xfer_deliver_iob ( &iscsi->socket, iobuf );
 }
 
 /**
@@ -1412,8 +1803,11 @@ static int iscsi_tx_data ( struct iscsi_session *iscsi ) {
 	struct iscsi_bhs_common *common = &iscsi->tx_bhs.common;
 
 	switch ( common->opcode & ISCSI_OPCODE_MASK ) {
+	case ISCSI_OPCODE_SCSI_COMMAND:
+		return iscsi_tx_write_data ( iscsi, 0 );
 	case ISCSI_OPCODE_DATA_OUT:
-		return iscsi_tx_data_out ( iscsi );
+		return iscsi_tx_write_data ( iscsi,
+				     ntohl ( iscsi->tx_bhs.data_out.offset ) );
 	case ISCSI_OPCODE_LOGIN_REQUEST:
 		return iscsi_tx_login_request ( iscsi );
 	default:
@@ -1433,15 +1827,21 @@ static int iscsi_tx_data ( struct iscsi_session *iscsi ) {
  */
 static void iscsi_tx_done ( struct iscsi_session *iscsi ) {
 	struct iscsi_bhs_common *common = &iscsi->tx_bhs.common;
+	struct iscsi_task *task = iscsi->tx_task;
 
 	/* Stop transmission process */
 	iscsi_tx_pause ( iscsi );
 
+	/* Detach PDU from task */
+	iscsi->tx_task = NULL;
+
 	switch ( common->opcode & ISCSI_OPCODE_MASK ) {
 	case ISCSI_OPCODE_DATA_OUT:
-		iscsi_data_out_done ( iscsi );
+		iscsi_data_out_done ( iscsi, task );
+		break;
 	case ISCSI_OPCODE_LOGIN_REQUEST:
 		iscsi_login_request_done ( iscsi );
+		break;
 	default:
 		/* No action */
 		break;
@@ -1483,6 +1883,9 @@ static void iscsi_tx_step ( struct iscsi_session *iscsi ) {
 			next_state = ISCSI_TX_IDLE;
 			break;
 		case ISCSI_TX_IDLE:
+			/* Start next pending PDU, if any */
+			if ( iscsi_tx_next ( iscsi ) )
+				continue;
 			/* Nothing to do; pause processing */
 			iscsi_tx_pause ( iscsi );
 			return;
@@ -1582,8 +1985,15 @@ static int iscsi_rx_data ( struct iscsi_session *iscsi, const void *data,
 	struct iscsi_bhs_common_response *response
 		= &iscsi->rx_bhs.common_response;
 
-	/* Update cmdsn and statsn */
-	iscsi->cmdsn = ntohl ( response->expcmdsn );
+	/* Update cmdsn, maxcmdsn and statsn.  Once we have reached
+	 * the full feature phase, cmdsn is advanced only by the
+	 * commands that we send.
+	 */
+	if ( ( iscsi->status & ISCSI_STATUS_PHASE_MASK ) !=
+	     ISCSI_STATUS_FULL_FEATURE_PHASE ) {
+		iscsi->cmdsn = ntohl ( response->expcmdsn );
+	}
+	iscsi->maxcmdsn = ntohl ( response->maxcmdsn );
 	iscsi->statsn = ntohl ( response->statsn );
 
 	switch ( response->opcode & ISCSI_OPCODE_MASK ) {
@@ -1606,6 +2016,104 @@ static int iscsi_rx_data ( struct iscsi_session *iscsi, const void *data,
 	}
 }
 
+/**
+ * Calculate length of data digest for current RX PDU
+ *
+ * @v iscsi		iSCSI session
+ * @ret len		Length of data digest
+ *
+ * A data digest is present only if the data segment is non-empty.
+ */
+static size_t iscsi_rx_data_digest_len ( struct iscsi_session *iscsi ) {
+	struct iscsi_bhs_common *common = &iscsi->rx_bhs.common;
+
+	if ( ( iscsi->rx_digests & ISCSI_STATUS_DATA_DIGEST ) &&
+	     ISCSI_DATA_LEN ( common->lengths ) )
+		return sizeof ( iscsi->rx_digest );
+	return 0;
+}
+
+/**
+ * Receive part of an iSCSI digest
+ *
+ * @v iscsi		iSCSI session
+ * @v data		Received data
+ * @v len		Length of received data
+ * @v remaining		Data remaining after this data
+ * @ret ok		Digest is complete and correct
+ */
+static int iscsi_rx_digest ( struct iscsi_session *iscsi, const void *data,
+			     size_t len, size_t remaining ) {
+
+	memcpy ( ( ( ( void * ) &iscsi->rx_digest ) + iscsi->rx_offset ),
+		 data, len );
+	if ( remaining )
+		return 0;
+	return ( iscsi->rx_digest == iscsi_digest ( iscsi->rx_crc ) );
+}
+
+/**
+ * Receive header digest of an iSCSI PDU
+ *
+ * @v iscsi		iSCSI session
+ * @v data		Received data
+ * @v len		Length of received data
+ * @v remaining		Data remaining after this data
+ * @ret rc		Return status code
+ */
+static int iscsi_rx_header_digest ( struct iscsi_session *iscsi,
+				    const void *data, size_t len,
+				    size_t remaining ) {
+
+	/* Do nothing unless header digests are in use */
+	if ( ! ( iscsi->rx_digests & ISCSI_STATUS_HEADER_DIGEST ) )
+		return 0;
+
+	/* Verify digest, and start calculating the data digest */
+	if ( ! iscsi_rx_digest ( iscsi, data, len, remaining ) ) {
+		if ( remaining )
+			return 0;
+		DBGC ( iscsi, "iSCSI %p header digest mismatch\n", iscsi );
+		return -EIO_HEADER_DIGEST;
+	}
+	iscsi->rx_crc = ~0;
+
+	return 0;
+}
+
+/**
+ * Receive data digest of an iSCSI PDU
+ *
+ * @v iscsi		iSCSI session
+ * @v data		Received data
+ * @v len		Length of received data
+ * @v remaining		Data remaining after this data
+ * @ret rc		Return status code
+ *
+ * When a data digest is present, the data segment handler is not told
+ * that the data segment is complete until the digest has been
+ * verified, so that no command can complete using corrupted data.
+ */
+static int iscsi_rx_data_digest ( struct iscsi_session *iscsi,
+				  const void *data, size_t len,
+				  size_t remaining ) {
+
+	/* Do nothing unless a data digest is present */
+	if ( ! iscsi_rx_data_digest_len ( iscsi ) )
+		return 0;
+
+	/* Verify digest */
+	if ( ! iscsi_rx_digest ( iscsi, data, len, remaining ) ) {
+		if ( remaining )
+			return 0;
+		DBGC ( iscsi, "iSCSI %p data digest mismatch\n", iscsi );
+		return -EIO_DATA_DIGEST;
+	}
+
+	/* Complete processing of the data segment */
+	return iscsi_rx_data ( iscsi, NULL, 0, 0 );
+}
+
 /**
  * Receive new data
  *
@@ -1620,6 +2128,11 @@ static int iscsi_rx_data ( struct iscsi_session *iscsi, const void *data,
  * portion as it arrives.  The data processing routine therefore
  * always has a full copy of the BHS available, even for portions of
  * the data in different packets to the BHS.
+ *
+ * Header and data digests (if in use) are calculated incrementally
+ * as each fragment is received.  The header digest is verified
+ * before the data segment is processed, and the data digest is
+ * verified before any command is completed.
  */
 static int iscsi_socket_deliver ( struct iscsi_session *iscsi,
 				  struct io_buffer *iobuf,
@@ -1630,29 +2143,63 @@ static int iscsi_socket_deliver ( struct iscsi_session *iscsi,
 	enum iscsi_rx_state next_state;
 	size_t frag_len;
 	size_t remaining;
+	size_t trailer_len;
+	int digest;
 	int rc;
 
 	while ( 1 ) {
+		trailer_len = 0;
 		switch ( iscsi->rx_state ) {
 		case ISCSI_RX_BHS:
+			/* Start of a new PDU */
+			if ( iscsi->rx_offset == 0 ) {
+				iscsi->rx_digests = iscsi_digests ( iscsi );
+				iscsi->rx_crc = ~0;
+			}
 			rx = iscsi_rx_bhs;
 			iscsi->rx_len = sizeof ( iscsi->rx_bhs );
-			next_state = ISCSI_RX_AHS;			
+			next_state = ISCSI_RX_AHS;
+			digest = ( iscsi->rx_digests &
+				   ISCSI_STATUS_HEADER_DIGEST );
 			break;
 		case ISCSI_RX_AHS:
 			rx = iscsi_rx_discard;
 			iscsi->rx_len = 4 * ISCSI_AHS_LEN ( common->lengths );
+			next_state = ISCSI_RX_HEADER_DIGEST;
+			digest = ( iscsi->rx_digests &
+				   ISCSI_STATUS_HEADER_DIGEST );
+			break;
+		case ISCSI_RX_HEADER_DIGEST:
+			rx = iscsi_rx_header_digest;
+			iscsi->rx_len = ( ( iscsi->rx_digests &
+					    ISCSI_STATUS_HEADER_DIGEST ) ?
+					  sizeof ( iscsi->rx_digest ) : 0 );
 			next_state = ISCSI_RX_DATA;
+			digest = 0;
 			break;
 		case ISCSI_RX_DATA:
 			rx = iscsi_rx_data;
 			iscsi->rx_len = ISCSI_DATA_LEN ( common->lengths );
 			next_state = ISCSI_RX_DATA_PADDING;
+			digest = iscsi_rx_data_digest_len ( iscsi );
+			/* Defer completion until data digest is verified */
+			if ( digest ) {
+				trailer_len =
+					( ISCSI_DATA_PAD_LEN ( common->lengths ) +
+					  sizeof ( iscsi->rx_digest ) );
+			}
 			break;
 		case ISCSI_RX_DATA_PADDING:
 			rx = iscsi_rx_discard;
 			iscsi->rx_len = ISCSI_DATA_PAD_LEN ( common->lengths );
+			next_state = ISCSI_RX_DATA_DIGEST;
+			digest = iscsi_rx_data_digest_len ( iscsi );
+			break;
+		case ISCSI_RX_DATA_DIGEST:
+			rx = iscsi_rx_data_digest;
+			iscsi->rx_len = iscsi_rx_data_digest_len ( iscsi );
 			next_state = ISCSI_RX_BHS;
+			digest = 0;
 			break;
 		default:
 			assert ( 0 );
@@ -1663,13 +2210,18 @@ static int iscsi_socket_deliver ( struct iscsi_session *iscsi,
 		frag_len = iscsi->rx_len - iscsi->rx_offset;
 		if ( frag_len > iob_len ( iobuf ) )
 			frag_len = iob_len ( iobuf );
-		remaining = iscsi->rx_len - iscsi->rx_offset - frag_len;
+		remaining = ( iscsi->rx_len - iscsi->rx_offset - frag_len +
+			      trailer_len );
 		if ( ( rc = rx ( iscsi, iobuf->data, frag_len,
 				 remaining ) ) != 0 ) {
 			DBGC ( iscsi, "iSCSI %p could not process received "
 			       "data: %s\n", iscsi, strerror ( rc ) );
 			goto done;
 		}
+		if ( digest ) {
+			iscsi->rx_crc = crc32c_le ( iscsi->rx_crc, iobuf->data,
+						    frag_len );
+		}
 
 		iscsi->rx_offset += frag_len;
 		iob_pull ( iobuf, frag_len );
@@ -1727,13 +2279,71 @@ static int iscsi_vredirect ( struct iscsi_session *iscsi, int type,
 	return xfer_vreopen ( &iscsi->socket, type, args );
 }
 
+/**
+ * Reinstate iSCSI connection
+ *
+ * @v iscsi		iSCSI session
+ * @v rc		Reason for failure of the old connection
+ * @ret rc		Return status code
+ *
+ * Opens a new connection within the existing session.  We use
+ * ErrorRecoveryLevel=0, so the target will terminate all tasks that
+ * were outstanding on the old connection; any such tasks are
+ * therefore reissued as new commands with fresh initiator task tags.
+ */
+static int iscsi_reinstate ( struct iscsi_session *iscsi, int rc ) {
+	struct iscsi_task *task;
+	unsigned int i;
+
+	/* Stop transmission and close old connection */
+	iscsi_tx_pause ( iscsi );
+	iscsi->tx_task = NULL;
+	iscsi_close_connection ( iscsi, rc );
+
+	/* Reissue all outstanding commands */
+	for ( i = 0 ; i < ISCSI_MAX_TASKS ; i++ ) {
+		task = &iscsi->task[i];
+		if ( ! ( task->status & ISCSI_TASK_ACTIVE ) )
+			continue;
+		task->itt = iscsi_new_itt();
+		task->status = ( ISCSI_TASK_ACTIVE | ISCSI_TASK_TX_COMMAND );
+	}
+
+	/* Open new connection */
+	return iscsi_open_connection ( iscsi );
+}
+
+/**
+ * Handle closure of iSCSI socket
+ *
+ * @v iscsi		iSCSI session
+ * @v rc		Reason for close
+ *
+ * If the connection fails after a session has been established, we
+ * attempt to reinstate the connection within the session rather than
+ * failing all outstanding commands.
+ */
+static void iscsi_socket_close ( struct iscsi_session *iscsi, int rc ) {
+
+	if ( iscsi->tsih &&
+	     ( iscsi->reinstatements < ISCSI_MAX_REINSTATEMENTS ) ) {
+		iscsi->reinstatements++;
+		DBGC ( iscsi, "iSCSI %p connection failed (%s); reinstating "
+		       "(attempt %d)\n", iscsi, strerror ( rc ),
+		       iscsi->reinstatements );
+		if ( iscsi_reinstate ( iscsi, rc ) == 0 )
+			return;
+	}
+	iscsi_close ( iscsi, rc );
+}
+
 /** iSCSI socket interface operations */
 static struct interface_operation iscsi_socket_operations[] = {
 	INTF_OP ( xfer_deliver, struct iscsi_session *, iscsi_socket_deliver ),
 	INTF_OP ( xfer_window_changed, struct iscsi_session *,
 		  iscsi_tx_resume ),
 	INTF_OP ( xfer_vredirect, struct iscsi_session *, iscsi_vredirect ),
-	INTF_OP ( intf_close, struct iscsi_session *, iscsi_close ),
+	INTF_OP ( intf_close, struct iscsi_session *, iscsi_socket_close ),
 };
 
 /** iSCSI socket interface descriptor */
@@ -1751,17 +2361,41 @@ static struct interface_descriptor iscsi_socket_desc =
  *
  * @v iscsi		iSCSI session
  * @ret len		Length of window
+ *
+ * The window is the number of further commands that may be issued,
+ * limited by both the number of free tasks and the target's command
+ * window (as advertised via MaxCmdSN).
  */
 static size_t iscsi_scsi_window ( struct iscsi_session *iscsi ) {
+	struct iscsi_task *task;
+	uint32_t cmdsn = iscsi->cmdsn;
+	int32_t cmd_window;
+	unsigned int available = 0;
+	unsigned int i;
 
-	if ( ( ( iscsi->status & ISCSI_STATUS_PHASE_MASK ) ==
-	       ISCSI_STATUS_FULL_FEATURE_PHASE ) &&
-	     ( iscsi->command == NULL ) ) {
-		/* We cannot handle concurrent commands */
-		return 1;
-	} else {
+	/* Refuse commands until login is complete */
+	if ( ( iscsi->status & ISCSI_STATUS_PHASE_MASK ) !=
+	     ISCSI_STATUS_FULL_FEATURE_PHASE )
 		return 0;
+
+	/* Count free tasks, and commands not yet assigned a CmdSN */
+	for ( i = 0 ; i < ISCSI_MAX_TASKS ; i++ ) {
+		task = &iscsi->task[i];
+		if ( ! ( task->status & ISCSI_TASK_ACTIVE ) ) {
+			available++;
+		} else if ( task->status & ISCSI_TASK_TX_COMMAND ) {
+			cmdsn++;
+		}
 	}
+
+	/* Limit to target's command window */
+	cmd_window = ( ( int32_t ) ( iscsi->maxcmdsn - cmdsn ) + 1 );
+	if ( cmd_window < 0 )
+		cmd_window = 0;
+	if ( available > ( unsigned int ) cmd_window )
+		available = cmd_window;
+
+	return available;
 }
 
 /**
@@ -1775,31 +2409,37 @@ static size_t iscsi_scsi_window ( struct iscsi_session *iscsi ) {
 static int iscsi_scsi_command ( struct iscsi_session *iscsi,
 				struct interface *parent,
 				struct scsi_cmd *command ) {
+	struct iscsi_task *task;
+	unsigned int i;
 
-	/* This iSCSI implementation cannot handle multiple concurrent
-	 * commands or commands arriving before login is complete.
+	/* Refuse commands arriving before login is complete, or
+	 * beyond the available window.
 	 */
 	if ( iscsi_scsi_window ( iscsi ) == 0 ) {
-		DBGC ( iscsi, "iSCSI %p cannot handle concurrent commands\n",
-		       iscsi );
+		DBGC ( iscsi, "iSCSI %p cannot handle further concurrent "
+		       "commands\n", iscsi );
 		return -EOPNOTSUPP;
 	}
 
-	/* Store command */
-	iscsi->command = malloc ( sizeof ( *command ) );
-	if ( ! iscsi->command )
-		return -ENOMEM;
-	memcpy ( iscsi->command, command, sizeof ( *command ) );
+	/* Find a free task */
+	for ( i = 0 ; i < ISCSI_MAX_TASKS ; i++ ) {
+		task = &iscsi->task[i];
+		if ( ! ( task->status & ISCSI_TASK_ACTIVE ) )
+			break;
+	}
+	assert ( i < ISCSI_MAX_TASKS );
 
-	/* Assign new ITT */
-	iscsi_new_itt ( iscsi );
+	/* Store command and assign new ITT */
+	memcpy ( &task->command, command, sizeof ( task->command ) );
+	task->itt = iscsi_new_itt();
+	task->status = ( ISCSI_TASK_ACTIVE | ISCSI_TASK_TX_COMMAND );
 
-	/* Start sending command */
-	iscsi_start_command ( iscsi );
+	/* Schedule transmission of command */
+	iscsi_tx_resume ( iscsi );
 
 	/* Attach to parent interface and return */
-	intf_plug_plug ( &iscsi->data, parent );
-	return iscsi->itt;
+	intf_plug_plug ( &task->data, parent );
+	return task->itt;
 }
 
 /** iSCSI SCSI command-issuing interface operations */
@@ -1817,29 +2457,30 @@ static struct interface_descriptor iscsi_control_desc =
 /**
  * Close iSCSI command
  *
- * @v iscsi		iSCSI session
+ * @v task		iSCSI task
  * @v rc		Reason for close
  */
-static void iscsi_command_close ( struct iscsi_session *iscsi, int rc ) {
+static void iscsi_command_close ( struct iscsi_task *task, int rc ) {
+	struct iscsi_session *iscsi = task->iscsi;
 
 	/* Restart interface */
-	intf_restart ( &iscsi->data, rc );
+	intf_restart ( &task->data, rc );
 
 	/* Treat unsolicited command closures mid-command as fatal,
 	 * because we have no code to handle partially-completed PDUs.
 	 */
-	if ( iscsi->command != NULL )
+	if ( task->status & ISCSI_TASK_ACTIVE )
 		iscsi_close ( iscsi, ( ( rc == 0 ) ? -ECANCELED : rc ) );
 }
 
 /** iSCSI SCSI command interface operations */
 static struct interface_operation iscsi_data_op[] = {
-	INTF_OP ( intf_close, struct iscsi_session *, iscsi_command_close ),
+	INTF_OP ( intf_close, struct iscsi_task *, iscsi_command_close ),
 };
 
 /** iSCSI SCSI command interface descriptor */
 static struct interface_descriptor iscsi_data_desc =
-	INTF_DESC ( struct iscsi_session, data, iscsi_data_op );
+	INTF_DESC ( struct iscsi_task, data, iscsi_data_op );
 
 /****************************************************************************
  *
@@ -2054,6 +2695,8 @@ static int iscsi_check_auth ( struct iscsi_session *iscsi ) {
  */
 static int iscsi_open ( struct interface *parent, struct uri *uri ) {
 	struct iscsi_session *iscsi;
+	struct iscsi_task *task;
+	unsigned int i;
 	int rc;
 
 	/* Sanity check */
@@ -2070,7 +2713,11 @@ static int iscsi_open ( struct interface *parent, struct uri *uri ) {
 	}
 	ref_init ( &iscsi->refcnt, iscsi_free );
 	intf_init ( &iscsi->control, &iscsi_control_desc, &iscsi->refcnt );
-	intf_init ( &iscsi->data, &iscsi_data_desc, &iscsi->refcnt );
+	for ( i = 0 ; i < ISCSI_MAX_TASKS ; i++ ) {
+		task = &iscsi->task[i];
+		task->iscsi = iscsi;
+		intf_init ( &task->data, &iscsi_data_desc, &iscsi->refcnt );
+	}
 	intf_init ( &iscsi->socket, &iscsi_socket_desc, &iscsi->refcnt );
 	process_init_stopped ( &iscsi->process, &iscsi_process_desc,
 			       &iscsi->refcnt );
@@ -2102,6 +2749,12 @@ static int iscsi_open ( struct interface *parent, struct uri *uri ) {
 	DBGC ( iscsi, "iSCSI %p target %s %s\n",
 	       iscsi, iscsi->target_address, iscsi->target_iqn );
 
+	/* Assign ISID.  This is retained for the lifetime of the
+	 * session, so that any subsequent login will reinstate the
+	 * existing session rather than creating a new one.
+	 */
+	iscsi->isid_iana_qual = ( random() & 0xffff );
+
 	/* Open socket */
 	if ( ( rc = iscsi_open_connection ( iscsi ) ) != 0 )
 		goto err_open_connection;
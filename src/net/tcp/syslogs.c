@@ -26,7 +26,10 @@ FILE_LICENCE ( GPL2_OR_LATER );
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
 #include <byteswap.h>
+#include <ipxe/iobuf.h>
 #include <ipxe/xfer.h>
 #include <ipxe/open.h>
 #include <ipxe/tcpip.h>
@@ -36,6 +39,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/lineconsole.h>
 #include <ipxe/tls.h>
 #include <ipxe/syslog.h>
+#include <ipxe/log.h>
 #include <config/console.h>
 
 /* Set default console usage if applicable */
@@ -46,6 +50,15 @@ FILE_LICENCE ( GPL2_OR_LATER );
 
 struct console_driver syslogs_console __console_driver;
 
+/** Encrypted syslog ring buffer data */
+static char syslogs_ring_data[SYSLOG_RING_SIZE];
+
+static int syslogs_flush ( struct log_ring *ring );
+
+/** Encrypted syslog ring buffer */
+struct log_ring syslogs_ring __log_ring =
+	LOG_RING_INIT ( syslogs_ring, syslogs_ring_data, syslogs_flush );
+
 /** The encrypted syslog server */
 static struct sockaddr_tcpip logserver = {
 	.st_family = AF_INET,
@@ -80,6 +93,9 @@ static void syslogs_window_changed ( struct interface *intf ) {
 			DBG ( "SYSLOGS console connected\n" );
 		syslogs_console.disabled = 0;
 	}
+
+	/* Resume transmitting any queued messages */
+	log_ring_kick ( &syslogs_ring );
 }
 
 /** Encrypted syslog TLS interface operations */
@@ -142,13 +158,71 @@ static struct line_console syslogs_line = {
 /** Encrypted syslog recursion marker */
 static int syslogs_entered;
 
+/**
+ * Transmit queued encrypted syslog messages
+ *
+ * @v ring		Log ring
+ * @ret rc		Return status code
+ *
+ * Messages are newline-delimited within the stream, and so as many
+ * queued records as the flow control window allows are coalesced
+ * into a single transmission.
+ */
+static int syslogs_flush ( struct log_ring *ring ) {
+	struct io_buffer *iobuf;
+	size_t window;
+	size_t len;
+	int rc;
+
+	/* Calculate length to transmit */
+	len = log_ring_fill ( ring );
+	window = xfer_window ( &syslogs );
+	if ( len > window )
+		len = window;
+	if ( len < log_ring_record_len ( ring ) )
+		return -ENOBUFS;
+
+	/* Allocate I/O buffer and remove records */
+	iobuf = xfer_alloc_iob ( &syslogs, len );
+	if ( ! iobuf )
+		return -ENOMEM;
+	iob_put ( iobuf, log_ring_get ( ring, iobuf->data, len ) );
+
+	/* Send log messages, guarding against re-entry */
+	syslogs_entered = 1;
+	if ( ( rc = xfer_deliver_iob ( &syslogs, iobuf ) ) != 0 ) {
+		DBG ( "SYSLOGS could not send log message: %s\n",
+		      strerror ( rc ) );
+	}
+	syslogs_entered = 0;
+
+	return rc;
+}
+
+/**
+ * Queue encrypted syslog message
+ *
+ * @v message		Message text
+ * @ret rc		Return status code
+ */
+static int syslogs_queue ( const char *message ) {
+	char record[ SYSLOG_BUFSIZE + SYSLOG_HEADER_LEN ];
+	size_t len;
+
+	len = snprintf ( record, sizeof ( record ), "<%d>ipxe: %s\n",
+			 SYSLOG_PRIORITY ( SYSLOG_DEFAULT_FACILITY,
+					   syslogs_severity ), message );
+	return log_ring_put ( &syslogs_ring, record, len );
+}
+
 /**
  * Print a character to encrypted syslog console
  *
  * @v character		Character to be printed
  */
 static void syslogs_putchar ( int character ) {
-	int rc;
+	char message[SYSLOG_DROPPED_LEN];
+	unsigned int dropped;
 
 	/* Ignore if we are already mid-logging */
 	if ( syslogs_entered )
@@ -161,14 +235,16 @@ static void syslogs_putchar ( int character ) {
 	/* Guard against re-entry */
 	syslogs_entered = 1;
 
-	/* Send log message */
-	if ( ( rc = xfer_printf ( &syslogs, "<%d>ipxe: %s\n",
-				  SYSLOG_PRIORITY ( SYSLOG_DEFAULT_FACILITY,
-						    syslogs_severity ),
-				  syslogs_buffer ) ) != 0 ) {
-		DBG ( "SYSLOGS could not send log message: %s\n",
-		      strerror ( rc ) );
+	/* Report any dropped messages, then queue log message */
+	dropped = syslogs_ring.dropped;
+	if ( dropped ) {
+		snprintf ( message, sizeof ( message ), "[%d messages dropped]",
+			   dropped );
+		syslogs_ring.dropped = 0;
+		if ( syslogs_queue ( message ) != 0 )
+			syslogs_ring.dropped = dropped;
 	}
+	syslogs_queue ( syslogs_buffer );
 
 	/* Clear re-entry flag */
 	syslogs_entered = 0;
@@ -237,7 +313,8 @@ static int apply_syslogs_settings ( void ) {
 	}
 
 	/* Add TLS filter */
-	if ( ( rc = add_tls ( &syslogs, server, &socket ) ) != 0 ) {
+	if ( ( rc = add_tls ( &syslogs, server, ntohs ( logserver.st_port ),
+			      &socket ) ) != 0 ) {
 		DBG ( "SYSLOGS cannot create TLS filter: %s\n",
 		      strerror ( rc ) );
 		goto err_add_tls;
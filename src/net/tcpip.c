@@ -4,7 +4,9 @@
 #include <byteswap.h>
 #include <ipxe/iobuf.h>
 #include <ipxe/tables.h>
+#include <ipxe/netdevice.h>
 #include <ipxe/tcpip.h>
+#include <ipxe/profstat.h>
 
 /** @file
  *
@@ -16,6 +18,35 @@
 
 FILE_LICENCE ( GPL2_OR_LATER );
 
+/** Transport-layer protocols, indexed by protocol number */
+static struct tcpip_protocol *tcpip_protocols[256];
+
+/** Transport-layer protocol lookup table has been constructed */
+static int tcpip_protocols_indexed;
+
+/**
+ * Identify transport-layer protocol
+ *
+ * @v tcpip_proto	Transport-layer protocol number
+ * @ret tcpip		Transport-layer protocol, or NULL
+ */
+static struct tcpip_protocol * tcpip_protocol_find ( uint8_t tcpip_proto ) {
+	struct tcpip_protocol *tcpip;
+
+	/* Construct lookup table on first use.  Where two table
+	 * entries claim the same protocol number, the first entry
+	 * takes precedence (as with a linear search of the linker
+	 * table).
+	 */
+	if ( ! tcpip_protocols_indexed ) {
+		for_each_table_entry_reverse ( tcpip, TCPIP_PROTOCOLS )
+			tcpip_protocols[tcpip->tcpip_proto] = tcpip;
+		tcpip_protocols_indexed = 1;
+	}
+
+	return tcpip_protocols[tcpip_proto];
+}
+
 /** Process a received TCP/IP packet
  *
  * @v iobuf		I/O buffer
@@ -31,18 +62,24 @@ FILE_LICENCE ( GPL2_OR_LATER );
  * address family and the network-layer addresses, but leave the ports
  * and the rest of the structures as zero).
  */
-int tcpip_rx ( struct io_buffer *iobuf, uint8_t tcpip_proto, 
-	       struct sockaddr_tcpip *st_src,
-	       struct sockaddr_tcpip *st_dest,
-	       uint16_t pshdr_csum ) {
+int __hot tcpip_rx ( struct io_buffer *iobuf, uint8_t tcpip_proto, 
+		     struct sockaddr_tcpip *st_src,
+		     struct sockaddr_tcpip *st_dest,
+		     uint16_t pshdr_csum ) {
 	struct tcpip_protocol *tcpip;
+	union profiler profiler;
+	size_t len;
+	int rc;
 
 	/* Hand off packet to the appropriate transport-layer protocol */
-	for_each_table_entry ( tcpip, TCPIP_PROTOCOLS ) {
-		if ( tcpip->tcpip_proto == tcpip_proto ) {
-			DBG ( "TCP/IP received %s packet\n", tcpip->name );
-			return tcpip->rx ( iobuf, st_src, st_dest, pshdr_csum );
-		}
+	tcpip = tcpip_protocol_find ( tcpip_proto );
+	if ( tcpip ) {
+		DBG ( "TCP/IP received %s packet\n", tcpip->name );
+		len = iob_len ( iobuf );
+		profstat_start ( &profiler );
+		rc = tcpip->rx ( iobuf, st_src, st_dest, pshdr_csum );
+		profstat_stop ( &profiler, "tcpip", tcpip, tcpip->name, len );
+		return rc;
 	}
 
 	DBG ( "Unrecognised TCP/IP protocol %d\n", tcpip_proto );
@@ -50,6 +87,36 @@ int tcpip_rx ( struct io_buffer *iobuf, uint8_t tcpip_proto,
 	return -EPROTONOSUPPORT;
 }
 
+/**
+ * Check whether received TCP/IP packets may be merged
+ *
+ * @v iobuf		I/O buffer containing first packet
+ * @v next		I/O buffer containing following packet
+ * @v tcpip_proto	Transport-layer protocol number
+ * @v pshdr_csum	Pseudo-header checksum for first packet
+ * @v next_pshdr_csum	Pseudo-header checksum for following packet
+ * @ret len		Length of headers in following packet, or rc
+ *
+ * Both I/O buffers should contain transport-layer segments, as for
+ * tcpip_rx().  Neither I/O buffer is consumed.
+ */
+int tcpip_merge ( struct io_buffer *iobuf, struct io_buffer *next,
+		  uint8_t tcpip_proto, uint16_t pshdr_csum,
+		  uint16_t next_pshdr_csum ) {
+	struct tcpip_protocol *tcpip;
+
+	/* Hand off to the appropriate transport-layer protocol, if
+	 * it supports merging.
+	 */
+	tcpip = tcpip_protocol_find ( tcpip_proto );
+	if ( tcpip && tcpip->merge ) {
+		return tcpip->merge ( iobuf, next, pshdr_csum,
+				      next_pshdr_csum );
+	}
+
+	return -ENOTSUP;
+}
+
 /** Transmit a TCP/IP packet
  *
  * @v iobuf		I/O buffer
@@ -79,6 +146,102 @@ int tcpip_tx ( struct io_buffer *iobuf, struct tcpip_protocol *tcpip_protocol,
 	return -EAFNOSUPPORT;
 }
 
+/**
+ * Determine required transmit headroom
+ *
+ * @v st_dest		Destination address
+ * @ret headroom	Headroom required for network- and link-layer headers
+ *
+ * Returns zero if the headroom cannot be determined (e.g. because
+ * there is currently no route to the destination).  Callers should
+ * reserve at least @c MAX_LL_NET_HEADER_LEN in this case.
+ */
+size_t tcpip_headroom ( struct sockaddr_tcpip *st_dest ) {
+	struct tcpip_net_protocol *tcpip_net;
+	struct net_device *netdev;
+
+	for_each_table_entry ( tcpip_net, TCPIP_NET_PROTOCOLS ) {
+		if ( tcpip_net->sa_family != st_dest->st_family )
+			continue;
+		if ( ! tcpip_net->netdev )
+			return 0;
+		netdev = tcpip_net->netdev ( st_dest );
+		if ( ! netdev )
+			return 0;
+		return ( tcpip_net->header_len + netdev_headroom ( netdev ) );
+	}
+
+	return 0;
+}
+
+/**
+ * Determine maximum transmission unit
+ *
+ * @v st_dest		Destination address
+ * @ret mtu		Maximum transport-layer payload length, or zero
+ *
+ * Returns zero if the MTU cannot be determined (e.g. because there
+ * is currently no route to the destination).  The MTU is limited by
+ * any known path MTU to the destination.
+ */
+size_t tcpip_mtu ( struct sockaddr_tcpip *st_dest ) {
+	struct tcpip_net_protocol *tcpip_net;
+	struct net_device *netdev;
+	size_t mtu;
+	size_t pmtu;
+
+	for_each_table_entry ( tcpip_net, TCPIP_NET_PROTOCOLS ) {
+		if ( tcpip_net->sa_family != st_dest->st_family )
+			continue;
+		if ( ! tcpip_net->netdev )
+			return 0;
+		netdev = tcpip_net->netdev ( st_dest );
+		if ( ! netdev )
+			return 0;
+		mtu = netdev->mtu;
+		if ( tcpip_net->pmtu &&
+		     ( ( pmtu = tcpip_net->pmtu ( st_dest ) ) != 0 ) &&
+		     ( pmtu < mtu ) ) {
+			mtu = pmtu;
+		}
+		if ( mtu <= tcpip_net->header_len )
+			return 0;
+		return ( mtu - tcpip_net->header_len );
+	}
+
+	return 0;
+}
+
+/**
+ * Process path MTU reduction
+ *
+ * @v tcpip_proto	Transport-layer protocol number
+ * @v st_peer		Peer address
+ * @v data		Leading part of the oversized packet's header
+ * @v len		Length of leading part of header
+ * @v mtu		New maximum transport-layer payload length
+ * @ret rc		Return status code
+ *
+ * This function is called by the network layer upon receiving a
+ * report that a packet was too large to be forwarded.  A successful
+ * return indicates that the report matched an existing connection,
+ * and that the network layer may record the new path MTU.
+ */
+int tcpip_pmtu ( uint8_t tcpip_proto, struct sockaddr_tcpip *st_peer,
+		 const void *data, size_t len, size_t mtu ) {
+	struct tcpip_protocol *tcpip;
+
+	/* Identify transport-layer protocol */
+	tcpip = tcpip_protocol_find ( tcpip_proto );
+	if ( ( ! tcpip ) || ( ! tcpip->pmtu ) ) {
+		DBG ( "Ignoring path MTU for TCP/IP protocol %d\n",
+		      tcpip_proto );
+		return -ENOTSUP;
+	}
+
+	return tcpip->pmtu ( st_peer, data, len, mtu );
+}
+
 /**
  * Calculate continued TCP/IP checkum
  *
@@ -96,9 +259,12 @@ int tcpip_tx ( struct io_buffer *iobuf, struct tcpip_protocol *tcpip_protocol,
  * byte-swap either the input partial checksum, the output checksum,
  * or both.  Deciding which to swap is left as an exercise for the
  * interested reader.
+ *
+ * This is the generic implementation; architectures may provide an
+ * optimised tcpip_continue_chksum() via <bits/tcpip.h>.
  */
-uint16_t tcpip_continue_chksum ( uint16_t partial, const void *data,
-				 size_t len ) {
+uint16_t __hot generic_tcpip_continue_chksum ( uint16_t partial,
+					       const void *data, size_t len ) {
 	unsigned int cksum = ( ( ~partial ) & 0xffff );
 	unsigned int value;
 	unsigned int i;
@@ -133,3 +299,32 @@ uint16_t tcpip_continue_chksum ( uint16_t partial, const void *data,
 uint16_t tcpip_chksum ( const void *data, size_t len ) {
 	return tcpip_continue_chksum ( TCPIP_EMPTY_CSUM, data, len );
 }
+
+/**
+ * Calculate TCP/IP checkum over a multi-fragment I/O buffer
+ *
+ * @v iobuf		I/O buffer
+ * @ret cksum		Checksum, in network byte order
+ *
+ * Calculates a TCP/IP-style 16-bit checksum over the data within all
+ * fragments of the I/O buffer.  Fragments need not have even
+ * lengths: a fragment starting at an odd offset is summed as though
+ * byte-swapped, which is equivalent under ones' complement addition.
+ */
+uint16_t tcpip_chksum_iob ( struct io_buffer *iobuf ) {
+	uint16_t cksum = TCPIP_EMPTY_CSUM;
+	size_t offset = 0;
+
+	for ( ; iobuf ; iobuf = iobuf->frag ) {
+		if ( offset & 1 ) {
+			cksum = bswap_16 ( tcpip_continue_chksum (
+				bswap_16 ( cksum ), iobuf->data,
+				iob_len ( iobuf ) ) );
+		} else {
+			cksum = tcpip_continue_chksum ( cksum, iobuf->data,
+							iob_len ( iobuf ) );
+		}
+		offset += iob_len ( iobuf );
+	}
+	return cksum;
+}
@@ -37,6 +37,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/sha256.h>
 #include <ipxe/aes.h>
 #include <ipxe/rsa.h>
+#include <ipxe/malloc.h>
 #include <ipxe/iobuf.h>
 #include <ipxe/xfer.h>
 #include <ipxe/open.h>
@@ -44,6 +45,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/clientcert.h>
 #include <ipxe/rbg.h>
 #include <ipxe/tls.h>
+#include <ipxe/timeline.h>
 
 /* Disambiguate the various error causes */
 #define EACCES_INCOMPLETE \
@@ -54,6 +56,10 @@ FILE_LICENCE ( GPL2_OR_LATER );
 	__einfo_error ( EINFO_EACCES_WRONG_NAME )
 #define EINFO_EACCES_WRONG_NAME \
 	__einfo_uniqify ( EINFO_EACCES, 0x02, "Incorrect server name" )
+#define EACCES_AUTH \
+	__einfo_error ( EINFO_EACCES_AUTH )
+#define EINFO_EACCES_AUTH \
+	__einfo_uniqify ( EINFO_EACCES, 0x03, "Record authentication failed" )
 
 static int tls_send_plaintext ( struct tls_session *tls, unsigned int type,
 				const void *data, size_t len );
@@ -183,7 +189,9 @@ static void free_tls ( struct refcnt *refcnt ) {
 	tls_clear_cipher ( tls, &tls->tx_cipherspec_pending );
 	tls_clear_cipher ( tls, &tls->rx_cipherspec );
 	tls_clear_cipher ( tls, &tls->rx_cipherspec_pending );
-	free ( tls->rx_data );
+	free_iob ( tls->rx_data );
+	free ( tls->ticket );
+	ref_put ( &tls->resume->refcnt );
 
 	/* Free TLS structure itself */
 	free ( tls );	
@@ -197,6 +205,10 @@ static void free_tls ( struct refcnt *refcnt ) {
  */
 static void tls_close ( struct tls_session *tls, int rc ) {
 
+	/* Record end of any incomplete handshake */
+	if ( ! ( tls->tx_ready || ( tls->tx_pending & TLS_TX_CLIENT_HELLO ) ) )
+		timeline_end ( "net", "tls handshake", tls, "aborted" );
+
 	/* Remove process */
 	process_del ( &tls->process );
 	
@@ -393,6 +405,200 @@ static void tls_prf ( struct tls_session *tls, void *secret, size_t secret_len,
 	tls_prf ( (tls), (secret), (secret_len), (out), (out_len),	   \
 		  label, ( sizeof ( label ) - 1 ), __VA_ARGS__, NULL )
 
+/******************************************************************************
+ *
+ * Session cache
+ *
+ ******************************************************************************
+ */
+
+/** List of cached sessions, most recently used first */
+static LIST_HEAD ( tls_cached_sessions );
+
+/** Number of cached sessions */
+static unsigned int tls_num_cached_sessions;
+
+struct cache_discarder tls_cache_discarder __cache_discarder ( CACHE_NORMAL );
+
+/**
+ * Free cached session
+ *
+ * @v refcnt		Reference counter
+ */
+static void tls_free_session ( struct refcnt *refcnt ) {
+	struct tls_cached_session *cached =
+		container_of ( refcnt, struct tls_cached_session, refcnt );
+	size_t len = ( sizeof ( *cached ) + strlen ( cached->name ) +
+		       1 /* NUL */ + cached->ticket_len );
+
+	/* Wipe master secret (and everything else) before freeing */
+	memset ( cached, 0, len );
+	free ( cached );
+}
+
+/**
+ * Remove session from cache
+ *
+ * @v cached		Cached session
+ */
+static void tls_uncache_session ( struct tls_cached_session *cached ) {
+
+	DBGC ( cached, "TLS cached session %p for \"%s:%u\" removed\n",
+	       cached, cached->name, cached->port );
+	list_del ( &cached->list );
+	INIT_LIST_HEAD ( &cached->list );
+	tls_num_cached_sessions--;
+	ref_put ( &cached->refcnt );
+}
+
+/**
+ * Find cached session
+ *
+ * @v name		Server name
+ * @v port		Server port
+ * @ret cached		Cached session, or NULL if not found
+ */
+static struct tls_cached_session * tls_find_session ( const char *name,
+						      unsigned int port ) {
+	struct tls_cached_session *cached;
+
+	list_for_each_entry ( cached, &tls_cached_sessions, list ) {
+		if ( ( cached->port == port ) &&
+		     ( strcmp ( cached->name, name ) == 0 ) ) {
+			/* Move to head of list */
+			list_del ( &cached->list );
+			list_add ( &cached->list, &tls_cached_sessions );
+			return cached;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Discard some cached sessions
+ *
+ * @ret discarded	Number of cached items discarded
+ */
+static unsigned int tls_discard ( void ) {
+	struct tls_cached_session *cached;
+
+	/* Drop least recently used session, if any */
+	list_for_each_entry_reverse ( cached, &tls_cached_sessions, list ) {
+		tls_uncache_session ( cached );
+		return 1;
+	}
+
+	return 0;
+}
+
+/**
+ * Add established session to cache
+ *
+ * @v tls		TLS session
+ */
+static void tls_cache_session ( struct tls_session *tls ) {
+	struct tls_cached_session *cached;
+	struct tls_cached_session *existing;
+	size_t name_len = ( strlen ( tls->name ) + 1 /* NUL */ );
+	char *name;
+
+	/* Nothing to do unless the server has provided some means of
+	 * resuming the session.
+	 */
+	if ( ! ( tls->session_id_len || tls->ticket ) )
+		return;
+
+	/* If we resumed a session and were not issued a new ticket,
+	 * then the cached session remains valid as it stands.
+	 */
+	if ( tls->resumed && ( tls->ticket == NULL ) )
+		return;
+
+	/* Allocate and populate cached session */
+	cached = zalloc ( sizeof ( *cached ) + name_len + tls->ticket_len );
+	if ( ! cached )
+		return;
+	ref_init ( &cached->refcnt, tls_free_session );
+	name = ( ( ( void * ) cached ) + sizeof ( *cached ) );
+	memcpy ( name, tls->name, name_len );
+	cached->name = name;
+	cached->port = tls->port;
+	cached->version = tls->version;
+	cached->cipher_suite = tls->rx_cipherspec.suite->code;
+	memcpy ( cached->master_secret, tls->master_secret,
+		 sizeof ( cached->master_secret ) );
+	memcpy ( cached->id, tls->session_id, tls->session_id_len );
+	cached->id_len = tls->session_id_len;
+	if ( tls->ticket ) {
+		cached->ticket = ( name + name_len );
+		memcpy ( cached->ticket, tls->ticket, tls->ticket_len );
+		cached->ticket_len = tls->ticket_len;
+	}
+
+	/* Replace any existing cached session for this server */
+	if ( ( existing = tls_find_session ( tls->name, tls->port ) ) != NULL )
+		tls_uncache_session ( existing );
+
+	/* Discard least recently used session if cache is full */
+	if ( tls_num_cached_sessions >= TLS_MAX_CACHED_SESSIONS )
+		tls_discard();
+
+	/* Add to cache */
+	list_add ( &cached->list, &tls_cached_sessions );
+	tls_num_cached_sessions++;
+	DBGC ( tls, "TLS %p cached session %p for \"%s:%u\" (ID %zd bytes, "
+	       "ticket %zd bytes)\n", tls, cached, cached->name, cached->port,
+	       cached->id_len, cached->ticket_len );
+}
+
+/**
+ * Prepare to resume cached session (if any)
+ *
+ * @v tls		TLS session
+ * @ret rc		Return status code
+ */
+static int tls_resume_session ( struct tls_session *tls ) {
+	struct tls_cached_session *cached;
+	int rc;
+
+	/* Find cached session, if any */
+	cached = tls_find_session ( tls->name, tls->port );
+	if ( ! cached ) {
+		cache_miss ( &tls_cache_discarder );
+		return 0;
+	}
+	cache_hit ( &tls_cache_discarder );
+	DBGC ( tls, "TLS %p offering cached session %p\n", tls, cached );
+
+	/* Offer cached session ID.  If resuming via a session ticket
+	 * without a session ID, then generate a session ID so that
+	 * we can tell whether or not the server accepted the ticket
+	 * (see RFC 5077 section 3.4).
+	 */
+	if ( cached->id_len ) {
+		memcpy ( tls->session_id, cached->id, cached->id_len );
+		tls->session_id_len = cached->id_len;
+	} else {
+		tls->session_id_len = sizeof ( tls->session_id );
+		if ( ( rc = tls_generate_random ( tls, tls->session_id,
+						  tls->session_id_len ) ) != 0 )
+			return rc;
+	}
+
+	/* Record cached session */
+	ref_get ( &cached->refcnt );
+	tls->resume = cached;
+
+	return 0;
+}
+
+/** TLS session cache discarder */
+struct cache_discarder tls_cache_discarder
+	__cache_discarder ( CACHE_NORMAL ) = {
+	.name = "tls",
+	.discard = tls_discard,
+};
+
 /******************************************************************************
  *
  * Secret management
@@ -428,6 +634,28 @@ static void tls_generate_master_secret ( struct tls_session *tls ) {
 	DBGC_HD ( tls, &tls->master_secret, sizeof ( tls->master_secret ) );
 }
 
+/**
+ * Set fixed initialisation vector
+ *
+ * @v tls		TLS session
+ * @v cipherspec	TLS cipher specification
+ * @v iv		Fixed initialisation vector from key block
+ *
+ * For authenticated ciphers, the fixed initialisation vector forms
+ * part of a nonce which is constructed separately for each record.
+ * For other ciphers, it is the initialisation vector for the whole
+ * session.
+ */
+static void tls_set_fixed_iv ( struct tls_session *tls __unused,
+			       struct tls_cipherspec *cipherspec,
+			       const void *iv ) {
+	struct tls_cipher_suite *suite = cipherspec->suite;
+
+	memcpy ( cipherspec->fixed_iv, iv, suite->fixed_iv_len );
+	if ( ! is_auth_cipher ( suite->cipher ) )
+		cipher_setiv ( suite->cipher, cipherspec->cipher_ctx, iv );
+}
+
 /**
  * Generate key material
  *
@@ -438,9 +666,9 @@ static void tls_generate_master_secret ( struct tls_session *tls ) {
 static int tls_generate_keys ( struct tls_session *tls ) {
 	struct tls_cipherspec *tx_cipherspec = &tls->tx_cipherspec_pending;
 	struct tls_cipherspec *rx_cipherspec = &tls->rx_cipherspec_pending;
-	size_t hash_size = tx_cipherspec->suite->digest->digestsize;
+	size_t hash_size = tx_cipherspec->suite->mac_len;
 	size_t key_size = tx_cipherspec->suite->key_len;
-	size_t iv_size = tx_cipherspec->suite->cipher->blocksize;
+	size_t iv_size = tx_cipherspec->suite->fixed_iv_len;
 	size_t total = ( 2 * ( hash_size + key_size + iv_size ) );
 	uint8_t key_block[total];
 	uint8_t *key;
@@ -492,15 +720,13 @@ static int tls_generate_keys ( struct tls_session *tls ) {
 	key += key_size;
 
 	/* TX initialisation vector */
-	cipher_setiv ( tx_cipherspec->suite->cipher,
-		       tx_cipherspec->cipher_ctx, key );
+	tls_set_fixed_iv ( tls, tx_cipherspec, key );
 	DBGC ( tls, "TLS %p TX IV:\n", tls );
 	DBGC_HD ( tls, key, iv_size );
 	key += iv_size;
 
 	/* RX initialisation vector */
-	cipher_setiv ( rx_cipherspec->suite->cipher,
-		       rx_cipherspec->cipher_ctx, key );
+	tls_set_fixed_iv ( tls, rx_cipherspec, key );
 	DBGC ( tls, "TLS %p RX IV:\n", tls );
 	DBGC_HD ( tls, key, iv_size );
 	key += iv_size;
@@ -526,9 +752,20 @@ struct tls_cipher_suite tls_cipher_suite_null = {
 
 /** Supported cipher suites, in order of preference */
 struct tls_cipher_suite tls_cipher_suites[] = {
+	{
+		.code = htons ( TLS_RSA_WITH_AES_128_GCM_SHA256 ),
+		.key_len = ( 128 / 8 ),
+		.fixed_iv_len = 4,
+		.record_iv_len = 8,
+		.pubkey = &rsa_algorithm,
+		.cipher = &aes_gcm_algorithm,
+		.digest = &sha256_algorithm,
+	},
 	{
 		.code = htons ( TLS_RSA_WITH_AES_256_CBC_SHA256 ),
 		.key_len = ( 256 / 8 ),
+		.mac_len = SHA256_DIGEST_SIZE,
+		.fixed_iv_len = AES_BLOCKSIZE,
 		.pubkey = &rsa_algorithm,
 		.cipher = &aes_cbc_algorithm,
 		.digest = &sha256_algorithm,
@@ -536,6 +773,8 @@ struct tls_cipher_suite tls_cipher_suites[] = {
 	{
 		.code = htons ( TLS_RSA_WITH_AES_128_CBC_SHA256 ),
 		.key_len = ( 128 / 8 ),
+		.mac_len = SHA256_DIGEST_SIZE,
+		.fixed_iv_len = AES_BLOCKSIZE,
 		.pubkey = &rsa_algorithm,
 		.cipher = &aes_cbc_algorithm,
 		.digest = &sha256_algorithm,
@@ -543,6 +782,8 @@ struct tls_cipher_suite tls_cipher_suites[] = {
 	{
 		.code = htons ( TLS_RSA_WITH_AES_256_CBC_SHA ),
 		.key_len = ( 256 / 8 ),
+		.mac_len = SHA1_DIGEST_SIZE,
+		.fixed_iv_len = AES_BLOCKSIZE,
 		.pubkey = &rsa_algorithm,
 		.cipher = &aes_cbc_algorithm,
 		.digest = &sha1_algorithm,
@@ -550,6 +791,8 @@ struct tls_cipher_suite tls_cipher_suites[] = {
 	{
 		.code = htons ( TLS_RSA_WITH_AES_128_CBC_SHA ),
 		.key_len = ( 128 / 8 ),
+		.mac_len = SHA1_DIGEST_SIZE,
+		.fixed_iv_len = AES_BLOCKSIZE,
 		.pubkey = &rsa_algorithm,
 		.cipher = &aes_cbc_algorithm,
 		.digest = &sha1_algorithm,
@@ -611,7 +854,6 @@ static int tls_set_cipher ( struct tls_session *tls,
 			    struct tls_cipher_suite *suite ) {
 	struct pubkey_algorithm *pubkey = suite->pubkey;
 	struct cipher_algorithm *cipher = suite->cipher;
-	struct digest_algorithm *digest = suite->digest;
 	size_t total;
 	void *dynamic;
 
@@ -619,7 +861,8 @@ static int tls_set_cipher ( struct tls_session *tls,
 	tls_clear_cipher ( tls, cipherspec );
 	
 	/* Allocate dynamic storage */
-	total = ( pubkey->ctxsize + 2 * cipher->ctxsize + digest->digestsize );
+	total = ( pubkey->ctxsize + cipher->ctxsize + suite->mac_len +
+		  suite->fixed_iv_len );
 	dynamic = zalloc ( total );
 	if ( ! dynamic ) {
 		DBGC ( tls, "TLS %p could not allocate %zd bytes for crypto "
@@ -631,8 +874,8 @@ static int tls_set_cipher ( struct tls_session *tls,
 	cipherspec->dynamic = dynamic;
 	cipherspec->pubkey_ctx = dynamic;	dynamic += pubkey->ctxsize;
 	cipherspec->cipher_ctx = dynamic;	dynamic += cipher->ctxsize;
-	cipherspec->cipher_next_ctx = dynamic;	dynamic += cipher->ctxsize;
-	cipherspec->mac_secret = dynamic;	dynamic += digest->digestsize;
+	cipherspec->mac_secret = dynamic;	dynamic += suite->mac_len;
+	cipherspec->fixed_iv = dynamic;		dynamic += suite->fixed_iv_len;
 	assert ( ( cipherspec->dynamic + total ) == dynamic );
 
 	/* Store parameters */
@@ -661,6 +904,15 @@ static int tls_select_cipher ( struct tls_session *tls,
 		return -ENOTSUP;
 	}
 
+	/* Authenticated encryption is defined only for TLSv1.2 */
+	if ( is_auth_cipher ( suite->cipher ) &&
+	     ( tls->version < TLS_VERSION_TLS_1_2 ) ) {
+		DBGC ( tls, "TLS %p cannot use cipher %04x with protocol "
+		       "version %d.%d\n", tls, ntohs ( cipher_suite ),
+		       ( tls->version >> 8 ), ( tls->version & 0xff ) );
+		return -ENOTSUP;
+	}
+
 	/* Set ciphers */
 	if ( ( rc = tls_set_cipher ( tls, &tls->tx_cipherspec_pending,
 				     suite ) ) != 0 )
@@ -833,11 +1085,16 @@ static int tls_send_handshake ( struct tls_session *tls,
  * @ret rc		Return status code
  */
 static int tls_send_client_hello ( struct tls_session *tls ) {
+	struct tls_cached_session *resume = tls->resume;
+	size_t ticket_len = ( resume ? resume->ticket_len : 0 );
 	struct {
 		uint32_t type_length;
 		uint16_t version;
 		uint8_t random[32];
 		uint8_t session_id_len;
+		uint8_t session_id[tls->session_id_len];
+	} __attribute__ (( packed )) hello;
+	struct {
 		uint16_t cipher_suite_len;
 		uint16_t cipher_suites[TLS_NUM_CIPHER_SUITES];
 		uint8_t compression_methods_len;
@@ -854,33 +1111,57 @@ static int tls_send_client_hello ( struct tls_session *tls ) {
 					uint8_t name[ strlen ( tls->name ) ];
 				} __attribute__ (( packed )) list[1];
 			} __attribute__ (( packed )) server_name;
+			uint16_t session_ticket_type;
+			uint16_t session_ticket_len;
 		} __attribute__ (( packed )) extensions;
-	} __attribute__ (( packed )) hello;
+	} __attribute__ (( packed )) body;
+	uint8_t data[ sizeof ( hello ) + sizeof ( body ) + ticket_len ];
 	unsigned int i;
 
+	/* Construct record header, up to and including the session
+	 * ID.  The remainder of the record (including the
+	 * variable-length session ticket) follows immediately after.
+	 */
 	memset ( &hello, 0, sizeof ( hello ) );
 	hello.type_length = ( cpu_to_le32 ( TLS_CLIENT_HELLO ) |
-			      htonl ( sizeof ( hello ) -
+			      htonl ( sizeof ( data ) -
 				      sizeof ( hello.type_length ) ) );
 	hello.version = htons ( tls->version );
 	memcpy ( &hello.random, &tls->client_random, sizeof ( hello.random ) );
-	hello.cipher_suite_len = htons ( sizeof ( hello.cipher_suites ) );
+	hello.session_id_len = sizeof ( hello.session_id );
+	memcpy ( hello.session_id, tls->session_id,
+		 sizeof ( hello.session_id ) );
+
+	/* Construct record body, excluding the session ticket */
+	memset ( &body, 0, sizeof ( body ) );
+	body.cipher_suite_len = htons ( sizeof ( body.cipher_suites ) );
 	for ( i = 0 ; i < TLS_NUM_CIPHER_SUITES ; i++ )
-		hello.cipher_suites[i] = tls_cipher_suites[i].code;
-	hello.compression_methods_len = sizeof ( hello.compression_methods );
-	hello.extensions_len = htons ( sizeof ( hello.extensions ) );
-	hello.extensions.server_name_type = htons ( TLS_SERVER_NAME );
-	hello.extensions.server_name_len
-		= htons ( sizeof ( hello.extensions.server_name ) );
-	hello.extensions.server_name.len
-		= htons ( sizeof ( hello.extensions.server_name.list ) );
-	hello.extensions.server_name.list[0].type = TLS_SERVER_NAME_HOST_NAME;
-	hello.extensions.server_name.list[0].len
-		= htons ( sizeof ( hello.extensions.server_name.list[0].name ));
-	memcpy ( hello.extensions.server_name.list[0].name, tls->name,
-		 sizeof ( hello.extensions.server_name.list[0].name ) );
+		body.cipher_suites[i] = tls_cipher_suites[i].code;
+	body.compression_methods_len = sizeof ( body.compression_methods );
+	body.extensions_len = htons ( sizeof ( body.extensions ) +
+				      ticket_len );
+	body.extensions.server_name_type = htons ( TLS_SERVER_NAME );
+	body.extensions.server_name_len
+		= htons ( sizeof ( body.extensions.server_name ) );
+	body.extensions.server_name.len
+		= htons ( sizeof ( body.extensions.server_name.list ) );
+	body.extensions.server_name.list[0].type = TLS_SERVER_NAME_HOST_NAME;
+	body.extensions.server_name.list[0].len
+		= htons ( sizeof ( body.extensions.server_name.list[0].name ));
+	memcpy ( body.extensions.server_name.list[0].name, tls->name,
+		 sizeof ( body.extensions.server_name.list[0].name ) );
+	body.extensions.session_ticket_type = htons ( TLS_SESSION_TICKET );
+	body.extensions.session_ticket_len = htons ( ticket_len );
+
+	/* Construct record */
+	memcpy ( data, &hello, sizeof ( hello ) );
+	memcpy ( ( data + sizeof ( hello ) ), &body, sizeof ( body ) );
+	if ( ticket_len ) {
+		memcpy ( ( data + sizeof ( hello ) + sizeof ( body ) ),
+			 resume->ticket, ticket_len );
+	}
 
-	return tls_send_handshake ( tls, &hello, sizeof ( hello ) );
+	return tls_send_handshake ( tls, data, sizeof ( data ) );
 }
 
 /**
@@ -1216,6 +1497,7 @@ static int tls_new_server_hello ( struct tls_session *tls,
 		char next[0];
 	} __attribute__ (( packed )) *hello_b = ( void * ) &hello_a->next;
 	const void *end = hello_b->next;
+	struct tls_cached_session *resume = tls->resume;
 	uint16_t version;
 	int rc;
 
@@ -1259,14 +1541,107 @@ static int tls_new_server_hello ( struct tls_session *tls,
 	if ( ( rc = tls_select_cipher ( tls, hello_b->cipher_suite ) ) != 0 )
 		return rc;
 
-	/* Generate secrets */
-	tls_generate_master_secret ( tls );
+	/* Check for session resumption */
+	if ( hello_a->session_id_len > sizeof ( tls->session_id ) ) {
+		DBGC ( tls, "TLS %p received overlength session ID\n", tls );
+		DBGC_HD ( tls, data, len );
+		return -EINVAL;
+	}
+	if ( resume && hello_a->session_id_len &&
+	     ( hello_a->session_id_len == tls->session_id_len ) &&
+	     ( memcmp ( hello_b->session_id, tls->session_id,
+			tls->session_id_len ) == 0 ) ) {
+
+		/* Server has agreed to resume the cached session */
+		if ( ( version != resume->version ) ||
+		     ( hello_b->cipher_suite != resume->cipher_suite ) ) {
+			DBGC ( tls, "TLS %p server changed parameters of "
+			       "resumed session\n", tls );
+			return -EPROTO;
+		}
+		DBGC ( tls, "TLS %p resuming cached session %p\n",
+		       tls, resume );
+		memcpy ( &tls->master_secret, &resume->master_secret,
+			 sizeof ( tls->master_secret ) );
+		tls->resumed = 1;
+
+	} else {
+
+		/* Server has rejected any cached session */
+		if ( resume ) {
+			DBGC ( tls, "TLS %p server rejected cached session "
+			       "%p\n", tls, resume );
+			if ( ! list_empty ( &resume->list ) )
+				tls_uncache_session ( resume );
+		}
+
+		/* Record session ID for future resumption */
+		memcpy ( tls->session_id, hello_b->session_id,
+			 hello_a->session_id_len );
+		tls->session_id_len = hello_a->session_id_len;
+
+		/* Generate master secret */
+		tls_generate_master_secret ( tls );
+	}
+
+	/* Generate keys */
 	if ( ( rc = tls_generate_keys ( tls ) ) != 0 )
 		return rc;
 
 	return 0;
 }
 
+/**
+ * Receive new New Session Ticket handshake record
+ *
+ * @v tls		TLS session
+ * @v data		Plaintext handshake record
+ * @v len		Length of plaintext handshake record
+ * @ret rc		Return status code
+ */
+static int tls_new_session_ticket ( struct tls_session *tls,
+				    const void *data, size_t len ) {
+	const struct {
+		uint32_t lifetime_hint;
+		uint16_t ticket_len;
+		char next[0];
+	} __attribute__ (( packed )) *new_ticket_a = data;
+	const struct {
+		uint8_t ticket[ ntohs ( new_ticket_a->ticket_len ) ];
+		char next[0];
+	} __attribute__ (( packed )) *new_ticket_b =
+		( void * ) &new_ticket_a->next;
+	const void *end = new_ticket_b->next;
+
+	/* Sanity check */
+	if ( ( len < sizeof ( *new_ticket_a ) ) || ( end != ( data + len ) ) ){
+		DBGC ( tls, "TLS %p received invalid New Session Ticket\n",
+		       tls );
+		DBGC_HD ( tls, data, len );
+		return -EINVAL;
+	}
+
+	/* An empty ticket indicates that no ticket will be issued */
+	free ( tls->ticket );
+	tls->ticket = NULL;
+	tls->ticket_len = 0;
+	if ( ! sizeof ( new_ticket_b->ticket ) )
+		return 0;
+
+	/* Record ticket for future resumption */
+	tls->ticket = malloc ( sizeof ( new_ticket_b->ticket ) );
+	if ( ! tls->ticket )
+		return -ENOMEM;
+	memcpy ( tls->ticket, new_ticket_b->ticket,
+		 sizeof ( new_ticket_b->ticket ) );
+	tls->ticket_len = sizeof ( new_ticket_b->ticket );
+	DBGC ( tls, "TLS %p received %zd-byte session ticket (lifetime %d "
+	       "seconds)\n", tls, tls->ticket_len,
+	       ntohl ( new_ticket_a->lifetime_hint ) );
+
+	return 0;
+}
+
 /** TLS certificate chain context */
 struct tls_certificate_context {
 	/** TLS session */
@@ -1445,6 +1820,25 @@ static int tls_new_server_hello_done ( struct tls_session *tls,
 	return 0;
 }
 
+/**
+ * Mark handshake as complete
+ *
+ * @v tls		TLS session
+ */
+static void tls_established ( struct tls_session *tls ) {
+
+	/* Record session for future resumption */
+	tls_cache_session ( tls );
+
+	/* Mark session as ready to transmit plaintext data */
+	tls->tx_ready = 1;
+	timeline_end ( "net", "tls handshake", tls,
+		       ( tls->resumed ? "resumed" : NULL ) );
+
+	/* Send notification of a window change */
+	xfer_window_changed ( &tls->plainstream );
+}
+
 /**
  * Receive new Finished handshake record
  *
@@ -1482,11 +1876,18 @@ static int tls_new_finished ( struct tls_session *tls,
 		return -EPERM;
 	}
 
-	/* Mark session as ready to transmit plaintext data */
-	tls->tx_ready = 1;
+	/* If this is an abbreviated handshake, then the server
+	 * finishes first and we must now send our own Change Cipher
+	 * and Finished.
+	 */
+	if ( tls->resumed ) {
+		tls->tx_pending |= ( TLS_TX_CHANGE_CIPHER | TLS_TX_FINISHED );
+		tls_tx_resume ( tls );
+		return 0;
+	}
 
-	/* Send notification of a window change */
-	xfer_window_changed ( &tls->plainstream );
+	/* Handshake is complete */
+	tls_established ( tls );
 
 	return 0;
 }
@@ -1526,6 +1927,10 @@ static int tls_new_handshake ( struct tls_session *tls,
 		case TLS_SERVER_HELLO:
 			rc = tls_new_server_hello ( tls, payload, payload_len );
 			break;
+		case TLS_NEW_SESSION_TICKET:
+			rc = tls_new_session_ticket ( tls, payload,
+						      payload_len );
+			break;
 		case TLS_CERTIFICATE:
 			rc = tls_new_certificate ( tls, payload, payload_len );
 			break;
@@ -1571,12 +1976,17 @@ static int tls_new_handshake ( struct tls_session *tls,
  *
  * @v tls		TLS session
  * @v type		Record type
- * @v data		Plaintext record
- * @v len		Length of plaintext record
+ * @v iobuf		I/O buffer containing plaintext record
  * @ret rc		Return status code
+ *
+ * If the record contains application data, then ownership of the I/O
+ * buffer is passed to the plaintext stream and @c *iobuf is set to
+ * NULL.  Otherwise, the I/O buffer remains owned by the caller.
  */
 static int tls_new_record ( struct tls_session *tls, unsigned int type,
-			    const void *data, size_t len ) {
+			    struct io_buffer **iobuf ) {
+	const void *data = (*iobuf)->data;
+	size_t len = iob_len ( *iobuf );
 
 	switch ( type ) {
 	case TLS_TYPE_CHANGE_CIPHER:
@@ -1586,7 +1996,8 @@ static int tls_new_record ( struct tls_session *tls, unsigned int type,
 	case TLS_TYPE_HANDSHAKE:
 		return tls_new_handshake ( tls, data, len );
 	case TLS_TYPE_DATA:
-		return xfer_deliver_raw ( &tls->plainstream, data, len );
+		return xfer_deliver_iob ( &tls->plainstream,
+					  iob_disown ( *iobuf ) );
 	default:
 		/* RFC4346 says that we should just ignore unknown
 		 * record types.
@@ -1714,6 +2125,107 @@ static void * tls_assemble_block ( struct tls_session *tls,
 	return plaintext;
 }
 
+/** Additional data for an authenticated cipher record */
+struct tls_auth_header {
+	/** Sequence number */
+	uint64_t seq;
+	/** TLS header */
+	struct tls_header tlshdr;
+} __attribute__ (( packed ));
+
+/**
+ * Construct authenticated cipher record nonce
+ *
+ * @v cipherspec	Cipher specification
+ * @v record_iv		Record initialisation vector
+ * @v iv		Nonce to fill in
+ */
+static void tls_auth_iv ( struct tls_cipherspec *cipherspec,
+			  const void *record_iv, void *iv ) {
+	struct tls_cipher_suite *suite = cipherspec->suite;
+
+	memcpy ( iv, cipherspec->fixed_iv, suite->fixed_iv_len );
+	memcpy ( ( iv + suite->fixed_iv_len ), record_iv,
+		 suite->record_iv_len );
+}
+
+/**
+ * Send plaintext record using an authenticated cipher
+ *
+ * @v tls		TLS session
+ * @v type		Record type
+ * @v data		Plaintext record
+ * @v len		Length of plaintext record
+ * @ret rc		Return status code
+ *
+ * The plaintext is encrypted and authenticated directly into the
+ * ciphertext record, without any intermediate copies.
+ */
+static int tls_send_auth ( struct tls_session *tls, unsigned int type,
+			   const void *data, size_t len ) {
+	struct tls_cipherspec *cipherspec = &tls->tx_cipherspec;
+	struct tls_cipher_suite *suite = cipherspec->suite;
+	struct cipher_algorithm *cipher = suite->cipher;
+	struct tls_auth_header authhdr;
+	struct tls_header *tlshdr;
+	struct io_buffer *ciphertext;
+	size_t record_len = ( suite->record_iv_len + len + cipher->authsize );
+	uint8_t iv[ suite->fixed_iv_len + suite->record_iv_len ];
+	uint64_t seq = cpu_to_be64 ( tls->tx_seq );
+	void *record_iv;
+	int rc;
+
+	/* Construct additional data */
+	authhdr.seq = seq;
+	authhdr.tlshdr.type = type;
+	authhdr.tlshdr.version = htons ( tls->version );
+	authhdr.tlshdr.length = htons ( len );
+
+	/* Allocate ciphertext */
+	ciphertext = xfer_alloc_iob ( &tls->cipherstream,
+				      ( sizeof ( *tlshdr ) + record_len ) );
+	if ( ! ciphertext ) {
+		DBGC ( tls, "TLS %p could not allocate %zd bytes for "
+		       "ciphertext\n", tls, ( sizeof ( *tlshdr ) + record_len ));
+		return -ENOMEM;
+	}
+
+	/* Assemble record header and explicit nonce.  The sequence
+	 * number is unique within the session, and so is used as the
+	 * explicit nonce.
+	 */
+	tlshdr = iob_put ( ciphertext, sizeof ( *tlshdr ) );
+	tlshdr->type = type;
+	tlshdr->version = htons ( tls->version );
+	tlshdr->length = htons ( record_len );
+	assert ( suite->record_iv_len == sizeof ( seq ) );
+	record_iv = iob_put ( ciphertext, suite->record_iv_len );
+	memcpy ( record_iv, &seq, suite->record_iv_len );
+
+	/* Encrypt and authenticate record */
+	tls_auth_iv ( cipherspec, record_iv, iv );
+	cipher_setiv ( cipher, cipherspec->cipher_ctx, iv );
+	cipher_encrypt ( cipher, cipherspec->cipher_ctx, &authhdr, NULL,
+			 sizeof ( authhdr ) );
+	cipher_encrypt ( cipher, cipherspec->cipher_ctx, data,
+			 iob_put ( ciphertext, len ), len );
+	cipher_auth ( cipher, cipherspec->cipher_ctx,
+		      iob_put ( ciphertext, cipher->authsize ) );
+
+	/* Send ciphertext */
+	if ( ( rc = xfer_deliver_iob ( &tls->cipherstream,
+				       ciphertext ) ) != 0 ) {
+		DBGC ( tls, "TLS %p could not deliver ciphertext: %s\n",
+		       tls, strerror ( rc ) );
+		return rc;
+	}
+
+	/* Update TX state machine to next record */
+	tls->tx_seq += 1;
+
+	return 0;
+}
+
 /**
  * Send plaintext record
  *
@@ -1735,8 +2247,13 @@ static int tls_send_plaintext ( struct tls_session *tls, unsigned int type,
 	size_t ciphertext_len;
 	size_t mac_len = cipherspec->suite->digest->digestsize;
 	uint8_t mac[mac_len];
+	uint8_t next_iv[cipher->blocksize];
 	int rc;
 
+	/* Use single-pass encryption for authenticated ciphers */
+	if ( is_auth_cipher ( cipher ) )
+		return tls_send_auth ( tls, type, data, len );
+
 	/* Construct header */
 	plaintext_tlshdr.type = type;
 	plaintext_tlshdr.version = htons ( tls->version );
@@ -1779,11 +2296,19 @@ static int tls_send_plaintext ( struct tls_session *tls, unsigned int type,
 	tlshdr->type = type;
 	tlshdr->version = htons ( tls->version );
 	tlshdr->length = htons ( plaintext_len );
-	memcpy ( cipherspec->cipher_next_ctx, cipherspec->cipher_ctx,
-		 cipher->ctxsize );
-	cipher_encrypt ( cipher, cipherspec->cipher_next_ctx, plaintext,
+	cipher_encrypt ( cipher, cipherspec->cipher_ctx, plaintext,
 			 iob_put ( ciphertext, plaintext_len ), plaintext_len );
 
+	/* Record the chaining value for the next record.  The cipher
+	 * context has already been advanced, and will be wound back
+	 * to the previous chaining value if delivery fails.  (Stream
+	 * ciphers have no state to advance.)
+	 */
+	if ( ! is_stream_cipher ( cipher ) ) {
+		memcpy ( next_iv, ( ciphertext->tail - sizeof ( next_iv ) ),
+			 sizeof ( next_iv ) );
+	}
+
 	/* Free plaintext as soon as possible to conserve memory */
 	free ( plaintext );
 	plaintext = NULL;
@@ -1793,13 +2318,17 @@ static int tls_send_plaintext ( struct tls_session *tls, unsigned int type,
 				       iob_disown ( ciphertext ) ) ) != 0 ) {
 		DBGC ( tls, "TLS %p could not deliver ciphertext: %s\n",
 		       tls, strerror ( rc ) );
+		if ( ! is_stream_cipher ( cipher ) ) {
+			cipher_setiv ( cipher, cipherspec->cipher_ctx,
+				       cipherspec->fixed_iv );
+		}
 		goto done;
 	}
 
 	/* Update TX state machine to next record */
 	tls->tx_seq += 1;
-	memcpy ( tls->tx_cipherspec.cipher_ctx,
-		 tls->tx_cipherspec.cipher_next_ctx, cipher->ctxsize );
+	if ( ! is_stream_cipher ( cipher ) )
+		memcpy ( cipherspec->fixed_iv, next_iv, sizeof ( next_iv ) );
 
  done:
 	free ( plaintext );
@@ -1912,22 +2441,92 @@ static int tls_split_block ( struct tls_session *tls,
 	return 0;
 }
 
+/**
+ * Receive new ciphertext record using an authenticated cipher
+ *
+ * @v tls		TLS session
+ * @v tlshdr		Record header
+ * @v iobuf		I/O buffer containing ciphertext record
+ * @ret rc		Return status code
+ *
+ * The record is decrypted and authenticated in a single pass.  See
+ * tls_new_ciphertext() for the ownership rules for the I/O buffer.
+ */
+static int tls_new_auth_ciphertext ( struct tls_session *tls,
+				     struct tls_header *tlshdr,
+				     struct io_buffer **iobuf ) {
+	struct tls_cipherspec *cipherspec = &tls->rx_cipherspec;
+	struct tls_cipher_suite *suite = cipherspec->suite;
+	struct cipher_algorithm *cipher = suite->cipher;
+	struct tls_auth_header authhdr;
+	size_t record_len = ntohs ( tlshdr->length );
+	void *record_iv = (*iobuf)->data;
+	uint8_t iv[ suite->fixed_iv_len + suite->record_iv_len ];
+	uint8_t verify_auth[cipher->authsize];
+	void *data;
+	size_t len;
+	void *auth;
+
+	/* Sanity check */
+	assert ( iob_len ( *iobuf ) == record_len );
+	if ( record_len < ( suite->record_iv_len + cipher->authsize ) ) {
+		DBGC ( tls, "TLS %p received underlength record\n", tls );
+		DBGC_HD ( tls, record_iv, record_len );
+		return -EINVAL;
+	}
+	len = ( record_len - suite->record_iv_len - cipher->authsize );
+	data = ( record_iv + suite->record_iv_len );
+	auth = ( data + len );
+
+	/* Construct additional data */
+	authhdr.seq = cpu_to_be64 ( tls->rx_seq );
+	authhdr.tlshdr.type = tlshdr->type;
+	authhdr.tlshdr.version = tlshdr->version;
+	authhdr.tlshdr.length = htons ( len );
+
+	/* Decrypt the record in place and verify authentication tag */
+	tls_auth_iv ( cipherspec, record_iv, iv );
+	cipher_setiv ( cipher, cipherspec->cipher_ctx, iv );
+	cipher_decrypt ( cipher, cipherspec->cipher_ctx, &authhdr, NULL,
+			 sizeof ( authhdr ) );
+	cipher_decrypt ( cipher, cipherspec->cipher_ctx, data, data, len );
+	cipher_auth ( cipher, cipherspec->cipher_ctx, verify_auth );
+	if ( memcmp ( auth, verify_auth, sizeof ( verify_auth ) ) != 0 ) {
+		DBGC ( tls, "TLS %p failed authentication\n", tls );
+		return -EACCES_AUTH;
+	}
+
+	DBGC2 ( tls, "Received plaintext data:\n" );
+	DBGC2_HD ( tls, data, len );
+
+	/* Trim I/O buffer to plaintext content */
+	iob_pull ( *iobuf, suite->record_iv_len );
+	iob_unput ( *iobuf, cipher->authsize );
+
+	/* Process plaintext record */
+	return tls_new_record ( tls, tlshdr->type, iobuf );
+}
+
 /**
  * Receive new ciphertext record
  *
  * @v tls		TLS session
  * @v tlshdr		Record header
- * @v ciphertext	Ciphertext record
+ * @v iobuf		I/O buffer containing ciphertext record
  * @ret rc		Return status code
+ *
+ * The record is decrypted in place, and the I/O buffer is trimmed to
+ * contain only the plaintext content before being processed.  See
+ * tls_new_record() for the ownership rules for the I/O buffer.
  */
 static int tls_new_ciphertext ( struct tls_session *tls,
 				struct tls_header *tlshdr,
-				const void *ciphertext ) {
+				struct io_buffer **iobuf ) {
 	struct tls_header plaintext_tlshdr;
 	struct tls_cipherspec *cipherspec = &tls->rx_cipherspec;
 	struct cipher_algorithm *cipher = cipherspec->suite->cipher;
 	size_t record_len = ntohs ( tlshdr->length );
-	void *plaintext = NULL;
+	void *plaintext = (*iobuf)->data;
 	void *data;
 	size_t len;
 	void *mac;
@@ -1935,28 +2534,26 @@ static int tls_new_ciphertext ( struct tls_session *tls,
 	uint8_t verify_mac[mac_len];
 	int rc;
 
-	/* Allocate buffer for plaintext */
-	plaintext = malloc ( record_len );
-	if ( ! plaintext ) {
-		DBGC ( tls, "TLS %p could not allocate %zd bytes for "
-		       "decryption buffer\n", tls, record_len );
-		rc = -ENOMEM;
-		goto done;
-	}
+	/* Use single-pass decryption for authenticated ciphers */
+	if ( is_auth_cipher ( cipher ) )
+		return tls_new_auth_ciphertext ( tls, tlshdr, iobuf );
 
-	/* Decrypt the record */
+	/* Sanity check */
+	assert ( iob_len ( *iobuf ) == record_len );
+
+	/* Decrypt the record in place */
 	cipher_decrypt ( cipher, cipherspec->cipher_ctx,
-			 ciphertext, plaintext, record_len );
+			 plaintext, plaintext, record_len );
 
 	/* Split record into content and MAC */
 	if ( is_stream_cipher ( cipher ) ) {
 		if ( ( rc = tls_split_stream ( tls, plaintext, record_len,
 					       &data, &len, &mac ) ) != 0 )
-			goto done;
+			return rc;
 	} else {
 		if ( ( rc = tls_split_block ( tls, plaintext, record_len,
 					      &data, &len, &mac ) ) != 0 )
-			goto done;
+			return rc;
 	}
 
 	/* Verify MAC */
@@ -1968,20 +2565,21 @@ static int tls_new_ciphertext ( struct tls_session *tls,
 	if ( memcmp ( mac, verify_mac, mac_len ) != 0 ) {
 		DBGC ( tls, "TLS %p failed MAC verification\n", tls );
 		DBGC_HD ( tls, plaintext, record_len );
-		goto done;
+		return 0;
 	}
 
 	DBGC2 ( tls, "Received plaintext data:\n" );
 	DBGC2_HD ( tls, data, len );
 
+	/* Trim I/O buffer to plaintext content */
+	iob_pull ( *iobuf, ( data - plaintext ) );
+	iob_unput ( *iobuf, ( iob_len ( *iobuf ) - len ) );
+
 	/* Process plaintext record */
-	if ( ( rc = tls_new_record ( tls, tlshdr->type, data, len ) ) != 0 )
-		goto done;
+	if ( ( rc = tls_new_record ( tls, tlshdr->type, iobuf ) ) != 0 )
+		return rc;
 
-	rc = 0;
- done:
-	free ( plaintext );
-	return rc;
+	return 0;
 }
 
 /******************************************************************************
@@ -2062,14 +2660,26 @@ static struct interface_descriptor tls_plainstream_desc =
 static int tls_newdata_process_header ( struct tls_session *tls ) {
 	size_t data_len = ntohs ( tls->rx_header.length );
 
-	/* Allocate data buffer now that we know the length */
-	assert ( tls->rx_data == NULL );
-	tls->rx_data = malloc ( data_len );
+	/* Reuse existing data buffer if large enough, otherwise
+	 * allocate a new data buffer now that we know the length.
+	 */
+	if ( tls->rx_data ) {
+		tls->rx_data->data = tls->rx_data->head;
+		tls->rx_data->tail = tls->rx_data->head;
+		if ( iob_tailroom ( tls->rx_data ) < data_len ) {
+			free_iob ( tls->rx_data );
+			tls->rx_data = NULL;
+		}
+	}
 	if ( ! tls->rx_data ) {
-		DBGC ( tls, "TLS %p could not allocate %zd bytes "
-		       "for receive buffer\n", tls, data_len );
-		return -ENOMEM;
+		tls->rx_data = alloc_iob ( data_len );
+		if ( ! tls->rx_data ) {
+			DBGC ( tls, "TLS %p could not allocate %zd bytes "
+			       "for receive buffer\n", tls, data_len );
+			return -ENOMEM;
+		}
 	}
+	iob_put ( tls->rx_data, data_len );
 
 	/* Move to data state */
 	tls->rx_state = TLS_RX_DATA;
@@ -2088,16 +2698,12 @@ static int tls_newdata_process_data ( struct tls_session *tls ) {
 
 	/* Process record */
 	if ( ( rc = tls_new_ciphertext ( tls, &tls->rx_header,
-					 tls->rx_data ) ) != 0 )
+					 &tls->rx_data ) ) != 0 )
 		return rc;
 
 	/* Increment RX sequence number */
 	tls->rx_seq += 1;
 
-	/* Free data buffer */
-	free ( tls->rx_data );
-	tls->rx_data = NULL;
-
 	/* Return to header state */
 	tls->rx_state = TLS_RX_HEADER;
 
@@ -2130,8 +2736,8 @@ static int tls_cipherstream_deliver ( struct tls_session *tls,
 			process = tls_newdata_process_header;
 			break;
 		case TLS_RX_DATA:
-			buf = tls->rx_data;
-			buf_len = ntohs ( tls->rx_header.length );
+			buf = tls->rx_data->data;
+			buf_len = iob_len ( tls->rx_data );
 			process = tls_newdata_process_data;
 			break;
 		default:
@@ -2199,6 +2805,7 @@ static void tls_tx_step ( struct tls_session *tls ) {
 	/* Send first pending transmission */
 	if ( tls->tx_pending & TLS_TX_CLIENT_HELLO ) {
 		/* Send Client Hello */
+		timeline_begin ( "net", "tls handshake", tls, tls->name );
 		if ( ( rc = tls_send_client_hello ( tls ) ) != 0 ) {
 			DBGC ( tls, "TLS %p could not send Client Hello: %s\n",
 			       tls, strerror ( rc ) );
@@ -2253,6 +2860,12 @@ static void tls_tx_step ( struct tls_session *tls ) {
 			goto err;
 		}
 		tls->tx_pending &= ~TLS_TX_FINISHED;
+
+		/* An abbreviated handshake is complete once we have
+		 * sent our Finished.
+		 */
+		if ( tls->resumed )
+			tls_established ( tls );
 	}
 
 	/* Reschedule process if pending transmissions remain */
@@ -2276,7 +2889,7 @@ static struct process_descriptor tls_process_desc =
  ******************************************************************************
  */
 
-int add_tls ( struct interface *xfer, const char *name,
+int add_tls ( struct interface *xfer, const char *name, unsigned int port,
 	      struct interface **next ) {
 	struct tls_session *tls;
 	int rc;
@@ -2290,6 +2903,7 @@ int add_tls ( struct interface *xfer, const char *name,
 	memset ( tls, 0, sizeof ( *tls ) );
 	ref_init ( &tls->refcnt, free_tls );
 	tls->name = name;
+	tls->port = port;
 	intf_init ( &tls->plainstream, &tls_plainstream_desc, &tls->refcnt );
 	intf_init ( &tls->cipherstream, &tls_cipherstream_desc, &tls->refcnt );
 	tls->version = TLS_VERSION_TLS_1_2;
@@ -2311,6 +2925,8 @@ int add_tls ( struct interface *xfer, const char *name,
 	digest_init ( &sha256_algorithm, tls->handshake_sha256_ctx );
 	tls->handshake_digest = &sha256_algorithm;
 	tls->handshake_ctx = tls->handshake_sha256_ctx;
+	if ( ( rc = tls_resume_session ( tls ) ) != 0 )
+		goto err_random;
 	tls->tx_pending = TLS_TX_CLIENT_HELLO;
 	process_init ( &tls->process, &tls_process_desc, &tls->refcnt );
 
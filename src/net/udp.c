@@ -10,7 +10,9 @@
 #include <ipxe/open.h>
 #include <ipxe/uri.h>
 #include <ipxe/netdevice.h>
+#include <ipxe/init.h>
 #include <ipxe/udp.h>
+#include <ipxe/netstat.h>
 
 /** @file
  *
@@ -28,6 +30,8 @@ struct udp_connection {
 	struct refcnt refcnt;
 	/** List of UDP connections */
 	struct list_head list;
+	/** List of UDP connections within hash bucket */
+	struct list_head hash;
 
 	/** Data transfer interface */
 	struct interface xfer;
@@ -43,6 +47,41 @@ struct udp_connection {
  */
 static LIST_HEAD ( udp_conns );
 
+/** Number of UDP connection hash buckets (must be a power of two) */
+#define UDP_HASH_SIZE 16
+
+/** UDP connection hash buckets, indexed by local port
+ *
+ * Only connections bound to a specific local port are hashed.
+ */
+static struct list_head udp_hash[UDP_HASH_SIZE];
+
+/** Number of UDP connections bound to a wildcard local port */
+static unsigned int udp_wildcards;
+
+/** UDP statistics */
+struct udp_statistics {
+	/** Number of received packets with incorrect checksums */
+	unsigned int checksum_errors;
+	/** Number of received packets with no matching connection */
+	unsigned int no_port;
+};
+
+/** UDP statistics */
+static struct udp_statistics udp_stats;
+
+/**
+ * Get UDP connection hash bucket
+ *
+ * @v local_port	Local port (in network-endian order)
+ * @ret bucket		Hash bucket
+ */
+static inline __attribute__ (( always_inline )) struct list_head *
+udp_bucket ( uint16_t local_port ) {
+	return &udp_hash[ ( local_port ^ ( local_port >> 8 ) ) &
+			  ( UDP_HASH_SIZE - 1 ) ];
+}
+
 /* Forward declatations */
 static struct interface_descriptor udp_xfer_desc;
 struct tcpip_protocol udp_protocol __tcpip_protocol;
@@ -74,7 +113,8 @@ static int udp_bind ( struct udp_connection *udp ) {
 	}
 
 	/* Attempt bind to local port */
-	list_for_each_entry ( existing, &udp_conns, list ) {
+	list_for_each_entry ( existing, udp_bucket ( udp->local.st_port ),
+			      hash ) {
 		if ( existing->local.st_port == udp->local.st_port ) {
 			DBGC ( udp, "UDP %p could not bind: port %d in use\n",
 			       udp, ntohs ( udp->local.st_port ) );
@@ -129,6 +169,12 @@ static int udp_open_common ( struct interface *xfer,
 	 */
 	intf_plug_plug ( &udp->xfer, xfer );
 	list_add ( &udp->list, &udp_conns );
+	if ( udp->local.st_port ) {
+		list_add ( &udp->hash, udp_bucket ( udp->local.st_port ) );
+	} else {
+		INIT_LIST_HEAD ( &udp->hash );
+		udp_wildcards++;
+	}
 	return 0;
 
  err:
@@ -175,11 +221,34 @@ static void udp_close ( struct udp_connection *udp, int rc ) {
 
 	/* Remove from list of connections and drop list's reference */
 	list_del ( &udp->list );
+	list_del ( &udp->hash );
+	if ( ! udp->local.st_port )
+		udp_wildcards--;
 	ref_put ( &udp->refcnt );
 
 	DBGC ( udp, "UDP %p closed\n", udp );
 }
 
+/**
+ * Determine required transmit headroom
+ *
+ * @v dest		Destination address
+ * @ret headroom	Headroom required for all headers
+ *
+ * The link-layer headroom is determined by the network device (and
+ * any underlying devices) via which the destination is routed.  At
+ * least @c MAX_LL_NET_HEADER_LEN is always required, for destinations
+ * that are not yet routable and for buffers allocated elsewhere.
+ */
+static size_t udp_headroom ( struct sockaddr_tcpip *dest ) {
+	size_t headroom;
+
+	headroom = ( sizeof ( struct udp_header ) + tcpip_headroom ( dest ) );
+	if ( headroom < MAX_LL_NET_HEADER_LEN )
+		headroom = MAX_LL_NET_HEADER_LEN;
+	return headroom;
+}
+
 /**
  * Transmit data via a UDP connection to a specified address
  *
@@ -197,19 +266,19 @@ static int udp_tx ( struct udp_connection *udp, struct io_buffer *iobuf,
 	size_t len;
 	int rc;
 
-	/* Check we can accommodate the header */
-	if ( ( rc = iob_ensure_headroom ( iobuf,
-					  MAX_LL_NET_HEADER_LEN ) ) != 0 ) {
-		free_iob ( iobuf );
-		return rc;
-	}
-
 	/* Fill in default values if not explicitly provided */
 	if ( ! src )
 		src = &udp->local;
 	if ( ! dest )
 		dest = &udp->peer;
 
+	/* Check we can accommodate the headers */
+	if ( ( rc = iob_ensure_headroom ( iobuf,
+					  udp_headroom ( dest ) ) ) != 0 ) {
+		free_iob ( iobuf );
+		return rc;
+	}
+
 	/* Add the UDP header */
 	udphdr = iob_push ( iobuf, sizeof ( *udphdr ) );
 	len = iob_len ( iobuf );
@@ -235,6 +304,27 @@ static int udp_tx ( struct udp_connection *udp, struct io_buffer *iobuf,
 	return 0;
 }
 
+/**
+ * Check if UDP connection matches local address
+ *
+ * @v udp		UDP connection
+ * @v local		Local address
+ * @ret match		Connection matches local address
+ */
+static inline __attribute__ (( always_inline )) int
+udp_demux_match ( struct udp_connection *udp, struct sockaddr_tcpip *local ) {
+	static const struct sockaddr_tcpip empty_sockaddr = { .pad = { 0, } };
+
+	return ( ( ( udp->local.st_family == local->st_family ) ||
+		   ( udp->local.st_family == 0 ) ) &&
+		 ( ( udp->local.st_port == local->st_port ) ||
+		   ( udp->local.st_port == 0 ) ) &&
+		 ( ( memcmp ( udp->local.pad, local->pad,
+			      sizeof ( udp->local.pad ) ) == 0 ) ||
+		   ( memcmp ( udp->local.pad, empty_sockaddr.pad,
+			      sizeof ( udp->local.pad ) ) == 0 ) ) );
+}
+
 /**
  * Identify UDP connection by local address
  *
@@ -242,20 +332,24 @@ static int udp_tx ( struct udp_connection *udp, struct io_buffer *iobuf,
  * @ret udp		UDP connection, or NULL
  */
 static struct udp_connection * udp_demux ( struct sockaddr_tcpip *local ) {
-	static const struct sockaddr_tcpip empty_sockaddr = { .pad = { 0, } };
 	struct udp_connection *udp;
 
-	list_for_each_entry ( udp, &udp_conns, list ) {
-		if ( ( ( udp->local.st_family == local->st_family ) ||
-		       ( udp->local.st_family == 0 ) ) &&
-		     ( ( udp->local.st_port == local->st_port ) ||
-		       ( udp->local.st_port == 0 ) ) &&
-		     ( ( memcmp ( udp->local.pad, local->pad,
-				  sizeof ( udp->local.pad ) ) == 0 ) ||
-		       ( memcmp ( udp->local.pad, empty_sockaddr.pad,
-				  sizeof ( udp->local.pad ) ) == 0 ) ) ) {
-			return udp;
+	/* If any wildcard (e.g. promiscuous) connections exist, then
+	 * fall back to scanning all connections in order of creation,
+	 * so that the most recently opened matching connection wins.
+	 */
+	if ( udp_wildcards ) {
+		list_for_each_entry ( udp, &udp_conns, list ) {
+			if ( udp_demux_match ( udp, local ) )
+				return udp;
 		}
+		return NULL;
+	}
+
+	/* Otherwise, scan only the hash bucket for this local port */
+	list_for_each_entry ( udp, udp_bucket ( local->st_port ), hash ) {
+		if ( udp_demux_match ( udp, local ) )
+			return udp;
 	}
 	return NULL;
 }
@@ -269,8 +363,10 @@ static struct udp_connection * udp_demux ( struct sockaddr_tcpip *local ) {
  * @v pshdr_csum	Pseudo-header checksum
  * @ret rc		Return status code
  */
-static int udp_rx ( struct io_buffer *iobuf, struct sockaddr_tcpip *st_src,
-		    struct sockaddr_tcpip *st_dest, uint16_t pshdr_csum ) {
+static int __hot udp_rx ( struct io_buffer *iobuf,
+			  struct sockaddr_tcpip *st_src,
+			  struct sockaddr_tcpip *st_dest,
+			  uint16_t pshdr_csum ) {
 	struct udp_header *udphdr = iobuf->data;
 	struct udp_connection *udp;
 	struct xfer_metadata meta;
@@ -299,11 +395,12 @@ static int udp_rx ( struct io_buffer *iobuf, struct sockaddr_tcpip *st_src,
 		rc = -EINVAL;
 		goto done;
 	}
-	if ( udphdr->chksum ) {
+	if ( udphdr->chksum && ! ( iobuf->flags & IOB_CSUM_VERIFIED ) ) {
 		csum = tcpip_continue_chksum ( pshdr_csum, iobuf->data, ulen );
 		if ( csum != 0 ) {
 			DBG ( "UDP checksum incorrect (is %04x including "
 			      "checksum field, should be 0000)\n", csum );
+			udp_stats.checksum_errors++;
 			rc = -EINVAL;
 			goto done;
 		}
@@ -324,6 +421,7 @@ static int udp_rx ( struct io_buffer *iobuf, struct sockaddr_tcpip *st_src,
 	if ( ! udp ) {
 		DBG ( "No UDP connection listening on port %d\n",
 		      ntohs ( udphdr->dest ) );
+		udp_stats.no_port++;
 		rc = -ENOTCONN;
 		goto done;
 	}
@@ -345,6 +443,29 @@ struct tcpip_protocol udp_protocol __tcpip_protocol = {
 	.tcpip_proto = IP_UDP,
 };
 
+/** UDP statistics */
+struct net_statistic udp_net_statistics[]
+	__net_statistic ( NET_STAT_TRANSPORT ) = {
+	{ "UDP", "CSUME", &udp_stats.checksum_errors },
+	{ "UDP", "NOPORT", &udp_stats.no_port },
+};
+
+/**
+ * Initialise UDP connection hash buckets
+ *
+ */
+static void udp_init ( void ) {
+	unsigned int i;
+
+	for ( i = 0 ; i < UDP_HASH_SIZE ; i++ )
+		INIT_LIST_HEAD ( &udp_hash[i] );
+}
+
+/** UDP initialisation function */
+struct init_fn udp_init_fn __init_fn ( INIT_NORMAL ) = {
+	.initialise = udp_init,
+};
+
 /***************************************************************************
  *
  * Data transfer interface
@@ -362,14 +483,16 @@ struct tcpip_protocol udp_protocol __tcpip_protocol = {
 static struct io_buffer * udp_xfer_alloc_iob ( struct udp_connection *udp,
 					       size_t len ) {
 	struct io_buffer *iobuf;
+	size_t headroom;
 
-	iobuf = alloc_iob ( MAX_LL_NET_HEADER_LEN + len );
+	headroom = udp_headroom ( &udp->peer );
+	iobuf = alloc_iob ( headroom + len );
 	if ( ! iobuf ) {
 		DBGC ( udp, "UDP %p cannot allocate buffer of length %zd\n",
 		       udp, len );
 		return NULL;
 	}
-	iob_reserve ( iobuf, MAX_LL_NET_HEADER_LEN );
+	iob_reserve ( iobuf, headroom );
 	return iobuf;
 }
 
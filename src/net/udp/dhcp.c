@@ -43,6 +43,8 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/dhcppkt.h>
 #include <ipxe/dhcp_arch.h>
 #include <ipxe/features.h>
+#include <ipxe/netstat.h>
+#include <ipxe/timeline.h>
 
 /** @file
  *
@@ -71,6 +73,30 @@ static const uint8_t dhcp_op[] = {
 	[DHCPINFORM]	= BOOTP_REQUEST,
 };
 
+/** DHCP statistics */
+struct dhcp_statistics {
+	/** Number of packets transmitted */
+	unsigned int tx;
+	/** Number of packets received for an active session */
+	unsigned int rx;
+	/** Number of packets received with a bad transaction ID */
+	unsigned int bad_xid;
+	/** Number of DHCPNAKs received */
+	unsigned int naks;
+};
+
+/** DHCP statistics */
+static struct dhcp_statistics dhcp_stats;
+
+/** DHCP statistics */
+struct net_statistic dhcp_net_statistics[]
+	__net_statistic ( NET_STAT_APPLICATION ) = {
+	{ "DHCP", "TX", &dhcp_stats.tx },
+	{ "DHCP", "RX", &dhcp_stats.rx },
+	{ "DHCP", "XIDE", &dhcp_stats.bad_xid },
+	{ "DHCP", "NAK", &dhcp_stats.naks },
+};
+
 /** Raw option data for options common to all DHCP requests */
 static uint8_t dhcp_request_options_data[] = {
 	DHCP_MESSAGE_TYPE, DHCP_BYTE ( 0 ),
@@ -87,6 +113,7 @@ static uint8_t dhcp_request_options_data[] = {
 		      DHCP_TFTP_SERVER_NAME, DHCP_BOOTFILE_NAME,
 		      128, 129, 130, 131, 132, 133, 134, 135, /* for PXE */
 		      DHCP_EB_ENCAP, DHCP_ISCSI_INITIATOR_IQN ),
+	DHCP_RAPID_COMMIT, 0 /* empty */,
 	DHCP_END
 };
 
@@ -117,6 +144,14 @@ struct setting use_cached_setting __setting ( SETTING_MISC ) = {
 	.type = &setting_type_uint8,
 };
 
+/** Maximum ProxyDHCP waiting time setting */
+struct setting proxydhcp_wait_setting __setting ( SETTING_MISC ) = {
+	.name = "proxydhcp-wait",
+	.description = "ProxyDHCP waiting time (ms)",
+	.tag = DHCP_EB_PROXYDHCP_WAIT,
+	.type = &setting_type_uint32,
+};
+
 /**
  * Most recent DHCP transaction ID
  *
@@ -192,6 +227,7 @@ struct dhcp_session_state {
 };
 
 static struct dhcp_session_state dhcp_state_discover;
+static struct dhcp_session_state dhcp_state_reboot;
 static struct dhcp_session_state dhcp_state_request;
 static struct dhcp_session_state dhcp_state_proxy;
 static struct dhcp_session_state dhcp_state_pxebs;
@@ -220,6 +256,8 @@ struct dhcp_session {
 	struct in_addr server;
 	/** DHCP offer priority */
 	int priority;
+	/** Rapid commit DHCPACK, if selected */
+	struct dhcp_packet *rapid_ack;
 
 	/** ProxyDHCP protocol extensions should be ignored */
 	int no_pxedhcp;
@@ -234,6 +272,8 @@ struct dhcp_session {
 	uint16_t pxe_type;
 	/** List of PXE Boot Servers to attempt */
 	struct in_addr *pxe_attempt;
+	/** PXE Boot Server being addressed by the current transmission */
+	struct in_addr *pxe_server;
 	/** List of PXE Boot Servers to accept */
 	struct in_addr *pxe_accept;
 
@@ -243,6 +283,8 @@ struct dhcp_session {
 	unsigned int count;
 	/** Start time of the current state (in ticks) */
 	unsigned long start;
+	/** Maximum time to wait for ProxyDHCP responses (in ticks) */
+	unsigned long proxy_timeout;
 };
 
 /**
@@ -255,6 +297,7 @@ static void dhcp_free ( struct refcnt *refcnt ) {
 		container_of ( refcnt, struct dhcp_session, refcnt );
 
 	netdev_put ( dhcp->netdev );
+	dhcppkt_put ( dhcp->rapid_ack );
 	dhcppkt_put ( dhcp->proxy_offer );
 	free ( dhcp );
 }
@@ -270,6 +313,10 @@ static void dhcp_finished ( struct dhcp_session *dhcp, int rc ) {
 	/* Stop retry timer */
 	stop_timer ( &dhcp->timer );
 
+	/* Record end of current state */
+	if ( dhcp->state )
+		timeline_end ( "dhcp", dhcp->state->name, dhcp, NULL );
+
 	/* Shut down interfaces */
 	intf_shutdown ( &dhcp->xfer, rc );
 	intf_shutdown ( &dhcp->job, rc );
@@ -285,6 +332,9 @@ static void dhcp_set_state ( struct dhcp_session *dhcp,
 			     struct dhcp_session_state *state ) {
 
 	DBGC ( dhcp, "DHCP %p entering %s state\n", dhcp, state->name );
+	if ( dhcp->state )
+		timeline_end ( "dhcp", dhcp->state->name, dhcp, NULL );
+	timeline_begin ( "dhcp", state->name, dhcp, NULL );
 	dhcp->state = state;
 	dhcp->start = currticks();
 	stop_timer ( &dhcp->timer );
@@ -322,6 +372,81 @@ static int dhcp_has_pxeopts ( struct dhcp_packet *dhcppkt ) {
  *
  */
 
+/**
+ * Complete DHCP with an acknowledged lease
+ *
+ * @v dhcp		DHCP session
+ * @v dhcppkt		DHCPACK packet
+ */
+static void dhcp_bound ( struct dhcp_session *dhcp,
+			 struct dhcp_packet *dhcppkt ) {
+	struct settings *parent;
+	struct settings *settings;
+	int rc;
+
+	/* Record assigned address */
+	dhcp->local.sin_addr = dhcppkt->dhcphdr->yiaddr;
+
+	/* Register settings */
+	parent = netdev_settings ( dhcp->netdev );
+	settings = &dhcppkt->settings;
+	if ( ( rc = register_settings ( settings, parent,
+					DHCP_SETTINGS_NAME ) ) != 0 ) {
+		DBGC ( dhcp, "DHCP %p could not register settings: %s\n",
+		       dhcp, strerror ( rc ) );
+		dhcp_finished ( dhcp, rc );
+		return;
+	}
+
+	/* Perform ProxyDHCP if applicable */
+	if ( dhcp->proxy_offer /* Have ProxyDHCP offer */ &&
+	     ( ! dhcp->no_pxedhcp ) /* ProxyDHCP not disabled */ ) {
+		if ( dhcp_has_pxeopts ( dhcp->proxy_offer ) ) {
+			/* PXE options already present; register settings
+			 * without performing a ProxyDHCPREQUEST
+			 */
+			settings = &dhcp->proxy_offer->settings;
+			if ( ( rc = register_settings ( settings, NULL,
+					   PROXYDHCP_SETTINGS_NAME ) ) != 0 ) {
+				DBGC ( dhcp, "DHCP %p could not register "
+				       "proxy settings: %s\n",
+				       dhcp, strerror ( rc ) );
+				dhcp_finished ( dhcp, rc );
+				return;
+			}
+		} else {
+			/* PXE options not present; use a ProxyDHCPREQUEST */
+			dhcp_set_state ( dhcp, &dhcp_state_proxy );
+			return;
+		}
+	}
+
+	/* Terminate DHCP */
+	dhcp_finished ( dhcp, 0 );
+}
+
+/**
+ * Complete DHCP discovery
+ *
+ * @v dhcp		DHCP session
+ *
+ * If the selected offer was a rapid commit DHCPACK, then the lease
+ * is already ours and no DHCPREQUEST is required.
+ */
+static void dhcp_discovery_done ( struct dhcp_session *dhcp ) {
+	struct dhcp_packet *rapid_ack = dhcp->rapid_ack;
+
+	if ( rapid_ack ) {
+		DBGC ( dhcp, "DHCP %p using rapid commit DHCPACK\n", dhcp );
+		dhcp->rapid_ack = NULL;
+		stop_timer ( &dhcp->timer );
+		dhcp_bound ( dhcp, rapid_ack );
+		dhcppkt_put ( rapid_ack );
+	} else {
+		dhcp_set_state ( dhcp, &dhcp_state_request );
+	}
+}
+
 /**
  * Construct transmitted packet for DHCP discovery
  *
@@ -361,6 +486,7 @@ static void dhcp_discovery_rx ( struct dhcp_session *dhcp,
 	int has_pxeclient;
 	int8_t priority = 0;
 	uint8_t no_pxedhcp = 0;
+	int rapid_commit;
 	unsigned long elapsed;
 
 	DBGC ( dhcp, "DHCP %p %s from %s:%d", dhcp,
@@ -395,16 +521,27 @@ static void dhcp_discovery_rx ( struct dhcp_session *dhcp,
 			sizeof ( no_pxedhcp ) );
 	if ( no_pxedhcp )
 		DBGC ( dhcp, " nopxe" );
+
+	/* Identify rapid commit DHCPACK */
+	rapid_commit = ( ( msgtype == DHCPACK ) &&
+			 ( dhcppkt_fetch ( dhcppkt, DHCP_RAPID_COMMIT,
+					   NULL, 0 ) >= 0 ) );
+	if ( rapid_commit )
+		DBGC ( dhcp, " rapid" );
 	DBGC ( dhcp, "\n" );
 
 	/* Select as DHCP offer, if applicable */
 	if ( ip.s_addr && ( peer->sin_port == htons ( BOOTPS_PORT ) ) &&
-	     ( ( msgtype == DHCPOFFER ) || ( ! msgtype /* BOOTP */ ) ) &&
+	     ( ( msgtype == DHCPOFFER ) || ( ! msgtype /* BOOTP */ ) ||
+	       rapid_commit ) &&
 	     ( priority >= dhcp->priority ) ) {
 		dhcp->offer = ip;
 		dhcp->server = server_id;
 		dhcp->priority = priority;
 		dhcp->no_pxedhcp = no_pxedhcp;
+		dhcppkt_put ( dhcp->rapid_ack );
+		dhcp->rapid_ack = ( rapid_commit ? dhcppkt_get ( dhcppkt ) :
+				    NULL );
 	}
 
 	/* Select as ProxyDHCP offer, if applicable */
@@ -428,14 +565,20 @@ static void dhcp_discovery_rx ( struct dhcp_session *dhcp,
 	if ( ! dhcp->offer.s_addr )
 		return;
 
-	/* If we can't yet transition to DHCPREQUEST, do nothing */
+	/* If we can't yet complete discovery, then ensure that
+	 * the timer expires once we have waited long enough for
+	 * ProxyDHCPOFFERs.
+	 */
 	elapsed = ( currticks() - dhcp->start );
 	if ( ! ( dhcp->no_pxedhcp || dhcp->proxy_offer ||
-		 ( elapsed > PROXYDHCP_MAX_TIMEOUT ) ) )
+		 ( elapsed > dhcp->proxy_timeout ) ) ) {
+		start_timer_fixed ( &dhcp->timer,
+				    ( dhcp->proxy_timeout - elapsed + 1 ) );
 		return;
+	}
 
-	/* Transition to DHCPREQUEST */
-	dhcp_set_state ( dhcp, &dhcp_state_request );
+	/* Transition to DHCPREQUEST, or bind via rapid commit */
+	dhcp_discovery_done ( dhcp );
 }
 
 /**
@@ -447,8 +590,8 @@ static void dhcp_discovery_expired ( struct dhcp_session *dhcp ) {
 	unsigned long elapsed = ( currticks() - dhcp->start );
 
 	/* Give up waiting for ProxyDHCP before we reach the failure point */
-	if ( dhcp->offer.s_addr && ( elapsed > PROXYDHCP_MAX_TIMEOUT ) ) {
-		dhcp_set_state ( dhcp, &dhcp_state_request );
+	if ( dhcp->offer.s_addr && ( elapsed > dhcp->proxy_timeout ) ) {
+		dhcp_discovery_done ( dhcp );
 		return;
 	}
 
@@ -515,9 +658,6 @@ static void dhcp_request_rx ( struct dhcp_session *dhcp,
 			      struct sockaddr_in *peer, uint8_t msgtype,
 			      struct in_addr server_id ) {
 	struct in_addr ip;
-	struct settings *parent;
-	struct settings *settings;
-	int rc;
 
 	DBGC ( dhcp, "DHCP %p %s from %s:%d", dhcp,
 	       dhcp_msgtype_name ( msgtype ), inet_ntoa ( peer->sin_addr ),
@@ -541,45 +681,8 @@ static void dhcp_request_rx ( struct dhcp_session *dhcp,
 	if ( ip.s_addr != dhcp->offer.s_addr )
 		return;
 
-	/* Record assigned address */
-	dhcp->local.sin_addr = ip;
-
-	/* Register settings */
-	parent = netdev_settings ( dhcp->netdev );
-	settings = &dhcppkt->settings;
-	if ( ( rc = register_settings ( settings, parent,
-					DHCP_SETTINGS_NAME ) ) != 0 ) {
-		DBGC ( dhcp, "DHCP %p could not register settings: %s\n",
-		       dhcp, strerror ( rc ) );
-		dhcp_finished ( dhcp, rc );
-		return;
-	}
-
-	/* Perform ProxyDHCP if applicable */
-	if ( dhcp->proxy_offer /* Have ProxyDHCP offer */ &&
-	     ( ! dhcp->no_pxedhcp ) /* ProxyDHCP not disabled */ ) {
-		if ( dhcp_has_pxeopts ( dhcp->proxy_offer ) ) {
-			/* PXE options already present; register settings
-			 * without performing a ProxyDHCPREQUEST
-			 */
-			settings = &dhcp->proxy_offer->settings;
-			if ( ( rc = register_settings ( settings, NULL,
-					   PROXYDHCP_SETTINGS_NAME ) ) != 0 ) {
-				DBGC ( dhcp, "DHCP %p could not register "
-				       "proxy settings: %s\n",
-				       dhcp, strerror ( rc ) );
-				dhcp_finished ( dhcp, rc );
-				return;
-			}
-		} else {
-			/* PXE options not present; use a ProxyDHCPREQUEST */
-			dhcp_set_state ( dhcp, &dhcp_state_proxy );
-			return;
-		}
-	}
-
-	/* Terminate DHCP */
-	dhcp_finished ( dhcp, 0 );
+	/* Accept lease */
+	dhcp_bound ( dhcp, dhcppkt );
 }
 
 /**
@@ -603,6 +706,114 @@ static struct dhcp_session_state dhcp_state_request = {
 	.apply_min_timeout	= 0,
 };
 
+/**
+ * Construct transmitted packet for DHCP INIT-REBOOT request
+ *
+ * @v dhcp		DHCP session
+ * @v dhcppkt		DHCP packet
+ * @v peer		Destination address
+ */
+static int dhcp_reboot_tx ( struct dhcp_session *dhcp,
+			    struct dhcp_packet *dhcppkt,
+			    struct sockaddr_in *peer ) {
+	int rc;
+
+	DBGC ( dhcp, "DHCP %p DHCPREQUEST (INIT-REBOOT) for %s\n",
+	       dhcp, inet_ntoa ( dhcp->offer ) );
+
+	/* Set requested IP address.  RFC 2131 section 4.3.2 requires
+	 * that no server identifier be present.
+	 */
+	if ( ( rc = dhcppkt_store ( dhcppkt, DHCP_REQUESTED_ADDRESS,
+				    &dhcp->offer,
+				    sizeof ( dhcp->offer ) ) ) != 0 )
+		return rc;
+
+	/* Set server address */
+	peer->sin_addr.s_addr = INADDR_BROADCAST;
+	peer->sin_port = htons ( BOOTPS_PORT );
+
+	return 0;
+}
+
+/**
+ * Handle received packet during DHCP INIT-REBOOT request
+ *
+ * @v dhcp		DHCP session
+ * @v dhcppkt		DHCP packet
+ * @v peer		DHCP server address
+ * @v msgtype		DHCP message type
+ * @v server_id		DHCP server ID
+ */
+static void dhcp_reboot_rx ( struct dhcp_session *dhcp,
+			     struct dhcp_packet *dhcppkt,
+			     struct sockaddr_in *peer, uint8_t msgtype,
+			     struct in_addr server_id ) {
+	struct in_addr ip;
+
+	DBGC ( dhcp, "DHCP %p %s from %s:%d", dhcp,
+	       dhcp_msgtype_name ( msgtype ), inet_ntoa ( peer->sin_addr ),
+	       ntohs ( peer->sin_port ) );
+	if ( server_id.s_addr != peer->sin_addr.s_addr )
+		DBGC ( dhcp, " (%s)", inet_ntoa ( server_id ) );
+
+	/* Identify leased IP address */
+	ip = dhcppkt->dhcphdr->yiaddr;
+	if ( ip.s_addr )
+		DBGC ( dhcp, " for %s", inet_ntoa ( ip ) );
+	DBGC ( dhcp, "\n" );
+
+	/* Filter out unacceptable responses */
+	if ( peer->sin_port != htons ( BOOTPS_PORT ) )
+		return;
+
+	/* Fall back to discovery if the cached lease is refused */
+	if ( msgtype == DHCPNAK ) {
+		dhcp->offer.s_addr = 0;
+		dhcp_set_state ( dhcp, &dhcp_state_discover );
+		return;
+	}
+
+	/* Filter out anything other than a DHCPACK for our address */
+	if ( msgtype != DHCPACK )
+		return;
+	if ( ip.s_addr != dhcp->offer.s_addr )
+		return;
+
+	/* Accept lease */
+	dhcp->server = server_id;
+	dhcp_bound ( dhcp, dhcppkt );
+}
+
+/**
+ * Handle timer expiry during DHCP INIT-REBOOT request
+ *
+ * @v dhcp		DHCP session
+ */
+static void dhcp_reboot_expired ( struct dhcp_session *dhcp ) {
+	unsigned long elapsed = ( currticks() - dhcp->start );
+
+	/* Fall back to discovery if no server responds */
+	if ( elapsed > DHCP_REBOOT_MAX_TIMEOUT ) {
+		dhcp->offer.s_addr = 0;
+		dhcp_set_state ( dhcp, &dhcp_state_discover );
+		return;
+	}
+
+	/* Otherwise, retransmit current packet */
+	dhcp_tx ( dhcp );
+}
+
+/** DHCP INIT-REBOOT request state operations */
+static struct dhcp_session_state dhcp_state_reboot = {
+	.name			= "init-reboot",
+	.tx			= dhcp_reboot_tx,
+	.rx			= dhcp_reboot_rx,
+	.expired		= dhcp_reboot_expired,
+	.tx_msgtype		= DHCPREQUEST,
+	.apply_min_timeout	= 0,
+};
+
 /**
  * Construct transmitted packet for ProxyDHCP request
  *
@@ -685,7 +896,7 @@ static void dhcp_proxy_expired ( struct dhcp_session *dhcp ) {
 	unsigned long elapsed = ( currticks() - dhcp->start );
 
 	/* Give up waiting for ProxyDHCP before we reach the failure point */
-	if ( elapsed > PROXYDHCP_MAX_TIMEOUT ) {
+	if ( elapsed > dhcp->proxy_timeout ) {
 		dhcp_finished ( dhcp, 0 );
 		return;
 	}
@@ -718,7 +929,7 @@ static int dhcp_pxebs_tx ( struct dhcp_session *dhcp,
 	int rc;
 
 	/* Set server address */
-	peer->sin_addr = *(dhcp->pxe_attempt);
+	peer->sin_addr = *(dhcp->pxe_server);
 	peer->sin_port = ( ( peer->sin_addr.s_addr == INADDR_BROADCAST ) ?
 			   htons ( BOOTPS_PORT ) : htons ( PXE_PORT ) );
 
@@ -823,22 +1034,20 @@ static void dhcp_pxebs_rx ( struct dhcp_session *dhcp,
 static void dhcp_pxebs_expired ( struct dhcp_session *dhcp ) {
 	unsigned long elapsed = ( currticks() - dhcp->start );
 
-	/* Give up waiting before we reach the failure point, and fail
-	 * over to the next server in the attempt list
-	 */
+	/* Give up waiting before we reach the failure point */
 	if ( elapsed > PXEBS_MAX_TIMEOUT ) {
-		dhcp->pxe_attempt++;
-		if ( dhcp->pxe_attempt->s_addr ) {
-			dhcp_set_state ( dhcp, &dhcp_state_pxebs );
-			return;
-		} else {
-			dhcp_finished ( dhcp, -ETIMEDOUT );
-			return;
-		}
+		dhcp_finished ( dhcp, -ETIMEDOUT );
+		return;
 	}
 
-	/* Retransmit current packet */
-	dhcp_tx ( dhcp );
+	/* Transmit to all servers in the attempt list at once, so
+	 * that unreachable servers do not delay discovery.  The first
+	 * acceptable response will be used.
+	 */
+	for ( dhcp->pxe_server = dhcp->pxe_attempt ;
+	      dhcp->pxe_server->s_addr ; dhcp->pxe_server++ ) {
+		dhcp_tx ( dhcp );
+	}
 }
 
 /** PXE Boot Server Discovery state operations */
@@ -994,6 +1203,10 @@ int dhcp_create_request ( struct dhcp_packet *dhcppkt,
 	/* Set client IP address */
 	dhcppkt->dhcphdr->ciaddr = ciaddr;
 
+	/* Rapid commit is meaningful only within a DHCPDISCOVER */
+	if ( msgtype != DHCPDISCOVER )
+		dhcppkt_store ( dhcppkt, DHCP_RAPID_COMMIT, NULL, 0 );
+
 	/* Add options to identify the feature list */
 	dhcp_features = table_start ( DHCP_FEATURES );
 	dhcp_features_len = table_num_entries ( DHCP_FEATURES );
@@ -1127,6 +1340,7 @@ static int dhcp_tx ( struct dhcp_session *dhcp ) {
 		       dhcp, strerror ( rc ) );
 		goto done;
 	}
+	dhcp_stats.tx++;
 
  done:
 	free_iob ( iobuf );
@@ -1190,9 +1404,13 @@ static int dhcp_deliver ( struct dhcp_session *dhcp,
 		       "ID\n", dhcp, dhcp_msgtype_name ( msgtype ),
 		       inet_ntoa ( peer->sin_addr ),
 		       ntohs ( peer->sin_port ) );
+		dhcp_stats.bad_xid++;
 		rc = -EINVAL;
 		goto err_xid;
 	};
+	dhcp_stats.rx++;
+	if ( msgtype == DHCPNAK )
+		dhcp_stats.naks++;
 
 	/* Handle packet based on current state */
 	dhcp->state->rx ( dhcp, dhcppkt, peer, msgtype, server_id );
@@ -1251,7 +1469,7 @@ static struct interface_descriptor dhcp_job_desc =
 
 /****************************************************************************
  *
- * Instantiators
+ * Shared client socket
  *
  */
 
@@ -1266,11 +1484,232 @@ static struct sockaddr dhcp_peer = {
 	.sa_family = AF_INET,
 };
 
+/** DHCP client socket address */
+static struct sockaddr_in dhcp_client = {
+	.sin_family = AF_INET,
+	.sin_port = htons ( BOOTPC_PORT ),
+};
+
+/**
+ * A user of the shared DHCP client socket
+ *
+ * Only one UDP connection may be bound to the DHCP client port, so
+ * concurrent DHCP sessions (e.g. on several network devices) share a
+ * single connection.  Received packets are passed to the session
+ * with the matching transaction ID.
+ */
+struct dhcp_port {
+	/** Reference counter */
+	struct refcnt refcnt;
+	/** List of shared DHCP client socket users */
+	struct list_head list;
+	/** Data transfer interface */
+	struct interface xfer;
+	/** Transaction ID (in network-endian order) */
+	uint32_t xid;
+};
+
+/** Users of the shared DHCP client socket */
+static LIST_HEAD ( dhcp_ports );
+
+/** Shared DHCP client socket interface descriptor */
+static struct interface_descriptor dhcp_socket_desc;
+
+/** Shared DHCP client socket */
+static struct interface dhcp_socket = INTF_INIT ( dhcp_socket_desc );
+
+/**
+ * Close shared DHCP client socket user
+ *
+ * @v port		Shared DHCP client socket user
+ * @v rc		Reason for close
+ */
+static void dhcp_port_close ( struct dhcp_port *port, int rc ) {
+
+	/* Remove from list of users, if applicable */
+	if ( ! list_empty ( &port->list ) ) {
+		list_del ( &port->list );
+		INIT_LIST_HEAD ( &port->list );
+	}
+
+	/* Shut down interface */
+	intf_shutdown ( &port->xfer, rc );
+
+	/* Close shared socket once it is no longer in use */
+	if ( list_empty ( &dhcp_ports ) )
+		intf_restart ( &dhcp_socket, rc );
+}
+
+/**
+ * Transmit packet via shared DHCP client socket
+ *
+ * @v port		Shared DHCP client socket user
+ * @v iobuf		I/O buffer
+ * @v meta		Data transfer metadata
+ * @ret rc		Return status code
+ */
+static int dhcp_port_deliver ( struct dhcp_port *port __unused,
+			       struct io_buffer *iobuf,
+			       struct xfer_metadata *meta ) {
+	return xfer_deliver ( &dhcp_socket, iobuf, meta );
+}
+
+/** Shared DHCP client socket user interface operations */
+static struct interface_operation dhcp_port_operations[] = {
+	INTF_OP ( xfer_deliver, struct dhcp_port *, dhcp_port_deliver ),
+	INTF_OP ( intf_close, struct dhcp_port *, dhcp_port_close ),
+};
+
+/** Shared DHCP client socket user interface descriptor */
+static struct interface_descriptor dhcp_port_desc =
+	INTF_DESC ( struct dhcp_port, xfer, dhcp_port_operations );
+
+/**
+ * Receive packet via shared DHCP client socket
+ *
+ * @v intf		Shared DHCP client socket
+ * @v iobuf		I/O buffer
+ * @v meta		Data transfer metadata
+ * @ret rc		Return status code
+ */
+static int dhcp_socket_deliver ( struct interface *intf __unused,
+				 struct io_buffer *iobuf,
+				 struct xfer_metadata *meta ) {
+	struct dhcphdr *dhcphdr = iobuf->data;
+	struct dhcp_port *port;
+
+	/* Identify session by transaction ID */
+	if ( iob_len ( iobuf ) >= ( offsetof ( typeof ( *dhcphdr ), xid ) +
+				    sizeof ( dhcphdr->xid ) ) ) {
+		list_for_each_entry ( port, &dhcp_ports, list ) {
+			if ( port->xid == dhcphdr->xid ) {
+				return xfer_deliver ( &port->xfer, iobuf,
+						      meta );
+			}
+		}
+	}
+
+	DBG ( "DHCP discarding packet with unknown transaction ID\n" );
+	free_iob ( iobuf );
+	return -ENOTCONN;
+}
+
+/**
+ * Handle closure of shared DHCP client socket
+ *
+ * @v intf		Shared DHCP client socket
+ * @v rc		Reason for close
+ */
+static void dhcp_socket_close ( struct interface *intf, int rc ) {
+	struct dhcp_port *port;
+	struct dhcp_port *tmp;
+
+	/* Close all users */
+	intf_restart ( intf, rc );
+	list_for_each_entry_safe ( port, tmp, &dhcp_ports, list )
+		dhcp_port_close ( port, rc );
+}
+
+/** Shared DHCP client socket interface operations */
+static struct interface_operation dhcp_socket_operations[] = {
+	INTF_OP ( xfer_deliver, struct interface *, dhcp_socket_deliver ),
+	INTF_OP ( intf_close, struct interface *, dhcp_socket_close ),
+};
+
+/** Shared DHCP client socket interface descriptor */
+static struct interface_descriptor dhcp_socket_desc =
+	INTF_DESC_PURE ( dhcp_socket_operations );
+
+/**
+ * Open shared DHCP client socket
+ *
+ * @v xfer		Data transfer interface
+ * @v xid		Transaction ID (in network-endian order)
+ * @ret rc		Return status code
+ */
+static int dhcp_open_socket ( struct interface *xfer, uint32_t xid ) {
+	struct dhcp_port *port;
+	int rc;
+
+	/* Allocate and initialise structure */
+	port = zalloc ( sizeof ( *port ) );
+	if ( ! port ) {
+		rc = -ENOMEM;
+		goto err_alloc;
+	}
+	ref_init ( &port->refcnt, NULL );
+	intf_init ( &port->xfer, &dhcp_port_desc, &port->refcnt );
+	port->xid = xid;
+
+	/* Open shared socket, if not already open */
+	if ( list_empty ( &dhcp_ports ) ) {
+		if ( ( rc = xfer_open_socket ( &dhcp_socket, SOCK_DGRAM,
+					       &dhcp_peer, ( struct sockaddr * )
+					       &dhcp_client ) ) != 0 ) {
+			DBG ( "DHCP could not open client socket: %s\n",
+			      strerror ( rc ) );
+			goto err_open;
+		}
+	}
+
+	/* Add to list of users, attach to parent interface, mortalise
+	 * self, and return
+	 */
+	list_add ( &port->list, &dhcp_ports );
+	intf_plug_plug ( &port->xfer, xfer );
+	ref_put ( &port->refcnt );
+	return 0;
+
+ err_open:
+	ref_put ( &port->refcnt );
+ err_alloc:
+	return rc;
+}
+
+/****************************************************************************
+ *
+ * Instantiators
+ *
+ */
+
 /**
  * Get cached DHCPACK where none exists
  */
 __weak void get_cached_dhcpack ( void ) { __keepme }
 
+/**
+ * Identify cached lease for use with INIT-REBOOT
+ *
+ * @v dhcp		DHCP session
+ * @ret rc		Return status code
+ *
+ * A lease is reused only if it was obtained via DHCP on this network
+ * device and contains a boot filename (i.e. did not require
+ * ProxyDHCP to complete it).
+ */
+static int dhcp_cached_lease ( struct dhcp_session *dhcp ) {
+	struct settings *parent = netdev_settings ( dhcp->netdev );
+	struct settings *origin;
+
+	/* Identify settings block providing the IP address */
+	origin = fetch_setting_origin ( parent, &ip_setting );
+	if ( ( ! origin ) || ( origin->parent != parent ) ||
+	     ( strcmp ( origin->name, DHCP_SETTINGS_NAME ) != 0 ) )
+		return -ENOENT;
+
+	/* Require a boot filename */
+	if ( ! setting_exists ( origin, &filename_setting ) )
+		return -ENOENT;
+
+	/* Record address to be requested */
+	if ( fetch_ipv4_setting ( origin, &ip_setting, &dhcp->offer ) < 0 )
+		return -ENOENT;
+
+	DBGC ( dhcp, "DHCP %p found cached lease for %s\n",
+	       dhcp, inet_ntoa ( dhcp->offer ) );
+	return 0;
+}
+
 /**
  * Start DHCP state machine on a network device
  *
@@ -1289,6 +1728,7 @@ __weak void get_cached_dhcpack ( void ) { __keepme }
  */
 int start_dhcp ( struct interface *job, struct net_device *netdev ) {
 	struct dhcp_session *dhcp;
+	unsigned long proxy_wait;
 	int rc;
 
 	/* Check for cached DHCP information */
@@ -1310,17 +1750,31 @@ int start_dhcp ( struct interface *job, struct net_device *netdev ) {
 	dhcp->local.sin_family = AF_INET;
 	dhcp->local.sin_port = htons ( BOOTPC_PORT );
 	dhcp->xid = random();
+	dhcp->proxy_timeout = PROXYDHCP_MAX_TIMEOUT;
+	if ( fetch_uint_setting ( NULL, &proxydhcp_wait_setting,
+				  &proxy_wait ) >= 0 ) {
+		if ( proxy_wait < ( ( PROXYDHCP_MAX_TIMEOUT * 1000 ) /
+				    TICKS_PER_SEC ) ) {
+			dhcp->proxy_timeout =
+				( ( proxy_wait * TICKS_PER_SEC ) / 1000 );
+		}
+	}
 
 	/* Store DHCP transaction ID for fakedhcp code */
 	dhcp_last_xid = dhcp->xid;
 
 	/* Instantiate child objects and attach to our interfaces */
-	if ( ( rc = xfer_open_socket ( &dhcp->xfer, SOCK_DGRAM, &dhcp_peer,
-				  ( struct sockaddr * ) &dhcp->local ) ) != 0 )
+	if ( ( rc = dhcp_open_socket ( &dhcp->xfer, dhcp->xid ) ) != 0 )
 		goto err;
 
-	/* Enter DHCPDISCOVER state */
-	dhcp_set_state ( dhcp, &dhcp_state_discover );
+	/* Enter INIT-REBOOT state if we have a cached lease,
+	 * otherwise enter DHCPDISCOVER state.
+	 */
+	if ( dhcp_cached_lease ( dhcp ) == 0 ) {
+		dhcp_set_state ( dhcp, &dhcp_state_reboot );
+	} else {
+		dhcp_set_state ( dhcp, &dhcp_state_discover );
+	}
 
 	/* Attach parent interface, mortalise self, and return */
 	intf_plug_plug ( &dhcp->job, job );
@@ -24,6 +24,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <stdio.h>
 #include <errno.h>
 #include <byteswap.h>
@@ -33,10 +34,14 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/open.h>
 #include <ipxe/resolv.h>
 #include <ipxe/retry.h>
+#include <ipxe/timer.h>
+#include <ipxe/process.h>
 #include <ipxe/tcpip.h>
 #include <ipxe/settings.h>
 #include <ipxe/features.h>
 #include <ipxe/dns.h>
+#include <ipxe/timeline.h>
+#include <config/general.h>
 
 /** @file
  *
@@ -62,6 +67,143 @@ static struct sockaddr_tcpip nameserver = {
 /** The local domain */
 static char *localdomain;
 
+/** Maximum time for which a resolved name is cached (in seconds) */
+#define DNS_CACHE_MAX_TTL 3600
+
+/** Maximum time for which a nonexistent name is cached (in seconds) */
+#define DNS_CACHE_MAX_NEGATIVE_TTL 60
+
+/** A cached DNS response */
+struct dns_cache_entry {
+	/** List of cached responses */
+	struct list_head list;
+	/** Time at which response was cached */
+	unsigned long created;
+	/** Lifetime of cached response (in ticks) */
+	unsigned long lifetime;
+	/** Status code (zero for a resolved name) */
+	int rc;
+	/** Number of resolved addresses */
+	unsigned int count;
+	/** Resolved addresses */
+	struct in_addr in_addr[RESOLV_ADDRESSES];
+	/** Fully-qualified name */
+	char name[0];
+};
+
+/** Cached DNS responses (most recently used first) */
+static LIST_HEAD ( dns_cache );
+
+/**
+ * Delete cached DNS response
+ *
+ * @v entry		Cached response
+ */
+static void dns_cache_del ( struct dns_cache_entry *entry ) {
+
+	list_del ( &entry->list );
+	free ( entry );
+}
+
+/**
+ * Delete all cached DNS responses
+ *
+ */
+static void dns_cache_flush ( void ) {
+	struct dns_cache_entry *entry;
+	struct dns_cache_entry *tmp;
+
+	list_for_each_entry_safe ( entry, tmp, &dns_cache, list )
+		dns_cache_del ( entry );
+}
+
+/**
+ * Find cached DNS response
+ *
+ * @v name		Fully-qualified name
+ * @ret entry		Cached response, or NULL if not found
+ */
+static struct dns_cache_entry * dns_cache_find ( const char *name ) {
+	struct dns_cache_entry *entry;
+	struct dns_cache_entry *tmp;
+	unsigned long now = currticks();
+
+	list_for_each_entry_safe ( entry, tmp, &dns_cache, list ) {
+
+		/* Discard expired responses */
+		if ( ( now - entry->created ) >= entry->lifetime ) {
+			DBG ( "DNS cached response for \"%s\" expired\n",
+			      entry->name );
+			dns_cache_del ( entry );
+			continue;
+		}
+
+		/* Move matching response to head of list */
+		if ( strcasecmp ( entry->name, name ) == 0 ) {
+			list_del ( &entry->list );
+			list_add ( &entry->list, &dns_cache );
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * Add DNS response to cache
+ *
+ * @v name		Fully-qualified name
+ * @v in_addr		Resolved addresses
+ * @v count		Number of addresses (zero for a nonexistent name)
+ * @v ttl		Time-to-live (in seconds)
+ * @v rc		Status code (zero for a resolved name)
+ */
+static void dns_cache_add ( const char *name, const struct in_addr *in_addr,
+			    unsigned int count, unsigned long ttl, int rc ) {
+	struct dns_cache_entry *entry;
+	struct dns_cache_entry *tmp;
+	unsigned int cached = 0;
+	size_t name_len;
+
+	/* Do nothing if caching is disabled or response must not be
+	 * cached.
+	 */
+	if ( ( ! DNS_CACHE ) || ( ! ttl ) )
+		return;
+
+	/* Replace any existing response for this name */
+	list_for_each_entry_safe ( entry, tmp, &dns_cache, list ) {
+		if ( strcasecmp ( entry->name, name ) == 0 ) {
+			dns_cache_del ( entry );
+		} else {
+			cached++;
+		}
+	}
+
+	/* Evict least recently used response if cache is full */
+	if ( ( cached + 1 ) > DNS_CACHE ) {
+		entry = list_entry ( dns_cache.prev, struct dns_cache_entry,
+				     list );
+		dns_cache_del ( entry );
+	}
+
+	/* Allocate and populate cache entry */
+	name_len = ( strlen ( name ) + 1 /* NUL */ );
+	entry = zalloc ( sizeof ( *entry ) + name_len );
+	if ( ! entry )
+		return;
+	entry->created = currticks();
+	entry->lifetime = ( ttl * TICKS_PER_SEC );
+	entry->rc = rc;
+	entry->count = count;
+	memcpy ( entry->in_addr, in_addr, ( count * sizeof ( in_addr[0] ) ) );
+	memcpy ( entry->name, name, name_len );
+	list_add ( &entry->list, &dns_cache );
+	DBG ( "DNS caching %s (%d addresses) for \"%s\" for %lus\n",
+	      ( count ? inet_ntoa ( in_addr[0] ) : strerror ( rc ) ),
+	      count, name, ttl );
+}
+
 /** A DNS request */
 struct dns_request {
 	/** Reference counter */
@@ -72,9 +214,15 @@ struct dns_request {
 	struct interface socket;
 	/** Retry timer */
 	struct retry_timer timer;
+	/** Cached response process */
+	struct process process;
 
 	/** Socket address to fill in with resolved address */
 	struct sockaddr sa;
+	/** Number of resolved addresses */
+	unsigned int count;
+	/** Resolved addresses */
+	struct in_addr in_addr[RESOLV_ADDRESSES];
 	/** Current query packet */
 	struct dns_query query;
 	/** Location of query info structure within current packet
@@ -85,6 +233,15 @@ struct dns_request {
 	struct dns_query_info *qinfo;
 	/** Recursion counter */
 	unsigned int recursion;
+	/** Minimum time-to-live of records used (in seconds) */
+	unsigned long ttl;
+	/** Status code of cached response (if applicable) */
+	int rc;
+	/** Fully-qualified name being resolved
+	 *
+	 * Must be at end of structure
+	 */
+	char name[0];
 };
 
 /**
@@ -95,14 +252,32 @@ struct dns_request {
  */
 static void dns_done ( struct dns_request *dns, int rc ) {
 
-	/* Stop the retry timer */
+	/* Stop the retry timer and cached response process */
 	stop_timer ( &dns->timer );
+	process_del ( &dns->process );
+	timeline_end ( "net", "dns", dns, NULL );
 
 	/* Shut down interfaces */
 	intf_shutdown ( &dns->socket, rc );
 	intf_shutdown ( &dns->resolv, rc );
 }
 
+/**
+ * Return resolved addresses
+ *
+ * @v dns		DNS request
+ */
+static void dns_resolved ( struct dns_request *dns ) {
+	struct sockaddr_in *sin = ( ( struct sockaddr_in * ) &dns->sa );
+	unsigned int i;
+
+	for ( i = 0 ; i < dns->count ; i++ ) {
+		sin->sin_family = AF_INET;
+		sin->sin_addr = dns->in_addr[i];
+		resolv_done ( &dns->resolv, &dns->sa );
+	}
+}
+
 /**
  * Compare DNS reply name against the query name from the original request
  *
@@ -164,10 +339,12 @@ static const char * dns_skip_name ( const char *name ) {
  *
  * @v dns		DNS request
  * @v reply		DNS reply
+ * @v prev		Previously found RR, or NULL to search from the start
  * @ret rr		DNS RR, or NULL if not found
  */
 static union dns_rr_info * dns_find_rr ( struct dns_request *dns,
-					 const struct dns_header *reply ) {
+					 const struct dns_header *reply,
+					 const union dns_rr_info *prev ) {
 	int i, cmp;
 	const char *p = ( ( char * ) reply ) + sizeof ( struct dns_header );
 	union dns_rr_info *rr_info;
@@ -182,7 +359,7 @@ static union dns_rr_info * dns_find_rr ( struct dns_request *dns,
 		cmp = dns_name_cmp ( dns, reply, p );
 		p = dns_skip_name ( p );
 		rr_info = ( ( union dns_rr_info * ) p );
-		if ( cmp == 0 )
+		if ( ( cmp == 0 ) && ( ( ! prev ) || ( rr_info > prev ) ) )
 			return rr_info;
 		p += ( sizeof ( rr_info->common ) +
 		       ntohs ( rr_info->common.rdlength ) );
@@ -191,6 +368,72 @@ static union dns_rr_info * dns_find_rr ( struct dns_request *dns,
 	return NULL;
 }
 
+/**
+ * Record time-to-live of DNS RR
+ *
+ * @v dns		DNS request
+ * @v rr_info		DNS RR
+ */
+static void dns_record_ttl ( struct dns_request *dns,
+			     const union dns_rr_info *rr_info ) {
+	unsigned long ttl = ntohl ( rr_info->common.ttl );
+
+	if ( ttl < dns->ttl )
+		dns->ttl = ttl;
+}
+
+/**
+ * Determine time-to-live of negative DNS reply
+ *
+ * @v reply		DNS reply
+ * @v len		Length of DNS reply
+ * @ret ttl		Time-to-live (in seconds), or zero if uncacheable
+ *
+ * The negative caching time is taken from the SOA record within the
+ * authority section (RFC 2308 section 5).  A negative reply without
+ * an SOA record must not be cached.
+ */
+static unsigned long dns_negative_ttl ( const struct dns_header *reply,
+					size_t len ) {
+	const char *p = ( ( char * ) reply ) + sizeof ( struct dns_header );
+	const char *end = ( ( ( char * ) reply ) + len );
+	const union dns_rr_info *rr_info;
+	const struct dns_soa_info *soa;
+	unsigned long ttl;
+	unsigned int records;
+	unsigned int i;
+
+	/* Skip over the questions section */
+	for ( i = ntohs ( reply->qdcount ) ; i > 0 ; i-- ) {
+		p = dns_skip_name ( p ) + sizeof ( struct dns_query_info );
+	}
+
+	/* Process the answers and authority sections */
+	records = ( ntohs ( reply->ancount ) + ntohs ( reply->nscount ) );
+	for ( i = 0 ; i < records ; i++ ) {
+		rr_info = ( ( union dns_rr_info * ) dns_skip_name ( p ) );
+		p = ( ( ( char * ) rr_info ) + sizeof ( rr_info->common ) +
+		      ntohs ( rr_info->common.rdlength ) );
+		if ( p > end )
+			break;
+		if ( ( i < ntohs ( reply->ancount ) ) ||
+		     ( rr_info->common.type != htons ( DNS_TYPE_SOA ) ) )
+			continue;
+		soa = ( ( struct dns_soa_info * ) dns_skip_name (
+				dns_skip_name ( rr_info->soa.mname ) ) );
+		if ( ( ( char * ) ( soa + 1 ) ) > p )
+			break;
+		ttl = ntohl ( rr_info->common.ttl );
+		if ( ttl > ntohl ( soa->minimum ) )
+			ttl = ntohl ( soa->minimum );
+		if ( ttl > DNS_CACHE_MAX_NEGATIVE_TTL )
+			ttl = DNS_CACHE_MAX_NEGATIVE_TTL;
+		return ttl;
+	}
+
+	return 0;
+}
+
 /**
  * Append DHCP domain name if available and name is not fully qualified
  *
@@ -344,7 +587,6 @@ static int dns_xfer_deliver ( struct dns_request *dns,
 			      struct xfer_metadata *meta __unused ) {
 	const struct dns_header *reply = iobuf->data;
 	union dns_rr_info *rr_info;
-	struct sockaddr_in *sin;
 	unsigned int qtype = dns->qinfo->qtype;
 	int rc;
 
@@ -379,20 +621,34 @@ static int dns_xfer_deliver ( struct dns_request *dns,
 	 * which send us e.g. the CNAME *and* the A record for the
 	 * pointed-to name.
 	 */
-	while ( ( rr_info = dns_find_rr ( dns, reply ) ) ) {
+	while ( ( rr_info = dns_find_rr ( dns, reply, NULL ) ) ) {
 		switch ( rr_info->common.type ) {
 
 		case htons ( DNS_TYPE_A ):
 
-			/* Found the target A record */
-			DBGC ( dns, "DNS %p found address %s\n",
-			       dns, inet_ntoa ( rr_info->a.in_addr ) );
-			sin = ( struct sockaddr_in * ) &dns->sa;
-			sin->sin_family = AF_INET;
-			sin->sin_addr = rr_info->a.in_addr;
-
-			/* Return resolved address */
-			resolv_done ( &dns->resolv, &dns->sa );
+			/* Found the target A record.  Record this and
+			 * any further A records for the same name, in
+			 * the order given by the server.
+			 */
+			do {
+				if ( rr_info->common.type !=
+				     htons ( DNS_TYPE_A ) )
+					continue;
+				DBGC ( dns, "DNS %p found address %s\n", dns,
+				       inet_ntoa ( rr_info->a.in_addr ) );
+				dns_record_ttl ( dns, rr_info );
+				dns->in_addr[ dns->count++ ] =
+					rr_info->a.in_addr;
+			} while ( ( dns->count < RESOLV_ADDRESSES ) &&
+				  ( rr_info = dns_find_rr ( dns, reply,
+							    rr_info ) ) );
+
+			/* Cache resolved addresses */
+			dns_cache_add ( dns->name, dns->in_addr, dns->count,
+					dns->ttl, 0 );
+
+			/* Return resolved addresses */
+			dns_resolved ( dns );
 
 			/* Mark operation as complete */
 			dns_done ( dns, 0 );
@@ -403,6 +659,7 @@ static int dns_xfer_deliver ( struct dns_request *dns,
 
 			/* Found a CNAME record; update query and recurse */
 			DBGC ( dns, "DNS %p found CNAME\n", dns );
+			dns_record_ttl ( dns, rr_info );
 			dns->qinfo = ( void * ) dns_decompress_name ( reply,
 							 rr_info->cname.cname,
 							 dns->query.payload );
@@ -452,6 +709,10 @@ static int dns_xfer_deliver ( struct dns_request *dns,
 			goto done;
 		} else {
 			DBGC ( dns, "DNS %p found no CNAME record\n", dns );
+			dns_cache_add ( dns->name, NULL, 0,
+					dns_negative_ttl ( reply,
+							   iob_len ( iobuf ) ),
+					-ENXIO_NO_RECORD );
 			dns_done ( dns, -ENXIO_NO_RECORD );
 			rc = 0;
 			goto done;
@@ -503,6 +764,22 @@ static struct interface_operation dns_resolv_op[] = {
 static struct interface_descriptor dns_resolv_desc =
 	INTF_DESC ( struct dns_request, resolv, dns_resolv_op );
 
+/**
+ * Complete DNS request using cached response
+ *
+ * @v dns		DNS request
+ */
+static void dns_cached ( struct dns_request *dns ) {
+
+	if ( dns->rc == 0 )
+		dns_resolved ( dns );
+	dns_done ( dns, dns->rc );
+}
+
+/** DNS cached response process descriptor */
+static struct process_descriptor dns_process_desc =
+	PROC_DESC_ONCE ( struct dns_request, process, dns_cached );
+
 /**
  * Resolve name using DNS
  *
@@ -513,7 +790,9 @@ static struct interface_descriptor dns_resolv_desc =
  */
 static int dns_resolv ( struct interface *resolv,
 			const char *name, struct sockaddr *sa ) {
+	struct dns_cache_entry *entry;
 	struct dns_request *dns;
+	size_t fqdn_len;
 	char *fqdn;
 	int rc;
 
@@ -533,7 +812,8 @@ static int dns_resolv ( struct interface *resolv,
 	}
 
 	/* Allocate DNS structure */
-	dns = zalloc ( sizeof ( *dns ) );
+	fqdn_len = ( strlen ( fqdn ) + 1 /* NUL */ );
+	dns = zalloc ( sizeof ( *dns ) + fqdn_len );
 	if ( ! dns ) {
 		rc = -ENOMEM;
 		goto err_alloc_dns;
@@ -542,7 +822,23 @@ static int dns_resolv ( struct interface *resolv,
 	intf_init ( &dns->resolv, &dns_resolv_desc, &dns->refcnt );
 	intf_init ( &dns->socket, &dns_socket_desc, &dns->refcnt );
 	timer_init ( &dns->timer, dns_timer_expired, &dns->refcnt );
+	process_init_stopped ( &dns->process, &dns_process_desc,
+			       &dns->refcnt );
 	memcpy ( &dns->sa, sa, sizeof ( dns->sa ) );
+	memcpy ( dns->name, fqdn, fqdn_len );
+	dns->ttl = DNS_CACHE_MAX_TTL;
+
+	/* Use cached response, if available */
+	if ( ( entry = dns_cache_find ( fqdn ) ) != NULL ) {
+		DBGC ( dns, "DNS %p using cached response for \"%s\"\n",
+		       dns, fqdn );
+		dns->count = entry->count;
+		memcpy ( dns->in_addr, entry->in_addr,
+			 sizeof ( dns->in_addr ) );
+		dns->rc = entry->rc;
+		process_add ( &dns->process );
+		goto attach;
+	}
 
 	/* Create query */
 	dns->query.dns.flags = htons ( DNS_FLAG_QUERY | DNS_FLAG_OPCODE_QUERY |
@@ -564,6 +860,9 @@ static int dns_resolv ( struct interface *resolv,
 	/* Send first DNS packet */
 	dns_send_packet ( dns );
 
+ attach:
+	timeline_begin ( "net", "dns", dns, dns->name );
+
 	/* Attach parent interface, mortalise self, and return */
 	intf_plug_plug ( &dns->resolv, resolv );
 	ref_put ( &dns->refcnt );
@@ -616,9 +915,12 @@ struct setting domain_setting __setting ( SETTING_IPv4_EXTRA ) = {
 static int apply_dns_settings ( void ) {
 	struct sockaddr_in *sin_nameserver =
 		( struct sockaddr_in * ) &nameserver;
+
+	struct sockaddr_tcpip old_nameserver;
 	int len;
 
 	/* Fetch DNS server address */
+	memcpy ( &old_nameserver, &nameserver, sizeof ( old_nameserver ) );
 	nameserver.st_family = 0;
 	if ( ( len = fetch_ipv4_setting ( NULL, &dns_setting,
 					  &sin_nameserver->sin_addr ) ) >= 0 ){
@@ -627,6 +929,11 @@ static int apply_dns_settings ( void ) {
 		      inet_ntoa ( sin_nameserver->sin_addr ) );
 	}
 
+	/* Discard cached responses if DNS server has changed */
+	if ( memcmp ( &old_nameserver, &nameserver,
+		      sizeof ( old_nameserver ) ) != 0 )
+		dns_cache_flush();
+
 	/* Get local domain DHCP option */
 	free ( localdomain );
 	if ( ( len = fetch_string_setting_copy ( NULL, &domain_setting,
@@ -103,14 +103,24 @@ FEATURE ( FEATURE_PROTOCOL, "SLAM", DHCP_EB_FEATURE_SLAM, 1 );
  */
 #define SLAM_MAX_BLOCKS_PER_NACK 4
 
-/** Maximum SLAM NACK length
+/** Maximum number of missing ranges to request per NACK
  *
- * We only ever send a NACK for a single range of up to @c
- * SLAM_MAX_BLOCKS_PER_NACK blocks.
+ * Scattered losses may be requested via a single NACK, subject to
+ * the overall limit of @c SLAM_MAX_BLOCKS_PER_NACK blocks.
  */
-#define SLAM_MAX_NACK_LEN ( 7 /* block */ + 7 /* #blocks */ + 1 /* NUL */ )
+#define SLAM_MAX_NACK_RANGES SLAM_MAX_BLOCKS_PER_NACK
 
-/** SLAM slave timeout */
+/** Maximum SLAM NACK length */
+#define SLAM_MAX_NACK_LEN ( SLAM_MAX_NACK_RANGES *			\
+			    ( 7 /* #received */ + 7 /* #missing */ ) +	\
+			    1 /* NUL */ )
+
+/** SLAM slave timeout
+ *
+ * The actual timeout is randomised to lie within the range [ 0.5 ,
+ * 1.5 ) times this value, so that large numbers of slave clients do
+ * not all attempt to become the master client at the same instant.
+ */
 #define SLAM_SLAVE_TIMEOUT ( 1 * TICKS_PER_SEC )
 
 /** A SLAM request */
@@ -159,6 +169,16 @@ static void slam_free ( struct refcnt *refcnt ) {
 	free ( slam );
 }
 
+/**
+ * Choose randomised SLAM slave timeout
+ *
+ * @ret timeout		Slave timeout
+ */
+static unsigned long slam_slave_timeout ( void ) {
+	return ( ( SLAM_SLAVE_TIMEOUT / 2 ) +
+		 ( random() % SLAM_SLAVE_TIMEOUT ) );
+}
+
 /**
  * Mark SLAM request as complete
  *
@@ -250,6 +270,10 @@ static int slam_tx_nack ( struct slam_request *slam ) {
 	struct io_buffer *iobuf;
 	unsigned long first_block;
 	unsigned long num_blocks;
+	unsigned long next_block;
+	unsigned long received;
+	unsigned int remaining;
+	unsigned int ranges;
 	uint8_t *nul;
 	int rc;
 
@@ -264,39 +288,66 @@ static int slam_tx_nack ( struct slam_request *slam ) {
 		return -ENOMEM;
 	}
 
-	/* Construct NACK.  We always request only a single packet;
-	 * this allows us to force multicast-TFTP-style flow control
-	 * on the SLAM server, which will otherwise just blast the
-	 * data out as fast as it can.  On a gigabit network, without
-	 * RX checksumming, this would inevitably cause packet drops.
+	/* Construct NACK.  We only ever request a few packets; this
+	 * allows us to force multicast-TFTP-style flow control on the
+	 * SLAM server, which will otherwise just blast the data out
+	 * as fast as it can.  On a gigabit network, without RX
+	 * checksumming, this would inevitably cause packet drops.
+	 *
+	 * Within that limit, we request each missing range in turn,
+	 * so that scattered losses may be repaired via a single NACK.
+	 * If we do not yet know the number of blocks, we request only
+	 * the first block.
 	 */
 	first_block = bitmap_first_gap ( &slam->bitmap );
-	for ( num_blocks = 1 ; ; num_blocks++ ) {
-		if ( num_blocks >= SLAM_MAX_BLOCKS_PER_NACK )
-			break;
-		if ( ( first_block + num_blocks ) >= slam->num_blocks )
+	remaining = ( SLAM_MAX_BLOCKS_PER_NACK - 1 );
+	if ( ! slam->num_blocks )
+		remaining = 0;
+	num_blocks = 1;
+	for ( received = first_block, ranges = 0 ;
+	      ranges < SLAM_MAX_NACK_RANGES ; ranges++ ) {
+
+		/* Extend missing range as far as possible */
+		while ( remaining &&
+			( ( first_block + num_blocks ) < slam->num_blocks ) &&
+			( ! bitmap_test ( &slam->bitmap,
+					  ( first_block + num_blocks ) ) ) ) {
+			num_blocks++;
+			remaining--;
+		}
+		DBGCP ( slam, "SLAM %p requesting blocks %ld-%ld\n", slam,
+			first_block, ( first_block + num_blocks - 1 ) );
+
+		/* Add received range and missing range */
+		if ( ( rc = slam_put_value ( slam, iobuf, received ) ) != 0 )
+			goto err;
+		if ( ( rc = slam_put_value ( slam, iobuf, num_blocks ) ) != 0 )
+			goto err;
+
+		/* Find next missing range, if any */
+		if ( ! remaining )
 			break;
-		if ( bitmap_test ( &slam->bitmap,
-				   ( first_block + num_blocks ) ) )
+		next_block = bitmap_next_gap ( &slam->bitmap,
+					       ( first_block + num_blocks ) );
+		if ( next_block >= slam->num_blocks )
 			break;
+		received = ( next_block - first_block - num_blocks );
+		first_block = next_block;
+		num_blocks = 1;
+		remaining--;
 	}
-	if ( first_block ) {
-		DBGCP ( slam, "SLAM %p transmitting NACK for blocks "
-			"%ld-%ld\n", slam, first_block,
-			( first_block + num_blocks - 1 ) );
-	} else {
-		DBGC ( slam, "SLAM %p transmitting initial NACK for blocks "
-		       "0-%ld\n", slam, ( num_blocks - 1 ) );
+	if ( ! bitmap_first_gap ( &slam->bitmap ) ) {
+		DBGC ( slam, "SLAM %p transmitted initial NACK\n", slam );
 	}
-	if ( ( rc = slam_put_value ( slam, iobuf, first_block ) ) != 0 )
-		return rc;
-	if ( ( rc = slam_put_value ( slam, iobuf, num_blocks ) ) != 0 )
-		return rc;
 	nul = iob_put ( iobuf, 1 );
 	*nul = 0;
 
 	/* Transmit packet */
 	return xfer_deliver_iob ( &slam->socket, iobuf );
+
+ err:
+	free_iob ( iobuf );
+	return rc;
 }
 
 /**
@@ -438,6 +489,13 @@ static int slam_pull_header ( struct slam_request *slam,
 	assert ( slam->header_len <= sizeof ( slam->header ) );
 	memcpy ( slam->header, header, slam->header_len );
 
+	/* Sanity check block size */
+	if ( ! slam->block_size ) {
+		DBGC ( slam, "SLAM %p invalid zero block size\n", slam );
+		slam->header_len = 0;
+		return -EINVAL;
+	}
+
 	/* Calculate number of blocks */
 	slam->num_blocks = ( ( slam->total_bytes + slam->block_size - 1 ) /
 			     slam->block_size );
@@ -485,7 +543,7 @@ static int slam_mc_socket_deliver ( struct slam_request *slam,
 	/* Stop the master client timer.  Restart the slave client timer. */
 	stop_timer ( &slam->master_timer );
 	stop_timer ( &slam->slave_timer );
-	start_timer_fixed ( &slam->slave_timer, SLAM_SLAVE_TIMEOUT );
+	start_timer_fixed ( &slam->slave_timer, slam_slave_timeout() );
 
 	/* Read and strip packet header */
 	if ( ( rc = slam_pull_header ( slam, iobuf ) ) != 0 )
@@ -736,7 +794,7 @@ static int slam_open ( struct interface *xfer, struct uri *uri ) {
 	}
 
 	/* Start slave retry timer */
-	start_timer_fixed ( &slam->slave_timer, SLAM_SLAVE_TIMEOUT );
+	start_timer_fixed ( &slam->slave_timer, slam_slave_timeout() );
 
 	/* Attach to parent interface, mortalise self, and return */
 	intf_plug_plug ( &slam->xfer, xfer );
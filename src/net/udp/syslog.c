@@ -25,7 +25,10 @@ FILE_LICENCE ( GPL2_OR_LATER );
  */
 
 #include <stdint.h>
+#include <stdio.h>
+#include <errno.h>
 #include <byteswap.h>
+#include <ipxe/iobuf.h>
 #include <ipxe/xfer.h>
 #include <ipxe/open.h>
 #include <ipxe/tcpip.h>
@@ -34,6 +37,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/console.h>
 #include <ipxe/lineconsole.h>
 #include <ipxe/syslog.h>
+#include <ipxe/log.h>
 #include <config/console.h>
 
 /* Set default console usage if applicable */
@@ -68,6 +72,15 @@ static struct interface syslogger = INTF_INIT ( syslogger_desc );
 /** Syslog line buffer */
 static char syslog_buffer[SYSLOG_BUFSIZE];
 
+/** Syslog ring buffer data */
+static char syslog_ring_data[SYSLOG_RING_SIZE];
+
+static int syslog_flush ( struct log_ring *ring );
+
+/** Syslog ring buffer */
+struct log_ring syslog_ring __log_ring =
+	LOG_RING_INIT ( syslog_ring, syslog_ring_data, syslog_flush );
+
 /** Syslog severity */
 static unsigned int syslog_severity = SYSLOG_DEFAULT_SEVERITY;
 
@@ -104,13 +117,67 @@ static struct line_console syslog_line = {
 /** Syslog recursion marker */
 static int syslog_entered;
 
+/**
+ * Transmit queued syslog messages
+ *
+ * @v ring		Log ring
+ * @ret rc		Return status code
+ *
+ * Each record is sent as a separate datagram, since a syslog server
+ * treats each datagram as a single message.
+ */
+static int syslog_flush ( struct log_ring *ring ) {
+	struct io_buffer *iobuf;
+	size_t len;
+	int rc;
+
+	/* Allocate I/O buffer for first record */
+	len = log_ring_record_len ( ring );
+	if ( ! len )
+		return -ENOENT;
+	iobuf = xfer_alloc_iob ( &syslogger, len );
+	if ( ! iobuf )
+		return -ENOMEM;
+
+	/* Remove record, stripping the terminating newline */
+	log_ring_get ( ring, iob_put ( iobuf, len ), len );
+	iob_unput ( iobuf, 1 );
+
+	/* Send log message, guarding against re-entry */
+	syslog_entered = 1;
+	if ( ( rc = xfer_deliver_iob ( &syslogger, iobuf ) ) != 0 ) {
+		DBG ( "SYSLOG could not send log message: %s\n",
+		      strerror ( rc ) );
+	}
+	syslog_entered = 0;
+
+	return rc;
+}
+
+/**
+ * Queue syslog message
+ *
+ * @v message		Message text
+ * @ret rc		Return status code
+ */
+static int syslog_queue ( const char *message ) {
+	char record[ SYSLOG_BUFSIZE + SYSLOG_HEADER_LEN ];
+	size_t len;
+
+	len = snprintf ( record, sizeof ( record ), "<%d>ipxe: %s\n",
+			 SYSLOG_PRIORITY ( SYSLOG_DEFAULT_FACILITY,
+					   syslog_severity ), message );
+	return log_ring_put ( &syslog_ring, record, len );
+}
+
 /**
  * Print a character to syslog console
  *
  * @v character		Character to be printed
  */
 static void syslog_putchar ( int character ) {
-	int rc;
+	char message[SYSLOG_DROPPED_LEN];
+	unsigned int dropped;
 
 	/* Ignore if we are already mid-logging */
 	if ( syslog_entered )
@@ -123,14 +190,16 @@ static void syslog_putchar ( int character ) {
 	/* Guard against re-entry */
 	syslog_entered = 1;
 
-	/* Send log message */
-	if ( ( rc = xfer_printf ( &syslogger, "<%d>ipxe: %s",
-				  SYSLOG_PRIORITY ( SYSLOG_DEFAULT_FACILITY,
-						    syslog_severity ),
-				  syslog_buffer ) ) != 0 ) {
-		DBG ( "SYSLOG could not send log message: %s\n",
-		      strerror ( rc ) );
+	/* Report any dropped messages, then queue log message */
+	dropped = syslog_ring.dropped;
+	if ( dropped ) {
+		snprintf ( message, sizeof ( message ), "[%d messages dropped]",
+			   dropped );
+		syslog_ring.dropped = 0;
+		if ( syslog_queue ( message ) != 0 )
+			syslog_ring.dropped = dropped;
 	}
+	syslog_queue ( syslog_buffer );
 
 	/* Clear re-entry flag */
 	syslog_entered = 0;
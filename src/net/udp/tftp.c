@@ -39,6 +39,8 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/dhcp.h>
 #include <ipxe/uri.h>
 #include <ipxe/tftp.h>
+#include <ipxe/netstat.h>
+#include <config/general.h>
 
 /** @file
  *
@@ -70,6 +72,9 @@ FEATURE ( FEATURE_PROTOCOL, "TFTP", DHCP_EB_FEATURE_TFTP, 1 );
 #define EINVAL_MC_INVALID_PORT __einfo_error ( EINFO_EINVAL_MC_INVALID_PORT )
 #define EINFO_EINVAL_MC_INVALID_PORT __einfo_uniqify \
 	( EINFO_EINVAL, 0x07, "Invalid multicast port" )
+#define EINVAL_WINDOWSIZE __einfo_error ( EINFO_EINVAL_WINDOWSIZE )
+#define EINFO_EINVAL_WINDOWSIZE __einfo_uniqify \
+	( EINFO_EINVAL, 0x08, "Invalid windowsize" )
 
 /**
  * A TFTP request
@@ -103,6 +108,16 @@ struct tftp_request {
 	 * "tsize" option, this value will be zero.
 	 */
 	unsigned long tsize;
+	/** Window size
+	 *
+	 * This is the "windowsize" option negotiated with the TFTP
+	 * server.  (If the TFTP server does not support the
+	 * "windowsize" option, this will default to 1, i.e. a
+	 * lock-step transfer).
+	 */
+	unsigned int windowsize;
+	/** Number of blocks received since the last ACK */
+	unsigned int window_count;
 	
 	/** Server port
 	 *
@@ -150,11 +165,34 @@ enum {
 	TFTP_FL_MTFTP_RECOVERY = 0x0008,
 	/** Only get filesize and then abort the transfer */
 	TFTP_FL_SIZEONLY = 0x0010,
+	/** Request windowsize option */
+	TFTP_FL_RRQ_WINDOWSIZE = 0x0020,
 };
 
 /** Maximum number of MTFTP open requests before falling back to TFTP */
 #define MTFTP_MAX_TIMEOUTS 3
 
+/** TFTP statistics */
+struct tftp_statistics {
+	/** Number of timeouts after the server has responded */
+	unsigned int timeouts;
+	/** Number of data blocks received ahead of a missing block */
+	unsigned int gaps;
+	/** Number of ERROR packets received */
+	unsigned int errors;
+};
+
+/** TFTP statistics */
+static struct tftp_statistics tftp_stats;
+
+/** TFTP statistics */
+struct net_statistic tftp_net_statistics[]
+	__net_statistic ( NET_STAT_APPLICATION ) = {
+	{ "TFTP", "TIMEOUT", &tftp_stats.timeouts },
+	{ "TFTP", "GAP", &tftp_stats.gaps },
+	{ "TFTP", "ERROR", &tftp_stats.errors },
+};
+
 /**
  * Free TFTP request
  *
@@ -208,6 +246,10 @@ static int tftp_reopen ( struct tftp_request *tftp ) {
 	/* Reset peer address */
 	memset ( &tftp->peer, 0, sizeof ( tftp->peer ) );
 
+	/* Revert to lock-step transfers until a window is negotiated */
+	tftp->windowsize = TFTP_DEFAULT_WINDOWSIZE;
+	tftp->window_count = 0;
+
 	/* Open socket */
 	memset ( &server, 0, sizeof ( server ) );
 	server.st_port = htons ( tftp->port );
@@ -304,6 +346,13 @@ void tftp_set_request_blksize ( unsigned int blksize ) {
 	tftp_request_blksize = blksize;
 }
 
+/**
+ * TFTP requested window size
+ *
+ * This is treated as a global configuration parameter.
+ */
+static unsigned int tftp_request_windowsize = TFTP_WINDOWSIZE;
+
 /**
  * MTFTP multicast receive address
  *
@@ -364,6 +413,7 @@ static int tftp_send_rrq ( struct tftp_request *tftp ) {
 		+ 5 + 1 /* "octet" + NUL */
 		+ 7 + 1 + 5 + 1 /* "blksize" + NUL + ddddd + NUL */
 		+ 5 + 1 + 1 + 1 /* "tsize" + NUL + "0" + NUL */ 
+		+ 10 + 1 + 5 + 1 /* "windowsize" + NUL + ddddd + NUL */
 		+ 9 + 1 + 1 /* "multicast" + NUL + NUL */ );
 	iobuf = xfer_alloc_iob ( &tftp->socket, len );
 	if ( ! iobuf )
@@ -380,6 +430,13 @@ static int tftp_send_rrq ( struct tftp_request *tftp ) {
 					    "blksize%c%d%ctsize%c0", 0,
 					    tftp_request_blksize, 0, 0 ) + 1 );
 	}
+	if ( ( tftp->flags & TFTP_FL_RRQ_WINDOWSIZE ) &&
+	     ( tftp_request_windowsize > TFTP_DEFAULT_WINDOWSIZE ) ) {
+		iob_put ( iobuf, snprintf ( iobuf->tail,
+					    iob_tailroom ( iobuf ),
+					    "windowsize%c%d", 0,
+					    tftp_request_windowsize ) + 1 );
+	}
 	if ( tftp->flags & TFTP_FL_RRQ_MULTICAST ) {
 		iob_put ( iobuf, snprintf ( iobuf->tail,
 					    iob_tailroom ( iobuf ),
@@ -410,6 +467,9 @@ static int tftp_send_ack ( struct tftp_request *tftp ) {
 	block = bitmap_first_gap ( &tftp->bitmap );
 	DBGC2 ( tftp, "TFTP %p sending ACK for block %d\n", tftp, block );
 
+	/* Start a new window */
+	tftp->window_count = 0;
+
 	/* Allocate buffer */
 	iobuf = xfer_alloc_iob ( &tftp->socket, sizeof ( *ack ) );
 	if ( ! iobuf )
@@ -502,6 +562,10 @@ static void tftp_timer_expired ( struct retry_timer *timer, int fail ) {
 		container_of ( timer, struct tftp_request, timer );
 	int rc;
 
+	/* Record timeout, unless this is the initial request */
+	if ( tftp->peer.st_family )
+		tftp_stats.timeouts++;
+
 	/* If we are doing MTFTP, attempt the various recovery strategies */
 	if ( tftp->flags & TFTP_FL_MTFTP_RECOVERY ) {
 		if ( tftp->peer.st_family ) {
@@ -520,7 +584,8 @@ static void tftp_timer_expired ( struct retry_timer *timer, int fail ) {
 			if ( tftp->mtftp_timeouts > MTFTP_MAX_TIMEOUTS ) {
 				DBGC ( tftp, "TFTP %p falling back to plain "
 				       "TFTP\n", tftp );
-				tftp->flags = TFTP_FL_RRQ_SIZES;
+				tftp->flags = ( TFTP_FL_RRQ_SIZES |
+						TFTP_FL_RRQ_WINDOWSIZE );
 
 				/* Close multicast socket */
 				intf_restart ( &tftp->mc_socket, 0 );
@@ -601,6 +666,30 @@ static int tftp_process_tsize ( struct tftp_request *tftp,
 	return 0;
 }
 
+/**
+ * Process TFTP "windowsize" option
+ *
+ * @v tftp		TFTP connection
+ * @v value		Option value
+ * @ret rc		Return status code
+ */
+static int tftp_process_windowsize ( struct tftp_request *tftp,
+				     const char *value ) {
+	char *end;
+
+	tftp->windowsize = strtoul ( value, &end, 10 );
+	if ( *end || ( tftp->windowsize < TFTP_DEFAULT_WINDOWSIZE ) ||
+	     ( tftp->windowsize > tftp_request_windowsize ) ) {
+		DBGC ( tftp, "TFTP %p got invalid windowsize \"%s\"\n",
+		       tftp, value );
+		tftp->windowsize = TFTP_DEFAULT_WINDOWSIZE;
+		return -EINVAL_WINDOWSIZE;
+	}
+	DBGC ( tftp, "TFTP %p windowsize=%d\n", tftp, tftp->windowsize );
+
+	return 0;
+}
+
 /**
  * Process TFTP "multicast" option
  *
@@ -688,6 +777,7 @@ struct tftp_option {
 static struct tftp_option tftp_options[] = {
 	{ "blksize", tftp_process_blksize },
 	{ "tsize", tftp_process_tsize },
+	{ "windowsize", tftp_process_windowsize },
 	{ "multicast", tftp_process_multicast },
 	{ NULL, NULL }
 };
@@ -812,6 +902,7 @@ static int tftp_rx_data ( struct tftp_request *tftp,
 			  struct io_buffer *iobuf ) {
 	struct tftp_data *data = iobuf->data;
 	struct xfer_metadata meta;
+	unsigned int expected;
 	unsigned int block;
 	off_t offset;
 	size_t data_len;
@@ -833,7 +924,8 @@ static int tftp_rx_data ( struct tftp_request *tftp,
 	}
 
 	/* Calculate block number */
-	block = ( ( bitmap_first_gap ( &tftp->bitmap ) + 1 ) & ~0xffff );
+	expected = bitmap_first_gap ( &tftp->bitmap );
+	block = ( ( expected + 1 ) & ~0xffff );
 	if ( data->block == 0 && block == 0 ) {
 		DBGC ( tftp, "TFTP %p received data block 0\n", tftp );
 		rc = -EINVAL;
@@ -869,9 +961,21 @@ static int tftp_rx_data ( struct tftp_request *tftp,
 
 	/* Mark block as received */
 	bitmap_set ( &tftp->bitmap, block );
+	if ( block > expected )
+		tftp_stats.gaps++;
 
-	/* Acknowledge block */
-	tftp_send_packet ( tftp );
+	/* Acknowledge the final block of each window.  Acknowledge
+	 * immediately if a block has been skipped, so that the
+	 * server will restart the window from the first missing
+	 * block.
+	 */
+	if ( ( ++tftp->window_count >= tftp->windowsize ) ||
+	     ( block > expected ) || bitmap_full ( &tftp->bitmap ) ) {
+		tftp_send_packet ( tftp );
+	} else {
+		stop_timer ( &tftp->timer );
+		start_timer ( &tftp->timer );
+	}
 
 	/* If all blocks have been received, finish. */
 	if ( bitmap_full ( &tftp->bitmap ) )
@@ -920,10 +1024,25 @@ static int tftp_rx_error ( struct tftp_request *tftp, void *buf, size_t len ) {
 
 	DBGC ( tftp, "TFTP %p received ERROR packet with code %d, message "
 	       "\"%s\"\n", tftp, ntohs ( error->errcode ), error->errmsg );
+	tftp_stats.errors++;
 	
+	/* Some servers reject unrecognised options rather than
+	 * ignoring them.  Retry without the "windowsize" option.
+	 */
+	if ( ( error->errcode == htons ( TFTP_ERR_BAD_OPTS ) ) &&
+	     ( tftp->flags & TFTP_FL_RRQ_WINDOWSIZE ) ) {
+		DBGC ( tftp, "TFTP %p retrying without windowsize\n", tftp );
+		tftp->flags &= ~TFTP_FL_RRQ_WINDOWSIZE;
+		if ( ( rc = tftp_reopen ( tftp ) ) != 0 )
+			goto err;
+		start_timer_nodelay ( &tftp->timer );
+		return 0;
+	}
+
 	/* Determine final operation result */
 	rc = tftp_errcode_to_rc ( ntohs ( error->errcode ) );
 
+ err:
 	/* Close TFTP request */
 	tftp_done ( tftp, rc );
 
@@ -1100,6 +1219,7 @@ static int tftp_core_open ( struct interface *xfer, struct uri *uri,
 	timer_init ( &tftp->timer, tftp_timer_expired, &tftp->refcnt );
 	tftp->uri = uri_get ( uri );
 	tftp->blksize = TFTP_DEFAULT_BLKSIZE;
+	tftp->windowsize = TFTP_DEFAULT_WINDOWSIZE;
 	tftp->flags = flags;
 
 	/* Open socket */
@@ -1138,7 +1258,8 @@ static int tftp_core_open ( struct interface *xfer, struct uri *uri,
  */
 static int tftp_open ( struct interface *xfer, struct uri *uri ) {
 	return tftp_core_open ( xfer, uri, TFTP_PORT, NULL,
-				TFTP_FL_RRQ_SIZES );
+				( TFTP_FL_RRQ_SIZES |
+				  TFTP_FL_RRQ_WINDOWSIZE ) );
 
 }
 
@@ -40,16 +40,80 @@ FEATURE ( FEATURE_PROTOCOL, "VLAN", DHCP_EB_FEATURE_VLAN, 1 );
 
 struct net_protocol vlan_protocol __net_protocol;
 
+/** Number of VLAN device hash chains (must be a power of two) */
+#define VLAN_HASH_SIZE 16
+
 /** VLAN device private data */
 struct vlan_device {
+	/** VLAN network device */
+	struct net_device *netdev;
+	/** VLAN device hash chain */
+	struct list_head hash;
 	/** Trunk network device */
 	struct net_device *trunk;
 	/** VLAN tag */
 	unsigned int tag;
 	/** Default priority */
 	unsigned int priority;
+	/** Promiscuous reception has been requested on trunk device */
+	int promisc;
 };
 
+/** VLAN device hash chains, indexed by tag */
+static struct list_head vlan_hash[VLAN_HASH_SIZE];
+
+/**
+ * Get VLAN device hash chain
+ *
+ * @v tag		VLAN tag
+ * @ret chain		VLAN device hash chain
+ */
+static struct list_head * vlan_chain ( unsigned int tag ) {
+	struct list_head *chain = &vlan_hash[ tag & ( VLAN_HASH_SIZE - 1 ) ];
+	unsigned int i;
+
+	/* Initialise hash chains on first use */
+	if ( ! chain->next ) {
+		for ( i = 0 ; i < VLAN_HASH_SIZE ; i++ )
+			INIT_LIST_HEAD ( &vlan_hash[i] );
+	}
+
+	return chain;
+}
+
+/**
+ * Set trunk device promiscuous reception state
+ *
+ * @v vlan		VLAN device
+ * @v promisc		Promiscuous reception is required
+ */
+static void vlan_promisc ( struct vlan_device *vlan, int promisc ) {
+
+	if ( promisc != vlan->promisc ) {
+		netdev_rx_promisc ( vlan->trunk, promisc );
+		vlan->promisc = promisc;
+	}
+}
+
+/**
+ * Update VLAN device receive address filter
+ *
+ * @v netdev		Network device
+ */
+static void vlan_filter ( struct net_device *netdev ) {
+	struct vlan_device *vlan = netdev->priv;
+	struct net_device *trunk = vlan->trunk;
+
+	/* The trunk device must receive promiscuously if the VLAN
+	 * device has been asked to do so, or if the VLAN device's
+	 * link-layer address has been changed.
+	 */
+	vlan_promisc ( vlan, ( netdev_rx_is_promisc ( netdev ) ||
+			       ( memcmp ( netdev->ll_addr, trunk->ll_addr,
+					  netdev->ll_protocol->ll_addr_len )
+				 != 0 ) ) );
+}
+
 /**
  * Open VLAN device
  *
@@ -58,8 +122,13 @@ struct vlan_device {
  */
 static int vlan_open ( struct net_device *netdev ) {
 	struct vlan_device *vlan = netdev->priv;
+	int rc;
 
-	return netdev_open ( vlan->trunk );
+	if ( ( rc = netdev_open ( vlan->trunk ) ) != 0 )
+		return rc;
+	vlan_filter ( netdev );
+
+	return 0;
 }
 
 /**
@@ -70,6 +139,7 @@ static int vlan_open ( struct net_device *netdev ) {
 static void vlan_close ( struct net_device *netdev ) {
 	struct vlan_device *vlan = netdev->priv;
 
+	vlan_promisc ( vlan, 0 );
 	netdev_close ( vlan->trunk );
 }
 
@@ -162,6 +232,7 @@ static struct net_device_operations vlan_operations = {
 	.transmit	= vlan_transmit,
 	.poll		= vlan_poll,
 	.irq		= vlan_irq,
+	.filter		= vlan_filter,
 };
 
 /**
@@ -195,15 +266,11 @@ static void vlan_sync ( struct net_device *netdev ) {
  * @ret netdev		VLAN device, if any
  */
 struct net_device * vlan_find ( struct net_device *trunk, unsigned int tag ) {
-	struct net_device *netdev;
 	struct vlan_device *vlan;
 
-	for_each_netdev ( netdev ) {
-		if ( netdev->op != &vlan_operations )
-			continue;
-		vlan = netdev->priv;
+	list_for_each_entry ( vlan, vlan_chain ( tag ), hash ) {
 		if ( ( vlan->trunk == trunk ) && ( vlan->tag == tag ) )
-			return netdev;
+			return vlan->netdev;
 	}
 	return NULL;
 }
@@ -357,8 +424,13 @@ int vlan_create ( struct net_device *trunk, unsigned int tag,
 	}
 	netdev_init ( netdev, &vlan_operations );
 	netdev->dev = trunk->dev;
+	netdev->max_pkt_len = trunk->max_pkt_len;
+	netdev->max_tx_frags = trunk->max_tx_frags;
+	netdev->tx_headroom = ( trunk->tx_headroom +
+				sizeof ( struct vlan_header ) );
 	memcpy ( netdev->hw_addr, trunk->ll_addr, ETH_ALEN );
 	vlan = netdev->priv;
+	vlan->netdev = netdev;
 	vlan->trunk = netdev_get ( trunk );
 	vlan->tag = tag;
 	vlan->priority = priority;
@@ -374,6 +446,9 @@ int vlan_create ( struct net_device *trunk, unsigned int tag,
 		goto err_register;
 	}
 
+	/* Add to hash chain for lookup on the receive path */
+	list_add ( &vlan->hash, vlan_chain ( tag ) );
+
 	/* Synchronise with trunk device */
 	vlan_sync ( netdev );
 
@@ -412,6 +487,7 @@ int vlan_destroy ( struct net_device *netdev ) {
 	DBGC ( netdev, "VLAN %s destroyed\n", netdev->name );
 
 	/* Remove VLAN device */
+	list_del ( &vlan->hash );
 	unregister_netdev ( netdev );
 	trunk = vlan->trunk;
 	netdev_nullify ( netdev );
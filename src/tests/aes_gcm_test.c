@@ -0,0 +1,278 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/** @file
+ *
+ * AES-in-GCM-mode tests
+ *
+ * These test vectors are taken from the test cases in "The
+ * Galois/Counter Mode of Operation (GCM)" by McGrew and Viega,
+ * downloadable from:
+ *
+ *    http://csrc.nist.gov/groups/ST/toolkit/BCM/documents/proposedmodes/gcm/gcm-revised-spec.pdf
+ *
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <assert.h>
+#include <string.h>
+#include <ipxe/aes.h>
+#include <ipxe/gcm.h>
+#include <ipxe/test.h>
+
+/** Define inline key */
+#define KEY(...) { __VA_ARGS__ }
+
+/** Define inline initialisation vector */
+#define IV(...) { __VA_ARGS__ }
+
+/** Define inline additional data */
+#define ADDITIONAL(...) { __VA_ARGS__ }
+
+/** Define inline plaintext data */
+#define PLAINTEXT(...) { __VA_ARGS__ }
+
+/** Define inline ciphertext data */
+#define CIPHERTEXT(...) { __VA_ARGS__ }
+
+/** Define inline authentication tag */
+#define AUTH(...) { __VA_ARGS__ }
+
+/** An AES-in-GCM-mode test */
+struct aes_gcm_test {
+	/** Key */
+	const void *key;
+	/** Length of key */
+	size_t key_len;
+	/** Initialisation vector */
+	const void *iv;
+	/** Length of initialisation vector */
+	size_t iv_len;
+	/** Additional data */
+	const void *additional;
+	/** Length of additional data */
+	size_t additional_len;
+	/** Plaintext */
+	const void *plaintext;
+	/** Length of plaintext */
+	size_t plaintext_len;
+	/** Ciphertext */
+	const void *ciphertext;
+	/** Length of ciphertext */
+	size_t ciphertext_len;
+	/** Authentication tag */
+	const void *auth;
+	/** Length of authentication tag */
+	size_t auth_len;
+};
+
+/**
+ * Define an AES-in-GCM-mode test
+ *
+ * @v name		Test name
+ * @v key_array		Key
+ * @v iv_array		Initialisation vector
+ * @v additional_array	Additional data
+ * @v plaintext_array	Plaintext
+ * @v ciphertext_array	Ciphertext
+ * @v auth_array	Authentication tag
+ * @ret test		AES-in-GCM-mode test
+ */
+#define AES_GCM_TEST( name, key_array, iv_array, additional_array,	\
+		      plaintext_array, ciphertext_array, auth_array )	\
+	static const uint8_t name ## _key [] = key_array;		\
+	static const uint8_t name ## _iv [] = iv_array;			\
+	static const uint8_t name ## _additional [] = additional_array;	\
+	static const uint8_t name ## _plaintext [] = plaintext_array;	\
+	static const uint8_t name ## _ciphertext [] = ciphertext_array;	\
+	static const uint8_t name ## _auth [] = auth_array;		\
+	static struct aes_gcm_test name = {				\
+		.key = name ## _key,					\
+		.key_len = sizeof ( name ## _key ),			\
+		.iv = name ## _iv,					\
+		.iv_len = sizeof ( name ## _iv ),			\
+		.additional = name ## _additional,			\
+		.additional_len = sizeof ( name ## _additional ),	\
+		.plaintext = name ## _plaintext,			\
+		.plaintext_len = sizeof ( name ## _plaintext ),		\
+		.ciphertext = name ## _ciphertext,			\
+		.ciphertext_len = sizeof ( name ## _ciphertext ),	\
+		.auth = name ## _auth,					\
+		.auth_len = sizeof ( name ## _auth ),			\
+	}
+
+/**
+ * Report AES-in-GCM-mode test result
+ *
+ * @v test		AES-in-GCM-mode test
+ */
+#define aes_gcm_ok( test ) do {						\
+	struct cipher_algorithm *cipher = &aes_gcm_algorithm;		\
+	uint8_t ctx[cipher->ctxsize];					\
+	uint8_t data[(test)->plaintext_len];				\
+	uint8_t auth[cipher->authsize];					\
+									\
+	assert ( (test)->iv_len == GCM_IV_LEN );			\
+	assert ( (test)->plaintext_len == (test)->ciphertext_len );	\
+	assert ( (test)->auth_len == cipher->authsize );		\
+									\
+	/* Test encryption */						\
+	ok ( cipher_setkey ( cipher, ctx, (test)->key,			\
+			     (test)->key_len ) == 0 );			\
+	cipher_setiv ( cipher, ctx, (test)->iv );			\
+	cipher_encrypt ( cipher, ctx, (test)->additional, NULL,		\
+			 (test)->additional_len );			\
+	cipher_encrypt ( cipher, ctx, (test)->plaintext, data,		\
+			 (test)->plaintext_len );			\
+	cipher_auth ( cipher, ctx, auth );				\
+	ok ( memcmp ( data, (test)->ciphertext,				\
+		      (test)->ciphertext_len ) == 0 );			\
+	ok ( memcmp ( auth, (test)->auth, (test)->auth_len ) == 0 );	\
+									\
+	/* Test in-place decryption */					\
+	cipher_setiv ( cipher, ctx, (test)->iv );			\
+	cipher_decrypt ( cipher, ctx, (test)->additional, NULL,		\
+			 (test)->additional_len );			\
+	cipher_decrypt ( cipher, ctx, data, data,			\
+			 (test)->ciphertext_len );			\
+	cipher_auth ( cipher, ctx, auth );				\
+	ok ( memcmp ( data, (test)->plaintext,				\
+		      (test)->plaintext_len ) == 0 );			\
+	ok ( memcmp ( auth, (test)->auth, (test)->auth_len ) == 0 );	\
+	} while ( 0 )
+
+/** Test case 2: 128-bit key, no additional data */
+AES_GCM_TEST ( test_2,
+	KEY ( 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 ),
+	IV ( 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	     0x00, 0x00, 0x00, 0x00 ),
+	ADDITIONAL(),
+	PLAINTEXT ( 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 ),
+	CIPHERTEXT ( 0x03, 0x88, 0xda, 0xce, 0x60, 0xb6, 0xa3, 0x92,
+	             0xf3, 0x28, 0xc2, 0xb9, 0x71, 0xb2, 0xfe, 0x78 ),
+	AUTH ( 0xab, 0x6e, 0x47, 0xd4, 0x2c, 0xec, 0x13, 0xbd,
+	       0xf5, 0x3a, 0x67, 0xb2, 0x12, 0x57, 0xbd, 0xdf ) );
+
+/** Test case 3: 128-bit key, no additional data */
+AES_GCM_TEST ( test_3,
+	KEY ( 0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c,
+	      0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08 ),
+	IV ( 0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce, 0xdb, 0xad,
+	     0xde, 0xca, 0xf8, 0x88 ),
+	ADDITIONAL(),
+	PLAINTEXT ( 0xd9, 0x31, 0x32, 0x25, 0xf8, 0x84, 0x06, 0xe5,
+	            0xa5, 0x59, 0x09, 0xc5, 0xaf, 0xf5, 0x26, 0x9a,
+	            0x86, 0xa7, 0xa9, 0x53, 0x15, 0x34, 0xf7, 0xda,
+	            0x2e, 0x4c, 0x30, 0x3d, 0x8a, 0x31, 0x8a, 0x72,
+	            0x1c, 0x3c, 0x0c, 0x95, 0x95, 0x68, 0x09, 0x53,
+	            0x2f, 0xcf, 0x0e, 0x24, 0x49, 0xa6, 0xb5, 0x25,
+	            0xb1, 0x6a, 0xed, 0xf5, 0xaa, 0x0d, 0xe6, 0x57,
+	            0xba, 0x63, 0x7b, 0x39, 0x1a, 0xaf, 0xd2, 0x55 ),
+	CIPHERTEXT ( 0x42, 0x83, 0x1e, 0xc2, 0x21, 0x77, 0x74, 0x24,
+	             0x4b, 0x72, 0x21, 0xb7, 0x84, 0xd0, 0xd4, 0x9c,
+	             0xe3, 0xaa, 0x21, 0x2f, 0x2c, 0x02, 0xa4, 0xe0,
+	             0x35, 0xc1, 0x7e, 0x23, 0x29, 0xac, 0xa1, 0x2e,
+	             0x21, 0xd5, 0x14, 0xb2, 0x54, 0x66, 0x93, 0x1c,
+	             0x7d, 0x8f, 0x6a, 0x5a, 0xac, 0x84, 0xaa, 0x05,
+	             0x1b, 0xa3, 0x0b, 0x39, 0x6a, 0x0a, 0xac, 0x97,
+	             0x3d, 0x58, 0xe0, 0x91, 0x47, 0x3f, 0x59, 0x85 ),
+	AUTH ( 0x4d, 0x5c, 0x2a, 0xf3, 0x27, 0xcd, 0x64, 0xa6,
+	       0x2c, 0xf3, 0x5a, 0xbd, 0x2b, 0xa6, 0xfa, 0xb4 ) );
+
+/** Test case 4: 128-bit key, with additional data */
+AES_GCM_TEST ( test_4,
+	KEY ( 0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c,
+	      0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08 ),
+	IV ( 0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce, 0xdb, 0xad,
+	     0xde, 0xca, 0xf8, 0x88 ),
+	ADDITIONAL ( 0xfe, 0xed, 0xfa, 0xce, 0xde, 0xad, 0xbe, 0xef,
+	             0xfe, 0xed, 0xfa, 0xce, 0xde, 0xad, 0xbe, 0xef,
+	             0xab, 0xad, 0xda, 0xd2 ),
+	PLAINTEXT ( 0xd9, 0x31, 0x32, 0x25, 0xf8, 0x84, 0x06, 0xe5,
+	            0xa5, 0x59, 0x09, 0xc5, 0xaf, 0xf5, 0x26, 0x9a,
+	            0x86, 0xa7, 0xa9, 0x53, 0x15, 0x34, 0xf7, 0xda,
+	            0x2e, 0x4c, 0x30, 0x3d, 0x8a, 0x31, 0x8a, 0x72,
+	            0x1c, 0x3c, 0x0c, 0x95, 0x95, 0x68, 0x09, 0x53,
+	            0x2f, 0xcf, 0x0e, 0x24, 0x49, 0xa6, 0xb5, 0x25,
+	            0xb1, 0x6a, 0xed, 0xf5, 0xaa, 0x0d, 0xe6, 0x57,
+	            0xba, 0x63, 0x7b, 0x39 ),
+	CIPHERTEXT ( 0x42, 0x83, 0x1e, 0xc2, 0x21, 0x77, 0x74, 0x24,
+	             0x4b, 0x72, 0x21, 0xb7, 0x84, 0xd0, 0xd4, 0x9c,
+	             0xe3, 0xaa, 0x21, 0x2f, 0x2c, 0x02, 0xa4, 0xe0,
+	             0x35, 0xc1, 0x7e, 0x23, 0x29, 0xac, 0xa1, 0x2e,
+	             0x21, 0xd5, 0x14, 0xb2, 0x54, 0x66, 0x93, 0x1c,
+	             0x7d, 0x8f, 0x6a, 0x5a, 0xac, 0x84, 0xaa, 0x05,
+	             0x1b, 0xa3, 0x0b, 0x39, 0x6a, 0x0a, 0xac, 0x97,
+	             0x3d, 0x58, 0xe0, 0x91 ),
+	AUTH ( 0x5b, 0xc9, 0x4f, 0xbc, 0x32, 0x21, 0xa5, 0xdb,
+	       0x94, 0xfa, 0xe9, 0x5a, 0xe7, 0x12, 0x1a, 0x47 ) );
+
+/** Test case 16: 256-bit key, with additional data */
+AES_GCM_TEST ( test_16,
+	KEY ( 0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c,
+	      0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08,
+	      0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c,
+	      0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08 ),
+	IV ( 0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce, 0xdb, 0xad,
+	     0xde, 0xca, 0xf8, 0x88 ),
+	ADDITIONAL ( 0xfe, 0xed, 0xfa, 0xce, 0xde, 0xad, 0xbe, 0xef,
+	             0xfe, 0xed, 0xfa, 0xce, 0xde, 0xad, 0xbe, 0xef,
+	             0xab, 0xad, 0xda, 0xd2 ),
+	PLAINTEXT ( 0xd9, 0x31, 0x32, 0x25, 0xf8, 0x84, 0x06, 0xe5,
+	            0xa5, 0x59, 0x09, 0xc5, 0xaf, 0xf5, 0x26, 0x9a,
+	            0x86, 0xa7, 0xa9, 0x53, 0x15, 0x34, 0xf7, 0xda,
+	            0x2e, 0x4c, 0x30, 0x3d, 0x8a, 0x31, 0x8a, 0x72,
+	            0x1c, 0x3c, 0x0c, 0x95, 0x95, 0x68, 0x09, 0x53,
+	            0x2f, 0xcf, 0x0e, 0x24, 0x49, 0xa6, 0xb5, 0x25,
+	            0xb1, 0x6a, 0xed, 0xf5, 0xaa, 0x0d, 0xe6, 0x57,
+	            0xba, 0x63, 0x7b, 0x39 ),
+	CIPHERTEXT ( 0x52, 0x2d, 0xc1, 0xf0, 0x99, 0x56, 0x7d, 0x07,
+	             0xf4, 0x7f, 0x37, 0xa3, 0x2a, 0x84, 0x42, 0x7d,
+	             0x64, 0x3a, 0x8c, 0xdc, 0xbf, 0xe5, 0xc0, 0xc9,
+	             0x75, 0x98, 0xa2, 0xbd, 0x25, 0x55, 0xd1, 0xaa,
+	             0x8c, 0xb0, 0x8e, 0x48, 0x59, 0x0d, 0xbb, 0x3d,
+	             0xa7, 0xb0, 0x8b, 0x10, 0x56, 0x82, 0x88, 0x38,
+	             0xc5, 0xf6, 0x1e, 0x63, 0x93, 0xba, 0x7a, 0x0a,
+	             0xbc, 0xc9, 0xf6, 0x62 ),
+	AUTH ( 0x76, 0xfc, 0x6e, 0xce, 0x0f, 0x4e, 0x17, 0x68,
+	       0xcd, 0xdf, 0x88, 0x53, 0xbb, 0x2d, 0x55, 0x1b ) );
+
+/**
+ * Perform AES-in-GCM-mode self-test
+ *
+ */
+static void aes_gcm_test_exec ( void ) {
+
+	aes_gcm_ok ( &test_2 );
+	aes_gcm_ok ( &test_3 );
+	aes_gcm_ok ( &test_4 );
+	aes_gcm_ok ( &test_16 );
+}
+
+/** AES-in-GCM-mode self-test */
+struct self_test aes_gcm_test __self_test = {
+	.name = "aes_gcm",
+	.exec = aes_gcm_test_exec,
+};
@@ -0,0 +1,222 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/** @file
+ *
+ * Block device read-ahead cache tests
+ *
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <ipxe/uaccess.h>
+#include <ipxe/blockcache.h>
+#include <ipxe/test.h>
+
+/** Test block size */
+#define BLOCKCACHE_TEST_BLKSIZE 4
+
+/** Number of blocks in test device */
+#define BLOCKCACHE_TEST_BLOCKS 70
+
+/** Number of blocks per test cache extent */
+#define BLOCKCACHE_TEST_COUNT 16
+
+/** Number of test cache extents */
+#define BLOCKCACHE_TEST_EXTENTS 2
+
+/** A block cache test device */
+struct blockcache_test {
+	/** Block cache */
+	struct block_cache cache;
+	/** Number of reads from underlying device */
+	unsigned int reads;
+	/** Number of blocks read from underlying device */
+	unsigned int blocks;
+	/** Generation number (incremented to simulate writes) */
+	uint8_t generation;
+};
+
+/**
+ * Calculate expected content of a test block byte
+ *
+ * @v test		Block cache test device
+ * @v lba		Logical block address
+ * @v offset		Offset within block
+ * @ret byte		Expected content
+ */
+static uint8_t blockcache_test_byte ( struct blockcache_test *test,
+				      uint64_t lba, unsigned int offset ) {
+	return ( ( lba * BLOCKCACHE_TEST_BLKSIZE ) + offset +
+		 ( test->generation << 4 ) );
+}
+
+/**
+ * Read from test device
+ *
+ * @v cache		Block cache
+ * @v lba		Starting logical block address
+ * @v count		Number of logical blocks
+ * @v buffer		Data buffer
+ * @ret rc		Return status code
+ */
+static int blockcache_test_read ( struct block_cache *cache, uint64_t lba,
+				  unsigned int count, userptr_t buffer ) {
+	struct blockcache_test *test =
+		container_of ( cache, struct blockcache_test, cache );
+	uint8_t *data = user_to_virt ( buffer, 0 );
+	unsigned int i;
+
+	if ( ( lba + count ) > BLOCKCACHE_TEST_BLOCKS )
+		return -ERANGE;
+
+	test->reads++;
+	test->blocks += count;
+	for ( ; count ; lba++, count-- ) {
+		for ( i = 0 ; i < BLOCKCACHE_TEST_BLKSIZE ; i++ )
+			*(data++) = blockcache_test_byte ( test, lba, i );
+	}
+	return 0;
+}
+
+/**
+ * Check contents of data read from test device
+ *
+ * @v test		Block cache test device
+ * @v lba		Starting logical block address
+ * @v count		Number of logical blocks
+ * @v data		Data
+ * @ret ok		Data is correct
+ */
+static int blockcache_test_check ( struct blockcache_test *test,
+				   uint64_t lba, unsigned int count,
+				   const uint8_t *data ) {
+	unsigned int i;
+
+	for ( ; count ; lba++, count--, data += BLOCKCACHE_TEST_BLKSIZE ) {
+		for ( i = 0 ; i < BLOCKCACHE_TEST_BLKSIZE ; i++ ) {
+			if ( data[i] != blockcache_test_byte ( test, lba, i ) )
+				return 0;
+		}
+	}
+	return 1;
+}
+
+/**
+ * Report a block cache read test result
+ *
+ * @v test		Block cache test device
+ * @v lba		Starting logical block address
+ * @v count		Number of logical blocks
+ * @v total_reads	Expected total number of underlying reads
+ */
+#define blockcache_read_ok( test, lba, count, total_reads ) do {	\
+	uint8_t buf[ (count) * BLOCKCACHE_TEST_BLKSIZE ];		\
+									\
+	memset ( buf, 0, sizeof ( buf ) );				\
+	ok ( block_cache_read ( &(test)->cache, (lba), (count),		\
+				virt_to_user ( buf ) ) == 0 );		\
+	ok ( blockcache_test_check ( (test), (lba), (count), buf ) );	\
+	ok ( (test)->reads == (total_reads) );				\
+	} while ( 0 )
+
+/**
+ * Perform block cache self-tests
+ *
+ */
+static void blockcache_test_exec ( void ) {
+	struct blockcache_test test;
+	uint8_t buf[ BLOCKCACHE_TEST_BLKSIZE ];
+
+	memset ( &test, 0, sizeof ( test ) );
+	block_cache_init ( &test.cache, blockcache_test_read );
+
+	/* Reads with no cache allocated go directly to the device */
+	blockcache_read_ok ( &test, 3, 1, 1 );
+	blockcache_read_ok ( &test, 4, 1, 2 );
+
+	/* Allocate cache */
+	ok ( block_cache_alloc ( &test.cache, BLOCKCACHE_TEST_BLKSIZE,
+				 BLOCKCACHE_TEST_BLOCKS,
+				 ( BLOCKCACHE_TEST_COUNT *
+				   BLOCKCACHE_TEST_BLKSIZE ),
+				 BLOCKCACHE_TEST_EXTENTS ) == 0 );
+	test.reads = 0;
+	test.blocks = 0;
+
+	/* Small sequential reads are coalesced into a single extent */
+	blockcache_read_ok ( &test, 0, 1, 1 );
+	blockcache_read_ok ( &test, 1, 2, 1 );
+	blockcache_read_ok ( &test, 3, 13, 1 );
+	ok ( test.blocks == BLOCKCACHE_TEST_COUNT );
+
+	/* A read spanning two extents fills only the missing extent */
+	blockcache_read_ok ( &test, 14, 4, 2 );
+	blockcache_read_ok ( &test, 20, 1, 2 );
+
+	/* Least recently used extent is replaced */
+	blockcache_read_ok ( &test, 0, 1, 2 );
+	blockcache_read_ok ( &test, 32, 1, 3 );
+	blockcache_read_ok ( &test, 5, 1, 3 );
+	blockcache_read_ok ( &test, 17, 1, 4 );
+
+	/* Reads at least as large as an extent bypass the cache */
+	test.blocks = 0;
+	blockcache_read_ok ( &test, 1, 17, 5 );
+	ok ( test.blocks == 17 );
+	blockcache_read_ok ( &test, 40, 16, 6 );
+	ok ( test.blocks == 33 );
+
+	/* Final extent is truncated at the end of the device */
+	test.blocks = 0;
+	blockcache_read_ok ( &test, 65, 5, 7 );
+	ok ( test.blocks == ( BLOCKCACHE_TEST_BLOCKS - 64 ) );
+	blockcache_read_ok ( &test, 69, 1, 7 );
+
+	/* Reads beyond the end of the device are reported by the device */
+	ok ( block_cache_read ( &test.cache, 69, 2,
+				virt_to_user ( buf ) ) == -ERANGE );
+	ok ( block_cache_read ( &test.cache, 70, 1,
+				virt_to_user ( buf ) ) == -ERANGE );
+
+	/* Invalidated blocks are reread from the device */
+	test.generation++;
+	block_cache_invalidate ( &test.cache, 68, 1 );
+	blockcache_read_ok ( &test, 66, 4, 8 );
+	block_cache_invalidate ( &test.cache, 0, 1 );
+	blockcache_read_ok ( &test, 0, 1, 9 );
+
+	/* Freeing the cache returns to reading directly from the device */
+	block_cache_free ( &test.cache );
+	blockcache_read_ok ( &test, 0, 1, 10 );
+	blockcache_read_ok ( &test, 0, 1, 11 );
+}
+
+/** Block cache self-test */
+struct self_test blockcache_test __self_test = {
+	.name = "blockcache",
+	.exec = blockcache_test_exec,
+};
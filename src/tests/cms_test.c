@@ -29,6 +29,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 
 #include <stdint.h>
 #include <string.h>
+#include <ipxe/sha1.h>
 #include <ipxe/sha256.h>
 #include <ipxe/x509.h>
 #include <ipxe/uaccess.h>
@@ -1370,11 +1371,55 @@ static time_t test_expired = 1375573111ULL; /* Sat Aug  3 23:38:31 2013 */
 			  (code)->len, name, time, root ) != 0 );	\
 	} while ( 0 )
 
+/**
+ * Report signature verification using precalculated digest test result
+ *
+ * @v sig		Test signature
+ * @v code		Test signed code
+ * @v digested		Algorithm of precalculated digest
+ * @v digested_out	Precalculated digest
+ * @v name		Test verification name
+ * @v time		Test verification time
+ * @v root		Test root certificate store
+ */
+#define cms_verify_digested_ok( sig, code, digested, digested_out,	\
+				name, time, root ) do {			\
+	struct cms_signature temp;					\
+	ok ( cms_parse ( &temp, (sig)->data, (sig)->len ) == 0 );	\
+	ok ( cms_verify_digested ( &temp, virt_to_user ( (code)->data ),	\
+				   (code)->len, digested, digested_out,	\
+				   name, time, root ) == 0 );		\
+	} while ( 0 )
+
+/**
+ * Report signature verification using precalculated digest failure
+ * test result
+ *
+ * @v sig		Test signature
+ * @v code		Test signed code
+ * @v digested		Algorithm of precalculated digest
+ * @v digested_out	Precalculated digest
+ * @v name		Test verification name
+ * @v time		Test verification time
+ * @v root		Test root certificate store
+ */
+#define cms_verify_digested_fail_ok( sig, code, digested, digested_out,	\
+				     name, time, root ) do {		\
+	struct cms_signature temp;					\
+	ok ( cms_parse ( &temp, (sig)->data, (sig)->len ) == 0 );	\
+	ok ( cms_verify_digested ( &temp, virt_to_user ( (code)->data ),	\
+				   (code)->len, digested, digested_out,	\
+				   name, time, root ) != 0 );		\
+	} while ( 0 )
+
 /**
  * Perform CMS self-tests
  *
  */
 static void cms_test_exec ( void ) {
+	uint8_t ctx[SHA1_CTX_SIZE];
+	uint8_t good_digest[SHA1_DIGEST_SIZE];
+	uint8_t bad_digest[SHA1_DIGEST_SIZE];
 
 	/* Check that all signatures can be parsed */
 	cms_parse_ok ( &codesigned_sig );
@@ -1415,6 +1460,26 @@ static void cms_test_exec ( void ) {
 	/* Check expired signature */
 	cms_verify_fail_ok ( &codesigned_sig, &test_code,
 			     NULL, test_expired, &test_root );
+
+	/* Calculate correct and incorrect digests of signed content */
+	digest_init ( &sha1_algorithm, ctx );
+	digest_update ( &sha1_algorithm, ctx, test_code.data, test_code.len );
+	digest_final ( &sha1_algorithm, ctx, good_digest );
+	memcpy ( bad_digest, good_digest, sizeof ( bad_digest ) );
+	bad_digest[0] ^= 0x01;
+
+	/* Check good signature using precalculated digest */
+	cms_verify_digested_ok ( &codesigned_sig, &test_code,
+				 &sha1_algorithm, good_digest,
+				 NULL, test_time, &test_root );
+
+	/* Check that precalculated digest is used in place of content */
+	cms_verify_digested_ok ( &codesigned_sig, &bad_code,
+				 &sha1_algorithm, good_digest,
+				 NULL, test_time, &test_root );
+	cms_verify_digested_fail_ok ( &codesigned_sig, &test_code,
+				      &sha1_algorithm, bad_digest,
+				      NULL, test_time, &test_root );
 }
 
 /** CMS self-test */
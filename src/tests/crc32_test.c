@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/** @file
+ *
+ * CRC32 tests
+ *
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <stdint.h>
+#include <string.h>
+#include <ipxe/crc32.h>
+#include <ipxe/test.h>
+
+/** Standard CRC32 check string */
+static const char crc32_check[] = "123456789";
+
+/**
+ * Calculate CRC32 one bit at a time
+ *
+ * @v seed		Initial value
+ * @v data		Data to checksum
+ * @v len		Length of data
+ * @ret crc		CRC value
+ */
+static u32 crc32_bitwise ( u32 seed, const void *data, size_t len ) {
+	const u8 *src = data;
+	u32 crc = seed;
+	unsigned int i;
+
+	while ( len-- ) {
+		crc ^= *(src++);
+		for ( i = 0 ; i < 8 ; i++ )
+			crc = ( ( crc >> 1 ) ^ ( ( crc & 1 ) ? 0xedb88320 : 0 ) );
+	}
+	return crc;
+}
+
+/**
+ * Perform CRC32 self-tests
+ *
+ */
+static void crc32_test_exec ( void ) {
+	static u8 data[251];
+	unsigned int offset;
+	unsigned int len;
+	unsigned int i;
+
+	/* Check value */
+	ok ( ~crc32_le ( ~0, crc32_check, strlen ( crc32_check ) ) ==
+	     0xcbf43926 );
+
+	/* Empty data leaves seed untouched */
+	ok ( crc32_le ( 0x12345678, crc32_check, 0 ) == 0x12345678 );
+
+	/* Compare against bitwise calculation for all alignments and
+	 * a range of lengths, including continuation across calls.
+	 */
+	for ( i = 0 ; i < sizeof ( data ) ; i++ )
+		data[i] = ( ( i * 37 ) ^ ( i >> 3 ) );
+	for ( offset = 0 ; offset < 8 ; offset++ ) {
+		for ( len = 0 ; len < ( sizeof ( data ) - offset ) ;
+		      len += 13 ) {
+			ok ( crc32_le ( ~0, &data[offset], len ) ==
+			     crc32_bitwise ( ~0, &data[offset], len ) );
+			ok ( crc32_le ( crc32_le ( 0, &data[offset], len ), data,
+					sizeof ( data ) ) ==
+			     crc32_bitwise ( crc32_bitwise ( 0, &data[offset],
+							     len ), data,
+					     sizeof ( data ) ) );
+		}
+	}
+}
+
+/** CRC32 self-test */
+struct self_test crc32_test __self_test = {
+	.name = "crc32",
+	.exec = crc32_test_exec,
+};
@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/** @file
+ *
+ * CRC32C tests
+ *
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <stdint.h>
+#include <string.h>
+#include <ipxe/crc32c.h>
+#include <ipxe/test.h>
+
+/** Define inline data */
+#define DATA(...) { __VA_ARGS__ }
+
+/** A CRC32C known-answer test */
+struct crc32c_test {
+	/** Data */
+	const void *data;
+	/** Length of data */
+	size_t len;
+	/** Expected CRC32C value */
+	uint32_t expected;
+};
+
+/**
+ * Define a CRC32C known-answer test
+ *
+ * @v name		Test name
+ * @v DATA		Data
+ * @v EXPECTED		Expected CRC32C value
+ */
+#define CRC32C_TEST( name, DATA, EXPECTED )				\
+	static const uint8_t name ## _data[] = DATA;			\
+	static struct crc32c_test name = {				\
+		.data = name ## _data,					\
+		.len = sizeof ( name ## _data ),			\
+		.expected = EXPECTED,					\
+	}
+
+/** Standard check string "123456789" */
+CRC32C_TEST ( check, DATA ( '1', '2', '3', '4', '5', '6', '7', '8', '9' ),
+	      0xe3069283 );
+
+/** RFC 3720 section B.4: 32 bytes of zeroes */
+CRC32C_TEST ( zeroes,
+	      DATA ( 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 ),
+	      0x8a9136aa );
+
+/** RFC 3720 section B.4: 32 bytes of ones */
+CRC32C_TEST ( ones,
+	      DATA ( 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		     0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		     0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		     0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff ),
+	      0x62a8ab43 );
+
+/** RFC 3720 section B.4: 32 bytes of incrementing values */
+CRC32C_TEST ( incrementing,
+	      DATA ( 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+		     0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+		     0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
+		     0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f ),
+	      0x46dd794e );
+
+/** RFC 3720 section B.4: 32 bytes of decrementing values */
+CRC32C_TEST ( decrementing,
+	      DATA ( 0x1f, 0x1e, 0x1d, 0x1c, 0x1b, 0x1a, 0x19, 0x18,
+		     0x17, 0x16, 0x15, 0x14, 0x13, 0x12, 0x11, 0x10,
+		     0x0f, 0x0e, 0x0d, 0x0c, 0x0b, 0x0a, 0x09, 0x08,
+		     0x07, 0x06, 0x05, 0x04, 0x03, 0x02, 0x01, 0x00 ),
+	      0x113fdb5c );
+
+/** RFC 3720 section B.4: iSCSI SCSI Read (10) command PDU */
+CRC32C_TEST ( read_pdu,
+	      DATA ( 0x01, 0xc0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		     0x14, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00,
+		     0x00, 0x00, 0x00, 0x14, 0x00, 0x00, 0x00, 0x18,
+		     0x28, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		     0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 ),
+	      0xd9963a56 );
+
+/**
+ * Check CRC32C known-answer test
+ *
+ * @v test		CRC32C test
+ * @ret success		Test succeeded
+ *
+ * The data is checksummed at each possible alignment relative to a
+ * dword boundary, using both the default and the generic
+ * implementations, and also in two parts.
+ */
+static int crc32c_test_okx ( struct crc32c_test *test ) {
+	uint8_t buf[ test->len + 8 ];
+	size_t split = ( test->len / 2 );
+	unsigned int offset;
+	void *data;
+	u32 crc;
+
+	for ( offset = 0 ; offset < 8 ; offset++ ) {
+		data = &buf[offset];
+		memcpy ( data, test->data, test->len );
+		if ( ~crc32c_le ( ~0, data, test->len ) != test->expected )
+			return 0;
+		if ( ~crc32c_le_generic ( ~0, data, test->len ) !=
+		     test->expected )
+			return 0;
+		crc = crc32c_le ( ~0, data, split );
+		crc = crc32c_le ( crc, ( data + split ), ( test->len - split ) );
+		if ( ~crc != test->expected )
+			return 0;
+	}
+	return 1;
+}
+
+/**
+ * Report CRC32C known-answer test result
+ *
+ * @v test		CRC32C test
+ */
+#define crc32c_ok( test ) do {						\
+	ok ( crc32c_test_okx ( test ) );				\
+	} while ( 0 )
+
+/**
+ * Perform CRC32C self-tests
+ *
+ */
+static void crc32c_test_exec ( void ) {
+
+	/* Known-answer tests */
+	crc32c_ok ( &check );
+	crc32c_ok ( &zeroes );
+	crc32c_ok ( &ones );
+	crc32c_ok ( &incrementing );
+	crc32c_ok ( &decrementing );
+	crc32c_ok ( &read_pdu );
+
+	/* Empty data leaves seed untouched */
+	ok ( crc32c_le ( 0x12345678, check_data, 0 ) == 0x12345678 );
+	ok ( crc32c_le_generic ( 0x12345678, check_data, 0 ) == 0x12345678 );
+}
+
+/** CRC32C self-test */
+struct self_test crc32c_test __self_test = {
+	.name = "crc32c",
+	.exec = crc32c_test_exec,
+};
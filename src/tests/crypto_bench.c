@@ -0,0 +1,323 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/** @file
+ *
+ * Cryptographic benchmarks
+ *
+ * Each measurement is the best of several runs, timed using the CPU
+ * timestamp counter.
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <ipxe/profile.h>
+#include <ipxe/crypto.h>
+#include <ipxe/md5.h>
+#include <ipxe/sha1.h>
+#include <ipxe/sha256.h>
+#include <ipxe/aes.h>
+#include <ipxe/bigint.h>
+#include <ipxe/crc32c.h>
+#include <ipxe/test.h>
+
+/** Length of data used for digest and cipher benchmarks */
+#define BENCH_LEN 16384
+
+/** Number of runs for each benchmark */
+#define BENCH_RUNS 16
+
+/** Duration of timestamp counter calibration (in milliseconds) */
+#define BENCH_CALIBRATE_MS 100
+
+/** Size of modular exponentiation operands (in bytes) */
+#define BENCH_MOD_EXP_LEN ( 2048 / 8 )
+
+/** Benchmark data buffer */
+static uint8_t bench_data[BENCH_LEN];
+
+/** Timestamp counter ticks per second */
+static unsigned long long bench_ticks_per_sec;
+
+/**
+ * Fill buffer with arbitrary data
+ *
+ * @v data		Data buffer
+ * @v len		Length of data buffer
+ * @v seed		Seed value
+ */
+static void bench_fill ( void *data, size_t len, uint32_t seed ) {
+	uint8_t *bytes = data;
+
+	while ( len-- ) {
+		seed = ( ( seed * 1103515245UL ) + 12345 );
+		*(bytes++) = ( seed >> 16 );
+	}
+}
+
+/**
+ * Report cycles per byte
+ *
+ * @v name		Algorithm name
+ * @v operation		Operation name
+ * @v ticks		Best elapsed ticks
+ * @v len		Length of data processed
+ */
+static void bench_report_bytes ( const char *name, const char *operation,
+				 unsigned long ticks, size_t len ) {
+	unsigned long long scaled = ( ( ticks * 100ULL ) / len );
+
+	printf ( "BENCH %s %s: %lld.%02lld cycles/byte\n", name, operation,
+		 ( scaled / 100 ), ( scaled % 100 ) );
+}
+
+/**
+ * Report operations per second
+ *
+ * @v name		Operation name
+ * @v ticks		Best elapsed ticks per operation
+ */
+static void bench_report_ops ( const char *name, unsigned long ticks ) {
+
+	printf ( "BENCH %s: %ld cycles/op, %lld ops/sec\n", name, ticks,
+		 ( ticks ? ( bench_ticks_per_sec / ticks ) : 0 ) );
+}
+
+/**
+ * Calibrate timestamp counter
+ *
+ */
+static void bench_calibrate ( void ) {
+	union profiler profiler;
+	unsigned long ticks;
+
+	profile ( &profiler );
+	mdelay ( BENCH_CALIBRATE_MS );
+	ticks = profile ( &profiler );
+	bench_ticks_per_sec = ( ( ticks * 1000ULL ) / BENCH_CALIBRATE_MS );
+	printf ( "BENCH timestamp counter: %lld ticks/sec\n",
+		 bench_ticks_per_sec );
+}
+
+/**
+ * Benchmark digest algorithm
+ *
+ * @v digest		Digest algorithm
+ */
+static void bench_digest ( struct digest_algorithm *digest ) {
+	uint8_t ctx[ digest->ctxsize ];
+	uint8_t out[ digest->digestsize ];
+	union profiler profiler;
+	unsigned long best = ~0UL;
+	unsigned long ticks;
+	unsigned int i;
+
+	for ( i = 0 ; i < BENCH_RUNS ; i++ ) {
+		profile ( &profiler );
+		digest_init ( digest, ctx );
+		digest_update ( digest, ctx, bench_data, sizeof ( bench_data ) );
+		digest_final ( digest, ctx, out );
+		ticks = profile ( &profiler );
+		if ( ticks < best )
+			best = ticks;
+	}
+	bench_report_bytes ( digest->name, "digest", best,
+			     sizeof ( bench_data ) );
+}
+
+/**
+ * Benchmark cipher algorithm
+ *
+ * @v cipher		Cipher algorithm
+ * @v key_len		Key length
+ */
+static void bench_cipher ( struct cipher_algorithm *cipher, size_t key_len ) {
+	uint8_t ctx[ cipher->ctxsize ];
+	uint8_t key[key_len];
+	uint8_t iv[ cipher->blocksize > 16 ? cipher->blocksize : 16 ];
+	char name[32];
+	union profiler profiler;
+	unsigned long best_encrypt = ~0UL;
+	unsigned long best_decrypt = ~0UL;
+	unsigned long ticks;
+	unsigned int i;
+
+	/* Construct name including key length */
+	snprintf ( name, sizeof ( name ), "%s-%zd", cipher->name,
+		   ( key_len * 8 ) );
+
+	/* Set key */
+	bench_fill ( key, sizeof ( key ), key_len );
+	bench_fill ( iv, sizeof ( iv ), 0 );
+	ok ( cipher_setkey ( cipher, ctx, key, sizeof ( key ) ) == 0 );
+
+	/* Encrypt and decrypt in place */
+	for ( i = 0 ; i < BENCH_RUNS ; i++ ) {
+		cipher_setiv ( cipher, ctx, iv );
+		profile ( &profiler );
+		cipher_encrypt ( cipher, ctx, bench_data, bench_data,
+				 sizeof ( bench_data ) );
+		ticks = profile ( &profiler );
+		if ( ticks < best_encrypt )
+			best_encrypt = ticks;
+		cipher_setiv ( cipher, ctx, iv );
+		profile ( &profiler );
+		cipher_decrypt ( cipher, ctx, bench_data, bench_data,
+				 sizeof ( bench_data ) );
+		ticks = profile ( &profiler );
+		if ( ticks < best_decrypt )
+			best_decrypt = ticks;
+	}
+	bench_report_bytes ( name, "encrypt", best_encrypt,
+			     sizeof ( bench_data ) );
+	bench_report_bytes ( name, "decrypt", best_decrypt,
+			     sizeof ( bench_data ) );
+}
+
+/**
+ * Benchmark CRC32C implementation
+ *
+ * @v name		Implementation name
+ * @v crc32c		CRC32C function
+ */
+static void bench_crc32c ( const char *name,
+			   u32 ( * crc32c ) ( u32 seed, const void *data,
+					      size_t len ) ) {
+	union profiler profiler;
+	unsigned long best = ~0UL;
+	unsigned long ticks;
+	unsigned int i;
+
+	for ( i = 0 ; i < BENCH_RUNS ; i++ ) {
+		profile ( &profiler );
+		crc32c ( ~0, bench_data, sizeof ( bench_data ) );
+		ticks = profile ( &profiler );
+		if ( ticks < best )
+			best = ticks;
+	}
+	bench_report_bytes ( name, "checksum", best, sizeof ( bench_data ) );
+}
+
+/**
+ * Benchmark modular exponentiation
+ *
+ * @v name		Operation name
+ * @v exponent_len	Length of exponent
+ * @v exponent_raw	Exponent, or NULL to use arbitrary exponent
+ * @v runs		Number of runs
+ *
+ * An RSA public key operation (as used for signature verification)
+ * is a modular exponentiation with a short public exponent; a
+ * private key operation uses an exponent as large as the modulus.
+ */
+static void bench_mod_exp ( const char *name, size_t exponent_len,
+			    const void *exponent_raw, unsigned int runs ) {
+	unsigned int size = bigint_required_size ( BENCH_MOD_EXP_LEN );
+	unsigned int exponent_size = bigint_required_size ( exponent_len );
+	uint8_t raw[BENCH_MOD_EXP_LEN];
+	uint8_t exponent_buf[exponent_len];
+	bigint_t ( size ) base;
+	bigint_t ( size ) modulus;
+	bigint_t ( exponent_size ) exponent;
+	bigint_t ( size ) result;
+	size_t tmp_len = bigint_mod_exp_tmp_len ( &modulus, &exponent );
+	uint8_t tmp[tmp_len];
+	union profiler profiler;
+	unsigned long best = ~0UL;
+	unsigned long ticks;
+	unsigned int i;
+
+	/* Construct odd modulus with top bit set */
+	bench_fill ( raw, sizeof ( raw ), 1 );
+	raw[0] |= 0x80;
+	raw[ sizeof ( raw ) - 1 ] |= 0x01;
+	bigint_init ( &modulus, raw, sizeof ( raw ) );
+
+	/* Construct base smaller than modulus */
+	bench_fill ( raw, sizeof ( raw ), 2 );
+	raw[0] &= 0x7f;
+	bigint_init ( &base, raw, sizeof ( raw ) );
+
+	/* Construct exponent */
+	if ( exponent_raw ) {
+		memcpy ( exponent_buf, exponent_raw, sizeof ( exponent_buf ) );
+	} else {
+		bench_fill ( exponent_buf, sizeof ( exponent_buf ), 3 );
+		exponent_buf[0] |= 0x80;
+	}
+	bigint_init ( &exponent, exponent_buf, sizeof ( exponent_buf ) );
+
+	for ( i = 0 ; i < runs ; i++ ) {
+		profile ( &profiler );
+		bigint_mod_exp ( &base, &modulus, &exponent, &result, tmp );
+		ticks = profile ( &profiler );
+		if ( ticks < best )
+			best = ticks;
+	}
+	ok ( ! bigint_is_zero ( &result ) );
+	bench_report_ops ( name, best );
+}
+
+/** RSA public exponent */
+static const uint8_t bench_rsa_public_exponent[] = { 0x01, 0x00, 0x01 };
+
+/**
+ * Perform cryptographic benchmarks
+ *
+ */
+static void crypto_bench_exec ( void ) {
+
+	/* Calibrate timestamp counter */
+	bench_calibrate();
+	bench_fill ( bench_data, sizeof ( bench_data ), 0 );
+
+	/* Digest algorithms */
+	bench_digest ( &md5_algorithm );
+	bench_digest ( &sha1_algorithm );
+	bench_digest ( &sha256_algorithm );
+
+	/* Cipher algorithms */
+	bench_cipher ( &aes_cbc_algorithm, ( 128 / 8 ) );
+	bench_cipher ( &aes_cbc_algorithm, ( 256 / 8 ) );
+	bench_cipher ( &aes_gcm_algorithm, ( 128 / 8 ) );
+
+	/* Checksums */
+	bench_crc32c ( "crc32c", crc32c_le );
+	bench_crc32c ( "crc32c-generic", crc32c_le_generic );
+
+	/* Public-key operations */
+	bench_mod_exp ( "rsa-2048 verify (mod_exp e=65537)",
+			sizeof ( bench_rsa_public_exponent ),
+			bench_rsa_public_exponent, BENCH_RUNS );
+	bench_mod_exp ( "bigint-2048 mod_exp", BENCH_MOD_EXP_LEN, NULL, 4 );
+}
+
+/** Cryptographic benchmarks */
+struct self_test crypto_bench __self_test = {
+	.name = "crypto_bench",
+	.exec = crypto_bench_exec,
+};
@@ -0,0 +1,301 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/** @file
+ *
+ * DEFLATE decompression tests
+ *
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <ipxe/deflate.h>
+#include <ipxe/test.h>
+
+/** Define inline compressed data */
+#define COMPRESSED(...) { __VA_ARGS__ }
+
+/** Define inline expected data */
+#define EXPECTED(...) { __VA_ARGS__ }
+
+/** A DEFLATE test */
+struct deflate_test {
+	/** Compression format */
+	enum deflate_format format;
+	/** Compressed data */
+	const void *compressed;
+	/** Length of compressed data */
+	size_t compressed_len;
+	/** Expected decompressed data */
+	const void *expected;
+	/** Length of expected decompressed data */
+	size_t expected_len;
+};
+
+/**
+ * Define a DEFLATE test
+ *
+ * @v name		Test name
+ * @v FORMAT		Compression format
+ * @v compressed_array	Compressed data
+ * @v expected_array	Expected decompressed data
+ * @ret test		DEFLATE test
+ */
+#define DEFLATE_TEST( name, FORMAT, compressed_array, expected_array )	\
+	static const uint8_t name ## _compressed[] = compressed_array;	\
+	static const uint8_t name ## _expected[] = expected_array;	\
+	static struct deflate_test name = {				\
+		.format = FORMAT,					\
+		.compressed = name ## _compressed,			\
+		.compressed_len = sizeof ( name ## _compressed ),	\
+		.expected = name ## _expected,				\
+		.expected_len = sizeof ( name ## _expected ),		\
+	}
+
+/**
+ * Define a DEFLATE test of the standard text
+ *
+ * @v name		Test name
+ * @v FORMAT		Compression format
+ * @v compressed_array	Compressed data
+ * @ret test		DEFLATE test
+ */
+#define DEFLATE_TEXT_TEST( name, FORMAT, compressed_array )		\
+	static const uint8_t name ## _compressed[] = compressed_array;	\
+	static struct deflate_test name = {				\
+		.format = FORMAT,					\
+		.compressed = name ## _compressed,			\
+		.compressed_len = sizeof ( name ## _compressed ),	\
+		.expected = deflate_text,				\
+		.expected_len = sizeof ( deflate_text ),		\
+	}
+
+/** Number of words in standard text */
+#define DEFLATE_TEXT_WORDS 120
+
+/** Length of standard text */
+#define DEFLATE_TEXT_LEN 760
+
+/** Vocabulary used to construct standard text */
+static const char *deflate_words[] = {
+	"Lorem", "ipsum", "dolor", "sit", "amet", "consectetur",
+	"adipiscing", "elit", "sed", "do", "eiusmod", "tempor",
+	"incididunt", "ut", "labore", "et", "dolore", "magna", "aliqua",
+};
+
+/** Standard text (long enough to be compressed using dynamic codes) */
+static uint8_t deflate_text[DEFLATE_TEXT_LEN];
+
+/** Fixed Huffman codes */
+DEFLATE_TEST ( fixed, DEFLATE_RAW,
+	COMPRESSED ( 0xcb, 0x48, 0xcd, 0xc9, 0xc9, 0x57, 0x28, 0xcf,
+		     0x2f, 0xca, 0x49, 0x01, 0x00 ),
+	EXPECTED ( 0x68, 0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x77, 0x6f,
+		   0x72, 0x6c, 0x64 ) );
+
+/** Stored block */
+DEFLATE_TEST ( stored, DEFLATE_RAW,
+	COMPRESSED ( 0x01, 0x0b, 0x00, 0xf4, 0xff, 0x68, 0x65, 0x6c,
+		     0x6c, 0x6f, 0x20, 0x77, 0x6f, 0x72, 0x6c, 0x64 ),
+	EXPECTED ( 0x68, 0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x77, 0x6f,
+		   0x72, 0x6c, 0x64 ) );
+
+/** Dynamic Huffman codes */
+DEFLATE_TEXT_TEST ( dynamic, DEFLATE_RAW,
+	COMPRESSED ( 0xad, 0xd1, 0x4d, 0x0a, 0x03, 0x21, 0x0c, 0x05,
+		     0xe0, 0x7d, 0x4e, 0xf1, 0x0e, 0x34, 0x97, 0x48,
+		     0x35, 0x0c, 0x01, 0x7f, 0xa6, 0x1a, 0xef, 0x5f,
+		     0x8b, 0x9b, 0x32, 0x2d, 0x05, 0x9d, 0xd9, 0x48,
+		     0x14, 0xc9, 0xc7, 0xe3, 0x6d, 0xb9, 0x48, 0x84,
+		     0x04, 0x35, 0x04, 0x7e, 0xf4, 0x0b, 0x7c, 0x0e,
+		     0xb9, 0xf4, 0x73, 0x0c, 0x02, 0x8e, 0x62, 0x30,
+		     0x89, 0x47, 0x7f, 0xe5, 0xa0, 0xcf, 0xc6, 0x60,
+		     0xaf, 0x87, 0x56, 0xa7, 0x69, 0x47, 0x33, 0xd2,
+		     0xa3, 0xb6, 0x88, 0x2a, 0x1e, 0xfd, 0x63, 0xed,
+		     0x8b, 0x44, 0x5b, 0x8d, 0xd9, 0x23, 0xf2, 0x9e,
+		     0x18, 0x2e, 0xa7, 0x2a, 0xce, 0xc4, 0x5a, 0x81,
+		     0x26, 0xa7, 0x5e, 0x7d, 0x4b, 0x86, 0xed, 0x0c,
+		     0xd3, 0x2c, 0x8c, 0x4f, 0x98, 0xd6, 0xe1, 0x73,
+		     0x62, 0x9a, 0x82, 0xbf, 0x13, 0xd3, 0x2a, 0xfc,
+		     0x23, 0x31, 0xcd, 0xc0, 0x7f, 0x13, 0xd3, 0x95,
+		     0x8e, 0x07, 0x4c, 0x97, 0x3b, 0x1e, 0x1e, 0x2d,
+		     0x76, 0xfc, 0x86, 0xe9, 0x9e, 0x8e, 0xf1, 0x02 ) );
+
+/** ZLIB format */
+DEFLATE_TEST ( zlib, DEFLATE_ZLIB,
+	COMPRESSED ( 0x78, 0xda, 0xcb, 0x48, 0xcd, 0xc9, 0xc9, 0x57,
+		     0x28, 0xcf, 0x2f, 0xca, 0x49, 0x01, 0x00, 0x1a,
+		     0x0b, 0x04, 0x5d ),
+	EXPECTED ( 0x68, 0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x77, 0x6f,
+		   0x72, 0x6c, 0x64 ) );
+
+/** GZIP format (with original file name) */
+DEFLATE_TEXT_TEST ( gzip, DEFLATE_GZIP,
+	COMPRESSED ( 0x1f, 0x8b, 0x08, 0x08, 0x00, 0x00, 0x00, 0x00,
+		     0x02, 0x03, 0x68, 0x65, 0x6c, 0x6c, 0x6f, 0x2e,
+		     0x74, 0x78, 0x74, 0x00, 0xad, 0xd1, 0x4d, 0x0a,
+		     0x03, 0x21, 0x0c, 0x05, 0xe0, 0x7d, 0x4e, 0xf1,
+		     0x0e, 0x34, 0x97, 0x48, 0x35, 0x0c, 0x01, 0x7f,
+		     0xa6, 0x1a, 0xef, 0x5f, 0x8b, 0x9b, 0x32, 0x2d,
+		     0x05, 0x9d, 0xd9, 0x48, 0x14, 0xc9, 0xc7, 0xe3,
+		     0x6d, 0xb9, 0x48, 0x84, 0x04, 0x35, 0x04, 0x7e,
+		     0xf4, 0x0b, 0x7c, 0x0e, 0xb9, 0xf4, 0x73, 0x0c,
+		     0x02, 0x8e, 0x62, 0x30, 0x89, 0x47, 0x7f, 0xe5,
+		     0xa0, 0xcf, 0xc6, 0x60, 0xaf, 0x87, 0x56, 0xa7,
+		     0x69, 0x47, 0x33, 0xd2, 0xa3, 0xb6, 0x88, 0x2a,
+		     0x1e, 0xfd, 0x63, 0xed, 0x8b, 0x44, 0x5b, 0x8d,
+		     0xd9, 0x23, 0xf2, 0x9e, 0x18, 0x2e, 0xa7, 0x2a,
+		     0xce, 0xc4, 0x5a, 0x81, 0x26, 0xa7, 0x5e, 0x7d,
+		     0x4b, 0x86, 0xed, 0x0c, 0xd3, 0x2c, 0x8c, 0x4f,
+		     0x98, 0xd6, 0xe1, 0x73, 0x62, 0x9a, 0x82, 0xbf,
+		     0x13, 0xd3, 0x2a, 0xfc, 0x23, 0x31, 0xcd, 0xc0,
+		     0x7f, 0x13, 0xd3, 0x95, 0x8e, 0x07, 0x4c, 0x97,
+		     0x3b, 0x1e, 0x1e, 0x2d, 0x76, 0xfc, 0x86, 0xe9,
+		     0x9e, 0x8e, 0xf1, 0x02, 0xee, 0xbf, 0x17, 0x44,
+		     0xf8, 0x02, 0x00, 0x00 ) );
+
+/** ZLIB format with corrupted checksum */
+DEFLATE_TEST ( zlib_corrupt, DEFLATE_ZLIB,
+	COMPRESSED ( 0x78, 0xda, 0xcb, 0x48, 0xcd, 0xc9, 0xc9, 0x57,
+		     0x28, 0xcf, 0x2f, 0xca, 0x49, 0x01, 0x00, 0x1a,
+		     0x0b, 0x04, 0x5e ),
+	EXPECTED ( 0x68, 0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x77, 0x6f,
+		   0x72, 0x6c, 0x64 ) );
+
+/**
+ * Construct standard text
+ *
+ */
+static void deflate_text_init ( void ) {
+	unsigned int num_words = ( sizeof ( deflate_words ) /
+				   sizeof ( deflate_words[0] ) );
+	const char *word;
+	size_t len = 0;
+	unsigned int i;
+
+	for ( i = 0 ; i < DEFLATE_TEXT_WORDS ; i++ ) {
+		word = deflate_words[ ( i * 7 ) % num_words ];
+		assert ( ( len + strlen ( word ) + 1 ) <=
+			 sizeof ( deflate_text ) );
+		memcpy ( &deflate_text[len], word, strlen ( word ) );
+		len += strlen ( word );
+		deflate_text[len++] = ( ( ( i % 11 ) == 10 ) ? '\n' : ' ' );
+	}
+	assert ( len == sizeof ( deflate_text ) );
+}
+
+/**
+ * Decompress DEFLATE test data
+ *
+ * @v test		DEFLATE test
+ * @v frag_len		Length of each input fragment
+ * @v out_frag_len	Length by which output buffer is extended each time
+ * @ret rc		Return status code
+ */
+static int deflate_test_inflate ( struct deflate_test *test, size_t frag_len,
+				  size_t out_frag_len ) {
+	static struct deflate deflate;
+	uint8_t data[ test->expected_len ];
+	struct deflate_chunk in;
+	struct deflate_chunk out;
+	size_t offset;
+	size_t end;
+	int rc;
+
+	/* Decompress input one fragment at a time, extending the
+	 * output buffer one fragment at a time.
+	 */
+	deflate_init ( &deflate, test->format );
+	deflate_chunk_init ( &out, data, 0, 0 );
+	for ( offset = 0 ; offset < test->compressed_len ; offset = end ) {
+		end = ( offset + frag_len );
+		if ( end > test->compressed_len )
+			end = test->compressed_len;
+		deflate_chunk_init ( &in, ( ( void * ) test->compressed ),
+				     offset, end );
+		do {
+			out.len = ( out.offset + out_frag_len );
+			if ( out.len > sizeof ( data ) )
+				out.len = sizeof ( data );
+			if ( ( rc = deflate_inflate ( &deflate, &in,
+						      &out ) ) != 0 )
+				return rc;
+		} while ( ( out.offset == out.len ) &&
+			  ( out.len < sizeof ( data ) ) );
+		if ( in.offset != in.len )
+			return -EINVAL;
+	}
+
+	/* Check decompressed data */
+	if ( ! deflate_finished ( &deflate ) )
+		return -EINVAL;
+	if ( out.offset != test->expected_len )
+		return -EINVAL;
+	if ( memcmp ( data, test->expected, test->expected_len ) != 0 )
+		return -EINVAL;
+
+	return 0;
+}
+
+/**
+ * Report DEFLATE test result
+ *
+ * @v test		DEFLATE test
+ */
+#define deflate_ok( test ) do {						\
+	ok ( deflate_test_inflate ( (test), (test)->compressed_len,	\
+				    (test)->expected_len ) == 0 );	\
+	ok ( deflate_test_inflate ( (test), 1, 1 ) == 0 );		\
+	ok ( deflate_test_inflate ( (test), 3, 7 ) == 0 );		\
+	ok ( deflate_test_inflate ( (test), 1, (test)->expected_len ) == 0 ); \
+	} while ( 0 )
+
+/**
+ * Perform DEFLATE self-test
+ *
+ */
+static void deflate_test_exec ( void ) {
+
+	/* Construct standard text */
+	deflate_text_init();
+
+	/* Valid data */
+	deflate_ok ( &fixed );
+	deflate_ok ( &stored );
+	deflate_ok ( &dynamic );
+	deflate_ok ( &zlib );
+	deflate_ok ( &gzip );
+
+	/* Corrupted data */
+	ok ( deflate_test_inflate ( &zlib_corrupt, zlib_corrupt.compressed_len,
+				    zlib_corrupt.expected_len ) != 0 );
+}
+
+/** DEFLATE self-test */
+struct self_test deflate_test __self_test = {
+	.name = "deflate",
+	.exec = deflate_test_exec,
+};
@@ -0,0 +1,317 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/** @file
+ *
+ * IPv6 receive path tests
+ *
+ * Packets are passed directly to the IPv6 receive path, and any
+ * upper-layer packets are delivered to a test transport-layer
+ * protocol.
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <stdint.h>
+#include <string.h>
+#include <byteswap.h>
+#include <ipxe/iobuf.h>
+#include <ipxe/in.h>
+#include <ipxe/ip6.h>
+#include <ipxe/tcpip.h>
+#include <ipxe/test.h>
+
+/** Test transport-layer protocol number (reserved for experimentation) */
+#define IPV6_TEST_PROTO 253
+
+/** Length of test payload data */
+#define IPV6_TEST_LEN 200
+
+/** Test source address (fe80::1) */
+static const struct in6_addr ipv6_test_src = {
+	.in6_u.u6_addr8 = { 0xfe, 0x80, 0, 0, 0, 0, 0, 0,
+			    0, 0, 0, 0, 0, 0, 0, 0x01 },
+};
+
+/** Test destination address (fe80::2) */
+static const struct in6_addr ipv6_test_dest = {
+	.in6_u.u6_addr8 = { 0xfe, 0x80, 0, 0, 0, 0, 0, 0,
+			    0, 0, 0, 0, 0, 0, 0, 0x02 },
+};
+
+/** Test payload data */
+static uint8_t ipv6_test_data[IPV6_TEST_LEN];
+
+/** Most recently delivered upper-layer packet */
+static struct {
+	/** I/O buffer, or NULL */
+	struct io_buffer *iobuf;
+	/** Source address */
+	struct sockaddr_in6 src;
+	/** Destination address */
+	struct sockaddr_in6 dest;
+	/** Pseudo-header checksum */
+	uint16_t pshdr_csum;
+	/** Number of packets delivered */
+	unsigned int count;
+} ipv6_test_rx_result;
+
+/**
+ * Receive packet via test transport-layer protocol
+ *
+ * @v iobuf		I/O buffer
+ * @v st_src		Partially-filled source address
+ * @v st_dest		Partially-filled destination address
+ * @v pshdr_csum	Pseudo-header checksum
+ * @ret rc		Return status code
+ */
+static int ipv6_test_rx ( struct io_buffer *iobuf,
+			  struct sockaddr_tcpip *st_src,
+			  struct sockaddr_tcpip *st_dest,
+			  uint16_t pshdr_csum ) {
+
+	free_iob ( ipv6_test_rx_result.iobuf );
+	ipv6_test_rx_result.iobuf = iobuf;
+	memcpy ( &ipv6_test_rx_result.src, st_src,
+		 sizeof ( ipv6_test_rx_result.src ) );
+	memcpy ( &ipv6_test_rx_result.dest, st_dest,
+		 sizeof ( ipv6_test_rx_result.dest ) );
+	ipv6_test_rx_result.pshdr_csum = pshdr_csum;
+	ipv6_test_rx_result.count++;
+	return 0;
+}
+
+/** Test transport-layer protocol */
+struct tcpip_protocol ipv6_test_protocol __tcpip_protocol = {
+	.name = "IPv6TEST",
+	.rx = ipv6_test_rx,
+	.tcpip_proto = IPV6_TEST_PROTO,
+};
+
+/**
+ * Pass packet to IPv6 receive path
+ *
+ * @v nxt_hdr		Next header
+ * @v data		Data following IPv6 header
+ * @v len		Length of data following IPv6 header
+ * @v pad		Length of link-layer padding
+ */
+static void ipv6_test_packet ( uint8_t nxt_hdr, const void *data,
+			       size_t len, size_t pad ) {
+	struct io_buffer *iobuf;
+	struct ip6_header *ip6hdr;
+
+	iobuf = alloc_iob ( sizeof ( *ip6hdr ) + len + pad );
+	ok ( iobuf != NULL );
+	if ( ! iobuf )
+		return;
+	ip6hdr = iob_put ( iobuf, sizeof ( *ip6hdr ) );
+	memset ( ip6hdr, 0, sizeof ( *ip6hdr ) );
+	ip6hdr->ver_traffic_class_flow_label = htonl ( 0x60000000 );
+	ip6hdr->payload_len = htons ( len );
+	ip6hdr->nxt_hdr = nxt_hdr;
+	ip6hdr->hop_limit = 64;
+	memcpy ( &ip6hdr->src, &ipv6_test_src, sizeof ( ip6hdr->src ) );
+	memcpy ( &ip6hdr->dest, &ipv6_test_dest, sizeof ( ip6hdr->dest ) );
+	memcpy ( iob_put ( iobuf, len ), data, len );
+	memset ( iob_put ( iobuf, pad ), 0xeb, pad );
+	ipv6_protocol.rx ( iobuf, NULL, NULL, NULL, 0 );
+}
+
+/**
+ * Pass fragment of test payload data to IPv6 receive path
+ *
+ * @v ident		Identification
+ * @v offset		Offset within test payload data
+ * @v len		Length of fragment
+ * @v more		More fragments follow
+ */
+static void ipv6_test_fragment ( uint32_t ident, size_t offset, size_t len,
+				 int more ) {
+	struct {
+		struct ip6_fragment_header fraghdr;
+		uint8_t data[len];
+	} __attribute__ (( packed )) frag;
+
+	frag.fraghdr.nxt_hdr = IPV6_TEST_PROTO;
+	frag.fraghdr.reserved = 0;
+	frag.fraghdr.offset_flags =
+		htons ( offset | ( more ? IP6_MASK_MOREFRAGS : 0 ) );
+	frag.fraghdr.ident = htonl ( ident );
+	memcpy ( frag.data, &ipv6_test_data[offset], len );
+	ipv6_test_packet ( IP6_FRAGMENT, &frag, sizeof ( frag ), 0 );
+}
+
+/**
+ * Calculate expected pseudo-header checksum
+ *
+ * @v len		Upper-layer packet length
+ * @ret csum		Pseudo-header checksum
+ */
+static uint16_t ipv6_test_pshdr_chksum ( size_t len ) {
+	struct ipv6_pseudo_header pshdr;
+
+	memset ( &pshdr, 0, sizeof ( pshdr ) );
+	memcpy ( &pshdr.src, &ipv6_test_src, sizeof ( pshdr.src ) );
+	memcpy ( &pshdr.dest, &ipv6_test_dest, sizeof ( pshdr.dest ) );
+	pshdr.nxt_hdr = IPV6_TEST_PROTO;
+	pshdr.len = htons ( len );
+	return tcpip_chksum ( &pshdr, sizeof ( pshdr ) );
+}
+
+/**
+ * Check for delivery of test payload data
+ *
+ * @v delivered	Expected number of delivered packets
+ * @v offset		Offset within test payload data
+ * @v len		Expected length
+ */
+#define ipv6_test_delivered_ok( delivered, offset, len ) do {		\
+	struct io_buffer *iobuf = ipv6_test_rx_result.iobuf;		\
+									\
+	ok ( ipv6_test_rx_result.count == (delivered) );		\
+	ok ( iobuf != NULL );						\
+	if ( iobuf ) {							\
+		ok ( iob_len ( iobuf ) == (len) );			\
+		ok ( memcmp ( iobuf->data,				\
+			      &ipv6_test_data[offset], (len) ) == 0 );	\
+	}								\
+	ok ( ipv6_test_rx_result.src.sin_family == AF_INET6 );		\
+	ok ( memcmp ( &ipv6_test_rx_result.src.sin6_addr,		\
+		      &ipv6_test_src,					\
+		      sizeof ( ipv6_test_src ) ) == 0 );		\
+	ok ( memcmp ( &ipv6_test_rx_result.dest.sin6_addr,		\
+		      &ipv6_test_dest,					\
+		      sizeof ( ipv6_test_dest ) ) == 0 );		\
+	ok ( ipv6_test_rx_result.pshdr_csum ==				\
+	     ipv6_test_pshdr_chksum ( len ) );				\
+	} while ( 0 )
+
+/**
+ * Perform IPv6 receive path self-tests
+ *
+ */
+static void ipv6_test_exec ( void ) {
+	struct {
+		struct ip6_ext_header hopbyhop;
+		uint8_t hopbyhop_pad[6];
+		struct ip6_ext_header destopts;
+		uint8_t destopts_pad[14];
+		uint8_t data[64];
+	} __attribute__ (( packed )) ext;
+	struct {
+		struct ip6_routing_header routing;
+		uint8_t reserved[4];
+		uint8_t data[64];
+	} __attribute__ (( packed )) routing;
+	unsigned int i;
+
+	/* Construct test payload data */
+	for ( i = 0 ; i < sizeof ( ipv6_test_data ) ; i++ )
+		ipv6_test_data[i] = ( ( i * 7 ) + 3 );
+
+	/* Upper-layer packet immediately following IPv6 header */
+	ipv6_test_packet ( IPV6_TEST_PROTO, ipv6_test_data, 64, 0 );
+	ipv6_test_delivered_ok ( 1, 0, 64 );
+
+	/* Link-layer padding is stripped */
+	ipv6_test_packet ( IPV6_TEST_PROTO, ipv6_test_data, 30, 16 );
+	ipv6_test_delivered_ok ( 2, 0, 30 );
+
+	/* Hop-by-hop and destination options headers are skipped.
+	 * (Zero-filled padding forms valid Pad1 options.)
+	 */
+	memset ( &ext, 0, sizeof ( ext ) );
+	ext.hopbyhop.nxt_hdr = IP6_DEST_OPTS;
+	ext.hopbyhop.len = 0;
+	ext.destopts.nxt_hdr = IPV6_TEST_PROTO;
+	ext.destopts.len = 1;
+	memcpy ( ext.data, ipv6_test_data, sizeof ( ext.data ) );
+	ipv6_test_packet ( IP6_HOPBYHOP, &ext, sizeof ( ext ), 0 );
+	ipv6_test_delivered_ok ( 3, 0, sizeof ( ext.data ) );
+
+	/* Truncated extension header is dropped */
+	ipv6_test_packet ( IP6_HOPBYHOP, &ext, 4, 0 );
+	ok ( ipv6_test_rx_result.count == 3 );
+
+	/* Routing header with no segments left is skipped */
+	memset ( &routing, 0, sizeof ( routing ) );
+	routing.routing.nxt_hdr = IPV6_TEST_PROTO;
+	routing.routing.len = 0;
+	memcpy ( routing.data, ipv6_test_data, sizeof ( routing.data ) );
+	ipv6_test_packet ( IP6_ROUTING, &routing, sizeof ( routing ), 0 );
+	ipv6_test_delivered_ok ( 4, 0, sizeof ( routing.data ) );
+
+	/* Source-routed packet is dropped */
+	routing.routing.segments_left = 1;
+	ipv6_test_packet ( IP6_ROUTING, &routing, sizeof ( routing ), 0 );
+	ok ( ipv6_test_rx_result.count == 4 );
+
+	/* Atomic fragment is delivered immediately */
+	ipv6_test_fragment ( 0x1000, 0, 40, 0 );
+	ipv6_test_delivered_ok ( 5, 0, 40 );
+
+	/* Fragments are reassembled in any order */
+	ipv6_test_fragment ( 0x1001, 128, ( IPV6_TEST_LEN - 128 ), 0 );
+	ok ( ipv6_test_rx_result.count == 5 );
+	ipv6_test_fragment ( 0x1001, 0, 64, 1 );
+	ok ( ipv6_test_rx_result.count == 5 );
+	ipv6_test_fragment ( 0x1001, 64, 64, 1 );
+	ipv6_test_delivered_ok ( 6, 0, IPV6_TEST_LEN );
+
+	/* Interleaved datagrams are reassembled independently */
+	ipv6_test_fragment ( 0x1002, 0, 96, 1 );
+	ipv6_test_fragment ( 0x1003, 0, 48, 1 );
+	ipv6_test_fragment ( 0x1002, 96, ( IPV6_TEST_LEN - 96 ), 0 );
+	ipv6_test_delivered_ok ( 7, 0, IPV6_TEST_LEN );
+	ipv6_test_fragment ( 0x1003, 48, 48, 0 );
+	ipv6_test_delivered_ok ( 8, 0, 96 );
+
+	/* Non-final fragment that is not a multiple of 8 octets is
+	 * dropped, without affecting the remainder of the datagram.
+	 */
+	ipv6_test_fragment ( 0x1004, 0, 60, 1 );
+	ipv6_test_fragment ( 0x1004, 0, 64, 1 );
+	ipv6_test_fragment ( 0x1004, 64, 16, 0 );
+	ipv6_test_delivered_ok ( 9, 0, 80 );
+
+	/* Overlapping fragments cause the whole datagram to be
+	 * discarded, after which the identification may be reused.
+	 */
+	ipv6_test_fragment ( 0x1005, 0, 64, 1 );
+	ipv6_test_fragment ( 0x1005, 56, 64, 1 );
+	ok ( ipv6_test_rx_result.count == 9 );
+	ipv6_test_fragment ( 0x1005, 64, 32, 0 );
+	ok ( ipv6_test_rx_result.count == 9 );
+	ipv6_test_fragment ( 0x1005, 0, 64, 1 );
+	ipv6_test_delivered_ok ( 10, 0, 96 );
+
+	/* Free last delivered packet */
+	free_iob ( ipv6_test_rx_result.iobuf );
+	ipv6_test_rx_result.iobuf = NULL;
+}
+
+/** IPv6 receive path self-test */
+struct self_test ipv6_test __self_test = {
+	.name = "ipv6",
+	.exec = ipv6_test_exec,
+};
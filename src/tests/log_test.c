@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/** @file
+ *
+ * Log ring buffer tests
+ *
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <ipxe/log.h>
+#include <ipxe/test.h>
+
+/**
+ * Dummy log ring transmit method
+ *
+ * @v ring		Log ring
+ * @ret rc		Return status code
+ */
+static int log_test_flush ( struct log_ring *ring __unused ) {
+	return -ENOTSUP;
+}
+
+/**
+ * Perform log ring buffer self-tests
+ *
+ */
+static void log_test_exec ( void ) {
+	static char data[32];
+	struct log_ring ring = LOG_RING_INIT ( ring, data, log_test_flush );
+	char buf[64];
+	unsigned int i;
+
+	/* Empty ring has no records */
+	ok ( log_ring_fill ( &ring ) == 0 );
+	ok ( log_ring_record_len ( &ring ) == 0 );
+	ok ( log_ring_get ( &ring, buf, sizeof ( buf ) ) == 0 );
+
+	/* Records are queued and the flush process started */
+	ok ( log_ring_put ( &ring, "one\n", 4 ) == 0 );
+	ok ( log_ring_put ( &ring, "three\n", 6 ) == 0 );
+	ok ( process_running ( &ring.process ) );
+	ok ( log_ring_fill ( &ring ) == 10 );
+	ok ( log_ring_record_len ( &ring ) == 4 );
+
+	/* Only complete records are removed */
+	ok ( log_ring_get ( &ring, buf, 9 ) == 4 );
+	ok ( memcmp ( buf, "one\n", 4 ) == 0 );
+	ok ( log_ring_get ( &ring, buf, 5 ) == 0 );
+	ok ( log_ring_get ( &ring, buf, sizeof ( buf ) ) == 6 );
+	ok ( memcmp ( buf, "three\n", 6 ) == 0 );
+	ok ( log_ring_fill ( &ring ) == 0 );
+
+	/* Records wrap around the end of the buffer */
+	for ( i = 0 ; i < 8 ; i++ ) {
+		ok ( log_ring_put ( &ring, "wrapping\n", 9 ) == 0 );
+		ok ( log_ring_put ( &ring, "ring\n", 5 ) == 0 );
+		ok ( log_ring_get ( &ring, buf, sizeof ( buf ) ) == 14 );
+		ok ( memcmp ( buf, "wrapping\nring\n", 14 ) == 0 );
+	}
+
+	/* Records are dropped when the ring is full */
+	ok ( ring.dropped == 0 );
+	ok ( log_ring_put ( &ring, "0123456789abcdef\n", 17 ) == 0 );
+	ok ( log_ring_put ( &ring, "0123456789abcdef\n", 17 ) != 0 );
+	ok ( ring.dropped == 1 );
+	ok ( log_ring_put ( &ring, "0123456789abcd\n", 15 ) == 0 );
+	ok ( log_ring_fill ( &ring ) == sizeof ( data ) );
+	ok ( log_ring_get ( &ring, buf, sizeof ( buf ) ) == sizeof ( data ) );
+	ok ( memcmp ( buf, "0123456789abcdef\n0123456789abcd\n",
+		      sizeof ( data ) ) == 0 );
+
+	/* Stop flush process */
+	process_del ( &ring.process );
+	ok ( ! process_running ( &ring.process ) );
+}
+
+/** Log ring buffer self-test */
+struct self_test log_test __self_test = {
+	.name = "log",
+	.exec = log_test_exec,
+};
@@ -0,0 +1,328 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/** @file
+ *
+ * LZ4 decompression tests
+ *
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <ipxe/lz4.h>
+#include <ipxe/test.h>
+
+/** Define inline compressed data */
+#define COMPRESSED(...) { __VA_ARGS__ }
+
+/** Define inline expected data */
+#define EXPECTED(...) { __VA_ARGS__ }
+
+/** An LZ4 test */
+struct lz4_test {
+	/** Compressed data */
+	const void *compressed;
+	/** Length of compressed data */
+	size_t compressed_len;
+	/** Expected decompressed data */
+	const void *expected;
+	/** Length of expected decompressed data */
+	size_t expected_len;
+};
+
+/**
+ * Define an LZ4 test
+ *
+ * @v name		Test name
+ * @v compressed_array	Compressed data
+ * @v expected_array	Expected decompressed data
+ * @ret test		LZ4 test
+ */
+#define LZ4_TEST( name, compressed_array, expected_array )		\
+	static const uint8_t name ## _compressed[] = compressed_array;	\
+	static const uint8_t name ## _expected[] = expected_array;	\
+	static struct lz4_test name = {					\
+		.compressed = name ## _compressed,			\
+		.compressed_len = sizeof ( name ## _compressed ),	\
+		.expected = name ## _expected,				\
+		.expected_len = sizeof ( name ## _expected ),		\
+	}
+
+/**
+ * Define an LZ4 test of the standard text
+ *
+ * @v name		Test name
+ * @v compressed_array	Compressed data
+ * @ret test		LZ4 test
+ */
+#define LZ4_TEXT_TEST( name, compressed_array )				\
+	static const uint8_t name ## _compressed[] = compressed_array;	\
+	static struct lz4_test name = {					\
+		.compressed = name ## _compressed,			\
+		.compressed_len = sizeof ( name ## _compressed ),	\
+		.expected = lz4_text,					\
+		.expected_len = sizeof ( lz4_text ),			\
+	}
+
+/** Number of words in standard text */
+#define LZ4_TEXT_WORDS 120
+
+/** Length of standard text */
+#define LZ4_TEXT_LEN 760
+
+/** Vocabulary used to construct standard text */
+static const char *lz4_words[] = {
+	"Lorem", "ipsum", "dolor", "sit", "amet", "consectetur",
+	"adipiscing", "elit", "sed", "do", "eiusmod", "tempor",
+	"incididunt", "ut", "labore", "et", "dolore", "magna", "aliqua",
+};
+
+/** Standard text (long enough to contain back-references) */
+static uint8_t lz4_text[LZ4_TEXT_LEN];
+
+/** Uncompressed block */
+LZ4_TEST ( stored,
+	COMPRESSED ( 0x04, 0x22, 0x4d, 0x18, 0x64, 0x40, 0xa7, 0x0b,
+		     0x00, 0x00, 0x80, 0x68, 0x65, 0x6c, 0x6c, 0x6f,
+		     0x20, 0x77, 0x6f, 0x72, 0x6c, 0x64, 0x00, 0x00,
+		     0x00, 0x00, 0x22, 0x66, 0xbb, 0xce ),
+	EXPECTED ( 0x68, 0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x77, 0x6f,
+		   0x72, 0x6c, 0x64 ) );
+
+/** Compressed block, with content size */
+LZ4_TEXT_TEST ( compressed,
+	COMPRESSED ( 0x04, 0x22, 0x4d, 0x18, 0x6c, 0x40, 0xf8, 0x02,
+		     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x54, 0xe1,
+		     0x00, 0x00, 0x00, 0xf2, 0x0b, 0x4c, 0x6f, 0x72,
+		     0x65, 0x6d, 0x20, 0x65, 0x6c, 0x69, 0x74, 0x20,
+		     0x6c, 0x61, 0x62, 0x6f, 0x72, 0x65, 0x20, 0x64,
+		     0x6f, 0x6c, 0x6f, 0x72, 0x20, 0x64, 0x6f, 0x09,
+		     0x00, 0xfd, 0x4a, 0x65, 0x20, 0x61, 0x6d, 0x65,
+		     0x74, 0x20, 0x74, 0x65, 0x6d, 0x70, 0x6f, 0x72,
+		     0x20, 0x61, 0x6c, 0x69, 0x71, 0x75, 0x61, 0x20,
+		     0x61, 0x64, 0x69, 0x70, 0x69, 0x73, 0x63, 0x69,
+		     0x6e, 0x67, 0x20, 0x75, 0x74, 0x0a, 0x69, 0x70,
+		     0x73, 0x75, 0x6d, 0x20, 0x73, 0x65, 0x64, 0x20,
+		     0x65, 0x74, 0x20, 0x73, 0x69, 0x74, 0x20, 0x65,
+		     0x69, 0x75, 0x73, 0x6d, 0x6f, 0x64, 0x20, 0x6d,
+		     0x61, 0x67, 0x6e, 0x61, 0x20, 0x63, 0x6f, 0x6e,
+		     0x73, 0x65, 0x63, 0x74, 0x65, 0x74, 0x75, 0x72,
+		     0x20, 0x69, 0x6e, 0x63, 0x69, 0x64, 0x69, 0x64,
+		     0x75, 0x6e, 0x74, 0x20, 0x79, 0x00, 0x1f, 0x0a,
+		     0x79, 0x00, 0x1d, 0x18, 0x20, 0x79, 0x00, 0x1f,
+		     0x0a, 0x79, 0x00, 0x27, 0x02, 0xe9, 0x00, 0x06,
+		     0xf2, 0x00, 0x1f, 0x0a, 0xf2, 0x00, 0x0d, 0x09,
+		     0x79, 0x00, 0x0e, 0xf2, 0x00, 0x1f, 0x0a, 0xf2,
+		     0x00, 0x15, 0x0c, 0x79, 0x00, 0x1e, 0x20, 0x79,
+		     0x00, 0x19, 0x0a, 0x6b, 0x01, 0x0f, 0x79, 0x00,
+		     0x0c, 0x0f, 0x6b, 0x01, 0x0a, 0x1f, 0x0a, 0xe4,
+		     0x01, 0x29, 0x02, 0x79, 0x00, 0x1f, 0x0a, 0xe4,
+		     0x01, 0x2e, 0x02, 0xf2, 0x00, 0x1f, 0x0a, 0x5d,
+		     0x02, 0x17, 0x02, 0x79, 0x00, 0x07, 0x5d, 0x02,
+		     0x1f, 0x0a, 0x5d, 0x02, 0x23, 0x02, 0x79, 0x00,
+		     0xb0, 0x20, 0x64, 0x6f, 0x20, 0x64, 0x6f, 0x6c,
+		     0x6f, 0x72, 0x65, 0x20, 0x00, 0x00, 0x00, 0x00,
+		     0x17, 0x8d, 0x81, 0x4c ) );
+
+/** Compressed block, with block checksums */
+LZ4_TEXT_TEST ( checksummed,
+	COMPRESSED ( 0x04, 0x22, 0x4d, 0x18, 0x74, 0x40, 0xbd, 0xe1,
+		     0x00, 0x00, 0x00, 0xf2, 0x0b, 0x4c, 0x6f, 0x72,
+		     0x65, 0x6d, 0x20, 0x65, 0x6c, 0x69, 0x74, 0x20,
+		     0x6c, 0x61, 0x62, 0x6f, 0x72, 0x65, 0x20, 0x64,
+		     0x6f, 0x6c, 0x6f, 0x72, 0x20, 0x64, 0x6f, 0x09,
+		     0x00, 0xfd, 0x4a, 0x65, 0x20, 0x61, 0x6d, 0x65,
+		     0x74, 0x20, 0x74, 0x65, 0x6d, 0x70, 0x6f, 0x72,
+		     0x20, 0x61, 0x6c, 0x69, 0x71, 0x75, 0x61, 0x20,
+		     0x61, 0x64, 0x69, 0x70, 0x69, 0x73, 0x63, 0x69,
+		     0x6e, 0x67, 0x20, 0x75, 0x74, 0x0a, 0x69, 0x70,
+		     0x73, 0x75, 0x6d, 0x20, 0x73, 0x65, 0x64, 0x20,
+		     0x65, 0x74, 0x20, 0x73, 0x69, 0x74, 0x20, 0x65,
+		     0x69, 0x75, 0x73, 0x6d, 0x6f, 0x64, 0x20, 0x6d,
+		     0x61, 0x67, 0x6e, 0x61, 0x20, 0x63, 0x6f, 0x6e,
+		     0x73, 0x65, 0x63, 0x74, 0x65, 0x74, 0x75, 0x72,
+		     0x20, 0x69, 0x6e, 0x63, 0x69, 0x64, 0x69, 0x64,
+		     0x75, 0x6e, 0x74, 0x20, 0x79, 0x00, 0x1f, 0x0a,
+		     0x79, 0x00, 0x1d, 0x18, 0x20, 0x79, 0x00, 0x1f,
+		     0x0a, 0x79, 0x00, 0x27, 0x02, 0xe9, 0x00, 0x06,
+		     0xf2, 0x00, 0x1f, 0x0a, 0xf2, 0x00, 0x0d, 0x09,
+		     0x79, 0x00, 0x0e, 0xf2, 0x00, 0x1f, 0x0a, 0xf2,
+		     0x00, 0x15, 0x0c, 0x79, 0x00, 0x1e, 0x20, 0x79,
+		     0x00, 0x19, 0x0a, 0x6b, 0x01, 0x0f, 0x79, 0x00,
+		     0x0c, 0x0f, 0x6b, 0x01, 0x0a, 0x1f, 0x0a, 0xe4,
+		     0x01, 0x29, 0x02, 0x79, 0x00, 0x1f, 0x0a, 0xe4,
+		     0x01, 0x2e, 0x02, 0xf2, 0x00, 0x1f, 0x0a, 0x5d,
+		     0x02, 0x17, 0x02, 0x79, 0x00, 0x07, 0x5d, 0x02,
+		     0x1f, 0x0a, 0x5d, 0x02, 0x23, 0x02, 0x79, 0x00,
+		     0xb0, 0x20, 0x64, 0x6f, 0x20, 0x64, 0x6f, 0x6c,
+		     0x6f, 0x72, 0x65, 0x20, 0x0a, 0x50, 0x08, 0x90,
+		     0x00, 0x00, 0x00, 0x00, 0x17, 0x8d, 0x81, 0x4c ) );
+
+/** Legacy frame format */
+LZ4_TEXT_TEST ( legacy,
+	COMPRESSED ( 0x02, 0x21, 0x4c, 0x18, 0xe1, 0x00, 0x00, 0x00,
+		     0xf2, 0x0b, 0x4c, 0x6f, 0x72, 0x65, 0x6d, 0x20,
+		     0x65, 0x6c, 0x69, 0x74, 0x20, 0x6c, 0x61, 0x62,
+		     0x6f, 0x72, 0x65, 0x20, 0x64, 0x6f, 0x6c, 0x6f,
+		     0x72, 0x20, 0x64, 0x6f, 0x09, 0x00, 0xfd, 0x4a,
+		     0x65, 0x20, 0x61, 0x6d, 0x65, 0x74, 0x20, 0x74,
+		     0x65, 0x6d, 0x70, 0x6f, 0x72, 0x20, 0x61, 0x6c,
+		     0x69, 0x71, 0x75, 0x61, 0x20, 0x61, 0x64, 0x69,
+		     0x70, 0x69, 0x73, 0x63, 0x69, 0x6e, 0x67, 0x20,
+		     0x75, 0x74, 0x0a, 0x69, 0x70, 0x73, 0x75, 0x6d,
+		     0x20, 0x73, 0x65, 0x64, 0x20, 0x65, 0x74, 0x20,
+		     0x73, 0x69, 0x74, 0x20, 0x65, 0x69, 0x75, 0x73,
+		     0x6d, 0x6f, 0x64, 0x20, 0x6d, 0x61, 0x67, 0x6e,
+		     0x61, 0x20, 0x63, 0x6f, 0x6e, 0x73, 0x65, 0x63,
+		     0x74, 0x65, 0x74, 0x75, 0x72, 0x20, 0x69, 0x6e,
+		     0x63, 0x69, 0x64, 0x69, 0x64, 0x75, 0x6e, 0x74,
+		     0x20, 0x79, 0x00, 0x1f, 0x0a, 0x79, 0x00, 0x1d,
+		     0x18, 0x20, 0x79, 0x00, 0x1f, 0x0a, 0x79, 0x00,
+		     0x27, 0x02, 0xe9, 0x00, 0x06, 0xf2, 0x00, 0x1f,
+		     0x0a, 0xf2, 0x00, 0x0d, 0x09, 0x79, 0x00, 0x0e,
+		     0xf2, 0x00, 0x1f, 0x0a, 0xf2, 0x00, 0x15, 0x0c,
+		     0x79, 0x00, 0x1e, 0x20, 0x79, 0x00, 0x19, 0x0a,
+		     0x6b, 0x01, 0x0f, 0x79, 0x00, 0x0c, 0x0f, 0x6b,
+		     0x01, 0x0a, 0x1f, 0x0a, 0xe4, 0x01, 0x29, 0x02,
+		     0x79, 0x00, 0x1f, 0x0a, 0xe4, 0x01, 0x2e, 0x02,
+		     0xf2, 0x00, 0x1f, 0x0a, 0x5d, 0x02, 0x17, 0x02,
+		     0x79, 0x00, 0x07, 0x5d, 0x02, 0x1f, 0x0a, 0x5d,
+		     0x02, 0x23, 0x02, 0x79, 0x00, 0xb0, 0x20, 0x64,
+		     0x6f, 0x20, 0x64, 0x6f, 0x6c, 0x6f, 0x72, 0x65,
+		     0x20 ) );
+
+/** Skippable frame followed by uncompressed block */
+LZ4_TEST ( skippable,
+	COMPRESSED ( 0x50, 0x2a, 0x4d, 0x18, 0x04, 0x00, 0x00, 0x00,
+		     0xde, 0xad, 0xbe, 0xef, 0x04, 0x22, 0x4d, 0x18,
+		     0x64, 0x40, 0xa7, 0x0b, 0x00, 0x00, 0x80, 0x68,
+		     0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x77, 0x6f, 0x72,
+		     0x6c, 0x64, 0x00, 0x00, 0x00, 0x00, 0x22, 0x66,
+		     0xbb, 0xce ),
+	EXPECTED ( 0x68, 0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x77, 0x6f,
+		   0x72, 0x6c, 0x64 ) );
+
+/** Back-reference beyond start of data */
+LZ4_TEST ( bad_distance,
+	COMPRESSED ( 0x04, 0x22, 0x4d, 0x18, 0x60, 0x40, 0x82, 0x04,
+		     0x00, 0x00, 0x00, 0x10, 0x61, 0x02, 0x00, 0x00,
+		     0x00, 0x00, 0x00 ),
+	EXPECTED ( 0x61 ) );
+
+/** Missing content checksum */
+LZ4_TEST ( truncated,
+	COMPRESSED ( 0x04, 0x22, 0x4d, 0x18, 0x64, 0x40, 0xa7, 0x0b,
+		     0x00, 0x00, 0x80, 0x68, 0x65, 0x6c, 0x6c, 0x6f,
+		     0x20, 0x77, 0x6f, 0x72, 0x6c, 0x64, 0x00, 0x00,
+		     0x00, 0x00 ),
+	EXPECTED ( 0x68, 0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x77, 0x6f,
+		   0x72, 0x6c, 0x64 ) );
+
+/**
+ * Construct standard text
+ *
+ */
+static void lz4_text_init ( void ) {
+	unsigned int num_words = ( sizeof ( lz4_words ) /
+				   sizeof ( lz4_words[0] ) );
+	const char *word;
+	size_t len = 0;
+	unsigned int i;
+
+	for ( i = 0 ; i < LZ4_TEXT_WORDS ; i++ ) {
+		word = lz4_words[ ( i * 7 ) % num_words ];
+		assert ( ( len + strlen ( word ) + 1 ) <=
+			 sizeof ( lz4_text ) );
+		memcpy ( &lz4_text[len], word, strlen ( word ) );
+		len += strlen ( word );
+		lz4_text[len++] = ( ( ( i % 11 ) == 10 ) ? '\n' : ' ' );
+	}
+	assert ( len == sizeof ( lz4_text ) );
+}
+
+/**
+ * Decompress LZ4 test data
+ *
+ * @v test		LZ4 test
+ * @ret rc		Return status code
+ */
+static int lz4_test_decompress ( struct lz4_test *test ) {
+	uint8_t data[ test->expected_len ];
+	size_t len;
+	int rc;
+
+	/* Calculate decompressed length */
+	if ( ( rc = lz4_decompress ( test->compressed, test->compressed_len,
+				     NULL, &len ) ) != 0 )
+		return rc;
+	if ( len != test->expected_len )
+		return -EINVAL;
+
+	/* Check that a too-short output buffer is rejected */
+	len = ( test->expected_len - 1 );
+	if ( lz4_decompress ( test->compressed, test->compressed_len,
+			      data, &len ) == 0 )
+		return -EINVAL;
+
+	/* Decompress and check data */
+	len = sizeof ( data );
+	if ( ( rc = lz4_decompress ( test->compressed, test->compressed_len,
+				     data, &len ) ) != 0 )
+		return rc;
+	if ( len != test->expected_len )
+		return -EINVAL;
+	if ( memcmp ( data, test->expected, test->expected_len ) != 0 )
+		return -EINVAL;
+
+	return 0;
+}
+
+/**
+ * Perform LZ4 self-test
+ *
+ */
+static void lz4_test_exec ( void ) {
+
+	/* Construct standard text */
+	lz4_text_init();
+
+	/* Valid data */
+	ok ( lz4_test_decompress ( &stored ) == 0 );
+	ok ( lz4_test_decompress ( &compressed ) == 0 );
+	ok ( lz4_test_decompress ( &checksummed ) == 0 );
+	ok ( lz4_test_decompress ( &legacy ) == 0 );
+	ok ( lz4_test_decompress ( &skippable ) == 0 );
+
+	/* Corrupted data */
+	ok ( lz4_test_decompress ( &bad_distance ) != 0 );
+	ok ( lz4_test_decompress ( &truncated ) != 0 );
+}
+
+/** LZ4 self-test */
+struct self_test lz4_test __self_test = {
+	.name = "lz4",
+	.exec = lz4_test_exec,
+};
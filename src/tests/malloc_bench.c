@@ -0,0 +1,595 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/** @file
+ *
+ * Memory allocator benchmarks
+ *
+ * Each benchmark replays a synthetic allocation trace modelled on a
+ * real workload, timing every individual allocation and free using
+ * the CPU timestamp counter.  The throughput, the worst-case latency
+ * of any single operation, and the amount by which the heap had to
+ * grow (relative to the peak amount of live data) are reported.
+ * Cached data such as pooled I/O buffers is discarded before and
+ * after each heap benchmark.
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <ipxe/profile.h>
+#include <ipxe/malloc.h>
+#include <ipxe/umalloc.h>
+#include <ipxe/iobuf.h>
+#include <ipxe/test.h>
+
+/** Duration of timestamp counter calibration (in milliseconds) */
+#define BENCH_CALIBRATE_MS 100
+
+/** Length of simulated HTTP download */
+#define BENCH_HTTP_LEN ( 1024 * 1024 * 1024ULL )
+
+/** TCP payload carried by each simulated HTTP packet */
+#define BENCH_HTTP_MSS 1460
+
+/** Length of each simulated receive buffer */
+#define BENCH_HTTP_RX_LEN 1536
+
+/** Number of simulated receive buffers outstanding at any time */
+#define BENCH_HTTP_RX_FILL 64
+
+/** Number of received packets per simulated transmitted ACK */
+#define BENCH_HTTP_ACK_RATIO 2
+
+/** Length of each simulated ACK buffer */
+#define BENCH_HTTP_ACK_LEN 256
+
+/** Number of simulated TLS records */
+#define BENCH_TLS_RECORDS 8192
+
+/** Maximum TLS record plaintext length */
+#define BENCH_TLS_MAX_LEN 16384
+
+/** TLS record header, MAC and padding overhead */
+#define BENCH_TLS_OVERHEAD 325
+
+/** Number of simulated iSCSI PDUs */
+#define BENCH_ISCSI_PDUS 65536
+
+/** Number of simulated iSCSI PDUs outstanding at any time */
+#define BENCH_ISCSI_FILL 8
+
+/** Length of an iSCSI basic header segment */
+#define BENCH_ISCSI_BHS_LEN 48
+
+/** Length of an iSCSI data segment */
+#define BENCH_ISCSI_DATA_LEN 8192
+
+/** Length of a simulated SCSI command structure */
+#define BENCH_ISCSI_CMD_LEN 232
+
+/** Number of simulated string operations */
+#define BENCH_STRING_OPS 262144
+
+/** Number of simulated strings live at any time */
+#define BENCH_STRING_FILL 64
+
+/** Maximum length of a simulated string */
+#define BENCH_STRING_MAX_LEN 4096
+
+/** Maximum length of a simulated download buffer */
+#define BENCH_UMALLOC_LEN ( 16 * 1024 * 1024 )
+
+/** Growth step for a simulated download buffer */
+#define BENCH_UMALLOC_STEP ( 64 * 1024 )
+
+/** Number of simulated downloads */
+#define BENCH_UMALLOC_RUNS 4
+
+/** An allocation benchmark */
+struct malloc_bench {
+	/** Name */
+	const char *name;
+	/** Number of operations performed */
+	unsigned long ops;
+	/** Total elapsed ticks */
+	unsigned long long ticks;
+	/** Worst-case elapsed ticks for a single operation */
+	unsigned long worst;
+	/** Number of failed allocations */
+	unsigned int failures;
+	/** Amount of live data */
+	size_t live;
+	/** Peak amount of live data */
+	size_t peak;
+	/** Free heap memory before starting */
+	size_t freemem;
+};
+
+/** Timestamp counter ticks per second */
+static unsigned long long bench_ticks_per_sec;
+
+/** Pseudo-random number generator state */
+static uint32_t bench_seed;
+
+/** Simulated buffer pointers */
+static void *bench_ptrs[ BENCH_STRING_FILL ];
+
+/** Simulated buffer lengths */
+static size_t bench_lens[ BENCH_STRING_FILL ];
+
+/** Simulated I/O buffers */
+static struct io_buffer *bench_iobufs[ BENCH_HTTP_RX_FILL ];
+
+/**
+ * Generate pseudo-random number
+ *
+ * @v max		Upper bound (exclusive)
+ * @ret value		Pseudo-random number in the range [0,max)
+ */
+static unsigned int bench_random ( unsigned int max ) {
+
+	bench_seed = ( ( bench_seed * 1103515245UL ) + 12345 );
+	return ( ( bench_seed >> 8 ) % max );
+}
+
+/**
+ * Calibrate timestamp counter
+ *
+ */
+static void bench_calibrate ( void ) {
+	union profiler profiler;
+	unsigned long ticks;
+
+	profile ( &profiler );
+	mdelay ( BENCH_CALIBRATE_MS );
+	ticks = profile ( &profiler );
+	bench_ticks_per_sec = ( ( ticks * 1000ULL ) / BENCH_CALIBRATE_MS );
+	printf ( "BENCH timestamp counter: %lld ticks/sec\n",
+		 bench_ticks_per_sec );
+}
+
+/**
+ * Discard all cached data
+ *
+ * Pooled I/O buffers (and any other cached data) are returned to the
+ * heap, so that the amount of free memory can be compared before and
+ * after each benchmark.
+ */
+static void bench_discard ( void ) {
+	struct cache_discarder *discarder;
+
+	for_each_table_entry ( discarder, CACHE_DISCARDERS ) {
+		while ( discarder->discard() ) {}
+	}
+}
+
+/**
+ * Start benchmark
+ *
+ * @v bench		Allocation benchmark
+ * @v name		Name
+ */
+static void bench_start ( struct malloc_bench *bench, const char *name ) {
+
+	memset ( bench, 0, sizeof ( *bench ) );
+	bench->name = name;
+	bench_discard();
+	bench->freemem = freemem;
+	bench_seed = 0;
+}
+
+/**
+ * Record completed operation
+ *
+ * @v bench		Allocation benchmark
+ * @v ticks		Elapsed ticks
+ * @v len		Change in amount of live data
+ */
+static void bench_record ( struct malloc_bench *bench, unsigned long ticks,
+			   ssize_t len ) {
+
+	bench->ops++;
+	bench->ticks += ticks;
+	if ( ticks > bench->worst )
+		bench->worst = ticks;
+	bench->live += len;
+	if ( bench->live > bench->peak )
+		bench->peak = bench->live;
+}
+
+/**
+ * Report benchmark results
+ *
+ * @v bench		Allocation benchmark
+ * @v heap		Benchmark uses the heap
+ */
+static void bench_report ( struct malloc_bench *bench, int heap ) {
+	unsigned long long avg;
+	unsigned long long ops_per_sec;
+	unsigned long long worst_ns;
+
+	/* Sanity checks */
+	ok ( bench->ops != 0 );
+	ok ( bench->failures == 0 );
+	ok ( bench->live == 0 );
+
+	/* Calculate results */
+	avg = ( bench->ticks / bench->ops );
+	ops_per_sec = ( avg ? ( bench_ticks_per_sec / avg ) : 0 );
+	worst_ns = ( bench_ticks_per_sec ?
+		     ( ( bench->worst * 1000000000ULL ) /
+		       bench_ticks_per_sec ) : 0 );
+	printf ( "BENCH %s: %ld ops, %lld cycles/op, %lld ops/sec, worst "
+		 "%ld cycles (%lld.%03lldus)", bench->name, bench->ops, avg,
+		 ops_per_sec, bench->worst, ( worst_ns / 1000 ),
+		 ( worst_ns % 1000 ) );
+	if ( heap ) {
+		/* All blocks have been freed, so any increase in free
+		 * memory is external memory added to the heap.
+		 */
+		bench_discard();
+		ok ( freemem >= bench->freemem );
+		printf ( ", peak %zdkB live, heap grew %zdkB",
+			 ( bench->peak / 1024 ),
+			 ( ( freemem - bench->freemem ) / 1024 ) );
+	}
+	printf ( "\n" );
+}
+
+/**
+ * Allocate memory block
+ *
+ * @v bench		Allocation benchmark
+ * @v len		Length
+ * @ret ptr		Allocated memory, or NULL
+ */
+static void * bench_malloc ( struct malloc_bench *bench, size_t len ) {
+	union profiler profiler;
+	unsigned long ticks;
+	void *ptr;
+
+	profile ( &profiler );
+	ptr = malloc ( len );
+	ticks = profile ( &profiler );
+	if ( ! ptr ) {
+		bench->failures++;
+		return NULL;
+	}
+	bench_record ( bench, ticks, len );
+	return ptr;
+}
+
+/**
+ * Reallocate memory block
+ *
+ * @v bench		Allocation benchmark
+ * @v ptr		Existing memory
+ * @v old_len		Existing length
+ * @v new_len		New length
+ * @ret ptr		Reallocated memory, or NULL
+ */
+static void * bench_realloc ( struct malloc_bench *bench, void *ptr,
+			      size_t old_len, size_t new_len ) {
+	union profiler profiler;
+	unsigned long ticks;
+	void *new_ptr;
+
+	profile ( &profiler );
+	new_ptr = realloc ( ptr, new_len );
+	ticks = profile ( &profiler );
+	if ( ! new_ptr ) {
+		bench->failures++;
+		return NULL;
+	}
+	bench_record ( bench, ticks, ( new_len - old_len ) );
+	return new_ptr;
+}
+
+/**
+ * Free memory block
+ *
+ * @v bench		Allocation benchmark
+ * @v ptr		Allocated memory
+ * @v len		Length
+ */
+static void bench_free ( struct malloc_bench *bench, void *ptr, size_t len ) {
+	union profiler profiler;
+	unsigned long ticks;
+
+	profile ( &profiler );
+	free ( ptr );
+	ticks = profile ( &profiler );
+	bench_record ( bench, ticks, -len );
+}
+
+/**
+ * Allocate I/O buffer
+ *
+ * @v bench		Allocation benchmark
+ * @v len		Length
+ * @ret iobuf		I/O buffer, or NULL
+ */
+static struct io_buffer * bench_alloc_iob ( struct malloc_bench *bench,
+					    size_t len ) {
+	union profiler profiler;
+	struct io_buffer *iobuf;
+	unsigned long ticks;
+
+	profile ( &profiler );
+	iobuf = alloc_iob ( len );
+	ticks = profile ( &profiler );
+	if ( ! iobuf ) {
+		bench->failures++;
+		return NULL;
+	}
+	bench_record ( bench, ticks, len );
+	iob_put ( iobuf, len );
+	return iobuf;
+}
+
+/**
+ * Free I/O buffer
+ *
+ * @v bench		Allocation benchmark
+ * @v iobuf		I/O buffer, or NULL
+ */
+static void bench_free_iob ( struct malloc_bench *bench,
+			     struct io_buffer *iobuf ) {
+	union profiler profiler;
+	unsigned long ticks;
+	size_t len;
+
+	if ( ! iobuf )
+		return;
+	len = iob_len ( iobuf );
+	profile ( &profiler );
+	free_iob ( iobuf );
+	ticks = profile ( &profiler );
+	bench_record ( bench, ticks, -len );
+}
+
+/**
+ * Benchmark I/O buffer churn of an HTTP download
+ *
+ * Received packets are allocated into a receive ring and freed once
+ * processed, with a transmitted ACK allocated and freed for every
+ * few received packets.
+ */
+static void bench_http ( void ) {
+	struct malloc_bench bench;
+	struct io_buffer *ack;
+	unsigned long packets = ( BENCH_HTTP_LEN / BENCH_HTTP_MSS );
+	unsigned long i;
+	unsigned int slot;
+
+	bench_start ( &bench, "http-iobuf" );
+	for ( i = 0 ; i < packets ; i++ ) {
+		slot = ( i % BENCH_HTTP_RX_FILL );
+		bench_free_iob ( &bench, bench_iobufs[slot] );
+		bench_iobufs[slot] = bench_alloc_iob ( &bench,
+						       BENCH_HTTP_RX_LEN );
+		if ( ( i % BENCH_HTTP_ACK_RATIO ) == 0 ) {
+			ack = bench_alloc_iob ( &bench, BENCH_HTTP_ACK_LEN );
+			bench_free_iob ( &bench, ack );
+		}
+	}
+	for ( slot = 0 ; slot < BENCH_HTTP_RX_FILL ; slot++ ) {
+		bench_free_iob ( &bench, bench_iobufs[slot] );
+		bench_iobufs[slot] = NULL;
+	}
+	bench_report ( &bench, 1 );
+}
+
+/**
+ * Benchmark TLS record buffers
+ *
+ * Each received record is allocated at its full length and then
+ * decrypted into a separately allocated buffer, while transmitted
+ * records of varying lengths are allocated and freed in between.
+ */
+static void bench_tls ( void ) {
+	struct malloc_bench bench;
+	struct io_buffer *rx;
+	struct io_buffer *plaintext;
+	struct io_buffer *tx;
+	unsigned int len;
+	unsigned int i;
+
+	bench_start ( &bench, "tls-record" );
+	for ( i = 0 ; i < BENCH_TLS_RECORDS ; i++ ) {
+		len = ( ( i & 1 ) ? BENCH_TLS_MAX_LEN :
+			( 1 + bench_random ( BENCH_TLS_MAX_LEN ) ) );
+		rx = bench_alloc_iob ( &bench, ( len + BENCH_TLS_OVERHEAD ) );
+		tx = bench_alloc_iob ( &bench, ( 1 + bench_random ( 512 ) +
+						 BENCH_TLS_OVERHEAD ) );
+		plaintext = bench_alloc_iob ( &bench, len );
+		bench_free_iob ( &bench, rx );
+		bench_free_iob ( &bench, tx );
+		bench_free_iob ( &bench, plaintext );
+	}
+	bench_report ( &bench, 1 );
+}
+
+/**
+ * Benchmark iSCSI PDUs
+ *
+ * Several commands are outstanding at once.  Each command allocates
+ * a command structure, a request PDU and a sequence of data-in PDUs,
+ * followed by a response PDU.
+ */
+static void bench_iscsi ( void ) {
+	struct malloc_bench bench;
+	struct io_buffer *pdu;
+	size_t data_len = ( BENCH_ISCSI_BHS_LEN + BENCH_ISCSI_DATA_LEN );
+	unsigned int pdus = 0;
+	unsigned int slot;
+	unsigned int count;
+
+	bench_start ( &bench, "iscsi-pdu" );
+	while ( pdus < BENCH_ISCSI_PDUS ) {
+		slot = bench_random ( BENCH_ISCSI_FILL );
+		if ( bench_ptrs[slot] ) {
+			/* Complete command with data-in and response */
+			for ( count = bench_random ( 8 ) ; count ; count-- ) {
+				pdu = bench_alloc_iob ( &bench, data_len );
+				bench_free_iob ( &bench, pdu );
+				pdus++;
+			}
+			pdu = bench_alloc_iob ( &bench, BENCH_ISCSI_BHS_LEN );
+			bench_free_iob ( &bench, pdu );
+			bench_free ( &bench, bench_ptrs[slot],
+				     BENCH_ISCSI_CMD_LEN );
+			bench_ptrs[slot] = NULL;
+		} else {
+			/* Issue command */
+			bench_ptrs[slot] = bench_malloc ( &bench,
+							  BENCH_ISCSI_CMD_LEN );
+			pdu = bench_alloc_iob ( &bench, BENCH_ISCSI_BHS_LEN );
+			bench_free_iob ( &bench, pdu );
+		}
+		pdus++;
+	}
+	for ( slot = 0 ; slot < BENCH_ISCSI_FILL ; slot++ ) {
+		if ( bench_ptrs[slot] ) {
+			bench_free ( &bench, bench_ptrs[slot],
+				     BENCH_ISCSI_CMD_LEN );
+			bench_ptrs[slot] = NULL;
+		}
+	}
+	bench_report ( &bench, 1 );
+}
+
+/**
+ * Benchmark script expansion strings
+ *
+ * A pool of short strings with random lifetimes is maintained, with
+ * some strings grown by reallocation as they are expanded.
+ */
+static void bench_strings ( void ) {
+	struct malloc_bench bench;
+	unsigned int slot;
+	unsigned int i;
+	size_t len;
+	void *ptr;
+
+	bench_start ( &bench, "script-string" );
+	for ( i = 0 ; i < BENCH_STRING_OPS ; i++ ) {
+		slot = bench_random ( BENCH_STRING_FILL );
+		len = bench_lens[slot];
+		if ( bench_ptrs[slot] && ( ( i % 4 ) == 0 ) &&
+		     ( len < BENCH_STRING_MAX_LEN ) ) {
+			/* Grow existing string */
+			ptr = bench_realloc ( &bench, bench_ptrs[slot], len,
+					      ( len * 2 ) );
+			if ( ptr ) {
+				bench_ptrs[slot] = ptr;
+				bench_lens[slot] = ( len * 2 );
+			}
+		} else {
+			/* Replace string */
+			if ( bench_ptrs[slot] )
+				bench_free ( &bench, bench_ptrs[slot], len );
+			len = ( 8 + bench_random ( 256 ) );
+			bench_ptrs[slot] = bench_malloc ( &bench, len );
+			bench_lens[slot] = ( bench_ptrs[slot] ? len : 0 );
+		}
+	}
+	for ( slot = 0 ; slot < BENCH_STRING_FILL ; slot++ ) {
+		if ( bench_ptrs[slot] ) {
+			bench_free ( &bench, bench_ptrs[slot],
+				     bench_lens[slot] );
+			bench_ptrs[slot] = NULL;
+			bench_lens[slot] = 0;
+		}
+	}
+	bench_report ( &bench, 1 );
+}
+
+/**
+ * Benchmark external memory allocator
+ *
+ * Download buffers are grown incrementally via urealloc() and then
+ * freed, using whichever umalloc() backend is present in this build.
+ */
+static void bench_umalloc ( void ) {
+	struct malloc_bench bench;
+	union profiler profiler;
+	unsigned long ticks;
+	userptr_t buffer;
+	userptr_t new_buffer;
+	size_t len;
+	unsigned int i;
+
+	bench_start ( &bench, "umalloc-download" );
+	for ( i = 0 ; i < BENCH_UMALLOC_RUNS ; i++ ) {
+		buffer = UNULL;
+		for ( len = BENCH_UMALLOC_STEP ; len <= BENCH_UMALLOC_LEN ;
+		      len += BENCH_UMALLOC_STEP ) {
+			profile ( &profiler );
+			new_buffer = urealloc ( buffer, len );
+			ticks = profile ( &profiler );
+			if ( ! new_buffer ) {
+				bench.failures++;
+				break;
+			}
+			buffer = new_buffer;
+			bench_record ( &bench, ticks, BENCH_UMALLOC_STEP );
+		}
+		len -= BENCH_UMALLOC_STEP;
+		profile ( &profiler );
+		ufree ( buffer );
+		ticks = profile ( &profiler );
+		bench_record ( &bench, ticks, -len );
+	}
+	bench_report ( &bench, 0 );
+}
+
+/**
+ * Perform memory allocator benchmarks
+ *
+ */
+static void malloc_bench_exec ( void ) {
+
+	/* Calibrate timestamp counter */
+	bench_calibrate();
+
+	/* Heap allocator */
+	bench_http();
+	bench_tls();
+	bench_iscsi();
+	bench_strings();
+
+	/* External memory allocator */
+	bench_umalloc();
+}
+
+/** Memory allocator benchmarks */
+struct self_test malloc_bench __self_test = {
+	.name = "malloc_bench",
+	.exec = malloc_bench_exec,
+};
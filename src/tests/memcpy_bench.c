@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/** @file
+ *
+ * Memory copy benchmarks
+ *
+ * Each measurement is the best of several runs, timed using the CPU
+ * timestamp counter.  The copied data is also verified.
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <ipxe/profile.h>
+#include <ipxe/test.h>
+
+/** Length of benchmark buffers */
+#define BENCH_LEN ( 1024 * 1024 )
+
+/** Number of runs for each benchmark */
+#define BENCH_RUNS 16
+
+/** Benchmark source buffer */
+static uint8_t bench_src[ BENCH_LEN + 64 ];
+
+/** Benchmark destination buffer */
+static uint8_t bench_dest[ BENCH_LEN + 64 ];
+
+/**
+ * Fill buffer with arbitrary data
+ *
+ * @v data		Data buffer
+ * @v len		Length of data buffer
+ * @v seed		Seed value
+ */
+static void bench_fill ( void *data, size_t len, uint32_t seed ) {
+	uint8_t *bytes = data;
+
+	while ( len-- ) {
+		seed = ( ( seed * 1103515245UL ) + 12345 );
+		*(bytes++) = ( seed >> 16 );
+	}
+}
+
+/**
+ * Report cycles per byte
+ *
+ * @v name		Operation name
+ * @v len		Length of data processed
+ * @v offset		Misalignment offset
+ * @v ticks		Best elapsed ticks
+ */
+static void bench_report ( const char *name, size_t len, size_t offset,
+			   unsigned long ticks ) {
+	unsigned long long scaled = ( ( ticks * 100ULL ) / len );
+
+	printf ( "BENCH %s len %zd offset %zd: %lld.%02lld cycles/byte\n",
+		 name, len, offset, ( scaled / 100 ), ( scaled % 100 ) );
+}
+
+/**
+ * Benchmark memcpy()
+ *
+ * @v len		Length to copy
+ * @v offset		Misalignment of source and destination
+ */
+static void bench_memcpy ( size_t len, size_t offset ) {
+	union profiler profiler;
+	unsigned long best = ~0UL;
+	unsigned long ticks;
+	unsigned int i;
+
+	for ( i = 0 ; i < BENCH_RUNS ; i++ ) {
+		memset ( bench_dest, 0, sizeof ( bench_dest ) );
+		profile ( &profiler );
+		memcpy ( ( bench_dest + offset ), ( bench_src + offset ), len );
+		ticks = profile ( &profiler );
+		if ( ticks < best )
+			best = ticks;
+		ok ( memcmp ( ( bench_dest + offset ), ( bench_src + offset ),
+			      len ) == 0 );
+		ok ( bench_dest[ offset + len ] == 0 );
+	}
+	bench_report ( "memcpy", len, offset, best );
+}
+
+/**
+ * Benchmark overlapping memmove()
+ *
+ * @v len		Length to move
+ * @v shift		Distance to move (negative to move downwards)
+ */
+static void bench_memmove ( size_t len, int shift ) {
+	uint8_t *src = ( bench_dest + 32 );
+	uint8_t *dest = ( src + shift );
+	union profiler profiler;
+	unsigned long best = ~0UL;
+	unsigned long ticks;
+	unsigned int i;
+
+	for ( i = 0 ; i < BENCH_RUNS ; i++ ) {
+		memcpy ( src, bench_src, len );
+		profile ( &profiler );
+		memmove ( dest, src, len );
+		ticks = profile ( &profiler );
+		if ( ticks < best )
+			best = ticks;
+		ok ( memcmp ( dest, bench_src, len ) == 0 );
+	}
+	bench_report ( ( ( shift < 0 ) ? "memmove-down" : "memmove-up" ),
+		       len, 0, best );
+}
+
+/**
+ * Perform memory copy benchmarks
+ *
+ */
+static void memcpy_bench_exec ( void ) {
+	static const size_t lens[] = { 64, 256, 4096, 65536, BENCH_LEN };
+	unsigned int i;
+
+	bench_fill ( bench_src, sizeof ( bench_src ), 0 );
+
+	for ( i = 0 ; i < ( sizeof ( lens ) / sizeof ( lens[0] ) ) ; i++ ) {
+		bench_memcpy ( lens[i], 0 );
+		bench_memcpy ( lens[i], 3 );
+	}
+	bench_memmove ( 4096, -5 );
+	bench_memmove ( 4096, 5 );
+	bench_memmove ( ( BENCH_LEN - 64 ), -16 );
+	bench_memmove ( ( BENCH_LEN - 64 ), 16 );
+}
+
+/** Memory copy benchmarks */
+struct self_test memcpy_bench __self_test = {
+	.name = "memcpy_bench",
+	.exec = memcpy_bench_exec,
+};
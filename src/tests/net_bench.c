@@ -0,0 +1,1760 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/** @file
+ *
+ * Network protocol benchmarks
+ *
+ * Files are downloaded via HTTP and TFTP over a simulated network
+ * device (so no real network hardware or tap device is required).
+ * Packets transmitted by the device pass through an emulated link
+ * to a minimal in-process server, and the server's responses pass
+ * back through the link to be received by the device.  Each
+ * direction of the link has a fixed bandwidth and propagation delay
+ * (half of the round-trip time), and may randomly lose or reorder
+ * packets.  The random number sequence is the same for every run.
+ *
+ * The server's TCP implementation uses slow start, congestion
+ * avoidance, fast retransmission and recovery (using any SACK
+ * information provided by the client) and exponential backoff of a
+ * retransmission timer.  Its TFTP implementation supports the
+ * "blksize", "tsize" and "windowsize" options.  The achieved goodput
+ * is reported for each download, along with the number of packets
+ * lost or reordered by the link, the number of packets retransmitted
+ * by the server, and the client's TCP statistics.
+ *
+ * The link is driven from the network device's poll method using the
+ * system timer, so on a heavily loaded machine the results will
+ * include some CPU-bound noise.
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <assert.h>
+#include <byteswap.h>
+#include <ipxe/iobuf.h>
+#include <ipxe/interface.h>
+#include <ipxe/xfer.h>
+#include <ipxe/open.h>
+#include <ipxe/process.h>
+#include <ipxe/timer.h>
+#include <ipxe/netdevice.h>
+#include <ipxe/ethernet.h>
+#include <ipxe/if_ether.h>
+#include <ipxe/if_arp.h>
+#include <ipxe/in.h>
+#include <ipxe/ip.h>
+#include <ipxe/tcpip.h>
+#include <ipxe/tcp.h>
+#include <ipxe/udp.h>
+#include <ipxe/tftp.h>
+#include <ipxe/settings.h>
+#include <ipxe/test.h>
+
+/** Simulated client IPv4 address */
+#define SIM_CLIENT_IP "10.99.0.1"
+
+/** Simulated server IPv4 address */
+#define SIM_SERVER_IP "10.99.0.2"
+
+/** Simulated network netmask */
+#define SIM_NETMASK "255.255.255.0"
+
+/** Simulated server HTTP port */
+#define SIM_HTTP_PORT 80
+
+/** Simulated server TFTP transfer port */
+#define SIM_TFTP_TID 1069
+
+/** Maximum number of packets held within each link direction */
+#define SIM_QUEUE_SIZE 1024
+
+/** Maximum time for which a packet may be held back for reordering
+ * (in microseconds)
+ */
+#define SIM_REORDER_US 1000
+
+/** Simulated server TCP maximum segment size */
+#define SIM_TCP_MSS 1460
+
+/** Simulated server TCP initial congestion window (in segments) */
+#define SIM_TCP_INITIAL_CWND 10
+
+/** Simulated server TCP duplicate ACK threshold */
+#define SIM_TCP_DUPACK_THRESHOLD 3
+
+/** Simulated server receive window */
+#define SIM_TCP_WINDOW 65535
+
+/** Minimum simulated server retransmission timeout (in microseconds) */
+#define SIM_MIN_RTO_US 200000
+
+/** Maximum simulated server TFTP block size */
+#define SIM_TFTP_MAX_BLKSIZE					\
+	( ETH_MAX_MTU - sizeof ( struct iphdr ) -		\
+	  sizeof ( struct udp_header ) - sizeof ( struct tftp_data ) )
+
+/** Length of HTTP downloads */
+#define NET_BENCH_HTTP_LEN ( 4 * 1024 * 1024 )
+
+/** Length of TFTP downloads */
+#define NET_BENCH_TFTP_LEN ( 1024 * 1024 )
+
+/** Maximum duration of each download (in seconds) */
+#define NET_BENCH_TIMEOUT_SEC 60
+
+/** A simulated link */
+struct sim_link {
+	/** Name */
+	const char *name;
+	/** Bandwidth (in Mbps) */
+	unsigned int mbps;
+	/** Round-trip time (in milliseconds) */
+	unsigned int rtt;
+	/** Packet loss probability (per mille) */
+	unsigned int loss;
+	/** Packet reordering probability (per mille) */
+	unsigned int reorder;
+};
+
+/** One direction of a simulated link */
+struct sim_queue {
+	/** Queued packets */
+	struct io_buffer *iobuf[SIM_QUEUE_SIZE];
+	/** Delivery times (in microseconds) */
+	uint64_t due[SIM_QUEUE_SIZE];
+	/** Producer counter */
+	unsigned int prod;
+	/** Consumer counter */
+	unsigned int cons;
+	/** Time at which the link next becomes idle (in microseconds) */
+	uint64_t idle;
+	/** Packet held back for reordering, if any */
+	struct io_buffer *held;
+	/** Time by which any held packet must be released */
+	uint64_t held_until;
+	/** Number of packets lost */
+	unsigned int lost;
+	/** Number of packets reordered */
+	unsigned int reordered;
+	/** Number of packets dropped due to a full queue */
+	unsigned int dropped;
+};
+
+/** Simulated server HTTP connection */
+struct sim_tcp {
+	/** Connection is open */
+	int open;
+	/** Client port */
+	unsigned int port;
+	/** Maximum segment size */
+	size_t mss;
+	/** Client sent a window scale option */
+	int ws;
+	/** Client window scale */
+	unsigned int scale;
+	/** Client permits SACK */
+	int sack;
+	/** Initial sequence number */
+	uint32_t iss;
+	/** Oldest unacknowledged sequence number */
+	uint32_t snd_una;
+	/** Next sequence number to send */
+	uint32_t snd_nxt;
+	/** Highest sequence number sent */
+	uint32_t snd_max;
+	/** Client receive window */
+	uint32_t snd_wnd;
+	/** Next expected client sequence number */
+	uint32_t rcv_nxt;
+	/** Congestion window */
+	uint32_t cwnd;
+	/** Slow start threshold */
+	uint32_t ssthresh;
+	/** Number of consecutive duplicate ACKs */
+	unsigned int dupacks;
+	/** Fast recovery is in progress */
+	int recovery;
+	/** Highest sequence number sent when recovery started */
+	uint32_t recover;
+	/** Next sequence number to consider for SACK retransmission */
+	uint32_t rexmit;
+	/** Most recently received SACK blocks */
+	struct tcp_sack_block sacked[TCP_SACK_MAX];
+	/** Number of most recently received SACK blocks */
+	unsigned int sacks;
+	/** Retransmission timeout (in microseconds) */
+	uint64_t rto;
+	/** Retransmission timer expiry time, or zero if stopped */
+	uint64_t expiry;
+	/** Request */
+	char request[256];
+	/** Length of request */
+	size_t request_len;
+	/** Response header */
+	char header[128];
+	/** Length of response header */
+	size_t header_len;
+	/** Length of response, or zero if no request has been received */
+	size_t len;
+	/** Number of retransmitted segments */
+	unsigned int retransmits;
+	/** Number of retransmission timeouts */
+	unsigned int timeouts;
+};
+
+/** Simulated server TFTP transfer */
+struct sim_tftp {
+	/** Transfer is open */
+	int open;
+	/** Client port */
+	unsigned int port;
+	/** Length of file */
+	size_t len;
+	/** Block size */
+	size_t blksize;
+	/** Window size */
+	unsigned int windowsize;
+	/** Client requested "blksize" option */
+	int want_blksize;
+	/** Client requested "tsize" option */
+	int want_tsize;
+	/** Client requested "windowsize" option */
+	int want_windowsize;
+	/** Options have been acknowledged (or were not requested) */
+	int started;
+	/** Total number of data blocks */
+	unsigned int blocks;
+	/** Number of data blocks acknowledged */
+	unsigned int acked;
+	/** Highest data block sent */
+	unsigned int sent;
+	/** Retransmission timeout (in microseconds) */
+	uint64_t rto;
+	/** Retransmission timer expiry time, or zero if stopped */
+	uint64_t expiry;
+	/** Number of retransmitted blocks */
+	unsigned int retransmits;
+	/** Number of retransmission timeouts */
+	unsigned int timeouts;
+};
+
+/** A benchmark download */
+struct net_bench_download {
+	/** Data transfer interface */
+	struct interface xfer;
+	/** Current position within file */
+	size_t pos;
+	/** Length of file (as far as is known) */
+	size_t len;
+	/** Download has finished */
+	int done;
+	/** Final status code */
+	int rc;
+};
+
+/** Simulated client MAC address */
+static const uint8_t sim_client_mac[ETH_ALEN] =
+	{ 0x02, 0x00, 0x00, 0x00, 0x99, 0x01 };
+
+/** Simulated server MAC address */
+static const uint8_t sim_server_mac[ETH_ALEN] =
+	{ 0x02, 0x00, 0x00, 0x00, 0x99, 0x02 };
+
+/** Simulated client IPv4 address */
+static struct in_addr sim_client;
+
+/** Simulated server IPv4 address */
+static struct in_addr sim_server;
+
+/** Current simulated link */
+static struct sim_link *sim_link;
+
+/** Client-to-server direction of simulated link */
+static struct sim_queue sim_uplink;
+
+/** Server-to-client direction of simulated link */
+static struct sim_queue sim_downlink;
+
+/** Simulated server HTTP connection */
+static struct sim_tcp sim_tcp;
+
+/** Simulated server TFTP transfer */
+static struct sim_tftp sim_tftp;
+
+/** Random number generator state */
+static uint32_t sim_seed;
+
+/** Simulated server IPv4 identification counter */
+static uint16_t sim_ident;
+
+/**
+ * Get current time
+ *
+ * @ret now		Current time (in microseconds)
+ */
+static uint64_t sim_now ( void ) {
+	return ( ( ( uint64_t ) currticks() * 1000000 ) / TICKS_PER_SEC );
+}
+
+/**
+ * Generate random event
+ *
+ * @v probability	Probability (per mille)
+ * @ret happened	Event happened
+ */
+static int sim_random ( unsigned int probability ) {
+
+	sim_seed = ( ( sim_seed * 1103515245UL ) + 12345 );
+	return ( ( ( sim_seed >> 16 ) % 1000 ) < probability );
+}
+
+/**
+ * Add packet to link queue
+ *
+ * @v queue		Link queue
+ * @v iobuf		I/O buffer
+ * @v now		Current time
+ */
+static void sim_queue_push ( struct sim_queue *queue,
+			     struct io_buffer *iobuf, uint64_t now ) {
+	unsigned int index;
+	uint64_t start;
+
+	/* Drop packet if queue is full */
+	if ( ( queue->prod - queue->cons ) >= SIM_QUEUE_SIZE ) {
+		queue->dropped++;
+		free_iob ( iobuf );
+		return;
+	}
+
+	/* Packet is delivered after the link has finished sending
+	 * all previous packets, plus the time taken to send this
+	 * packet, plus the one-way propagation delay.
+	 */
+	start = ( ( queue->idle > now ) ? queue->idle : now );
+	queue->idle = ( start +
+			( ( iob_len ( iobuf ) * 8 ) / sim_link->mbps ) );
+	index = ( queue->prod++ % SIM_QUEUE_SIZE );
+	queue->iobuf[index] = iobuf;
+	queue->due[index] = ( queue->idle + ( sim_link->rtt * 500 ) );
+}
+
+/**
+ * Release any packet held back for reordering
+ *
+ * @v queue		Link queue
+ * @v now		Current time
+ */
+static void sim_queue_release ( struct sim_queue *queue, uint64_t now ) {
+
+	if ( queue->held ) {
+		sim_queue_push ( queue, queue->held, now );
+		queue->held = NULL;
+	}
+}
+
+/**
+ * Transmit packet via link
+ *
+ * @v queue		Link queue
+ * @v iobuf		I/O buffer
+ * @v now		Current time
+ */
+static void sim_queue_tx ( struct sim_queue *queue, struct io_buffer *iobuf,
+			   uint64_t now ) {
+
+	/* Discard lost packets */
+	if ( sim_random ( sim_link->loss ) ) {
+		queue->lost++;
+		free_iob ( iobuf );
+		return;
+	}
+
+	/* Hold back packets to be reordered, until after the next
+	 * packet has been sent.
+	 */
+	if ( sim_random ( sim_link->reorder ) && ( ! queue->held ) ) {
+		queue->held = iobuf;
+		queue->held_until = ( now + SIM_REORDER_US );
+		queue->reordered++;
+		return;
+	}
+
+	/* Queue packet, followed by any held packet */
+	sim_queue_push ( queue, iobuf, now );
+	sim_queue_release ( queue, now );
+}
+
+/**
+ * Receive packet from link
+ *
+ * @v queue		Link queue
+ * @v now		Current time
+ * @ret iobuf		I/O buffer, or NULL if no packet is due
+ */
+static struct io_buffer * sim_queue_rx ( struct sim_queue *queue,
+					 uint64_t now ) {
+	unsigned int index;
+
+	/* Release held packet if it has waited for too long */
+	if ( queue->held && ( now >= queue->held_until ) )
+		sim_queue_release ( queue, now );
+
+	/* Dequeue packet, if due */
+	if ( queue->cons == queue->prod )
+		return NULL;
+	index = ( queue->cons % SIM_QUEUE_SIZE );
+	if ( now < queue->due[index] )
+		return NULL;
+	queue->cons++;
+	return queue->iobuf[index];
+}
+
+/**
+ * Reset link queue
+ *
+ * @v queue		Link queue
+ */
+static void sim_queue_reset ( struct sim_queue *queue ) {
+	unsigned int index;
+
+	/* Discard all packets */
+	while ( queue->cons != queue->prod ) {
+		index = ( queue->cons++ % SIM_QUEUE_SIZE );
+		free_iob ( queue->iobuf[index] );
+	}
+	free_iob ( queue->held );
+
+	/* Reset queue */
+	memset ( queue, 0, sizeof ( *queue ) );
+}
+
+/**
+ * Allocate I/O buffer for simulated server
+ *
+ * @v len		Length of transport-layer packet
+ * @ret iobuf		I/O buffer, or NULL
+ */
+static struct io_buffer * sim_alloc_iob ( size_t len ) {
+	struct io_buffer *iobuf;
+
+	iobuf = alloc_iob ( MAX_LL_NET_HEADER_LEN + len );
+	if ( iobuf )
+		iob_reserve ( iobuf, MAX_LL_NET_HEADER_LEN );
+	return iobuf;
+}
+
+/**
+ * Transmit packet from simulated server
+ *
+ * @v iobuf		I/O buffer
+ * @v net_proto		Network-layer protocol (in network byte order)
+ * @v now		Current time
+ */
+static void sim_server_tx ( struct io_buffer *iobuf, uint16_t net_proto,
+			    uint64_t now ) {
+	struct ethhdr *ethhdr;
+
+	ethhdr = iob_push ( iobuf, sizeof ( *ethhdr ) );
+	memcpy ( ethhdr->h_dest, sim_client_mac, ETH_ALEN );
+	memcpy ( ethhdr->h_source, sim_server_mac, ETH_ALEN );
+	ethhdr->h_protocol = net_proto;
+	sim_queue_tx ( &sim_downlink, iobuf, now );
+}
+
+/**
+ * Transmit IPv4 packet from simulated server
+ *
+ * @v iobuf		I/O buffer
+ * @v protocol		Transport-layer protocol
+ * @v csum		Transport-layer checksum field
+ * @v now		Current time
+ */
+static void sim_ipv4_tx ( struct io_buffer *iobuf, unsigned int protocol,
+			  uint16_t *csum, uint64_t now ) {
+	struct ipv4_pseudo_header pshdr;
+	struct iphdr *iphdr;
+
+	/* Calculate transport-layer checksum */
+	pshdr.src = sim_server;
+	pshdr.dest = sim_client;
+	pshdr.zero_padding = 0;
+	pshdr.protocol = protocol;
+	pshdr.len = htons ( iob_len ( iobuf ) );
+	*csum = tcpip_continue_chksum ( tcpip_chksum ( &pshdr,
+						       sizeof ( pshdr ) ),
+					iobuf->data, iob_len ( iobuf ) );
+
+	/* Construct IPv4 header */
+	iphdr = iob_push ( iobuf, sizeof ( *iphdr ) );
+	memset ( iphdr, 0, sizeof ( *iphdr ) );
+	iphdr->verhdrlen = ( IP_VER | ( sizeof ( *iphdr ) / 4 ) );
+	iphdr->len = htons ( iob_len ( iobuf ) );
+	iphdr->ident = htons ( sim_ident++ );
+	iphdr->frags = htons ( IP_MASK_DONOTFRAG );
+	iphdr->ttl = IP_TTL;
+	iphdr->protocol = protocol;
+	iphdr->src = sim_server;
+	iphdr->dest = sim_client;
+	iphdr->chksum = tcpip_chksum ( iphdr, sizeof ( *iphdr ) );
+
+	sim_server_tx ( iobuf, htons ( ETH_P_IP ), now );
+}
+
+/**
+ * Fill in simulated HTTP response data
+ *
+ * @v data		Data buffer
+ * @v offset		Offset within response
+ * @v len		Length of data
+ */
+static void sim_http_fill ( void *data, size_t offset, size_t len ) {
+	struct sim_tcp *tcp = &sim_tcp;
+	size_t frag_len;
+
+	/* Copy any portion of response header */
+	if ( offset < tcp->header_len ) {
+		frag_len = ( tcp->header_len - offset );
+		if ( frag_len > len )
+			frag_len = len;
+		memcpy ( data, ( tcp->header + offset ), frag_len );
+		data += frag_len;
+		len -= frag_len;
+	}
+
+	/* Fill in remainder of response body */
+	memset ( data, 'x', len );
+}
+
+/**
+ * Process simulated HTTP request data
+ *
+ * @v data		Data
+ * @v len		Length of data
+ */
+static void sim_http_rx ( const void *data, size_t len ) {
+	struct sim_tcp *tcp = &sim_tcp;
+	size_t body_len;
+
+	/* Accumulate request, truncating if necessary */
+	if ( len > ( sizeof ( tcp->request ) - 1 - tcp->request_len ) )
+		len = ( sizeof ( tcp->request ) - 1 - tcp->request_len );
+	memcpy ( ( tcp->request + tcp->request_len ), data, len );
+	tcp->request_len += len;
+	tcp->request[tcp->request_len] = '\0';
+
+	/* Wait for complete request */
+	if ( tcp->len || ( ! strstr ( tcp->request, "\r\n\r\n" ) ) )
+		return;
+
+	/* Construct response with a body of the requested length */
+	if ( strncmp ( tcp->request, "GET /", 5 ) == 0 ) {
+		body_len = strtoul ( ( tcp->request + 5 ), NULL, 10 );
+	} else {
+		body_len = 0;
+	}
+	tcp->header_len = snprintf ( tcp->header, sizeof ( tcp->header ),
+				     "HTTP/1.1 200 OK\r\n"
+				     "Content-Length: %zd\r\n"
+				     "Connection: close\r\n\r\n", body_len );
+	tcp->len = ( tcp->header_len + body_len );
+}
+
+/**
+ * Transmit simulated server TCP segment
+ *
+ * @v seq		Sequence number
+ * @v len		Length of data
+ * @v flags		TCP flags
+ * @v now		Current time
+ */
+static void sim_tcp_tx ( uint32_t seq, size_t len, unsigned int flags,
+			 uint64_t now ) {
+	struct sim_tcp *tcp = &sim_tcp;
+	struct tcp_sack_permitted_padded_option *spopt;
+	struct tcp_window_scale_padded_option *wsopt;
+	struct tcp_mss_option *mssopt;
+	struct tcp_header *tcphdr;
+	struct io_buffer *iobuf;
+	size_t hlen;
+
+	/* Allocate I/O buffer */
+	iobuf = sim_alloc_iob ( sizeof ( *tcphdr ) + sizeof ( *mssopt ) +
+				sizeof ( *wsopt ) + sizeof ( *spopt ) + len );
+	if ( ! iobuf )
+		return;
+
+	/* Fill in data */
+	sim_http_fill ( iob_put ( iobuf, len ), ( seq - tcp->iss - 1 ), len );
+
+	/* Construct SYN options */
+	if ( flags & TCP_SYN ) {
+		if ( tcp->sack ) {
+			spopt = iob_push ( iobuf, sizeof ( *spopt ) );
+			memset ( spopt->nop, TCP_OPTION_NOP,
+				 sizeof ( spopt->nop ) );
+			spopt->spopt.kind = TCP_OPTION_SACK_PERMITTED;
+			spopt->spopt.length = sizeof ( spopt->spopt );
+		}
+		if ( tcp->ws ) {
+			wsopt = iob_push ( iobuf, sizeof ( *wsopt ) );
+			memset ( wsopt->nop, TCP_OPTION_NOP,
+				 sizeof ( wsopt->nop ) );
+			wsopt->wsopt.kind = TCP_OPTION_WS;
+			wsopt->wsopt.length = sizeof ( wsopt->wsopt );
+			wsopt->wsopt.scale = 0;
+		}
+		mssopt = iob_push ( iobuf, sizeof ( *mssopt ) );
+		mssopt->kind = TCP_OPTION_MSS;
+		mssopt->length = sizeof ( *mssopt );
+		mssopt->mss = htons ( SIM_TCP_MSS );
+	}
+
+	/* Construct TCP header */
+	tcphdr = iob_push ( iobuf, sizeof ( *tcphdr ) );
+	hlen = ( iob_len ( iobuf ) - len );
+	tcphdr->src = htons ( SIM_HTTP_PORT );
+	tcphdr->dest = htons ( tcp->port );
+	tcphdr->seq = htonl ( seq );
+	tcphdr->ack = htonl ( tcp->rcv_nxt );
+	tcphdr->hlen = ( ( hlen / 4 ) << 4 );
+	tcphdr->flags = flags;
+	tcphdr->win = htons ( SIM_TCP_WINDOW );
+	tcphdr->csum = 0;
+	tcphdr->urg = 0;
+
+	sim_ipv4_tx ( iobuf, IP_TCP, &tcphdr->csum, now );
+}
+
+/**
+ * Transmit simulated server TCP data segment
+ *
+ * @v seq		Starting sequence number
+ * @v now		Current time
+ * @ret len		Sequence space consumed by segment
+ *
+ * The segment carries as much data as possible starting from the
+ * specified sequence number, along with a FIN if it reaches the end
+ * of the response.
+ */
+static size_t sim_tcp_xmit ( uint32_t seq, uint64_t now ) {
+	struct sim_tcp *tcp = &sim_tcp;
+	size_t offset = ( ( uint32_t ) ( seq - tcp->iss - 1 ) );
+	unsigned int flags = TCP_ACK;
+	size_t len;
+
+	/* Do nothing if sequence number lies beyond the FIN */
+	if ( offset > tcp->len )
+		return 0;
+
+	/* Send segment */
+	len = ( tcp->len - offset );
+	if ( len > tcp->mss )
+		len = tcp->mss;
+	if ( ( offset + len ) == tcp->len )
+		flags |= ( TCP_PSH | TCP_FIN );
+	sim_tcp_tx ( seq, len, flags, now );
+
+	/* Start retransmission timer, if not already running */
+	if ( ! tcp->expiry )
+		tcp->expiry = ( now + tcp->rto );
+
+	return ( len + ( ( flags & TCP_FIN ) ? 1 : 0 ) );
+}
+
+/**
+ * Retransmit simulated server TCP data segment
+ *
+ * @v seq		Starting sequence number
+ * @v now		Current time
+ * @ret len		Sequence space consumed by segment
+ */
+static size_t sim_tcp_retransmit ( uint32_t seq, uint64_t now ) {
+	struct sim_tcp *tcp = &sim_tcp;
+
+	tcp->retransmits++;
+	return sim_tcp_xmit ( seq, now );
+}
+
+/**
+ * Calculate amount of data reported as received by SACK
+ *
+ * @ret len		Length of SACKed data
+ */
+static uint32_t sim_tcp_sacked ( void ) {
+	struct sim_tcp *tcp = &sim_tcp;
+	struct tcp_sack_block *sack;
+	uint32_t len = 0;
+	unsigned int i;
+
+	for ( i = 0 ; i < tcp->sacks ; i++ ) {
+		sack = &tcp->sacked[i];
+		if ( tcp_cmp ( sack->left, tcp->snd_una ) >= 0 )
+			len += ( sack->right - sack->left );
+	}
+	return len;
+}
+
+/**
+ * Retransmit next unacknowledged hole during SACK recovery
+ *
+ * @v now		Current time
+ */
+static void sim_tcp_sack_retransmit ( uint64_t now ) {
+	struct sim_tcp *tcp = &sim_tcp;
+	struct tcp_sack_block *sack;
+	uint32_t highest = tcp->snd_una;
+	uint32_t seq = tcp->rexmit;
+	unsigned int i;
+
+	/* Find highest SACKed sequence number */
+	for ( i = 0 ; i < tcp->sacks ; i++ ) {
+		sack = &tcp->sacked[i];
+		if ( tcp_cmp ( sack->right, highest ) > 0 )
+			highest = sack->right;
+	}
+
+	/* Skip over any SACKed data */
+	if ( tcp_cmp ( seq, tcp->snd_una ) < 0 )
+		seq = tcp->snd_una;
+	for ( i = 0 ; i < tcp->sacks ; i++ ) {
+		sack = &tcp->sacked[i];
+		if ( tcp_in_window ( seq, sack->left,
+				     ( sack->right - sack->left ) ) ) {
+			seq = sack->right;
+			i = -1U;
+		}
+	}
+
+	/* Retransmit hole, if any hole lies below the highest SACKed
+	 * sequence number.
+	 */
+	if ( tcp_cmp ( seq, highest ) < 0 )
+		tcp->rexmit = ( seq + sim_tcp_retransmit ( seq, now ) );
+}
+
+/**
+ * Transmit as much new data as the windows permit
+ *
+ * @v now		Current time
+ */
+static void sim_tcp_push ( uint64_t now ) {
+	struct sim_tcp *tcp = &sim_tcp;
+	uint32_t end = ( tcp->iss + 1 + tcp->len + 1 );
+	uint32_t window;
+	uint32_t flight;
+	uint32_t len;
+
+	/* Do nothing until a request has been received */
+	if ( ! ( tcp->open && tcp->len ) )
+		return;
+
+	/* Send segments */
+	window = ( ( tcp->cwnd < tcp->snd_wnd ) ? tcp->cwnd : tcp->snd_wnd );
+	while ( tcp_cmp ( tcp->snd_nxt, end ) < 0 ) {
+		flight = ( tcp->snd_nxt - tcp->snd_una );
+		len = ( end - tcp->snd_nxt );
+		if ( len > tcp->mss )
+			len = tcp->mss;
+		if ( ( flight + len ) > window )
+			break;
+		tcp->snd_nxt += sim_tcp_xmit ( tcp->snd_nxt, now );
+		if ( tcp_cmp ( tcp->snd_nxt, tcp->snd_max ) > 0 )
+			tcp->snd_max = tcp->snd_nxt;
+	}
+
+	/* Ensure that the retransmission timer will probe a closed
+	 * window.
+	 */
+	if ( ( tcp->snd_nxt != end ) && ( ! tcp->expiry ) )
+		tcp->expiry = ( now + tcp->rto );
+}
+
+/**
+ * Parse simulated server TCP options
+ *
+ * @v tcphdr		TCP header
+ * @v hlen		Length of TCP header
+ */
+static void sim_tcp_options ( struct tcp_header *tcphdr, size_t hlen ) {
+	struct sim_tcp *tcp = &sim_tcp;
+	const uint8_t *option = ( ( const void * ) ( tcphdr + 1 ) );
+	const uint8_t *end = ( ( ( const void * ) tcphdr ) + hlen );
+	const struct tcp_mss_option *mssopt;
+	const struct tcp_window_scale_option *wsopt;
+	const struct tcp_sack_block *sack;
+	unsigned int count;
+	unsigned int i;
+
+	tcp->sacks = 0;
+	while ( option < end ) {
+		if ( *option == TCP_OPTION_END )
+			break;
+		if ( *option == TCP_OPTION_NOP ) {
+			option++;
+			continue;
+		}
+		if ( ( ( option + 2 ) > end ) || ( option[1] < 2 ) ||
+		     ( ( option + option[1] ) > end ) )
+			break;
+		switch ( *option ) {
+		case TCP_OPTION_MSS:
+			mssopt = ( ( const void * ) option );
+			if ( ntohs ( mssopt->mss ) < tcp->mss )
+				tcp->mss = ntohs ( mssopt->mss );
+			break;
+		case TCP_OPTION_WS:
+			wsopt = ( ( const void * ) option );
+			tcp->ws = 1;
+			tcp->scale = wsopt->scale;
+			if ( tcp->scale > TCP_MAX_WINDOW_SCALE )
+				tcp->scale = TCP_MAX_WINDOW_SCALE;
+			break;
+		case TCP_OPTION_SACK_PERMITTED:
+			tcp->sack = 1;
+			break;
+		case TCP_OPTION_SACK:
+			sack = ( ( const void * ) ( option + 2 ) );
+			count = ( ( option[1] - 2 ) / sizeof ( *sack ) );
+			if ( count > TCP_SACK_MAX )
+				count = TCP_SACK_MAX;
+			for ( i = 0 ; i < count ; i++ ) {
+				tcp->sacked[i].left = ntohl ( sack[i].left );
+				tcp->sacked[i].right = ntohl ( sack[i].right );
+			}
+			tcp->sacks = count;
+			break;
+		default:
+			break;
+		}
+		option += option[1];
+	}
+}
+
+/**
+ * Process simulated server TCP connection request
+ *
+ * @v tcphdr		TCP header
+ * @v hlen		Length of TCP header
+ * @v now		Current time
+ */
+static void sim_tcp_rx_syn ( struct tcp_header *tcphdr, size_t hlen,
+			     uint64_t now ) {
+	struct sim_tcp *tcp = &sim_tcp;
+	uint32_t seq = ntohl ( tcphdr->seq );
+
+	/* Reinitialise connection, unless this is a retransmitted SYN */
+	if ( ! ( tcp->open && ( tcp->port == ntohs ( tcphdr->src ) ) &&
+		 ( tcp->rcv_nxt == ( seq + 1 ) ) ) ) {
+		memset ( tcp, 0, sizeof ( *tcp ) );
+		tcp->open = 1;
+		tcp->port = ntohs ( tcphdr->src );
+		tcp->mss = SIM_TCP_MSS;
+		sim_tcp_options ( tcphdr, hlen );
+		tcp->iss = ( sim_seed ^ 0x5eed0000UL );
+		tcp->snd_una = tcp->iss;
+		tcp->snd_nxt = ( tcp->iss + 1 );
+		tcp->snd_max = tcp->snd_nxt;
+		tcp->snd_wnd = ntohs ( tcphdr->win );
+		tcp->rcv_nxt = ( seq + 1 );
+		tcp->cwnd = ( SIM_TCP_INITIAL_CWND * tcp->mss );
+		tcp->ssthresh = ~( ( uint32_t ) 0 );
+		tcp->rto = ( SIM_MIN_RTO_US + ( sim_link->rtt * 1000 ) );
+	}
+
+	/* Send SYN-ACK */
+	sim_tcp_tx ( tcp->iss, 0, ( TCP_SYN | TCP_ACK ), now );
+	tcp->expiry = ( now + tcp->rto );
+}
+
+/**
+ * Process simulated server TCP acknowledgement
+ *
+ * @v ack		Acknowledgement number
+ * @v win		Client receive window
+ * @v data		Segment contains data or a FIN
+ * @v now		Current time
+ */
+static void sim_tcp_rx_ack ( uint32_t ack, uint32_t win, int data,
+			     uint64_t now ) {
+	struct sim_tcp *tcp = &sim_tcp;
+	uint32_t acked;
+	uint32_t flight;
+	size_t len;
+
+	/* Ignore acknowledgements for data not yet sent */
+	if ( tcp_cmp ( ack, tcp->snd_max ) > 0 )
+		return;
+	tcp->snd_wnd = win;
+
+	if ( tcp_cmp ( ack, tcp->snd_una ) > 0 ) {
+
+		/* New data acknowledged */
+		acked = ( ack - tcp->snd_una );
+		tcp->snd_una = ack;
+		if ( tcp_cmp ( tcp->snd_nxt, ack ) < 0 )
+			tcp->snd_nxt = ack;
+		tcp->dupacks = 0;
+		if ( tcp->recovery ) {
+			if ( tcp_cmp ( ack, tcp->recover ) >= 0 ) {
+				/* Full acknowledgement: end recovery */
+				tcp->recovery = 0;
+				tcp->cwnd = tcp->ssthresh;
+			} else {
+				/* Partial acknowledgement: retransmit
+				 * next missing segment and deflate
+				 * congestion window.
+				 */
+				if ( tcp_cmp ( tcp->rexmit, ack ) <= 0 ) {
+					len = sim_tcp_retransmit ( ack, now );
+					tcp->rexmit = ( ack + len );
+				}
+				tcp->cwnd -= ( ( acked < tcp->cwnd ) ?
+					       acked : 0 );
+				tcp->cwnd += tcp->mss;
+			}
+		} else if ( tcp->cwnd < tcp->ssthresh ) {
+			/* Slow start */
+			tcp->cwnd += ( ( acked < tcp->mss ) ?
+				       acked : tcp->mss );
+		} else {
+			/* Congestion avoidance */
+			tcp->cwnd += ( ( ( tcp->mss * tcp->mss ) / tcp->cwnd )
+				       + 1 );
+		}
+
+		/* Restart retransmission timer */
+		tcp->rto = ( SIM_MIN_RTO_US + ( sim_link->rtt * 1000 ) );
+		tcp->expiry = ( ( ack == tcp->snd_max ) ?
+				0 : ( now + tcp->rto ) );
+
+	} else if ( ( ack == tcp->snd_una ) && ( ! data ) &&
+		    ( tcp->snd_una != tcp->snd_max ) ) {
+
+		/* Duplicate acknowledgement.  Since the client may
+		 * coalesce acknowledgements, recovery also starts
+		 * once SACK shows that enough later data has arrived
+		 * (as per RFC 6675).
+		 */
+		tcp->dupacks++;
+		if ( tcp->recovery ) {
+			tcp->cwnd += tcp->mss;
+			sim_tcp_sack_retransmit ( now );
+		} else if ( ( tcp->dupacks >= SIM_TCP_DUPACK_THRESHOLD ) ||
+			    ( sim_tcp_sacked() >=
+			      ( ( SIM_TCP_DUPACK_THRESHOLD - 1 ) *
+				tcp->mss ) ) ) {
+			flight = ( tcp->snd_max - tcp->snd_una );
+			tcp->ssthresh = ( flight / 2 );
+			if ( tcp->ssthresh < ( 2 * tcp->mss ) )
+				tcp->ssthresh = ( 2 * tcp->mss );
+			tcp->cwnd = ( tcp->ssthresh +
+				      ( SIM_TCP_DUPACK_THRESHOLD * tcp->mss ) );
+			tcp->recovery = 1;
+			tcp->recover = tcp->snd_max;
+			tcp->rexmit = ( ack + sim_tcp_retransmit ( ack, now ) );
+		}
+	}
+}
+
+/**
+ * Process simulated server TCP segment
+ *
+ * @v iobuf		I/O buffer
+ * @v now		Current time
+ */
+static void sim_tcp_rx ( struct io_buffer *iobuf, uint64_t now ) {
+	struct sim_tcp *tcp = &sim_tcp;
+	struct tcp_header *tcphdr = iobuf->data;
+	unsigned int flags;
+	size_t hlen;
+	size_t len;
+	uint32_t seq;
+
+	/* Sanity check */
+	if ( iob_len ( iobuf ) < sizeof ( *tcphdr ) )
+		return;
+	hlen = ( ( tcphdr->hlen & TCP_MASK_HLEN ) / 16 ) * 4;
+	if ( ( hlen < sizeof ( *tcphdr ) ) || ( hlen > iob_len ( iobuf ) ) )
+		return;
+	if ( tcphdr->dest != htons ( SIM_HTTP_PORT ) )
+		return;
+	flags = tcphdr->flags;
+	seq = ntohl ( tcphdr->seq );
+	len = ( iob_len ( iobuf ) - hlen );
+
+	/* Handle connection requests */
+	if ( flags & TCP_SYN ) {
+		sim_tcp_rx_syn ( tcphdr, hlen, now );
+		return;
+	}
+
+	/* Ignore segments for any other connection */
+	if ( ! ( tcp->open && ( tcphdr->src == htons ( tcp->port ) ) ) )
+		return;
+
+	/* Handle resets */
+	if ( flags & TCP_RST ) {
+		tcp->open = 0;
+		return;
+	}
+
+	/* Process acknowledgement */
+	sim_tcp_options ( tcphdr, hlen );
+	if ( flags & TCP_ACK ) {
+		sim_tcp_rx_ack ( ntohl ( tcphdr->ack ),
+				 ( ntohs ( tcphdr->win ) << tcp->scale ),
+				 ( len || ( flags & TCP_FIN ) ), now );
+	}
+
+	/* Process in-order data, and acknowledge any data */
+	if ( len || ( flags & TCP_FIN ) ) {
+		if ( seq == tcp->rcv_nxt ) {
+			sim_http_rx ( ( iobuf->data + hlen ), len );
+			tcp->rcv_nxt += len;
+			if ( flags & TCP_FIN )
+				tcp->rcv_nxt++;
+		}
+		sim_tcp_tx ( tcp->snd_nxt, 0, TCP_ACK, now );
+	}
+
+	/* Send any new data */
+	sim_tcp_push ( now );
+}
+
+/**
+ * Run simulated server TCP retransmission timer
+ *
+ * @v now		Current time
+ */
+static void sim_tcp_poll ( uint64_t now ) {
+	struct sim_tcp *tcp = &sim_tcp;
+	uint32_t flight;
+
+	/* Do nothing unless timer has expired */
+	if ( ! ( tcp->open && tcp->expiry && ( now >= tcp->expiry ) ) )
+		return;
+	tcp->timeouts++;
+	tcp->rto *= 2;
+	tcp->expiry = ( now + tcp->rto );
+
+	/* Retransmit SYN-ACK, if applicable */
+	if ( tcp->snd_una == tcp->iss ) {
+		sim_tcp_tx ( tcp->iss, 0, ( TCP_SYN | TCP_ACK ), now );
+		return;
+	}
+
+	/* Collapse congestion window and go back to the first
+	 * unacknowledged segment.
+	 */
+	flight = ( tcp->snd_max - tcp->snd_una );
+	tcp->ssthresh = ( flight / 2 );
+	if ( tcp->ssthresh < ( 2 * tcp->mss ) )
+		tcp->ssthresh = ( 2 * tcp->mss );
+	tcp->cwnd = tcp->mss;
+	tcp->recovery = 0;
+	tcp->dupacks = 0;
+	tcp->snd_nxt = ( tcp->snd_una +
+			 sim_tcp_retransmit ( tcp->snd_una, now ) );
+	if ( tcp_cmp ( tcp->snd_nxt, tcp->snd_max ) > 0 )
+		tcp->snd_max = tcp->snd_nxt;
+}
+
+/**
+ * Transmit simulated server UDP packet
+ *
+ * @v iobuf		I/O buffer
+ * @v now		Current time
+ */
+static void sim_udp_tx ( struct io_buffer *iobuf, uint64_t now ) {
+	struct sim_tftp *tftp = &sim_tftp;
+	struct udp_header *udphdr;
+
+	udphdr = iob_push ( iobuf, sizeof ( *udphdr ) );
+	udphdr->src = htons ( SIM_TFTP_TID );
+	udphdr->dest = htons ( tftp->port );
+	udphdr->len = htons ( iob_len ( iobuf ) );
+	udphdr->chksum = 0;
+	sim_ipv4_tx ( iobuf, IP_UDP, &udphdr->chksum, now );
+}
+
+/**
+ * Transmit simulated server TFTP options acknowledgement
+ *
+ * @v now		Current time
+ */
+static void sim_tftp_tx_oack ( uint64_t now ) {
+	struct sim_tftp *tftp = &sim_tftp;
+	struct tftp_oack *oack;
+	struct io_buffer *iobuf;
+
+	/* Allocate I/O buffer */
+	iobuf = sim_alloc_iob ( sizeof ( struct udp_header ) + 64 );
+	if ( ! iobuf )
+		return;
+
+	/* Construct options acknowledgement */
+	oack = iob_put ( iobuf, sizeof ( *oack ) );
+	oack->opcode = htons ( TFTP_OACK );
+	if ( tftp->want_blksize ) {
+		iob_put ( iobuf, snprintf ( iobuf->tail,
+					    iob_tailroom ( iobuf ),
+					    "blksize%c%zd", 0,
+					    tftp->blksize ) + 1 );
+	}
+	if ( tftp->want_tsize ) {
+		iob_put ( iobuf, snprintf ( iobuf->tail,
+					    iob_tailroom ( iobuf ),
+					    "tsize%c%zd", 0, tftp->len ) + 1 );
+	}
+	if ( tftp->want_windowsize ) {
+		iob_put ( iobuf, snprintf ( iobuf->tail,
+					    iob_tailroom ( iobuf ),
+					    "windowsize%c%d", 0,
+					    tftp->windowsize ) + 1 );
+	}
+
+	sim_udp_tx ( iobuf, now );
+}
+
+/**
+ * Transmit simulated server TFTP window
+ *
+ * @v now		Current time
+ *
+ * All blocks within the window following the last acknowledged block
+ * are (re)transmitted.
+ */
+static void sim_tftp_tx_window ( uint64_t now ) {
+	struct sim_tftp *tftp = &sim_tftp;
+	struct tftp_data *data;
+	struct io_buffer *iobuf;
+	unsigned int block;
+	size_t offset;
+	size_t len;
+
+	for ( block = ( tftp->acked + 1 ) ;
+	      ( ( block <= ( tftp->acked + tftp->windowsize ) ) &&
+		( block <= tftp->blocks ) ) ; block++ ) {
+
+		/* Allocate I/O buffer */
+		offset = ( ( block - 1 ) * tftp->blksize );
+		len = ( tftp->len - offset );
+		if ( len > tftp->blksize )
+			len = tftp->blksize;
+		iobuf = sim_alloc_iob ( sizeof ( struct udp_header ) +
+					sizeof ( *data ) + len );
+		if ( ! iobuf )
+			break;
+
+		/* Construct data block */
+		data = iob_put ( iobuf, sizeof ( *data ) );
+		data->opcode = htons ( TFTP_DATA );
+		data->block = htons ( block );
+		memset ( iob_put ( iobuf, len ), 'x', len );
+		sim_udp_tx ( iobuf, now );
+
+		/* Record transmission */
+		if ( block <= tftp->sent ) {
+			tftp->retransmits++;
+		} else {
+			tftp->sent = block;
+		}
+	}
+}
+
+/**
+ * Process simulated server TFTP read request
+ *
+ * @v port		Client port
+ * @v data		Request
+ * @v len		Length of request
+ * @v now		Current time
+ */
+static void sim_tftp_rx_rrq ( unsigned int port, const void *data,
+			      size_t len, uint64_t now ) {
+	struct sim_tftp *tftp = &sim_tftp;
+	const struct tftp_rrq *rrq = data;
+	const char *end = ( data + len );
+	const char *filename;
+	const char *name;
+	const char *value;
+	int oack;
+
+	/* Sanity check */
+	if ( ( len < ( sizeof ( *rrq ) + 1 ) ) ||
+	     ( rrq->opcode != htons ( TFTP_RRQ ) ) || ( end[-1] != '\0' ) )
+		return;
+
+	/* Reinitialise transfer.  The filename is the file length. */
+	memset ( tftp, 0, sizeof ( *tftp ) );
+	tftp->open = 1;
+	tftp->port = port;
+	filename = rrq->data;
+	if ( *filename == '/' )
+		filename++;
+	tftp->len = strtoul ( filename, NULL, 10 );
+	tftp->blksize = TFTP_DEFAULT_BLKSIZE;
+	tftp->windowsize = TFTP_DEFAULT_WINDOWSIZE;
+	tftp->rto = ( SIM_MIN_RTO_US + ( sim_link->rtt * 1000 ) );
+
+	/* Parse options (following the filename and mode) */
+	name = ( rrq->data + strlen ( rrq->data ) + 1 );
+	if ( name < end )
+		name += ( strlen ( name ) + 1 );
+	while ( name < end ) {
+		value = ( name + strlen ( name ) + 1 );
+		if ( value >= end )
+			break;
+		if ( strcasecmp ( name, "blksize" ) == 0 ) {
+			tftp->blksize = strtoul ( value, NULL, 10 );
+			if ( tftp->blksize > SIM_TFTP_MAX_BLKSIZE )
+				tftp->blksize = SIM_TFTP_MAX_BLKSIZE;
+			tftp->want_blksize = 1;
+		} else if ( strcasecmp ( name, "tsize" ) == 0 ) {
+			tftp->want_tsize = 1;
+		} else if ( strcasecmp ( name, "windowsize" ) == 0 ) {
+			tftp->windowsize = strtoul ( value, NULL, 10 );
+			tftp->want_windowsize = 1;
+		}
+		name = ( value + strlen ( value ) + 1 );
+	}
+	if ( ! tftp->blksize )
+		tftp->blksize = TFTP_DEFAULT_BLKSIZE;
+	if ( ! tftp->windowsize )
+		tftp->windowsize = TFTP_DEFAULT_WINDOWSIZE;
+	tftp->blocks = ( ( tftp->len / tftp->blksize ) + 1 );
+
+	/* Acknowledge options, or start transfer immediately */
+	oack = ( tftp->want_blksize || tftp->want_tsize ||
+		 tftp->want_windowsize );
+	if ( oack ) {
+		sim_tftp_tx_oack ( now );
+	} else {
+		tftp->started = 1;
+		sim_tftp_tx_window ( now );
+	}
+	tftp->expiry = ( now + tftp->rto );
+}
+
+/**
+ * Process simulated server TFTP acknowledgement
+ *
+ * @v data		Acknowledgement
+ * @v len		Length of acknowledgement
+ * @v now		Current time
+ */
+static void sim_tftp_rx_ack ( const void *data, size_t len, uint64_t now ) {
+	struct sim_tftp *tftp = &sim_tftp;
+	const struct tftp_ack *ack = data;
+	unsigned int block;
+
+	/* Sanity check */
+	if ( len < sizeof ( *ack ) )
+		return;
+	if ( ack->opcode == htons ( TFTP_ERROR ) ) {
+		tftp->open = 0;
+		return;
+	}
+	if ( ack->opcode != htons ( TFTP_ACK ) )
+		return;
+
+	/* Extend 16-bit block number */
+	block = ( tftp->acked +
+		  ( ( uint16_t ) ( ntohs ( ack->block ) - tftp->acked ) ) );
+
+	/* Acknowledgement of options starts the transfer */
+	if ( ! tftp->started ) {
+		if ( block != 0 )
+			return;
+		tftp->started = 1;
+	} else {
+		/* Ignore duplicate acknowledgements, since the
+		 * client acknowledges every block received after any
+		 * missing block.  The window is restarted only by
+		 * forward progress or by the retransmission timer.
+		 */
+		if ( ( block <= tftp->acked ) || ( block > tftp->sent ) )
+			return;
+		tftp->acked = block;
+	}
+
+	/* Finish transfer, or send next window */
+	tftp->rto = ( SIM_MIN_RTO_US + ( sim_link->rtt * 1000 ) );
+	if ( tftp->acked == tftp->blocks ) {
+		tftp->open = 0;
+		return;
+	}
+	sim_tftp_tx_window ( now );
+	tftp->expiry = ( now + tftp->rto );
+}
+
+/**
+ * Run simulated server TFTP retransmission timer
+ *
+ * @v now		Current time
+ */
+static void sim_tftp_poll ( uint64_t now ) {
+	struct sim_tftp *tftp = &sim_tftp;
+
+	/* Do nothing unless timer has expired */
+	if ( ! ( tftp->open && ( now >= tftp->expiry ) ) )
+		return;
+	tftp->timeouts++;
+	tftp->rto *= 2;
+	tftp->expiry = ( now + tftp->rto );
+
+	/* Retransmit options acknowledgement or current window */
+	if ( tftp->started ) {
+		sim_tftp_tx_window ( now );
+	} else {
+		sim_tftp_tx_oack ( now );
+	}
+}
+
+/**
+ * Process simulated server UDP packet
+ *
+ * @v iobuf		I/O buffer
+ * @v now		Current time
+ */
+static void sim_udp_rx ( struct io_buffer *iobuf, uint64_t now ) {
+	struct sim_tftp *tftp = &sim_tftp;
+	struct udp_header *udphdr = iobuf->data;
+	size_t len;
+
+	/* Sanity check */
+	if ( iob_len ( iobuf ) < sizeof ( *udphdr ) )
+		return;
+	len = ntohs ( udphdr->len );
+	if ( ( len < sizeof ( *udphdr ) ) || ( len > iob_len ( iobuf ) ) )
+		return;
+	len -= sizeof ( *udphdr );
+
+	/* Hand off to TFTP server */
+	if ( udphdr->dest == htons ( TFTP_PORT ) ) {
+		sim_tftp_rx_rrq ( ntohs ( udphdr->src ), ( udphdr + 1 ), len,
+				  now );
+	} else if ( ( udphdr->dest == htons ( SIM_TFTP_TID ) ) &&
+		    tftp->open && ( udphdr->src == htons ( tftp->port ) ) ) {
+		sim_tftp_rx_ack ( ( udphdr + 1 ), len, now );
+	}
+}
+
+/**
+ * Process simulated server IPv4 packet
+ *
+ * @v iobuf		I/O buffer
+ * @v now		Current time
+ */
+static void sim_ipv4_rx ( struct io_buffer *iobuf, uint64_t now ) {
+	struct iphdr *iphdr = iobuf->data;
+	size_t hdrlen;
+	size_t len;
+
+	/* Sanity check */
+	if ( iob_len ( iobuf ) < sizeof ( *iphdr ) )
+		return;
+	hdrlen = ( ( iphdr->verhdrlen & IP_MASK_HLEN ) * 4 );
+	len = ntohs ( iphdr->len );
+	if ( ( hdrlen < sizeof ( *iphdr ) ) || ( len < hdrlen ) ||
+	     ( len > iob_len ( iobuf ) ) )
+		return;
+	if ( iphdr->dest.s_addr != sim_server.s_addr )
+		return;
+
+	/* Strip IPv4 header and any link-layer padding */
+	iob_unput ( iobuf, ( iob_len ( iobuf ) - len ) );
+	iob_pull ( iobuf, hdrlen );
+
+	/* Hand off to transport layer */
+	if ( iphdr->protocol == IP_TCP ) {
+		sim_tcp_rx ( iobuf, now );
+	} else if ( iphdr->protocol == IP_UDP ) {
+		sim_udp_rx ( iobuf, now );
+	}
+}
+
+/**
+ * Process simulated server ARP packet
+ *
+ * @v iobuf		I/O buffer
+ * @v now		Current time
+ */
+static void sim_arp_rx ( struct io_buffer *iobuf, uint64_t now ) {
+	struct arphdr *arphdr = iobuf->data;
+	struct arphdr *reply_arphdr;
+	struct io_buffer *reply;
+	size_t len;
+
+	/* Sanity check */
+	len = ( sizeof ( *arphdr ) +
+		( 2 * ( ETH_ALEN + sizeof ( struct in_addr ) ) ) );
+	if ( ( iob_len ( iobuf ) < len ) ||
+	     ( arphdr->ar_hln != ETH_ALEN ) ||
+	     ( arphdr->ar_pln != sizeof ( struct in_addr ) ) ||
+	     ( arphdr->ar_op != htons ( ARPOP_REQUEST ) ) )
+		return;
+
+	/* Respond only to requests for the server's address.  (The
+	 * reply's sender address is then copied from the request's
+	 * target address.)
+	 */
+	if ( memcmp ( arp_target_pa ( arphdr ), &sim_server,
+		      sizeof ( sim_server ) ) != 0 )
+		return;
+
+	/* Construct reply */
+	reply = alloc_iob ( MAX_LL_HEADER_LEN + len );
+	if ( ! reply )
+		return;
+	iob_reserve ( reply, MAX_LL_HEADER_LEN );
+	reply_arphdr = iob_put ( reply, len );
+	memcpy ( reply_arphdr, arphdr, sizeof ( *reply_arphdr ) );
+	reply_arphdr->ar_op = htons ( ARPOP_REPLY );
+	memcpy ( arp_sender_ha ( reply_arphdr ), sim_server_mac, ETH_ALEN );
+	memcpy ( arp_sender_pa ( reply_arphdr ), arp_target_pa ( arphdr ),
+		 sizeof ( struct in_addr ) );
+	memcpy ( arp_target_ha ( reply_arphdr ), arp_sender_ha ( arphdr ),
+		 ETH_ALEN );
+	memcpy ( arp_target_pa ( reply_arphdr ), arp_sender_pa ( arphdr ),
+		 sizeof ( struct in_addr ) );
+
+	sim_server_tx ( reply, htons ( ETH_P_ARP ), now );
+}
+
+/**
+ * Process packet received by simulated server
+ *
+ * @v iobuf		I/O buffer
+ * @v now		Current time
+ */
+static void sim_server_rx ( struct io_buffer *iobuf, uint64_t now ) {
+	struct ethhdr *ethhdr = iobuf->data;
+
+	if ( iob_len ( iobuf ) >= sizeof ( *ethhdr ) ) {
+		iob_pull ( iobuf, sizeof ( *ethhdr ) );
+		if ( ethhdr->h_protocol == htons ( ETH_P_IP ) ) {
+			sim_ipv4_rx ( iobuf, now );
+		} else if ( ethhdr->h_protocol == htons ( ETH_P_ARP ) ) {
+			sim_arp_rx ( iobuf, now );
+		}
+	}
+	free_iob ( iobuf );
+}
+
+/**
+ * Open simulated network device
+ *
+ * @v netdev		Network device
+ * @ret rc		Return status code
+ */
+static int sim_open ( struct net_device *netdev __unused ) {
+	return 0;
+}
+
+/**
+ * Close simulated network device
+ *
+ * @v netdev		Network device
+ */
+static void sim_close ( struct net_device *netdev __unused ) {
+	/* Nothing to do */
+}
+
+/**
+ * Transmit packet via simulated network device
+ *
+ * @v netdev		Network device
+ * @v iobuf		I/O buffer
+ * @ret rc		Return status code
+ *
+ * The packet is copied onto the link, so that transmission can be
+ * completed immediately.
+ */
+static int sim_transmit ( struct net_device *netdev,
+			  struct io_buffer *iobuf ) {
+	size_t len = iob_len ( iobuf );
+	struct io_buffer *copy;
+
+	copy = alloc_iob ( len );
+	if ( ! copy )
+		return -ENOMEM;
+	memcpy ( iob_put ( copy, len ), iobuf->data, len );
+	sim_queue_tx ( &sim_uplink, copy, sim_now() );
+	netdev_tx_complete ( netdev, iobuf );
+	return 0;
+}
+
+/**
+ * Poll simulated network device
+ *
+ * @v netdev		Network device
+ *
+ * This delivers all packets that have finished crossing the link in
+ * either direction, and runs the simulated server's timers.
+ */
+static void sim_poll ( struct net_device *netdev ) {
+	struct io_buffer *iobuf;
+	uint64_t now = sim_now();
+
+	while ( ( iobuf = sim_queue_rx ( &sim_uplink, now ) ) )
+		sim_server_rx ( iobuf, now );
+	sim_tcp_poll ( now );
+	sim_tcp_push ( now );
+	sim_tftp_poll ( now );
+	while ( ( iobuf = sim_queue_rx ( &sim_downlink, now ) ) )
+		netdev_rx ( netdev, iobuf );
+}
+
+/**
+ * Enable or disable interrupts on simulated network device
+ *
+ * @v netdev		Network device
+ * @v enable		Interrupts should be enabled
+ */
+static void sim_irq ( struct net_device *netdev __unused,
+		      int enable __unused ) {
+	/* Nothing to do */
+}
+
+/** Simulated network device operations */
+static struct net_device_operations sim_operations = {
+	.open		= sim_open,
+	.close		= sim_close,
+	.transmit	= sim_transmit,
+	.poll		= sim_poll,
+	.irq		= sim_irq,
+};
+
+/**
+ * Reset simulated link and server
+ *
+ * @v link		Simulated link
+ */
+static void sim_reset ( struct sim_link *link ) {
+
+	sim_link = link;
+	sim_queue_reset ( &sim_uplink );
+	sim_queue_reset ( &sim_downlink );
+	memset ( &sim_tcp, 0, sizeof ( sim_tcp ) );
+	memset ( &sim_tftp, 0, sizeof ( sim_tftp ) );
+	sim_seed = 0;
+}
+
+/**
+ * Receive benchmark download data
+ *
+ * @v download		Benchmark download
+ * @v iobuf		I/O buffer
+ * @v meta		Data transfer metadata
+ * @ret rc		Return status code
+ */
+static int net_bench_deliver ( struct net_bench_download *download,
+			       struct io_buffer *iobuf,
+			       struct xfer_metadata *meta ) {
+	size_t len = iob_len ( iobuf );
+
+	/* Track file position, since some protocols (e.g. TFTP) may
+	 * deliver the same data more than once.
+	 */
+	if ( meta->flags & XFER_FL_ABS_OFFSET )
+		download->pos = 0;
+	download->pos += meta->offset;
+	if ( download->len < ( download->pos + len ) )
+		download->len = ( download->pos + len );
+	download->pos += len;
+	free_iob ( iobuf );
+	return 0;
+}
+
+/**
+ * Finish benchmark download
+ *
+ * @v download		Benchmark download
+ * @v rc		Reason for finishing
+ */
+static void net_bench_close ( struct net_bench_download *download, int rc ) {
+
+	download->rc = rc;
+	download->done = 1;
+	intf_restart ( &download->xfer, rc );
+}
+
+/** Benchmark download data transfer interface operations */
+static struct interface_operation net_bench_xfer_op[] = {
+	INTF_OP ( xfer_deliver, struct net_bench_download *,
+		  net_bench_deliver ),
+	INTF_OP ( intf_close, struct net_bench_download *, net_bench_close ),
+};
+
+/** Benchmark download data transfer interface descriptor */
+static struct interface_descriptor net_bench_xfer_desc =
+	INTF_DESC ( struct net_bench_download, xfer, net_bench_xfer_op );
+
+/** Benchmark download */
+static struct net_bench_download net_bench_download = {
+	.xfer = INTF_INIT ( net_bench_xfer_desc ),
+};
+
+/**
+ * Benchmark a download over a simulated link
+ *
+ * @v link		Simulated link
+ * @v scheme		URI scheme
+ * @v len		Length of file
+ */
+static void net_bench_run ( struct sim_link *link, const char *scheme,
+			    size_t len ) {
+	struct net_bench_download *download = &net_bench_download;
+	struct tcp_statistics before;
+	unsigned long started;
+	unsigned long elapsed;
+	unsigned long ms;
+	uint64_t kbps;
+	char uri[64];
+	int rc;
+
+	/* Reset link and server */
+	sim_reset ( link );
+	memcpy ( &before, &tcp_stats, sizeof ( before ) );
+	download->pos = 0;
+	download->len = 0;
+	download->done = 0;
+	download->rc = 0;
+
+	/* Download file */
+	snprintf ( uri, sizeof ( uri ), "%s://%s/%zd", scheme,
+		   inet_ntoa ( sim_server ), len );
+	started = currticks();
+	rc = xfer_open_uri_string ( &download->xfer, uri );
+	ok ( rc == 0 );
+	if ( rc != 0 )
+		return;
+	while ( ! download->done ) {
+		step();
+		if ( ( currticks() - started ) >
+		     ( NET_BENCH_TIMEOUT_SEC * TICKS_PER_SEC ) ) {
+			net_bench_close ( download, -ETIMEDOUT );
+		}
+	}
+	elapsed = ( currticks() - started );
+	ok ( download->rc == 0 );
+	ok ( download->len == len );
+
+	/* Report results */
+	ms = ( ( ( uint64_t ) elapsed * 1000 ) / TICKS_PER_SEC );
+	kbps = ( ms ? ( ( ( uint64_t ) download->len * 8 ) / ms ) : 0 );
+	printf ( "BENCH %s %s (%dMbps %dms %d.%d%% loss %d.%d%% reorder) "
+		 "%zd bytes: %lld.%02lld Mbps in %ld.%03lds\n",
+		 scheme, link->name, link->mbps, link->rtt,
+		 ( link->loss / 10 ), ( link->loss % 10 ),
+		 ( link->reorder / 10 ), ( link->reorder % 10 ),
+		 download->len, ( kbps / 1000 ), ( ( kbps % 1000 ) / 10 ),
+		 ( ms / 1000 ), ( ms % 1000 ) );
+	printf ( "BENCH %s %s link: %d/%d lost, %d/%d reordered, "
+		 "%d/%d dropped\n", scheme, link->name,
+		 sim_uplink.lost, sim_downlink.lost,
+		 sim_uplink.reordered, sim_downlink.reordered,
+		 sim_uplink.dropped, sim_downlink.dropped );
+	printf ( "BENCH %s %s server: %d retransmits, %d timeouts; client: "
+		 "%d retransmits (%d fast), %d duplicate, %d out of order, "
+		 "%d zero windows\n", scheme, link->name,
+		 ( sim_tcp.retransmits + sim_tftp.retransmits ),
+		 ( sim_tcp.timeouts + sim_tftp.timeouts ),
+		 ( tcp_stats.retransmits - before.retransmits ),
+		 ( tcp_stats.fast_retransmits - before.fast_retransmits ),
+		 ( tcp_stats.rx_duplicates - before.rx_duplicates ),
+		 ( tcp_stats.rx_out_of_order - before.rx_out_of_order ),
+		 ( tcp_stats.zero_windows - before.zero_windows ) );
+}
+
+/** Simulated links */
+static struct sim_link net_bench_links[] = {
+	{ .name = "lan", .mbps = 1000, .rtt = 1 },
+	{ .name = "wan", .mbps = 100, .rtt = 20 },
+	{ .name = "lossy", .mbps = 100, .rtt = 20, .loss = 10 },
+	{ .name = "reorder", .mbps = 100, .rtt = 5, .reorder = 20 },
+};
+
+/**
+ * Perform network protocol benchmarks
+ *
+ */
+static void net_bench_exec ( void ) {
+	struct net_device *netdev;
+	struct settings *settings;
+	struct in_addr netmask;
+	unsigned int i;
+
+	/* Configure addresses */
+	inet_aton ( SIM_CLIENT_IP, &sim_client );
+	inet_aton ( SIM_SERVER_IP, &sim_server );
+	inet_aton ( SIM_NETMASK, &netmask );
+	sim_link = &net_bench_links[0];
+
+	/* Create simulated network device */
+	netdev = alloc_etherdev ( 0 );
+	ok ( netdev != NULL );
+	if ( ! netdev )
+		goto err_alloc;
+	netdev_init ( netdev, &sim_operations );
+	memcpy ( netdev->hw_addr, sim_client_mac, ETH_ALEN );
+	ok ( register_netdev ( netdev ) == 0 );
+	netdev_link_up ( netdev );
+	ok ( netdev_open ( netdev ) == 0 );
+	settings = netdev_settings ( netdev );
+	ok ( store_setting ( settings, &ip_setting, &sim_client,
+			     sizeof ( sim_client ) ) == 0 );
+	ok ( store_setting ( settings, &netmask_setting, &netmask,
+			     sizeof ( netmask ) ) == 0 );
+
+	/* Run benchmarks */
+	for ( i = 0 ; i < ( sizeof ( net_bench_links ) /
+			    sizeof ( net_bench_links[0] ) ) ; i++ ) {
+		net_bench_run ( &net_bench_links[i], "http",
+				NET_BENCH_HTTP_LEN );
+		net_bench_run ( &net_bench_links[i], "tftp",
+				NET_BENCH_TFTP_LEN );
+	}
+
+	/* Destroy simulated network device */
+	unregister_netdev ( netdev );
+	netdev_nullify ( netdev );
+	netdev_put ( netdev );
+	sim_reset ( &net_bench_links[0] );
+ err_alloc:
+	return;
+}
+
+/** Network protocol benchmarks */
+struct self_test net_bench __self_test = {
+	.name = "net_bench",
+	.exec = net_bench_exec,
+};
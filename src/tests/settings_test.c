@@ -174,6 +174,8 @@ static struct setting test_uuid_setting = {
  *
  */
 static void settings_test_exec ( void ) {
+	struct setting *setting;
+	struct setting *named;
 
 	/* Register test settings block */
 	ok ( register_settings ( &test_settings, NULL, "test" ) == 0 );
@@ -267,6 +269,15 @@ static void settings_test_exec ( void ) {
 			  0x7a, 0x7c, 0xfe, 0x4f, 0xca, 0x4a, 0x57 ),
 		    "1a6a749d-0eda-461a-a87a-7cfe4fca4a57" );
 
+	/* Named setting lookup */
+	for_each_table_entry ( setting, SETTINGS ) {
+		named = find_setting ( setting->name );
+		ok ( ( named != NULL ) && ( named <= setting ) &&
+		     ( strcmp ( named->name, setting->name ) == 0 ) );
+	}
+	ok ( find_setting ( "no-such-setting" ) == NULL );
+	ok ( find_setting ( "" ) == NULL );
+
 	/* Unregister test settings block */
 	unregister_settings ( &test_settings );
 }
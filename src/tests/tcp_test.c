@@ -0,0 +1,448 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/** @file
+ *
+ * TCP connection establishment tests
+ *
+ * Connections are opened via a test network device.  Each SYN
+ * transmitted by the device is captured, and the peer's responses
+ * are passed directly to the TCP receive path.
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <byteswap.h>
+#include <ipxe/iobuf.h>
+#include <ipxe/interface.h>
+#include <ipxe/open.h>
+#include <ipxe/socket.h>
+#include <ipxe/process.h>
+#include <ipxe/timer.h>
+#include <ipxe/netdevice.h>
+#include <ipxe/ethernet.h>
+#include <ipxe/if_ether.h>
+#include <ipxe/if_arp.h>
+#include <ipxe/in.h>
+#include <ipxe/ip.h>
+#include <ipxe/tcpip.h>
+#include <ipxe/tcp.h>
+#include <ipxe/settings.h>
+#include <ipxe/test.h>
+
+/** Test client IPv4 address */
+#define TCP_TEST_CLIENT_IP "10.98.0.1"
+
+/** Test peer IPv4 address */
+#define TCP_TEST_PEER_IP "10.98.0.2"
+
+/** Test netmask */
+#define TCP_TEST_NETMASK "255.255.255.0"
+
+/** Test peer port */
+#define TCP_TEST_PORT 8080
+
+/** Test peer initial sequence number */
+#define TCP_TEST_ISS 0x7e570000UL
+
+/** Test peer MAC address */
+static const uint8_t tcp_test_peer_mac[ETH_ALEN] =
+	{ 0x02, 0x00, 0x00, 0x00, 0x7e, 0x57 };
+
+/** Test client MAC address */
+static const uint8_t tcp_test_client_mac[ETH_ALEN] =
+	{ 0x02, 0x00, 0x00, 0x00, 0x7e, 0x01 };
+
+/** Test peer IPv4 address */
+static struct in_addr tcp_test_peer;
+
+/** Most recently transmitted TCP segment */
+static struct {
+	/** Segment (including TCP header) */
+	uint8_t data[ sizeof ( struct tcp_header ) + TCP_MAX_OPTIONS_LEN ];
+	/** Length of TCP header */
+	size_t hlen;
+	/** Number of SYNs transmitted */
+	unsigned int syns;
+} tcp_test_tx;
+
+/** Test data transfer interface */
+static struct interface tcp_test_xfer = INTF_INIT ( null_intf_desc );
+
+/**
+ * Reply to ARP request from test network device
+ *
+ * @v netdev		Network device
+ * @v arphdr		ARP request
+ * @v len		Length of ARP request
+ */
+static void tcp_test_arp ( struct net_device *netdev, struct arphdr *arphdr,
+			   size_t len ) {
+	struct arphdr *reply_arphdr;
+	struct ethhdr *ethhdr;
+	struct io_buffer *reply;
+
+	/* Respond only to requests for the peer's address */
+	if ( ( len < ( sizeof ( *arphdr ) +
+		       ( 2 * ( ETH_ALEN + sizeof ( struct in_addr ) ) ) ) ) ||
+	     ( arphdr->ar_op != htons ( ARPOP_REQUEST ) ) ||
+	     ( memcmp ( arp_target_pa ( arphdr ), &tcp_test_peer,
+			sizeof ( tcp_test_peer ) ) != 0 ) )
+		return;
+
+	/* Construct reply */
+	reply = alloc_iob ( sizeof ( *ethhdr ) + len );
+	if ( ! reply )
+		return;
+	ethhdr = iob_put ( reply, sizeof ( *ethhdr ) );
+	memcpy ( ethhdr->h_dest, tcp_test_client_mac, ETH_ALEN );
+	memcpy ( ethhdr->h_source, tcp_test_peer_mac, ETH_ALEN );
+	ethhdr->h_protocol = htons ( ETH_P_ARP );
+	reply_arphdr = iob_put ( reply, len );
+	memcpy ( reply_arphdr, arphdr, sizeof ( *reply_arphdr ) );
+	reply_arphdr->ar_op = htons ( ARPOP_REPLY );
+	memcpy ( arp_sender_ha ( reply_arphdr ), tcp_test_peer_mac, ETH_ALEN );
+	memcpy ( arp_sender_pa ( reply_arphdr ), arp_target_pa ( arphdr ),
+		 sizeof ( struct in_addr ) );
+	memcpy ( arp_target_ha ( reply_arphdr ), arp_sender_ha ( arphdr ),
+		 ETH_ALEN );
+	memcpy ( arp_target_pa ( reply_arphdr ), arp_sender_pa ( arphdr ),
+		 sizeof ( struct in_addr ) );
+	netdev_rx ( netdev, reply );
+}
+
+/**
+ * Open test network device
+ *
+ * @v netdev		Network device
+ * @ret rc		Return status code
+ */
+static int tcp_test_open ( struct net_device *netdev __unused ) {
+	return 0;
+}
+
+/**
+ * Close test network device
+ *
+ * @v netdev		Network device
+ */
+static void tcp_test_close ( struct net_device *netdev __unused ) {
+	/* Nothing to do */
+}
+
+/**
+ * Transmit packet via test network device
+ *
+ * @v netdev		Network device
+ * @v iobuf		I/O buffer
+ * @ret rc		Return status code
+ *
+ * ARP requests for the peer are answered, and any SYN is recorded.
+ */
+static int tcp_test_transmit ( struct net_device *netdev,
+			       struct io_buffer *iobuf ) {
+	struct ethhdr *ethhdr = iobuf->data;
+	struct iphdr *iphdr = ( ( void * ) ( ethhdr + 1 ) );
+	struct tcp_header *tcphdr;
+	size_t len = iob_len ( iobuf );
+	size_t iphlen;
+	size_t hlen;
+
+	/* Answer ARP requests */
+	if ( ( len >= sizeof ( *ethhdr ) ) &&
+	     ( ethhdr->h_protocol == htons ( ETH_P_ARP ) ) ) {
+		tcp_test_arp ( netdev, ( ( void * ) ( ethhdr + 1 ) ),
+			       ( len - sizeof ( *ethhdr ) ) );
+		goto done;
+	}
+
+	/* Record SYNs */
+	if ( ( len < ( sizeof ( *ethhdr ) + sizeof ( *iphdr ) ) ) ||
+	     ( ethhdr->h_protocol != htons ( ETH_P_IP ) ) ||
+	     ( iphdr->protocol != IP_TCP ) )
+		goto done;
+	iphlen = ( ( iphdr->verhdrlen & IP_MASK_HLEN ) * 4 );
+	len -= ( sizeof ( *ethhdr ) + iphlen );
+	tcphdr = ( ( ( void * ) iphdr ) + iphlen );
+	if ( ( len < sizeof ( *tcphdr ) ) || ! ( tcphdr->flags & TCP_SYN ) )
+		goto done;
+	hlen = ( ( tcphdr->hlen & TCP_MASK_HLEN ) / 16 ) * 4;
+	memset ( tcp_test_tx.data, 0, sizeof ( tcp_test_tx.data ) );
+	memcpy ( tcp_test_tx.data, tcphdr,
+		 ( ( len < sizeof ( tcp_test_tx.data ) ) ?
+		   len : sizeof ( tcp_test_tx.data ) ) );
+	tcp_test_tx.hlen = hlen;
+	tcp_test_tx.syns++;
+
+ done:
+	netdev_tx_complete ( netdev, iobuf );
+	return 0;
+}
+
+/**
+ * Poll test network device
+ *
+ * @v netdev		Network device
+ */
+static void tcp_test_poll ( struct net_device *netdev __unused ) {
+	/* Nothing to do */
+}
+
+/**
+ * Enable or disable interrupts on test network device
+ *
+ * @v netdev		Network device
+ * @v enable		Interrupts should be enabled
+ */
+static void tcp_test_irq ( struct net_device *netdev __unused,
+			   int enable __unused ) {
+	/* Nothing to do */
+}
+
+/** Test network device operations */
+static struct net_device_operations tcp_test_operations = {
+	.open		= tcp_test_open,
+	.close		= tcp_test_close,
+	.transmit	= tcp_test_transmit,
+	.poll		= tcp_test_poll,
+	.irq		= tcp_test_irq,
+};
+
+/**
+ * Find option within recorded SYN
+ *
+ * @v kind		Option kind
+ * @ret option		Option, or NULL if not present
+ */
+static const uint8_t * tcp_test_option ( unsigned int kind ) {
+	const uint8_t *option = ( tcp_test_tx.data +
+				  sizeof ( struct tcp_header ) );
+	const uint8_t *end = ( tcp_test_tx.data + tcp_test_tx.hlen );
+
+	while ( option < end ) {
+		if ( *option == TCP_OPTION_END )
+			break;
+		if ( *option == TCP_OPTION_NOP ) {
+			option++;
+			continue;
+		}
+		if ( ( ( option + 2 ) > end ) || ( option[1] < 2 ) ||
+		     ( ( option + option[1] ) > end ) )
+			break;
+		if ( *option == kind )
+			return option;
+		option += option[1];
+	}
+	return NULL;
+}
+
+/**
+ * Open connection and wait for SYN
+ *
+ * @v peer		Peer address
+ * @ret rc		Return status code
+ */
+static int tcp_test_connect ( struct sockaddr_in *peer ) {
+	unsigned int syns = tcp_test_tx.syns;
+	unsigned long start;
+	int rc;
+
+	/* Open connection */
+	if ( ( rc = xfer_open_socket ( &tcp_test_xfer, SOCK_STREAM_FASTOPEN,
+				       ( struct sockaddr * ) peer,
+				       NULL ) ) != 0 )
+		return rc;
+
+	/* Wait for SYN (which may be deliberately delayed when a
+	 * Fast Open cookie is available).
+	 */
+	start = currticks();
+	while ( tcp_test_tx.syns == syns ) {
+		if ( ( currticks() - start ) > TICKS_PER_SEC )
+			return -ETIMEDOUT;
+		step();
+	}
+	return 0;
+}
+
+/**
+ * Pass segment from peer to TCP receive path
+ *
+ * @v flags		TCP flags
+ * @v seq		Sequence number
+ * @v cookie		Fast Open cookie, or NULL
+ * @v cookie_len	Length of Fast Open cookie
+ */
+static void tcp_test_rx ( unsigned int flags, uint32_t seq,
+			  const void *cookie, size_t cookie_len ) {
+	const struct tcp_header *syn = ( ( void * ) tcp_test_tx.data );
+	struct sockaddr_in src;
+	struct sockaddr_in dest;
+	struct tcp_fastopen_option *foopt;
+	struct tcp_header *tcphdr;
+	struct io_buffer *iobuf;
+	size_t opt_len = 0;
+	void *pad;
+
+	/* Construct segment */
+	iobuf = alloc_iob ( sizeof ( *tcphdr ) + TCP_MAX_OPTIONS_LEN );
+	ok ( iobuf != NULL );
+	if ( ! iobuf )
+		return;
+	tcphdr = iob_put ( iobuf, sizeof ( *tcphdr ) );
+	if ( cookie ) {
+		opt_len = ( ( sizeof ( *foopt ) + cookie_len + 3 ) & ~3 );
+		pad = iob_put ( iobuf, opt_len );
+		memset ( pad, TCP_OPTION_NOP, opt_len );
+		foopt = ( pad + opt_len - ( sizeof ( *foopt ) + cookie_len ) );
+		foopt->kind = TCP_OPTION_FASTOPEN;
+		foopt->length = ( sizeof ( *foopt ) + cookie_len );
+		memcpy ( ( foopt + 1 ), cookie, cookie_len );
+	}
+	memset ( tcphdr, 0, sizeof ( *tcphdr ) );
+	tcphdr->src = syn->dest;
+	tcphdr->dest = syn->src;
+	tcphdr->seq = htonl ( seq );
+	tcphdr->ack = htonl ( ntohl ( syn->seq ) + 1 );
+	tcphdr->hlen = ( ( ( sizeof ( *tcphdr ) + opt_len ) / 4 ) << 4 );
+	tcphdr->flags = flags;
+	tcphdr->win = htons ( 0xffff );
+	tcphdr->csum = tcpip_chksum ( iobuf->data, iob_len ( iobuf ) );
+
+	/* Pass to TCP receive path */
+	memset ( &src, 0, sizeof ( src ) );
+	src.sin_family = AF_INET;
+	src.sin_addr = tcp_test_peer;
+	memset ( &dest, 0, sizeof ( dest ) );
+	dest.sin_family = AF_INET;
+	tcpip_rx ( iobuf, IP_TCP, ( struct sockaddr_tcpip * ) &src,
+		   ( struct sockaddr_tcpip * ) &dest, TCPIP_EMPTY_CSUM );
+}
+
+/**
+ * Complete handshake and reset connection
+ *
+ * @v cookie		Fast Open cookie to issue, or NULL
+ * @v cookie_len	Length of Fast Open cookie
+ */
+static void tcp_test_accept ( const void *cookie, size_t cookie_len ) {
+
+	tcp_test_rx ( ( TCP_SYN | TCP_ACK ), TCP_TEST_ISS,
+		      cookie, cookie_len );
+	tcp_test_rx ( TCP_RST, ( TCP_TEST_ISS + 1 ), NULL, 0 );
+	intf_restart ( &tcp_test_xfer, 0 );
+}
+
+/**
+ * Check recorded SYN
+ *
+ * @v cookie		Expected Fast Open cookie
+ * @v cookie_len	Length of expected Fast Open cookie
+ */
+#define tcp_test_syn_ok( cookie, cookie_len ) do {			\
+	const uint8_t *option;						\
+	ok ( tcp_test_tx.hlen >= sizeof ( struct tcp_header ) );	\
+	ok ( tcp_test_tx.hlen <= ( sizeof ( struct tcp_header ) +	\
+				   TCP_MAX_OPTIONS_LEN ) );		\
+	ok ( tcp_test_option ( TCP_OPTION_MSS ) != NULL );		\
+	ok ( tcp_test_option ( TCP_OPTION_TS ) != NULL );		\
+	option = tcp_test_option ( TCP_OPTION_FASTOPEN );		\
+	ok ( option != NULL );						\
+	if ( option ) {							\
+		ok ( option[1] == ( sizeof ( struct tcp_fastopen_option ) \
+				    + (cookie_len) ) );			\
+		ok ( memcmp ( ( option + 2 ), (cookie),			\
+			      (cookie_len) ) == 0 );			\
+	}								\
+	} while ( 0 )
+
+/**
+ * Perform TCP connection establishment self-tests
+ *
+ */
+static void tcp_test_exec ( void ) {
+	static const uint8_t long_cookie[16] =
+		{ 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+		  0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff };
+	static const uint8_t max_cookie[TCP_FASTOPEN_COOKIE_MAX] =
+		{ 0xc0, 0x0c, 0x1e, 0x50, 0xf0, 0x0d, 0xfe, 0xed,
+		  0xfa, 0xce, 0xbe, 0xef, 0xca, 0xfe };
+	struct net_device *netdev;
+	struct settings *settings;
+	struct in_addr client;
+	struct in_addr netmask;
+	struct sockaddr_in peer;
+
+	/* Create test network device */
+	inet_aton ( TCP_TEST_CLIENT_IP, &client );
+	inet_aton ( TCP_TEST_PEER_IP, &tcp_test_peer );
+	inet_aton ( TCP_TEST_NETMASK, &netmask );
+	netdev = alloc_etherdev ( 0 );
+	ok ( netdev != NULL );
+	if ( ! netdev )
+		return;
+	netdev_init ( netdev, &tcp_test_operations );
+	memcpy ( netdev->hw_addr, tcp_test_client_mac, ETH_ALEN );
+	ok ( register_netdev ( netdev ) == 0 );
+	netdev_link_up ( netdev );
+	ok ( netdev_open ( netdev ) == 0 );
+	settings = netdev_settings ( netdev );
+	ok ( store_setting ( settings, &ip_setting, &client,
+			     sizeof ( client ) ) == 0 );
+	ok ( store_setting ( settings, &netmask_setting, &netmask,
+			     sizeof ( netmask ) ) == 0 );
+	memset ( &peer, 0, sizeof ( peer ) );
+	peer.sin_family = AF_INET;
+	peer.sin_addr = tcp_test_peer;
+	peer.sin_port = htons ( TCP_TEST_PORT );
+
+	/* Initial SYN requests a cookie */
+	ok ( tcp_test_connect ( &peer ) == 0 );
+	tcp_test_syn_ok ( "", 0 );
+
+	/* A cookie too long to fit alongside the other SYN options
+	 * is ignored, so the next SYN requests a cookie again.
+	 */
+	tcp_test_accept ( long_cookie, sizeof ( long_cookie ) );
+	ok ( tcp_test_connect ( &peer ) == 0 );
+	tcp_test_syn_ok ( "", 0 );
+
+	/* A maximum-length cookie is sent within a valid SYN */
+	tcp_test_accept ( max_cookie, sizeof ( max_cookie ) );
+	ok ( tcp_test_connect ( &peer ) == 0 );
+	tcp_test_syn_ok ( max_cookie, sizeof ( max_cookie ) );
+	tcp_test_accept ( NULL, 0 );
+
+	/* Destroy test network device */
+	unregister_netdev ( netdev );
+	netdev_nullify ( netdev );
+	netdev_put ( netdev );
+}
+
+/** TCP connection establishment self-test */
+struct self_test tcp_test __self_test = {
+	.name = "tcp",
+	.exec = tcp_test_exec,
+};
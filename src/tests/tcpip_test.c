@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/** @file
+ *
+ * TCP/IP checksum tests
+ *
+ */
+
+/* Forcibly enable assertions */
+#undef NDEBUG
+
+#include <stdint.h>
+#include <string.h>
+#include <byteswap.h>
+#include <ipxe/iobuf.h>
+#include <ipxe/tcpip.h>
+#include <ipxe/test.h>
+
+/** Define inline data */
+#define DATA(...) { __VA_ARGS__ }
+
+/** A TCP/IP checksum known-answer test */
+struct tcpip_test {
+	/** Data */
+	const void *data;
+	/** Length of data */
+	size_t len;
+	/** Expected checksum (in host byte order) */
+	uint16_t expected;
+};
+
+/**
+ * Define a TCP/IP checksum known-answer test
+ *
+ * @v name		Test name
+ * @v DATA		Data
+ * @v EXPECTED		Expected checksum (in host byte order)
+ */
+#define TCPIP_TEST( name, DATA, EXPECTED )				\
+	static const uint8_t name ## _data[] = DATA;			\
+	static struct tcpip_test name = {				\
+		.data = name ## _data,					\
+		.len = sizeof ( name ## _data ),			\
+		.expected = EXPECTED,					\
+	}
+
+/** RFC 1071 section 3 example */
+TCPIP_TEST ( rfc1071,
+	     DATA ( 0x00, 0x01, 0xf2, 0x03, 0xf4, 0xf5, 0xf6, 0xf7 ),
+	     0x220d );
+
+/** RFC 1071 example truncated to an odd length */
+TCPIP_TEST ( rfc1071_odd, DATA ( 0x00, 0x01, 0xf2 ), 0x0dfe );
+
+/** IPv4 header, with the checksum field zeroed */
+TCPIP_TEST ( ipv4_header,
+	     DATA ( 0x45, 0x00, 0x00, 0x73, 0x00, 0x00, 0x40, 0x00, 0x40,
+		    0x11, 0x00, 0x00, 0xc0, 0xa8, 0x00, 0x01, 0xc0, 0xa8,
+		    0x00, 0xc7 ),
+	     0xb861 );
+
+/** Zero data (which sums to zero, giving a checksum of 0xffff) */
+TCPIP_TEST ( zeroes, DATA ( 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 ), 0xffff );
+
+/** Complementary words (which sum to 0xffff, giving a checksum of 0) */
+TCPIP_TEST ( complement, DATA ( 0x12, 0x34, 0xed, 0xcb ), 0x0000 );
+
+/** All-ones data, long enough to carry repeatedly within each block */
+TCPIP_TEST ( ones,
+	     DATA ( 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff ),
+	     0x0000 );
+
+/** Mixed data spanning several blocks, with a trailing odd byte */
+TCPIP_TEST ( mixed,
+	     DATA ( 0x5a, 0xf7, 0x94, 0x31, 0xce, 0x6b, 0x08, 0xa5,
+		    0x42, 0xdf, 0x7c, 0x19, 0xb6, 0x53, 0xf0, 0x8d,
+		    0x2a, 0xc7, 0x64, 0x01, 0x9e, 0x3b, 0xd8, 0x75,
+		    0x12, 0xaf, 0x4c, 0xe9, 0x86, 0x23, 0xc0, 0x5d,
+		    0xfa, 0x97, 0x34, 0xd1, 0x6e, 0x0b, 0xa8, 0x45,
+		    0xe2, 0x7f, 0x1c, 0xb9, 0x56, 0xf3, 0x90, 0x2d,
+		    0xca, 0x67, 0x04, 0xa1, 0x3e, 0xdb, 0x78, 0x15,
+		    0xb2, 0x4f, 0xec, 0x89, 0x26, 0xc3, 0x60, 0xfd,
+		    0x9a, 0x37, 0xd4, 0x71, 0x0e, 0xab, 0x48 ),
+	     0x8a5b );
+
+/**
+ * Check TCP/IP checksum known-answer test
+ *
+ * @v test		TCP/IP checksum test
+ * @ret success		Test succeeded
+ *
+ * The data is checksummed starting at both even and odd addresses,
+ * using both the default and the generic implementations, and also
+ * in two parts split at an even offset.
+ */
+static int tcpip_test_okx ( struct tcpip_test *test ) {
+	uint8_t buf[ test->len + 8 ];
+	uint16_t expected = htons ( test->expected );
+	size_t split = ( ( test->len / 2 ) & ~1 );
+	unsigned int offset;
+	void *data;
+	uint16_t partial;
+
+	for ( offset = 0 ; offset < 8 ; offset++ ) {
+		data = &buf[offset];
+		memcpy ( data, test->data, test->len );
+		if ( tcpip_chksum ( data, test->len ) != expected )
+			return 0;
+		if ( generic_tcpip_continue_chksum ( TCPIP_EMPTY_CSUM, data,
+						     test->len ) != expected )
+			return 0;
+		partial = tcpip_chksum ( data, split );
+		if ( tcpip_continue_chksum ( partial, ( data + split ),
+					     ( test->len - split ) ) !=
+		     expected )
+			return 0;
+	}
+	return 1;
+}
+
+/**
+ * Report TCP/IP checksum known-answer test result
+ *
+ * @v test		TCP/IP checksum test
+ */
+#define tcpip_ok( test ) do {						\
+	ok ( tcpip_test_okx ( test ) );					\
+	} while ( 0 )
+
+/**
+ * Perform TCP/IP checksum self-tests
+ *
+ */
+static void tcpip_test_exec ( void ) {
+	struct io_buffer frags[3];
+	unsigned int split;
+
+	/* Known-answer tests */
+	tcpip_ok ( &rfc1071 );
+	tcpip_ok ( &rfc1071_odd );
+	tcpip_ok ( &ipv4_header );
+	tcpip_ok ( &zeroes );
+	tcpip_ok ( &complement );
+	tcpip_ok ( &ones );
+	tcpip_ok ( &mixed );
+
+	/* Empty data leaves checksum untouched */
+	ok ( tcpip_continue_chksum ( 0x1234, mixed_data, 0 ) == 0x1234 );
+	ok ( tcpip_chksum ( mixed_data, 0 ) == TCPIP_EMPTY_CSUM );
+
+	/* Multi-fragment I/O buffers, including fragments starting
+	 * at odd offsets.
+	 */
+	for ( split = 0 ; split < ( sizeof ( mixed_data ) - 3 ) ; split++ ) {
+		iob_populate ( &frags[0], ( ( void * ) mixed_data ),
+			       split, split );
+		iob_populate ( &frags[1], ( ( void * ) &mixed_data[split] ),
+			       3, 3 );
+		iob_populate ( &frags[2],
+			       ( ( void * ) &mixed_data[ split + 3 ] ),
+			       ( sizeof ( mixed_data ) - split - 3 ),
+			       ( sizeof ( mixed_data ) - split - 3 ) );
+		frags[0].frag = &frags[1];
+		frags[1].frag = &frags[2];
+		ok ( iob_total_len ( &frags[0] ) == sizeof ( mixed_data ) );
+		ok ( tcpip_chksum_iob ( &frags[0] ) == htons ( mixed.expected ) );
+	}
+}
+
+/** TCP/IP checksum self-test */
+struct self_test tcpip_test __self_test = {
+	.name = "tcpip",
+	.exec = tcpip_test_exec,
+};
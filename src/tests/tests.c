@@ -22,17 +22,37 @@ FILE_LICENCE ( GPL2_OR_LATER );
  *
  * Self-test collection
  *
+ * Benchmarks (such as crypto_bench) are deliberately not included
+ * in this collection, since their results are measurements rather
+ * than pass/fail outcomes.  Build and run each benchmark
+ * individually using e.g.
+ *
+ *     make bin-x86_64-linux/crypto_bench.linux
+ *     ./bin-x86_64-linux/crypto_bench.linux
+ *
+ * or include it in a bootable image (e.g. "make bin/crypto_bench.usb")
+ * to take measurements on real hardware.
  */
 
 /* Drag in all applicable self-tests */
 REQUIRE_OBJECT ( list_test );
+REQUIRE_OBJECT ( log_test );
 REQUIRE_OBJECT ( byteswap_test );
+REQUIRE_OBJECT ( crc32_test );
+REQUIRE_OBJECT ( crc32c_test );
+REQUIRE_OBJECT ( tcpip_test );
+REQUIRE_OBJECT ( ipv6_test );
+REQUIRE_OBJECT ( tcp_test );
 REQUIRE_OBJECT ( settings_test );
 REQUIRE_OBJECT ( time_test );
+REQUIRE_OBJECT ( blockcache_test );
+REQUIRE_OBJECT ( deflate_test );
+REQUIRE_OBJECT ( lz4_test );
 REQUIRE_OBJECT ( md5_test );
 REQUIRE_OBJECT ( sha1_test );
 REQUIRE_OBJECT ( sha256_test );
 REQUIRE_OBJECT ( aes_cbc_test );
+REQUIRE_OBJECT ( aes_gcm_test );
 REQUIRE_OBJECT ( hmac_drbg_test );
 REQUIRE_OBJECT ( hash_df_test );
 REQUIRE_OBJECT ( bigint_test );
@@ -727,6 +727,28 @@ x509_test_parse_next ( struct x509_certificate *cert,
 	ok ( x509_parse ( &temp, (cert)->data, (cert)->len ) == 0 );	\
 	} while ( 0 )
 
+/**
+ * Report certificate indexing test result
+ *
+ * @v cert		Test certificate
+ */
+#define x509_index_ok( cert ) do {					\
+	struct x509_certificate parsed;					\
+	struct x509_certificate indexed;				\
+	ok ( x509_parse ( &parsed, (cert)->data, (cert)->len ) == 0 );	\
+	ok ( x509_index ( &indexed, (cert)->data, (cert)->len ) == 0 );	\
+	ok ( asn1_compare ( &indexed.raw, &parsed.raw ) == 0 );		\
+	ok ( asn1_compare ( &indexed.tbs, &parsed.tbs ) == 0 );		\
+	ok ( asn1_compare ( &indexed.serial.raw,			\
+			    &parsed.serial.raw ) == 0 );		\
+	ok ( asn1_compare ( &indexed.issuer.raw,			\
+			    &parsed.issuer.raw ) == 0 );		\
+	ok ( asn1_compare ( &indexed.subject.raw,			\
+			    &parsed.subject.raw ) == 0 );		\
+	ok ( indexed.serial.raw.len > 0 );				\
+	ok ( indexed.subject.raw.len > 0 );				\
+	} while ( 0 )
+
 /**
  * Report certificate fingerprint test result
  *
@@ -866,6 +888,11 @@ static void x509_test_exec ( void ) {
 	x509_fingerprint_ok ( &not_ca_crt );
 	x509_fingerprint_ok ( &bad_path_len_crt );
 
+	/* Check certificate indexing */
+	x509_index_ok ( &root_crt );
+	x509_index_ok ( &leaf_crt );
+	x509_index_ok ( &server_crt );
+
 	/* Check pairwise issuing */
 	x509_validate_issuer_ok ( &intermediate_crt, &root_crt );
 	x509_validate_issuer_ok ( &leaf_crt, &intermediate_crt );
@@ -908,6 +935,22 @@ static void x509_test_exec ( void ) {
 	x509_validate_chain_ok ( &useless_chain, test_expired, &test_root );
 	x509_validate_chain_fail_ok ( &useless_chain, test_ca_expired,
 				      &test_root );
+
+	/* Check that repeated validations (using cached signature
+	 * verifications) give identical results.
+	 */
+	x509_validate_chain_ok ( &server_chain, test_time, &test_root );
+	x509_validate_chain_fail_ok ( &server_chain, test_time, &dummy_root );
+	x509_validate_chain_fail_ok ( &server_chain, test_expired, &test_root );
+	x509_validate_chain_ok ( &useless_chain, test_time, &test_root );
+	x509_validate_chain_fail_ok ( &useless_chain, test_ca_expired,
+				      &test_root );
+	x509_validate_chain_fail_ok ( &broken_server_chain, test_time,
+				      &test_root );
+	x509_validate_chain_fail_ok ( &incomplete_server_chain, test_time,
+				      &test_root );
+	x509_validate_chain_fail_ok ( &bad_path_len_chain, test_time,
+				      &test_root );
 }
 
 /** X.509 self-test */
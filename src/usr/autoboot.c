@@ -29,11 +29,14 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/uri.h>
 #include <ipxe/open.h>
 #include <ipxe/init.h>
+#include <ipxe/device.h>
+#include <ipxe/timeline.h>
 #include <usr/ifmgmt.h>
 #include <usr/route.h>
 #include <usr/dhcpmgmt.h>
 #include <usr/imgmgmt.h>
 #include <usr/autoboot.h>
+#include <config/general.h>
 
 /** @file
  *
@@ -53,12 +56,48 @@ __weak int pxe_menu_boot ( struct net_device *netdev __unused ) {
 	return -ENOTSUP;
 }
 
+/** Autoboot device description */
+static struct device_description autoboot_desc;
+
+/**
+ * Set autoboot device bus location
+ *
+ * @v bus_type		Bus type
+ * @v location		Location
+ */
+void set_autoboot_busloc ( unsigned int bus_type, unsigned int location ) {
+
+	/* Record autoboot device description */
+	memset ( &autoboot_desc, 0, sizeof ( autoboot_desc ) );
+	autoboot_desc.bus_type = bus_type;
+	autoboot_desc.location = location;
+
+	/* Probe the autoboot device before all others, if applicable */
+	if ( AUTOBOOT_LAZY_PROBE )
+		probe_device_first ( &autoboot_desc );
+}
+
 /**
  * Identify the boot network device
  *
  * @ret netdev		Boot network device
  */
 static struct net_device * find_boot_netdev ( void ) {
+	struct net_device *netdev;
+	struct device_description *desc;
+
+	/* Do nothing unless an autoboot device has been specified */
+	if ( ! autoboot_desc.bus_type )
+		return NULL;
+
+	/* Identify matching network device, if any */
+	for_each_netdev ( netdev ) {
+		desc = &netdev->dev->desc;
+		if ( ( desc->bus_type == autoboot_desc.bus_type ) &&
+		     ( desc->location == autoboot_desc.location ) )
+			return netdev;
+	}
+
 	return NULL;
 }
 
@@ -118,7 +157,8 @@ struct setting skip_san_boot_setting __setting ( SETTING_SANBOOT_EXTRA ) = {
  * Boot from filename and root-path URIs
  *
  * @v filename		Filename
- * @v root_path		Root path
+ * @v root_paths	Root path(s)
+ * @v root_path_count	Number of root paths
  * @v drive		SAN drive (if applicable)
  * @v flags		Boot action flags
  * @ret rc		Return status code
@@ -128,15 +168,22 @@ struct setting skip_san_boot_setting __setting ( SETTING_SANBOOT_EXTRA ) = {
  * function to a SAN boot via a DHCP-specified root path, and to
  * provide backwards compatibility for the "keep-san" and
  * "skip-san-boot" options.
+ *
+ * Multiple root paths are treated as alternative paths to the same
+ * SAN device.
  */
-int uriboot ( struct uri *filename, struct uri *root_path, int drive,
-	      unsigned int flags ) {
+int uriboot ( struct uri *filename, struct uri **root_paths,
+	      unsigned int root_path_count, int drive, unsigned int flags ) {
 	struct image *image;
+	unsigned int san_flags;
 	int rc;
 
 	/* Hook SAN device, if applicable */
-	if ( root_path ) {
-		if ( ( rc = san_hook ( root_path, drive ) ) != 0 ) {
+	if ( root_path_count ) {
+		san_flags = ( ( flags & URIBOOT_SAN_RAMDISK ) ?
+			      SAN_RAMDISK : 0 );
+		if ( ( rc = san_hook ( root_paths, root_path_count,
+				       drive, san_flags ) ) != 0 ) {
 			printf ( "Could not open SAN device: %s\n",
 				 strerror ( rc ) );
 			goto err_san_hook;
@@ -314,29 +361,16 @@ static int have_pxe_menu ( void ) {
 }
 
 /**
- * Boot from a network device
+ * Boot from a configured network device
  *
  * @v netdev		Network device
  * @ret rc		Return status code
  */
-int netboot ( struct net_device *netdev ) {
+static int netboot_configured ( struct net_device *netdev ) {
 	struct uri *filename;
 	struct uri *root_path;
 	int rc;
 
-	/* Close all other network devices */
-	close_all_netdevs();
-
-	/* Open device and display device status */
-	if ( ( rc = ifopen ( netdev ) ) != 0 )
-		goto err_ifopen;
-	ifstat ( netdev );
-
-	/* Configure device via DHCP */
-	if ( ( rc = dhcp ( netdev ) ) != 0 )
-		goto err_dhcp;
-	route();
-
 	/* Try PXE menu boot, if applicable */
 	if ( have_pxe_menu() ) {
 		printf ( "Booting from PXE menu\n" );
@@ -346,8 +380,10 @@ int netboot ( struct net_device *netdev ) {
 
 	/* Fetch next server and filename */
 	filename = fetch_next_server_and_filename ( NULL );
-	if ( ! filename )
+	if ( ! filename ) {
+		rc = -ENOMEM;
 		goto err_filename;
+	}
 	if ( ! uri_has_path ( filename ) ) {
 		/* Ignore empty filename */
 		uri_put ( filename );
@@ -356,8 +392,10 @@ int netboot ( struct net_device *netdev ) {
 
 	/* Fetch root path */
 	root_path = fetch_root_path ( NULL );
-	if ( ! root_path )
+	if ( ! root_path ) {
+		rc = -ENOMEM;
 		goto err_root_path;
+	}
 	if ( ! uri_is_absolute ( root_path ) ) {
 		/* Ignore empty root path */
 		uri_put ( root_path );
@@ -383,7 +421,8 @@ int netboot ( struct net_device *netdev ) {
 	}
 
 	/* Boot using next server, filename and root path */
-	if ( ( rc = uriboot ( filename, root_path, san_default_drive(),
+	if ( ( rc = uriboot ( filename, &root_path, ( root_path ? 1 : 0 ),
+			      san_default_drive(),
 			      ( root_path ? 0 : URIBOOT_NO_SAN ) ) ) != 0 )
 		goto err_uriboot;
 
@@ -394,11 +433,67 @@ int netboot ( struct net_device *netdev ) {
 	uri_put ( filename );
  err_filename:
  err_pxe_menu_boot:
+	return rc;
+}
+
+/**
+ * Boot from a network device
+ *
+ * @v netdev		Network device
+ * @ret rc		Return status code
+ */
+int netboot ( struct net_device *netdev ) {
+	int rc;
+
+	/* Close all other network devices */
+	close_all_netdevs();
+	timeline_begin ( "boot", "netboot", netdev, netdev->name );
+
+	/* Open device and display device status */
+	if ( ( rc = ifopen ( netdev ) ) != 0 )
+		goto err_ifopen;
+	ifstat ( netdev );
+
+	/* Configure device via DHCP */
+	if ( ( rc = dhcp ( netdev ) ) != 0 )
+		goto err_dhcp;
+	route();
+
+	/* Boot from device */
+	rc = netboot_configured ( netdev );
+
  err_dhcp:
  err_ifopen:
+	timeline_end ( "boot", "netboot", netdev, NULL );
 	return rc;
 }
 
+/**
+ * Boot from whichever network device is configured first
+ *
+ * @ret netdev		Network device, or NULL
+ * @ret rc		Return status code
+ */
+static int netboot_any ( struct net_device **netdev ) {
+	struct net_device *other;
+	int rc;
+
+	/* Configure any network device via DHCP */
+	if ( ( rc = dhcp_any ( netdev ) ) != 0 )
+		return rc;
+
+	/* Close all other network devices and display device status */
+	for_each_netdev ( other ) {
+		if ( other != *netdev )
+			ifclose ( other );
+	}
+	ifstat ( *netdev );
+	route();
+
+	/* Boot from device */
+	return netboot_configured ( *netdev );
+}
+
 /**
  * Boot the system
  */
@@ -407,11 +502,18 @@ int autoboot ( void ) {
 	struct net_device *netdev;
 	int rc = -ENODEV;
 
-	/* If we have an identifable boot device, try that first */
-	if ( ( boot_netdev = find_boot_netdev() ) )
+	/* If we have an identifable boot device, try that first.
+	 * Otherwise, if applicable, try whichever device is first to
+	 * be configured via DHCP.
+	 */
+	if ( ( boot_netdev = find_boot_netdev() ) ) {
 		rc = netboot ( boot_netdev );
+	} else if ( AUTOBOOT_PARALLEL_DHCP ) {
+		rc = netboot_any ( &boot_netdev );
+	}
 
 	/* If that fails, try booting from any of the other devices */
+	probe_deferred_devices();
 	for_each_netdev ( netdev ) {
 		if ( netdev == boot_netdev )
 			continue;
@@ -19,12 +19,17 @@
 FILE_LICENCE ( GPL2_OR_LATER );
 
 #include <string.h>
+#include <stdlib.h>
 #include <stdio.h>
 #include <errno.h>
 #include <ipxe/netdevice.h>
 #include <ipxe/dhcp.h>
 #include <ipxe/monojob.h>
 #include <ipxe/process.h>
+#include <ipxe/interface.h>
+#include <ipxe/timer.h>
+#include <ipxe/keys.h>
+#include <ipxe/console.h>
 #include <usr/ifmgmt.h>
 #include <usr/dhcpmgmt.h>
 
@@ -68,6 +73,153 @@ int dhcp ( struct net_device *netdev ) {
 	return rc;
 }
 
+/** A concurrent DHCP attempt */
+struct dhcp_attempt {
+	/** Job control interface */
+	struct interface job;
+	/** Network device */
+	struct net_device *netdev;
+	/** DHCP has been started */
+	int started;
+	/** Status code */
+	int rc;
+};
+
+/**
+ * Handle completion of concurrent DHCP attempt
+ *
+ * @v attempt		Concurrent DHCP attempt
+ * @v rc		Reason for completion
+ */
+static void dhcp_attempt_close ( struct dhcp_attempt *attempt, int rc ) {
+	attempt->rc = rc;
+	intf_restart ( &attempt->job, rc );
+}
+
+/** Concurrent DHCP attempt job control interface operations */
+static struct interface_operation dhcp_attempt_op[] = {
+	INTF_OP ( intf_close, struct dhcp_attempt *, dhcp_attempt_close ),
+};
+
+/** Concurrent DHCP attempt job control interface descriptor */
+static struct interface_descriptor dhcp_attempt_desc =
+	INTF_DESC ( struct dhcp_attempt, job, dhcp_attempt_op );
+
+/**
+ * Perform DHCP on all network devices concurrently
+ *
+ * @ret configured	Network device configured via DHCP
+ * @ret rc		Return status code
+ *
+ * DHCP is started on each network device as soon as its link comes
+ * up.  The first network device to be configured successfully is
+ * returned, and DHCP is abandoned on all other network devices.
+ */
+int dhcp_any ( struct net_device **configured ) {
+	struct dhcp_attempt *attempts;
+	struct dhcp_attempt *attempt;
+	struct net_device *netdev;
+	unsigned long start = currticks();
+	unsigned long elapsed;
+	unsigned int count = 0;
+	unsigned int started = 0;
+	unsigned int busy;
+	unsigned int i;
+	int rc;
+
+	/* Allocate attempts */
+	*configured = NULL;
+	for_each_netdev ( netdev )
+		count++;
+	if ( ! count )
+		return -ENODEV;
+	attempts = zalloc ( count * sizeof ( attempts[0] ) );
+	if ( ! attempts )
+		return -ENOMEM;
+
+	/* Open all network devices */
+	i = 0;
+	for_each_netdev ( netdev ) {
+		attempt = &attempts[i++];
+		intf_init ( &attempt->job, &dhcp_attempt_desc, NULL );
+		attempt->netdev = netdev_get ( netdev );
+		attempt->rc = ifopen ( netdev );
+		if ( attempt->rc == 0 )
+			attempt->rc = -EINPROGRESS;
+	}
+
+	/* Start DHCP on each network device as its link comes up, and
+	 * wait for any network device to be configured.
+	 */
+	printf ( "DHCP (" );
+	do {
+		step();
+		elapsed = ( currticks() - start );
+		busy = 0;
+		for ( i = 0 ; i < count ; i++ ) {
+			attempt = &attempts[i];
+			if ( ( attempt->rc == -EINPROGRESS ) &&
+			     ( ! attempt->started ) ) {
+				netdev = attempt->netdev;
+				if ( netdev_link_ok ( netdev ) ) {
+					printf ( "%s%s",
+						 ( started++ ? " " : "" ),
+						 netdev->name );
+					attempt->started = 1;
+					rc = start_dhcp ( &attempt->job,
+							  netdev );
+					if ( rc != 0 )
+						attempt->rc = ( ( rc > 0 ) ?
+								0 : rc );
+				} else if ( elapsed > ( ( LINK_WAIT_MS *
+							  TICKS_PER_SEC ) /
+							1000 ) ) {
+					attempt->rc = netdev->link_rc;
+				}
+			}
+			if ( ( attempt->rc == 0 ) && ! *configured )
+				*configured = attempt->netdev;
+			if ( attempt->rc == -EINPROGRESS )
+				busy++;
+		}
+		if ( iskey() && ( getchar() == CTRL_C ) )
+			break;
+	} while ( busy && ! *configured );
+
+	/* Abandon all other attempts */
+	for ( i = 0 ; i < count ; i++ ) {
+		attempt = &attempts[i];
+		if ( attempt->rc == -EINPROGRESS ) {
+			if ( attempt->started ) {
+				dhcp_attempt_close ( attempt, -ECANCELED );
+			} else {
+				attempt->rc = -ECANCELED;
+			}
+		}
+	}
+
+	/* Report status */
+	if ( *configured ) {
+		rc = 0;
+		printf ( ")... ok (using %s)\n", ( *configured )->name );
+	} else {
+		rc = -ENODEV;
+		for ( i = 0 ; i < count ; i++ ) {
+			attempt = &attempts[i];
+			if ( ( rc == -ENODEV ) || attempt->started )
+				rc = attempt->rc;
+		}
+		printf ( ")... %s\n", strerror ( rc ) );
+	}
+
+	/* Free attempts */
+	for ( i = 0 ; i < count ; i++ )
+		netdev_put ( attempts[i].netdev );
+	free ( attempts );
+
+	return rc;
+}
+
 int pxebs ( struct net_device *netdev, unsigned int pxe_type ) {
 	int rc;
 
@@ -27,6 +27,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/device.h>
 #include <ipxe/process.h>
 #include <ipxe/keys.h>
+#include <ipxe/netstat.h>
 #include <usr/ifmgmt.h>
 
 /** @file
@@ -101,6 +102,33 @@ void ifstat ( struct net_device *netdev ) {
 	}
 	ifstat_errors ( &netdev->tx_stats, "TXE" );
 	ifstat_errors ( &netdev->rx_stats, "RXE" );
+	if ( netdev->rx_budget_exhausted ) {
+		printf ( "  [RX budget exhausted: %u]\n",
+			 netdev->rx_budget_exhausted );
+	}
+}
+
+/**
+ * Print network protocol statistics
+ *
+ */
+void netstat ( void ) {
+	struct net_statistic *stat;
+	struct net_statistic *prev = NULL;
+
+	for_each_table_entry ( stat, NET_STATISTICS ) {
+		if ( prev &&
+		     ( strcmp ( stat->protocol, prev->protocol ) == 0 ) ) {
+			printf ( " " );
+		} else {
+			printf ( "%s%s: [", ( prev ? "]\n" : "" ),
+				 stat->protocol );
+		}
+		printf ( "%s:%d", stat->name, *(stat->counter) );
+		prev = stat;
+	}
+	if ( prev )
+		printf ( "]\n" );
 }
 
 /**
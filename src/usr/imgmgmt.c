@@ -21,13 +21,20 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <errno.h>
+#include <ipxe/keys.h>
+#include <ipxe/console.h>
+#include <ipxe/process.h>
+#include <ipxe/interface.h>
 #include <ipxe/image.h>
 #include <ipxe/downloader.h>
 #include <ipxe/monojob.h>
+#include <ipxe/multijob.h>
 #include <ipxe/open.h>
 #include <ipxe/uri.h>
 #include <usr/imgmgmt.h>
+#include <config/general.h>
 
 /** @file
  *
@@ -35,6 +42,61 @@ FILE_LICENCE ( GPL2_OR_LATER );
  *
  */
 
+/** Reuse images already downloaded from the same URI */
+#ifdef DOWNLOAD_CACHE
+#define IMGDOWNLOAD_CACHE 1
+#else
+#define IMGDOWNLOAD_CACHE 0
+#endif
+
+/**
+ * Find image already downloaded from a URI
+ *
+ * @v uri		URI
+ * @ret image		Registered image, or NULL
+ *
+ * Any image which remains registered (including images fetched by a
+ * script which has since been replaced via "chain") may be reused
+ * rather than downloaded again.  Images prefetched by a script are
+ * reused (once) even if caching is not enabled.
+ *
+ * Only absolute URIs are matched, since a relative URI may refer to
+ * a different resource when used from a different script.
+ */
+static struct image * imgdownload_cached ( struct uri *uri ) {
+	size_t len = ( unparse_uri ( NULL, 0, uri, URI_ALL ) + 1 );
+	char uri_string[len];
+	char image_uri_string[len];
+	struct image *image;
+	size_t image_len;
+
+	/* Do nothing for relative URIs */
+	if ( ! uri_is_absolute ( uri ) )
+		return NULL;
+
+	/* Look for a registered image with an identical URI */
+	unparse_uri ( uri_string, len, uri, URI_ALL );
+	for_each_image ( image ) {
+		if ( ! image->uri )
+			continue;
+		if ( ! ( IMGDOWNLOAD_CACHE ||
+			 ( image->flags & IMAGE_PREFETCHED ) ) )
+			continue;
+		image_len = ( unparse_uri ( NULL, 0, image->uri, URI_ALL ) + 1 );
+		if ( image_len != len )
+			continue;
+		unparse_uri ( image_uri_string, len, image->uri, URI_ALL );
+		if ( strcmp ( image_uri_string, uri_string ) == 0 ) {
+			DBGC ( image, "IMAGE %s reused for %s\n",
+			       image->name, uri_string );
+			image->flags &= ~IMAGE_PREFETCHED;
+			return image;
+		}
+	}
+
+	return NULL;
+}
+
 /**
  * Download a new image
  *
@@ -48,13 +110,6 @@ int imgdownload ( struct uri *uri, struct image **image ) {
 	const char *password;
 	int rc;
 
-	/* Allocate image */
-	*image = alloc_image ( uri );
-	if ( ! *image ) {
-		rc = -ENOMEM;
-		goto err_alloc_image;
-	}
-
 	/* Redact password portion of URI, if necessary */
 	password = uri->password;
 	if ( password )
@@ -63,6 +118,19 @@ int imgdownload ( struct uri *uri, struct image **image ) {
 		      uri, URI_ALL );
 	uri->password = password;
 
+	/* Reuse any image already downloaded from this URI */
+	if ( ( *image = imgdownload_cached ( uri ) ) != NULL ) {
+		printf ( "%s... cached\n", uri_string_redacted );
+		return 0;
+	}
+
+	/* Allocate image */
+	*image = alloc_image ( uri );
+	if ( ! *image ) {
+		rc = -ENOMEM;
+		goto err_alloc_image;
+	}
+
 	/* Create downloader */
 	if ( ( rc = create_downloader ( &monojob, *image, LOCATION_URI,
 					uri ) ) != 0 ) {
@@ -95,6 +163,28 @@ int imgdownload ( struct uri *uri, struct image **image ) {
 	return rc;
 }
 
+/**
+ * Parse image URI
+ *
+ * @v uri_string	URI string
+ * @ret uri		Resolved URI, or NULL
+ *
+ * The URI is resolved against the current working URI immediately,
+ * so that the image records the resource from which it was actually
+ * downloaded.
+ */
+static struct uri * imgdownload_parse ( const char *uri_string ) {
+	struct uri *uri;
+	struct uri *resolved;
+
+	uri = parse_uri ( uri_string );
+	if ( ! uri )
+		return NULL;
+	resolved = resolve_uri ( cwuri, uri );
+	uri_put ( uri );
+	return resolved;
+}
+
 /**
  * Download a new image
  *
@@ -106,7 +196,7 @@ int imgdownload_string ( const char *uri_string, struct image **image ) {
 	struct uri *uri;
 	int rc;
 
-	if ( ! ( uri = parse_uri ( uri_string ) ) )
+	if ( ! ( uri = imgdownload_parse ( uri_string ) ) )
 		return -ENOMEM;
 
 	rc = imgdownload ( uri, image );
@@ -115,6 +205,237 @@ int imgdownload_string ( const char *uri_string, struct image **image ) {
 	return rc;
 }
 
+/** A concurrent image download */
+struct imgdownload_job {
+	/** Job control interface */
+	struct interface job;
+	/** Image */
+	struct image *image;
+	/** Download status */
+	int rc;
+};
+
+/**
+ * Handle completion of concurrent image download
+ *
+ * @v dl		Concurrent image download
+ * @v rc		Reason for completion
+ */
+static void imgdownload_job_close ( struct imgdownload_job *dl, int rc ) {
+	dl->rc = rc;
+	intf_restart ( &dl->job, rc );
+}
+
+/** Concurrent image download job control interface operations */
+static struct interface_operation imgdownload_job_op[] = {
+	INTF_OP ( intf_close, struct imgdownload_job *, imgdownload_job_close ),
+};
+
+/** Concurrent image download job control interface descriptor */
+static struct interface_descriptor imgdownload_job_desc =
+	INTF_DESC ( struct imgdownload_job, job, imgdownload_job_op );
+
+/**
+ * Download several new images concurrently
+ *
+ * @v uri_strings	URI strings
+ * @v count		Number of URI strings
+ * @v flags		Flags to set on downloaded images
+ * @ret rc		Return status code
+ *
+ * All downloads are started before waiting for any to complete, so
+ * that requests to the same server may share a connection.  Images
+ * which are downloaded successfully are registered in the order
+ * specified, even if any other download fails.
+ */
+int imgdownload_multi ( char **uri_strings, unsigned int count,
+			unsigned int flags ) {
+	struct imgdownload_job *dls;
+	struct imgdownload_job *dl;
+	struct uri *uri;
+	unsigned int busy;
+	unsigned int i;
+	int rc = 0;
+
+	/* Allocate downloads */
+	dls = zalloc ( count * sizeof ( dls[0] ) );
+	if ( ! dls )
+		return -ENOMEM;
+
+	/* Start all downloads */
+	for ( i = 0 ; i < count ; i++ ) {
+		dl = &dls[i];
+		intf_init ( &dl->job, &imgdownload_job_desc, NULL );
+		dl->rc = -EINPROGRESS;
+		uri = imgdownload_parse ( uri_strings[i] );
+		if ( ! uri ) {
+			dl->rc = -ENOMEM;
+			continue;
+		}
+		if ( ( dl->image = imgdownload_cached ( uri ) ) != NULL ) {
+			image_get ( dl->image );
+			dl->rc = 0;
+		} else if ( ! ( dl->image = alloc_image ( uri ) ) ) {
+			dl->rc = -ENOMEM;
+		} else if ( ( rc = create_downloader ( &dl->job, dl->image,
+						       LOCATION_URI,
+						       uri ) ) != 0 ) {
+			dl->rc = rc;
+		}
+		uri_put ( uri );
+	}
+
+	/* Wait for all downloads to complete */
+	printf ( "Downloading %d images...", count );
+	do {
+		step();
+		if ( iskey() && ( getchar() == CTRL_C ) ) {
+			for ( i = 0 ; i < count ; i++ ) {
+				dl = &dls[i];
+				if ( dl->rc == -EINPROGRESS ) {
+					imgdownload_job_close ( dl,
+								-ECANCELED );
+				}
+			}
+		}
+		busy = 0;
+		for ( i = 0 ; i < count ; i++ ) {
+			if ( dls[i].rc == -EINPROGRESS )
+				busy++;
+		}
+	} while ( busy );
+	printf ( "\n" );
+
+	/* Report status and register images */
+	rc = 0;
+	for ( i = 0 ; i < count ; i++ ) {
+		dl = &dls[i];
+		if ( ( dl->rc == 0 ) &&
+		     ( ! ( dl->image->flags & IMAGE_REGISTERED ) ) &&
+		     ( ( dl->rc = register_image ( dl->image ) ) != 0 ) ) {
+			printf ( "Could not register image: %s\n",
+				 strerror ( dl->rc ) );
+		}
+		if ( dl->rc == 0 )
+			dl->image->flags |= flags;
+		printf ( "%s... %s\n",
+			 ( dl->image ? dl->image->name : uri_strings[i] ),
+			 ( dl->rc ? strerror ( dl->rc ) : "ok" ) );
+		if ( dl->rc && ! rc )
+			rc = dl->rc;
+		image_put ( dl->image );
+	}
+
+	free ( dls );
+	return rc;
+}
+
+/**
+ * Handle completion of background image download
+ *
+ * @v mj		Background job
+ * @v rc		Reason for completion
+ * @ret rc		Final status code
+ */
+static int imgdownload_async_complete ( struct multijob *mj, int rc ) {
+	struct image **image = mj->priv;
+
+	/* Register image */
+	if ( ( rc == 0 ) && ( ( rc = register_image ( *image ) ) != 0 ) )
+		printf ( "Could not register image: %s\n", strerror ( rc ) );
+
+	/* Drop local reference to image */
+	image_put ( *image );
+	*image = NULL;
+
+	return rc;
+}
+
+/**
+ * Download a new image in the background
+ *
+ * @v uri_string	URI string
+ * @v name		Image name, or NULL
+ * @v cmdline		Image command line, or NULL
+ * @ret rc		Return status code
+ *
+ * The image will be registered only when the download completes
+ * successfully.  Use multijob_wait() to wait for completion.
+ */
+int imgdownload_async ( const char *uri_string, const char *name,
+			const char *cmdline ) {
+	struct multijob *mj;
+	struct image *image;
+	struct uri *uri;
+	int rc;
+
+	/* Parse URI */
+	uri = imgdownload_parse ( uri_string );
+	if ( ! uri ) {
+		rc = -ENOMEM;
+		goto err_parse;
+	}
+
+	/* Reuse any image already downloaded from this URI */
+	if ( ( image = imgdownload_cached ( uri ) ) != NULL ) {
+		printf ( "%s... cached\n", image->name );
+		image_get ( image );
+	} else if ( ( image = alloc_image ( uri ) ) == NULL ) {
+		rc = -ENOMEM;
+		goto err_alloc_image;
+	}
+
+	/* Set the image name and command line, if applicable */
+	if ( name && ( ( rc = image_set_name ( image, name ) ) != 0 ) ) {
+		printf ( "Could not name image: %s\n", strerror ( rc ) );
+		goto err_set_name;
+	}
+	if ( cmdline &&
+	     ( ( rc = image_set_cmdline ( image, cmdline ) ) != 0 ) ) {
+		printf ( "Could not set arguments: %s\n", strerror ( rc ) );
+		goto err_set_cmdline;
+	}
+
+	/* Nothing more to do if image was cached */
+	if ( image->flags & IMAGE_REGISTERED ) {
+		rc = 0;
+		goto done;
+	}
+
+	/* Allocate background job */
+	mj = multijob_alloc ( image->name, sizeof ( image ) );
+	if ( ! mj ) {
+		rc = -ENOMEM;
+		goto err_alloc_job;
+	}
+	*( ( struct image ** ) mj->priv ) = image;
+	mj->complete = imgdownload_async_complete;
+
+	/* Create downloader */
+	if ( ( rc = create_downloader ( &mj->job, image, LOCATION_URI,
+					uri ) ) != 0 ) {
+		printf ( "Could not start download: %s\n", strerror ( rc ) );
+		goto err_create_downloader;
+	}
+
+	/* Start background job, handing over image reference */
+	multijob_start ( mj );
+	uri_put ( uri );
+	return 0;
+
+ err_create_downloader:
+	multijob_put ( mj );
+ err_alloc_job:
+ done:
+ err_set_cmdline:
+ err_set_name:
+	image_put ( image );
+ err_alloc_image:
+	uri_put ( uri );
+ err_parse:
+	return rc;
+}
+
 /**
  * Acquire an image
  *
@@ -25,6 +25,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/uaccess.h>
 #include <ipxe/image.h>
 #include <ipxe/cms.h>
+#include <ipxe/timeline.h>
 #include <usr/imgtrust.h>
 
 /** @file
@@ -46,11 +47,14 @@ int imgverify ( struct image *image, struct image *signature,
 	size_t len;
 	void *data;
 	struct cms_signature sig;
+	struct digest_algorithm *digest = NULL;
+	const void *digest_out = NULL;
 	time_t now;
 	int rc;
 
 	/* Mark image as untrusted */
 	image_untrust ( image );
+	timeline_begin ( "image", "verify", image, image->name );
 
 	/* Copy signature to internal memory */
 	len = signature->len;
@@ -65,10 +69,17 @@ int imgverify ( struct image *image, struct image *signature,
 	if ( ( rc = cms_parse ( &sig, data, len ) ) != 0 )
 		goto err_parse;
 
-	/* Use signature to verify image */
+	/* Use signature to verify image, using any digest calculated
+	 * while the image was being downloaded.
+	 */
 	now = time ( NULL );
-	if ( ( rc = cms_verify ( &sig, image->data, image->len,
-				 name, now, NULL ) ) != 0 )
+	if ( image->digest ) {
+		digest = image->digest->digest;
+		digest_out = image->digest->out;
+	}
+	if ( ( rc = cms_verify_digested ( &sig, image->data, image->len,
+					  digest, digest_out, name, now,
+					  NULL ) ) != 0 )
 		goto err_verify;
 
 	/* Mark image as trusted */
@@ -78,12 +89,14 @@ int imgverify ( struct image *image, struct image *signature,
 	/* Free internal copy of signature */
 	free ( data );
 
+	timeline_end ( "image", "verify", image, NULL );
 	return 0;
 
  err_verify:
  err_parse:
 	free ( data );
  err_alloc:
+	timeline_end ( "image", "verify", image, "failed" );
 	syslog ( LOG_ERR, "Image \"%s\" signature bad: %s\n",
 		 image->name, strerror ( rc ) );
 	return rc;
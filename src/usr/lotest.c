@@ -29,6 +29,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <ipxe/if_ether.h>
 #include <ipxe/keys.h>
 #include <ipxe/console.h>
+#include <ipxe/timer.h>
 #include <usr/ifmgmt.h>
 #include <usr/lotest.h>
 
@@ -84,84 +85,219 @@ static struct net_protocol lotest_protocol __net_protocol = {
 	.net_addr_len = 0,
 };
 
+/** Loopback test packet header */
+struct lotest_header {
+	/** Sequence number */
+	uint32_t seq;
+	/** Transmission time (in ticks) */
+	uint32_t sent;
+} __attribute__ (( packed ));
+
+/** Time to wait for an outstanding packet before declaring it lost */
+#define LOTEST_TIMEOUT ( TICKS_PER_SEC )
+
+/** Interval between progress updates */
+#define LOTEST_PROGRESS ( TICKS_PER_SEC / 4 )
+
+/** Number of round-trip time histogram buckets (in ticks) */
+#define LOTEST_RTT_BUCKETS 64
+
+/** Loopback test statistics */
+struct lotest_stats {
+	/** Number of packets transmitted */
+	unsigned int sent;
+	/** Number of packets received */
+	unsigned int received;
+	/** Number of packets lost */
+	unsigned int lost;
+	/** Number of spurious, late, or duplicate packets */
+	unsigned int spurious;
+	/** Number of bytes received (excluding link-layer headers) */
+	uint64_t bytes;
+	/** Round-trip time histogram */
+	unsigned int rtt[LOTEST_RTT_BUCKETS];
+};
+
+/**
+ * Fill packet body with test data
+ *
+ * @v data		Packet body
+ * @v len		Length of packet body
+ * @v seq		Sequence number
+ *
+ * The test data is a pseudo-random function of the sequence number,
+ * so that the content of each received packet can be checked without
+ * retaining a copy of every packet still in flight.
+ */
+static void lotest_fill ( uint8_t *data, size_t len, uint32_t seq ) {
+	uint32_t state = ( ( seq * 2654435761UL ) ^ 0x5a5a5a5aUL );
+	size_t i;
+
+	for ( i = 0 ; i < len ; i++ ) {
+		state = ( ( state * 1103515245UL ) + 12345 );
+		data[i] = ( state >> 16 );
+	}
+}
+
 /**
- * Wait for packet to be received
+ * Transmit loopback test packet
  *
- * @v receiver		Receiving network device*
- * @v data		Expected data
- * @v len		Expected data length
+ * @v sender		Sending network device
+ * @v receiver		Receiving network device
+ * @v mtu		Packet size (excluding link-layer headers)
+ * @v seq		Sequence number
  * @ret rc		Return status code
  */
-static int loopback_wait ( struct net_device *receiver, void *data,
-			   size_t len ) {
-	struct ll_protocol *ll_protocol = receiver->ll_protocol;
+static int lotest_tx ( struct net_device *sender, struct net_device *receiver,
+		       size_t mtu, uint32_t seq ) {
 	struct io_buffer *iobuf;
+	struct lotest_header *hdr;
+
+	/* Construct packet */
+	iobuf = alloc_iob ( MAX_LL_HEADER_LEN + mtu );
+	if ( ! iobuf )
+		return -ENOMEM;
+	iob_reserve ( iobuf, MAX_LL_HEADER_LEN );
+	hdr = iob_put ( iobuf, sizeof ( *hdr ) );
+	hdr->seq = htonl ( seq );
+	hdr->sent = htonl ( currticks() );
+	lotest_fill ( iob_put ( iobuf, ( mtu - sizeof ( *hdr ) ) ),
+		      ( mtu - sizeof ( *hdr ) ), seq );
+
+	/* Transmit packet */
+	return net_tx ( iob_disown ( iobuf ), sender, &lotest_protocol,
+			receiver->ll_addr, sender->ll_addr );
+}
+
+/**
+ * Check received loopback test packet
+ *
+ * @v receiver		Receiving network device
+ * @v iobuf		I/O buffer
+ * @v mtu		Expected packet size (excluding link-layer headers)
+ * @v buf		Scratch buffer (of length @c mtu)
+ * @ret seq		Sequence number
+ * @ret sent		Transmission time (in ticks)
+ * @ret rc		Return status code
+ *
+ * Returns -ENOTTY for a packet that is not a loopback test packet.
+ */
+static int lotest_check ( struct net_device *receiver,
+			  struct io_buffer *iobuf, size_t mtu,
+			  uint8_t *buf, uint32_t *seq, uint32_t *sent ) {
+	struct ll_protocol *ll_protocol = receiver->ll_protocol;
+	struct lotest_header *hdr;
 	const void *ll_dest;
 	const void *ll_source;
 	uint16_t net_proto;
 	unsigned int flags;
 	int rc;
 
-	/* Poll until packet arrives */
-	while ( 1 ) {
+	/* Strip link-layer header */
+	if ( ( rc = ll_protocol->pull ( receiver, iobuf, &ll_dest,
+					&ll_source, &net_proto,
+					&flags ) ) != 0 ) {
+		printf ( "\nFailed to strip link-layer header: %s",
+			 strerror ( rc ) );
+		return rc;
+	}
 
-		/* Check for cancellation */
-		if ( iskey() && ( getchar() == CTRL_C ) )
-			return -ECANCELED;
+	/* Ignore non-loopback packets */
+	if ( net_proto != lotest_protocol.net_proto ) {
+		printf ( "\nReceived spurious packet type %04x\n",
+			 ntohs ( net_proto ) );
+		return -ENOTTY;
+	}
 
-		/* Poll network devices */
-		net_poll();
+	/* Check packet length */
+	if ( iob_len ( iobuf ) != mtu ) {
+		printf ( "\nLength mismatch: sent %zd, received %zd",
+			 mtu, iob_len ( iobuf ) );
+		DBG ( "\nReceived:\n" );
+		DBG_HDA ( 0, iobuf->data, iob_len ( iobuf ) );
+		return -EINVAL;
+	}
 
-		/* Dequeue packet, if available */
-		iobuf = netdev_rx_dequeue ( receiver );
-		if ( ! iobuf )
-			continue;
-
-		/* Strip link-layer header */
-		if ( ( rc = ll_protocol->pull ( receiver, iobuf, &ll_dest,
-						&ll_source, &net_proto,
-						&flags ) ) != 0 ) {
-			printf ( "\nFailed to strip link-layer header: %s",
-				 strerror ( rc ) );
-			free_iob ( iob_disown ( iobuf ) );
-			return rc;
-		}
+	/* Check packet content */
+	hdr = iobuf->data;
+	*seq = ntohl ( hdr->seq );
+	*sent = ntohl ( hdr->sent );
+	lotest_fill ( buf, ( mtu - sizeof ( *hdr ) ), *seq );
+	if ( memcmp ( ( iobuf->data + sizeof ( *hdr ) ), buf,
+		      ( mtu - sizeof ( *hdr ) ) ) != 0 ) {
+		printf ( "\nContent mismatch in packet %d", *seq );
+		DBG ( "\nExpected:\n" );
+		DBG_HDA ( 0, buf, ( mtu - sizeof ( *hdr ) ) );
+		DBG ( "Received:\n" );
+		DBG_HDA ( 0, iobuf->data, iob_len ( iobuf ) );
+		return -EINVAL;
+	}
 
-		/* Ignore non-loopback packets */
-		if ( net_proto != lotest_protocol.net_proto ) {
-			printf ( "\nReceived spurious packet type %04x\n",
-				 ntohs ( net_proto ) );
-			free_iob ( iob_disown ( iobuf ) );
-			continue;
-		}
+	return 0;
+}
 
-		/* Check packet length */
-		if ( iob_len ( iobuf ) != len ) {
-			printf ( "\nLength mismatch: sent %zd, received %zd",
-				 len, iob_len ( iobuf ) );
-			DBG ( "\nSent:\n" );
-			DBG_HDA ( 0, data, len );
-			DBG ( "Received:\n" );
-			DBG_HDA ( 0, iobuf->data, iob_len ( iobuf ) );
-			free_iob ( iob_disown ( iobuf ) );
-			return -EINVAL;
-		}
+/**
+ * Convert ticks to microseconds
+ *
+ * @v ticks		Time in ticks
+ * @ret us		Time in microseconds
+ */
+static unsigned long lotest_us ( unsigned long ticks ) {
+	return ( ( ( uint64_t ) ticks * 1000000 ) / TICKS_PER_SEC );
+}
 
-		/* Check packet content */
-		if ( memcmp ( iobuf->data, data, len ) != 0 ) {
-			printf ( "\nContent mismatch" );
-			DBG ( "\nSent:\n" );
-			DBG_HDA ( 0, data, len );
-			DBG ( "Received:\n" );
-			DBG_HDA ( 0, iobuf->data, iob_len ( iobuf ) );
-			free_iob ( iob_disown ( iobuf ) );
-			return -EINVAL;
-		}
+/**
+ * Find round-trip time percentile
+ *
+ * @v stats		Loopback test statistics
+ * @v percent		Percentile
+ * @ret ticks		Round-trip time (in ticks)
+ */
+static unsigned int lotest_percentile ( struct lotest_stats *stats,
+					unsigned int percent ) {
+	unsigned int threshold;
+	unsigned int total = 0;
+	unsigned int i;
 
-		/* Discard packet and return */
-		free_iob ( iob_disown ( iobuf ) );
-		return 0;
+	threshold = ( ( ( uint64_t ) stats->received * percent + 99 ) / 100 );
+	for ( i = 0 ; i < ( LOTEST_RTT_BUCKETS - 1 ) ; i++ ) {
+		total += stats->rtt[i];
+		if ( total >= threshold )
+			break;
 	}
+	return i;
+}
+
+/**
+ * Report loopback test results
+ *
+ * @v stats		Loopback test statistics
+ * @v elapsed		Elapsed time (in ticks)
+ */
+static void lotest_report ( struct lotest_stats *stats,
+			    unsigned long elapsed ) {
+	unsigned long us = lotest_us ( elapsed );
+
+	printf ( "Sent %d, received %d, lost %d (%d.%d%%), spurious %d\n",
+		 stats->sent, stats->received, stats->lost,
+		 ( stats->sent ? ( ( stats->lost * 100 ) / stats->sent ) : 0 ),
+		 ( stats->sent ?
+		   ( ( ( stats->lost * 1000 ) / stats->sent ) % 10 ) : 0 ),
+		 stats->spurious );
+	if ( ! ( us && stats->received ) )
+		return;
+	printf ( "%lld packets/s, %lld Mbps over %ld.%03lds\n",
+		 ( ( stats->received * 1000000ULL ) / us ),
+		 ( ( stats->bytes * 8 ) / us ), ( us / 1000000 ),
+		 ( ( us / 1000 ) % 1000 ) );
+	printf ( "RTT p50 %ldus, p90 %ldus, p99 %ldus, max %s%ldus "
+		 "(resolution %ldus)\n",
+		 lotest_us ( lotest_percentile ( stats, 50 ) ),
+		 lotest_us ( lotest_percentile ( stats, 90 ) ),
+		 lotest_us ( lotest_percentile ( stats, 99 ) ),
+		 ( stats->rtt[ LOTEST_RTT_BUCKETS - 1 ] ? ">=" : "" ),
+		 lotest_us ( lotest_percentile ( stats, 100 ) ),
+		 lotest_us ( 1 ) );
 }
 
 /**
@@ -170,16 +306,38 @@ static int loopback_wait ( struct net_device *receiver, void *data,
  * @v sender		Sending network device
  * @v receiver		Received network device
  * @v mtu		Packet size (excluding link-layer headers)
+ * @v window		Maximum number of packets in flight
+ * @v count		Number of packets to send, or zero to run until
+ *			interrupted
  * @ret rc		Return status code
+ *
+ * Packets are streamed from the sender to the receiver, with up to
+ * @c window packets in flight at any time.  Packets that do not
+ * arrive within @c LOTEST_TIMEOUT are counted as lost.  The test
+ * stops on the first corrupted packet.
  */
 int loopback_test ( struct net_device *sender, struct net_device *receiver,
-		    size_t mtu ) {
+		    size_t mtu, unsigned int window, unsigned int count ) {
 	uint8_t buf[mtu];
+	struct lotest_stats stats;
 	struct io_buffer *iobuf;
-	unsigned int i;
-	unsigned int successes;
+	unsigned long start;
+	unsigned long last_rx;
+	unsigned long last_progress;
+	unsigned long now;
+	unsigned long rtt;
+	uint32_t tx_seq = 0;
+	uint32_t rx_seq = 0;
+	uint32_t seq = 0;
+	uint32_t sent = 0;
 	int rc;
 
+	/* Sanity checks */
+	if ( mtu < sizeof ( struct lotest_header ) )
+		return -EINVAL;
+	if ( ! window )
+		window = 1;
+
 	/* Open network devices */
 	if ( ( rc = ifopen ( sender ) ) != 0 )
 		return rc;
@@ -193,8 +351,9 @@ int loopback_test ( struct net_device *sender, struct net_device *receiver,
 		return rc;
 
 	/* Print initial statistics */
-	printf ( "Performing loopback test from %s to %s with %zd byte MTU\n",
-		 sender->name, receiver->name, mtu );
+	printf ( "Performing loopback test from %s to %s with %zd byte MTU "
+		 "and %d packets in flight\n",
+		 sender->name, receiver->name, mtu, window );
 	ifstat ( sender );
 	ifstat ( receiver );
 
@@ -204,46 +363,88 @@ int loopback_test ( struct net_device *sender, struct net_device *receiver,
 	netdev_rx_freeze ( receiver );
 
 	/* Perform loopback test */
-	for ( successes = 0 ; ; successes++ ) {
+	memset ( &stats, 0, sizeof ( stats ) );
+	start = last_rx = last_progress = currticks();
+	while ( ( ! count ) || ( tx_seq < count ) || ( rx_seq < tx_seq ) ) {
 
-		/* Print running total */
-		printf ( "\r%d", successes );
-
-		/* Generate random packet */
-		for ( i = 0 ; i < sizeof ( buf ) ; i++ )
-			buf[i] = random();
-		iobuf = alloc_iob ( MAX_LL_HEADER_LEN + sizeof ( buf ) );
-		if ( ! iobuf ) {
-			printf ( "\nFailed to allocate I/O buffer" );
-			rc = -ENOMEM;
+		/* Check for cancellation */
+		if ( iskey() && ( getchar() == CTRL_C ) )
 			break;
+
+		/* Fill transmit window */
+		while ( ( ( tx_seq - rx_seq ) < window ) &&
+			( ( ! count ) || ( tx_seq < count ) ) ) {
+			rc = lotest_tx ( sender, receiver, mtu, tx_seq );
+			if ( rc == -ENOBUFS )
+				break;
+			if ( rc != 0 ) {
+				printf ( "\nFailed to transmit packet: %s",
+					 strerror ( rc ) );
+				goto done;
+			}
+			tx_seq++;
+			stats.sent++;
 		}
-		iob_reserve ( iobuf, MAX_LL_HEADER_LEN );
-		memcpy ( iob_put ( iobuf, sizeof ( buf ) ),
-			 buf, sizeof ( buf ) );
-
-		/* Transmit packet */
-		if ( ( rc = net_tx ( iob_disown ( iobuf ), sender,
-				     &lotest_protocol, receiver->ll_addr,
-				     sender->ll_addr ) ) != 0 ) {
-			printf ( "\nFailed to transmit packet: %s",
-				 strerror ( rc ) );
-			break;
+
+		/* Poll network devices */
+		net_poll();
+		now = currticks();
+
+		/* Process received packets */
+		while ( ( iobuf = netdev_rx_dequeue ( receiver ) ) != NULL ) {
+			rc = lotest_check ( receiver, iobuf, mtu, buf,
+					    &seq, &sent );
+			free_iob ( iobuf );
+			if ( rc == -ENOTTY )
+				continue;
+			if ( rc != 0 )
+				goto done;
+
+			/* Ignore late and duplicate packets */
+			if ( ( seq < rx_seq ) || ( seq >= tx_seq ) ) {
+				stats.spurious++;
+				continue;
+			}
+
+			/* Count any skipped packets as lost */
+			stats.lost += ( seq - rx_seq );
+			rx_seq = ( seq + 1 );
+			stats.received++;
+			stats.bytes += mtu;
+			rtt = ( ( uint32_t ) now - sent );
+			if ( rtt >= LOTEST_RTT_BUCKETS )
+				rtt = ( LOTEST_RTT_BUCKETS - 1 );
+			stats.rtt[rtt]++;
+			last_rx = now;
 		}
 
-		/* Wait for received packet */
-		if ( ( rc = loopback_wait ( receiver, buf,
-					    sizeof ( buf ) ) ) != 0 ) {
-			break;
+		/* Declare all outstanding packets lost on timeout */
+		if ( rx_seq == tx_seq ) {
+			last_rx = now;
+		} else if ( ( now - last_rx ) >= LOTEST_TIMEOUT ) {
+			stats.lost += ( tx_seq - rx_seq );
+			rx_seq = tx_seq;
+			last_rx = now;
+		}
+
+		/* Print running total */
+		if ( ( now - last_progress ) >= LOTEST_PROGRESS ) {
+			printf ( "\r%d", stats.received );
+			last_progress = now;
 		}
 	}
+	rc = 0;
 
-	printf ( "\n");
+ done:
+	printf ( "\r%d\n", stats.received );
 	netdev_rx_unfreeze ( receiver );
 
+	/* Report results */
+	lotest_report ( &stats, ( currticks() - start ) );
+
 	/* Dump final statistics */
 	ifstat ( sender );
 	ifstat ( receiver );
 
-	return 0;
+	return rc;
 }
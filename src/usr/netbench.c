@@ -0,0 +1,322 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <ipxe/refcnt.h>
+#include <ipxe/interface.h>
+#include <ipxe/iobuf.h>
+#include <ipxe/xfer.h>
+#include <ipxe/open.h>
+#include <ipxe/job.h>
+#include <ipxe/monojob.h>
+#include <ipxe/uri.h>
+#include <ipxe/timer.h>
+#include <ipxe/profile.h>
+#include <ipxe/tcp.h>
+#include <usr/netbench.h>
+
+/** @file
+ *
+ * Network download benchmarking
+ *
+ */
+
+/** Results of a download benchmark */
+struct netbench_result {
+	/** Number of bytes received */
+	uint64_t bytes;
+	/** Elapsed time (in ticks) */
+	unsigned long ticks;
+	/** Time to first byte (in ticks) */
+	unsigned long ttfb;
+	/** Elapsed timestamp counter ticks */
+	uint64_t cycles;
+	/** Change in TCP statistics */
+	struct tcp_statistics tcp;
+};
+
+/** A download benchmark */
+struct netbench {
+	/** Reference count */
+	struct refcnt refcnt;
+	/** Job control interface */
+	struct interface job;
+	/** Data transfer interface */
+	struct interface xfer;
+
+	/** Start time (in ticks) */
+	unsigned long started;
+	/** Time of first received data (in ticks), or zero */
+	unsigned long first;
+	/** Completion time (in ticks), or zero */
+	unsigned long finished;
+	/** Number of bytes received */
+	size_t len;
+	/** Current position within file */
+	size_t pos;
+	/** Length of file (as far as is known) */
+	size_t max;
+};
+
+/**
+ * Terminate download benchmark
+ *
+ * @v bench		Download benchmark
+ * @v rc		Reason for termination
+ */
+static void netbench_close ( struct netbench *bench, int rc ) {
+
+	/* Record completion time */
+	if ( ! bench->finished )
+		bench->finished = currticks();
+
+	/* Shut down interfaces */
+	intf_shutdown ( &bench->xfer, rc );
+	intf_shutdown ( &bench->job, rc );
+}
+
+/**
+ * Report progress of download benchmark
+ *
+ * @v bench		Download benchmark
+ * @v progress		Progress report to fill in
+ */
+static void netbench_progress ( struct netbench *bench,
+				struct job_progress *progress ) {
+
+	progress->completed = bench->len;
+	progress->total = bench->max;
+}
+
+/**
+ * Discard received data
+ *
+ * @v bench		Download benchmark
+ * @v iobuf		Datagram I/O buffer
+ * @v meta		Data transfer metadata
+ * @ret rc		Return status code
+ */
+static int netbench_deliver ( struct netbench *bench, struct io_buffer *iobuf,
+			      struct xfer_metadata *meta ) {
+	size_t len = iob_len ( iobuf );
+
+	/* Track file position and length, as for a real download,
+	 * so that progress can be reported.
+	 */
+	if ( meta->flags & XFER_FL_ABS_OFFSET )
+		bench->pos = 0;
+	bench->pos += meta->offset;
+	if ( bench->max < ( bench->pos + len ) )
+		bench->max = ( bench->pos + len );
+	bench->pos += len;
+
+	/* Record time to first byte and discard data */
+	if ( len && ! bench->first )
+		bench->first = currticks();
+	bench->len += len;
+	free_iob ( iobuf );
+
+	return 0;
+}
+
+/** Download benchmark data transfer interface operations */
+static struct interface_operation netbench_xfer_op[] = {
+	INTF_OP ( xfer_deliver, struct netbench *, netbench_deliver ),
+	INTF_OP ( intf_close, struct netbench *, netbench_close ),
+};
+
+/** Download benchmark data transfer interface descriptor */
+static struct interface_descriptor netbench_xfer_desc =
+	INTF_DESC ( struct netbench, xfer, netbench_xfer_op );
+
+/** Download benchmark job control interface operations */
+static struct interface_operation netbench_job_op[] = {
+	INTF_OP ( job_progress, struct netbench *, netbench_progress ),
+	INTF_OP ( intf_close, struct netbench *, netbench_close ),
+};
+
+/** Download benchmark job control interface descriptor */
+static struct interface_descriptor netbench_job_desc =
+	INTF_DESC ( struct netbench, job, netbench_job_op );
+
+/**
+ * Convert ticks to milliseconds
+ *
+ * @v ticks		Time in ticks
+ * @ret ms		Time in milliseconds
+ */
+static unsigned long netbench_ms ( unsigned long ticks ) {
+	return ( ( ( uint64_t ) ticks * 1000 ) / TICKS_PER_SEC );
+}
+
+/**
+ * Run a single download benchmark
+ *
+ * @v uri		URI
+ * @v name		Name to display
+ * @v result		Results to fill in
+ * @ret rc		Return status code
+ */
+static int netbench_run ( struct uri *uri, const char *name,
+			  struct netbench_result *result ) {
+	struct tcp_statistics before;
+	union profiler profiler;
+	struct netbench *bench;
+	uint64_t start;
+	int rc;
+
+	/* Allocate and initialise structure */
+	bench = zalloc ( sizeof ( *bench ) );
+	if ( ! bench )
+		return -ENOMEM;
+	ref_init ( &bench->refcnt, NULL );
+	intf_init ( &bench->job, &netbench_job_desc, &bench->refcnt );
+	intf_init ( &bench->xfer, &netbench_xfer_desc, &bench->refcnt );
+
+	/* Record starting statistics */
+	memcpy ( &before, &tcp_stats, sizeof ( before ) );
+	profiler.timestamp = 0;
+	profile ( &profiler );
+	start = profiler.timestamp;
+	bench->started = currticks();
+
+	/* Open URI and wait for transfer to complete */
+	if ( ( rc = xfer_open_uri ( &bench->xfer, uri ) ) != 0 ) {
+		printf ( "Could not start download: %s\n", strerror ( rc ) );
+		netbench_close ( bench, rc );
+		goto err_open;
+	}
+	intf_plug_plug ( &bench->job, &monojob );
+	rc = monojob_wait ( name );
+	profile ( &profiler );
+
+	/* Record results */
+	result->bytes = bench->len;
+	result->ticks = ( bench->finished - bench->started );
+	result->ttfb = ( bench->first ? ( bench->first - bench->started ) : 0 );
+	result->cycles = ( profiler.timestamp - start );
+	result->tcp.retransmits = ( tcp_stats.retransmits -
+				    before.retransmits );
+	result->tcp.fast_retransmits = ( tcp_stats.fast_retransmits -
+					 before.fast_retransmits );
+	result->tcp.rx_duplicates = ( tcp_stats.rx_duplicates -
+				      before.rx_duplicates );
+	result->tcp.rx_out_of_order = ( tcp_stats.rx_out_of_order -
+					before.rx_out_of_order );
+	result->tcp.zero_windows = ( tcp_stats.zero_windows -
+				     before.zero_windows );
+
+ err_open:
+	ref_put ( &bench->refcnt );
+	return rc;
+}
+
+/**
+ * Report download benchmark results
+ *
+ * @v label		Label
+ * @v result		Results
+ */
+static void netbench_report ( const char *label,
+			      struct netbench_result *result ) {
+	unsigned long ms = netbench_ms ( result->ticks );
+
+	printf ( "%s: %lld bytes in %ld.%03lds", label, result->bytes,
+		 ( ms / 1000 ), ( ms % 1000 ) );
+	if ( ms ) {
+		printf ( " (%lld kbps)",
+			 ( ( result->bytes * 8 ) / ms ) );
+	}
+	printf ( ", first byte %ldms\n", netbench_ms ( result->ttfb ) );
+	printf ( "%s: %d retransmits (%d fast), %d duplicate, "
+		 "%d out of order, %d zero windows", label,
+		 result->tcp.retransmits, result->tcp.fast_retransmits,
+		 result->tcp.rx_duplicates, result->tcp.rx_out_of_order,
+		 result->tcp.zero_windows );
+	if ( result->bytes ) {
+		printf ( ", %lld cycles/byte",
+			 ( result->cycles / result->bytes ) );
+	}
+	printf ( "\n" );
+}
+
+/**
+ * Benchmark repeated downloads of a URI
+ *
+ * @v uri		URI
+ * @v count		Number of downloads
+ * @ret rc		Return status code
+ *
+ * The downloaded data is discarded, so that the results reflect only
+ * the performance of the network and protocol stack.  The jitter in
+ * results is at least one timer tick.  The cycle count covers the
+ * whole of each download, including time spent idle waiting for
+ * packets.
+ */
+int netbench ( struct uri *uri, unsigned int count ) {
+	size_t len = ( unparse_uri ( NULL, 0, uri, URI_ALL ) + 1 );
+	char uri_string_redacted[len];
+	struct netbench_result result;
+	struct netbench_result total;
+	const char *password;
+	char label[16];
+	unsigned int i;
+	int rc = 0;
+
+	/* Redact password portion of URI, if necessary */
+	password = uri->password;
+	if ( password )
+		uri->password = "***";
+	unparse_uri ( uri_string_redacted, sizeof ( uri_string_redacted ),
+		      uri, URI_ALL );
+	uri->password = password;
+
+	/* Run benchmarks */
+	memset ( &total, 0, sizeof ( total ) );
+	for ( i = 0 ; i < count ; i++ ) {
+		if ( ( rc = netbench_run ( uri, uri_string_redacted,
+					   &result ) ) != 0 )
+			break;
+		snprintf ( label, sizeof ( label ), "Run %d", ( i + 1 ) );
+		netbench_report ( label, &result );
+		total.bytes += result.bytes;
+		total.ticks += result.ticks;
+		total.ttfb += result.ttfb;
+		total.cycles += result.cycles;
+		total.tcp.retransmits += result.tcp.retransmits;
+		total.tcp.fast_retransmits += result.tcp.fast_retransmits;
+		total.tcp.rx_duplicates += result.tcp.rx_duplicates;
+		total.tcp.rx_out_of_order += result.tcp.rx_out_of_order;
+		total.tcp.zero_windows += result.tcp.zero_windows;
+	}
+
+	/* Report totals, with an average time to first byte */
+	if ( i > 1 ) {
+		total.ttfb /= i;
+		netbench_report ( "Total", &total );
+	}
+
+	return rc;
+}
@@ -0,0 +1,293 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/** @file
+ *
+ * LZ4 block compressor
+ *
+ * This produces a single raw LZ4 block (with no frame header), for
+ * decompression by the LZ4 prefix decompressor.  Since compression
+ * takes place only at build time, matches are found via a hash chain
+ * search with lazy evaluation, in order to approach the best
+ * compression ratio that the LZ4 format allows.
+ *
+ * The output obeys the LZ4 end-of-block restrictions (the final five
+ * bytes are always literals, and no match starts within the final
+ * twelve bytes), and so may also be decompressed by any standard LZ4
+ * block decompressor.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Minimum match length */
+#define LZ4_MIN_MATCH 4
+
+/** Maximum match offset */
+#define LZ4_MAX_OFFSET 0xffff
+
+/** Number of bytes at end of block which must be literals */
+#define LZ4_LAST_LITERALS 5
+
+/** Number of bytes at end of block within which no match may start */
+#define LZ4_MF_LIMIT 12
+
+/** Length field value indicating that extension bytes follow */
+#define LZ4_LEN_EXT 0x0f
+
+/** Number of bits in match hash */
+#define LZ4_HASH_BITS 16
+
+/** Maximum number of hash chain entries to search */
+#define LZ4_MAX_CHAIN 4096
+
+/**
+ * Calculate worst-case compressed length
+ *
+ * @v len		Uncompressed length
+ * @ret max_len		Maximum compressed length
+ */
+static size_t lz4_max_len ( size_t len ) {
+	return ( len + ( len / 255 ) + 16 );
+}
+
+/**
+ * Calculate hash of four bytes
+ *
+ * @v data		Data
+ * @ret hash		Hash value
+ */
+static unsigned int lz4_hash ( const uint8_t *data ) {
+	uint32_t value;
+
+	value = ( data[0] | ( data[1] << 8 ) | ( data[2] << 16 ) |
+		  ( ( ( uint32_t ) data[3] ) << 24 ) );
+	return ( ( value * 2654435761U ) >> ( 32 - LZ4_HASH_BITS ) );
+}
+
+/** LZ4 compression state */
+struct lz4_state {
+	/** Input data */
+	const uint8_t *in;
+	/** Input length */
+	size_t len;
+	/** Most recent position for each hash value */
+	long *head;
+	/** Previous position with the same hash value */
+	long *prev;
+	/** Next position to be inserted into the hash chains */
+	size_t inserted;
+};
+
+/**
+ * Insert positions into hash chains
+ *
+ * @v state		Compression state
+ * @v pos		Position up to which to insert (exclusive)
+ */
+static void lz4_insert ( struct lz4_state *state, size_t pos ) {
+	unsigned int hash;
+
+	for ( ; state->inserted < pos ; state->inserted++ ) {
+		if ( ( state->inserted + LZ4_MIN_MATCH ) > state->len )
+			break;
+		hash = lz4_hash ( state->in + state->inserted );
+		state->prev[state->inserted] = state->head[hash];
+		state->head[hash] = state->inserted;
+	}
+}
+
+/**
+ * Find longest match
+ *
+ * @v state		Compression state
+ * @v pos		Current position
+ * @v offset		Match offset to fill in
+ * @ret match_len	Match length, or zero if no match was found
+ */
+static size_t lz4_find ( struct lz4_state *state, size_t pos,
+			 size_t *offset ) {
+	const uint8_t *in = state->in;
+	size_t limit;
+	size_t best = 0;
+	size_t len;
+	unsigned int depth;
+	long cand;
+
+	/* No match may start within the final bytes of the block */
+	if ( ( pos + LZ4_MF_LIMIT ) > state->len )
+		return 0;
+	limit = ( state->len - LZ4_LAST_LITERALS - pos );
+
+	/* Search hash chain */
+	lz4_insert ( state, pos );
+	cand = state->head[ lz4_hash ( in + pos ) ];
+	for ( depth = 0 ; ( cand >= 0 ) && ( depth < LZ4_MAX_CHAIN ) ;
+	      cand = state->prev[cand], depth++ ) {
+		if ( ( pos - cand ) > LZ4_MAX_OFFSET )
+			break;
+		if ( in[ cand + best ] != in[ pos + best ] )
+			continue;
+		for ( len = 0 ; ( ( len < limit ) &&
+				  ( in[ cand + len ] == in[ pos + len ] ) ) ;
+		      len++ ) {}
+		if ( len > best ) {
+			best = len;
+			*offset = ( pos - cand );
+			if ( best == limit )
+				break;
+		}
+	}
+
+	return ( ( best >= LZ4_MIN_MATCH ) ? best : 0 );
+}
+
+/**
+ * Write length extension bytes
+ *
+ * @v out		Output pointer
+ * @v len		Length (excluding the part held in the token)
+ * @ret out		Updated output pointer
+ */
+static uint8_t * lz4_put_len ( uint8_t *out, size_t len ) {
+
+	for ( ; len >= 0xff ; len -= 0xff )
+		*(out++) = 0xff;
+	*(out++) = len;
+	return out;
+}
+
+/**
+ * Write sequence
+ *
+ * @v out		Output pointer
+ * @v literals		Literal data
+ * @v literal_len	Number of literals
+ * @v offset		Match offset
+ * @v match_len		Match length, or zero for the final sequence
+ * @ret out		Updated output pointer
+ */
+static uint8_t * lz4_put_sequence ( uint8_t *out, const uint8_t *literals,
+				    size_t literal_len, size_t offset,
+				    size_t match_len ) {
+	uint8_t *token = out++;
+	size_t match_ext = ( match_len - LZ4_MIN_MATCH );
+
+	/* Construct token and literals */
+	if ( literal_len >= LZ4_LEN_EXT ) {
+		*token = ( LZ4_LEN_EXT << 4 );
+		out = lz4_put_len ( out, ( literal_len - LZ4_LEN_EXT ) );
+	} else {
+		*token = ( literal_len << 4 );
+	}
+	memcpy ( out, literals, literal_len );
+	out += literal_len;
+
+	/* Construct match, if applicable */
+	if ( match_len ) {
+		*(out++) = ( offset & 0xff );
+		*(out++) = ( offset >> 8 );
+		if ( match_ext >= LZ4_LEN_EXT ) {
+			*token |= LZ4_LEN_EXT;
+			out = lz4_put_len ( out, ( match_ext - LZ4_LEN_EXT ) );
+		} else {
+			*token |= match_ext;
+		}
+	}
+
+	return out;
+}
+
+/**
+ * Compress data using LZ4
+ *
+ * @v data		Uncompressed data
+ * @v len		Length of uncompressed data
+ * @v out		Output buffer
+ * @v out_len		Length of compressed data to fill in
+ * @v max_len		Length of output buffer
+ * @ret rc		Return status code (zero on success)
+ */
+static int lz4_compress ( const void *data, size_t len, void *out,
+			  unsigned long *out_len, size_t max_len ) {
+	struct lz4_state state;
+	uint8_t *start = out;
+	uint8_t *pos = out;
+	size_t literal = 0;
+	size_t offset = 0;
+	size_t next_offset;
+	size_t match_len;
+	size_t next_len;
+	size_t i;
+	unsigned int hash;
+	int rc = -1;
+
+	/* Check that output buffer is large enough for any input */
+	if ( max_len < lz4_max_len ( len ) )
+		return -1;
+
+	/* Initialise hash chains */
+	state.in = data;
+	state.len = len;
+	state.inserted = 0;
+	state.head = malloc ( ( 1 << LZ4_HASH_BITS ) *
+			      sizeof ( state.head[0] ) );
+	state.prev = malloc ( ( len + 1 ) * sizeof ( state.prev[0] ) );
+	if ( ! ( state.head && state.prev ) )
+		goto err_alloc;
+	for ( hash = 0 ; hash < ( 1 << LZ4_HASH_BITS ) ; hash++ )
+		state.head[hash] = -1;
+
+	/* Construct sequences */
+	for ( i = 0 ; i < len ; ) {
+
+		/* Find best match at this position */
+		match_len = lz4_find ( &state, i, &offset );
+		if ( ! match_len ) {
+			i++;
+			continue;
+		}
+
+		/* Defer to a longer match at the next position, if any */
+		next_len = lz4_find ( &state, ( i + 1 ), &next_offset );
+		if ( next_len > match_len ) {
+			i++;
+			continue;
+		}
+
+		/* Emit sequence */
+		pos = lz4_put_sequence ( pos, ( state.in + literal ),
+					 ( i - literal ), offset, match_len );
+		i += match_len;
+		literal = i;
+	}
+
+	/* Emit final literals */
+	pos = lz4_put_sequence ( pos, ( state.in + literal ),
+				 ( len - literal ), 0, 0 );
+	*out_len = ( pos - start );
+	rc = 0;
+
+ err_alloc:
+	free ( state.prev );
+	free ( state.head );
+	return rc;
+}
@@ -4,10 +4,18 @@
 #define ENCODE
 #define VERBOSE
 #include "nrv2b.c"
+#include "lz4.c"
 FILE *infile, *outfile;
 
 #define DEBUG 0
 
+enum zbin_algorithm {
+	ZBIN_NRV2B,
+	ZBIN_LZ4,
+};
+
+static enum zbin_algorithm algorithm = ZBIN_NRV2B;
+
 struct input_file {
 	void *buf;
 	size_t len;
@@ -196,11 +204,24 @@ static int process_zinfo_pack ( struct input_file *input,
 		return -1;
 	}
 
-	if ( ucl_nrv2b_99_compress ( ( input->buf + offset ), len,
-				     ( output->buf + output->len ),
-				     &packed_len, 0 ) != UCL_E_OK ) {
-		fprintf ( stderr, "Compression failure\n" );
-		return -1;
+	switch ( algorithm ) {
+	case ZBIN_LZ4:
+		if ( lz4_compress ( ( input->buf + offset ), len,
+				    ( output->buf + output->len ),
+				    &packed_len,
+				    ( output->max_len - output->len ) ) != 0 ) {
+			fprintf ( stderr, "Compression failure\n" );
+			return -1;
+		}
+		break;
+	default:
+		if ( ucl_nrv2b_99_compress ( ( input->buf + offset ), len,
+					     ( output->buf + output->len ),
+					     &packed_len, 0 ) != UCL_E_OK ) {
+			fprintf ( stderr, "Compression failure\n" );
+			return -1;
+		}
+		break;
 	}
 
 	if ( DEBUG ) {
@@ -411,9 +432,21 @@ int main ( int argc, char **argv ) {
 	struct zinfo_file zinfo;
 	unsigned int i;
 
+	if ( ( argc == 5 ) && ( strcmp ( argv[1], "-a" ) == 0 ) ) {
+		if ( strcmp ( argv[2], "lz4" ) == 0 ) {
+			algorithm = ZBIN_LZ4;
+		} else if ( strcmp ( argv[2], "nrv2b" ) != 0 ) {
+			fprintf ( stderr, "Unknown compression algorithm "
+				  "\"%s\"\n", argv[2] );
+			exit ( 1 );
+		}
+		argc -= 2;
+		argv += 2;
+	}
+
 	if ( argc != 3 ) {
-		fprintf ( stderr, "Syntax: %s file.bin file.zinfo "
-			  "> file.zbin\n", argv[0] );
+		fprintf ( stderr, "Syntax: %s [-a nrv2b|lz4] file.bin "
+			  "file.zinfo > file.zbin\n", argv[0] );
 		exit ( 1 );
 	}
 